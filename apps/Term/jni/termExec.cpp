@@ -42,7 +42,9 @@
 #include <sys/wait.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <stdlib.h>
+#include <time.h>
 #include <unistd.h>
 #include <termios.h>
 
@@ -215,6 +217,81 @@ static int android_os_Exec_waitFor(JNIEnv *env, jobject clazz,
     return result;
 }
 
+static long long now_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * Wait for output on the pty, then keep reading what comes in for up to
+ * batchMillis, or until the buffer is full, so the caller gets it in one
+ * batch. Reads only happen when poll() says there is data, so they never
+ * block, and the pty (shared with the writer) stays in blocking mode.
+ *
+ * Returns the number of bytes put at the start of the direct buffer, or
+ * -1 once the pty is closed and everything was read.
+ */
+static jint android_os_Exec_readPty(JNIEnv *env, jobject clazz,
+    jobject fileDescriptor, jobject byteBuffer, jint batchMillis)
+{
+    int fd = env->GetIntField(fileDescriptor, field_fileDescriptor_descriptor);
+
+    if (env->ExceptionOccurred() != NULL) {
+        return -1;
+    }
+
+    char* buf = (char*) env->GetDirectBufferAddress(byteBuffer);
+    jlong capacity = env->GetDirectBufferCapacity(byteBuffer);
+    if (buf == NULL || capacity <= 0) {
+        LOGE("readPty needs a direct buffer");
+        return -1;
+    }
+
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+
+    jlong total = 0;
+    long long deadline = 0;
+    int timeout = -1;   // wait as long as it takes for the first bytes
+    while (total < capacity) {
+        pfd.revents = 0;
+        int ret = poll(&pfd, 1, timeout);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (ret == 0) {
+            break;      // batch window is over
+        }
+        if (!(pfd.revents & POLLIN)) {
+            break;      // hung up or error, with nothing left to read
+        }
+
+        ssize_t n = read(fd, buf + total, capacity - total);
+        if (n < 0 && (errno == EINTR || errno == EAGAIN)) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+
+        if (total == 0) {
+            deadline = now_ms() + batchMillis;
+        }
+        total += n;
+
+        long long left = deadline - now_ms();
+        timeout = left > 0 ? (int) left : 0;
+    }
+
+    return total > 0 ? (jint) total : -1;
+}
+
 static void android_os_Exec_close(JNIEnv *env, jobject clazz, jobject fileDescriptor)
 {
     int fd;
@@ -264,6 +341,8 @@ static JNINativeMethod method_table[] = {
         (void*) android_os_Exec_setPtyWindowSize},
     { "waitFor", "(I)I",
         (void*) android_os_Exec_waitFor},
+    { "readPty", "(Ljava/io/FileDescriptor;Ljava/nio/ByteBuffer;I)I",
+        (void*) android_os_Exec_readPty},
     { "close", "(Ljava/io/FileDescriptor;)V",
         (void*) android_os_Exec_close}
 };
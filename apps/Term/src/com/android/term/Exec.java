@@ -17,6 +17,7 @@
 package com.android.term;
 
 import java.io.FileDescriptor;
+import java.nio.ByteBuffer;
 
 /**
  * Utility methods for creating and managing a subprocess.
@@ -67,6 +68,20 @@ public class Exec
      */
     public static native int waitFor(int processId);
 
+    /**
+     * Read the output of a pty in batches. Blocks until there is output,
+     * then keeps reading for up to batchMillis, or until the buffer is
+     * full, so that a flood of output costs one call per batch.
+     *
+     * @param fd The pty, as returned by createSubprocess
+     * @param buffer A direct buffer, filled from its start. Its position
+     * and limit are not changed.
+     * @param batchMillis How long to keep reading after the first bytes.
+     * @return the number of bytes read, or -1 once the pty is closed.
+     */
+    public static native int readPty(FileDescriptor fd, ByteBuffer buffer,
+        int batchMillis);
+
     /**
      * Close a given file descriptor.
      */
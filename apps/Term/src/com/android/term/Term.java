@@ -17,9 +17,9 @@
 package com.android.term;
 
 import java.io.FileDescriptor;
-import java.io.FileInputStream;
 import java.io.FileOutputStream;
 import java.io.IOException;
+import java.nio.ByteBuffer;
 import java.util.ArrayList;
 
 import android.app.Activity;
@@ -2563,10 +2563,6 @@ class EmulatorView extends View implements GestureDetector.OnGestureListener {
     private int mLeftColumn;
 
     private FileDescriptor mTermFd;
-    /**
-     * Used to receive data from the remote process.
-     */
-    private FileInputStream mTermIn;
 
     private FileOutputStream mTermOut;
 
@@ -2584,6 +2580,18 @@ class EmulatorView extends View implements GestureDetector.OnGestureListener {
      */
     private static final int UPDATE = 1;
 
+    /**
+     * Size of the batches read from the remote process, and of the queue
+     * they go through to the UI thread.
+     */
+    private static final int RECEIVE_BATCH_SIZE = 16 * 1024;
+
+    /**
+     * How long the reader keeps collecting output before it hands it over,
+     * about a frame.
+     */
+    private static final int RECEIVE_BATCH_MILLIS = 16;
+
     /**
      * Thread that polls for input from the remote process
      */
@@ -2827,9 +2835,8 @@ class EmulatorView extends View implements GestureDetector.OnGestureListener {
         mForeground = Term.WHITE;
         mBackground = Term.BLACK;
         updateText();
-        mTermIn = new FileInputStream(mTermFd);
-        mReceiveBuffer = new byte[4 * 1024];
-        mByteQueue = new ByteQueue(4 * 1024);
+        mReceiveBuffer = new byte[RECEIVE_BATCH_SIZE];
+        mByteQueue = new ByteQueue(RECEIVE_BATCH_SIZE);
     }
 
     /**
@@ -2968,23 +2975,33 @@ class EmulatorView extends View implements GestureDetector.OnGestureListener {
             mKnownSize = true;
 
             // Set up a thread to read input from the
-            // pseudo-teletype:
+            // pseudo-teletype. It reads in batches and only tells the
+            // UI thread when it isn't already about to update.
 
             mPollingThread = new Thread(new Runnable() {
 
                 public void run() {
                     try {
                         while(true) {
-                            int read = mTermIn.read(mBuffer);
+                            int read = Exec.readPty(mTermFd, mDirectBuffer,
+                                    RECEIVE_BATCH_MILLIS);
+                            if (read < 0) {
+                                break;
+                            }
+                            mDirectBuffer.clear();
+                            mDirectBuffer.get(mBuffer, 0, read);
                             mByteQueue.write(mBuffer, 0, read);
-                            mHandler.sendMessage(
-                                    mHandler.obtainMessage(UPDATE));
+                            if (!mHandler.hasMessages(UPDATE)) {
+                                mHandler.sendMessage(
+                                        mHandler.obtainMessage(UPDATE));
+                            }
                         }
-                    } catch (IOException e) {
                     } catch (InterruptedException e) {
                     }
                 }
-                private byte[] mBuffer = new byte[4096];
+                private ByteBuffer mDirectBuffer =
+                        ByteBuffer.allocateDirect(RECEIVE_BATCH_SIZE);
+                private byte[] mBuffer = new byte[RECEIVE_BATCH_SIZE];
             });
             mPollingThread.setName("Input reader");
             mPollingThread.start();
@@ -3024,13 +3041,20 @@ class EmulatorView extends View implements GestureDetector.OnGestureListener {
 
     /**
      * Look for new input from the ptty, send it to the terminal emulator.
+     * Takes everything that was queued when it was called, since the
+     * reader only sends another UPDATE once this one has been taken.
      */
     private void update() {
         int bytesAvailable = mByteQueue.getBytesAvailable();
-        int bytesToRead = Math.min(bytesAvailable, mReceiveBuffer.length);
         try {
-            int bytesRead = mByteQueue.read(mReceiveBuffer, 0, bytesToRead);
-            append(mReceiveBuffer, 0, bytesRead);
+            while (bytesAvailable > 0) {
+                int bytesToRead =
+                        Math.min(bytesAvailable, mReceiveBuffer.length);
+                int bytesRead =
+                        mByteQueue.read(mReceiveBuffer, 0, bytesToRead);
+                append(mReceiveBuffer, 0, bytesRead);
+                bytesAvailable -= bytesRead;
+            }
         } catch (InterruptedException e) {
         }
     }
@@ -19,6 +19,9 @@
 // interface in order to enumerate USB interfaces for Android ADB class, and
 // for each interface found we will test USB I/O on that interface by sending
 // a simple "hand shake" message to the device connected via this interface.
+//
+// When started with -bench this application instead measures bulk transfer
+// throughput and latency on the first interface found, see PrintBenchUsage.
 
 #include "stdafx.h"
 
@@ -69,8 +72,88 @@ bool TestInterface(const wchar_t* device_name);
 bool TestInterfaceHandle(ADBAPIHANDLE interface_handle);
 
 // Sends a "handshake" message to the given interface.
-bool DeviceHandShake(ADBAPIHANDLE adb_interface);
+bool DeviceHandShake(ADBAPIHANDLE adb_interface);
+
+//
+// Benchmark declarations.
+//
+
+// What the device does with our transfers.
+enum BenchMode {
+  // Device discards what we write (sink).
+  BenchModeWrite,
+
+  // Device keeps sending data (source).
+  BenchModeRead,
+
+  // Device sends back what we write (loopback).
+  BenchModeEcho,
+};
+
+// AdbWinApi routines used for transfers.
+enum BenchApi {
+  // AdbRead/WriteEndpointSync, one transfer at a time.
+  BenchApiSync,
+
+  // AdbRead/WriteEndpointAsync, queue_depth transfers in flight.
+  BenchApiAsync,
+
+  // AdbRead/WriteEndpointSync on top of AdbStartEndpointStream.
+  BenchApiStream,
+};
+
+// Benchmark parameters, parsed from the command line.
+struct BenchSettings {
+  BenchMode     mode;
+  BenchApi      api;
+  unsigned long transfer_size;
+  unsigned long queue_depth;
+  unsigned long count;
+  unsigned long time_out;
+};
+
+// Transfer statistics collected by the benchmark.
+struct BenchResults {
+  // Latency of each transfer (round trip in echo mode), in milliseconds.
+  std::vector<double> latencies;
+
+  // Number of bytes moved, in either direction.
+  ULONGLONG           bytes;
+
+  // Total time of the run, in milliseconds.
+  double              elapsed;
+};
+
+// Prints command line help for the benchmark.
+void PrintBenchUsage();
+
+// Parses benchmark command line. Returns false on invalid arguments.
+bool ParseBenchArgs(int argc, TCHAR* argv[], BenchSettings* settings);
+
+// Runs the benchmark on the first interface found.
+bool RunBenchmark(const BenchSettings& settings);
+
+// Runs the transfers with AdbRead/WriteEndpointSync.
+bool BenchSync(ADBAPIHANDLE adb_read, ADBAPIHANDLE adb_write,
+               const BenchSettings& settings, BenchResults* results);
+
+// Runs the transfers with AdbRead/WriteEndpointAsync.
+bool BenchAsync(ADBAPIHANDLE adb_read, ADBAPIHANDLE adb_write,
+                const BenchSettings& settings, BenchResults* results);
+
+// Prints throughput and latency percentiles.
+void PrintBenchResults(const BenchSettings& settings, BenchResults* results);
+
 int __cdecl _tmain(int argc, TCHAR* argv[], TCHAR* envp[]) {
+  if ((argc > 1) && (0 == _tcscmp(argv[1], _T("-bench")))) {
+    BenchSettings settings;
+    if (!ParseBenchArgs(argc - 2, argv + 2, &settings)) {
+      PrintBenchUsage();
+      return -3;
+    }
+    return RunBenchmark(settings) ? 0 : -4;
+  }
+
   // Test enum interfaces.
   if (!TestEnumInterfaces())
     return -1;
@@ -424,3 +507,338 @@ bool DeviceHandShake(ADBAPIHANDLE adb_interface) {
 
   return true;
 }
+
+void PrintBenchUsage() {
+  printf("\nUsage: adb_winapi_test -bench <write|read|echo> [options]"
+         "\n  write   Device discards what we send (sink)."
+         "\n  read    Device keeps sending data (source)."
+         "\n  echo    Device sends back what we send (loopback)."
+         "\nOptions:"
+         "\n  -api <sync|async|stream>  AdbWinApi routines to use (sync)"
+         "\n  -size <bytes>             Transfer size (16384)"
+         "\n  -depth <n>                Transfers in flight with async and"
+         "\n                            stream APIs (4)"
+         "\n  -count <n>                Number of transfers (4096)"
+         "\n  -timeout <ms>             Timeout of each transfer (5000)\n");
+}
+
+bool ParseBenchArgs(int argc, TCHAR* argv[], BenchSettings* settings) {
+  settings->api = BenchApiSync;
+  settings->transfer_size = 16384;
+  settings->queue_depth = 4;
+  settings->count = 4096;
+  settings->time_out = 5000;
+
+  if (argc < 1)
+    return false;
+
+  if (0 == _tcscmp(argv[0], _T("write"))) {
+    settings->mode = BenchModeWrite;
+  } else if (0 == _tcscmp(argv[0], _T("read"))) {
+    settings->mode = BenchModeRead;
+  } else if (0 == _tcscmp(argv[0], _T("echo"))) {
+    settings->mode = BenchModeEcho;
+  } else {
+    return false;
+  }
+
+  for (int n = 1; n < argc; n += 2) {
+    if (n + 1 >= argc)
+      return false;
+
+    const TCHAR* value = argv[n + 1];
+    if (0 == _tcscmp(argv[n], _T("-api"))) {
+      if (0 == _tcscmp(value, _T("sync"))) {
+        settings->api = BenchApiSync;
+      } else if (0 == _tcscmp(value, _T("async"))) {
+        settings->api = BenchApiAsync;
+      } else if (0 == _tcscmp(value, _T("stream"))) {
+        settings->api = BenchApiStream;
+      } else {
+        return false;
+      }
+    } else if (0 == _tcscmp(argv[n], _T("-size"))) {
+      settings->transfer_size = _tcstoul(value, NULL, 0);
+    } else if (0 == _tcscmp(argv[n], _T("-depth"))) {
+      settings->queue_depth = _tcstoul(value, NULL, 0);
+    } else if (0 == _tcscmp(argv[n], _T("-count"))) {
+      settings->count = _tcstoul(value, NULL, 0);
+    } else if (0 == _tcscmp(argv[n], _T("-timeout"))) {
+      settings->time_out = _tcstoul(value, NULL, 0);
+    } else {
+      return false;
+    }
+  }
+
+  return (0 != settings->transfer_size) && (0 != settings->queue_depth) &&
+         (0 != settings->count);
+}
+
+// Returns time elapsed since 'start', in milliseconds.
+static double BenchElapsed(const LARGE_INTEGER& start) {
+  LARGE_INTEGER now;
+  LARGE_INTEGER freq;
+  QueryPerformanceCounter(&now);
+  QueryPerformanceFrequency(&freq);
+  return static_cast<double>(now.QuadPart - start.QuadPart) * 1000.0 /
+         static_cast<double>(freq.QuadPart);
+}
+
+bool RunBenchmark(const BenchSettings& settings) {
+  // Pick the first interface of our class
+  ADBAPIHANDLE enum_handle =
+    AdbEnumInterfaces(kAdbInterfaceId, true, true, true);
+  if (NULL == enum_handle) {
+    printf("\nUnable to enumerate ADB interfaces: %u", GetLastError());
+    return false;
+  }
+
+  union {
+    AdbInterfaceInfo interface_info;
+    char buf[4096];
+  };
+  unsigned long buf_size = sizeof(buf);
+  bool found = AdbNextInterface(enum_handle, &interface_info, &buf_size);
+  AdbCloseHandle(enum_handle);
+  if (!found) {
+    printf("\nNo ADB interfaces found.");
+    return false;
+  }
+
+  printf("\nBenchmark on %ws", interface_info.device_name);
+  ADBAPIHANDLE adb_interface =
+    AdbCreateInterfaceByName(interface_info.device_name);
+  if (NULL == adb_interface) {
+    printf("\nUnable to create interface by name: %u", GetLastError());
+    return false;
+  }
+
+  ADBAPIHANDLE adb_read = AdbOpenDefaultBulkReadEndpoint(adb_interface,
+                                                         AdbOpenAccessTypeReadWrite,
+                                                         AdbOpenSharingModeReadWrite);
+  ADBAPIHANDLE adb_write = AdbOpenDefaultBulkWriteEndpoint(adb_interface,
+                                                           AdbOpenAccessTypeReadWrite,
+                                                           AdbOpenSharingModeReadWrite);
+  if ((NULL == adb_read) || (NULL == adb_write)) {
+    printf("\nUnable to open bulk endpoints: %u", GetLastError());
+    if (NULL != adb_read)
+      AdbCloseHandle(adb_read);
+    if (NULL != adb_write)
+      AdbCloseHandle(adb_write);
+    AdbCloseHandle(adb_interface);
+    return false;
+  }
+
+  bool ret = true;
+  if (BenchApiStream == settings.api) {
+    if (!AdbStartEndpointStream(adb_read, settings.transfer_size,
+                                settings.queue_depth, settings.time_out) ||
+        !AdbStartEndpointStream(adb_write, settings.transfer_size,
+                                settings.queue_depth, settings.time_out)) {
+      printf("\nAdbStartEndpointStream returned error %u", GetLastError());
+      ret = false;
+    }
+  }
+
+  BenchResults results;
+  results.bytes = 0;
+  results.elapsed = 0;
+  if (ret) {
+    LARGE_INTEGER start;
+    QueryPerformanceCounter(&start);
+    ret = (BenchApiAsync == settings.api) ?
+          BenchAsync(adb_read, adb_write, settings, &results) :
+          BenchSync(adb_read, adb_write, settings, &results);
+    if (ret && (BenchApiStream == settings.api) &&
+        !AdbFlushEndpointStream(adb_write)) {
+      printf("\nAdbFlushEndpointStream returned error %u", GetLastError());
+      ret = false;
+    }
+    results.elapsed = BenchElapsed(start);
+  }
+
+  if (ret)
+    PrintBenchResults(settings, &results);
+
+  AdbCloseHandle(adb_write);
+  AdbCloseHandle(adb_read);
+  AdbCloseHandle(adb_interface);
+  return ret;
+}
+
+bool BenchSync(ADBAPIHANDLE adb_read, ADBAPIHANDLE adb_write,
+               const BenchSettings& settings, BenchResults* results) {
+  std::vector<char> write_buf(settings.transfer_size);
+  std::vector<char> read_buf(settings.transfer_size);
+  for (ULONG n = 0; n < settings.transfer_size; n++)
+    write_buf[n] = static_cast<char>(n);
+
+  results->latencies.reserve(settings.count);
+  for (ULONG transfer = 0; transfer < settings.count; transfer++) {
+    LARGE_INTEGER start;
+    QueryPerformanceCounter(&start);
+
+    if (BenchModeRead != settings.mode) {
+      ULONG written = 0;
+      if (!AdbWriteEndpointSync(adb_write, &write_buf[0],
+                                settings.transfer_size, &written,
+                                settings.time_out)) {
+        printf("\nAdbWriteEndpointSync returned error %u", GetLastError());
+        return false;
+      }
+      results->bytes += written;
+    }
+
+    if (BenchModeWrite != settings.mode) {
+      // A stream may hand the data back in pieces
+      ULONG received = 0;
+      do {
+        ULONG read = 0;
+        if (!AdbReadEndpointSync(adb_read, &read_buf[received],
+                                 settings.transfer_size - received, &read,
+                                 settings.time_out)) {
+          printf("\nAdbReadEndpointSync returned error %u", GetLastError());
+          return false;
+        }
+        received += read;
+        if ((0 == read) || (BenchApiStream != settings.api))
+          break;
+      } while (received < settings.transfer_size);
+      results->bytes += received;
+    }
+
+    results->latencies.push_back(BenchElapsed(start));
+  }
+
+  return true;
+}
+
+// One queued transfer of BenchAsync.
+struct BenchTransfer {
+  std::vector<char> buffer;
+  HANDLE            event;
+  ADBAPIHANDLE      io;
+  LARGE_INTEGER     start;
+};
+
+// Waits for a queued transfer and closes its handle.
+static bool BenchComplete(BenchTransfer* transfer, ULONG* transferred) {
+  bool ret = AdbGetOvelappedIoResult(transfer->io, NULL, transferred, true);
+  if (!ret)
+    printf("\nAdbGetOvelappedIoResult returned error %u", GetLastError());
+  AdbCloseHandle(transfer->io);
+  transfer->io = NULL;
+  return ret;
+}
+
+bool BenchAsync(ADBAPIHANDLE adb_read, ADBAPIHANDLE adb_write,
+                const BenchSettings& settings, BenchResults* results) {
+  // Each slot has a write and a read, whichever the mode uses. Slots are
+  // completed in the order they were submitted.
+  std::vector<BenchTransfer> writes(settings.queue_depth);
+  std::vector<BenchTransfer> reads(settings.queue_depth);
+  bool ret = true;
+  for (ULONG slot = 0; slot < settings.queue_depth; slot++) {
+    writes[slot].buffer.resize(settings.transfer_size);
+    reads[slot].buffer.resize(settings.transfer_size);
+    for (ULONG n = 0; n < settings.transfer_size; n++)
+      writes[slot].buffer[n] = static_cast<char>(n + slot);
+    writes[slot].io = NULL;
+    reads[slot].io = NULL;
+    writes[slot].event = CreateEvent(NULL, TRUE, FALSE, NULL);
+    reads[slot].event = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if ((NULL == writes[slot].event) || (NULL == reads[slot].event))
+      ret = false;
+  }
+
+  // Run depth slots past the last transfer to retire the ones in flight
+  results->latencies.reserve(settings.count);
+  ULONG total = settings.count + settings.queue_depth;
+  for (ULONG transfer = 0; ret && (transfer < total); transfer++) {
+    ULONG slot = transfer % settings.queue_depth;
+    BenchTransfer* write = &writes[slot];
+    BenchTransfer* read = &reads[slot];
+
+    // Retire what this slot queued depth transfers ago
+    if ((NULL != write->io) || (NULL != read->io)) {
+      ULONG transferred = 0;
+      if (NULL != write->io) {
+        ret = BenchComplete(write, &transferred) && ret;
+        results->bytes += transferred;
+      }
+      if (NULL != read->io) {
+        ret = BenchComplete(read, &transferred) && ret;
+        results->bytes += transferred;
+      }
+      results->latencies.push_back(BenchElapsed(
+        (BenchModeWrite == settings.mode) ? write->start : read->start));
+    }
+
+    if (!ret || (transfer >= settings.count))
+      continue;
+
+    if (BenchModeRead != settings.mode) {
+      QueryPerformanceCounter(&write->start);
+      write->io = AdbWriteEndpointAsync(adb_write, &write->buffer[0],
+                                        settings.transfer_size, NULL,
+                                        settings.time_out, write->event);
+      if (NULL == write->io) {
+        printf("\nAdbWriteEndpointAsync returned error %u", GetLastError());
+        ret = false;
+      }
+    }
+    if (ret && (BenchModeWrite != settings.mode)) {
+      // In echo mode the round trip starts with the write
+      if (BenchModeEcho == settings.mode)
+        read->start = write->start;
+      else
+        QueryPerformanceCounter(&read->start);
+      read->io = AdbReadEndpointAsync(adb_read, &read->buffer[0],
+                                      settings.transfer_size, NULL,
+                                      settings.time_out, read->event);
+      if (NULL == read->io) {
+        printf("\nAdbReadEndpointAsync returned error %u", GetLastError());
+        ret = false;
+      }
+    }
+  }
+
+  // On error, wait for what is still in flight
+  for (ULONG slot = 0; slot < settings.queue_depth; slot++) {
+    ULONG transferred;
+    if (NULL != writes[slot].io)
+      BenchComplete(&writes[slot], &transferred);
+    if (NULL != reads[slot].io)
+      BenchComplete(&reads[slot], &transferred);
+    if (NULL != writes[slot].event)
+      CloseHandle(writes[slot].event);
+    if (NULL != reads[slot].event)
+      CloseHandle(reads[slot].event);
+  }
+
+  return ret;
+}
+
+void PrintBenchResults(const BenchSettings& settings, BenchResults* results) {
+  static const char* const kModeNames[] = { "write", "read", "echo" };
+  static const char* const kApiNames[] = { "sync", "async", "stream" };
+
+  printf("\n%s, %s API: %u transfers of %u bytes, depth %u",
+         kModeNames[settings.mode], kApiNames[settings.api],
+         settings.count, settings.transfer_size,
+         (BenchApiSync == settings.api) ? 1 : settings.queue_depth);
+
+  double seconds = results->elapsed / 1000.0;
+  printf("\n  %I64u bytes in %.1f ms: %.2f MB/s", results->bytes,
+         results->elapsed,
+         (seconds > 0) ? (results->bytes / (1024.0 * 1024.0)) / seconds : 0.0);
+
+  std::vector<double>& lat = results->latencies;
+  if (lat.empty())
+    return;
+
+  std::sort(lat.begin(), lat.end());
+  printf("\n  latency (ms): min %.3f  p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n",
+         lat.front(), lat[lat.size() * 50 / 100], lat[lat.size() * 90 / 100],
+         lat[lat.size() * 99 / 100], lat.back());
+}
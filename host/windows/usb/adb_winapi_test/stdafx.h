@@ -40,6 +40,8 @@
 
 #include <stdio.h>
 #include <tchar.h>
+#include <vector>
+#include <algorithm>
 
 #define _ATL_STATIC_LIB_IMPL
 #define _ATL_APARTMENT_THREADED
@@ -23,6 +23,7 @@
 #include "adb_api.h"
 #include "adb_object_handle.h"
 #include "adb_interface_enum.h"
+#include "adb_interface_cache.h"
 #include "adb_interface.h"
 #include "adb_legacy_interface.h"
 #include "adb_endpoint_object.h"
@@ -146,7 +147,7 @@ ADBAPIHANDLE __cdecl AdbCreateInterface(GUID class_id,
   // Enumerate all active interfaces for the given class
   AdbEnumInterfaceArray interfaces;
 
-  if (!EnumerateDeviceInterfaces(class_id,
+  if (!GetCachedDeviceInterfaces(class_id,
                                  DIGCF_DEVICEINTERFACE | DIGCF_PRESENT,
                                  true,
                                  true,
@@ -166,7 +167,7 @@ ADBAPIHANDLE __cdecl AdbCreateInterface(GUID class_id,
   //    vid_xxxx is for the vendor id (xxxx are hex for the given vendor id),
   //    pid_xxxx is for the product id (xxxx are hex for the given product id)
   //    mi_xx is for the interface id  (xx are hex for the given interface id)
-  // EnumerateDeviceInterfaces will guarantee that returned interface names
+  // GetCachedDeviceInterfaces will guarantee that returned interface names
   // will have our class id at the end of the name (those last XXXes in the
   // format). So, we only need to match the beginning of the name
   wchar_t match_name[64];
@@ -480,6 +481,78 @@ bool __cdecl AdbWriteEndpointSync(ADBAPIHANDLE adb_endpoint,
   }
 }
 
+bool __cdecl AdbStartEndpointStream(ADBAPIHANDLE adb_endpoint,
+                            unsigned long transfer_size,
+                            unsigned long queue_depth,
+                            unsigned long time_out) {
+  // Lookup endpoint object for the handle
+  AdbEndpointObject* adb_object =
+    LookupObject<AdbEndpointObject>(adb_endpoint);
+
+  if (NULL != adb_object) {
+    // Dispatch the call to the found object
+    bool ret =
+      adb_object->StartStream(transfer_size, queue_depth, time_out);
+    adb_object->Release();
+    return ret;
+  } else {
+    SetLastError(ERROR_INVALID_HANDLE);
+    return false;
+  }
+}
+
+bool __cdecl AdbFlushEndpointStream(ADBAPIHANDLE adb_endpoint) {
+  // Lookup endpoint object for the handle
+  AdbEndpointObject* adb_object =
+    LookupObject<AdbEndpointObject>(adb_endpoint);
+
+  if (NULL != adb_object) {
+    // Dispatch the call to the found object
+    bool ret = adb_object->FlushStream();
+    adb_object->Release();
+    return ret;
+  } else {
+    SetLastError(ERROR_INVALID_HANDLE);
+    return false;
+  }
+}
+
+bool __cdecl AdbSetEndpointPolicy(ADBAPIHANDLE adb_endpoint,
+                          AdbEndpointPolicy policy,
+                          unsigned long value) {
+  // Lookup endpoint object for the handle
+  AdbEndpointObject* adb_object =
+    LookupObject<AdbEndpointObject>(adb_endpoint);
+
+  if (NULL != adb_object) {
+    // Dispatch the call to the found object
+    bool ret = adb_object->SetPolicy(policy, value);
+    adb_object->Release();
+    return ret;
+  } else {
+    SetLastError(ERROR_INVALID_HANDLE);
+    return false;
+  }
+}
+
+bool __cdecl AdbGetEndpointPolicy(ADBAPIHANDLE adb_endpoint,
+                          AdbEndpointPolicy policy,
+                          unsigned long* value) {
+  // Lookup endpoint object for the handle
+  AdbEndpointObject* adb_object =
+    LookupObject<AdbEndpointObject>(adb_endpoint);
+
+  if (NULL != adb_object) {
+    // Dispatch the call to the found object
+    bool ret = adb_object->GetPolicy(policy, value);
+    adb_object->Release();
+    return ret;
+  } else {
+    SetLastError(ERROR_INVALID_HANDLE);
+    return false;
+  }
+}
+
 bool __cdecl AdbGetOvelappedIoResult(ADBAPIHANDLE adb_io_completion,
                              LPOVERLAPPED overlapped,
                              unsigned long* bytes_transferred,
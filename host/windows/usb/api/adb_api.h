@@ -194,6 +194,32 @@ typedef enum _AdbOpenSharingMode {
   AdbOpenSharingModeExclusive,
 } AdbOpenSharingMode;
 
+/** \brief Defines transfer policies that can be set on an endpoint.
+
+  These are the WinUsb pipe policies of the same names, see WinUsb SDK doc
+  on WinUsb_SetPipePolicy for more information. Endpoints controlled by the
+  legacy driver don't support them.
+*/
+typedef enum _AdbEndpointPolicy {
+  /// Clears a stall condition automatically (AUTO_CLEAR_STALL). Boolean.
+  AdbEndpointPolicyAutoClearStall,
+
+  /// Timeout, in milliseconds, for transfers on the endpoint
+  /// (PIPE_TRANSFER_TIMEOUT). Note that the time_out of each read and
+  /// write on the endpoint replaces it.
+  AdbEndpointPolicyTransferTimeout,
+
+  /// Sends transfers straight to the device, without queueing them in the
+  /// driver (RAW_IO). Boolean. Reads must then use buffers that are a
+  /// multiple of the endpoint's maximum packet size and no larger than
+  /// AdbEndpointPolicyMaximumTransferSize.
+  AdbEndpointPolicyRawIo,
+
+  /// Largest transfer the driver accepts on the endpoint, in bytes
+  /// (MAXIMUM_TRANSFER_SIZE). Can only be queried.
+  AdbEndpointPolicyMaximumTransferSize,
+} AdbEndpointPolicy;
+
 /** \brief Provides information about an interface.
 */
 typedef struct _AdbInterfaceInfo {
@@ -576,6 +602,73 @@ ADBWIN_API bool __cdecl AdbWriteEndpointSync(ADBAPIHANDLE adb_endpoint,
                                      unsigned long* bytes_written,
                                      unsigned long time_out);
 
+/** \brief Starts streaming transfers on the given endpoint.
+
+  Keeps up to queue_depth transfers of transfer_size bytes queued with the
+  device, instead of one at a time, so the bus doesn't sit idle between
+  transfers. AdbReadEndpointSync / AdbWriteEndpointSync on the endpoint are
+  then served from the queue: reads return data already received in the
+  queued transfers, like reads from a byte stream, and writes return as
+  soon as their data is queued. Errors of queued writes are reported by
+  later writes or AdbFlushEndpointStream. The time_out argument of reads
+  and writes is ignored, the one given here applies to each transfer.
+  Closing the endpoint handle aborts the queued transfers.
+  @param[in] adb_endpoint A handle to opened endpoint object, obtained via one
+         of the AdbOpenXxxEndpoint calls.
+  @param[in] transfer_size Size of each queued transfer. For a write endpoint
+         it should be a multiple of the endpoint's maximum packet size.
+  @param[in] queue_depth Number of queued transfers, up to 32.
+  @param[in] time_out A timeout (in milliseconds) for each transfer. Zero
+         value for this parameter means that there is no timeout.
+  @return true on success and false on failure. If false is
+          returned GetLastError() provides extended error information.
+*/
+ADBWIN_API bool __cdecl AdbStartEndpointStream(ADBAPIHANDLE adb_endpoint,
+                                       unsigned long transfer_size,
+                                       unsigned long queue_depth,
+                                       unsigned long time_out);
+
+/** \brief Waits for the writes queued on the given endpoint to complete.
+
+  @param[in] adb_endpoint A handle to opened endpoint object on which
+         AdbStartEndpointStream was called.
+  @return true on success and false if one of the queued writes failed. If
+          false is returned GetLastError() provides extended error
+          information.
+*/
+ADBWIN_API bool __cdecl AdbFlushEndpointStream(ADBAPIHANDLE adb_endpoint);
+
+/** \brief Sets a transfer policy on the given endpoint.
+
+  @param[in] adb_endpoint A handle to opened endpoint object, obtained via one
+         of the AdbOpenXxxEndpoint calls.
+  @param[in] policy Policy to set, one of the AdbEndpointPolicy types.
+  @param[in] value Value of the policy. Boolean policies are enabled by
+         any non-zero value.
+  @return true on success and false on failure. If false is returned
+          GetLastError() provides extended error information.
+          ERROR_NOT_SUPPORTED is set if the endpoint doesn't support
+          transfer policies.
+*/
+ADBWIN_API bool __cdecl AdbSetEndpointPolicy(ADBAPIHANDLE adb_endpoint,
+                                     AdbEndpointPolicy policy,
+                                     unsigned long value);
+
+/** \brief Gets a transfer policy of the given endpoint.
+
+  @param[in] adb_endpoint A handle to opened endpoint object, obtained via one
+         of the AdbOpenXxxEndpoint calls.
+  @param[in] policy Policy to get, one of the AdbEndpointPolicy types.
+  @param[out] value Receives the value of the policy.
+  @return true on success and false on failure. If false is returned
+          GetLastError() provides extended error information.
+          ERROR_NOT_SUPPORTED is set if the endpoint doesn't support
+          transfer policies.
+*/
+ADBWIN_API bool __cdecl AdbGetEndpointPolicy(ADBAPIHANDLE adb_endpoint,
+                                     AdbEndpointPolicy policy,
+                                     unsigned long* value);
+
 /** \brief Gets overlapped I/O result for async I/O performed on the
   given endpoint.
 
@@ -21,6 +21,7 @@
 
 #include "stdafx.h"
 #include "adb_endpoint_object.h"
+#include "adb_io_completion.h"
 
 AdbEndpointObject::AdbEndpointObject(AdbInterfaceObject* parent_interf,
                                      UCHAR endpoint_id,
@@ -28,16 +29,61 @@ AdbEndpointObject::AdbEndpointObject(AdbInterfaceObject* parent_interf,
     : AdbObjectHandle(AdbObjectTypeEndpoint),
       parent_interface_(parent_interf),
       endpoint_id_(endpoint_id),
-      endpoint_index_(endpoint_index) {
+      endpoint_index_(endpoint_index),
+      io_event_count_(0),
+      stream_(NULL),
+      stream_depth_(0),
+      stream_transfer_size_(0),
+      stream_time_out_(0),
+      stream_head_(0),
+      stream_queued_(0),
+      stream_stopped_(false) {
   if (NULL != parent_interface_)
     parent_interface_->AddRef();
 }
 
 AdbEndpointObject::~AdbEndpointObject() {
+  FreeStream();
+
+  for (ULONG index = 0; index < io_event_count_; index++)
+    ::CloseHandle(io_events_[index]);
+
   if (NULL != parent_interface_)
     parent_interface_->Release();
 }
 
+HANDLE AdbEndpointObject::AcquireIoEvent() {
+  HANDLE ret = NULL;
+
+  io_event_locker_.Lock();
+  if (0 != io_event_count_)
+    ret = io_events_[--io_event_count_];
+  io_event_locker_.Unlock();
+
+  if (NULL == ret)
+    ret = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+  return ret;
+}
+
+void AdbEndpointObject::ReleaseIoEvent(HANDLE event_handle) {
+  if (NULL == event_handle)
+    return;
+
+  // An event that completed an I/O is left signaled
+  ResetEvent(event_handle);
+
+  io_event_locker_.Lock();
+  if (io_event_count_ < kIoEventPoolSize) {
+    io_events_[io_event_count_++] = event_handle;
+    event_handle = NULL;
+  }
+  io_event_locker_.Unlock();
+
+  if (NULL != event_handle)
+    ::CloseHandle(event_handle);
+}
+
 bool AdbEndpointObject::GetEndpointInformation(AdbEndpointInformation* info) {
   if (!IsOpened()) {
     SetLastError(ERROR_INVALID_HANDLE);
@@ -77,6 +123,13 @@ bool AdbEndpointObject::SyncRead(void* buffer,
                            ULONG bytes_to_read,
                            ULONG* bytes_read,
                            ULONG time_out) {
+  if (IsStreaming()) {
+    stream_locker_.Lock();
+    bool ret = StreamRead(buffer, bytes_to_read, bytes_read);
+    stream_locker_.Unlock();
+    return ret;
+  }
+
   return CommonSyncReadWrite(true,
                              buffer,
                              bytes_to_read,
@@ -88,9 +141,326 @@ bool AdbEndpointObject::SyncWrite(void* buffer,
                             ULONG bytes_to_write,
                             ULONG* bytes_written,
                             ULONG time_out) {
+  if (IsStreaming()) {
+    stream_locker_.Lock();
+    bool ret = StreamWrite(buffer, bytes_to_write, bytes_written);
+    stream_locker_.Unlock();
+    return ret;
+  }
+
   return CommonSyncReadWrite(false,
                              buffer,
                              bytes_to_write,
                              bytes_written,
                              time_out);
 }
+
+bool AdbEndpointObject::StartStream(ULONG transfer_size,
+                                    ULONG queue_depth,
+                                    ULONG time_out) {
+  if (!IsOpened()) {
+    SetLastError(ERROR_INVALID_HANDLE);
+    return false;
+  }
+
+  if ((0 == transfer_size) || (0 == queue_depth) ||
+      (queue_depth > kMaxStreamDepth)) {
+    SetLastError(ERROR_INVALID_PARAMETER);
+    return false;
+  }
+
+  stream_locker_.Lock();
+
+  if (IsStreaming()) {
+    stream_locker_.Unlock();
+    SetLastError(ERROR_GEN_FAILURE);
+    return false;
+  }
+
+  AdbStreamTransfer* stream = NULL;
+  try {
+    stream = new AdbStreamTransfer[queue_depth];
+    ZeroMemory(stream, queue_depth * sizeof(AdbStreamTransfer));
+    for (ULONG index = 0; index < queue_depth; index++)
+      stream[index].buffer = new UCHAR[transfer_size];
+  } catch (... ) {
+    // We don't expect exceptions other than OOM thrown here.
+    if (NULL != stream) {
+      for (ULONG index = 0; index < queue_depth; index++)
+        delete[] stream[index].buffer;
+      delete[] stream;
+    }
+    stream_locker_.Unlock();
+    SetLastError(ERROR_OUTOFMEMORY);
+    return false;
+  }
+
+  stream_ = stream;
+  stream_depth_ = queue_depth;
+  stream_transfer_size_ = transfer_size;
+  stream_time_out_ = time_out;
+  stream_head_ = 0;
+  stream_queued_ = 0;
+
+  bool ret = true;
+  for (ULONG index = 0; ret && (index < queue_depth); index++) {
+    stream_[index].event = CreateEvent(NULL, TRUE, FALSE, NULL);
+    ret = (NULL != stream_[index].event);
+  }
+
+  // Reads are queued right away. Only the first one failing is fatal, the
+  // others report their error once the caller gets to them.
+  if (ret && USB_ENDPOINT_DIRECTION_IN(endpoint_id())) {
+    ret = SubmitStreamTransfer(&stream_[0], stream_transfer_size_);
+    for (ULONG index = 1; ret && (index < queue_depth); index++)
+      SubmitStreamTransfer(&stream_[index], stream_transfer_size_);
+  }
+
+  if (!ret) {
+    ULONG error = GetLastError();
+    FreeStream();
+    SetLastError(error);
+  }
+
+  stream_locker_.Unlock();
+  return ret;
+}
+
+bool AdbEndpointObject::FlushStream() {
+  if (!IsStreaming()) {
+    SetLastError(ERROR_INVALID_HANDLE);
+    return false;
+  }
+
+  bool ret = true;
+  ULONG error = NO_ERROR;
+
+  stream_locker_.Lock();
+  while (!stream_stopped_ && (0 != stream_queued_)) {
+    if (!WaitStreamTransfer(&stream_[stream_head_]) && ret) {
+      ret = false;
+      error = GetLastError();
+    }
+    if (stream_stopped_)
+      break;
+    stream_head_ = (stream_head_ + 1) % stream_depth_;
+    stream_queued_--;
+  }
+  if (stream_stopped_ && ret) {
+    ret = false;
+    error = ERROR_OPERATION_ABORTED;
+  }
+  stream_locker_.Unlock();
+
+  if (!ret)
+    SetLastError(error);
+  return ret;
+}
+
+bool AdbEndpointObject::SetPolicy(AdbEndpointPolicy policy, ULONG value) {
+  SetLastError(IsOpened() ? ERROR_NOT_SUPPORTED : ERROR_INVALID_HANDLE);
+  return false;
+}
+
+bool AdbEndpointObject::GetPolicy(AdbEndpointPolicy policy, ULONG* value) {
+  SetLastError(IsOpened() ? ERROR_NOT_SUPPORTED : ERROR_INVALID_HANDLE);
+  return false;
+}
+
+bool AdbEndpointObject::CloseHandle() {
+  if (IsStreaming())
+    StopStream();
+
+  return AdbObjectHandle::CloseHandle();
+}
+
+bool AdbEndpointObject::StreamRead(void* buffer,
+                                   ULONG bytes_to_read,
+                                   ULONG* bytes_read) {
+  if (NULL != bytes_read)
+    *bytes_read = 0;
+
+  if (stream_stopped_) {
+    SetLastError(ERROR_OPERATION_ABORTED);
+    return false;
+  }
+
+  AdbStreamTransfer* transfer = &stream_[stream_head_];
+  bool ret = true;
+  if (NULL != transfer->io) {
+    ret = WaitStreamTransfer(transfer);
+    if (stream_stopped_)
+      return false;
+  } else if (NO_ERROR != transfer->error) {
+    // This transfer could not be queued
+    SetLastError(transfer->error);
+    ret = false;
+  }
+
+  ULONG copy = 0;
+  if (ret) {
+    copy = transfer->data_size - transfer->data_offset;
+    if (copy > bytes_to_read)
+      copy = bytes_to_read;
+    CopyMemory(buffer, transfer->buffer + transfer->data_offset, copy);
+    transfer->data_offset += copy;
+    if (NULL != bytes_read)
+      *bytes_read = copy;
+  }
+
+  // Once its data is consumed the transfer goes back at the end of the
+  // queue, which keeps the queue in submission order.
+  if (!ret || (transfer->data_offset >= transfer->data_size)) {
+    ULONG error = GetLastError();
+    SubmitStreamTransfer(transfer, stream_transfer_size_);
+    stream_head_ = (stream_head_ + 1) % stream_depth_;
+    SetLastError(error);
+  }
+
+  return ret;
+}
+
+bool AdbEndpointObject::StreamWrite(void* buffer,
+                                    ULONG bytes_to_write,
+                                    ULONG* bytes_written) {
+  if (NULL != bytes_written)
+    *bytes_written = 0;
+
+  const UCHAR* data = reinterpret_cast<const UCHAR*>(buffer);
+  ULONG left = bytes_to_write;
+
+  // A zero length write is queued as well, it ends the device's transfer.
+  do {
+    if (stream_stopped_) {
+      SetLastError(ERROR_OPERATION_ABORTED);
+      return false;
+    }
+
+    // Retire the oldest write if they are all in flight
+    if (stream_queued_ == stream_depth_) {
+      bool ok = WaitStreamTransfer(&stream_[stream_head_]);
+      if (stream_stopped_)
+        return false;
+      stream_head_ = (stream_head_ + 1) % stream_depth_;
+      stream_queued_--;
+      if (!ok)
+        return false;
+    }
+
+    AdbStreamTransfer* transfer =
+      &stream_[(stream_head_ + stream_queued_) % stream_depth_];
+    ULONG chunk = (left > stream_transfer_size_) ? stream_transfer_size_ :
+                                                   left;
+    CopyMemory(transfer->buffer, data, chunk);
+    if (!SubmitStreamTransfer(transfer, chunk))
+      return false;
+    stream_queued_++;
+
+    data += chunk;
+    left -= chunk;
+  } while (0 != left);
+
+  if (NULL != bytes_written)
+    *bytes_written = bytes_to_write;
+
+  return true;
+}
+
+bool AdbEndpointObject::SubmitStreamTransfer(AdbStreamTransfer* transfer,
+                                             ULONG size) {
+  ATLASSERT(NULL == transfer->io);
+
+  transfer->data_size = 0;
+  transfer->data_offset = 0;
+  transfer->error = NO_ERROR;
+
+  // Not every driver resets the event when it takes the request
+  ResetEvent(transfer->event);
+
+  ADBAPIHANDLE io_handle =
+    CommonAsyncReadWrite(USB_ENDPOINT_DIRECTION_IN(endpoint_id()) ? true :
+                                                                    false,
+                         transfer->buffer,
+                         size,
+                         NULL,
+                         transfer->event,
+                         stream_time_out_);
+  if (NULL == io_handle) {
+    transfer->error = GetLastError();
+    return false;
+  }
+
+  // Keep a reference to the completion object while it is in flight
+  transfer->io = LookupObject<AdbIOCompletion>(io_handle);
+  ATLASSERT(NULL != transfer->io);
+
+  return true;
+}
+
+bool AdbEndpointObject::WaitStreamTransfer(AdbStreamTransfer* transfer) {
+  ATLASSERT(NULL != transfer->io);
+
+  // Don't block the thread closing the endpoint while we wait
+  AdbIOCompletion* io = transfer->io;
+  io->AddRef();
+  stream_locker_.Unlock();
+
+  WaitForSingleObject(transfer->event, INFINITE);
+
+  stream_locker_.Lock();
+  io->Release();
+
+  if (stream_stopped_) {
+    SetLastError(ERROR_OPERATION_ABORTED);
+    return false;
+  }
+
+  ULONG transferred = 0;
+  bool ret = io->GetOvelappedIoResult(NULL, &transferred, true);
+  ULONG error = GetLastError();
+
+  io->CloseHandle();
+  io->Release();
+  transfer->io = NULL;
+  transfer->data_size = ret ? transferred : 0;
+
+  SetLastError(error);
+  return ret;
+}
+
+void AdbEndpointObject::StopStream() {
+  stream_locker_.Lock();
+
+  stream_stopped_ = true;
+
+  // Transfers have been cancelled, so they are about to complete. Their
+  // buffers and events outlive this, threads still waiting on them find
+  // the stream stopped once they're back.
+  for (ULONG index = 0; index < stream_depth_; index++) {
+    AdbStreamTransfer* transfer = &stream_[index];
+    if (NULL != transfer->io) {
+      WaitForSingleObject(transfer->event, INFINITE);
+      transfer->io->CloseHandle();
+      transfer->io->Release();
+      transfer->io = NULL;
+    }
+  }
+
+  stream_locker_.Unlock();
+}
+
+void AdbEndpointObject::FreeStream() {
+  if (NULL == stream_)
+    return;
+
+  for (ULONG index = 0; index < stream_depth_; index++) {
+    ATLASSERT(NULL == stream_[index].io);
+    if (NULL != stream_[index].event)
+      ::CloseHandle(stream_[index].event);
+    delete[] stream_[index].buffer;
+  }
+
+  delete[] stream_;
+  stream_ = NULL;
+  stream_depth_ = 0;
+}
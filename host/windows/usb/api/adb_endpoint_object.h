@@ -23,6 +23,32 @@
 
 #include "adb_interface.h"
 
+class AdbIOCompletion;
+
+/** \brief One of the transfers queued by an endpoint stream.
+
+  See AdbEndpointObject::StartStream for more information.
+*/
+struct AdbStreamTransfer {
+  /// Transfer buffer
+  UCHAR*            buffer;
+
+  /// Number of bytes the last completed read put in the buffer
+  ULONG             data_size;
+
+  /// Number of those bytes already given to the caller
+  ULONG             data_offset;
+
+  /// Event signaled when the transfer completes
+  HANDLE            event;
+
+  /// Completion object of the transfer in flight. NULL if none.
+  AdbIOCompletion*  io;
+
+  /// Error that prevented the transfer from being queued
+  ULONG             error;
+};
+
 /** Class AdbEndpointObject encapsulates a handle opened to an endpoint on
   our device.
 
@@ -182,6 +208,80 @@ class ADBWIN_API_CLASS AdbEndpointObject : public AdbObjectHandle {
                          ULONG* bytes_written,
                          ULONG time_out);
 
+  /** \brief Starts streaming transfers on this endpoint.
+
+    Synchronous I/O leaves the bus idle between the completion of a transfer
+    and the submission of the next one. Once a stream is started, this
+    endpoint keeps up to queue_depth transfers of transfer_size bytes queued
+    with the device and SyncRead / SyncWrite are served from them:
+    - On an IN endpoint all the transfers are submitted right away, and
+      reads return data from the oldest completed one, resubmitting it once
+      the caller has consumed it. Reads thus behave like reads from a byte
+      stream, a read can return data that came in more than one transfer
+      from the device, or part of one.
+    - On an OUT endpoint writes copy the data into free transfers, split in
+      transfer_size chunks, and return as soon as it is queued. A write only
+      waits when all the transfers are in flight. A failure of a queued
+      transfer is reported by the write that waits for it or by FlushStream.
+    The time_out parameter of reads and writes is ignored, queued transfers
+    use the timeout given here. Reads, writes and flushes should not be
+    issued concurrently from several threads. Closing the handle to the
+    endpoint may be done from another thread, it aborts the queued transfers.
+    @param[in] transfer_size Size of each transfer. For writes it should be
+           a multiple of the endpoint's maximum packet size so that the
+           device sees the chunks as one transfer.
+    @param[in] queue_depth Number of transfers kept queued.
+    @param[in] time_out A timeout (in milliseconds) for each transfer. Zero
+           value in this parameter means that there is no timeout.
+    @return true on success, false on failure. If false is returned
+            GetLastError() provides extended error information.
+            ERROR_GEN_FAILURE is set if the stream is already started.
+  */
+  virtual bool StartStream(ULONG transfer_size,
+                           ULONG queue_depth,
+                           ULONG time_out);
+
+  /** \brief Waits for all the writes queued by the stream to complete.
+
+    @return true on success, false if one of the writes failed or if the
+            endpoint is not streaming. If false is returned GetLastError()
+            provides extended error information.
+  */
+  virtual bool FlushStream();
+
+  /** \brief Sets a transfer policy on this endpoint.
+
+    Transfer policies are only supported by WinUsb endpoints, this
+    implementation fails with ERROR_NOT_SUPPORTED.
+    @param[in] policy Policy to set.
+    @param[in] value Value of the policy.
+    @return true on success, false on failure. If false is returned
+            GetLastError() provides extended error information.
+  */
+  virtual bool SetPolicy(AdbEndpointPolicy policy, ULONG value);
+
+  /** \brief Gets a transfer policy of this endpoint.
+
+    Transfer policies are only supported by WinUsb endpoints, this
+    implementation fails with ERROR_NOT_SUPPORTED.
+    @param[in] policy Policy to get.
+    @param[out] value Receives the value of the policy.
+    @return true on success, false on failure. If false is returned
+            GetLastError() provides extended error information.
+  */
+  virtual bool GetPolicy(AdbEndpointPolicy policy, ULONG* value);
+
+  /** \brief This method is called when handle to this object gets closed.
+
+    We override this method in order to abort the stream started on this
+    endpoint. Subclasses must have cancelled pending transfers before
+    calling it.
+    @return true on success or false if object is already closed. If
+            false is returned GetLastError() provides extended error
+            information.
+  */
+  virtual bool CloseHandle();
+
  public:
   /// This is a helper for extracting object from the AdbObjectHandleMap
   static AdbObjectType Type() {
@@ -208,7 +308,61 @@ class ADBWIN_API_CLASS AdbEndpointObject : public AdbObjectHandle {
                                           NULL;
   }
 
+  /// Checks if a stream has been started on this endpoint
+  bool IsStreaming() const {
+    return NULL != stream_;
+  }
+
+ protected:
+  /** \brief Gets a manual-reset event for a synchronous I/O
+
+    Synchronous reads and writes are issued as overlapped I/O and need an
+    event to wait on. Instead of creating a new event for each transfer
+    we keep a few of them cached by the endpoint, since bulk transfers
+    are performed back to back for the whole lifetime of the endpoint.
+    @return Event handle in non-signaled state or NULL on failure. If NULL
+            is returned GetLastError() provides extended error information.
+            The event must be returned with ReleaseIoEvent.
+  */
+  HANDLE AcquireIoEvent();
+
+  /** \brief Returns an event obtained with AcquireIoEvent
+
+    @param[in] event_handle Event to return. Can be NULL.
+  */
+  void ReleaseIoEvent(HANDLE event_handle);
+
+  /// Reads from the stream. Called under stream_locker_.
+  bool StreamRead(void* buffer, ULONG bytes_to_read, ULONG* bytes_read);
+
+  /// Writes to the stream. Called under stream_locker_.
+  bool StreamWrite(void* buffer, ULONG bytes_to_write, ULONG* bytes_written);
+
+  /// Submits a stream transfer of the given size
+  bool SubmitStreamTransfer(AdbStreamTransfer* transfer, ULONG size);
+
+  /** \brief Waits for a stream transfer to complete.
+
+    Called under stream_locker_, which is released during the wait.
+    @return true on success, false if the transfer failed or if the stream
+            has been stopped meanwhile. If false is returned GetLastError()
+            provides extended error information.
+  */
+  bool WaitStreamTransfer(AdbStreamTransfer* transfer);
+
+  /// Stops the stream once pending transfers have been cancelled
+  void StopStream();
+
+  /// Frees the stream transfers, none of them may be in flight
+  void FreeStream();
+
  protected:
+  /// Maximum number of idle events cached by the endpoint
+  static const ULONG  kIoEventPoolSize = 4;
+
+  /// Maximum number of transfers queued by a stream
+  static const ULONG  kMaxStreamDepth = 32;
+
   /// Parent interface
   AdbInterfaceObject* parent_interface_;
 
@@ -217,6 +371,39 @@ class ADBWIN_API_CLASS AdbEndpointObject : public AdbObjectHandle {
 
   /// This endpoint index on the interface
   UCHAR               endpoint_index_;
+
+  /// Idle events cached for synchronous I/O
+  HANDLE              io_events_[kIoEventPoolSize];
+
+  /// Number of events in io_events_
+  ULONG               io_event_count_;
+
+  /// Locker for io_events_
+  CComAutoCriticalSection io_event_locker_;
+
+  /// Stream transfers, NULL if no stream has been started
+  AdbStreamTransfer*  stream_;
+
+  /// Number of transfers in stream_
+  ULONG               stream_depth_;
+
+  /// Size of each stream transfer
+  ULONG               stream_transfer_size_;
+
+  /// Timeout for stream transfers
+  ULONG               stream_time_out_;
+
+  /// Index of the oldest queued stream transfer
+  ULONG               stream_head_;
+
+  /// Number of writes in flight, starting at stream_head_
+  ULONG               stream_queued_;
+
+  /// Set once the stream has been stopped by CloseHandle
+  bool                stream_stopped_;
+
+  /// Locker for the stream state
+  CComAutoCriticalSection stream_locker_;
 };
 
 #endif  // ANDROID_USB_API_ADB_ENDPOINT_OBJECT_H__
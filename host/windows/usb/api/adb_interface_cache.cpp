@@ -0,0 +1,355 @@
+/*
+ * Copyright (C) 2006 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file
+  This file consists of implementation of the cache of enumerated device
+  interfaces, that is kept up to date by device change notifications.
+*/
+
+#include "stdafx.h"
+#include <dbt.h>
+#include <process.h>
+#include "adb_api.h"
+#include "adb_interface_cache.h"
+#include "adb_helper_routines.h"
+
+/// Delay between a device change notification and the enumeration it
+/// triggers, so that the notifications for the interfaces of one device
+/// are handled at once
+static const UINT kRefreshDelayMs = 100;
+
+/// Age after which a cached list gets enumerated again anyway
+static const DWORD kMaxCacheAgeMs = 10000;
+
+/// Timer of the watcher window that triggers the enumeration
+static const UINT_PTR kRefreshTimerId = 1;
+
+/// Window class of the watcher window
+static const wchar_t kWatcherClassName[] = L"AdbWinApiInterfaceWatcher";
+
+/** \brief Parameters of an enumeration, and its cached result
+*/
+struct AdbCachedInterfaces {
+  /// Device class ID
+  GUID                  class_id;
+
+  /// Flags passed to SetupDiGetClassDevs
+  ULONG                 flags;
+
+  /// Whether interfaces with SPINT_REMOVED flag set are excluded
+  bool                  exclude_removed;
+
+  /// Whether only interfaces with SPINT_ACTIVE flag set are included
+  bool                  active_only;
+
+  /// Value of the_change_count when the enumeration started
+  ULONG                 change_count;
+
+  /// GetTickCount() when the enumeration completed
+  DWORD                 enumerated_at;
+
+  /// Enumerated interfaces
+  AdbEnumInterfaceArray interfaces;
+};
+
+/// Defines array of cached enumerations
+typedef std::vector< AdbCachedInterfaces > AdbCachedInterfacesArray;
+
+/** \brief A device class for which notifications have been requested
+*/
+struct AdbWatchedClass {
+  /// Device class ID
+  GUID  class_id;
+
+  /// False if the registration failed. The class is not cached then.
+  bool  registered;
+};
+
+/// Cached enumerations, by parameters
+AdbCachedInterfacesArray          the_cache;
+
+/// Classes for which notifications have been requested
+std::vector< AdbWatchedClass >    the_watched_classes;
+
+/// Locker for the cache, the watched classes and the change count
+CComAutoCriticalSection           the_cache_locker;
+
+/// Incremented on each device change notification, a cached enumeration
+/// that started before the last one is stale.
+ULONG                             the_change_count = 0;
+
+/// Window receiving the notifications, NULL if the watcher is not running
+HWND                              the_watcher_window = NULL;
+
+/// Set once the watcher has been started (or failed to start)
+bool                              the_watcher_started = false;
+
+static void RefreshCache();
+
+/// Handles the messages of the watcher window
+static LRESULT CALLBACK WatcherWindowProc(HWND window,
+                                          UINT message,
+                                          WPARAM wparam,
+                                          LPARAM lparam) {
+  switch (message) {
+    case WM_DEVICECHANGE:
+      if ((DBT_DEVICEARRIVAL == wparam) || (DBT_DEVICEREMOVECOMPLETE == wparam)) {
+        // Until the refresh, enumerations go to the SetupDi calls again
+        the_cache_locker.Lock();
+        the_change_count++;
+        the_cache_locker.Unlock();
+
+        // Restarts the timer if it is already running
+        SetTimer(window, kRefreshTimerId, kRefreshDelayMs, NULL);
+      }
+      return TRUE;
+
+    case WM_TIMER:
+      if (kRefreshTimerId == wparam) {
+        KillTimer(window, kRefreshTimerId);
+        RefreshCache();
+        return 0;
+      }
+      break;
+  }
+
+  return DefWindowProc(window, message, wparam, lparam);
+}
+
+/// Creates the watcher window and runs its message loop
+static unsigned __stdcall WatcherThread(void* param) {
+  HANDLE ready = reinterpret_cast<HANDLE>(param);
+  HINSTANCE instance = _AtlBaseModule.GetModuleInstance();
+
+  WNDCLASS window_class;
+  ZeroMemory(&window_class, sizeof(window_class));
+  window_class.lpfnWndProc = WatcherWindowProc;
+  window_class.hInstance = instance;
+  window_class.lpszClassName = kWatcherClassName;
+
+  // The window only receives messages, nothing is displayed
+  HWND window = NULL;
+  if ((0 != RegisterClass(&window_class)) ||
+      (ERROR_CLASS_ALREADY_EXISTS == GetLastError())) {
+    window = CreateWindow(kWatcherClassName, L"", 0, 0, 0, 0, 0,
+                          HWND_MESSAGE, NULL, instance, NULL);
+  }
+
+  the_watcher_window = window;
+  SetEvent(ready);
+
+  if (NULL == window)
+    return 0;
+
+  MSG msg;
+  while (GetMessage(&msg, NULL, 0, 0) > 0)
+    DispatchMessage(&msg);
+
+  return 0;
+}
+
+/** \brief Starts the watcher thread, the first time it is called.
+
+  The thread runs until the process exits. Before it starts, the DLL takes
+  a reference on itself that it never releases, so that it does not get
+  unloaded under the thread. Must be called with the_cache_locker held.
+  @return true if the watcher window is available.
+*/
+static bool StartWatcher() {
+  if (the_watcher_started)
+    return (NULL != the_watcher_window);
+
+  the_watcher_started = true;
+
+  wchar_t module_path[MAX_PATH];
+  DWORD len = GetModuleFileName(_AtlBaseModule.GetModuleInstance(),
+                                module_path,
+                                MAX_PATH);
+  if ((0 == len) || (MAX_PATH == len) || (NULL == LoadLibrary(module_path)))
+    return false;
+
+  HANDLE ready = CreateEvent(NULL, TRUE, FALSE, NULL);
+  if (NULL == ready)
+    return false;
+
+  uintptr_t thread = _beginthreadex(NULL, 0, WatcherThread, ready, 0, NULL);
+  if (0 != thread) {
+    WaitForSingleObject(ready, INFINITE);
+    CloseHandle(reinterpret_cast<HANDLE>(thread));
+  }
+  CloseHandle(ready);
+
+  return (NULL != the_watcher_window);
+}
+
+/** \brief Registers for the interface notifications of a class, the first
+  time it is called for that class.
+
+  Must be called with the_cache_locker held.
+  @return true if the notifications of the class are received.
+*/
+static bool WatchClass(GUID class_id) {
+  for (size_t i = 0; i < the_watched_classes.size(); i++) {
+    if (IsEqualGUID(class_id, the_watched_classes[i].class_id))
+      return the_watched_classes[i].registered;
+  }
+
+  DEV_BROADCAST_DEVICEINTERFACE filter;
+  ZeroMemory(&filter, sizeof(filter));
+  filter.dbcc_size = sizeof(filter);
+  filter.dbcc_devicetype = DBT_DEVTYP_DEVICEINTERFACE;
+  filter.dbcc_classguid = class_id;
+
+  AdbWatchedClass watched;
+  watched.class_id = class_id;
+  watched.registered = (NULL != RegisterDeviceNotification(the_watcher_window,
+                                                           &filter,
+                                                           DEVICE_NOTIFY_WINDOW_HANDLE));
+  the_watched_classes.push_back(watched);
+
+  return watched.registered;
+}
+
+/// Finds the cached enumeration with the parameters of 'key', or NULL.
+/// Must be called with the_cache_locker held.
+static AdbCachedInterfaces* FindCachedInterfaces(const AdbCachedInterfaces& key) {
+  for (AdbCachedInterfacesArray::iterator it = the_cache.begin();
+       it != the_cache.end(); it++) {
+    if (IsEqualGUID(key.class_id, it->class_id) &&
+        (key.flags == it->flags) &&
+        (key.exclude_removed == it->exclude_removed) &&
+        (key.active_only == it->active_only)) {
+      return &(*it);
+    }
+  }
+
+  return NULL;
+}
+
+/// Stores the enumeration of 'key' in the cache, unless a more recent one
+/// is there already. Takes the_cache_locker.
+static void StoreCachedInterfaces(const AdbCachedInterfaces& key,
+                                  const AdbEnumInterfaceArray& interfaces) {
+  the_cache_locker.Lock();
+
+  try {
+    AdbCachedInterfaces* entry = FindCachedInterfaces(key);
+    if (NULL == entry) {
+      the_cache.push_back(key);
+      entry = &the_cache.back();
+    } else if (static_cast<LONG>(key.change_count - entry->change_count) < 0) {
+      entry = NULL;
+    }
+
+    if (NULL != entry) {
+      entry->interfaces = interfaces;
+      entry->change_count = key.change_count;
+      entry->enumerated_at = GetTickCount();
+    }
+  } catch (...) {
+    // Not cached, the next enumeration will go to SetupDi again
+  }
+
+  the_cache_locker.Unlock();
+}
+
+/// Enumerates again all the cached enumerations, on the watcher thread
+static void RefreshCache() {
+  AdbCachedInterfacesArray keys;
+
+  the_cache_locker.Lock();
+  try {
+    for (size_t i = 0; i < the_cache.size(); i++) {
+      keys.push_back(AdbCachedInterfaces());
+      AdbCachedInterfaces& key = keys.back();
+      key.class_id = the_cache[i].class_id;
+      key.flags = the_cache[i].flags;
+      key.exclude_removed = the_cache[i].exclude_removed;
+      key.active_only = the_cache[i].active_only;
+      key.change_count = the_change_count;
+      key.enumerated_at = 0;
+    }
+  } catch (...) {
+  }
+  the_cache_locker.Unlock();
+
+  for (size_t i = 0; i < keys.size(); i++) {
+    AdbEnumInterfaceArray interfaces;
+    if (EnumerateDeviceInterfaces(keys[i].class_id,
+                                  keys[i].flags,
+                                  keys[i].exclude_removed,
+                                  keys[i].active_only,
+                                  &interfaces)) {
+      StoreCachedInterfaces(keys[i], interfaces);
+    }
+  }
+}
+
+bool GetCachedDeviceInterfaces(GUID class_id,
+                               ULONG flags,
+                               bool exclude_removed,
+                               bool active_only,
+                               AdbEnumInterfaceArray* interfaces) {
+  AdbCachedInterfaces key;
+  key.class_id = class_id;
+  key.flags = flags;
+  key.exclude_removed = exclude_removed;
+  key.active_only = active_only;
+  key.change_count = 0;
+  key.enumerated_at = 0;
+
+  bool cached = false;
+
+  the_cache_locker.Lock();
+  try {
+    // The notifications are set up before the first enumeration, so that
+    // no change goes unnoticed after it.
+    if (StartWatcher() && WatchClass(class_id)) {
+      cached = true;
+      key.change_count = the_change_count;
+
+      AdbCachedInterfaces* entry = FindCachedInterfaces(key);
+      if ((NULL != entry) &&
+          (entry->change_count == the_change_count) &&
+          ((GetTickCount() - entry->enumerated_at) < kMaxCacheAgeMs)) {
+        *interfaces = entry->interfaces;
+        the_cache_locker.Unlock();
+        return true;
+      }
+    }
+  } catch (...) {
+    the_cache_locker.Unlock();
+    SetLastError(ERROR_OUTOFMEMORY);
+    return false;
+  }
+  the_cache_locker.Unlock();
+
+  // Enumerate without holding the lock, the SetupDi calls take a while
+  AdbEnumInterfaceArray tmp;
+  if (!EnumerateDeviceInterfaces(class_id,
+                                 flags,
+                                 exclude_removed,
+                                 active_only,
+                                 &tmp)) {
+    return false;
+  }
+
+  if (cached)
+    StoreCachedInterfaces(key, tmp);
+
+  interfaces->swap(tmp);
+  return true;
+}
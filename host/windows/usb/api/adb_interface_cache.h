@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2006 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_USB_API_ADB_INTERFACE_CACHE_H__
+#define ANDROID_USB_API_ADB_INTERFACE_CACHE_H__
+/** \file
+  This file consists of declaration of the cache of enumerated device
+  interfaces, that is kept up to date by device change notifications.
+*/
+
+#include "adb_api_private_defines.h"
+
+/** \brief Enumerates all interfaces for our device class from the cache.
+
+  This routine returns the same interfaces as EnumerateDeviceInterfaces,
+  without walking the device information set each time. The first call for
+  a class registers for device interface notifications of that class. Each
+  set of parameters then has its own copy of the interface list, which is
+  enumerated again when an interface of the class arrives or goes away, by
+  a watcher thread of this DLL, so that the enumeration calls made while
+  polling for devices just copy it. A list is also enumerated again if it
+  is older than a few seconds, in case a notification is missed. If the
+  notifications cannot be set up this routine just calls
+  EnumerateDeviceInterfaces.
+  @param[in] class_id Device class ID how it is specified by our USB driver
+  @param[in] flags Flags to pass to SetupDiGetClassDevs to filter devices. See
+         SetupDiGetClassDevs() in SDK for more info on these flags.
+  @param[in] exclude_removed If true interfaces with SPINT_REMOVED flag set
+         will be not included in the enumeration.
+  @param[in] active_only If true only active interfaces (with flag
+         SPINT_ACTIVE set) will be included in the enumeration.
+  @param[out] interfaces Upon successfull completion will consist of array of
+         all interfaces found for this device (matching all filters).
+  @return True on success, false on failure, in which case GetLastError()
+          provides extended information about the error that occurred.
+*/
+bool GetCachedDeviceInterfaces(GUID class_id,
+                               ULONG flags,
+                               bool exclude_removed,
+                               bool active_only,
+                               AdbEnumInterfaceArray* interfaces);
+
+#endif  // ANDROID_USB_API_ADB_INTERFACE_CACHE_H__
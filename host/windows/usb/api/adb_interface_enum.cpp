@@ -22,7 +22,7 @@
 #include "stdafx.h"
 #include "adb_api.h"
 #include "adb_interface_enum.h"
-#include "adb_helper_routines.h"
+#include "adb_interface_cache.h"
 
 AdbInterfaceEnumObject::AdbInterfaceEnumObject()
     : AdbObjectHandle(AdbObjectTypeInterfaceEnumerator) {
@@ -41,8 +41,8 @@ bool AdbInterfaceEnumObject::InitializeEnum(GUID class_id,
   if (exclude_not_present)
     flags |= DIGCF_PRESENT;
 
-  // Do the enum
-  bool ret = EnumerateDeviceInterfaces(class_id,
+  // Do the enum, from the cache while no device comes or goes
+  bool ret = GetCachedDeviceInterfaces(class_id,
                                        flags,
                                        exclude_removed,
                                        active_only,
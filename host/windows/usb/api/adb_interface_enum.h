@@ -42,8 +42,9 @@ class AdbInterfaceEnumObject : public AdbObjectHandle {
  public:
   /** \brief Enumerates all interfaces for the given device class.
 
-    This routine uses SetupDiGetClassDevs to get our device info and calls
-    EnumerateDeviceInterfaces to perform the enumeration.
+    This routine gets the interfaces from GetCachedDeviceInterfaces, which
+    only calls SetupDiGetClassDevs and EnumerateDeviceInterfaces when the
+    devices have changed since the previous enumeration.
     @param[in] class_id Device class ID that is specified by our USB driver
     @param[in] exclude_not_present If set include only those devices that are
            currently present.
@@ -143,9 +143,14 @@ bool AdbLegacyEndpointObject::CommonSyncReadWrite(bool is_read,
 
   // This is synchronous I/O. Since we always open I/O items for
   // overlapped I/O we're obligated to always provide OVERLAPPED
-  // structure to read / write routines. Prepare it now.
+  // structure to read / write routines. Prepare it now. We wait on our
+  // own event rather than on the file handle, which gets signaled by
+  // any I/O completing on it.
   OVERLAPPED overlapped;
   ZeroMemory(&overlapped, sizeof(overlapped));
+  overlapped.hEvent = AcquireIoEvent();
+  if (NULL == overlapped.hEvent)
+    return false;
 
   BOOL ret = TRUE;
   ULONG ioctl_write_transferred = 0;
@@ -174,6 +179,7 @@ bool AdbLegacyEndpointObject::CommonSyncReadWrite(bool is_read,
   // Lets see the result
   if (!ret && (ERROR_IO_PENDING != GetLastError())) {
     // I/O failed.
+    ReleaseIoEvent(overlapped.hEvent);
     return false;
   }
 
@@ -185,6 +191,8 @@ bool AdbLegacyEndpointObject::CommonSyncReadWrite(bool is_read,
                                           transferred;
   }
 
+  ReleaseIoEvent(overlapped.hEvent);
+
   return ret ? true : false;
 }
 
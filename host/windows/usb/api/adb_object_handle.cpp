@@ -24,14 +24,96 @@
 #include "adb_api.h"
 #include "adb_object_handle.h"
 
-/// Global ADBAPIHANDLE -> AdbObjectHandle* map
-AdbObjectHandleMap      the_map;
+/// Number of slots in a chunk of the handle table
+static const ULONG kHandleChunkSlots = 256;
 
-/// Locker for the AdbObjectHandleMap instance
+/// Maximum number of chunks in the handle table
+static const ULONG kHandleMaxChunks = 256;
+
+/// Number of low bits of a handle value that hold its slot index
+static const ULONG kHandleIndexBits = 16;
+
+/// Largest generation stored in the high bits of a handle value
+static const ULONG kHandleMaxGeneration = 0x7FFF;
+
+/** \brief A slot of the handle table
+
+  A handle value is made of the index of its slot and of the slot's
+  generation, which changes each time the slot gets reused, so a stale
+  handle never finds the object that replaced it.
+*/
+struct AdbObjectHandleSlot {
+  /// Handle assigned from this slot, NULL if the slot is not in use
+  ADBAPIHANDLE volatile     handle;
+
+  /// Object associated with the handle
+  AdbObjectHandle* volatile object;
+
+  /// Number of lookups currently reading this slot
+  LONG volatile             readers;
+
+  /// Generation of the last handle assigned from this slot
+  ULONG                     generation;
+};
+
+/// Global ADBAPIHANDLE -> AdbObjectHandle* table. Chunks are allocated as
+/// handles get created and never freed, so lookups can read the table
+/// without holding a lock.
+AdbObjectHandleSlot* volatile the_map[kHandleMaxChunks];
+
+/// Locker for creating and closing handles in the table
 CComAutoCriticalSection the_map_locker;
 
-/// Next adb handle value generator
-ULONG_PTR               next_adb_handle_value = 0;
+/// Number of slots in the allocated chunks
+ULONG                   the_map_slots = 0;
+
+/// Next slot to try when looking for a free one
+ULONG                   next_free_slot = 0;
+
+/// Gets a slot of the table, or NULL if its chunk is not allocated
+static AdbObjectHandleSlot* GetHandleSlot(ULONG index) {
+  if (index >= kHandleChunkSlots * kHandleMaxChunks)
+    return NULL;
+
+  AdbObjectHandleSlot* chunk = the_map[index / kHandleChunkSlots];
+  return (NULL != chunk) ? &chunk[index % kHandleChunkSlots] : NULL;
+}
+
+/// Finds a free slot in the table, growing it if all slots are in use.
+/// Must be called under the_map_locker.
+static AdbObjectHandleSlot* AllocHandleSlot(ULONG* index) {
+  // Reuse slots round robin, so the same slot is not reused right away
+  for (ULONG probe = 0; probe < the_map_slots; probe++) {
+    ULONG candidate = (next_free_slot + probe) % the_map_slots;
+    AdbObjectHandleSlot* slot = GetHandleSlot(candidate);
+    if (NULL == slot->object) {
+      *index = candidate;
+      next_free_slot = candidate + 1;
+      return slot;
+    }
+  }
+
+  if (the_map_slots >= kHandleChunkSlots * kHandleMaxChunks)
+    return NULL;
+
+  AdbObjectHandleSlot* chunk = NULL;
+  try {
+    chunk = new AdbObjectHandleSlot[kHandleChunkSlots];
+  } catch (...) {
+    return NULL;
+  }
+  ZeroMemory(chunk, kHandleChunkSlots * sizeof(AdbObjectHandleSlot));
+
+  // Publish the chunk only once it has been initialized
+  AdbObjectHandleSlot* volatile* entry =
+    &the_map[the_map_slots / kHandleChunkSlots];
+  InterlockedExchangePointer(reinterpret_cast<PVOID volatile*>(entry), chunk);
+
+  *index = the_map_slots;
+  the_map_slots += kHandleChunkSlots;
+  next_free_slot = *index + 1;
+  return chunk;
+}
 
 AdbObjectHandle::AdbObjectHandle(AdbObjectType obj_type)
     : adb_handle_(NULL),
@@ -71,19 +153,24 @@ ADBAPIHANDLE AdbObjectHandle::CreateHandle() {
   ATLASSERT(!IsOpened());
 
   if (!IsOpened()) {
-    try {
-      // Generate next handle value
-      next_adb_handle_value++;
-      ret = reinterpret_cast<ADBAPIHANDLE>(next_adb_handle_value);
+    ULONG index = 0;
+    AdbObjectHandleSlot* slot = AllocHandleSlot(&index);
+    if (NULL != slot) {
+      // Generate next handle value for the slot
+      slot->generation = (slot->generation % kHandleMaxGeneration) + 1;
+      ret = reinterpret_cast<ADBAPIHANDLE>(
+        (static_cast<ULONG_PTR>(slot->generation) << kHandleIndexBits) | index);
 
-      // Add ourselves to the map
-      the_map[ret] = this;
-
-      // Save handle, addref and return
+      // Save handle and addref
       adb_handle_ = ret;
       AddRef();
-    } catch (...) {
-      ret = NULL;
+
+      // Add ourselves to the table. The handle goes last, so a lookup that
+      // matches it finds the object.
+      slot->object = this;
+      InterlockedExchangePointer(
+        reinterpret_cast<PVOID volatile*>(&slot->handle), ret);
+    } else {
       SetLastError(ERROR_OUTOFMEMORY);
     }
   } else {
@@ -100,7 +187,7 @@ bool AdbObjectHandle::CloseHandle() {
   bool ret = false;
 
   // Addref just in case that last reference to this object is being
-  // held in the map
+  // held in the table
   AddRef();
 
   the_map_locker.Lock();
@@ -108,23 +195,30 @@ bool AdbObjectHandle::CloseHandle() {
   ATLASSERT(IsOpened());
 
   if (IsOpened()) {
-    try {
-      // Look us up in the map.
-      AdbObjectHandleMap::iterator found = the_map.find(adb_handle());
-      ATLASSERT((found != the_map.end()) && (this == found->second));
-
-      if ((found != the_map.end()) && (this == found->second)) {
-        // Remove ourselves from the map, close and release the object
-        the_map.erase(found);
-        adb_handle_ = NULL;
-        Release();
-        ret = true;
-      } else {
-        SetLastError(ERROR_INVALID_HANDLE);
-      }
-    } catch (...) {
-      ret = false;
-      SetLastError(ERROR_OUTOFMEMORY);
+    // Look us up in the table.
+    AdbObjectHandleSlot* slot = GetHandleSlot(static_cast<ULONG>(
+      reinterpret_cast<ULONG_PTR>(adb_handle()) &
+        ((1 << kHandleIndexBits) - 1)));
+    ATLASSERT((NULL != slot) && (adb_handle() == slot->handle) &&
+              (this == slot->object));
+
+    if ((NULL != slot) && (adb_handle() == slot->handle) &&
+        (this == slot->object)) {
+      // Remove ourselves from the table. Lookups that have read the handle
+      // before it was cleared are about to reference us, let them finish
+      // before we release the table's reference.
+      InterlockedExchangePointer(
+        reinterpret_cast<PVOID volatile*>(&slot->handle), NULL);
+      while (0 != slot->readers)
+        SwitchToThread();
+      slot->object = NULL;
+
+      // Close and release the object
+      adb_handle_ = NULL;
+      Release();
+      ret = true;
+    } else {
+      SetLastError(ERROR_INVALID_HANDLE);
     }
   } else {
     SetLastError(ERROR_INVALID_HANDLE);
@@ -148,20 +242,22 @@ void AdbObjectHandle::LastReferenceReleased() {
 AdbObjectHandle* AdbObjectHandle::Lookup(ADBAPIHANDLE adb_hndl) {
   AdbObjectHandle* ret = NULL;
 
-  the_map_locker.Lock();
+  if (NULL == adb_hndl)
+    return NULL;
 
-  try {
-    // Look us up in the map.
-    AdbObjectHandleMap::iterator found = the_map.find(adb_hndl);
-    if (found != the_map.end()) {
-      ret = found->second;
+  // This doesn't take the_map_locker, so that concurrent I/O on different
+  // objects doesn't serialize here. See CloseHandle for how we avoid
+  // referencing an object that is being released.
+  AdbObjectHandleSlot* slot = GetHandleSlot(static_cast<ULONG>(
+    reinterpret_cast<ULONG_PTR>(adb_hndl) & ((1 << kHandleIndexBits) - 1)));
+  if (NULL != slot) {
+    InterlockedIncrement(&slot->readers);
+    if (adb_hndl == slot->handle) {
+      ret = slot->object;
       ret->AddRef();
     }
-  } catch (...) {
-    SetLastError(ERROR_OUTOFMEMORY);
+    InterlockedDecrement(&slot->readers);
   }
 
-  the_map_locker.Unlock();
-
   return ret;
 }
@@ -48,9 +48,13 @@ enum AdbObjectType {
   
   In order to prevent crashes when API client tries to access an object through
   an invalid or already closed handle, we keep track of all opened handles in
-  AdbObjectHandleMap that maps association between valid ADBAPIHANDLE and
-  an object that this handle represents. All objects that are exposed to the
-  outside of API via ADBAPIHANDLE are self-destructing referenced objects.
+  AdbObjectHandleMap, a table of slots that maps association between valid
+  ADBAPIHANDLE and an object that this handle represents. A handle value
+  holds the index of its slot and a generation number that changes each time
+  the slot is reused, so lookups are a table access and don't need a lock.
+  Creating and closing handles is still serialized. All objects that are
+  exposed to the outside of API via ADBAPIHANDLE are self-destructing
+  referenced objects.
   The reference model for these objects is as such:
   1. When CreateHandle() method is called on an object, a handle (ADBAPIHANDLE
      that is) is assigned to it, a pair <handle, object> is added to the global
@@ -64,9 +68,10 @@ enum AdbObjectType {
      return from this method, just before returning from the API call, object
      is dereferenced back to match lookup reference.
   3. When object handle gets closed, assuming object is found in the map, that
-     <handle, object> pair is deleted from the map and object's refcount is
-     decremented to match refcount increment performed when object has been
-     added to the map.
+     <handle, object> pair is deleted from the map, lookups still in progress
+     on its slot are waited for, and object's refcount is decremented to
+     match refcount increment performed when object has been added to the
+     map.
   4. When object's refcount drops to zero, the object commits suicide by
      calling "delete this".
   All API objects that have handles that are sent back to API client must be
@@ -181,9 +186,6 @@ class ADBWIN_API_CLASS AdbObjectHandle {
   LONG          ref_count_;
 };
 
-/// Maps ADBAPIHANDLE to associated AdbObjectHandle object
-typedef std::map< ADBAPIHANDLE, AdbObjectHandle* > AdbObjectHandleMap;
-
 /** \brief Template routine that unifies extracting of objects of different
   types from the AdbObjectHandleMap
 
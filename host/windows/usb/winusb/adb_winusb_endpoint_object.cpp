@@ -118,7 +118,9 @@ bool AdbWinUsbEndpointObject::CommonSyncReadWrite(bool is_read,
   // structure to read / write routines. Prepare it now.
   OVERLAPPED overlapped;
   ZeroMemory(&overlapped, sizeof(overlapped));
-  overlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+  overlapped.hEvent = AcquireIoEvent();
+  if (NULL == overlapped.hEvent)
+    return false;
 
   BOOL ret = TRUE;
   ULONG transferred = 0;
@@ -140,8 +142,7 @@ bool AdbWinUsbEndpointObject::CommonSyncReadWrite(bool is_read,
   // Lets see the result
   if (!ret && (ERROR_IO_PENDING != GetLastError())) {
     // I/O failed.
-    if (NULL != overlapped.hEvent)
-      ::CloseHandle(overlapped.hEvent);
+    ReleaseIoEvent(overlapped.hEvent);
     return false;
   }
 
@@ -152,12 +153,95 @@ bool AdbWinUsbEndpointObject::CommonSyncReadWrite(bool is_read,
     *bytes_transferred = transferred;
   }
 
-  if (NULL != overlapped.hEvent)
-    ::CloseHandle(overlapped.hEvent);
+  ReleaseIoEvent(overlapped.hEvent);
 
   return ret ? true : false;
 }
 
+bool AdbWinUsbEndpointObject::CloseHandle() {
+  if (IsStreaming())
+    WinUsb_AbortPipe(parent_winusb_interface()->winusb_handle(), endpoint_id());
+
+  return AdbEndpointObject::CloseHandle();
+}
+
+bool AdbWinUsbEndpointObject::SetPolicy(AdbEndpointPolicy policy,
+                                        ULONG value) {
+  if (!IsOpened()) {
+    SetLastError(ERROR_INVALID_HANDLE);
+    return false;
+  }
+
+  UCHAR flag = (0 != value) ? TRUE : FALSE;
+  switch (policy) {
+    case AdbEndpointPolicyAutoClearStall:
+      return WinUsb_SetPipePolicy(parent_winusb_interface()->winusb_handle(),
+                                  endpoint_id(), AUTO_CLEAR_STALL,
+                                  sizeof(flag), &flag) ? true : false;
+
+    case AdbEndpointPolicyTransferTimeout:
+      return SetTimeout(value);
+
+    case AdbEndpointPolicyRawIo:
+      return WinUsb_SetPipePolicy(parent_winusb_interface()->winusb_handle(),
+                                  endpoint_id(), RAW_IO,
+                                  sizeof(flag), &flag) ? true : false;
+
+    default:
+      // MAXIMUM_TRANSFER_SIZE is read only
+      SetLastError(ERROR_INVALID_PARAMETER);
+      return false;
+  }
+}
+
+bool AdbWinUsbEndpointObject::GetPolicy(AdbEndpointPolicy policy,
+                                        ULONG* value) {
+  if (!IsOpened()) {
+    SetLastError(ERROR_INVALID_HANDLE);
+    return false;
+  }
+
+  if (NULL == value) {
+    SetLastError(ERROR_INVALID_PARAMETER);
+    return false;
+  }
+
+  ULONG policy_type;
+  switch (policy) {
+    case AdbEndpointPolicyAutoClearStall:
+      policy_type = AUTO_CLEAR_STALL;
+      break;
+
+    case AdbEndpointPolicyTransferTimeout:
+      policy_type = PIPE_TRANSFER_TIMEOUT;
+      break;
+
+    case AdbEndpointPolicyRawIo:
+      policy_type = RAW_IO;
+      break;
+
+    case AdbEndpointPolicyMaximumTransferSize:
+      policy_type = MAXIMUM_TRANSFER_SIZE;
+      break;
+
+    default:
+      SetLastError(ERROR_INVALID_PARAMETER);
+      return false;
+  }
+
+  // Boolean policies are returned in a single byte
+  ULONG result = 0;
+  bool is_flag = (AUTO_CLEAR_STALL == policy_type) || (RAW_IO == policy_type);
+  ULONG size = is_flag ? sizeof(UCHAR) : sizeof(ULONG);
+  if (!WinUsb_GetPipePolicy(parent_winusb_interface()->winusb_handle(),
+                            endpoint_id(), policy_type, &size, &result)) {
+    return false;
+  }
+
+  *value = is_flag ? *reinterpret_cast<UCHAR*>(&result) : result;
+  return true;
+}
+
 bool AdbWinUsbEndpointObject::SetTimeout(ULONG timeout) {
   if (!WinUsb_SetPipePolicy(parent_winusb_interface()->winusb_handle(),
                             endpoint_id(), PIPE_TRANSFER_TIMEOUT,
@@ -121,6 +121,36 @@ class AdbWinUsbEndpointObject : public AdbEndpointObject {
   // Operations
   //
 
+ public:
+  /** \brief This method is called when handle to this object gets closed.
+
+    We override this method in order to abort the transfers queued by a
+    stream started on this endpoint.
+    @return true on success or false if object is already closed. If
+            false is returned GetLastError() provides extended error
+            information.
+  */
+  virtual bool CloseHandle();
+
+  /** \brief Sets a transfer policy on this endpoint.
+
+    @param[in] policy Policy to set. AdbEndpointPolicyMaximumTransferSize
+           can't be set.
+    @param[in] value Value of the policy.
+    @return true on success, false on failure. If false is returned
+            GetLastError() provides extended error information.
+  */
+  virtual bool SetPolicy(AdbEndpointPolicy policy, ULONG value);
+
+  /** \brief Gets a transfer policy of this endpoint.
+
+    @param[in] policy Policy to get.
+    @param[out] value Receives the value of the policy.
+    @return true on success, false on failure. If false is returned
+            GetLastError() provides extended error information.
+  */
+  virtual bool GetPolicy(AdbEndpointPolicy policy, ULONG* value);
+
  protected:
   /** \brief Sets read / write operation timeout.
 
@@ -22,6 +22,10 @@
 #include <time.h>
 #include <android/log.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <GLES/gl.h>
+
+#include "app.h"
 
 int   gAppAlive   = 1;
 
@@ -31,6 +35,27 @@ static int  sDemoStopped  = 0;
 static long sTimeOffset   = 0;
 static int  sTimeOffsetInit = 0;
 static long sTimeStopped  = 0;
+static int  sUseVBO       = 0;
+
+/* Benchmark mode: the demo timeline advances by a fixed step per frame
+ * instead of following the clock, so every run renders the same frames,
+ * whatever their rate. The time spent in appRender (CPU submit), in an
+ * optional glFinish (GPU drain) and between frames is recorded for each
+ * frame, and logged when the last one is done.
+ */
+typedef struct {
+    int       submitUs;
+    int       finishUs;
+    int       intervalUs;
+} BenchFrame;
+
+static int         sBenchFrames  = 0;   /* 0 when not benchmarking */
+static int         sBenchFinish  = 0;
+static int         sBenchCurrent = 0;
+static long        sBenchStep    = 0;
+static int64_t     sBenchStartUs = 0;
+static int64_t     sBenchLastUs  = 0;
+static BenchFrame* sBenchData    = NULL;
 
 static long
 _getTime(void)
@@ -41,6 +66,96 @@ _getTime(void)
     return (long)(now.tv_sec*1000 + now.tv_usec/1000);
 }
 
+static int64_t
+_getTimeUs(void)
+{
+    struct timespec  now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec*1000000 + now.tv_nsec/1000;
+}
+
+static int
+_compareInts(const void*  a, const void*  b)
+{
+    int  ia = *(const int*)a;
+    int  ib = *(const int*)b;
+    return (ia > ib) - (ia < ib);
+}
+
+/* log min/median/p90/p99/max/mean of 'count' values, which get sorted */
+static void
+_logSummary(const char*  name, int*  values, int  count)
+{
+    int64_t  sum = 0;
+    int      nn;
+
+    if (count == 0)
+        return;
+
+    for (nn = 0; nn < count; nn++)
+        sum += values[nn];
+    qsort(values, count, sizeof(values[0]), _compareInts);
+
+    __android_log_print(ANDROID_LOG_INFO, "SanAngeles",
+        "BENCH_SUMMARY,%s,%d,%d,%d,%d,%d,%d", name,
+        values[0], values[(count-1)/2], values[(count-1)*90/100],
+        values[(count-1)*99/100], values[count-1], (int)(sum/count));
+}
+
+static void
+_benchReport(void)
+{
+    int      frames   = sBenchFrames;
+    int64_t  totalUs  = sBenchLastUs - sBenchStartUs;
+    int*     values   = malloc(frames * sizeof(int));
+    int      nn;
+
+    __android_log_print(ANDROID_LOG_INFO, "SanAngeles",
+        "BENCH_FRAME,frame,submit_us,finish_us,interval_us");
+    for (nn = 0; nn < frames; nn++) {
+        __android_log_print(ANDROID_LOG_INFO, "SanAngeles",
+            "BENCH_FRAME,%d,%d,%d,%d", nn, sBenchData[nn].submitUs,
+            sBenchData[nn].finishUs, sBenchData[nn].intervalUs);
+    }
+
+    __android_log_print(ANDROID_LOG_INFO, "SanAngeles",
+        "BENCH_SUMMARY,metric,min_us,p50_us,p90_us,p99_us,max_us,mean_us");
+    if (values != NULL) {
+        for (nn = 0; nn < frames; nn++)
+            values[nn] = sBenchData[nn].submitUs;
+        _logSummary("submit", values, frames);
+
+        if (sBenchFinish) {
+            for (nn = 0; nn < frames; nn++)
+                values[nn] = sBenchData[nn].finishUs;
+            _logSummary("finish", values, frames);
+        }
+
+        /* the first frame has no previous one */
+        for (nn = 1; nn < frames; nn++)
+            values[nn-1] = sBenchData[nn].intervalUs;
+        _logSummary("interval", values, frames - 1);
+        free(values);
+    }
+
+    __android_log_print(ANDROID_LOG_INFO, "SanAngeles",
+        "BENCH_TOTAL,frames,%d,seconds,%.3f,fps,%.2f,vbo,%d", frames,
+        totalUs / 1e6, totalUs > 0 ? frames * 1e6 / totalUs : 0., sUseVBO);
+}
+
+/* Call before nativeInit to draw the static geometry from buffer
+ * objects (true) or from client-side arrays (false, the default).
+ */
+void
+Java_com_example_SanAngeles_DemoRenderer_nativeSetVBO( JNIEnv*  env, jobject  thiz, jboolean enable )
+{
+    sUseVBO = enable;
+    appSetUseVBO(enable);
+    __android_log_print(ANDROID_LOG_INFO, "SanAngeles", "vertex buffer objects %s",
+        enable ? "on" : "off");
+}
+
 /* Call to initialize the graphics state */
 void
 Java_com_example_SanAngeles_DemoRenderer_nativeInit( JNIEnv*  env )
@@ -74,6 +189,10 @@ Java_com_example_SanAngeles_DemoRenderer_nativeDone( JNIEnv*  env )
 void
 Java_com_example_SanAngeles_DemoGLSurfaceView_nativePause( JNIEnv*  env )
 {
+    /* a benchmark always runs through */
+    if (sBenchFrames > 0)
+        return;
+
     sDemoStopped = !sDemoStopped;
     if (sDemoStopped) {
         /* we paused the animation, so store the current
@@ -86,12 +205,80 @@ Java_com_example_SanAngeles_DemoGLSurfaceView_nativePause( JNIEnv*  env )
     }
 }
 
+/* Call after nativeInit to render 'frames' frames of the benchmark
+ * timeline, calling glFinish after each of them if 'finish' is true.
+ */
+void
+Java_com_example_SanAngeles_DemoRenderer_nativeStartBenchmark( JNIEnv*  env, jobject  thiz, jint frames, jboolean finish )
+{
+    free(sBenchData);
+    sBenchData    = calloc(frames > 0 ? frames : 1, sizeof(BenchFrame));
+    sBenchFrames  = sBenchData != NULL ? frames : 0;
+    sBenchFinish  = finish;
+    sBenchCurrent = 0;
+    /* stay short of the end of the demo, which clears gAppAlive */
+    sBenchStep    = sBenchFrames > 0 ? (appRunLength() - 1) / sBenchFrames : 0;
+    if (sBenchStep < 1)
+        sBenchStep = 1;
+
+    __android_log_print(ANDROID_LOG_INFO, "SanAngeles",
+        "benchmark: %d frames, %ld ticks per frame, glFinish %s",
+        sBenchFrames, sBenchStep, sBenchFinish ? "on" : "off");
+}
+
+/* Returns false once the benchmark is done */
+jboolean
+Java_com_example_SanAngeles_DemoRenderer_nativeIsAlive( JNIEnv*  env )
+{
+    return gAppAlive;
+}
+
+static void
+_benchRender(void)
+{
+    BenchFrame*  frame;
+    int64_t      t0, t1, t2;
+
+    if (sBenchCurrent >= sBenchFrames)
+        return;
+
+    frame = &sBenchData[sBenchCurrent];
+    t0 = _getTimeUs();
+    if (sBenchCurrent == 0)
+        sBenchStartUs = t0;
+    else
+        frame->intervalUs = (int)(t0 - sBenchLastUs);
+    sBenchLastUs = t0;
+
+    /* appRender ignores a zero start tick */
+    appRender(1 + sBenchCurrent * sBenchStep, sWindowWidth, sWindowHeight);
+    t1 = _getTimeUs();
+    if (sBenchFinish)
+        glFinish();
+    t2 = _getTimeUs();
+
+    frame->submitUs = (int)(t1 - t0);
+    frame->finishUs = (int)(t2 - t1);
+
+    if (++sBenchCurrent == sBenchFrames) {
+        /* count the last frame up to now */
+        sBenchLastUs = t2;
+        _benchReport();
+        gAppAlive = 0;
+    }
+}
+
 /* Call to render the next GL frame */
 void
 Java_com_example_SanAngeles_DemoRenderer_nativeRender( JNIEnv*  env )
 {
     long   curTime;
 
+    if (sBenchFrames > 0) {
+        _benchRender();
+        return;
+    }
+
     /* NOTE: if sDemoStopped is TRUE, then we re-render the same frame
      *       on each iteration.
      */
@@ -42,6 +42,14 @@ extern void appInit();
 extern void appDeinit();
 extern void appRender(long tick, int width, int height);
 
+// Selects whether the static objects are drawn from buffer objects
+// instead of client-side arrays. Takes effect at the next appInit().
+extern void appSetUseVBO(int enable);
+
+// Length of the whole demonstration in ticks, after which gAppAlive is
+// cleared.
+extern long appRunLength();
+
 /* Value is non-zero when application is alive, and 0 when it is closing.
  * Defined by the application framework.
  */
@@ -77,12 +77,19 @@ typedef struct {
      * (i.e. tightly packed array). Color array is supposed to have 4
      * components per color with GL_UNSIGNED_BYTE datatype and stride 0.
      * Normal array is supposed to use GL_FIXED datatype and stride 0.
+     *
+     * When the object has been uploaded to buffer objects, the arrays
+     * are freed and drawing uses the buffers instead; normalBuffer is
+     * then 0 when the object has no normals.
      */
     GLfixed *vertexArray;
     GLubyte *colorArray;
     GLfixed *normalArray;
     GLint vertexComponents;
     GLsizei count;
+    GLuint vertexBuffer;
+    GLuint colorBuffer;
+    GLuint normalBuffer;
 } GLOBJECT;
 
 
@@ -96,6 +103,9 @@ static long sNextCamTrackStartTick = 0x7fffffff;
 static GLOBJECT *sSuperShapeObjects[SUPERSHAPE_COUNT] = { NULL };
 static GLOBJECT *sGroundPlane = NULL;
 
+// Non-zero to draw the static objects from buffer objects.
+static int sUseVBO = 0;
+
 
 typedef struct {
     float x, y, z;
@@ -106,6 +116,14 @@ static void freeGLObject(GLOBJECT *object)
 {
     if (object == NULL)
         return;
+    if (object->vertexBuffer)
+    {
+        GLuint buffers[3];
+        buffers[0] = object->vertexBuffer;
+        buffers[1] = object->colorBuffer;
+        buffers[2] = object->normalBuffer;
+        glDeleteBuffers(object->normalBuffer ? 3 : 2, buffers);
+    }
     free(object->normalArray);
     free(object->colorArray);
     free(object->vertexArray);
@@ -122,6 +140,9 @@ static GLOBJECT * newGLObject(long vertices, int vertexComponents,
         return NULL;
     result->count = vertices;
     result->vertexComponents = vertexComponents;
+    result->vertexBuffer = 0;
+    result->colorBuffer = 0;
+    result->normalBuffer = 0;
     result->vertexArray = (GLfixed *)malloc(vertices * vertexComponents *
                                             sizeof(GLfixed));
     result->colorArray = (GLubyte *)malloc(vertices * 4 * sizeof(GLubyte));
@@ -143,18 +164,81 @@ static GLOBJECT * newGLObject(long vertices, int vertexComponents,
 }
 
 
+// Copies the arrays of an object to buffer objects, so that they don't
+// have to be sent again each time the object is drawn. The object is
+// left untouched if the buffers cannot be created.
+static void uploadGLObject(GLOBJECT *object)
+{
+    GLuint buffers[3];
+    int count = object->normalArray ? 3 : 2;
+
+    glGetError();   // clear any earlier error
+    glGenBuffers(count, buffers);
+
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+    glBufferData(GL_ARRAY_BUFFER, object->count * object->vertexComponents *
+                 sizeof(GLfixed), object->vertexArray, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[1]);
+    glBufferData(GL_ARRAY_BUFFER, object->count * 4 * sizeof(GLubyte),
+                 object->colorArray, GL_STATIC_DRAW);
+    if (object->normalArray)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[2]);
+        glBufferData(GL_ARRAY_BUFFER, object->count * 3 * sizeof(GLfixed),
+                     object->normalArray, GL_STATIC_DRAW);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (glGetError() != GL_NO_ERROR)
+    {
+        glDeleteBuffers(count, buffers);
+        return;
+    }
+
+    object->vertexBuffer = buffers[0];
+    object->colorBuffer = buffers[1];
+    object->normalBuffer = object->normalArray ? buffers[2] : 0;
+    free(object->vertexArray);
+    free(object->colorArray);
+    free(object->normalArray);
+    object->vertexArray = NULL;
+    object->colorArray = NULL;
+    object->normalArray = NULL;
+}
+
+
 static void drawGLObject(GLOBJECT *object)
 {
     assert(object != NULL);
 
-    glVertexPointer(object->vertexComponents, GL_FIXED,
-                    0, object->vertexArray);
-    glColorPointer(4, GL_UNSIGNED_BYTE, 0, object->colorArray);
-
     // Already done in initialization:
     //glEnableClientState(GL_VERTEX_ARRAY);
     //glEnableClientState(GL_COLOR_ARRAY);
 
+    if (object->vertexBuffer)
+    {
+        // With a buffer bound, the pointers are offsets into it.
+        glBindBuffer(GL_ARRAY_BUFFER, object->vertexBuffer);
+        glVertexPointer(object->vertexComponents, GL_FIXED, 0, 0);
+        glBindBuffer(GL_ARRAY_BUFFER, object->colorBuffer);
+        glColorPointer(4, GL_UNSIGNED_BYTE, 0, 0);
+        if (object->normalBuffer)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, object->normalBuffer);
+            glNormalPointer(GL_FIXED, 0, 0);
+            glEnableClientState(GL_NORMAL_ARRAY);
+        }
+        else
+            glDisableClientState(GL_NORMAL_ARRAY);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glDrawArrays(GL_TRIANGLES, 0, object->count);
+        return;
+    }
+
+    glVertexPointer(object->vertexComponents, GL_FIXED,
+                    0, object->vertexArray);
+    glColorPointer(4, GL_UNSIGNED_BYTE, 0, object->colorArray);
+
     if (object->normalArray)
     {
         glNormalPointer(GL_FIXED, 0, object->normalArray);
@@ -486,6 +570,20 @@ void appInit()
     }
     sGroundPlane = createGroundPlane();
     assert(sGroundPlane != NULL);
+
+    if (sUseVBO)
+    {
+        for (a = 0; a < SUPERSHAPE_COUNT; ++a)
+            uploadGLObject(sSuperShapeObjects[a]);
+        uploadGLObject(sGroundPlane);
+    }
+}
+
+
+// Called from the app framework.
+void appSetUseVBO(int enable)
+{
+    sUseVBO = enable;
 }
 
 
@@ -750,6 +848,12 @@ static void camTrack()
 /* The tick is current time in milliseconds, width and height
  * are the image dimensions to be rendered.
  */
+long appRunLength()
+{
+    return RUN_LENGTH;
+}
+
+
 void appRender(long tick, int width, int height)
 {
     if (sStartTick == 0)
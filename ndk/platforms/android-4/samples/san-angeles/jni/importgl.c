@@ -120,17 +120,21 @@ int importGLInit()
     IMPORT_FUNC(eglTerminate);
 #endif /* !ANDROID_NDK */
 
+    IMPORT_FUNC(glBindBuffer);
     IMPORT_FUNC(glBlendFunc);
+    IMPORT_FUNC(glBufferData);
     IMPORT_FUNC(glClear);
     IMPORT_FUNC(glClearColorx);
     IMPORT_FUNC(glColor4x);
     IMPORT_FUNC(glColorPointer);
+    IMPORT_FUNC(glDeleteBuffers);
     IMPORT_FUNC(glDisable);
     IMPORT_FUNC(glDisableClientState);
     IMPORT_FUNC(glDrawArrays);
     IMPORT_FUNC(glEnable);
     IMPORT_FUNC(glEnableClientState);
     IMPORT_FUNC(glFrustumx);
+    IMPORT_FUNC(glGenBuffers);
     IMPORT_FUNC(glGetError);
     IMPORT_FUNC(glLightxv);
     IMPORT_FUNC(glLoadIdentity);
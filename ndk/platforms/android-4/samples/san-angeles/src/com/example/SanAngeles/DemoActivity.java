@@ -38,6 +38,20 @@
  *
  * Fixing the program to send less polygons to the GPU is left
  * as an exercise to the reader. As always, patches welcomed :-)
+ *
+ * Starting the activity with a "benchmark" extra renders that many
+ * frames of a fixed timeline as fast as possible, logs the time spent
+ * on each of them with a summary, and exits. With the "finish" extra,
+ * glFinish() is called after each frame to split the CPU submit time
+ * from the GPU time:
+ *
+ *   adb shell am start -n com.example.SanAngeles/.DemoActivity \
+ *       --ei benchmark 600 --ez finish true
+ *   adb logcat -d -s SanAngeles | grep BENCH
+ *
+ * With the "vbo" extra (--ez vbo true), the static geometry is uploaded
+ * once to vertex buffer objects instead of being sent from client-side
+ * arrays on every frame, to compare the cost of both.
  */
 package com.example.SanAngeles;
 
@@ -45,7 +59,6 @@ import javax.microedition.khronos.egl.EGLConfig;
 import javax.microedition.khronos.opengles.GL10;
 
 import android.app.Activity;
-import android.content.Context;
 import android.opengl.GLSurfaceView;
 import android.os.Bundle;
 import android.view.MotionEvent;
@@ -54,7 +67,10 @@ public class DemoActivity extends Activity {
     @Override
     protected void onCreate(Bundle savedInstanceState) {
         super.onCreate(savedInstanceState);
-        mGLView = new DemoGLSurfaceView(this);
+        mGLView = new DemoGLSurfaceView(this,
+                getIntent().getIntExtra("benchmark", 0),
+                getIntent().getBooleanExtra("finish", false),
+                getIntent().getBooleanExtra("vbo", false));
         setContentView(mGLView);
     }
 
@@ -78,9 +94,11 @@ public class DemoActivity extends Activity {
 }
 
 class DemoGLSurfaceView extends GLSurfaceView {
-    public DemoGLSurfaceView(Context context) {
-        super(context);
-        mRenderer = new DemoRenderer();
+    public DemoGLSurfaceView(Activity activity, int benchmarkFrames,
+            boolean benchmarkFinish, boolean useVBO) {
+        super(activity);
+        mRenderer = new DemoRenderer(activity, benchmarkFrames, benchmarkFinish,
+                useVBO);
         setRenderer(mRenderer);
     }
 
@@ -97,8 +115,20 @@ class DemoGLSurfaceView extends GLSurfaceView {
 }
 
 class DemoRenderer implements GLSurfaceView.Renderer {
+    public DemoRenderer(Activity activity, int benchmarkFrames,
+            boolean benchmarkFinish, boolean useVBO) {
+        mActivity = activity;
+        mBenchmarkFrames = benchmarkFrames;
+        mBenchmarkFinish = benchmarkFinish;
+        mUseVBO = useVBO;
+    }
+
     public void onSurfaceCreated(GL10 gl, EGLConfig config) {
+        nativeSetVBO(mUseVBO);
         nativeInit();
+        if (mBenchmarkFrames > 0) {
+            nativeStartBenchmark(mBenchmarkFrames, mBenchmarkFinish);
+        }
     }
 
     public void onSurfaceChanged(GL10 gl, int w, int h) {
@@ -108,10 +138,27 @@ class DemoRenderer implements GLSurfaceView.Renderer {
 
     public void onDrawFrame(GL10 gl) {
         nativeRender();
+        if (mBenchmarkFrames > 0 && !mBenchmarkDone && !nativeIsAlive()) {
+            mBenchmarkDone = true;
+            mActivity.runOnUiThread(new Runnable() {
+                public void run() {
+                    mActivity.finish();
+                }
+            });
+        }
     }
 
+    private Activity mActivity;
+    private int mBenchmarkFrames;
+    private boolean mBenchmarkFinish;
+    private boolean mBenchmarkDone;
+    private boolean mUseVBO;
+
+    private static native void nativeSetVBO(boolean enable);
     private static native void nativeInit();
     private static native void nativeResize(int w, int h);
     private static native void nativeRender();
     private static native void nativeDone();
+    private static native void nativeStartBenchmark(int frames, boolean finish);
+    private static native boolean nativeIsAlive();
 }
@@ -24,5 +24,7 @@ LOCAL_LDLIBS    += -lOpenSLES
 LOCAL_LDLIBS    += -llog
 # for native asset manager
 LOCAL_LDLIBS    += -landroid
+# for the streaming mode tone
+LOCAL_LDLIBS    += -lm
 
 include $(BUILD_SHARED_LIBRARY)
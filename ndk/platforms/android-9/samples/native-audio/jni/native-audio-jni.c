@@ -23,10 +23,15 @@
 
 #include <assert.h>
 #include <jni.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 // for __android_log_print(ANDROID_LOG_INFO, "YourApp", "formatted message");
-// #include <android/log.h>
+#include <android/log.h>
 
 // for native audio
 #include <SLES/OpenSLES.h>
@@ -126,7 +131,7 @@ void bqPlayerCallback(SLAndroidSimpleBufferQueueItf bq, void *context)
 // this callback handler is called every time a buffer finishes recording
 void bqRecorderCallback(SLAndroidSimpleBufferQueueItf bq, void *context)
 {
-    assert(bq == bqRecorderBufferQueue);
+    assert(bq == recorderBufferQueue);
     assert(NULL == context);
     // for streaming recording, here we would call Enqueue to give recorder the next buffer to fill
     // but instead, this is a one-time buffer so we stop recording
@@ -551,10 +556,423 @@ void Java_com_example_nativeaudio_NativeAudio_startRecording(JNIEnv* env, jclass
 }
 
 
+// streaming mode: a buffer queue player that is kept fed with a continuous synthesized
+// stream, refilling each buffer from its callback, and measuring how regularly the callbacks
+// come, how often the queue runs dry and, with the recorder enabled, the round-trip latency
+
+// streaming player and recorder interfaces
+static SLObjectItf stPlayerObject = NULL;
+static SLPlayItf stPlayerPlay;
+static SLAndroidSimpleBufferQueueItf stPlayerBufferQueue;
+static SLObjectItf stRecorderObject = NULL;
+static SLRecordItf stRecorderRecord;
+static SLAndroidSimpleBufferQueueItf stRecorderBufferQueue;
+
+// one cycle of a sine wave, and the tone played while not measuring latency
+#define SINE_BITS 10
+#define SINE_SIZE (1 << SINE_BITS)
+#define STREAM_TONE_HZ 440
+static short sineTable[SINE_SIZE];
+
+// when measuring latency, a short burst of tone is played once per second over silence,
+// and the first recorded sample above the threshold is taken as its echo
+#define PULSE_HZ 1000
+#define PULSE_MS 5
+#define PULSE_THRESHOLD 0x0800
+
+#define STREAM_MAX_BUFFERS 16
+
+// stream configuration and buffers, set up by createStreamPlayer
+static unsigned streamRate;
+static unsigned streamFrames;       // frames per buffer
+static unsigned streamCount;        // number of buffers in each queue
+static int streamLatency;           // true when the recorder is used to measure latency
+static short *streamBuffers;        // streamCount player buffers, then streamCount recorder ones
+static unsigned streamNext;         // next player buffer to fill
+static unsigned streamRecNext;      // next recorder buffer to be filled
+static unsigned streamPhase;        // phase of the tone, in units of 2*pi/2^32
+static unsigned streamPulseLeft;    // frames of the current pulse left to play
+static unsigned streamBuffersToPulse;
+
+// statistics, protected by streamLock as the callbacks run on the audio threads
+typedef struct {
+    unsigned callbacks;
+    unsigned underruns;             // callbacks that found the player queue empty
+    unsigned late;                  // callback intervals over 1.5 buffer periods
+    long long lastUs;
+    long long minUs, maxUs;         // callback intervals
+    double sumUs, sumSqUs;
+    unsigned intervals;
+    // latency measurement
+    int pulsePending;
+    long long pulseUs;              // when the pulse buffer was enqueued
+    unsigned pulses, echoes;
+    long long latencyMinUs, latencyMaxUs, latencyLastUs;
+    double latencySumUs;
+} StreamStats;
+
+static StreamStats streamStats;
+static pthread_mutex_t streamLock = PTHREAD_MUTEX_INITIALIZER;
+
+static long long nowUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+// synthesize the next player buffer, at most one pulse of it when measuring latency
+static int fillStreamBuffer(short *buffer)
+{
+    unsigned i, increment;
+    int pulse = 0;
+
+    if (!streamLatency) {
+        increment = (unsigned) ((STREAM_TONE_HZ * 4294967296.0) / streamRate);
+        for (i = 0; i < streamFrames; ++i) {
+            buffer[i] = sineTable[streamPhase >> (32 - SINE_BITS)] >> 2;
+            streamPhase += increment;
+        }
+        return 0;
+    }
+
+    if (streamBuffersToPulse-- == 0) {
+        streamBuffersToPulse = (streamRate + streamFrames - 1) / streamFrames - 1;
+        streamPulseLeft = streamRate * PULSE_MS / 1000;
+        streamPhase = 0;
+        pulse = 1;
+    }
+    increment = (unsigned) ((PULSE_HZ * 4294967296.0) / streamRate);
+    for (i = 0; i < streamFrames; ++i) {
+        if (streamPulseLeft > 0) {
+            buffer[i] = sineTable[streamPhase >> (32 - SINE_BITS)] >> 1;
+            streamPhase += increment;
+            --streamPulseLeft;
+        } else {
+            buffer[i] = 0;
+        }
+    }
+    return pulse;
+}
+
+// refill and enqueue the player buffer that just finished playing
+void stPlayerCallback(SLAndroidSimpleBufferQueueItf bq, void *context)
+{
+    assert(bq == stPlayerBufferQueue);
+    assert(NULL == context);
+    long long now = nowUs();
+    long long periodUs = streamFrames * 1000000LL / streamRate;
+    SLAndroidSimpleBufferQueueState state;
+    SLresult result;
+
+    result = (*bq)->GetState(bq, &state);
+    assert(SL_RESULT_SUCCESS == result);
+
+    pthread_mutex_lock(&streamLock);
+    StreamStats *s = &streamStats;
+    s->callbacks++;
+    // the queue should still hold the other buffers, unless we were too slow to refill it
+    if (state.count == 0) {
+        s->underruns++;
+    }
+    if (s->lastUs != 0) {
+        long long interval = now - s->lastUs;
+        if (s->intervals == 0 || interval < s->minUs) s->minUs = interval;
+        if (s->intervals == 0 || interval > s->maxUs) s->maxUs = interval;
+        s->sumUs += interval;
+        s->sumSqUs += (double) interval * interval;
+        s->intervals++;
+        if (interval * 2 > periodUs * 3) {
+            s->late++;
+        }
+    }
+    s->lastUs = now;
+    pthread_mutex_unlock(&streamLock);
+
+    short *buffer = streamBuffers + streamNext * streamFrames;
+    streamNext = (streamNext + 1) % streamCount;
+    int pulse = fillStreamBuffer(buffer);
+    if (pulse) {
+        pthread_mutex_lock(&streamLock);
+        s->pulses++;
+        s->pulsePending = 1;
+        s->pulseUs = nowUs();
+        pthread_mutex_unlock(&streamLock);
+    }
+    result = (*bq)->Enqueue(bq, buffer, streamFrames * sizeof(short));
+    assert(SL_RESULT_SUCCESS == result);
+}
+
+// look for the echo of the last pulse in the buffer just recorded, and enqueue it again
+void stRecorderCallback(SLAndroidSimpleBufferQueueItf bq, void *context)
+{
+    assert(bq == stRecorderBufferQueue);
+    assert(NULL == context);
+    long long now = nowUs();
+    short *buffer = streamBuffers + (streamCount + streamRecNext) * streamFrames;
+    SLresult result;
+    unsigned i;
+
+    pthread_mutex_lock(&streamLock);
+    StreamStats *s = &streamStats;
+    if (s->pulsePending) {
+        for (i = 0; i < streamFrames; ++i) {
+            if (buffer[i] > PULSE_THRESHOLD || buffer[i] < -PULSE_THRESHOLD) {
+                // the buffer was complete at 'now', so sample i was captured a bit earlier
+                long long echoUs = now - (streamFrames - i) * 1000000LL / streamRate;
+                long long latency = echoUs - s->pulseUs;
+                if (s->echoes == 0 || latency < s->latencyMinUs) s->latencyMinUs = latency;
+                if (s->echoes == 0 || latency > s->latencyMaxUs) s->latencyMaxUs = latency;
+                s->latencyLastUs = latency;
+                s->latencySumUs += latency;
+                s->echoes++;
+                s->pulsePending = 0;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&streamLock);
+
+    streamRecNext = (streamRecNext + 1) % streamCount;
+    result = (*bq)->Enqueue(bq, buffer, streamFrames * sizeof(short));
+    assert(SL_RESULT_SUCCESS == result);
+}
+
+static jboolean createStreamRecorder(void)
+{
+    SLresult result;
+    unsigned i;
+
+    // configure audio source
+    SLDataLocator_IODevice loc_dev = {SL_DATALOCATOR_IODEVICE, SL_IODEVICE_AUDIOINPUT,
+            SL_DEFAULTDEVICEID_AUDIOINPUT, NULL};
+    SLDataSource audioSrc = {&loc_dev, NULL};
+
+    // configure audio sink, with the same format as the player
+    SLDataLocator_AndroidSimpleBufferQueue loc_bq = {SL_DATALOCATOR_ANDROIDSIMPLEBUFFERQUEUE,
+            streamCount};
+    SLDataFormat_PCM format_pcm = {SL_DATAFORMAT_PCM, 1, streamRate * 1000,
+        SL_PCMSAMPLEFORMAT_FIXED_16, SL_PCMSAMPLEFORMAT_FIXED_16,
+        SL_SPEAKER_FRONT_CENTER, SL_BYTEORDER_LITTLEENDIAN};
+    SLDataSink audioSnk = {&loc_bq, &format_pcm};
+
+    // create audio recorder
+    // (requires the RECORD_AUDIO permission)
+    const SLInterfaceID id[1] = {SL_IID_ANDROIDSIMPLEBUFFERQUEUE};
+    const SLboolean req[1] = {SL_BOOLEAN_TRUE};
+    result = (*engineEngine)->CreateAudioRecorder(engineEngine, &stRecorderObject, &audioSrc,
+            &audioSnk, 1, id, req);
+    if (SL_RESULT_SUCCESS != result) {
+        stRecorderObject = NULL;
+        return JNI_FALSE;
+    }
+
+    // realize the audio recorder
+    result = (*stRecorderObject)->Realize(stRecorderObject, SL_BOOLEAN_FALSE);
+    if (SL_RESULT_SUCCESS != result) {
+        return JNI_FALSE;
+    }
+
+    // get the record and buffer queue interfaces
+    result = (*stRecorderObject)->GetInterface(stRecorderObject, SL_IID_RECORD,
+            &stRecorderRecord);
+    assert(SL_RESULT_SUCCESS == result);
+    result = (*stRecorderObject)->GetInterface(stRecorderObject,
+            SL_IID_ANDROIDSIMPLEBUFFERQUEUE, &stRecorderBufferQueue);
+    assert(SL_RESULT_SUCCESS == result);
+    result = (*stRecorderBufferQueue)->RegisterCallback(stRecorderBufferQueue,
+            stRecorderCallback, NULL);
+    assert(SL_RESULT_SUCCESS == result);
+
+    // enqueue all the empty buffers, and start recording
+    for (i = 0; i < streamCount; ++i) {
+        result = (*stRecorderBufferQueue)->Enqueue(stRecorderBufferQueue,
+                streamBuffers + (streamCount + i) * streamFrames, streamFrames * sizeof(short));
+        assert(SL_RESULT_SUCCESS == result);
+    }
+    result = (*stRecorderRecord)->SetRecordState(stRecorderRecord, SL_RECORDSTATE_RECORDING);
+    return SL_RESULT_SUCCESS == result ? JNI_TRUE : JNI_FALSE;
+}
+
+
+// stop the streaming player and recorder, and invalidate all associated interfaces
+void Java_com_example_nativeaudio_NativeAudio_stopStreamPlayer(JNIEnv* env, jclass clazz)
+{
+    // destroying an object waits for its callbacks to return
+    if (stPlayerObject != NULL) {
+        (*stPlayerObject)->Destroy(stPlayerObject);
+        stPlayerObject = NULL;
+        stPlayerPlay = NULL;
+        stPlayerBufferQueue = NULL;
+    }
+    if (stRecorderObject != NULL) {
+        (*stRecorderObject)->Destroy(stRecorderObject);
+        stRecorderObject = NULL;
+        stRecorderRecord = NULL;
+        stRecorderBufferQueue = NULL;
+    }
+    free(streamBuffers);
+    streamBuffers = NULL;
+}
+
+
+// create and start the streaming player, with 'count' buffers of 'frames' frames each at
+// 'rate' Hz, and a recorder with the same configuration if 'measureLatency' is true
+jboolean Java_com_example_nativeaudio_NativeAudio_createStreamPlayer(JNIEnv* env, jclass clazz,
+        jint rate, jint frames, jint count, jboolean measureLatency)
+{
+    SLresult result;
+    unsigned i;
+
+    Java_com_example_nativeaudio_NativeAudio_stopStreamPlayer(env, clazz);
+
+    // a single buffer can't be refilled while it plays
+    if (rate < 8000 || rate > 48000 || frames <= 0 || count < 2 || count > STREAM_MAX_BUFFERS) {
+        return JNI_FALSE;
+    }
+    streamRate = rate;
+    streamFrames = frames;
+    streamCount = count;
+    streamLatency = measureLatency;
+    streamBuffers = (short *) calloc(2 * streamCount * streamFrames, sizeof(short));
+    if (NULL == streamBuffers) {
+        return JNI_FALSE;
+    }
+    streamNext = 0;
+    streamRecNext = 0;
+    streamPhase = 0;
+    streamPulseLeft = 0;
+    streamBuffersToPulse = 0;
+    memset(&streamStats, 0, sizeof(streamStats));
+    for (i = 0; i < SINE_SIZE; ++i) {
+        sineTable[i] = (short) (32767 * sin(i * 2 * M_PI / SINE_SIZE));
+    }
+
+    // configure audio source
+    SLDataLocator_AndroidSimpleBufferQueue loc_bufq = {SL_DATALOCATOR_ANDROIDSIMPLEBUFFERQUEUE,
+            streamCount};
+    SLDataFormat_PCM format_pcm = {SL_DATAFORMAT_PCM, 1, streamRate * 1000,
+        SL_PCMSAMPLEFORMAT_FIXED_16, SL_PCMSAMPLEFORMAT_FIXED_16,
+        SL_SPEAKER_FRONT_CENTER, SL_BYTEORDER_LITTLEENDIAN};
+    SLDataSource audioSrc = {&loc_bufq, &format_pcm};
+
+    // configure audio sink
+    SLDataLocator_OutputMix loc_outmix = {SL_DATALOCATOR_OUTPUTMIX, outputMixObject};
+    SLDataSink audioSnk = {&loc_outmix, NULL};
+
+    // create audio player, no effects so that nothing is added to the output path
+    const SLInterfaceID ids[1] = {SL_IID_BUFFERQUEUE};
+    const SLboolean req[1] = {SL_BOOLEAN_TRUE};
+    result = (*engineEngine)->CreateAudioPlayer(engineEngine, &stPlayerObject, &audioSrc,
+            &audioSnk, 1, ids, req);
+    if (SL_RESULT_SUCCESS != result) {
+        stPlayerObject = NULL;
+        Java_com_example_nativeaudio_NativeAudio_stopStreamPlayer(env, clazz);
+        return JNI_FALSE;
+    }
+
+    // realize the player
+    result = (*stPlayerObject)->Realize(stPlayerObject, SL_BOOLEAN_FALSE);
+    if (SL_RESULT_SUCCESS != result) {
+        Java_com_example_nativeaudio_NativeAudio_stopStreamPlayer(env, clazz);
+        return JNI_FALSE;
+    }
+
+    // get the play and buffer queue interfaces, and register the callback
+    result = (*stPlayerObject)->GetInterface(stPlayerObject, SL_IID_PLAY, &stPlayerPlay);
+    assert(SL_RESULT_SUCCESS == result);
+    result = (*stPlayerObject)->GetInterface(stPlayerObject, SL_IID_BUFFERQUEUE,
+            &stPlayerBufferQueue);
+    assert(SL_RESULT_SUCCESS == result);
+    result = (*stPlayerBufferQueue)->RegisterCallback(stPlayerBufferQueue, stPlayerCallback, NULL);
+    assert(SL_RESULT_SUCCESS == result);
+
+    // the recorder runs first, so that it doesn't miss the first pulse
+    if (streamLatency && !createStreamRecorder()) {
+        __android_log_print(ANDROID_LOG_WARN, "NativeAudio",
+                "cannot create the stream recorder, not measuring latency");
+        if (stRecorderObject != NULL) {
+            (*stRecorderObject)->Destroy(stRecorderObject);
+            stRecorderObject = NULL;
+        }
+        streamLatency = 0;
+    }
+
+    // fill the whole queue before starting, the callbacks keep it full afterwards
+    for (i = 0; i < streamCount; ++i) {
+        short *buffer = streamBuffers + i * streamFrames;
+        if (fillStreamBuffer(buffer)) {
+            streamStats.pulses++;
+            streamStats.pulsePending = 1;
+            streamStats.pulseUs = nowUs();
+        }
+        result = (*stPlayerBufferQueue)->Enqueue(stPlayerBufferQueue, buffer,
+                streamFrames * sizeof(short));
+        assert(SL_RESULT_SUCCESS == result);
+    }
+
+    result = (*stPlayerPlay)->SetPlayState(stPlayerPlay, SL_PLAYSTATE_PLAYING);
+    assert(SL_RESULT_SUCCESS == result);
+
+    __android_log_print(ANDROID_LOG_INFO, "NativeAudio",
+            "streaming %u buffers of %u frames at %u Hz (%.1f ms queued), latency %s",
+            streamCount, streamFrames, streamRate,
+            streamCount * streamFrames * 1000.0 / streamRate, streamLatency ? "on" : "off");
+    return JNI_TRUE;
+}
+
+
+// return a report of the streaming statistics, and log it
+jstring Java_com_example_nativeaudio_NativeAudio_getStreamStats(JNIEnv* env, jclass clazz)
+{
+    char report[512];
+    int len = 0;
+
+    if (NULL == stPlayerObject) {
+        return (*env)->NewStringUTF(env, "not streaming");
+    }
+
+    pthread_mutex_lock(&streamLock);
+    StreamStats s = streamStats;
+    pthread_mutex_unlock(&streamLock);
+
+    double periodUs = streamFrames * 1000000.0 / streamRate;
+    double meanUs = s.intervals > 0 ? s.sumUs / s.intervals : 0.;
+    double var = s.intervals > 0 ? s.sumSqUs / s.intervals - meanUs * meanUs : 0.;
+
+    len += snprintf(report + len, sizeof(report) - len,
+            "%u x %u frames at %u Hz\n"
+            "callbacks: %u, underruns: %u, late: %u\n"
+            "interval ms: period %.2f min %.2f mean %.2f max %.2f jitter %.2f\n",
+            streamCount, streamFrames, streamRate,
+            s.callbacks, s.underruns, s.late,
+            periodUs / 1000., s.minUs / 1000., meanUs / 1000., s.maxUs / 1000.,
+            var > 0 ? sqrt(var) / 1000. : 0.);
+    if (streamLatency) {
+        if (s.echoes > 0) {
+            snprintf(report + len, sizeof(report) - len,
+                    "round trip ms: last %.1f min %.1f mean %.1f max %.1f (%u/%u pulses)\n",
+                    s.latencyLastUs / 1000., s.latencyMinUs / 1000.,
+                    s.latencySumUs / s.echoes / 1000., s.latencyMaxUs / 1000.,
+                    s.echoes, s.pulses);
+        } else {
+            snprintf(report + len, sizeof(report) - len,
+                    "round trip: no echo heard (%u pulses)\n", s.pulses);
+        }
+    }
+
+    __android_log_print(ANDROID_LOG_INFO, "NativeAudio", "%s", report);
+    return (*env)->NewStringUTF(env, report);
+}
+
+
 // shut down the native audio system
 void Java_com_example_nativeaudio_NativeAudio_shutdown(JNIEnv* env, jclass clazz)
 {
 
+    // destroy the streaming player and recorder
+    Java_com_example_nativeaudio_NativeAudio_stopStreamPlayer(env, clazz);
+
     // destroy buffer queue audio player object, and invalidate all associated interfaces
     if (bqPlayerObject != NULL) {
         (*bqPlayerObject)->Destroy(bqPlayerObject);
@@ -18,10 +18,13 @@ package com.example.nativeaudio;
 
 import android.app.Activity;
 import android.content.res.AssetManager;
+import android.content.Intent;
 import android.os.Bundle;
+import android.os.Handler;
 import android.view.View;
 import android.view.View.OnClickListener;
 import android.widget.Button;
+import android.widget.TextView;
 
 public class NativeAudio extends Activity {
 
@@ -37,6 +40,46 @@ public class NativeAudio extends Activity {
     static boolean isPlayingAsset = false;
     static boolean isPlayingUri = false;
 
+    // streaming mode configuration, which can be changed with intent extras, e.g.
+    //   adb shell am start -n com.example.nativeaudio/.NativeAudio \
+    //       --ei rate 44100 --ei frames 256 --ei buffers 2
+    static final int STREAM_STATS_PERIOD_MS = 1000;
+    int streamRate;
+    int streamFrames;
+    int streamBuffers;
+    boolean isStreaming = false;
+    TextView streamStats;
+    final Handler handler = new Handler();
+
+    // refresh the streaming statistics while streaming
+    final Runnable updateStreamStats = new Runnable() {
+        public void run() {
+            if (isStreaming) {
+                streamStats.setText(getStreamStats());
+                handler.postDelayed(this, STREAM_STATS_PERIOD_MS);
+            }
+        }
+    };
+
+    void setStreaming(boolean streaming, boolean measureLatency) {
+        handler.removeCallbacks(updateStreamStats);
+        if (streaming) {
+            isStreaming = createStreamPlayer(streamRate, streamFrames, streamBuffers,
+                    measureLatency);
+            if (!isStreaming) {
+                streamStats.setText("cannot stream " + streamBuffers + " x " + streamFrames
+                        + " frames at " + streamRate + " Hz");
+                return;
+            }
+            handler.postDelayed(updateStreamStats, STREAM_STATS_PERIOD_MS);
+        } else if (isStreaming) {
+            // keep the last statistics on screen
+            streamStats.setText(getStreamStats());
+            stopStreamPlayer();
+            isStreaming = false;
+        }
+    }
+
     /** Called when the activity is first created. */
     @Override
     protected void onCreate(Bundle icicle) {
@@ -45,6 +88,12 @@ public class NativeAudio extends Activity {
 
         assetManager = getAssets();
 
+        Intent intent = getIntent();
+        streamRate = intent.getIntExtra("rate", 44100);
+        streamFrames = intent.getIntExtra("frames", 512);
+        streamBuffers = intent.getIntExtra("buffers", 2);
+        streamStats = (TextView) findViewById(R.id.stream_stats);
+
         // initialize native audio system
 
         createEngine();
@@ -128,6 +177,18 @@ public class NativeAudio extends Activity {
             }
         });
 
+        ((Button) findViewById(R.id.stream)).setOnClickListener(new OnClickListener() {
+            public void onClick(View view) {
+                setStreaming(!isStreaming, false);
+            }
+        });
+
+        ((Button) findViewById(R.id.stream_latency)).setOnClickListener(new OnClickListener() {
+            public void onClick(View view) {
+                setStreaming(!isStreaming, true);
+            }
+        });
+
     }
 
     /** Called when the activity is about to be destroyed. */
@@ -136,6 +197,7 @@ public class NativeAudio extends Activity {
     {
         // turn off all audio
         selectClip(CLIP_NONE, 0);
+        setStreaming(false, false);
         isPlayingAsset = false;
         setPlayingAssetAudioPlayer(false);
         isPlayingUri = false;
@@ -162,6 +224,10 @@ public class NativeAudio extends Activity {
     public static native boolean enableReverb(boolean enabled);
     public static native boolean createAudioRecorder();
     public static native void startRecording();
+    public static native boolean createStreamPlayer(int rate, int frames, int buffers,
+            boolean measureLatency);
+    public static native String getStreamStats();
+    public static native void stopStreamPlayer();
     public static native void shutdown();
 
     /** Load jni .so on initialization */
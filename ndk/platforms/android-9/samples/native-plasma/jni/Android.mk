@@ -18,9 +18,16 @@ include $(CLEAR_VARS)
 
 LOCAL_MODULE    := native-plasma
 LOCAL_SRC_FILES := plasma.c
+
+ifeq ($(TARGET_ARCH_ABI),armeabi-v7a)
+    LOCAL_CFLAGS    := -DHAVE_NEON=1
+    LOCAL_SRC_FILES += plasma-neon.c.neon
+endif
+
 LOCAL_LDLIBS    := -lm -llog -landroid
-LOCAL_STATIC_LIBRARIES := android_native_app_glue
+LOCAL_STATIC_LIBRARIES := android_native_app_glue cpufeatures
 
 include $(BUILD_SHARED_LIBRARY)
 
 $(call import-module,android/native_app_glue)
+$(call import-module,cpufeatures)
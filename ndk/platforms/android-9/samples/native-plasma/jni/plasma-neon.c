@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "plasma-neon.h"
+#include <arm_neon.h>
+
+/* this source file should only be compiled by Android.mk when targeting
+ * the armeabi-v7a ABI, and should be built in NEON mode
+ */
+
+/* These must match FIXED_BITS and PALETTE_BITS in plasma.c */
+#define  FIXED_BITS     16
+#define  FIXED_ONE      (1 << FIXED_BITS)
+#define  PALETTE_BITS   8
+
+void
+fill_plasma_row_neon(uint16_t* line, const int32_t* xsum, int width,
+                     int32_t base, const uint16_t* palette)
+{
+    int32x4_t  vbase = vdupq_n_s32(base);
+    int32x4_t  vmax  = vdupq_n_s32(FIXED_ONE-1);
+    uint16_t   index[8];
+    int        xx;
+
+    /* NEON has no table lookup wide enough for the palette, so the
+     * palette indices are computed 8 at a time, and looked up with
+     * scalar loads. */
+    for (xx = 0; xx + 8 <= width; xx += 8) {
+        int32x4_t  v0 = vaddq_s32(vld1q_s32(xsum + xx), vbase);
+        int32x4_t  v1 = vaddq_s32(vld1q_s32(xsum + xx + 4), vbase);
+
+        /* same as palette_from_fixed(): absolute value clamped to
+         * [0,FIXED_ONE-1], top PALETTE_BITS of the fraction */
+        v0 = vminq_s32(vabsq_s32(vshrq_n_s32(v0, 2)), vmax);
+        v1 = vminq_s32(vabsq_s32(vshrq_n_s32(v1, 2)), vmax);
+
+        uint16x8_t idx = vcombine_u16(
+                vshrn_n_u32(vreinterpretq_u32_s32(v0), FIXED_BITS - PALETTE_BITS),
+                vshrn_n_u32(vreinterpretq_u32_s32(v1), FIXED_BITS - PALETTE_BITS));
+        vst1q_u16(index, idx);
+
+        line[xx+0] = palette[index[0]];
+        line[xx+1] = palette[index[1]];
+        line[xx+2] = palette[index[2]];
+        line[xx+3] = palette[index[3]];
+        line[xx+4] = palette[index[4]];
+        line[xx+5] = palette[index[5]];
+        line[xx+6] = palette[index[6]];
+        line[xx+7] = palette[index[7]];
+    }
+
+    for ( ; xx < width; xx++) {
+        int32_t  x = (base + xsum[xx]) >> 2;
+        if (x < 0) x = -x;
+        if (x >= FIXED_ONE) x = FIXED_ONE-1;
+        line[xx] = palette[x >> (FIXED_BITS - PALETTE_BITS)];
+    }
+}
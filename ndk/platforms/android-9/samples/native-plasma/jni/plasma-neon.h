@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef PLASMA_NEON_H
+#define PLASMA_NEON_H
+
+#include <stdint.h>
+
+/* NEON version of fill_plasma_row() in plasma.c, only available when
+ * building for armeabi-v7a, and only usable if the CPU has NEON.
+ *
+ * Writes 'width' pixels to 'line', pixel xx taking its color from
+ * 'palette' for the 16.16 fixed-point value (base + xsum[xx])/4.
+ */
+void fill_plasma_row_neon(uint16_t* line, const int32_t* xsum, int width,
+                          int32_t base, const uint16_t* palette);
+
+#endif /* PLASMA_NEON_H */
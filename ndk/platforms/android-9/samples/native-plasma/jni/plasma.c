@@ -19,14 +19,21 @@
 
 #include <errno.h>
 #include <jni.h>
+#include <pthread.h>
 #include <sys/time.h>
 #include <time.h>
 #include <android/log.h>
+#include <cpu-features.h>
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
+#ifdef HAVE_NEON
+#include "plasma-neon.h"
+#endif
+
 #define  LOG_TAG    "libplasma"
 #define  LOGI(...)  __android_log_print(ANDROID_LOG_INFO,LOG_TAG,__VA_ARGS__)
 #define  LOGW(...)  __android_log_print(ANDROID_LOG_WARN,LOG_TAG,__VA_ARGS__)
@@ -38,6 +45,9 @@
 /* Set to 1 to optimize memory stores when generating plasma. */
 #define OPTIMIZE_WRITES  1
 
+/* Maximum number of threads used to render a frame */
+#define MAX_THREADS  8
+
 /* Return current time in milliseconds */
 static double now_ms(void)
 {
@@ -190,93 +200,213 @@ static void init_tables(void)
     init_angles();
 }
 
-static void fill_plasma(ANativeWindow_Buffer* buffer, double  t)
-{
-    Fixed ft  = FIXED_FROM_FLOAT(t/1000.);
-    Fixed yt1 = FIXED_FROM_FLOAT(t/1230.);
-    Fixed yt2 = yt1;
-    Fixed xt10 = FIXED_FROM_FLOAT(t/3000.);
-    Fixed xt20 = xt10;
-
 #define  YT1_INCR   FIXED_FROM_FLOAT(1/100.)
 #define  YT2_INCR   FIXED_FROM_FLOAT(1/163.)
 
-    void* pixels = buffer->bits;
+#define  XT1_INCR  FIXED_FROM_FLOAT(1/173.)
+#define  XT2_INCR  FIXED_FROM_FLOAT(1/242.)
+
+/* The x terms of the plasma, fixed_sin(xt1) + fixed_sin(xt2), are the
+ * same for every line of a frame, so they are computed once per frame
+ * in this table, and each pixel only costs an add and a palette lookup.
+ */
+static Fixed*  plasma_xsum;
+static int     plasma_xsum_size;
+
+static int     use_neon;
+
+static int init_xsum(int width, double t)
+{
+    Fixed xt1 = FIXED_FROM_FLOAT(t/3000.);
+    Fixed xt2 = xt1;
+    int   xx;
+
+    if (width > plasma_xsum_size) {
+        Fixed*  xsum = realloc(plasma_xsum, width*sizeof(Fixed));
+        if (xsum == NULL)
+            return -1;
+        plasma_xsum      = xsum;
+        plasma_xsum_size = width;
+    }
+
+    for (xx = 0; xx < width; xx++) {
+        plasma_xsum[xx] = fixed_sin(xt1) + fixed_sin(xt2);
+        xt1 += XT1_INCR;
+        xt2 += XT2_INCR;
+    }
+    return 0;
+}
+
+static void fill_plasma_row(uint16_t* line, const Fixed* xsum, int width, Fixed base)
+{
+#if OPTIMIZE_WRITES
+    /* optimize memory writes by generating one aligned 32-bit store
+     * for every pair of pixels.
+     */
+    uint16_t*  line_end = line + width;
+
+    if (line < line_end) {
+        if (((uint32_t)line & 3) != 0) {
+            line[0] = palette_from_fixed((base + *xsum++) >> 2);
+            line++;
+        }
+
+        while (line + 2 <= line_end) {
+            Fixed i1 = base + xsum[0];
+            Fixed i2 = base + xsum[1];
+
+            /* the first pixel goes in the low half on little-endian CPUs */
+            uint32_t  pixel = ((uint32_t)palette_from_fixed(i2 >> 2) << 16) |
+                               (uint32_t)palette_from_fixed(i1 >> 2);
+
+            ((uint32_t*)line)[0] = pixel;
+            line += 2;
+            xsum += 2;
+        }
+
+        if (line < line_end) {
+            line[0] = palette_from_fixed((base + *xsum) >> 2);
+            line++;
+        }
+    }
+#else /* !OPTIMIZE_WRITES */
+    int xx;
+    for (xx = 0; xx < width; xx++) {
+        line[xx] = palette_from_fixed((base + xsum[xx]) >> 2);
+    }
+#endif /* !OPTIMIZE_WRITES */
+}
+
+/* Render lines [y0,y1) of the frame at time 't', init_xsum() must have
+ * been called for the frame first. */
+static void fill_plasma_rows(ANativeWindow_Buffer* buffer, double  t, int y0, int y1)
+{
+    Fixed yt1 = FIXED_FROM_FLOAT(t/1230.) + y0*YT1_INCR;
+    Fixed yt2 = FIXED_FROM_FLOAT(t/1230.) + y0*YT2_INCR;
+
+    uint16_t* pixels = (uint16_t*)buffer->bits + y0*buffer->stride;
     //LOGI("width=%d height=%d stride=%d format=%d", buffer->width, buffer->height,
     //        buffer->stride, buffer->format);
 
     int  yy;
-    for (yy = 0; yy < buffer->height; yy++) {
-        uint16_t*  line = (uint16_t*)pixels;
-        Fixed      base = fixed_sin(yt1) + fixed_sin(yt2);
-        Fixed      xt1 = xt10;
-        Fixed      xt2 = xt20;
+    for (yy = y0; yy < y1; yy++) {
+        Fixed  base = fixed_sin(yt1) + fixed_sin(yt2);
 
         yt1 += YT1_INCR;
         yt2 += YT2_INCR;
 
-#define  XT1_INCR  FIXED_FROM_FLOAT(1/173.)
-#define  XT2_INCR  FIXED_FROM_FLOAT(1/242.)
-
-#if OPTIMIZE_WRITES
-        /* optimize memory writes by generating one aligned 32-bit store
-         * for every pair of pixels.
-         */
-        uint16_t*  line_end = line + buffer->width;
+#ifdef HAVE_NEON
+        if (use_neon)
+            fill_plasma_row_neon(pixels, plasma_xsum, buffer->width, base, palette);
+        else
+#endif
+            fill_plasma_row(pixels, plasma_xsum, buffer->width, base);
 
-        if (line < line_end) {
-            if (((uint32_t)line & 3) != 0) {
-                Fixed ii = base + fixed_sin(xt1) + fixed_sin(xt2);
+        // go to next line
+        pixels += buffer->stride;
+    }
+}
 
-                xt1 += XT1_INCR;
-                xt2 += XT2_INCR;
+/* Rendering threads: each frame is cut in one band of lines per thread,
+ * the calling thread renders the first band and waits for the others.
+ */
+typedef struct {
+    pthread_mutex_t        lock;
+    pthread_cond_t         startCond;
+    pthread_cond_t         doneCond;
+    int                    numThreads;
+    int                    generation;  /* incremented for each frame */
+    int                    pending;     /* bands not rendered yet */
+    ANativeWindow_Buffer*  buffer;
+    double                 time;
+} Workers;
+
+static Workers    workers;
+static pthread_t  worker_threads[MAX_THREADS];
+
+static void fill_plasma_band(int band)
+{
+    int height = workers.buffer->height;
+    int n      = workers.numThreads;
 
-                line[0] = palette_from_fixed(ii >> 2);
-                line++;
-            }
+    fill_plasma_rows(workers.buffer, workers.time,
+                     height*band/n, height*(band+1)/n);
+}
 
-            while (line + 2 <= line_end) {
-                Fixed i1 = base + fixed_sin(xt1) + fixed_sin(xt2);
-                xt1 += XT1_INCR;
-                xt2 += XT2_INCR;
+static void* worker_main(void* arg)
+{
+    int band = (int)(intptr_t)arg;
+    int generation = 0;
 
-                Fixed i2 = base + fixed_sin(xt1) + fixed_sin(xt2);
-                xt1 += XT1_INCR;
-                xt2 += XT2_INCR;
+    pthread_mutex_lock(&workers.lock);
+    for (;;) {
+        while (workers.generation == generation)
+            pthread_cond_wait(&workers.startCond, &workers.lock);
+        generation = workers.generation;
+        pthread_mutex_unlock(&workers.lock);
 
-                uint32_t  pixel = ((uint32_t)palette_from_fixed(i1 >> 2) << 16) |
-                                   (uint32_t)palette_from_fixed(i2 >> 2);
+        fill_plasma_band(band);
 
-                ((uint32_t*)line)[0] = pixel;
-                line += 2;
-            }
+        pthread_mutex_lock(&workers.lock);
+        if (--workers.pending == 0)
+            pthread_cond_signal(&workers.doneCond);
+    }
+    return NULL;
+}
 
-            if (line < line_end) {
-                Fixed ii = base + fixed_sin(xt1) + fixed_sin(xt2);
-                line[0] = palette_from_fixed(ii >> 2);
-                line++;
-            }
-        }
-#else /* !OPTIMIZE_WRITES */
-        int xx;
-        for (xx = 0; xx < buffer->width; xx++) {
+static void init_workers(void)
+{
+    int nn, count = android_getCpuCount();
 
-            Fixed ii = base + fixed_sin(xt1) + fixed_sin(xt2);
+    if (count > MAX_THREADS)
+        count = MAX_THREADS;
 
-            xt1 += XT1_INCR;
-            xt2 += XT2_INCR;
+    pthread_mutex_init(&workers.lock, NULL);
+    pthread_cond_init(&workers.startCond, NULL);
+    pthread_cond_init(&workers.doneCond, NULL);
+    workers.numThreads = 1;
 
-            line[xx] = palette_from_fixed(ii / 4);
+    for (nn = 1; nn < count; nn++) {
+        if (pthread_create(&worker_threads[nn], NULL, worker_main,
+                           (void*)(intptr_t)nn) != 0) {
+            LOGW("Unable to create rendering thread: %s", strerror(errno));
+            break;
         }
-#endif /* !OPTIMIZE_WRITES */
+        workers.numThreads++;
+    }
+}
 
-        // go to next line
-        pixels = (uint16_t*)pixels + buffer->stride;
+static void fill_plasma(ANativeWindow_Buffer* buffer, double  t)
+{
+    if (init_xsum(buffer->width, t) < 0) {
+        LOGE("Out of memory");
+        return;
     }
+
+    if (workers.numThreads == 1) {
+        fill_plasma_rows(buffer, t, 0, buffer->height);
+        return;
+    }
+
+    pthread_mutex_lock(&workers.lock);
+    workers.buffer  = buffer;
+    workers.time    = t;
+    workers.pending = workers.numThreads - 1;
+    workers.generation++;
+    pthread_cond_broadcast(&workers.startCond);
+    pthread_mutex_unlock(&workers.lock);
+
+    fill_plasma_band(0);
+
+    pthread_mutex_lock(&workers.lock);
+    while (workers.pending > 0)
+        pthread_cond_wait(&workers.doneCond, &workers.lock);
+    pthread_mutex_unlock(&workers.lock);
 }
 
 /* simple stats management */
 typedef struct {
+    double  fillTime;
     double  renderTime;
     double  frameTime;
 } FrameStats;
@@ -288,6 +418,7 @@ typedef struct {
     double  firstTime;
     double  lastTime;
     double  frameTime;
+    double  fillTime;
 
     int         firstFrame;
     int         numFrames;
@@ -309,6 +440,13 @@ stats_startFrame( Stats*  s )
     s->frameTime = now_ms();
 }
 
+/* call when the pixels of the frame have been computed */
+static void
+stats_endFill( Stats*  s )
+{
+    s->fillTime = now_ms() - s->frameTime;
+}
+
 static void
 stats_endFrame( Stats*  s )
 {
@@ -319,33 +457,42 @@ stats_endFrame( Stats*  s )
 
     if (now - s->firstTime >= MAX_PERIOD_MS) {
         if (s->numFrames > 0) {
+            double minFill, maxFill, avgFill;
             double minRender, maxRender, avgRender;
             double minFrame, maxFrame, avgFrame;
             int count;
 
             nn = s->firstFrame;
+            minFill   = maxFill   = avgFill   = s->frames[nn].fillTime;
             minRender = maxRender = avgRender = s->frames[nn].renderTime;
             minFrame  = maxFrame  = avgFrame  = s->frames[nn].frameTime;
             for (count = s->numFrames; count > 0; count-- ) {
                 nn += 1;
                 if (nn >= MAX_FRAME_STATS)
                     nn -= MAX_FRAME_STATS;
+                double fill = s->frames[nn].fillTime;
+                if (fill < minFill) minFill = fill;
+                if (fill > maxFill) maxFill = fill;
                 double render = s->frames[nn].renderTime;
                 if (render < minRender) minRender = render;
                 if (render > maxRender) maxRender = render;
                 double frame = s->frames[nn].frameTime;
                 if (frame < minFrame) minFrame = frame;
                 if (frame > maxFrame) maxFrame = frame;
+                avgFill   += fill;
                 avgRender += render;
                 avgFrame  += frame;
             }
+            avgFill   /= s->numFrames;
             avgRender /= s->numFrames;
             avgFrame  /= s->numFrames;
 
             LOGI("frame/s (avg,min,max) = (%.1f,%.1f,%.1f) "
-                 "render time ms (avg,min,max) = (%.1f,%.1f,%.1f)\n",
+                 "render time ms (avg,min,max) = (%.1f,%.1f,%.1f) "
+                 "fill time ms (avg,min,max) = (%.1f,%.1f,%.1f)\n",
                  1000./avgFrame, 1000./maxFrame, 1000./minFrame,
-                 avgRender, minRender, maxRender);
+                 avgRender, minRender, maxRender,
+                 avgFill, minFill, maxFill);
         }
         s->numFrames  = 0;
         s->firstFrame = 0;
@@ -356,6 +503,7 @@ stats_endFrame( Stats*  s )
     if (nn >= MAX_FRAME_STATS)
         nn -= MAX_FRAME_STATS;
 
+    s->frames[nn].fillTime   = s->fillTime;
     s->frames[nn].renderTime = renderTime;
     s->frames[nn].frameTime  = frameTime;
 
@@ -401,6 +549,7 @@ static void engine_draw_frame(struct engine* engine) {
 
     /* Now fill the values with a nice little plasma */
     fill_plasma(&buffer, time_ms);
+    stats_endFill(&engine->stats);
 
     ANativeWindow_unlockAndPost(engine->app->window);
 
@@ -460,6 +609,13 @@ void android_main(struct android_app* state) {
 
     if (!init) {
         init_tables();
+        init_workers();
+#ifdef HAVE_NEON
+        use_neon = (android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
+                    (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON) != 0);
+#endif
+        LOGI("Rendering with %d thread(s), %s inner loop",
+             workers.numThreads, use_neon ? "NEON" : "C");
         init = 1;
     }
 
@@ -4,7 +4,7 @@ include $(CLEAR_VARS)
 
 LOCAL_MODULE := helloneon
 
-LOCAL_SRC_FILES := helloneon.c
+LOCAL_SRC_FILES := helloneon.c helloneon-bench.c helloneon-kernels.c
 
 ifeq ($(TARGET_ARCH_ABI),armeabi-v7a)
     LOCAL_CFLAGS := -DHAVE_NEON=1
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "helloneon-bench.h"
+#include <time.h>
+#include <stdlib.h>
+
+/* return current time in microseconds */
+static double
+now_us(void)
+{
+    struct timespec res;
+    clock_gettime(CLOCK_MONOTONIC, &res);
+    return 1e6*res.tv_sec + (double)res.tv_nsec/1e3;
+}
+
+/* run 'iterations' calls of 'func', return the elapsed time */
+static double
+run_repetition(BenchFunc func, void* opaque, int iterations)
+{
+    double  t0 = now_us();
+    int     nn;
+    for (nn = 0; nn < iterations; nn++) {
+        func(opaque);
+    }
+    return now_us() - t0;
+}
+
+static int
+compare_doubles(const void* a, const void* b)
+{
+    double  da = *(const double*)a;
+    double  db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+void
+bench_measure(BenchFunc func, void* opaque, BenchStats* stats)
+{
+    double  samples[BENCH_REPETITIONS];
+    int     iterations = 1;
+    int     nn;
+
+    /* calibrate, doubling the number of calls until a repetition is
+     * long enough for the clock resolution not to matter */
+    while (run_repetition(func, opaque, iterations) < BENCH_MIN_REP_US &&
+           iterations < (1 << 24)) {
+        iterations *= 2;
+    }
+
+    for (nn = 0; nn < BENCH_WARMUPS; nn++) {
+        run_repetition(func, opaque, iterations);
+    }
+
+    for (nn = 0; nn < BENCH_REPETITIONS; nn++) {
+        samples[nn] = run_repetition(func, opaque, iterations) / iterations;
+    }
+    qsort(samples, BENCH_REPETITIONS, sizeof(samples[0]), compare_doubles);
+
+    /* nearest-rank percentiles */
+    stats->iterations  = iterations;
+    stats->repetitions = BENCH_REPETITIONS;
+    stats->min_us      = samples[0];
+    stats->p10_us      = samples[(BENCH_REPETITIONS - 1) * 10 / 100];
+    stats->median_us   = samples[(BENCH_REPETITIONS - 1) / 2];
+    stats->p90_us      = samples[(BENCH_REPETITIONS - 1) * 90 / 100];
+    stats->max_us      = samples[BENCH_REPETITIONS - 1];
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef HELLONEON_BENCH_H
+#define HELLONEON_BENCH_H
+
+/* A tiny benchmark harness.
+ *
+ * bench_measure() first calibrates how many calls of a kernel make one
+ * repetition last at least BENCH_MIN_REP_US, then runs BENCH_WARMUPS
+ * repetitions that are not measured, and BENCH_REPETITIONS that are.
+ * The statistics are given for a single call, in microseconds.
+ */
+#define  BENCH_WARMUPS       3
+#define  BENCH_REPETITIONS   15
+#define  BENCH_MIN_REP_US    1000.0
+
+typedef void (*BenchFunc)(void* opaque);
+
+typedef struct {
+    int     iterations;     /* calls per repetition */
+    int     repetitions;
+    double  min_us;
+    double  p10_us;
+    double  median_us;
+    double  p90_us;
+    double  max_us;
+} BenchStats;
+
+void bench_measure(BenchFunc func, void* opaque, BenchStats* stats);
+
+#endif /* HELLONEON_BENCH_H */
@@ -15,6 +15,8 @@
  *
  */
 #include "helloneon-intrinsics.h"
+#include "helloneon-kernels.h"
+#include <string.h>
 #include <arm_neon.h>
 
 /* this source file should only be compiled by Android.mk when targeting
@@ -62,3 +64,110 @@ fir_filter_neon_intrinsics(short *output, const short* input, const short* kerne
     }
 #endif
 }
+
+int64_t
+dot_product_neon_intrinsics(const short* input0, const short* input1, int count)
+{
+    int64x2_t  sum_vec = vdupq_n_s64(0);
+    int64_t    sum;
+    int        nn;
+
+    for (nn = 0; nn + 8 <= count; nn += 8) {
+        int16x8_t  a = vld1q_s16(input0 + nn);
+        int16x8_t  b = vld1q_s16(input1 + nn);
+        /* each product fits in 32 bits, they are summed in 64 bits */
+        sum_vec = vpadalq_s32(sum_vec, vmull_s16(vget_low_s16(a), vget_low_s16(b)));
+        sum_vec = vpadalq_s32(sum_vec, vmull_s16(vget_high_s16(a), vget_high_s16(b)));
+    }
+
+    sum = vgetq_lane_s64(sum_vec, 0) + vgetq_lane_s64(sum_vec, 1);
+    for (; nn < count; nn++)
+        sum += input0[nn]*input1[nn];
+
+    return sum;
+}
+
+/* see yuv420sp_row_to_rgb565_c() for the coefficients */
+static inline uint16x8_t
+pack_rgb565(int16x8_t yy, int16x8_t rv, int16x8_t guv, int16x8_t bu)
+{
+    uint8x8_t   r = vqmovun_s16(vshrq_n_s16(vqaddq_s16(yy, rv), 6));
+    uint8x8_t   g = vqmovun_s16(vshrq_n_s16(vqsubq_s16(yy, guv), 6));
+    uint8x8_t   b = vqmovun_s16(vshrq_n_s16(vqaddq_s16(yy, bu), 6));
+    uint16x8_t  rgb = vshll_n_u8(r, 8);
+    rgb = vsriq_n_u16(rgb, vshll_n_u8(g, 8), 5);
+    rgb = vsriq_n_u16(rgb, vshll_n_u8(b, 8), 11);
+    return rgb;
+}
+
+void
+yuv420sp_to_rgb565_neon_intrinsics(uint16_t* output, const uint8_t* y, const uint8_t* vu, int width, int height)
+{
+    const int16x8_t  k16  = vdupq_n_s16(16);
+    const int16x8_t  k128 = vdupq_n_s16(128);
+    int  row;
+
+    for (row = 0; row < height; row++) {
+        const uint8_t*  py  = y + row*width;
+        const uint8_t*  pvu = vu + (row/2)*width;
+        uint16_t*       out = output + row*width;
+        int             nn;
+
+        /* 16 pixels, sharing 8 V/U pairs, at a time */
+        for (nn = 0; nn + 16 <= width; nn += 16) {
+            uint8x16_t   yv = vld1q_u8(py + nn);
+            uint8x8x2_t  c  = vld2_u8(pvu + nn);
+            int16x8_t    v  = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(c.val[0])), k128);
+            int16x8_t    u  = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(c.val[1])), k128);
+            int16x8_t    y0 = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(yv)));
+            int16x8_t    y1 = vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(yv)));
+
+            /* each chroma term is used by two neighbouring pixels */
+            int16x8x2_t  rv  = vzipq_s16(vmulq_n_s16(v, 102), vmulq_n_s16(v, 102));
+            int16x8_t    guv_half = vmlaq_n_s16(vmulq_n_s16(v, 52), u, 25);
+            int16x8x2_t  guv = vzipq_s16(guv_half, guv_half);
+            int16x8x2_t  bu  = vzipq_s16(vmulq_n_s16(u, 129), vmulq_n_s16(u, 129));
+
+            y0 = vmulq_n_s16(vsubq_s16(y0, k16), 74);
+            y1 = vmulq_n_s16(vsubq_s16(y1, k16), 74);
+
+            vst1q_u16(out + nn,     pack_rgb565(y0, rv.val[0], guv.val[0], bu.val[0]));
+            vst1q_u16(out + nn + 8, pack_rgb565(y1, rv.val[1], guv.val[1], bu.val[1]));
+        }
+
+        if (nn < width)
+            yuv420sp_row_to_rgb565_c(out + nn, py + nn, pvu + nn, width - nn);
+    }
+}
+
+void
+fixed_to_float_neon_intrinsics(float* output, const int32_t* input, int count)
+{
+    int  nn;
+    for (nn = 0; nn + 4 <= count; nn += 4) {
+        vst1q_f32(output + nn, vcvtq_n_f32_s32(vld1q_s32(input + nn), 16));
+    }
+    if (nn < count)
+        fixed_to_float_c(output + nn, input + nn, count - nn);
+}
+
+void
+copy_neon_intrinsics(void* dst, const void* src, int size)
+{
+    uint8_t*        d = dst;
+    const uint8_t*  s = src;
+    int             nn;
+
+    for (nn = 0; nn + 64 <= size; nn += 64) {
+        uint8x16_t  a = vld1q_u8(s + nn);
+        uint8x16_t  b = vld1q_u8(s + nn + 16);
+        uint8x16_t  c = vld1q_u8(s + nn + 32);
+        uint8x16_t  e = vld1q_u8(s + nn + 48);
+        vst1q_u8(d + nn,      a);
+        vst1q_u8(d + nn + 16, b);
+        vst1q_u8(d + nn + 32, c);
+        vst1q_u8(d + nn + 48, e);
+    }
+    if (nn < size)
+        memcpy(d + nn, s + nn, size - nn);
+}
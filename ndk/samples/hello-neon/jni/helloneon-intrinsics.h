@@ -17,6 +17,19 @@
 #ifndef HELLONEON_INTRINSICS_H
 #define HELLONEON_INTRINSICS_H
 
+#include <stdint.h>
+
+/* NEON versions of the kernels in helloneon-kernels.h, only available
+ * when building for armeabi-v7a, and only usable if the CPU has NEON */
 void fir_filter_neon_intrinsics(short *output, const short* input, const short* kernel, int width, int kernelSize);
 
+int64_t dot_product_neon_intrinsics(const short* input0, const short* input1, int count);
+
+void yuv420sp_to_rgb565_neon_intrinsics(uint16_t* output, const uint8_t* y, const uint8_t* vu, int width, int height);
+
+void fixed_to_float_neon_intrinsics(float* output, const int32_t* input, int count);
+
+/* same as memcpy() */
+void copy_neon_intrinsics(void* dst, const void* src, int size);
+
 #endif /* HELLONEON_INTRINSICS_H */
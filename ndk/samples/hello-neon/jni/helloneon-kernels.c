@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "helloneon-kernels.h"
+
+/* this is a FIR filter implemented in C */
+void
+fir_filter_c(short *output, const short* input, const short* kernel, int width, int kernelSize)
+{
+    int  offset = -kernelSize/2;
+    int  nn;
+    for (nn = 0; nn < width; nn++) {
+        int sum = 0;
+        int mm;
+        for (mm = 0; mm < kernelSize; mm++) {
+            sum += kernel[mm]*input[nn+offset+mm];
+        }
+        output[nn] = (short)((sum + 0x8000) >> 16);
+    }
+}
+
+int64_t
+dot_product_c(const short* input0, const short* input1, int count)
+{
+    int64_t  sum = 0;
+    int      nn;
+    for (nn = 0; nn < count; nn++) {
+        sum += input0[nn]*input1[nn];
+    }
+    return sum;
+}
+
+static int
+clamp_255(int value)
+{
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+/* BT.601 coefficients in 10.6 fixed point, which the NEON version computes
+ * with saturating 16-bit arithmetic: only blue can exceed 16 bits, and it
+ * then saturates to a value that is also clamped to 255 */
+void
+yuv420sp_row_to_rgb565_c(uint16_t* output, const uint8_t* y, const uint8_t* vu, int width)
+{
+    int  nn;
+    for (nn = 0; nn < width; nn++) {
+        int  yy = 74 * (y[nn] - 16);
+        int  v  = vu[nn & ~1] - 128;
+        int  u  = vu[nn | 1] - 128;
+        int  r  = clamp_255((yy + 102*v) >> 6);
+        int  g  = clamp_255((yy - 52*v - 25*u) >> 6);
+        int  b  = clamp_255((yy + 129*u) >> 6);
+        output[nn] = (uint16_t)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+    }
+}
+
+void
+yuv420sp_to_rgb565_c(uint16_t* output, const uint8_t* y, const uint8_t* vu, int width, int height)
+{
+    int  row;
+    for (row = 0; row < height; row++) {
+        yuv420sp_row_to_rgb565_c(output + row*width, y + row*width,
+                                 vu + (row/2)*width, width);
+    }
+}
+
+void
+fixed_to_float_c(float* output, const int32_t* input, int count)
+{
+    int  nn;
+    for (nn = 0; nn < count; nn++) {
+        output[nn] = (float)input[nn] * (1.0f / 65536.0f);
+    }
+}
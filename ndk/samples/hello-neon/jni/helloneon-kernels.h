@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef HELLONEON_KERNELS_H
+#define HELLONEON_KERNELS_H
+
+#include <stdint.h>
+
+/* Reference C versions of the benchmarked kernels. The NEON versions in
+ * helloneon-intrinsics.h must produce exactly the same results.
+ */
+
+/* FIR filter, 'input' must have kernelSize/2 valid samples before and
+ * after the 'width' ones filtered */
+void fir_filter_c(short *output, const short* input, const short* kernel, int width, int kernelSize);
+
+/* sum of input0[nn]*input1[nn] */
+int64_t dot_product_c(const short* input0, const short* input1, int count);
+
+/* convert one row of a YUV 4:2:0 semi-planar (NV21) image to RGB565,
+ * 'vu' is the row of interleaved V/U samples for this row */
+void yuv420sp_row_to_rgb565_c(uint16_t* output, const uint8_t* y, const uint8_t* vu, int width);
+
+/* convert a whole NV21 image to RGB565 */
+void yuv420sp_to_rgb565_c(uint16_t* output, const uint8_t* y, const uint8_t* vu, int width, int height);
+
+/* convert 16.16 fixed point values to floats */
+void fixed_to_float_c(float* output, const int32_t* input, int count);
+
+#endif /* HELLONEON_KERNELS_H */
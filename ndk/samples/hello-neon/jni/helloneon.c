@@ -15,149 +15,446 @@
  *
  */
 #include <jni.h>
-#include <time.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
 #include <cpu-features.h>
+#include <android/log.h>
+#include "helloneon-bench.h"
+#include "helloneon-kernels.h"
 #include "helloneon-intrinsics.h"
 
 #define DEBUG 0
 
 #if DEBUG
-#include <android/log.h>
 #  define  D(x...)  __android_log_print(ANDROID_LOG_INFO,"helloneon",x)
 #else
 #  define  D(...)  do {} while (0)
 #endif
 
-/* return current time in milliseconds */
-static double
-now_ms(void)
+/* Results are always logged, one comma-separated line per measurement,
+ * get them with:  adb logcat -d -s helloneon | grep RESULT
+ */
+#define  R(x...)  __android_log_print(ANDROID_LOG_INFO,"helloneon",x)
+
+/* the summary displayed by the application */
+static char  s_report[8192];
+
+static void
+report(const char* format, ...)
 {
-    struct timespec res;
-    clock_gettime(CLOCK_REALTIME, &res);
-    return 1000.0*res.tv_sec + (double)res.tv_nsec/1e6;
+    size_t   len = strlen(s_report);
+    va_list  args;
+    va_start(args, format);
+    vsnprintf(s_report + len, sizeof s_report - len, format, args);
+    va_end(args);
 }
 
+/* NULL if the NEON kernels can be used, otherwise why they can't */
+static const char*  s_no_neon;
 
-/* this is a FIR filter implemented in C */
 static void
-fir_filter_c(short *output, const short* input, const short* kernel, int width, int kernelSize)
+check_neon(void)
 {
-    int  offset = -kernelSize/2;
-    int  nn;
-    for (nn = 0; nn < width; nn++) {
-        int sum = 0;
-        int mm;
-        for (mm = 0; mm < kernelSize; mm++) {
-            sum += kernel[mm]*input[nn+offset+mm];
-        }
-        output[nn] = (short)((sum + 0x8000) >> 16);
+    uint64_t  features;
+
+    features = android_getCpuFeatures();
+    R("DEVICE,cpu_family=%d,cpu_count=%d,features=0x%llx",
+      android_getCpuFamily(), android_getCpuCount(),
+      (unsigned long long)features);
+
+    s_no_neon = NULL;
+    if (android_getCpuFamily() != ANDROID_CPU_FAMILY_ARM) {
+        s_no_neon = "Not an ARM CPU !";
+        return;
     }
-}
 
-#define  FIR_KERNEL_SIZE   32
-#define  FIR_OUTPUT_SIZE   2560
-#define  FIR_INPUT_SIZE    (FIR_OUTPUT_SIZE + FIR_KERNEL_SIZE)
-#define  FIR_ITERATIONS    600
+    if ((features & ANDROID_CPU_ARM_FEATURE_ARMv7) == 0) {
+        s_no_neon = "Not an ARMv7 CPU !";
+        return;
+    }
 
-static const short  fir_kernel[FIR_KERNEL_SIZE] = { 
-    0x10, 0x20, 0x40, 0x70, 0x8c, 0xa2, 0xce, 0xf0, 0xe9, 0xce, 0xa2, 0x8c, 070, 0x40, 0x20, 0x10,
-    0x10, 0x20, 0x40, 0x70, 0x8c, 0xa2, 0xce, 0xf0, 0xe9, 0xce, 0xa2, 0x8c, 070, 0x40, 0x20, 0x10 };
+    /* HAVE_NEON is defined in Android.mk ! */
+#ifdef HAVE_NEON
+    if ((features & ANDROID_CPU_ARM_FEATURE_NEON) == 0) {
+        s_no_neon = "CPU doesn't support NEON !";
+    }
+#else
+    s_no_neon = "Program not compiled with ARMv7 support !";
+#endif
+}
 
-static short        fir_output[FIR_OUTPUT_SIZE];
-static short        fir_input_0[FIR_INPUT_SIZE];
-static const short* fir_input = fir_input_0 + (FIR_KERNEL_SIZE/2);
-static short        fir_output_expected[FIR_OUTPUT_SIZE];
+static void
+log_stats(const char* kernel, const char* impl, int size, int param,
+          const BenchStats* stats, const char* check)
+{
+    R("RESULT,%s,%s,%d,%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%s",
+      kernel, impl, size, param, stats->iterations, stats->repetitions,
+      stats->min_us, stats->p10_us, stats->median_us, stats->p90_us,
+      stats->max_us, check);
+}
 
-/* This is a trivial JNI example where we use a native method
- * to return a new VM String. See the corresponding Java source
- * file located at:
- *
- *   apps/samples/hello-neon/project/src/com/example/neon/HelloNeon.java
+/* Benchmark the C and NEON versions of a kernel. Each one writes
+ * 'output_size' bytes to 'output', the NEON result is checked against
+ * 'expected', which the caller computed with the C version.
  */
-jstring
-Java_com_example_neon_HelloNeon_stringFromJNI( JNIEnv* env,
-                                               jobject thiz )
+static void
+bench_pair(const char* kernel, int size, int param,
+           BenchFunc func_c, BenchFunc func_neon, void* args,
+           void* output, const void* expected, size_t output_size)
 {
-    char*  str;
-    uint64_t features;
-    char buffer[512];
-    char tryNeon = 0;
-    double  t0, t1, time_c, time_neon;
+    BenchStats  stats_c, stats_neon;
 
-    /* setup FIR input - whatever */
-    {
-        int  nn;
-        for (nn = 0; nn < FIR_INPUT_SIZE; nn++) {
-            fir_input_0[nn] = (5*nn) & 255;
-        }
-        fir_filter_c(fir_output_expected, fir_input, fir_kernel, FIR_OUTPUT_SIZE, FIR_KERNEL_SIZE);
+    bench_measure(func_c, args, &stats_c);
+    log_stats(kernel, "c", size, param, &stats_c, "ref");
+
+    if (param != 0)
+        report("%s %d/%d: C %.2f us", kernel, size, param, stats_c.median_us);
+    else
+        report("%s %d: C %.2f us", kernel, size, stats_c.median_us);
+
+    if (s_no_neon != NULL || func_neon == NULL) {
+        report("\n");
+        return;
     }
 
-    /* Benchmark small FIR filter loop - C version */
-    t0 = now_ms();
     {
-        int  count = FIR_ITERATIONS;
-        for (; count > 0; count--) {
-            fir_filter_c(fir_output, fir_input, fir_kernel, FIR_OUTPUT_SIZE, FIR_KERNEL_SIZE);
-        }
+        const char*  check;
+
+        memset(output, 0x55, output_size);
+        func_neon(args);
+        check = memcmp(output, expected, output_size) ? "FAIL" : "ok";
+
+        bench_measure(func_neon, args, &stats_neon);
+        log_stats(kernel, "neon", size, param, &stats_neon, check);
+
+        report(", NEON %.2f us (x%.2f)%s\n", stats_neon.median_us,
+               stats_c.median_us / (stats_neon.median_us < 1e-6 ? 1. : stats_neon.median_us),
+               strcmp(check, "ok") ? " WRONG RESULT" : "");
     }
-    t1 = now_ms();
-    time_c = t1 - t0;
+}
 
-    asprintf(&str, "FIR Filter benchmark:\nC version          : %g ms\n", time_c);
-    strlcpy(buffer, str, sizeof buffer);
-    free(str);
+#ifdef HAVE_NEON
+#  define  NEON_FUNC(f)  f
+#else
+#  define  NEON_FUNC(f)  NULL
+#endif
 
-    strlcat(buffer, "Neon version   : ", sizeof buffer);
+/* FIR filter */
 
-    if (android_getCpuFamily() != ANDROID_CPU_FAMILY_ARM) {
-        strlcat(buffer, "Not an ARM CPU !\n", sizeof buffer);
-        goto EXIT;
+typedef struct {
+    short*        output;
+    const short*  input;
+    const short*  kernel;
+    int           width;
+    int           kernelSize;
+} FirArgs;
+
+static void
+run_fir_c(void* opaque)
+{
+    FirArgs*  a = opaque;
+    fir_filter_c(a->output, a->input, a->kernel, a->width, a->kernelSize);
+}
+
+#ifdef HAVE_NEON
+static void
+run_fir_neon(void* opaque)
+{
+    FirArgs*  a = opaque;
+    fir_filter_neon_intrinsics(a->output, a->input, a->kernel, a->width, a->kernelSize);
+}
+#endif
+
+static void
+bench_fir(int width, int kernelSize)
+{
+    short*   kernel   = malloc(kernelSize * sizeof(short));
+    short*   input    = malloc((width + kernelSize) * sizeof(short));
+    short*   output   = malloc(width * sizeof(short));
+    short*   expected = malloc(width * sizeof(short));
+    FirArgs  args;
+    int      nn;
+
+    for (nn = 0; nn < kernelSize; nn++) {
+        kernel[nn] = 0x10 + ((nn * 37) & 0xdf);
+    }
+    for (nn = 0; nn < width + kernelSize; nn++) {
+        input[nn] = (5*nn) & 255;
     }
 
-    features = android_getCpuFeatures();
-    if ((features & ANDROID_CPU_ARM_FEATURE_ARMv7) == 0) {
-        strlcat(buffer, "Not an ARMv7 CPU !\n", sizeof buffer);
-        goto EXIT;
+    args.input      = input + kernelSize/2;
+    args.kernel     = kernel;
+    args.width      = width;
+    args.kernelSize = kernelSize;
+
+    args.output = expected;
+    run_fir_c(&args);
+    args.output = output;
+    bench_pair("fir", width, kernelSize, run_fir_c, NEON_FUNC(run_fir_neon),
+               &args, output, expected, width * sizeof(short));
+
+    free(kernel);
+    free(input);
+    free(output);
+    free(expected);
+}
+
+/* memcpy */
+
+typedef struct {
+    void*        output;
+    const void*  input;
+    int          size;
+} CopyArgs;
+
+static void
+run_copy_c(void* opaque)
+{
+    CopyArgs*  a = opaque;
+    memcpy(a->output, a->input, a->size);
+}
+
+#ifdef HAVE_NEON
+static void
+run_copy_neon(void* opaque)
+{
+    CopyArgs*  a = opaque;
+    copy_neon_intrinsics(a->output, a->input, a->size);
+}
+#endif
+
+static void
+bench_copy(int size)
+{
+    unsigned char*  input  = malloc(size);
+    unsigned char*  output = malloc(size);
+    CopyArgs        args;
+    int             nn;
+
+    for (nn = 0; nn < size; nn++) {
+        input[nn] = (unsigned char)(nn * 7);
     }
 
-    /* HAVE_NEON is defined in Android.mk ! */
+    args.input  = input;
+    args.output = output;
+    args.size   = size;
+    bench_pair("memcpy", size, 0, run_copy_c, NEON_FUNC(run_copy_neon),
+               &args, output, input, size);
+
+    free(input);
+    free(output);
+}
+
+/* dot product */
+
+typedef struct {
+    int64_t*      output;
+    const short*  input0;
+    const short*  input1;
+    int           count;
+} DotArgs;
+
+static void
+run_dot_c(void* opaque)
+{
+    DotArgs*  a = opaque;
+    *a->output = dot_product_c(a->input0, a->input1, a->count);
+}
+
 #ifdef HAVE_NEON
-    if ((features & ANDROID_CPU_ARM_FEATURE_NEON) == 0) {
-        strlcat(buffer, "CPU doesn't support NEON !\n", sizeof buffer);
-        goto EXIT;
+static void
+run_dot_neon(void* opaque)
+{
+    DotArgs*  a = opaque;
+    *a->output = dot_product_neon_intrinsics(a->input0, a->input1, a->count);
+}
+#endif
+
+static void
+bench_dot(int count)
+{
+    short*   input0 = malloc(count * sizeof(short));
+    short*   input1 = malloc(count * sizeof(short));
+    int64_t  output, expected;
+    DotArgs  args;
+    int      nn;
+
+    for (nn = 0; nn < count; nn++) {
+        input0[nn] = (short)(nn * 2654435761U >> 16);
+        input1[nn] = (short)(nn * 40503U);
     }
 
-    /* Benchmark small FIR filter loop - Neon version */
-    t0 = now_ms();
-    {
-        int  count = FIR_ITERATIONS;
-        for (; count > 0; count--) {
-            fir_filter_neon_intrinsics(fir_output, fir_input, fir_kernel, FIR_OUTPUT_SIZE, FIR_KERNEL_SIZE);
-        }
+    args.input0 = input0;
+    args.input1 = input1;
+    args.count  = count;
+
+    args.output = &expected;
+    run_dot_c(&args);
+    args.output = &output;
+    bench_pair("dot", count, 0, run_dot_c, NEON_FUNC(run_dot_neon),
+               &args, &output, &expected, sizeof(output));
+
+    free(input0);
+    free(input1);
+}
+
+/* NV21 to RGB565 */
+
+typedef struct {
+    uint16_t*       output;
+    const uint8_t*  y;
+    const uint8_t*  vu;
+    int             width;
+    int             height;
+} YuvArgs;
+
+static void
+run_yuv_c(void* opaque)
+{
+    YuvArgs*  a = opaque;
+    yuv420sp_to_rgb565_c(a->output, a->y, a->vu, a->width, a->height);
+}
+
+#ifdef HAVE_NEON
+static void
+run_yuv_neon(void* opaque)
+{
+    YuvArgs*  a = opaque;
+    yuv420sp_to_rgb565_neon_intrinsics(a->output, a->y, a->vu, a->width, a->height);
+}
+#endif
+
+static void
+bench_yuv(int width, int height)
+{
+    int        pixels   = width * height;
+    uint8_t*   input    = malloc(pixels + pixels/2);
+    uint16_t*  output   = malloc(pixels * sizeof(uint16_t));
+    uint16_t*  expected = malloc(pixels * sizeof(uint16_t));
+    YuvArgs    args;
+    int        nn;
+
+    for (nn = 0; nn < pixels + pixels/2; nn++) {
+        input[nn] = (uint8_t)(nn * 2654435761U >> 24);
     }
-    t1 = now_ms();
-    time_neon = t1 - t0;
-    asprintf(&str, "%g ms (x%g faster)\n", time_neon, time_c / (time_neon < 1e-6 ? 1. : time_neon));
-    strlcat(buffer, str, sizeof buffer);
-    free(str);
 
-    /* check the result, just in case */
-    {
-        int  nn, fails = 0;
-        for (nn = 0; nn < FIR_OUTPUT_SIZE; nn++) {
-            if (fir_output[nn] != fir_output_expected[nn]) {
-                if (++fails < 16)
-                    D("neon[%d] = %d expected %d", nn, fir_output[nn], fir_output_expected[nn]);
-            }
+    args.y      = input;
+    args.vu     = input + pixels;
+    args.width  = width;
+    args.height = height;
+
+    args.output = expected;
+    run_yuv_c(&args);
+    args.output = output;
+    bench_pair("yuv2rgb565", pixels, width, run_yuv_c, NEON_FUNC(run_yuv_neon),
+               &args, output, expected, pixels * sizeof(uint16_t));
+
+    free(input);
+    free(output);
+    free(expected);
+}
+
+/* 16.16 fixed point to float */
+
+typedef struct {
+    float*          output;
+    const int32_t*  input;
+    int             count;
+} FixedArgs;
+
+static void
+run_fixed_c(void* opaque)
+{
+    FixedArgs*  a = opaque;
+    fixed_to_float_c(a->output, a->input, a->count);
+}
+
+#ifdef HAVE_NEON
+static void
+run_fixed_neon(void* opaque)
+{
+    FixedArgs*  a = opaque;
+    fixed_to_float_neon_intrinsics(a->output, a->input, a->count);
+}
+#endif
+
+static void
+bench_fixed(int count)
+{
+    int32_t*   input    = malloc(count * sizeof(int32_t));
+    float*     output   = malloc(count * sizeof(float));
+    float*     expected = malloc(count * sizeof(float));
+    FixedArgs  args;
+    int        nn;
+
+    for (nn = 0; nn < count; nn++) {
+        input[nn] = (int32_t)(nn * 2654435761U);
+    }
+
+    args.input = input;
+    args.count = count;
+
+    args.output = expected;
+    run_fixed_c(&args);
+    args.output = output;
+    bench_pair("fixed2float", count, 0, run_fixed_c, NEON_FUNC(run_fixed_neon),
+               &args, output, expected, count * sizeof(float));
+
+    free(input);
+    free(output);
+    free(expected);
+}
+
+/* the sweeps, sizes are in elements, or pixels for images */
+static const int  fir_kernel_sizes[] = { 8, 16, 32, 64 };
+static const int  fir_output_sizes[] = { 256, 2560, 25600 };
+static const int  copy_sizes[]       = { 1024, 16384, 262144, 4194304 };
+static const int  dot_sizes[]        = { 256, 4096, 65536 };
+static const int  yuv_sizes[][2]     = { { 176, 144 }, { 640, 480 }, { 1280, 720 } };
+static const int  fixed_sizes[]      = { 1024, 65536 };
+
+#define  ARRAY_SIZE(a)  (int)(sizeof(a)/sizeof((a)[0]))
+
+/* This is a trivial JNI example where we use a native method
+ * to return a new VM String. See the corresponding Java source
+ * file located at:
+ *
+ *   apps/samples/hello-neon/project/src/com/example/neon/HelloNeon.java
+ */
+jstring
+Java_com_example_neon_HelloNeon_stringFromJNI( JNIEnv* env,
+                                               jobject thiz )
+{
+    int  nn, mm;
+
+    s_report[0] = '\0';
+    check_neon();
+
+    report("Median time per call, size/parameter:\n");
+    if (s_no_neon != NULL) {
+        report("Neon version: %s\n", s_no_neon);
+    }
+    R("RESULT,kernel,impl,size,param,iterations,repetitions,min_us,p10_us,median_us,p90_us,max_us,check");
+
+    for (nn = 0; nn < ARRAY_SIZE(fir_output_sizes); nn++) {
+        for (mm = 0; mm < ARRAY_SIZE(fir_kernel_sizes); mm++) {
+            bench_fir(fir_output_sizes[nn], fir_kernel_sizes[mm]);
         }
-        D("%d fails\n", fails);
     }
-#else /* !HAVE_NEON */
-    strlcat(buffer, "Program not compiled with ARMv7 support !\n", sizeof buffer);
-#endif /* !HAVE_NEON */
-EXIT:
-    return (*env)->NewStringUTF(env, buffer);
+    for (nn = 0; nn < ARRAY_SIZE(copy_sizes); nn++) {
+        bench_copy(copy_sizes[nn]);
+    }
+    for (nn = 0; nn < ARRAY_SIZE(dot_sizes); nn++) {
+        bench_dot(dot_sizes[nn]);
+    }
+    for (nn = 0; nn < ARRAY_SIZE(yuv_sizes); nn++) {
+        bench_yuv(yuv_sizes[nn][0], yuv_sizes[nn][1]);
+    }
+    for (nn = 0; nn < ARRAY_SIZE(fixed_sizes); nn++) {
+        bench_fixed(fixed_sizes[nn]);
+    }
+
+    return (*env)->NewStringUTF(env, s_report);
 }
@@ -12,6 +12,7 @@
 # include "wx/wx.h"
 #endif
 #include "wx/image.h"
+#include "wx/stopwatch.h"
 
 #include "DeviceManager.h"
 #include "MyApp.h"
@@ -41,7 +42,7 @@
  */
 DeviceManager::DeviceManager(void)
     : mThread(NULL), mDisplay(NULL), mNumDisplays(0), mKeyMap(NULL),
-      mpStatusWindow(NULL)
+      mpStatusWindow(NULL), mNumPendingTouch(0), mLastTouchSend(0)
 {
     //printf("--- DeviceManager constructor\n");
 }
@@ -299,19 +300,85 @@ void DeviceManager::SendKeyEvent(int32_t keyCode, bool down)
  *
  * "mode" can be "down" (we're pressing), "up" (we're lifting our finger
  * off) or "drag".
+ *
+ * The mouse can report motion much faster than the device redraws, so
+ * drags are held and sent in batches, at most one per frame.  Every
+ * point is kept, so the runtime still sees the whole path.  Downs and
+ * ups go out right away, behind any drags that were held.
+ *
+ * Returns 0, or the number of msec until the caller should call
+ * FlushTouchEvents() to send the held drags.
+ */
+int DeviceManager::SendTouchEvent(android::Simulator::TouchMode mode,
+    int x, int y)
+{
+    //printf("Sim: sending touch-%d x=%d y=%d\n", (int) mode, x, y);
+
+    if (mode != android::Simulator::kTouchDrag) {
+        SendTouchMessages(mode, x, y);
+        return 0;
+    }
+
+    if (mNumPendingTouch == kMaxPendingTouch)
+        FlushTouchEvents();
+    mPendingTouch[mNumPendingTouch].x = x;
+    mPendingTouch[mNumPendingTouch].y = y;
+    mNumPendingTouch++;
+
+    int refresh = 60;
+    if (mNumDisplays > 0 && mDisplay[0].GetRefresh() > 0)
+        refresh = mDisplay[0].GetRefresh();
+    long frameMsec = 1000 / refresh;
+    long elapsed = (wxGetLocalTimeMillis() - mLastTouchSend).ToLong();
+
+    if (elapsed < 0 || elapsed >= frameMsec) {
+        FlushTouchEvents();
+        return 0;
+    }
+    return frameMsec - elapsed;
+}
+
+/*
+ * Send any touch-screen drags we're holding.
+ */
+void DeviceManager::FlushTouchEvents(void)
+{
+    SendTouchMessages(android::Simulator::kTouchDrag, 0, 0);
+}
+
+/*
+ * Send the held drags, followed by a "mode" event unless that's a drag,
+ * all in one write.
  */
-void DeviceManager::SendTouchEvent(android::Simulator::TouchMode mode,
+void DeviceManager::SendTouchMessages(android::Simulator::TouchMode mode,
     int x, int y)
 {
+    android::Message msgs[kMaxPendingTouch + 1];
+    const android::Message* pMsgs[kMaxPendingTouch + 1];
+    int count = 0;
+
+    for (int i = 0; i < mNumPendingTouch; i++) {
+        msgs[count].setCommandExt(android::Simulator::kCommandTouch,
+            android::Simulator::kTouchDrag,
+            mPendingTouch[i].x, mPendingTouch[i].y);
+        pMsgs[count] = &msgs[count];
+        count++;
+    }
+    mNumPendingTouch = 0;
+
+    if (mode != android::Simulator::kTouchDrag) {
+        msgs[count].setCommandExt(android::Simulator::kCommandTouch,
+            mode, x, y);
+        pMsgs[count] = &msgs[count];
+        count++;
+    }
+
     android::MessageStream* pStream = GetStream();
-    if (pStream == NULL)
+    if (pStream == NULL || count == 0)
         return;
 
-    //printf("Sim: sending touch-%d x=%d y=%d\n", (int) mode, x, y);
-
-    android::Message msg;
-    msg.setCommandExt(android::Simulator::kCommandTouch, mode, x, y);
-    pStream->send(&msg);
+    mLastTouchSend = wxGetLocalTimeMillis();
+    pStream->sendv(pMsgs, count);
 }
 
 /*
@@ -320,24 +387,23 @@ void DeviceManager::SendTouchEvent(android::Simulator::TouchMode mode,
  * NOTE: we're still in the runtime management thread.  We have to pass the
  * bitmap through AddPendingEvent to get it over to the main thread.
  *
- * We have to make a copy of the data from the runtime; the easiest
- * way to do that is to convert it to a bitmap here.  However, X11 gets
- * all worked up about calls being made from multiple threads, so we're
- * better off just copying it into a buffer.
+ * The frame stays in the shared memory frame ring until the UI thread
+ * gets to it in UpdateBitmap().  X11 gets all worked up about calls being
+ * made from multiple threads, so we can't convert it to a bitmap here.
+ * We just add the rect that changed to what the UI has to convert.
  *
  * Because we're decoupled from the runtime, there is a chance that we
- * could drop frames.  Buffering them up is probably worse, since it
- * creates the possibility that we could stall and run out of memory.
- * We could save a copy by handing the runtime a pointer to our buffer,
- * but then we'd have to mutex the runtime against the simulator window
- * Paint function.
+ * could drop frames: the UI always picks up the latest one, and skips
+ * the ones it was too slow to show.  Buffering them up is probably worse,
+ * since it creates the possibility that we could stall and run out of
+ * memory.
  */
-void DeviceManager::ShowFrame(int displayIndex)
+void DeviceManager::ShowFrame(int displayIndex, int left, int top,
+    int right, int bottom)
 {
     assert(displayIndex >= 0 && displayIndex < mNumDisplays);
 
-    // copy the data to local storage and convert
-    mDisplay[displayIndex].CopyFromShared();
+    mDisplay[displayIndex].AddDirtyRect(left, top, right, bottom);
 
     // create a user event and send it to the window
     UserEvent uev(0, (void*) displayIndex);
@@ -357,12 +423,13 @@ void DeviceManager::Vibrate(int vibrateOn)
 }
 
 /*
- * Get the display data from the specified display.
+ * Update the bitmap of the specified display.
  */
-wxBitmap* DeviceManager::GetImageData(int displayIndex)
+bool DeviceManager::UpdateBitmap(int displayIndex, wxBitmap* pBitmap,
+    wxRect* pChanged)
 {
     assert(displayIndex >= 0 && displayIndex < mNumDisplays);
-    return mDisplay[displayIndex].GetImageData();
+    return mDisplay[displayIndex].UpdateBitmap(pBitmap, pChanged);
 }
 
 /*
@@ -394,7 +461,7 @@ bool DeviceManager::Display::Create(int displayNum, wxWindow* window,
     //printf("DeviceManager::Display constructor\n");
 
     assert(window != NULL);
-    if (mImageData != NULL) {
+    if (mpShmem != NULL) {
         assert(false);              // no re-init
         return false;
     }
@@ -408,16 +475,26 @@ bool DeviceManager::Display::Create(int displayNum, wxWindow* window,
 
     // use a fixed key for now
     mShmemKey = GenerateKey(displayNum);
-    // allocate 24bpp for now
+    // allocate a ring of 24bpp frames for now
+    long frameSize = width * height * 3;
     mpShmem = new android::Shmem;
-    if (!mpShmem->create(mShmemKey, width * height * 3, true))
+    if (!mpShmem->create(mShmemKey, android::Simulator::kFrameRingHeaderSize +
+            android::Simulator::kFrameSlots * frameSize, true))
         return false;
     //printf("--- CREATED shmem, key=0x%08x addr=%p\n",
     //    mShmemKey, mpShmem->getAddr());
 
-    mImageData = new unsigned char[width * height * 3];
-    if (mImageData == NULL)
-        return false;
+    /* the runtime draws into slot 0 first, we start out showing slot 2 */
+    android::Simulator::FrameRing* ring =
+        (android::Simulator::FrameRing*) mpShmem->getAddr();
+    ring->magic = android::Simulator::kFrameRingMagic;
+    ring->numSlots = android::Simulator::kFrameSlots;
+    ring->slotSize = frameSize;
+    ring->state = FRAME_RING_STATE(0, 2, 1);
+    mLastSeq = 0;
+    mDirtyLeft = mDirtyTop = 0;
+    mDirtyRight = width;
+    mDirtyBottom = height;
 
     return true;
 }
@@ -439,7 +516,7 @@ void DeviceManager::Display::Uncreate(void)
 
     mDisplayWindow = NULL;
 
-    // the "locker" mutex keeps this from hosing CopyFromShared()
+    // the "locker" mutex keeps this from hosing UpdateBitmap()
     if (mpShmem != NULL) {
         //printf("--- DELETING shmem, addr=%p\n", mpShmem->getAddr());
         delete mpShmem;
@@ -448,48 +525,110 @@ void DeviceManager::Display::Uncreate(void)
 }
 
 /*
- * Make a local copy of the image data.  The UI grabs this data from a
- * different thread, so we have to mutex it.
+ * Add a rect the runtime redrew to what the UI thread has to convert.
+ * The rect may be for a frame the UI has already picked up, or for one
+ * it will skip; either way the shown frame has the new pixels by the
+ * time UpdateBitmap() converts it, so unioning the rects is enough.
  */
-void DeviceManager::Display::CopyFromShared(void)
+void DeviceManager::Display::AddDirtyRect(int left, int top, int right,
+    int bottom)
 {
     wxMutexLocker locker(mImageDataLock);
 
-    if (mpShmem == NULL) {
-        //printf("Sim: SKIP CopyFromShared\n");
+    if (left < 0)           left = 0;
+    if (top < 0)            top = 0;
+    if (right > mWidth)     right = mWidth;
+    if (bottom > mHeight)   bottom = mHeight;
+    if (left >= right || top >= bottom)
         return;
-    }
 
-    //printf("Display %d: copying data from %p to %p\n",
-    //    mDisplayNum, mpShmem->getAddr(), mImageData);
-
-    /* data is always 24bpp RGB */
-    mpShmem->lock();        // avoid tearing
-    memcpy(mImageData, mpShmem->getAddr(), mWidth * mHeight * 3);
-    mpShmem->unlock();
+    if (mDirtyLeft >= mDirtyRight || mDirtyTop >= mDirtyBottom) {
+        mDirtyLeft = left;
+        mDirtyTop = top;
+        mDirtyRight = right;
+        mDirtyBottom = bottom;
+        return;
+    }
+    if (left < mDirtyLeft)      mDirtyLeft = left;
+    if (top < mDirtyTop)        mDirtyTop = top;
+    if (right > mDirtyRight)    mDirtyRight = right;
+    if (bottom > mDirtyBottom)  mDirtyBottom = bottom;
 }
 
 /*
- * Get the image data in the form of a newly-allocated bitmap.
+ * Bring the caller's bitmap up to date with the latest frame, converting
+ * only the rows that changed since the last call.
+ *
+ * We take the latest frame published by the runtime, handing it back the
+ * one we were showing.  The runtime never touches the frame we're
+ * showing, so there is no need to lock it out.  The bitmap is recreated
+ * (and converted in full) if it isn't the size of the display.
+ *
+ * The 24bpp frame rows are contiguous, so the band of changed rows is
+ * wrapped in a wxImage without copying, converted, and blitted into the
+ * bitmap.  "pChanged" gets the rect the window needs to repaint.
+ *
+ * When the runtime gets ahead of the UI, several update events can be
+ * queued for the same frame; only the first one has anything to do, so
+ * this returns false if nothing changed since the last call.
  *
  * This MUST be called from the UI thread.  Creating wxBitmaps in the
  * runtime management thread will cause X11 failures (e.g.
  * "Xlib: unexpected async reply").
  */
-wxBitmap* DeviceManager::Display::GetImageData(void)
+bool DeviceManager::Display::UpdateBitmap(wxBitmap* pBitmap,
+    wxRect* pChanged)
 {
     wxMutexLocker locker(mImageDataLock);
 
-    assert(mImageData != NULL);
+    if (mpShmem == NULL)
+        return false;
+
+    if (!pBitmap->IsOk() || pBitmap->GetWidth() != mWidth ||
+        pBitmap->GetHeight() != mHeight)
+    {
+        pBitmap->Create(mWidth, mHeight, 24);
+        mDirtyLeft = mDirtyTop = 0;
+        mDirtyRight = mWidth;
+        mDirtyBottom = mHeight;
+    }
+
+    android::Simulator::FrameRing* ring =
+        (android::Simulator::FrameRing*) mpShmem->getAddr();
+    unsigned int state, newState;
+    do {
+        state = ring->state;
+        if (FRAME_RING_SEQ(state) == mLastSeq) {
+            /* no new frame, but a late rect may still be pending */
+            newState = state;
+            break;
+        }
+        newState = FRAME_RING_STATE(FRAME_RING_SEQ(state),
+            FRAME_RING_LATEST(state), FRAME_RING_SHOWN(state));
+    } while (__sync_val_compare_and_swap(&ring->state, state, newState)
+            != state);
+    mLastSeq = FRAME_RING_SEQ(newState);
+
+    if (mDirtyLeft >= mDirtyRight || mDirtyTop >= mDirtyBottom)
+        return false;
+
+    unsigned char* frame = (unsigned char*) ring +
+        android::Simulator::kFrameRingHeaderSize +
+        FRAME_RING_SHOWN(newState) * ring->slotSize;
+    int rows = mDirtyBottom - mDirtyTop;
 
-    //printf("HEY: creating tmpImage, w=%d h=%d data=%p\n",
-    //    mWidth, mHeight, mImageData);
+    /* a temporary wxImage of the changed rows; it does not own the data */
+    wxImage band(mWidth, rows, frame + mDirtyTop * mWidth * 3, true);
+    wxBitmap bandBitmap(band);
 
-    /* create a temporary wxImage; it does not own the data */
-    wxImage tmpImage(mWidth, mHeight, (unsigned char*) mImageData, true);
+    wxMemoryDC memDC;
+    memDC.SelectObject(*pBitmap);
+    memDC.DrawBitmap(bandBitmap, 0, mDirtyTop, false);
+    memDC.SelectObject(wxNullBitmap);
 
-    /* return a new bitmap with the converted-for-display data */
-    return new wxBitmap(tmpImage);
+    *pChanged = wxRect(mDirtyLeft, mDirtyTop, mDirtyRight - mDirtyLeft, rows);
+    mDirtyLeft = mDirtyTop = mDirtyRight = mDirtyBottom = 0;
+    return true;
 }
 
 
@@ -865,6 +1004,7 @@ void* DeviceManager::DeviceThread::Entry(void)
 {
     //android::MessageStream stream;
     android::Message msg;
+    android::Message pgroupMsg, displayMsg, keymapMsg, doneMsg;
     wxString errMsg;
     char statusBuf[64] = "(no status)";
     int result = 1;
@@ -904,9 +1044,10 @@ void* DeviceManager::DeviceThread::Entry(void)
      * Tell the runtime to put itself into a new process group and set
      * itself up as the foreground process.  The latter is only really
      * necessary to make valgrind+gdb work.
+     *
+     * The configuration goes out as one write, see below.
      */
-    msg.setCommand(android::Simulator::kCommandNewPGroup, true);
-    mStream.send(&msg);
+    pgroupMsg.setCommand(android::Simulator::kCommandNewPGroup, true);
 
     printf("Sim: Sending hardware configuration\n");
 
@@ -930,9 +1071,8 @@ void* DeviceManager::DeviceThread::Entry(void)
         pBuf[3] = pDisplay->GetRefresh();
         pBuf[4] = pDisplay->GetShmemKey();
     }
-    msg.setRaw((const unsigned char*)buf, sizeof(buf),
+    displayMsg.setRaw((const unsigned char*)buf, sizeof(buf),
         android::Message::kCleanupNoDelete);
-    mStream.send(&msg);
 
     /*
      * Send other hardware config.
@@ -944,14 +1084,17 @@ void* DeviceManager::DeviceThread::Entry(void)
      * - Initial mode (e.g. "flipped open" vs. "flipped closed").
      */
 
-    msg.setConfig("keycharmap", mpDeviceManager->GetKeyMap());
-    mStream.send(&msg);
+    keymapMsg.setConfig("keycharmap", mpDeviceManager->GetKeyMap());
 
     /*
      * Done with config.
      */
-    msg.setCommand(android::Simulator::kCommandConfigDone, 0);
-    mStream.send(&msg);
+    doneMsg.setCommand(android::Simulator::kCommandConfigDone, 0);
+
+    const android::Message* configMsgs[] = {
+        &pgroupMsg, &displayMsg, &keymapMsg, &doneMsg
+    };
+    mStream.sendv(configMsgs, sizeof(configMsgs) / sizeof(configMsgs[0]));
 
     /*
      * Sit forever, waiting for messages from the runtime process.
@@ -985,7 +1128,7 @@ void* DeviceManager::DeviceThread::Entry(void)
                 case android::Simulator::kCommandUpdateDisplay:
                     // new frame of graphics is ready
                     //printf("RCVD display update %d\n", arg);
-                    mpDeviceManager->ShowFrame(arg);
+                    mpDeviceManager->ShowFrame(arg, 0, 0, 0xffff, 0xffff);
                     break;
                 case android::Simulator::kCommandVibrate:
                     // vibrator on or off
@@ -997,13 +1140,37 @@ void* DeviceManager::DeviceThread::Entry(void)
                     break;
                 }
             }
-        } else if (msg.getType() == android::Message::kTypeLogBundle) {
-            android_LogBundle bundle;
+        } else if (msg.getType() == android::Message::kTypeCommandExt) {
+            int cmd, arg0, arg1, arg2;
 
-            if (!msg.getLogBundle(&bundle)) {
-                fprintf(stderr, "Sim: Warning: failed unpacking logBundle\n");
+            if (!msg.getCommandExt(&cmd, &arg0, &arg1, &arg2)) {
+                fprintf(stderr, "Sim: Warning: failed unpacking ext command\n");
                 /* keep going? */
             } else {
+                switch (cmd) {
+                case android::Simulator::kCommandUpdateDisplay:
+                    // new frame, the rect in arg1/arg2 changed; the
+                    // runtime already redrew it in the frame ring
+                    mpDeviceManager->ShowFrame(arg0,
+                        arg1 & 0xffff, (arg1 >> 16) & 0xffff,
+                        arg2 & 0xffff, (arg2 >> 16) & 0xffff);
+                    break;
+                default:
+                    printf("Sim: got unknown ext command %d\n", cmd);
+                    break;
+                }
+            }
+        } else if (msg.getType() == android::Message::kTypeLogBundle) {
+            android_LogBundle bundle;
+            int offset = 0;
+
+            /* the runtime batches log messages */
+            while (offset < msg.getLength()) {
+                if (!msg.getLogBundle(&bundle, &offset)) {
+                    fprintf(stderr,
+                        "Sim: Warning: failed unpacking logBundle\n");
+                    break;
+                }
                 LogWindow::PostLogMsg(&bundle);
             }
         } else {
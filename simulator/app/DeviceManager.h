@@ -108,10 +108,15 @@ public:
 
     // send a key-up or key-down event to the runtime
     void SendKeyEvent(int32_t keyCode, bool down);
-    // send touch-screen events
-    void SendTouchEvent(android::Simulator::TouchMode mode, int x, int y);
-
-    wxBitmap* GetImageData(int displayIndex);
+    // send touch-screen events; drags may be held for up to a frame, in
+    // which case this returns the number of msec until FlushTouchEvents()
+    // should be called
+    int SendTouchEvent(android::Simulator::TouchMode mode, int x, int y);
+    // send any held touch-screen drags
+    void FlushTouchEvents(void);
+
+    // bring the display bitmap up to date; see Display::UpdateBitmap
+    bool UpdateBitmap(int displayIndex, wxBitmap* pBitmap, wxRect* pChanged);
     
     void BroadcastEvent(UserEvent &userEvent);
 
@@ -190,12 +195,12 @@ private:
     public:
         Display(void)
             : mDisplayWindow(NULL), mpShmem(NULL), mShmemKey(0),
-              mImageData(NULL), mDisplayNum(-1), mWidth(-1), mHeight(-1),
+              mLastSeq(0), mDirtyLeft(0), mDirtyTop(0), mDirtyRight(0),
+              mDirtyBottom(0), mDisplayNum(-1), mWidth(-1), mHeight(-1),
               mFormat(android::PIXEL_FORMAT_UNKNOWN), mRefresh(0)
             {}
         ~Display() {
             delete mpShmem;
-            delete[] mImageData;
         }
 
         /* initialize goodies */
@@ -205,11 +210,11 @@ private:
         /* call this if we're shutting down soon */
         void Uncreate(void);
 
-        /* copy & convert data from shared memory */
-        void CopyFromShared(void);
+        /* note that a rect of the frame changed; runtime mgr thread */
+        void AddDirtyRect(int left, int top, int right, int bottom);
 
-        /* get image data in the form of a 24bpp bitmap */
-        wxBitmap* GetImageData(void);
+        /* convert what changed into the caller's bitmap; UI thread */
+        bool UpdateBitmap(wxBitmap* pBitmap, wxRect* pChanged);
 
         /* get a pointer to our display window */
         wxWindow* GetWindow(void) const { return mDisplayWindow; }
@@ -227,7 +232,7 @@ private:
             return 0x41544d00 | displayNum;
         }
 
-        // control access to image data shared between runtime mgr and UI
+        // keeps the runtime mgr from deleting mpShmem under the UI
         wxMutex         mImageDataLock;
         // we send an event here when we get stuff to display
         wxWindow*       mDisplayWindow;
@@ -236,8 +241,14 @@ private:
         android::Shmem* mpShmem;
         int             mShmemKey;
 
-        // local copy of data from shared mem, converted to 24bpp
-        unsigned char*  mImageData;
+        // sequence number of the frame we're showing
+        unsigned int    mLastSeq;
+
+        // what changed since the last UpdateBitmap; right/bottom exclusive
+        int             mDirtyLeft;
+        int             mDirtyTop;
+        int             mDirtyRight;
+        int             mDirtyBottom;
 
         // mainly for debugging -- which display are we?
         int             mDisplayNum;
@@ -253,7 +264,8 @@ private:
 
     const char* GetKeyMap() { return mKeyMap ? mKeyMap : "qwerty"; }
 
-    void ShowFrame(int displayIndex);
+    void ShowFrame(int displayIndex, int left, int top, int right,
+        int bottom);
 
     void Vibrate(int vibrateOn);
 
@@ -263,6 +275,9 @@ private:
     // send a request to set the visible layers
     void SendSetVisibleLayers(void);
 
+    // send held drags, and the given event if "mode" isn't kTouchDrag
+    void SendTouchMessages(android::Simulator::TouchMode mode, int x, int y);
+
     // points at the runtime's thread (while it's running)
     DeviceThread*   mThread;
 
@@ -279,6 +294,12 @@ private:
     // where to send status messages
     wxWindow*       mpStatusWindow;
 
+    // touch-screen drags held back so we send at most one batch per frame
+    enum { kMaxPendingTouch = 32 };
+    struct { int x, y; } mPendingTouch[kMaxPendingTouch];
+    int             mNumPendingTouch;
+    wxLongLong      mLastTouchSend;     // msec
+
 };
 
 #endif // _SIM_DEVICE_MANAGER_H
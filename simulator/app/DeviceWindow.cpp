@@ -46,15 +46,14 @@ END_EVENT_TABLE()
 DeviceWindow::DeviceWindow(wxWindow* parent, DeviceManager* pDM)
     : wxWindow(parent, wxID_ANY, wxDefaultPosition, wxDefaultSize,
         wxNO_BORDER | wxWANTS_CHARS),
-      mpDeviceManager(pDM)
+      mpDeviceManager(pDM), mHasOnionSkinBitmap(false),
+      mOnionSkinLoaded(false)
 {
     //printf("DW: created (parent=%p DM=%p)\n", parent, pDM);
 
     SetBackgroundStyle(wxBG_STYLE_CUSTOM);
 
-    // create a trivial bitmap so we have something allocated
-    mBitmap.Create(1, 1);
-
+    // mBitmap is created at the display size by the first frame
 }
 
 /*
@@ -134,63 +133,72 @@ void DeviceWindow::ClampMouse(wxMouseEvent* pEvent)
 
 /*
  * Handle a "user event".  We get these when the runtime wants us to
- * know that it has a new frame of graphics to display.
- * 
+ * know that it has a new frame of graphics to display, or with a
+ * displayIndex of -1 when the onion skin prefs have changed.
  */
 void DeviceWindow::OnUserEvent(UserEvent& event)
 {
-    wxBitmap* pBitmap;
     long displayIndex;
 
     displayIndex = (long) event.GetData();
 
     //printf("GOT UAE %d\n", displayIndex);
 
-    // a displayIndex of -1 means just update the onion skin
+    if (displayIndex == -1 || !mOnionSkinLoaded) {
+        LoadOnionSkin();
+        if (displayIndex == -1) {
+            Refresh();
+            return;
+        }
+    }
+
     if (displayIndex >= 0) {
-        /* get a newly-allocated bitmap with converted image data */
-        pBitmap = mpDeviceManager->GetImageData(displayIndex);
-    
-        /* do a ptr/refcount assignment to hold the data */
-        mBitmap = *pBitmap;
-        /* delete the temporary object; does not delete the bitmap storage */
-        delete pBitmap;
+        /* convert what changed into our bitmap */
+        wxRect changed;
+        if (!mpDeviceManager->UpdateBitmap(displayIndex, &mBitmap, &changed))
+            return;     // an earlier event already picked up this frame
+
+        /* induce an update of just that part */
+        RefreshRect(changed, false);
     }
-    
-    if (displayIndex >= -1) {
-        mHasOnionSkinBitmap = false;
-        
-        Preferences* pPrefs = ((MyApp*)wxTheApp)->GetPrefs();
-        assert(pPrefs != NULL);
-    
-        bool overlayOnionSkin;
-        char* onionSkinFileName = NULL;
-        
-        bool overlayOnionSkinExists = pPrefs->GetBool("overlay-onion-skin", &overlayOnionSkin);
-        if (overlayOnionSkinExists && overlayOnionSkin) {
-            bool fileNameExists = pPrefs->GetString("onion-skin-file-name", &onionSkinFileName);
-            if (fileNameExists && *onionSkinFileName) {
-                wxImage onionSkinImage(wxString::FromAscii(onionSkinFileName));
-                onionSkinImage.SetAlpha(NULL);
-                bool hasAlpha = onionSkinImage.HasAlpha();
-                int width = onionSkinImage.GetWidth();
-                int height = onionSkinImage.GetHeight();
-                if (hasAlpha) {
-                    unsigned char *alpha = onionSkinImage.GetAlpha();
-                    int alphaVal = 127;
-                    pPrefs->GetInt("onion-skin-alpha-value", &alphaVal);
-                    for (int i = (width * height) - 1; i >= 0; i--) {
-                        alpha[i] = alphaVal;
-                    } 
+}
+
+/*
+ * (Re-)load the onion skin image, as set in the preferences.  This is
+ * only done when the prefs change, not for every frame.
+ */
+void DeviceWindow::LoadOnionSkin(void)
+{
+    mOnionSkinLoaded = true;
+    mHasOnionSkinBitmap = false;
+
+    Preferences* pPrefs = ((MyApp*)wxTheApp)->GetPrefs();
+    assert(pPrefs != NULL);
+
+    bool overlayOnionSkin;
+    char* onionSkinFileName = NULL;
+
+    bool overlayOnionSkinExists = pPrefs->GetBool("overlay-onion-skin", &overlayOnionSkin);
+    if (overlayOnionSkinExists && overlayOnionSkin) {
+        bool fileNameExists = pPrefs->GetString("onion-skin-file-name", &onionSkinFileName);
+        if (fileNameExists && *onionSkinFileName) {
+            wxImage onionSkinImage(wxString::FromAscii(onionSkinFileName));
+            onionSkinImage.SetAlpha(NULL);
+            bool hasAlpha = onionSkinImage.HasAlpha();
+            int width = onionSkinImage.GetWidth();
+            int height = onionSkinImage.GetHeight();
+            if (hasAlpha) {
+                unsigned char *alpha = onionSkinImage.GetAlpha();
+                int alphaVal = 127;
+                pPrefs->GetInt("onion-skin-alpha-value", &alphaVal);
+                for (int i = (width * height) - 1; i >= 0; i--) {
+                    alpha[i] = alphaVal;
                 }
-                mOnionSkinBitmap = wxBitmap(onionSkinImage);
-                mHasOnionSkinBitmap = true;
             }
+            mOnionSkinBitmap = wxBitmap(onionSkinImage);
+            mHasOnionSkinBitmap = true;
         }
     }
-
-    /* induce an update */
-    Refresh();
 }
 
 /*
@@ -207,16 +215,8 @@ void DeviceWindow::OnSize(wxSizeEvent& WXUNUSED(event))
     GetClientSize(&width, &height);
     printf("Sim: device window resize: %dx%d\n", width, height);
 
-    mBitmap.Create(width, height);
-
-    wxMemoryDC memDC;
-    memDC.SelectObject(mBitmap);
-
-    wxColour backColor(96, 122, 121);
-    memDC.SetBrush(wxBrush(backColor));
-    memDC.SetPen(wxPen(backColor, 1));
-    wxRect windowRect(wxPoint(0, 0), GetClientSize());
-    memDC.DrawRectangle(windowRect);
+    /* the bitmap stays the size of the display; OnPaint fills the rest */
+    Refresh();
 }
 
 /*
@@ -229,13 +229,41 @@ void DeviceWindow::OnErase(wxEraseEvent& WXUNUSED(event))
 
 /*
  * Repaint the simulator output.
+ *
+ * Only the damaged part of the display bitmap is blitted, straight from
+ * a memory DC; new frames only damage the rect that changed.
  */
 void DeviceWindow::OnPaint(wxPaintEvent& WXUNUSED(event))
 {
     wxPaintDC dc(this);
+    wxRect damage = GetUpdateRegion().GetBox();
+
+    /* draw the display */
+    wxRect bitmapRect(0, 0, 0, 0);
+    if (mBitmap.IsOk())
+        bitmapRect = wxRect(0, 0, mBitmap.GetWidth(), mBitmap.GetHeight());
+    wxRect blitRect = damage;
+    blitRect.Intersect(bitmapRect);
+    if (!blitRect.IsEmpty()) {
+        wxMemoryDC memDC;
+        memDC.SelectObject(mBitmap);
+        dc.Blit(blitRect.x, blitRect.y, blitRect.width, blitRect.height,
+            &memDC, blitRect.x, blitRect.y);
+        memDC.SelectObject(wxNullBitmap);
+    }
 
-    /* draw background image */
-    dc.DrawBitmap(mBitmap, 0, 0, TRUE);
+    /* fill whatever the display doesn't cover */
+    if (blitRect != damage) {
+        wxColour backColor(96, 122, 121);
+        dc.SetBrush(wxBrush(backColor));
+        dc.SetPen(wxPen(backColor, 1));
+        wxRegion background(damage);
+        if (!blitRect.IsEmpty())
+            background.Subtract(blitRect);
+        wxRegionIterator iter(background);
+        for ( ; iter; iter++)
+            dc.DrawRectangle(iter.GetRect());
+    }
 
     /* If necessary, draw onion skin image on top */
     if (mHasOnionSkinBitmap) {
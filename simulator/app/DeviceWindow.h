@@ -58,11 +58,14 @@ private:
     void OnUserEvent(UserEvent& event);
 
     void ClampMouse(wxMouseEvent* pEvent);
+    void LoadOnionSkin(void);
 
     DeviceManager*  mpDeviceManager;
+    // display-sized, updated in place as frames come in
     wxBitmap    mBitmap;
     wxBitmap	mOnionSkinBitmap;
     bool        mHasOnionSkinBitmap;
+    bool        mOnionSkinLoaded;
 
     DECLARE_EVENT_TABLE()
 };
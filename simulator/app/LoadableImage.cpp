@@ -18,8 +18,11 @@
 #include "MyApp.h"
 
 #include "utils.h"
+#include <utils/KeyedVector.h>
+#include <utils/String8.h>
 
 #include <stdio.h>
+#include <string.h>
 
 
 /*
@@ -42,54 +45,140 @@ bool LoadableImage::Create(const char* fileName, int x, int y)
 }
 
 /*
- * Load the bitmap.
+ * Decoded bitmaps, keyed by asset name.  wxBitmap is reference-counted,
+ * so images that share an asset also share the pixels.  Allocated on
+ * first use and freed by FlushCache(), because wx has to be up when the
+ * bitmaps are destroyed.
+ */
+typedef android::KeyedVector<android::String8, wxBitmap> BitmapCache;
+static BitmapCache* gpBitmapCache = NULL;
+
+/*
+ * Open the named image asset.
+ */
+static android::Asset* openImageAsset(const char* name,
+    android::Asset::AccessMode mode)
+{
+    android::AssetManager* pAssetMgr = ((MyApp*)wxTheApp)->GetAssetManager();
+    android::Asset* pAsset;
+
+    pAsset = pAssetMgr->open(name, mode);
+    if (pAsset == NULL)
+        fprintf(stderr, "ERROR: unable to load '%s'\n", name);
+    return pAsset;
+}
+
+/*
+ * Get the image size without decoding the pixels.
  */
 bool LoadableImage::LoadResources(void)
 {
     if (mName == NULL)
         return false;
 
-    if (mpBitmap != NULL)       // already loaded?
+    if (mpBitmap != NULL || mWidth > 0)     // already loaded?
         return true;
 
-    //printf("LoadResources: '%s'\n", (const char*) mName);
+    if (ReadSize())
+        return true;
+
+    /* not a PNG, or we couldn't make sense of it; decode it now */
+    return DecodeBitmap();
+}
+
+/*
+ * Pull the image dimensions out of a PNG header.  The IHDR chunk is
+ * required to come first, so the size is at a fixed offset.
+ */
+bool LoadableImage::ReadSize(void)
+{
 #ifdef BEFORE_ASSET
-    wxImage img(mName);
+    return false;
 #else
-    android::AssetManager* pAssetMgr = ((MyApp*)wxTheApp)->GetAssetManager();
+    static const unsigned char kPngSig[8] =
+        { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    unsigned char hdr[24];
     android::Asset* pAsset;
+    ssize_t actual;
+
+    pAsset = openImageAsset(mName, android::Asset::ACCESS_STREAMING);
+    if (pAsset == NULL)
+        return false;
+    actual = pAsset->read(hdr, sizeof(hdr));
+    delete pAsset;
+
+    if (actual != (ssize_t) sizeof(hdr) ||
+        memcmp(hdr, kPngSig, sizeof(kPngSig)) != 0 ||
+        memcmp(hdr + 12, "IHDR", 4) != 0)
+    {
+        return false;
+    }
+
+    int width = (hdr[16] << 24) | (hdr[17] << 16) | (hdr[18] << 8) | hdr[19];
+    int height = (hdr[20] << 24) | (hdr[21] << 16) | (hdr[22] << 8) | hdr[23];
+    if (width <= 0 || height <= 0)
+        return false;
+
+    mWidth = width;
+    mHeight = height;
+    return true;
+#endif
+}
 
-    pAsset = pAssetMgr->open(mName, android::Asset::ACCESS_RANDOM);
-    if (pAsset == NULL) {
-        fprintf(stderr, "ERROR: unable to load '%s'\n", mName);
+/*
+ * Decode the bitmap, or find it in the cache.
+ */
+bool LoadableImage::DecodeBitmap(void) const
+{
+    if (mName == NULL)
         return false;
-    } else {
-        //printf("--- opened asset '%s'\n",
-        //    (const char*) pAsset->getAssetSource());
+
+    if (mpBitmap != NULL)       // already decoded?
+        return true;
+
+    if (gpBitmapCache == NULL)
+        gpBitmapCache = new BitmapCache;
+
+    android::String8 key(mName);
+    ssize_t idx = gpBitmapCache->indexOfKey(key);
+    if (idx >= 0) {
+        mpBitmap = new wxBitmap(gpBitmapCache->valueAt(idx));
+        mWidth = mpBitmap->GetWidth();
+        mHeight = mpBitmap->GetHeight();
+        return true;
     }
+
+    //printf("DecodeBitmap: '%s'\n", (const char*) mName);
+#ifdef BEFORE_ASSET
+    wxImage img(mName);
+#else
+    android::Asset* pAsset;
+
+    pAsset = openImageAsset(mName, android::Asset::ACCESS_RANDOM);
+    if (pAsset == NULL)
+        return false;
     AssetStream astr(pAsset);
 
     wxImage img(astr);
 #endif
 
-    mWidth = img.GetWidth();
-    mHeight = img.GetHeight();
-    if (mWidth <= 0 || mHeight <= 0) {
+    if (img.GetWidth() <= 0 || img.GetHeight() <= 0) {
         /* image failed to load or decode */
         fprintf(stderr, "ERROR: unable to load/decode '%s'\n", mName);
-        //delete img;
         return false;
     }
+    mWidth = img.GetWidth();
+    mHeight = img.GetHeight();
 
     mpBitmap = new wxBitmap(img);
-
-    //delete img;
+    gpBitmapCache->add(key, *mpBitmap);
 
     return true;
 }
 
 /*
- * Unload the bitmap.
+ * Unload the bitmap.  The cache keeps its reference, so reloading it
+ * doesn't mean decoding it again.
  */
 bool LoadableImage::UnloadResources(void)
 {
@@ -98,3 +187,11 @@ bool LoadableImage::UnloadResources(void)
     return true;
 }
 
+/*
+ * Throw away all cached bitmaps.
+ */
+/*static*/ void LoadableImage::FlushCache(void)
+{
+    delete gpBitmapCache;
+    gpBitmapCache = NULL;
+}
@@ -11,6 +11,11 @@
 /*
  * Holds an image that may or may not be loaded at present.  The image
  * has an (x,y) offset.
+ *
+ * "Loading" only establishes the image size, which for PNG files is read
+ * from the header.  The pixels aren't decoded until somebody asks for the
+ * bitmap, so views and modes that are never shown cost nothing.  Decoded
+ * bitmaps are shared through a cache keyed by asset name.
  */
 class LoadableImage {
 public:
@@ -53,21 +58,31 @@ public:
     bool LoadResources(void);
     bool UnloadResources(void);
 
+    // discard all cached bitmaps (e.g. when the skins are re-scanned)
+    static void FlushCache(void);
+
     // accessors
     int GetX(void) const { return mX; }
     int GetY(void) const { return mY; }
     int GetWidth(void) const { return mWidth; }
     int GetHeight(void) const { return mHeight; }
-    wxBitmap* GetBitmap(void) const { return mpBitmap; }
+    wxBitmap* GetBitmap(void) const {
+        if (mpBitmap == NULL && mName != NULL)
+            DecodeBitmap();
+        return mpBitmap;
+    }
 
 private:
+    bool ReadSize(void);
+    bool DecodeBitmap(void) const;
+
     char*       mName;
-    wxBitmap*   mpBitmap;
+    mutable wxBitmap* mpBitmap; // decoded on first use
 
     int         mX;         // position relative to phone image
     int         mY;
-    int         mWidth;     // from image (cached values)
-    int         mHeight;
+    mutable int mWidth;     // from image (cached values)
+    mutable int mHeight;
 };
 
 #endif // _SIM_LOADABLE_IMAGE_H
@@ -17,12 +17,10 @@ LogMessage::LogMessage(void)
 }
 
 /*
- * Destructor.
+ * Destructor.  The strings live in our own storage.
  */
 LogMessage::~LogMessage(void)
 {
-    delete[] mTag;
-    delete[] mMsg;
 }
 
 /*
@@ -31,21 +29,25 @@ LogMessage::~LogMessage(void)
  */
 /*static*/ LogMessage* LogMessage::Create(const android_LogBundle* pBundle)
 {
-    LogMessage* newMsg = new LogMessage;
+    assert(pBundle != NULL);
+
+    size_t tagLen = strlen(pBundle->tag);
+    size_t len = 0;
+    size_t i;
+    for (i=0; i<pBundle->msgCount; i++) len += pBundle->msgVec[i].iov_len;
 
+    LogMessage* newMsg = new (tagLen+1 + len+1) LogMessage;
     if (newMsg == NULL)
         return NULL;
-    assert(pBundle != NULL);
 
     newMsg->mWhen = pBundle->when;
     newMsg->mPriority = pBundle->priority;
     newMsg->mPid = pBundle->pid;
-    newMsg->mTag = android::strdupNew(pBundle->tag);
 
-    size_t len = 0;
-    size_t i;
-    for (i=0; i<pBundle->msgCount; i++) len += pBundle->msgVec[i].iov_len;
-    newMsg->mMsg = new char[len+1];
+    newMsg->mTag = (char*) (newMsg + 1);
+    memcpy(newMsg->mTag, pBundle->tag, tagLen+1);
+
+    newMsg->mMsg = newMsg->mTag + tagLen+1;
     char* p = newMsg->mMsg;
     for (i=0; i<pBundle->msgCount; i++) {
         memcpy(p, pBundle->msgVec[i].iov_base, pBundle->msgVec[i].iov_len);
@@ -55,11 +57,7 @@ LogMessage::~LogMessage(void)
 
     newMsg->mRefCnt = 1;
     newMsg->mInternal = false;
-    newMsg->mFootprint = 8 * sizeof(int) + strlen(newMsg->mTag) +
-        strlen(newMsg->mMsg) + 4;
-    newMsg->mTextCtrlLen = 0;
-    newMsg->mpPrev = NULL;
-    newMsg->mpNext = NULL;
+    newMsg->mFootprint = 8 * sizeof(int) + tagLen + len + 4;
 
     return newMsg;
 }
@@ -12,9 +12,9 @@
 /*
  * Hold a single log message.
  *
- * To reduce malloc strain we could over-allocate the object and tuck the
- * message text into the object storage.  On this off chance this becomes
- * important, the implementation keeps its constructor private.
+ * To reduce malloc strain, the tag and message text are tucked into the
+ * object storage, right after the object itself.  That's why the
+ * constructor is private.
  */
 class LogMessage {
 public:
@@ -23,15 +23,7 @@ public:
     static LogMessage* Create(const android_LogBundle* pBundle);
     static LogMessage* Create(const char* msg);
 
-    /* the total length of text added to the text ctrl */
-    int GetTextCtrlLen(void) const { return mTextCtrlLen; }
-    void SetTextCtrlLen(int len) { mTextCtrlLen = len; }
-
     /* log pool */
-    LogMessage* GetPrev(void) const { return mpPrev; }
-    void SetPrev(LogMessage* pPrev) { mpPrev = pPrev; }
-    LogMessage* GetNext(void) const { return mpNext; }
-    void SetNext(LogMessage* pNext) { mpNext = pNext; }
     int GetFootprint(void) const { return mFootprint; }
 
     /* message contents */
@@ -54,6 +46,17 @@ private:
     LogMessage(const LogMessage& src);              // not implemented
     LogMessage& operator=(const LogMessage& src);   // not implemented
 
+    /* allocate "extra" bytes of text storage along with the object */
+    static void* operator new(size_t size, size_t extra) {
+        return ::operator new(size + extra);
+    }
+    static void operator delete(void* ptr, size_t extra) {
+        ::operator delete(ptr);
+    }
+    static void operator delete(void* ptr) {
+        ::operator delete(ptr);
+    }
+
     /* log message contents */
     time_t          mWhen;
     android_LogPriority mPriority;
@@ -65,9 +68,6 @@ private:
     int             mRefCnt;        // reference count
     bool            mInternal;      // message generated internally by us?
     int             mFootprint;     // approx. size of this object in memory
-    int             mTextCtrlLen;   // #of characters req'd in text ctrl
-    LogMessage*     mpPrev;         // link to previous item in log pool
-    LogMessage*     mpNext;         // link to next item in log pool
 };
 
 #endif // _SIM_LOG_MESSAGE_H
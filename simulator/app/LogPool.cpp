@@ -9,24 +9,41 @@
 
 
 /*
- * Add a message at the head of the pool.
+ * Append a message to a ring, growing it if it's full.
+ */
+/*static*/ void LogPool::Push(Ring* pRing, LogMessage* pLogMessage)
+{
+    if (pRing->end - pRing->begin == pRing->capacity) {
+        unsigned int newCapacity = pRing->capacity ? pRing->capacity * 2 : 256;
+        LogMessage** newSlots = new LogMessage*[newCapacity];
+
+        for (unsigned int n = pRing->begin; n != pRing->end; n++) {
+            newSlots[n & (newCapacity - 1)] =
+                pRing->slots[n & (pRing->capacity - 1)];
+        }
+        delete[] pRing->slots;
+        pRing->slots = newSlots;
+        pRing->capacity = newCapacity;
+    }
+
+    pRing->slots[pRing->end & (pRing->capacity - 1)] = pLogMessage;
+    pRing->end++;
+}
+
+/*
+ * Add a message to the pool.
  */
 void LogPool::Add(LogMessage* pLogMessage)
 {
     pLogMessage->Acquire();     // bump up the ref count
 
-    assert(pLogMessage->GetPrev() == NULL);
-    assert(pLogMessage->GetNext() == NULL);
-
-    if (mpHead == NULL) {
-        assert(mpTail == NULL);
-        mpTail = mpHead = pLogMessage;
-    } else {
-        assert(mpHead->GetPrev() == NULL);
-        mpHead->SetPrev(pLogMessage);
-        pLogMessage->SetNext(mpHead);
-        mpHead = pLogMessage;
-    }
+    Push(&mRings[0], pLogMessage);
+    /* messages below VERBOSE don't pass any filter */
+    int level = 0;
+    if (pLogMessage->GetPriority() >= ANDROID_LOG_VERBOSE)
+        level = RingIndex(pLogMessage->GetPriority());
+    for (int i = 1; i <= level; i++)
+        Push(&mRings[i], pLogMessage);
 
     /* update the pool size, and remove old entries if necessary */
     mCurrentSize += pLogMessage->GetFootprint();
@@ -36,35 +53,60 @@ void LogPool::Add(LogMessage* pLogMessage)
 }
 
 /*
- * Remove the oldest message (from the tail of the list).
+ * Remove the oldest message.  It's also the oldest one in every ring
+ * that holds it.
  */
 void LogPool::RemoveOldest(void)
 {
-    LogMessage* pPrev;
+    Ring* pAll = &mRings[0];
 
-    if (mpTail == NULL) {
+    if (pAll->begin == pAll->end) {
         fprintf(stderr, "HEY: nothing left to remove (cur=%ld)\n",
             mCurrentSize);
         assert(false);
         return;
     }
 
-    if (mpTail == mpBookmark)
-        mpBookmark = NULL;
+    LogMessage* pOldest = pAll->slots[pAll->begin & (pAll->capacity - 1)];
+    pAll->begin++;
 
-    //printf("--- removing oldest, size %ld->%ld (%s)\n",
-    //    mCurrentSize, mCurrentSize - mpTail->GetFootprint(),mpTail->GetMsg());
-    mCurrentSize -= mpTail->GetFootprint();
-
-    pPrev = mpTail->GetPrev();
-    mpTail->Release();
-    mpTail = pPrev;
-    if (mpTail == NULL) {
-        //printf("--- pool is now empty (size=%ld)\n", mCurrentSize);
-        mpHead = NULL;
-    } else {
-        mpTail->SetNext(NULL);
+    for (int i = 1; i < kNumRings; i++) {
+        Ring* pRing = &mRings[i];
+        if (pRing->begin != pRing->end &&
+            pRing->slots[pRing->begin & (pRing->capacity - 1)] == pOldest)
+        {
+            pRing->begin++;
+        }
     }
+
+    //printf("--- removing oldest, size %ld->%ld (%s)\n",
+    //    mCurrentSize, mCurrentSize - pOldest->GetFootprint(),
+    //    pOldest->GetMsg());
+    mCurrentSize -= pOldest->GetFootprint();
+    pOldest->Release();
+}
+
+/*
+ * Get message number "num" of those at or above "minPriority".
+ */
+LogMessage* LogPool::GetMessage(android_LogPriority minPriority,
+    unsigned int num) const
+{
+    const Ring* pRing = &mRings[RingIndex(minPriority)];
+
+    /* unsigned math copes with the numbers wrapping around */
+    if (num - pRing->begin >= pRing->end - pRing->begin)
+        return NULL;
+    return pRing->slots[num & (pRing->capacity - 1)];
+}
+
+/*
+ * Remember where every ring ends right now.
+ */
+void LogPool::SetBookmark(void)
+{
+    for (int i = 0; i < kNumRings; i++)
+        mBookmark[i] = mRings[i].end;
 }
 
 /*
@@ -84,7 +126,6 @@ void LogPool::Resize(long maxSize)
  */
 void LogPool::Clear(void)
 {
-    while (mpTail != NULL)
+    while (mRings[0].begin != mRings[0].end)
         RemoveOldest();
 }
-
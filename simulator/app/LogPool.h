@@ -9,23 +9,37 @@
 
 #include "LogMessage.h"
 
+#include <string.h>
+
 /*
  * This contains the pool of log messages.  The messages themselves are
- * allocated individually and reference counted.  We add new messages to
- * the head and, when the total "footprint" exceeds our stated max, we
- * delete one or more from the tail.
+ * allocated individually and reference counted, the pool keeps them in
+ * arrival order in a ring buffer of pointers.  When the total "footprint"
+ * exceeds our stated max, we drop the oldest ones.
+ *
+ * Besides the ring holding everything, there is one ring per priority
+ * level holding only the messages at or above that level, so the window
+ * can find the Nth message passing its filter without scanning.  The
+ * messages of each level are numbered from 0 as they arrive; numbers are
+ * never reused, so a number stays valid (or becomes NULL once the message
+ * is dropped) as messages come and go.
  *
- * To support pause/resume, we allow a "bookmark" to be set.  This is
- * just a pointer to a message in the pool.  If the bookmarked message
- * is deleted, we discard the bookmark.
+ * To support pause/resume, we allow a "bookmark" to be set.  This just
+ * remembers how many messages each level had at the time.
  */
 class LogPool {
 public:
     LogPool(void)
-        : mpHead(NULL), mpTail(NULL), mpBookmark(NULL),
-          mCurrentSize(0), mMaxSize(10240)
-        {}
-    ~LogPool(void) { Clear(); }
+        : mCurrentSize(0), mMaxSize(10240)
+        {
+            memset(mRings, 0, sizeof(mRings));
+            memset(mBookmark, 0, sizeof(mBookmark));
+        }
+    ~LogPool(void) {
+        Clear();
+        for (int i = 0; i < kNumRings; i++)
+            delete[] mRings[i].slots;
+    }
 
     void Clear(void);
 
@@ -38,17 +52,52 @@ public:
     /* return the current limit, in bytes */
     long GetMaxSize(void) const { return mMaxSize; }
 
-    LogMessage* GetHead(void) const { return mpHead; }
+    /*
+     * Messages at or above "minPriority" are numbered from GetBegin() to
+     * GetEnd()-1, oldest first.  GetMessage() returns NULL for numbers
+     * outside that range.
+     */
+    unsigned int GetBegin(android_LogPriority minPriority) const {
+        return mRings[RingIndex(minPriority)].begin;
+    }
+    unsigned int GetEnd(android_LogPriority minPriority) const {
+        return mRings[RingIndex(minPriority)].end;
+    }
+    LogMessage* GetMessage(android_LogPriority minPriority,
+        unsigned int num) const;
 
-    void SetBookmark(void) { mpBookmark = mpHead; }
-    LogMessage* GetBookmark(void) const { return mpBookmark; }
+    void SetBookmark(void);
+    /* value of GetEnd() when SetBookmark() was called */
+    unsigned int GetBookmark(android_LogPriority minPriority) const {
+        return mBookmark[RingIndex(minPriority)];
+    }
 
 private:
+    /* ring 0 holds all messages, ring N those at VERBOSE+N-1 and above */
+    enum {
+        kNumRings = 1 + ANDROID_LOG_FATAL - ANDROID_LOG_VERBOSE + 1,
+    };
+
+    typedef struct Ring {
+        LogMessage**    slots;
+        unsigned int    capacity;       // always a power of 2
+        unsigned int    begin;          // number of the oldest message
+        unsigned int    end;            // number of the next message
+    } Ring;
+
+    static int RingIndex(android_LogPriority priority) {
+        if (priority < ANDROID_LOG_VERBOSE)
+            return 1;
+        if (priority > ANDROID_LOG_FATAL)
+            return kNumRings - 1;
+        return 1 + priority - ANDROID_LOG_VERBOSE;
+    }
+
+    static void Push(Ring* pRing, LogMessage* pLogMessage);
     void RemoveOldest(void);
 
-    LogMessage*     mpHead;
-    LogMessage*     mpTail;
-    LogMessage*     mpBookmark;
+    Ring            mRings[kNumRings];
+    unsigned int    mBookmark[kNumRings];
     long            mCurrentSize;       // current size, in bytes
     long            mMaxSize;           // maximum size, in bytes
 };
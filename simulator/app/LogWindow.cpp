@@ -13,6 +13,7 @@
 #endif
 #include "wx/image.h"   // needed for Windows build
 #include "wx/dcbuffer.h"
+#include "wx/listctrl.h"
 
 #include "LogWindow.h"
 #include "LogMessage.h"
@@ -63,6 +64,34 @@ void MyTextCtrl::OnScrollBottom(wxScrollWinEvent& event)
 }
 #endif
 
+/*
+ * Virtual list control for the log output.  The control only asks for
+ * the rows it is about to draw, so we never hold formatted text for
+ * messages that aren't on screen.
+ */
+class LogListCtrl : public wxListCtrl {
+public:
+    LogListCtrl(LogWindow* pLogWindow, wxWindow* parent, wxWindowID id)
+        : wxListCtrl(parent, id, wxDefaultPosition, wxDefaultSize,
+            wxLC_REPORT | wxLC_VIRTUAL | wxLC_NO_HEADER | wxLC_SINGLE_SEL |
+                wxSUNKEN_BORDER),
+          mpLogWindow(pLogWindow)
+        {
+            /* one wide column; rows are never wrapped */
+            InsertColumn(0, wxT(""), wxLIST_FORMAT_LEFT, 2000);
+        }
+
+    virtual wxString OnGetItemText(long item, long column) const {
+        return mpLogWindow->GetRowText(item);
+    }
+    virtual wxListItemAttr* OnGetItemAttr(long item) const {
+        return mpLogWindow->GetRowAttr(item);
+    }
+
+private:
+    LogWindow*  mpLogWindow;
+};
+
 
 BEGIN_EVENT_TABLE(LogWindow, wxDialog)
     EVT_CLOSE(LogWindow::OnClose)
@@ -71,6 +100,7 @@ BEGIN_EVENT_TABLE(LogWindow, wxDialog)
     EVT_BUTTON(IDC_LOG_CLEAR, LogWindow::OnLogClear)
     EVT_BUTTON(IDC_LOG_PAUSE, LogWindow::OnLogPause)
     EVT_BUTTON(IDC_LOG_PREFS, LogWindow::OnLogPrefs)
+    EVT_IDLE(LogWindow::OnIdle)
 END_EVENT_TABLE()
 
 /*
@@ -98,7 +128,8 @@ LogWindow::LogWindow(wxWindow* parent)
     : wxDialog(parent, wxID_ANY, wxT("Log Output"), wxDefaultPosition,
         wxDefaultSize,
         wxCAPTION | wxSYSTEM_MENU | wxCLOSE_BOX | wxRESIZE_BORDER),
-      mDisplayArray(NULL), mMaxDisplayMsgs(0), mPaused(false),
+      mpListCtrl(NULL), mMaxDisplayMsgs(0), mDisplayFirst(0),
+      mDisplayDirty(false), mPaused(false),
       mMinPriority(ANDROID_LOG_VERBOSE),
       mHeaderFormat(LogPrefsDialog::kHFFull),
       mSingleLine(false), mExtraSpacing(0), mPointSize(10), mUseColor(true),
@@ -117,10 +148,6 @@ LogWindow::LogWindow(wxWindow* parent)
     mMaxDisplayMsgs = 1000;
     pPrefs->GetInt("log-display-msg-count", &mMaxDisplayMsgs);
     assert(mMaxDisplayMsgs > 0);
-    mDisplayArray = new LogMessage*[mMaxDisplayMsgs];
-    memset(mDisplayArray, 0, sizeof(LogMessage*) * mMaxDisplayMsgs);
-    mTopPtr = -1;
-    mNextPtr = 0;
 
     int tmpInt = (int) mHeaderFormat;
     pPrefs->GetInt("log-header-format", &tmpInt);
@@ -145,34 +172,29 @@ LogWindow::LogWindow(wxWindow* parent)
  */
 LogWindow::~LogWindow(void)
 {
-    ClearDisplay();
-    delete[] mDisplayArray;
-
     if (mLogFp != NULL)
         fclose(mLogFp);
 }
 
 /*
- * Set the text style, based on our preferences.
+ * Set the font and row colors, based on our preferences.
  */
 void LogWindow::SetTextStyle(void)
 {
-    wxTextCtrl* pTextCtrl;
-    pTextCtrl = (wxTextCtrl*) FindWindow(IDC_LOG_TEXT);
-    wxTextAttr style;
-    style = pTextCtrl->GetDefaultStyle();
-
     if (mFontMonospace) {
         wxFont font(mPointSize, wxFONTFAMILY_MODERN, wxFONTSTYLE_NORMAL,
             wxFONTWEIGHT_NORMAL);
-        style.SetFont(font);
+        mpListCtrl->SetFont(font);
     } else {
         wxFont font(mPointSize, wxFONTFAMILY_SWISS, wxFONTSTYLE_NORMAL,
             wxFONTWEIGHT_NORMAL);
-        style.SetFont(font);
+        mpListCtrl->SetFont(font);
     }
 
-    pTextCtrl->SetDefaultStyle(style);
+    mAttrNormal.SetTextColour(*wxBLACK);
+    mAttrWarn.SetTextColour(*wxBLUE);
+    mAttrError.SetTextColour(*wxRED);
+    mAttrInternal.SetTextColour(*wxGREEN);
 }
 
 /*
@@ -228,19 +250,15 @@ void LogWindow::ConstructControls(void)
     configSizer->Add(prefs, 0, wxALIGN_RIGHT);
 
     /*
-     * Create text ctrl.
+     * Create the output list.
      */
-    wxTextCtrl* pTextCtrl;
-    pTextCtrl = new wxTextCtrl(base, IDC_LOG_TEXT, wxT(""),
-        wxDefaultPosition, wxDefaultSize,
-        wxTE_MULTILINE | wxTE_READONLY | wxTE_RICH2 | wxTE_NOHIDESEL |
-            wxHSCROLL);
+    mpListCtrl = new LogListCtrl(this, base, IDC_LOG_TEXT);
 
     /*
      * Add components to master sizer.
      */
     masterSizer->AddSpacer(kEdgeSpacing);
-    masterSizer->Add(pTextCtrl, 1, wxEXPAND);
+    masterSizer->Add(mpListCtrl, 1, wxEXPAND);
     masterSizer->AddSpacer(kInterSpacing);
     masterSizer->Add(configSizer, 0, wxEXPAND);
     masterSizer->AddSpacer(kEdgeSpacing);
@@ -436,8 +454,8 @@ void LogWindow::OnLogLevel(wxCommandEvent& event)
  */
 void LogWindow::OnLogClear(wxCommandEvent& event)
 {
-    ClearDisplay();
     mPool.Clear();
+    UpdateDisplay();
 }
 
 /*
@@ -457,24 +475,8 @@ void LogWindow::OnLogPause(wxCommandEvent& event)
     } else {
         pButton->SetLabel(wxT("&Pause"));
 
-        LogMessage* pMsg = mPool.GetBookmark();
-        if (pMsg == NULL) {
-            /* bookmarked item fell out of pool */
-            printf("--- bookmark was lost, redisplaying\n");
-            Redisplay();
-        } else {
-            /*
-             * The bookmark points to the last item added to the display.
-             * We want to chase its "prev" pointer to walk toward the head
-             * of the list, adding items from oldest to newest.
-             */
-            pMsg = pMsg->GetPrev();
-            while (pMsg != NULL) {
-                if (FilterMatches(pMsg))
-                    AddToDisplay(pMsg);
-                pMsg = pMsg->GetPrev();
-            }
-        }
+        /* just jump to the end; the list only formats what it shows */
+        UpdateDisplay();
     }
 }
 
@@ -507,10 +509,6 @@ void LogWindow::OnLogPrefs(wxCommandEvent& event)
      * re-display the log output.
      */
     if (dialog.ShowModal() == wxID_OK) {
-        /* discard old display arra */
-        ClearDisplay();
-        delete[] mDisplayArray;
-
         mHeaderFormat = dialog.mHeaderFormat;
         mSingleLine = dialog.mSingleLine;
         mExtraSpacing = dialog.mExtraSpacing;
@@ -532,8 +530,6 @@ void LogWindow::OnLogPrefs(wxCommandEvent& event)
         mFileName = dialog.mFileName;
         mTruncateOld = dialog.mTruncateOld;
 
-        mDisplayArray = new LogMessage*[mMaxDisplayMsgs];
-        memset(mDisplayArray, 0, sizeof(LogMessage*) * mMaxDisplayMsgs);
         Redisplay();
 
         PrepareLogFile();
@@ -550,16 +546,20 @@ void LogWindow::AddLogMessage(LogMessage* pLogMessage)
 {
     mPool.Add(pLogMessage);
 
-    if (!mPaused && mVisible && FilterMatches(pLogMessage)) {
-        /*
-         * Thought: keep a reference to the previous message.  If it
-         * matches in most fields (all except timestamp?), hold it and
-         * increment a counter.  If we get a message that doesn't match,
-         * or a timer elapses, synthesize a "previous message repeated N
-         * times" string.
-         */
-        AddToDisplay(pLogMessage);
-    }
+    /*
+     * Even a message we don't show can push old ones we do show out of
+     * the pool, so any addition means the display range needs another
+     * look.  That happens when we go idle, so a burst of messages costs
+     * one update instead of one per message.
+     *
+     * Thought: keep a reference to the previous message.  If it
+     * matches in most fields (all except timestamp?), hold it and
+     * increment a counter.  If we get a message that doesn't match,
+     * or a timer elapses, synthesize a "previous message repeated N
+     * times" string.
+     */
+    if (mVisible)
+        mDisplayDirty = true;
 
     // release the initial ref caused by allocation
     pLogMessage->Release();
@@ -569,86 +569,104 @@ void LogWindow::AddLogMessage(LogMessage* pLogMessage)
 }
 
 /*
- * Clear out the display, releasing any log messages held in the display
- * array.
+ * Bring the display up to date after messages were added, at most once
+ * per trip through the event loop.
  */
-void LogWindow::ClearDisplay(void)
+void LogWindow::OnIdle(wxIdleEvent& event)
 {
-    wxTextCtrl* pTextCtrl;
-    pTextCtrl = (wxTextCtrl*) FindWindow(IDC_LOG_TEXT);
-    pTextCtrl->Clear();
+    if (mDisplayDirty)
+        UpdateDisplay();
+    event.Skip();
+}
 
-    /*
-     * Just run through the entire array.
-     */
-    for (int i = 0; i < mMaxDisplayMsgs; i++) {
-        if (mDisplayArray[i] != NULL) {
-            mDisplayArray[i]->Release();
-            mDisplayArray[i] = NULL;
+/*
+ * Work out which messages the list should show, and tell it.
+ *
+ * We show the last mMaxDisplayMsgs messages that pass the filter, up to
+ * the end of the pool, or up to the bookmark if we're paused.  Messages
+ * in this range are formatted by the list as it draws them.
+ */
+void LogWindow::UpdateDisplay(void)
+{
+    unsigned int begin, end;
+
+    begin = mPool.GetBegin(mMinPriority);
+    if (mPaused) {
+        end = mPool.GetBookmark(mMinPriority);
+        if ((int) (end - begin) < 0) {
+            /* bookmarked messages fell out of the pool */
+            end = begin;
         }
+    } else {
+        end = mPool.GetEnd(mMinPriority);
+    }
+    if (end - begin > (unsigned int) mMaxDisplayMsgs)
+        begin = end - mMaxDisplayMsgs;
+
+    long count = end - begin;
+    mDisplayFirst = begin;
+    mDisplayDirty = false;
+
+    mpListCtrl->SetItemCount(count);
+    if (count > 0) {
+        mpListCtrl->RefreshItems(0, count-1);
+        if (!mPaused)
+            mpListCtrl->EnsureVisible(count-1);
+    } else {
+        mpListCtrl->Refresh();
     }
-    mTopPtr = -1;
-    mNextPtr = 0;
 }
 
 /*
- * Clear the current display and regenerate it from the log pool.  We need
- * to do this whenever we change filters or log message formatting.
+ * Regenerate the display from the log pool.  We need to do this whenever
+ * we change filters or log message formatting.  There's no text to
+ * rebuild, so this is just a matter of picking the new range of messages.
  */
 void LogWindow::Redisplay(void)
 {
-    /*
-     * Freeze output rendering so it doesn't flash during update.  Doesn't
-     * seem to help for GTK, and it leaves garbage on the screen in WinXP,
-     * so I'm leaving it commented out.
-     */
-    //wxTextCtrl* pText = (wxTextCtrl*) FindWindow(IDC_LOG_TEXT);
-    //pText->Freeze();
-
-    //printf("--- redisplay\n");
-    ClearDisplay();
-
-    /*
-     * Set up the default wxWidgets text style stuff.
-     */
     SetTextStyle();
+    UpdateDisplay();
+}
 
-    /*
-     * Here's the plan:
-     * - Start at the head of the pool (where the most recently added
-     *   items are).
-     * - Check to see if the current item passes our filter.  If it does,
-     *   increment the "found count".
-     * - Continue in this manner until we run out of pool or have
-     *   sufficient items to fill the screen.
-     * - Starting from the current position, walk back toward the head,
-     *   adding the items that meet the current filter criteria.
-     *
-     * Don't forget that the log pool could be empty.
-     */
-    LogMessage* pMsg = mPool.GetHead();
+/*
+ * Return the text for row "row" of the list.
+ */
+wxString LogWindow::GetRowText(long row)
+{
+    const LogMessage* pMsg;
 
-    if (pMsg != NULL) {
-        int foundCount = 0;
+    pMsg = mPool.GetMessage(mMinPriority, mDisplayFirst + row);
+    if (pMsg == NULL)
+        return wxEmptyString;   // dropped since the last update
+    return FormatMessage(pMsg);
+}
 
-        // note this stops before it runs off the end
-        while (pMsg->GetNext() != NULL && foundCount < mMaxDisplayMsgs) {
-            if (FilterMatches(pMsg))
-                foundCount++;
-            pMsg = pMsg->GetNext();
-        }
+/*
+ * Return the colors for row "row" of the list, or NULL for the default.
+ */
+wxListItemAttr* LogWindow::GetRowAttr(long row)
+{
+    const LogMessage* pMsg;
 
-        while (pMsg != NULL) {
-            if (FilterMatches(pMsg))
-                AddToDisplay(pMsg);
-            pMsg = pMsg->GetPrev();
-        }
-    }
+    if (!mUseColor)
+        return NULL;
+    pMsg = mPool.GetMessage(mMinPriority, mDisplayFirst + row);
+    if (pMsg == NULL)
+        return NULL;
 
-    //pText->Thaw();
+    if (pMsg->GetInternal())
+        return &mAttrInternal;
+    switch (pMsg->GetPriority()) {
+    case ANDROID_LOG_WARN:
+        return &mAttrWarn;
+    case ANDROID_LOG_ERROR:
+    case ANDROID_LOG_FATAL:
+        return &mAttrError;
+    default:
+        return &mAttrNormal;
+    }
 }
 
-
 /*
  * Returns "true" if the currently specified filters would allow this
  * message to be shown.
@@ -672,63 +690,6 @@ void LogWindow::SetMaxDisplayMsgs(int max)
     pPrefs->SetInt("log-display-msg-count", max);
 }
 
-/*
- * Add the message to the display array and to the screen.
- */
-void LogWindow::AddToDisplay(LogMessage* pLogMessage)
-{
-    wxTextCtrl* pTextCtrl;
-    pTextCtrl = (wxTextCtrl*) FindWindow(IDC_LOG_TEXT);
-
-    if (mNextPtr == mTopPtr) {
-        /*
-         * The display array is full.
-         *
-         * We need to eliminate the topmost entry.  This requires removing
-         * it from the array and removing the text from the wxTextCtrl.
-         */
-        pTextCtrl->Remove(0, mDisplayArray[mTopPtr]->GetTextCtrlLen());
-        mDisplayArray[mTopPtr]->Release();
-        mTopPtr = (mTopPtr + 1) % mMaxDisplayMsgs;
-    }
-
-    /*
-     * Add formatted text to the text ctrl.  Track how much actual space
-     * is required.  The space may be different on Win32 (CRLF-based) vs.
-     * GTK (LF-based), so we need to measure it, not compute it from the
-     * text string.
-     */
-    long lastBefore, lastAfter;
-    //long insertBefore;
-    //insertBefore = pTextCtrl->GetInsertionPoint();
-    lastBefore = pTextCtrl->GetLastPosition();
-    FormatMessage(pLogMessage, pTextCtrl);
-    lastAfter = pTextCtrl->GetLastPosition();
-    pLogMessage->SetTextCtrlLen(lastAfter - lastBefore);
-
-    /*
-     * If we restore the old insertion point, we will be glued to where
-     * we were.  This is okay until we start deleting text from the top,
-     * at which point we need to adjust it to retain our position.
-     *
-     * If we set the insertion point to the bottom, we effectively
-     * implement "scroll to bottom on output".
-     *
-     * If we don't set it at all, we get slightly strange behavior out
-     * of GTK, which seems to be par for the course here.
-     */
-    //pTextCtrl->SetInsertionPoint(insertBefore);     // restore insertion pt
-    pTextCtrl->SetInsertionPoint(lastAfter);
-
-    /* add it to array, claim ownership */
-    mDisplayArray[mNextPtr] = pLogMessage;
-    pLogMessage->Acquire();
-
-    /* adjust pointers */
-    if (mTopPtr < 0)        // first time only
-        mTopPtr = 0;
-    mNextPtr = (mNextPtr + 1) % mMaxDisplayMsgs;
-}
 
 
 /*
@@ -746,10 +707,9 @@ static const wxCharBuffer GetPriorityString(android_LogPriority priority)
 }
 
 /*
- * Format a message and write it to the text control.
+ * Format a message as a single row of the display.
  */
-void LogWindow::FormatMessage(const LogMessage* pLogMessage, 
-    wxTextCtrl* pTextCtrl)
+wxString LogWindow::FormatMessage(const LogMessage* pLogMessage)
 {
 #if defined(HAVE_LOCALTIME_R)
     struct tm tmBuf;
@@ -801,67 +761,28 @@ void LogWindow::FormatMessage(const LogMessage* pLogMessage,
     else
         strcpy(timeBuf, "-");
 
-    const int kMaxExtraNewlines = 2;
-    char hdrNewline[2];
-    char finalNewlines[kMaxExtraNewlines+1 +1];
-
-    if (mSingleLine)
-        hdrNewline[0] = ' ';
-    else
-        hdrNewline[0] = '\n';
-    hdrNewline[1] = '\0';
-
-    assert(mExtraSpacing <= kMaxExtraNewlines);
-    int i;
-    for (i = 0; i < mExtraSpacing+1; i++)
-        finalNewlines[i] = '\n';
-    finalNewlines[i] = '\0';
-
-    wxTextAttr msgColor;
-    switch (pLogMessage->GetPriority()) {
-    case ANDROID_LOG_WARN:
-        msgColor.SetTextColour(*wxBLUE);
-        break;
-    case ANDROID_LOG_ERROR:
-        msgColor.SetTextColour(*wxRED);
-        break;
-    case ANDROID_LOG_VERBOSE:
-    case ANDROID_LOG_DEBUG:
-    case ANDROID_LOG_INFO:
-    default:
-        msgColor.SetTextColour(*wxBLACK);
-        break;
-    }
-    if (pLogMessage->GetInternal())
-        msgColor.SetTextColour(*wxGREEN);
-
     /*
-     * Construct a buffer containing the log header.
+     * Construct a buffer containing the log header and message.
      */
-    bool splitHeader = true;
     outBuf = msgBuf;
     switch (headerFmt) {
     case LogPrefsDialog::kHFFull:
-        splitHeader = true;
         msgLen = android_snprintfBuffer(&outBuf, sizeof(msgBuf),
-                    "[ %s %5d %c/%-6.6s]%s",
+                    "[ %s %5d %c/%-6.6s] %s",
                     timeBuf, pLogMessage->GetPid(), priChar,
-                    pLogMessage->GetTag(), hdrNewline);
+                    pLogMessage->GetTag(), pLogMessage->GetMsg());
         break;
     case LogPrefsDialog::kHFBrief:
-        splitHeader = true;
         msgLen = android_snprintfBuffer(&outBuf, sizeof(msgBuf),
-                    "[%s %5d]%s",
-                    timeBuf, pLogMessage->GetPid(), hdrNewline);
+                    "[%s %5d] %s",
+                    timeBuf, pLogMessage->GetPid(), pLogMessage->GetMsg());
         break;
     case LogPrefsDialog::kHFMinimal:
-        splitHeader = false;
         msgLen = android_snprintfBuffer(&outBuf, sizeof(msgBuf),
                     "%s %5d- %s",
                     timeBuf, pLogMessage->GetPid(), pLogMessage->GetMsg());
         break;
     case LogPrefsDialog::kHFInternal:
-        splitHeader = false;
         msgLen = android_snprintfBuffer(&outBuf, sizeof(msgBuf),
                     "[%s] %s", timeBuf, pLogMessage->GetMsg());
         break;
@@ -874,31 +795,24 @@ void LogWindow::FormatMessage(const LogMessage* pLogMessage,
     if (msgLen < 0) {
         fprintf(stderr, "WHOOPS\n");
         assert(outBuf == msgBuf);
-        return;
+        return wxEmptyString;
     }
 
-    if (splitHeader) {
-        if (mUseColor)
-            pTextCtrl->SetDefaultStyle(wxTextAttr(*wxLIGHT_GREY));
-        pTextCtrl->AppendText(wxString::FromAscii(outBuf));
-        if (mUseColor)
-            pTextCtrl->SetDefaultStyle(msgColor);
-        pTextCtrl->AppendText(wxString::FromAscii(pLogMessage->GetMsg()));
-        if (mUseColor)
-            pTextCtrl->SetDefaultStyle(*wxBLACK);
-        pTextCtrl->AppendText(wxString::FromAscii(finalNewlines));
-    } else {
-        if (mUseColor)
-            pTextCtrl->SetDefaultStyle(msgColor);
-        pTextCtrl->AppendText(wxString::FromAscii(outBuf));
-        if (mUseColor)
-            pTextCtrl->SetDefaultStyle(*wxBLACK);
-        pTextCtrl->AppendText(wxString::FromAscii(finalNewlines));
+    /* a row is one line; drop trailing newlines, flatten the rest */
+    while (msgLen > 0 && outBuf[msgLen-1] == '\n')
+        outBuf[--msgLen] = '\0';
+    for (int i = 0; i < msgLen; i++) {
+        if (outBuf[i] == '\n' || outBuf[i] == '\t')
+            outBuf[i] = ' ';
     }
 
+    wxString row(wxString::FromAscii(outBuf));
+
     /* if we allocated storage for this message, free it */
     if (outBuf != msgBuf)
         free(outBuf);
+
+    return row;
 }
 
 /*
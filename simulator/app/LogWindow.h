@@ -6,6 +6,8 @@
 #ifndef _SIM_LOG_WINDOW_H
 #define _SIM_LOG_WINDOW_H
 
+#include "wx/listctrl.h"
+
 #include "PhoneData.h"
 #include "UserEvent.h"
 #include "LogMessage.h"
@@ -22,12 +24,15 @@
  * window.
  *
  * Messages are stored in a "log pool", which has a fixed memory footprint.
- * The messages that are currently visible in the log output window are
- * also pointed at from a fixed-size display array.  Changes to output
- * format cause us to clear the display and re-show everything in the
- * display array, while changes to the output filter cause us to
- * re-evaluate the contents of the display pool.
+ * The output window is a virtual list control showing one message per
+ * row: it only asks us for the rows it is actually drawing, and we format
+ * them on the fly.  So the display is just a range of message numbers in
+ * the pool, and changing the format or the filter only means picking a
+ * new range and repainting.  Incoming messages are coalesced, the range
+ * is updated when the UI goes idle.
  */
+class LogListCtrl;
+
 class LogWindow : public wxDialog {
 public:
     LogWindow(wxWindow* parent);
@@ -50,6 +55,10 @@ public:
     static void PostLogMsg(const wxString& msg);
     static void PostLogMsg(const char* msg);
 
+    /* text and attributes of a row, for the list control */
+    wxString GetRowText(long row);
+    wxListItemAttr* GetRowAttr(long row);
+
 private:
     void OnMove(wxMoveEvent& event);
     void OnClose(wxCloseEvent& event);
@@ -57,6 +66,7 @@ private:
     void OnLogClear(wxCommandEvent& event);
     void OnLogPause(wxCommandEvent& event);
     void OnLogPrefs(wxCommandEvent& event);
+    void OnIdle(wxIdleEvent& event);
 
     /* handle incoming log message */
     void OnUserEvent(UserEvent& event);
@@ -64,15 +74,13 @@ private:
     void SaveWindowPrefs(void);
     void ConstructControls(void);
 
-    void AddToDisplay(LogMessage* pLogMessage);
-    void ClearDisplay(void);
+    void UpdateDisplay(void);
     void Redisplay(void);
     void SetTextStyle(void);
 
     bool FilterMatches(const LogMessage* pLogMessage);
 
-    void FormatMessage(const LogMessage* pLogMessage, 
-        wxTextCtrl* pTextCtrl);
+    wxString FormatMessage(const LogMessage* pLogMessage);
 
     void LogToFile(const LogMessage* pLogMessage);
     void PrepareLogFile(void);
@@ -84,16 +92,22 @@ private:
     LogPool     mPool;
 
     /*
-     * Display array.  This is a fixed-size circular array that holds
-     * pointers to the log messages currently displayed on screen.
+     * Display.  Row N of the list shows message mDisplayFirst+N of those
+     * passing the filter.
      */
-    LogMessage**    mDisplayArray;      // ptrs to messages currently displayed
+    LogListCtrl*    mpListCtrl;
     int         mMaxDisplayMsgs;        // max #of messages
-    int         mTopPtr;                // index of top message
-    int         mNextPtr;               // index of next empty slot
+    unsigned int mDisplayFirst;         // pool number of the first row
+    bool        mDisplayDirty;          // pool changed since last update
 
     bool        mPaused;                // is output paused for review?
 
+    /* row colors */
+    wxListItemAttr  mAttrNormal;
+    wxListItemAttr  mAttrWarn;
+    wxListItemAttr  mAttrError;
+    wxListItemAttr  mAttrInternal;
+
     /*
      * Current filter.
      */
@@ -44,8 +44,7 @@ void Message::setConfig(const char* name, const char* value)
 
     int nlen = strlen(name) +1;
     int vlen = strlen(value) +1;
-    mData = new unsigned char[nlen+vlen];
-    mCleanup = kCleanupDelete;
+    mData = allocData(nlen+vlen);
     mLength = nlen + vlen;
     mType = kTypeConfig;
 
@@ -74,8 +73,7 @@ void Message::setCommand(int cmd, int arg)
 {
     reset();
 
-    mData = new unsigned char[sizeof(int) * 2];
-    mCleanup = kCleanupDelete;
+    mData = allocData(sizeof(int) * 2);
     mLength = sizeof(int) * 2;
     mType = kTypeCommand;
 
@@ -91,8 +89,7 @@ void Message::setCommandExt(int cmd, int arg0, int arg1, int arg2)
 {
     reset();
 
-    mData = new unsigned char[sizeof(int) * 4];
-    mCleanup = kCleanupDelete;
+    mData = allocData(sizeof(int) * 4);
     mLength = sizeof(int) * 4;
     mType = kTypeCommandExt;
 
@@ -121,6 +118,27 @@ bool Message::getCommand(int* pCmd, int* pArg)
     return true;
 }
 
+/*
+ * Try to return the contents of the message as if it were an "extended
+ * command".
+ */
+bool Message::getCommandExt(int* pCmd, int* pArg0, int* pArg1, int* pArg2)
+{
+    if (mLength != sizeof(int) * 4) {
+        LOG(LOG_WARN, "", "type is %d, len is %d\n", mType, mLength);
+        return false;
+    }
+    assert(mData != NULL);
+
+    const int* pInt = (const int*) mData;
+    *pCmd = pInt[0];
+    *pArg0 = pInt[1];
+    *pArg1 = pInt[2];
+    *pArg2 = pInt[3];
+
+    return true;
+}
+
 /*
  * Serialize a log message.
  *
@@ -139,13 +157,12 @@ void Message::setLogBundle(const android_LogBundle* pBundle)
     msgLen += 1;
 
     /* set up the structure */
-    mCleanup = kCleanupDelete;
     mLength =   sizeof(pBundle->when) +
                 sizeof(pBundle->priority) +
                 sizeof(pBundle->pid) +
                 tagLen +
                 msgLen;
-    mData = new unsigned char[mLength];
+    mData = allocData(mLength);
     mType = kTypeLogBundle;
 
     unsigned char* pCur = mData;
@@ -171,19 +188,29 @@ void Message::setLogBundle(const android_LogBundle* pBundle)
 /*
  * Extract the components of a log bundle.
  *
+ * A log bundle message may hold several bundles back to back.  If
+ * "pOffset" is non-NULL, we unpack the bundle that starts there and
+ * advance it past the end; keep calling until it reaches getLength().
+ * Otherwise the message must hold exactly one bundle.
+ *
  * We're just returning points inside the message buffer, so the caller
- * will need to copy them out before the next reset().
+ * will need to copy them out before the next reset() or the next call.
  */
-bool Message::getLogBundle(android_LogBundle* pBundle)
+bool Message::getLogBundle(android_LogBundle* pBundle, int* pOffset)
 {
-    if (mLength < (int)(sizeof(time_t) + sizeof(int)*2 + 4)) {
-        LOG(LOG_WARN, "", "type is %d, len is %d, too small\n",
-            mType, mLength);
+    int offset = (pOffset != NULL) ? *pOffset : 0;
+    int avail = mLength - offset;
+
+    if (avail < (int)(sizeof(time_t) + sizeof(int)*2 + 2)) {
+        LOG(LOG_WARN, "", "type is %d, len is %d at %d, too small\n",
+            mType, mLength, offset);
         return false;
     }
     assert(mData != NULL);
 
-    unsigned char* pCur = mData;
+    unsigned char* pCur = mData + offset;
+    unsigned char* pEnd = mData + mLength;
+    unsigned char* pNul;
 
     pBundle->when = *((time_t*) pCur);
     pCur += sizeof(pBundle->when);
@@ -191,21 +218,36 @@ bool Message::getLogBundle(android_LogBundle* pBundle)
     pCur += sizeof(pBundle->priority);
     pBundle->pid = *((pid_t*) pCur);
     pCur += sizeof(pBundle->pid);
+
+    pNul = (unsigned char*) memchr(pCur, '\0', pEnd - pCur);
+    if (pNul == NULL)
+        goto truncated;
     pBundle->tag = (const char*) pCur;
-    pCur += strlen((const char*) pCur) +1;
+    pCur = pNul +1;
+
+    pNul = (unsigned char*) memchr(pCur, '\0', pEnd - pCur);
+    if (pNul == NULL)
+        goto truncated;
     mVec.iov_base = (char*) pCur;
-    mVec.iov_len = strlen((const char*) pCur);
+    mVec.iov_len = pNul - pCur;
     pBundle->msgVec = &mVec;
     pBundle->msgCount = 1;
-    pCur += mVec.iov_len +1;
+    pCur = pNul +1;
 
-    if (pCur - mData != mLength) {
+    if (pOffset != NULL) {
+        *pOffset = pCur - mData;
+    } else if (pCur != pEnd) {
         LOG(LOG_WARN, "", "log bundle rcvd %d, used %d\n", mLength,
             (int) (pCur - mData));
         return false;
     }
 
     return true;
+
+truncated:
+    LOG(LOG_WARN, "", "log bundle truncated (len %d, offset %d)\n",
+        mLength, offset);
+    return false;
 }
 
 /*
@@ -237,12 +279,11 @@ bool Message::read(Pipe* pPipe, bool wait)
     if (mLength > 0) {
         int actual;
 
-        mData = new unsigned char[mLength];
+        mData = allocData(mLength);
         if (mData == NULL) {
             LOG(LOG_ERROR, "", "alloc failed\n");
             return false;
         }
-        mCleanup = kCleanupDelete;
 
         actual = pPipe->read(mData, mLength);
         if (actual != mLength) {
@@ -255,6 +296,23 @@ bool Message::read(Pipe* pPipe, bool wait)
     return true;
 }
 
+/*
+ * Write the packet header and body to "buf".
+ *
+ * The current value of "mLength" does not include the 4-byte header.
+ * Two of the 4 header bytes are included in the length we output
+ * (the type byte and the pad byte), so we adjust mLength.
+ */
+void Message::pack(unsigned char* buf) const
+{
+    buf[0] = (unsigned char) (mLength + kHeaderLen -2);
+    buf[1] = (unsigned char) ((mLength + kHeaderLen -2) >> 8);
+    buf[2] = (unsigned char) mType;
+    buf[3] = 0;
+    if (mLength > 0)
+        memcpy(buf + kHeaderLen, mData, mLength);
+}
+
 /*
  * Write this event to a pipe.
  *
@@ -269,44 +327,58 @@ bool Message::read(Pipe* pPipe, bool wait)
  */
 bool Message::write(Pipe* pPipe) const
 {
-    char tmpBuf[128];
-    char* writeBuf = tmpBuf;
+    const Message* pMsg = this;
+
+    return write(pPipe, &pMsg, 1);
+}
+
+/*
+ * Write several messages with a single write, so a burst of commands
+ * costs one trip through the pipe and can't be interleaved with another
+ * thread's messages.
+ *
+ * DO NOT call LOG() from here, as we could be in the process of sending
+ * a log message.
+ */
+/*static*/ bool Message::write(Pipe* pPipe, const Message* const* msgs,
+    int count)
+{
+    unsigned char tmpBuf[256];
+    unsigned char* writeBuf = tmpBuf;
     bool result = false;
-    int kHeaderLen = 4;
+    int totalLen = 0;
+    int i;
 
     if (pPipe == NULL)
         return false;
     assert(pPipe->isCreated());
 
-    if (mData == NULL || mLength < 0)
-        return false;
+    for (i = 0; i < count; i++) {
+        if (msgs[i]->mData == NULL || msgs[i]->mLength < 0)
+            return false;
+        totalLen += msgs[i]->getPacketLength();
+    }
 
     /* if it doesn't fit in stack buffer, allocate space */
-    if (mLength + kHeaderLen > (int) sizeof(tmpBuf)) {
-        writeBuf = new char[mLength + kHeaderLen];
+    if (totalLen > (int) sizeof(tmpBuf)) {
+        writeBuf = new unsigned char[totalLen];
         if (writeBuf == NULL)
-            goto bail;
+            return false;
     }
 
-    /*
-     * The current value of "mLength" does not include the 4-byte header.
-     * Two of the 4 header bytes are included in the length we output
-     * (the type byte and the pad byte), so we adjust mLength.
-     */
-    writeBuf[0] = (unsigned char) (mLength + kHeaderLen -2);
-    writeBuf[1] = (unsigned char) ((mLength + kHeaderLen -2) >> 8);
-    writeBuf[2] = (unsigned char) mType;
-    writeBuf[3] = 0;
-    if (mLength > 0)
-        memcpy(writeBuf + kHeaderLen, mData, mLength);
+    unsigned char* pCur = writeBuf;
+    for (i = 0; i < count; i++) {
+        msgs[i]->pack(pCur);
+        pCur += msgs[i]->getPacketLength();
+    }
 
     int actual;
 
-    actual = pPipe->write(writeBuf, mLength + kHeaderLen);
-    if (actual != mLength + kHeaderLen) {
+    actual = pPipe->write(writeBuf, totalLen);
+    if (actual != totalLen) {
         fprintf(stderr,
-            "Message::write failed writing message body (%d of %d bytes)\n",
-            actual, mLength + kHeaderLen);
+            "Message::write failed writing messages (%d of %d bytes)\n",
+            actual, totalLen);
         goto bail;
     }
 
@@ -402,3 +474,97 @@ bool MessageStream::init(Pipe* readPipe, Pipe* writePipe, bool initiateHello)
     return true;
 }
 
+/*
+ * If we have a complete packet at the front of the receive buffer,
+ * return its length.
+ */
+int MessageStream::bufferedPacketLength(void) const
+{
+    int avail = mRecvEnd - mRecvStart;
+
+    if (avail < Message::kHeaderLen)
+        return 0;
+
+    const unsigned char* header = mRecvBuf + mRecvStart;
+    int len = (header[0] | header[1] << 8) + 2;
+    if (len < Message::kHeaderLen)
+        len = Message::kHeaderLen;      // bogus; recv() will reject it
+    return (avail >= len) ? len : 0;
+}
+
+bool MessageStream::recvReady(void)
+{
+    if (mRecvBuf != NULL && bufferedPacketLength() > 0)
+        return true;
+    return mReadPipe != NULL && mReadPipe->readReady();
+}
+
+/*
+ * Receive a message.
+ *
+ * We read as much as the pipe will give us and parse messages out of the
+ * buffer, so a burst of small messages costs one read instead of two per
+ * message.  The message body usually points straight into our buffer;
+ * if it isn't 32-bit aligned, it's copied into the message's own storage
+ * so the accessors can treat it as ints.
+ *
+ * If "wait" is false, we return false unless a message is already
+ * buffered or the pipe has data.  Once we start reading, we block until
+ * the message is complete.
+ */
+bool MessageStream::recv(Message* pMsg, bool wait)
+{
+    if (mReadPipe == NULL)
+        return false;
+    assert(mReadPipe->isCreated());
+
+    if (mRecvBuf == NULL)
+        mRecvBuf = new unsigned char[kRecvBufLen];
+
+    pMsg->reset();
+
+    int len;
+    while ((len = bufferedPacketLength()) == 0) {
+        int avail = mRecvEnd - mRecvStart;
+
+        if (!wait && !mReadPipe->readReady())
+            return false;
+
+        /* slide the partial packet to the front to make room */
+        if (mRecvStart > 0) {
+            memmove(mRecvBuf, mRecvBuf + mRecvStart, avail);
+            mRecvStart = 0;
+            mRecvEnd = avail;
+        }
+
+        int actual = mReadPipe->read(mRecvBuf + mRecvEnd,
+                        kRecvBufLen - mRecvEnd);
+        if (actual <= 0)
+            return false;
+        mRecvEnd += actual;
+        wait = true;        // finish what we started
+    }
+
+    unsigned char* header = mRecvBuf + mRecvStart;
+    mRecvStart += len;
+    if ((header[0] | header[1] << 8) < 2) {
+        LOG(LOG_WARN, "", "bad message length %d\n", header[0] | header[1] << 8);
+        return false;
+    }
+
+    pMsg->mType = (Message::MessageType) header[2];
+    pMsg->mLength = len - Message::kHeaderLen;
+    if (pMsg->mLength > 0) {
+        unsigned char* body = header + Message::kHeaderLen;
+
+        if (((uintptr_t) body & 3) == 0) {
+            pMsg->mData = body;
+        } else {
+            pMsg->mData = pMsg->allocData(pMsg->mLength);
+            memcpy(pMsg->mData, body, pMsg->mLength);
+        }
+    }
+
+    return true;
+}
+
@@ -10,6 +10,9 @@
 //  +03 (reserved, must be zero)
 //  +04 message body
 //
+// Several packets may arrive in a single read; the stream keeps a buffer
+// and hands out messages that point straight into it.
+//
 #ifndef _LIBS_UTILS_MESSAGE_STREAM_H
 #define _LIBS_UTILS_MESSAGE_STREAM_H
 
@@ -30,14 +33,15 @@ namespace android {
  * A single message, which can be filled out and sent, or filled with
  * received data.
  *
- * Message objects are reusable.
+ * Message objects are reusable, and keep their data buffer from one use
+ * to the next, so reusing one avoids an allocation per message.
  */
 class Message {
 public:
     Message(void)
-        : mCleanup(kCleanupUnknown)
+        : mCleanup(kCleanupUnknown), mBuf(NULL), mBufLen(0)
         { reset(); }
-    ~Message(void) { reset(); }
+    ~Message(void) { reset(); delete[] mBuf; }
 
     /* values for message type byte */
     typedef enum MessageType {
@@ -93,7 +97,8 @@ public:
      */
     bool getConfig(const char** pName, const char** pValue);
     bool getCommand(int* pCmd, int* pArg);
-    bool getLogBundle(android_LogBundle* pBundle);
+    bool getCommandExt(int* pCmd, int* pArg0, int* pArg1, int* pArg2);
+    bool getLogBundle(android_LogBundle* pBundle, int* pOffset = NULL);
 
     /*
      * Read or write this message on the specified pipe.
@@ -103,11 +108,37 @@ public:
      */
     bool read(Pipe* pPipe, bool wait);
     bool write(Pipe* pPipe) const;
+    static bool write(Pipe* pPipe, const Message* const* msgs, int count);
+
+    /*
+     * Size of the packet, and write it into "buf", which must have room
+     * for getPacketLength() bytes.
+     */
+    enum { kHeaderLen = 4 };
+    int getPacketLength(void) const { return mLength + kHeaderLen; }
+    void pack(unsigned char* buf) const;
 
 private:
+    friend class MessageStream;
+
     Message& operator=(const Message&);     // not defined
     Message(const Message&);                // not defined
 
+    /*
+     * Get "len" bytes of storage for mData, owned by the Message.  Small
+     * things go in mInline, larger ones in mBuf, which only grows.
+     */
+    unsigned char* allocData(int len) {
+        if (len <= (int) sizeof(mInline))
+            return (unsigned char*) mInline;
+        if (len > mBufLen) {
+            delete[] mBuf;
+            mBuf = new unsigned char[len];
+            mBufLen = len;
+        }
+        return mBuf;
+    }
+
     void reset(void) {
         if (mCleanup == kCleanupDelete)
             delete[] mData;
@@ -123,6 +154,10 @@ private:
     unsigned char*  mData;
     int             mLength;
     struct iovec    mVec;
+
+    int             mInline[4];     // command-sized messages
+    unsigned char*  mBuf;           // reusable storage for bigger ones
+    int             mBufLen;
 };
 
 
@@ -137,9 +172,10 @@ private:
 class MessageStream {
 public:
     MessageStream(void)
-        : mReadPipe(NULL), mWritePipe(NULL)
+        : mReadPipe(NULL), mWritePipe(NULL),
+          mRecvBuf(NULL), mRecvStart(0), mRecvEnd(0)
         {}
-    ~MessageStream(void) {}
+    ~MessageStream(void) { delete[] mRecvBuf; }
 
     /*
      * Initialize object and exchange greetings.  "initateHello" determines
@@ -156,9 +192,17 @@ public:
     bool send(const Message* pMsg) { return pMsg->write(mWritePipe); }
 
     /*
-     * Receive a message.
+     * Send several messages with a single write.
+     */
+    bool sendv(const Message* const* msgs, int count) {
+        return Message::write(mWritePipe, msgs, count);
+    }
+
+    /*
+     * Receive a message.  The message data points into our receive
+     * buffer, and is only good until the next recv().
      */
-    bool recv(Message* pMsg, bool wait) { return pMsg->read(mReadPipe, wait); }
+    bool recv(Message* pMsg, bool wait);
 
     /*
      * Close communication pipes.  Further attempts to send or receive
@@ -170,19 +214,34 @@ public:
     /*
      * Get our incoming traffic pipe.  This is useful on Linux systems
      * because it allows access to the file descriptor which can be used
-     * in a select() call.
+     * in a select() call.  Check recvReady() first, though: messages
+     * may already be waiting in our buffer.
      */
     Pipe* getReadPipe(void) { return mReadPipe; }
 
+    /* Returns "true" if recv() has a message without waiting */
+    bool recvReady(void);
+
 private:
     enum {
         kHelloMsg       = 0x4e303047,       // 'N00G'
         kHelloAckMsg    = 0x31455221,       // '1ER!'
     };
 
+    /* largest packet: 16-bit length plus the two bytes before it */
+    enum { kRecvBufLen = 65535 + 2 };
+
+    /* length of the complete packet at the front of mRecvBuf, or 0 */
+    int bufferedPacketLength(void) const;
+
     /* communication pipes; note we don't own these */
     Pipe*   mReadPipe;
     Pipe*   mWritePipe;
+
+    /* received data not yet handed out, at [mRecvStart, mRecvEnd) */
+    unsigned char*  mRecvBuf;
+    int     mRecvStart;
+    int     mRecvEnd;
 };
 
 }; // namespace android
@@ -16,6 +16,7 @@
 
 #include "MainFrame.h"
 #include "MyApp.h"
+#include "LoadableImage.h"
 #include "executablepath.h"
 
 #include <stdio.h>
@@ -173,6 +174,8 @@ void MyApp::ChangeAssetDirectory(const wxString& dir)
  */
 int MyApp::OnExit(void)
 {
+    LoadableImage::FlushCache();
+
     if (mPrefs.GetDirty()) {
         printf("Sim: writing config file to '%s'\n",
             (const char*) mConfigFile.ToAscii());
@@ -54,17 +54,15 @@ bool PhoneButton::Create(const char* label, const char* imageFileName,
 }
 
 /*
- * Load the image, if any.
+ * Load the image, if any.  The highlighted bitmap is created the first
+ * time the button is highlighted.
  */
 bool PhoneButton::LoadResources(void)
 {
     if (!mHasImage)
         return true;        // no image associated with this button
 
-    bool result = mSelectedImage.LoadResources();
-    if (result)
-        CreateHighlightedBitmap();
-    return result;
+    return mSelectedImage.LoadResources();
 }
 
 /*
@@ -87,7 +85,8 @@ static inline int MinVal(int a, int b) { return (a < b ? a : b); }
 void PhoneButton::CreateHighlightedBitmap(void)
 {
     wxBitmap* src = mSelectedImage.GetBitmap();
-    assert(src != NULL);
+    if (src == NULL)
+        return;         // image failed to decode, already reported
     wxImage tmpImage = src->ConvertToImage();
 
     unsigned char* pRGB = tmpImage.GetData();       // top-left RGBRGB...
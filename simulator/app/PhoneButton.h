@@ -54,7 +54,11 @@ public:
     int GetY(void) const { return mSelectedImage.GetY(); }
     int GetWidth(void) const { return mSelectedImage.GetWidth(); }
     int GetHeight(void) const { return mSelectedImage.GetHeight(); }
-    wxBitmap* GetHighlightedBitmap(void) { return &mHighlightedBitmap; }
+    wxBitmap* GetHighlightedBitmap(void) {
+        if (!mHighlightedBitmap.Ok())
+            CreateHighlightedBitmap();
+        return &mHighlightedBitmap;
+    }
     wxBitmap* GetSelectedBitmap(void) const {
         return mSelectedImage.GetBitmap();
     }
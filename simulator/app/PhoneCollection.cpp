@@ -16,6 +16,7 @@
 
 #include "PhoneCollection.h"
 #include "PhoneData.h"
+#include "LoadableImage.h"
 #include "MyApp.h"
 
 #include "utils.h"
@@ -47,6 +48,9 @@ void PhoneCollection::ScanForPhones(const char* directory)
      */
     StringArray strArr;
 
+    /* the skins may have changed under us */
+    LoadableImage::FlushCache();
+
 #ifdef BEFORE_ASSET
     DIR* dirp;
     struct dirent* entp;
@@ -43,6 +43,7 @@ BEGIN_EVENT_TABLE(PhoneWindow, wxWindow)    // NOT wxDialog
     EVT_MOTION(PhoneWindow::OnMouseMotion)
     EVT_LEAVE_WINDOW(PhoneWindow::OnMouseLeaveWindow)
     EVT_TIMER(kVibrateTimerId, PhoneWindow::OnTimer)
+    EVT_TIMER(kTouchTimerId, PhoneWindow::OnTouchTimer)
 END_EVENT_TABLE()
 
 
@@ -64,6 +65,7 @@ PhoneWindow::PhoneWindow(wxWindow* parent, const wxPoint& posn)
       mPlacementChecked(false),
       mpParent((MainFrame*)parent),
       mTimer(this, kVibrateTimerId),
+      mTouchTimer(this, kTouchTimerId),
       mTrackingTouch(false)
 {
     SetBackgroundColour(*wxLIGHT_GREY);
@@ -372,20 +374,20 @@ bool PhoneWindow::GetDimensions(PhoneData* pPhoneData, PhoneView* pPhoneView,
         return false;
     }
 
-    // load images for this phone
+    // get image sizes for this phone; the pixels are decoded when drawn
     (void) pPhoneView->LoadResources();
 
     width = height = 0;
 
     // by convention, the background bitmap is the first image in the list
     if (pPhoneView->GetBkgImageCount() > 0) {
-        wxBitmap* pBitmap = pPhoneView->GetBkgImage(0)->GetBitmap();
-        if (pBitmap != NULL) {
+        const LoadableImage* pLimg = pPhoneView->GetBkgImage(0);
+        if (pLimg->GetWidth() > 0) {
             // size window to match bitmap
             xoff = pPhoneView->GetXOffset();
             yoff = pPhoneView->GetYOffset();
-            width = pBitmap->GetWidth();
-            height = pBitmap->GetHeight();
+            width = pLimg->GetWidth();
+            height = pLimg->GetHeight();
         }
     }
 
@@ -703,8 +705,11 @@ void PhoneWindow::OnMouseMotion(wxMouseEvent& event)
                 //printf("TOUCH moved to %d,%d\n", screenX, screenY);
                 mTouchX = screenX;
                 mTouchY = screenY;
-                GetDeviceManager()->SendTouchEvent(Simulator::kTouchDrag,
-                    mTouchX, mTouchY);
+                int delay;
+                delay = GetDeviceManager()->SendTouchEvent(
+                            Simulator::kTouchDrag, mTouchX, mTouchY);
+                if (delay > 0 && !mTouchTimer.IsRunning())
+                    mTouchTimer.Start(delay, wxTIMER_ONE_SHOT);
             } else {
                 //printf("TOUCH moved off screen\n");
             }
@@ -1049,3 +1054,11 @@ void PhoneWindow::OnTimer(wxTimerEvent& event)
     else
         Move(rect.x-4,rect.y);
 }
+
+/*
+ * Send the touch drags the device manager held back.
+ */
+void PhoneWindow::OnTouchTimer(wxTimerEvent& event)
+{
+    GetDeviceManager()->FlushTouchEvents();
+}
@@ -117,6 +117,7 @@ private:
     void OnMove(wxMoveEvent& event);
     void OnClose(wxCloseEvent& event);
     void OnTimer(wxTimerEvent& event);
+    void OnTouchTimer(wxTimerEvent& event);
     void OnKeyDown(wxKeyEvent& event);
     void OnKeyUp(wxKeyEvent& event);
     void OnErase(wxEraseEvent& event);
@@ -171,10 +172,13 @@ private:
 
     MainFrame*      mpParent;           // retain pointer to parent window
 
-    enum { kVibrateTimerId = 1010 };
+    enum { kVibrateTimerId = 1010, kTouchTimerId };
     wxTimer         mTimer;
     int             mVibrateX;
 
+    /* fires when held touch drags are due to be sent */
+    wxTimer         mTouchTimer;
+
     /* touchscreen simulation */
     bool            mTrackingTouch;
     int             mTouchX;
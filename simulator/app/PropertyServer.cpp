@@ -29,6 +29,8 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/un.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 
 
 using namespace android;
@@ -44,6 +46,13 @@ PropertyServer::~PropertyServer(void)
         // TODO: cause thread to stop, then Wait for it
     }
     printf("Sim: in ~PropertyServer()\n");
+
+    if (mPropAreaMapped) {
+        munmap(mPropArea, mPropAreaSize);
+        unlink(kPropAreaFileName);
+    } else {
+        free(mPropArea);
+    }
 }
 
 /*
@@ -51,6 +60,9 @@ PropertyServer::~PropertyServer(void)
  */
 bool PropertyServer::StartThread(void)
 {
+    if (!CreatePropArea(kPropAreaFileName))
+        return false;
+
     if (Create() != wxTHREAD_NO_ERROR) {
         fprintf(stderr, "Sim: ERROR: can't create PropertyServer thread\n");
         return false;
@@ -62,15 +74,115 @@ bool PropertyServer::StartThread(void)
 
 
 /*
- * Clear out the list.
+ * Create the property area and map it into our address space.
+ *
+ * If the file can't be created the runtime will just have to ask us for
+ * everything, so we keep the table in private memory instead.
  */
-void PropertyServer::ClearProperties(void)
+bool PropertyServer::CreatePropArea(const char* fileName)
+{
+    size_t size = sizeof(PropAreaHeader) +
+        kPropAreaBuckets * sizeof(PropAreaEntry);
+    void* addr = NULL;
+    int fd;
+
+    /* remove any leftovers, somebody may still have the old one mapped */
+    unlink(fileName);
+    fd = open(fileName, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd >= 0) {
+        if (ftruncate(fd, size) == 0) {
+            addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    fd, 0);
+            if (addr == MAP_FAILED)
+                addr = NULL;
+        }
+        close(fd);
+    }
+
+    if (addr != NULL) {
+        mPropAreaMapped = true;
+    } else {
+        LOG(LOG_WARN, "sim-prop",
+            "Unable to create property area '%s' (errno=%d)\n",
+            fileName, errno);
+        unlink(fileName);
+        addr = calloc(1, size);
+        if (addr == NULL)
+            return false;
+        mPropAreaMapped = false;
+    }
+
+    /* a new file is all zeroes, so every entry starts out empty */
+    mPropArea = (PropAreaHeader*) addr;
+    mPropAreaSize = size;
+    mPropArea->magic = kPropAreaMagic;
+    mPropArea->version = kPropAreaVersion;
+    mPropArea->numBuckets = kPropAreaBuckets;
+    mPropArea->entrySize = sizeof(PropAreaEntry);
+    mPropUsed = 0;
+    return true;
+}
+
+/*
+ * Find the entry for "key".
+ *
+ * If "forInsert" is set and the key isn't there, this returns the entry
+ * where it should be added instead (the first tombstone on the way, or
+ * the empty entry that ended the search), or NULL if the table is full.
+ * Otherwise, this returns NULL if the key isn't there.
+ *
+ * Must be called with mPropLock held.
+ */
+PropAreaEntry* PropertyServer::FindEntry(const char* key, bool forInsert)
 {
-    typedef List<Property>::iterator PropIter;
+    PropAreaEntry* entries = (PropAreaEntry*) (mPropArea + 1);
+    PropAreaEntry* tombstone = NULL;
+    uint32_t hash = 2166136261U;
+    const unsigned char* cp;
+
+    for (cp = (const unsigned char*) key; *cp != '\0'; cp++)
+        hash = (hash ^ *cp) * 16777619U;
 
-    for (PropIter pi = mPropList.begin(); pi != mPropList.end(); ++pi) {
-        pi = mPropList.erase(pi);
+    for (int i = 0; i < kPropAreaBuckets; i++) {
+        PropAreaEntry* ent = &entries[(hash + i) & (kPropAreaBuckets - 1)];
+
+        if (ent->state == kPropEntryEmpty) {
+            if (!forInsert)
+                return NULL;
+            return tombstone != NULL ? tombstone : ent;
+        }
+        if (ent->state == kPropEntryDeleted) {
+            if (tombstone == NULL)
+                tombstone = ent;
+        } else if (strcmp(ent->key, key) == 0) {
+            return ent;
+        }
     }
+
+    return forInsert ? tombstone : NULL;
+}
+
+/*
+ * Clear out the table.
+ */
+void PropertyServer::ClearProperties(void)
+{
+    wxMutexLocker locker(mPropLock);
+    PropAreaEntry* entries = (PropAreaEntry*) (mPropArea + 1);
+
+    for (int i = 0; i < kPropAreaBuckets; i++) {
+        PropAreaEntry* ent = &entries[i];
+
+        if (ent->state != kPropEntryEmpty) {
+            ent->serial++;
+            __sync_synchronize();
+            ent->state = kPropEntryEmpty;
+            ent->key[0] = '\0';
+            __sync_synchronize();
+            ent->serial++;
+        }
+    }
+    mPropUsed = 0;
 }
 
 /*
@@ -181,28 +293,25 @@ void PropertyServer::SetDefaultProperties(void)
  */
 bool PropertyServer::GetProperty(const char* key, char* valueBuf)
 {
-    typedef List<Property>::iterator PropIter;
+    wxMutexLocker locker(mPropLock);
 
     assert(key != NULL);
     assert(valueBuf != NULL);
 
-    for (PropIter pi = mPropList.begin(); pi != mPropList.end(); ++pi) {
-        Property& prop = *pi;
-        if (strcmp(prop.key, key) == 0) {
-            if (strlen(prop.value) >= PROPERTY_VALUE_MAX) {
-                fprintf(stderr,
-                    "GLITCH: properties table holds '%s' '%s' (len=%d)\n",
-                    prop.key, prop.value, (int) strlen(prop.value));
-                abort();
-            }
-            assert(strlen(prop.value) < PROPERTY_VALUE_MAX);
-            strcpy(valueBuf, prop.value);
-            return true;
-        }
+    PropAreaEntry* ent = FindEntry(key, false);
+    if (ent == NULL) {
+        //printf("Prop: get [%s] not found\n", key);
+        return false;
     }
 
-    //printf("Prop: get [%s] not found\n", key);
-    return false;
+    if (strlen(ent->value) >= PROPERTY_VALUE_MAX) {
+        fprintf(stderr,
+            "GLITCH: properties table holds '%s' '%s' (len=%d)\n",
+            ent->key, ent->value, (int) strlen(ent->value));
+        abort();
+    }
+    strcpy(valueBuf, ent->value);
+    return true;
 }
 
 /*
@@ -215,31 +324,51 @@ bool PropertyServer::GetProperty(const char* key, char* valueBuf)
  */
 bool PropertyServer::SetProperty(const char* key, const char* value)
 {
-    typedef List<Property>::iterator PropIter;
+    wxMutexLocker locker(mPropLock);
 
     assert(key != NULL);
-    assert(value != NULL);
-
-    for (PropIter pi = mPropList.begin(); pi != mPropList.end(); ++pi) {
-        Property& prop = *pi;
-        if (strcmp(prop.key, key) == 0) {
-            if (value != NULL) {
-                //printf("Prop: replacing [%s]: [%s] with [%s]\n",
-                //    prop.key, prop.value, value);
-                strcpy(prop.value, value);
-            } else {
-                //printf("Prop: removing [%s]\n", prop.key);
-                mPropList.erase(pi);
-            }
+
+    if (strlen(key) >= PROPERTY_KEY_MAX ||
+        (value != NULL && strlen(value) >= PROPERTY_VALUE_MAX))
+    {
+        fprintf(stderr, "Sim: property '%s' too long, ignored\n", key);
+        return false;
+    }
+
+    PropAreaEntry* ent = FindEntry(key, value != NULL);
+    if (ent == NULL) {
+        if (value == NULL)
             return true;
-        }
+        fprintf(stderr, "Sim: property table full, dropping '%s'\n", key);
+        return false;
     }
 
-    //printf("Prop: adding [%s]: [%s]\n", key, value);
-    Property tmp;
-    strcpy(tmp.key, key);
-    strcpy(tmp.value, value);
-    mPropList.push_back(tmp);
+    /* keep a quarter of the table empty so misses stay short */
+    bool adding = (ent->state != kPropEntryLive);
+    if (adding && ent->state == kPropEntryEmpty &&
+        mPropUsed >= kPropAreaBuckets * 3 / 4)
+    {
+        fprintf(stderr, "Sim: property table full, dropping '%s'\n", key);
+        return false;
+    }
+
+    ent->serial++;              // odd: readers keep out
+    __sync_synchronize();
+    if (value == NULL) {
+        //printf("Prop: removing [%s]\n", ent->key);
+        ent->state = kPropEntryDeleted;
+    } else {
+        //printf("Prop: setting [%s]: [%s]\n", key, value);
+        if (adding) {
+            if (ent->state == kPropEntryEmpty)
+                mPropUsed++;
+            strcpy(ent->key, key);
+            ent->state = kPropEntryLive;
+        }
+        strcpy(ent->value, value);
+    }
+    __sync_synchronize();
+    ent->serial++;
     return true;
 }
 
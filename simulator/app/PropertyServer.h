@@ -9,13 +9,59 @@
 #include "cutils/properties.h"
 #include "utils/List.h"
 
+#include <stdint.h>
+
+/*
+ * Runtime processes can read properties straight out of a shared memory
+ * "property area", instead of asking us over the socket for each one.  It
+ * is a file that we map read-write and everybody else maps read-only.
+ *
+ * The area is a PropAreaHeader followed by "numBuckets" PropAreaEntry
+ * structs, forming an open-addressed hash table (FNV-1a hash of the key,
+ * linear probing).  Only we write it.  Each entry's "serial" is odd while
+ * we are changing the entry, so readers copy it out and retry if the
+ * serial was odd or changed in the meantime.
+ *
+ * NOTE: this is cloned in wrapsim/SysProps.c -- keep them in sync.
+ */
+#define kPropAreaFileName   "/tmp/android-sysprop-area"
+
+enum {
+    kPropAreaMagic = 0x41505250,        // 'PRPA'
+    kPropAreaVersion = 1,
+    kPropAreaBuckets = 1024,            // must be a power of 2
+};
+
+enum PropEntryState {
+    kPropEntryEmpty = 0,
+    kPropEntryLive,
+    kPropEntryDeleted,                  // tombstone, keep probing
+};
+
+typedef struct PropAreaHeader {
+    uint32_t    magic;
+    uint32_t    version;
+    uint32_t    numBuckets;
+    uint32_t    entrySize;
+} PropAreaHeader;
+
+typedef struct PropAreaEntry {
+    volatile uint32_t serial;
+    uint32_t    state;
+    char        key[PROPERTY_KEY_MAX];
+    char        value[PROPERTY_VALUE_MAX];
+} PropAreaEntry;
+
 /*
  * Define a thread that responds to requests from clients to get/set/list
  * system properties.
  */
 class PropertyServer : public wxThread {
 public:
-    PropertyServer(void) : mListenSock(-1) {}
+    PropertyServer(void)
+        : mListenSock(-1), mPropArea(NULL), mPropAreaSize(0),
+          mPropAreaMapped(false), mPropUsed(0)
+        {}
     virtual ~PropertyServer(void);
 
     /* start the thread running */
@@ -40,11 +86,11 @@ public:
     static const char* kPropCheckJni;
 
 private:
-    /* one property entry */
-    typedef struct Property {
-        char    key[PROPERTY_KEY_MAX];
-        char    value[PROPERTY_VALUE_MAX];
-    } Property;
+    /* set up the property area */
+    bool CreatePropArea(const char* fileName);
+
+    /* find the entry for "key", or where to insert it; NULL if full */
+    PropAreaEntry* FindEntry(const char* key, bool forInsert);
 
     /* create the UNIX-domain socket we listen on */
     bool CreateSocket(const char* fileName);
@@ -61,8 +107,14 @@ private:
     /* list of connected fds to scan */
     android::List<int>      mClientList;
 
-    /* set of known properties */
-    android::List<Property> mPropList;
+    /* set of known properties, shared with the runtime processes */
+    PropAreaHeader* mPropArea;
+    size_t  mPropAreaSize;
+    bool    mPropAreaMapped;        // false if we fell back to malloc
+    int     mPropUsed;              // live entries and tombstones
+
+    /* properties are set from the UI and device threads too */
+    wxMutex mPropLock;
 };
 
 #endif // PROPERTY_SERVER_H
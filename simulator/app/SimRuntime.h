@@ -19,6 +19,15 @@ namespace android {
 
 #define ANDROID_PIPE_NAME "runtime"
 
+/*
+ * Accessors for Simulator::FrameRing::state.
+ */
+#define FRAME_RING_LATEST(_s)   ((_s) & 3)          /* latest finished */
+#define FRAME_RING_SHOWN(_s)    (((_s) >> 2) & 3)   /* shown by the sim */
+#define FRAME_RING_SEQ(_s)      ((_s) >> 4)         /* frames published */
+#define FRAME_RING_STATE(_seq, _shown, _latest) \
+    (((_seq) << 4) | ((_shown) << 2) | (_latest))
+
 /*
  * Hold simulator state.
  */
@@ -63,6 +72,30 @@ public:
         kValuesPerDisplay = 5,
     };
 
+    /*
+     * Layout of the display shared memory.
+     *
+     * The segment starts with a FrameRing header, followed by kFrameSlots
+     * 24bpp frames at kFrameRingHeaderSize.  At any time one slot is being
+     * drawn by the runtime, one holds the latest finished frame, and one
+     * is being shown by the simulator.  "state" says which is which (the
+     * runtime owns the remaining slot) and counts the frames published so
+     * far.  Both sides only swap slots with compare-and-swap on "state",
+     * so neither ever waits for the other.
+     */
+    enum {
+        kFrameRingMagic = 0x46524e47,       // 'FRNG'
+        kFrameSlots = 3,
+        kFrameRingHeaderSize = 64,
+    };
+
+    typedef struct FrameRing {
+        int             magic;
+        int             numSlots;
+        int             slotSize;
+        volatile unsigned int state;
+    } FrameRing;
+
     /*
      * Set up communication with parent process.
      */
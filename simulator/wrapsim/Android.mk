@@ -23,13 +23,14 @@ LOCAL_SRC_FILES := \
 	Log.c \
 	SimMgr.c \
 	SysPower.c \
+	SysProps.c \
 	Util.c
 
 LOCAL_MODULE := libwrapsim
 
 # Relying on other Android libraries is probably a bad idea, since any
 # library or system calls they make could lead to recursive behavior.
-LOCAL_LDLIBS += -lpthread -ldl
+LOCAL_LDLIBS += -lpthread -ldl -lrt
 
 ifeq ($(BUILD_SIM_WITHOUT_AUDIO),true)
 LOCAL_CFLAGS += -DBUILD_SIM_WITHOUT_AUDIO=1
@@ -8,6 +8,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdint.h>
+#include <time.h>
 #include <alsa/asoundlib.h>
 
 #include <fcntl.h>
@@ -15,13 +20,217 @@
 #include <linux/input.h>
 
 
+/*
+ * The output format, 16-bit stereo at 44.1kHz.
+ */
+#define kAudioRate          44100
+#define kAudioFrameSize     4
+#define kAudioBytesPerSec   (kAudioRate * kAudioFrameSize)
+
+/*
+ * Writes go into a ring buffer that a playback thread drains to the
+ * device, or paces against the clock when we're faking it.  The ring is
+ * about 93ms long; the app only blocks once it is that far ahead, which
+ * is the latency a real device would give it.  Both sizes must be powers
+ * of two and multiples of the frame size.
+ */
+#define kAudioRingSize      16384
+#define kAudioChunkSize     4096
+
 /*
  * Input event device state.
+ *
+ * "head" is only advanced by the writer and "tail" by the playback thread,
+ * so the ring needs no lock.  Each side sets its "waiting" flag before it
+ * sleeps, and the other side posts the semaphore when it sees the flag.
  */
 typedef struct AudioState {
     snd_pcm_t *handle;
+
+    unsigned char*  ring;
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile int    writerWaiting;
+    volatile int    readerWaiting;
+    volatile int    stopping;
+    sem_t           spaceSem;
+    sem_t           dataSem;
+
+    pthread_t       thread;
+    int             threadStarted;
+    struct timespec deadline;       /* end of the faked playback */
+
+    volatile uint32_t underruns;    /* the device ran dry */
+    volatile uint32_t overruns;     /* the device stalled a writer */
 } AudioState;
 
+static int64_t timespecToNs(const struct timespec* ts)
+{
+    return ts->tv_sec * 1000000000LL + ts->tv_nsec;
+}
+
+/*
+ * Hand "count" bytes to the device.  Without one, we keep track of the
+ * absolute time the data handed so far is done playing, and sleep until
+ * one chunk is left before it, like a device with a two chunk buffer.
+ * Our wakeup jitter doesn't add up that way, and data coming after that
+ * time is an underrun.
+ */
+static void playChunk(AudioState* state, const unsigned char* buf,
+    uint32_t count)
+{
+    if (state->handle != NULL) {
+        snd_pcm_uframes_t frames = count / kAudioFrameSize;
+        while (frames > 0) {
+            snd_pcm_sframes_t cc = snd_pcm_writei(state->handle, buf, frames);
+            if (cc == -EPIPE) {
+                __sync_fetch_and_add(&state->underruns, 1);
+                snd_pcm_prepare(state->handle);
+                continue;
+            } else if (cc < 0) {
+                if (snd_pcm_recover(state->handle, cc, 1) < 0) {
+                    wsLog("Audio write failed: %s\n", snd_strerror(cc));
+                    return;
+                }
+                continue;
+            }
+            buf += cc * kAudioFrameSize;
+            frames -= cc;
+        }
+        return;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t nowNs = timespecToNs(&now);
+    int64_t end = timespecToNs(&state->deadline);
+    if (end < nowNs) {
+        if (end != 0)
+            __sync_fetch_and_add(&state->underruns, 1);
+        end = nowNs;
+    }
+    end += (int64_t) count * 1000000000LL / kAudioBytesPerSec;
+
+    state->deadline.tv_sec = end / 1000000000LL;
+    state->deadline.tv_nsec = end % 1000000000LL;
+
+    int64_t wake = end - (int64_t) kAudioChunkSize * 1000000000LL / kAudioBytesPerSec;
+    struct timespec wakeTime;
+    wakeTime.tv_sec = wake / 1000000000LL;
+    wakeTime.tv_nsec = wake % 1000000000LL;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+                &wakeTime, NULL) == EINTR)
+        ;
+}
+
+/*
+ * Playback thread.  Drains the ring a chunk at a time until the device
+ * is closed.
+ */
+static void* audioThreadEntry(void* arg)
+{
+    AudioState* state = (AudioState*) arg;
+
+    while (1) {
+        uint32_t avail = state->head - state->tail;
+
+        if (avail < kAudioFrameSize) {
+            if (state->stopping)
+                break;
+            state->readerWaiting = 1;
+            __sync_synchronize();
+            if (state->head - state->tail < kAudioFrameSize &&
+                !state->stopping)
+            {
+                while (sem_wait(&state->dataSem) != 0 && errno == EINTR)
+                    ;
+            }
+            state->readerWaiting = 0;
+            continue;
+        }
+
+        /* whole frames, without wrapping around the end of the ring */
+        uint32_t offset = state->tail & (kAudioRingSize - 1);
+        uint32_t count = avail;
+        if (count > kAudioChunkSize)
+            count = kAudioChunkSize;
+        if (count > kAudioRingSize - offset)
+            count = kAudioRingSize - offset;
+        count -= count % kAudioFrameSize;
+
+        playChunk(state, state->ring + offset, count);
+
+        __sync_synchronize();
+        state->tail += count;
+        __sync_synchronize();
+        if (state->writerWaiting) {
+            state->writerWaiting = 0;
+            sem_post(&state->spaceSem);
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Start the playback thread.  Returns 0 on success.
+ */
+static int startPlayback(AudioState* state)
+{
+    int cc;
+
+    state->ring = malloc(kAudioRingSize);
+    if (state->ring == NULL)
+        return -1;
+
+    if (sem_init(&state->spaceSem, 0, 0) != 0 ||
+        sem_init(&state->dataSem, 0, 0) != 0)
+    {
+        wsLog("Unable to create audio semaphores: %s\n", strerror(errno));
+        free(state->ring);
+        state->ring = NULL;
+        return -1;
+    }
+
+    cc = pthread_create(&state->thread, NULL, audioThreadEntry, state);
+    if (cc != 0) {
+        wsLog("Unable to create audio thread: %s\n", strerror(cc));
+        sem_destroy(&state->spaceSem);
+        sem_destroy(&state->dataSem);
+        free(state->ring);
+        state->ring = NULL;
+        return -1;
+    }
+
+    state->threadStarted = 1;
+    return 0;
+}
+
+/*
+ * Stop the playback thread once it has played what was written.
+ */
+static void stopPlayback(AudioState* state)
+{
+    if (!state->threadStarted)
+        return;
+
+    state->stopping = 1;
+    __sync_synchronize();
+    sem_post(&state->dataSem);
+    pthread_join(state->thread, NULL);
+
+    if (state->underruns != 0 || state->overruns != 0) {
+        wsLog("Audio closed: %u underruns, %u overruns\n",
+            state->underruns, state->overruns);
+    }
+
+    sem_destroy(&state->spaceSem);
+    sem_destroy(&state->dataSem);
+    free(state->ring);
+    state->ring = NULL;
+    state->threadStarted = 0;
+}
+
 /*
  * Set some stuff up.
  */
@@ -40,7 +249,7 @@ static int configureInitialState(const char* pathName, AudioState* audioState)
         snd_pcm_hw_params_any(audioState->handle, params);
         snd_pcm_hw_params_set_access(audioState->handle, params, SND_PCM_ACCESS_RW_INTERLEAVED);
         snd_pcm_hw_params_set_format(audioState->handle, params, SND_PCM_FORMAT_S16_LE);
-        unsigned int rate = 44100;
+        unsigned int rate = kAudioRate;
         snd_pcm_hw_params_set_rate_near(audioState->handle, params, &rate, NULL);
         snd_pcm_hw_params_set_channels(audioState->handle, params, 2);
         snd_pcm_hw_params(audioState->handle, params);
@@ -49,10 +258,68 @@ static int configureInitialState(const char* pathName, AudioState* audioState)
         wsLog("Couldn't open audio hardware, faking it\n");
     }
 
+    /* without the thread, writes go straight to the device */
+    if (startPlayback(audioState) != 0)
+        wsLog("Audio playback thread not started, writing synchronously\n");
+
     return 0;
 #endif
 }
 
+/*
+ * Copy as much of "buf" as fits into the ring, waiting for the playback
+ * thread to make room if it's full.
+ */
+static void queueAudio(AudioState* state, const unsigned char* buf,
+    size_t count)
+{
+    while (count > 0) {
+        uint32_t space = kAudioRingSize - (state->head - state->tail);
+
+        if (space == 0) {
+            /*
+             * Waiting for a chunk to play is the normal pacing.  Waiting
+             * longer than the whole ring lasts means the device stalled.
+             */
+            struct timespec start, end;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            state->writerWaiting = 1;
+            __sync_synchronize();
+            if (state->head - state->tail == kAudioRingSize) {
+                while (sem_wait(&state->spaceSem) != 0 && errno == EINTR)
+                    ;
+            }
+            state->writerWaiting = 0;
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            if (timespecToNs(&end) - timespecToNs(&start) >
+                (int64_t) kAudioRingSize * 1000000000LL / kAudioBytesPerSec)
+            {
+                __sync_fetch_and_add(&state->overruns, 1);
+            }
+            continue;
+        }
+
+        uint32_t offset = state->head & (kAudioRingSize - 1);
+        uint32_t chunk = space;
+        if (chunk > count)
+            chunk = count;
+        if (chunk > kAudioRingSize - offset)
+            chunk = kAudioRingSize - offset;
+
+        memcpy(state->ring + offset, buf, chunk);
+        __sync_synchronize();
+        state->head += chunk;
+        __sync_synchronize();
+        if (state->readerWaiting) {
+            state->readerWaiting = 0;
+            sem_post(&state->dataSem);
+        }
+
+        buf += chunk;
+        count -= chunk;
+    }
+}
+
 /*
  * Write audio data.
  */
@@ -62,6 +329,11 @@ static ssize_t writeAudio(FakeDev* dev, int fd, const void* buf, size_t count)
     return 0;
 #else
     AudioState *state = (AudioState*)dev->state;
+    if (state->threadStarted) {
+        queueAudio(state, buf, count);
+        return count;
+    }
+
     if (state->handle != NULL) {
         snd_pcm_writei(state->handle, buf, count / 4);
         return count;
@@ -90,7 +362,9 @@ static int closeAudio(FakeDev* dev, int fd)
     return 0;
 #else
     AudioState *state = (AudioState*)dev->state;
-    snd_pcm_close(state->handle);
+    stopPlayback(state);
+    if (state->handle != NULL)
+        snd_pcm_close(state->handle);
     free(state);
     dev->state = NULL;
     return 0;
@@ -127,7 +127,8 @@ static void handleAbsGet(int reqIdx, void* argp)
 /*
  * Return the next available input event.
  *
- * We just pass this through to the real "read", since "fd" is real.
+ * We just pass this through to the real "read", since "fd" is real.  It
+ * blocks only if the app opened the device without O_NONBLOCK.
  */
 static ssize_t readEvent(FakeDev* dev, int fd, void* buf, size_t count)
 {
@@ -251,7 +252,7 @@ static int closeEvent(FakeDev* dev, int fd)
  */
 FakeDev* wsOpenDevEvent(const char* pathName, int flags)
 {
-    FakeDev* newDev = wsCreateRealFakeDev(pathName);
+    FakeDev* newDev = wsCreateRealFakeDev(pathName, flags);
     if (newDev != NULL) {
         newDev->read = readEvent;
         newDev->write = writeEvent;
@@ -281,109 +282,100 @@ FakeDev* wsOpenDevEvent(const char* pathName, int flags)
 }
 
 /*
- * Write a key event.
+ * Events waiting to be written to the input device.
+ *
+ * The listener thread queues the events for each message from the
+ * simulator, and wsFlushSimInput() writes them with a single write once
+ * it has handled everything the simulator sent.  A burst of touch moves
+ * then costs the reader one wakeup instead of three per point.
+ *
+ * Only the simulator listener thread touches this.
  */
-static int sendKeyEvent(FakeDev* dev, int code, int isDown)
-{
-    struct input_event iev;
-    ssize_t actual;
-
-    gettimeofday(&iev.time, NULL);
-    iev.type = EV_KEY;
-    iev.code = code;
-    iev.value = (isDown != 0) ? 1 : 0;
-
-    actual = _ws_write(dev->otherFd, &iev, sizeof(iev));
-    if (actual != (ssize_t) sizeof(iev)) {
-        wsLog("WARNING: send key event partial write (%d of %d)\n",
-            actual, sizeof(iev));
-        return -1;
-    }
+#define kMaxQueuedEvents  192
 
-    return 0;
-}
+static struct {
+    struct input_event  events[kMaxQueuedEvents];
+    int                 count;
+    int                 lastDrag;   /* index of last movement, or -1 */
+} gInputQueue = { .lastDrag = -1 };
 
 /*
- * Write an absolute (touch screen) event.
+ * Add an event to the queue, flushing it first if it's full.
  */
-static int sendAbsButton(FakeDev* dev, int x, int y, int isDown)
+static void queueEvent(int type, int code, int value)
 {
-    struct input_event iev;
-    ssize_t actual;
-
-    wsLog("absButton x=%d y=%d down=%d\n", x, y, isDown);
+    struct input_event* piev;
 
-    gettimeofday(&iev.time, NULL);
-    iev.type = EV_KEY;
-    iev.code = BTN_TOUCH;
-    iev.value = (isDown != 0) ? 1 : 0;
+    if (gInputQueue.count == kMaxQueuedEvents)
+        wsFlushSimInput();
 
-    actual = _ws_write(dev->otherFd, &iev, sizeof(iev));
-    if (actual != (ssize_t) sizeof(iev)) {
-        wsLog("WARNING: send touch event partial write (%d of %d)\n",
-            actual, sizeof(iev));
-        return -1;
-    }
+    piev = &gInputQueue.events[gInputQueue.count++];
+    gettimeofday(&piev->time, NULL);
+    piev->type = type;
+    piev->code = code;
+    piev->value = value;
+}
 
-    return 0;
+/*
+ * Write a key event.
+ */
+static void sendKeyEvent(FakeDev* dev, int code, int isDown)
+{
+    queueEvent(EV_KEY, code, (isDown != 0) ? 1 : 0);
+    gInputQueue.lastDrag = -1;
 }
 
 /*
  * Write an absolute (touch screen) event.
  */
-static int sendAbsMovement(FakeDev* dev, int x, int y)
+static void sendAbsButton(FakeDev* dev, int x, int y, int isDown)
 {
-    struct input_event iev;
-    ssize_t actual;
-
-    wsLog("absMove x=%d y=%d\n", x, y);
-
-    gettimeofday(&iev.time, NULL);
-    iev.type = EV_ABS;
-    iev.code = ABS_X;
-    iev.value = x;
-
-    actual = _ws_write(dev->otherFd, &iev, sizeof(iev));
-    if (actual != (ssize_t) sizeof(iev)) {
-        wsLog("WARNING: send abs movement event partial X write (%d of %d)\n",
-            actual, sizeof(iev));
-        return -1;
-    }
+    wsLog("absButton x=%d y=%d down=%d\n", x, y, isDown);
 
-    iev.code = ABS_Y;
-    iev.value = y;
+    queueEvent(EV_KEY, BTN_TOUCH, (isDown != 0) ? 1 : 0);
+    gInputQueue.lastDrag = -1;
+}
 
-    actual = _ws_write(dev->otherFd, &iev, sizeof(iev));
-    if (actual != (ssize_t) sizeof(iev)) {
-        wsLog("WARNING: send abs movement event partial Y write (%d of %d)\n",
-            actual, sizeof(iev));
-        return -1;
-    }
+/*
+ * Write an absolute (touch screen) event.
+ */
+static void sendAbsMovement(FakeDev* dev, int x, int y)
+{
+    //wsLog("absMove x=%d y=%d\n", x, y);
 
-    return 0;
+    queueEvent(EV_ABS, ABS_X, x);
+    queueEvent(EV_ABS, ABS_Y, y);
 }
 
 /*
  * Not quite sure what this is for, but the emulator does it.
  */
-static int sendAbsSyn(FakeDev* dev)
+static void sendAbsSyn(FakeDev* dev)
 {
-    struct input_event iev;
-    ssize_t actual;
-
-    gettimeofday(&iev.time, NULL);
-    iev.type = EV_SYN;
-    iev.code = 0;
-    iev.value = 0;
-
-    actual = _ws_write(dev->otherFd, &iev, sizeof(iev));
-    if (actual != (ssize_t) sizeof(iev)) {
-        wsLog("WARNING: send abs movement syn (%d of %d)\n",
-            actual, sizeof(iev));
-        return -1;
+    queueEvent(EV_SYN, 0, 0);
+}
+
+/*
+ * Write everything queued for the input device.
+ */
+void wsFlushSimInput(void)
+{
+    FakeDev* dev = gWrapSim.keyInputDevice;
+    size_t len = gInputQueue.count * sizeof(struct input_event);
+
+    if (gInputQueue.count == 0)
+        return;
+
+    if (dev != NULL) {
+        ssize_t actual = _ws_write(dev->otherFd, gInputQueue.events, len);
+        if (actual != (ssize_t) len) {
+            wsLog("WARNING: input event partial write (%d of %d)\n",
+                (int) actual, (int) len);
+        }
     }
 
-    return 0;
+    gInputQueue.count = 0;
+    gInputQueue.lastDrag = -1;
 }
 
 /*
@@ -427,8 +419,26 @@ void wsSendSimTouchEvent(int action, int x, int y)
         sendAbsButton(dev, x, y, 0);
         sendAbsSyn(dev);
     } else if (action == kTouchDrag) {
-        sendAbsMovement(dev, x, y);
-        sendAbsSyn(dev);
+        /*
+         * Every point the simulator sent is passed on, each with its own
+         * SYN, unless we've been asked to keep only the latest position;
+         * then a move just updates the one that's still queued.
+         */
+        int last = gInputQueue.lastDrag;
+        if (gWrapSim.noTouchHistory && last >= 0) {
+            struct timeval now;
+            gettimeofday(&now, NULL);
+            gInputQueue.events[last].value = x;
+            gInputQueue.events[last+1].value = y;
+            gInputQueue.events[last].time = gInputQueue.events[last+1].time =
+                gInputQueue.events[last+2].time = now;
+        } else {
+            if (gInputQueue.count + 3 > kMaxQueuedEvents)
+                wsFlushSimInput();
+            gInputQueue.lastDrag = gInputQueue.count;
+            sendAbsMovement(dev, x, y);
+            sendAbsSyn(dev);
+        }
     } else {
         wsLog("WARNING: unexpected sim touch action  %d\n", action);
     }
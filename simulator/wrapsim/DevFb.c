@@ -8,11 +8,17 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <errno.h>
+#include <time.h>
 
 #include <sys/mman.h>
 #include <sys/ioctl.h>
 #include <linux/fb.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 typedef struct FbState {
 
     /* refcount for dup() */
@@ -24,6 +30,9 @@ typedef struct FbState {
     /* VRAM address, set by mmap() call */
     void*   vramAddr;
 
+    /* when the next synthetic vsync happens, CLOCK_MONOTONIC */
+    struct timespec nextVsync;
+
     /* kernel data structures */
     struct fb_var_screeninfo    vinfo;
     struct fb_fix_screeninfo    finfo;
@@ -92,15 +101,109 @@ static void freeState(FbState* fbState)
 
 /*
  * Wait for our synthetic vsync to happen.
+ *
+ * Vsyncs happen at a fixed rate no matter how long the frame took to
+ * draw, so we sleep until an absolute deadline rather than for a whole
+ * period.  If we fell behind, the vsyncs we missed are skipped, like a
+ * real display would.
  */
 static void waitForVsync(FbState* state)
 {
-    /* TODO: simulate a real interval */
-    usleep(1000000/60);
+    if (gWrapSim.noVsync)
+        return;
+
+    int refresh = gWrapSim.display[state->displayIdx].refresh;
+    if (refresh <= 0)
+        refresh = 60;
+    const int64_t period = 1000000000LL / refresh;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t nowNs = now.tv_sec * 1000000000LL + now.tv_nsec;
+    int64_t next = state->nextVsync.tv_sec * 1000000000LL +
+        state->nextVsync.tv_nsec;
+
+    if (next == 0) {
+        next = nowNs + period;
+    } else if (next <= nowNs) {
+        next += ((nowNs - next) / period + 1) * period;
+    }
+
+    state->nextVsync.tv_sec = next / 1000000000LL;
+    state->nextVsync.tv_nsec = next % 1000000000LL;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+                &state->nextVsync, NULL) == EINTR)
+        ;
 }
 
 /*
- * Forward pixels to the simulator.
+ * Convert "count" RGB565 pixels to 24-bit RGB.
+ *
+ * With SSE2 we expand 8 pixels at a time to 32-bit RGBx, squeeze them
+ * down to 24 bytes and store them with two unaligned 16-byte writes.  The
+ * second write runs 4 bytes past the end of the group, which is why we
+ * leave the last few pixels of the row to the scalar loop.
+ */
+static void convertRow565(const uint16_t* src, uint8_t* dst, int count)
+{
+    int x = 0;
+
+#ifdef __SSE2__
+    const __m128i mask5 = _mm_set1_epi16(0xf8);
+    const __m128i mask6 = _mm_set1_epi16(0xfc);
+    const __m128i lo24 = _mm_set_epi32(0, 0x00ffffff, 0, 0x00ffffff);
+    const __m128i hi24 = _mm_set_epi32(0x0000ffff, 0xff000000,
+                                       0x0000ffff, 0xff000000);
+    const __m128i lo48 = _mm_set_epi32(0, 0, 0x0000ffff, 0xffffffff);
+
+    for ( ; x + 10 <= count; x += 8) {
+        __m128i in = _mm_loadu_si128((const __m128i*)(src + x));
+        __m128i R, G, B, rg, px;
+
+        R = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(in, 8), mask5),
+                         _mm_srli_epi16(in, 13));
+        G = _mm_and_si128(_mm_srli_epi16(in, 3), mask6);
+        G = _mm_or_si128(G, _mm_srli_epi16(G, 6));
+        B = _mm_and_si128(_mm_slli_epi16(in, 3), mask5);
+        B = _mm_or_si128(B, _mm_srli_epi16(B, 5));
+        rg = _mm_or_si128(R, _mm_slli_epi16(G, 8));
+
+        /* RGBx RGBx -> RGBRGB in each 64-bit half, then join the halves */
+        px = _mm_unpacklo_epi16(rg, B);
+        px = _mm_or_si128(_mm_and_si128(px, lo24),
+                          _mm_and_si128(_mm_srli_epi64(px, 8), hi24));
+        px = _mm_or_si128(_mm_and_si128(px, lo48),
+                          _mm_andnot_si128(lo48, _mm_srli_si128(px, 2)));
+        _mm_storeu_si128((__m128i*)(dst + x*3), px);
+
+        px = _mm_unpackhi_epi16(rg, B);
+        px = _mm_or_si128(_mm_and_si128(px, lo24),
+                          _mm_and_si128(_mm_srli_epi64(px, 8), hi24));
+        px = _mm_or_si128(_mm_and_si128(px, lo48),
+                          _mm_andnot_si128(lo48, _mm_srli_si128(px, 2)));
+        _mm_storeu_si128((__m128i*)(dst + x*3 + 12), px);
+    }
+#endif
+
+    for ( ; x < count; x++) {
+        uint16_t in = src[x];
+        uint32_t R,G,B;
+        R = ((in>>8)&0xF8) | (in>>(8+5));
+        G = (in & 0x7E0)>>3;
+        G |= G>>6;
+        B = (in & 0x1F)<<3;
+        B |= B>>5;
+        dst[x*3+0] = R;
+        dst[x*3+1] = G;
+        dst[x*3+2] = B;
+    }
+}
+
+/* vinfo.reserved[0] value marking a dirty region, "UPDT" */
+#define kDirtyRegionTag 0x54445055
+
+/*
+ * Forward pixels to the simulator, converting only the dirty region.
  */
 static void sendPixelsToSim(FbState* state)
 {
@@ -112,56 +215,55 @@ static void sendPixelsToSim(FbState* state)
     //wsLog("+++ sending pixels to sim (disp=%d yoff=%d)\n",
     //    state->displayIdx, state->vinfo.yoffset);
 
-    wsLockDisplay(state->displayIdx);
-
-    uint8_t* dst = gWrapSim.display[state->displayIdx].addr;
-
     int l,t,r,b,w,h;
     w = gWrapSim.display[state->displayIdx].width;
     h = gWrapSim.display[state->displayIdx].height;
 
-#if 0
     /*
-     * TODO: surfaceflinger encodes the dirty region in vinfo.reserved[].  We
-     * can use that to perform a partial update.
+     * SurfaceFlinger encodes the dirty region in vinfo.reserved[]: an
+     * "UPDT" tag followed by the left/top and right/bottom corners packed
+     * as 16-bit values.  Everything outside of it is the same in both
+     * pages, so we only need to convert what's inside.  Without the tag
+     * (or with a bogus region) we fall back to the full screen.
      */
-    const Rect dirty(dirtyReg.bounds());
-    l = dirty.left  >=0 ? dirty.left : 0;
-    t = dirty.top   >=0 ? dirty.top  : 0;
-    r = dirty.right <=w ? dirty.right  : w;
-    b = dirty.bottom<=h ? dirty.bottom : h;
-#else
     l = t = 0;
     r = w;
     b = h;
-#endif
+    if (state->vinfo.reserved[0] == kDirtyRegionTag) {
+        int dl = state->vinfo.reserved[1] & 0xffff;
+        int dt = state->vinfo.reserved[1] >> 16;
+        int dr = state->vinfo.reserved[2] & 0xffff;
+        int db = state->vinfo.reserved[2] >> 16;
+        if (dr > w) dr = w;
+        if (db > h) db = h;
+        if (dl < dr && dt < db) {
+            l = dl;
+            t = dt;
+            r = dr;
+            b = db;
+        }
+    }
+
+    /*
+     * The frame slot we get may be a few frames old, in which case we
+     * must also redraw what changed since then.
+     */
+    int cl = l, ct = t, cr = r, cb = b;
+    uint8_t* dst = wsBeginDisplayUpdate(state->displayIdx,
+        &cl, &ct, &cr, &cb);
 
     /* find the right page */
     int ypage = state->vinfo.yoffset;
 
-    int x, y;
-    for (y = t ; y < b ; y++) {
+    int y;
+    for (y = ct ; y < cb ; y++) {
         // no "stride" issues with this display
-        uint8_t* outPtr = dst + (y*w+l)*3;
-        const uint16_t* ptr16 = (uint16_t*)state->vramAddr + ((y+ypage)*w+l);
-        for (x = l; x < r; x++) {
-            uint16_t in = *ptr16++;
-            uint32_t R,G,B;
-            R = ((in>>8)&0xF8) | (in>>(8+5));
-            G = (in & 0x7E0)>>3;
-            G |= G>>6;
-            B = (in & 0x1F)<<3;
-            B |= B>>5;
-            *outPtr++ = R;
-            *outPtr++ = G;
-            *outPtr++ = B;
-        }
+        convertRow565((uint16_t*)state->vramAddr + ((y+ypage)*w+cl),
+            dst + (y*w+cl)*3, cr - cl);
     }
 
-    wsUnlockDisplay(state->displayIdx);
-
-    /* notify the simulator */
-    wsPostDisplayUpdate(state->displayIdx);
+    /* publish the frame and notify the simulator */
+    wsEndDisplayUpdate(state->displayIdx, l, t, r, b);
 }
 
 /*
@@ -213,6 +213,46 @@ static const char* getPriorityString(int priority)
     return priorityStrings[idx];
 }
 
+/*
+ * Format the current time for a log header.
+ *
+ * The string only changes once a second, so each thread keeps the last
+ * one it made rather than calling localtime and strftime per message.
+ */
+static const char* getTimeString(void)
+{
+    static __thread time_t lastWhen = (time_t) -1;
+    static __thread char timeBuf[32];
+    time_t when = time(NULL);
+
+    if (when != lastWhen) {
+#if defined(HAVE_LOCALTIME_R)
+        struct tm tmBuf;
+#endif
+        struct tm* ptm;
+
+        /*
+         * Get the current date/time in pretty form
+         *
+         * It's often useful when examining a log with "less" to jump to
+         * a specific point in the file by searching for the date/time
+         * stamp.  For this reason it's very annoying to have regexp meta
+         * characters in the time stamp.  Don't use forward slashes,
+         * parenthesis, brackets, asterisks, or other special chars here.
+         */
+#if defined(HAVE_LOCALTIME_R)
+        ptm = localtime_r(&when, &tmBuf);
+#else
+        ptm = localtime(&when);
+#endif
+        //strftime(timeBuf, sizeof(timeBuf), "%Y-%m-%d %H:%M:%S", ptm);
+        strftime(timeBuf, sizeof(timeBuf), "%m-%d %H:%M:%S", ptm);
+        lastWhen = when;
+    }
+
+    return timeBuf;
+}
+
 /*
  * Show a log message.  We write it to stderr and send a copy to the
  * simulator front-end for the log window.
@@ -223,40 +263,16 @@ static void showLog(FakeDev* dev, int logPrio, const char* tag, const char* msg)
 {
     LogState* state = (LogState*) dev->state;
 
-#if defined(HAVE_LOCALTIME_R)
-    struct tm tmBuf;
-#endif
-    struct tm* ptm;
-    char timeBuf[32];
     char prefixBuf[128], suffixBuf[128];
     char priChar;
-    time_t when;
     pid_t pid, tid;
 
     //wsLog("LOG %d: %s %s", logPrio, tag, msg);
     wsPostLogMessage(logPrio, tag, msg);
 
     priChar = getPriorityString(logPrio)[0];
-    when = time(NULL);
     pid = tid = getpid();       // find gettid()?
 
-    /*
-     * Get the current date/time in pretty form
-     *
-     * It's often useful when examining a log with "less" to jump to
-     * a specific point in the file by searching for the date/time stamp.
-     * For this reason it's very annoying to have regexp meta characters
-     * in the time stamp.  Don't use forward slashes, parenthesis,
-     * brackets, asterisks, or other special chars here.
-     */
-#if defined(HAVE_LOCALTIME_R)
-    ptm = localtime_r(&when, &tmBuf);
-#else
-    ptm = localtime(&when);
-#endif
-    //strftime(timeBuf, sizeof(timeBuf), "%Y-%m-%d %H:%M:%S", ptm);
-    strftime(timeBuf, sizeof(timeBuf), "%m-%d %H:%M:%S", ptm);
-
     /*
      * Construct a buffer containing the log header and log message.
      */
@@ -285,13 +301,13 @@ static void showLog(FakeDev* dev, int logPrio, const char* tag, const char* msg)
         break;
     case FORMAT_TIME:
         prefixLen = snprintf(prefixBuf, sizeof(prefixBuf),
-            "%s %-8s\n\t", timeBuf, tag);
+            "%s %-8s\n\t", getTimeString(), tag);
         strcpy(suffixBuf, "\n"); suffixLen = 1;
         break;
     case FORMAT_LONG:
         prefixLen = snprintf(prefixBuf, sizeof(prefixBuf),
             "[ %s %5d:%p %c/%-8s ]\n",
-            timeBuf, pid, (void*)tid, priChar, tag);
+            getTimeString(), pid, (void*)tid, priChar, tag);
         strcpy(suffixBuf, "\n\n"); suffixLen = 2;
         break;
     default:
@@ -32,16 +32,23 @@ a small risk of application fds wandering into our range, but we can
 minimize that by asserting on a "guard zone" and/or obstructing dup2().
 (We can also dup2(/dev/null) to "reserve" our fds, but that wastes
 resources.)
+
+Only devices that hand data *to* the app need a real fd, since that's
+what the app waits on.  Today that's just the input event device, which
+the simulator feeds through the other end of its socketpair; the event
+hub can poll() it alongside everything else.  Log, audio and the console
+tty are sinks, and the power files are read on demand, so those stay
+fake.
 */
 
 #include "Common.h"
 
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <assert.h>
-#include <fnmatch.h>
 
 /*
  * Devices we intercept.
@@ -53,28 +60,76 @@ resources.)
 typedef FakeDev* (*wsFileHook)(const char *path, int flags);
 
 typedef struct FakedPath {
-    const char *pathexpr;
+    const char *path;       /* full path, or prefix if "isPrefix" */
+    size_t pathLen;
+    int isPrefix;
     wsFileHook hook;
 } FakedPath;
 
-FakedPath fakedpaths[] =
+/*
+ * Exact paths, and prefixes that match everything below a directory.
+ * Lengths are worked out at compile time so the lookup is a few memcmp
+ * calls, rather than an fnmatch() per entry.
+ */
+#define FAKE_PATH(_path, _hook)     { _path, sizeof(_path)-1, 0, _hook }
+#define FAKE_PREFIX(_path, _hook)   { _path, sizeof(_path)-1, 1, _hook }
+
+/* everything below must live under one of these */
+#define kFakeRootLen 5          /* strlen("/dev/") == strlen("/sys/") */
+
+static const FakedPath fakedDevPaths[] =
 {
-    { "/dev/graphics/fb0",      wsOpenDevFb },
-    { "/dev/hw3d",              NULL },
-    { "/dev/eac",               wsOpenDevAudio },
-    { "/dev/tty0",              wsOpenDevConsoleTty },
-    { "/dev/input/event0",      wsOpenDevEvent },
-    { "/dev/input/*",           NULL },
-    { "/dev/log/*",             wsOpenDevLog },
-    { "/sys/class/power_supply/*", wsOpenDevPower },
-    { "/sys/power/state",       wsOpenSysPower },
-    { "/sys/power/wake_lock",   wsOpenSysPower },
-    { "/sys/power/wake_unlock", wsOpenSysPower },
-    { "/sys/devices/platform/android-vibrator/enable",  wsOpenDevVibrator },
-    { "/sys/qemu_trace/*",      NULL },
-    { NULL,                     NULL }
+    FAKE_PATH("/dev/graphics/fb0",      wsOpenDevFb),
+    FAKE_PATH("/dev/hw3d",              NULL),
+    FAKE_PATH("/dev/eac",               wsOpenDevAudio),
+    FAKE_PATH("/dev/tty0",              wsOpenDevConsoleTty),
+    FAKE_PATH("/dev/input/event0",      wsOpenDevEvent),
+    FAKE_PREFIX("/dev/input/",          NULL),
+    FAKE_PREFIX("/dev/log/",            wsOpenDevLog),
+    { NULL, 0, 0, NULL }
 };
 
+static const FakedPath fakedSysPaths[] =
+{
+    FAKE_PREFIX("/sys/class/power_supply/", wsOpenDevPower),
+    FAKE_PATH("/sys/power/state",       wsOpenSysPower),
+    FAKE_PATH("/sys/power/wake_lock",   wsOpenSysPower),
+    FAKE_PATH("/sys/power/wake_unlock", wsOpenSysPower),
+    FAKE_PATH("/sys/devices/platform/android-vibrator/enable",  wsOpenDevVibrator),
+    FAKE_PREFIX("/sys/qemu_trace/",     NULL),
+    { NULL, 0, 0, NULL }
+};
+
+/*
+ * Find the entry for "pathName", or NULL if it isn't one of ours.  Most
+ * paths are rejected by looking at the first component.
+ */
+static const FakedPath* findFakedPath(const char* pathName)
+{
+    const FakedPath* p;
+    size_t len;
+
+    if (pathName[0] != '/')
+        return NULL;
+    if (pathName[1] == 'd' && strncmp(pathName, "/dev/", kFakeRootLen) == 0)
+        p = fakedDevPaths;
+    else if (pathName[1] == 's' &&
+             strncmp(pathName, "/sys/", kFakeRootLen) == 0)
+        p = fakedSysPaths;
+    else
+        return NULL;
+
+    len = strlen(pathName);
+    for ( ; p->path != NULL; p++) {
+        if (p->isPrefix ? len < p->pathLen : len != p->pathLen)
+            continue;
+        if (memcmp(pathName + kFakeRootLen, p->path + kFakeRootLen,
+                p->pathLen - kFakeRootLen) == 0)
+            return p;
+    }
+    return NULL;
+}
+
 
 /*
  * Generic drop-in for an unimplemented call.
@@ -183,7 +238,7 @@ FakeDev* wsCreateFakeDev(const char* debugName)
  * Create a new FakeDev entry, and open a file descriptor that actually
  * works.
  */
-FakeDev* wsCreateRealFakeDev(const char* debugName)
+FakeDev* wsCreateRealFakeDev(const char* debugName, int flags)
 {
     FakeDev* newDev = wsCreateFakeDev(debugName);
     if (newDev == NULL)
@@ -205,6 +260,16 @@ FakeDev* wsCreateRealFakeDev(const char* debugName)
     }
     close(fds[0]);
 
+    /*
+     * Give the app the blocking behavior it asked for.  A poll()-driven
+     * reader opens with O_NONBLOCK and must never stall in read().
+     */
+    if ((flags & O_NONBLOCK) != 0)
+        fcntl(newDev->fd, F_SETFL, fcntl(newDev->fd, F_GETFL) | O_NONBLOCK);
+    if ((flags & O_CLOEXEC) != 0)
+        fcntl(newDev->fd, F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
     /* okay to leave this one in the "normal" range; not visible to app */
     newDev->otherFd = fds[1];
 
@@ -264,29 +329,26 @@ FakeDev* wsFakeDevFromFd(int fd)
  */
 int wsInterceptDeviceOpen(const char* pathName, int flags)
 {
-    FakedPath* p = fakedpaths;
-
-    while (p->pathexpr) {
-        if (fnmatch(p->pathexpr, pathName, 0) == 0) {
-            if (p->hook != NULL) {
-                FakeDev* dev = p->hook(pathName, flags);
-                if (dev != NULL) {
-                    /*
-                     * Now that the device entry is ready, add it to the list.
-                     */
-                    wsLog("## created fake dev %d: '%s' %p\n",
-                        dev->fd, dev->debugName, dev->state);
-                    gWrapSim.fakeFdList[dev->fd - kFakeFdBase] = dev;
-                    return dev->fd;
-                }
-            } else {
-                wsLog("## rejecting attempt to open %s\n", pathName);
-                errno = ENOENT;
-                return -2;
-            }
-            break;
+    const FakedPath* p = findFakedPath(pathName);
+
+    if (p == NULL)
+        return -1;
+
+    if (p->hook != NULL) {
+        FakeDev* dev = p->hook(pathName, flags);
+        if (dev != NULL) {
+            /*
+             * Now that the device entry is ready, add it to the list.
+             */
+            wsLog("## created fake dev %d: '%s' %p\n",
+                dev->fd, dev->debugName, dev->state);
+            gWrapSim.fakeFdList[dev->fd - kFakeFdBase] = dev;
+            return dev->fd;
         }
-        p++;
+    } else {
+        wsLog("## rejecting attempt to open %s\n", pathName);
+        errno = ENOENT;
+        return -2;
     }
     return -1;
 }
@@ -300,20 +362,16 @@ int wsInterceptDeviceOpen(const char* pathName, int flags)
  */
 int wsInterceptDeviceAccess(const char *pathName, int mode)
 {
-    FakedPath *p = fakedpaths;
-
-    while (p->pathexpr) {
-        if (fnmatch(p->pathexpr, pathName, 0) == 0) {
-            if (p->hook) {
-                return 0;
-            } else {
-                wsLog("## rejecting attempt to open %s\n", pathName);
-                errno = ENOENT;
-                return -2;
-            }
-            break;
+    const FakedPath* p = findFakedPath(pathName);
+
+    if (p != NULL) {
+        if (p->hook) {
+            return 0;
+        } else {
+            wsLog("## rejecting attempt to open %s\n", pathName);
+            errno = ENOENT;
+            return -2;
         }
-        p++;
     }
     errno = ENOENT;
     return -1;
@@ -71,9 +71,11 @@ struct FakeDev {
 FakeDev* wsCreateFakeDev(const char* debugName);
 
 /*
- * Create a new, mostly fake device entry.
+ * Create a new, mostly fake device entry, backed by one end of a
+ * socketpair so it works with poll() and select().  O_NONBLOCK and
+ * O_CLOEXEC in "flags" are applied to the app's end.
  */
-FakeDev* wsCreateRealFakeDev(const char* debugName);
+FakeDev* wsCreateRealFakeDev(const char* debugName, int flags);
 
 /*
  * Free a fake device entry.
@@ -123,4 +125,9 @@ void wsSendSimKeyEvent(int key, int isDown);
  */
 void wsSendSimTouchEvent(int action, int x, int y);
 
+/*
+ * Write the events queued by the above to the input event device.
+ */
+void wsFlushSimInput(void);
+
 #endif /*_WRAPSIM_FAKEDEV_H*/
@@ -184,15 +184,25 @@ struct WrapSimGlobals {
     struct {
         int     width;
         int     height;
+        int     refresh;        /* frames per second */
 
         int     shmemKey;
         int     shmid;
         void*   addr;
         long    length;
-        int     semid;
+
+        /* slot being drawn, and what changed since each slot was drawn */
+        int     drawSlot;
+        struct { int left, top, right, bottom; } stale[kFrameSlots];
     } display[kMaxDisplays];
     int     numDisplays;
 
+    /* don't wait for vsync at all, for benchmark runs */
+    int     noVsync;
+
+    /* pass on only the latest point of a burst of touch moves */
+    int     noTouchHistory;
+
     /*
      * Input device.
      */
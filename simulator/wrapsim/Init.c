@@ -113,6 +113,13 @@ static void initGlobals(void)
 
     gWrapSim.numDisplays = 0;
 
+    /* WRAPSIM_NO_VSYNC lets the framebuffer flip as fast as it's drawn */
+    gWrapSim.noVsync = (getenv("WRAPSIM_NO_VSYNC") != NULL);
+    if (gWrapSim.noVsync)
+        wsLog("--- vsync disabled\n");
+
+    gWrapSim.noTouchHistory = (getenv("WRAPSIM_NO_TOUCH_HISTORY") != NULL);
+
     gWrapSim.keyInputDevice = NULL;
 
     /*
@@ -122,22 +122,34 @@ want to show "fake" directory contents -- we would need:
 static const char* rewritePath(const char* func, char* pathBuf,
     const char* origPath)
 {
+    size_t len;
+
     /*
-     * Rewrite paths that start with "/system/" or "/data/"
+     * Rewrite paths that start with "/system/" or "/data/".  This is on
+     * the path of every stat() and open(), so reject on the first letter
+     * of the first component before comparing names.
      */
     if (origPath[0] != '/')
-        goto skip_rewrite;
+        return origPath;
     while (origPath[1] == '/') origPath++; // some apps like to use paths like '//data/data/....'
-    if (memcmp(origPath+1, "system", 6) == 0 &&
-        (origPath[7] == '/' || origPath[7] == '\0'))
-            goto do_rewrite;
-    if (memcmp(origPath+1, "data", 4) == 0 &&
-        (origPath[5] == '/' || origPath[5] == '\0'))
-            goto do_rewrite;
-
-skip_rewrite:
+    switch (origPath[1]) {
+    case 's':
+        if (strncmp(origPath+1, "system", 6) == 0 &&
+            (origPath[7] == '/' || origPath[7] == '\0'))
+                goto do_rewrite;
+        break;
+    case 'd':
+        if (strncmp(origPath+1, "data", 4) == 0 &&
+            (origPath[5] == '/' || origPath[5] == '\0'))
+                goto do_rewrite;
+        break;
+    default:
+        break;
+    }
+
     /* check to see if something is side-stepping the rewrite */
-    if (memcmp(origPath, gWrapSim.remapBaseDir, gWrapSim.remapBaseDirLen) == 0)
+    if (origPath[1] == gWrapSim.remapBaseDir[1] &&
+        strncmp(origPath, gWrapSim.remapBaseDir, gWrapSim.remapBaseDirLen) == 0)
     {
         wsLog("NOTE: full path used: %s(%s)\n", func, origPath);
     }
@@ -146,8 +158,15 @@ skip_rewrite:
     return origPath;
 
 do_rewrite:
+    len = strlen(origPath);
+    if (gWrapSim.remapBaseDirLen + len >= PATH_MAX) {
+        /* fail the call rather than let it reach the host's /system */
+        wsLog("WARNING: path too long to rewrite: %s(%s)\n", func, origPath);
+        pathBuf[0] = '\0';
+        return pathBuf;
+    }
     memcpy(pathBuf, gWrapSim.remapBaseDir, gWrapSim.remapBaseDirLen);
-    strcpy(pathBuf + gWrapSim.remapBaseDirLen, origPath);
+    memcpy(pathBuf + gWrapSim.remapBaseDirLen, origPath, len + 1);
     CALLTRACE("rewrite %s('%s') --> '%s'\n", func, origPath, pathBuf);
     return pathBuf;
 }
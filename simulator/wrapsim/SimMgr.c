@@ -9,6 +9,8 @@
  */
 #include "Common.h"
 
+#include "cutils/logd.h"
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
@@ -19,6 +21,7 @@
 #include <sys/sem.h>
 #include <sys/un.h>
 #include <signal.h>
+#include <semaphore.h>
 #include <assert.h>
 
 // fwd
@@ -165,13 +168,34 @@ typedef enum MessageType {
 
 /*
  * Reusable message object.
+ *
+ * Messages never own their data: received messages point into the
+ * receive buffer, and commands are built in "mInline".
  */
 typedef struct Message {
     MessageType     mType;
     unsigned char*  mData;
     int             mLength;
+    int             mInline[4];
 } Message;
 
+/*
+ * Receive buffer.  We read as much as the socket has for us and parse
+ * messages in place, rather than making two reads and a malloc per
+ * message; a drag across the touch screen sends a lot of them.
+ *
+ * There is one simulator connection, read from one thread at a time,
+ * so one buffer will do.  It holds the largest possible message.
+ */
+#define kMaxMessageLen  65535               /* 16-bit length field */
+#define kRecvBufSize    (kMaxMessageLen + 4)
+
+static struct {
+    int     buf[(kRecvBufSize + 3) / 4];
+    int     aligned[(kMaxMessageLen + 3) / 4];  /* for misaligned bodies */
+    int     start, end;                         /* unparsed data */
+} gRecvBuf;
+
 /* magic init messages; must match android::MessageStream constants */
 enum {
     kHelloMsg       = 0x4e303047,       // 'N00G'
@@ -187,37 +211,6 @@ static void Message_clear(Message* msg)
     memset(msg, 0, sizeof(Message));
 }
 
-/*
- * Keep reading until we get all bytes or hit EOF/error.  "fd" is expected
- * to be in blocking mode.
- *
- * Returns 0 on success.
- */
-static int readAll(int fd, void* buf, size_t count)
-{
-    ssize_t actual;
-    ssize_t have;
-
-    have = 0;
-    while (have != (ssize_t) count) {
-        actual = _ws_read(fd, ((char*) buf) + have, count - have);
-        if (actual < 0) {
-            if (errno == EINTR)
-                continue;
-            wsLog("read %d failed: %s\n", fd, strerror(errno));
-        } else if (actual == 0) {
-            wsLog("early EOF on %d\n", fd);
-            return -1;
-        } else {
-            have += actual;
-        }
-
-        assert(have <= (ssize_t)count);
-    }
-
-    return 0;
-}
-
 #if 0
 /*
  * Keep writing until we put all bytes or hit an error.  "fd" is expected
@@ -254,39 +247,76 @@ static int writeAll(int fd, const void* buf, size_t count)
 /*
  * Read a message from the specified file descriptor.
  *
- * The caller must Message_release(&msg).
+ * "msg->mData" points into the receive buffer, and is only good until
+ * the next call.  The caller must still Message_release(&msg).
  *
  * We guarantee 32-bit alignment for msg->mData.
  */
 static int Message_read(Message* msg, int fd)
 {
-    unsigned char header[4];
+    unsigned char* buf = (unsigned char*) gRecvBuf.buf;
 
-    readAll(fd, header, 4);
+    while (1) {
+        int avail = gRecvBuf.end - gRecvBuf.start;
+        ssize_t actual;
 
-    msg->mType = (MessageType) header[2];
-    msg->mLength = header[0] | header[1] << 8;
-    msg->mLength -= 2;   // we already read two of them in the header
+        if (avail >= 4) {
+            unsigned char* header = buf + gRecvBuf.start;
+            int len = (header[0] | header[1] << 8) + 2;
 
-    if (msg->mLength > 0) {
-        int actual;
+            if (len < 4) {
+                wsLog("bad message length %d\n", len);
+                return -1;
+            }
+            if (avail >= len) {
+                msg->mType = (MessageType) header[2];
+                msg->mLength = len - 4;
+                msg->mData = NULL;
+                if (msg->mLength > 0) {
+                    msg->mData = header + 4;
+                    if (((uintptr_t) msg->mData & 3) != 0) {
+                        memcpy(gRecvBuf.aligned, msg->mData, msg->mLength);
+                        msg->mData = (unsigned char*) gRecvBuf.aligned;
+                    }
+                }
+                gRecvBuf.start += len;
+                return 0;
+            }
+        }
 
-        /* Linux malloc guarantees at least 32-bit alignment */
-        msg->mData = (unsigned char*) malloc(msg->mLength);
-        if (msg->mData == NULL) {
-            wsLog("alloc %d failed\n", msg->mLength);
-            return -1;
+        /* need more; slide the partial message to the front first */
+        if (gRecvBuf.start > 0) {
+            memmove(buf, buf + gRecvBuf.start, avail);
+            gRecvBuf.start = 0;
+            gRecvBuf.end = avail;
         }
 
-        if (readAll(fd, msg->mData, msg->mLength) != 0) {
-            wsLog("failed reading message body (wanted %d)\n", msg->mLength);
+        actual = _ws_read(fd, buf + gRecvBuf.end,
+                    kRecvBufSize - gRecvBuf.end);
+        if (actual < 0) {
+            if (errno == EINTR)
+                continue;
+            wsLog("read %d failed: %s\n", fd, strerror(errno));
+            return -1;
+        } else if (actual == 0) {
+            wsLog("early EOF on %d\n", fd);
             return -1;
         }
-    } else {
-        msg->mData = NULL;
+        gRecvBuf.end += actual;
     }
+}
 
-    return 0;
+/*
+ * Returns nonzero if Message_read() has a whole message buffered, and
+ * won't have to wait for one.
+ */
+static int Message_pending(void)
+{
+    const unsigned char* header =
+        (const unsigned char*) gRecvBuf.buf + gRecvBuf.start;
+    int avail = gRecvBuf.end - gRecvBuf.start;
+
+    return avail >= 4 && avail >= (header[0] | header[1] << 8) + 2;
 }
 
 /*
@@ -333,7 +363,6 @@ static int Message_write(Message* msg, int fd)
  */
 static void Message_release(Message* msg)
 {
-    free(msg->mData);
     msg->mData = NULL;
 }
 
@@ -399,26 +428,45 @@ static int getCommandExt(const Message* msg, int* pCmd, int* pArg0,
 /*
  * Attach 8 bytes of data with "cmd" and "arg" to "msg".
  *
- * "msg->mData" will need to be freed by the caller.  (This approach made
- * more sense when C++ destructors were available, but it's just not worth
- * reworking it.)
+ * The data lives in "msg" itself.
  */
 static int setCommand(Message* msg, int cmd, int arg)
 {
     Message_clear(msg);
 
     msg->mLength = 8;
-    msg->mData = malloc(msg->mLength);
+    msg->mData = (unsigned char*) msg->mInline;
     msg->mType = kTypeCommand;
 
-    /* assumes 32-bit alignment on malloc blocks */
-    int* pInt = (int*) msg->mData;
+    int* pInt = msg->mInline;
     pInt[0] = cmd;
     pInt[1] = arg;
 
     return 0;
 }
 
+/*
+ * Attach 16 bytes of data with "cmd" and three args to "msg".
+ *
+ * The data lives in "msg" itself.
+ */
+static int setCommandExt(Message* msg, int cmd, int arg0, int arg1, int arg2)
+{
+    Message_clear(msg);
+
+    msg->mLength = 16;
+    msg->mData = (unsigned char*) msg->mInline;
+    msg->mType = kTypeCommandExt;
+
+    int* pInt = msg->mInline;
+    pInt[0] = cmd;
+    pInt[1] = arg0;
+    pInt[2] = arg1;
+    pInt[3] = arg2;
+
+    return 0;
+}
+
 /*
  * Construct the full path.  The caller must free() the return value.
  */
@@ -471,70 +519,91 @@ static int attachToShmem(int key, int* pShmid, void** pAddr, long* pLength)
 }
 
 /*
- * Attach to a SysV semaphore.
+ * Grow a rectangle to also cover another one.
  */
-static int attachToSem(int key, int* pSemid)
+static void unionRect(int* pLeft, int* pTop, int* pRight, int* pBottom,
+    int left, int top, int right, int bottom)
 {
-    int semid;
-
-    semid = semget(key, 0, 0);
-    if (semid == -1) {
-        wsLog("ERROR: failed to attach to semaphore key=%d\n", key);
-        return -1;
+    if (left >= right || top >= bottom)
+        return;
+    if (*pLeft >= *pRight || *pTop >= *pBottom) {
+        *pLeft = left;
+        *pTop = top;
+        *pRight = right;
+        *pBottom = bottom;
+        return;
     }
-
-    *pSemid = semid;
-    return 0;
+    if (left < *pLeft)      *pLeft = left;
+    if (top < *pTop)        *pTop = top;
+    if (right > *pRight)    *pRight = right;
+    if (bottom > *pBottom)  *pBottom = bottom;
 }
 
 /*
- * "Adjust" a semaphore.
+ * Get the frame slot to draw the next frame of a display into.
+ *
+ * The slot still holds whatever frame we drew into it last, so the
+ * rectangle is grown to cover everything that changed since then.  The
+ * caller must redraw all of it.
  */
-static int adjustSem(int semid, int adj)
+unsigned char* wsBeginDisplayUpdate(int displayIdx, int* pLeft, int* pTop,
+    int* pRight, int* pBottom)
 {
-    const int wait = 1;
-    struct sembuf op;
-    int cc;
+    assert(displayIdx >= 0 && displayIdx < gWrapSim.numDisplays);
+    FrameRing* ring = (FrameRing*) gWrapSim.display[displayIdx].addr;
 
-    op.sem_num = 0;
-    op.sem_op = adj;
-    op.sem_flg = SEM_UNDO;
-    if (!wait)
-        op.sem_flg |= IPC_NOWAIT;
+    /* the simulator only swaps the other two slots, so this one is ours */
+    unsigned int state = ring->state;
+    int slot = 3 - FRAME_RING_LATEST(state) - FRAME_RING_SHOWN(state);
+    gWrapSim.display[displayIdx].drawSlot = slot;
 
-    cc = semop(semid, &op, 1);
-    if (cc != 0) {
-        if (wait || errno != EAGAIN) {
-            wsLog("Warning:"
-                " semaphore adjust by %d failed for semid=%d (errno=%d)\n",
-                adj, semid, errno);
-        }
-        return -1;
-    }
+    unionRect(pLeft, pTop, pRight, pBottom,
+        gWrapSim.display[displayIdx].stale[slot].left,
+        gWrapSim.display[displayIdx].stale[slot].top,
+        gWrapSim.display[displayIdx].stale[slot].right,
+        gWrapSim.display[displayIdx].stale[slot].bottom);
 
-    return 0;
+    return (unsigned char*) ring + kFrameRingHeaderSize +
+        slot * ring->slotSize;
 }
 
 /*
- * Acquire the semaphore associated with a display.
+ * Publish the frame drawn since wsBeginDisplayUpdate() as the latest one,
+ * and tell the simulator.  The rectangle is what changed in this frame.
  */
-void wsLockDisplay(int displayIdx)
+void wsEndDisplayUpdate(int displayIdx, int left, int top, int right,
+    int bottom)
 {
     assert(displayIdx >= 0 && displayIdx < gWrapSim.numDisplays);
-    int semid = gWrapSim.display[displayIdx].semid;
+    FrameRing* ring = (FrameRing*) gWrapSim.display[displayIdx].addr;
+    int slot = gWrapSim.display[displayIdx].drawSlot;
+    int i;
 
-    (void) adjustSem(semid, -1);
-}
+    for (i = 0; i < kFrameSlots; i++) {
+        if (i == slot) {
+            gWrapSim.display[displayIdx].stale[i].left = 0;
+            gWrapSim.display[displayIdx].stale[i].top = 0;
+            gWrapSim.display[displayIdx].stale[i].right = 0;
+            gWrapSim.display[displayIdx].stale[i].bottom = 0;
+        } else {
+            unionRect(&gWrapSim.display[displayIdx].stale[i].left,
+                &gWrapSim.display[displayIdx].stale[i].top,
+                &gWrapSim.display[displayIdx].stale[i].right,
+                &gWrapSim.display[displayIdx].stale[i].bottom,
+                left, top, right, bottom);
+        }
+    }
 
-/*
- * Acquire the semaphore associated with a display.
- */
-void wsUnlockDisplay(int displayIdx)
-{
-    assert(displayIdx >= 0 && displayIdx < gWrapSim.numDisplays);
-    int semid = gWrapSim.display[displayIdx].semid;
+    /* our slot becomes the latest, the previous latest is ours next */
+    unsigned int state, newState;
+    do {
+        state = ring->state;
+        newState = FRAME_RING_STATE(FRAME_RING_SEQ(state) + 1,
+            FRAME_RING_SHOWN(state), slot);
+    } while (__sync_val_compare_and_swap(&ring->state, state, newState)
+            != state);
 
-    (void) adjustSem(semid, 1);
+    wsPostDisplayUpdate(displayIdx, left, top, right, bottom);
 }
 
 /*
@@ -586,11 +655,12 @@ static int handleDisplayConfig(const int* pData, int length)
     for (i = 0; i < numDisplays; i++) {
         gWrapSim.display[i].width = pData[0];
         gWrapSim.display[i].height = pData[1];
+        gWrapSim.display[i].refresh = pData[3];
         gWrapSim.display[i].shmemKey = pData[4];
-        /* format/refresh no longer needed */
+        /* format no longer needed */
 
         void* addr;
-        int shmid, semid;
+        int shmid;
         long length;
         if (attachToShmem(gWrapSim.display[i].shmemKey, &shmid, &addr,
                 &length) != 0)
@@ -599,25 +669,38 @@ static int handleDisplayConfig(const int* pData, int length)
             return -1;
         }
 
-        if (attachToSem(gWrapSim.display[i].shmemKey, &semid) != 0) {
-            wsLog("Unable to attach to sempahore\n");
+        const FrameRing* ring = (const FrameRing*) addr;
+        int frameSize = pData[0] * pData[1] * 3;
+        if (ring->magic != kFrameRingMagic || ring->numSlots != kFrameSlots ||
+            ring->slotSize < frameSize ||
+            length < kFrameRingHeaderSize + kFrameSlots * ring->slotSize)
+        {
+            wsLog("Bad display shared memory (magic=0x%08x)\n", ring->magic);
             return -1;
         }
 
         gWrapSim.display[i].shmid = shmid;
         gWrapSim.display[i].addr = addr;
         gWrapSim.display[i].length = length;
-        gWrapSim.display[i].semid = semid;
 
-        wsLog("Display %d: width=%d height=%d\n",
+        /* we don't know what the slots hold, so redraw them fully */
+        int j;
+        for (j = 0; j < kFrameSlots; j++) {
+            gWrapSim.display[i].stale[j].left = 0;
+            gWrapSim.display[i].stale[j].top = 0;
+            gWrapSim.display[i].stale[j].right = pData[0];
+            gWrapSim.display[i].stale[j].bottom = pData[1];
+        }
+
+        wsLog("Display %d: width=%d height=%d refresh=%d\n",
             i,
             gWrapSim.display[i].width,
-            gWrapSim.display[i].height);
-        wsLog("  shmem=0x%08x addr=%p len=%ld semid=%d\n",
+            gWrapSim.display[i].height,
+            gWrapSim.display[i].refresh);
+        wsLog("  shmem=0x%08x addr=%p len=%ld\n",
             gWrapSim.display[i].shmemKey,
             gWrapSim.display[i].addr,
-            gWrapSim.display[i].length,
-            gWrapSim.display[i].semid);
+            gWrapSim.display[i].length);
 
         pData += kValuesPerDisplay;
     }
@@ -850,6 +933,10 @@ static void listenToSim(void)
     while (1) {
         Message msg;
 
+        /* send input events along before we wait for more */
+        if (!Message_pending())
+            wsFlushSimInput();
+
         Message_clear(&msg);
         if (Message_read(&msg, gWrapSim.simulatorFd) != 0) {
             wsLog("--- sim message read failed\n");
@@ -908,8 +995,13 @@ static void listenToSim(void)
 
 /*
  * Tell the simulator front-end that the display has been updated.
+ *
+ * Only the pixels in [left,right) x [top,bottom) have changed.  The
+ * corners are packed as 16-bit pairs into an extended command; a plain
+ * command still means "everything changed".
  */
-void wsPostDisplayUpdate(int displayIdx)
+void wsPostDisplayUpdate(int displayIdx, int left, int top, int right,
+    int bottom)
 {
     if (gWrapSim.simulatorFd < 0) {
         wsLog("Not posting display update -- sim not ready\n");
@@ -918,32 +1010,67 @@ void wsPostDisplayUpdate(int displayIdx)
 
     Message msg;
 
-    setCommand(&msg, kCommandUpdateDisplay, displayIdx);
+    setCommandExt(&msg, kCommandUpdateDisplay, displayIdx,
+        (left & 0xffff) | (top << 16), (right & 0xffff) | (bottom << 16));
     Message_write(&msg, gWrapSim.simulatorFd);
     Message_release(&msg);
 }
 
 /*
- * Send a log message to the front-end.
+ * Log messages are handed to a per-process log thread, so the threads
+ * doing the logging never wait on the simulator socket.  Writers push
+ * serialized bundles onto a lock-free stack; the log thread grabs the
+ * whole stack at once, puts it back in order, and sends the bundles in
+ * as few messages as it can.  See Message::getLogBundle() in
+ * simulator/app/MessageStream.cpp for the receiving side.
  */
-void wsPostLogMessage(int logPrio, const char* tag, const char* message)
-{
-    if (gWrapSim.simulatorFd < 0) {
-        wsLog("Not posting log message -- sim not ready\n");
-        return;
-    }
+typedef struct LogRecord {
+    struct LogRecord*   next;
+    int                 len;        /* bytes in data[] */
+    unsigned char       data[];     /* one serialized bundle */
+} LogRecord;
 
-    time_t when = time(NULL);
+enum {
+    kLogMaxTagLen = 128,            /* longer tags are truncated */
+    kLogMaxMessageLen = 4096,       /* longer messages are truncated */
+    kLogQueueMaxBytes = 1024 * 1024,/* drop messages beyond this */
+    kLogBatchMaxBytes = 32 * 1024,  /* must fit a 16-bit message length */
+};
+
+static struct {
+    LogRecord* volatile head;       /* newest first */
+    volatile int    bytes;          /* queued payload */
+    volatile int    dropped;        /* messages we had no room for */
+    volatile int    started;        /* log thread is running */
+    sem_t           sem;            /* posted when "head" becomes non-empty */
+    pthread_mutex_t startLock;
+} gLogQueue = { NULL, 0, 0, 0, { { 0 } }, PTHREAD_MUTEX_INITIALIZER };
+
+/*
+ * Serialize a log message into a new record.  Returns NULL if we're out
+ * of memory.
+ */
+static LogRecord* createLogRecord(int logPrio, const char* tag,
+    const char* message)
+{
+    int when = (int) time(NULL);
     int pid = (int) getpid();
     int tagLen, messageLen, totalLen;
+    LogRecord* rec;
+    unsigned char* cp;
 
-    tagLen = strlen(tag) +1;
-    messageLen = strlen(message) +1;
-    totalLen = sizeof(int) * 3 + tagLen + messageLen;
-    unsigned char outBuf[totalLen];
-    unsigned char* cp = outBuf;
+    tagLen = strnlen(tag, kLogMaxTagLen-1);
+    messageLen = strnlen(message, kLogMaxMessageLen-1);
+    totalLen = sizeof(int) * 3 + tagLen+1 + messageLen+1;
+
+    rec = (LogRecord*) malloc(sizeof(LogRecord) + totalLen);
+    if (rec == NULL)
+        return NULL;
+    rec->next = NULL;
+    rec->len = totalLen;
 
     /* See Message::set/getLogBundle() in simulator/MessageStream.cpp. */
+    cp = rec->data;
     memcpy(cp, &when, sizeof(int));
     cp += sizeof(int);
     memcpy(cp, &logPrio, sizeof(int));
@@ -952,19 +1079,207 @@ void wsPostLogMessage(int logPrio, const char* tag, const char* message)
     cp += sizeof(int);
     memcpy(cp, tag, tagLen);
     cp += tagLen;
+    *cp++ = '\0';
     memcpy(cp, message, messageLen);
     cp += messageLen;
+    *cp++ = '\0';
 
-    assert(cp - outBuf == totalLen);
+    assert(cp - rec->data == totalLen);
+    return rec;
+}
 
-    Message msg;
-    msg.mType = kTypeLogBundle;
-    msg.mData = outBuf;
-    msg.mLength = totalLen;
-    Message_write(&msg, gWrapSim.simulatorFd);
+/*
+ * Take everything off the queue, oldest first.
+ */
+static LogRecord* takeLogRecords(void)
+{
+    LogRecord* list;
+    LogRecord* ordered = NULL;
+
+    list = (LogRecord*) __sync_lock_test_and_set(&gLogQueue.head, NULL);
+    while (list != NULL) {
+        LogRecord* next = list->next;
+        list->next = ordered;
+        ordered = list;
+        list = next;
+    }
 
-    msg.mData = NULL;       // don't free
-    Message_release(&msg);
+    return ordered;
+}
+
+/*
+ * Log thread.  Sends whatever has been queued each time it wakes up.
+ */
+static void* logThreadEntry(void* arg)
+{
+    unsigned char* batch = (unsigned char*) malloc(kLogBatchMaxBytes);
+
+    if (batch == NULL) {
+        wsLog("Unable to allocate log batch buffer\n");
+        return NULL;
+    }
+
+    while (1) {
+        LogRecord* rec;
+        int dropped;
+
+        if (sem_wait(&gLogQueue.sem) != 0) {
+            if (errno != EINTR)
+                wsLog("log thread sem_wait failed: %s\n", strerror(errno));
+            continue;
+        }
+
+        rec = takeLogRecords();
+
+        dropped = __sync_lock_test_and_set(&gLogQueue.dropped, 0);
+        if (dropped > 0) {
+            char buf[64];
+            LogRecord* note;
+
+            snprintf(buf, sizeof(buf), "%d log messages dropped\n", dropped);
+            note = createLogRecord(ANDROID_LOG_WARN, "wrapsim", buf);
+            if (note != NULL) {
+                __sync_fetch_and_add(&gLogQueue.bytes, note->len);
+                note->next = rec;
+                rec = note;
+            }
+        }
+
+        while (rec != NULL) {
+            Message msg;
+            int used = 0;
+
+            while (rec != NULL && used + rec->len <= kLogBatchMaxBytes) {
+                LogRecord* next = rec->next;
+
+                memcpy(batch + used, rec->data, rec->len);
+                used += rec->len;
+                __sync_fetch_and_sub(&gLogQueue.bytes, rec->len);
+                free(rec);
+                rec = next;
+            }
+
+            msg.mType = kTypeLogBundle;
+            msg.mData = batch;
+            msg.mLength = used;
+            Message_write(&msg, gWrapSim.simulatorFd);
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * After a fork(), the child has a copy of the queue but no log thread.
+ * Throw the parent's messages away and start over.
+ */
+static void resetLogQueueInChild(void)
+{
+    LogRecord* rec = (LogRecord*) gLogQueue.head;
+
+    while (rec != NULL) {
+        LogRecord* next = rec->next;
+        free(rec);
+        rec = next;
+    }
+    gLogQueue.head = NULL;
+    gLogQueue.bytes = 0;
+    gLogQueue.dropped = 0;
+    if (gLogQueue.started)
+        sem_destroy(&gLogQueue.sem);
+    gLogQueue.started = 0;
+    pthread_mutex_init(&gLogQueue.startLock, NULL);
+}
+
+/*
+ * Start the log thread, if nobody has yet.  Returns 0 on success.
+ */
+static int startLogThread(void)
+{
+    static int atforkRegistered = 0;
+    pthread_attr_t threadAttr;
+    pthread_t threadHandle;
+    int result = -1;
+    int cc;
+
+    cc = pthread_mutex_lock(&gLogQueue.startLock);
+    assert(cc == 0);
+
+    if (gLogQueue.started) {
+        result = 0;
+        goto bail;
+    }
+
+    if (!atforkRegistered) {
+        pthread_atfork(NULL, NULL, resetLogQueueInChild);
+        atforkRegistered = 1;
+    }
+
+    if (sem_init(&gLogQueue.sem, 0, 0) != 0) {
+        wsLog("Unable to create log semaphore: %s\n", strerror(errno));
+        goto bail;
+    }
+
+    pthread_attr_init(&threadAttr);
+    pthread_attr_setdetachstate(&threadAttr, PTHREAD_CREATE_DETACHED);
+    cc = pthread_create(&threadHandle, &threadAttr, logThreadEntry, NULL);
+    pthread_attr_destroy(&threadAttr);
+    if (cc != 0) {
+        wsLog("Unable to create log thread: %s\n", strerror(cc));
+        sem_destroy(&gLogQueue.sem);
+        goto bail;
+    }
+
+    __sync_synchronize();
+    gLogQueue.started = 1;
+    result = 0;
+
+bail:
+    cc = pthread_mutex_unlock(&gLogQueue.startLock);
+    assert(cc == 0);
+    return result;
+}
+
+/*
+ * Send a log message to the front-end.
+ *
+ * This just queues the message for the log thread, and never blocks.
+ * If the simulator falls too far behind, messages are dropped and
+ * counted.
+ */
+void wsPostLogMessage(int logPrio, const char* tag, const char* message)
+{
+    LogRecord* rec;
+    LogRecord* old;
+
+    if (gWrapSim.simulatorFd < 0) {
+        wsLog("Not posting log message -- sim not ready\n");
+        return;
+    }
+
+    if (!gLogQueue.started && startLogThread() != 0)
+        return;
+
+    if (gLogQueue.bytes >= kLogQueueMaxBytes) {
+        __sync_fetch_and_add(&gLogQueue.dropped, 1);
+        return;
+    }
+
+    rec = createLogRecord(logPrio, tag, message);
+    if (rec == NULL) {
+        __sync_fetch_and_add(&gLogQueue.dropped, 1);
+        return;
+    }
+    __sync_fetch_and_add(&gLogQueue.bytes, rec->len);
+
+    do {
+        old = (LogRecord*) gLogQueue.head;
+        rec->next = old;
+    } while (!__sync_bool_compare_and_swap(&gLogQueue.head, old, rec));
+
+    /* the log thread drains the whole stack, so only wake it when empty */
+    if (old == NULL)
+        sem_post(&gLogQueue.sem);
 }
 
 /*
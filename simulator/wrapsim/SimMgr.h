@@ -48,6 +48,36 @@ enum {
     kValuesPerDisplay = 5,
 };
 
+/*
+ * Layout of the display shared memory; also cloned from SimRuntime.h.
+ *
+ * The segment starts with a FrameRing header, followed by kFrameSlots
+ * 24bpp frames at kFrameRingHeaderSize.  At any time one slot is being
+ * drawn by the runtime, one holds the latest finished frame, and one is
+ * being shown by the simulator.  "state" says which is which (the runtime
+ * owns the remaining slot) and counts the frames published so far.  Both
+ * sides only swap slots with compare-and-swap on "state", so neither ever
+ * waits for the other.
+ */
+enum {
+    kFrameRingMagic = 0x46524e47,       // 'FRNG'
+    kFrameSlots = 3,
+    kFrameRingHeaderSize = 64,
+};
+
+typedef struct FrameRing {
+    int             magic;
+    int             numSlots;
+    int             slotSize;
+    volatile unsigned int state;
+} FrameRing;
+
+#define FRAME_RING_LATEST(_s)   ((_s) & 3)          /* latest finished */
+#define FRAME_RING_SHOWN(_s)    (((_s) >> 2) & 3)   /* shown by the sim */
+#define FRAME_RING_SEQ(_s)      ((_s) >> 4)         /* frames published */
+#define FRAME_RING_STATE(_seq, _shown, _latest) \
+    (((_seq) << 4) | ((_shown) << 2) | (_latest))
+
 /*
  * UNIX domain socket name.
  */
@@ -58,9 +88,12 @@ int wsSimConnect(void);
 /*
  * Display management.
  */
-void wsLockDisplay(int displayIdx);
-void wsUnlockDisplay(int displayIdx);
-void wsPostDisplayUpdate(int displayIdx);
+unsigned char* wsBeginDisplayUpdate(int displayIdx, int* pLeft, int* pTop,
+    int* pRight, int* pBottom);
+void wsEndDisplayUpdate(int displayIdx, int left, int top, int right,
+    int bottom);
+void wsPostDisplayUpdate(int displayIdx, int left, int top, int right,
+    int bottom);
 
 /*
  * Send a log message.
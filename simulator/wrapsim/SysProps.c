@@ -0,0 +1,181 @@
+/*
+ * Copyright 2011 The Android Open Source Project
+ *
+ * System property reads from the simulator's shared property area.
+ */
+#include "Common.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * Layout of the property area written by the simulator.
+ *
+ * NOTE: this is cloned from PropertyServer.h -- fix this.
+ */
+#define kPropAreaFileName   "/tmp/android-sysprop-area"
+
+enum {
+    kPropAreaMagic = 0x41505250,        // 'PRPA'
+    kPropAreaVersion = 1,
+    kPropKeyMax = 32,                   // PROPERTY_KEY_MAX
+    kPropValueMax = 92,                 // PROPERTY_VALUE_MAX
+};
+
+enum {
+    kPropEntryEmpty = 0,
+    kPropEntryLive,
+    kPropEntryDeleted,
+};
+
+typedef struct PropAreaHeader {
+    uint32_t    magic;
+    uint32_t    version;
+    uint32_t    numBuckets;
+    uint32_t    entrySize;
+} PropAreaHeader;
+
+typedef struct PropAreaEntry {
+    volatile uint32_t serial;
+    uint32_t    state;
+    char        key[kPropKeyMax];
+    char        value[kPropValueMax];
+} PropAreaEntry;
+
+typedef int (*Func_property_get)(const char*, char*, const char*);
+
+static pthread_once_t gPropOnce = PTHREAD_ONCE_INIT;
+static const PropAreaHeader* gPropArea = NULL;
+static Func_property_get gRealPropertyGet = NULL;
+
+/*
+ * Map the property area, if the simulator made one we understand.
+ *
+ * libcutils may not be loaded yet when we initialize, so the real
+ * property_get is looked up here as well.
+ */
+static void mapPropArea(void)
+{
+    struct stat sb;
+    void* addr;
+    int fd;
+
+    gRealPropertyGet = (Func_property_get) dlsym(RTLD_NEXT, "property_get");
+
+    fd = _ws_open(kPropAreaFileName, O_RDONLY, 0);
+    if (fd < 0) {
+        wsLog("No property area, using the property server\n");
+        return;
+    }
+
+    addr = MAP_FAILED;
+    if (fstat(fd, &sb) == 0 && sb.st_size >= (off_t) sizeof(PropAreaHeader))
+        addr = _ws_mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    _ws_close(fd);
+    if (addr == MAP_FAILED) {
+        wsLog("Unable to map property area (errno=%d)\n", errno);
+        return;
+    }
+
+    const PropAreaHeader* area = (const PropAreaHeader*) addr;
+    if (area->magic != kPropAreaMagic || area->version != kPropAreaVersion ||
+        area->entrySize != sizeof(PropAreaEntry) ||
+        (area->numBuckets & (area->numBuckets - 1)) != 0 ||
+        sb.st_size < (off_t) (sizeof(PropAreaHeader) +
+            area->numBuckets * sizeof(PropAreaEntry)))
+    {
+        wsLog("Bad property area (magic=0x%08x), ignoring it\n", area->magic);
+        munmap(addr, sb.st_size);
+        return;
+    }
+
+    gPropArea = area;
+}
+
+/*
+ * Look "key" up in the property area, copying its value to "value".
+ *
+ * Returns the length of the value, or 0 if it isn't set.
+ */
+static int findProperty(const PropAreaHeader* area, const char* key,
+    char* value)
+{
+    const PropAreaEntry* entries = (const PropAreaEntry*) (area + 1);
+    uint32_t mask = area->numBuckets - 1;
+    uint32_t hash = 2166136261U;
+    const unsigned char* cp;
+    uint32_t i;
+
+    for (cp = (const unsigned char*) key; *cp != '\0'; cp++)
+        hash = (hash ^ *cp) * 16777619U;
+
+    for (i = 0; i <= mask; i++) {
+        const PropAreaEntry* ent = &entries[(hash + i) & mask];
+        uint32_t serial, state;
+        int match;
+
+        /* copy the entry out, retrying if the simulator was changing it */
+        do {
+            while ((serial = ent->serial) & 1)
+                sched_yield();
+            __sync_synchronize();
+            state = ent->state;
+            match = (state == kPropEntryLive &&
+                     strncmp(ent->key, key, kPropKeyMax) == 0);
+            if (match) {
+                memcpy(value, ent->value, kPropValueMax);
+                value[kPropValueMax-1] = '\0';
+            }
+            __sync_synchronize();
+        } while (ent->serial != serial);
+
+        if (state == kPropEntryEmpty)
+            return 0;
+        if (match)
+            return strlen(value);
+    }
+
+    return 0;
+}
+
+/*
+ * Replacement for the libcutils property_get().  Reads come from the
+ * property area when there is one, which spares every process a round
+ * trip to the simulator per property.  Sets still go through the
+ * property server, which updates the area.
+ */
+int property_get(const char* key, char* value, const char* default_value)
+{
+    pthread_once(&gPropOnce, mapPropArea);
+
+    if (gPropArea == NULL) {
+        if (gRealPropertyGet != NULL)
+            return gRealPropertyGet(key, value, default_value);
+        wsLog("property_get(%s) with no property area or server\n", key);
+        value[0] = '\0';
+    } else {
+        int len = findProperty(gPropArea, key, value);
+        if (len > 0)
+            return len;
+    }
+
+    if (default_value != NULL) {
+        int len = strlen(default_value);
+        if (len >= kPropValueMax)
+            len = kPropValueMax - 1;
+        memcpy(value, default_value, len);
+        value[len] = '\0';
+        return len;
+    }
+
+    value[0] = '\0';
+    return 0;
+}
@@ -18,9 +18,20 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
 
 #include "ErrorLog.h"
 
+// set in the size of a pointer whose data went through the bulk channel
+#define IOSTREAM_BULK_FLAG 0x80000000
+
+// set in the 16 bits opcode which starts a compact packet, see emugen README
+#define IOSTREAM_COMPACT_FLAG 0x8000
+
 class IOStream {
 public:
 
@@ -28,25 +39,98 @@ public:
         m_buf = NULL;
         m_bufsize = bufSize;
         m_free = 0;
+        m_sentSeq = 0;
+        m_checksumSeq = 0;
+        m_deferredReplies = 0;
+        m_compactPackets = false;
+        m_minBufSize = bufSize;
+        m_maxBufSize = 0;
+        m_shrinkMS = 0;
+        m_peakUse = 0;
+        m_shrinkCheckMS = 0;
     }
 
     virtual void *allocBuffer(size_t minSize) = 0;
     virtual int commitBuffer(size_t size) = 0;
     virtual const unsigned char *readFully( void *buf, size_t len) = 0;
     virtual const unsigned char *read( void *buf, size_t *inout_len) = 0;
+    virtual int writeFully(const void *buf, size_t len) = 0;
+
+    //
+    // commitBufferv - commit 'size' bytes of the staging buffer followed
+    //     by 'len' bytes taken directly from 'data'. Streams which can
+    //     send both with a single vectored write should override this.
+    //
+    virtual int commitBufferv(size_t size, const void *data, size_t len) {
+        if (size > 0) {
+            int stat = commitBuffer(size);
+            if (stat < 0) return stat;
+        }
+        return len > 0 ? writeFully(data, len) : 0;
+    }
+
+    //
+    // trimBuffers - release the buffers of an idle stream, the next use
+    //     allocates them again. The stream must have been flushed.
+    //
+    virtual void trimBuffers() {}
+
+    //
+    // interrupt - makes a read() blocked on another thread fail, and every
+    //     later read as well. Used to stop a reader thread before the
+    //     stream is destroyed.
+    //
+    virtual void interrupt() {}
+
+    //
+    // allocBulk - reserves 'len' bytes in the bulk side channel of the
+    //     stream for a large payload which is then referenced by '*id' in
+    //     the command stream, instead of being copied in it. Never waits,
+    //     returns NULL if the stream has no side channel or it is full,
+    //     the caller then sends the data inline.
+    //
+    virtual void *allocBulk(size_t len, unsigned int *id) { return NULL; }
+
+    //
+    // getBulk - the 'len' bytes of bulk data referenced by 'id', on the
+    //     receiving side. They stay valid until releaseBulk is called,
+    //     which must be done in the order they were received.
+    //
+    virtual const unsigned char *getBulk(unsigned int id, size_t len) { return NULL; }
+    virtual void releaseBulk(unsigned int id, size_t len) {}
 
     virtual ~IOStream() {
 
         // NOTE: m_buf is 'owned' by the child class thus we expect it to be released by it
     }
 
+    //
+    // alloc - reserves 'len' bytes at the end of the staging buffer. The
+    //     common case of a packet which fits is kept to a single test, the
+    //     rest is done by allocSlow.
+    //
     unsigned char *alloc(size_t len) {
+        if (m_buf && len <= m_free) {
+            unsigned char *ptr = m_buf + (m_bufsize - m_free);
+            m_free -= len;
+            return ptr;
+        }
+        return allocSlow(len);
+    }
+
+private:
+    unsigned char *allocSlow(size_t len) {
 
         if (m_buf && len > m_free) {
             if (flush() < 0) {
                 ERR("Failed to flush in alloc\n");
                 return NULL; // we failed to flush so something is wrong
             }
+            // the buffer filled up, the next one is larger
+            if (m_bufsize < m_maxBufSize) {
+                m_bufsize = m_bufsize * 2 < m_maxBufSize ? m_bufsize * 2 :
+                                                           m_maxBufSize;
+            }
         }
 
         if (!m_buf || len > m_bufsize) {
@@ -67,25 +151,147 @@ public:
         return ptr;
     }
 
+public:
     int flush() {
 
         if (!m_buf || m_free == m_bufsize) return 0;
 
-        int stat = commitBuffer(m_bufsize - m_free);
+        size_t used = m_bufsize - m_free;
+        int stat = commitBuffer(used);
         m_buf = NULL;
         m_free = 0;
+        m_sentSeq++;
+        if (m_maxBufSize > 0) {
+            adaptBuffer(used);
+        }
+        return stat;
+    }
+
+    //
+    // setAdaptiveBuffer - lets the staging buffer grow geometrically when
+    //     it fills up, from the size given to the constructor up to
+    //     'maxSize', and shrink by half each 'shrinkMS' milliseconds in
+    //     which less than a quarter of it was used. The streams allocate
+    //     a new buffer when the size asked for is less than half of the
+    //     current one. A zero 'maxSize' keeps the size fixed, the default.
+    //
+    void setAdaptiveBuffer(size_t maxSize, int shrinkMS) {
+        m_maxBufSize = maxSize > m_minBufSize ? maxSize : 0;
+        m_shrinkMS = shrinkMS;
+        m_peakUse = 0;
+        m_shrinkCheckMS = currentTimeMS();
+    }
+
+    //
+    // sentSeq / idleSince - idleSince(seq) is true if nothing was sent or
+    //     staged since sentSeq() returned 'seq'. A glFlush which follows
+    //     another one this way has nothing to flush, the encoders drop it
+    //     (see GLEncoder::s_glFlush).
+    //
+    unsigned int sentSeq() const { return m_sentSeq; }
+    bool idleSince(unsigned int seq) const {
+        return seq == m_sentSeq && (!m_buf || m_free == m_bufsize);
+    }
+
+    //
+    // writev - send any data pending in the staging buffer followed by
+    //     'len' bytes of 'data', without copying 'data' into the staging
+    //     buffer. Used for large pointer payloads such as texture pixels.
+    //
+    int writev(const void *data, size_t len) {
+
+        size_t pending = m_buf ? m_bufsize - m_free : 0;
+        if (!data) len = 0;
+        if (pending == 0 && len == 0) return 0;
+
+        int stat = commitBufferv(pending, data, len);
+        m_buf = NULL;
+        m_free = 0;
+        m_sentSeq++;
+        if (m_maxBufSize > 0) {
+            adaptBuffer(pending);
+        }
         return stat;
     }
 
     const unsigned char *readback(void *buf, size_t len) {
         flush();
+        while (m_deferredReplies > 0) {
+            if (!takeDeferredReply()) return NULL;
+        }
         return readFully(buf, len);
     }
 
+    //
+    // deferReply - the 32-bit reply of the command just sent is not waited
+    //     for (emugen deferred_reply entry points). The replies come in
+    //     order, so readback() first takes the deferred ones, and
+    //     takeDeferredReply() takes the oldest on demand, discarding its
+    //     value. The command must have been flushed.
+    //
+    void deferReply() { m_deferredReplies++; }
+    int deferredReplies() const { return m_deferredReplies; }
+    bool takeDeferredReply() {
+        unsigned int reply;
+        if (m_deferredReplies == 0) return true;
+        if (!readFully(&reply, sizeof(reply))) return false;
+        m_deferredReplies--;
+        return true;
+    }
+
+    //
+    // setCompactPackets - let the encoders send the entry points without
+    //     pointers in compact packets. Only once the decoding side is known
+    //     to accept them, the default is off.
+    //
+    void setCompactPackets(bool enable) { m_compactPackets = enable; }
+    bool compactPackets() const { return m_compactPackets; }
+
+    // sequence number of the next packet sent or received, see StreamChecksum
+    unsigned int nextChecksumSeq() { return m_checksumSeq++; }
+
+private:
+    // adaptBuffer - accounts 'used' bytes just committed, see setAdaptiveBuffer
+    void adaptBuffer(size_t used) {
+        if (used > m_peakUse) {
+            m_peakUse = used;
+        }
+        long long now = currentTimeMS();
+        if (now - m_shrinkCheckMS < m_shrinkMS) {
+            return;
+        }
+        if (m_peakUse <= m_bufsize / 4 && m_bufsize > m_minBufSize) {
+            m_bufsize = m_bufsize / 2 > m_minBufSize ? m_bufsize / 2 :
+                                                       m_minBufSize;
+        }
+        m_peakUse = 0;
+        m_shrinkCheckMS = now;
+    }
+
+    static long long currentTimeMS() {
+#ifdef _WIN32
+        return GetTickCount();
+#else
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return (long long)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+#endif
+    }
+
 private:
     unsigned char *m_buf;
     size_t m_bufsize;
     size_t m_free;
+    unsigned int m_sentSeq;     // see sentSeq
+    unsigned int m_checksumSeq;
+    int m_deferredReplies;
+    bool m_compactPackets;
+    // adaptive staging buffer, see setAdaptiveBuffer
+    size_t m_minBufSize;
+    size_t m_maxBufSize;
+    long long m_shrinkMS;
+    size_t m_peakUse;
+    long long m_shrinkCheckMS;
 };
 
 #endif
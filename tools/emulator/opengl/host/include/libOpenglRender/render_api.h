@@ -38,10 +38,26 @@ typedef Window   FBNativeWindowType;
 
 //
 // initOpenGLRenderer - initialize the OpenGL renderer process.
-//     window is the native window to be used as the framebuffer.
+//     window is the native window to be used as the framebuffer, it may
+//     be 0 to render headless (see FrameBuffer::initialize).
 //     x,y,width,height are the dimensions of the rendering subwindow.
 //     portNum is the tcp port number the renderer is listening to.
 //
+//     If ANDROID_SHARED_RENDERER_PORT is set, no renderer is started: the
+//     emulator becomes a tenant of the 'emulator_renderer -multi' which
+//     listens to that port and serves several emulators, portNum is
+//     ignored. stopOpenGLRenderer() then only releases the tenant.
+//     If ANDROID_RENDER_COMPRESS is set, the connections which cannot use
+//     shared memory, such as a port forwarded to a renderer on another
+//     machine, ask for an LZ4 compressed stream. If ANDROID_RENDER_UNIX
+//     is set, the renderer is reached through a Unix domain socket named
+//     after the port rather than loopback TCP.
+//     If ANDROID_RENDER_RESTORE is set, it names a renderer snapshot
+//     written by saveOpenGLRendererSnapshot() which is restored before
+//     the guest connects, for a guest resumed from the matching VM
+//     snapshot. Initialization fails if it cannot be restored. It is
+//     ignored by a tenant of a shared renderer.
+//
 // returns true if renderer has been starter successfully;
 //
 // This function is *NOT* thread safe and should be called first
@@ -58,6 +74,67 @@ bool initOpenGLRenderer(FBNativeWindowType window,
 //
 bool stopOpenGLRenderer();
 
+//
+// setOpenGLDisplayTransform - moves, scales and rotates the display inside
+//     the renderer window, without reinitializing the renderer or waiting
+//     for the guest to send a new frame: the last frame is shown again.
+//     x,y,width,height is the display viewport in window pixels, rotation
+//     a counterclockwise rotation in degrees (a multiple of 90), zoom >= 1
+//     a magnification around the point (centerX, centerY) of the display,
+//     given as fractions of its width and height.
+//
+// returns false if the transform is invalid, the renderer is headless, or
+// it runs in a separate emulator_renderer process, which has no control
+// channel to receive it.
+//
+bool setOpenGLDisplayTransform(int x, int y, int width, int height,
+                               int rotation, float zoom,
+                               float centerX, float centerY);
+
+//
+// setOpenGLDisplayVisible - tells the renderer whether its window can be
+//     seen, the emulator UI reports it when the window is minimized or
+//     fully covered. Nothing is composed nor presented while it is hidden.
+//
+// returns false if the renderer is headless, or runs in a separate
+// emulator_renderer process.
+//
+bool setOpenGLDisplayVisible(bool visible);
+
+//
+// saveOpenGLRendererSnapshot - writes the contexts, surfaces and color
+//     buffers of the renderer to the file 'path', along with a VM
+//     snapshot, see ANDROID_RENDER_RESTORE. The color buffer pixels are
+//     saved, not the textures and state of the GL contexts.
+//
+// returns false if the file cannot be written, or the renderer runs in a
+// separate emulator_renderer process.
+//
+bool saveOpenGLRendererSnapshot(const char *path);
+
+//
+// startOpenGLRecording - streams the frames the renderer presents, for
+//     video capture. 'callback' is called on a renderer thread with each
+//     frame: width x height tightly packed GL_RGBA/GL_UNSIGNED_BYTE pixels,
+//     bottom row first, and the time it was presented in microseconds
+//     (GetCurrentTimeUS). The pixels are only valid during the call.
+//     width and height may be 0 for the display size, the frames are
+//     scaled on the GPU otherwise. Frames are dropped rather than delaying
+//     the display when the callback falls behind.
+// stopOpenGLRecording - stops it, the callback is not called anymore
+//     once it returns.
+//
+// returns false if a recording is already running, or the renderer runs
+// in a separate emulator_renderer process.
+//
+typedef void (*OnRecordedFrameFunc)(void *opaque, int width, int height,
+                                    const unsigned char *pixels,
+                                    long long timeUS);
+
+bool startOpenGLRecording(int width, int height,
+                          OnRecordedFrameFunc callback, void *opaque);
+bool stopOpenGLRecording();
+
 //
 // createRenderThread - opens a new communication channel to the renderer
 //   process and creates new rendering thread.
@@ -34,7 +34,7 @@ LOCAL_LDLIBS := -ldl
 GEN := $(intermediates)/gl_server_context.cpp $(intermediates)/gl_dec.cpp $(intermediates)/gl_dec.h
 
 $(GEN) : PRIVATE_PATH := $(LOCAL_PATH)
-$(GEN) : PRIVATE_CUSTOM_TOOL := $(EMUGEN) -D $(intermediates) -i $(emulatorOpengl)/system/GLESv1_enc gl
+$(GEN) : PRIVATE_CUSTOM_TOOL := $(EMUGEN) -J -D $(intermediates) -i $(emulatorOpengl)/system/GLESv1_enc gl
 $(GEN) : $(EMUGEN) \
         $(emulatorOpengl)/system/GLESv1_enc/gl.attrib \
         $(emulatorOpengl)/system/GLESv1_enc/gl.in \
@@ -14,6 +14,7 @@
 * limitations under the License.
 */
 #include "GLDecoder.h"
+#include "TextureCache.h"
 #include <string.h>
 #include <dlfcn.h>
 #include <stdio.h>
@@ -71,10 +72,15 @@ int GLDecoder::initGL(get_proc_func_t getProcFunc, void *getProcFuncData)
     set_glPointSizePointerData(s_glPointSizePointerData);
     set_glWeightPointerData(s_glWeightPointerData);
     set_glMatrixIndexPointerData(s_glMatrixIndexPointerData);
+    set_glInterleavedArrayData(s_glInterleavedArrayData);
+    set_glInterleavedArrayPointer(s_glInterleavedArrayPointer);
 
     set_glDrawElementsOffset(s_glDrawElementsOffset);
     set_glDrawElementsData(s_glDrawElementsData);
 
+    set_glTexImage2DCached(s_glTexImage2DCached);
+    set_glTexImage2DCachedData(s_glTexImage2DCachedData);
+
     return 0;
 }
 
@@ -194,6 +200,60 @@ void GLDecoder::s_glMatrixIndexPointerData(void * self, GLint size, GLenum type,
     ctx->glMatrixIndexPointerOES(size, type, 0, ctx->m_contextData->pointerData(GLDecoderContextData::MATRIXINDEX_LOCATION));
 }
 
+void GLDecoder::s_glInterleavedArrayData(void *self, void *data, GLuint datalen)
+{
+    GLDecoder *ctx = (GLDecoder *)self;
+    if (ctx->m_contextData != NULL) {
+        ctx->m_contextData->storeInterleavedData(data, datalen);
+    }
+}
+
+//
+// points the array of 'location' at 'offset' in the last block sent by
+// glInterleavedArrayData, the block keeps the stride of the client arrays.
+// Texture coordinates use the client active texture, as the offset
+// versions do.
+//
+void GLDecoder::s_glInterleavedArrayPointer(void *self, GLint location, GLint size, GLenum type, GLsizei stride, GLuint offset)
+{
+    GLDecoder *ctx = (GLDecoder *)self;
+    if (ctx->m_contextData == NULL) return;
+
+    void *ptr = ctx->m_contextData->interleavedData(offset);
+    if (ptr == NULL) return;
+
+    switch (location) {
+    case GLDecoderContextData::VERTEX_LOCATION:
+        ctx->glVertexPointer(size, type, stride, ptr);
+        break;
+    case GLDecoderContextData::NORMAL_LOCATION:
+        ctx->glNormalPointer(type, stride, ptr);
+        break;
+    case GLDecoderContextData::COLOR_LOCATION:
+        ctx->glColorPointer(size, type, stride, ptr);
+        break;
+    case GLDecoderContextData::POINTSIZE_LOCATION:
+        ctx->glPointSizePointerOES(type, stride, ptr);
+        break;
+    case GLDecoderContextData::TEXCOORD0_LOCATION:
+    case GLDecoderContextData::TEXCOORD1_LOCATION:
+    case GLDecoderContextData::TEXCOORD2_LOCATION:
+    case GLDecoderContextData::TEXCOORD3_LOCATION:
+    case GLDecoderContextData::TEXCOORD4_LOCATION:
+    case GLDecoderContextData::TEXCOORD5_LOCATION:
+    case GLDecoderContextData::TEXCOORD6_LOCATION:
+    case GLDecoderContextData::TEXCOORD7_LOCATION:
+        ctx->glTexCoordPointer(size, type, stride, ptr);
+        break;
+    case GLDecoderContextData::WEIGHT_LOCATION:
+        ctx->glWeightPointerOES(size, type, stride, ptr);
+        break;
+    case GLDecoderContextData::MATRIXINDEX_LOCATION:
+        ctx->glMatrixIndexPointerOES(size, type, stride, ptr);
+        break;
+    }
+}
+
 void GLDecoder::s_glDrawElementsOffset(void *self, GLenum mode, GLsizei count, GLenum type, GLuint offset)
 {
     GLDecoder *ctx = (GLDecoder *)self;
@@ -212,6 +272,44 @@ void GLDecoder::s_glGetCompressedTextureFormats(void *self, GLint count, GLint *
     ctx->glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, data);
 }
 
+GLint GLDecoder::s_glTexImage2DCached(void *self, GLenum target, GLint level, GLint internalformat,
+                                      GLsizei width, GLsizei height, GLint border,
+                                      GLenum format, GLenum type, GLuint datalen, GLuint *hash)
+{
+    GLDecoder *ctx = (GLDecoder *)self;
+    TextureCache *cache = TextureCache::get();
+    if (cache == NULL) {
+        return -1;
+    }
+
+    TextureCacheKey key;
+    key.set(hash, width, height, format, type, datalen);
+    void *pixels = datalen <= cache->maxSize() ? ctx->m_textureBuffer.alloc(datalen) : NULL;
+    if (pixels == NULL || !cache->lookup(key, pixels)) {
+        return 0;
+    }
+    ctx->glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+    return 1;
+}
+
+void GLDecoder::s_glTexImage2DCachedData(void *self, GLenum target, GLint level, GLint internalformat,
+                                         GLsizei width, GLsizei height, GLint border,
+                                         GLenum format, GLenum type, void *pixels, GLuint datalen)
+{
+    GLDecoder *ctx = (GLDecoder *)self;
+    ctx->glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+
+    // the hash is computed here, the guest one is not trusted
+    TextureCache *cache = TextureCache::get();
+    if (cache != NULL && pixels != NULL) {
+        GLuint hash[TEXTURE_HASH_WORDS];
+        textureHash(pixels, datalen, hash);
+        TextureCacheKey key;
+        key.set(hash, width, height, format, type, datalen);
+        cache->insert(key, pixels);
+    }
+}
+
 void *GLDecoder::s_getProc(const char *name, void *userData)
 {
     GLDecoder *ctx = (GLDecoder *)userData;
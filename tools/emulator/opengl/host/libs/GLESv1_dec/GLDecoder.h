@@ -59,10 +59,21 @@ private:
     static void s_glMatrixIndexPointerData(void * self, GLint size, GLenum type, GLsizei stride, void * data, GLuint datalen);
     static void s_glMatrixIndexPointerOffset(void * self, GLint size, GLenum type, GLsizei stride, GLuint offset);
 
+    static void s_glInterleavedArrayData(void *self, void *data, GLuint datalen);
+    static void s_glInterleavedArrayPointer(void *self, GLint location, GLint size, GLenum type, GLsizei stride, GLuint offset);
+
     static void * s_getProc(const char *name, void *userData);
 
+    static GLint s_glTexImage2DCached(void *self, GLenum target, GLint level, GLint internalformat,
+                                      GLsizei width, GLsizei height, GLint border,
+                                      GLenum format, GLenum type, GLuint datalen, GLuint *hash);
+    static void s_glTexImage2DCachedData(void *self, GLenum target, GLint level, GLint internalformat,
+                                         GLsizei width, GLsizei height, GLint border,
+                                         GLenum format, GLenum type, void *pixels, GLuint datalen);
+
     GLDecoderContextData *m_contextData;
     void *m_glesDso;
+    FixedBuffer m_textureBuffer;
 };
 
 #endif
@@ -35,7 +35,7 @@ LOCAL_LDLIBS := -ldl
 GEN := $(intermediates)/gl2_dec.cpp $(intermediates)/gl2_dec.h $(intermediates)/gl2_server_context.cpp
 
 $(GEN) : PRIVATE_PATH := $(LOCAL_PATH)
-$(GEN) : PRIVATE_CUSTOM_TOOL := $(EMUGEN) -D $(intermediates) -i $(emulatorOpengl)/system/GLESv2_enc gl2
+$(GEN) : PRIVATE_CUSTOM_TOOL := $(EMUGEN) -J -D $(intermediates) -i $(emulatorOpengl)/system/GLESv2_enc gl2
 $(GEN) : $(EMUGEN) \
         $(emulatorOpengl)/system/GLESv2_enc/gl2.attrib \
         $(emulatorOpengl)/system/GLESv2_enc/gl2.in \
@@ -2,6 +2,11 @@
 #include <EGL/egl.h>
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "GLProgramLocations.h"
+#include "TextureCache.h"
 
 
 GL2Decoder::GL2Decoder()
@@ -58,6 +63,9 @@ int GL2Decoder::initGL(get_proc_func_t getProcFunc, void *getProcFuncData)
     set_glDrawElementsOffset(s_glDrawElementsOffset);
     set_glDrawElementsData(s_glDrawElementsData);
     set_glShaderString(s_glShaderString);
+    set_glGetProgramLocations(s_glGetProgramLocations);
+    set_glTexImage2DCached(s_glTexImage2DCached);
+    set_glTexImage2DCachedData(s_glTexImage2DCachedData);
     return 0;
 
 }
@@ -113,3 +121,162 @@ void GL2Decoder::s_glShaderString(void *self, GLuint shader, GLstr string, GLsiz
     GL2Decoder *ctx = (GL2Decoder *)self;
     ctx->glShaderSource(shader, 1, &string, NULL);
 }
+
+//
+// appends the entry of one active attribute or uniform to 'table', which
+// is grown as needed. Returns false when out of memory.
+//
+static bool appendProgramLocation(GLint **table, size_t *tableInts, size_t *used,
+                                  GLint kind, GLint flags, GLint size,
+                                  const char *name, GLint length)
+{
+    size_t nameInts = GL_PROGRAM_LOCATION_NAME_INTS(length);
+    size_t needed = *used + 4 + nameInts + size;
+    if (needed > *tableInts) {
+        size_t newInts = needed * 2;
+        GLint *newTable = (GLint *)realloc(*table, newInts * sizeof(GLint));
+        if (newTable == NULL) {
+            return false;
+        }
+        *table = newTable;
+        *tableInts = newInts;
+    }
+
+    GLint *entry = *table + *used;
+    entry[0] = kind;
+    entry[1] = flags;
+    entry[2] = size;
+    entry[3] = length;
+    memset(entry + 4, 0, nameInts * sizeof(GLint));
+    memcpy(entry + 4, name, length);
+    *used = needed;
+    return true;
+}
+
+void GL2Decoder::s_glGetProgramLocations(void *self, GLuint program, GLsizei bufsize, GLint *out)
+{
+    GL2Decoder *ctx = (GL2Decoder *)self;
+    GLint header[GL_PROGRAM_LOCATION_HEADER] = { sizeof(header), 0, 0 };
+
+    // only query programs that will not raise errors, the guest asks the
+    // host directly about the others
+    if (ctx->glIsProgram(program)) {
+        ctx->glGetProgramiv(program, GL_LINK_STATUS, &header[1]);
+    }
+    if (!header[1]) {
+        memcpy(out, header, bufsize < (GLsizei)sizeof(header) ? bufsize : sizeof(header));
+        return;
+    }
+
+    GLint nAttribs = 0, nUniforms = 0, attribMax = 0, uniformMax = 0;
+    ctx->glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &nAttribs);
+    ctx->glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &attribMax);
+    ctx->glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &nUniforms);
+    ctx->glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &uniformMax);
+
+    // room for the longest name with an "[index]" suffix
+    GLint nameMax = (attribMax > uniformMax ? attribMax : uniformMax) + 16;
+    char *name = new char[nameMax];
+    size_t tableInts = GL_PROGRAM_LOCATION_HEADER + 64;
+    size_t used = GL_PROGRAM_LOCATION_HEADER;
+    GLint *table = (GLint *)malloc(tableInts * sizeof(GLint));
+    GLint nEntries = 0;
+    bool ok = table != NULL;
+
+    for (GLint i = 0; ok && i < nAttribs; i++) {
+        GLsizei length = 0;
+        GLint size;
+        GLenum type;
+        ctx->glGetActiveAttrib(program, i, nameMax, &length, &size, &type, name);
+        name[length] = '\0';
+        ok = appendProgramLocation(&table, &tableInts, &used,
+                                   GL_PROGRAM_LOCATION_ATTRIB, 0, 1, name, length);
+        if (ok) {
+            table[used - 1] = ctx->glGetAttribLocation(program, name);
+            nEntries++;
+        }
+    }
+
+    for (GLint i = 0; ok && i < nUniforms; i++) {
+        GLsizei length = 0;
+        GLint size;
+        GLenum type;
+        GLint flags = 0;
+        ctx->glGetActiveUniform(program, i, nameMax, &length, &size, &type, name);
+        name[length] = '\0';
+        // arrays may be reported as "name[0]", the table has the bare name
+        if (length > 3 && !strcmp(name + length - 3, "[0]")) {
+            length -= 3;
+            name[length] = '\0';
+            flags |= GL_PROGRAM_LOCATION_ARRAY;
+        }
+        if (size > 1) {
+            flags |= GL_PROGRAM_LOCATION_ARRAY;
+        }
+        ok = appendProgramLocation(&table, &tableInts, &used,
+                                   GL_PROGRAM_LOCATION_UNIFORM, flags, size, name, length);
+        if (!ok) {
+            break;
+        }
+        GLint *locations = table + used - size;
+        locations[0] = ctx->glGetUniformLocation(program, name);
+        for (GLint j = 1; j < size; j++) {
+            snprintf(name + length, nameMax - length, "[%d]", j);
+            locations[j] = ctx->glGetUniformLocation(program, name);
+        }
+        nEntries++;
+    }
+
+    if (!ok) {
+        // an empty table of a program the guest then asks about directly
+        fprintf(stderr, "GetProgramLocations: out of memory\n");
+        header[1] = 0;
+        memcpy(out, header, bufsize < (GLsizei)sizeof(header) ? bufsize : sizeof(header));
+    } else {
+        table[0] = used * sizeof(GLint);
+        table[1] = header[1];
+        table[2] = nEntries;
+        memcpy(out, table, bufsize < table[0] ? bufsize : table[0]);
+    }
+
+    free(table);
+    delete [] name;
+}
+
+GLint GL2Decoder::s_glTexImage2DCached(void *self, GLenum target, GLint level, GLint internalformat,
+                                       GLsizei width, GLsizei height, GLint border,
+                                       GLenum format, GLenum type, GLuint datalen, GLuint *hash)
+{
+    GL2Decoder *ctx = (GL2Decoder *)self;
+    TextureCache *cache = TextureCache::get();
+    if (cache == NULL) {
+        return -1;
+    }
+
+    TextureCacheKey key;
+    key.set(hash, width, height, format, type, datalen);
+    void *pixels = datalen <= cache->maxSize() ? ctx->m_textureBuffer.alloc(datalen) : NULL;
+    if (pixels == NULL || !cache->lookup(key, pixels)) {
+        return 0;
+    }
+    ctx->glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+    return 1;
+}
+
+void GL2Decoder::s_glTexImage2DCachedData(void *self, GLenum target, GLint level, GLint internalformat,
+                                          GLsizei width, GLsizei height, GLint border,
+                                          GLenum format, GLenum type, void *pixels, GLuint datalen)
+{
+    GL2Decoder *ctx = (GL2Decoder *)self;
+    ctx->glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+
+    // the hash is computed here, the guest one is not trusted
+    TextureCache *cache = TextureCache::get();
+    if (cache != NULL && pixels != NULL) {
+        GLuint hash[TEXTURE_HASH_WORDS];
+        textureHash(pixels, datalen, hash);
+        TextureCacheKey key;
+        key.set(hash, width, height, format, type, datalen);
+        cache->insert(key, pixels);
+    }
+}
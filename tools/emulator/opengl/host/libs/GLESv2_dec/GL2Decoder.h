@@ -7,6 +7,7 @@
 #include "gl2_dec.h"
 #include "OpenglOsUtils/osDynLibrary.h"
 #include "GLDecoderContextData.h"
+#include "FixedBuffer.h"
 
 
 class GL2Decoder : public gl2_decoder_context_t
@@ -20,6 +21,7 @@ public:
 private:
     GLDecoderContextData *m_contextData;
     osUtils::dynLibrary * m_GL2library;
+    FixedBuffer m_textureBuffer;
 
     static void *s_getProc(const char *name, void *userData);
     static void s_glGetCompressedTextureFormats(void *self, int count, GLint *formats);
@@ -31,5 +33,12 @@ private:
     static void s_glDrawElementsOffset(void *self, GLenum mode, GLsizei count, GLenum type, GLuint offset);
     static void s_glDrawElementsData(void *self, GLenum mode, GLsizei count, GLenum type, void * data, GLuint datalen);
     static void s_glShaderString(void *self, GLuint shader, GLstr string, GLsizei len);
+    static void s_glGetProgramLocations(void *self, GLuint program, GLsizei bufsize, GLint *table);
+    static GLint s_glTexImage2DCached(void *self, GLenum target, GLint level, GLint internalformat,
+                                      GLsizei width, GLsizei height, GLint border,
+                                      GLenum format, GLenum type, GLuint datalen, GLuint *hash);
+    static void s_glTexImage2DCachedData(void *self, GLenum target, GLint level, GLint internalformat,
+                                         GLsizei width, GLsizei height, GLint border,
+                                         GLenum format, GLenum type, void *pixels, GLuint datalen);
 };
 #endif
@@ -4,6 +4,8 @@ LOCAL_PATH := $(call my-dir)
 include $(CLEAR_VARS)
 
 translator_path := $(LOCAL_PATH)/..
+#exclude darwin builds until the CGL backend has been built on a Mac
+ifeq (, $(findstring $(HOST_OS), darwin))
 
 OS_SRCS:=
 
@@ -14,7 +16,9 @@ ifeq ($(HOST_OS),linux)
 endif
 
 ifeq ($(HOST_OS),darwin)
-    OS_SRCS = EglMacApi.cpp
+    OS_SRCS = EglMacApi.cpp \
+              MacNative.m
+    LOCAL_LDLIBS := -Wl,-framework,AppKit -Wl,-framework,OpenGL
 endif
 
 ifeq ($(HOST_OS),windows)
@@ -57,3 +61,4 @@ LOCAL_SHARED_LIBRARIES := \
 
 include $(BUILD_HOST_SHARED_LIBRARY)
 
+endif
@@ -18,7 +18,7 @@
 
 #include<EGL/egl.h>
 
-#define MIN_SWAP_INTERVAL 1
+#define MIN_SWAP_INTERVAL 0
 #define MAX_SWAP_INTERVAL 10
 
 
@@ -15,8 +15,6 @@
 */
 #include "EglContext.h"
 
-unsigned int EglContext::s_nextContextHndl = 0;
-
 bool EglContext::usingSurface(SurfacePtr surface) {
   return surface.Ptr() == m_read.Ptr() || surface.Ptr() == m_draw.Ptr();
 }
@@ -29,12 +27,12 @@ m_glesContext(glesCtx),
 m_read(NULL),
 m_draw(NULL),
 m_destroy(false),
-m_version(ver)
+m_version(ver),
+m_hndl(0)
 {
     m_shareGroup = shared_context.Ptr()?
                    mngr->attachShareGroup(context,shared_context.Ptr()->getShareGroup().Ptr()):
                    mngr->createShareGroup(context);
-    m_hndl = ++s_nextContextHndl;
 }
 
 void EglContext::setSurfaces(SurfacePtr read,SurfacePtr draw)
@@ -48,17 +48,23 @@ public:
     bool getAttrib(EGLint attrib,EGLint* value);
     SurfacePtr read(){ return m_read;};
     SurfacePtr draw(){ return m_draw;};
+    // borrowed surfaces, without a reference count update
+    EglSurface* readPtr() const { return m_read.Ptr(); }
+    EglSurface* drawPtr() const { return m_draw.Ptr(); }
+    bool isBound(const EglSurface* surface) const {
+        return surface == m_read.Ptr() || surface == m_draw.Ptr();
+    }
     ShareGroupPtr getShareGroup(){return m_shareGroup;}
     EglConfig* getConfig(){ return m_config;};
     GLESVersion version(){return m_version;};
     GLEScontext* getGlesContext(){return m_glesContext;}
     void setSurfaces(SurfacePtr read,SurfacePtr draw);
     unsigned int getHndl(){return m_hndl;}
+    void setHndl(unsigned int hndl){m_hndl = hndl;}  // by EglDisplay::addContext
     bool attachImage(unsigned int imageId,ImagePtr img);
     void detachImage(unsigned int imageId);
 
 private:
-    static unsigned int  s_nextContextHndl;
     EGLNativeContextType m_native;
     EglConfig*           m_config;
     GLEScontext*         m_glesContext;
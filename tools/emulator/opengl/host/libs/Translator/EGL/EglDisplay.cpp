@@ -17,17 +17,40 @@
 #include "EglOsApi.h"
 #include <GLcommon/GLutils.h>
 #include <utils/threads.h>
+#include <stdlib.h>
+
+//
+// Destroyed pbuffers are kept in a pool of at most ANDROID_EGL_PBUFFER_POOL_MAX
+// (default 4) native pbuffers, guest surfaces of the same size are often
+// destroyed and created again (rotation, activity restarts). 0 disables it.
+//
+#define PBUFFER_POOL_DEFAULT_MAX 4
+
+static unsigned int pbufferPoolMax() {
+    static int s_max = -1;
+    if(s_max < 0) {
+        const char* max = getenv("ANDROID_EGL_PBUFFER_POOL_MAX");
+        s_max = max ? atoi(max) : PBUFFER_POOL_DEFAULT_MAX;
+        if(s_max < 0) s_max = 0;
+    }
+    return s_max;
+}
+
+static const EGLint s_surfaceBucketBits[EGL_CONFIG_SURFACE_BUCKETS] = {
+    EGL_WINDOW_BIT, EGL_PBUFFER_BIT, EGL_PIXMAP_BIT
+};
 
 EglDisplay::EglDisplay(EGLNativeDisplayType dpy,bool isDefault):m_dpy(dpy),m_initialized(false),m_configInitialized(false),m_isDefault(isDefault),m_nextEglImageId(0){};
 
 EglDisplay::~EglDisplay() {
     android::Mutex::Autolock mutex(m_lock);
+    releasePbufferPool();
     if(m_isDefault) {
         EglOS::releaseDisplay(m_dpy);
     }
 
 
-    for(ConfigsList::iterator it = m_configs.begin(); it != m_configs.end(); it++) {
+    for(ConfigsVector::iterator it = m_configs.begin(); it != m_configs.end(); it++) {
         EglConfig* pConfig = *it;
         if(pConfig) delete pConfig;
     }
@@ -48,6 +71,7 @@ void EglDisplay::terminate(){
     android::Mutex::Autolock mutex(m_lock);
      m_contexts.clear();
      m_surfaces.clear();
+     releasePbufferPool();
      m_initialized = false;
 }
 
@@ -57,111 +81,105 @@ static bool compareEglConfigsPtrs(EglConfig* first,EglConfig* second) {
 
 void EglDisplay::initConfigurations() {
     if(m_configInitialized) return;
-    EglOS::queryConfigs(m_dpy,m_configs);
-    m_configs.sort(compareEglConfigsPtrs);
+    ConfigsList configs;
+    EglOS::queryConfigs(m_dpy,configs);
+    configs.sort(compareEglConfigsPtrs);
+    m_configs.assign(configs.begin(),configs.end());
+    indexConfigurations();
 }
 
-EglConfig* EglDisplay::getConfig(EGLConfig conf) {
-    android::Mutex::Autolock mutex(m_lock);
+static EGLint confAttrib(const EglConfig& conf,EGLint attrib) {
+    EGLint val = EGL_DONT_CARE;
+    conf.getConfAttrib(attrib,&val);
+    return val;
+}
 
-    for(ConfigsList::iterator it = m_configs.begin(); it != m_configs.end() ;it++) {
-        if(static_cast<EGLConfig>(*it) == conf) {
-            return (*it);
+static void getConfigKey(const EglConfig& conf,EglConfigKey& key) {
+    key.red         = confAttrib(conf,EGL_RED_SIZE);
+    key.green       = confAttrib(conf,EGL_GREEN_SIZE);
+    key.blue        = confAttrib(conf,EGL_BLUE_SIZE);
+    key.alpha       = confAttrib(conf,EGL_ALPHA_SIZE);
+    key.depth       = confAttrib(conf,EGL_DEPTH_SIZE);
+    key.stencil     = confAttrib(conf,EGL_STENCIL_SIZE);
+    key.surfaceType = confAttrib(conf,EGL_SURFACE_TYPE);
+}
 
+void EglDisplay::indexConfigurations() {
+    m_configKeys.resize(m_configs.size());
+    for(unsigned int i = 0; i < m_configs.size(); i++) {
+        EglConfig* pConfig = m_configs[i];
+        getConfigKey(*pConfig,m_configKeys[i]);
+        for(int b = 0; b < EGL_CONFIG_SURFACE_BUCKETS; b++) {
+            if(m_configKeys[i].surfaceType & s_surfaceBucketBits[b]) {
+                m_surfaceBuckets[b].push_back(i);
+            }
         }
+        m_configsById[pConfig->id()] = pConfig;
+        m_configsSet.insert(pConfig);
     }
-    return NULL;
 }
 
-SurfacePtr EglDisplay::getSurface(EGLSurface surface) {
+//quick check of the "at least" sizes and surface bits, choosen() does the rest
+static bool keyMatches(const EglConfigKey& key,const EglConfigKey& wanted) {
+    if(wanted.red != EGL_DONT_CARE && wanted.red > key.red) return false;
+    if(wanted.green != EGL_DONT_CARE && wanted.green > key.green) return false;
+    if(wanted.blue != EGL_DONT_CARE && wanted.blue > key.blue) return false;
+    if(wanted.alpha != EGL_DONT_CARE && wanted.alpha > key.alpha) return false;
+    if(wanted.depth != EGL_DONT_CARE && wanted.depth > key.depth) return false;
+    if(wanted.stencil != EGL_DONT_CARE && wanted.stencil > key.stencil) return false;
+    if(wanted.surfaceType != EGL_DONT_CARE &&
+       (wanted.surfaceType & key.surfaceType) != wanted.surfaceType) return false;
+    return true;
+}
+
+EglConfig* EglDisplay::getConfig(EGLConfig conf) {
     android::Mutex::Autolock mutex(m_lock);
 
-    SurfacesHndlMap::iterator it = m_surfaces.find(reinterpret_cast<unsigned int>(surface));
-    return it != m_surfaces.end() ?
-                                  (*it).second :
-                                   SurfacePtr(NULL);
+    EglConfig* pConfig = static_cast<EglConfig*>(conf);
+    return m_configsSet.count(pConfig) ? pConfig : NULL;
 }
 
-ContextPtr EglDisplay::getContext(EGLContext ctx) {
+SurfacePtr EglDisplay::getSurface(EGLSurface surface) {
     android::Mutex::Autolock mutex(m_lock);
+    return m_surfaces.get(reinterpret_cast<unsigned int>(surface));
+}
 
-    ContextsHndlMap::iterator it = m_contexts.find(reinterpret_cast<unsigned int>(ctx));
-    return it != m_contexts.end() ?
-                                  (*it).second :
-                                   ContextPtr(NULL);
+ContextPtr EglDisplay::getContext(EGLContext ctx) {
+    android::Mutex::Autolock mutex(m_lock);
+    return m_contexts.get(reinterpret_cast<unsigned int>(ctx));
 }
 
 bool EglDisplay::removeSurface(EGLSurface s) {
     android::Mutex::Autolock mutex(m_lock);
-
-    SurfacesHndlMap::iterator it = m_surfaces.find(reinterpret_cast<unsigned int>(s));
-    if(it != m_surfaces.end()) {
-        m_surfaces.erase(it);
-        return true;
-    }
-    return false;
+    return m_surfaces.remove(reinterpret_cast<unsigned int>(s));
 }
 
 bool EglDisplay::removeSurface(SurfacePtr s) {
     android::Mutex::Autolock mutex(m_lock);
-
-    SurfacesHndlMap::iterator it;
-    for(it = m_surfaces.begin(); it!= m_surfaces.end();it++)
-    {
-        if((*it).second == s.Ptr()) {
-            break;
-        }
-    }
-    if(it != m_surfaces.end()) {
-        m_surfaces.erase(it);
-        return true;
-    }
-    return false;
+    return s.Ptr() && m_surfaces.remove(s->getHndl());
 }
 
 bool EglDisplay::removeContext(EGLContext ctx) {
     android::Mutex::Autolock mutex(m_lock);
-
-    ContextsHndlMap::iterator it = m_contexts.find(reinterpret_cast<unsigned int>(ctx));
-    if(it != m_contexts.end()) {
-        m_contexts.erase(it);
-        return true;
-    }
-    return false;
+    return m_contexts.remove(reinterpret_cast<unsigned int>(ctx));
 }
 
 bool EglDisplay::removeContext(ContextPtr ctx) {
     android::Mutex::Autolock mutex(m_lock);
-
-    ContextsHndlMap::iterator it;
-    for(it = m_contexts.begin(); it != m_contexts.end();it++) {
-        if((*it).second == ctx.Ptr()){
-            break;
-        }
-    }
-    if(it != m_contexts.end()) {
-        m_contexts.erase(it);
-        return true;
-    }
-    return false;
+    return ctx.Ptr() && m_contexts.remove(ctx->getHndl());
 }
 
 EglConfig* EglDisplay::getConfig(EGLint id) {
     android::Mutex::Autolock mutex(m_lock);
 
-    for(ConfigsList::iterator it = m_configs.begin(); it != m_configs.end() ;it++) {
-        if((*it)->id() == id) {
-            return (*it);
-
-        }
-    }
-    return NULL;
+    ConfigsIdMap::iterator it = m_configsById.find(id);
+    return it != m_configsById.end() ? (*it).second : NULL;
 }
 
 int EglDisplay::getConfigs(EGLConfig* configs,int config_size) {
     android::Mutex::Autolock mutex(m_lock);
     int i = 0;
-    for(ConfigsList::iterator it = m_configs.begin(); it != m_configs.end() && i < config_size ;i++,it++) {
+    for(ConfigsVector::iterator it = m_configs.begin(); it != m_configs.end() && i < config_size ;i++,it++) {
         configs[i] = static_cast<EGLConfig>(*it);
     }
     return i;
@@ -169,42 +187,54 @@ int EglDisplay::getConfigs(EGLConfig* configs,int config_size) {
 
 int EglDisplay::chooseConfigs(const EglConfig& dummy,EGLConfig* configs,int config_size) {
     android::Mutex::Autolock mutex(m_lock);
-    int added = 0;
-    for(ConfigsList::iterator it = m_configs.begin(); it != m_configs.end() && added < config_size;it++) {
+    EglConfigKey wanted;
+    getConfigKey(dummy,wanted);
+
+    //
+    // scan only the configs having the rarest of the requested surface
+    // bits, the buckets are in the sorted order of m_configs so the result
+    // does not need to be sorted
+    //
+    const std::vector<int>* bucket = NULL;
+    if(wanted.surfaceType != EGL_DONT_CARE) {
+        for(int b = 0; b < EGL_CONFIG_SURFACE_BUCKETS; b++) {
+            if((wanted.surfaceType & s_surfaceBucketBits[b]) &&
+               (!bucket || m_surfaceBuckets[b].size() < bucket->size())) {
+                bucket = &m_surfaceBuckets[b];
+            }
+        }
+    }
 
-       if( (*it)->choosen(dummy)){
-           configs[added++] = static_cast<EGLConfig>(*it);
-       }
+    int nCandidates = bucket ? bucket->size() : m_configs.size();
+    int added = 0;
+    for(int c = 0; c < nCandidates && (!configs || added < config_size); c++) {
+        int i = bucket ? (*bucket)[c] : c;
+        if(!keyMatches(m_configKeys[i],wanted) || !m_configs[i]->choosen(dummy)) continue;
+        if(configs) configs[added] = static_cast<EGLConfig>(m_configs[i]);
+        added++;
     }
-    //no need to sort since the configurations are saved already in sorted maner
     return added;
 }
 
 EGLSurface EglDisplay::addSurface(SurfacePtr s ) {
     android::Mutex::Autolock mutex(m_lock);
-   unsigned int hndl = s.Ptr()->getHndl();
-   EGLSurface ret =reinterpret_cast<EGLSurface> (hndl);
-
-   if(m_surfaces.find(hndl) != m_surfaces.end()) {
-       return ret;
+   unsigned int hndl = s->getHndl();
+   if(!hndl || m_surfaces.peek(hndl) != s.Ptr()) {
+       hndl = m_surfaces.add(s);
+       s->setHndl(hndl);
    }
-
-   m_surfaces[hndl] = s;
-   return ret;
+   return reinterpret_cast<EGLSurface>(hndl);
 }
 
 EGLContext EglDisplay::addContext(ContextPtr ctx ) {
     android::Mutex::Autolock mutex(m_lock);
 
-   unsigned int hndl = ctx.Ptr()->getHndl();
-   EGLContext ret    = reinterpret_cast<EGLContext> (hndl);
-
-   if(m_contexts.find(hndl) != m_contexts.end()) {
-       return ret;
+   unsigned int hndl = ctx->getHndl();
+   if(!hndl || m_contexts.peek(hndl) != ctx.Ptr()) {
+       hndl = m_contexts.add(ctx);
+       ctx->setHndl(hndl);
    }
-
-   m_contexts[hndl] = ctx;
-   return ret;
+   return reinterpret_cast<EGLContext>(hndl);
 }
 
 
@@ -232,3 +262,62 @@ bool EglDisplay:: destroyImageKHR(EGLImageKHR img) {
     }
     return false;
 }
+
+static void getPbufferKey(EglConfig* cfg,EglPbufferSurface* srfc,EglPooledPbuffer& key) {
+    key.config = cfg;
+    srfc->getDim(&key.width,&key.height,&key.largest);
+    srfc->getTexInfo(&key.texFormat,&key.texTarget);
+}
+
+static bool samePbufferKey(const EglPooledPbuffer& a,const EglPooledPbuffer& b) {
+    return a.config == b.config && a.width == b.width && a.height == b.height &&
+           a.largest == b.largest && a.texFormat == b.texFormat &&
+           a.texTarget == b.texTarget;
+}
+
+EGLNativePbufferType EglDisplay::createPbuffer(EglConfig* cfg,EglPbufferSurface* srfc) {
+    EglPooledPbuffer key;
+    getPbufferKey(cfg,srfc,key);
+    {
+        android::Mutex::Autolock mutex(m_lock);
+        for(PbufferPool::iterator it = m_pbufferPool.begin(); it != m_pbufferPool.end(); it++) {
+            if(samePbufferKey(*it,key)) {
+                EGLNativePbufferType pb = (*it).pb;
+                m_pbufferPool.erase(it);
+                return pb;
+            }
+        }
+    }
+    return EglOS::createPbuffer(m_dpy,cfg,srfc);
+}
+
+void EglDisplay::releasePbuffer(EglPbufferSurface* srfc) {
+    EGLNativePbufferType pb = reinterpret_cast<EGLNativePbufferType>(srfc->native());
+    if(!pb) return;
+    srfc->setNativePbuffer(0);
+
+    unsigned int max = pbufferPoolMax();
+    if(max == 0) {
+        EglOS::releasePbuffer(m_dpy,pb);
+        return;
+    }
+
+    EglPooledPbuffer entry;
+    getPbufferKey(srfc->getConfig(),srfc,entry);
+    entry.pb = pb;
+
+    android::Mutex::Autolock mutex(m_lock);
+    while(m_pbufferPool.size() >= max) {
+        EglOS::releasePbuffer(m_dpy,m_pbufferPool.front().pb);
+        m_pbufferPool.pop_front();
+    }
+    m_pbufferPool.push_back(entry);
+}
+
+//called with m_lock held
+void EglDisplay::releasePbufferPool() {
+    for(PbufferPool::iterator it = m_pbufferPool.begin(); it != m_pbufferPool.end(); it++) {
+        EglOS::releasePbuffer(m_dpy,(*it).pb);
+    }
+    m_pbufferPool.clear();
+}
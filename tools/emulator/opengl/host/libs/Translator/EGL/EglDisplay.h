@@ -17,7 +17,9 @@
 #define EGL_DISPLAY_H
 
 #include <list>
+#include <vector>
 #include <map>
+#include <set>
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
 #include <utils/threads.h>
@@ -27,12 +29,49 @@
 #include "EglContext.h"
 #include "EglSurface.h"
 #include "EglWindowSurface.h"
+#include "EglPbufferSurface.h"
+#include "EglHandleTable.h"
 
 
 
 typedef  std::list<EglConfig*>  ConfigsList;
-typedef  std::map< unsigned int, ContextPtr>     ContextsHndlMap;
-typedef  std::map< unsigned int, SurfacePtr>     SurfacesHndlMap;
+typedef  std::vector<EglConfig*>  ConfigsVector;
+typedef  std::set<EglConfig*>           ConfigsSet;
+typedef  std::map<EGLint, EglConfig*>   ConfigsIdMap;
+
+//
+// the attributes most selections ask for, kept next to each other so
+// eglChooseConfig can discard most configs without touching them
+//
+struct EglConfigKey {
+    EGLint red;
+    EGLint green;
+    EGLint blue;
+    EGLint alpha;
+    EGLint depth;
+    EGLint stencil;
+    EGLint surfaceType;
+};
+
+// window, pbuffer and pixmap surface bits
+#define EGL_CONFIG_SURFACE_BUCKETS 3
+//
+// native pbuffer of a destroyed pbuffer surface, kept for the next
+// surface created with the same config and attributes
+//
+struct EglPooledPbuffer {
+    EglConfig*           config;
+    EGLint               width;
+    EGLint               height;
+    EGLint               largest;
+    EGLint               texFormat;
+    EGLint               texTarget;
+    EGLNativePbufferType pb;
+};
+typedef  std::list<EglPooledPbuffer> PbufferPool;
+
+typedef  EglHandleTable<EglContext>     ContextsHndlTable;
+typedef  EglHandleTable<EglSurface>     SurfacesHndlTable;
 
 class EglDisplay {
 public:
@@ -55,6 +94,19 @@ public:
     ContextPtr getContext(EGLContext ctx);
     bool removeContext(EGLContext ctx);
     bool removeContext(ContextPtr ctx);
+
+    //
+    // lookups without the display lock, for the hot paths. The object is
+    // borrowed (see EglHandleTable::peek), use it only once it is known
+    // to be held otherwise, like the current context of the thread or
+    // its surfaces.
+    //
+    EglSurface* peekSurface(EGLSurface surface) const {
+        return m_surfaces.peek(reinterpret_cast<unsigned int>(surface));
+    }
+    EglContext* peekContext(EGLContext ctx) const {
+        return m_contexts.peek(reinterpret_cast<unsigned int>(ctx));
+    }
     ObjectNameManager* getManager(GLESVersion ver){ return &m_manager[ver];}
 
     ~EglDisplay();
@@ -66,20 +118,34 @@ public:
     EGLImageKHR addImageKHR(ImagePtr);
     bool destroyImageKHR(EGLImageKHR img);
 
+    //
+    // native pbuffers of pbuffer surfaces, a released pbuffer is pooled
+    // and handed back by createPbuffer for the same config and attributes
+    //
+    EGLNativePbufferType createPbuffer(EglConfig* cfg,EglPbufferSurface* srfc);
+    void releasePbuffer(EglPbufferSurface* srfc);
+
 private:
    void initConfigurations();
+   void indexConfigurations();
+   void releasePbufferPool();
 
    EGLNativeDisplayType   m_dpy;
    bool                   m_initialized;
    bool                   m_configInitialized;
    bool                   m_isDefault;
-   ConfigsList            m_configs;
-   ContextsHndlMap        m_contexts;
-   SurfacesHndlMap        m_surfaces;
+   ConfigsVector          m_configs;        // sorted as eglChooseConfig returns them
+   std::vector<EglConfigKey> m_configKeys;  // m_configKeys[i] is the key of m_configs[i]
+   std::vector<int>       m_surfaceBuckets[EGL_CONFIG_SURFACE_BUCKETS]; // indices of configs by surface bit
+   ConfigsSet             m_configsSet;     // for EGLConfig lookups
+   ConfigsIdMap           m_configsById;
+   ContextsHndlTable      m_contexts;
+   SurfacesHndlTable      m_surfaces;
    ObjectNameManager      m_manager[MAX_GLES_VERSION];
    android::Mutex         m_lock;
    ImagesHndlMap           m_eglImages;
    unsigned int           m_nextEglImageId;
+   PbufferPool            m_pbufferPool;    // oldest first
 };
 
 #endif
@@ -0,0 +1,163 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef EGL_HANDLE_TABLE_H
+#define EGL_HANDLE_TABLE_H
+
+#include <vector>
+#include <GLcommon/SmartPtr.h>
+
+//
+// EglHandleTable - the EGL handles of the contexts or surfaces of a
+// display. A handle is the slot index plus one in its low bits and the
+// generation of the slot in the high bits, which changes every time the
+// slot is freed, so a stale handle does not find the next object of the
+// slot.
+//
+// add, remove, get and clear must be called under the lock of the owner.
+// peek does not take any lock: the slots are in pages which never move
+// and are only freed with the table, and a slot is read between two
+// loads of its handle. The object it returns is borrowed, it may be
+// removed and deleted by another thread at any time, so the caller must
+// only use it once it has checked it is an object it holds a reference
+// on otherwise (like the surfaces of its current context).
+//
+template <class T>
+class EglHandleTable {
+public:
+    EglHandleTable() : m_used(0) {
+        for (int i = 0; i < MAX_PAGES; i++) {
+            m_pages[i] = NULL;
+        }
+    }
+
+    ~EglHandleTable() {
+        for (int i = 0; i < MAX_PAGES; i++) {
+            delete [] m_pages[i];
+        }
+    }
+
+    // add - stores 'obj', returns its handle or 0 if the table is full
+    unsigned int add(const SmartPtr<T>& obj) {
+        unsigned int index;
+        if (!m_free.empty()) {
+            index = m_free.back();
+            m_free.pop_back();
+        } else {
+            if (m_used == MAX_SLOTS) return 0;
+            index = m_used;
+            if (!m_pages[index >> PAGE_BITS]) {
+                Slot* page = new Slot[PAGE_SIZE];
+                // the slots are initialized before readers can see them
+                __sync_synchronize();
+                m_pages[index >> PAGE_BITS] = page;
+            }
+            m_used++;
+        }
+
+        Slot& s = slot(index);
+        unsigned int hndl = (s.gen << INDEX_BITS) | (index + 1);
+        s.ref = obj;
+        s.obj = obj.Ptr();
+        __sync_synchronize();
+        s.hndl = hndl;
+        return hndl;
+    }
+
+    // remove - releases the reference of the table on the object of 'hndl'
+    bool remove(unsigned int hndl) {
+        Slot* s = find(hndl);
+        if (!s) return false;
+
+        SmartPtr<T> ref;
+        ref.swap(s->ref);
+        s->hndl = 0;
+        __sync_synchronize();
+        s->obj = NULL;
+        s->gen = (s->gen + 1) & GEN_MASK;
+        m_free.push_back((hndl & INDEX_MASK) - 1);
+        // the object may be deleted now, after the slot is cleared
+        return true;
+    }
+
+    // get - a reference on the object of 'hndl', NULL if there is none
+    SmartPtr<T> get(unsigned int hndl) {
+        Slot* s = find(hndl);
+        return s ? s->ref : SmartPtr<T>(NULL);
+    }
+
+    // peek - the borrowed object of 'hndl', see above
+    T* peek(unsigned int hndl) const {
+        unsigned int index = (hndl & INDEX_MASK) - 1;
+        if (index >= MAX_SLOTS) return NULL;
+        Slot* page = m_pages[index >> PAGE_BITS];
+        if (!page) return NULL;
+        __sync_synchronize();
+
+        const Slot& s = page[index & PAGE_MASK];
+        if (s.hndl != hndl) return NULL;
+        __sync_synchronize();
+        T* obj = s.obj;
+        __sync_synchronize();
+        return s.hndl == hndl ? obj : NULL;
+    }
+
+    // clear - removes all the objects
+    void clear() {
+        for (unsigned int i = 0; i < m_used; i++) {
+            Slot& s = slot(i);
+            if (s.hndl) {
+                remove(s.hndl);
+            }
+        }
+    }
+
+private:
+    enum {
+        INDEX_BITS = 16,
+        INDEX_MASK = (1 << INDEX_BITS) - 1,
+        GEN_MASK   = 0xffff,
+        PAGE_BITS  = 8,
+        PAGE_SIZE  = 1 << PAGE_BITS,
+        PAGE_MASK  = PAGE_SIZE - 1,
+        MAX_SLOTS  = INDEX_MASK,    // the index plus one fits in the mask
+        MAX_PAGES  = (MAX_SLOTS + PAGE_SIZE - 1) / PAGE_SIZE
+    };
+
+    struct Slot {
+        Slot() : hndl(0), obj(NULL), gen(1) {}
+        volatile unsigned int hndl;  // 0 while the slot is free
+        T* volatile           obj;
+        unsigned int          gen;
+        SmartPtr<T>           ref;
+    };
+
+    Slot& slot(unsigned int index) {
+        return m_pages[index >> PAGE_BITS][index & PAGE_MASK];
+    }
+
+    Slot* find(unsigned int hndl) {
+        unsigned int index = (hndl & INDEX_MASK) - 1;
+        if (index >= m_used) return NULL;
+        Slot& s = slot(index);
+        return s.hndl == hndl && hndl != 0 ? &s : NULL;
+    }
+
+    Slot* volatile            m_pages[MAX_PAGES];
+    unsigned int              m_used;   // slots handed out at least once
+    std::vector<unsigned int> m_free;
+};
+
+#endif
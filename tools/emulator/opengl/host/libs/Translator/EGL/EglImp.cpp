@@ -59,16 +59,18 @@ static EGLiface            s_eglIface = {
 /*****************************************  supported extentions  ***********************************************************************/
 
 //extentions
-#define EGL_EXTENTIONS 2
+#define EGL_EXTENTIONS 3
 
 //decleration
 EGLImageKHR eglCreateImageKHR(EGLDisplay display, EGLContext context, EGLenum target, EGLClientBuffer buffer, const EGLint *attrib_list);
 EGLBoolean eglDestroyImageKHR(EGLDisplay display, EGLImageKHR image);
+EGLBoolean eglSetSwapRectangleANDROID(EGLDisplay display, EGLSurface surface, EGLint left, EGLint top, EGLint width, EGLint height);
 
 // extentions descriptors
 static ExtentionDescriptor s_eglExtentions[] = {
                                                    {"eglCreateImageKHR" ,(__eglMustCastToProperFunctionPointerType)eglCreateImageKHR},
-                                                   {"eglDestroyImageKHR",(__eglMustCastToProperFunctionPointerType)eglDestroyImageKHR}
+                                                   {"eglDestroyImageKHR",(__eglMustCastToProperFunctionPointerType)eglDestroyImageKHR},
+                                                   {"eglSetSwapRectangleANDROID",(__eglMustCastToProperFunctionPointerType)eglSetSwapRectangleANDROID}
                                                };
 
 /****************************************************************************************************************************************/
@@ -163,10 +165,16 @@ static __translator_getGLESIfaceFunc loadIfaces(const char* libName){
 
 #ifdef _WIN32
 #define LIB_GLES_NAME "libGLES_CM_translator"
+#define LIB_GLES_V2_NAME "libGLES_V2_translator"
 #elif __linux__
 #define LIB_GLES_NAME "libGLES_CM_translator.so"
+#define LIB_GLES_V2_NAME "libGLES_V2_translator.so"
+#elif defined(__APPLE__)
+#define LIB_GLES_NAME "libGLES_CM_translator.dylib"
+#define LIB_GLES_V2_NAME "libGLES_V2_translator.dylib"
 #else
 #define LIB_GLES_NAME "libGLES_CM_translator"
+#define LIB_GLES_V2_NAME "libGLES_V2_translator"
 #endif
 
 EGLAPI EGLBoolean EGLAPIENTRY eglInitialize(EGLDisplay display, EGLint *major, EGLint *minor) {
@@ -187,6 +195,13 @@ EGLAPI EGLBoolean EGLAPIENTRY eglInitialize(EGLDisplay display, EGLint *major, E
            return EGL_FALSE;
         }
     }
+    //GLES 2.0 is optional, contexts of version 2 just fail without it
+    if(!g_eglInfo->getIface(GLES_2_0)) {
+        __translator_getGLESIfaceFunc func  = loadIfaces(LIB_GLES_V2_NAME);
+        if(func){
+            g_eglInfo->setIface(func(&s_eglIface),GLES_2_0);
+        }
+    }
     dpy->initialize();
     return EGL_TRUE;
 }
@@ -201,7 +216,9 @@ EGLAPI const char * EGLAPIENTRY eglQueryString(EGLDisplay display, EGLint name)
     VALIDATE_DISPLAY(display);
     static const char* vendor     = "Google";
     static const char* version    = "1.4";
-    static const char* extensions = "EGL_KHR_image_base EGL_KHR_gl_texture_2d_image";
+    static const char* extensions = "EGL_KHR_image_base EGL_KHR_gl_texture_2D_image";
+    // partial swaps need the native platform to present part of a window
+    static const char* swapRectExtensions = "EGL_KHR_image_base EGL_KHR_gl_texture_2D_image EGL_ANDROID_swap_rectangle";
     if(!EglValidate::stringName(name)) {
         RETURN_ERROR(NULL,EGL_BAD_PARAMETER);
     }
@@ -211,7 +228,7 @@ EGLAPI const char * EGLAPIENTRY eglQueryString(EGLDisplay display, EGLint name)
     case EGL_VERSION:
         return version;
     case EGL_EXTENSIONS:
-        return extensions;
+        return EglOS::copySubBufferSupported(dpy->nativeType()) ? swapRectExtensions : extensions;
     }
     return NULL;
 }
@@ -495,7 +512,7 @@ EGLAPI EGLSurface EGLAPIENTRY eglCreatePbufferSurface(EGLDisplay display, EGLCon
         RETURN_ERROR(EGL_NO_SURFACE,EGL_BAD_ATTRIBUTE);
     }
 
-    EGLNativePbufferType pb = EglOS::createPbuffer(dpy->nativeType(),cfg,tmpPbSurfacePtr);
+    EGLNativePbufferType pb = dpy->createPbuffer(cfg,tmpPbSurfacePtr);
     if(!pb) {
         //TODO: RETURN_ERROR(EGL_NO_SURFACE,EGL_BAD_VALUE); dont have bad value
         RETURN_ERROR(EGL_NO_SURFACE,EGL_BAD_ATTRIBUTE);
@@ -538,7 +555,7 @@ static bool destroySurfaceIfNotCurrent(EglDisplay* dpy,SurfacePtr surface) {
     EglContext* currCtx = static_cast<EglContext*>(thread->eglContext);
     if(currCtx && !currCtx->usingSurface(surface)){
         if(surface->type() == EglSurface::PBUFFER) {
-            EglOS::releasePbuffer(dpy->nativeType(),reinterpret_cast<EGLNativePbufferType>(surface->native()));
+            dpy->releasePbuffer(static_cast<EglPbufferSurface*>(surface.Ptr()));
             return true;
         }
     }
@@ -654,8 +671,34 @@ EGLAPI EGLBoolean EGLAPIENTRY eglDestroyContext(EGLDisplay display, EGLContext c
     return EGL_TRUE;
 }
 
+//
+// isCurrentBinding - true if display/draw/read/context are what the calling
+// thread already has current. Checked with no lock, only from the thread
+// state, since the render thread makes its context current again on nearly
+// every request.
+//
+static bool isCurrentBinding(EGLDisplay display, EGLSurface draw,
+                             EGLSurface read, EGLContext context) {
+    ThreadInfo* thread  = getThreadInfo();
+    EglContext* currCtx = static_cast<EglContext*>(thread->eglContext);
+    EglDisplay* currDpy = static_cast<EglDisplay*>(thread->eglDisplay);
+    if(!currCtx || !thread->glesContext || !currDpy || static_cast<EGLDisplay>(currDpy) != display) return false;
+    if(!currDpy->isInitialize() || currCtx->destroy()) return false;
+    if(reinterpret_cast<EGLContext>(currCtx->getHndl()) != context) return false;
+
+    EglSurface* currDraw = currCtx->drawPtr();
+    EglSurface* currRead = currCtx->readPtr();
+    return currDraw && currRead && !currDraw->destroy() && !currRead->destroy() &&
+           reinterpret_cast<EGLSurface>(currDraw->getHndl()) == draw &&
+           reinterpret_cast<EGLSurface>(currRead->getHndl()) == read;
+}
+
 EGLAPI EGLBoolean EGLAPIENTRY eglMakeCurrent(EGLDisplay display, EGLSurface draw,
               EGLSurface read, EGLContext context) {
+    if(context != EGL_NO_CONTEXT && isCurrentBinding(display,draw,read,context)) {
+        return EGL_TRUE;
+    }
+
     VALIDATE_DISPLAY(display);
 
     bool releaseContext = EglValidate::releaseContext(context,read,draw);
@@ -764,21 +807,45 @@ EGLAPI EGLBoolean EGLAPIENTRY eglQueryContext(EGLDisplay display, EGLContext con
 
 EGLAPI EGLBoolean EGLAPIENTRY eglSwapBuffers(EGLDisplay display, EGLSurface surface) {
     VALIDATE_DISPLAY(display);
-    VALIDATE_SURFACE(surface,Srfc);
     ThreadInfo* thread        = getThreadInfo();
     EglContext* currentCtx    = static_cast<EglContext*>(thread->eglContext);
 
+    //
+    // the surface is normally one of the current context, which keeps it
+    // alive, so it is looked up without the display lock and reference
+    // count updates. Anything else takes the locked lookup.
+    //
+    SurfacePtr  srfcRef;
+    EglSurface* Srfc = dpy->peekSurface(surface);
+    if(!Srfc || !currentCtx || !currentCtx->isBound(Srfc)) {
+        srfcRef = dpy->getSurface(surface);
+        Srfc = srfcRef.Ptr();
+        if(!Srfc) {
+            RETURN_ERROR(EGL_FALSE,EGL_BAD_SURFACE);
+        }
+    }
 
     //if surface not window return
     if(Srfc->type() != EglSurface::WINDOW){
         RETURN_ERROR(EGL_TRUE,EGL_SUCCESS);
     }
 
-    if(!currentCtx || !currentCtx->usingSurface(Srfc) || !EglOS::validNativeWin(dpy->nativeType(),reinterpret_cast<EGLNativeWindowType>(Srfc.Ptr()->native()))) {
+    if(!currentCtx || !currentCtx->isBound(Srfc) || !EglOS::validNativeWin(dpy->nativeType(),reinterpret_cast<EGLNativeWindowType>(Srfc->native()))) {
         RETURN_ERROR(EGL_FALSE,EGL_BAD_SURFACE);
     }
 
-    EglOS::swapBuffers(dpy->nativeType(),reinterpret_cast<EGLNativeWindowType>(Srfc->native()));
+    //the GLES translator may hold some draws back, they go before the swap
+    g_eglInfo->getIface(currentCtx->version())->flush();
+    int left,top,width,height;
+    EglWindowSurface* winSrfc = static_cast<EglWindowSurface*>(Srfc);
+    if(winSrfc->getSwapRect(&left,&top,&width,&height)) {
+        EGLint srfcHeight = 0;
+        winSrfc->getAttrib(EGL_HEIGHT,&srfcHeight);
+        EglOS::copySubBuffer(dpy->nativeType(),reinterpret_cast<EGLNativeWindowType>(Srfc->native()),
+                             left,srfcHeight - top - height,width,height);
+    } else {
+        EglOS::swapBuffers(dpy->nativeType(),reinterpret_cast<EGLNativeWindowType>(Srfc->native()));
+    }
     return EGL_TRUE;
 }
 
@@ -803,7 +870,7 @@ EGLAPI EGLContext EGLAPIENTRY eglGetCurrentContext(void) {
     EglDisplay* dpy    = static_cast<EglDisplay*>(thread->eglDisplay);
     EglContext* ctx    = static_cast<EglContext*>(thread->eglContext);
     if(dpy && ctx){
-        return dpy->getContext(ContextPtr(ctx));
+        return reinterpret_cast<EGLContext>(ctx->getHndl());
     }
     return EGL_NO_CONTEXT;
 }
@@ -816,8 +883,8 @@ EGLAPI EGLSurface EGLAPIENTRY eglGetCurrentSurface(EGLint readdraw) {
     EglContext* ctx    = static_cast<EglContext*>(thread->eglContext);
 
     if(dpy && ctx) {
-        SurfacePtr surface = readdraw == EGL_READ ? ctx->read() : ctx->draw();
-        return dpy->getSurface(surface);
+        EglSurface* surface = readdraw == EGL_READ ? ctx->readPtr() : ctx->drawPtr();
+        return surface ? reinterpret_cast<EGLSurface>(surface->getHndl()) : EGL_NO_SURFACE;
     }
     return EGL_NO_SURFACE;
 }
@@ -913,9 +980,11 @@ EGLAPI __eglMustCastToProperFunctionPointerType EGLAPIENTRY
             }
         }
     } else if (!strncmp(procname,"gl",2)){ //GL proc
-        retVal = g_eglInfo->getIface(GLES_1_1)->getProcAddress(procname); //try to get it from GLES 1.0
-        if(!retVal){ //try to get it from GLES 2.0
-            retVal = g_eglInfo->getIface(GLES_2_0)->getProcAddress(procname);
+        GLESiface* iface = g_eglInfo->getIface(GLES_1_1);
+        if(iface) retVal = iface->getProcAddress(procname); //try to get it from GLES 1.0
+        iface = g_eglInfo->getIface(GLES_2_0);
+        if(!retVal && iface){ //try to get it from GLES 2.0
+            retVal = iface->getProcAddress(procname);
         }
     }
     return retVal;
@@ -1031,4 +1100,20 @@ EGLBoolean eglDestroyImageKHR(EGLDisplay display, EGLImageKHR image)
     return dpy->destroyImageKHR(image) ? EGL_TRUE:EGL_FALSE;
 }
 
+EGLBoolean eglSetSwapRectangleANDROID(EGLDisplay display, EGLSurface surface, EGLint left, EGLint top, EGLint width, EGLint height)
+{
+    VALIDATE_DISPLAY(display);
+    VALIDATE_SURFACE(surface,srfc);
+
+    if(srfc->type() != EglSurface::WINDOW || !EglOS::copySubBufferSupported(dpy->nativeType())) {
+        RETURN_ERROR(EGL_FALSE,EGL_BAD_SURFACE);
+    }
+    if(width < 0 || height < 0) {
+        RETURN_ERROR(EGL_FALSE,EGL_BAD_PARAMETER);
+    }
+
+    static_cast<EglWindowSurface*>(srfc.Ptr())->setSwapRect(left,top,width,height);
+    return EGL_TRUE;
+}
+
 /*********************************************************************************/
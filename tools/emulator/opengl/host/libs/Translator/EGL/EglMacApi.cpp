@@ -13,36 +13,114 @@
 * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 * See the License for the specific language governing permissions and
 * limitations under the License.
-*/
 #include "EglOsApi.h"
+#include "MacNative.h"
+#include <OpenGL/OpenGL.h>
+#include <OpenGL/glext.h>
+
+//
+// CGL implementation. There is a single display, the configs come from a
+// list of CGL pixel formats in the order of the attributes below. Windows
+// are NSView objects the contexts draw into through Cocoa, see MacNative.m.
+// Pixmaps are not supported.
+//
+struct _EGLNativeDisplayType {
+    int unused;
+};
+
+struct _EGLNativeContextType {
+    CGLContextObj cgl;
+    void*         nsCtx;  //NSOpenGLContext drawing into view
+    void*         view;
+};
 
+struct _EGLNativePbufferType {
+    CGLPBufferObj pbuffer;
+};
+
+static _EGLNativeDisplayType s_display;
+
+//color, alpha, depth and stencil sizes of the pixel formats offered
+static const int s_formatSizes[][4] = {
+    {24,8,24,8}, {24,8,24,0}, {24,8,16,0}, {24,8,0,0},
+    {24,0,24,8}, {24,0,24,0}, {24,0,16,0}, {24,0,0,0},
+    {16,0,24,8}, {16,0,16,0}, {16,0,0,0}
+};
 
-//TODO: implementation for mac for all funcs
 namespace EglOS {
 
-EGLNativeDisplayType getDefaultDisplay() {return NULL;}
+EGLNativeDisplayType getDefaultDisplay() {return &s_display;}
 
 bool releaseDisplay(EGLNativeDisplayType dpy) {
-    return false;
+    return true;
 }
 
-EglConfig* pixelFormatToConfig(EGLNativeDisplayType dpy,EGLNativePixelFormatType* frmt){
-    return NULL;
+static EglConfig* pixelFormatToConfig(int index,CGLPixelFormatObj frmt){
+    GLint color,alpha,depth,stencil,samples,pbuffer;
+    if(CGLDescribePixelFormat(frmt,0,kCGLPFAColorSize,&color)     != kCGLNoError ||
+       CGLDescribePixelFormat(frmt,0,kCGLPFAAlphaSize,&alpha)     != kCGLNoError ||
+       CGLDescribePixelFormat(frmt,0,kCGLPFADepthSize,&depth)     != kCGLNoError ||
+       CGLDescribePixelFormat(frmt,0,kCGLPFAStencilSize,&stencil) != kCGLNoError ||
+       CGLDescribePixelFormat(frmt,0,kCGLPFASamples,&samples)     != kCGLNoError ||
+       CGLDescribePixelFormat(frmt,0,kCGLPFAPBuffer,&pbuffer)     != kCGLNoError) {
+        return NULL;
+    }
+
+    //the color size may include the alpha bits
+    if(color > 24) color -= alpha;
+    EGLint red   = color >= 24 ? 8 : 5;
+    EGLint green = color >= 24 ? 8 : 6;
+    EGLint blue  = color >= 24 ? 8 : 5;
+
+    EGLint supportedSurfaces = EGL_WINDOW_BIT;
+    if(pbuffer) supportedSurfaces |= EGL_PBUFFER_BIT;
+
+    return new EglConfig(red,green,blue,alpha,EGL_NONE,index,depth,0,PBUFFER_MAX_WIDTH,PBUFFER_MAX_HEIGHT,
+                         PBUFFER_MAX_PIXELS,EGL_FALSE,0,EGL_NONE,samples,stencil,supportedSurfaces,
+                         EGL_NONE,0,0,0,frmt);
 }
 
 void queryConfigs(EGLNativeDisplayType dpy,ConfigsList& listOut) {
+    int index = 1;
+    for(unsigned int i = 0; i < sizeof(s_formatSizes)/sizeof(s_formatSizes[0]); i++) {
+        CGLPixelFormatAttribute attribs[] = {
+            kCGLPFAColorSize,   (CGLPixelFormatAttribute)s_formatSizes[i][0],
+            kCGLPFAAlphaSize,   (CGLPixelFormatAttribute)s_formatSizes[i][1],
+            kCGLPFADepthSize,   (CGLPixelFormatAttribute)s_formatSizes[i][2],
+            kCGLPFAStencilSize, (CGLPixelFormatAttribute)s_formatSizes[i][3],
+            kCGLPFAAccelerated,
+            kCGLPFANoRecovery,
+            kCGLPFADoubleBuffer,
+            kCGLPFAPBuffer,
+            (CGLPixelFormatAttribute)0
+        };
+        CGLPixelFormatObj frmt = NULL;
+        GLint n = 0;
+        if(CGLChoosePixelFormat(attribs,&frmt,&n) != kCGLNoError || !frmt) continue;
+
+        EglConfig* conf = pixelFormatToConfig(index,frmt);
+        if(conf) {
+            listOut.push_back(conf);
+            index++;
+        } else {
+            CGLReleasePixelFormat(frmt);
+        }
+    }
 }
 
 bool validNativeWin(EGLNativeDisplayType dpy, EGLNativeWindowType win) {
-   return true;
+   return nsValidView(win);
 }
 
 bool validNativePixmap(EGLNativeDisplayType dpy, EGLNativePixmapType pix) {
-   return true;
+   return false;
 }
 
+//any view can show any of the pixel formats
 bool checkWindowPixelFormatMatch(EGLNativeDisplayType dpy,EGLNativeWindowType win,EglConfig* cfg,unsigned int* width,unsigned int* height) {
-    return false;
+    if(!nsValidView(win)) return false;
+    nsGetViewSize(win,width,height);
+    return true;
 }
 
 bool checkPixmapPixelFormatMatch(EGLNativeDisplayType dpy,EGLNativePixmapType pix,EglConfig* cfg,unsigned int* width,unsigned int* height) {
@@ -50,34 +128,104 @@ bool checkPixmapPixelFormatMatch(EGLNativeDisplayType dpy,EGLNativePixmapType pi
 }
 
 EGLNativePbufferType createPbuffer(EGLNativeDisplayType dpy,EglConfig* cfg,EglPbufferSurface* srfc){
-    return NULL;
+    EGLint width,height,largest,alpha;
+    srfc->getDim(&width,&height,&largest);
+    cfg->getConfAttrib(EGL_ALPHA_SIZE,&alpha);
+
+    //rectangle textures, so any size can be used
+    CGLPBufferObj pbuffer = NULL;
+    if(CGLCreatePBuffer(width,height,GL_TEXTURE_RECTANGLE_EXT,alpha ? GL_RGBA : GL_RGB,0,&pbuffer) != kCGLNoError) {
+        return NULL;
+    }
+    EGLNativePbufferType pb = new _EGLNativePbufferType;
+    pb->pbuffer = pbuffer;
+    return pb;
 }
 
 bool releasePbuffer(EGLNativeDisplayType dis,EGLNativePbufferType pb) {
+    if(!pb) return false;
+    CGLDestroyPBuffer(pb->pbuffer);
+    delete pb;
     return true;
 }
 
 EGLNativeContextType createContext(EGLNativeDisplayType dpy,EglConfig* cfg,EGLNativeContextType sharedContext) {
- return NULL;
+    CGLContextObj cgl = NULL;
+    if(CGLCreateContext((CGLPixelFormatObj)cfg->nativeConfig(),sharedContext ? sharedContext->cgl : NULL,&cgl) != kCGLNoError) {
+        return NULL;
+    }
+    EGLNativeContextType ctx = new _EGLNativeContextType;
+    ctx->cgl   = cgl;
+    ctx->nsCtx = NULL;
+    ctx->view  = NULL;
+    return ctx;
+}
+
+static void detachView(EGLNativeContextType ctx) {
+    if(ctx->nsCtx) nsDetachContext(ctx->nsCtx);
+    ctx->nsCtx = NULL;
+    ctx->view  = NULL;
 }
 
 bool destroyContext(EGLNativeDisplayType dpy,EGLNativeContextType ctx) {
-    return false;
+    if(!ctx) return false;
+    if(CGLGetCurrentContext() == ctx->cgl) CGLSetCurrentContext(NULL);
+    detachView(ctx);
+    CGLDestroyContext(ctx->cgl);
+    delete ctx;
+    return true;
 }
 
+//
+// the context draws into the draw surface and reads from it too, CGL has
+// no separate read drawable
+//
+bool makeCurrent(EGLNativeDisplayType dpy,EglSurface* read,EglSurface* draw,EGLNativeContextType ctx){
+    if(!ctx) return CGLSetCurrentContext(NULL) == kCGLNoError;
+    if(!draw) return false;
+
+    if(draw->type() == EglSurface::WINDOW) {
+        void* view = draw->native();
+        if(ctx->view != view) {
+            detachView(ctx);
+            ctx->nsCtx = nsAttachContext(ctx->cgl,view);
+            if(!ctx->nsCtx) return false;
+            ctx->view = view;
+        } else {
+            nsUpdateContext(ctx->nsCtx);
+        }
+    } else if(draw->type() == EglSurface::PBUFFER) {
+        EGLNativePbufferType pb = (EGLNativePbufferType)draw->native();
+        GLint screen = 0;
+        detachView(ctx);
+        CGLGetVirtualScreen(ctx->cgl,&screen);
+        if(!pb || CGLSetPBuffer(ctx->cgl,pb->pbuffer,0,0,screen) != kCGLNoError) return false;
+    } else {
+        return false;
+    }
+    return CGLSetCurrentContext(ctx->cgl) == kCGLNoError;
+}
 
+//the window is the one the current context draws into
+void swapBuffers(EGLNativeDisplayType dpy,EGLNativeWindowType win) {
+    CGLContextObj cgl = CGLGetCurrentContext();
+    if(cgl) CGLFlushDrawable(cgl);
+}
 
-bool makeCurrent(EGLNativeDisplayType dpy,EglSurface* read,EglSurface* draw,EGLNativeContextType ctx){
+bool copySubBufferSupported(EGLNativeDisplayType dpy) {
     return false;
 }
 
-void swapBuffers(EGLNativeDisplayType dpy,EGLNativeWindowType win) {
+void copySubBuffer(EGLNativeDisplayType dpy,EGLNativeWindowType win,int x,int y,int width,int height) {
 }
 
 void waitNative() {
 }
 
 void swapInterval(EGLNativeDisplayType dpy,EGLNativeWindowType win,int interval){
+    CGLContextObj cgl = CGLGetCurrentContext();
+    GLint value = interval;
+    if(cgl) CGLSetParameter(cgl,kCGLCPSwapInterval,&value);
 }
 
 };
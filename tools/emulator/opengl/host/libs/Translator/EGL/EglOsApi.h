@@ -42,6 +42,10 @@ namespace EglOS{
     bool checkPixmapPixelFormatMatch(EGLNativeDisplayType dpy,EGLNativePixmapType pix,EglConfig* cfg,unsigned int* width,unsigned int* height);
     bool makeCurrent(EGLNativeDisplayType dpy,EglSurface* read,EglSurface* draw,EGLNativeContextType);
     void swapBuffers(EGLNativeDisplayType dpy,EGLNativeWindowType win);
+    // partial present of a window from its back buffer, which is kept.
+    // x, y is the bottom-left corner of the rectangle.
+    bool copySubBufferSupported(EGLNativeDisplayType dpy);
+    void copySubBuffer(EGLNativeDisplayType dpy,EGLNativeWindowType win,int x,int y,int width,int height);
     void swapInterval(EGLNativeDisplayType dpy,EGLNativeWindowType win,int interval);
     void waitNative();
 
@@ -15,8 +15,6 @@
 */
 #include "EglSurface.h"
 
-unsigned int EglSurface::s_nextSurfaceHndl = 0;
-
 bool  EglSurface::setAttrib(EGLint attrib,EGLint val) {
     switch(attrib) {
     case EGL_WIDTH:
@@ -42,9 +42,9 @@ public:
   bool          destroy(){return m_destroy;};
   EglConfig*    getConfig(){return m_config;};
   unsigned int  getHndl(){return m_hndl;};
+  void          setHndl(unsigned int hndl){m_hndl = hndl;};  // by EglDisplay::addSurface
 
 private:
-    static unsigned int   s_nextSurfaceHndl;
     ESurfaceType          m_type;
     bool                  m_destroy;
     unsigned int          m_hndl;
@@ -54,7 +54,7 @@ protected:
                                                                                m_destroy(false),
                                                                                m_config(config),
                                                                                m_width(width),
-                                                                               m_height(height){ m_hndl = ++s_nextSurfaceHndl;};
+                                                                               m_height(height){ m_hndl = 0;};
     EglConfig*   m_config;
     EGLint       m_width;
     EGLint       m_height;
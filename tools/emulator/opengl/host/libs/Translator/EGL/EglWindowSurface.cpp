@@ -22,7 +22,12 @@ bool EglWindowSurface::alreadyAssociatedWithConfig(EGLNativeWindowType win) {
 
 }
 
-EglWindowSurface::EglWindowSurface(EGLNativeWindowType win,EglConfig* config,unsigned int width,unsigned int height):EglSurface(WINDOW,config,width,height),m_win(win){
+EglWindowSurface::EglWindowSurface(EGLNativeWindowType win,EglConfig* config,unsigned int width,unsigned int height):EglSurface(WINDOW,config,width,height),
+                                                                                                                      m_win(win),
+                                                                                                                      m_swapLeft(0),
+                                                                                                                      m_swapTop(0),
+                                                                                                                      m_swapWidth(0),
+                                                                                                                      m_swapHeight(0){
     s_associatedWins.insert(win);
 }
 
@@ -30,6 +35,22 @@ EglWindowSurface:: ~EglWindowSurface() {
     s_associatedWins.erase(m_win);
 }
 
+void EglWindowSurface::setSwapRect(int left,int top,int width,int height) {
+    m_swapLeft   = left;
+    m_swapTop    = top;
+    m_swapWidth  = width;
+    m_swapHeight = height;
+}
+
+bool EglWindowSurface::getSwapRect(int* left,int* top,int* width,int* height) {
+    if(m_swapWidth <= 0 || m_swapHeight <= 0) return false;
+    *left   = m_swapLeft;
+    *top    = m_swapTop;
+    *width  = m_swapWidth;
+    *height = m_swapHeight;
+    return true;
+}
+
 bool  EglWindowSurface::getAttrib(EGLint attrib,EGLint* val) {
     switch(attrib) {
     case EGL_CONFIG_ID:
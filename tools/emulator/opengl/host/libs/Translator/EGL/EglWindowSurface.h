@@ -28,9 +28,21 @@ public:
     bool  getAttrib(EGLint attrib,EGLint* val);
     void* native(){ return (void *)m_win;};
 
+    //
+    // swap rectangle of eglSetSwapRectangleANDROID, top-left origin. While
+    // it is set the swaps only present that part of the surface and keep
+    // the back buffer content, an empty rectangle restores regular swaps.
+    //
+    void  setSwapRect(int left,int top,int width,int height);
+    bool  getSwapRect(int* left,int* top,int* width,int* height);
+
     static bool alreadyAssociatedWithConfig(EGLNativeWindowType win);
 private:
     EGLNativeWindowType m_win;
+    int                 m_swapLeft;
+    int                 m_swapTop;
+    int                 m_swapWidth;
+    int                 m_swapHeight;
     static std::set<EGLNativeWindowType> s_associatedWins;
 };
 #endif
@@ -247,13 +247,17 @@ EglConfig* pixelFormatToConfig(EGLNativeDisplayType display,EGLNativePixelFormat
                           WGL_TRANSPARENT_GREEN_VALUE_ARB,
                           WGL_TRANSPARENT_BLUE_VALUE_ARB
                      };
+    int values[sizeof(attribs)/sizeof(attribs[0])];
 
     supportedSurfaces = 0;
     if(!s_wglExtProcs->wglGetPixelFormatAttribivARB) return NULL;
 
-    IS_TRUE(s_wglExtProcs->wglGetPixelFormatAttribivARB(dpy,index,0,1,&attribs[0],&window));
-    IS_TRUE(s_wglExtProcs->wglGetPixelFormatAttribivARB(dpy,index,0,1,&attribs[1],&bitmap));
-    IS_TRUE(s_wglExtProcs->wglGetPixelFormatAttribivARB(dpy,index,0,1,&attribs[2],&pbuffer));
+    //one driver call for all the attributes instead of one per attribute
+    IS_TRUE(s_wglExtProcs->wglGetPixelFormatAttribivARB(dpy,index,0,sizeof(attribs)/sizeof(attribs[0]),attribs,values));
+    window      = values[0];
+    bitmap      = values[1];
+    pbuffer     = values[2];
+    transparent = values[3];
     if(window)  supportedSurfaces |= EGL_WINDOW_BIT;
     if(bitmap)  supportedSurfaces |= EGL_PIXMAP_BIT;
     if(pbuffer) supportedSurfaces |= EGL_PBUFFER_BIT;
@@ -271,12 +275,11 @@ EglConfig* pixelFormatToConfig(EGLNativeDisplayType display,EGLNativePixelFormat
     samples                   = 0 ;
     level                     = 0 ;
 
-    IS_TRUE(s_wglExtProcs->wglGetPixelFormatAttribivARB(dpy,index,0,1,&attribs[3],&transparent));
     if(transparent) {
         transparentType = EGL_TRANSPARENT_RGB;
-        IS_TRUE(s_wglExtProcs->wglGetPixelFormatAttribivARB(dpy,index,0,1,&attribs[4],&tRed));
-        IS_TRUE(s_wglExtProcs->wglGetPixelFormatAttribivARB(dpy,index,0,1,&attribs[5],&tGreen));
-        IS_TRUE(s_wglExtProcs->wglGetPixelFormatAttribivARB(dpy,index,0,1,&attribs[6],&tBlue));
+        tRed   = values[4];
+        tGreen = values[5];
+        tBlue  = values[6];
     } else {
         transparentType = EGL_NONE;
     }
@@ -515,6 +518,13 @@ void swapBuffers(EGLNativeDisplayType display,EGLNativeWindowType win) {
 
 }
 
+bool copySubBufferSupported(EGLNativeDisplayType display) {
+    return false;
+}
+
+void copySubBuffer(EGLNativeDisplayType display,EGLNativeWindowType win,int x,int y,int width,int height) {
+}
+
 
 void waitNative(){}
 
@@ -168,10 +168,12 @@ bool validNativePixmap(EGLNativeDisplayType dpy,EGLNativePixmapType pix) {
 bool checkWindowPixelFormatMatch(EGLNativeDisplayType dpy,EGLNativeWindowType win,EglConfig* cfg,unsigned int* width,unsigned int* height) {
 //TODO: to check what does ATI & NVIDIA enforce on win pixelformat
    unsigned int depth,configDepth,border;
-   int r,g,b,x,y;
-   IS_SUCCESS(glXGetFBConfigAttrib(dpy,cfg->nativeConfig(),GLX_RED_SIZE,&r));
-   IS_SUCCESS(glXGetFBConfigAttrib(dpy,cfg->nativeConfig(),GLX_GREEN_SIZE,&g));
-   IS_SUCCESS(glXGetFBConfigAttrib(dpy,cfg->nativeConfig(),GLX_BLUE_SIZE,&b));
+   EGLint r,g,b;
+   int x,y;
+   //the sizes were read from the FBConfig when the config list was built
+   cfg->getConfAttrib(EGL_RED_SIZE,&r);
+   cfg->getConfAttrib(EGL_GREEN_SIZE,&g);
+   cfg->getConfAttrib(EGL_BLUE_SIZE,&b);
    configDepth = r + g + b;
    Window root;
    if(!XGetGeometry(dpy,win,&root,&x,&y,width,height,&border,&depth)) return false;
@@ -180,10 +182,12 @@ bool checkWindowPixelFormatMatch(EGLNativeDisplayType dpy,EGLNativeWindowType wi
 
 bool checkPixmapPixelFormatMatch(EGLNativeDisplayType dpy,EGLNativePixmapType pix,EglConfig* cfg,unsigned int* width,unsigned int* height) {
    unsigned int depth,configDepth,border;
-   int r,g,b,x,y;
-   IS_SUCCESS(glXGetFBConfigAttrib(dpy,cfg->nativeConfig(),GLX_RED_SIZE,&r));
-   IS_SUCCESS(glXGetFBConfigAttrib(dpy,cfg->nativeConfig(),GLX_GREEN_SIZE,&g));
-   IS_SUCCESS(glXGetFBConfigAttrib(dpy,cfg->nativeConfig(),GLX_BLUE_SIZE,&b));
+   EGLint r,g,b;
+   int x,y;
+   //the sizes were read from the FBConfig when the config list was built
+   cfg->getConfAttrib(EGL_RED_SIZE,&r);
+   cfg->getConfAttrib(EGL_GREEN_SIZE,&g);
+   cfg->getConfAttrib(EGL_BLUE_SIZE,&b);
    configDepth = r + g + b;
    Window root;
    if(!XGetGeometry(dpy,pix,&root,&x,&y,width,height,&border,&depth)) return false;
@@ -245,6 +249,27 @@ void swapBuffers(EGLNativeDisplayType dpy,EGLNativeWindowType win) {
     glXSwapBuffers(dpy,win);
 }
 
+typedef void (*GLXCOPYSUBBUFFERMESA)(Display*,GLXDrawable,int,int,int,int);
+
+static GLXCOPYSUBBUFFERMESA getCopySubBuffer(EGLNativeDisplayType dpy) {
+    const char* extensions = glXQueryExtensionsString(dpy,DefaultScreen(dpy));
+    if(!extensions || !strstr(extensions,"GLX_MESA_copy_sub_buffer")) {
+        return NULL;
+    }
+    return (GLXCOPYSUBBUFFERMESA)glXGetProcAddress((const GLubyte*)"glXCopySubBufferMESA");
+}
+
+bool copySubBufferSupported(EGLNativeDisplayType dpy) {
+    return getCopySubBuffer(dpy) != NULL;
+}
+
+void copySubBuffer(EGLNativeDisplayType dpy,EGLNativeWindowType win,int x,int y,int width,int height) {
+    GLXCOPYSUBBUFFERMESA glXCopySubBufferMESA = getCopySubBuffer(dpy);
+    if(glXCopySubBufferMESA) {
+        glXCopySubBufferMESA(dpy,win,x,y,width,height);
+    }
+}
+
 void waitNative() {
     glXWaitX();
 }
@@ -0,0 +1,43 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef MAC_NATIVE_H
+#define MAC_NATIVE_H
+
+#include <stdbool.h>
+#include <OpenGL/OpenGL.h>
+
+//
+// Cocoa side of the Mac EGL backend, see EglMacApi.cpp. The windows are
+// NSView objects, a CGL context draws into one through an NSOpenGLContext
+// wrapping it.
+//
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool  nsValidView(void* view);
+void  nsGetViewSize(void* view,unsigned int* width,unsigned int* height);
+// returns the NSOpenGLContext drawing into 'view' with 'ctx', or NULL
+void* nsAttachContext(CGLContextObj ctx,void* view);
+// follows a change of the view size or position
+void  nsUpdateContext(void* nsCtx);
+void  nsDetachContext(void* nsCtx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
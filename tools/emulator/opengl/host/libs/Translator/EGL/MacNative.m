@@ -0,0 +1,54 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#import <Cocoa/Cocoa.h>
+#include "MacNative.h"
+
+//the calls come from the render threads, which have no autorelease pool
+bool nsValidView(void* view) {
+    NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+    bool valid = view && [(id)view isKindOfClass:[NSView class]];
+    [pool release];
+    return valid;
+}
+
+void nsGetViewSize(void* view,unsigned int* width,unsigned int* height) {
+    NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+    NSRect bounds = [(NSView*)view bounds];
+    *width  = (unsigned int)bounds.size.width;
+    *height = (unsigned int)bounds.size.height;
+    [pool release];
+}
+
+void* nsAttachContext(CGLContextObj ctx,void* view) {
+    NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+    NSOpenGLContext* nsCtx = [[NSOpenGLContext alloc] initWithCGLContextObj:ctx];
+    if(nsCtx) [nsCtx setView:(NSView*)view];
+    [pool release];
+    return nsCtx;
+}
+
+void nsUpdateContext(void* nsCtx) {
+    NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+    [(NSOpenGLContext*)nsCtx update];
+    [pool release];
+}
+
+void nsDetachContext(void* nsCtx) {
+    NSAutoreleasePool* pool = [[NSAutoreleasePool alloc] init];
+    [(NSOpenGLContext*)nsCtx clearDrawable];
+    [(NSOpenGLContext*)nsCtx release];
+    [pool release];
+}
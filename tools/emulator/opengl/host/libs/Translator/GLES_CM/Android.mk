@@ -4,7 +4,7 @@ LOCAL_PATH := $(call my-dir)
 include $(CLEAR_VARS)
 
 translator_path := $(LOCAL_PATH)/..
-#exclude darwin builds
+#exclude darwin builds until the CGL backend has been built on a Mac
 ifeq (, $(findstring $(HOST_OS), darwin))
 
 LOCAL_SRC_FILES :=    \
@@ -16,6 +16,9 @@ LOCAL_SRC_FILES :=    \
      GLESutils.cpp    \
      GLESbuffer.cpp   \
      TextureUtils.cpp \
+     GLfixed_convert.cpp \
+     GLfixed_pool.cpp \
+     FFProgramCache.cpp \
      RangeManip.cpp
 
 LOCAL_C_INCLUDES += \
@@ -31,6 +34,10 @@ LOCAL_SHARED_LIBRARIES := \
     libGLcommon
 
 LOCAL_CFLAGS := -g -O0
+# the enums were validated by the guest already, see GLESvalidate.h
+ifeq ($(GLES_TRUSTED_GUEST),true)
+    LOCAL_CFLAGS += -DGLES_TRUSTED_GUEST
+endif
 LOCAL_MODULE_TAGS := debug
 LOCAL_MODULE := libGLES_CM_translator
 
@@ -42,6 +49,10 @@ ifeq ($(HOST_OS),windows)
     LOCAL_LDLIBS := -lopengl32 -lgdi32
 endif
 
+ifeq ($(HOST_OS),darwin)
+    LOCAL_LDLIBS := -Wl,-framework,OpenGL
+endif
+
 include $(BUILD_HOST_SHARED_LIBRARY)
 
 endif
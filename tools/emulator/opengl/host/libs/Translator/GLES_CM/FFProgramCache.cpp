@@ -0,0 +1,310 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "FFProgramCache.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string>
+
+#define GL_FRAGMENT_SHADER 0x8B30
+#define GL_VERTEX_SHADER   0x8B31
+#define GL_COMPILE_STATUS  0x8B81
+#define GL_LINK_STATUS     0x8B82
+#define GL_INFO_LOG_LENGTH 0x8B84
+#define GL_CURRENT_PROGRAM 0x8B8D
+
+android::Mutex             FFProgramCache::s_lock;
+FFProgramCache::ProgramMap FFProgramCache::s_programs;
+
+static void append(std::string& str,const char* fmt,...) {
+    char buf[512];
+    va_list ap;
+    va_start(ap,fmt);
+    vsnprintf(buf,sizeof(buf),fmt,ap);
+    va_end(ap);
+    str += buf;
+}
+
+//
+// the lighting of GLES 1.1, accumulated into 'color' for a light. The viewer
+// is at infinity and the ambient and diffuse colors of the material are given,
+// they are the vertex color with GL_COLOR_MATERIAL. $L is the light source.
+//
+static const char s_lightBlock[] =
+"    {\n"
+"        vec3 VP;\n"
+"        float att = 1.0;\n"
+"        if ($L.position.w != 0.0) {\n"
+"            VP = $L.position.xyz - eyePos;\n"
+"            float d = length(VP);\n"
+"            VP /= d;\n"
+"            att = 1.0 / ($L.constantAttenuation + $L.linearAttenuation * d + $L.quadraticAttenuation * d * d);\n"
+"            if ($L.spotCutoff != 180.0) {\n"
+"                float spotDot = dot(-VP, normalize($L.spotDirection));\n"
+"                if (spotDot < $L.spotCosCutoff) att = 0.0;\n"
+"                else if ($L.spotExponent != 0.0) att *= pow(spotDot, $L.spotExponent);\n"
+"            }\n"
+"        } else {\n"
+"            VP = normalize($L.position.xyz);\n"
+"        }\n"
+"        float nDotVP = max(dot(n, VP), 0.0);\n"
+"        color += att * ($L.ambient.rgb * ambient.rgb + nDotVP * $L.diffuse.rgb * diffuse.rgb);\n"
+"        if (nDotVP > 0.0) {\n"
+"            float nDotH = max(dot(n, normalize(VP + vec3(0.0, 0.0, 1.0))), 0.0);\n"
+"            float pf = gl_FrontMaterial.shininess != 0.0 ? pow(nDotH, gl_FrontMaterial.shininess) : 1.0;\n"
+"            color += att * pf * $L.specular.rgb * gl_FrontMaterial.specular.rgb;\n"
+"        }\n"
+"    }\n";
+
+static std::string vertexShader(const FFProgramKey& key) {
+    std::string src = "#version 120\n";
+    bool lighting = (key.flags & FF_KEY_LIGHTING) != 0;
+    if(lighting) {
+        src += "vec4 lit(vec3 n, vec3 eyePos, vec4 ambient, vec4 diffuse)\n"
+               "{\n"
+               "    vec3 color = gl_FrontMaterial.emission.rgb + gl_LightModel.ambient.rgb * ambient.rgb;\n";
+        for(int i = 0; i < 8; i++) {
+            if(!(key.lights & (1 << i))) continue;
+            std::string block = s_lightBlock;
+            char source[32];
+            snprintf(source,sizeof(source),"gl_LightSource[%d]",i);
+            for(size_t pos = block.find("$L"); pos != std::string::npos; pos = block.find("$L",pos)) {
+                block.replace(pos,2,source);
+            }
+            src += block;
+        }
+        src += "    return vec4(clamp(color, 0.0, 1.0), clamp(diffuse.a, 0.0, 1.0));\n"
+               "}\n";
+    }
+
+    src += "void main()\n"
+           "{\n"
+           "    vec4 eyePos = gl_ModelViewMatrix * gl_Vertex;\n"
+           "    gl_Position = ftransform();\n"
+           "    gl_ClipVertex = eyePos;\n";
+    if(lighting) {
+        const char* material = key.flags & FF_KEY_COLOR_MATERIAL ? "gl_Color" : NULL;
+        src += "    vec3 normal = gl_NormalMatrix * gl_Normal;\n";
+        if(key.flags & FF_KEY_NORMALIZE) src += "    normal = normalize(normal);\n";
+        else if(key.flags & FF_KEY_RESCALE_NORMAL) src += "    normal *= gl_NormalScale;\n";
+        append(src,"    vec4 ambient = %s;\n",material ? material : "gl_FrontMaterial.ambient");
+        append(src,"    vec4 diffuse = %s;\n",material ? material : "gl_FrontMaterial.diffuse");
+        src += "    gl_FrontColor = lit(normal, eyePos.xyz, ambient, diffuse);\n";
+        if(key.flags & FF_KEY_TWO_SIDE) src += "    gl_BackColor = lit(-normal, eyePos.xyz, ambient, diffuse);\n";
+    } else {
+        src += "    gl_FrontColor = gl_Color;\n";
+    }
+    for(int i = 0; i < MAX_TEX_UNITS; i++) {
+        if(key.units[i].format) append(src,"    gl_TexCoord[%d] = gl_TextureMatrix[%d] * gl_MultiTexCoord%d;\n",i,i,i);
+    }
+    if(key.fogMode) src += "    gl_FogFragCoord = abs(eyePos.z);\n";
+    src += "}\n";
+    return src;
+}
+
+static std::string combineSource(GLenum src,int unit) {
+    char buf[32];
+    switch(src) {
+    case GL_TEXTURE:       return "tex";
+    case GL_PRIMARY_COLOR: return "primary";
+    case GL_CONSTANT:
+        snprintf(buf,sizeof(buf),"gl_TextureEnvColor[%d]",unit);
+        return buf;
+    default:               return "prev";
+    }
+}
+
+static std::string combineArg(GLenum src,GLenum operand,int unit) {
+    std::string s = combineSource(src,unit);
+    switch(operand) {
+    case GL_SRC_COLOR:           return s + ".rgb";
+    case GL_ONE_MINUS_SRC_COLOR: return "(1.0 - " + s + ".rgb)";
+    case GL_ONE_MINUS_SRC_ALPHA: return "(1.0 - " + s + ".a)";
+    default:                     return s + ".a";
+    }
+}
+
+//an alpha operand of the rgb combiner is replicated
+static std::string combineRGBArg(GLenum src,GLenum operand,int unit) {
+    if(operand == GL_SRC_ALPHA || operand == GL_ONE_MINUS_SRC_ALPHA) {
+        return "vec3(" + combineArg(src,operand,unit) + ")";
+    }
+    return combineArg(src,operand,unit);
+}
+
+static std::string combineFunc(GLenum func,const std::string* a) {
+    switch(func) {
+    case GL_REPLACE:     return a[0];
+    case GL_ADD:         return a[0] + " + " + a[1];
+    case GL_ADD_SIGNED:  return a[0] + " + " + a[1] + " - 0.5";
+    case GL_INTERPOLATE: return "mix(" + a[1] + ", " + a[0] + ", " + a[2] + ")";
+    case GL_SUBTRACT:    return a[0] + " - " + a[1];
+    case GL_DOT3_RGB:
+    case GL_DOT3_RGBA:   return "vec3(4.0 * dot(" + a[0] + " - 0.5, " + a[1] + " - 0.5))";
+    default:             return a[0] + " * " + a[1];
+    }
+}
+
+//
+// the texture environment of a unit, from the sampled 'tex' and the 'prev'
+// output of the previous unit. The texture functions of GLES 1.1 depend on
+// the base format, the missing components are taken from 'prev'.
+//
+static void texEnvStage(std::string& src,const FFTexUnitKey& unit,int i) {
+    append(src,"    tex = texture2DProj(u_tex%d, gl_TexCoord[%d]);\n",i,i);
+    bool hasColor = unit.format != GL_ALPHA;
+    bool hasAlpha = unit.format == GL_ALPHA || unit.format == GL_LUMINANCE_ALPHA || unit.format == GL_RGBA;
+    switch(unit.envMode) {
+    case GL_REPLACE:
+        append(src,"    prev = vec4(%s, %s);\n",hasColor ? "tex.rgb" : "prev.rgb",hasAlpha ? "tex.a" : "prev.a");
+        break;
+    case GL_DECAL:
+        if(unit.format == GL_RGB) src += "    prev.rgb = tex.rgb;\n";
+        else if(unit.format == GL_RGBA) src += "    prev.rgb = mix(prev.rgb, tex.rgb, tex.a);\n";
+        break;
+    case GL_BLEND:
+        if(hasColor) append(src,"    prev.rgb = mix(prev.rgb, gl_TextureEnvColor[%d].rgb, tex.rgb);\n",i);
+        src += "    prev.a *= tex.a;\n";
+        break;
+    case GL_ADD:
+        if(hasColor) src += "    prev.rgb = min(prev.rgb + tex.rgb, 1.0);\n";
+        src += "    prev.a *= tex.a;\n";
+        break;
+    case GL_COMBINE: {
+        std::string rgb[3],alpha[3];
+        for(int arg = 0; arg < 3; arg++) {
+            rgb[arg] = combineRGBArg(unit.srcRGB[arg],unit.operandRGB[arg],i);
+            alpha[arg] = combineArg(unit.srcAlpha[arg],unit.operandAlpha[arg],i);
+        }
+        src += "    {\n";
+        append(src,"        vec3 rgb = clamp((%s) * %d.0, 0.0, 1.0);\n",combineFunc(unit.combineRGB,rgb).c_str(),unit.rgbScale);
+        if(unit.combineRGB == GL_DOT3_RGBA) {
+            src += "        prev = vec4(rgb, rgb.r);\n";
+        } else {
+            append(src,"        prev = vec4(rgb, clamp((%s) * %d.0, 0.0, 1.0));\n",combineFunc(unit.combineAlpha,alpha).c_str(),unit.alphaScale);
+        }
+        src += "    }\n";
+        break;
+    }
+    default: //GL_MODULATE
+        if(hasColor) src += "    prev.rgb *= tex.rgb;\n";
+        src += "    prev.a *= tex.a;\n";
+        break;
+    }
+}
+
+static std::string fragmentShader(const FFProgramKey& key) {
+    std::string src = "#version 120\n";
+    for(int i = 0; i < MAX_TEX_UNITS; i++) {
+        if(key.units[i].format) append(src,"uniform sampler2D u_tex%d;\n",i);
+    }
+    src += "void main()\n"
+           "{\n"
+           "    vec4 primary = gl_Color;\n"
+           "    vec4 prev = primary;\n"
+           "    vec4 tex;\n";
+    for(int i = 0; i < MAX_TEX_UNITS; i++) {
+        if(key.units[i].format) texEnvStage(src,key.units[i],i);
+    }
+    switch(key.fogMode) {
+    case 0:
+        break;
+    case GL_LINEAR:
+        src += "    float fog = (gl_Fog.end - gl_FogFragCoord) * gl_Fog.scale;\n";
+        break;
+    case GL_EXP2:
+        src += "    float fog = exp(-(gl_Fog.density * gl_FogFragCoord) * (gl_Fog.density * gl_FogFragCoord));\n";
+        break;
+    default:
+        src += "    float fog = exp(-gl_Fog.density * gl_FogFragCoord);\n";
+        break;
+    }
+    if(key.fogMode) src += "    prev.rgb = mix(gl_Fog.color.rgb, prev.rgb, clamp(fog, 0.0, 1.0));\n";
+    src += "    gl_FragColor = prev;\n"
+           "}\n";
+    return src;
+}
+
+static GLuint compileShader(GLDispatch& gl,GLenum type,const std::string& src) {
+    GLuint shader = gl.glCreateShader(type);
+    const char* str = src.c_str();
+    gl.glShaderSource(shader,1,&str,NULL);
+    gl.glCompileShader(shader);
+    GLint status = 0;
+    gl.glGetShaderiv(shader,GL_COMPILE_STATUS,&status);
+    if(!status) {
+        char log[1024] = "";
+        gl.glGetShaderInfoLog(shader,sizeof(log),NULL,log);
+        fprintf(stderr,"fixed function %s shader did not compile: %s\n%s",
+                type == GL_VERTEX_SHADER ? "vertex" : "fragment",log,str);
+        gl.glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+bool FFProgramCache::supported(GLDispatch& gl) {
+    return gl.glCreateShader && gl.glShaderSource && gl.glCompileShader && gl.glGetShaderiv &&
+           gl.glGetShaderInfoLog && gl.glDeleteShader && gl.glCreateProgram && gl.glAttachShader &&
+           gl.glLinkProgram && gl.glGetProgramiv && gl.glGetProgramInfoLog && gl.glDeleteProgram && gl.glUseProgram &&
+           gl.glGetUniformLocation && gl.glUniform1i;
+}
+
+//the shaders are flagged for deletion at once, they go with the program
+GLuint FFProgramCache::buildProgram(GLDispatch& gl,const FFProgramKey& key) {
+    GLuint vs = compileShader(gl,GL_VERTEX_SHADER,vertexShader(key));
+    GLuint fs = vs ? compileShader(gl,GL_FRAGMENT_SHADER,fragmentShader(key)) : 0;
+    if(!fs) {
+        if(vs) gl.glDeleteShader(vs);
+        return 0;
+    }
+    GLuint program = gl.glCreateProgram();
+    gl.glAttachShader(program,vs);
+    gl.glAttachShader(program,fs);
+    gl.glDeleteShader(vs);
+    gl.glDeleteShader(fs);
+    gl.glLinkProgram(program);
+    GLint status = 0;
+    gl.glGetProgramiv(program,GL_LINK_STATUS,&status);
+    if(!status) {
+        char log[1024] = "";
+        gl.glGetProgramInfoLog(program,sizeof(log),NULL,log);
+        fprintf(stderr,"fixed function program did not link: %s\n",log);
+        gl.glDeleteProgram(program);
+        return 0;
+    }
+
+    //each sampler reads its own unit
+    GLint current = 0;
+    gl.glGetIntegerv(GL_CURRENT_PROGRAM,&current);
+    gl.glUseProgram(program);
+    for(int i = 0; i < MAX_TEX_UNITS; i++) {
+        if(!key.units[i].format) continue;
+        char name[16];
+        snprintf(name,sizeof(name),"u_tex%d",i);
+        gl.glUniform1i(gl.glGetUniformLocation(program,name),i);
+    }
+    gl.glUseProgram(current);
+    return program;
+}
+
+GLuint FFProgramCache::getProgram(GLDispatch& gl,const FFProgramKey& key) {
+    android::Mutex::Autolock mutex(s_lock);
+    ProgramMap::iterator it = s_programs.find(key);
+    if(it != s_programs.end()) return (*it).second;
+    GLuint program = buildProgram(gl,key);
+    s_programs[key] = program; //a failed key is not built again
+    return program;
+}
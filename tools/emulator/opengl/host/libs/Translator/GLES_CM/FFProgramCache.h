@@ -0,0 +1,56 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef FF_PROGRAM_CACHE_H
+#define FF_PROGRAM_CACHE_H
+
+#include "GLEScontext.h"
+#include <map>
+#include <utils/threads.h>
+
+#define GL_VERTEX_PROGRAM_TWO_SIDE 0x8643
+
+//
+// GLES 1.1 fixed function pipeline emulated by GLSL programs, generated for
+// the state of each draw (see GLEScontext::useFFProgram). The programs are
+// GLSL 1.20 and read the vertex attributes and the lights, materials, fog
+// and texture environment colors from the compatibility built-ins, so the
+// state calls and the client arrays still go to the driver as they are.
+// The native contexts share with the global one and the programs are
+// shared by all the contexts of the process.
+//
+class FFProgramCache
+{
+public:
+    // supported - the driver has the OpenGL 2.0 shader entry points
+    static bool supported(GLDispatch& gl);
+
+    //
+    // getProgram - the program of 'key', generated the first time the key
+    // is seen. 0 when the driver could not build it, the draws then go
+    // through the fixed function pipeline.
+    //
+    static GLuint getProgram(GLDispatch& gl,const FFProgramKey& key);
+
+private:
+    typedef std::map<FFProgramKey,GLuint> ProgramMap;
+
+    static GLuint buildProgram(GLDispatch& gl,const FFProgramKey& key);
+
+    static android::Mutex s_lock;
+    static ProgramMap     s_programs;
+};
+
+#endif
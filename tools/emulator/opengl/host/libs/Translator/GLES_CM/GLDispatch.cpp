@@ -33,6 +33,9 @@ static GL_FUNC_PTR getGLFuncAddress(const char *funcName) {
 #elif defined(WIN32)
     static osUtils::dynLibrary* libGL = osUtils::dynLibrary::open("opengl32");
     ret = (GL_FUNC_PTR)wglGetProcAddress(funcName);
+#elif defined(__APPLE__)
+    //every entry point of the framework is exported
+    static osUtils::dynLibrary* libGL = osUtils::dynLibrary::open("/System/Library/Frameworks/OpenGL.framework/OpenGL");
 #endif
     if(!ret && libGL){
         ret = libGL->findSymbol(funcName);
@@ -47,6 +50,9 @@ static GL_FUNC_PTR getGLFuncAddress(const char *funcName) {
                 else                          \
                     fprintf(stderr,"could not load func %s\n",#name); }
 
+//optional entry points are left NULL
+#define LOAD_GL_EXT_FUNC(name) { *(void**)(&name) = (void *)getGLFuncAddress(#name); }
+
 GLDispatch::GLDispatch():m_isLoaded(false){};
 
 
@@ -174,5 +180,35 @@ void GLDispatch::dispatchFuncs() {
     LOAD_GL_FUNC(glVertexPointer);
     LOAD_GL_FUNC(glViewport);
 
+    glGenerateMipmapEXT = (void (GLAPIENTRY *)(GLenum))getGLFuncAddress("glGenerateMipmapEXT");
+    LOAD_GL_EXT_FUNC(glIsRenderbufferEXT);
+    LOAD_GL_EXT_FUNC(glBindRenderbufferEXT);
+    LOAD_GL_EXT_FUNC(glDeleteRenderbuffersEXT);
+    LOAD_GL_EXT_FUNC(glRenderbufferStorageEXT);
+    LOAD_GL_EXT_FUNC(glGetRenderbufferParameterivEXT);
+    LOAD_GL_EXT_FUNC(glIsFramebufferEXT);
+    LOAD_GL_EXT_FUNC(glBindFramebufferEXT);
+    LOAD_GL_EXT_FUNC(glDeleteFramebuffersEXT);
+    LOAD_GL_EXT_FUNC(glCheckFramebufferStatusEXT);
+    LOAD_GL_EXT_FUNC(glFramebufferTexture2DEXT);
+    LOAD_GL_EXT_FUNC(glFramebufferRenderbufferEXT);
+    LOAD_GL_EXT_FUNC(glGetFramebufferAttachmentParameterivEXT);
+
+    LOAD_GL_EXT_FUNC(glCreateShader);
+    LOAD_GL_EXT_FUNC(glShaderSource);
+    LOAD_GL_EXT_FUNC(glCompileShader);
+    LOAD_GL_EXT_FUNC(glGetShaderiv);
+    LOAD_GL_EXT_FUNC(glGetShaderInfoLog);
+    LOAD_GL_EXT_FUNC(glDeleteShader);
+    LOAD_GL_EXT_FUNC(glCreateProgram);
+    LOAD_GL_EXT_FUNC(glAttachShader);
+    LOAD_GL_EXT_FUNC(glLinkProgram);
+    LOAD_GL_EXT_FUNC(glGetProgramiv);
+    LOAD_GL_EXT_FUNC(glGetProgramInfoLog);
+    LOAD_GL_EXT_FUNC(glDeleteProgram);
+    LOAD_GL_EXT_FUNC(glUseProgram);
+    LOAD_GL_EXT_FUNC(glGetUniformLocation);
+    LOAD_GL_EXT_FUNC(glUniform1i);
+
     m_isLoaded = true;
 }
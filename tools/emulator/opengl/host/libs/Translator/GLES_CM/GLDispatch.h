@@ -150,6 +150,38 @@ public:
     void (GLAPIENTRY *glTranslatef) (GLfloat x, GLfloat y, GLfloat z);
     void (GLAPIENTRY *glVertexPointer) (GLint size, GLenum type, GLsizei stride, const GLvoid *pointer);
     void (GLAPIENTRY *glViewport) (GLint x, GLint y, GLsizei width, GLsizei height);
+
+    //extensions, NULL when the driver does not have them
+    void (GLAPIENTRY *glGenerateMipmapEXT) (GLenum target);
+    GLboolean (GLAPIENTRY *glIsRenderbufferEXT) (GLuint renderbuffer);
+    void (GLAPIENTRY *glBindRenderbufferEXT) (GLenum target, GLuint renderbuffer);
+    void (GLAPIENTRY *glDeleteRenderbuffersEXT) (GLsizei n, const GLuint *renderbuffers);
+    void (GLAPIENTRY *glRenderbufferStorageEXT) (GLenum target, GLenum internalformat, GLsizei width, GLsizei height);
+    void (GLAPIENTRY *glGetRenderbufferParameterivEXT) (GLenum target, GLenum pname, GLint *params);
+    GLboolean (GLAPIENTRY *glIsFramebufferEXT) (GLuint framebuffer);
+    void (GLAPIENTRY *glBindFramebufferEXT) (GLenum target, GLuint framebuffer);
+    void (GLAPIENTRY *glDeleteFramebuffersEXT) (GLsizei n, const GLuint *framebuffers);
+    GLenum (GLAPIENTRY *glCheckFramebufferStatusEXT) (GLenum target);
+    void (GLAPIENTRY *glFramebufferTexture2DEXT) (GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+    void (GLAPIENTRY *glFramebufferRenderbufferEXT) (GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer);
+    void (GLAPIENTRY *glGetFramebufferAttachmentParameterivEXT) (GLenum target, GLenum attachment, GLenum pname, GLint *params);
+
+    //OpenGL 2.0 shaders, see FFProgramCache
+    GLuint (GLAPIENTRY *glCreateShader) (GLenum type);
+    void (GLAPIENTRY *glShaderSource) (GLuint shader, GLsizei count, const char **string, const GLint *length);
+    void (GLAPIENTRY *glCompileShader) (GLuint shader);
+    void (GLAPIENTRY *glGetShaderiv) (GLuint shader, GLenum pname, GLint *params);
+    void (GLAPIENTRY *glGetShaderInfoLog) (GLuint shader, GLsizei bufSize, GLsizei *length, char *infoLog);
+    void (GLAPIENTRY *glDeleteShader) (GLuint shader);
+    GLuint (GLAPIENTRY *glCreateProgram) (void);
+    void (GLAPIENTRY *glAttachShader) (GLuint program, GLuint shader);
+    void (GLAPIENTRY *glLinkProgram) (GLuint program);
+    void (GLAPIENTRY *glGetProgramiv) (GLuint program, GLenum pname, GLint *params);
+    void (GLAPIENTRY *glGetProgramInfoLog) (GLuint program, GLsizei bufSize, GLsizei *length, char *infoLog);
+    void (GLAPIENTRY *glDeleteProgram) (GLuint program);
+    void (GLAPIENTRY *glUseProgram) (GLuint program);
+    GLint (GLAPIENTRY *glGetUniformLocation) (GLuint program, const char *name);
+    void (GLAPIENTRY *glUniform1i) (GLint location, GLint v0);
 private:
     bool             m_isLoaded;
     android::Mutex   m_lock;
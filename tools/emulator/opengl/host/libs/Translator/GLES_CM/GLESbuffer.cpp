@@ -16,21 +16,24 @@
 #include "GLESbuffer.h"
 #include <string.h>
 
+//the data is the only store of the buffer, the driver is given pointers
+//into it. it is kept when the size does not change, the buffers apps
+//respecify every frame keep their size, and the pointers set on them
+//stay valid.
 bool  GLESbuffer::setBuffer(GLuint size,GLuint usage,const GLvoid* data) {
-    m_size = size;
-    m_usage = usage;
-    if(m_data) {
+    if(!m_data || size != m_size) {
         delete [] m_data;
-        m_data = NULL;
+        m_data = new unsigned char[size ? size : 1];
     }
-    m_data = new unsigned char[size];
-    if(m_data) {
+    m_size = size;
+    m_usage = usage;
+    //no data leaves the content undefined
+    if(data) {
         memcpy(m_data,data,size);
-        m_conversionManager.clear();
-        m_conversionManager.addRange(Range(0,m_size));
-        return true;
     }
-    return false;
+    m_conversionManager.clear();
+    m_conversionManager.addRange(Range(0,m_size));
+    return true;
 }
 
 bool  GLESbuffer::setSubBuffer(GLint offset,GLuint size,const GLvoid* data) {
@@ -16,13 +16,17 @@
 #include "GLEScontext.h"
 #include "GLESutils.h"
 #include "GLfixed_ops.h"
+#include "GLfixed_convert.h"
 #include "RangeManip.h"
+#include "FFProgramCache.h"
 #include <GLcommon/GLutils.h>
+#include <GLcommon/TranslatorIfaces.h>
 #include <string.h>
+#include <stdlib.h>
+#include <algorithm>
 #include <GLES/gl.h>
 
 //declerations
-static void convertDirectLoop(const char* dataIn,unsigned int strideIn,void* dataOut,unsigned int nBytes,unsigned int strideOut,int attribSize);
 static void convertIndirectLoop(const char* dataIn,unsigned int strideIn,void* dataOut,GLsizei count,GLenum indices_type,const GLvoid* indices,unsigned int strideOut,int attribSize);
 static int findMaxIndex(GLsizei count,GLenum type,const GLvoid* indices);
 
@@ -30,22 +34,37 @@ static int findMaxIndex(GLsizei count,GLenum type,const GLvoid* indices);
 GLDispatch     GLEScontext::s_glDispatch;
 GLsupport      GLEScontext::s_glSupport;
 android::Mutex GLEScontext::s_lock;
-
-GLESFloatArrays::~GLESFloatArrays() {
-    for(std::map<GLenum,GLfloat*>::iterator it = arrays.begin(); it != arrays.end();it++) {
-        GLfloat* p = (*it).second;
-        if(p) {
-            delete[] p;
-        }
+FixedConvertPool* GLEScontext::s_convertPool = NULL;
+
+static const GLenum s_arrayIds[GLES_ARRAY_SLOTS] = {GL_VERTEX_ARRAY,GL_NORMAL_ARRAY,GL_COLOR_ARRAY,GL_POINT_SIZE_ARRAY_OES,GL_TEXTURE_COORD_ARRAY};
+
+//slot of a client array, the arrays pointers names are accepted too
+static inline int arraySlot(GLenum arr) {
+    switch(arr) {
+    case GL_VERTEX_ARRAY:
+    case GL_VERTEX_ARRAY_POINTER:
+        return GLES_VERTEX_SLOT;
+    case GL_NORMAL_ARRAY:
+    case GL_NORMAL_ARRAY_POINTER:
+        return GLES_NORMAL_SLOT;
+    case GL_COLOR_ARRAY:
+    case GL_COLOR_ARRAY_POINTER:
+        return GLES_COLOR_SLOT;
+    case GL_POINT_SIZE_ARRAY_OES:
+    case GL_POINT_SIZE_ARRAY_POINTER_OES:
+        return GLES_POINT_SIZE_SLOT;
+    case GL_TEXTURE_COORD_ARRAY:
+    case GL_TEXTURE_COORD_ARRAY_POINTER:
+        return GLES_TEXCOORD_SLOT;
     }
+    return -1;
 }
 
 GLEScontext::~GLEScontext() {
-    for(ArraysMap::iterator it = m_map.begin(); it != m_map.end();it++) {
-        GLESpointer* p = (*it).second;
-        if(p) {
-            delete[] p;
-        }
+    delete[] m_texCoords;
+    for(int i = 0; i < GLES_CONVERTED_SLOTS; i++) {
+        delete[] m_convertedArrays[i].fixedData;
+        delete[] m_convertedArrays[i].floatData;
     }
 }
 
@@ -59,20 +78,33 @@ void GLEScontext::init() {
         s_glDispatch.glGetIntegerv(GL_MAX_TEXTURE_SIZE,&s_glSupport.maxTexSize);
         s_glDispatch.glGetIntegerv(GL_MAX_TEXTURE_UNITS,&maxTexUnits);
         s_glSupport.maxTexUnits = maxTexUnits < MAX_TEX_UNITS ? maxTexUnits:MAX_TEX_UNITS;
+        const char* extensions = reinterpret_cast<const char*>(s_glDispatch.glGetString(GL_EXTENSIONS));
+        s_glSupport.GL_OES_compressed_ETC1_RGB8_texture = extensions && strstr(extensions,"GL_OES_compressed_ETC1_RGB8_texture");
+        //for drivers known to upload the packed types quickly
+        s_glSupport.nativePackedTexels = getenv("ANDROID_GL_NATIVE_PACKED_TEXELS") != NULL;
+        s_glSupport.batchDraws = getenv("ANDROID_GLES_BATCH_DRAWS") != NULL;
+        //threads converting the large GL_FIXED arrays, the render thread included
+        const char* convertThreads = getenv("ANDROID_GLES_CONVERT_THREADS");
+        if(convertThreads && !s_convertPool) s_convertPool = FixedConvertPool::create(atoi(convertThreads));
+        s_glSupport.GL_EXT_framebuffer_object = extensions && strstr(extensions,"GL_EXT_framebuffer_object") &&
+                                                s_glDispatch.glGenerateMipmapEXT;
+        s_glSupport.shaderFF = getenv("ANDROID_GLES_SHADER_FF") != NULL && FFProgramCache::supported(s_glDispatch);
     }
 
     m_texCoords = new GLESpointer[s_glSupport.maxTexUnits];
-    m_map[GL_TEXTURE_COORD_ARRAY]  = &m_texCoords[m_activeTexture];
+    m_arrays[GLES_TEXCOORD_SLOT] = &m_texCoords[m_activeTexture];
     m_initialized = true;
 }
 
-GLEScontext::GLEScontext():m_glError(GL_NO_ERROR),m_activeTexture(0),m_arrayBuffer(0),m_elementBuffer(0),m_pointsIndex(-1),m_initialized(false) {
+GLEScontext::GLEScontext():m_glError(GL_NO_ERROR),m_activeTexture(0),m_activeServerTexture(0),m_arrayBuffer(0),m_elementBuffer(0),m_pointsIndex(-1),m_initialized(false),m_unpackAlignment(4),m_mipmapsPending(false),
+                             m_ffState(),m_ffStateDirty(true),m_ffPointAttenuation(false),m_ffKey(),m_ffKeyValid(false),m_ffTwoSide(false) {
 
-
-    m_map[GL_COLOR_ARRAY]          = new GLESpointer();
-    m_map[GL_NORMAL_ARRAY]         = new GLESpointer();
-    m_map[GL_VERTEX_ARRAY]         = new GLESpointer();
-    m_map[GL_POINT_SIZE_ARRAY_OES] = new GLESpointer();
+    m_texCoords = NULL;
+    m_enabledArrays = 0;
+    for(int i = 0; i < GLES_TEXCOORD_SLOT; i++) {
+        m_arrays[i] = &m_pointers[i];
+    }
+    m_arrays[GLES_TEXCOORD_SLOT] = NULL; //allocated by init()
 }
 
 GLDispatch& GLEScontext::dispatcher() {
@@ -89,33 +121,109 @@ void GLEScontext::setGLerror(GLenum err) {
 
 void GLEScontext::setActiveTexture(GLenum tex) {
    m_activeTexture = tex - GL_TEXTURE0;
-   m_map[GL_TEXTURE_COORD_ARRAY] = &m_texCoords[m_activeTexture];
+   m_arrays[GLES_TEXCOORD_SLOT] = &m_texCoords[m_activeTexture];
+}
+
+static bool updateShadow(StateShadowMap& shadow,const StateKey& key,GLuint value) {
+    StateShadowMap::iterator it = shadow.find(key);
+    if(it != shadow.end() && (*it).second.i == value) return false;
+    shadow[key].i = value;
+    return true;
+}
+
+static bool updateShadow(StateShadowMap& shadow,const StateKey& key,const GLfloat* values,int count) {
+    StateShadowMap::iterator it = shadow.find(key);
+    if(it != shadow.end()) {
+        bool same = true;
+        for(int i = 0; i < count; i++) {
+            if((*it).second.f[i] != values[i]) same = false;
+        }
+        if(same) return false;
+    }
+    GLESStateValue& v = shadow[key];
+    for(int i = 0; i < count; i++) {
+        v.f[i] = values[i];
+    }
+    return true;
+}
+
+//a change of the shadow may change the fixed function program key as well
+bool GLEScontext::updateState(GLenum pname,GLuint value) {
+    if(!updateShadow(m_stateShadow,StateKey(pname,0),value)) return false;
+    m_ffStateDirty = true;
+    return true;
+}
+
+bool GLEScontext::updateState(GLenum pname,const GLfloat* values,int count) {
+    if(!updateShadow(m_stateShadow,StateKey(pname,0),values,count)) return false;
+    m_ffStateDirty = true;
+    return true;
+}
+
+bool GLEScontext::updateTexState(GLenum pname,GLuint value) {
+    if(!updateShadow(m_stateShadow,StateKey(pname,m_activeServerTexture),value)) return false;
+    m_ffStateDirty = true;
+    return true;
+}
+
+bool GLEScontext::updateTexState(GLenum pname,const GLfloat* values,int count) {
+    if(!updateShadow(m_stateShadow,StateKey(pname,m_activeServerTexture),values,count)) return false;
+    m_ffStateDirty = true;
+    return true;
+}
+
+//the active server texture unit is always known, GL_TEXTURE0 at start
+bool GLEScontext::setActiveServerTexture(GLenum tex) {
+    unsigned int unit = tex - GL_TEXTURE0;
+    if(unit == m_activeServerTexture) return false;
+    m_activeServerTexture = unit;
+    return true;
+}
+
+//the driver unbinds a deleted texture from the units of this context
+void GLEScontext::textureDeleted(GLuint globalName) {
+    for(int i = 0; i < s_glSupport.maxTexUnits; i++) {
+        StateShadowMap::iterator it = m_stateShadow.find(StateKey(GL_TEXTURE_BINDING_2D,i));
+        if(it != m_stateShadow.end() && (*it).second.i == globalName) {
+            m_stateShadow.erase(it);
+        }
+    }
 }
 
 const GLvoid* GLEScontext::setPointer(GLenum arrType,GLint size,GLenum type,GLsizei stride,const GLvoid* data) {
     GLuint bufferName = m_arrayBuffer;
     if(bufferName) {
         unsigned int offset = reinterpret_cast<unsigned int>(data);
-        GLESbuffer* vbo = static_cast<GLESbuffer*>(m_shareGroup->getObjectData(VERTEXBUFFER,bufferName).Ptr());
-        m_map[arrType]->setBuffer(size,type,stride,vbo,offset);
+        GLESbuffer* vbo = static_cast<GLESbuffer*>(m_shareGroup->getObjectDataPtr(VERTEXBUFFER,bufferName));
+        m_arrays[arraySlot(arrType)]->setBuffer(size,type,stride,vbo,offset);
         return  static_cast<const unsigned char*>(vbo->getData()) +  offset;
     }
-    m_map[arrType]->setArray(size,type,stride,data);
+    m_arrays[arraySlot(arrType)]->setArray(size,type,stride,data);
     return data;
 }
 
 
 void GLEScontext::enableArr(GLenum arr,bool enable) {
-    m_map[arr]->enable(enable);
+    int slot = arraySlot(arr);
+    if(slot < 0) return;
+    m_arrays[slot]->enable(enable);
+
+    unsigned int bit = 1 << (slot == GLES_TEXCOORD_SLOT ? slot + m_activeTexture : slot);
+    if(enable) {
+        m_enabledArrays |= bit;
+    } else {
+        m_enabledArrays &= ~bit;
+    }
 }
 
 bool GLEScontext::isArrEnabled(GLenum arr) {
-    return m_map[arr]->isEnable();
+    int slot = arraySlot(arr);
+    return slot >= 0 && m_arrays[slot]->isEnable();
 }
 
 const GLESpointer* GLEScontext::getPointer(GLenum arrType) {
-    if(m_map.find(arrType) != m_map.end()) return m_map[arrType];
-    return NULL;
+    int slot = arraySlot(arrType);
+    return slot >= 0 ? m_arrays[slot] : NULL;
 }
 
 //sending data to server side
@@ -139,29 +247,8 @@ void GLEScontext::sendArr(GLvoid* arr,GLenum arrayType,GLint size,GLsizei stride
     }
 }
 
-static void convertDirectLoop(const char* dataIn,unsigned int strideIn,void* dataOut,unsigned int nBytes,unsigned int strideOut,int attribSize) {
-
-    for(unsigned int i = 0; i < nBytes;i+=strideOut) {
-        const GLfixed* fixed_data = (const GLfixed *)dataIn;
-        //filling attrib
-        for(int j=0;j<attribSize;j++) {
-            reinterpret_cast<GLfloat*>(&static_cast<unsigned char*>(dataOut)[i])[j] = X2F(fixed_data[j]);
-        }
-        dataIn += strideIn;
-    }
-}
-
 static void convertIndirectLoop(const char* dataIn,unsigned int strideIn,void* dataOut,GLsizei count,GLenum indices_type,const GLvoid* indices,unsigned int strideOut,int attribSize) {
-    for(int i = 0 ;i < count ;i++) {
-        unsigned short index = indices_type == GL_UNSIGNED_BYTE? ((GLubyte *)indices)[i]:
-                                                             ((GLushort *)indices)[i];
-        const GLfixed* fixed_data = (GLfixed *)(dataIn  + index*strideIn);
-        GLfloat* float_data = reinterpret_cast<GLfloat*>(static_cast<unsigned char*>(dataOut) + index*strideOut);
-
-        for(int j=0;j<attribSize;j++) {
-            float_data[j] = X2F(fixed_data[j]);
-         }
-    }
+    fixedToFloatIndexed(dataIn,strideIn,static_cast<char*>(dataOut),strideOut,count,indices_type,indices,attribSize);
 }
 
 static void directToBytesRanges(GLint first,GLsizei count,GLESpointer* p,RangeList& list) {
@@ -199,9 +286,10 @@ int bytesRangesToIndices(RangeList& ranges,GLESpointer* p,GLushort* indices) {
     int offset = p->getBufferOffset();
 
     int n = 0;
-    for(int i=0;i<ranges.size();i++) {
-        int startIndex = (ranges[i].getStart() - offset) / stride;
-        int nElements = ranges[i].getSize()/attribSize;
+    for(RangeList::const_iterator it = ranges.begin(); it != ranges.end(); it++) {
+        Range r = RangeList::rangeAt(it);
+        int startIndex = (r.getStart() - offset) / stride;
+        int nElements = r.getSize()/attribSize;
         for(int j=0;j<nElements;j++) {
             indices[n++] = startIndex+j;
         }
@@ -209,16 +297,59 @@ int bytesRangesToIndices(RangeList& ranges,GLESpointer* p,GLushort* indices) {
     return n;
 }
 
+//
+// convertClientArray - returns 'elements' elements of the client array at
+// 'src' converted to tightly packed floats. The conversion of each array is
+// kept, and reused as long as the same array is drawn with unchanged content.
+//
+GLfloat* GLEScontext::convertClientArray(GLenum array_id,const char* src,int stride,int attribSize,unsigned int elements) {
+    //texture coords arrays of the different units are kept apart
+    int slot = arraySlot(array_id);
+    GLESConvertedArray& conv = m_convertedArrays[slot == GLES_TEXCOORD_SLOT ? slot + m_activeTexture : slot];
+
+    unsigned int fixedSize = elements ? (elements-1)*stride + attribSize*sizeof(GLfixed) : 0;
+    unsigned int floatSize = elements*attribSize;
+
+    if(conv.src == src && conv.stride == stride && conv.attribSize == attribSize &&
+       conv.elements == elements && conv.floatData &&
+       memcmp(conv.fixedData,src,fixedSize) == 0) {
+        return conv.floatData;
+    }
+
+    //buffers are only reallocated when growing
+    if(conv.fixedSize < fixedSize || !conv.fixedData) {
+        delete[] conv.fixedData;
+        conv.fixedData = new char[fixedSize ? fixedSize : 1];
+        conv.fixedSize = fixedSize;
+    }
+    if(conv.floatSize < floatSize || !conv.floatData) {
+        delete[] conv.floatData;
+        conv.floatData = new GLfloat[floatSize ? floatSize : 1];
+        conv.floatSize = floatSize;
+    }
+
+    char* floatData = reinterpret_cast<char*>(conv.floatData);
+    if(!s_convertPool || floatSize < GLES_PARALLEL_CONVERT_MIN ||
+       !s_convertPool->convert(src,stride,conv.fixedData,fixedSize,floatData,attribSize*sizeof(GLfloat),elements,attribSize)) {
+        memcpy(conv.fixedData,src,fixedSize);
+        fixedToFloatStrided(src,stride,floatData,attribSize*sizeof(GLfloat),elements,attribSize);
+    }
+    conv.src        = src;
+    conv.stride     = stride;
+    conv.attribSize = attribSize;
+    conv.elements   = elements;
+    return conv.floatData;
+}
+
 void GLEScontext::convertDirect(GLESFloatArrays& fArrs,GLint first,GLsizei count,GLenum array_id,GLESpointer* p,unsigned int& index) {
     GLenum type    = p->getType();
     if(isArrEnabled(array_id) && type == GL_FIXED) {
         int attribSize = p->getSize();
-        unsigned int size = attribSize*count + first;
-        fArrs.arrays[index] = new GLfloat[size];
         int stride = p->getStride()?p->getStride():sizeof(GLfixed)*attribSize;
-        const char* data = (const char*)p->getArrayData() + (first*stride);
+        const char* data = (const char*)p->getArrayData();
 
-        convertDirectLoop(data,stride,fArrs.arrays[index],size*sizeof(GLfloat),attribSize*sizeof(GLfloat),attribSize);
+        //the draw reads elements [first,first+count) so the converted array starts at element 0
+        fArrs.arrays[index] = convertClientArray(array_id,data,stride,attribSize,first+count);
         sendArr(fArrs.arrays[index],array_id,attribSize,0,index);
         index++;
     }
@@ -232,7 +363,6 @@ void GLEScontext::convertDirectVBO(GLint first,GLsizei count,GLenum array_id,GLE
         GLushort* indices = NULL;
         int attribSize = p->getSize();
         int stride = p->getStride()?p->getStride():sizeof(GLfixed)*attribSize;
-        unsigned int size = p->getStride()?p->getStride()*count:attribSize*count*sizeof(GLfixed);
         char* data = (char*)p->getBufferData() + (first*stride);
 
         if(p->bufferNeedConversion()) {
@@ -253,16 +383,15 @@ void GLEScontext::convertDirectVBO(GLint first,GLsizei count,GLenum array_id,GLE
 
 void GLEScontext::convertIndirect(GLESFloatArrays& fArrs,GLsizei count,GLenum indices_type,const GLvoid* indices,GLenum array_id,GLESpointer* p,unsigned int& index_out) {
     GLenum type    = p->getType();
-    int maxElements = findMaxIndex(count,type,indices) + 1;
+    int maxElements = findMaxIndex(count,indices_type,indices) + 1;
 
     if(isArrEnabled(array_id) && type == GL_FIXED) {
         int attribSize = p->getSize();
-        int size = attribSize * maxElements;
-        fArrs.arrays[index_out] = new GLfloat[size];
         int stride = p->getStride()?p->getStride():sizeof(GLfixed)*attribSize;
 
+        //converting all the elements up to the largest index, so the conversion can be reused with other indices
         const char* data = (const char*)p->getArrayData();
-        convertIndirectLoop(data,stride,fArrs.arrays[index_out],count,indices_type,indices,attribSize*sizeof(GLfloat),attribSize);
+        fArrs.arrays[index_out] = convertClientArray(array_id,data,stride,attribSize,maxElements);
         sendArr(fArrs.arrays[index_out],array_id,attribSize,0,index_out);
         index_out++;
     }
@@ -311,39 +440,458 @@ void GLEScontext::chooseConvertMethod(GLESFloatArrays& fArrs,GLint first,GLsizei
 }
 
 void GLEScontext::convertArrs(GLESFloatArrays& fArrs,GLint first,GLsizei count,GLenum type,const GLvoid* indices,bool direct) {
-    ArraysMap::iterator it;
     unsigned int index = 0;
     m_pointsIndex = -1;
 
-    //going over all clients arrays Pointers
-    for ( it=m_map.begin() ; it != m_map.end(); it++ ) {
-        GLenum array_id   = (*it).first;
-        GLESpointer* p = (*it).second;
-
-        if(array_id == GL_TEXTURE_COORD_ARRAY) continue; //handling textures later
-        chooseConvertMethod(fArrs,first,count,type,indices,direct,p,array_id,index);
+    //going over the enabled clients arrays, texture coords are handled later
+    for(int slot = 0; slot < GLES_TEXCOORD_SLOT; slot++) {
+        if(!(m_enabledArrays & (1 << slot))) continue;
+        chooseConvertMethod(fArrs,first,count,type,indices,direct,m_arrays[slot],s_arrayIds[slot],index);
     }
 
-    unsigned int activeTexture = m_activeTexture + GL_TEXTURE0;
-
     s_lock.lock();
     int maxTexUnits = s_glSupport.maxTexUnits;
     s_lock.unlock();
 
-    //converting all texture coords arrays
+    //converting the enabled GL_FIXED texture coords arrays, the client unit is only switched for them
+    unsigned int activeTexture = m_activeTexture + GL_TEXTURE0;
+    bool switched = false;
     for(int i=0; i< maxTexUnits;i++) {
+        if(!(m_enabledArrays & (1 << (GLES_TEXCOORD_SLOT + i))) || m_texCoords[i].getType() != GL_FIXED) continue;
 
         unsigned int tex = GL_TEXTURE0+i;
-        setActiveTexture(tex);
-        s_glDispatch.glClientActiveTexture(tex);
+        if(tex != activeTexture || switched) {
+            setActiveTexture(tex);
+            s_glDispatch.glClientActiveTexture(tex);
+            switched = true;
+        }
+        chooseConvertMethod(fArrs,first,count,type,indices,direct,&m_texCoords[i],GL_TEXTURE_COORD_ARRAY,index);
+    }
+
+    if(switched) {
+        setActiveTexture(activeTexture);
+        s_glDispatch.glClientActiveTexture(activeTexture);
+    }
+}
+
+
+//element 'i' of a client array as floats, the types accepted by batchDrawArrays
+static void readElement(const GLESpointer* p,int i,GLfloat* out) {
+    GLint size = p->getSize();
+    const char* src = static_cast<const char*>(p->getArrayData());
+    switch(p->getType()) {
+    case GL_FLOAT: {
+        const GLfloat* f = reinterpret_cast<const GLfloat*>(src + i*(p->getStride() ? p->getStride() : size*sizeof(GLfloat)));
+        for(int c = 0; c < size; c++) out[c] = f[c];
+        break;
+    }
+    case GL_FIXED: {
+        const GLfixed* x = reinterpret_cast<const GLfixed*>(src + i*(p->getStride() ? p->getStride() : size*sizeof(GLfixed)));
+        for(int c = 0; c < size; c++) out[c] = X2F(x[c]);
+        break;
+    }
+    case GL_UNSIGNED_BYTE: {
+        const GLubyte* b = reinterpret_cast<const GLubyte*>(src + i*(p->getStride() ? p->getStride() : size));
+        for(int c = 0; c < size; c++) out[c] = b[c] / 255.0f;
+        break;
+    }
+    }
+}
+
+static bool batchableType(int slot,GLenum type) {
+    return type == GL_FLOAT || type == GL_FIXED || (slot == GLES_COLOR_SLOT && type == GL_UNSIGNED_BYTE);
+}
+
+bool GLEScontext::batchDrawArrays(GLenum mode,GLint first,GLsizei count) {
+    if(m_texBatch.quads) drawTexBatch();
+    if(!s_glSupport.batchDraws) return false;
+
+    bool batchable = (mode == GL_TRIANGLES || mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN) &&
+                     count >= 3 && count <= GLES_BATCH_MAX_DRAW;
+    for(int slot = 0; batchable && slot < GLES_CONVERTED_SLOTS; slot++) {
+        if(!(m_enabledArrays & (1 << slot)) || slot == GLES_POINT_SIZE_SLOT) continue;
+        const GLESpointer* p = slotPointer(slot);
+        batchable = !p->hasBuffer() && p->getArrayData() && batchableType(slot,p->getType());
+    }
+    if(!batchable) {
+        flushDraws();
+        return false;
+    }
+
+    bool compatible = m_batch.enabled == m_enabledArrays &&
+                      m_batch.vertices + count <= GLES_BATCH_MAX_VERTICES;
+    for(int slot = 0; compatible && slot < GLES_CONVERTED_SLOTS; slot++) {
+        if(m_enabledArrays & (1 << slot)) compatible = m_batch.sizes[slot] == slotPointer(slot)->getSize();
+    }
+    if(!compatible) {
+        flushDraws();
+        m_batch.enabled = m_enabledArrays;
+        for(int slot = 0; slot < GLES_CONVERTED_SLOTS; slot++) {
+            m_batch.sizes[slot] = (m_enabledArrays & (1 << slot)) ? slotPointer(slot)->getSize() : 0;
+        }
+    }
+
+    for(int slot = 0; slot < GLES_CONVERTED_SLOTS; slot++) {
+        if(!(m_enabledArrays & (1 << slot)) || slot == GLES_POINT_SIZE_SLOT) continue;
+        const GLESpointer* p = slotPointer(slot);
+        std::vector<GLfloat>& data = m_batch.data[slot];
+        unsigned int pos = data.size();
+        data.resize(pos + count*p->getSize());
+        for(int i = 0; i < count; i++) {
+            readElement(p,first + i,&data[pos + i*p->getSize()]);
+        }
+    }
 
-        GLenum array_id   = GL_TEXTURE_COORD_ARRAY;
-        GLESpointer* p = m_map[array_id];
-        chooseConvertMethod(fArrs,first,count,type,indices,direct,p,array_id,index);
+    //everything becomes a list of triangles, strips keep their winding
+    GLushort base = m_batch.vertices;
+    for(int i = 0; i + 2 < count; i++) {
+        if(mode == GL_TRIANGLES) {
+            if(i % 3) continue;
+            m_batch.indices.push_back(base + i);
+            m_batch.indices.push_back(base + i + 1);
+        } else if(mode == GL_TRIANGLE_STRIP) {
+            m_batch.indices.push_back(base + i + (i & 1));
+            m_batch.indices.push_back(base + i + 1 - (i & 1));
+        } else {
+            m_batch.indices.push_back(base);
+            m_batch.indices.push_back(base + i + 1);
+        }
+        m_batch.indices.push_back(base + i + 2);
+    }
+    m_batch.vertices += count;
+    return true;
+}
+
+void GLEScontext::sendSlotPointer(int slot,GLint size,GLenum type,GLsizei stride,const GLvoid* data) {
+    switch(slot) {
+    case GLES_VERTEX_SLOT:
+        s_glDispatch.glVertexPointer(size,type,stride,data);
+        break;
+    case GLES_NORMAL_SLOT:
+        s_glDispatch.glNormalPointer(type,stride,data);
+        break;
+    case GLES_COLOR_SLOT:
+        s_glDispatch.glColorPointer(size,type,stride,data);
+        break;
+    default:
+        s_glDispatch.glTexCoordPointer(size,type,stride,data);
+        break;
+    }
+}
+
+void GLEScontext::drawBatch() {
+    //the batch goes through the driver's arrays, the client's pointers are
+    //given back afterwards. GL_FIXED arrays are sent again by every draw.
+    unsigned int activeTexture = m_activeTexture;
+    for(int pass = 0; pass < 2; pass++) {
+        for(int slot = 0; slot < GLES_CONVERTED_SLOTS; slot++) {
+            if(!(m_batch.enabled & (1 << slot)) || slot == GLES_POINT_SIZE_SLOT) continue;
+            const GLESpointer* p = slotPointer(slot);
+            if(pass == 1 && p->getType() == GL_FIXED) continue;
+            if(slot >= GLES_TEXCOORD_SLOT && (unsigned int)(slot - GLES_TEXCOORD_SLOT) != activeTexture) {
+                activeTexture = slot - GLES_TEXCOORD_SLOT;
+                s_glDispatch.glClientActiveTexture(GL_TEXTURE0 + activeTexture);
+            }
+            if(pass == 0) {
+                sendSlotPointer(slot,m_batch.sizes[slot],GL_FLOAT,0,&m_batch.data[slot][0]);
+            } else {
+                sendSlotPointer(slot,p->getSize(),p->getType(),p->getStride(),
+                                p->hasBuffer() ? p->getBufferData() : p->getArrayData());
+            }
+        }
+        if(pass == 0) {
+            useFFProgram(GL_TRIANGLES,false);
+            s_glDispatch.glDrawElements(GL_TRIANGLES,m_batch.indices.size(),GL_UNSIGNED_SHORT,&m_batch.indices[0]);
+        }
+    }
+    if(activeTexture != m_activeTexture) {
+        s_glDispatch.glClientActiveTexture(GL_TEXTURE0 + m_activeTexture);
+    }
+
+    for(int slot = 0; slot < GLES_CONVERTED_SLOTS; slot++) {
+        m_batch.data[slot].clear();
+    }
+    m_batch.indices.clear();
+    m_batch.vertices = 0;
+}
+
+//state never set is asked to the driver
+bool GLEScontext::isStateEnabled(GLenum cap) {
+    StateShadowMap::iterator it = m_stateShadow.find(StateKey(cap,0));
+    if(it != m_stateShadow.end()) return (*it).second.i != 0;
+    return s_glDispatch.glIsEnabled(cap);
+}
+
+//GL_TEXTURE_2D is never invalidated, a unit it was never set on is disabled
+bool GLEScontext::isTexUnitEnabled(unsigned int unit) {
+    StateShadowMap::iterator it = m_stateShadow.find(StateKey(GL_TEXTURE_2D,unit));
+    return it != m_stateShadow.end() && (*it).second.i != 0;
+}
+
+//values kept by the shadow, GL defaults for the state never set
+static GLuint shadowInt(const StateShadowMap& shadow,GLenum pname,unsigned int unit,GLuint def) {
+    StateShadowMap::const_iterator it = shadow.find(StateKey(pname,unit));
+    return it != shadow.end() ? (*it).second.i : def;
+}
+
+static GLushort shadowEnum(const StateShadowMap& shadow,GLenum pname,unsigned int unit,GLenum def) {
+    StateShadowMap::const_iterator it = shadow.find(StateKey(pname,unit));
+    return static_cast<GLushort>(it != shadow.end() ? (*it).second.f[0] : def);
+}
+
+//
+// buildFFState - the key of the state tracked by the shadow. The state set
+// through the driver alone (the lights, materials, fog parameters and
+// matrices) is read by the programs from the driver.
+//
+void GLEScontext::buildFFState() {
+    FFProgramKey& key = m_ffState;
+    key.reset();
+    if(shadowInt(m_stateShadow,GL_LIGHTING,0,0)) {
+        key.flags |= FF_KEY_LIGHTING;
+        if(shadowInt(m_stateShadow,GL_LIGHT_MODEL_TWO_SIDE,0,0)) key.flags |= FF_KEY_TWO_SIDE;
+        if(shadowInt(m_stateShadow,GL_COLOR_MATERIAL,0,0)) key.flags |= FF_KEY_COLOR_MATERIAL;
+        if(shadowInt(m_stateShadow,GL_NORMALIZE,0,0)) key.flags |= FF_KEY_NORMALIZE;
+        if(shadowInt(m_stateShadow,GL_RESCALE_NORMAL,0,0)) key.flags |= FF_KEY_RESCALE_NORMAL;
+        for(int i = 0; i < s_glSupport.maxLights && i < 8; i++) {
+            if(shadowInt(m_stateShadow,GL_LIGHT0 + i,0,0)) key.lights |= 1 << i;
+        }
+    }
+    if(shadowInt(m_stateShadow,GL_FOG,0,0)) {
+        key.fogMode = shadowInt(m_stateShadow,GL_FOG_MODE,0,GL_EXP);
+    }
+    for(int i = 0; i < s_glSupport.maxTexUnits && i < MAX_TEX_UNITS; i++) {
+        if(!isTexUnitEnabled(i)) continue;
+        FFTexUnitKey& unit = key.units[i];
+        unit.format = GL_RGBA; //given by the bound texture at draw time
+        unit.envMode = shadowEnum(m_stateShadow,GL_TEXTURE_ENV_MODE,i,GL_MODULATE);
+        if(unit.envMode != GL_COMBINE) continue;
+        static const GLenum srcs[3] = {GL_TEXTURE,GL_PREVIOUS,GL_CONSTANT};
+        static const GLenum rgbOperands[3] = {GL_SRC_COLOR,GL_SRC_COLOR,GL_SRC_ALPHA};
+        unit.combineRGB = shadowEnum(m_stateShadow,GL_COMBINE_RGB,i,GL_MODULATE);
+        unit.combineAlpha = shadowEnum(m_stateShadow,GL_COMBINE_ALPHA,i,GL_MODULATE);
+        for(int arg = 0; arg < 3; arg++) {
+            unit.srcRGB[arg] = shadowEnum(m_stateShadow,GL_SRC0_RGB + arg,i,srcs[arg]);
+            unit.srcAlpha[arg] = shadowEnum(m_stateShadow,GL_SRC0_ALPHA + arg,i,srcs[arg]);
+            unit.operandRGB[arg] = shadowEnum(m_stateShadow,GL_OPERAND0_RGB + arg,i,rgbOperands[arg]);
+            unit.operandAlpha[arg] = shadowEnum(m_stateShadow,GL_OPERAND0_ALPHA + arg,i,GL_SRC_ALPHA);
+        }
+        unit.rgbScale = shadowEnum(m_stateShadow,GL_RGB_SCALE,i,1);
+        unit.alphaScale = shadowEnum(m_stateShadow,GL_ALPHA_SCALE,i,1);
+    }
+
+    StateShadowMap::iterator it = m_stateShadow.find(StateKey(GL_POINT_DISTANCE_ATTENUATION,0));
+    m_ffPointAttenuation = it != m_stateShadow.end() &&
+                           ((*it).second.f[0] != 1 || (*it).second.f[1] != 0 || (*it).second.f[2] != 0);
+}
+
+//the base format of a texture image, the ones of unknown textures are taken as RGBA
+static GLushort textureBaseFormat(TextureData* texData) {
+    if(!texData) return GL_RGBA;
+    switch(texData->internalFormat) {
+    case GL_ALPHA:
+    case GL_LUMINANCE:
+    case GL_LUMINANCE_ALPHA:
+    case GL_RGB:
+        return texData->internalFormat;
+    default:
+        return GL_RGBA;
+    }
+}
+
+//
+// useFFProgram - the texture formats are looked up for every draw, a texture
+// may be redefined by another context of the share group. The program only
+// changes with the key.
+//
+void GLEScontext::useFFProgram(GLenum mode,bool drawTex) {
+    if(!s_glSupport.shaderFF) return;
+    if(m_ffStateDirty) {
+        buildFFState();
+        m_ffStateDirty = false;
     }
 
-    setActiveTexture(activeTexture);
-    s_glDispatch.glClientActiveTexture(activeTexture);
+    FFProgramKey key = m_ffState;
+    if(drawTex) {
+        key.flags = 0;
+        key.lights = 0;
+    }
+    if(mode == GL_POINTS && m_ffPointAttenuation) {
+        //the point size of a vertex program is not attenuated
+        key.flags |= FF_KEY_FIXED_FUNCTION;
+    }
+    for(int i = 0; i < MAX_TEX_UNITS; i++) {
+        if(!key.units[i].format) continue;
+        key.units[i].format = textureBaseFormat(m_shareGroup.Ptr() ?
+                              static_cast<TextureData*>(m_shareGroup->getObjectDataPtr(TEXTURE,m_tex2DBind[i])) : NULL);
+    }
+    if(m_ffKeyValid && key == m_ffKey) return;
+
+    GLuint program = key.flags & FF_KEY_FIXED_FUNCTION ? 0 : FFProgramCache::getProgram(s_glDispatch,key);
+    s_glDispatch.glUseProgram(program);
+    bool twoSide = program && (key.flags & FF_KEY_TWO_SIDE);
+    if(twoSide != m_ffTwoSide) {
+        if(twoSide) s_glDispatch.glEnable(GL_VERTEX_PROGRAM_TWO_SIDE);
+        else s_glDispatch.glDisable(GL_VERTEX_PROGRAM_TWO_SIDE);
+        m_ffTwoSide = twoSide;
+    }
+    m_ffKey = key;
+    m_ffKeyValid = true;
+}
+
+//
+// drawTex - the texture coordinates of each enabled unit map the crop
+// rectangle of its texture over the quad, a texture of unknown size or an
+// empty crop rectangle gives 0. The quad waits in the batch for the next
+// flush, the array batch is drawn first to keep the order.
+//
+void GLEScontext::drawTex(GLfloat x,GLfloat y,GLfloat z,GLfloat width,GLfloat height) {
+    if(m_batch.vertices) drawBatch();
+
+    unsigned int units = 0;
+    for(int i = 0; i < s_glSupport.maxTexUnits && i < MAX_TEX_UNITS; i++) {
+        if(isTexUnitEnabled(i)) units |= 1 << i;
+    }
+    if(m_texBatch.quads && (m_texBatch.units != units || m_texBatch.quads == GLES_DRAWTEX_MAX_QUADS)) {
+        drawTexBatch();
+    }
+    m_texBatch.units = units;
+
+    //counter clockwise from the bottom left corner
+    static const int corners[4][2] = {{0,0},{1,0},{1,1},{0,1}};
+    z = z < 0 ? 0 : (z > 1 ? 1 : z);
+    for(int c = 0; c < 4; c++) {
+        m_texBatch.positions.push_back(x + corners[c][0] * width);
+        m_texBatch.positions.push_back(y + corners[c][1] * height);
+        m_texBatch.positions.push_back(z);
+    }
+    for(int i = 0; i < MAX_TEX_UNITS; i++) {
+        if(!(units & (1 << i))) continue;
+        GLfloat s[2] = {0,0},t[2] = {0,0};
+        TextureData* texData = m_shareGroup.Ptr() ?
+                               static_cast<TextureData*>(m_shareGroup->getObjectDataPtr(TEXTURE,m_tex2DBind[i])) : NULL;
+        if(texData && texData->width && texData->height) {
+            const int* crop = texData->cropRect;
+            s[0] = static_cast<GLfloat>(crop[0]) / texData->width;
+            s[1] = static_cast<GLfloat>(crop[0] + crop[2]) / texData->width;
+            t[0] = static_cast<GLfloat>(crop[1]) / texData->height;
+            t[1] = static_cast<GLfloat>(crop[1] + crop[3]) / texData->height;
+        }
+        for(int c = 0; c < 4; c++) {
+            m_texBatch.texCoords[i].push_back(s[corners[c][0]]);
+            m_texBatch.texCoords[i].push_back(t[corners[c][1]]);
+        }
+    }
+
+    GLushort base = m_texBatch.quads * 4;
+    static const GLushort quad[6] = {0,1,2,0,2,3};
+    for(int i = 0; i < 6; i++) {
+        m_texBatch.indices.push_back(base + quad[i]);
+    }
+    m_texBatch.quads++;
+}
+
+//
+// drawTexBatch - the quads are drawn in normalized device coordinates with
+// identity matrices, without lighting or face culling. The driver state
+// changed for them is given back afterwards, like the client arrays.
+//
+void GLEScontext::drawTexBatch() {
+    GLint viewport[4];
+    s_glDispatch.glGetIntegerv(GL_VIEWPORT,viewport);
+    GLfloat* pos = &m_texBatch.positions[0];
+    for(size_t i = 0; i < m_texBatch.positions.size(); i += 3) {
+        pos[i]     = viewport[2] ? 2.0f * (pos[i] - viewport[0]) / viewport[2] - 1.0f : 0;
+        pos[i + 1] = viewport[3] ? 2.0f * (pos[i + 1] - viewport[1]) / viewport[3] - 1.0f : 0;
+        pos[i + 2] = 2.0f * pos[i + 2] - 1.0f;
+    }
+
+    GLint matrixMode;
+    s_glDispatch.glGetIntegerv(GL_MATRIX_MODE,&matrixMode);
+    s_glDispatch.glMatrixMode(GL_PROJECTION);
+    s_glDispatch.glPushMatrix();
+    s_glDispatch.glLoadIdentity();
+    s_glDispatch.glMatrixMode(GL_MODELVIEW);
+    s_glDispatch.glPushMatrix();
+    s_glDispatch.glLoadIdentity();
+    s_glDispatch.glMatrixMode(GL_TEXTURE);
+    unsigned int unit = m_activeServerTexture;
+    for(int i = 0; i < MAX_TEX_UNITS; i++) {
+        if(!(m_texBatch.units & (1 << i))) continue;
+        if(unit != (unsigned int)i) {
+            unit = i;
+            s_glDispatch.glActiveTexture(GL_TEXTURE0 + unit);
+        }
+        s_glDispatch.glPushMatrix();
+        s_glDispatch.glLoadIdentity();
+    }
+    bool lighting = isStateEnabled(GL_LIGHTING);
+    bool culling = isStateEnabled(GL_CULL_FACE);
+    if(lighting) s_glDispatch.glDisable(GL_LIGHTING);
+    if(culling) s_glDispatch.glDisable(GL_CULL_FACE);
+
+    //the driver client arrays follow m_enabledArrays, only the quads ones are
+    //enabled for the draw
+    unsigned int used = (1 << GLES_VERTEX_SLOT) | (m_texBatch.units << GLES_TEXCOORD_SLOT);
+    unsigned int activeTexture = m_activeTexture;
+    for(int pass = 0; pass < 2; pass++) {
+        for(int slot = 0; slot < GLES_CONVERTED_SLOTS; slot++) {
+            unsigned int bit = 1 << slot;
+            if(!((used | m_enabledArrays) & bit) || slot == GLES_POINT_SIZE_SLOT) continue;
+            if(slot >= GLES_TEXCOORD_SLOT && (unsigned int)(slot - GLES_TEXCOORD_SLOT) != activeTexture) {
+                activeTexture = slot - GLES_TEXCOORD_SLOT;
+                s_glDispatch.glClientActiveTexture(GL_TEXTURE0 + activeTexture);
+            }
+            GLenum array = s_arrayIds[slot < GLES_TEXCOORD_SLOT ? slot : GLES_TEXCOORD_SLOT];
+            if((used & bit) != (m_enabledArrays & bit)) {
+                bool enable = pass == 0 ? (used & bit) != 0 : (m_enabledArrays & bit) != 0;
+                if(enable) s_glDispatch.glEnableClientState(array);
+                else s_glDispatch.glDisableClientState(array);
+            }
+            if(!(used & bit)) continue;
+            if(pass == 0) {
+                if(slot == GLES_VERTEX_SLOT) sendSlotPointer(slot,3,GL_FLOAT,0,pos);
+                else sendSlotPointer(slot,2,GL_FLOAT,0,&m_texBatch.texCoords[slot - GLES_TEXCOORD_SLOT][0]);
+            } else {
+                const GLESpointer* p = slotPointer(slot);
+                if(p->getType() != GL_FIXED) {
+                    sendSlotPointer(slot,p->getSize(),p->getType(),p->getStride(),
+                                    p->hasBuffer() ? p->getBufferData() : p->getArrayData());
+                }
+            }
+        }
+        if(pass == 0) {
+            useFFProgram(GL_TRIANGLES,true);
+            s_glDispatch.glDrawElements(GL_TRIANGLES,m_texBatch.indices.size(),GL_UNSIGNED_SHORT,&m_texBatch.indices[0]);
+        }
+    }
+    if(activeTexture != m_activeTexture) {
+        s_glDispatch.glClientActiveTexture(GL_TEXTURE0 + m_activeTexture);
+    }
+
+    if(lighting) s_glDispatch.glEnable(GL_LIGHTING);
+    if(culling) s_glDispatch.glEnable(GL_CULL_FACE);
+    for(int i = 0; i < MAX_TEX_UNITS; i++) {
+        if(!(m_texBatch.units & (1 << i))) continue;
+        if(unit != (unsigned int)i) {
+            unit = i;
+            s_glDispatch.glActiveTexture(GL_TEXTURE0 + unit);
+        }
+        s_glDispatch.glPopMatrix();
+    }
+    if(unit != m_activeServerTexture) s_glDispatch.glActiveTexture(GL_TEXTURE0 + m_activeServerTexture);
+    s_glDispatch.glMatrixMode(GL_MODELVIEW);
+    s_glDispatch.glPopMatrix();
+    s_glDispatch.glMatrixMode(GL_PROJECTION);
+    s_glDispatch.glPopMatrix();
+    s_glDispatch.glMatrixMode(matrixMode);
+
+    m_texBatch.positions.clear();
+    for(int i = 0; i < MAX_TEX_UNITS; i++) {
+        m_texBatch.texCoords[i].clear();
+    }
+    m_texBatch.indices.clear();
+    m_texBatch.quads = 0;
 }
 
 
@@ -381,29 +929,36 @@ void sortPoints(GLfloat* sortedPoints,GLushort* sortedIndices,int size) {
 }
 
 
-void GLEScontext::drawPoints(PointSizeIndices* points) {
+static bool comparePointSizes(const std::pair<GLfloat,GLushort>& a,const std::pair<GLfloat,GLushort>& b) {
+    return a.first < b.first;
+}
 
-    GLushort* indices = NULL;
-    int last_size = 0;
+//
+// drawPoints - the host has no per vertex point size, so the points are
+// drawn once for each distinct size. The points are sorted by size into
+// a single index array and each run of equal sizes is drawn from it.
+//
+void GLEScontext::drawPoints() {
 
-    //drawing each group of vertices by the points size
-    for(PointSizeIndices::iterator it = points->begin();it != points->end(); it++) {
-            int count = (*it).second.size();
-            int pointSize = (*it).first;
-            std::vector<int>& arr = (*it).second;
+    //stable, so points of the same size are drawn in their original order
+    std::stable_sort(m_points.begin(),m_points.end(),comparePointSizes);
 
-            if(count > last_size) {
-             if(indices) delete [] indices;
-             indices = new GLushort[count];
-            }
-            int i = 0 ;
-            for(std::vector<int>::iterator it2 = arr.begin();it2 != arr.end();it2++) {
-                indices[i++] = (*it2);
-            }
-            s_glDispatch.glPointSize(pointSize);
-            s_glDispatch.glDrawElements(GL_POINTS,count,GL_UNSIGNED_SHORT,indices);
+    int count = m_points.size();
+    m_pointIndices.resize(count);
+    for(int i = 0; i < count; i++) {
+        m_pointIndices[i] = m_points[i].second;
+    }
+
+    int start = 0;
+    while(start < count) {
+        GLfloat pointSize = m_points[start].first;
+        int end = start + 1;
+        while(end < count && m_points[end].first == pointSize) end++;
+
+        s_glDispatch.glPointSize(pointSize);
+        s_glDispatch.glDrawElements(GL_POINTS,end - start,GL_UNSIGNED_SHORT,&m_pointIndices[start]);
+        start = end;
     }
-    if(indices) delete [] indices;
 }
 
 void  GLEScontext::drawPointsData(GLESFloatArrays& fArrs,GLint first,GLsizei count,GLenum type,const GLvoid* indices_in,bool isElemsDraw) {
@@ -415,26 +970,26 @@ void  GLEScontext::drawPointsData(GLESFloatArrays& fArrs,GLint first,GLsizei cou
         pointsArr=fArrs.arrays[m_pointsIndex];
         stride = 1;
     } else {
-        GLESpointer* p = m_map[GL_POINT_SIZE_ARRAY_OES];
+        GLESpointer* p = m_arrays[GLES_POINT_SIZE_SLOT];
         pointsArr = static_cast<const GLfloat*>(isBindedBuffer(GL_ARRAY_BUFFER)?p->getBufferData():p->getArrayData());
         stride = p->getStride()?p->getStride()/sizeof(GLfloat):1;
     }
 
     //filling  arrays before sorting them
-    PointSizeIndices  points;
+    m_points.resize(count);
     if(isElemsDraw) {
         for(int i=0; i< count; i++) {
             GLushort index = (type == GL_UNSIGNED_SHORT?
                     static_cast<const GLushort*>(indices_in)[i]:
                     static_cast<const GLubyte*>(indices_in)[i]);
-            points[pointsArr[index*stride]].push_back(index);
+            m_points[i] = std::make_pair(pointsArr[index*stride],index);
         }
     } else {
         for(int i=0; i< count; i++) {
-            points[pointsArr[first+i*stride]].push_back(i+first);
+            m_points[i] = std::make_pair(pointsArr[(first+i)*stride],(GLushort)(first+i));
         }
     }
-    drawPoints(&points);
+    drawPoints();
 }
 
 void  GLEScontext::drawPointsArrs(GLESFloatArrays& arrs,GLint first,GLsizei count) {
@@ -470,26 +1025,26 @@ GLvoid* GLEScontext::getBindedBuffer(GLenum target) {
     GLuint bufferName = getBuffer(target);
     if(!bufferName) return NULL;
 
-    GLESbuffer* vbo = static_cast<GLESbuffer*>(m_shareGroup->getObjectData(VERTEXBUFFER,bufferName).Ptr());
+    GLESbuffer* vbo = static_cast<GLESbuffer*>(m_shareGroup->getObjectDataPtr(VERTEXBUFFER,bufferName));
     return vbo->getData();
 }
 
 void GLEScontext::getBufferSize(GLenum target,GLint* param) {
     GLuint bufferName = getBuffer(target);
-    GLESbuffer* vbo = static_cast<GLESbuffer*>(m_shareGroup->getObjectData(VERTEXBUFFER,bufferName).Ptr());
+    GLESbuffer* vbo = static_cast<GLESbuffer*>(m_shareGroup->getObjectDataPtr(VERTEXBUFFER,bufferName));
     *param = vbo->getSize();
 }
 
 void GLEScontext::getBufferUsage(GLenum target,GLint* param) {
     GLuint bufferName = getBuffer(target);
-    GLESbuffer* vbo = static_cast<GLESbuffer*>(m_shareGroup->getObjectData(VERTEXBUFFER,bufferName).Ptr());
+    GLESbuffer* vbo = static_cast<GLESbuffer*>(m_shareGroup->getObjectDataPtr(VERTEXBUFFER,bufferName));
     *param = vbo->getUsage();
 }
 
 bool GLEScontext::setBufferData(GLenum target,GLsizeiptr size,const GLvoid* data,GLenum usage) {
     GLuint bufferName = getBuffer(target);
     if(!bufferName) return false;
-    GLESbuffer* vbo = static_cast<GLESbuffer*>(m_shareGroup->getObjectData(VERTEXBUFFER,bufferName).Ptr());
+    GLESbuffer* vbo = static_cast<GLESbuffer*>(m_shareGroup->getObjectDataPtr(VERTEXBUFFER,bufferName));
     return vbo->setBuffer(size,usage,data);
 }
 
@@ -497,6 +1052,6 @@ bool GLEScontext::setBufferSubData(GLenum target,GLintptr offset,GLsizeiptr size
 
     GLuint bufferName = getBuffer(target);
     if(!bufferName) return false;
-    GLESbuffer* vbo = static_cast<GLESbuffer*>(m_shareGroup->getObjectData(VERTEXBUFFER,bufferName).Ptr());
+    GLESbuffer* vbo = static_cast<GLESbuffer*>(m_shareGroup->getObjectDataPtr(VERTEXBUFFER,bufferName));
     return vbo->setSubBuffer(offset,size,data);
 }
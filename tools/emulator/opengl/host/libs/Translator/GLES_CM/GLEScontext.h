@@ -19,29 +19,147 @@
 #include "GLDispatch.h"
 #include "GLESpointer.h"
 #include "GLESbuffer.h"
+#include "GLfixed_pool.h"
 #include <map>
+#include <string.h>
 #include <vector>
 #include <utils/threads.h>
 
 #define MAX_TEX_UNITS 8
 
-typedef std::map<GLenum,GLESpointer*>  ArraysMap;
-typedef std::map<GLfloat,std::vector<int> > PointSizeIndices;
+//client arrays have fixed slots, the texture coords array has one per texture unit
+enum {
+    GLES_VERTEX_SLOT = 0,
+    GLES_NORMAL_SLOT,
+    GLES_COLOR_SLOT,
+    GLES_POINT_SIZE_SLOT,
+    GLES_TEXCOORD_SLOT,
+    GLES_ARRAY_SLOTS,
+    GLES_CONVERTED_SLOTS = GLES_TEXCOORD_SLOT + MAX_TEX_UNITS
+};
+
+typedef std::vector<std::pair<GLfloat,GLushort> > PointSizeIndices; //point size of each vertex index
+
+#define GLES_PARALLEL_CONVERT_MIN 32768   //components of a client array converted by the pool, see FixedConvertPool
+
+#define GLES_BATCH_MAX_DRAW     64      //larger draws go to the driver as they are
+#define GLES_BATCH_MAX_VERTICES 4096
+
+//
+// consecutive small triangle draws from client arrays with the same arrays
+// enabled, merged into one indexed draw. The vertices are copied as floats
+// when the draw is recorded, state changes flush the batch first.
+//
+struct GLESDrawBatch
+{
+    GLESDrawBatch():enabled(0),vertices(0){memset(sizes,0,sizeof(sizes));};
+    unsigned int          enabled;    //m_enabledArrays of the batched draws
+    GLint                 sizes[GLES_CONVERTED_SLOTS];
+    std::vector<GLfloat>  data[GLES_CONVERTED_SLOTS];
+    std::vector<GLushort> indices;
+    unsigned int          vertices;
+};
+
+#define GLES_DRAWTEX_MAX_QUADS  1024    //4 vertices each, indexed by GLushort
 
+//
+// consecutive glDrawTex*OES quads with the same texture units enabled, drawn
+// as one list of triangles. The quads are kept in window coordinates with the
+// texture coordinates of the crop rectangles, the storage is reused.
+//
+struct GLESDrawTexBatch
+{
+    GLESDrawTexBatch():units(0),quads(0){};
+    unsigned int          units;      //bit per texture unit with texture coordinates
+    std::vector<GLfloat>  positions;  //x,y,z of each corner
+    std::vector<GLfloat>  texCoords[MAX_TEX_UNITS];
+    std::vector<GLushort> indices;
+    unsigned int          quads;
+};
+
+//arrays converted for the current draw, they are owned by the context conversion cache
 struct GLESFloatArrays
 {
-    GLESFloatArrays(){};
-    ~GLESFloatArrays();
-    std::map<GLenum,GLfloat*> arrays;
+    GLESFloatArrays(){memset(arrays,0,sizeof(arrays));};
+    GLfloat* arrays[GLES_CONVERTED_SLOTS];
+};
+
+//GL_FIXED client array converted to floats, kept across draws as long as the array content does not change
+struct GLESConvertedArray
+{
+    GLESConvertedArray():src(NULL),stride(0),attribSize(0),elements(0),fixedData(NULL),fixedSize(0),floatData(NULL),floatSize(0){};
+    const char*  src;
+    int          stride;
+    int          attribSize;
+    unsigned int elements;
+    char*        fixedData;  //copy of the source data, to detect changes
+    unsigned int fixedSize;
+    GLfloat*     floatData;
+    unsigned int floatSize;
+};
+
+
+//last value given to the driver for a piece of server state, keyed by (pname,texture unit)
+struct GLESStateValue
+{
+    GLuint  i;
+    GLfloat f[4];
+};
+
+typedef std::pair<GLenum,unsigned int>         StateKey;
+typedef std::map<StateKey,GLESStateValue>      StateShadowMap;
+
+
+#define FF_KEY_LIGHTING       0x01
+#define FF_KEY_TWO_SIDE       0x02
+#define FF_KEY_COLOR_MATERIAL 0x04
+#define FF_KEY_NORMALIZE      0x08
+#define FF_KEY_RESCALE_NORMAL 0x10
+#define FF_KEY_FIXED_FUNCTION 0x20    //drawn by the driver fixed function pipeline
+
+//texture environment of an enabled unit, the combiner fields are 0 unless envMode is GL_COMBINE
+struct FFTexUnitKey
+{
+    GLushort format;        //base format of the bound texture, 0 when the unit is disabled
+    GLushort envMode;
+    GLushort combineRGB;
+    GLushort combineAlpha;
+    GLushort srcRGB[3];
+    GLushort operandRGB[3];
+    GLushort srcAlpha[3];
+    GLushort operandAlpha[3];
+    GLushort rgbScale;
+    GLushort alphaScale;
+};
+
+//
+// the fixed function state a generated program depends on, see FFProgramCache.
+// It is compared as raw memory, so it is cleared entirely before being filled,
+// by reset() or by value initialization.
+//
+struct FFProgramKey
+{
+    void reset(){memset(this,0,sizeof(*this));};
+    bool operator<(const FFProgramKey& k) const {return memcmp(this,&k,sizeof(*this)) < 0;};
+    bool operator==(const FFProgramKey& k) const {return memcmp(this,&k,sizeof(*this)) == 0;};
+    unsigned int flags;
+    unsigned int lights;    //bit per enabled light
+    GLenum       fogMode;   //0 without fog
+    FFTexUnitKey units[MAX_TEX_UNITS];
 };
 
 
 struct GLsupport {
-    GLsupport():maxLights(0),maxClipPlane(0),maxTexUnits(0),maxTexSize(0){};
+    GLsupport():maxLights(0),maxClipPlane(0),maxTexUnits(0),maxTexSize(0),GL_OES_compressed_ETC1_RGB8_texture(false),nativePackedTexels(false),GL_EXT_framebuffer_object(false),batchDraws(false),shaderFF(false){};
     int  maxLights;
     int  maxClipPlane;
     int  maxTexUnits;
     int  maxTexSize;
+    bool GL_OES_compressed_ETC1_RGB8_texture; //ETC1 textures can be given to the driver as is
+    bool nativePackedTexels; //16 bits texel types are given to the driver as is, see TextureUtils.h
+    bool GL_EXT_framebuffer_object; //GL_OES_framebuffer_object, glGenerateMipmapEXT replaces the driver's GL_GENERATE_MIPMAP
+    bool batchDraws; //ANDROID_GLES_BATCH_DRAWS, see GLESDrawBatch
+    bool shaderFF; //ANDROID_GLES_SHADER_FF, see FFProgramCache
 };
 
 class GLEScontext
@@ -56,14 +174,27 @@ public:
     void  setGLerror(GLenum err);
     void  setActiveTexture(GLenum tex);
     const GLvoid* setPointer(GLenum arrType,GLint size,GLenum type,GLsizei stride,const GLvoid* data);
-    unsigned int getBindedTexture(){return m_tex2DBind[m_activeTexture];};
-    void setBindedTexture(unsigned int tex){ m_tex2DBind[m_activeTexture] = tex;};
+    unsigned int getBindedTexture(){return m_tex2DBind[m_activeServerTexture];};
+    unsigned int getUnitTexture(unsigned int unit){return m_tex2DBind[unit];};
+    unsigned int getActiveServerTexture(){return m_activeServerTexture;};
+    void setBindedTexture(unsigned int tex){ m_tex2DBind[m_activeServerTexture] = tex;};
     const GLESpointer* getPointer(GLenum arrType);
 
     void convertArrs(GLESFloatArrays& fArrs,GLint first,GLsizei count,GLenum type,const GLvoid* indices,bool direct);
     void drawPointsArrs(GLESFloatArrays& arrs,GLint first,GLsizei count);
     void drawPointsElems(GLESFloatArrays& arrs,GLsizei count,GLenum type,const GLvoid* indices);
 
+    //
+    // batchDrawArrays records a glDrawArrays in the draw batch, returns
+    // false if the draw can't be batched, the batch is flushed then.
+    // flushDraws must be called before anything that depends on the draws
+    // or changes the state they use.
+    //
+    bool batchDrawArrays(GLenum mode,GLint first,GLsizei count);
+    void flushDraws(){if(m_batch.vertices) drawBatch(); if(m_texBatch.quads) drawTexBatch();};
+    //records a glDrawTex*OES rectangle, in window coordinates
+    void drawTex(GLfloat x,GLfloat y,GLfloat z,GLfloat width,GLfloat height);
+
     void bindBuffer(GLenum target,GLuint buffer);
     bool isBuffer(GLuint buffer);
     bool isBindedBuffer(GLenum target);
@@ -73,12 +204,45 @@ public:
     bool setBufferData(GLenum target,GLsizeiptr size,const GLvoid* data,GLenum usage);
     bool setBufferSubData(GLenum target,GLintptr offset,GLsizeiptr size,const GLvoid* data);
     void setShareGroup(ShareGroupPtr grp){m_shareGroup = grp;};
+    std::vector<unsigned char>& texScratchBuffer(){return m_texScratch;}; //decoded texture images
+    void setUnpackAlignment(int alignment){m_unpackAlignment = alignment;};
+    int  getUnpackAlignment(){return m_unpackAlignment;}; //last GL_UNPACK_ALIGNMENT given to the driver
+    //a bound texture may have GL_GENERATE_MIPMAP mipmaps to rebuild before the next draw
+    void setMipmapsPending(bool pending){m_mipmapsPending = pending;};
+    bool mipmapsPending(){return m_mipmapsPending;};
+
+    //
+    // shadow of the server state. updateState records the value about to be
+    // given to the driver and returns false when it is already the current
+    // one, so the call can be dropped. State never set is unknown and always
+    // goes through. Texture unit state is keyed by the active server unit.
+    //
+    bool updateState(GLenum pname,GLuint value);
+    bool updateState(GLenum pname,const GLfloat* values,int count);
+    bool updateTexState(GLenum pname,GLuint value);
+    bool updateTexState(GLenum pname,const GLfloat* values,int count);
+    void invalidateState(GLenum pname){m_stateShadow.erase(StateKey(pname,0));};
+    void invalidateTexState(GLenum pname){m_stateShadow.erase(StateKey(pname,m_activeServerTexture));};
+    bool setActiveServerTexture(GLenum tex);
+    void textureDeleted(GLuint globalName);
+
+    //
+    // fixed function emulation, when ANDROID_GLES_SHADER_FF is set. useFFProgram
+    // binds the program generated for the current state before the driver draws
+    // 'mode', without lighting for the glDrawTex quads. State the programs do
+    // not cover goes back to the driver fixed function pipeline, program 0.
+    //
+    void useFFProgram(GLenum mode,bool drawTex);
 
     static GLDispatch& dispatcher();
     static int getMaxLights(){return s_glSupport.maxLights;}
     static int getMaxClipPlanes(){return s_glSupport.maxClipPlane;}
     static int getMaxTexUnits(){return s_glSupport.maxTexUnits;}
     static int getMaxTexSize(){return s_glSupport.maxTexSize;}
+    static bool hasNativeETC1(){return s_glSupport.GL_OES_compressed_ETC1_RGB8_texture;}
+    static bool hasNativePackedTexels(){return s_glSupport.nativePackedTexels;}
+    static bool hasGenerateMipmap(){return s_glSupport.GL_EXT_framebuffer_object;}
+    static bool hasFramebufferObject(){return s_glSupport.GL_EXT_framebuffer_object;}
 
 
     ~GLEScontext();
@@ -86,7 +250,7 @@ private:
 
     GLuint getBuffer(GLenum target);
     void sendArr(GLvoid* arr,GLenum arrayType,GLint size,GLsizei stride,int pointsIndex = -1);
-    void drawPoints(PointSizeIndices* points);
+    void drawPoints();
     void drawPointsData(GLESFloatArrays& arrs,GLint first,GLsizei count,GLenum type,const GLvoid* indices_in,bool isElemsDraw);
 
     void chooseConvertMethod(GLESFloatArrays& fArrs,GLint first,GLsizei count,GLenum type,const GLvoid* indices,bool direct,GLESpointer* p,GLenum array_id,unsigned int& index);
@@ -94,21 +258,48 @@ private:
     void convertDirectVBO(GLint first,GLsizei count,GLenum array_id,GLESpointer* p);
     void convertIndirect(GLESFloatArrays& fArrs,GLsizei count,GLenum type,const GLvoid* indices,GLenum array_id,GLESpointer* p,unsigned int& index);
     void convertIndirectVBO(GLsizei count,GLenum indices_type,const GLvoid* indices,GLenum array_id,GLESpointer* p);
+    GLfloat* convertClientArray(GLenum array_id,const char* src,int stride,int attribSize,unsigned int elements);
+    GLESpointer* slotPointer(int slot){return slot < GLES_TEXCOORD_SLOT ? &m_pointers[slot] : &m_texCoords[slot - GLES_TEXCOORD_SLOT];};
+    void sendSlotPointer(int slot,GLint size,GLenum type,GLsizei stride,const GLvoid* data);
+    void drawBatch();
+    void drawTexBatch();
+    bool isStateEnabled(GLenum cap);
+    bool isTexUnitEnabled(unsigned int unit);
+    void buildFFState();
 
     static GLDispatch     s_glDispatch;
     static GLsupport      s_glSupport;
     static android::Mutex s_lock;
+    static FixedConvertPool* s_convertPool; //ANDROID_GLES_CONVERT_THREADS
 
-    ArraysMap             m_map;
+    GLESpointer*          m_arrays[GLES_ARRAY_SLOTS]; //the texture coords slot points to the client active unit array
+    GLESpointer           m_pointers[GLES_TEXCOORD_SLOT];
     GLESpointer*          m_texCoords;
+    unsigned int          m_enabledArrays;  //bit per slot, the texture coords bits start at GLES_TEXCOORD_SLOT
     GLenum                m_glError;
     unsigned int          m_activeTexture;
+    unsigned int          m_activeServerTexture; //glActiveTexture, m_activeTexture follows glClientActiveTexture
     unsigned int          m_tex2DBind[MAX_TEX_UNITS];
     unsigned int          m_arrayBuffer;
     unsigned int          m_elementBuffer;
     int                   m_pointsIndex;
     bool                  m_initialized;
     ShareGroupPtr         m_shareGroup;
+    GLESConvertedArray    m_convertedArrays[GLES_CONVERTED_SLOTS];
+    PointSizeIndices      m_points;       //kept across draws to reuse the storage
+    std::vector<GLushort> m_pointIndices;
+    std::vector<unsigned char> m_texScratch;
+    int                   m_unpackAlignment;
+    bool                  m_mipmapsPending;
+    GLESDrawBatch         m_batch;
+    GLESDrawTexBatch      m_texBatch;
+    StateShadowMap        m_stateShadow;
+    FFProgramKey          m_ffState;      //the shadowed part of the key, rebuilt when the shadow changes
+    bool                  m_ffStateDirty;
+    bool                  m_ffPointAttenuation; //points are sized by the driver fixed function pipeline
+    FFProgramKey          m_ffKey;        //key of the program in use
+    bool                  m_ffKeyValid;
+    bool                  m_ffTwoSide;    //GL_VERTEX_PROGRAM_TWO_SIDE given to the driver
 };
 
 #endif
@@ -44,13 +44,17 @@ static __translatorMustCastToProperFunctionPointerType getProcAddress(const char
 }
 
 /************************************** GLES EXTENSIONS *********************************************************/
-#define GLES_EXTENTIONS 1
-//extensions decleration
-void glEGLImageTargetTexture2DOES(GLenum target, GLeglImageOES image);
+#define GLES_EXTENTIONS 2
+//extensions decleration, exported as well for the renderer which loads them by name
+extern "C" {
+GL_API void GL_APIENTRY glEGLImageTargetTexture2DOES(GLenum target, GLeglImageOES image);
+GL_API void GL_APIENTRY glEGLImageTargetRenderbufferStorageOES(GLenum target, GLeglImageOES image);
+}
 
 //extentions descriptor
 static ExtentionDescriptor s_glesExtentions[] = {
-                                                    {"glEGLImageTargetTexture2DOES",(__translatorMustCastToProperFunctionPointerType)glEGLImageTargetTexture2DOES}
+                                                    {"glEGLImageTargetTexture2DOES",(__translatorMustCastToProperFunctionPointerType)glEGLImageTargetTexture2DOES},
+                                                    {"glEGLImageTargetRenderbufferStorageOES",(__translatorMustCastToProperFunctionPointerType)glEGLImageTargetRenderbufferStorageOES}
                                                 };
 /****************************************************************************************************************/
 typedef void(*FUNCPTR)();
@@ -101,26 +105,51 @@ GL_API GLESiface* __translator_getIfaces(EGLiface* eglIface){
 
 }
 
+//
+// the ThreadInfo of a thread never changes, each thread keeps it here
+// rather than going through the EGL interface on every call
+//
+#ifdef __linux__
+static __thread ThreadInfo* s_threadInfo = NULL;
+#define CACHED_THREAD_INFO() s_threadInfo
+#define CACHE_THREAD_INFO(thrd) s_threadInfo = (thrd)
+#else
+#define CACHED_THREAD_INFO() NULL
+#define CACHE_THREAD_INFO(thrd)
+#endif
+
 #define GET_THREAD()                                                         \
-            ThreadInfo* thrd = NULL;                                         \
-            if(s_eglIface) {                                                 \
-                thrd = s_eglIface->getThreadInfo();                          \
-            } else {                                                         \
-                fprintf(stderr,"Context wasn't initialized yet \n");         \
+            ThreadInfo* thrd = CACHED_THREAD_INFO();                         \
+            if(!thrd) {                                                      \
+                if(s_eglIface) {                                             \
+                    thrd = s_eglIface->getThreadInfo();                      \
+                    CACHE_THREAD_INFO(thrd);                                 \
+                } else {                                                     \
+                    fprintf(stderr,"Context wasn't initialized yet \n");     \
+                }                                                            \
             }
 
 
-#define GET_CTX()                                                            \
+//
+// every entry point flushes the batched draws, see GLESDrawBatch, except
+// glDrawArrays and the array pointer calls, which use GET_CTX_NO_FLUSH
+//
+#define GET_CTX_NO_FLUSH()                                                   \
             GET_THREAD();                                                    \
             if(!thrd) return;                                                \
             GLEScontext *ctx = static_cast<GLEScontext*>(thrd->glesContext); \
             if(!ctx) return;
 
+#define GET_CTX()                                                            \
+            GET_CTX_NO_FLUSH()                                               \
+            ctx->flushDraws();
+
 #define GET_CTX_RET(failure_ret)                                             \
             GET_THREAD();                                                    \
             if(!thrd) return failure_ret;                                    \
             GLEScontext *ctx = static_cast<GLEScontext*>(thrd->glesContext); \
-            if(!ctx) return failure_ret;
+            if(!ctx) return failure_ret;                                     \
+            ctx->flushDraws();
 
 
 #define SET_ERROR_IF(condition,err) if((condition)) {                        \
@@ -139,8 +168,8 @@ GL_API GLboolean GL_APIENTRY glIsBuffer(GLuint buffer) {
     GET_CTX_RET(GL_FALSE)
 
     if(buffer && thrd->shareGroup.Ptr()) {
-       ObjectDataPtr objData = thrd->shareGroup->getObjectData(VERTEXBUFFER,buffer);
-       return objData.Ptr() ? ((GLESbuffer*)objData.Ptr())->wasBinded():GL_FALSE;
+       GLESbuffer* vbo = (GLESbuffer*)thrd->shareGroup->getObjectDataPtr(VERTEXBUFFER,buffer);
+       return vbo ? vbo->wasBinded():GL_FALSE;
     }
     return GL_FALSE;
 }
@@ -172,14 +201,23 @@ GL_API GLenum GL_APIENTRY  glGetError(void) {
     return ctx->dispatcher().glGetError();
 }
 
+//GL_OES_framebuffer_object needs the driver's GL_EXT_framebuffer_object
+#define COMMON_EXTENSIONS "GL_OES_compressed_paletted_texture " \
+                          "GL_OES_compressed_ETC1_RGB8_texture " \
+                          "GL_OES_point_size_array " \
+                          "GL_OES_draw_texture " \
+                          "GL_OES_EGL_image " \
+                          "GL_EXT_texture_format_BGRA8888 " \
+                          "GL_EXT_read_format_bgra"
+
 GL_API const GLubyte * GL_APIENTRY  glGetString( GLenum name) {
 
     GET_CTX_RET(NULL)
     static GLubyte VENDOR[]     = "Google";
     static GLubyte RENDERER[]   = "OpenGL ES-CM 1.1";
     static GLubyte VERSION[]    = "OpenGL ES-CM 1.1";
-    static GLubyte EXTENSIONS[] = "GL_OES_compressed_paletted_texture "
-                                  "GL_OES_point_size_array";
+    static GLubyte EXTENSIONS[]     = COMMON_EXTENSIONS;
+    static GLubyte FBO_EXTENSIONS[] = COMMON_EXTENSIONS " GL_OES_framebuffer_object";
     switch(name) {
         case GL_VENDOR:
             return VENDOR;
@@ -188,29 +226,112 @@ GL_API const GLubyte * GL_APIENTRY  glGetString( GLenum name) {
         case GL_VERSION:
             return VERSION;
         case GL_EXTENSIONS:
-            return EXTENSIONS;
+            return ctx->hasFramebufferObject() ? FBO_EXTENSIONS : EXTENSIONS;
         default:
             RET_AND_SET_ERROR_IF(true,GL_INVALID_ENUM,NULL);
     }
 }
 
+//GL_TEXTURE_2D is per texture unit, invalid caps are left to the driver
+static TextureData* getTextureData();
+
+//
+// GL_GENERATE_MIPMAP. When the driver has glGenerateMipmapEXT the parameter
+// is kept by the translator: changes to level 0 only mark the texture, and
+// its mipmaps are built once before the next draw, instead of by the driver
+// after every glTexSubImage2D.
+//
+static bool setGenerateMipmap(ThreadInfo* thrd,GLEScontext* ctx,GLenum pname,GLfloat param) {
+    if(pname != GL_GENERATE_MIPMAP || !ctx->hasGenerateMipmap()) return false;
+    TextureData* texData = thrd->shareGroup.Ptr() ? getTextureData() : NULL;
+    if(texData) {
+        texData->generateMipmap = param != 0;
+        if(texData->generateMipmap && texData->width) {
+            texData->mipmapDirty = true;
+            ctx->setMipmapsPending(true);
+        }
+    }
+    return true;
+}
+
+static bool getGenerateMipmap(ThreadInfo* thrd,GLEScontext* ctx,GLenum pname,GLint* param) {
+    if(pname != GL_GENERATE_MIPMAP || !ctx->hasGenerateMipmap()) return false;
+    TextureData* texData = thrd->shareGroup.Ptr() ? getTextureData() : NULL;
+    *param = texData && texData->generateMipmap;
+    return true;
+}
+
+//GL_TEXTURE_CROP_RECT_OES is kept by the translator, for glDrawTex*OES
+static bool setCropRect(ThreadInfo* thrd,GLenum pname,const GLint* crop) {
+    if(pname != GL_TEXTURE_CROP_RECT_OES) return false;
+    TextureData* texData = thrd->shareGroup.Ptr() ? getTextureData() : NULL;
+    if(texData) memcpy(texData->cropRect,crop,sizeof(texData->cropRect));
+    return true;
+}
+
+static bool getCropRect(ThreadInfo* thrd,GLenum pname,GLint* crop) {
+    if(pname != GL_TEXTURE_CROP_RECT_OES) return false;
+    TextureData* texData = thrd->shareGroup.Ptr() ? getTextureData() : NULL;
+    for(int i = 0; i < 4; i++) {
+        crop[i] = texData ? texData->cropRect[i] : 0;
+    }
+    return true;
+}
+
+static void textureLevelChanged(ThreadInfo* thrd,GLEScontext* ctx,GLint level) {
+    if(level != 0 || !ctx->hasGenerateMipmap() || !thrd->shareGroup.Ptr()) return;
+    TextureData* texData = getTextureData();
+    if(texData && texData->generateMipmap) {
+        texData->mipmapDirty = true;
+        ctx->setMipmapsPending(true);
+    }
+}
+
+static void generatePendingMipmaps(ThreadInfo* thrd,GLEScontext* ctx) {
+    if(!ctx->mipmapsPending()) return;
+    ctx->setMipmapsPending(false);
+    if(!thrd->shareGroup.Ptr()) return;
+
+    unsigned int active = ctx->getActiveServerTexture();
+    unsigned int unit = active;
+    for(int i = 0; i < ctx->getMaxTexUnits(); i++) {
+        TextureData* texData = (TextureData*)thrd->shareGroup->getObjectDataPtr(TEXTURE,ctx->getUnitTexture(i));
+        if(!texData || !texData->mipmapDirty) continue;
+        if(unit != (unsigned int)i) {
+            unit = i;
+            ctx->dispatcher().glActiveTexture(GL_TEXTURE0 + unit);
+        }
+        ctx->dispatcher().glGenerateMipmapEXT(GL_TEXTURE_2D);
+        texData->mipmapDirty = false;
+    }
+    if(unit != active) ctx->dispatcher().glActiveTexture(GL_TEXTURE0 + active);
+}
+
+static bool capChanged(GLEScontext* ctx,GLenum cap,bool enable) {
+    if(cap == GL_TEXTURE_2D) return ctx->updateTexState(cap,enable);
+    if(!GLESvalidate::capability(cap,ctx->getMaxLights(),ctx->getMaxClipPlanes())) return true;
+    return ctx->updateState(cap,enable);
+}
+
 GL_API void GL_APIENTRY  glActiveTexture( GLenum texture) {
     GET_CTX()
     SET_ERROR_IF(!GLESvalidate::textureEnum(texture,ctx->getMaxTexUnits()),GL_INVALID_ENUM);
-    ctx->dispatcher().glActiveTexture(texture);
+    if(ctx->setActiveServerTexture(texture)) ctx->dispatcher().glActiveTexture(texture);
 }
 
 GL_API void GL_APIENTRY  glAlphaFunc( GLenum func, GLclampf ref) {
     GET_CTX()
     SET_ERROR_IF(!GLESvalidate::alphaFunc(func),GL_INVALID_ENUM);
-    ctx->dispatcher().glAlphaFunc(func,ref);
+    GLfloat state[2] = {static_cast<GLfloat>(func),ref};
+    if(ctx->updateState(GL_ALPHA_TEST_FUNC,state,2)) ctx->dispatcher().glAlphaFunc(func,ref);
 }
 
 
 GL_API void GL_APIENTRY  glAlphaFuncx( GLenum func, GLclampx ref) {
     GET_CTX()
     SET_ERROR_IF(!GLESvalidate::alphaFunc(func),GL_INVALID_ENUM);
-    ctx->dispatcher().glAlphaFunc(func,X2F(ref));
+    GLfloat state[2] = {static_cast<GLfloat>(func),X2F(ref)};
+    if(ctx->updateState(GL_ALPHA_TEST_FUNC,state,2)) ctx->dispatcher().glAlphaFunc(func,X2F(ref));
 }
 
 
@@ -224,7 +345,7 @@ GL_API void GL_APIENTRY  glBindBuffer( GLenum target, GLuint buffer) {
         thrd->shareGroup->setObjectData(VERTEXBUFFER,buffer,ObjectDataPtr(new GLESbuffer()));
     }
     ctx->bindBuffer(target,buffer);
-    GLESbuffer* vbo = (GLESbuffer*)thrd->shareGroup->getObjectData(VERTEXBUFFER,buffer).Ptr();
+    GLESbuffer* vbo = (GLESbuffer*)thrd->shareGroup->getObjectDataPtr(VERTEXBUFFER,buffer);
     vbo->wasBinded();
 }
 
@@ -243,13 +364,19 @@ GL_API void GL_APIENTRY  glBindTexture( GLenum target, GLuint texture) {
         }
     }
     ctx->setBindedTexture(globalTextureName);
-    ctx->dispatcher().glBindTexture(target,globalTextureName);
+    if(ctx->updateTexState(GL_TEXTURE_BINDING_2D,globalTextureName)) ctx->dispatcher().glBindTexture(target,globalTextureName);
+
+    if(ctx->hasGenerateMipmap() && thrd->shareGroup.Ptr()) {
+        TextureData* texData = (TextureData*)thrd->shareGroup->getObjectDataPtr(TEXTURE,globalTextureName);
+        if(texData && texData->mipmapDirty) ctx->setMipmapsPending(true);
+    }
 }
 
 GL_API void GL_APIENTRY  glBlendFunc( GLenum sfactor, GLenum dfactor) {
     GET_CTX()
     SET_ERROR_IF(!GLESvalidate::blendSrc(sfactor) || !GLESvalidate::blendDst(dfactor),GL_INVALID_ENUM)
-    ctx->dispatcher().glBlendFunc(sfactor,dfactor);
+    GLfloat state[2] = {static_cast<GLfloat>(sfactor),static_cast<GLfloat>(dfactor)};
+    if(ctx->updateState(GL_BLEND_SRC,state,2)) ctx->dispatcher().glBlendFunc(sfactor,dfactor);
 }
 
 GL_API void GL_APIENTRY  glBufferData( GLenum target, GLsizeiptr size, const GLvoid *data, GLenum usage) {
@@ -326,17 +453,20 @@ GL_API void GL_APIENTRY  glClipPlanex( GLenum plane, const GLfixed *equation) {
 
 GL_API void GL_APIENTRY  glColor4f( GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
     GET_CTX()
-    ctx->dispatcher().glColor4f(red,green,blue,alpha);
+    GLfloat color[4] = {red,green,blue,alpha};
+    if(ctx->updateState(GL_CURRENT_COLOR,color,4)) ctx->dispatcher().glColor4f(red,green,blue,alpha);
 }
 
 GL_API void GL_APIENTRY  glColor4ub( GLubyte red, GLubyte green, GLubyte blue, GLubyte alpha) {
     GET_CTX()
-    ctx->dispatcher().glColor4ub(red,green,blue,alpha);
+    GLfloat color[4] = {red/255.0f,green/255.0f,blue/255.0f,alpha/255.0f};
+    if(ctx->updateState(GL_CURRENT_COLOR,color,4)) ctx->dispatcher().glColor4ub(red,green,blue,alpha);
 }
 
 GL_API void GL_APIENTRY  glColor4x( GLfixed red, GLfixed green, GLfixed blue, GLfixed alpha) {
     GET_CTX()
-    ctx->dispatcher().glColor4f(X2F(red),X2F(green),X2F(blue),X2F(alpha));
+    GLfloat color[4] = {X2F(red),X2F(green),X2F(blue),X2F(alpha)};
+    if(ctx->updateState(GL_CURRENT_COLOR,color,4)) ctx->dispatcher().glColor4f(color[0],color[1],color[2],color[3]);
 }
 
 GL_API void GL_APIENTRY  glColorMask( GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) {
@@ -345,92 +475,129 @@ GL_API void GL_APIENTRY  glColorMask( GLboolean red, GLboolean green, GLboolean
 }
 
 GL_API void GL_APIENTRY  glColorPointer( GLint size, GLenum type, GLsizei stride, const GLvoid *pointer) {
-    GET_CTX()
+    GET_CTX_NO_FLUSH()
     SET_ERROR_IF(!GLESvalidate::colorPointerParams(size,stride),GL_INVALID_VALUE);
 
     const GLvoid* data = ctx->setPointer(GL_COLOR_ARRAY,size,type,stride,pointer);
     if(type != GL_FIXED) ctx->dispatcher().glColorPointer(size,type,stride,data);
 }
 
+//
+// ETC1 images go to the driver as they are when it supports them,
+// otherwise they are decoded to GL_RGB, with rows aligned as the
+// current unpack alignment expects.
+//
+static void compressedTexImageETC1(GLEScontext* ctx,GLenum target,GLint level,GLsizei width,GLsizei height,GLsizei imageSize,const GLvoid* data) {
+    if(ctx->hasNativeETC1()) {
+        ctx->dispatcher().glCompressedTexImage2D(target,level,GL_ETC1_RGB8_OES,width,height,0,imageSize,data);
+        return;
+    }
+
+    int alignment = ctx->getUnpackAlignment();
+    int stride = (width*3 + alignment - 1) / alignment * alignment;
+
+    std::vector<unsigned char>& pixels = ctx->texScratchBuffer();
+    pixels.resize(stride*height + 1);
+    if(data) {
+        etc1DecodeImage(data,width,height,&pixels[0],stride);
+    }
+    ctx->dispatcher().glTexImage2D(target,level,GL_RGB,width,height,0,GL_RGB,GL_UNSIGNED_BYTE,data ? &pixels[0] : NULL);
+}
+
 GL_API void GL_APIENTRY  glCompressedTexImage2D( GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const GLvoid *data) {
     GET_CTX()
     SET_ERROR_IF(!(GLESvalidate::texCompImgFrmt(internalformat) && GLESvalidate::textureTarget(target)),GL_INVALID_ENUM);
+
+    if(internalformat == GL_ETC1_RGB8_OES) {
+        SET_ERROR_IF(level < 0 || level > log2(ctx->getMaxTexSize()) || border != 0 || !GLESvalidate::texImgDim(width,height,ctx->getMaxTexSize()+2),GL_INVALID_VALUE)
+        SET_ERROR_IF(imageSize < 0 || static_cast<unsigned int>(imageSize) != etc1DataSize(width,height),GL_INVALID_VALUE)
+        compressedTexImageETC1(ctx,target,level,width,height,imageSize,data);
+        return;
+    }
+
     SET_ERROR_IF(level > log2(ctx->getMaxTexSize())|| border !=0 || level > 0 || !GLESvalidate::texImgDim(width,height,ctx->getMaxTexSize()+2),GL_INVALID_VALUE)
 
+    //all the mipmap levels are decoded in one pass, the palette is shared
     int nMipmaps = -level + 1;
+    unsigned int levelOffsets[32];
+    GLenum uncompressedFrmt;
+    std::vector<unsigned char>& pixels = ctx->texScratchBuffer();
+    SET_ERROR_IF(!uncompressTexture(internalformat,uncompressedFrmt,width,height,imageSize,data,nMipmaps,pixels,levelOffsets),GL_INVALID_VALUE);
+
     GLsizei tmpWidth  = width;
     GLsizei tmpHeight = height;
-
     for(int i = 0; i < nMipmaps ; i++)
     {
-       GLenum uncompressedFrmt;
-       unsigned char* uncompressed = uncompressTexture(internalformat,uncompressedFrmt,width,height,imageSize,data,i);
-       ctx->dispatcher().glTexImage2D(target,i,uncompressedFrmt,width,height,border,uncompressedFrmt,GL_UNSIGNED_BYTE,uncompressed);
-       tmpWidth/=2;
-       tmpHeight/=2;
-       delete uncompressed;
+       ctx->dispatcher().glTexImage2D(target,i,uncompressedFrmt,tmpWidth,tmpHeight,border,GL_RGBA,GL_UNSIGNED_BYTE,&pixels[levelOffsets[i]]);
+       tmpWidth  = tmpWidth  > 1 ? tmpWidth/2  : 1;
+       tmpHeight = tmpHeight > 1 ? tmpHeight/2 : 1;
     }
-    ctx->dispatcher().glCompressedTexImage2D(target,level,internalformat,width,height,border,imageSize,data);
 }
 
 GL_API void GL_APIENTRY  glCompressedTexSubImage2D( GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, const GLvoid *data) {
     GET_CTX()
     SET_ERROR_IF(!(GLESvalidate::texCompImgFrmt(format) && GLESvalidate::textureTarget(target)),GL_INVALID_ENUM);
     SET_ERROR_IF(level < 0 || level > log2(ctx->getMaxTexSize()),GL_INVALID_VALUE)
+    SET_ERROR_IF(format == GL_ETC1_RGB8_OES,GL_INVALID_OPERATION) //ETC1 images cannot be updated
 
+    unsigned int levelOffsets[32];
     GLenum uncompressedFrmt;
-    unsigned char* uncompressed = uncompressTexture(format,uncompressedFrmt,width,height,imageSize,data,level);
-    ctx->dispatcher().glTexSubImage2D(target,level,xoffset,yoffset,width,height,uncompressedFrmt,GL_UNSIGNED_BYTE,uncompressed);
-    delete uncompressed;
+    std::vector<unsigned char>& pixels = ctx->texScratchBuffer();
+    SET_ERROR_IF(!uncompressTexture(format,uncompressedFrmt,width,height,imageSize,data,level+1,pixels,levelOffsets),GL_INVALID_VALUE);
+    ctx->dispatcher().glTexSubImage2D(target,level,xoffset,yoffset,width,height,GL_RGBA,GL_UNSIGNED_BYTE,&pixels[levelOffsets[level]]);
 }
 
 GL_API void GL_APIENTRY  glCopyTexImage2D( GLenum target, GLint level, GLenum internalformat, GLint x, GLint y, GLsizei width, GLsizei height, GLint border) {
     GET_CTX()
     SET_ERROR_IF(!(GLESvalidate::pixelFrmt(internalformat) && GLESvalidate::textureTarget(target)),GL_INVALID_ENUM);
+    SET_ERROR_IF(internalformat == GL_BGRA_EXT,GL_INVALID_ENUM);
     SET_ERROR_IF(border != 0,GL_INVALID_VALUE);
     ctx->dispatcher().glCopyTexImage2D(target,level,internalformat,x,y,width,height,border);
+    textureLevelChanged(thrd,ctx,level);
 }
 
 GL_API void GL_APIENTRY  glCopyTexSubImage2D( GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint x, GLint y, GLsizei width, GLsizei height) {
     GET_CTX()
     SET_ERROR_IF(!GLESvalidate::textureTarget(target),GL_INVALID_ENUM);
     ctx->dispatcher().glCopyTexSubImage2D(target,level,xoffset,yoffset,x,y,width,height);
+    textureLevelChanged(thrd,ctx,level);
 }
 
 GL_API void GL_APIENTRY  glCullFace( GLenum mode) {
     GET_CTX()
-    ctx->dispatcher().glCullFace(mode);
+    if(ctx->updateState(GL_CULL_FACE_MODE,mode)) ctx->dispatcher().glCullFace(mode);
 }
 
 GL_API void GL_APIENTRY  glDeleteBuffers( GLsizei n, const GLuint *buffers) {
     GET_CTX()
     SET_ERROR_IF(n<0,GL_INVALID_VALUE);
     if(thrd->shareGroup.Ptr()) {
-        for(int i=0; i < n; i++){
-           thrd->shareGroup->deleteName(VERTEXBUFFER,buffers[i]);
-        }
+        thrd->shareGroup->deleteNames(VERTEXBUFFER,n,buffers);
     }
 }
 
 GL_API void GL_APIENTRY  glDeleteTextures( GLsizei n, const GLuint *textures) {
     GET_CTX()
-    if(thrd->shareGroup.Ptr()) {
+    SET_ERROR_IF(n<0,GL_INVALID_VALUE);
+    if(thrd->shareGroup.Ptr() && n > 0) {
+        std::vector<GLuint> globalTextureNames(n);
+        thrd->shareGroup->deleteNames(TEXTURE,n,textures,&globalTextureNames[0]);
         for(int i=0; i < n; i++){
-           thrd->shareGroup->deleteName(TEXTURE,textures[i]);
-           const GLuint globalTextureName = thrd->shareGroup->getGlobalName(TEXTURE,textures[i]);
-           ctx->dispatcher().glDeleteTextures(1,&globalTextureName);
+           ctx->textureDeleted(globalTextureNames[i]);
         }
+        //names which did not exist are 0, ignored by the driver
+        ctx->dispatcher().glDeleteTextures(n,&globalTextureNames[0]);
     }
 }
 
 GL_API void GL_APIENTRY  glDepthFunc( GLenum func) {
     GET_CTX()
-    ctx->dispatcher().glDepthFunc(func);
+    if(ctx->updateState(GL_DEPTH_FUNC,func)) ctx->dispatcher().glDepthFunc(func);
 }
 
 GL_API void GL_APIENTRY  glDepthMask( GLboolean flag) {
     GET_CTX()
-    ctx->dispatcher().glDepthMask(flag);
+    if(ctx->updateState(GL_DEPTH_WRITEMASK,flag)) ctx->dispatcher().glDepthMask(flag);
 }
 
 GL_API void GL_APIENTRY  glDepthRangef( GLclampf zNear, GLclampf zFar) {
@@ -445,7 +612,7 @@ GL_API void GL_APIENTRY  glDepthRangex( GLclampx zNear, GLclampx zFar) {
 
 GL_API void GL_APIENTRY  glDisable( GLenum cap) {
     GET_CTX()
-    ctx->dispatcher().glDisable(cap);
+    if(capChanged(ctx,cap,false)) ctx->dispatcher().glDisable(cap);
 }
 
 GL_API void GL_APIENTRY  glDisableClientState( GLenum array) {
@@ -458,20 +625,71 @@ GL_API void GL_APIENTRY  glDisableClientState( GLenum array) {
 
 
 GL_API void GL_APIENTRY  glDrawArrays( GLenum mode, GLint first, GLsizei count) {
-    GET_CTX()
+    GET_CTX_NO_FLUSH()
     SET_ERROR_IF(count < 0,GL_INVALID_VALUE)
     SET_ERROR_IF(!GLESvalidate::drawMode(mode),GL_INVALID_ENUM)
 
     if(!ctx->isArrEnabled(GL_VERTEX_ARRAY)) return;
 
+    generatePendingMipmaps(thrd,ctx);
+    if(ctx->batchDrawArrays(mode,first,count)) {
+        if(ctx->isArrEnabled(GL_COLOR_ARRAY)) ctx->invalidateState(GL_CURRENT_COLOR);
+        return;
+    }
     GLESFloatArrays tmpArrs;
     ctx->convertArrs(tmpArrs,first,count,0,NULL,true);
+    ctx->useFFProgram(mode,false);
     if(mode != GL_POINTS || !ctx->isArrEnabled(GL_POINT_SIZE_ARRAY_OES)){
         ctx->dispatcher().glDrawArrays(mode,first,count);
     }
     else{
         ctx->drawPointsArrs(tmpArrs,first,count);
     }
+    //the current color is undefined after drawing with a color array
+    if(ctx->isArrEnabled(GL_COLOR_ARRAY)) ctx->invalidateState(GL_CURRENT_COLOR);
+}
+
+//
+// GL_OES_draw_texture. The rectangles are drawn by the translator, see
+// GLEScontext::drawTex, consecutive ones go to the driver as a single draw.
+//
+static void drawTex(GLfloat x,GLfloat y,GLfloat z,GLfloat width,GLfloat height) {
+    GET_CTX_NO_FLUSH()
+    SET_ERROR_IF(width <= 0 || height <= 0,GL_INVALID_VALUE);
+    generatePendingMipmaps(thrd,ctx);
+    ctx->drawTex(x,y,z,width,height);
+}
+
+GL_API void GL_APIENTRY  glDrawTexsOES( GLshort x, GLshort y, GLshort z, GLshort width, GLshort height) {
+    drawTex(x,y,z,width,height);
+}
+
+GL_API void GL_APIENTRY  glDrawTexiOES( GLint x, GLint y, GLint z, GLint width, GLint height) {
+    drawTex(x,y,z,width,height);
+}
+
+GL_API void GL_APIENTRY  glDrawTexxOES( GLfixed x, GLfixed y, GLfixed z, GLfixed width, GLfixed height) {
+    drawTex(X2F(x),X2F(y),X2F(z),X2F(width),X2F(height));
+}
+
+GL_API void GL_APIENTRY  glDrawTexfOES( GLfloat x, GLfloat y, GLfloat z, GLfloat width, GLfloat height) {
+    drawTex(x,y,z,width,height);
+}
+
+GL_API void GL_APIENTRY  glDrawTexsvOES( const GLshort* coords) {
+    drawTex(coords[0],coords[1],coords[2],coords[3],coords[4]);
+}
+
+GL_API void GL_APIENTRY  glDrawTexivOES( const GLint* coords) {
+    drawTex(coords[0],coords[1],coords[2],coords[3],coords[4]);
+}
+
+GL_API void GL_APIENTRY  glDrawTexxvOES( const GLfixed* coords) {
+    drawTex(X2F(coords[0]),X2F(coords[1]),X2F(coords[2]),X2F(coords[3]),X2F(coords[4]));
+}
+
+GL_API void GL_APIENTRY  glDrawTexfvOES( const GLfloat* coords) {
+    drawTex(coords[0],coords[1],coords[2],coords[3],coords[4]);
 }
 
 GL_API void GL_APIENTRY  glDrawElements( GLenum mode, GLsizei count, GLenum type, const GLvoid *elementsIndices) {
@@ -485,18 +703,21 @@ GL_API void GL_APIENTRY  glDrawElements( GLenum mode, GLsizei count, GLenum type
         indices = buf+reinterpret_cast<unsigned int>(elementsIndices);
     }
 
+    generatePendingMipmaps(thrd,ctx);
     ctx->convertArrs(tmpArrs,0,count,type,indices,false);
+    ctx->useFFProgram(mode,false);
     if(mode != GL_POINTS || !ctx->isArrEnabled(GL_POINT_SIZE_ARRAY_OES)){
         ctx->dispatcher().glDrawElements(mode,count,type,indices);
     }
     else{
         ctx->drawPointsElems(tmpArrs,count,type,indices);
     }
+    if(ctx->isArrEnabled(GL_COLOR_ARRAY)) ctx->invalidateState(GL_CURRENT_COLOR);
 }
 
 GL_API void GL_APIENTRY  glEnable( GLenum cap) {
     GET_CTX()
-    ctx->dispatcher().glEnable(cap);
+    if(capChanged(ctx,cap,true)) ctx->dispatcher().glEnable(cap);
 }
 
 GL_API void GL_APIENTRY  glEnableClientState( GLenum array) {
@@ -517,24 +738,29 @@ GL_API void GL_APIENTRY  glFlush( void) {
     ctx->dispatcher().glFlush();
 }
 
+//the fog mode and the two sided lighting are part of the fixed function program key
 GL_API void GL_APIENTRY  glFogf( GLenum pname, GLfloat param) {
     GET_CTX()
+    if(pname == GL_FOG_MODE) ctx->updateState(pname,static_cast<GLuint>(param));
     ctx->dispatcher().glFogf(pname,param);
 }
 
 GL_API void GL_APIENTRY  glFogfv( GLenum pname, const GLfloat *params) {
     GET_CTX()
+    if(pname == GL_FOG_MODE) ctx->updateState(pname,static_cast<GLuint>(params[0]));
     ctx->dispatcher().glFogfv(pname,params);
 }
 
 GL_API void GL_APIENTRY  glFogx( GLenum pname, GLfixed param) {
     GET_CTX()
+    if(pname == GL_FOG_MODE) ctx->updateState(pname,static_cast<GLuint>(param));
     ctx->dispatcher().glFogf(pname,(pname == GL_FOG_MODE)? static_cast<GLfloat>(param):X2F(param));
 }
 
 GL_API void GL_APIENTRY  glFogxv( GLenum pname, const GLfixed *params) {
     GET_CTX()
     if(pname == GL_FOG_MODE) {
+        ctx->updateState(pname,static_cast<GLuint>(params[0]));
         GLfloat tmpParam = static_cast<GLfloat>(params[0]);
         ctx->dispatcher().glFogfv(pname,&tmpParam);
     } else {
@@ -549,7 +775,7 @@ GL_API void GL_APIENTRY  glFogxv( GLenum pname, const GLfixed *params) {
 
 GL_API void GL_APIENTRY  glFrontFace( GLenum mode) {
     GET_CTX()
-    ctx->dispatcher().glFrontFace(mode);
+    if(ctx->updateState(GL_FRONT_FACE,mode)) ctx->dispatcher().glFrontFace(mode);
 }
 
 GL_API void GL_APIENTRY  glFrustumf( GLfloat left, GLfloat right, GLfloat bottom, GLfloat top, GLfloat zNear, GLfloat zFar) {
@@ -566,8 +792,8 @@ GL_API void GL_APIENTRY  glGenBuffers( GLsizei n, GLuint *buffers) {
     GET_CTX()
     SET_ERROR_IF(n<0,GL_INVALID_VALUE);
     if(thrd->shareGroup.Ptr()) {
+        thrd->shareGroup->genNames(VERTEXBUFFER,n,buffers);
         for(int i=0; i<n ;i++) {
-            buffers[i] = thrd->shareGroup->genName(VERTEXBUFFER);
             //generating vbo object related to this buffer name
             thrd->shareGroup->setObjectData(VERTEXBUFFER,buffers[i],ObjectDataPtr(new GLESbuffer()));
         }
@@ -576,13 +802,40 @@ GL_API void GL_APIENTRY  glGenBuffers( GLsizei n, GLuint *buffers) {
 
 GL_API void GL_APIENTRY  glGenTextures( GLsizei n, GLuint *textures) {
     GET_CTX();
+    SET_ERROR_IF(n<0,GL_INVALID_VALUE);
+    if(thrd->shareGroup.Ptr()) {
+        thrd->shareGroup->genNames(TEXTURE,n,textures);
+    }
+}
+
+//
+// Objects named by the guest (qemu.gles.guest_names), see the GLES 2.0
+// translator.
+//
+extern "C" {
+
+GL_API void GL_APIENTRY  glGenBuffersGuest( GLsizei n, const GLuint *buffers) {
+    GET_CTX()
+    SET_ERROR_IF(n<0,GL_INVALID_VALUE);
     if(thrd->shareGroup.Ptr()) {
         for(int i=0; i<n ;i++) {
-            textures[i] = thrd->shareGroup->genName(TEXTURE);
+            if(!buffers[i] || thrd->shareGroup->isObject(VERTEXBUFFER,buffers[i])) continue;
+            thrd->shareGroup->genName(VERTEXBUFFER,buffers[i]);
+            thrd->shareGroup->setObjectData(VERTEXBUFFER,buffers[i],ObjectDataPtr(new GLESbuffer()));
         }
     }
 }
 
+GL_API void GL_APIENTRY  glGenTexturesGuest( GLsizei n, const GLuint *textures) {
+    GET_CTX();
+    SET_ERROR_IF(n<0,GL_INVALID_VALUE);
+    if(thrd->shareGroup.Ptr()) {
+        thrd->shareGroup->createNames(TEXTURE,n,textures);
+    }
+}
+
+}
+
 GL_API void GL_APIENTRY  glGetBooleanv( GLenum pname, GLboolean *params) {
     GET_CTX()
     ctx->dispatcher().glGetBooleanv(pname,params);
@@ -641,6 +894,23 @@ GL_API void GL_APIENTRY  glGetFloatv( GLenum pname, GLfloat *params) {
 
 GL_API void GL_APIENTRY  glGetIntegerv( GLenum pname, GLint *params) {
     GET_CTX()
+    switch(pname) {
+    //GL_BGRA is the layout of the desktop color buffers, it is read back as it is
+    case GL_IMPLEMENTATION_COLOR_READ_FORMAT_OES:
+        *params = GL_BGRA_EXT;
+        return;
+    case GL_IMPLEMENTATION_COLOR_READ_TYPE_OES:
+        *params = GL_UNSIGNED_BYTE;
+        return;
+    //the bindings are given back as local names
+    case GL_FRAMEBUFFER_BINDING_OES:
+    case GL_RENDERBUFFER_BINDING_OES:
+        ctx->dispatcher().glGetIntegerv(pname,params);
+        if(*params && thrd->shareGroup.Ptr()) {
+            *params = thrd->shareGroup->getLocalName(pname == GL_FRAMEBUFFER_BINDING_OES ? FRAMEBUFFER : RENDERBUFFER,*params);
+        }
+        return;
+    }
     ctx->dispatcher().glGetIntegerv(pname,params);
 }
 
@@ -736,16 +1006,38 @@ GL_API void GL_APIENTRY  glGetTexEnvxv( GLenum env, GLenum pname, GLfixed *param
 
 GL_API void GL_APIENTRY  glGetTexParameterfv( GLenum target, GLenum pname, GLfloat *params) {
     GET_CTX()
+    GLint generate;
+    if(getGenerateMipmap(thrd,ctx,pname,&generate)) {
+        params[0] = static_cast<GLfloat>(generate);
+        return;
+    }
+    GLint crop[4];
+    if(getCropRect(thrd,pname,crop)) {
+        for(int i = 0; i < 4; i++) params[i] = static_cast<GLfloat>(crop[i]);
+        return;
+    }
     ctx->dispatcher().glGetTexParameterfv(target,pname,params);
 }
 
 GL_API void GL_APIENTRY  glGetTexParameteriv( GLenum target, GLenum pname, GLint *params) {
     GET_CTX()
+    if(getGenerateMipmap(thrd,ctx,pname,params)) return;
+    if(getCropRect(thrd,pname,params)) return;
     ctx->dispatcher().glGetTexParameteriv(target,pname,params);
 }
 
 GL_API void GL_APIENTRY  glGetTexParameterxv( GLenum target, GLenum pname, GLfixed *params) {
     GET_CTX()
+    GLint generate;
+    if(getGenerateMipmap(thrd,ctx,pname,&generate)) {
+        params[0] = static_cast<GLfixed>(generate);
+        return;
+    }
+    GLint crop[4];
+    if(getCropRect(thrd,pname,crop)) {
+        for(int i = 0; i < 4; i++) params[i] = F2X(crop[i]);
+        return;
+    }
     GLfloat tmpParam;
     ctx->dispatcher().glGetTexParameterfv(target,pname,&tmpParam);
     params[0] = static_cast<GLfixed>(tmpParam);
@@ -759,16 +1051,19 @@ GL_API void GL_APIENTRY  glHint( GLenum target, GLenum mode) {
 
 GL_API void GL_APIENTRY  glLightModelf( GLenum pname, GLfloat param) {
     GET_CTX()
+    if(pname == GL_LIGHT_MODEL_TWO_SIDE) ctx->updateState(pname,param != 0);
     ctx->dispatcher().glLightModelf(pname,param);
 }
 
 GL_API void GL_APIENTRY  glLightModelfv( GLenum pname, const GLfloat *params) {
     GET_CTX()
+    if(pname == GL_LIGHT_MODEL_TWO_SIDE) ctx->updateState(pname,params[0] != 0);
     ctx->dispatcher().glLightModelfv(pname,params);
 }
 
 GL_API void GL_APIENTRY  glLightModelx( GLenum pname, GLfixed param) {
     GET_CTX()
+    if(pname == GL_LIGHT_MODEL_TWO_SIDE) ctx->updateState(pname,param != 0);
     GLfloat tmpParam = static_cast<GLfloat>(param);
     ctx->dispatcher().glLightModelf(pname,tmpParam);
 }
@@ -778,6 +1073,7 @@ GL_API void GL_APIENTRY  glLightModelxv( GLenum pname, const GLfixed *params) {
     GLfloat tmpParams[4];
     if(pname == GL_LIGHT_MODEL_TWO_SIDE) {
         tmpParams[0] = X2F(params[0]);
+        ctx->updateState(pname,params[0] != 0);
     } else if (pname == GL_LIGHT_MODEL_AMBIENT) {
         for(int i=0;i<4;i++) {
             tmpParams[i] = X2F(params[i]);
@@ -886,7 +1182,7 @@ GL_API void GL_APIENTRY  glMaterialxv( GLenum face, GLenum pname, const GLfixed
 
 GL_API void GL_APIENTRY  glMatrixMode( GLenum mode) {
     GET_CTX()
-    ctx->dispatcher().glMatrixMode(mode);
+    if(ctx->updateState(GL_MATRIX_MODE,mode)) ctx->dispatcher().glMatrixMode(mode);
 }
 
 GL_API void GL_APIENTRY  glMultMatrixf( const GLfloat *m) {
@@ -926,7 +1222,7 @@ GL_API void GL_APIENTRY  glNormal3x( GLfixed nx, GLfixed ny, GLfixed nz) {
 }
 
 GL_API void GL_APIENTRY  glNormalPointer( GLenum type, GLsizei stride, const GLvoid *pointer) {
-    GET_CTX()
+    GET_CTX_NO_FLUSH()
     SET_ERROR_IF(stride < 0,GL_INVALID_VALUE);
     const GLvoid* data = ctx->setPointer(GL_NORMAL_ARRAY,3,type,stride,pointer);//3 normal verctor
     if(type != GL_FIXED) ctx->dispatcher().glNormalPointer(type,stride,data);
@@ -944,6 +1240,10 @@ GL_API void GL_APIENTRY  glOrthox( GLfixed left, GLfixed right, GLfixed bottom,
 
 GL_API void GL_APIENTRY  glPixelStorei( GLenum pname, GLint param) {
     GET_CTX()
+    if(pname == GL_UNPACK_ALIGNMENT) {
+        SET_ERROR_IF(!(param == 1 || param == 2 || param == 4 || param == 8),GL_INVALID_VALUE);
+        ctx->setUnpackAlignment(param);
+    }
     ctx->dispatcher().glPixelStorei(pname,param);
 }
 
@@ -952,8 +1252,10 @@ GL_API void GL_APIENTRY  glPointParameterf( GLenum pname, GLfloat param) {
     ctx->dispatcher().glPointParameterf(pname,param);
 }
 
+//the distance attenuation sends the points to the driver fixed function pipeline, see useFFProgram
 GL_API void GL_APIENTRY  glPointParameterfv( GLenum pname, const GLfloat *params) {
     GET_CTX()
+    if(pname == GL_POINT_DISTANCE_ATTENUATION) ctx->updateState(pname,params,3);
     ctx->dispatcher().glPointParameterfv(pname,params);
 }
 
@@ -966,12 +1268,12 @@ GL_API void GL_APIENTRY  glPointParameterx( GLenum pname, GLfixed param)
 GL_API void GL_APIENTRY  glPointParameterxv( GLenum pname, const GLfixed *params) {
     GET_CTX()
     GLfloat tmpParams[3];
-    int i = 0;
+    int count = pname == GL_POINT_DISTANCE_ATTENUATION ? 3 : 1;
 
-    do {
+    for(int i = 0; i < count; i++) {
         tmpParams[i] = X2F(params[i]);
-        i++;
-    }while(pname != GL_POINT_DISTANCE_ATTENUATION);
+    }
+    if(pname == GL_POINT_DISTANCE_ATTENUATION) ctx->updateState(pname,tmpParams,3);
     ctx->dispatcher().glPointParameterfv(pname,tmpParams);
 }
 
@@ -1056,7 +1358,7 @@ GL_API void GL_APIENTRY  glScissor( GLint x, GLint y, GLsizei width, GLsizei hei
 
 GL_API void GL_APIENTRY  glShadeModel( GLenum mode) {
     GET_CTX()
-    ctx->dispatcher().glShadeModel(mode);
+    if(ctx->updateState(GL_SHADE_MODEL,mode)) ctx->dispatcher().glShadeModel(mode);
 }
 
 GL_API void GL_APIENTRY  glStencilFunc( GLenum func, GLint ref, GLuint mask) {
@@ -1075,7 +1377,7 @@ GL_API void GL_APIENTRY  glStencilOp( GLenum fail, GLenum zfail, GLenum zpass) {
 }
 
 GL_API void GL_APIENTRY  glTexCoordPointer( GLint size, GLenum type, GLsizei stride, const GLvoid *pointer) {
-    GET_CTX()
+    GET_CTX_NO_FLUSH()
     SET_ERROR_IF(!GLESvalidate::texCoordPointerParams(size,stride),GL_INVALID_VALUE);
 
     const GLvoid* data = ctx->setPointer(GL_TEXTURE_COORD_ARRAY,size,type,stride,pointer);
@@ -1085,24 +1387,31 @@ GL_API void GL_APIENTRY  glTexCoordPointer( GLint size, GLenum type, GLsizei str
 GL_API void GL_APIENTRY  glTexEnvf( GLenum target, GLenum pname, GLfloat param) {
     GET_CTX()
     SET_ERROR_IF(!GLESvalidate::texEnv(target,pname),GL_INVALID_ENUM);
-    ctx->dispatcher().glTexEnvf(target,pname,param);
+    if(ctx->updateTexState(pname,&param,1)) ctx->dispatcher().glTexEnvf(target,pname,param);
 }
 
 GL_API void GL_APIENTRY  glTexEnvfv( GLenum target, GLenum pname, const GLfloat *params) {
     GET_CTX()
     SET_ERROR_IF(!GLESvalidate::texEnv(target,pname),GL_INVALID_ENUM);
-    ctx->dispatcher().glTexEnvfv(target,pname,params);
+    if(ctx->updateTexState(pname,params,pname == GL_TEXTURE_ENV_COLOR ? 4:1)) ctx->dispatcher().glTexEnvfv(target,pname,params);
 }
 
 GL_API void GL_APIENTRY  glTexEnvi( GLenum target, GLenum pname, GLint param) {
     GET_CTX()
     SET_ERROR_IF(!GLESvalidate::texEnv(target,pname),GL_INVALID_ENUM);
-    ctx->dispatcher().glTexEnvi(target,pname,param);
+    GLfloat state = static_cast<GLfloat>(param);
+    if(ctx->updateTexState(pname,&state,1)) ctx->dispatcher().glTexEnvi(target,pname,param);
 }
 
 GL_API void GL_APIENTRY  glTexEnviv( GLenum target, GLenum pname, const GLint *params) {
     GET_CTX()
     SET_ERROR_IF(!GLESvalidate::texEnv(target,pname),GL_INVALID_ENUM);
+    if(pname == GL_TEXTURE_ENV_COLOR) {
+        ctx->invalidateTexState(pname); //integer colors are scaled by the driver
+    } else {
+        GLfloat state = static_cast<GLfloat>(params[0]);
+        if(!ctx->updateTexState(pname,&state,1)) return;
+    }
     ctx->dispatcher().glTexEnviv(target,pname,params);
 }
 
@@ -1110,7 +1419,7 @@ GL_API void GL_APIENTRY  glTexEnvx( GLenum target, GLenum pname, GLfixed param)
     GET_CTX()
     SET_ERROR_IF(!GLESvalidate::texEnv(target,pname),GL_INVALID_ENUM);
     GLfloat tmpParam = static_cast<GLfloat>(param);
-    ctx->dispatcher().glTexEnvf(target,pname,tmpParam);
+    if(ctx->updateTexState(pname,&tmpParam,1)) ctx->dispatcher().glTexEnvf(target,pname,tmpParam);
 }
 
 GL_API void GL_APIENTRY  glTexEnvxv( GLenum target, GLenum pname, const GLfixed *params) {
@@ -1125,19 +1434,19 @@ GL_API void GL_APIENTRY  glTexEnvxv( GLenum target, GLenum pname, const GLfixed
     } else {
         tmpParams[0] = static_cast<GLfloat>(params[0]);
     }
-    ctx->dispatcher().glTexEnvfv(target,pname,tmpParams);
+    if(ctx->updateTexState(pname,tmpParams,pname == GL_TEXTURE_ENV_COLOR ? 4:1)) ctx->dispatcher().glTexEnvfv(target,pname,tmpParams);
 }
 
 static TextureData* getTextureData(){
     GET_CTX_RET(NULL);
     unsigned int tex = ctx->getBindedTexture();
     TextureData *texData = NULL;
-    ObjectDataPtr objData = thrd->shareGroup->getObjectData(TEXTURE,tex);
-    if(!objData.Ptr()){
+    ObjectData* objData = thrd->shareGroup->getObjectDataPtr(TEXTURE,tex);
+    if(!objData){
         texData = new TextureData();
         thrd->shareGroup->setObjectData(TEXTURE, tex, ObjectDataPtr(texData));
     } else {
-        texData = (TextureData*)objData.Ptr();
+        texData = (TextureData*)objData;
     }
     return texData;
 }
@@ -1163,43 +1472,78 @@ GL_API void GL_APIENTRY  glTexImage2D( GLenum target, GLint level, GLint interna
             texData->internalFormat = internalformat;
         }
     }
-    ctx->dispatcher().glTexImage2D(target,level,internalformat,width,height,border,format,type,pixels);
+
+    if(isPackedTexelType(type) && !ctx->hasNativePackedTexels()) {
+        //the storage is RGBA8 either way, sub images are converted as well
+        const GLvoid* data = NULL;
+        if(pixels) {
+            std::vector<unsigned char>& rgba = ctx->texScratchBuffer();
+            rgba.resize(packedTexelsSize(width,height,ctx->getUnpackAlignment()) + 1);
+            convertPackedTexels(type,width,height,ctx->getUnpackAlignment(),pixels,&rgba[0]);
+            data = &rgba[0];
+        }
+        ctx->dispatcher().glTexImage2D(target,level,internalformat,width,height,border,GL_RGBA,GL_UNSIGNED_BYTE,data);
+    } else {
+        //GL_BGRA_EXT is only a desktop pixel format, the storage is RGBA8
+        GLint dtInternalFormat = internalformat == GL_BGRA_EXT ? GL_RGBA : internalformat;
+        ctx->dispatcher().glTexImage2D(target,level,dtInternalFormat,width,height,border,format,type,pixels);
+    }
+    textureLevelChanged(thrd,ctx,level);
 }
 
 GL_API void GL_APIENTRY  glTexParameterf( GLenum target, GLenum pname, GLfloat param) {
     GET_CTX()
-    SET_ERROR_IF(!GLESvalidate::texParams(target,pname),GL_INVALID_ENUM);
+    SET_ERROR_IF(!GLESvalidate::texParams(target,pname) || pname == GL_TEXTURE_CROP_RECT_OES,GL_INVALID_ENUM);
+    if(setGenerateMipmap(thrd,ctx,pname,param)) return;
     ctx->dispatcher().glTexParameterf(target,pname,param);
 }
 
 GL_API void GL_APIENTRY  glTexParameterfv( GLenum target, GLenum pname, const GLfloat *params) {
     GET_CTX()
     SET_ERROR_IF(!GLESvalidate::texParams(target,pname),GL_INVALID_ENUM);
+    if(pname == GL_TEXTURE_CROP_RECT_OES) {
+        GLint crop[4];
+        for(int i = 0; i < 4; i++) crop[i] = static_cast<GLint>(params[i]);
+        setCropRect(thrd,pname,crop);
+        return;
+    }
+    if(setGenerateMipmap(thrd,ctx,pname,params[0])) return;
     ctx->dispatcher().glTexParameterfv(target,pname,params);
 }
 
 GL_API void GL_APIENTRY  glTexParameteri( GLenum target, GLenum pname, GLint param) {
     GET_CTX()
-    SET_ERROR_IF(!GLESvalidate::texParams(target,pname),GL_INVALID_ENUM);
+    SET_ERROR_IF(!GLESvalidate::texParams(target,pname) || pname == GL_TEXTURE_CROP_RECT_OES,GL_INVALID_ENUM);
+    if(setGenerateMipmap(thrd,ctx,pname,param)) return;
     ctx->dispatcher().glTexParameteri(target,pname,param);
 }
 
 GL_API void GL_APIENTRY  glTexParameteriv( GLenum target, GLenum pname, const GLint *params) {
     GET_CTX()
     SET_ERROR_IF(!GLESvalidate::texParams(target,pname),GL_INVALID_ENUM);
+    if(setCropRect(thrd,pname,params)) return;
+    if(setGenerateMipmap(thrd,ctx,pname,params[0])) return;
     ctx->dispatcher().glTexParameteriv(target,pname,params);
 }
 
 GL_API void GL_APIENTRY  glTexParameterx( GLenum target, GLenum pname, GLfixed param) {
     GET_CTX()
-    SET_ERROR_IF(!GLESvalidate::texParams(target,pname),GL_INVALID_ENUM);
+    SET_ERROR_IF(!GLESvalidate::texParams(target,pname) || pname == GL_TEXTURE_CROP_RECT_OES,GL_INVALID_ENUM);
+    if(setGenerateMipmap(thrd,ctx,pname,static_cast<GLfloat>(param))) return;
     ctx->dispatcher().glTexParameterf(target,pname,static_cast<GLfloat>(param));
 }
 
 GL_API void GL_APIENTRY  glTexParameterxv( GLenum target, GLenum pname, const GLfixed *params) {
     GET_CTX()
     SET_ERROR_IF(!GLESvalidate::texParams(target,pname),GL_INVALID_ENUM);
+    if(pname == GL_TEXTURE_CROP_RECT_OES) {
+        GLint crop[4];
+        for(int i = 0; i < 4; i++) crop[i] = X2I(params[i]);
+        setCropRect(thrd,pname,crop);
+        return;
+    }
     GLfloat param = static_cast<GLfloat>(params[0]);
+    if(setGenerateMipmap(thrd,ctx,pname,param)) return;
     ctx->dispatcher().glTexParameterfv(target,pname,&param);
 }
 
@@ -1210,7 +1554,15 @@ GL_API void GL_APIENTRY  glTexSubImage2D( GLenum target, GLint level, GLint xoff
                    GLESvalidate::pixelType(type)),GL_INVALID_ENUM);
     SET_ERROR_IF(!GLESvalidate::pixelOp(format,type),GL_INVALID_OPERATION);
 
-    ctx->dispatcher().glTexSubImage2D(target,level,xoffset,yoffset,width,height,format,type,pixels);
+    if(isPackedTexelType(type) && !ctx->hasNativePackedTexels() && pixels) {
+        std::vector<unsigned char>& rgba = ctx->texScratchBuffer();
+        rgba.resize(packedTexelsSize(width,height,ctx->getUnpackAlignment()) + 1);
+        convertPackedTexels(type,width,height,ctx->getUnpackAlignment(),pixels,&rgba[0]);
+        ctx->dispatcher().glTexSubImage2D(target,level,xoffset,yoffset,width,height,GL_RGBA,GL_UNSIGNED_BYTE,&rgba[0]);
+    } else {
+        ctx->dispatcher().glTexSubImage2D(target,level,xoffset,yoffset,width,height,format,type,pixels);
+    }
+    textureLevelChanged(thrd,ctx,level);
 }
 
 GL_API void GL_APIENTRY  glTranslatef( GLfloat x, GLfloat y, GLfloat z) {
@@ -1224,7 +1576,7 @@ GL_API void GL_APIENTRY  glTranslatex( GLfixed x, GLfixed y, GLfixed z) {
 }
 
 GL_API void GL_APIENTRY  glVertexPointer( GLint size, GLenum type, GLsizei stride, const GLvoid *pointer) {
-    GET_CTX()
+    GET_CTX_NO_FLUSH()
     SET_ERROR_IF(!GLESvalidate::vertexPointerParams(size,stride),GL_INVALID_VALUE);
 
     const GLvoid* data = ctx->setPointer(GL_VERTEX_ARRAY,size,type,stride,pointer);
@@ -1236,7 +1588,7 @@ GL_API void GL_APIENTRY  glViewport( GLint x, GLint y, GLsizei width, GLsizei he
     ctx->dispatcher().glViewport(x,y,width,height);
 }
 
-void glEGLImageTargetTexture2DOES(GLenum target, GLeglImageOES image)
+GL_API void GL_APIENTRY glEGLImageTargetTexture2DOES(GLenum target, GLeglImageOES image)
 {
     GET_CTX();
     SET_ERROR_IF(!GLESvalidate::textureTarget(target),GL_INVALID_ENUM);
@@ -1255,9 +1607,207 @@ void glEGLImageTargetTexture2DOES(GLenum target, GLeglImageOES image)
             // replace mapping and bind the new global object
             thrd->shareGroup->replaceGlobalName(TEXTURE, tex,img->globalTexName);
             ctx->dispatcher().glBindTexture(GL_TEXTURE_2D, img->globalTexName);
+            ctx->updateTexState(GL_TEXTURE_BINDING_2D,img->globalTexName);
             TextureData *texData = getTextureData();
             texData->sourceEGLImage = (unsigned int)image;
             texData->eglImageDetach = s_eglIface->eglDetachEGLImage;
         }
     }
 }
+
+GL_API void GL_APIENTRY glEGLImageTargetRenderbufferStorageOES(GLenum target, GLeglImageOES image)
+{
+    GET_CTX();
+    SET_ERROR_IF(!ctx->hasFramebufferObject(),GL_INVALID_OPERATION);
+    SET_ERROR_IF(target != GL_RENDERBUFFER_OES,GL_INVALID_ENUM);
+    SET_ERROR_IF(!thrd->shareGroup.Ptr(),GL_INVALID_OPERATION);
+    GLint rb = 0;
+    glGetIntegerv(GL_RENDERBUFFER_BINDING_OES,&rb);
+    SET_ERROR_IF(!rb,GL_INVALID_OPERATION);
+    EglImage *img = s_eglIface->eglAttachEGLImage((unsigned int)image);
+    SET_ERROR_IF(!img,GL_INVALID_VALUE);
+
+    // The storage is the texture of the image, see RenderbufferData
+    RenderbufferData *rbData = new RenderbufferData();
+    rbData->sourceEGLImage = (unsigned int)image;
+    rbData->eglImageGlobalTexName = img->globalTexName;
+    rbData->eglImageDetach = s_eglIface->eglDetachEGLImage;
+    thrd->shareGroup->setObjectData(RENDERBUFFER,rb,ObjectDataPtr(rbData));
+}
+
+//
+// GL_OES_framebuffer_object, on top of the driver's GL_EXT_framebuffer_object
+// which has the same enums. The names are local to the share group as the
+// texture and buffer ones are.
+//
+static GLuint fboGlobalName(ThreadInfo* thrd,NamedObjectType type,GLuint name) {
+    if(!name || !thrd->shareGroup.Ptr()) return name;
+    return thrd->shareGroup->getGlobalName(type,name);
+}
+
+//binding a name which was never generated creates the object
+static GLuint fboBindGlobalName(ThreadInfo* thrd,NamedObjectType type,GLuint name) {
+    if(!name || !thrd->shareGroup.Ptr()) return name;
+    GLuint globalName = thrd->shareGroup->getGlobalName(type,name);
+    if(!globalName) {
+        thrd->shareGroup->genName(type,name);
+        globalName = thrd->shareGroup->getGlobalName(type,name);
+    }
+    return globalName;
+}
+
+extern "C" {
+
+GL_API GLboolean GL_APIENTRY glIsRenderbufferOES(GLuint renderbuffer) {
+    GET_CTX_RET(GL_FALSE)
+    RET_AND_SET_ERROR_IF(!ctx->hasFramebufferObject(),GL_INVALID_OPERATION,GL_FALSE);
+    GLuint globalName = fboGlobalName(thrd,RENDERBUFFER,renderbuffer);
+    return globalName ? ctx->dispatcher().glIsRenderbufferEXT(globalName) : GL_FALSE;
+}
+
+GL_API void GL_APIENTRY glBindRenderbufferOES(GLenum target, GLuint renderbuffer) {
+    GET_CTX()
+    SET_ERROR_IF(!ctx->hasFramebufferObject(),GL_INVALID_OPERATION);
+    SET_ERROR_IF(target != GL_RENDERBUFFER_OES,GL_INVALID_ENUM);
+    ctx->dispatcher().glBindRenderbufferEXT(target,fboBindGlobalName(thrd,RENDERBUFFER,renderbuffer));
+}
+
+GL_API void GL_APIENTRY glDeleteRenderbuffersOES(GLsizei n, const GLuint* renderbuffers) {
+    GET_CTX()
+    SET_ERROR_IF(!ctx->hasFramebufferObject(),GL_INVALID_OPERATION);
+    SET_ERROR_IF(n<0,GL_INVALID_VALUE);
+    if(!thrd->shareGroup.Ptr() || !n) return;
+    std::vector<GLuint> globalNames(n);
+    thrd->shareGroup->deleteNames(RENDERBUFFER,n,renderbuffers,&globalNames[0]);
+    ctx->dispatcher().glDeleteRenderbuffersEXT(n,&globalNames[0]);
+}
+
+GL_API void GL_APIENTRY glGenRenderbuffersOES(GLsizei n, GLuint* renderbuffers) {
+    GET_CTX()
+    SET_ERROR_IF(!ctx->hasFramebufferObject(),GL_INVALID_OPERATION);
+    SET_ERROR_IF(n<0,GL_INVALID_VALUE);
+    if(thrd->shareGroup.Ptr()) {
+        thrd->shareGroup->genNames(RENDERBUFFER,n,renderbuffers);
+    }
+}
+
+GL_API void GL_APIENTRY glRenderbufferStorageOES(GLenum target, GLenum internalformat, GLsizei width, GLsizei height) {
+    GET_CTX()
+    SET_ERROR_IF(!ctx->hasFramebufferObject(),GL_INVALID_OPERATION);
+    SET_ERROR_IF(target != GL_RENDERBUFFER_OES,GL_INVALID_ENUM);
+    //GL_RGB565 is not a desktop renderbuffer format before OpenGL 4.1
+    if(internalformat == GL_RGB565_OES) internalformat = GL_RGB;
+    //the renderbuffer no longer takes its storage from an EGLImage
+    GLint rb = 0;
+    glGetIntegerv(GL_RENDERBUFFER_BINDING_OES,&rb);
+    if(rb && thrd->shareGroup.Ptr() && thrd->shareGroup->getObjectDataPtr(RENDERBUFFER,rb)) {
+        thrd->shareGroup->setObjectData(RENDERBUFFER,rb,ObjectDataPtr(NULL));
+    }
+    ctx->dispatcher().glRenderbufferStorageEXT(target,internalformat,width,height);
+}
+
+GL_API void GL_APIENTRY glGetRenderbufferParameterivOES(GLenum target, GLenum pname, GLint* params) {
+    GET_CTX()
+    SET_ERROR_IF(!ctx->hasFramebufferObject(),GL_INVALID_OPERATION);
+    ctx->dispatcher().glGetRenderbufferParameterivEXT(target,pname,params);
+}
+
+GL_API GLboolean GL_APIENTRY glIsFramebufferOES(GLuint framebuffer) {
+    GET_CTX_RET(GL_FALSE)
+    RET_AND_SET_ERROR_IF(!ctx->hasFramebufferObject(),GL_INVALID_OPERATION,GL_FALSE);
+    GLuint globalName = fboGlobalName(thrd,FRAMEBUFFER,framebuffer);
+    return globalName ? ctx->dispatcher().glIsFramebufferEXT(globalName) : GL_FALSE;
+}
+
+GL_API void GL_APIENTRY glBindFramebufferOES(GLenum target, GLuint framebuffer) {
+    GET_CTX()
+    SET_ERROR_IF(!ctx->hasFramebufferObject(),GL_INVALID_OPERATION);
+    SET_ERROR_IF(target != GL_FRAMEBUFFER_OES,GL_INVALID_ENUM);
+    ctx->dispatcher().glBindFramebufferEXT(target,fboBindGlobalName(thrd,FRAMEBUFFER,framebuffer));
+}
+
+GL_API void GL_APIENTRY glDeleteFramebuffersOES(GLsizei n, const GLuint* framebuffers) {
+    GET_CTX()
+    SET_ERROR_IF(!ctx->hasFramebufferObject(),GL_INVALID_OPERATION);
+    SET_ERROR_IF(n<0,GL_INVALID_VALUE);
+    if(!thrd->shareGroup.Ptr() || !n) return;
+    std::vector<GLuint> globalNames(n);
+    thrd->shareGroup->deleteNames(FRAMEBUFFER,n,framebuffers,&globalNames[0]);
+    ctx->dispatcher().glDeleteFramebuffersEXT(n,&globalNames[0]);
+}
+
+GL_API void GL_APIENTRY glGenFramebuffersOES(GLsizei n, GLuint* framebuffers) {
+    GET_CTX()
+    SET_ERROR_IF(!ctx->hasFramebufferObject(),GL_INVALID_OPERATION);
+    SET_ERROR_IF(n<0,GL_INVALID_VALUE);
+    if(thrd->shareGroup.Ptr()) {
+        thrd->shareGroup->genNames(FRAMEBUFFER,n,framebuffers);
+    }
+}
+
+//the names picked by the guest (qemu.gles.guest_names), see glGenBuffersGuest
+GL_API void GL_APIENTRY glGenFramebuffersOESGuest(GLsizei n, const GLuint* framebuffers) {
+    GET_CTX()
+    SET_ERROR_IF(!ctx->hasFramebufferObject(),GL_INVALID_OPERATION);
+    SET_ERROR_IF(n<0,GL_INVALID_VALUE);
+    if(thrd->shareGroup.Ptr()) {
+        thrd->shareGroup->createNames(FRAMEBUFFER,n,framebuffers);
+    }
+}
+
+GL_API void GL_APIENTRY glGenRenderbuffersOESGuest(GLsizei n, const GLuint* renderbuffers) {
+    GET_CTX()
+    SET_ERROR_IF(!ctx->hasFramebufferObject(),GL_INVALID_OPERATION);
+    SET_ERROR_IF(n<0,GL_INVALID_VALUE);
+    if(thrd->shareGroup.Ptr()) {
+        thrd->shareGroup->createNames(RENDERBUFFER,n,renderbuffers);
+    }
+}
+
+GL_API GLenum GL_APIENTRY glCheckFramebufferStatusOES(GLenum target) {
+    GET_CTX_RET(0)
+    RET_AND_SET_ERROR_IF(!ctx->hasFramebufferObject(),GL_INVALID_OPERATION,0);
+    RET_AND_SET_ERROR_IF(target != GL_FRAMEBUFFER_OES,GL_INVALID_ENUM,0);
+    return ctx->dispatcher().glCheckFramebufferStatusEXT(target);
+}
+
+GL_API void GL_APIENTRY glFramebufferTexture2DOES(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level) {
+    GET_CTX()
+    SET_ERROR_IF(!ctx->hasFramebufferObject(),GL_INVALID_OPERATION);
+    SET_ERROR_IF(target != GL_FRAMEBUFFER_OES || !GLESvalidate::textureTarget(textarget),GL_INVALID_ENUM);
+    ctx->dispatcher().glFramebufferTexture2DEXT(target,attachment,textarget,fboGlobalName(thrd,TEXTURE,texture),level);
+}
+
+GL_API void GL_APIENTRY glFramebufferRenderbufferOES(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer) {
+    GET_CTX()
+    SET_ERROR_IF(!ctx->hasFramebufferObject(),GL_INVALID_OPERATION);
+    SET_ERROR_IF(target != GL_FRAMEBUFFER_OES || renderbuffertarget != GL_RENDERBUFFER_OES,GL_INVALID_ENUM);
+    //the storage of an EGLImage renderbuffer is the texture of the image
+    RenderbufferData* rbData = renderbuffer && thrd->shareGroup.Ptr() ?
+        (RenderbufferData*)thrd->shareGroup->getObjectDataPtr(RENDERBUFFER,renderbuffer) : NULL;
+    if(rbData && rbData->eglImageGlobalTexName) {
+        ctx->dispatcher().glFramebufferTexture2DEXT(target,attachment,GL_TEXTURE_2D,rbData->eglImageGlobalTexName,0);
+        return;
+    }
+    ctx->dispatcher().glFramebufferRenderbufferEXT(target,attachment,renderbuffertarget,fboGlobalName(thrd,RENDERBUFFER,renderbuffer));
+}
+
+GL_API void GL_APIENTRY glGetFramebufferAttachmentParameterivOES(GLenum target, GLenum attachment, GLenum pname, GLint* params) {
+    GET_CTX()
+    SET_ERROR_IF(!ctx->hasFramebufferObject(),GL_INVALID_OPERATION);
+    ctx->dispatcher().glGetFramebufferAttachmentParameterivEXT(target,attachment,pname,params);
+    if(pname == GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME_OES && *params && thrd->shareGroup.Ptr()) {
+        GLint type = GL_NONE_OES;
+        ctx->dispatcher().glGetFramebufferAttachmentParameterivEXT(target,attachment,GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE_OES,&type);
+        *params = thrd->shareGroup->getLocalName(type == GL_TEXTURE ? TEXTURE : RENDERBUFFER,*params);
+    }
+}
+
+GL_API void GL_APIENTRY glGenerateMipmapOES(GLenum target) {
+    GET_CTX()
+    SET_ERROR_IF(!ctx->hasFramebufferObject(),GL_INVALID_OPERATION);
+    SET_ERROR_IF(!GLESvalidate::textureTarget(target),GL_INVALID_ENUM);
+    ctx->dispatcher().glGenerateMipmapEXT(target);
+}
+
+}
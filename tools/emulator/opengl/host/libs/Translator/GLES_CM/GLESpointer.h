@@ -32,6 +32,7 @@ public:
     unsigned int  getBufferOffset() const;
     void          getBufferConversions(const RangeList& rl,RangeList& rlOut);
     bool          bufferNeedConversion(){ return !m_buffer->fullyConverted();}
+    bool          hasBuffer() const { return m_buffer != NULL;}
     void          setArray (GLint size,GLenum type,GLsizei stride,const GLvoid* data);
     void          setBuffer(GLint size,GLenum type,GLsizei stride,GLESbuffer* buf,int offset);
     bool          isEnable() const;
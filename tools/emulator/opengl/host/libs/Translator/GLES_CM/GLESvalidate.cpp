@@ -14,8 +14,72 @@
 * limitations under the License.
 */
 #include "GLESvalidate.h"
+#include <GLES/glext.h>
 #include <GLcommon/GLutils.h>
 
+#ifdef GLES_TRUSTED_GUEST
+#define TRUSTED_GUEST true
+#else
+#define TRUSTED_GUEST false
+#endif
+
+unsigned short GLESvalidate::s_enumCategories[GLES_ENUM_TABLE_SIZE];
+
+struct EnumCategory {
+    unsigned short category;
+    GLenum         members[32];   //ends with 0xffffffff, GL_ZERO is a member of some
+};
+
+#define END_OF_CATEGORY 0xffffffff
+
+static const EnumCategory s_categories[] = {
+    {GLES_ENUM_ALPHA_FUNC,{GL_NEVER,GL_LESS,GL_EQUAL,GL_LEQUAL,GL_GREATER,GL_NOTEQUAL,GL_GEQUAL,GL_ALWAYS,
+                           END_OF_CATEGORY}},
+    {GLES_ENUM_BLEND_SRC,{GL_ZERO,GL_ONE,GL_DST_COLOR,GL_ONE_MINUS_DST_COLOR,GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA,
+                          GL_DST_ALPHA,GL_ONE_MINUS_DST_ALPHA,END_OF_CATEGORY}},
+    {GLES_ENUM_BLEND_DST,{GL_ZERO,GL_ONE,GL_SRC_COLOR,GL_ONE_MINUS_SRC_COLOR,GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA,
+                          GL_DST_ALPHA,GL_ONE_MINUS_DST_ALPHA,END_OF_CATEGORY}},
+    {GLES_ENUM_ARRAY,{GL_COLOR_ARRAY,GL_NORMAL_ARRAY,GL_POINT_SIZE_ARRAY_OES,GL_TEXTURE_COORD_ARRAY,GL_VERTEX_ARRAY,
+                      END_OF_CATEGORY}},
+    {GLES_ENUM_DRAW_MODE,{GL_POINTS,GL_LINE_STRIP,GL_LINE_LOOP,GL_LINES,GL_TRIANGLE_STRIP,GL_TRIANGLE_FAN,GL_TRIANGLES,
+                          END_OF_CATEGORY}},
+    {GLES_ENUM_HINT_TARGET,{GL_FOG_HINT,GL_GENERATE_MIPMAP_HINT,GL_LINE_SMOOTH_HINT,GL_PERSPECTIVE_CORRECTION_HINT,
+                            GL_POINT_SMOOTH_HINT,END_OF_CATEGORY}},
+    {GLES_ENUM_HINT_MODE,{GL_FASTEST,GL_NICEST,GL_DONT_CARE,END_OF_CATEGORY}},
+    {GLES_ENUM_TEX_PARAM,{GL_TEXTURE_MIN_FILTER,GL_TEXTURE_MAG_FILTER,GL_TEXTURE_WRAP_S,GL_TEXTURE_WRAP_T,
+                          GL_GENERATE_MIPMAP,GL_TEXTURE_CROP_RECT_OES,END_OF_CATEGORY}},
+    {GLES_ENUM_TEX_ENV,{GL_TEXTURE_ENV_MODE,GL_COMBINE_RGB,GL_COMBINE_ALPHA,GL_SRC0_RGB,GL_SRC1_RGB,GL_SRC2_RGB,
+                        GL_SRC0_ALPHA,GL_SRC1_ALPHA,GL_SRC2_ALPHA,GL_OPERAND0_RGB,GL_OPERAND1_RGB,GL_OPERAND2_RGB,
+                        GL_OPERAND0_ALPHA,GL_OPERAND1_ALPHA,GL_OPERAND2_ALPHA,GL_RGB_SCALE,GL_ALPHA_SCALE,
+                        GL_COORD_REPLACE_OES,END_OF_CATEGORY}},
+    //the lights and clip planes depend on the driver, they are checked apart
+    {GLES_ENUM_CAPABILITY,{GL_ALPHA_TEST,GL_BLEND,GL_COLOR_ARRAY,GL_COLOR_LOGIC_OP,GL_COLOR_MATERIAL,GL_CULL_FACE,
+                           GL_DEPTH_TEST,GL_DITHER,GL_FOG,GL_LIGHTING,GL_LINE_SMOOTH,GL_MULTISAMPLE,GL_NORMAL_ARRAY,
+                           GL_NORMALIZE,GL_POINT_SIZE_ARRAY_OES,GL_POINT_SMOOTH,GL_POINT_SPRITE_OES,
+                           GL_POLYGON_OFFSET_FILL,GL_RESCALE_NORMAL,GL_SAMPLE_ALPHA_TO_COVERAGE,
+                           GL_SAMPLE_ALPHA_TO_ONE,GL_SAMPLE_COVERAGE,GL_SCISSOR_TEST,GL_STENCIL_TEST,GL_TEXTURE_2D,
+                           GL_TEXTURE_COORD_ARRAY,GL_VERTEX_ARRAY,END_OF_CATEGORY}},
+    {GLES_ENUM_PIXEL_TYPE,{GL_UNSIGNED_BYTE,GL_UNSIGNED_SHORT_5_6_5,GL_UNSIGNED_SHORT_4_4_4_4,GL_UNSIGNED_SHORT_5_5_5_1,
+                           END_OF_CATEGORY}},
+    {GLES_ENUM_PIXEL_FORMAT,{GL_ALPHA,GL_RGB,GL_RGBA,GL_LUMINANCE,GL_LUMINANCE_ALPHA,GL_BGRA_EXT,END_OF_CATEGORY}},
+    {GLES_ENUM_COMPRESSED_FMT,{GL_PALETTE4_RGB8_OES,GL_PALETTE4_RGBA8_OES,GL_PALETTE4_R5_G6_B5_OES,GL_PALETTE4_RGBA4_OES,
+                               GL_PALETTE4_RGB5_A1_OES,GL_PALETTE8_RGB8_OES,GL_PALETTE8_RGBA8_OES,
+                               GL_PALETTE8_R5_G6_B5_OES,GL_PALETTE8_RGBA4_OES,GL_PALETTE8_RGB5_A1_OES,
+                               GL_ETC1_RGB8_OES,END_OF_CATEGORY}}
+};
+
+//fills the table when the library is loaded, before any call is validated
+static struct EnumTableInit {
+    EnumTableInit() {
+        for(unsigned int i = 0; i < sizeof(s_categories)/sizeof(s_categories[0]); i++) {
+            const EnumCategory& c = s_categories[i];
+            for(int j = 0; c.members[j] != END_OF_CATEGORY; j++) {
+                GLESvalidate::s_enumCategories[c.members[j]] |= c.category;
+            }
+        }
+    }
+} s_enumTableInit;
+
 bool  GLESvalidate::textureEnum(GLenum e,unsigned int maxTex) {
     return e >= GL_TEXTURE0 && e <= (GL_TEXTURE0 + maxTex);
 }
@@ -29,53 +93,7 @@ bool GLESvalidate::clipPlaneEnum(GLenum e,unsigned int maxClipPlanes) {
 }
 
 bool GLESvalidate::textureTarget(GLenum target) {
-    return target == GL_TEXTURE_2D;
-}
-
-
-bool GLESvalidate::alphaFunc(GLenum f) {
-    switch(f) {
-    case GL_NEVER:
-    case GL_LESS:
-    case GL_EQUAL:
-    case GL_LEQUAL:
-    case GL_GREATER:
-    case GL_NOTEQUAL:
-    case GL_GEQUAL:
-    case GL_ALWAYS:
-        return true;
-    }
-    return false;
-}
-
-bool GLESvalidate::blendSrc(GLenum s) {
-   switch(s) {
-    case GL_ZERO:
-    case GL_ONE:
-    case GL_DST_COLOR:
-    case GL_ONE_MINUS_DST_COLOR:
-    case GL_SRC_ALPHA:
-    case GL_ONE_MINUS_SRC_ALPHA:
-    case GL_DST_ALPHA:
-    case GL_ONE_MINUS_DST_ALPHA:
-        return true;
-  }
-  return false;
-}
-
-bool GLESvalidate::blendDst(GLenum d) {
-   switch(d) {
-    case GL_ZERO:
-    case GL_ONE:
-    case GL_SRC_COLOR:
-    case GL_ONE_MINUS_SRC_COLOR:
-    case GL_SRC_ALPHA:
-    case GL_ONE_MINUS_SRC_ALPHA:
-    case GL_DST_ALPHA:
-    case GL_ONE_MINUS_DST_ALPHA:
-        return true;
-   }
-   return false;
+    return TRUSTED_GUEST || target == GL_TEXTURE_2D;
 }
 
 bool GLESvalidate::vertexPointerParams(GLint size,GLsizei stride) {
@@ -90,171 +108,22 @@ bool GLESvalidate::texCoordPointerParams(GLint size,GLsizei stride) {
     return ((size >=1) && (size <= 4)) && (stride >=0) ;
 }
 
-bool GLESvalidate::supportedArrays(GLenum arr) {
-    switch(arr) {
-    case GL_COLOR_ARRAY:
-    case GL_NORMAL_ARRAY:
-    case GL_POINT_SIZE_ARRAY_OES:
-    case GL_TEXTURE_COORD_ARRAY:
-    case GL_VERTEX_ARRAY:
-        return true;
-    }
-    return false;
-}
-
-bool GLESvalidate::drawMode(GLenum mode) {
-    switch(mode) {
-    case GL_POINTS:
-    case GL_LINE_STRIP:
-    case GL_LINE_LOOP:
-    case GL_LINES:
-    case GL_TRIANGLE_STRIP:
-    case GL_TRIANGLE_FAN:
-    case GL_TRIANGLES:
-        return true;
-    }
-    return false;
-}
-
 bool GLESvalidate::drawType(GLenum mode) {
-    return mode == GL_UNSIGNED_BYTE || mode == GL_UNSIGNED_SHORT;
-}
-
-bool GLESvalidate::hintTargetMode(GLenum target,GLenum mode) {
-   switch(target) {
-   case GL_FOG_HINT:
-   case GL_GENERATE_MIPMAP_HINT:
-   case GL_LINE_SMOOTH_HINT:
-   case GL_PERSPECTIVE_CORRECTION_HINT:
-   case GL_POINT_SMOOTH_HINT:
-       break;
-   default: return false;
-   }
-   switch(mode) {
-   case GL_FASTEST:
-   case GL_NICEST:
-   case GL_DONT_CARE:
-       break;
-   default: return false;
-   }
-   return true;
-}
-
-bool GLESvalidate::texParams(GLenum target,GLenum pname) {
-    switch(pname) {
-    case GL_TEXTURE_MIN_FILTER:
-    case GL_TEXTURE_MAG_FILTER:
-    case GL_TEXTURE_WRAP_S:
-    case GL_TEXTURE_WRAP_T:
-        break;
-    default:
-        return false;
-    }
-    return target == GL_TEXTURE_2D;
+    return TRUSTED_GUEST || mode == GL_UNSIGNED_BYTE || mode == GL_UNSIGNED_SHORT;
 }
 
 bool GLESvalidate::texEnv(GLenum target,GLenum pname) {
-    switch(pname) {
-    case GL_TEXTURE_ENV_MODE:
-    case GL_COMBINE_RGB:
-    case GL_COMBINE_ALPHA:
-    case GL_SRC0_RGB:
-    case GL_SRC1_RGB:
-    case GL_SRC2_RGB:
-    case GL_SRC0_ALPHA:
-    case GL_SRC1_ALPHA:
-    case GL_SRC2_ALPHA:
-    case GL_OPERAND0_RGB:
-    case GL_OPERAND1_RGB:
-    case GL_OPERAND2_RGB:
-    case GL_OPERAND0_ALPHA:
-    case GL_OPERAND1_ALPHA:
-    case GL_OPERAND2_ALPHA:
-    case GL_RGB_SCALE:
-    case GL_ALPHA_SCALE:
-    case GL_COORD_REPLACE_OES:
-        break;
-    default:
-        return false;
-    }
-    return (target == GL_TEXTURE_ENV || target == GL_POINT_SPRITE_OES);
+    return isEnum(pname,GLES_ENUM_TEX_ENV) &&
+           (TRUSTED_GUEST || target == GL_TEXTURE_ENV || target == GL_POINT_SPRITE_OES);
 }
 
 bool GLESvalidate::capability(GLenum cap,int maxLights,int maxClipPlanes) {
-    switch(cap) {
-    case GL_ALPHA_TEST:
-    case GL_BLEND:
-    case GL_COLOR_ARRAY:
-    case GL_COLOR_LOGIC_OP:
-    case GL_COLOR_MATERIAL:
-    case GL_CULL_FACE:
-    case GL_DEPTH_TEST:
-    case GL_DITHER:
-    case GL_FOG:
-    case GL_LIGHTING:
-    case GL_LINE_SMOOTH:
-    case GL_MULTISAMPLE:
-    case GL_NORMAL_ARRAY:
-    case GL_NORMALIZE:
-    case GL_POINT_SIZE_ARRAY_OES:
-    case GL_POINT_SMOOTH:
-    case GL_POINT_SPRITE_OES:
-    case GL_POLYGON_OFFSET_FILL:
-    case GL_RESCALE_NORMAL:
-    case GL_SAMPLE_ALPHA_TO_COVERAGE:
-    case GL_SAMPLE_ALPHA_TO_ONE:
-    case GL_SAMPLE_COVERAGE:
-    case GL_SCISSOR_TEST:
-    case GL_STENCIL_TEST:
-    case GL_TEXTURE_2D:
-    case GL_TEXTURE_COORD_ARRAY:
-    case GL_VERTEX_ARRAY:
-        return true;
-    }
-    return GLESvalidate::lightEnum(cap,maxLights) || GLESvalidate::clipPlaneEnum(cap,maxClipPlanes);
-}
-
-bool GLESvalidate::pixelType(GLenum type) {
-    switch(type) {
-    case GL_UNSIGNED_BYTE:
-    case GL_UNSIGNED_SHORT_5_6_5:
-    case GL_UNSIGNED_SHORT_4_4_4_4:
-    case GL_UNSIGNED_SHORT_5_5_5_1:
-        return true;
-    }
-    return false;
-}
-
-bool GLESvalidate::pixelFrmt(GLenum format) {
-    switch(format) {
-    case GL_ALPHA:
-    case GL_RGB:
-    case GL_RGBA:
-    case GL_LUMINANCE:
-    case GL_LUMINANCE_ALPHA:
-        return true;
-    }
-    return false;
-}
-
-bool GLESvalidate::texCompImgFrmt(GLenum format) {
-    switch(format) {
-    case GL_PALETTE4_RGB8_OES:
-    case GL_PALETTE4_RGBA8_OES:
-    case GL_PALETTE4_R5_G6_B5_OES:
-    case GL_PALETTE4_RGBA4_OES:
-    case GL_PALETTE4_RGB5_A1_OES:
-    case GL_PALETTE8_RGB8_OES:
-    case GL_PALETTE8_RGBA8_OES:
-    case GL_PALETTE8_R5_G6_B5_OES:
-    case GL_PALETTE8_RGBA4_OES:
-    case GL_PALETTE8_RGB5_A1_OES:
-        return true;
-    }
-    return false;
+    return isEnum(cap,GLES_ENUM_CAPABILITY) ||
+           GLESvalidate::lightEnum(cap,maxLights) || GLESvalidate::clipPlaneEnum(cap,maxClipPlanes);
 }
 
 bool GLESvalidate::pixelOp(GLenum format,GLenum type) {
+     if(TRUSTED_GUEST) return true;
      switch(type) {
      case GL_UNSIGNED_SHORT_4_4_4_4:
      case GL_UNSIGNED_SHORT_5_5_5_1:
@@ -273,9 +142,9 @@ bool GLESvalidate::texImgDim(GLsizei width,GLsizei height,int maxTexSize) {
 }
 
 bool GLESvalidate::bufferTarget(GLenum target) {
-    return target == GL_ARRAY_BUFFER || target == GL_ELEMENT_ARRAY_BUFFER;
+    return TRUSTED_GUEST || target == GL_ARRAY_BUFFER || target == GL_ELEMENT_ARRAY_BUFFER;
 }
 
 bool GLESvalidate::bufferParam(GLenum param) {
- return  (param == GL_BUFFER_SIZE) || (param == GL_BUFFER_USAGE);
+ return  TRUSTED_GUEST || (param == GL_BUFFER_SIZE) || (param == GL_BUFFER_USAGE);
 }
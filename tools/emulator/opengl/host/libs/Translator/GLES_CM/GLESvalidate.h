@@ -18,33 +18,71 @@
 
 #include <GLES/gl.h>
 
+#define GLES_ENUM_TABLE_SIZE 0x10000 //every GLES 1.1 enum is below
+
+//
+// enum categories, an enum has the bits of the categories it belongs to in
+// the table indexed by its value, see GLESvalidate.cpp for the members
+//
+enum {
+    GLES_ENUM_ALPHA_FUNC     = 1 << 0,
+    GLES_ENUM_BLEND_SRC      = 1 << 1,
+    GLES_ENUM_BLEND_DST      = 1 << 2,
+    GLES_ENUM_ARRAY          = 1 << 3,
+    GLES_ENUM_DRAW_MODE      = 1 << 4,
+    GLES_ENUM_HINT_TARGET    = 1 << 5,
+    GLES_ENUM_HINT_MODE      = 1 << 6,
+    GLES_ENUM_TEX_PARAM      = 1 << 7,
+    GLES_ENUM_TEX_ENV        = 1 << 8,
+    GLES_ENUM_CAPABILITY     = 1 << 9,
+    GLES_ENUM_PIXEL_TYPE     = 1 << 10,
+    GLES_ENUM_PIXEL_FORMAT   = 1 << 11,
+    GLES_ENUM_COMPRESSED_FMT = 1 << 12
+};
+
+//
+// GLES_TRUSTED_GUEST builds (GLES_TRUSTED_GUEST := true in the build
+// environment) leave the enum checks to the guest, which made them
+// already: every enum is accepted. Sizes and dimensions are still
+// checked, the translator relies on them.
+//
 struct GLESvalidate
 {
 
 static bool lightEnum(GLenum e,unsigned int maxLIghts);
 static bool clipPlaneEnum(GLenum e,unsigned int maxClipPlanes);
-static bool alphaFunc(GLenum f);
-static bool blendSrc(GLenum s);
-static bool blendDst(GLenum d);
+static bool alphaFunc(GLenum f){return isEnum(f,GLES_ENUM_ALPHA_FUNC);};
+static bool blendSrc(GLenum s){return isEnum(s,GLES_ENUM_BLEND_SRC);};
+static bool blendDst(GLenum d){return isEnum(d,GLES_ENUM_BLEND_DST);};
 static bool vertexPointerParams(GLint size,GLsizei stride);
 static bool colorPointerParams(GLint size,GLsizei stride);
-static bool supportedArrays(GLenum arr);
-static bool drawMode(GLenum mode);
+static bool supportedArrays(GLenum arr){return isEnum(arr,GLES_ENUM_ARRAY);};
+static bool drawMode(GLenum mode){return isEnum(mode,GLES_ENUM_DRAW_MODE);};
 static bool drawType(GLenum mode);
-static bool hintTargetMode(GLenum target,GLenum mode);
+static bool hintTargetMode(GLenum target,GLenum mode){return isEnum(target,GLES_ENUM_HINT_TARGET) && isEnum(mode,GLES_ENUM_HINT_MODE);};
 static bool capability(GLenum cap,int maxLights,int maxClipPlanes);
-static bool texParams(GLenum target,GLenum pname);
+static bool texParams(GLenum target,GLenum pname){return isEnum(pname,GLES_ENUM_TEX_PARAM) && textureTarget(target);};
 static bool texCoordPointerParams(GLint size,GLsizei stride);
 static bool textureTarget(GLenum target);
 static bool textureEnum(GLenum e,unsigned int maxTex);
 static bool texEnv(GLenum target,GLenum pname);
-static bool pixelFrmt(GLenum format);
-static bool pixelType(GLenum type);
+static bool pixelFrmt(GLenum format){return isEnum(format,GLES_ENUM_PIXEL_FORMAT);};
+static bool pixelType(GLenum type){return isEnum(type,GLES_ENUM_PIXEL_TYPE);};
 static bool pixelOp(GLenum format,GLenum type);
-static bool texCompImgFrmt(GLenum format);
+static bool texCompImgFrmt(GLenum format){return isEnum(format,GLES_ENUM_COMPRESSED_FMT);};
 static bool texImgDim(GLsizei width,GLsizei height,int maxTexSize);
 static bool bufferTarget(GLenum target);
 static bool bufferParam(GLenum param);
+
+static bool isEnum(GLenum e,unsigned int categories) {
+#ifdef GLES_TRUSTED_GUEST
+    return true;
+#else
+    return e < GLES_ENUM_TABLE_SIZE && (s_enumCategories[e] & categories);
+#endif
+};
+
+static unsigned short s_enumCategories[GLES_ENUM_TABLE_SIZE];
 };
 
 #endif
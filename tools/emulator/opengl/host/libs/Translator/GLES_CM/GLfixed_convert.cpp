@@ -0,0 +1,189 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "GLfixed_convert.h"
+#include "GLfixed_ops.h"
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#define FIXED_CONVERT_SSE2
+#include <emmintrin.h>
+#ifdef __GNUC__
+#include <cpuid.h>
+// lets the kernels use SSE2 without building the whole file for it
+#define SSE2_FUNC __attribute__((target("sse2")))
+#else
+#include <intrin.h>
+#define SSE2_FUNC
+#endif
+#endif
+
+#ifdef __ARM_NEON__
+#define FIXED_CONVERT_NEON
+#include <arm_neon.h>
+#endif
+
+// loads a vertex index of type 'indices_type'
+#define INDEX_AT(indices_type,indices,i) \
+    ((indices_type) == GL_UNSIGNED_BYTE ? ((const GLubyte *)(indices))[i] : \
+                                          ((const GLushort *)(indices))[i])
+
+typedef void (*convert_proc_t)(const GLfixed*,GLfloat*,unsigned int);
+typedef void (*convert4_proc_t)(const GLfixed*,GLfloat*);
+
+//
+// scalar versions
+//
+static void convert_c(const GLfixed* dataIn,GLfloat* dataOut,unsigned int count) {
+    for(unsigned int i = 0; i < count; i++) {
+        dataOut[i] = X2F(dataIn[i]);
+    }
+}
+
+static void convert4_c(const GLfixed* dataIn,GLfloat* dataOut) {
+    convert_c(dataIn,dataOut,4);
+}
+
+#ifdef FIXED_CONVERT_SSE2
+//
+// 1/65536 is a power of two so multiplying by it gives the exact same
+// results as the division done by X2F.
+//
+SSE2_FUNC static void convert_sse2(const GLfixed* dataIn,GLfloat* dataOut,unsigned int count) {
+    const __m128 scale = _mm_set1_ps(1.0f/65536.0f);
+    unsigned int i = 0;
+    for(; i + 8 <= count; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(dataIn + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(dataIn + i + 4));
+        _mm_storeu_ps(dataOut + i,     _mm_mul_ps(_mm_cvtepi32_ps(a),scale));
+        _mm_storeu_ps(dataOut + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(b),scale));
+    }
+    for(; i + 4 <= count; i += 4) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(dataIn + i));
+        _mm_storeu_ps(dataOut + i, _mm_mul_ps(_mm_cvtepi32_ps(a),scale));
+    }
+    for(; i < count; i++) {
+        dataOut[i] = X2F(dataIn[i]);
+    }
+}
+
+SSE2_FUNC static void convert4_sse2(const GLfixed* dataIn,GLfloat* dataOut) {
+    __m128i a = _mm_loadu_si128((const __m128i*)dataIn);
+    _mm_storeu_ps(dataOut, _mm_mul_ps(_mm_cvtepi32_ps(a),_mm_set1_ps(1.0f/65536.0f)));
+}
+
+static bool hasSSE2() {
+#if defined(__x86_64__) || defined(_M_X64)
+    return true;
+#elif defined(__GNUC__)
+    unsigned int eax,ebx,ecx,edx;
+    if(!__get_cpuid(1,&eax,&ebx,&ecx,&edx)) return false;
+    return (edx & bit_SSE2) != 0;
+#else
+    int info[4];
+    __cpuid(info,1);
+    return (info[3] & (1 << 26)) != 0;
+#endif
+}
+#endif
+
+#ifdef FIXED_CONVERT_NEON
+//
+// vcvtq_n_f32_s32 converts from fixed point with 16 fraction bits
+// directly.
+//
+static void convert_neon(const GLfixed* dataIn,GLfloat* dataOut,unsigned int count) {
+    unsigned int i = 0;
+    for(; i + 4 <= count; i += 4) {
+        vst1q_f32(dataOut + i, vcvtq_n_f32_s32(vld1q_s32(dataIn + i),16));
+    }
+    for(; i < count; i++) {
+        dataOut[i] = X2F(dataIn[i]);
+    }
+}
+
+static void convert4_neon(const GLfixed* dataIn,GLfloat* dataOut) {
+    vst1q_f32(dataOut, vcvtq_n_f32_s32(vld1q_s32(dataIn),16));
+}
+#endif
+
+static convert_proc_t s_convert = NULL;
+static convert4_proc_t s_convert4 = NULL;
+
+//
+// picks the kernels for this cpu, several threads may do it at the
+// same time, they all pick the same ones.
+//
+static void initKernels() {
+    convert_proc_t convert = convert_c;
+    convert4_proc_t convert4 = convert4_c;
+#ifdef FIXED_CONVERT_SSE2
+    if(hasSSE2()) {
+        convert = convert_sse2;
+        convert4 = convert4_sse2;
+    }
+#endif
+#ifdef FIXED_CONVERT_NEON
+    convert = convert_neon;
+    convert4 = convert4_neon;
+#endif
+    s_convert4 = convert4;
+    s_convert = convert;
+}
+
+void fixedToFloat(const GLfixed* dataIn,GLfloat* dataOut,unsigned int count) {
+    if(!s_convert) initKernels();
+    s_convert(dataIn,dataOut,count);
+}
+
+void fixedToFloatStrided(const char* dataIn,unsigned int strideIn,
+                         char* dataOut,unsigned int strideOut,
+                         unsigned int count,int attribSize) {
+    if(!s_convert) initKernels();
+
+    unsigned int elemSize = attribSize*sizeof(GLfixed);
+    if(strideIn == elemSize && strideOut == elemSize) {
+        // tightly packed arrays - convert everything in one go
+        s_convert((const GLfixed*)dataIn,(GLfloat*)dataOut,count*attribSize);
+        return;
+    }
+
+    for(unsigned int i = 0; i < count; i++) {
+        if(attribSize == 4) {
+            s_convert4((const GLfixed*)dataIn,(GLfloat*)dataOut);
+        } else {
+            convert_c((const GLfixed*)dataIn,(GLfloat*)dataOut,attribSize);
+        }
+        dataIn += strideIn;
+        dataOut += strideOut;
+    }
+}
+
+void fixedToFloatIndexed(const char* dataIn,unsigned int strideIn,
+                         char* dataOut,unsigned int strideOut,
+                         GLsizei count,GLenum indices_type,const GLvoid* indices,
+                         int attribSize) {
+    if(!s_convert) initKernels();
+
+    for(int i = 0; i < count; i++) {
+        unsigned int index = INDEX_AT(indices_type,indices,i);
+        const GLfixed* fixed_data = (const GLfixed*)(dataIn + index*strideIn);
+        GLfloat* float_data = (GLfloat*)(dataOut + index*strideOut);
+        if(attribSize == 4) {
+            s_convert4(fixed_data,float_data);
+        } else {
+            convert_c(fixed_data,float_data,attribSize);
+        }
+    }
+}
@@ -0,0 +1,44 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _GL_FIXED_CONVERT_H
+#define _GL_FIXED_CONVERT_H
+
+#include <GLES/gl.h>
+
+//
+// GL_FIXED to GL_FLOAT conversion of vertex arrays. The results are the
+// same as converting each component with X2F. SIMD versions are picked
+// at runtime according to the host CPU (SSE2 on x86, NEON on ARM builds
+// with NEON enabled). Converting in place (dataIn == dataOut with the same
+// stride) is supported.
+//
+
+// converts 'count' tightly packed components
+void fixedToFloat(const GLfixed* dataIn,GLfloat* dataOut,unsigned int count);
+
+// converts 'count' elements of 'attribSize' components
+void fixedToFloatStrided(const char* dataIn,unsigned int strideIn,
+                         char* dataOut,unsigned int strideOut,
+                         unsigned int count,int attribSize);
+
+// converts the elements referenced by 'indices', element n is read from
+// dataIn + n*strideIn and written to dataOut + n*strideOut
+void fixedToFloatIndexed(const char* dataIn,unsigned int strideIn,
+                         char* dataOut,unsigned int strideOut,
+                         GLsizei count,GLenum indices_type,const GLvoid* indices,
+                         int attribSize);
+
+#endif
@@ -0,0 +1,118 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "GLfixed_pool.h"
+#include "GLfixed_convert.h"
+#include <string.h>
+
+FixedConvertPool* FixedConvertPool::create(int threads) {
+    if(threads < 2) return NULL;
+    if(threads > FIXED_POOL_MAX_THREADS) threads = FIXED_POOL_MAX_THREADS;
+
+    FixedConvertPool* pool = new FixedConvertPool(threads);
+    for(int i = 1; i < threads; i++) {
+        Worker* worker = new Worker(pool,i);
+        worker->setName("gles-convert");
+        if(!worker->start()) {
+            delete worker;
+            break;
+        }
+        pool->m_workers[pool->m_threads++] = worker;
+    }
+    if(pool->m_threads == 1) {
+        delete pool;
+        return NULL;
+    }
+    return pool;
+}
+
+FixedConvertPool::FixedConvertPool(int threads):m_jobSerial(0),m_pending(0),m_exit(false),m_threads(1) {
+    memset(&m_job,0,sizeof(m_job));
+    memset(m_workers,0,sizeof(m_workers));
+}
+
+FixedConvertPool::~FixedConvertPool() {
+    m_lock.lock();
+    m_exit = true;
+    m_workCond.broadcast();
+    m_lock.unlock();
+    for(int i = 1; i < m_threads; i++) {
+        int exitStatus;
+        m_workers[i]->wait(&exitStatus);
+        delete m_workers[i];
+    }
+}
+
+bool FixedConvertPool::convert(const char* dataIn,unsigned int strideIn,
+                               char* copy,unsigned int copySize,
+                               char* dataOut,unsigned int strideOut,
+                               unsigned int count,int attribSize) {
+    if(m_jobLock.tryLock() != 0) return false;
+
+    m_lock.lock();
+    m_job.dataIn     = dataIn;
+    m_job.strideIn   = strideIn;
+    m_job.copy       = copy;
+    m_job.copySize   = copySize;
+    m_job.dataOut    = dataOut;
+    m_job.strideOut  = strideOut;
+    m_job.count      = count;
+    m_job.attribSize = attribSize;
+    m_pending = m_threads - 1;
+    m_jobSerial++;
+    m_workCond.broadcast();
+    m_lock.unlock();
+
+    convertPart(0);
+
+    m_lock.lock();
+    while(m_pending) m_doneCond.wait(m_lock);
+    m_lock.unlock();
+    m_jobLock.unlock();
+    return true;
+}
+
+int FixedConvertPool::workerMain(int part) {
+    unsigned int serial = 0;
+    m_lock.lock();
+    for(;;) {
+        while(!m_exit && m_jobSerial == serial) m_workCond.wait(m_lock);
+        if(m_exit) break;
+        serial = m_jobSerial;
+        m_lock.unlock();
+
+        convertPart(part);
+
+        m_lock.lock();
+        if(--m_pending == 0) m_doneCond.signal();
+    }
+    m_lock.unlock();
+    return 0;
+}
+
+//the parts are consecutive runs of whole elements, the last one copies up to copySize
+void FixedConvertPool::convertPart(int part) {
+    const Job& job = m_job;
+    unsigned int begin = (unsigned long long)job.count * part / m_threads;
+    unsigned int end   = (unsigned long long)job.count * (part + 1) / m_threads;
+    if(begin == end) return;
+
+    unsigned int copyBegin = begin * job.strideIn;
+    unsigned int copyEnd   = part == m_threads - 1 ? job.copySize : end * job.strideIn;
+    memcpy(job.copy + copyBegin,job.dataIn + copyBegin,copyEnd - copyBegin);
+    fixedToFloatStrided(job.dataIn + begin * job.strideIn,job.strideIn,
+                        job.dataOut + begin * job.strideOut,job.strideOut,
+                        end - begin,job.attribSize);
+}
@@ -0,0 +1,84 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _GL_FIXED_POOL_H
+#define _GL_FIXED_POOL_H
+
+#include <utils/threads.h>
+#include "osThread.h"
+
+#define FIXED_POOL_MAX_THREADS 16
+
+//
+// worker threads sharing the GL_FIXED conversion of large client arrays
+// with the render thread. A conversion is split in vertex ranges, one per
+// thread, and convert() returns once every range is done. The pool is
+// shared by the contexts, a context finding it busy converts by itself.
+//
+class FixedConvertPool
+{
+public:
+    // threads - converting threads, the calling one included
+    static FixedConvertPool* create(int threads);
+    ~FixedConvertPool();
+
+    //
+    // convert - same as copying 'copySize' bytes of dataIn to 'copy' and
+    // converting with fixedToFloatStrided. Returns false without doing
+    // anything when another conversion is running.
+    //
+    bool convert(const char* dataIn,unsigned int strideIn,
+                 char* copy,unsigned int copySize,
+                 char* dataOut,unsigned int strideOut,
+                 unsigned int count,int attribSize);
+
+private:
+    class Worker : public osUtils::Thread {
+    public:
+        Worker(FixedConvertPool* pool,int part):m_pool(pool),m_part(part){};
+        virtual int Main(){return m_pool->workerMain(m_part);};
+    private:
+        FixedConvertPool* m_pool;
+        int               m_part;
+    };
+
+    struct Job {
+        const char*  dataIn;
+        unsigned int strideIn;
+        char*        copy;
+        unsigned int copySize;
+        char*        dataOut;
+        unsigned int strideOut;
+        unsigned int count;
+        int          attribSize;
+    };
+
+    FixedConvertPool(int threads);
+    int  workerMain(int part);
+    void convertPart(int part);
+
+    android::Mutex     m_jobLock;     //held by the thread owning the current job
+    android::Mutex     m_lock;
+    android::Condition m_workCond;
+    android::Condition m_doneCond;
+    Job                m_job;
+    unsigned int       m_jobSerial;   //bumped for each job
+    int                m_pending;     //worker parts not done yet
+    bool               m_exit;
+    int                m_threads;
+    Worker*            m_workers[FIXED_POOL_MAX_THREADS];
+};
+
+#endif
@@ -41,18 +41,37 @@ bool Range::rangeUnion(const Range& r,Range& rOut) const {
 }
 
 void RangeList::addRange(const Range& r) {
-    list.push_back(r);
+    if(r.getSize() <= 0) return;
+
+    int start = r.getStart();
+    int end   = r.getEnd();
+
+    // first range which may touch r: the last one starting at or before r
+    std::map<int,int>::iterator it = list.upper_bound(start);
+    if(it != list.begin()) {
+        std::map<int,int>::iterator prev = it;
+        prev--;
+        if(prev->second >= start) it = prev;
+    }
+
+    // absorb all the ranges overlapping or adjacent to r
+    while(it != list.end() && it->first <= end) {
+        if(it->first < start) start = it->first;
+        if(it->second > end) end = it->second;
+        list.erase(it++);
+    }
+    list[start] = end;
 }
 
 void RangeList::addRanges(const RangeList& rl) {
-    for(int i =0; i< rl.size();i++) {
-       addRange(rl.list[i]);
+    for(const_iterator it = rl.begin(); it != rl.end(); it++) {
+       addRange(rangeAt(it));
     }
 }
 
 void RangeList::delRanges(const RangeList& rl,RangeList& deleted) {
-    for(int i =0; i< rl.size();i++) {
-       delRange(rl.list[i],deleted);
+    for(const_iterator it = rl.begin(); it != rl.end(); it++) {
+       delRange(rangeAt(it),deleted);
     }
 }
 
@@ -67,60 +86,35 @@ void RangeList::clear() {
     return list.clear();
 }
 
-void RangeList::erase(unsigned int i) {
-    if(i > list.size()) return;
-    list.erase(list.begin() +i);
-}
-
 void RangeList::delRange(const Range& r,RangeList& deleted) {
-    if(r.getSize() == 0) return;
-
-    Range intersection;
-    Range temp;
-    // compare new rect to each and any of the rects on the list
-    for (int i=0;i<(int)list.size();i++) { // i must be signed for i-- below
-     // if there is intersection
-     if (r.rangeIntersection(list[i],intersection)) {
-             Range old=list[i];
-         // remove old as it is about to be split
-         erase(i);
-         i--;
-         if (intersection!=old) { // otherwise split:
-                 //intersection on right side
-                 if(old.getStart() != intersection.getStart()) {
-                     list.insert(list.begin(),Range(old.getStart(),intersection.getStart() - old.getStart()));
-                 }
-
-                 //intersection on left side
-                 if(old.getEnd() != intersection.getEnd()) {
-                     list.insert(list.begin(),Range(intersection.getEnd(),old.getEnd() - intersection.getEnd()));
-                 }
-                 deleted.addRange(intersection);
-             }
-     }
- }
+    if(r.getSize() <= 0) return;
+
+    int start = r.getStart();
+    int end   = r.getEnd();
+
+    // first range which may intersect r
+    std::map<int,int>::iterator it = list.upper_bound(start);
+    if(it != list.begin()) {
+        std::map<int,int>::iterator prev = it;
+        prev--;
+        if(prev->second > start) it = prev;
+    }
+
+    while(it != list.end() && it->first < end) {
+        int oldStart = it->first;
+        int oldEnd   = it->second;
+        int interStart = oldStart > start ? oldStart : start;
+        int interEnd   = oldEnd < end ? oldEnd : end;
+        list.erase(it++);
+
+        // keep the parts of the old range which are outside of r
+        if(oldStart < interStart) list[oldStart] = interStart;
+        if(oldEnd > interEnd) list[interEnd] = oldEnd;
+
+        deleted.addRange(Range(interStart,interEnd - interStart));
+    }
 }
 
+//ranges are merged when added, kept for compatibility
 void RangeList::merge() {
-    if(list.empty()) return;
-
-    Range temp;
-    bool changed;
-
-    do { // re-run if changed in last run
-        changed=0;
-        // run for each combinations of two rects in the list
-        for (int i=0;i<(((int)list.size())-1) && !changed ;i++)
-        {
-            for (int j=i+1;j<(int)list.size() && !changed ;j++)
-            {
-               if (list[i].rangeUnion(list[j],temp)) {
-                    // are them exactly one on left of the other
-                    list[i] = temp;
-                    erase(j);
-                    changed=1;
-               }
-            }
-        }
-    } while (changed);
 }
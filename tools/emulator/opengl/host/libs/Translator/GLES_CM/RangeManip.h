@@ -16,7 +16,7 @@
 #ifndef RANGE_H
 #define RANGE_H
 
-#include <vector>
+#include <map>
 
 class Range {
 
@@ -47,8 +47,15 @@ private:
     int m_size;
 };
 
+//
+// RangeList - a set of disjoint ranges kept sorted by start offset.
+// Overlapping and adjacent ranges are coalesced when added, so adding or
+// deleting a range is O(log n) in the number of ranges it touches.
+//
 class RangeList {
 public:
+      typedef std::map<int,int>::const_iterator const_iterator; // start -> end
+
       void addRange(const Range& r);
       void addRanges(const RangeList& rl);
       void delRange(const Range& r,RangeList& deleted);
@@ -57,13 +64,11 @@ public:
       void merge();
       int  size() const;
       void clear();
-      Range& operator[](unsigned int i){return list[i];};
+      const_iterator begin() const{return list.begin();};
+      const_iterator end() const{return list.end();};
+      static Range rangeAt(const_iterator it){return Range(it->first,it->second - it->first);};
 private:
-  void erase(unsigned int i);
-  std::vector<Range> list;
+  std::map<int,int> list;
 };
 
-
-
-
 #endif
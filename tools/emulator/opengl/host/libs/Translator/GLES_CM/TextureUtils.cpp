@@ -15,17 +15,10 @@
 */
 #include "TextureUtils.h"
 #include <stdio.h>
+#include <string.h>
+#include <stdint.h>
 
 
-struct Color
-{
-  Color(unsigned char r, unsigned char g,unsigned char b, unsigned char a):red(r),green(g),blue(b),alpha(a){};
-  unsigned char red;
-  unsigned char green;
-  unsigned char blue;
-  unsigned char alpha;
-};
-
 void getPaletteInfo(GLenum internalFormat,unsigned int& indexSizeBits,unsigned int& colorSizeBytes,GLenum& colorFrmt) {
 
         colorFrmt = GL_RGB;
@@ -43,9 +36,9 @@ void getPaletteInfo(GLenum internalFormat,unsigned int& indexSizeBits,unsigned i
         break;
 
     case GL_PALETTE4_RGBA4_OES:
+    case GL_PALETTE4_RGB5_A1_OES:
             colorFrmt = GL_RGBA;
     case GL_PALETTE4_R5_G6_B5_OES:
-    case GL_PALETTE4_RGB5_A1_OES:
         indexSizeBits = 4;
         colorSizeBytes = 2;
         break;
@@ -61,45 +54,114 @@ void getPaletteInfo(GLenum internalFormat,unsigned int& indexSizeBits,unsigned i
             colorFrmt = GL_RGBA;
         break;
 
-    case GL_PALETTE8_R5_G6_B5_OES:
+    case GL_PALETTE8_RGBA4_OES:
     case GL_PALETTE8_RGB5_A1_OES:
+            colorFrmt = GL_RGBA;
+    case GL_PALETTE8_R5_G6_B5_OES:
         indexSizeBits = 8;
         colorSizeBytes = 2;
         break;
     }
 }
 
+static inline uint32_t rgba(unsigned int r,unsigned int g,unsigned int b,unsigned int a) {
+    const unsigned char c[4] = {(unsigned char)r,(unsigned char)g,(unsigned char)b,(unsigned char)a};
+    uint32_t v;
+    memcpy(&v,c,4); //same byte order as the pixels in memory
+    return v;
+}
 
-Color paletteColor(const unsigned char* pallete,unsigned int index,GLenum format)
+//palette entry converted to RGBA8, 565/4444/5551 components are expanded to 8 bits
+static uint32_t paletteColor(const unsigned char* entry,GLenum format)
 {
-        short s;
-        switch(format) {
-        //RGB
+    unsigned int s = entry[0] | (entry[1] << 8);
+    unsigned int r,g,b;
+    switch(format) {
     case GL_PALETTE4_RGB8_OES:
     case GL_PALETTE8_RGB8_OES:
-            return Color(pallete[index],pallete[index+1],pallete[index+2],0);
-    case GL_PALETTE8_R5_G6_B5_OES:
-    case GL_PALETTE4_R5_G6_B5_OES:
-            s = *((short *)(pallete+index));
-            return Color(s >> 10,(s >> 5) & 0x3f ,s & 0x1f,0);
-
-        //RGBA
+        return rgba(entry[0],entry[1],entry[2],255);
     case GL_PALETTE4_RGBA8_OES:
     case GL_PALETTE8_RGBA8_OES:
-            return Color(pallete[index],pallete[index+1],pallete[index+2],pallete[index+3]);
+        return rgba(entry[0],entry[1],entry[2],entry[3]);
+    case GL_PALETTE4_R5_G6_B5_OES:
+    case GL_PALETTE8_R5_G6_B5_OES:
+        r = (s >> 11) & 0x1f; g = (s >> 5) & 0x3f; b = s & 0x1f;
+        return rgba((r << 3) | (r >> 2),(g << 2) | (g >> 4),(b << 3) | (b >> 2),255);
     case GL_PALETTE4_RGBA4_OES:
-            s = *((short *)(pallete+index));
-            return Color((s >> 12) & 0xf,(s >> 8) & 0xf,(s >> 4) & 0xf ,s & 0xf);
+    case GL_PALETTE8_RGBA4_OES:
+        return rgba(((s >> 12) & 0xf) * 17,((s >> 8) & 0xf) * 17,((s >> 4) & 0xf) * 17,(s & 0xf) * 17);
     case GL_PALETTE4_RGB5_A1_OES:
     case GL_PALETTE8_RGB5_A1_OES:
-            s = *((short *)(pallete+index));
-            return Color((s >> 11) & 0x1f,(s >> 6) & 0x1f,(s >> 1) & 0x1f ,s & 0x1 * 255);
-        default:
-            return Color(255,255,255,255);
+        r = (s >> 11) & 0x1f; g = (s >> 6) & 0x1f; b = (s >> 1) & 0x1f;
+        return rgba((r << 3) | (r >> 2),(g << 3) | (g >> 2),(b << 3) | (b >> 2),(s & 0x1) ? 255 : 0);
+    default:
+        return rgba(255,255,255,255);
+    }
+}
+
+bool isPackedTexelType(GLenum type) {
+    return type == GL_UNSIGNED_SHORT_5_6_5 ||
+           type == GL_UNSIGNED_SHORT_4_4_4_4 ||
+           type == GL_UNSIGNED_SHORT_5_5_5_1;
+}
+
+static inline unsigned int alignedRow(unsigned int bytes,int alignment) {
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+
+unsigned int packedTexelsSize(GLsizei width,GLsizei height,int alignment) {
+    return alignedRow(width*4,alignment) * height;
+}
+
+//
+// the loops are kept to shifts and masks on whole rows so the compiler
+// can vectorize them, the 5 and 6 bits components are widened by
+// replicating their top bits like paletteColor() does.
+//
+void convertPackedTexels(GLenum type,GLsizei width,GLsizei height,int alignment,const GLvoid* src,unsigned char* dst) {
+    unsigned int srcStride = alignedRow(width*2,alignment);
+    unsigned int dstStride = alignedRow(width*4,alignment);
+    const unsigned char* srcRow = static_cast<const unsigned char*>(src);
+
+    for(int y = 0; y < height; y++, srcRow += srcStride, dst += dstStride) {
+        const unsigned char* p = srcRow;
+        unsigned char* d = dst;
+        switch(type) {
+        case GL_UNSIGNED_SHORT_5_6_5:
+            for(int x = 0; x < width; x++, p += 2, d += 4) {
+                unsigned int s = p[0] | (p[1] << 8);
+                unsigned int r = (s >> 11) & 0x1f, g = (s >> 5) & 0x3f, b = s & 0x1f;
+                d[0] = (r << 3) | (r >> 2);
+                d[1] = (g << 2) | (g >> 4);
+                d[2] = (b << 3) | (b >> 2);
+                d[3] = 255;
+            }
+            break;
+        case GL_UNSIGNED_SHORT_4_4_4_4:
+            for(int x = 0; x < width; x++, p += 2, d += 4) {
+                unsigned int s = p[0] | (p[1] << 8);
+                d[0] = ((s >> 12) & 0xf) * 17;
+                d[1] = ((s >> 8) & 0xf) * 17;
+                d[2] = ((s >> 4) & 0xf) * 17;
+                d[3] = (s & 0xf) * 17;
+            }
+            break;
+        case GL_UNSIGNED_SHORT_5_5_5_1:
+            for(int x = 0; x < width; x++, p += 2, d += 4) {
+                unsigned int s = p[0] | (p[1] << 8);
+                unsigned int r = (s >> 11) & 0x1f, g = (s >> 6) & 0x1f, b = (s >> 1) & 0x1f;
+                d[0] = (r << 3) | (r >> 2);
+                d[1] = (g << 3) | (g >> 2);
+                d[2] = (b << 3) | (b >> 2);
+                d[3] = (s & 0x1) ? 255 : 0;
+            }
+            break;
+        }
     }
 }
 
-unsigned char* uncompressTexture(GLenum internalformat,GLenum& formatOut,GLsizei width,GLsizei height,GLsizei imageSize, const GLvoid* data,GLint level) {
+bool uncompressTexture(GLenum internalformat,GLenum& formatOut,GLsizei width,GLsizei height,GLsizei imageSize,const GLvoid* data,int nLevels,
+                       std::vector<unsigned char>& pixels,unsigned int* levelOffsets) {
 
     unsigned int indexSizeBits;  //the size of the color index in the pallete
     unsigned int colorSizeBytes; //the size of each color cell in the pallete
@@ -110,49 +172,150 @@ unsigned char* uncompressTexture(GLenum internalformat,GLenum& formatOut,GLsizei
 
     //the pallete positioned in the begininng of the data
     // so we jump over it to get to the colos indices in the palette
-
-    int nColors = 2 << (indexSizeBits -1); //2^indexSizeBits
+    int nColors = 1 << indexSizeBits;
     int paletteSizeBytes = nColors*colorSizeBytes;
-    const unsigned char* imageIndices =  palette + paletteSizeBytes;
+    if(imageSize < paletteSizeBytes) return false;
 
-    //jumping to the the correct mipmap level
-    for(int i=0;i<level;i++) {
-        imageIndices+= (width*height*indexSizeBits)/8;
-        width  = width  >> 1;
-        height = height >> 1;
+    //
+    // expand the palette once into a RGBA lookup table. With 4 bits
+    // indices every index byte is looked up in a table of pixel pairs,
+    // first pixel in the upper bits.
+    //
+    uint32_t lut[256];
+    for(int i = 0; i < nColors; i++) {
+        lut[i] = paletteColor(palette + i*colorSizeBytes,internalformat);
+    }
+    uint32_t pairs[256][2];
+    if(indexSizeBits == 4) {
+        for(int i = 0; i < 256; i++) {
+            pairs[i][0] = lut[i >> 4];
+            pairs[i][1] = lut[i & 0xf];
+        }
     }
 
-    int colorSizeOut = (formatOut == GL_RGB? 3:4);
-    int nPixels = width*height;
-    unsigned char* pixelsOut = new unsigned char[nPixels*colorSizeOut];
-    if(!pixelsOut) return NULL;
-
-    int leftBytes = ((palette + imageSize) /* the end of data pointer*/
-                      - imageIndices);
-    int leftPixels = (leftBytes * 8 )/indexSizeBits;
+    //sizing the output for all levels
+    unsigned int totalPixels = 0;
+    GLsizei w = width, h = height;
+    for(int l = 0; l < nLevels; l++) {
+        levelOffsets[l] = totalPixels*4;
+        totalPixels += w*h;
+        w = w > 1 ? w >> 1 : 1;
+        h = h > 1 ? h >> 1 : 1;
+    }
+    pixels.resize(totalPixels*4);
 
-    int maxIndices = (leftPixels < nPixels) ? leftPixels:nPixels;
+    const unsigned char* indices = palette + paletteSizeBytes;
+    const unsigned char* end     = palette + imageSize;
+    w = width;
+    h = height;
+    for(int l = 0; l < nLevels; l++) {
+        uint32_t* out = reinterpret_cast<uint32_t*>(&pixels[levelOffsets[l]]);
+        unsigned int nPixels = w*h;
+        unsigned int levelBytes = (nPixels*indexSizeBits + 7)/8;
+        unsigned int availBytes = indices < end ? end - indices : 0;
+        unsigned int nBytes = levelBytes < availBytes ? levelBytes : availBytes;
 
-    //filling the pixels array
-    for(int i =0 ; i < maxIndices ; i++) {
-        int paletteIndex = 0;
-        int indexOut = i*colorSizeOut;
+        unsigned int n = 0;
         if(indexSizeBits == 4) {
-            paletteIndex = (i%2)? imageIndices[i/2] >> 4:  //upper bits
-                           imageIndices[i/2] & 0xf; //lower bits
+            unsigned int fullBytes = nBytes < nPixels/2 ? nBytes : nPixels/2;
+            for(unsigned int i = 0; i < fullBytes; i++) {
+                memcpy(out + n,pairs[indices[i]],8);
+                n += 2;
+            }
+            if(n < nPixels && fullBytes < nBytes) {
+                out[n++] = lut[indices[fullBytes] >> 4]; //odd number of pixels
+            }
         } else {
-            paletteIndex = imageIndices[i];
+            for(; n < nBytes; n++) {
+                out[n] = lut[indices[n]];
+            }
+        }
+        //missing data
+        if(n < nPixels) {
+            memset(out + n,0,(nPixels - n)*4);
         }
 
-        paletteIndex*=colorSizeBytes;
-        Color c = paletteColor(palette,paletteIndex,internalformat);
+        indices += levelBytes;
+        w = w > 1 ? w >> 1 : 1;
+        h = h > 1 ? h >> 1 : 1;
+    }
+    return true;
+}
+
+//
+// ETC1 - each 4x4 block is 64 bits, big endian. The high word holds the
+// two base colors, the modifier tables and the diff/flip bits, the low word
+// holds two bits planes of pixel indices, column major.
+//
+static const int s_etc1Modifiers[8][2] = {
+    {2,8},{5,17},{9,29},{13,42},{18,60},{24,80},{33,106},{47,183}
+};
+
+static inline unsigned char clamp255(int v) {
+    return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+//the four colors a sub block can use, in pixel index order
+static void etc1SubBlockColors(int r,int g,int b,int table,unsigned char colors[4][3]) {
+    const int a = s_etc1Modifiers[table][0];
+    const int m = s_etc1Modifiers[table][1];
+    const int mods[4] = {a,m,-a,-m};
+    for(int i = 0; i < 4; i++) {
+        colors[i][0] = clamp255(r + mods[i]);
+        colors[i][1] = clamp255(g + mods[i]);
+        colors[i][2] = clamp255(b + mods[i]);
+    }
+}
+
+static void etc1DecodeBlock(const unsigned char* block,unsigned char* out,int stride,int w,int h) {
+    uint32_t high = (block[0] << 24) | (block[1] << 16) | (block[2] << 8) | block[3];
+    uint32_t low  = (block[4] << 24) | (block[5] << 16) | (block[6] << 8) | block[7];
+
+    int r1,g1,b1,r2,g2,b2;
+    if(high & 2) {
+        //differential mode, 555 base color plus a signed 333 delta
+        int r = high >> 27, g = (high >> 19) & 0x1f, b = (high >> 11) & 0x1f;
+        int dr = ((int)(high << 5)) >> 29, dg = ((int)(high << 13)) >> 29, db = ((int)(high << 21)) >> 29;
+        r2 = (r + dr) & 0x1f; g2 = (g + dg) & 0x1f; b2 = (b + db) & 0x1f;
+        r1 = (r << 3) | (r >> 2); g1 = (g << 3) | (g >> 2); b1 = (b << 3) | (b >> 2);
+        r2 = (r2 << 3) | (r2 >> 2); g2 = (g2 << 3) | (g2 >> 2); b2 = (b2 << 3) | (b2 >> 2);
+    } else {
+        //individual mode, two 444 colors
+        r1 = (high >> 28) * 17;        r2 = ((high >> 24) & 0xf) * 17;
+        g1 = ((high >> 20) & 0xf) * 17; g2 = ((high >> 16) & 0xf) * 17;
+        b1 = ((high >> 12) & 0xf) * 17; b2 = ((high >> 8) & 0xf) * 17;
+    }
+
+    unsigned char colors[2][4][3];
+    etc1SubBlockColors(r1,g1,b1,(high >> 5) & 0x7,colors[0]);
+    etc1SubBlockColors(r2,g2,b2,(high >> 2) & 0x7,colors[1]);
+    bool flip = high & 1;
+
+    for(int y = 0; y < h; y++) {
+        unsigned char* p = out + y*stride;
+        for(int x = 0; x < w; x++) {
+            int bit = x*4 + y;
+            int index = (((low >> (bit + 16)) & 1) << 1) | ((low >> bit) & 1);
+            int sub = flip ? (y >= 2) : (x >= 2);
+            const unsigned char* c = colors[sub][index];
+            p[0] = c[0]; p[1] = c[1]; p[2] = c[2];
+            p += 3;
+        }
+    }
+}
+
+unsigned int etc1DataSize(GLsizei width,GLsizei height) {
+    return ((width + 3)/4) * ((height + 3)/4) * 8;
+}
 
-        pixelsOut[indexOut] = c.red;
-        pixelsOut[indexOut+1] = c.green;
-        pixelsOut[indexOut+2] = c.blue;
-        if(formatOut == GL_RGBA) {
-            pixelsOut[indexOut+3] = c.alpha;
+void etc1DecodeImage(const GLvoid* data,GLsizei width,GLsizei height,unsigned char* pixels,int stride) {
+    const unsigned char* block = static_cast<const unsigned char*>(data);
+    for(GLsizei y = 0; y < height; y += 4) {
+        int h = height - y < 4 ? height - y : 4;
+        for(GLsizei x = 0; x < width; x += 4) {
+            int w = width - x < 4 ? width - x : 4;
+            etc1DecodeBlock(block,pixels + y*stride + x*3,stride,w,h);
+            block += 8;
         }
     }
-    return pixelsOut;
 }
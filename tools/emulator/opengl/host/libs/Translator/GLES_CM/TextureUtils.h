@@ -17,7 +17,35 @@
 #define _TEXTURE_UTILS_H
 
 #include <GLES/gl.h>
+#include <vector>
 
-unsigned char* uncompressTexture(GLenum internalformat,GLenum& formatOut,GLsizei width,GLsizei height,GLsizei imageSize, const GLvoid* data,GLint level);
+//
+// uncompressTexture - decodes the mipmap levels [0,nLevels) of a paletted
+// texture image to RGBA8 pixels, all levels one after the other in 'pixels'.
+// levelOffsets[i] receives the byte offset of level i. formatOut is the
+// internal format matching the palette (GL_RGB or GL_RGBA).
+// Returns false if the data does not even hold the palette.
+//
+bool uncompressTexture(GLenum internalformat,GLenum& formatOut,GLsizei width,GLsizei height,GLsizei imageSize,const GLvoid* data,int nLevels,
+                       std::vector<unsigned char>& pixels,unsigned int* levelOffsets);
+
+//
+// Packed 16 bits texel types (GL_UNSIGNED_SHORT_5_6_5, _4_4_4_4, _5_5_5_1)
+// take a slow CPU conversion path in many desktop drivers.
+// convertPackedTexels expands a width x height image of such texels to
+// RGBA8, rows of both images padded to 'alignment' bytes like
+// GL_UNPACK_ALIGNMENT does. 'dst' must hold packedTexelsSize() bytes.
+//
+bool isPackedTexelType(GLenum type);
+unsigned int packedTexelsSize(GLsizei width,GLsizei height,int alignment);
+void convertPackedTexels(GLenum type,GLsizei width,GLsizei height,int alignment,const GLvoid* src,unsigned char* dst);
+
+//
+// ETC1 (OES_compressed_ETC1_RGB8_texture) helpers. etc1DecodeImage writes
+// the RGB888 pixels of a width x height image, rows are 'stride' bytes
+// apart. 'data' must hold etc1DataSize(width,height) bytes.
+//
+unsigned int etc1DataSize(GLsizei width,GLsizei height);
+void etc1DecodeImage(const GLvoid* data,GLsizei width,GLsizei height,unsigned char* pixels,int stride);
 
 #endif
@@ -0,0 +1,48 @@
+LOCAL_PATH := $(call my-dir)
+
+### GLES_V2 host implementation (On top of OpenGL) ########################
+include $(CLEAR_VARS)
+
+translator_path := $(LOCAL_PATH)/..
+#exclude darwin builds until the CGL backend has been built on a Mac
+ifeq (, $(findstring $(HOST_OS), darwin))
+
+LOCAL_SRC_FILES :=       \
+     GLESv2Dispatch.cpp  \
+     GLESv2Context.cpp   \
+     GLESv2Imp.cpp       \
+     ShaderParser.cpp    \
+     ProgramData.cpp     \
+     ProgramCache.cpp
+
+LOCAL_C_INCLUDES += \
+                 $(translator_path)/include \
+                 $(translator_path)/../../../shared
+
+LOCAL_STATIC_LIBRARIES := \
+    libOpenglOsUtils      \
+    libutils              \
+    libcutils
+
+LOCAL_SHARED_LIBRARIES := \
+    libGLcommon
+
+LOCAL_CFLAGS := -g -O0
+LOCAL_MODULE_TAGS := debug
+LOCAL_MODULE := libGLES_V2_translator
+
+ifeq ($(HOST_OS),linux)
+    LOCAL_LDLIBS := -lGL -ldl
+endif
+
+ifeq ($(HOST_OS),windows)
+    LOCAL_LDLIBS := -lopengl32 -lgdi32
+endif
+
+ifeq ($(HOST_OS),darwin)
+    LOCAL_LDLIBS := -Wl,-framework,OpenGL
+endif
+
+include $(BUILD_HOST_SHARED_LIBRARY)
+
+endif
@@ -0,0 +1,55 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "GLESv2Context.h"
+#include <string.h>
+
+GLESv2Dispatch GLESv2Context::s_glDispatch;
+GLv2support    GLESv2Context::s_glSupport;
+android::Mutex GLESv2Context::s_lock;
+
+GLESv2Context::GLESv2Context():m_glError(GL_NO_ERROR),m_activeTexture(0),m_initialized(false) {
+    memset(m_tex2DBind,0,sizeof(m_tex2DBind));
+}
+
+GLESv2Context::~GLESv2Context() {
+}
+
+void GLESv2Context::init() {
+    android::Mutex::Autolock mutex(s_lock);
+    if(!m_initialized) {
+        int maxTexUnits;
+        s_glDispatch.dispatchFuncs();
+        s_glDispatch.glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS,&maxTexUnits);
+        s_glSupport.maxTexUnits = maxTexUnits < MAX_TEX_UNITS ? maxTexUnits:MAX_TEX_UNITS;
+    }
+    m_initialized = true;
+}
+
+GLESv2Dispatch& GLESv2Context::dispatcher() {
+    return s_glDispatch;
+}
+
+GLenum GLESv2Context::getGLerror() {
+    return m_glError;
+}
+
+void GLESv2Context::setGLerror(GLenum err) {
+    m_glError = err;
+}
+
+void GLESv2Context::setActiveTexture(GLenum tex) {
+    m_activeTexture = tex - GL_TEXTURE0;
+}
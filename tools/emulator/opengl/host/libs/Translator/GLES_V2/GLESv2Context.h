@@ -0,0 +1,68 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef GLES_V2_CONTEXT_H
+#define GLES_V2_CONTEXT_H
+
+#include "GLESv2Dispatch.h"
+#include <GLcommon/objectNameManager.h>
+#include <utils/threads.h>
+
+#define MAX_TEX_UNITS 8
+
+struct GLv2support {
+    GLv2support():maxTexUnits(0){};
+    int  maxTexUnits;
+};
+
+//
+// GLESv2Context - the translator state of one GLES 2.0 context. Object
+//    names seen by the application are local to its share group, the
+//    driver is given the global names (see ShareGroup). Most of the state
+//    lives in the driver, this only tracks what the translator needs
+//    itself: the pending error and the textures bound to each unit, by
+//    local name, for EGLImage targets.
+//
+class GLESv2Context
+{
+public:
+    void init();
+    GLESv2Context();
+    ~GLESv2Context();
+
+    GLenum getGLerror();
+    void   setGLerror(GLenum err);
+    void   setShareGroup(ShareGroupPtr grp){m_shareGroup = grp;};
+
+    void setActiveTexture(GLenum tex);
+    unsigned int getBindedTexture(){return m_tex2DBind[m_activeTexture];};
+    void setBindedTexture(unsigned int tex){m_tex2DBind[m_activeTexture] = tex;};
+
+    static GLESv2Dispatch& dispatcher();
+    static int getMaxTexUnits(){return s_glSupport.maxTexUnits;}
+
+private:
+    static GLESv2Dispatch s_glDispatch;
+    static GLv2support    s_glSupport;
+    static android::Mutex s_lock;
+
+    GLenum                m_glError;
+    unsigned int          m_activeTexture;
+    unsigned int          m_tex2DBind[MAX_TEX_UNITS];
+    bool                  m_initialized;
+    ShareGroupPtr         m_shareGroup;
+};
+
+#endif
@@ -0,0 +1,220 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "GLESv2Dispatch.h"
+#include <stdio.h>
+#include <string.h>
+#include <OpenglOsUtils/osDynLibrary.h>
+
+#ifdef __linux__
+#include <GL/glx.h>
+#elif defined(WIN32)
+#include <windows.h>
+#endif
+
+typedef void (*GL_FUNC_PTR)();
+
+static GL_FUNC_PTR getGLFuncAddress(const char *funcName) {
+    GL_FUNC_PTR ret = NULL;
+#ifdef __linux__
+    static osUtils::dynLibrary* libGL = osUtils::dynLibrary::open("libGL.so");
+    ret = (GL_FUNC_PTR)glXGetProcAddress((const GLubyte*)funcName);
+#elif defined(WIN32)
+    static osUtils::dynLibrary* libGL = osUtils::dynLibrary::open("opengl32");
+    ret = (GL_FUNC_PTR)wglGetProcAddress(funcName);
+#elif defined(__APPLE__)
+    //every entry point of the framework is exported
+    static osUtils::dynLibrary* libGL = osUtils::dynLibrary::open("/System/Library/Frameworks/OpenGL.framework/OpenGL");
+#endif
+    if(!ret && libGL){
+        ret = libGL->findSymbol(funcName);
+    }
+    return ret;
+}
+
+#define LOAD_GL_FUNC(name)  {   void * funcAddrs = NULL;              \
+                funcAddrs = (void *)getGLFuncAddress(#name);          \
+                if(funcAddrs)                                         \
+                    *(void**)(&name) = funcAddrs;                     \
+                else                          \
+                    fprintf(stderr,"could not load func %s\n",#name); }
+
+//framebuffer objects functions, core in OpenGL 3.0 and EXT before
+#define LOAD_GL_FBO_FUNC(name)  {   void * funcAddrs = NULL;          \
+                funcAddrs = (void *)getGLFuncAddress(#name);          \
+                if(!funcAddrs)                                        \
+                    funcAddrs = (void *)getGLFuncAddress(#name "EXT");\
+                if(funcAddrs)                                         \
+                    *(void**)(&name) = funcAddrs;                     \
+                else                          \
+                    fprintf(stderr,"could not load func %s\n",#name); }
+
+//functions the translator can do without, they are left NULL
+#define LOAD_GL_OPTIONAL_FUNC(name)  {                                \
+                *(void**)(&name) = (void *)getGLFuncAddress(#name); }
+
+GLESv2Dispatch::GLESv2Dispatch():m_isLoaded(false){};
+
+
+void GLESv2Dispatch::dispatchFuncs() {
+    android::Mutex::Autolock mutex(m_lock);
+    if(m_isLoaded)
+        return;
+    LOAD_GL_FUNC(glActiveTexture);
+    LOAD_GL_FUNC(glAttachShader);
+    LOAD_GL_FUNC(glBindAttribLocation);
+    LOAD_GL_FUNC(glBindBuffer);
+    LOAD_GL_FBO_FUNC(glBindFramebuffer);
+    LOAD_GL_FBO_FUNC(glBindRenderbuffer);
+    LOAD_GL_FUNC(glBindTexture);
+    LOAD_GL_FUNC(glBlendColor);
+    LOAD_GL_FUNC(glBlendEquation);
+    LOAD_GL_FUNC(glBlendEquationSeparate);
+    LOAD_GL_FUNC(glBlendFunc);
+    LOAD_GL_FUNC(glBlendFuncSeparate);
+    LOAD_GL_FUNC(glBufferData);
+    LOAD_GL_FUNC(glBufferSubData);
+    LOAD_GL_FBO_FUNC(glCheckFramebufferStatus);
+    LOAD_GL_FUNC(glClear);
+    LOAD_GL_FUNC(glClearColor);
+    LOAD_GL_FUNC(glClearDepth);
+    LOAD_GL_FUNC(glClearStencil);
+    LOAD_GL_FUNC(glColorMask);
+    LOAD_GL_FUNC(glCompileShader);
+    LOAD_GL_FUNC(glCompressedTexImage2D);
+    LOAD_GL_FUNC(glCompressedTexSubImage2D);
+    LOAD_GL_FUNC(glCopyTexImage2D);
+    LOAD_GL_FUNC(glCopyTexSubImage2D);
+    LOAD_GL_FUNC(glCreateProgram);
+    LOAD_GL_FUNC(glCreateShader);
+    LOAD_GL_FUNC(glCullFace);
+    LOAD_GL_FUNC(glDeleteBuffers);
+    LOAD_GL_FBO_FUNC(glDeleteFramebuffers);
+    LOAD_GL_FUNC(glDeleteProgram);
+    LOAD_GL_FBO_FUNC(glDeleteRenderbuffers);
+    LOAD_GL_FUNC(glDeleteShader);
+    LOAD_GL_FUNC(glDeleteTextures);
+    LOAD_GL_FUNC(glDepthFunc);
+    LOAD_GL_FUNC(glDepthMask);
+    LOAD_GL_FUNC(glDepthRange);
+    LOAD_GL_FUNC(glDetachShader);
+    LOAD_GL_FUNC(glDisable);
+    LOAD_GL_FUNC(glDisableVertexAttribArray);
+    LOAD_GL_FUNC(glDrawArrays);
+    LOAD_GL_FUNC(glDrawElements);
+    LOAD_GL_FUNC(glEnable);
+    LOAD_GL_FUNC(glEnableVertexAttribArray);
+    LOAD_GL_FUNC(glFinish);
+    LOAD_GL_FUNC(glFlush);
+    LOAD_GL_FBO_FUNC(glFramebufferRenderbuffer);
+    LOAD_GL_FBO_FUNC(glFramebufferTexture2D);
+    LOAD_GL_FUNC(glFrontFace);
+    LOAD_GL_FUNC(glGenBuffers);
+    LOAD_GL_FBO_FUNC(glGenFramebuffers);
+    LOAD_GL_FBO_FUNC(glGenRenderbuffers);
+    LOAD_GL_FUNC(glGenTextures);
+    LOAD_GL_FBO_FUNC(glGenerateMipmap);
+    LOAD_GL_FUNC(glGetActiveAttrib);
+    LOAD_GL_FUNC(glGetActiveUniform);
+    LOAD_GL_FUNC(glGetAttachedShaders);
+    LOAD_GL_FUNC(glGetAttribLocation);
+    LOAD_GL_FUNC(glGetBooleanv);
+    LOAD_GL_FUNC(glGetBufferParameteriv);
+    LOAD_GL_FUNC(glGetError);
+    LOAD_GL_FUNC(glGetFloatv);
+    LOAD_GL_FBO_FUNC(glGetFramebufferAttachmentParameteriv);
+    LOAD_GL_FUNC(glGetIntegerv);
+    LOAD_GL_FUNC(glGetProgramInfoLog);
+    LOAD_GL_FUNC(glGetProgramiv);
+    LOAD_GL_FBO_FUNC(glGetRenderbufferParameteriv);
+    LOAD_GL_FUNC(glGetShaderInfoLog);
+    LOAD_GL_FUNC(glGetShaderSource);
+    LOAD_GL_FUNC(glGetShaderiv);
+    LOAD_GL_FUNC(glGetString);
+    LOAD_GL_FUNC(glGetTexParameterfv);
+    LOAD_GL_FUNC(glGetTexParameteriv);
+    LOAD_GL_FUNC(glGetUniformLocation);
+    LOAD_GL_FUNC(glGetUniformfv);
+    LOAD_GL_FUNC(glGetUniformiv);
+    LOAD_GL_FUNC(glGetVertexAttribPointerv);
+    LOAD_GL_FUNC(glGetVertexAttribfv);
+    LOAD_GL_FUNC(glGetVertexAttribiv);
+    LOAD_GL_FUNC(glHint);
+    LOAD_GL_FUNC(glIsBuffer);
+    LOAD_GL_FUNC(glIsEnabled);
+    LOAD_GL_FBO_FUNC(glIsFramebuffer);
+    LOAD_GL_FUNC(glIsProgram);
+    LOAD_GL_FBO_FUNC(glIsRenderbuffer);
+    LOAD_GL_FUNC(glIsShader);
+    LOAD_GL_FUNC(glIsTexture);
+    LOAD_GL_FUNC(glLineWidth);
+    LOAD_GL_FUNC(glLinkProgram);
+    LOAD_GL_FUNC(glPixelStorei);
+    LOAD_GL_FUNC(glPolygonOffset);
+    LOAD_GL_FUNC(glReadPixels);
+    LOAD_GL_FBO_FUNC(glRenderbufferStorage);
+    LOAD_GL_FUNC(glSampleCoverage);
+    LOAD_GL_FUNC(glScissor);
+    LOAD_GL_FUNC(glShaderSource);
+    LOAD_GL_FUNC(glStencilFunc);
+    LOAD_GL_FUNC(glStencilFuncSeparate);
+    LOAD_GL_FUNC(glStencilMask);
+    LOAD_GL_FUNC(glStencilMaskSeparate);
+    LOAD_GL_FUNC(glStencilOp);
+    LOAD_GL_FUNC(glStencilOpSeparate);
+    LOAD_GL_FUNC(glTexImage2D);
+    LOAD_GL_FUNC(glTexParameterf);
+    LOAD_GL_FUNC(glTexParameterfv);
+    LOAD_GL_FUNC(glTexParameteri);
+    LOAD_GL_FUNC(glTexParameteriv);
+    LOAD_GL_FUNC(glTexSubImage2D);
+    LOAD_GL_FUNC(glUniform1f);
+    LOAD_GL_FUNC(glUniform1fv);
+    LOAD_GL_FUNC(glUniform1i);
+    LOAD_GL_FUNC(glUniform1iv);
+    LOAD_GL_FUNC(glUniform2f);
+    LOAD_GL_FUNC(glUniform2fv);
+    LOAD_GL_FUNC(glUniform2i);
+    LOAD_GL_FUNC(glUniform2iv);
+    LOAD_GL_FUNC(glUniform3f);
+    LOAD_GL_FUNC(glUniform3fv);
+    LOAD_GL_FUNC(glUniform3i);
+    LOAD_GL_FUNC(glUniform3iv);
+    LOAD_GL_FUNC(glUniform4f);
+    LOAD_GL_FUNC(glUniform4fv);
+    LOAD_GL_FUNC(glUniform4i);
+    LOAD_GL_FUNC(glUniform4iv);
+    LOAD_GL_FUNC(glUniformMatrix2fv);
+    LOAD_GL_FUNC(glUniformMatrix3fv);
+    LOAD_GL_FUNC(glUniformMatrix4fv);
+    LOAD_GL_FUNC(glUseProgram);
+    LOAD_GL_FUNC(glValidateProgram);
+    LOAD_GL_FUNC(glVertexAttrib1f);
+    LOAD_GL_FUNC(glVertexAttrib1fv);
+    LOAD_GL_FUNC(glVertexAttrib2f);
+    LOAD_GL_FUNC(glVertexAttrib2fv);
+    LOAD_GL_FUNC(glVertexAttrib3f);
+    LOAD_GL_FUNC(glVertexAttrib3fv);
+    LOAD_GL_FUNC(glVertexAttrib4f);
+    LOAD_GL_FUNC(glVertexAttrib4fv);
+    LOAD_GL_FUNC(glVertexAttribPointer);
+    LOAD_GL_FUNC(glViewport);
+
+    LOAD_GL_OPTIONAL_FUNC(glGetProgramBinary);
+    LOAD_GL_OPTIONAL_FUNC(glProgramBinary);
+    LOAD_GL_OPTIONAL_FUNC(glProgramParameteri);
+
+    m_isLoaded = true;
+}
@@ -0,0 +1,187 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef GLES_V2_DISPATCH_H
+#define GLES_V2_DISPATCH_H
+
+#include <GLES2/gl2.h>
+#include <utils/threads.h>
+
+#define GLAPIENTRY GL_APIENTRY
+
+typedef double      GLclampd;   /* double precision float in [0,1] */
+
+//
+// GLESv2Dispatch - the desktop OpenGL 2.0 functions the GLES 2.0
+// translator forwards to. The framebuffer objects functions are taken from
+// EXT_framebuffer_object when the driver does not have the core ones.
+//
+class GLESv2Dispatch
+{
+public:
+
+    GLESv2Dispatch();
+    void dispatchFuncs();
+
+    void (GLAPIENTRY *glActiveTexture) (GLenum texture);
+    void (GLAPIENTRY *glAttachShader) (GLuint program, GLuint shader);
+    void (GLAPIENTRY *glBindAttribLocation) (GLuint program, GLuint index, const char* name);
+    void (GLAPIENTRY *glBindBuffer) (GLenum target, GLuint buffer);
+    void (GLAPIENTRY *glBindFramebuffer) (GLenum target, GLuint framebuffer);
+    void (GLAPIENTRY *glBindRenderbuffer) (GLenum target, GLuint renderbuffer);
+    void (GLAPIENTRY *glBindTexture) (GLenum target, GLuint texture);
+    void (GLAPIENTRY *glBlendColor) (GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha);
+    void (GLAPIENTRY *glBlendEquation) (GLenum mode);
+    void (GLAPIENTRY *glBlendEquationSeparate) (GLenum modeRGB, GLenum modeAlpha);
+    void (GLAPIENTRY *glBlendFunc) (GLenum sfactor, GLenum dfactor);
+    void (GLAPIENTRY *glBlendFuncSeparate) (GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha);
+    void (GLAPIENTRY *glBufferData) (GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+    void (GLAPIENTRY *glBufferSubData) (GLenum target, GLintptr offset, GLsizeiptr size, const void* data);
+    GLenum (GLAPIENTRY *glCheckFramebufferStatus) (GLenum target);
+    void (GLAPIENTRY *glClear) (GLbitfield mask);
+    void (GLAPIENTRY *glClearColor) (GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha);
+    void (GLAPIENTRY *glClearDepth) (GLclampd depth);
+    void (GLAPIENTRY *glClearStencil) (GLint s);
+    void (GLAPIENTRY *glColorMask) (GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha);
+    void (GLAPIENTRY *glCompileShader) (GLuint shader);
+    void (GLAPIENTRY *glCompressedTexImage2D) (GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const void* data);
+    void (GLAPIENTRY *glCompressedTexSubImage2D) (GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, const void* data);
+    void (GLAPIENTRY *glCopyTexImage2D) (GLenum target, GLint level, GLenum internalformat, GLint x, GLint y, GLsizei width, GLsizei height, GLint border);
+    void (GLAPIENTRY *glCopyTexSubImage2D) (GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint x, GLint y, GLsizei width, GLsizei height);
+    GLuint (GLAPIENTRY *glCreateProgram) (void);
+    GLuint (GLAPIENTRY *glCreateShader) (GLenum type);
+    void (GLAPIENTRY *glCullFace) (GLenum mode);
+    void (GLAPIENTRY *glDeleteBuffers) (GLsizei n, const GLuint* buffers);
+    void (GLAPIENTRY *glDeleteFramebuffers) (GLsizei n, const GLuint* framebuffers);
+    void (GLAPIENTRY *glDeleteProgram) (GLuint program);
+    void (GLAPIENTRY *glDeleteRenderbuffers) (GLsizei n, const GLuint* renderbuffers);
+    void (GLAPIENTRY *glDeleteShader) (GLuint shader);
+    void (GLAPIENTRY *glDeleteTextures) (GLsizei n, const GLuint* textures);
+    void (GLAPIENTRY *glDepthFunc) (GLenum func);
+    void (GLAPIENTRY *glDepthMask) (GLboolean flag);
+    void (GLAPIENTRY *glDepthRange) (GLclampd zNear, GLclampd zFar);
+    void (GLAPIENTRY *glDetachShader) (GLuint program, GLuint shader);
+    void (GLAPIENTRY *glDisable) (GLenum cap);
+    void (GLAPIENTRY *glDisableVertexAttribArray) (GLuint index);
+    void (GLAPIENTRY *glDrawArrays) (GLenum mode, GLint first, GLsizei count);
+    void (GLAPIENTRY *glDrawElements) (GLenum mode, GLsizei count, GLenum type, const void* indices);
+    void (GLAPIENTRY *glEnable) (GLenum cap);
+    void (GLAPIENTRY *glEnableVertexAttribArray) (GLuint index);
+    void (GLAPIENTRY *glFinish) (void);
+    void (GLAPIENTRY *glFlush) (void);
+    void (GLAPIENTRY *glFramebufferRenderbuffer) (GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer);
+    void (GLAPIENTRY *glFramebufferTexture2D) (GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+    void (GLAPIENTRY *glFrontFace) (GLenum mode);
+    void (GLAPIENTRY *glGenBuffers) (GLsizei n, GLuint* buffers);
+    void (GLAPIENTRY *glGenFramebuffers) (GLsizei n, GLuint* framebuffers);
+    void (GLAPIENTRY *glGenRenderbuffers) (GLsizei n, GLuint* renderbuffers);
+    void (GLAPIENTRY *glGenTextures) (GLsizei n, GLuint* textures);
+    void (GLAPIENTRY *glGenerateMipmap) (GLenum target);
+    void (GLAPIENTRY *glGetActiveAttrib) (GLuint program, GLuint index, GLsizei bufsize, GLsizei* length, GLint* size, GLenum* type, char* name);
+    void (GLAPIENTRY *glGetActiveUniform) (GLuint program, GLuint index, GLsizei bufsize, GLsizei* length, GLint* size, GLenum* type, char* name);
+    void (GLAPIENTRY *glGetAttachedShaders) (GLuint program, GLsizei maxcount, GLsizei* count, GLuint* shaders);
+    int (GLAPIENTRY *glGetAttribLocation) (GLuint program, const char* name);
+    void (GLAPIENTRY *glGetBooleanv) (GLenum pname, GLboolean* params);
+    void (GLAPIENTRY *glGetBufferParameteriv) (GLenum target, GLenum pname, GLint* params);
+    GLenum (GLAPIENTRY *glGetError) (void);
+    void (GLAPIENTRY *glGetFloatv) (GLenum pname, GLfloat* params);
+    void (GLAPIENTRY *glGetFramebufferAttachmentParameteriv) (GLenum target, GLenum attachment, GLenum pname, GLint* params);
+    void (GLAPIENTRY *glGetIntegerv) (GLenum pname, GLint* params);
+    void (GLAPIENTRY *glGetProgramInfoLog) (GLuint program, GLsizei bufsize, GLsizei* length, char* infolog);
+    void (GLAPIENTRY *glGetProgramiv) (GLuint program, GLenum pname, GLint* params);
+    void (GLAPIENTRY *glGetRenderbufferParameteriv) (GLenum target, GLenum pname, GLint* params);
+    void (GLAPIENTRY *glGetShaderInfoLog) (GLuint shader, GLsizei bufsize, GLsizei* length, char* infolog);
+    void (GLAPIENTRY *glGetShaderSource) (GLuint shader, GLsizei bufsize, GLsizei* length, char* source);
+    void (GLAPIENTRY *glGetShaderiv) (GLuint shader, GLenum pname, GLint* params);
+    const GLubyte* (GLAPIENTRY *glGetString) (GLenum name);
+    void (GLAPIENTRY *glGetTexParameterfv) (GLenum target, GLenum pname, GLfloat* params);
+    void (GLAPIENTRY *glGetTexParameteriv) (GLenum target, GLenum pname, GLint* params);
+    int (GLAPIENTRY *glGetUniformLocation) (GLuint program, const char* name);
+    void (GLAPIENTRY *glGetUniformfv) (GLuint program, GLint location, GLfloat* params);
+    void (GLAPIENTRY *glGetUniformiv) (GLuint program, GLint location, GLint* params);
+    void (GLAPIENTRY *glGetVertexAttribPointerv) (GLuint index, GLenum pname, void** pointer);
+    void (GLAPIENTRY *glGetVertexAttribfv) (GLuint index, GLenum pname, GLfloat* params);
+    void (GLAPIENTRY *glGetVertexAttribiv) (GLuint index, GLenum pname, GLint* params);
+    void (GLAPIENTRY *glHint) (GLenum target, GLenum mode);
+    GLboolean (GLAPIENTRY *glIsBuffer) (GLuint buffer);
+    GLboolean (GLAPIENTRY *glIsEnabled) (GLenum cap);
+    GLboolean (GLAPIENTRY *glIsFramebuffer) (GLuint framebuffer);
+    GLboolean (GLAPIENTRY *glIsProgram) (GLuint program);
+    GLboolean (GLAPIENTRY *glIsRenderbuffer) (GLuint renderbuffer);
+    GLboolean (GLAPIENTRY *glIsShader) (GLuint shader);
+    GLboolean (GLAPIENTRY *glIsTexture) (GLuint texture);
+    void (GLAPIENTRY *glLineWidth) (GLfloat width);
+    void (GLAPIENTRY *glLinkProgram) (GLuint program);
+    void (GLAPIENTRY *glPixelStorei) (GLenum pname, GLint param);
+    void (GLAPIENTRY *glPolygonOffset) (GLfloat factor, GLfloat units);
+    void (GLAPIENTRY *glReadPixels) (GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels);
+    void (GLAPIENTRY *glRenderbufferStorage) (GLenum target, GLenum internalformat, GLsizei width, GLsizei height);
+    void (GLAPIENTRY *glSampleCoverage) (GLclampf value, GLboolean invert);
+    void (GLAPIENTRY *glScissor) (GLint x, GLint y, GLsizei width, GLsizei height);
+    void (GLAPIENTRY *glShaderSource) (GLuint shader, GLsizei count, const char** string, const GLint* length);
+    void (GLAPIENTRY *glStencilFunc) (GLenum func, GLint ref, GLuint mask);
+    void (GLAPIENTRY *glStencilFuncSeparate) (GLenum face, GLenum func, GLint ref, GLuint mask);
+    void (GLAPIENTRY *glStencilMask) (GLuint mask);
+    void (GLAPIENTRY *glStencilMaskSeparate) (GLenum face, GLuint mask);
+    void (GLAPIENTRY *glStencilOp) (GLenum fail, GLenum zfail, GLenum zpass);
+    void (GLAPIENTRY *glStencilOpSeparate) (GLenum face, GLenum fail, GLenum zfail, GLenum zpass);
+    void (GLAPIENTRY *glTexImage2D) (GLenum target, GLint level, GLint internalformat,  GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const GLvoid* pixels);
+    void (GLAPIENTRY *glTexParameterf) (GLenum target, GLenum pname, GLfloat param);
+    void (GLAPIENTRY *glTexParameterfv) (GLenum target, GLenum pname, const GLfloat* params);
+    void (GLAPIENTRY *glTexParameteri) (GLenum target, GLenum pname, GLint param);
+    void (GLAPIENTRY *glTexParameteriv) (GLenum target, GLenum pname, const GLint* params);
+    void (GLAPIENTRY *glTexSubImage2D) (GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels);
+    void (GLAPIENTRY *glUniform1f) (GLint location, GLfloat x);
+    void (GLAPIENTRY *glUniform1fv) (GLint location, GLsizei count, const GLfloat* v);
+    void (GLAPIENTRY *glUniform1i) (GLint location, GLint x);
+    void (GLAPIENTRY *glUniform1iv) (GLint location, GLsizei count, const GLint* v);
+    void (GLAPIENTRY *glUniform2f) (GLint location, GLfloat x, GLfloat y);
+    void (GLAPIENTRY *glUniform2fv) (GLint location, GLsizei count, const GLfloat* v);
+    void (GLAPIENTRY *glUniform2i) (GLint location, GLint x, GLint y);
+    void (GLAPIENTRY *glUniform2iv) (GLint location, GLsizei count, const GLint* v);
+    void (GLAPIENTRY *glUniform3f) (GLint location, GLfloat x, GLfloat y, GLfloat z);
+    void (GLAPIENTRY *glUniform3fv) (GLint location, GLsizei count, const GLfloat* v);
+    void (GLAPIENTRY *glUniform3i) (GLint location, GLint x, GLint y, GLint z);
+    void (GLAPIENTRY *glUniform3iv) (GLint location, GLsizei count, const GLint* v);
+    void (GLAPIENTRY *glUniform4f) (GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w);
+    void (GLAPIENTRY *glUniform4fv) (GLint location, GLsizei count, const GLfloat* v);
+    void (GLAPIENTRY *glUniform4i) (GLint location, GLint x, GLint y, GLint z, GLint w);
+    void (GLAPIENTRY *glUniform4iv) (GLint location, GLsizei count, const GLint* v);
+    void (GLAPIENTRY *glUniformMatrix2fv) (GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+    void (GLAPIENTRY *glUniformMatrix3fv) (GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+    void (GLAPIENTRY *glUniformMatrix4fv) (GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+    void (GLAPIENTRY *glUseProgram) (GLuint program);
+    void (GLAPIENTRY *glValidateProgram) (GLuint program);
+    void (GLAPIENTRY *glVertexAttrib1f) (GLuint indx, GLfloat x);
+    void (GLAPIENTRY *glVertexAttrib1fv) (GLuint indx, const GLfloat* values);
+    void (GLAPIENTRY *glVertexAttrib2f) (GLuint indx, GLfloat x, GLfloat y);
+    void (GLAPIENTRY *glVertexAttrib2fv) (GLuint indx, const GLfloat* values);
+    void (GLAPIENTRY *glVertexAttrib3f) (GLuint indx, GLfloat x, GLfloat y, GLfloat z);
+    void (GLAPIENTRY *glVertexAttrib3fv) (GLuint indx, const GLfloat* values);
+    void (GLAPIENTRY *glVertexAttrib4f) (GLuint indx, GLfloat x, GLfloat y, GLfloat z, GLfloat w);
+    void (GLAPIENTRY *glVertexAttrib4fv) (GLuint indx, const GLfloat* values);
+    void (GLAPIENTRY *glVertexAttribPointer) (GLuint indx, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* ptr);
+    void (GLAPIENTRY *glViewport) (GLint x, GLint y, GLsizei width, GLsizei height);
+
+    //ARB_get_program_binary, NULL when the driver does not have it
+    void (GLAPIENTRY *glGetProgramBinary) (GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+    void (GLAPIENTRY *glProgramBinary) (GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+    void (GLAPIENTRY *glProgramParameteri) (GLuint program, GLenum pname, GLint value);
+private:
+    bool             m_isLoaded;
+    android::Mutex   m_lock;
+};
+
+#endif
@@ -0,0 +1,1408 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifdef _WIN32
+#undef  GL_APICALL
+#define GL_APICALL __declspec(dllexport)
+#endif
+#include <stdio.h>
+#include <string.h>
+#include "GLESv2Context.h"
+#include "ShaderParser.h"
+#include "ProgramData.h"
+#include "ProgramCache.h"
+
+#include <GLcommon/TranslatorIfaces.h>
+#include <GLcommon/ThreadInfo.h>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+//desktop only limits, the GLES ones are given in vectors
+#ifndef GL_MAX_FRAGMENT_UNIFORM_COMPONENTS
+#define GL_MAX_FRAGMENT_UNIFORM_COMPONENTS 0x8B49
+#endif
+#ifndef GL_MAX_VERTEX_UNIFORM_COMPONENTS
+#define GL_MAX_VERTEX_UNIFORM_COMPONENTS   0x8B4A
+#endif
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_MAX_VARYING_FLOATS
+#define GL_MAX_VARYING_FLOATS              0x8B4B
+#endif
+
+//
+// The GLES interface is shared with the GLES 1.1 translator and only
+// passes its contexts around as opaque GLEScontext pointers.
+//
+extern "C" {
+
+//decleration
+static void initContext(GLEScontext* ctx);
+static void deleteGLESContext(GLEScontext* ctx);
+static void setShareGroup(GLEScontext* ctx,ShareGroupPtr grp);
+static GLEScontext* createGLESContext();
+static __translatorMustCastToProperFunctionPointerType getProcAddress(const char* procName);
+
+}
+
+/************************************** GLES EXTENSIONS *********************************************************/
+#define GLES_EXTENTIONS 2
+//extensions decleration, exported as well for the renderer which loads them by name
+extern "C" {
+GL_APICALL void GL_APIENTRY glEGLImageTargetTexture2DOES(GLenum target, GLeglImageOES image);
+GL_APICALL void GL_APIENTRY glEGLImageTargetRenderbufferStorageOES(GLenum target, GLeglImageOES image);
+}
+
+//extentions descriptor
+static ExtentionDescriptor s_glesExtentions[] = {
+                                                    {"glEGLImageTargetTexture2DOES",(__translatorMustCastToProperFunctionPointerType)glEGLImageTargetTexture2DOES},
+                                                    {"glEGLImageTargetRenderbufferStorageOES",(__translatorMustCastToProperFunctionPointerType)glEGLImageTargetRenderbufferStorageOES}
+                                                };
+/****************************************************************************************************************/
+typedef void(*FUNCPTR)();
+
+static EGLiface*  s_eglIface = NULL;
+static GLESiface  s_glesIface = {
+    createGLESContext:createGLESContext,
+    initContext      :initContext,
+    deleteGLESContext:deleteGLESContext,
+    flush            :(FUNCPTR)glFlush,
+    finish           :(FUNCPTR)glFinish,
+    setShareGroup    :setShareGroup,
+    getProcAddress   :getProcAddress
+};
+
+extern "C" {
+
+static void initContext(GLEScontext* ctx) {
+    reinterpret_cast<GLESv2Context*>(ctx)->init();
+}
+static GLEScontext* createGLESContext() {
+    return reinterpret_cast<GLEScontext*>(new GLESv2Context());
+}
+
+static void deleteGLESContext(GLEScontext* ctx) {
+    if(ctx) delete reinterpret_cast<GLESv2Context*>(ctx);
+}
+
+static void setShareGroup(GLEScontext* ctx,ShareGroupPtr grp) {
+    if(ctx) {
+        reinterpret_cast<GLESv2Context*>(ctx)->setShareGroup(grp);
+    }
+}
+
+static __translatorMustCastToProperFunctionPointerType getProcAddress(const char* procName) {
+    for(int i=0;i<GLES_EXTENTIONS;i++){
+        if(strcmp(procName,s_glesExtentions[i].name) == 0){
+            return s_glesExtentions[i].address;
+        }
+    }
+    return NULL;
+}
+GL_APICALL GLESiface* __translator_getIfaces(EGLiface* eglIface){
+    s_eglIface = eglIface;
+    return & s_glesIface;
+}
+
+}
+
+//
+// the ThreadInfo of a thread never changes, each thread keeps it here
+// rather than going through the EGL interface on every call
+//
+#ifdef __linux__
+static __thread ThreadInfo* s_threadInfo = NULL;
+#define CACHED_THREAD_INFO() s_threadInfo
+#define CACHE_THREAD_INFO(thrd) s_threadInfo = (thrd)
+#else
+#define CACHED_THREAD_INFO() NULL
+#define CACHE_THREAD_INFO(thrd)
+#endif
+
+#define GET_THREAD()                                                         \
+            ThreadInfo* thrd = CACHED_THREAD_INFO();                         \
+            if(!thrd) {                                                      \
+                if(s_eglIface) {                                             \
+                    thrd = s_eglIface->getThreadInfo();                      \
+                    CACHE_THREAD_INFO(thrd);                                 \
+                } else {                                                     \
+                    fprintf(stderr,"Context wasn't initialized yet \n");     \
+                }                                                            \
+            }
+
+
+#define GET_CTX()                                                            \
+            GET_THREAD();                                                    \
+            if(!thrd) return;                                                \
+            GLESv2Context *ctx = static_cast<GLESv2Context*>(thrd->glesContext); \
+            if(!ctx) return;
+
+#define GET_CTX_RET(failure_ret)                                             \
+            GET_THREAD();                                                    \
+            if(!thrd) return failure_ret;                                    \
+            GLESv2Context *ctx = static_cast<GLESv2Context*>(thrd->glesContext); \
+            if(!ctx) return failure_ret;
+
+
+#define SET_ERROR_IF(condition,err) if((condition)) {                        \
+                        ctx->setGLerror(err);                                \
+                        return;                                              \
+                    }
+
+
+#define RET_AND_SET_ERROR_IF(condition,err,ret) if((condition)) {            \
+                        ctx->setGLerror(err);                                \
+                        return ret;                                          \
+                    }
+
+/************************************** NAMES *******************************************************************/
+//global name of an object, 0 when it does not exist
+static GLuint localToGlobal(ThreadInfo* thrd,NamedObjectType type,GLuint name) {
+    if(!name || !thrd->shareGroup.Ptr()) return name;
+    return thrd->shareGroup->getGlobalName(type,name);
+}
+
+static GLuint globalToLocal(ThreadInfo* thrd,NamedObjectType type,GLuint globalName) {
+    if(!globalName || !thrd->shareGroup.Ptr()) return globalName;
+    return thrd->shareGroup->getLocalName(type,globalName);
+}
+
+//binding a name which was never generated creates the object
+static GLuint bindGlobalName(ThreadInfo* thrd,NamedObjectType type,GLuint name) {
+    if(!name || !thrd->shareGroup.Ptr()) return name;
+    GLuint globalName = thrd->shareGroup->getGlobalName(type,name);
+    if(!globalName) {
+        thrd->shareGroup->genName(type,name);
+        globalName = thrd->shareGroup->getGlobalName(type,name);
+    }
+    return globalName;
+}
+
+//
+// shaders and programs names, the error for an unknown name depends on
+// whether it is the name of the other kind of object
+//
+static GLuint objectGlobalName(GLESv2Context* ctx,ThreadInfo* thrd,NamedObjectType type,NamedObjectType otherType,GLuint name) {
+    if(!thrd->shareGroup.Ptr()) return name;
+    GLuint globalName = thrd->shareGroup->getGlobalName(type,name);
+    if(!globalName) {
+        ctx->setGLerror(name && thrd->shareGroup->isObject(otherType,name) ? GL_INVALID_OPERATION : GL_INVALID_VALUE);
+    }
+    return globalName;
+}
+
+static GLuint shaderGlobalName(GLESv2Context* ctx,ThreadInfo* thrd,GLuint shader) {
+    return objectGlobalName(ctx,thrd,SHADER,PROGRAM,shader);
+}
+
+static GLuint programGlobalName(GLESv2Context* ctx,ThreadInfo* thrd,GLuint program) {
+    return objectGlobalName(ctx,thrd,PROGRAM,SHADER,program);
+}
+
+static ShaderParser* getShaderParser(ThreadInfo* thrd,GLuint shader) {
+    if(!thrd->shareGroup.Ptr()) return NULL;
+    return static_cast<ShaderParser*>(thrd->shareGroup->getObjectDataPtr(SHADER,shader));
+}
+
+static ProgramData* getProgramData(ThreadInfo* thrd,GLuint program) {
+    if(!thrd->shareGroup.Ptr()) return NULL;
+    return static_cast<ProgramData*>(thrd->shareGroup->getObjectDataPtr(PROGRAM,program));
+}
+
+//
+// programCacheKey - the inputs of linking 'program': the compiled sources
+//    of its shaders and its attribute bindings. Returns false when they
+//    are not all known to the translator.
+//
+static bool programCacheKey(ThreadInfo* thrd,GLuint program,std::string& key) {
+    ProgramData* programData = getProgramData(thrd,program);
+    if(!programData) return false;
+
+    const std::vector<GLuint>& shaders = programData->getAttachedShaders();
+    std::vector<std::string> sources;
+    for(unsigned int i = 0; i < shaders.size(); i++) {
+        ShaderParser* sp = getShaderParser(thrd,shaders[i]);
+        if(!sp || sp->compiledSrc().empty()) return false;
+        char header[32];
+        snprintf(header,sizeof(header),"%x %u\n",sp->getType(),(unsigned int)sp->compiledSrc().size());
+        sources.push_back(header + sp->compiledSrc());
+    }
+    //the attachment order does not change the link
+    std::sort(sources.begin(),sources.end());
+    for(unsigned int i = 0; i < sources.size(); i++) {
+        key += sources[i];
+    }
+
+    const AttribBindingsMap& attribs = programData->getAttribBindings();
+    for(AttribBindingsMap::const_iterator it = attribs.begin(); it != attribs.end(); it++) {
+        char index[16];
+        snprintf(index,sizeof(index),"=%u\n",(*it).second);
+        key += (*it).first + index;
+    }
+    return true;
+}
+
+/************************************** QUERIES *****************************************************************/
+#define MAX_ES_PARAMS 1
+
+static unsigned int esParamSize(GLenum pname) {
+    return pname == GL_SHADER_BINARY_FORMATS ? 0 : 1;
+}
+
+//
+// getIntegerES - the GLES queries the driver does not answer the GLES way:
+// bindings (given back as local names) and the GLES only limits.
+// Returns false for the other ones.
+//
+static bool getIntegerES(GLESv2Context* ctx,ThreadInfo* thrd,GLenum pname,GLint* params) {
+    GLint i = 0;
+    switch(pname) {
+    case GL_ARRAY_BUFFER_BINDING:
+    case GL_ELEMENT_ARRAY_BUFFER_BINDING:
+        ctx->dispatcher().glGetIntegerv(pname,&i);
+        *params = globalToLocal(thrd,VERTEXBUFFER,i);
+        return true;
+    case GL_TEXTURE_BINDING_2D:
+    case GL_TEXTURE_BINDING_CUBE_MAP:
+        ctx->dispatcher().glGetIntegerv(pname,&i);
+        *params = globalToLocal(thrd,TEXTURE,i);
+        return true;
+    case GL_FRAMEBUFFER_BINDING:
+        ctx->dispatcher().glGetIntegerv(pname,&i);
+        *params = globalToLocal(thrd,FRAMEBUFFER,i);
+        return true;
+    case GL_RENDERBUFFER_BINDING:
+        ctx->dispatcher().glGetIntegerv(pname,&i);
+        *params = globalToLocal(thrd,RENDERBUFFER,i);
+        return true;
+    case GL_CURRENT_PROGRAM:
+        ctx->dispatcher().glGetIntegerv(pname,&i);
+        *params = globalToLocal(thrd,PROGRAM,i);
+        return true;
+    case GL_MAX_VARYING_VECTORS:
+        ctx->dispatcher().glGetIntegerv(GL_MAX_VARYING_FLOATS,&i);
+        *params = i / 4;
+        return true;
+    case GL_MAX_VERTEX_UNIFORM_VECTORS:
+        ctx->dispatcher().glGetIntegerv(GL_MAX_VERTEX_UNIFORM_COMPONENTS,&i);
+        *params = i / 4;
+        return true;
+    case GL_MAX_FRAGMENT_UNIFORM_VECTORS:
+        ctx->dispatcher().glGetIntegerv(GL_MAX_FRAGMENT_UNIFORM_COMPONENTS,&i);
+        *params = i / 4;
+        return true;
+    case GL_SHADER_COMPILER:
+        *params = 1;
+        return true;
+    case GL_NUM_SHADER_BINARY_FORMATS:
+        *params = 0;
+        return true;
+    case GL_SHADER_BINARY_FORMATS:
+        return true;
+    case GL_IMPLEMENTATION_COLOR_READ_TYPE:
+        *params = GL_UNSIGNED_BYTE;
+        return true;
+    case GL_IMPLEMENTATION_COLOR_READ_FORMAT:
+        *params = GL_RGBA;
+        return true;
+    }
+    return false;
+}
+
+/************************************** ENTRY POINTS ************************************************************/
+
+GL_APICALL void GL_APIENTRY glActiveTexture(GLenum texture) {
+    GET_CTX()
+    SET_ERROR_IF(texture < GL_TEXTURE0 || texture >= GL_TEXTURE0 + static_cast<GLenum>(ctx->getMaxTexUnits()),GL_INVALID_ENUM);
+    ctx->setActiveTexture(texture);
+    ctx->dispatcher().glActiveTexture(texture);
+}
+
+GL_APICALL void GL_APIENTRY glAttachShader(GLuint program, GLuint shader) {
+    GET_CTX()
+    GLuint globalProgramName = programGlobalName(ctx,thrd,program);
+    GLuint globalShaderName  = shaderGlobalName(ctx,thrd,shader);
+    if(!globalProgramName || !globalShaderName) return;
+    ctx->dispatcher().glAttachShader(globalProgramName,globalShaderName);
+    ProgramData* programData = getProgramData(thrd,program);
+    if(programData) programData->attachShader(shader);
+}
+
+GL_APICALL void GL_APIENTRY glBindAttribLocation(GLuint program, GLuint index, const char* name) {
+    GET_CTX()
+    GLuint globalProgramName = programGlobalName(ctx,thrd,program);
+    if(!globalProgramName) return;
+    ctx->dispatcher().glBindAttribLocation(globalProgramName,index,name);
+    ProgramData* programData = getProgramData(thrd,program);
+    if(programData && name) programData->bindAttribLocation(name,index);
+}
+
+GL_APICALL void GL_APIENTRY glBindBuffer(GLenum target, GLuint buffer) {
+    GET_CTX()
+    ctx->dispatcher().glBindBuffer(target,bindGlobalName(thrd,VERTEXBUFFER,buffer));
+}
+
+GL_APICALL void GL_APIENTRY glBindFramebuffer(GLenum target, GLuint framebuffer) {
+    GET_CTX()
+    ctx->dispatcher().glBindFramebuffer(target,bindGlobalName(thrd,FRAMEBUFFER,framebuffer));
+}
+
+GL_APICALL void GL_APIENTRY glBindRenderbuffer(GLenum target, GLuint renderbuffer) {
+    GET_CTX()
+    ctx->dispatcher().glBindRenderbuffer(target,bindGlobalName(thrd,RENDERBUFFER,renderbuffer));
+}
+
+GL_APICALL void GL_APIENTRY glBindTexture(GLenum target, GLuint texture) {
+    GET_CTX()
+    GLuint globalTextureName = bindGlobalName(thrd,TEXTURE,texture);
+    if(target == GL_TEXTURE_2D) ctx->setBindedTexture(texture);
+    ctx->dispatcher().glBindTexture(target,globalTextureName);
+}
+
+GL_APICALL void GL_APIENTRY glBlendColor(GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha) {
+    GET_CTX()
+    ctx->dispatcher().glBlendColor(red,green,blue,alpha);
+}
+
+GL_APICALL void GL_APIENTRY glBlendEquation(GLenum mode) {
+    GET_CTX()
+    ctx->dispatcher().glBlendEquation(mode);
+}
+
+GL_APICALL void GL_APIENTRY glBlendEquationSeparate(GLenum modeRGB, GLenum modeAlpha) {
+    GET_CTX()
+    ctx->dispatcher().glBlendEquationSeparate(modeRGB,modeAlpha);
+}
+
+GL_APICALL void GL_APIENTRY glBlendFunc(GLenum sfactor, GLenum dfactor) {
+    GET_CTX()
+    ctx->dispatcher().glBlendFunc(sfactor,dfactor);
+}
+
+GL_APICALL void GL_APIENTRY glBlendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha) {
+    GET_CTX()
+    ctx->dispatcher().glBlendFuncSeparate(srcRGB,dstRGB,srcAlpha,dstAlpha);
+}
+
+GL_APICALL void GL_APIENTRY glBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+    GET_CTX()
+    ctx->dispatcher().glBufferData(target,size,data,usage);
+}
+
+GL_APICALL void GL_APIENTRY glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+    GET_CTX()
+    ctx->dispatcher().glBufferSubData(target,offset,size,data);
+}
+
+GL_APICALL GLenum GL_APIENTRY glCheckFramebufferStatus(GLenum target) {
+    GET_CTX_RET(0)
+    return ctx->dispatcher().glCheckFramebufferStatus(target);
+}
+
+GL_APICALL void GL_APIENTRY glClear(GLbitfield mask) {
+    GET_CTX()
+    ctx->dispatcher().glClear(mask);
+}
+
+GL_APICALL void GL_APIENTRY glClearColor(GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha) {
+    GET_CTX()
+    ctx->dispatcher().glClearColor(red,green,blue,alpha);
+}
+
+GL_APICALL void GL_APIENTRY glClearDepthf(GLclampf depth) {
+    GET_CTX()
+    ctx->dispatcher().glClearDepth(depth);
+}
+
+GL_APICALL void GL_APIENTRY glClearStencil(GLint s) {
+    GET_CTX()
+    ctx->dispatcher().glClearStencil(s);
+}
+
+GL_APICALL void GL_APIENTRY glColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) {
+    GET_CTX()
+    ctx->dispatcher().glColorMask(red,green,blue,alpha);
+}
+
+GL_APICALL void GL_APIENTRY glCompileShader(GLuint shader) {
+    GET_CTX()
+    GLuint globalShaderName = shaderGlobalName(ctx,thrd,shader);
+    if(!globalShaderName) return;
+    ctx->dispatcher().glCompileShader(globalShaderName);
+    ShaderParser* sp = getShaderParser(thrd,shader);
+    if(sp) sp->setCompiled();
+}
+
+GL_APICALL void GL_APIENTRY glCompressedTexImage2D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const void* data) {
+    GET_CTX()
+    ctx->dispatcher().glCompressedTexImage2D(target,level,internalformat,width,height,border,imageSize,data);
+}
+
+GL_APICALL void GL_APIENTRY glCompressedTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, const void* data) {
+    GET_CTX()
+    ctx->dispatcher().glCompressedTexSubImage2D(target,level,xoffset,yoffset,width,height,format,imageSize,data);
+}
+
+GL_APICALL void GL_APIENTRY glCopyTexImage2D(GLenum target, GLint level, GLenum internalformat, GLint x, GLint y, GLsizei width, GLsizei height, GLint border) {
+    GET_CTX()
+    ctx->dispatcher().glCopyTexImage2D(target,level,internalformat,x,y,width,height,border);
+}
+
+GL_APICALL void GL_APIENTRY glCopyTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint x, GLint y, GLsizei width, GLsizei height) {
+    GET_CTX()
+    ctx->dispatcher().glCopyTexSubImage2D(target,level,xoffset,yoffset,x,y,width,height);
+}
+
+GL_APICALL GLuint GL_APIENTRY glCreateProgram(void) {
+    GET_CTX_RET(0)
+    GLuint globalProgramName = ctx->dispatcher().glCreateProgram();
+    if(!globalProgramName || !thrd->shareGroup.Ptr()) return globalProgramName;
+
+    //the driver names programs, the local name is mapped to that one
+    GLuint localProgramName = thrd->shareGroup->genName(PROGRAM);
+    thrd->shareGroup->replaceGlobalName(PROGRAM,localProgramName,globalProgramName);
+    thrd->shareGroup->setObjectData(PROGRAM,localProgramName,ObjectDataPtr(new ProgramData()));
+    return localProgramName;
+}
+
+GL_APICALL GLuint GL_APIENTRY glCreateShader(GLenum type) {
+    GET_CTX_RET(0)
+    RET_AND_SET_ERROR_IF(type != GL_VERTEX_SHADER && type != GL_FRAGMENT_SHADER,GL_INVALID_ENUM,0);
+    GLuint globalShaderName = ctx->dispatcher().glCreateShader(type);
+    if(!globalShaderName || !thrd->shareGroup.Ptr()) return globalShaderName;
+
+    GLuint localShaderName = thrd->shareGroup->genName(SHADER);
+    thrd->shareGroup->replaceGlobalName(SHADER,localShaderName,globalShaderName);
+    thrd->shareGroup->setObjectData(SHADER,localShaderName,ObjectDataPtr(new ShaderParser(type)));
+    return localShaderName;
+}
+
+GL_APICALL void GL_APIENTRY glCullFace(GLenum mode) {
+    GET_CTX()
+    ctx->dispatcher().glCullFace(mode);
+}
+
+GL_APICALL void GL_APIENTRY glDeleteBuffers(GLsizei n, const GLuint* buffers) {
+    GET_CTX()
+    SET_ERROR_IF(n < 0,GL_INVALID_VALUE);
+    if(!thrd->shareGroup.Ptr() || !n) return;
+    std::vector<GLuint> globalNames(n);
+    thrd->shareGroup->deleteNames(VERTEXBUFFER,n,buffers,&globalNames[0]);
+    ctx->dispatcher().glDeleteBuffers(n,&globalNames[0]);
+}
+
+GL_APICALL void GL_APIENTRY glDeleteFramebuffers(GLsizei n, const GLuint* framebuffers) {
+    GET_CTX()
+    SET_ERROR_IF(n < 0,GL_INVALID_VALUE);
+    if(!thrd->shareGroup.Ptr() || !n) return;
+    std::vector<GLuint> globalNames(n);
+    thrd->shareGroup->deleteNames(FRAMEBUFFER,n,framebuffers,&globalNames[0]);
+    ctx->dispatcher().glDeleteFramebuffers(n,&globalNames[0]);
+}
+
+GL_APICALL void GL_APIENTRY glDeleteProgram(GLuint program) {
+    GET_CTX()
+    if(!program || !thrd->shareGroup.Ptr()) return;
+    GLuint globalProgramName = programGlobalName(ctx,thrd,program);
+    if(!globalProgramName) return;
+    thrd->shareGroup->deleteName(PROGRAM,program);
+    ctx->dispatcher().glDeleteProgram(globalProgramName);
+}
+
+GL_APICALL void GL_APIENTRY glDeleteRenderbuffers(GLsizei n, const GLuint* renderbuffers) {
+    GET_CTX()
+    SET_ERROR_IF(n < 0,GL_INVALID_VALUE);
+    if(!thrd->shareGroup.Ptr() || !n) return;
+    std::vector<GLuint> globalNames(n);
+    thrd->shareGroup->deleteNames(RENDERBUFFER,n,renderbuffers,&globalNames[0]);
+    ctx->dispatcher().glDeleteRenderbuffers(n,&globalNames[0]);
+}
+
+GL_APICALL void GL_APIENTRY glDeleteShader(GLuint shader) {
+    GET_CTX()
+    if(!shader || !thrd->shareGroup.Ptr()) return;
+    GLuint globalShaderName = shaderGlobalName(ctx,thrd,shader);
+    if(!globalShaderName) return;
+    thrd->shareGroup->deleteName(SHADER,shader);
+    ctx->dispatcher().glDeleteShader(globalShaderName);
+}
+
+GL_APICALL void GL_APIENTRY glDeleteTextures(GLsizei n, const GLuint* textures) {
+    GET_CTX()
+    SET_ERROR_IF(n < 0,GL_INVALID_VALUE);
+    if(!thrd->shareGroup.Ptr() || !n) return;
+    std::vector<GLuint> globalNames(n);
+    thrd->shareGroup->deleteNames(TEXTURE,n,textures,&globalNames[0]);
+    ctx->dispatcher().glDeleteTextures(n,&globalNames[0]);
+}
+
+GL_APICALL void GL_APIENTRY glDepthFunc(GLenum func) {
+    GET_CTX()
+    ctx->dispatcher().glDepthFunc(func);
+}
+
+GL_APICALL void GL_APIENTRY glDepthMask(GLboolean flag) {
+    GET_CTX()
+    ctx->dispatcher().glDepthMask(flag);
+}
+
+GL_APICALL void GL_APIENTRY glDepthRangef(GLclampf zNear, GLclampf zFar) {
+    GET_CTX()
+    ctx->dispatcher().glDepthRange(zNear,zFar);
+}
+
+GL_APICALL void GL_APIENTRY glDetachShader(GLuint program, GLuint shader) {
+    GET_CTX()
+    GLuint globalProgramName = programGlobalName(ctx,thrd,program);
+    GLuint globalShaderName  = shaderGlobalName(ctx,thrd,shader);
+    if(!globalProgramName || !globalShaderName) return;
+    ctx->dispatcher().glDetachShader(globalProgramName,globalShaderName);
+    ProgramData* programData = getProgramData(thrd,program);
+    if(programData) programData->detachShader(shader);
+}
+
+GL_APICALL void GL_APIENTRY glDisable(GLenum cap) {
+    GET_CTX()
+    ctx->dispatcher().glDisable(cap);
+}
+
+GL_APICALL void GL_APIENTRY glDisableVertexAttribArray(GLuint index) {
+    GET_CTX()
+    ctx->dispatcher().glDisableVertexAttribArray(index);
+}
+
+GL_APICALL void GL_APIENTRY glDrawArrays(GLenum mode, GLint first, GLsizei count) {
+    GET_CTX()
+    ctx->dispatcher().glDrawArrays(mode,first,count);
+}
+
+GL_APICALL void GL_APIENTRY glDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) {
+    GET_CTX()
+    ctx->dispatcher().glDrawElements(mode,count,type,indices);
+}
+
+GL_APICALL void GL_APIENTRY glEnable(GLenum cap) {
+    GET_CTX()
+    ctx->dispatcher().glEnable(cap);
+}
+
+GL_APICALL void GL_APIENTRY glEnableVertexAttribArray(GLuint index) {
+    GET_CTX()
+    ctx->dispatcher().glEnableVertexAttribArray(index);
+}
+
+GL_APICALL void GL_APIENTRY glFinish(void) {
+    GET_CTX()
+    ctx->dispatcher().glFinish();
+}
+
+GL_APICALL void GL_APIENTRY glFlush(void) {
+    GET_CTX()
+    ctx->dispatcher().glFlush();
+}
+
+GL_APICALL void GL_APIENTRY glFramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer) {
+    GET_CTX()
+    //the storage of an EGLImage renderbuffer is the texture of the image
+    RenderbufferData* rbData = renderbuffer && thrd->shareGroup.Ptr() ?
+        (RenderbufferData*)thrd->shareGroup->getObjectDataPtr(RENDERBUFFER,renderbuffer) : NULL;
+    if(rbData && rbData->eglImageGlobalTexName) {
+        ctx->dispatcher().glFramebufferTexture2D(target,attachment,GL_TEXTURE_2D,rbData->eglImageGlobalTexName,0);
+        return;
+    }
+    ctx->dispatcher().glFramebufferRenderbuffer(target,attachment,renderbuffertarget,localToGlobal(thrd,RENDERBUFFER,renderbuffer));
+}
+
+GL_APICALL void GL_APIENTRY glFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level) {
+    GET_CTX()
+    ctx->dispatcher().glFramebufferTexture2D(target,attachment,textarget,localToGlobal(thrd,TEXTURE,texture),level);
+}
+
+GL_APICALL void GL_APIENTRY glFrontFace(GLenum mode) {
+    GET_CTX()
+    ctx->dispatcher().glFrontFace(mode);
+}
+
+GL_APICALL void GL_APIENTRY glGenBuffers(GLsizei n, GLuint* buffers) {
+    GET_CTX()
+    SET_ERROR_IF(n < 0,GL_INVALID_VALUE);
+    if(!thrd->shareGroup.Ptr()) return;
+    thrd->shareGroup->genNames(VERTEXBUFFER,n,buffers);
+}
+
+GL_APICALL void GL_APIENTRY glGenerateMipmap(GLenum target) {
+    GET_CTX()
+    ctx->dispatcher().glGenerateMipmap(target);
+}
+
+GL_APICALL void GL_APIENTRY glGenFramebuffers(GLsizei n, GLuint* framebuffers) {
+    GET_CTX()
+    SET_ERROR_IF(n < 0,GL_INVALID_VALUE);
+    if(!thrd->shareGroup.Ptr()) return;
+    thrd->shareGroup->genNames(FRAMEBUFFER,n,framebuffers);
+}
+
+GL_APICALL void GL_APIENTRY glGenRenderbuffers(GLsizei n, GLuint* renderbuffers) {
+    GET_CTX()
+    SET_ERROR_IF(n < 0,GL_INVALID_VALUE);
+    if(!thrd->shareGroup.Ptr()) return;
+    thrd->shareGroup->genNames(RENDERBUFFER,n,renderbuffers);
+}
+
+GL_APICALL void GL_APIENTRY glGenTextures(GLsizei n, GLuint* textures) {
+    GET_CTX()
+    SET_ERROR_IF(n < 0,GL_INVALID_VALUE);
+    if(!thrd->shareGroup.Ptr()) return;
+    thrd->shareGroup->genNames(TEXTURE,n,textures);
+}
+
+//
+// Objects named by the guest (qemu.gles.guest_names), which picks the
+// names itself and sends these instead of waiting for glGen*/glCreate*.
+// The decoder resolves them from this library by name.
+//
+extern "C" {
+
+GL_APICALL void GL_APIENTRY glGenBuffersGuest(GLsizei n, const GLuint* buffers) {
+    GET_CTX()
+    SET_ERROR_IF(n < 0,GL_INVALID_VALUE);
+    if(!thrd->shareGroup.Ptr()) return;
+    thrd->shareGroup->createNames(VERTEXBUFFER,n,buffers);
+}
+
+GL_APICALL void GL_APIENTRY glGenFramebuffersGuest(GLsizei n, const GLuint* framebuffers) {
+    GET_CTX()
+    SET_ERROR_IF(n < 0,GL_INVALID_VALUE);
+    if(!thrd->shareGroup.Ptr()) return;
+    thrd->shareGroup->createNames(FRAMEBUFFER,n,framebuffers);
+}
+
+GL_APICALL void GL_APIENTRY glGenRenderbuffersGuest(GLsizei n, const GLuint* renderbuffers) {
+    GET_CTX()
+    SET_ERROR_IF(n < 0,GL_INVALID_VALUE);
+    if(!thrd->shareGroup.Ptr()) return;
+    thrd->shareGroup->createNames(RENDERBUFFER,n,renderbuffers);
+}
+
+GL_APICALL void GL_APIENTRY glGenTexturesGuest(GLsizei n, const GLuint* textures) {
+    GET_CTX()
+    SET_ERROR_IF(n < 0,GL_INVALID_VALUE);
+    if(!thrd->shareGroup.Ptr()) return;
+    thrd->shareGroup->createNames(TEXTURE,n,textures);
+}
+
+GL_APICALL void GL_APIENTRY glCreateProgramGuest(GLuint program) {
+    GET_CTX()
+    if(!program || !thrd->shareGroup.Ptr()) return;
+    SET_ERROR_IF(thrd->shareGroup->isObject(PROGRAM,program),GL_INVALID_OPERATION);
+    GLuint globalProgramName = ctx->dispatcher().glCreateProgram();
+    if(!globalProgramName) return;
+
+    thrd->shareGroup->genName(PROGRAM,program);
+    thrd->shareGroup->replaceGlobalName(PROGRAM,program,globalProgramName);
+    thrd->shareGroup->setObjectData(PROGRAM,program,ObjectDataPtr(new ProgramData()));
+}
+
+GL_APICALL void GL_APIENTRY glCreateShaderGuest(GLenum type, GLuint shader) {
+    GET_CTX()
+    SET_ERROR_IF(type != GL_VERTEX_SHADER && type != GL_FRAGMENT_SHADER,GL_INVALID_ENUM);
+    if(!shader || !thrd->shareGroup.Ptr()) return;
+    SET_ERROR_IF(thrd->shareGroup->isObject(SHADER,shader),GL_INVALID_OPERATION);
+    GLuint globalShaderName = ctx->dispatcher().glCreateShader(type);
+    if(!globalShaderName) return;
+
+    thrd->shareGroup->genName(SHADER,shader);
+    thrd->shareGroup->replaceGlobalName(SHADER,shader,globalShaderName);
+    thrd->shareGroup->setObjectData(SHADER,shader,ObjectDataPtr(new ShaderParser(type)));
+}
+
+}
+
+GL_APICALL void GL_APIENTRY glGetActiveAttrib(GLuint program, GLuint index, GLsizei bufsize, GLsizei* length, GLint* size, GLenum* type, char* name) {
+    GET_CTX()
+    GLuint globalProgramName = programGlobalName(ctx,thrd,program);
+    if(!globalProgramName) return;
+    ctx->dispatcher().glGetActiveAttrib(globalProgramName,index,bufsize,length,size,type,name);
+}
+
+GL_APICALL void GL_APIENTRY glGetActiveUniform(GLuint program, GLuint index, GLsizei bufsize, GLsizei* length, GLint* size, GLenum* type, char* name) {
+    GET_CTX()
+    GLuint globalProgramName = programGlobalName(ctx,thrd,program);
+    if(!globalProgramName) return;
+    ctx->dispatcher().glGetActiveUniform(globalProgramName,index,bufsize,length,size,type,name);
+}
+
+GL_APICALL void GL_APIENTRY glGetAttachedShaders(GLuint program, GLsizei maxcount, GLsizei* count, GLuint* shaders) {
+    GET_CTX()
+    SET_ERROR_IF(maxcount < 0,GL_INVALID_VALUE);
+    GLuint globalProgramName = programGlobalName(ctx,thrd,program);
+    if(!globalProgramName) return;
+    GLsizei n = 0;
+    ctx->dispatcher().glGetAttachedShaders(globalProgramName,maxcount,&n,shaders);
+    for(int i = 0; i < n; i++) {
+        shaders[i] = globalToLocal(thrd,SHADER,shaders[i]);
+    }
+    if(count) *count = n;
+}
+
+GL_APICALL int GL_APIENTRY glGetAttribLocation(GLuint program, const char* name) {
+    GET_CTX_RET(-1)
+    GLuint globalProgramName = programGlobalName(ctx,thrd,program);
+    if(!globalProgramName) return -1;
+    return ctx->dispatcher().glGetAttribLocation(globalProgramName,name);
+}
+
+GL_APICALL void GL_APIENTRY glGetBooleanv(GLenum pname, GLboolean* params) {
+    GET_CTX()
+    GLint i[MAX_ES_PARAMS];
+    if(getIntegerES(ctx,thrd,pname,i)) {
+        for(unsigned int j = 0; j < esParamSize(pname); j++) {
+            params[j] = i[j] ? GL_TRUE : GL_FALSE;
+        }
+        return;
+    }
+    ctx->dispatcher().glGetBooleanv(pname,params);
+}
+
+GL_APICALL void GL_APIENTRY glGetBufferParameteriv(GLenum target, GLenum pname, GLint* params) {
+    GET_CTX()
+    ctx->dispatcher().glGetBufferParameteriv(target,pname,params);
+}
+
+GL_APICALL GLenum GL_APIENTRY glGetError(void) {
+    GET_CTX_RET(GL_NO_ERROR)
+    GLenum err = ctx->getGLerror();
+    if(err != GL_NO_ERROR) {
+        ctx->setGLerror(GL_NO_ERROR);
+        return err;
+    }
+
+    return ctx->dispatcher().glGetError();
+}
+
+GL_APICALL void GL_APIENTRY glGetFloatv(GLenum pname, GLfloat* params) {
+    GET_CTX()
+    GLint i[MAX_ES_PARAMS];
+    if(getIntegerES(ctx,thrd,pname,i)) {
+        for(unsigned int j = 0; j < esParamSize(pname); j++) {
+            params[j] = static_cast<GLfloat>(i[j]);
+        }
+        return;
+    }
+    ctx->dispatcher().glGetFloatv(pname,params);
+}
+
+GL_APICALL void GL_APIENTRY glGetFramebufferAttachmentParameteriv(GLenum target, GLenum attachment, GLenum pname, GLint* params) {
+    GET_CTX()
+    ctx->dispatcher().glGetFramebufferAttachmentParameteriv(target,attachment,pname,params);
+    if(pname == GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME) {
+        GLint type = GL_NONE;
+        ctx->dispatcher().glGetFramebufferAttachmentParameteriv(target,attachment,GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE,&type);
+        if(type == GL_TEXTURE) {
+            *params = globalToLocal(thrd,TEXTURE,*params);
+        } else if(type == GL_RENDERBUFFER) {
+            *params = globalToLocal(thrd,RENDERBUFFER,*params);
+        }
+    }
+}
+
+GL_APICALL void GL_APIENTRY glGetIntegerv(GLenum pname, GLint* params) {
+    GET_CTX()
+    if(getIntegerES(ctx,thrd,pname,params)) return;
+    ctx->dispatcher().glGetIntegerv(pname,params);
+}
+
+GL_APICALL void GL_APIENTRY glGetProgramiv(GLuint program, GLenum pname, GLint* params) {
+    GET_CTX()
+    GLuint globalProgramName = programGlobalName(ctx,thrd,program);
+    if(!globalProgramName) return;
+    ctx->dispatcher().glGetProgramiv(globalProgramName,pname,params);
+}
+
+GL_APICALL void GL_APIENTRY glGetProgramInfoLog(GLuint program, GLsizei bufsize, GLsizei* length, char* infolog) {
+    GET_CTX()
+    GLuint globalProgramName = programGlobalName(ctx,thrd,program);
+    if(!globalProgramName) return;
+    ctx->dispatcher().glGetProgramInfoLog(globalProgramName,bufsize,length,infolog);
+}
+
+GL_APICALL void GL_APIENTRY glGetRenderbufferParameteriv(GLenum target, GLenum pname, GLint* params) {
+    GET_CTX()
+    ctx->dispatcher().glGetRenderbufferParameteriv(target,pname,params);
+}
+
+GL_APICALL void GL_APIENTRY glGetShaderiv(GLuint shader, GLenum pname, GLint* params) {
+    GET_CTX()
+    GLuint globalShaderName = shaderGlobalName(ctx,thrd,shader);
+    if(!globalShaderName) return;
+    if(pname == GL_SHADER_SOURCE_LENGTH) {
+        //the application source, not the one given to the driver
+        ShaderParser* sp = getShaderParser(thrd,shader);
+        size_t len = sp ? strlen(sp->getOriginalSrc()) : 0;
+        *params = len ? len + 1 : 0;
+        return;
+    }
+    ctx->dispatcher().glGetShaderiv(globalShaderName,pname,params);
+}
+
+GL_APICALL void GL_APIENTRY glGetShaderInfoLog(GLuint shader, GLsizei bufsize, GLsizei* length, char* infolog) {
+    GET_CTX()
+    GLuint globalShaderName = shaderGlobalName(ctx,thrd,shader);
+    if(!globalShaderName) return;
+    ctx->dispatcher().glGetShaderInfoLog(globalShaderName,bufsize,length,infolog);
+}
+
+GL_APICALL void GL_APIENTRY glGetShaderPrecisionFormat(GLenum shadertype, GLenum precisiontype, GLint* range, GLint* precision) {
+    GET_CTX()
+    SET_ERROR_IF(shadertype != GL_VERTEX_SHADER && shadertype != GL_FRAGMENT_SHADER,GL_INVALID_ENUM);
+
+    //desktop GLSL has no precisions, every type is computed as highp
+    switch(precisiontype) {
+    case GL_LOW_INT:
+    case GL_MEDIUM_INT:
+    case GL_HIGH_INT:
+        range[0] = 31;
+        range[1] = 30;
+        *precision = 0;
+        break;
+    case GL_LOW_FLOAT:
+    case GL_MEDIUM_FLOAT:
+    case GL_HIGH_FLOAT:
+        range[0] = 127;
+        range[1] = 127;
+        *precision = 23;
+        break;
+    default:
+        ctx->setGLerror(GL_INVALID_ENUM);
+    }
+}
+
+GL_APICALL void GL_APIENTRY glGetShaderSource(GLuint shader, GLsizei bufsize, GLsizei* length, char* source) {
+    GET_CTX()
+    SET_ERROR_IF(bufsize < 0,GL_INVALID_VALUE);
+    if(!shaderGlobalName(ctx,thrd,shader)) return;
+    ShaderParser* sp = getShaderParser(thrd,shader);
+    const char* src = sp ? sp->getOriginalSrc() : "";
+    GLsizei len = 0;
+    if(bufsize > 0) {
+        len = strlen(src);
+        if(len > bufsize - 1) len = bufsize - 1;
+        memcpy(source,src,len);
+        source[len] = '\0';
+    }
+    if(length) *length = len;
+}
+
+GL_APICALL const GLubyte* GL_APIENTRY glGetString(GLenum name) {
+    GET_CTX_RET(NULL)
+    static GLubyte VENDOR[]     = "Google";
+    static GLubyte RENDERER[]   = "OpenGL ES 2.0";
+    static GLubyte VERSION[]    = "OpenGL ES 2.0";
+    static GLubyte SHADING[]    = "OpenGL ES GLSL ES 1.0.17";
+    static GLubyte EXTENSIONS[] = "GL_OES_EGL_image";
+    switch(name) {
+        case GL_VENDOR:
+            return VENDOR;
+        case GL_RENDERER:
+            return RENDERER;
+        case GL_VERSION:
+            return VERSION;
+        case GL_SHADING_LANGUAGE_VERSION:
+            return SHADING;
+        case GL_EXTENSIONS:
+            return EXTENSIONS;
+        default:
+            RET_AND_SET_ERROR_IF(true,GL_INVALID_ENUM,NULL);
+    }
+}
+
+GL_APICALL void GL_APIENTRY glGetTexParameterfv(GLenum target, GLenum pname, GLfloat* params) {
+    GET_CTX()
+    ctx->dispatcher().glGetTexParameterfv(target,pname,params);
+}
+
+GL_APICALL void GL_APIENTRY glGetTexParameteriv(GLenum target, GLenum pname, GLint* params) {
+    GET_CTX()
+    ctx->dispatcher().glGetTexParameteriv(target,pname,params);
+}
+
+GL_APICALL void GL_APIENTRY glGetUniformfv(GLuint program, GLint location, GLfloat* params) {
+    GET_CTX()
+    GLuint globalProgramName = programGlobalName(ctx,thrd,program);
+    if(!globalProgramName) return;
+    ctx->dispatcher().glGetUniformfv(globalProgramName,location,params);
+}
+
+GL_APICALL void GL_APIENTRY glGetUniformiv(GLuint program, GLint location, GLint* params) {
+    GET_CTX()
+    GLuint globalProgramName = programGlobalName(ctx,thrd,program);
+    if(!globalProgramName) return;
+    ctx->dispatcher().glGetUniformiv(globalProgramName,location,params);
+}
+
+GL_APICALL int GL_APIENTRY glGetUniformLocation(GLuint program, const char* name) {
+    GET_CTX_RET(-1)
+    GLuint globalProgramName = programGlobalName(ctx,thrd,program);
+    if(!globalProgramName) return -1;
+    return ctx->dispatcher().glGetUniformLocation(globalProgramName,name);
+}
+
+GL_APICALL void GL_APIENTRY glGetVertexAttribfv(GLuint index, GLenum pname, GLfloat* params) {
+    GET_CTX()
+    ctx->dispatcher().glGetVertexAttribfv(index,pname,params);
+}
+
+GL_APICALL void GL_APIENTRY glGetVertexAttribiv(GLuint index, GLenum pname, GLint* params) {
+    GET_CTX()
+    ctx->dispatcher().glGetVertexAttribiv(index,pname,params);
+    if(pname == GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING) {
+        *params = globalToLocal(thrd,VERTEXBUFFER,*params);
+    }
+}
+
+GL_APICALL void GL_APIENTRY glGetVertexAttribPointerv(GLuint index, GLenum pname, void** pointer) {
+    GET_CTX()
+    ctx->dispatcher().glGetVertexAttribPointerv(index,pname,pointer);
+}
+
+GL_APICALL void GL_APIENTRY glHint(GLenum target, GLenum mode) {
+    GET_CTX()
+    ctx->dispatcher().glHint(target,mode);
+}
+
+GL_APICALL GLboolean GL_APIENTRY glIsBuffer(GLuint buffer) {
+    GET_CTX_RET(GL_FALSE)
+    GLuint globalName = localToGlobal(thrd,VERTEXBUFFER,buffer);
+    if(!globalName) return GL_FALSE;
+    return ctx->dispatcher().glIsBuffer(globalName);
+}
+
+GL_APICALL GLboolean GL_APIENTRY glIsEnabled(GLenum cap) {
+    GET_CTX_RET(GL_FALSE)
+    return ctx->dispatcher().glIsEnabled(cap);
+}
+
+GL_APICALL GLboolean GL_APIENTRY glIsFramebuffer(GLuint framebuffer) {
+    GET_CTX_RET(GL_FALSE)
+    GLuint globalName = localToGlobal(thrd,FRAMEBUFFER,framebuffer);
+    if(!globalName) return GL_FALSE;
+    return ctx->dispatcher().glIsFramebuffer(globalName);
+}
+
+GL_APICALL GLboolean GL_APIENTRY glIsProgram(GLuint program) {
+    GET_CTX_RET(GL_FALSE)
+    GLuint globalProgramName = localToGlobal(thrd,PROGRAM,program);
+    if(!globalProgramName) return GL_FALSE;
+    return ctx->dispatcher().glIsProgram(globalProgramName);
+}
+
+GL_APICALL GLboolean GL_APIENTRY glIsRenderbuffer(GLuint renderbuffer) {
+    GET_CTX_RET(GL_FALSE)
+    GLuint globalName = localToGlobal(thrd,RENDERBUFFER,renderbuffer);
+    if(!globalName) return GL_FALSE;
+    return ctx->dispatcher().glIsRenderbuffer(globalName);
+}
+
+GL_APICALL GLboolean GL_APIENTRY glIsShader(GLuint shader) {
+    GET_CTX_RET(GL_FALSE)
+    GLuint globalShaderName = localToGlobal(thrd,SHADER,shader);
+    if(!globalShaderName) return GL_FALSE;
+    return ctx->dispatcher().glIsShader(globalShaderName);
+}
+
+GL_APICALL GLboolean GL_APIENTRY glIsTexture(GLuint texture) {
+    GET_CTX_RET(GL_FALSE)
+    GLuint globalName = localToGlobal(thrd,TEXTURE,texture);
+    if(!globalName) return GL_FALSE;
+    return ctx->dispatcher().glIsTexture(globalName);
+}
+
+GL_APICALL void GL_APIENTRY glLineWidth(GLfloat width) {
+    GET_CTX()
+    ctx->dispatcher().glLineWidth(width);
+}
+
+GL_APICALL void GL_APIENTRY glLinkProgram(GLuint program) {
+    GET_CTX()
+    GLuint globalProgramName = programGlobalName(ctx,thrd,program);
+    if(!globalProgramName) return;
+
+    std::string key;
+    bool cached = ProgramCache::enabled(ctx->dispatcher()) && programCacheKey(thrd,program,key);
+    if(cached) {
+        if(ProgramCache::loadProgram(ctx->dispatcher(),globalProgramName,key)) return;
+        if(ctx->dispatcher().glProgramParameteri) {
+            ctx->dispatcher().glProgramParameteri(globalProgramName,GL_PROGRAM_BINARY_RETRIEVABLE_HINT,GL_TRUE);
+        }
+    }
+
+    ctx->dispatcher().glLinkProgram(globalProgramName);
+
+    if(cached) {
+        GLint linked = GL_FALSE;
+        ctx->dispatcher().glGetProgramiv(globalProgramName,GL_LINK_STATUS,&linked);
+        if(linked == GL_TRUE) ProgramCache::storeProgram(ctx->dispatcher(),globalProgramName,key);
+    }
+}
+
+GL_APICALL void GL_APIENTRY glPixelStorei(GLenum pname, GLint param) {
+    GET_CTX()
+    ctx->dispatcher().glPixelStorei(pname,param);
+}
+
+GL_APICALL void GL_APIENTRY glPolygonOffset(GLfloat factor, GLfloat units) {
+    GET_CTX()
+    ctx->dispatcher().glPolygonOffset(factor,units);
+}
+
+GL_APICALL void GL_APIENTRY glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels) {
+    GET_CTX()
+    ctx->dispatcher().glReadPixels(x,y,width,height,format,type,pixels);
+}
+
+GL_APICALL void GL_APIENTRY glReleaseShaderCompiler(void) {
+    GET_CTX()
+    //nothing to release, the desktop compiler belongs to the driver
+}
+
+GL_APICALL void GL_APIENTRY glRenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height) {
+    GET_CTX()
+    //GL_RGB565 is not a desktop renderbuffer format before OpenGL 4.1
+    if(internalformat == GL_RGB565) internalformat = GL_RGB;
+    //the renderbuffer no longer takes its storage from an EGLImage
+    GLint rb = 0;
+    ctx->dispatcher().glGetIntegerv(GL_RENDERBUFFER_BINDING,&rb);
+    rb = globalToLocal(thrd,RENDERBUFFER,rb);
+    if(rb && thrd->shareGroup.Ptr() && thrd->shareGroup->getObjectDataPtr(RENDERBUFFER,rb)) {
+        thrd->shareGroup->setObjectData(RENDERBUFFER,rb,ObjectDataPtr(NULL));
+    }
+    ctx->dispatcher().glRenderbufferStorage(target,internalformat,width,height);
+}
+
+GL_APICALL void GL_APIENTRY glSampleCoverage(GLclampf value, GLboolean invert) {
+    GET_CTX()
+    ctx->dispatcher().glSampleCoverage(value,invert);
+}
+
+GL_APICALL void GL_APIENTRY glScissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+    GET_CTX()
+    ctx->dispatcher().glScissor(x,y,width,height);
+}
+
+GL_APICALL void GL_APIENTRY glShaderBinary(GLsizei n, const GLuint* shaders, GLenum binaryformat, const void* binary, GLsizei length) {
+    GET_CTX()
+    //no binary formats are supported (GL_NUM_SHADER_BINARY_FORMATS is 0)
+    ctx->setGLerror(GL_INVALID_ENUM);
+}
+
+GL_APICALL void GL_APIENTRY glShaderSource(GLuint shader, GLsizei count, const char** string, const GLint* length) {
+    GET_CTX()
+    SET_ERROR_IF(count < 0,GL_INVALID_VALUE);
+    GLuint globalShaderName = shaderGlobalName(ctx,thrd,shader);
+    if(!globalShaderName) return;
+    ShaderParser* sp = getShaderParser(thrd,shader);
+    if(!sp) {
+        ctx->dispatcher().glShaderSource(globalShaderName,count,string,length);
+        return;
+    }
+    sp->setSrc(count,string,length);
+    const char* src = sp->parsedSrc();
+    ctx->dispatcher().glShaderSource(globalShaderName,1,&src,NULL);
+}
+
+GL_APICALL void GL_APIENTRY glStencilFunc(GLenum func, GLint ref, GLuint mask) {
+    GET_CTX()
+    ctx->dispatcher().glStencilFunc(func,ref,mask);
+}
+
+GL_APICALL void GL_APIENTRY glStencilFuncSeparate(GLenum face, GLenum func, GLint ref, GLuint mask) {
+    GET_CTX()
+    ctx->dispatcher().glStencilFuncSeparate(face,func,ref,mask);
+}
+
+GL_APICALL void GL_APIENTRY glStencilMask(GLuint mask) {
+    GET_CTX()
+    ctx->dispatcher().glStencilMask(mask);
+}
+
+GL_APICALL void GL_APIENTRY glStencilMaskSeparate(GLenum face, GLuint mask) {
+    GET_CTX()
+    ctx->dispatcher().glStencilMaskSeparate(face,mask);
+}
+
+GL_APICALL void GL_APIENTRY glStencilOp(GLenum fail, GLenum zfail, GLenum zpass) {
+    GET_CTX()
+    ctx->dispatcher().glStencilOp(fail,zfail,zpass);
+}
+
+GL_APICALL void GL_APIENTRY glStencilOpSeparate(GLenum face, GLenum fail, GLenum zfail, GLenum zpass) {
+    GET_CTX()
+    ctx->dispatcher().glStencilOpSeparate(face,fail,zfail,zpass);
+}
+
+GL_APICALL void GL_APIENTRY glTexImage2D(GLenum target, GLint level, GLint internalformat,  GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const GLvoid* pixels) {
+    GET_CTX()
+    ctx->dispatcher().glTexImage2D(target,level,internalformat,width,height,border,format,type,pixels);
+}
+
+GL_APICALL void GL_APIENTRY glTexParameterf(GLenum target, GLenum pname, GLfloat param) {
+    GET_CTX()
+    ctx->dispatcher().glTexParameterf(target,pname,param);
+}
+
+GL_APICALL void GL_APIENTRY glTexParameterfv(GLenum target, GLenum pname, const GLfloat* params) {
+    GET_CTX()
+    ctx->dispatcher().glTexParameterfv(target,pname,params);
+}
+
+GL_APICALL void GL_APIENTRY glTexParameteri(GLenum target, GLenum pname, GLint param) {
+    GET_CTX()
+    ctx->dispatcher().glTexParameteri(target,pname,param);
+}
+
+GL_APICALL void GL_APIENTRY glTexParameteriv(GLenum target, GLenum pname, const GLint* params) {
+    GET_CTX()
+    ctx->dispatcher().glTexParameteriv(target,pname,params);
+}
+
+GL_APICALL void GL_APIENTRY glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels) {
+    GET_CTX()
+    ctx->dispatcher().glTexSubImage2D(target,level,xoffset,yoffset,width,height,format,type,pixels);
+}
+
+GL_APICALL void GL_APIENTRY glUniform1f(GLint location, GLfloat x) {
+    GET_CTX()
+    ctx->dispatcher().glUniform1f(location,x);
+}
+
+GL_APICALL void GL_APIENTRY glUniform1fv(GLint location, GLsizei count, const GLfloat* v) {
+    GET_CTX()
+    ctx->dispatcher().glUniform1fv(location,count,v);
+}
+
+GL_APICALL void GL_APIENTRY glUniform1i(GLint location, GLint x) {
+    GET_CTX()
+    ctx->dispatcher().glUniform1i(location,x);
+}
+
+GL_APICALL void GL_APIENTRY glUniform1iv(GLint location, GLsizei count, const GLint* v) {
+    GET_CTX()
+    ctx->dispatcher().glUniform1iv(location,count,v);
+}
+
+GL_APICALL void GL_APIENTRY glUniform2f(GLint location, GLfloat x, GLfloat y) {
+    GET_CTX()
+    ctx->dispatcher().glUniform2f(location,x,y);
+}
+
+GL_APICALL void GL_APIENTRY glUniform2fv(GLint location, GLsizei count, const GLfloat* v) {
+    GET_CTX()
+    ctx->dispatcher().glUniform2fv(location,count,v);
+}
+
+GL_APICALL void GL_APIENTRY glUniform2i(GLint location, GLint x, GLint y) {
+    GET_CTX()
+    ctx->dispatcher().glUniform2i(location,x,y);
+}
+
+GL_APICALL void GL_APIENTRY glUniform2iv(GLint location, GLsizei count, const GLint* v) {
+    GET_CTX()
+    ctx->dispatcher().glUniform2iv(location,count,v);
+}
+
+GL_APICALL void GL_APIENTRY glUniform3f(GLint location, GLfloat x, GLfloat y, GLfloat z) {
+    GET_CTX()
+    ctx->dispatcher().glUniform3f(location,x,y,z);
+}
+
+GL_APICALL void GL_APIENTRY glUniform3fv(GLint location, GLsizei count, const GLfloat* v) {
+    GET_CTX()
+    ctx->dispatcher().glUniform3fv(location,count,v);
+}
+
+GL_APICALL void GL_APIENTRY glUniform3i(GLint location, GLint x, GLint y, GLint z) {
+    GET_CTX()
+    ctx->dispatcher().glUniform3i(location,x,y,z);
+}
+
+GL_APICALL void GL_APIENTRY glUniform3iv(GLint location, GLsizei count, const GLint* v) {
+    GET_CTX()
+    ctx->dispatcher().glUniform3iv(location,count,v);
+}
+
+GL_APICALL void GL_APIENTRY glUniform4f(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w) {
+    GET_CTX()
+    ctx->dispatcher().glUniform4f(location,x,y,z,w);
+}
+
+GL_APICALL void GL_APIENTRY glUniform4fv(GLint location, GLsizei count, const GLfloat* v) {
+    GET_CTX()
+    ctx->dispatcher().glUniform4fv(location,count,v);
+}
+
+GL_APICALL void GL_APIENTRY glUniform4i(GLint location, GLint x, GLint y, GLint z, GLint w) {
+    GET_CTX()
+    ctx->dispatcher().glUniform4i(location,x,y,z,w);
+}
+
+GL_APICALL void GL_APIENTRY glUniform4iv(GLint location, GLsizei count, const GLint* v) {
+    GET_CTX()
+    ctx->dispatcher().glUniform4iv(location,count,v);
+}
+
+GL_APICALL void GL_APIENTRY glUniformMatrix2fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+    GET_CTX()
+    ctx->dispatcher().glUniformMatrix2fv(location,count,transpose,value);
+}
+
+GL_APICALL void GL_APIENTRY glUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+    GET_CTX()
+    ctx->dispatcher().glUniformMatrix3fv(location,count,transpose,value);
+}
+
+GL_APICALL void GL_APIENTRY glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+    GET_CTX()
+    ctx->dispatcher().glUniformMatrix4fv(location,count,transpose,value);
+}
+
+GL_APICALL void GL_APIENTRY glUseProgram(GLuint program) {
+    GET_CTX()
+    GLuint globalProgramName = 0;
+    if(program) {
+        globalProgramName = programGlobalName(ctx,thrd,program);
+        if(!globalProgramName) return;
+    }
+    ctx->dispatcher().glUseProgram(globalProgramName);
+}
+
+GL_APICALL void GL_APIENTRY glValidateProgram(GLuint program) {
+    GET_CTX()
+    GLuint globalProgramName = programGlobalName(ctx,thrd,program);
+    if(!globalProgramName) return;
+    ctx->dispatcher().glValidateProgram(globalProgramName);
+}
+
+GL_APICALL void GL_APIENTRY glVertexAttrib1f(GLuint indx, GLfloat x) {
+    GET_CTX()
+    ctx->dispatcher().glVertexAttrib1f(indx,x);
+}
+
+GL_APICALL void GL_APIENTRY glVertexAttrib1fv(GLuint indx, const GLfloat* values) {
+    GET_CTX()
+    ctx->dispatcher().glVertexAttrib1fv(indx,values);
+}
+
+GL_APICALL void GL_APIENTRY glVertexAttrib2f(GLuint indx, GLfloat x, GLfloat y) {
+    GET_CTX()
+    ctx->dispatcher().glVertexAttrib2f(indx,x,y);
+}
+
+GL_APICALL void GL_APIENTRY glVertexAttrib2fv(GLuint indx, const GLfloat* values) {
+    GET_CTX()
+    ctx->dispatcher().glVertexAttrib2fv(indx,values);
+}
+
+GL_APICALL void GL_APIENTRY glVertexAttrib3f(GLuint indx, GLfloat x, GLfloat y, GLfloat z) {
+    GET_CTX()
+    ctx->dispatcher().glVertexAttrib3f(indx,x,y,z);
+}
+
+GL_APICALL void GL_APIENTRY glVertexAttrib3fv(GLuint indx, const GLfloat* values) {
+    GET_CTX()
+    ctx->dispatcher().glVertexAttrib3fv(indx,values);
+}
+
+GL_APICALL void GL_APIENTRY glVertexAttrib4f(GLuint indx, GLfloat x, GLfloat y, GLfloat z, GLfloat w) {
+    GET_CTX()
+    ctx->dispatcher().glVertexAttrib4f(indx,x,y,z,w);
+}
+
+GL_APICALL void GL_APIENTRY glVertexAttrib4fv(GLuint indx, const GLfloat* values) {
+    GET_CTX()
+    ctx->dispatcher().glVertexAttrib4fv(indx,values);
+}
+
+GL_APICALL void GL_APIENTRY glVertexAttribPointer(GLuint indx, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* ptr) {
+    GET_CTX()
+    ctx->dispatcher().glVertexAttribPointer(indx,size,type,normalized,stride,ptr);
+}
+
+GL_APICALL void GL_APIENTRY glViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    GET_CTX()
+    ctx->dispatcher().glViewport(x,y,width,height);
+}
+
+static TextureData* getTextureData(ThreadInfo* thrd,unsigned int tex){
+    TextureData *texData = NULL;
+    ObjectData* objData = thrd->shareGroup->getObjectDataPtr(TEXTURE,tex);
+    if(!objData){
+        texData = new TextureData();
+        thrd->shareGroup->setObjectData(TEXTURE, tex, ObjectDataPtr(texData));
+    } else {
+        texData = (TextureData*)objData;
+    }
+    return texData;
+}
+
+GL_APICALL void GL_APIENTRY glEGLImageTargetTexture2DOES(GLenum target, GLeglImageOES image)
+{
+    GET_CTX();
+    SET_ERROR_IF(target != GL_TEXTURE_2D,GL_INVALID_ENUM);
+    EglImage *img = s_eglIface->eglAttachEGLImage((unsigned int)image);
+    if (img) {
+        // Map the currently bound texture object to the global texture
+        // object of the image, as the GLES 1.1 translator does.
+        if (thrd->shareGroup.Ptr()) {
+            unsigned int tex = ctx->getBindedTexture();
+            unsigned int oldGlobal = thrd->shareGroup->getGlobalName(TEXTURE, tex);
+            // Delete old texture object
+            if (oldGlobal) {
+                ctx->dispatcher().glDeleteTextures(1, &oldGlobal);
+            }
+            // replace mapping and bind the new global object
+            thrd->shareGroup->replaceGlobalName(TEXTURE, tex,img->globalTexName);
+            ctx->dispatcher().glBindTexture(GL_TEXTURE_2D, img->globalTexName);
+            TextureData *texData = getTextureData(thrd,tex);
+            texData->sourceEGLImage = (unsigned int)image;
+            texData->eglImageDetach = s_eglIface->eglDetachEGLImage;
+        }
+    }
+}
+
+GL_APICALL void GL_APIENTRY glEGLImageTargetRenderbufferStorageOES(GLenum target, GLeglImageOES image)
+{
+    GET_CTX();
+    SET_ERROR_IF(target != GL_RENDERBUFFER,GL_INVALID_ENUM);
+    SET_ERROR_IF(!thrd->shareGroup.Ptr(),GL_INVALID_OPERATION);
+    GLint rb = 0;
+    ctx->dispatcher().glGetIntegerv(GL_RENDERBUFFER_BINDING,&rb);
+    rb = globalToLocal(thrd,RENDERBUFFER,rb);
+    SET_ERROR_IF(!rb,GL_INVALID_OPERATION);
+    EglImage *img = s_eglIface->eglAttachEGLImage((unsigned int)image);
+    SET_ERROR_IF(!img,GL_INVALID_VALUE);
+
+    // The desktop driver cannot give the storage of a texture to a
+    // renderbuffer, glFramebufferRenderbuffer attaches the texture of the
+    // image instead, see RenderbufferData.
+    RenderbufferData *rbData = new RenderbufferData();
+    rbData->sourceEGLImage = (unsigned int)image;
+    rbData->eglImageGlobalTexName = img->globalTexName;
+    rbData->eglImageDetach = s_eglIface->eglDetachEGLImage;
+    thrd->shareGroup->setObjectData(RENDERBUFFER,rb,ObjectDataPtr(rbData));
+}
@@ -0,0 +1,174 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "ProgramCache.h"
+#include <utils/threads.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH          0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS     0x87FE
+#endif
+
+#define PROGRAM_CACHE_MAGIC    0x43504745 // "EGPC"
+#define PROGRAM_CACHE_VERSION  1
+#define PROGRAM_CACHE_MAX_SIZE (16*1024*1024)
+
+struct ProgramCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t keyCheck;      //second hash of the key, against name collisions
+    uint32_t keyLength;
+    uint32_t binaryFormat;
+    uint32_t binaryLength;
+};
+
+static android::Mutex s_lock;
+static int            s_enabled = -1;
+static std::string    s_dir;
+static std::string    s_driver;
+
+// FNV-1a
+static uint64_t hashKey(const std::string& key,uint64_t hash) {
+    for(size_t i = 0; i < key.size(); i++) {
+        hash ^= (unsigned char)key[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static std::string driverString(GLESv2Dispatch& gl,GLenum name) {
+    const char* str = (const char*)gl.glGetString(name);
+    return str ? str : "";
+}
+
+bool ProgramCache::enabled(GLESv2Dispatch& gl) {
+    android::Mutex::Autolock lock(s_lock);
+    if(s_enabled < 0) {
+        s_enabled = 0;
+        const char* dir = getenv("ANDROID_GLES_PROGRAM_CACHE");
+        if(dir && *dir && gl.glGetProgramBinary && gl.glProgramBinary) {
+            GLint nFormats = 0;
+            gl.glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS,&nFormats);
+            if(nFormats > 0) {
+                s_dir = dir;
+#ifdef _WIN32
+                _mkdir(dir);
+#else
+                mkdir(dir,0755);
+#endif
+                s_driver  = driverString(gl,GL_VENDOR) + '\n';
+                s_driver += driverString(gl,GL_RENDERER) + '\n';
+                s_driver += driverString(gl,GL_VERSION) + '\n';
+                s_enabled = 1;
+            }
+        }
+    }
+    return s_enabled == 1;
+}
+
+static std::string entryName(const std::string& fullKey) {
+    char name[32];
+    snprintf(name,sizeof(name),"/%016llx.bin",(unsigned long long)hashKey(fullKey,14695981039346656037ULL));
+    return s_dir + name;
+}
+
+static uint64_t keyCheck(const std::string& fullKey) {
+    return hashKey(fullKey,0x84222325cbf29ce4ULL);
+}
+
+bool ProgramCache::loadProgram(GLESv2Dispatch& gl,GLuint program,const std::string& key) {
+    std::string fullKey = s_driver + key;
+    FILE* fp = fopen(entryName(fullKey).c_str(),"rb");
+    if(!fp) return false;
+
+    ProgramCacheHeader header;
+    std::vector<char> binary;
+    bool valid = fread(&header,sizeof(header),1,fp) == 1 &&
+                 header.magic == PROGRAM_CACHE_MAGIC &&
+                 header.version == PROGRAM_CACHE_VERSION &&
+                 header.keyLength == fullKey.size() &&
+                 header.keyCheck == keyCheck(fullKey) &&
+                 header.binaryLength > 0 &&
+                 header.binaryLength <= PROGRAM_CACHE_MAX_SIZE;
+    if(valid) {
+        binary.resize(header.binaryLength);
+        valid = fread(&binary[0],1,binary.size(),fp) == binary.size();
+    }
+    fclose(fp);
+    if(!valid) return false;
+
+    GLint linked = GL_FALSE;
+    gl.glProgramBinary(program,header.binaryFormat,&binary[0],binary.size());
+    gl.glGetProgramiv(program,GL_LINK_STATUS,&linked);
+    return linked == GL_TRUE;
+}
+
+void ProgramCache::storeProgram(GLESv2Dispatch& gl,GLuint program,const std::string& key) {
+    GLint length = 0;
+    gl.glGetProgramiv(program,GL_PROGRAM_BINARY_LENGTH,&length);
+    if(length <= 0 || length > PROGRAM_CACHE_MAX_SIZE) return;
+
+    std::vector<char> binary(length);
+    GLsizei written = 0;
+    GLenum format = 0;
+    gl.glGetProgramBinary(program,length,&written,&format,&binary[0]);
+    if(written <= 0) return;
+
+    std::string fullKey = s_driver + key;
+    ProgramCacheHeader header;
+    header.magic        = PROGRAM_CACHE_MAGIC;
+    header.version      = PROGRAM_CACHE_VERSION;
+    header.keyCheck     = keyCheck(fullKey);
+    header.keyLength    = fullKey.size();
+    header.binaryFormat = format;
+    header.binaryLength = written;
+
+    std::string name = entryName(fullKey);
+    char suffix[32];
+#ifdef _WIN32
+    snprintf(suffix,sizeof(suffix),".%d.tmp",_getpid());
+#else
+    snprintf(suffix,sizeof(suffix),".%d.tmp",(int)getpid());
+#endif
+    std::string tmpName = name + suffix;
+
+    FILE* fp = fopen(tmpName.c_str(),"wb");
+    if(!fp) {
+        fprintf(stderr,"ProgramCache: could not create %s\n",tmpName.c_str());
+        return;
+    }
+    bool ok = fwrite(&header,sizeof(header),1,fp) == 1 &&
+              fwrite(&binary[0],1,written,fp) == (size_t)written;
+    ok = fclose(fp) == 0 && ok;
+#ifdef _WIN32
+    if(ok) remove(name.c_str());
+#endif
+    if(!ok || rename(tmpName.c_str(),name.c_str()) != 0) {
+        remove(tmpName.c_str());
+    }
+}
@@ -0,0 +1,53 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include "GLESv2Dispatch.h"
+#include <string>
+
+//
+// ProgramCache - on disk cache of linked programs.
+//    Every emulator boot compiles and links the same launcher and UI
+//    shaders. When ANDROID_GLES_PROGRAM_CACHE is set to a directory and
+//    the driver supports ARB_get_program_binary, linked programs are saved
+//    there and the next links of the same program just load the binary.
+//
+//    Entries are keyed by the link inputs given by the caller (shaders
+//    sources, attribute bindings) and by the driver vendor, renderer and
+//    version strings, so a driver update starts a new set of entries. A
+//    binary the driver refuses is relinked from source and its entry
+//    rewritten. Entries are written to a temporary file then renamed, so
+//    several emulators can share one directory.
+//
+class ProgramCache
+{
+public:
+    // returns true if programs can be cached, needs a current context
+    static bool enabled(GLESv2Dispatch& gl);
+
+    //
+    // loadProgram - loads the cached binary of 'key' in 'program'.
+    //     Returns true if the program is now linked, false if there is no
+    //     usable entry and the program has to be linked the usual way.
+    //
+    static bool loadProgram(GLESv2Dispatch& gl,GLuint program,const std::string& key);
+
+    // storeProgram - saves the binary of the linked 'program' for 'key'
+    static void storeProgram(GLESv2Dispatch& gl,GLuint program,const std::string& key);
+};
+
+#endif
@@ -0,0 +1,32 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "ProgramData.h"
+
+void ProgramData::attachShader(GLuint shader) {
+    for(unsigned int i = 0; i < m_shaders.size(); i++) {
+        if(m_shaders[i] == shader) return;
+    }
+    m_shaders.push_back(shader);
+}
+
+void ProgramData::detachShader(GLuint shader) {
+    for(unsigned int i = 0; i < m_shaders.size(); i++) {
+        if(m_shaders[i] == shader) {
+            m_shaders.erase(m_shaders.begin() + i);
+            return;
+        }
+    }
+}
@@ -0,0 +1,48 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef PROGRAM_DATA_H
+#define PROGRAM_DATA_H
+
+#include <GLcommon/objectNameManager.h>
+#include <GLES2/gl2.h>
+#include <string>
+#include <vector>
+#include <map>
+
+typedef std::map<std::string,GLuint> AttribBindingsMap;
+
+//
+// ProgramData - the data of a program object: the local names of the
+//    shaders attached to it and the attribute locations bound by the
+//    application. Together with the shaders sources this is all the input
+//    of a link, which is what the program binary cache is keyed by.
+//
+class ProgramData : public ObjectData
+{
+public:
+    void attachShader(GLuint shader);
+    void detachShader(GLuint shader);
+    const std::vector<GLuint>& getAttachedShaders(){return m_shaders;};
+
+    void bindAttribLocation(const char* name,GLuint index){m_attribs[name] = index;};
+    const AttribBindingsMap& getAttribBindings(){return m_attribs;};
+
+private:
+    std::vector<GLuint> m_shaders;
+    AttribBindingsMap   m_attribs;
+};
+
+#endif
@@ -0,0 +1,134 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "ShaderParser.h"
+#include <utils/threads.h>
+#include <string.h>
+#include <map>
+#include <list>
+
+#define SHADER_CACHE_SIZE 128
+
+//
+// desktop GLSL 1.20 is the closest to GLSL ES 1.00. With GLSL 1.20
+// "#line 0" makes the next line line 1.
+//
+static const char s_prefix[] = "#version 120\n"
+                               "#define lowp\n"
+                               "#define mediump\n"
+                               "#define highp\n"
+                               "#line 0\n";
+
+typedef std::map<std::string,std::string> ShaderCacheMap;
+
+static android::Mutex         s_cacheLock;
+static ShaderCacheMap         s_cache;
+static std::list<std::string> s_cacheOrder; //oldest first
+
+static bool isIdentChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+//blanks src[start,end) keeping the new lines
+static void blank(std::string& src,size_t start,size_t end) {
+    for(size_t i = start; i < end && i < src.size(); i++) {
+        if(src[i] != '\n') src[i] = ' ';
+    }
+}
+
+static void parseSrc(const std::string& src,std::string& parsed) {
+    std::string body = src;
+    size_t n = body.size();
+    bool lineStart = true;
+    size_t i = 0;
+    while(i < n) {
+        char c = body[i];
+        if(c == '/' && i + 1 < n && body[i+1] == '/') {
+            //line comment
+            while(i < n && body[i] != '\n') i++;
+            continue;
+        }
+        if(c == '/' && i + 1 < n && body[i+1] == '*') {
+            size_t end = body.find("*/",i + 2);
+            i = end == std::string::npos ? n : end + 2;
+            continue;
+        }
+        if(c == '\n') {
+            lineStart = true;
+            i++;
+            continue;
+        }
+        if(c == ' ' || c == '\t' || c == '\r') {
+            i++;
+            continue;
+        }
+        if(c == '#' && lineStart) {
+            size_t end = body.find('\n',i);
+            if(end == std::string::npos) end = n;
+            size_t d = i + 1;
+            while(d < end && (body[d] == ' ' || body[d] == '\t')) d++;
+            if(body.compare(d,7,"version") == 0) {
+                blank(body,i,end); //the prefix has its own version
+            }
+            i = end;
+            continue;
+        }
+        lineStart = false;
+        if(isIdentChar(c)) {
+            size_t start = i;
+            while(i < n && isIdentChar(body[i])) i++;
+            if(i - start == 9 && body.compare(start,9,"precision") == 0) {
+                //default precision statement, desktop GLSL 1.20 has none
+                size_t end = body.find(';',i);
+                end = end == std::string::npos ? n : end + 1;
+                blank(body,start,end);
+                i = end;
+            }
+            continue;
+        }
+        i++;
+    }
+    parsed = s_prefix;
+    parsed += body;
+}
+
+ShaderParser::ShaderParser(GLenum type):m_type(type) {}
+
+void ShaderParser::setSrc(GLsizei count,const char** strings,const GLint* length) {
+    m_src.clear();
+    for(int i = 0; i < count; i++) {
+        if(!strings[i]) continue;
+        if(length && length[i] >= 0) {
+            m_src.append(strings[i],length[i]);
+        } else {
+            m_src.append(strings[i]);
+        }
+    }
+
+    android::Mutex::Autolock lock(s_cacheLock);
+    ShaderCacheMap::iterator it = s_cache.find(m_src);
+    if(it != s_cache.end()) {
+        m_parsedSrc = (*it).second;
+        return;
+    }
+
+    parseSrc(m_src,m_parsedSrc);
+    if(s_cache.size() >= SHADER_CACHE_SIZE) {
+        s_cache.erase(s_cacheOrder.front());
+        s_cacheOrder.pop_front();
+    }
+    s_cache[m_src] = m_parsedSrc;
+    s_cacheOrder.push_back(m_src);
+}
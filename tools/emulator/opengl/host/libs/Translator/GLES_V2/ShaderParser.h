@@ -0,0 +1,56 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef SHADER_PARSER_H
+#define SHADER_PARSER_H
+
+#include <GLcommon/objectNameManager.h>
+#include <GLES2/gl2.h>
+#include <string>
+
+//
+// ShaderParser - the data of a shader object. Keeps the GLES source as
+//    given by the application, for glGetShaderSource, and the source
+//    rewritten for the desktop GLSL compiler: "#version 100" and the
+//    precision statements are removed and the precision qualifiers are
+//    defined away. Line numbers are kept so the compiler logs match the
+//    application source.
+//
+//    Applications tend to compile the same shaders again and again (each
+//    context, each activity restart), so the rewritten sources are kept in
+//    a cache shared by all the contexts, keyed by the GLES source.
+//
+class ShaderParser : public ObjectData
+{
+public:
+    explicit ShaderParser(GLenum type);
+
+    void setSrc(GLsizei count,const char** strings,const GLint* length);
+    const char* getOriginalSrc(){return m_src.c_str();};
+    const char* parsedSrc(){return m_parsedSrc.c_str();};
+    GLenum getType(){return m_type;};
+
+    //the source given to the last glCompileShader, what a link uses
+    void setCompiled(){m_compiledSrc = m_parsedSrc;};
+    const std::string& compiledSrc(){return m_compiledSrc;};
+
+private:
+    GLenum      m_type;
+    std::string m_src;
+    std::string m_parsedSrc;
+    std::string m_compiledSrc;
+};
+
+#endif
@@ -12,7 +12,8 @@ LOCAL_SRC_FILES :=           \
 
 
 LOCAL_C_INCLUDES += \
-                 $(translator_path)/include
+                 $(translator_path)/include \
+                 $(translator_path)/../../../shared
 
 LOCAL_STATIC_LIBRARIES := \
     libutils              \
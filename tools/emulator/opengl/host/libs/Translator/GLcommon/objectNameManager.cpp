@@ -14,6 +14,7 @@
 * limitations under the License.
 */
 #include <map>
+#include <cutils/atomic.h>
 #include <GLcommon/objectNameManager.h>
 
 class GlobalNameSpace
@@ -49,6 +50,28 @@ public:
         return name;
     }
 
+    void genNames(NamedObjectType p_type, unsigned int p_count, unsigned int *p_names)
+    {
+        if ( p_type >= NUM_OBJECT_TYPES ) return;
+
+        mutex_lock(&m_lock);
+        for (unsigned int i=0; i<p_count; i++) {
+            p_names[i] = m_nameSpace[p_type]->genName(0, false);
+        }
+        mutex_unlock(&m_lock);
+    }
+
+    void deleteNames(NamedObjectType p_type, unsigned int p_count, const unsigned int *p_names)
+    {
+        if ( p_type >= NUM_OBJECT_TYPES ) return;
+
+        mutex_lock(&m_lock);
+        for (unsigned int i=0; i<p_count; i++) {
+            if (p_names[i]) m_nameSpace[p_type]->deleteName(p_names[i]);
+        }
+        mutex_unlock(&m_lock);
+    }
+
     void deleteName(NamedObjectType p_type, unsigned int p_name)
     {
         if ( p_type >= NUM_OBJECT_TYPES ) return;
@@ -67,17 +90,85 @@ static GlobalNameSpace *s_globalNameSpace = NULL;
 
 NameSpace::NameSpace(NamedObjectType p_type) :
     m_nextName(0),
+    m_dense(NULL),
+    m_denseSize(0),
+    m_denseSeq(0),
     m_type(p_type)
 {
 }
 
 NameSpace::~NameSpace()
 {
-    for (NamesMap::iterator n = m_localToGlobalMap.begin();
-         n != m_localToGlobalMap.end();
+    for (unsigned int i = 0; i < m_denseSize; i++) {
+        if (m_dense[i].globalName) {
+            s_globalNameSpace->deleteName(m_type, m_dense[i].globalName);
+        }
+    }
+    for (NamesMap::iterator n = m_sparseLocalToGlobal.begin();
+         n != m_sparseLocalToGlobal.end();
          n++) {
         s_globalNameSpace->deleteName(m_type, (*n).second);
     }
+
+    delete [] m_dense;
+    for (size_t i = 0; i < m_retiredDense.size(); i++) {
+        delete [] m_retiredDense[i];
+    }
+}
+
+void
+NameSpace::growDense(unsigned int p_localName)
+{
+    unsigned int newSize = m_denseSize ? m_denseSize : 64;
+    while (newSize <= p_localName && newSize < NAMESPACE_DENSE_NAMES) {
+        newSize *= 2;
+    }
+
+    NameEntry *dense = new NameEntry[newSize];
+    for (unsigned int i = 0; i < newSize; i++) {
+        dense[i].globalName = i < m_denseSize ? m_dense[i].globalName : 0;
+        dense[i].data = i < m_denseSize ? m_dense[i].data : NULL;
+    }
+    m_denseData.resize(newSize);
+
+    // readers seeing an odd or changed sequence take the locked path
+    android_atomic_inc(&m_denseSeq);
+    if (m_dense) {
+        m_retiredDense.push_back((NameEntry *)m_dense);
+    }
+    m_dense = dense;
+    m_denseSize = newSize;
+    android_atomic_inc(&m_denseSeq);
+}
+
+void
+NameSpace::setGlobalName(unsigned int p_localName, unsigned int p_globalName)
+{
+    unsigned int oldGlobal = getGlobalName(p_localName);
+    if (oldGlobal) {
+        NamesMap::iterator r( m_globalToLocal.find(oldGlobal) );
+        if (r != m_globalToLocal.end() && (*r).second == p_localName) {
+            m_globalToLocal.erase(r);
+        }
+    }
+
+    if (p_localName < NAMESPACE_DENSE_NAMES) {
+        if (p_localName >= m_denseSize) {
+            if (!p_globalName) return;
+            growDense(p_localName);
+        }
+        m_dense[p_localName].globalName = p_globalName;
+    }
+    else if (p_globalName) {
+        m_sparseLocalToGlobal[p_localName] = p_globalName;
+    }
+    else {
+        m_sparseLocalToGlobal.erase(p_localName);
+    }
+
+    if (p_globalName) {
+        m_globalToLocal[p_globalName] = p_localName;
+    }
 }
 
 unsigned int
@@ -88,22 +179,62 @@ NameSpace::genName(unsigned int p_localName, bool genGlobal)
     if (localName == 0) {
         do {
             localName = ++m_nextName;
-        } while( localName == 0 || m_localToGlobalMap.find(localName) != m_localToGlobalMap.end() );
+        } while( localName == 0 || isObject(localName) );
     }
 
     if (genGlobal) {
         unsigned int globalName = s_globalNameSpace->genName(m_type);
-        m_localToGlobalMap[localName] = globalName;
+        setGlobalName(localName, globalName);
     }
 
     return localName;
 }
 
+void
+NameSpace::genNames(unsigned int p_count, unsigned int *p_localNames)
+{
+    std::vector<unsigned int> globalNames(p_count);
+    if (p_count == 0) return;
+    s_globalNameSpace->genNames(m_type, p_count, &globalNames[0]);
+
+    for (unsigned int i = 0; i < p_count; i++) {
+        unsigned int localName;
+        do {
+            localName = ++m_nextName;
+        } while( localName == 0 || isObject(localName) );
+        setGlobalName(localName, globalNames[i]);
+        p_localNames[i] = localName;
+    }
+}
+
+void
+NameSpace::createNames(unsigned int p_count, const unsigned int *p_localNames)
+{
+    std::vector<unsigned int> newNames;
+    newNames.reserve(p_count);
+    for (unsigned int i = 0; i < p_count; i++) {
+        if (p_localNames[i] && !isObject(p_localNames[i])) {
+            newNames.push_back(p_localNames[i]);
+        }
+    }
+    if (newNames.empty()) return;
+
+    std::vector<unsigned int> globalNames(newNames.size());
+    s_globalNameSpace->genNames(m_type, newNames.size(), &globalNames[0]);
+    for (unsigned int i = 0; i < newNames.size(); i++) {
+        setGlobalName(newNames[i], globalNames[i]);
+    }
+}
+
 unsigned int
 NameSpace::getGlobalName(unsigned int p_localName)
 {
-    NamesMap::iterator n( m_localToGlobalMap.find(p_localName) );
-    if (n != m_localToGlobalMap.end()) {
+    if (p_localName < NAMESPACE_DENSE_NAMES) {
+        return p_localName < m_denseSize ? m_dense[p_localName].globalName : 0;
+    }
+
+    NamesMap::iterator n( m_sparseLocalToGlobal.find(p_localName) );
+    if (n != m_sparseLocalToGlobal.end()) {
         // object found - return its global name map
         return (*n).second;
     }
@@ -112,14 +243,34 @@ NameSpace::getGlobalName(unsigned int p_localName)
     return 0;
 }
 
+bool
+NameSpace::getGlobalNameNoLock(unsigned int p_localName, unsigned int *p_globalName)
+{
+    if (p_localName >= NAMESPACE_DENSE_NAMES) {
+        return false;
+    }
+
+    int32_t seq = android_atomic_acquire_load(&m_denseSeq);
+    if (seq & 1) {
+        return false;
+    }
+    NameEntry *dense = m_dense;
+    unsigned int globalName = p_localName < m_denseSize ? dense[p_localName].globalName : 0;
+    if (android_atomic_release_load(&m_denseSeq) != seq) {
+        return false;
+    }
+
+    *p_globalName = globalName;
+    return true;
+}
+
 unsigned int
 NameSpace::getLocalName(unsigned int p_globalName)
 {
-    for(NamesMap::iterator it = m_localToGlobalMap.begin(); it != m_localToGlobalMap.end();it++){
-        if((*it).second == p_globalName){
-            // object found - return its local name
-            return (*it).first;
-        }
+    NamesMap::iterator it( m_globalToLocal.find(p_globalName) );
+    if (it != m_globalToLocal.end()) {
+        // object found - return its local name
+        return (*it).second;
     }
 
     // object does not exist;
@@ -129,31 +280,106 @@ NameSpace::getLocalName(unsigned int p_globalName)
 void
 NameSpace::deleteName(unsigned int p_localName)
 {
-    NamesMap::iterator n( m_localToGlobalMap.find(p_localName) );
-    if (n != m_localToGlobalMap.end()) {
-        s_globalNameSpace->deleteName(m_type, (*n).second);
-        m_localToGlobalMap.erase(p_localName);
+    unsigned int globalName = getGlobalName(p_localName);
+    if (globalName) {
+        s_globalNameSpace->deleteName(m_type, globalName);
+        setGlobalName(p_localName, 0);
+    }
+    setObjectData(p_localName, ObjectDataPtr(NULL));
+}
+
+void
+NameSpace::deleteNames(unsigned int p_count, const unsigned int *p_localNames,
+                       unsigned int *p_globalNames)
+{
+    std::vector<unsigned int> globalNames(p_count);
+    if (p_count == 0) return;
+
+    for (unsigned int i = 0; i < p_count; i++) {
+        globalNames[i] = getGlobalName(p_localNames[i]);
+        if (globalNames[i]) {
+            setGlobalName(p_localNames[i], 0);
+        }
+        setObjectData(p_localNames[i], ObjectDataPtr(NULL));
+    }
+    s_globalNameSpace->deleteNames(m_type, p_count, &globalNames[0]);
+
+    if (p_globalNames) {
+        for (unsigned int i = 0; i < p_count; i++) {
+            p_globalNames[i] = globalNames[i];
+        }
     }
 }
 
 bool
 NameSpace::isObject(unsigned int p_localName)
 {
-    return (m_localToGlobalMap.find(p_localName) != m_localToGlobalMap.end() );
+    return getGlobalName(p_localName) != 0;
 }
 
 void
 NameSpace::replaceGlobalName(unsigned int p_localName, unsigned int p_globalName)
 {
-    NamesMap::iterator n( m_localToGlobalMap.find(p_localName) );
-    if (n != m_localToGlobalMap.end()) {
-        s_globalNameSpace->deleteName(m_type, (*n).second);
-        (*n).second = p_globalName;
+    unsigned int globalName = getGlobalName(p_localName);
+    if (globalName) {
+        s_globalNameSpace->deleteName(m_type, globalName);
+        setGlobalName(p_localName, p_globalName);
     }
 }
 
-typedef std::pair<NamedObjectType, unsigned int> ObjectIDPair;
-typedef std::map<ObjectIDPair, ObjectDataPtr> ObjectDataMap;
+void
+NameSpace::setObjectData(unsigned int p_localName, ObjectDataPtr data)
+{
+    if (p_localName >= NAMESPACE_DENSE_NAMES) {
+        if (data.Ptr()) {
+            m_sparseData[p_localName] = data;
+        }
+        else {
+            m_sparseData.erase(p_localName);
+        }
+        return;
+    }
+
+    if (p_localName >= m_denseSize) {
+        if (!data.Ptr()) return;
+        growDense(p_localName);
+    }
+    // the entry points to the new data before the previous one is released
+    m_dense[p_localName].data = data.Ptr();
+    m_denseData[p_localName] = data;
+}
+
+ObjectDataPtr
+NameSpace::getObjectData(unsigned int p_localName)
+{
+    if (p_localName >= NAMESPACE_DENSE_NAMES) {
+        ObjectDataMap::iterator d( m_sparseData.find(p_localName) );
+        return d != m_sparseData.end() ? (*d).second : ObjectDataPtr(NULL);
+    }
+    return p_localName < m_denseSize ? m_denseData[p_localName] : ObjectDataPtr(NULL);
+}
+
+bool
+NameSpace::getObjectDataNoLock(unsigned int p_localName, ObjectData **p_data)
+{
+    if (p_localName >= NAMESPACE_DENSE_NAMES) {
+        return false;
+    }
+
+    int32_t seq = android_atomic_acquire_load(&m_denseSeq);
+    if (seq & 1) {
+        return false;
+    }
+    NameEntry *dense = m_dense;
+    ObjectData *data = p_localName < m_denseSize ? dense[p_localName].data : NULL;
+    if (android_atomic_release_load(&m_denseSeq) != seq) {
+        return false;
+    }
+
+    *p_data = data;
+    return true;
+}
+
 
 ShareGroup::ShareGroup()
 {
@@ -163,7 +389,6 @@ ShareGroup::ShareGroup()
         m_nameSpace[i] = new NameSpace((NamedObjectType)i);
     }
 
-    m_objectsData = NULL;
 }
 
 ShareGroup::~ShareGroup()
@@ -172,10 +397,6 @@ ShareGroup::~ShareGroup()
     for (int t = 0; t < NUM_OBJECT_TYPES; t++) {
         delete m_nameSpace[t];
     }
-
-    ObjectDataMap *map = (ObjectDataMap *)m_objectsData;
-    if (map) delete map;
-
     mutex_unlock(&m_lock);
     mutex_destroy(&m_lock);
 }
@@ -192,13 +413,38 @@ ShareGroup::genName(NamedObjectType p_type, unsigned int p_localName)
     return localName;
 }
 
+void
+ShareGroup::genNames(NamedObjectType p_type, unsigned int p_count, unsigned int *p_localNames)
+{
+    if (p_type >= NUM_OBJECT_TYPES) return;
+
+    mutex_lock(&m_lock);
+    m_nameSpace[p_type]->genNames(p_count, p_localNames);
+    mutex_unlock(&m_lock);
+}
+
+void
+ShareGroup::createNames(NamedObjectType p_type, unsigned int p_count, const unsigned int *p_localNames)
+{
+    if (p_type >= NUM_OBJECT_TYPES) return;
+
+    mutex_lock(&m_lock);
+    m_nameSpace[p_type]->createNames(p_count, p_localNames);
+    mutex_unlock(&m_lock);
+}
+
 unsigned int
 ShareGroup::getGlobalName(NamedObjectType p_type, unsigned int p_localName)
 {
     if (p_type >= NUM_OBJECT_TYPES) return 0;
 
+    unsigned int globalName;
+    if (m_nameSpace[p_type]->getGlobalNameNoLock(p_localName, &globalName)) {
+        return globalName;
+    }
+
     mutex_lock(&m_lock);
-    unsigned int globalName = m_nameSpace[p_type]->getGlobalName(p_localName);
+    globalName = m_nameSpace[p_type]->getGlobalName(p_localName);
     mutex_unlock(&m_lock);
 
     return globalName;
@@ -223,10 +469,18 @@ ShareGroup::deleteName(NamedObjectType p_type, unsigned int p_localName)
 
     mutex_lock(&m_lock);
     m_nameSpace[p_type]->deleteName(p_localName);
-    ObjectDataMap *map = (ObjectDataMap *)m_objectsData;
-    if (map) {
-        map->erase( ObjectIDPair(p_type, p_localName) );
-    }
+    mutex_unlock(&m_lock);
+}
+
+void
+ShareGroup::deleteNames(NamedObjectType p_type, unsigned int p_count,
+                        const unsigned int *p_localNames,
+                        unsigned int *p_globalNames)
+{
+    if (p_type >= NUM_OBJECT_TYPES) return;
+
+    mutex_lock(&m_lock);
+    m_nameSpace[p_type]->deleteNames(p_count, p_localNames, p_globalNames);
     mutex_unlock(&m_lock);
 }
 
@@ -235,6 +489,11 @@ ShareGroup::isObject(NamedObjectType p_type, unsigned int p_localName)
 {
     if (p_type >= NUM_OBJECT_TYPES) return 0;
 
+    unsigned int globalName;
+    if (m_nameSpace[p_type]->getGlobalNameNoLock(p_localName, &globalName)) {
+        return globalName != 0;
+    }
+
     mutex_lock(&m_lock);
     bool exist = m_nameSpace[p_type]->isObject(p_localName);
     mutex_unlock(&m_lock);
@@ -258,16 +517,7 @@ ShareGroup::setObjectData(NamedObjectType p_type, unsigned int p_localName, Obje
     if (p_type >= NUM_OBJECT_TYPES) return;
 
     mutex_lock(&m_lock);
-
-    ObjectDataMap *map = (ObjectDataMap *)m_objectsData;
-    if (!map) {
-        map = new ObjectDataMap();
-        m_objectsData = map;
-    }
-
-    ObjectIDPair id( p_type, p_localName );
-    map->insert( std::pair<ObjectIDPair, ObjectDataPtr>(id, data) );
-
+    m_nameSpace[p_type]->setObjectData(p_localName, data);
     mutex_unlock(&m_lock);
 }
 
@@ -279,16 +529,27 @@ ShareGroup::getObjectData(NamedObjectType p_type, unsigned int p_localName)
     if (p_type >= NUM_OBJECT_TYPES) return ret;
 
     mutex_lock(&m_lock);
+    ret = m_nameSpace[p_type]->getObjectData(p_localName);
+    mutex_unlock(&m_lock);
+
+    return ret;
+}
 
-    ObjectDataMap *map = (ObjectDataMap *)m_objectsData;
-    if (map) {
-        ObjectDataMap::iterator i = map->find( ObjectIDPair(p_type, p_localName) );
-        if (i != map->end()) ret = (*i).second;
+ObjectData *
+ShareGroup::getObjectDataPtr(NamedObjectType p_type, unsigned int p_localName)
+{
+    if (p_type >= NUM_OBJECT_TYPES) return NULL;
+
+    ObjectData *data;
+    if (m_nameSpace[p_type]->getObjectDataNoLock(p_localName, &data)) {
+        return data;
     }
 
+    mutex_lock(&m_lock);
+    data = m_nameSpace[p_type]->getObjectData(p_localName).Ptr();
     mutex_unlock(&m_lock);
 
-    return ret;
+    return data;
 }
 
 ObjectNameManager::ObjectNameManager()
@@ -83,14 +83,15 @@ typedef HWND                   EGLNativeWindowType;
 
 #elif defined(__APPLE__)
 
-typedef int  EGLNativePixelFormatType;
-#define PIXEL_FORMAT_INITIALIZER 0
+/* the pixel formats are CGLPixelFormatObj, the windows NSView objects */
+typedef void*  EGLNativePixelFormatType;
+#define PIXEL_FORMAT_INITIALIZER NULL
 
 typedef struct _EGLNativeContextType*      EGLNativeContextType;
 typedef struct _EGLNativePbufferType*      EGLNativePbufferType;
 typedef struct _EGLNativeDisplayType*      EGLNativeDisplayType;
-typedef int       EGLNativePixmapType;
-typedef int       EGLNativeWindowType;
+typedef void*     EGLNativePixmapType;
+typedef void*     EGLNativeWindowType;
 
 #elif defined(__unix__)
 
@@ -17,6 +17,7 @@
 #define TRANSLATOR_IFACES_H
 #include <GLcommon/ThreadInfo.h>
 #include <GLES/gl.h>
+#include <string.h>
 
 extern "C" {
 
@@ -36,13 +37,35 @@ public:
     ~TextureData() {
         if (sourceEGLImage && eglImageDetach) (*eglImageDetach)(sourceEGLImage);
     }
-    TextureData():width(0),height(0),border(0),internalFormat(GL_RGBA),sourceEGLImage(0){};
+    TextureData():width(0),height(0),border(0),internalFormat(GL_RGBA),sourceEGLImage(0),generateMipmap(false),mipmapDirty(false){
+        memset(cropRect,0,sizeof(cropRect));
+    };
 
     unsigned int width;
     unsigned int height;
     unsigned int border;
     unsigned int internalFormat;
     unsigned int sourceEGLImage;
+    bool generateMipmap;    //GL_GENERATE_MIPMAP, when the translator makes the mipmaps
+    bool mipmapDirty;       //level 0 changed since the mipmaps were made
+    int cropRect[4];        //GL_TEXTURE_CROP_RECT_OES, used by glDrawTex*OES
+    void (*eglImageDetach)(unsigned int imageId);
+};
+
+//
+// The storage of a renderbuffer given by an EGLImage is the texture of the
+// image, the renderbuffer is attached to a framebuffer as that texture.
+//
+class RenderbufferData : public ObjectData
+{
+public:
+    ~RenderbufferData() {
+        if (sourceEGLImage && eglImageDetach) (*eglImageDetach)(sourceEGLImage);
+    }
+    RenderbufferData():sourceEGLImage(0),eglImageGlobalTexName(0),eglImageDetach(NULL){};
+
+    unsigned int sourceEGLImage;
+    unsigned int eglImageGlobalTexName;
     void (*eglImageDetach)(unsigned int imageId);
 };
 
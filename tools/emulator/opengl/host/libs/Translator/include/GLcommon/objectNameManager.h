@@ -17,7 +17,9 @@
 #define _OBJECT_NAME_MANAGER_H
 
 #include <cutils/threads.h>
+#include <stdint.h>
 #include <map>
+#include <vector>
 #include "SmartPtr.h"
 
 typedef std::map<unsigned int, unsigned int> NamesMap;
@@ -38,6 +40,7 @@ public:
     virtual ~ObjectData() {}
 };
 typedef SmartPtr<ObjectData> ObjectDataPtr;
+typedef std::map<unsigned int, ObjectDataPtr> ObjectDataMap;
 
 //
 // Class NameSpace - this class manages allocations and deletions of objects
@@ -46,9 +49,19 @@ typedef SmartPtr<ObjectData> ObjectDataPtr;
 //                   generated as well to be used in the space where all
 //                   contexts are shared.
 //
+//   Local names below NAMESPACE_DENSE_NAMES, which is where genName puts
+//   them, live in an array indexed by the local name, the others in a map.
+//   Each entry of the array holds the global name and the object data of
+//   the name. Global names are never 0, a 0 entry in the array is a free
+//   name. The array is read without taking a lock (see
+//   getGlobalNameNoLock), when it grows the previous one is kept until the
+//   NameSpace is destroyed so a concurrent reader never reads freed memory.
+//
 //   NOTE: this class does not used by the EGL/GLES layer directly,
 //         the EGL/GLES layer creates objects using the ShareGroup class
 //         interface (see below).
+#define NAMESPACE_DENSE_NAMES 65536
+
 class NameSpace
 {
     friend class ShareGroup;
@@ -67,12 +80,33 @@ private:
     //
     unsigned int genName(unsigned int p_localName = 0, bool genGlobal = true);
 
+    //
+    // genNames - creates p_count new objects, their names are returned in
+    //            p_localNames. The global names are generated all at once.
+    //
+    void genNames(unsigned int p_count, unsigned int *p_localNames);
+
+    //
+    // createNames - creates the objects of p_localNames which do not exist
+    //               yet, names picked by the guest. 0 is skipped.
+    //
+    void createNames(unsigned int p_count, const unsigned int *p_localNames);
+
     //
     // getGlobalName - returns the global name of an object or 0 if the object
     //                 does not exist.
     //
     unsigned int getGlobalName(unsigned int p_localName);
 
+    //
+    // getGlobalNameNoLock - same as getGlobalName for the names of the
+    //                       array, can be called concurrently with the
+    //                       other functions. Returns false if the name is
+    //                       not in the range of the array or the array was
+    //                       being resized, getGlobalName has to be called.
+    //
+    bool getGlobalNameNoLock(unsigned int p_localName, unsigned int *p_globalName);
+
     //
     // getLocaalName - returns the local name of an object or 0 if the object
     //                 does not exist.
@@ -85,6 +119,14 @@ private:
     //
     void deleteName(unsigned int p_localName);
 
+    //
+    // deleteNames - deletes p_count objects. If p_globalNames is not NULL it
+    //               receives the global names of the deleted objects, 0 for
+    //               names which did not exist.
+    //
+    void deleteNames(unsigned int p_count, const unsigned int *p_localNames,
+                     unsigned int *p_globalNames);
+
     //
     // isObject - returns true if the named object exist.
     //
@@ -95,9 +137,39 @@ private:
     //
     void replaceGlobalName(unsigned int p_localName, unsigned int p_globalName);
 
+    //
+    // object data of a name, which is released with the name. Any local
+    // name can have data, even one which was not generated (like 0).
+    //
+    void setObjectData(unsigned int p_localName, ObjectDataPtr data);
+    ObjectDataPtr getObjectData(unsigned int p_localName);
+
+    //
+    // getObjectDataNoLock - returns the object data of a name of the array
+    //                       without taking a reference on it, see
+    //                       getGlobalNameNoLock.
+    //
+    bool getObjectDataNoLock(unsigned int p_localName, ObjectData **p_data);
+
+private:
+    struct NameEntry {
+        volatile unsigned int globalName;
+        ObjectData * volatile data;     // owned by m_denseData
+    };
+
+    void setGlobalName(unsigned int p_localName, unsigned int p_globalName);
+    void growDense(unsigned int p_localName);
+
 private:
     unsigned int m_nextName;
-    NamesMap m_localToGlobalMap;
+    NameEntry * volatile m_dense;
+    volatile unsigned int m_denseSize;
+    volatile int32_t m_denseSeq;        // odd while the array is replaced
+    std::vector<NameEntry *> m_retiredDense;
+    std::vector<ObjectDataPtr> m_denseData;
+    NamesMap m_sparseLocalToGlobal;     // local names out of the array
+    ObjectDataMap m_sparseData;
+    NamesMap m_globalToLocal;
     const NamedObjectType m_type;
 };
 
@@ -107,7 +179,9 @@ private:
 //   there will be one inctance of ShareGroup for each user OpenGL context
 //   unless the user context share with another user context. In that case they
 //   both will share the same ShareGroup instance.
-//   calls into that class gets serialized through a lock so it is thread safe.
+//   calls into that class gets serialized through a lock so it is thread safe,
+//   except for the getGlobalName, isObject and getObjectDataPtr lookups of
+//   the names kept in the NameSpace arrays which do not take the lock.
 //
 class ShareGroup
 {
@@ -124,6 +198,20 @@ public:
     //
     unsigned int genName(NamedObjectType p_type, unsigned int p_localName = 0);
 
+    //
+    // genNames - generates p_count new object names into p_localNames,
+    //            taking the locks once for all of them (glGen* with n > 1).
+    //
+    void genNames(NamedObjectType p_type, unsigned int p_count, unsigned int *p_localNames);
+
+    //
+    // createNames - creates objects with the names in p_localNames, which
+    //               were allocated by the guest (glGen*Guest), the names
+    //               which already exist are left as they are.
+    //
+    void createNames(NamedObjectType p_type, unsigned int p_count,
+                     const unsigned int *p_localNames);
+
     //
     // getGlobalName - retrieves the "global" name of an object or 0 if the
     //                 object does not exist.
@@ -142,6 +230,17 @@ public:
     //
     void deleteName(NamedObjectType p_type, unsigned int p_localName);
 
+    //
+    // deleteNames - deletes p_count objects as deleteName does, taking the
+    //               locks once. When p_globalNames is not NULL it receives
+    //               the global names the objects had (0 for names which
+    //               did not exist) so the caller can delete them all in
+    //               one call to the driver.
+    //
+    void deleteNames(NamedObjectType p_type, unsigned int p_count,
+                     const unsigned int *p_localNames,
+                     unsigned int *p_globalNames = NULL);
+
     //
     // replaceGlobalName - replaces an object to map to an existing global
     //        named object. (used when creating EGLImage siblings)
@@ -163,6 +262,14 @@ public:
     //
     ObjectDataPtr getObjectData(NamedObjectType p_type, unsigned int p_localName);
 
+    //
+    // getObjectDataPtr - same as getObjectData without taking a reference
+    //       on the data, mostly without locking. The pointer is valid until
+    //       the object is deleted or its data replaced, which is what the
+    //       per call lookups of the GLES layers need.
+    //
+    ObjectData *getObjectDataPtr(NamedObjectType p_type, unsigned int p_localName);
+
 private:
     ShareGroup();
     ~ShareGroup();
@@ -170,7 +277,6 @@ private:
 private:
     mutex_t m_lock;
     NameSpace *m_nameSpace[NUM_OBJECT_TYPES];
-    void *m_objectsData;
 };
 
 typedef SmartPtr<ShareGroup> ShareGroupPtr;
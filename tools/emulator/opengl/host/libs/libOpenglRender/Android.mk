@@ -17,6 +17,7 @@ LOCAL_ADDITIONAL_DEPENDENCIES := \
 LOCAL_SRC_FILES := \
     render_api.cpp \
     ColorBuffer.cpp \
+    YUVConverter.cpp \
     EGLDispatch.cpp \
     FBConfig.cpp \
     FrameBuffer.cpp \
@@ -28,7 +29,16 @@ LOCAL_SRC_FILES := \
     ThreadInfo.cpp \
     RenderThread.cpp \
     ReadBuffer.cpp \
-    RenderServer.cpp
+    ShmStream.cpp \
+    FrameTrace.cpp \
+    StreamCapture.cpp \
+    FrameShm.cpp \
+    FrameRecorder.cpp \
+    RenderServer.cpp \
+    RenderTenant.cpp \
+    RendererSnapshot.cpp \
+    GpuMemory.cpp \
+    RenderScheduler.cpp
 
 LOCAL_C_INCLUDES += \
     $(emulatorOpengl)/host/include \
@@ -57,7 +67,7 @@ ifeq ($(HOST_OS),windows)
 endif
 
 ifeq ($(HOST_OS),linux)
-    LOCAL_LDLIBS := -ldl -lpthread -lrt
+    LOCAL_LDLIBS := -ldl -lpthread -lrt -lX11
 endif
 
 # XXX - uncomment for debug
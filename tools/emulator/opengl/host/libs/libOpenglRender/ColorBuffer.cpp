@@ -17,7 +17,139 @@
 #include "FrameBuffer.h"
 #include "EGLDispatch.h"
 #include "GLDispatch.h"
+#include "YUVConverter.h"
+#include "StreamCompress.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <list>
+#include <map>
+#include <utils/threads.h>
+
+//
+// Pool of the GL objects of released color buffers. Guest gralloc
+// allocates and frees buffers of the same few sizes all the time, so
+// the texture, EGLImage and FBO of a destroyed color buffer are kept
+// and handed to the next color buffer created with the same size and
+// internal format. The pool is bounded by ANDROID_CB_POOL_MAX entries
+// and ANDROID_CB_POOL_MAX_MB megabytes, the oldest entries are released
+// first. Setting ANDROID_CB_POOL_MAX to 0 disables the pool.
+// GL objects belong to the share group of a framebuffer, so each
+// framebuffer has its own pool, which is only accessed with the lock of
+// that framebuffer held. s_poolsLock only protects the map of pools.
+//
+#define CB_POOL_DEFAULT_MAX      8
+#define CB_POOL_DEFAULT_MAX_MB   32
+
+struct PooledColorBuffer {
+    GLuint tex;
+    EGLImageKHR eglImage;
+    GLuint fbo;
+    GLuint width;
+    GLuint height;
+    GLenum internalFormat;
+};
+
+typedef std::list<PooledColorBuffer> PooledColorBufferList;
+
+struct ColorBufferPool {
+    ColorBufferPool() : bytes(0) {}
+    PooledColorBufferList entries;
+    size_t bytes;
+};
+
+typedef std::map<FrameBuffer *, ColorBufferPool> ColorBufferPoolMap;
+
+static ColorBufferPoolMap s_pools;
+static android::Mutex s_poolsLock;
+
+// the buffer object of the post quad of each framebuffer, see drawTexQuad
+typedef std::map<FrameBuffer *, GLuint> QuadVBOMap;
+static QuadVBOMap s_quadVBOs;  // protected by s_poolsLock
+static size_t s_poolMaxEntries = 0;
+static size_t s_poolMaxBytes = 0;
+
+static void getPoolLimits()
+{
+    static bool s_limitsRead = false;
+    if (s_limitsRead) {
+        return;
+    }
+
+    const char *max = getenv("ANDROID_CB_POOL_MAX");
+    const char *maxMB = getenv("ANDROID_CB_POOL_MAX_MB");
+    s_poolMaxEntries = max ? atoi(max) : CB_POOL_DEFAULT_MAX;
+    s_poolMaxBytes = (size_t)(maxMB ? atoi(maxMB) : CB_POOL_DEFAULT_MAX_MB)
+                     * 1024 * 1024;
+    s_limitsRead = true;
+}
+
+static size_t pooledSize(const PooledColorBuffer &p)
+{
+    // assume 32 bits per pixel whatever the internal format
+    return (size_t)p.width * p.height * 4;
+}
+
+// getPool - the pool of 'fb', map nodes are never moved by insertions
+static ColorBufferPool &getPool(FrameBuffer *fb)
+{
+    android::Mutex::Autolock lock(s_poolsLock);
+    return s_pools[fb];
+}
+
+static void releasePooled(FrameBuffer *fb, const PooledColorBuffer &p)
+{
+    s_gl.glDeleteTextures(1, &p.tex);
+    if (p.eglImage) {
+        s_egl.eglDestroyImageKHR(fb->getDisplay(), p.eglImage);
+    }
+    if (p.fbo) {
+        s_gl.glDeleteFramebuffersOES(1, &p.fbo);
+    }
+}
+
+// textureFormat - YUV buffers are converted to RGBA when they are updated
+static GLenum textureFormat(GLenum p_internalFormat)
+{
+    if (YUVConverter::isYUVFormat(p_internalFormat)) {
+        return GL_RGBA;
+    }
+    return p_internalFormat;
+}
+
+// storageFormat - the RGBA buffers are stored in the host preferred layout
+static GLenum storageFormat(FrameBuffer *fb, GLenum p_internalFormat)
+{
+    if (textureFormat(p_internalFormat) == GL_RGBA) {
+        return fb->getCaps().uploadFormat;
+    }
+    return GL_RGBA;
+}
+
+// storageInternalFormat - the internal format of the texture, which is
+//     its storage format for the RGBA buffers
+static GLenum storageInternalFormat(GLenum p_internalFormat,
+                                    GLenum p_storageFormat)
+{
+    GLenum format = textureFormat(p_internalFormat);
+    return format == GL_RGBA ? p_storageFormat : format;
+}
+
+static bool isRGBALayout(GLenum p_format)
+{
+    return p_format == GL_RGBA || p_format == GL_BGRA_EXT;
+}
+
+void ColorBuffer::swapRedBlue(const unsigned char *src, unsigned char *dst,
+                              size_t count)
+{
+    for (size_t i = 0; i < count; i++, src += 4, dst += 4) {
+        unsigned char r = src[0];
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = r;
+        dst[3] = src[3];
+    }
+}
 
 ColorBuffer *ColorBuffer::create(int p_width, int p_height,
                                  GLenum p_internalFormat)
@@ -29,20 +161,60 @@ ColorBuffer *ColorBuffer::create(int p_width, int p_height,
     }
 
     ColorBuffer *cb = new ColorBuffer();
+    cb->m_fb = fb;
+    cb->m_width = p_width;
+    cb->m_height = p_height;
+    cb->m_internalFormat = p_internalFormat;
+    cb->m_storageFormat = storageFormat(fb, p_internalFormat);
+    cb->m_lastUse = fb->nextUseStamp();
+    cb->m_memUsage.init(fb->getMemAccount());
+    cb->m_memUsage.set((long long)p_width * p_height * 4, 0);
+
+    ColorBufferPool &pool = getPool(fb);
+    for (PooledColorBufferList::iterator i = pool.entries.begin();
+         i != pool.entries.end(); i++) {
+        if (i->width == cb->m_width && i->height == cb->m_height &&
+            i->internalFormat == p_internalFormat) {
+            cb->m_tex = i->tex;
+            cb->m_eglImage = i->eglImage;
+            cb->m_fbo = i->fbo;
+            // the texture may have been posted with another filter
+            s_gl.glBindTexture(GL_TEXTURE_2D, cb->m_tex);
+            s_gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            s_gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            // it still has the pixels of its previous owner, which may
+            // be another guest process
+            if (cb->bind_fbo()) {
+                s_gl.glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+                s_gl.glClear(GL_COLOR_BUFFER_BIT);
+                s_gl.glBindFramebufferOES(GL_FRAMEBUFFER_OES, 0);
+            }
+            else {
+                // not renderable, re-specifying it would orphan the image
+                void *zeros = calloc((size_t)cb->m_width * cb->m_height, 4);
+                s_gl.glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
+                                     cb->m_width, cb->m_height,
+                                     storageInternalFormat(p_internalFormat,
+                                                           cb->m_storageFormat),
+                                     GL_UNSIGNED_BYTE, zeros);
+                free(zeros);
+            }
+            pool.bytes -= pooledSize(*i);
+            GpuMemory::charge(fb->getOwnMemAccount(),
+                              -(long long)pooledSize(*i), 0);
+            pool.entries.erase(i);
+            fb->unbind_locked();
+            return cb;
+        }
+    }
 
     s_gl.glGenTextures(1, &cb->m_tex);
     s_gl.glBindTexture(GL_TEXTURE_2D, cb->m_tex);
-    s_gl.glTexImage2D(GL_TEXTURE_2D, 0, p_internalFormat,
-                      p_width, p_height, 0,
-                      GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    cb->uploadStorage(NULL);
     s_gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     s_gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     s_gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     s_gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    s_gl.glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
-
-    cb->m_width = p_width;
-    cb->m_height = p_height;
 
     if (fb->getCaps().has_eglimage_texture_2d) {
         cb->m_eglImage = s_egl.eglCreateImageKHR(fb->getDisplay(),
@@ -57,40 +229,519 @@ ColorBuffer *ColorBuffer::create(int p_width, int p_height,
 }
 
 ColorBuffer::ColorBuffer() :
+    m_fb(NULL),
     m_tex(0),
     m_eglImage(NULL),
-    m_fbo(0)
+    m_width(0),
+    m_height(0),
+    m_internalFormat(0),
+    m_storageFormat(GL_RGBA),
+    m_fbo(0),
+    m_postFilter(GL_NEAREST),
+    m_rendered(false),
+    m_renderedDirectly(false),
+    m_generation(1),
+    m_directTargets(0),
+    m_snapshotFile(NULL),
+    m_snapshotPixels(NULL),
+    m_evicted(false),
+    m_evictedPixels(NULL),
+    m_evictedLen(0),
+    m_lastUse(0)
 {
 }
 
 ColorBuffer::~ColorBuffer()
 {
-    FrameBuffer *fb = FrameBuffer::getFB();
+    FrameBuffer *fb = m_fb;
     fb->bind_locked();
-    s_gl.glDeleteTextures(1, &m_tex);
-    if (m_eglImage) {
-        s_egl.eglDestroyImageKHR(fb->getDisplay(), m_eglImage);
+
+    PooledColorBuffer p;
+    p.tex = m_tex;
+    p.eglImage = m_eglImage;
+    p.fbo = m_fbo;
+    p.width = m_width;
+    p.height = m_height;
+    p.internalFormat = m_internalFormat;
+
+    // the storage of an evicted buffer does not have its size anymore
+    free(m_evictedPixels);
+    getPoolLimits();
+    if (!m_evicted &&
+        s_poolMaxEntries > 0 && pooledSize(p) <= s_poolMaxBytes) {
+        // make room for the new entry, oldest entries go first
+        ColorBufferPool &pool = getPool(fb);
+        while (pool.entries.size() >= s_poolMaxEntries ||
+               pool.bytes + pooledSize(p) > s_poolMaxBytes) {
+            releasePooled(fb, pool.entries.front());
+            pool.bytes -= pooledSize(pool.entries.front());
+            GpuMemory::charge(fb->getOwnMemAccount(),
+                              -(long long)pooledSize(pool.entries.front()), 0);
+            pool.entries.pop_front();
+        }
+        pool.entries.push_back(p);
+        pool.bytes += pooledSize(p);
+        GpuMemory::charge(fb->getOwnMemAccount(), pooledSize(p), 0);
     }
-    if (m_fbo) {
-        s_gl.glDeleteFramebuffersOES(1, &m_fbo);
+    else {
+        releasePooled(fb, p);
     }
+
     fb->unbind_locked();
 }
 
+void ColorBuffer::releasePool(FrameBuffer *fb)
+{
+    ColorBufferPool pool;
+    {
+        android::Mutex::Autolock lock(s_poolsLock);
+        // a later framebuffer at the same address sets up its own quad
+        QuadVBOMap::iterator quad = s_quadVBOs.find(fb);
+        if (quad != s_quadVBOs.end()) {
+            s_gl.glDeleteBuffers(1, &quad->second);
+            s_quadVBOs.erase(quad);
+        }
+
+        ColorBufferPoolMap::iterator it = s_pools.find(fb);
+        if (it == s_pools.end()) {
+            return;
+        }
+        pool = it->second;
+        s_pools.erase(it);
+    }
+
+    for (PooledColorBufferList::iterator i = pool.entries.begin();
+         i != pool.entries.end(); i++) {
+        releasePooled(fb, *i);
+    }
+    GpuMemory::charge(fb->getOwnMemAccount(), -(long long)pool.bytes, 0);
+}
+
+//
+// toStorageLayout - 'p_pixels' in the byte order of the storage. The
+//     GL_RGBA or GL_BGRA_EXT pixels of the other order are swizzled into
+//     a new '*p_converted' buffer, which the caller frees, and '*p_format'
+//     is updated. Other pixels are returned as they are, the driver
+//     converts them if it has to.
+//
+const void *ColorBuffer::toStorageLayout(GLenum *p_format, GLenum p_type,
+                                         const void *p_pixels, size_t p_count,
+                                         unsigned char **p_converted)
+{
+    *p_converted = NULL;
+    if (!p_pixels || p_type != GL_UNSIGNED_BYTE ||
+        *p_format == m_storageFormat || !isRGBALayout(*p_format)) {
+        return p_pixels;
+    }
+
+    unsigned char *converted = (unsigned char *)malloc(p_count * 4);
+    if (!converted) {
+        return p_pixels;
+    }
+    swapRedBlue((const unsigned char *)p_pixels, converted, p_count);
+    *p_converted = converted;
+    *p_format = m_storageFormat;
+    return converted;
+}
+
+//
+// uploadStorage - allocates the storage of the bound texture, with the
+//     'p_pixels' of the storage format if not NULL
+//
+void ColorBuffer::uploadStorage(const void *p_pixels)
+{
+    s_gl.glTexImage2D(GL_TEXTURE_2D, 0,
+                      storageInternalFormat(m_internalFormat, m_storageFormat),
+                      m_width, m_height, 0,
+                      m_storageFormat, GL_UNSIGNED_BYTE, p_pixels);
+}
+
 void ColorBuffer::update(GLenum p_format, GLenum p_type, void *pixels)
 {
-    FrameBuffer *fb = FrameBuffer::getFB();
-    if (!fb->bind_locked()) return;
+    makeResident(false);
+    unsigned char *converted;
+    const void *data = toStorageLayout(&p_format, p_type, pixels,
+                                       (size_t)m_width * m_height, &converted);
+    FrameBuffer *fb = m_fb;
+    if (!fb->bind_locked()) {
+        free(converted);
+        return;
+    }
     s_gl.glBindTexture(GL_TEXTURE_2D, m_tex);
     s_gl.glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     s_gl.glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
-                         m_width, m_height, p_format, p_type, pixels);
+                         m_width, m_height, p_format, p_type, data);
     fb->unbind_locked();
+    free(converted);
+    contentChanged();
+}
+
+//
+// The evicted pixels are compressed in blocks of LZ4_MAX_BLOCK_SIZE bytes,
+// each one preceded by its compressed size.
+//
+static unsigned char *compressPixels(const unsigned char *p_pixels,
+                                     size_t p_len, size_t *p_packedLen)
+{
+    size_t blocks = (p_len + LZ4_MAX_BLOCK_SIZE - 1) / LZ4_MAX_BLOCK_SIZE;
+    size_t maxLen = blocks * (sizeof(uint32_t) +
+                              LZ4_COMPRESS_BOUND(LZ4_MAX_BLOCK_SIZE));
+    unsigned char *packed = (unsigned char *)malloc(maxLen);
+    if (!packed) {
+        return NULL;
+    }
+
+    size_t pos = 0;
+    for (size_t off = 0; off < p_len; off += LZ4_MAX_BLOCK_SIZE) {
+        size_t n = p_len - off;
+        if (n > LZ4_MAX_BLOCK_SIZE) {
+            n = LZ4_MAX_BLOCK_SIZE;
+        }
+        size_t clen = lz4Compress(p_pixels + off, n,
+                                  packed + pos + sizeof(uint32_t),
+                                  maxLen - pos - sizeof(uint32_t));
+        if (clen == 0) {
+            free(packed);
+            return NULL;
+        }
+        *(uint32_t *)(packed + pos) = clen;
+        pos += sizeof(uint32_t) + clen;
+    }
+
+    unsigned char *shrunk = (unsigned char *)realloc(packed, pos ? pos : 1);
+    *p_packedLen = pos;
+    return shrunk ? shrunk : packed;
+}
+
+static bool decompressPixels(const unsigned char *p_packed, size_t p_packedLen,
+                             unsigned char *p_pixels, size_t p_len)
+{
+    size_t pos = 0;
+    size_t off = 0;
+    while (pos < p_packedLen) {
+        uint32_t clen = *(const uint32_t *)(p_packed + pos);
+        pos += sizeof(uint32_t);
+        int n = lz4Decompress(p_packed + pos, clen,
+                              p_pixels + off, p_len - off);
+        if (n < 0) {
+            return false;
+        }
+        pos += clen;
+        off += n;
+    }
+    return off == p_len;
+}
+
+void ColorBuffer::makeResident(bool p_keepContent)
+{
+    m_lastUse = m_fb->nextUseStamp();
+    if (!m_evicted && !m_snapshotPixels) {
+        return;
+    }
+
+    FrameBuffer *fb = m_fb;
+    if (!fb->bind_locked()) return;
+    s_gl.glBindTexture(GL_TEXTURE_2D, m_tex);
+    s_gl.glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    if (m_evicted) {
+        size_t len = (size_t)m_width * m_height * 4;
+        unsigned char *pixels = NULL;
+        if (p_keepContent && m_evictedPixels) {
+            pixels = (unsigned char *)malloc(len);
+            if (pixels &&
+                !decompressPixels(m_evictedPixels, m_evictedLen, pixels, len)) {
+                free(pixels);
+                pixels = NULL;
+            }
+        }
+
+        // the pixels were read back in the host readback layout
+        GLenum readFormat = fb->getCaps().readbackFormat;
+        if (pixels && readFormat != m_storageFormat) {
+            swapRedBlue(pixels, pixels, (size_t)m_width * m_height);
+        }
+        uploadStorage(pixels);
+        free(pixels);
+
+        // the image of the evicted storage is gone with it
+        if (fb->getCaps().has_eglimage_texture_2d) {
+            m_eglImage = s_egl.eglCreateImageKHR(fb->getDisplay(),
+                                                 fb->getContext(),
+                                                 EGL_GL_TEXTURE_2D_KHR,
+                                                 (EGLClientBuffer)m_tex,
+                                                 NULL);
+        }
+
+        free(m_evictedPixels);
+        m_evictedPixels = NULL;
+        m_evictedLen = 0;
+        m_evicted = false;
+        m_memUsage.set(len, 0);
+        GpuMemory::countEviction(m_memUsage.getAccount(), true);
+    }
+
+    if (m_snapshotPixels && p_keepContent) {
+        GLenum format = GL_RGBA;
+        unsigned char *converted;
+        const void *data = toStorageLayout(&format, GL_UNSIGNED_BYTE,
+                                           m_snapshotPixels,
+                                           (size_t)m_width * m_height,
+                                           &converted);
+        s_gl.glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height,
+                             format, GL_UNSIGNED_BYTE, data);
+        free(converted);
+    }
+    dropSnapshotContent();
+
+    fb->unbind_locked();
+    contentChanged();
+}
+
+bool ColorBuffer::evict()
+{
+    if (m_evicted || m_directTargets > 0) {
+        return false;
+    }
+
+    //
+    // the pixels still pending from a snapshot are uploaded from it again,
+    // others are read back and compressed
+    //
+    unsigned char *packed = NULL;
+    size_t packedLen = 0;
+    if (!m_snapshotPixels) {
+        size_t len = (size_t)m_width * m_height * 4;
+        unsigned char *pixels = (unsigned char *)malloc(len);
+        if (!pixels) {
+            return false;
+        }
+        if (!readPixels(0, 0, m_width, m_height,
+                        m_fb->getCaps().readbackFormat, GL_UNSIGNED_BYTE,
+                        pixels)) {
+            free(pixels);
+            return false;
+        }
+        packed = compressPixels(pixels, len, &packedLen);
+        free(pixels);
+        if (!packed) {
+            return false;
+        }
+    }
+
+    FrameBuffer *fb = m_fb;
+    if (!fb->bind_locked()) {
+        free(packed);
+        return false;
+    }
+    if (m_fbo) {
+        s_gl.glDeleteFramebuffersOES(1, &m_fbo);
+        m_fbo = 0;
+    }
+    if (m_eglImage) {
+        s_egl.eglDestroyImageKHR(fb->getDisplay(), m_eglImage);
+        m_eglImage = NULL;
+    }
+    s_gl.glBindTexture(GL_TEXTURE_2D, m_tex);
+    s_gl.glTexImage2D(GL_TEXTURE_2D, 0,
+                      storageInternalFormat(m_internalFormat, m_storageFormat),
+                      1, 1, 0, m_storageFormat, GL_UNSIGNED_BYTE, NULL);
+    fb->unbind_locked();
+
+    m_evicted = true;
+    m_evictedPixels = packed;
+    m_evictedLen = packedLen;
+    m_memUsage.set(4, packedLen);
+    GpuMemory::countEviction(m_memUsage.getAccount(), false);
+    return true;
+}
+
+//
+// subUpdate - update only the (x, y, width, height) rectangle of the
+//     color buffer, 'pixels' holds exactly width x height tightly packed
+//     pixels. Returns false if the rectangle is outside of the buffer.
+//     YUV pixels can only update the whole buffer, they are converted
+//     to RGBA on the way. RGBA pixels are swizzled here if the storage
+//     has the other layout.
+//
+bool ColorBuffer::subUpdate(int x, int y, int width, int height,
+                            GLenum p_format, GLenum p_type, void *pixels)
+{
+    if (x < 0 || y < 0 || width <= 0 || height <= 0 ||
+        (GLuint)(x + width) > m_width || (GLuint)(y + height) > m_height) {
+        return false;
+    }
+
+    unsigned char *rgba = NULL;
+    if (YUVConverter::isYUVFormat(p_format)) {
+        if (x != 0 || y != 0 || (GLuint)width != m_width ||
+            (GLuint)height != m_height || (width & 1) || (height & 1)) {
+            return false;
+        }
+        rgba = (unsigned char *)malloc(width * height * 4);
+        if (!rgba) {
+            return false;
+        }
+        YUVConverter::yuvToRGBA(p_format, width, height,
+                                (const unsigned char *)pixels, rgba);
+        p_format = GL_RGBA;
+        p_type = GL_UNSIGNED_BYTE;
+        if (m_storageFormat == GL_BGRA_EXT) {
+            swapRedBlue(rgba, rgba, (size_t)width * height);
+            p_format = GL_BGRA_EXT;
+        }
+        pixels = rgba;
+    }
+    else {
+        const void *data = toStorageLayout(&p_format, p_type, pixels,
+                                           (size_t)width * height, &rgba);
+        pixels = (void *)data;
+    }
+
+    makeResident(x != 0 || y != 0 ||
+                 (GLuint)width != m_width || (GLuint)height != m_height);
+
+    FrameBuffer *fb = m_fb;
+    if (!fb->bind_locked()) {
+        free(rgba);
+        return false;
+    }
+    s_gl.glBindTexture(GL_TEXTURE_2D, m_tex);
+    s_gl.glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    s_gl.glTexSubImage2D(GL_TEXTURE_2D, 0, x, y,
+                         width, height, p_format, p_type, pixels);
+    fb->unbind_locked();
+    free(rgba);
+    contentChanged();
+    return true;
+}
+
+//
+// readPixels - read back the (x, y, width, height) rectangle of the color
+//     buffer, 'pixels' receives width x height tightly packed pixels. Any
+//     of GL_RGBA and GL_BGRA_EXT is read in the host readback layout.
+//
+bool ColorBuffer::readPixels(int x, int y, int width, int height,
+                             GLenum p_format, GLenum p_type, void *pixels)
+{
+    if (YUVConverter::isYUVFormat(p_format)) {
+        return false;
+    }
+    if (x < 0 || y < 0 || width <= 0 || height <= 0 ||
+        (GLuint)(x + width) > m_width || (GLuint)(y + height) > m_height) {
+        return false;
+    }
+
+    ensureContent();
+    FrameBuffer *fb = m_fb;
+    if (!fb->bind_locked()) return false;
+    if (!bind_fbo()) {
+        fb->unbind_locked();
+        return false;
+    }
+    // the pixels are read in the host layout, and swizzled here if the
+    // other one was asked for
+    GLenum readFormat = p_format;
+    if (p_type == GL_UNSIGNED_BYTE && isRGBALayout(p_format)) {
+        readFormat = fb->getCaps().readbackFormat;
+    }
+    s_gl.glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    s_gl.glReadPixels(x, y, width, height, readFormat, p_type, pixels);
+    s_gl.glBindFramebufferOES(GL_FRAMEBUFFER_OES, 0);
+    fb->unbind_locked();
+    if (readFormat != p_format) {
+        swapRedBlue((const unsigned char *)pixels, (unsigned char *)pixels,
+                    (size_t)width * height);
+    }
+    return true;
+}
+
+//
+// copyRect - GPU side copy of the (x, y, width, height) rectangle of the
+//     color buffer to the origin of 'p_dst', which must be large enough.
+//     The framebuffer lock should be held.
+//
+bool ColorBuffer::copyRect(ColorBuffer *p_dst, int x, int y,
+                           int width, int height)
+{
+    if (x < 0 || y < 0 || width <= 0 || height <= 0 ||
+        (GLuint)(x + width) > m_width || (GLuint)(y + height) > m_height ||
+        (GLuint)width > p_dst->m_width || (GLuint)height > p_dst->m_height) {
+        return false;
+    }
+
+    ensureContent();
+    p_dst->ensureContent();
+
+    FrameBuffer *fb = m_fb;
+    if (!fb->bind_locked()) return false;
+    if (!bind_fbo()) {
+        fb->unbind_locked();
+        return false;
+    }
+    s_gl.glBindTexture(GL_TEXTURE_2D, p_dst->m_tex);
+    s_gl.glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, x, y, width, height);
+    bool ret = (s_gl.glGetError() == GL_NO_ERROR);
+    s_gl.glBindFramebufferOES(GL_FRAMEBUFFER_OES, 0);
+    fb->unbind_locked();
+    p_dst->contentChanged();
+    return ret;
+}
+
+//
+// copyFromSurface - GPU side copy of the bottom left width x height pixels
+//     of the current read surface of the framebuffer context, which must
+//     be bound, to the origin of the color buffer.
+//
+bool ColorBuffer::copyFromSurface(int width, int height)
+{
+    if (width <= 0 || height <= 0 ||
+        (GLuint)width > m_width || (GLuint)height > m_height) {
+        return false;
+    }
+
+    makeResident(false);
+    s_gl.glBindTexture(GL_TEXTURE_2D, m_tex);
+    s_gl.glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+    contentChanged();
+    return s_gl.glGetError() == GL_NO_ERROR;
+}
+
+//
+// drawScaled - draws the whole of 'p_src' over the color buffer, filtered
+//     to its size. The framebuffer context must be bound, the default
+//     framebuffer is bound again on return.
+//
+bool ColorBuffer::drawScaled(ColorBuffer *p_src)
+{
+    p_src->ensureContent();
+    makeResident(false);
+    if (!bind_fbo()) {
+        return false;
+    }
+
+    GLint viewport[4];
+    s_gl.glGetIntegerv(GL_VIEWPORT, viewport);
+    s_gl.glViewport(0, 0, m_width, m_height);
+    s_gl.glMatrixMode(GL_MODELVIEW);
+    s_gl.glPushMatrix();
+    s_gl.glLoadIdentity();
+
+    p_src->setPostFilter(GL_LINEAR);
+    s_gl.glBindTexture(GL_TEXTURE_2D, p_src->m_tex);
+    drawTexQuad();
+
+    s_gl.glPopMatrix();
+    s_gl.glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    s_gl.glBindFramebufferOES(GL_FRAMEBUFFER_OES, 0);
+    contentChanged();
+    return true;
 }
 
 bool ColorBuffer::blitFromPbuffer(EGLSurface p_pbufSurface)
 {
-    FrameBuffer *fb = FrameBuffer::getFB();
+    makeResident(false);
+    FrameBuffer *fb = m_fb;
     if (!fb->bind_locked()) return false;
 
     //
@@ -118,8 +769,6 @@ bool ColorBuffer::blitFromPbuffer(EGLSurface p_pbufSurface)
     s_gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     s_gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     s_gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    s_gl.glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
-    s_gl.glEnable(GL_TEXTURE_2D);
 
     drawTexQuad();
 
@@ -134,6 +783,35 @@ bool ColorBuffer::blitFromPbuffer(EGLSurface p_pbufSurface)
     return true;
 }
 
+//
+// copyFromPbuffer - GPU side copy of the pbuffer content into the color
+//     buffer texture, by reading it with the framebuffer context. This
+//     fails if the pbuffer config is not compatible with that context.
+//     The framebuffer lock should be held.
+//
+bool ColorBuffer::copyFromPbuffer(EGLSurface p_pbufSurface)
+{
+    makeResident(false);
+    FrameBuffer *fb = m_fb;
+
+    EGLContext prevContext = s_egl.eglGetCurrentContext();
+    EGLSurface prevReadSurf = s_egl.eglGetCurrentSurface(EGL_READ);
+    EGLSurface prevDrawSurf = s_egl.eglGetCurrentSurface(EGL_DRAW);
+
+    if (!s_egl.eglMakeCurrent(fb->getDisplay(), p_pbufSurface,
+                              p_pbufSurface, fb->getContext())) {
+        return false;
+    }
+
+    s_gl.glBindTexture(GL_TEXTURE_2D, m_tex);
+    s_gl.glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, m_width, m_height);
+    bool ret = (s_gl.glGetError() == GL_NO_ERROR);
+
+    s_egl.eglMakeCurrent(fb->getDisplay(), prevDrawSurf,
+                         prevReadSurf, prevContext);
+    return ret;
+}
+
 bool ColorBuffer::bind_fbo()
 {
     if (m_fbo) {
@@ -160,30 +838,111 @@ bool ColorBuffer::bind_fbo()
 
 bool ColorBuffer::post()
 {
+    ensureContent();
     s_gl.glBindTexture(GL_TEXTURE_2D, m_tex);
-    s_gl.glEnable(GL_TEXTURE_2D);
     drawTexQuad();
 
     return true;
 }
 
-void ColorBuffer::drawTexQuad()
+//
+// setPostFilter - texture filter used when posting, GL_LINEAR when the
+//     display is scaled. Only the framebuffer context samples m_tex.
+//     The framebuffer lock should be held.
+//
+void ColorBuffer::setPostFilter(GLenum p_filter)
+{
+    if (p_filter == m_postFilter) {
+        return;
+    }
+    s_gl.glBindTexture(GL_TEXTURE_2D, m_tex);
+    s_gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, p_filter);
+    s_gl.glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, p_filter);
+    m_postFilter = p_filter;
+}
+
+static void initTexQuad(FrameBuffer *fb);
+
+//
+// postLayer - draws the color buffer over the unit quad, mapped on its
+//     rectangle by the current modelview matrix. A blended layer has
+//     premultiplied pixels, faded by 'alpha' (0 to 255), drawn over what
+//     is already there.
+//     The framebuffer lock should be held.
+//
+bool ColorBuffer::postLayer(int alpha, bool blend)
+{
+    ensureContent();
+    s_gl.glBindTexture(GL_TEXTURE_2D, m_tex);
+
+    if (!blend) {
+        drawTexQuad();
+        return true;
+    }
+
+    GLfloat a = (alpha < 0 ? 0 : alpha > 255 ? 255 : alpha) / 255.0f;
+    initTexQuad(m_fb);
+    s_gl.glEnable(GL_BLEND);
+    s_gl.glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    s_gl.glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    s_gl.glColor4f(a, a, a, a);
+
+    drawTexQuad();
+
+    // back to the state drawTexQuad expects
+    s_gl.glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+    s_gl.glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+    s_gl.glDisable(GL_BLEND);
+    return true;
+}
+
+//
+// drawTexQuad - draws the currently bound texture over the whole
+//     viewport, unless the modelview matrix maps it elsewhere. The quad
+//     vertices are kept in a buffer object and the array and texturing
+//     state is set up once per framebuffer, since its context is only
+//     used for color buffer composition. Each framebuffer has a context
+//     of its own (see FrameBuffer::create), so the quad is kept by
+//     framebuffer the same way as the pools.
+//     The framebuffer lock should be held.
+//
+static void initTexQuad(FrameBuffer *fb)
 {
-    GLfloat verts[] = { -1.0f, -1.0f, 0.0f,
-                         -1.0f, +1.0f, 0.0f,
-                         +1.0f, -1.0f, 0.0f,
-                         +1.0f, +1.0f, 0.0f };
+    GLuint vbo;
+    {
+        android::Mutex::Autolock lock(s_poolsLock);
+        GLuint &entry = s_quadVBOs[fb];
+        if (entry) {
+            return;
+        }
+        s_gl.glGenBuffers(1, &entry);
+        vbo = entry;
+    }
 
-    GLfloat tcoords[] = { 0.0f, 0.0f,
-                           0.0f, 1.0f,
-                           1.0f, 0.0f,
-                           1.0f, 1.0f };
+    // interleaved x, y, z, s, t
+    static const GLfloat quad[] = { -1.0f, -1.0f, 0.0f, 0.0f, 0.0f,
+                                    -1.0f, +1.0f, 0.0f, 0.0f, 1.0f,
+                                    +1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+                                    +1.0f, +1.0f, 0.0f, 1.0f, 1.0f };
+    const GLsizei stride = 5 * sizeof(GLfloat);
+
+    s_gl.glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    s_gl.glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
 
     s_gl.glClientActiveTexture(GL_TEXTURE0);
     s_gl.glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-    s_gl.glTexCoordPointer(2, GL_FLOAT, 0, tcoords);
-
+    s_gl.glTexCoordPointer(2, GL_FLOAT, stride,
+                           (const GLvoid *)(3 * sizeof(GLfloat)));
     s_gl.glEnableClientState(GL_VERTEX_ARRAY);
-    s_gl.glVertexPointer(3, GL_FLOAT, 0, verts);
+    s_gl.glVertexPointer(3, GL_FLOAT, stride, 0);
+    s_gl.glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    s_gl.glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+    s_gl.glEnable(GL_TEXTURE_2D);
+}
+
+void ColorBuffer::drawTexQuad()
+{
+    initTexQuad(m_fb);
     s_gl.glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 }
@@ -19,7 +19,13 @@
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
 #include <GLES/gl.h>
+#include <GLES/glext.h>
 #include <SmartPtr.h>
+#include "RendererSnapshot.h"
+#include "GpuMemory.h"
+#include <stdint.h>
+
+class FrameBuffer;
 
 class ColorBuffer
 {
@@ -28,25 +34,152 @@ public:
                                GLenum p_internalFormat);
     ~ColorBuffer();
 
+    //
+    // releasePool - deletes the GL objects kept for reuse by the color
+    //     buffers of 'fb', and its post quad, when it is destroyed. Its
+    //     context must be bound.
+    //
+    static void releasePool(FrameBuffer *fb);
+
+    //
+    // swapRedBlue - copies the 'count' 4 byte pixels of 'src' to 'dst',
+    //     which may be the same, swapping their first and third bytes. It
+    //     turns GL_RGBA pixels into GL_BGRA_EXT ones and back.
+    //
+    static void swapRedBlue(const unsigned char *src, unsigned char *dst,
+                            size_t count);
+
     GLuint getGLTextureName() const { return m_tex; }
     GLuint getWidth() const { return m_width; }
     GLuint getHeight() const { return m_height; }
+    GLenum getInternalFormat() const { return m_internalFormat; }
+    EGLImageKHR getEGLImage() const { return m_eglImage; }
 
     void update(GLenum p_format, GLenum p_type, void *pixels);
+    bool subUpdate(int x, int y, int width, int height,
+                   GLenum p_format, GLenum p_type, void *pixels);
     bool blitFromPbuffer(EGLSurface p_pbufSurface);
+    bool copyFromPbuffer(EGLSurface p_pbufSurface);
+    bool readPixels(int x, int y, int width, int height,
+                    GLenum p_format, GLenum p_type, void *pixels);
+    bool copyRect(ColorBuffer *p_dst, int x, int y, int width, int height);
+    bool copyFromSurface(int width, int height);
+    bool drawScaled(ColorBuffer *p_src);
     bool post();
+    bool postLayer(int alpha, bool blend);
+    void setPostFilter(GLenum p_filter);
+
+    //
+    // Lazy restore from a renderer snapshot (see FrameBuffer::restoreSnapshot).
+    // setSnapshotContent - the content of the buffer is the 'p_pixels'
+    //     GL_RGBA pixels of the mapped 'p_file', they are uploaded the first
+    //     time the buffer is used. Replacing the whole content drops them.
+    // ensureContent - brings the content back to the GPU, uploading the
+    //     pending snapshot pixels or the evicted ones if any, and marks
+    //     the buffer as used. The framebuffer lock should be held.
+    //
+    void setSnapshotContent(RenderSnapshotFilePtr p_file,
+                            const unsigned char *p_pixels) {
+        m_snapshotFile = p_file;
+        m_snapshotPixels = p_pixels;
+    }
+    void ensureContent() { makeResident(true); }
+
+    //
+    // Eviction under a GPU memory budget (see GpuMemory.h).
+    // evict - moves the content to compressed host memory and releases
+    //     the texture storage, until the buffer is used again. Fails for
+    //     a buffer which a window surface renders into directly. The
+    //     framebuffer lock should be held.
+    // getLastUse - FrameBuffer::nextUseStamp of the last use.
+    //
+    bool evict();
+    bool isEvicted() const { return m_evicted; }
+    uint32_t getLastUse() const { return m_lastUse; }
+    long long getGpuBytes() const { return m_memUsage.getGpuBytes(); }
+
+    //
+    // GPU rendering tracking, the guest only reads a color buffer back
+    // when it has been rendered to since it last read it.
+    // markRendered - the content was replaced by rendering.
+    // setRenderedDirectly - the buffer is a render target through its
+    //     EGLImage, any read has to assume it changed from now on.
+    // takeRendered - returns whether the buffer was rendered to since the
+    //     previous call.
+    //
+    void markRendered() { m_rendered = true; contentChanged(); }
+    void setRenderedDirectly() { m_renderedDirectly = true; }
+    bool takeRendered() {
+        bool rendered = m_rendered || m_renderedDirectly;
+        m_rendered = false;
+        return rendered;
+    }
+
+    //
+    // content generation, for a post to find out the buffer has not
+    // changed since it was displayed. The framebuffer lock should be held.
+    // getGeneration - changes with the content. It is 0 while the buffer
+    //     is the direct render target of a window surface, which renders
+    //     into it unseen.
+    // setDirectTarget - the buffer is attached to (or detached from) a
+    //     window surface rendering straight into it.
+    //
+    uint32_t getGeneration() const {
+        return m_directTargets > 0 ? 0 : m_generation;
+    }
+    void setDirectTarget(bool p_attached) {
+        if (p_attached) {
+            m_directTargets++;
+        }
+        else {
+            m_directTargets--;
+            contentChanged();
+        }
+    }
 
 private:
     ColorBuffer();
     void drawTexQuad();
+    // makeResident - ensureContent, the content is about to be replaced
+    // entirely when 'p_keepContent' is false
+    void makeResident(bool p_keepContent);
+    void dropSnapshotContent() {
+        m_snapshotPixels = NULL;
+        m_snapshotFile = RenderSnapshotFilePtr(NULL);
+    }
     bool bind_fbo();  // binds a fbo which have this texture as render target
+    const void *toStorageLayout(GLenum *p_format, GLenum p_type,
+                                const void *p_pixels, size_t p_count,
+                                unsigned char **p_converted);
+    void uploadStorage(const void *p_pixels);
+    void contentChanged() {
+        if (++m_generation == 0) m_generation = 1;
+    }
 
 private:
+    FrameBuffer *m_fb;  // the framebuffer the GL objects belong to
     GLuint m_tex;
     EGLImageKHR m_eglImage;
     GLuint m_width;
     GLuint m_height;
+    GLenum m_internalFormat;
+    // the format the texture is allocated and uploaded in, the host
+    // preferred one for the RGBA and YUV buffers (see
+    // FrameBufferCaps::uploadFormat), GL_RGBA for the others
+    GLenum m_storageFormat;
     GLuint m_fbo;
+    GLenum m_postFilter;
+    bool m_rendered;
+    bool m_renderedDirectly;
+    uint32_t m_generation;
+    int m_directTargets;
+    RenderSnapshotFilePtr m_snapshotFile;
+    const unsigned char *m_snapshotPixels;  // not uploaded yet
+    bool m_evicted;
+    unsigned char *m_evictedPixels;  // compressed, NULL for snapshot pixels
+    size_t m_evictedLen;
+    uint32_t m_lastUse;
+    GpuMemoryUsage m_memUsage;
 };
 
 typedef SmartPtr<ColorBuffer> ColorBufferPtr;
@@ -18,8 +18,12 @@
 #include "EGLDispatch.h"
 #include <stdio.h>
 
-FBConfig **FBConfig::s_fbConfigs = NULL;
-int FBConfig::s_numConfigs = 0;
+//
+// The lists are only added, under the creation lock of FrameBuffer, and
+// a list is complete before s_numLists counts it.
+//
+FBConfig::ConfigList FBConfig::s_lists[FB_CONFIG_MAX_DISPLAYS];
+int FBConfig::s_numLists = 0;
 
 const GLuint FBConfig::s_configAttribs[] = {
     EGL_DEPTH_SIZE,     // must be first - see getDepthSize()
@@ -75,6 +79,16 @@ InitConfigStatus FBConfig::initConfigList(FrameBuffer *fb)
         return ret;
     }
 
+    // the configs of a display are listed once for all its framebuffers
+    const ConfigList *found = findList(dpy);
+    if (found) {
+        return found->status;
+    }
+    if (s_numLists >= FB_CONFIG_MAX_DISPLAYS) {
+        fprintf(stderr, "Too many EGL displays, max %d\n", FB_CONFIG_MAX_DISPLAYS);
+        return ret;
+    }
+
     //
     // Query the set of configs in the EGL backend
     //
@@ -154,8 +168,10 @@ InitConfigStatus FBConfig::initConfigList(FrameBuffer *fb)
         ret = INIT_CONFIG_PASSED;
     }
 
+    ConfigList *list = &s_lists[s_numLists];
     int j = 0;
-    s_fbConfigs = new FBConfig*[nConfigs];
+    list->dpy = dpy;
+    list->configs = new FBConfig*[nConfigs];
     for (int i=0; i<nConfigs; i++) {
         if (useOnlyBindToTexture) {
             EGLint bindToTexture;
@@ -170,33 +186,69 @@ InitConfigStatus FBConfig::initConfigList(FrameBuffer *fb)
             if (!(surfaceType & EGL_PBUFFER_BIT)) continue;
         }
 
-        s_fbConfigs[j++] = new FBConfig(dpy, configs[i]);
+        list->configs[j++] = new FBConfig(dpy, configs[i]);
     }
-    s_numConfigs = j;
+    list->numConfigs = j;
+    list->status = ret;
+    s_numLists++;
 
     delete configs;
     return ret;
 }
 
+const FBConfig::ConfigList *FBConfig::findList(EGLDisplay p_dpy)
+{
+    for (int i=0; i<s_numLists; i++) {
+        if (s_lists[i].dpy == p_dpy) {
+            return &s_lists[i];
+        }
+    }
+    return NULL;
+}
+
+const FBConfig::ConfigList *FBConfig::currentList()
+{
+    FrameBuffer *fb = FrameBuffer::getFB();
+    return fb ? findList(fb->getDisplay()) : NULL;
+}
+
 const FBConfig *FBConfig::get(int p_config)
 {
-    if (p_config >= 0 && p_config < s_numConfigs) {
-        return s_fbConfigs[p_config];
+    const ConfigList *list = currentList();
+    if (list && p_config >= 0 && p_config < list->numConfigs) {
+        return list->configs[p_config];
+    }
+    return NULL;
+}
+
+const FBConfig *FBConfig::get(EGLDisplay p_dpy, int p_config)
+{
+    const ConfigList *list = findList(p_dpy);
+    if (list && p_config >= 0 && p_config < list->numConfigs) {
+        return list->configs[p_config];
     }
     return NULL;
 }
 
 int FBConfig::getNumConfigs()
 {
-    return s_numConfigs;
+    const ConfigList *list = currentList();
+    return list ? list->numConfigs : 0;
+}
+
+int FBConfig::getNumConfigs(EGLDisplay p_dpy)
+{
+    const ConfigList *list = findList(p_dpy);
+    return list ? list->numConfigs : 0;
 }
 
 void FBConfig::packConfigsInfo(GLuint *buffer)
 {
+    const ConfigList *list = currentList();
     memcpy(buffer, s_configAttribs, s_numConfigAttribs * sizeof(GLuint));
-    for (int i=0; i<s_numConfigs; i++) {
+    for (int i=0; list && i<list->numConfigs; i++) {
         memcpy(buffer+(i+1)*s_numConfigAttribs,
-               &s_fbConfigs[i]->m_attribValues,
+               &list->configs[i]->m_attribValues,
                s_numConfigAttribs * sizeof(GLuint));
     }
 }
@@ -21,6 +21,9 @@
 
 class FrameBuffer;
 
+// number of EGL displays whose configs can be listed, see initConfigList
+#define FB_CONFIG_MAX_DISPLAYS 8
+
 enum InitConfigStatus {
     INIT_CONFIG_FAILED = 0,
     INIT_CONFIG_PASSED = 1,
@@ -30,9 +33,17 @@ enum InitConfigStatus {
 class FBConfig
 {
 public:
+    //
+    // initConfigList - lists the usable configs of the display of 'fb'.
+    //     The list is made once per display and shared by all the
+    //     framebuffers on it. get, getNumConfigs and packConfigsInfo without
+    //     a display use the display of the framebuffer of the calling thread.
+    //
     static InitConfigStatus initConfigList(FrameBuffer *fb);
     static const FBConfig *get(int p_config);
+    static const FBConfig *get(EGLDisplay p_dpy, int p_config);
     static int getNumConfigs();
+    static int getNumConfigs(EGLDisplay p_dpy);
     static int getNumAttribs() { return s_numConfigAttribs; }
     static void packConfigsInfo(GLuint *buffer);
     ~FBConfig();
@@ -47,8 +58,19 @@ private:
     FBConfig(EGLDisplay p_eglDpy, EGLConfig p_eglCfg);
 
 private:
-    static FBConfig **s_fbConfigs;
-    static int s_numConfigs;
+    struct ConfigList {
+        EGLDisplay dpy;
+        FBConfig **configs;
+        int numConfigs;
+        InitConfigStatus status;
+    };
+
+    static const ConfigList *findList(EGLDisplay p_dpy);
+    static const ConfigList *currentList();
+
+private:
+    static ConfigList s_lists[FB_CONFIG_MAX_DISPLAYS];
+    static int s_numLists;
     static const int s_numConfigAttribs;
     static const GLuint s_configAttribs[];
 
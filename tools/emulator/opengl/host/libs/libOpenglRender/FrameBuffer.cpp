@@ -19,10 +19,79 @@
 #include "GLDispatch.h"
 #include "GL2Dispatch.h"
 #include "ThreadInfo.h"
+#include "FrameTrace.h"
+#include "TimeUtils.h"
+#include "FrameShm.h"
+#include "FrameRecorder.h"
+#include "RendererSnapshot.h"
+#include "glUtils.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
 
 FrameBuffer *FrameBuffer::s_theFrameBuffer = NULL;
-HandleType FrameBuffer::s_nextHandle = 0;
+
+//
+// The dispatch tables, the EGL displays and their config lists are shared
+// by all the framebuffers of the process. s_createLock serializes their
+// initialization with the creation of the framebuffers.
+//
+static android::Mutex s_createLock;
+static bool s_dispatchLoaded = false;
+static bool s_gl2DispatchLoaded = false;
+
+#ifdef __linux__
+#define FB_MAX_NATIVE_DISPLAYS 8
+
+static struct {
+    char name[64];
+    Display *dpy;
+} s_nativeDisplays[FB_MAX_NATIVE_DISPLAYS];
+static int s_numNativeDisplays = 0;
+#endif
+
+//
+// openNativeDisplay - the native display named 'p_name', an X display
+//     such as ":0.1" to render on another screen or GPU. Each display is
+//     opened once, so the framebuffers on it share one EGL display.
+//     NULL or "" is the default display.
+//
+static bool openNativeDisplay(const char *p_name, EGLNativeDisplayType *p_dpy)
+{
+    *p_dpy = EGL_DEFAULT_DISPLAY;
+    if (!p_name || !*p_name) {
+        return true;
+    }
+
+#ifdef __linux__
+    for (int i=0; i<s_numNativeDisplays; i++) {
+        if (!strcmp(s_nativeDisplays[i].name, p_name)) {
+            *p_dpy = (EGLNativeDisplayType)s_nativeDisplays[i].dpy;
+            return true;
+        }
+    }
+    if (s_numNativeDisplays >= FB_MAX_NATIVE_DISPLAYS ||
+        strlen(p_name) >= sizeof(s_nativeDisplays[0].name)) {
+        fprintf(stderr, "FrameBuffer: cannot use display %s\n", p_name);
+        return false;
+    }
+
+    Display *dpy = XOpenDisplay(p_name);
+    if (!dpy) {
+        fprintf(stderr, "FrameBuffer: failed to open display %s\n", p_name);
+        return false;
+    }
+    strcpy(s_nativeDisplays[s_numNativeDisplays].name, p_name);
+    s_nativeDisplays[s_numNativeDisplays].dpy = dpy;
+    s_numNativeDisplays++;
+    *p_dpy = (EGLNativeDisplayType)dpy;
+#else
+    fprintf(stderr, "FrameBuffer: display %s ignored, only the default"
+                    " display is supported\n", p_name);
+#endif
+    return true;
+}
 
 #ifdef WITH_GLES2
 static const char *getGLES2ExtensionString(EGLDisplay p_dpy,
@@ -32,7 +101,7 @@ static const char *getGLES2ExtensionString(EGLDisplay p_dpy,
     EGLSurface surface;
 
     GLint configAttribs[] = {
-        EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
+        EGL_SURFACE_TYPE, p_window ? EGL_WINDOW_BIT : EGL_PBUFFER_BIT,
         EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
         EGL_NONE
     };
@@ -43,12 +112,26 @@ static const char *getGLES2ExtensionString(EGLDisplay p_dpy,
         return NULL;
     }
 
+    if (!p_window) {
+        // headless framebuffer
+        EGLint pbufAttribs[] = {
+            EGL_WIDTH, 1,
+            EGL_HEIGHT, 1,
+            EGL_NONE
+        };
+        surface = s_egl.eglCreatePbufferSurface(p_dpy, config, pbufAttribs);
+        if (surface == EGL_NO_SURFACE) {
+            return NULL;
+        }
+    }
 #if defined(__linux__) || defined(_WIN32) || defined(__VC32__) && !defined(__CYGWIN__)
-    surface = s_egl.eglCreateWindowSurface(p_dpy, config,
+    else {
+        surface = s_egl.eglCreateWindowSurface(p_dpy, config,
                                               (EGLNativeWindowType)p_window,
                                               NULL);
-    if (surface == EGL_NO_SURFACE) {
-        return NULL;
+        if (surface == EGL_NO_SURFACE) {
+            return NULL;
+        }
     }
 #endif
 
@@ -92,20 +175,59 @@ bool FrameBuffer::initialize(FBNativeWindowType p_window,
         return true;
     }
 
-    //
-    // Load EGL Plugin
-    //
-    if (!init_egl_dispatch()) {
-        // Failed to load EGL
+    FrameBuffer *fb = create(p_window, p_x, p_y, p_width, p_height,
+                             getenv("ANDROID_FB_SHM"),
+                             getenv("ANDROID_RENDER_DISPLAY"));
+    if (!fb) {
         return false;
     }
 
     //
-    // Load GLES Plugin
+    // Keep the singleton framebuffer pointer
     //
-    if (!init_gl_dispatch()) {
-        // Failed to load GLES
-        return false;
+    s_theFrameBuffer = fb;
+    return true;
+}
+
+FrameBuffer *FrameBuffer::getFB()
+{
+    FrameBuffer *fb = getRenderThreadInfo()->frameBuffer;
+    return fb ? fb : s_theFrameBuffer;
+}
+
+FrameBuffer *FrameBuffer::create(FBNativeWindowType p_window,
+                                 int p_x, int p_y,
+                                 int p_width, int p_height,
+                                 const char *p_shmName,
+                                 const char *p_displayName)
+{
+    android::Mutex::Autolock createLock(s_createLock);
+
+    if (!s_dispatchLoaded) {
+        //
+        // Load EGL Plugin
+        //
+        if (!init_egl_dispatch()) {
+            // Failed to load EGL
+            return NULL;
+        }
+
+        //
+        // Load GLES Plugin
+        //
+        if (!init_gl_dispatch()) {
+            // Failed to load GLES
+            return NULL;
+        }
+
+#ifdef WITH_GLES2
+        //
+        // Try to load GLES2 Plugin, not mandatory
+        //
+        s_gl2DispatchLoaded = !getenv("ANDROID_NO_GLES2") &&
+                              init_gl2_dispatch();
+#endif
+        s_dispatchLoaded = true;
     }
 
     //
@@ -113,30 +235,23 @@ bool FrameBuffer::initialize(FBNativeWindowType p_window,
     //
     FrameBuffer *fb = new FrameBuffer(p_x, p_y, p_width, p_height);
     if (!fb) {
-        return false;
+        return NULL;
     }
 
-#ifdef WITH_GLES2
-    //
-    // Try to load GLES2 Plugin, not mandatory
-    //
-    if (getenv("ANDROID_NO_GLES2")) {
-        fb->m_caps.hasGL2 = false;
-    }
-    else {
-        fb->m_caps.hasGL2 = init_gl2_dispatch();
-    }
-#else
-    fb->m_caps.hasGL2 = false;
-#endif
+    fb->m_caps.hasGL2 = s_gl2DispatchLoaded;
 
     //
     // Initialize backend EGL display
     //
-    fb->m_eglDisplay = s_egl.eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    EGLNativeDisplayType nativeDisplay;
+    if (!openNativeDisplay(p_displayName, &nativeDisplay)) {
+        delete fb;
+        return NULL;
+    }
+    fb->m_eglDisplay = s_egl.eglGetDisplay(nativeDisplay);
     if (fb->m_eglDisplay == EGL_NO_DISPLAY) {
         delete fb;
-        return false;
+        return NULL;
     }
     s_egl.eglInitialize(fb->m_eglDisplay, &fb->m_caps.eglMajor, &fb->m_caps.eglMinor);
     s_egl.eglBindAPI(EGL_OPENGL_ES_API);
@@ -161,9 +276,11 @@ bool FrameBuffer::initialize(FBNativeWindowType p_window,
     //
     // Create EGL context and Surface attached to the native window, for
     // framebuffer post rendering.
+    // Without a window (headless) the frames are composed into a pbuffer
+    // of the framebuffer size instead.
     //
     GLint configAttribs[] = {
-        EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
+        EGL_SURFACE_TYPE, p_window ? EGL_WINDOW_BIT : EGL_PBUFFER_BIT,
         EGL_RENDERABLE_TYPE, EGL_OPENGL_ES_BIT,
         EGL_NONE
     };
@@ -173,16 +290,39 @@ bool FrameBuffer::initialize(FBNativeWindowType p_window,
     if (!s_egl.eglChooseConfig(fb->m_eglDisplay, configAttribs,
                                &eglConfig, 1, &n)) {
         delete fb;
-        return false;
+        return NULL;
     }
 
+    if (!p_window) {
+        EGLint pbufAttribs[] = {
+            EGL_WIDTH, p_width,
+            EGL_HEIGHT, p_height,
+            EGL_NONE
+        };
+        fb->m_eglSurface = s_egl.eglCreatePbufferSurface(fb->m_eglDisplay,
+                                                       eglConfig,
+                                                       pbufAttribs);
+        if (fb->m_eglSurface == EGL_NO_SURFACE) {
+            delete fb;
+            return NULL;
+        }
+
+        //
+        // publish the frames for other processes if asked to
+        //
+        if (p_shmName) {
+            fb->m_frameShm = FrameShm::create(p_shmName, p_width, p_height);
+        }
+    }
 #if defined(__linux__) || defined(_WIN32) || defined(__VC32__) && !defined(__CYGWIN__)
-    fb->m_eglSurface = s_egl.eglCreateWindowSurface(fb->m_eglDisplay, eglConfig,
+    else {
+        fb->m_eglSurface = s_egl.eglCreateWindowSurface(fb->m_eglDisplay, eglConfig,
                                                   (EGLNativeWindowType)p_window,
                                                   NULL);
-    if (fb->m_eglSurface == EGL_NO_SURFACE) {
-        delete fb;
-        return false;
+        if (fb->m_eglSurface == EGL_NO_SURFACE) {
+            delete fb;
+            return NULL;
+        }
     }
 #endif
 
@@ -191,19 +331,34 @@ bool FrameBuffer::initialize(FBNativeWindowType p_window,
         EGL_NONE
     };
 
+    //
+    // query the swap intervals supported for the framebuffer window and
+    // the host display refresh rate
+    //
+    EGLint minSwap, maxSwap;
+    if (s_egl.eglGetConfigAttrib(fb->m_eglDisplay, eglConfig,
+                                 EGL_MIN_SWAP_INTERVAL, &minSwap) &&
+        s_egl.eglGetConfigAttrib(fb->m_eglDisplay, eglConfig,
+                                 EGL_MAX_SWAP_INTERVAL, &maxSwap) &&
+        minSwap <= maxSwap) {
+        fb->m_minSwapInterval = minSwap;
+        fb->m_maxSwapInterval = maxSwap;
+    }
+    fb->m_refreshRate = queryRefreshRate();
+
     fb->m_eglContext = s_egl.eglCreateContext(fb->m_eglDisplay, eglConfig,
                                               EGL_NO_CONTEXT,
                                               glContextAttribs);
     if (fb->m_eglContext == EGL_NO_CONTEXT) {
         printf("Failed to create Context 0x%x\n", s_egl.eglGetError());
         delete fb;
-        return false;
+        return NULL;
     }
 
     // Make the context current
     if (!fb->bind_locked()) {
         delete fb;
-        return false;
+        return NULL;
     }
 
     //
@@ -225,31 +380,40 @@ bool FrameBuffer::initialize(FBNativeWindowType p_window,
     if (eglExtensions && has_gl_oes_image) {
         fb->m_caps.has_eglimage_texture_2d =
              strstr(eglExtensions, "EGL_KHR_gl_texture_2D_image") != NULL;
+        // an EGLImage as the storage of a renderbuffer of a framebuffer
+        // object, GLES2 always has framebuffer objects
         fb->m_caps.has_eglimage_renderbuffer =
-             strstr(eglExtensions, "EGL_KHR_gl_renderbuffer_image") != NULL;
+             strstr(glExtensions, "GL_OES_framebuffer_object") != NULL;
     }
     else {
         fb->m_caps.has_eglimage_texture_2d = false;
         fb->m_caps.has_eglimage_renderbuffer = false;
     }
 
+    fb->probePixelFormats(glExtensions);
+
+    // the translator only has swap rectangles when it can present them
+    fb->m_caps.has_swapRectangle = fb->m_nativeWindow && eglExtensions &&
+        s_egl.eglSetSwapRectangleANDROID &&
+        strstr(eglExtensions, "EGL_ANDROID_swap_rectangle") != NULL;
+
     //
     // Initialize set of configs
     //
     InitConfigStatus configStatus = FBConfig::initConfigList(fb);
     if (configStatus == INIT_CONFIG_FAILED) {
         delete fb;
-        return false;
+        return NULL;
     }
 
     //
     // Check that we have config for each GLES and GLES2
     //
-    int nConfigs = FBConfig::getNumConfigs();
+    int nConfigs = FBConfig::getNumConfigs(fb->m_eglDisplay);
     int nGLConfigs = 0;
     int nGL2Configs = 0;
     for (int i=0; i<nConfigs; i++) {
-        GLint rtype = FBConfig::get(i)->getRenderableType();
+        GLint rtype = FBConfig::get(fb->m_eglDisplay, i)->getRenderableType();
         if (0 != (rtype & EGL_OPENGL_ES_BIT)) {
             nGLConfigs++;
         }
@@ -263,7 +427,7 @@ bool FrameBuffer::initialize(FBNativeWindowType p_window,
     //
     if (nGLConfigs == 0) {
         delete fb;
-        return false;
+        return NULL;
     }
 
     //
@@ -293,10 +457,124 @@ bool FrameBuffer::initialize(FBNativeWindowType p_window,
     fb->unbind_locked();
 
     //
-    // Keep the singleton framebuffer pointer
+    // start the compositor thread, posts are done synchronously
+    // by the caller if it cannot be started
     //
-    s_theFrameBuffer = fb;
-    return true;
+    if (!getenv("ANDROID_SYNC_FB_POST")) {
+        fb->m_postThread = new PostThread(fb);
+        if (!fb->m_postThread->start()) {
+            delete fb->m_postThread;
+            fb->m_postThread = NULL;
+        }
+    }
+
+    return fb;
+}
+
+void FrameBuffer::destroy(FrameBuffer *fb)
+{
+    // the default framebuffer lives as long as the process
+    if (!fb || fb == s_theFrameBuffer) {
+        return;
+    }
+
+    // the destructors of the objects below look the framebuffer up
+    RenderThreadInfo *tInfo = getRenderThreadInfo();
+    FrameBuffer *prevFB = tInfo->frameBuffer;
+    tInfo->frameBuffer = fb;
+
+    if (fb->m_postThread) {
+        {
+            android::Mutex::Autolock mutex(fb->m_postLock);
+            fb->m_postExit = true;
+            fb->m_postCond.signal();
+            fb->m_postDoneCond.broadcast();
+        }
+        fb->m_postThread->wait(NULL);
+        delete fb->m_postThread;
+        fb->m_postThread = NULL;
+    }
+
+    fb->stopRecording();
+
+    if (fb->m_readbackThread) {
+        {
+            android::Mutex::Autolock mutex(fb->m_readbackLock);
+            fb->m_readbackExit = true;
+            fb->m_readbackCond.broadcast();
+        }
+        fb->m_readbackThread->wait(NULL);
+        delete fb->m_readbackThread;
+        fb->m_readbackThread = NULL;
+    }
+
+    {
+        android::Mutex::Autolock mutex(fb->m_lock);
+        {
+            android::Mutex::Autolock readback(fb->m_readbackLock);
+            for (std::map<HandleType, Readback *>::iterator it =
+                     fb->m_readbacks.begin();
+                 it != fb->m_readbacks.end(); it++) {
+                freeReadback(it->second);
+            }
+            fb->m_readbacks.clear();
+            fb->m_readbackQueue.clear();
+        }
+        {
+            // windows hold references to contexts and color buffers
+            android::Mutex::Autolock objects(fb->m_objectsLock);
+            fb->m_windows = WindowSurfaceMap();
+            fb->m_contexts = RenderContextMap();
+            fb->m_colorbuffers = ColorBufferMap();
+            fb->m_contextGroups.clear();
+        }
+
+        if (fb->bind_locked()) {
+            ColorBuffer::releasePool(fb);
+            fb->unbind_locked();
+        }
+    }
+
+    for (std::map<int, EGLSurface>::iterator it = fb->m_configPbuffers.begin();
+         it != fb->m_configPbuffers.end(); it++) {
+        s_egl.eglDestroySurface(fb->m_eglDisplay, it->second);
+    }
+    s_egl.eglDestroyContext(fb->m_eglDisplay, fb->m_eglContext);
+    s_egl.eglDestroySurface(fb->m_eglDisplay, fb->m_eglSurface);
+    delete fb;
+
+    tInfo->frameBuffer = prevFB;
+}
+
+//
+// probePixelFormats - GL_BGRA_EXT is taken for the color buffers when the
+//     host can store it, and for the readbacks when it is the read format
+//     of the host. Desktop drivers usually keep their color buffers in
+//     that layout and swizzle GL_RGBA pixels on the CPU. ANDROID_FB_RGBA
+//     keeps both GL_RGBA, for drivers which handle GL_BGRA_EXT badly.
+//     The framebuffer context should be current.
+//
+void FrameBuffer::probePixelFormats(const char *p_glExtensions)
+{
+    m_caps.uploadFormat = GL_RGBA;
+    m_caps.readbackFormat = GL_RGBA;
+    if (!p_glExtensions || getenv("ANDROID_FB_RGBA")) {
+        return;
+    }
+
+    if (strstr(p_glExtensions, "GL_EXT_texture_format_BGRA8888")) {
+        m_caps.uploadFormat = GL_BGRA_EXT;
+    }
+    if (strstr(p_glExtensions, "GL_EXT_read_format_bgra")) {
+        GLint format = 0;
+        GLint type = 0;
+        s_gl.glGetIntegerv(GL_IMPLEMENTATION_COLOR_READ_FORMAT_OES, &format);
+        s_gl.glGetIntegerv(GL_IMPLEMENTATION_COLOR_READ_TYPE_OES, &type);
+        s_gl.glGetError();  // in case the driver does not know the queries
+        if (format == GL_BGRA_EXT && type == GL_UNSIGNED_BYTE) {
+            m_caps.readbackFormat = GL_BGRA_EXT;
+        }
+    }
 }
 
 FrameBuffer::FrameBuffer(int p_x, int p_y, int p_width, int p_height) :
@@ -305,249 +583,1551 @@ FrameBuffer::FrameBuffer(int p_x, int p_y, int p_width, int p_height) :
     m_width(p_width),
     m_height(p_height),
     m_eglDisplay(EGL_NO_DISPLAY),
+    m_memAccount(GpuMemory::addAccount(this)),
+    m_useStamp(0),
     m_eglSurface(EGL_NO_SURFACE),
     m_eglContext(EGL_NO_CONTEXT),
     m_prevContext(EGL_NO_CONTEXT),
     m_prevReadSurf(EGL_NO_SURFACE),
-    m_prevDrawSurf(EGL_NO_SURFACE)
+    m_prevDrawSurf(EGL_NO_SURFACE),
+    m_bindDepth(0),
+    m_frameShm(NULL),
+    m_recorder(NULL),
+    m_refreshRate(60),
+    m_minSwapInterval(1),
+    m_maxSwapInterval(1),
+    m_swapInterval(1),
+    m_appliedSwapInterval(-1),
+    m_backBufferValid(false),
+    m_swapRectSet(false),
+    m_postThread(NULL),
+    m_postExit(false),
+    m_pendingCount(0),
+    m_pendingFrameId(0),
+    m_pendingPartial(false),
+    m_postsQueued(0),
+    m_postsDone(0),
+    m_readbackThread(NULL),
+    m_readbackExit(false),
+    m_lastCount(0),
+    m_forceRedraw(false),
+    m_visible(true),
+    m_dpyTransformed(false),
+    m_dpyX(0),
+    m_dpyY(0),
+    m_dpyWidth(p_width),
+    m_dpyHeight(p_height),
+    m_dpyRotation(0),
+    m_dpyZoom(1.0f),
+    m_dpyCenterX(0.5f),
+    m_dpyCenterY(0.5f)
 {
 }
 
 FrameBuffer::~FrameBuffer()
 {
+    delete m_frameShm;
+    GpuMemory::release(m_memAccount);
+}
+
+//
+// queryRefreshRate - returns the refresh rate of the host display.
+//     ANDROID_FB_FPS overrides the detected value. On platforms where it
+//     cannot be queried 60 is assumed.
+//
+int FrameBuffer::queryRefreshRate()
+{
+    const char *fps = getenv("ANDROID_FB_FPS");
+    if (fps && atoi(fps) > 0) {
+        return atoi(fps);
+    }
+
+#ifdef _WIN32
+    HDC hdc = GetDC(NULL);
+    int rate = GetDeviceCaps(hdc, VREFRESH);
+    ReleaseDC(NULL, hdc);
+    // 0 and 1 mean the hardware default rate
+    if (rate > 1) {
+        return rate;
+    }
+#endif
+
+    return 60;
+}
+
+void FrameBuffer::setSwapInterval(int p_interval)
+{
+    if (p_interval < m_minSwapInterval) {
+        p_interval = m_minSwapInterval;
+    }
+    else if (p_interval > m_maxSwapInterval) {
+        p_interval = m_maxSwapInterval;
+    }
+
+    android::Mutex::Autolock mutex(m_lock);
+    m_swapInterval = p_interval;
+}
+
+HandleType FrameBuffer::reserveHandles(ObjectType p_type, uint32_t p_count)
+{
+    android::Mutex::Autolock objects(m_objectsLock);
+    switch (p_type) {
+    case OBJECT_COLOR_BUFFER:
+        return m_colorbuffers.reserve(p_count);
+    case OBJECT_RENDER_CONTEXT:
+        return m_contexts.reserve(p_count);
+    case OBJECT_WINDOW_SURFACE:
+        return m_windows.reserve(p_count);
+    }
+    return 0;
 }
 
-HandleType FrameBuffer::genHandle()
+void FrameBuffer::releaseHandles(ObjectType p_type, HandleType p_first, uint32_t p_count)
 {
-    HandleType id;
-    do {
-        id = ++s_nextHandle;
-    } while( id == 0 ||
-             m_contexts.find(id) != m_contexts.end() ||
-             m_windows.find(id) != m_windows.end() );
+    android::Mutex::Autolock objects(m_objectsLock);
+    switch (p_type) {
+    case OBJECT_COLOR_BUFFER:
+        m_colorbuffers.unreserve(p_first, p_count);
+        break;
+    case OBJECT_RENDER_CONTEXT:
+        m_contexts.unreserve(p_first, p_count);
+        break;
+    case OBJECT_WINDOW_SURFACE:
+        m_windows.unreserve(p_first, p_count);
+        break;
+    }
+    m_objectsCond.broadcast();
+}
 
-    return id;
+// how long a handle from another connection may stay pending, its create
+// command is at most one flush behind
+#define CREATE_WAIT_US 100000
+
+void FrameBuffer::waitCreated(ObjectType p_type, HandleType p_handle)
+{
+    android::Mutex::Autolock objects(m_objectsLock);
+    long long deadline = GetCurrentTimeUS() + CREATE_WAIT_US;
+    for (;;) {
+        bool pending = false;
+        switch (p_type) {
+        case OBJECT_COLOR_BUFFER:
+            pending = m_colorbuffers.isPending(p_handle);
+            break;
+        case OBJECT_RENDER_CONTEXT:
+            pending = m_contexts.isPending(p_handle);
+            break;
+        case OBJECT_WINDOW_SURFACE:
+            pending = m_windows.isPending(p_handle);
+            break;
+        }
+        long long left = deadline - GetCurrentTimeUS();
+        if (!pending || left <= 0) {
+            return;
+        }
+        m_objectsCond.waitRelative(m_objectsLock, left * 1000);
+    }
 }
 
 HandleType FrameBuffer::createColorBuffer(int p_width, int p_height,
-                                          GLenum p_internalFormat)
+                                          GLenum p_internalFormat,
+                                          HandleType p_handle)
 {
     android::Mutex::Autolock mutex(m_lock);
     HandleType ret = 0;
 
     ColorBufferPtr cb( ColorBuffer::create(p_width, p_height, p_internalFormat) );
     if (cb.Ptr() != NULL) {
-        ret = genHandle();
-        m_colorbuffers[ret] = cb;
+        {
+            android::Mutex::Autolock objects(m_objectsLock);
+            if (!p_handle) {
+                ret = m_colorbuffers.add(cb);
+            }
+            else if (m_colorbuffers.addReserved(p_handle, cb)) {
+                ret = p_handle;
+                m_objectsCond.broadcast();
+            }
+        }
+        evictColorBuffers_locked();
     }
     return ret;
 }
 
 HandleType FrameBuffer::createRenderContext(int p_config, HandleType p_share,
-                                            bool p_isGL2)
+                                            bool p_isGL2, HandleType p_handle)
 {
-    android::Mutex::Autolock mutex(m_lock);
     HandleType ret = 0;
 
     RenderContextPtr share(NULL);
     if (p_share != 0) {
-        RenderContextMap::iterator s( m_contexts.find(p_share) );
-        if (s == m_contexts.end()) {
+        android::Mutex::Autolock objects(m_objectsLock);
+        RenderContextPtr *s = m_contexts.get(p_share);
+        if (!s) {
             return 0;
         }
-        share = (*s).second;
+        share = *s;
     }
 
+    // does not need the framebuffer context
     RenderContextPtr rctx( RenderContext::create(p_config, share, p_isGL2) );
     if (rctx.Ptr() != NULL) {
-        ret = genHandle();
-        m_contexts[ret] = rctx;
+        android::Mutex::Autolock objects(m_objectsLock);
+        if (!p_handle) {
+            ret = m_contexts.add(rctx);
+        }
+        else if (m_contexts.addReserved(p_handle, rctx)) {
+            ret = p_handle;
+            m_objectsCond.broadcast();
+        }
+        if (ret) {
+            m_contextGroups[ret] = p_share ? m_contextGroups[p_share] : ret;
+        }
     }
     return ret;
 }
 
-HandleType FrameBuffer::createWindowSurface(int p_config, int p_width, int p_height)
+HandleType FrameBuffer::createWindowSurface(int p_config, int p_width, int p_height,
+                                            HandleType p_handle)
 {
-    android::Mutex::Autolock mutex(m_lock);
-
     HandleType ret = 0;
+
+    // does not need the framebuffer context
     WindowSurfacePtr win( WindowSurface::create(p_config, p_width, p_height) );
     if (win.Ptr() != NULL) {
-        ret = genHandle();
-        m_windows[ret] = win;
+        android::Mutex::Autolock objects(m_objectsLock);
+        if (!p_handle) {
+            ret = m_windows.add(win);
+        }
+        else if (m_windows.addReserved(p_handle, win)) {
+            ret = p_handle;
+            m_objectsCond.broadcast();
+        }
     }
 
+    long long budget = GpuMemory::getBudget();
+    if (ret && budget > 0 && GpuMemory::getGroupGpuBytes(this) > budget) {
+        android::Mutex::Autolock mutex(m_lock);
+        evictColorBuffers_locked();
+    }
     return ret;
 }
 
+EGLSurface FrameBuffer::getConfigPbuffer(int p_config)
+{
+    android::Mutex::Autolock objects(m_objectsLock);
+
+    std::map<int, EGLSurface>::iterator it = m_configPbuffers.find(p_config);
+    if (it != m_configPbuffers.end()) {
+        return it->second;
+    }
+
+    const FBConfig *fbconf = FBConfig::get(p_config);
+    if (!fbconf) {
+        return EGL_NO_SURFACE;
+    }
+
+    EGLint pbufAttribs[] = {
+        EGL_WIDTH, 1,
+        EGL_HEIGHT, 1,
+        EGL_NONE
+    };
+    EGLSurface surface = s_egl.eglCreatePbufferSurface(m_eglDisplay,
+                                                 fbconf->getEGLConfig(),
+                                                 pbufAttribs);
+    if (surface != EGL_NO_SURFACE) {
+        m_configPbuffers[p_config] = surface;
+    }
+    return surface;
+}
+
 void FrameBuffer::DestroyRenderContext(HandleType p_context)
 {
-    android::Mutex::Autolock mutex(m_lock);
-    m_contexts.erase(p_context);
+    android::Mutex::Autolock objects(m_objectsLock);
+    if (m_contexts.remove(p_context)) {
+        m_contextGroups.erase(p_context);
+    }
 }
 
 void FrameBuffer::DestroyWindowSurface(HandleType p_surface)
 {
+    // the surface may hold the last reference to a color buffer
     android::Mutex::Autolock mutex(m_lock);
-    m_windows.erase(p_surface);
+    android::Mutex::Autolock objects(m_objectsLock);
+    m_windows.remove(p_surface);
 }
 
 void FrameBuffer::DestroyColorBuffer(HandleType p_colorbuffer)
 {
     android::Mutex::Autolock mutex(m_lock);
-    m_colorbuffers.erase(p_colorbuffer);
+    cancelReadback_locked(p_colorbuffer);
+    android::Mutex::Autolock objects(m_objectsLock);
+    m_colorbuffers.remove(p_colorbuffer);
 }
 
 bool FrameBuffer::setWindowSurfaceColorBuffer(HandleType p_surface,
                                               HandleType p_colorbuffer)
 {
+    // the previously attached color buffer may be released
     android::Mutex::Autolock mutex(m_lock);
+    android::Mutex::Autolock objects(m_objectsLock);
 
-    WindowSurfaceMap::iterator w( m_windows.find(p_surface) );
-    if (w == m_windows.end()) {
+    WindowSurfacePtr *w = m_windows.get(p_surface);
+    if (!w) {
         // bad surface handle
         return false;
     }
 
-    ColorBufferMap::iterator c( m_colorbuffers.find(p_colorbuffer) );
-    if (c == m_colorbuffers.end()) {
+    ColorBufferPtr *c = m_colorbuffers.get(p_colorbuffer);
+    if (!c) {
         // bad colorbuffer handle
         return false;
     }
 
-    (*w).second->setColorBuffer( (*c).second );
+    // rendering into a restored buffer needs its snapshot content first
+    (*c)->ensureContent();
+    (*w)->setColorBuffer( *c );
 
     return true;
 }
 
-bool FrameBuffer::bindContext(HandleType p_context,
-                              HandleType p_drawSurface,
-                              HandleType p_readSurface)
+bool FrameBuffer::updateColorBuffer(HandleType p_colorbuffer,
+                                    int x, int y, int width, int height,
+                                    GLenum format, GLenum type, void *pixels)
 {
+    // the update is done with the framebuffer context
     android::Mutex::Autolock mutex(m_lock);
 
-    WindowSurfacePtr draw(NULL), read(NULL);
-    RenderContextPtr ctx(NULL);
-
-    //
-    // if this is not an unbind operation - make sure all handles are good
-    //
-    if (p_context || p_drawSurface || p_readSurface) {
-        RenderContextMap::iterator r( m_contexts.find(p_context) );
-        if (r == m_contexts.end()) {
-            // bad context handle
+    ColorBufferPtr cb;
+    {
+        android::Mutex::Autolock objects(m_objectsLock);
+        ColorBufferPtr *c = m_colorbuffers.get(p_colorbuffer);
+        if (!c) {
+            // bad colorbuffer handle
             return false;
         }
+        cb = *c;
+    }
 
-        ctx = (*r).second;
-        WindowSurfaceMap::iterator w( m_windows.find(p_drawSurface) );
-        if (w == m_windows.end()) {
-            // bad surface handle
-            return false;
-        }
-        draw = (*w).second;
+    return cb->subUpdate(x, y, width, height, format, type, pixels);
+}
 
-        if (p_readSurface != p_drawSurface) {
-            WindowSurfaceMap::iterator w( m_windows.find(p_readSurface) );
-            if (w == m_windows.end()) {
-                // bad surface handle
-                return false;
-            }
-            read = (*w).second;
-        }
-        else {
-            read = draw;
+bool FrameBuffer::readColorBuffer(HandleType p_colorbuffer,
+                                  int x, int y, int width, int height,
+                                  GLenum format, GLenum type, void *pixels)
+{
+    // the read is done with the framebuffer context
+    android::Mutex::Autolock mutex(m_lock);
+
+    ColorBufferPtr cb;
+    {
+        android::Mutex::Autolock objects(m_objectsLock);
+        ColorBufferPtr *c = m_colorbuffers.get(p_colorbuffer);
+        if (!c) {
+            // bad colorbuffer handle
+            return false;
         }
+        cb = *c;
     }
 
-    if (!s_egl.eglMakeCurrent(m_eglDisplay,
-                              draw ? draw->getEGLSurface() : EGL_NO_SURFACE,
-                              read ? read->getEGLSurface() : EGL_NO_SURFACE,
-                              ctx ? ctx->getEGLContext() : EGL_NO_CONTEXT)) {
-        // MakeCurrent failed
-        return false;
-    }
+    return cb->readPixels(x, y, width, height, format, type, pixels);
+}
 
-    //
-    // Bind the surface(s) to the context
-    //
-    RenderThreadInfo *tinfo = getRenderThreadInfo();
-    if (draw.Ptr() == NULL && read.Ptr() == NULL) {
-        // if this is an unbind operation - make sure the current bound
-        // surfaces get unbound from the context.
-        draw = tinfo->currDrawSurf;
-        read = tinfo->currReadSurf;
-    }
+int FrameBuffer::colorBufferCacheFlush(HandleType p_colorbuffer, bool p_forRead)
+{
+    // the rendering flags are updated with the framebuffer lock held
+    android::Mutex::Autolock mutex(m_lock);
 
-    if (draw.Ptr() != NULL && read.Ptr() != NULL) {
-        if (p_readSurface != p_drawSurface) {
-            draw->bind( ctx, SURFACE_BIND_DRAW );
-            read->bind( ctx, SURFACE_BIND_READ );
-        }
-        else {
-            draw->bind( ctx, SURFACE_BIND_READDRAW );
+    ColorBufferPtr cb;
+    {
+        android::Mutex::Autolock objects(m_objectsLock);
+        ColorBufferPtr *c = m_colorbuffers.get(p_colorbuffer);
+        if (!c) {
+            // bad colorbuffer handle
+            return -1;
         }
+        cb = *c;
     }
 
-    //
-    // update thread info with current bound context
-    //
-    tinfo->currContext = ctx;
-    tinfo->currDrawSurf = draw;
-    tinfo->currReadSurf = read;
+    if (!p_forRead) {
+        return 0;
+    }
+    if (cb->takeRendered()) {
+        // a pending readback has the previous content
+        cancelReadback_locked(p_colorbuffer);
+        return 1;
+    }
 
-    return true;
+    android::Mutex::Autolock readback(m_readbackLock);
+    return m_readbacks.find(p_colorbuffer) != m_readbacks.end() ? 2 : 0;
 }
 
-//
-// The framebuffer lock should be held when calling this function !
-//
-bool FrameBuffer::bind_locked()
+bool FrameBuffer::startReadColorBuffer(HandleType p_colorbuffer,
+                                       int x, int y, int width, int height,
+                                       GLenum format, GLenum type)
 {
-    EGLContext prevContext = s_egl.eglGetCurrentContext();
-    EGLSurface prevReadSurf = s_egl.eglGetCurrentSurface(EGL_READ);
-    EGLSurface prevDrawSurf = s_egl.eglGetCurrentSurface(EGL_DRAW);
+    // the copy is done with the framebuffer context
+    android::Mutex::Autolock mutex(m_lock);
 
-    if (!s_egl.eglMakeCurrent(m_eglDisplay, m_eglSurface,
-                              m_eglSurface, m_eglContext)) {
-        return false;
+    ColorBufferPtr cb;
+    {
+        android::Mutex::Autolock objects(m_objectsLock);
+        ColorBufferPtr *c = m_colorbuffers.get(p_colorbuffer);
+        if (!c) {
+            // bad colorbuffer handle
+            return false;
+        }
+        cb = *c;
     }
 
-    m_prevContext = prevContext;
-    m_prevReadSurf = prevReadSurf;
-    m_prevDrawSurf = prevDrawSurf;
-    return true;
-}
+    cancelReadback_locked(p_colorbuffer);
 
-bool FrameBuffer::unbind_locked()
-{
-    if (!s_egl.eglMakeCurrent(m_eglDisplay, m_prevDrawSurf,
-                              m_prevReadSurf, m_prevContext)) {
+    if (width <= 0 || height <= 0) {
         return false;
     }
+    size_t len = (size_t)((glUtilsPixelBitSize(format, type) * width) >> 3) *
+                 height;
+    if (len == 0) {
+        return false;
+    }
+
+    ColorBufferPtr staging(ColorBuffer::create(width, height,
+                                               cb->getInternalFormat()));
+    if (!staging.Ptr() || !cb->copyRect(staging.Ptr(), x, y, width, height)) {
+        return false;
+    }
+    if (bind_locked()) {
+        // let the GPU start the copy before the thread waits for it
+        s_gl.glFlush();
+        unbind_locked();
+    }
+
+    // the readback has the content rendered so far
+    cb->takeRendered();
+
+    Readback *rb = new Readback();
+    rb->staging = staging;
+    rb->width = width;
+    rb->height = height;
+    rb->format = format;
+    rb->type = type;
+    rb->pixels = NULL;
+    rb->len = len;
+    rb->state = READBACK_QUEUED;
+    rb->dropped = false;
+
+    android::Mutex::Autolock readback(m_readbackLock);
+    if (!m_readbackThread && !m_readbackExit) {
+        m_readbackThread = new ReadbackThread(this);
+        if (!m_readbackThread->start()) {
+            delete m_readbackThread;
+            m_readbackThread = NULL;
+            m_readbackExit = true;
+        }
+    }
+    if (m_readbackThread) {
+        m_readbackQueue.push_back(rb);
+        m_readbackCond.broadcast();
+    } else {
+        rb->state = readback_locked(rb) ? READBACK_DONE : READBACK_FAILED;
+    }
+    m_readbacks[p_colorbuffer] = rb;
+    return true;
+}
+
+int FrameBuffer::finishReadColorBuffer(HandleType p_colorbuffer, bool p_wait,
+                                       void *p_pixels, size_t p_len)
+{
+    android::Mutex::Autolock readback(m_readbackLock);
+
+    while (true) {
+        // the readback may be replaced or dropped while waiting
+        std::map<HandleType, Readback *>::iterator it =
+            m_readbacks.find(p_colorbuffer);
+        if (it == m_readbacks.end()) {
+            return -1;
+        }
+        Readback *rb = it->second;
+
+        if (rb->state == READBACK_DONE || rb->state == READBACK_FAILED) {
+            int ret = (rb->state == READBACK_DONE) ? 1 : -1;
+            if (p_len == 0) {
+                return ret;
+            }
+            if (ret == 1) {
+                memcpy(p_pixels, rb->pixels, p_len < rb->len ? p_len : rb->len);
+            }
+            // the staging color buffer is already released
+            m_readbacks.erase(it);
+            freeReadback(rb);
+            return ret;
+        }
+
+        if (!p_wait || p_len == 0) {
+            return 0;
+        }
+        m_readbackCond.wait(m_readbackLock);
+    }
+}
+
+//
+// readback_locked - reads the staging color buffer of 'p_rb' into its
+//     pixels and releases it. m_lock should be held.
+//
+bool FrameBuffer::readback_locked(Readback *p_rb)
+{
+    bool ret = false;
+    p_rb->pixels = (unsigned char *)malloc(p_rb->len);
+    if (p_rb->pixels) {
+        ret = p_rb->staging->readPixels(0, 0, p_rb->width, p_rb->height,
+                                        p_rb->format, p_rb->type,
+                                        p_rb->pixels);
+    }
+    p_rb->staging = ColorBufferPtr();
+    return ret;
+}
+
+//
+// cancelReadback_locked - forgets the readback of a color buffer, if any.
+//     m_lock should be held, it may release the staging color buffer.
+//
+void FrameBuffer::cancelReadback_locked(HandleType p_colorbuffer)
+{
+    android::Mutex::Autolock readback(m_readbackLock);
+
+    std::map<HandleType, Readback *>::iterator it =
+        m_readbacks.find(p_colorbuffer);
+    if (it == m_readbacks.end()) {
+        return;
+    }
+    Readback *rb = it->second;
+    m_readbacks.erase(it);
+
+    if (rb->state == READBACK_READING) {
+        rb->dropped = true;
+    } else {
+        if (rb->state == READBACK_QUEUED) {
+            m_readbackQueue.remove(rb);
+        }
+        freeReadback(rb);
+    }
+    // waiters for the readback see it is gone
+    m_readbackCond.broadcast();
+}
+
+bool FrameBuffer::startRecording(int p_width, int p_height,
+                                 OnRecordedFrameFunc p_callback,
+                                 void *p_opaque)
+{
+    android::Mutex::Autolock mutex(m_lock);
+    if (m_recorder) {
+        return false;
+    }
+
+    FrameRecorder *rec = FrameRecorder::create(this,
+                                               p_width > 0 ? p_width : m_width,
+                                               p_height > 0 ? p_height : m_height,
+                                               p_callback, p_opaque);
+    if (!rec) {
+        return false;
+    }
+    if (!rec->start()) {
+        delete rec;
+        return false;
+    }
+    m_recorder = rec;
+    return true;
+}
+
+void FrameBuffer::stopRecording()
+{
+    FrameRecorder *rec;
+    {
+        android::Mutex::Autolock mutex(m_lock);
+        rec = m_recorder;
+        m_recorder = NULL;
+    }
+    if (!rec) {
+        return;
+    }
+
+    // the recorder thread takes the lock to read the frames back
+    rec->stop();
+
+    android::Mutex::Autolock mutex(m_lock);
+    delete rec;
+}
+
+GpuMemoryAccount *FrameBuffer::getMemAccount()
+{
+    RenderThreadInfo *tInfo = getRenderThreadInfo();
+    return tInfo->memAccount ? tInfo->memAccount : m_memAccount;
+}
+
+static bool compareLastUse(const ColorBufferPtr &a, const ColorBufferPtr &b)
+{
+    // stamps wrap around, compare their distance
+    return (int32_t)(a->getLastUse() - b->getLastUse()) < 0;
+}
+
+// eviction goes below the budget by that fraction, not to run on each create
+#define GPU_BUDGET_SLACK 8
+
+//
+// evictColorBuffers_locked - when the framebuffer is over its GPU memory
+//     budget, evicts its least recently used color buffers until it is
+//     back under the budget. The buffers of the displayed frame and the
+//     most recently used one are kept. m_lock should be held.
+//
+void FrameBuffer::evictColorBuffers_locked()
+{
+    long long budget = GpuMemory::getBudget();
+    long long used = GpuMemory::getGroupGpuBytes(this);
+    if (budget <= 0 || used <= budget) {
+        return;
+    }
+
+    std::vector<ColorBufferPtr> cbs;
+    {
+        android::Mutex::Autolock objects(m_objectsLock);
+        std::vector<HandleType> handles;
+        m_colorbuffers.getHandles(handles);
+        for (size_t i = 0; i < handles.size(); i++) {
+            bool displayed = false;
+            for (int l = 0; l < m_lastCount; l++) {
+                displayed |= (m_lastLayers[l].colorBuffer == handles[i]);
+            }
+            ColorBufferPtr cb = *m_colorbuffers.get(handles[i]);
+            if (!displayed && !cb->isEvicted()) {
+                cbs.push_back(cb);
+            }
+        }
+    }
+    if (cbs.size() < 2) {
+        return;
+    }
+    std::sort(cbs.begin(), cbs.end(), compareLastUse);
+
+    long long target = budget - budget / GPU_BUDGET_SLACK;
+    for (size_t i = 0; i + 1 < cbs.size() && used > target; i++) {
+        long long bytes = cbs[i]->getGpuBytes();
+        if (cbs[i]->evict()) {
+            used -= bytes - cbs[i]->getGpuBytes();
+        }
+    }
+}
+
+void FrameBuffer::freeReadback(Readback *p_rb)
+{
+    free(p_rb->pixels);
+    delete p_rb;
+}
+
+bool FrameBuffer::bindContext(HandleType p_context,
+                              HandleType p_drawSurface,
+                              HandleType p_readSurface)
+{
+    //
+    // binding the surfaces may copy their content into the attached
+    // color buffers, which is done with the framebuffer context.
+    //
+    android::Mutex::Autolock mutex(m_lock);
+
+    WindowSurfacePtr draw(NULL), read(NULL);
+    RenderContextPtr ctx(NULL);
+
+    //
+    // if this is not an unbind operation - make sure all handles are good
+    //
+    if (p_context || p_drawSurface || p_readSurface) {
+        android::Mutex::Autolock objects(m_objectsLock);
+
+        RenderContextPtr *r = m_contexts.get(p_context);
+        if (!r) {
+            // bad context handle
+            return false;
+        }
+
+        ctx = *r;
+        WindowSurfacePtr *w = m_windows.get(p_drawSurface);
+        if (!w) {
+            // bad surface handle
+            return false;
+        }
+        draw = *w;
+
+        if (p_readSurface != p_drawSurface) {
+            WindowSurfacePtr *w = m_windows.get(p_readSurface);
+            if (!w) {
+                // bad surface handle
+                return false;
+            }
+            read = *w;
+        }
+        else {
+            read = draw;
+        }
+    }
+
+    //
+    // rebinding what is already current in this thread is a no-op, the
+    // host eglMakeCurrent can be expensive and this happens on every
+    // request of a guest thread. The surfaces are bound again if another
+    // context has been bound to them since.
+    //
+    RenderThreadInfo *tinfo = getRenderThreadInfo();
+    if (ctx.Ptr() != NULL &&
+        ctx.Ptr() == tinfo->currContext.Ptr() &&
+        draw.Ptr() == tinfo->currDrawSurf.Ptr() &&
+        read.Ptr() == tinfo->currReadSurf.Ptr()) {
+        ctx->deleteReleasedObjects();
+        if (p_readSurface != p_drawSurface) {
+            if (!draw->isBound(ctx, SURFACE_BIND_DRAW)) {
+                draw->bind( ctx, SURFACE_BIND_DRAW );
+            }
+            if (!read->isBound(ctx, SURFACE_BIND_READ)) {
+                read->bind( ctx, SURFACE_BIND_READ );
+            }
+        }
+        else if (!draw->isBound(ctx, SURFACE_BIND_READDRAW)) {
+            draw->bind( ctx, SURFACE_BIND_READDRAW );
+        }
+        return true;
+    }
+
+    if (!s_egl.eglMakeCurrent(m_eglDisplay,
+                              draw ? draw->getEGLSurface() : EGL_NO_SURFACE,
+                              read ? read->getEGLSurface() : EGL_NO_SURFACE,
+                              ctx ? ctx->getEGLContext() : EGL_NO_CONTEXT)) {
+        // MakeCurrent failed
+        return false;
+    }
+
+    // objects other surfaces created in the context and gave back
+    if (ctx.Ptr() != NULL) {
+        ctx->deleteReleasedObjects();
+    }
+
+    //
+    // Bind the surface(s) to the context
+    //
+    if (draw.Ptr() == NULL && read.Ptr() == NULL) {
+        // if this is an unbind operation - make sure the current bound
+        // surfaces get unbound from the context.
+        draw = tinfo->currDrawSurf;
+        read = tinfo->currReadSurf;
+    }
+
+    if (draw.Ptr() != NULL && read.Ptr() != NULL) {
+        if (p_readSurface != p_drawSurface) {
+            draw->bind( ctx, SURFACE_BIND_DRAW );
+            read->bind( ctx, SURFACE_BIND_READ );
+        }
+        else {
+            draw->bind( ctx, SURFACE_BIND_READDRAW );
+        }
+    }
+
+    //
+    // update thread info with current bound context
+    //
+    tinfo->currContext = ctx;
+    tinfo->currDrawSurf = draw;
+    tinfo->currReadSurf = read;
+
+    return true;
+}
 
+//
+// The framebuffer lock should be held when calling this function !
+//
+// bind/unbind pairs may be nested so that several colorbuffer operations
+// are done under a single bind, only the outermost pair saves and restores
+// the previous binding. eglMakeCurrent is skipped whenever the framebuffer
+// context is already current.
+//
+bool FrameBuffer::bind_locked()
+{
+    EGLContext prevContext = s_egl.eglGetCurrentContext();
+    EGLSurface prevReadSurf = s_egl.eglGetCurrentSurface(EGL_READ);
+    EGLSurface prevDrawSurf = s_egl.eglGetCurrentSurface(EGL_DRAW);
+
+    if (prevContext != m_eglContext || prevReadSurf != m_eglSurface ||
+        prevDrawSurf != m_eglSurface) {
+        if (!s_egl.eglMakeCurrent(m_eglDisplay, m_eglSurface,
+                                  m_eglSurface, m_eglContext)) {
+            return false;
+        }
+    }
+
+    if (m_bindDepth++ == 0) {
+        m_prevContext = prevContext;
+        m_prevReadSurf = prevReadSurf;
+        m_prevDrawSurf = prevDrawSurf;
+    }
+    return true;
+}
+
+bool FrameBuffer::unbind_locked()
+{
+    if (m_bindDepth > 1) {
+        m_bindDepth--;
+        return true;
+    }
+
+    if (m_prevContext != m_eglContext || m_prevReadSurf != m_eglSurface ||
+        m_prevDrawSurf != m_eglSurface) {
+        if (!s_egl.eglMakeCurrent(m_eglDisplay, m_prevDrawSurf,
+                                  m_prevReadSurf, m_prevContext)) {
+            return false;
+        }
+    }
+
+    m_bindDepth = 0;
     m_prevContext = EGL_NO_CONTEXT;
     m_prevReadSurf = EGL_NO_SURFACE;
     m_prevDrawSurf = EGL_NO_SURFACE;
     return true;
 }
 
-bool FrameBuffer::post(HandleType p_colorbuffer)
+static void unionRect(FrameBufferRect *p_rect, const FrameBufferRect &p_other)
+{
+    int x1 = p_rect->x + p_rect->width;
+    int y1 = p_rect->y + p_rect->height;
+    int ox1 = p_other.x + p_other.width;
+    int oy1 = p_other.y + p_other.height;
+    p_rect->x = p_rect->x < p_other.x ? p_rect->x : p_other.x;
+    p_rect->y = p_rect->y < p_other.y ? p_rect->y : p_other.y;
+    p_rect->width = (x1 > ox1 ? x1 : ox1) - p_rect->x;
+    p_rect->height = (y1 > oy1 ? y1 : oy1) - p_rect->y;
+}
+
+static bool sameLayer(const FrameBufferLayer &p_a, const FrameBufferLayer &p_b)
+{
+    return p_a.colorBuffer == p_b.colorBuffer &&
+           p_a.x == p_b.x && p_a.y == p_b.y &&
+           p_a.width == p_b.width && p_a.height == p_b.height &&
+           p_a.alpha == p_b.alpha && p_a.blend == p_b.blend;
+}
+
+static void intersectRect(FrameBufferRect *p_rect, const FrameBufferRect &p_other)
+{
+    int x1 = p_rect->x + p_rect->width;
+    int y1 = p_rect->y + p_rect->height;
+    int ox1 = p_other.x + p_other.width;
+    int oy1 = p_other.y + p_other.height;
+    p_rect->x = p_rect->x > p_other.x ? p_rect->x : p_other.x;
+    p_rect->y = p_rect->y > p_other.y ? p_rect->y : p_other.y;
+    p_rect->width = (x1 < ox1 ? x1 : ox1) - p_rect->x;
+    p_rect->height = (y1 < oy1 ? y1 : oy1) - p_rect->y;
+}
+
+bool FrameBuffer::post(HandleType p_colorbuffer, uint32_t p_frameId,
+                       const FrameBufferRect *p_damage)
+{
+    FrameBufferLayer layer;
+    layer.colorBuffer = p_colorbuffer;
+    layer.x = 0;
+    layer.y = 0;
+    layer.width = m_width;
+    layer.height = m_height;
+    layer.alpha = 255;
+    layer.blend = false;
+
+    return composeLayers(&layer, 1, p_frameId, p_damage);
+}
+
+bool FrameBuffer::composeLayers(const FrameBufferLayer *p_layers, int p_count,
+                                uint32_t p_frameId,
+                                const FrameBufferRect *p_damage)
+{
+    if (p_count <= 0 || p_count > FB_MAX_LAYERS) {
+        return false;
+    }
+
+    if (!m_postThread) {
+        return postNow(p_layers, p_count, p_frameId, p_damage);
+    }
+
+    {
+        android::Mutex::Autolock objects(m_objectsLock);
+        for (int i = 0; i < p_count; i++) {
+            if (!m_colorbuffers.get(p_layers[i].colorBuffer)) {
+                return false;
+            }
+        }
+    }
+
+    //
+    // make sure the rendering into the color buffers has been submitted
+    // before another thread samples them.
+    //
+    RenderThreadInfo *tinfo = getRenderThreadInfo();
+    if (tinfo->currContext.Ptr()) {
+#ifdef WITH_GLES2
+        if (tinfo->currContext->isGL2()) {
+            s_gl2.glFlush();
+        }
+        else
+#endif
+        {
+            s_gl.glFlush();
+        }
+    }
+
+    // latest post wins, with the damage of the post it replaces
+    android::Mutex::Autolock mutex(m_postLock);
+    bool partial = (p_damage != NULL);
+    FrameBufferRect damage;
+    if (partial) {
+        damage = *p_damage;
+        if (m_pendingCount > 0) {
+            partial = m_pendingPartial;
+            unionRect(&damage, m_pendingDamage);
+        }
+    }
+    memcpy(m_pendingLayers, p_layers, p_count * sizeof(FrameBufferLayer));
+    m_pendingCount = p_count;
+    m_pendingFrameId = p_frameId;
+    m_pendingPartial = partial;
+    m_pendingDamage = damage;
+    m_postsQueued++;
+    m_postCond.signal();
+    return true;
+}
+
+void FrameBuffer::waitPosted()
+{
+    // synchronous posts are done when they return
+    if (!m_postThread) {
+        return;
+    }
+
+    android::Mutex::Autolock mutex(m_postLock);
+    uint32_t target = m_postsQueued;
+    while ((int32_t)(target - m_postsDone) > 0 && !m_postExit) {
+        m_postDoneCond.wait(m_postLock);
+    }
+}
+
+bool FrameBuffer::postNow(const FrameBufferLayer *p_layers, int p_count,
+                          uint32_t p_frameId, const FrameBufferRect *p_damage)
 {
     android::Mutex::Autolock mutex(m_lock);
-    bool ret = false;
+    bool ret = true;
+
+    // hold the color buffers for the length of the composition
+    ColorBufferPtr cbs[FB_MAX_LAYERS];
+    {
+        android::Mutex::Autolock objects(m_objectsLock);
+        for (int i = 0; i < p_count; i++) {
+            ColorBufferPtr *c = m_colorbuffers.get(p_layers[i].colorBuffer);
+            if (!c) {
+                return false;
+            }
+            cbs[i] = *c;
+        }
+    }
 
-    ColorBufferMap::iterator c( m_colorbuffers.find(p_colorbuffer) );
-    if (c != m_colorbuffers.end()) {
-        if (!bind_locked()) {
-            return false;
+    //
+    // an identical frame is not presented again, and nothing is while
+    // the window is hidden, the frame is then kept for the redraw.
+    //
+    uint32_t generations[FB_MAX_LAYERS];
+    bool unchanged = !m_forceRedraw && p_count == m_lastCount;
+    for (int i = 0; i < p_count; i++) {
+        generations[i] = cbs[i]->getGeneration();
+        if (unchanged && (generations[i] == 0 ||
+                          generations[i] != m_lastGenerations[i] ||
+                          !sameLayer(p_layers[i], m_lastLayers[i]))) {
+            unchanged = false;
         }
-        ret = (*c).second->post();
-        if (ret) {
-            s_egl.eglSwapBuffers(m_eglDisplay, m_eglSurface);
+    }
+    if (unchanged) {
+        return true;
+    }
+    if (!m_visible) {
+        if (p_layers != m_lastLayers) {
+            memcpy(m_lastLayers, p_layers, p_count * sizeof(FrameBufferLayer));
+            m_lastCount = p_count;
         }
-        unbind_locked();
+        m_forceRedraw = true;
+        return true;
+    }
+
+    if (!bind_locked()) {
+        return false;
+    }
+    if (p_frameId) {
+        FrameTrace::record(p_frameId, 0, FRAME_TRACE_COMPOSITE_START,
+                           GetCurrentTimeUS());
+    }
+
+    //
+    // a partial present only redraws the damage over the previous frame,
+    // which is in the back buffer after a previous partial present. The
+    // first one is drawn whole.
+    //
+    bool partial = p_damage && m_caps.has_swapRectangle && !m_dpyTransformed;
+    FrameBufferRect damage = { 0, 0, m_width, m_height };
+    if (partial && m_backBufferValid) {
+        FrameBufferRect full = damage;
+        damage = *p_damage;
+        intersectRect(&damage, full);
+        if (damage.width <= 0 || damage.height <= 0) {
+            // nothing changed
+            unbind_locked();
+            return true;
+        }
+    }
+    bool scissored = partial &&
+        (damage.width != m_width || damage.height != m_height);
+    if (scissored) {
+        s_gl.glEnable(GL_SCISSOR_TEST);
+        s_gl.glScissor(damage.x, damage.y, damage.width, damage.height);
+    }
+    if (m_swapInterval != m_appliedSwapInterval) {
+        // the framebuffer window surface is now current
+        s_egl.eglSwapInterval(m_eglDisplay, m_swapInterval);
+        m_appliedSwapInterval = m_swapInterval;
+    }
+
+    //
+    // place the display in the window, the whole window is cleared when
+    // the display does not cover it exactly.
+    //
+    if (m_dpyTransformed) {
+        EGLint winWidth = m_width, winHeight = m_height;
+        s_egl.eglQuerySurface(m_eglDisplay, m_eglSurface, EGL_WIDTH, &winWidth);
+        s_egl.eglQuerySurface(m_eglDisplay, m_eglSurface, EGL_HEIGHT, &winHeight);
+        s_gl.glViewport(0, 0, winWidth, winHeight);
+        s_gl.glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        s_gl.glClear(GL_COLOR_BUFFER_BIT);
+        s_gl.glViewport(m_dpyX, m_dpyY, m_dpyWidth, m_dpyHeight);
+    }
+    else {
+        s_gl.glViewport(0, 0, m_width, m_height);
+    }
+    s_gl.glMatrixMode(GL_MODELVIEW);
+    s_gl.glLoadIdentity();
+    if (m_dpyTransformed) {
+        s_gl.glRotatef((GLfloat)m_dpyRotation, 0.0f, 0.0f, 1.0f);
+        s_gl.glScalef(m_dpyZoom, m_dpyZoom, 1.0f);
+        s_gl.glTranslatef(1.0f - 2.0f * m_dpyCenterX,
+                          1.0f - 2.0f * m_dpyCenterY, 0.0f);
+    }
+
+    // scaled displays are filtered
+    GLenum filter = GL_NEAREST;
+    if (m_dpyZoom != 1.0f ||
+        (m_dpyTransformed && (m_dpyRotation % 180 == 0 ?
+                              (m_dpyWidth != m_width || m_dpyHeight != m_height) :
+                              (m_dpyWidth != m_height || m_dpyHeight != m_width)))) {
+        filter = GL_LINEAR;
     }
 
+    //
+    // a single opaque layer covering the framebuffer is a plain post,
+    // anything else may leave parts of the previous frame visible.
+    //
+    const FrameBufferLayer &first = p_layers[0];
+    if (p_count == 1 && !first.blend && first.x == 0 && first.y == 0 &&
+        first.width == m_width && first.height == m_height) {
+        cbs[0]->setPostFilter(filter);
+        ret = cbs[0]->post();
+    }
+    else {
+        if (!m_dpyTransformed) {
+            s_gl.glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            s_gl.glClear(GL_COLOR_BUFFER_BIT);
+        }
+        for (int i = 0; i < p_count && ret; i++) {
+            const FrameBufferLayer &l = p_layers[i];
+            if (l.width <= 0 || l.height <= 0) {
+                continue;
+            }
+            // map the full screen quad on the layer rectangle
+            s_gl.glPushMatrix();
+            s_gl.glTranslatef((GLfloat)(2 * l.x + l.width) / m_width - 1.0f,
+                              (GLfloat)(2 * l.y + l.height) / m_height - 1.0f,
+                              0.0f);
+            s_gl.glScalef((GLfloat)l.width / m_width,
+                          (GLfloat)l.height / m_height, 1.0f);
+            cbs[i]->setPostFilter(filter);
+            ret = cbs[i]->postLayer(l.alpha, l.blend);
+            s_gl.glPopMatrix();
+        }
+    }
+
+    // other users of the framebuffer context expect the default state
+    if (m_dpyTransformed) {
+        s_gl.glLoadIdentity();
+        s_gl.glViewport(0, 0, m_width, m_height);
+    }
+    if (scissored) {
+        s_gl.glDisable(GL_SCISSOR_TEST);
+    }
+
+    if (ret && p_layers != m_lastLayers) {
+        // kept to redraw the display when it is moved
+        memcpy(m_lastLayers, p_layers, p_count * sizeof(FrameBufferLayer));
+        m_lastCount = p_count;
+    }
+    if (ret) {
+        memcpy(m_lastGenerations, generations, p_count * sizeof(uint32_t));
+        m_forceRedraw = false;
+    }
+
+    if (ret) {
+        if (m_frameShm) {
+            // the readers get GL_RGBA pixels (see FrameShm.h)
+            void *pixels = m_frameShm->beginFrame();
+            s_gl.glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            s_gl.glReadPixels(0, 0, m_width, m_height,
+                              m_caps.readbackFormat, GL_UNSIGNED_BYTE, pixels);
+            if (m_caps.readbackFormat != GL_RGBA) {
+                ColorBuffer::swapRedBlue((const unsigned char *)pixels,
+                                         (unsigned char *)pixels,
+                                         (size_t)m_width * m_height);
+            }
+            m_frameShm->endFrame(p_frameId);
+        }
+        if (m_recorder) {
+            m_recorder->capture_locked();
+        }
+
+        // the swap rectangle has a top-left origin
+        if (partial) {
+            s_egl.eglSetSwapRectangleANDROID(m_eglDisplay, m_eglSurface,
+                    damage.x, m_height - damage.y - damage.height,
+                    damage.width, damage.height);
+            m_swapRectSet = true;
+        }
+        else if (m_swapRectSet) {
+            s_egl.eglSetSwapRectangleANDROID(m_eglDisplay, m_eglSurface,
+                                             0, 0, 0, 0);
+            m_swapRectSet = false;
+        }
+        s_egl.eglSwapBuffers(m_eglDisplay, m_eglSurface);
+        m_backBufferValid = partial;
+        if (p_frameId) {
+            FrameTrace::record(p_frameId, 0, FRAME_TRACE_SWAPPED,
+                               GetCurrentTimeUS());
+        }
+    }
+    unbind_locked();
+
     return ret;
 }
+
+bool FrameBuffer::setDisplayTransform(int p_x, int p_y, int p_width, int p_height,
+                                      int p_rotation, float p_zoom,
+                                      float p_centerX, float p_centerY)
+{
+    if (!m_nativeWindow || p_width <= 0 || p_height <= 0 ||
+        p_rotation % 90 != 0 || p_zoom < 1.0f ||
+        p_centerX < 0.0f || p_centerX > 1.0f ||
+        p_centerY < 0.0f || p_centerY > 1.0f) {
+        return false;
+    }
+
+    {
+        android::Mutex::Autolock mutex(m_lock);
+        m_dpyX = p_x;
+        m_dpyY = p_y;
+        m_dpyWidth = p_width;
+        m_dpyHeight = p_height;
+        m_dpyRotation = ((p_rotation % 360) + 360) % 360;
+        m_dpyZoom = p_zoom;
+        m_dpyCenterX = p_centerX;
+        m_dpyCenterY = p_centerY;
+        m_dpyTransformed = true;
+        m_forceRedraw = true;
+    }
+
+    redrawLast();
+    return true;
+}
+
+bool FrameBuffer::setVisible(bool p_visible)
+{
+    if (!m_nativeWindow) {
+        return false;
+    }
+
+    {
+        android::Mutex::Autolock mutex(m_lock);
+        if (m_visible == p_visible) {
+            return true;
+        }
+        m_visible = p_visible;
+        if (!p_visible) {
+            return true;
+        }
+        // the window content may have been lost while it was hidden
+        m_forceRedraw = true;
+        m_backBufferValid = false;
+    }
+
+    redrawLast();
+    return true;
+}
+
+//
+// redrawLast - draws the last frame again, unless a new one is already
+//     on its way. Not called by a render thread, so the post thread is
+//     fed directly.
+//
+void FrameBuffer::redrawLast()
+{
+    FrameBufferLayer layers[FB_MAX_LAYERS];
+    int count;
+    {
+        android::Mutex::Autolock mutex(m_lock);
+        count = m_lastCount;
+        memcpy(layers, m_lastLayers, count * sizeof(FrameBufferLayer));
+    }
+
+    if (count == 0) {
+        return;
+    }
+    if (m_postThread) {
+        android::Mutex::Autolock mutex(m_postLock);
+        if (m_pendingCount == 0) {
+            memcpy(m_pendingLayers, layers, count * sizeof(FrameBufferLayer));
+            m_pendingCount = count;
+            m_pendingFrameId = 0;
+            m_pendingPartial = false;
+            m_postCond.signal();
+        }
+        return;
+    }
+    postNow(layers, count, 0, NULL);
+}
+
+int FrameBuffer::postThreadMain()
+{
+    // objects released by the posts belong to this framebuffer
+    getRenderThreadInfo()->frameBuffer = this;
+
+    while (true) {
+        FrameBufferLayer layers[FB_MAX_LAYERS];
+        int count;
+        uint32_t frameId;
+        bool partial;
+        FrameBufferRect damage;
+        uint32_t seq;
+        {
+            android::Mutex::Autolock mutex(m_postLock);
+            while (m_pendingCount == 0 && !m_postExit) {
+                m_postCond.wait(m_postLock);
+            }
+            if (m_postExit) {
+                break;
+            }
+            count = m_pendingCount;
+            memcpy(layers, m_pendingLayers, count * sizeof(FrameBufferLayer));
+            frameId = m_pendingFrameId;
+            partial = m_pendingPartial;
+            damage = m_pendingDamage;
+            seq = m_postsQueued;
+            m_pendingCount = 0;
+        }
+
+        // the color buffers may have been destroyed in the meantime,
+        // postNow simply fails in that case.
+        postNow(layers, count, frameId, partial ? &damage : NULL);
+
+        android::Mutex::Autolock mutex(m_postLock);
+        m_postsDone = seq;
+        m_postDoneCond.broadcast();
+    }
+    return 0;
+}
+
+int FrameBuffer::readbackThreadMain()
+{
+    // the staging color buffers belong to this framebuffer
+    getRenderThreadInfo()->frameBuffer = this;
+
+    while (true) {
+        Readback *rb;
+        {
+            android::Mutex::Autolock readback(m_readbackLock);
+            while (m_readbackQueue.empty() && !m_readbackExit) {
+                m_readbackCond.wait(m_readbackLock);
+            }
+            if (m_readbackExit) {
+                break;
+            }
+            rb = m_readbackQueue.front();
+            m_readbackQueue.pop_front();
+            rb->state = READBACK_READING;
+        }
+
+        // the read waits for the GPU copy, not for a render thread
+        bool ok;
+        {
+            android::Mutex::Autolock mutex(m_lock);
+            ok = readback_locked(rb);
+        }
+
+        android::Mutex::Autolock readback(m_readbackLock);
+        if (rb->dropped) {
+            freeReadback(rb);
+        } else {
+            rb->state = ok ? READBACK_DONE : READBACK_FAILED;
+        }
+        m_readbackCond.broadcast();
+    }
+    return 0;
+}
+
+static uint64_t snapshotAlign(uint64_t p_offset)
+{
+    return (p_offset + RENDER_SNAPSHOT_ALIGN - 1) &
+           ~(uint64_t)(RENDER_SNAPSHOT_ALIGN - 1);
+}
+
+// writePadding - zero fill the file from 'p_pos' up to 'p_offset'
+static bool writePadding(FILE *p_file, uint64_t p_pos, uint64_t p_offset)
+{
+    static const unsigned char zeros[RENDER_SNAPSHOT_ALIGN] = { 0 };
+    while (p_pos < p_offset) {
+        size_t n = (size_t)(p_offset - p_pos);
+        if (n > sizeof(zeros)) {
+            n = sizeof(zeros);
+        }
+        if (fwrite(zeros, 1, n, p_file) != n) {
+            return false;
+        }
+        p_pos += n;
+    }
+    return true;
+}
+
+bool FrameBuffer::saveSnapshot(const char *p_path)
+{
+    // the color buffers are read with the framebuffer context
+    android::Mutex::Autolock mutex(m_lock);
+
+    std::vector<HandleType> handles;
+    std::vector<ColorBufferPtr> cbs;
+    std::vector<RenderSnapshotColorBuffer> cbRecords;
+    std::vector<RenderSnapshotContext> ctxRecords;
+    std::vector<RenderSnapshotWindow> winRecords;
+    {
+        android::Mutex::Autolock objects(m_objectsLock);
+
+        std::map<ColorBuffer *, HandleType> cbHandles;
+        m_colorbuffers.getHandles(handles);
+        for (size_t i = 0; i < handles.size(); i++) {
+            ColorBufferPtr cb = *m_colorbuffers.get(handles[i]);
+            RenderSnapshotColorBuffer rec;
+            rec.handle = handles[i];
+            rec.width = cb->getWidth();
+            rec.height = cb->getHeight();
+            rec.internalFormat = cb->getInternalFormat();
+            rec.offset = 0;
+            cbRecords.push_back(rec);
+            cbs.push_back(cb);
+            cbHandles[cb.Ptr()] = handles[i];
+        }
+
+        handles.clear();
+        m_contexts.getHandles(handles);
+        for (size_t i = 0; i < handles.size(); i++) {
+            RenderContextPtr ctx = *m_contexts.get(handles[i]);
+            RenderSnapshotContext rec;
+            rec.handle = handles[i];
+            rec.config = ctx->getConfig();
+            rec.shareGroup = m_contextGroups[handles[i]];
+            rec.isGL2 = ctx->isGL2();
+            ctxRecords.push_back(rec);
+        }
+
+        handles.clear();
+        m_windows.getHandles(handles);
+        for (size_t i = 0; i < handles.size(); i++) {
+            WindowSurfacePtr win = *m_windows.get(handles[i]);
+            RenderSnapshotWindow rec;
+            rec.handle = handles[i];
+            rec.config = win->getConfig();
+            rec.width = win->getWidth();
+            rec.height = win->getHeight();
+            rec.colorBuffer = 0;
+            rec.pad = 0;
+            ColorBuffer *cb = win->getColorBuffer().Ptr();
+            if (cb && cbHandles.find(cb) != cbHandles.end()) {
+                rec.colorBuffer = cbHandles[cb];
+            }
+            winRecords.push_back(rec);
+        }
+    }
+
+    RenderSnapshotHeader hdr;
+    hdr.magic = RENDER_SNAPSHOT_MAGIC;
+    hdr.version = RENDER_SNAPSHOT_VERSION;
+    hdr.numColorBuffers = cbRecords.size();
+    hdr.numContexts = ctxRecords.size();
+    hdr.numWindows = winRecords.size();
+    hdr.pad = 0;
+
+    uint64_t pos = sizeof(hdr) +
+                   cbRecords.size() * sizeof(RenderSnapshotColorBuffer) +
+                   ctxRecords.size() * sizeof(RenderSnapshotContext) +
+                   winRecords.size() * sizeof(RenderSnapshotWindow);
+    size_t maxLen = 0;
+    uint64_t offset = pos;
+    for (size_t i = 0; i < cbRecords.size(); i++) {
+        size_t len = (size_t)cbRecords[i].width * cbRecords[i].height * 4;
+        cbRecords[i].offset = snapshotAlign(offset);
+        offset = cbRecords[i].offset + len;
+        if (len > maxLen) {
+            maxLen = len;
+        }
+    }
+
+    FILE *file = fopen(p_path, "wb");
+    if (!file) {
+        fprintf(stderr, "Cannot create renderer snapshot %s\n", p_path);
+        return false;
+    }
+
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, file) == 1;
+    if (ok && !cbRecords.empty()) {
+        ok = fwrite(&cbRecords[0], sizeof(RenderSnapshotColorBuffer),
+                    cbRecords.size(), file) == cbRecords.size();
+    }
+    if (ok && !ctxRecords.empty()) {
+        ok = fwrite(&ctxRecords[0], sizeof(RenderSnapshotContext),
+                    ctxRecords.size(), file) == ctxRecords.size();
+    }
+    if (ok && !winRecords.empty()) {
+        ok = fwrite(&winRecords[0], sizeof(RenderSnapshotWindow),
+                    winRecords.size(), file) == winRecords.size();
+    }
+
+    unsigned char *pixels = maxLen ? (unsigned char *)malloc(maxLen) : NULL;
+    if (maxLen && !pixels) {
+        ok = false;
+    }
+    for (size_t i = 0; ok && i < cbRecords.size(); i++) {
+        const RenderSnapshotColorBuffer &rec = cbRecords[i];
+        size_t len = (size_t)rec.width * rec.height * 4;
+        ok = writePadding(file, pos, rec.offset) &&
+             cbs[i]->readPixels(0, 0, rec.width, rec.height,
+                                GL_RGBA, GL_UNSIGNED_BYTE, pixels) &&
+             fwrite(pixels, 1, len, file) == len;
+        pos = rec.offset + len;
+    }
+    free(pixels);
+
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        fprintf(stderr, "Failed to write renderer snapshot %s\n", p_path);
+        remove(p_path);
+    }
+    return ok;
+}
+
+bool FrameBuffer::restoreSnapshot(const char *p_path)
+{
+    RenderSnapshotFilePtr file(RenderSnapshotFile::map(p_path));
+    if (file.Ptr() == NULL) {
+        return false;
+    }
+
+    // color buffers are created with the framebuffer context
+    android::Mutex::Autolock mutex(m_lock);
+    {
+        android::Mutex::Autolock objects(m_objectsLock);
+        if (!m_colorbuffers.empty() || !m_contexts.empty() ||
+            !m_windows.empty()) {
+            return false;
+        }
+    }
+
+    const RenderSnapshotHeader *hdr = file->getHeader();
+    bool ok = true;
+
+    const RenderSnapshotColorBuffer *cbRecords = file->getColorBuffers();
+    for (uint32_t i = 0; ok && i < hdr->numColorBuffers; i++) {
+        const RenderSnapshotColorBuffer &rec = cbRecords[i];
+        ColorBufferPtr cb( ColorBuffer::create(rec.width, rec.height,
+                                               rec.internalFormat) );
+        if (cb.Ptr() == NULL) {
+            ok = false;
+            break;
+        }
+        cb->setSnapshotContent(file, file->getPixels(rec));
+
+        android::Mutex::Autolock objects(m_objectsLock);
+        ok = m_colorbuffers.insert(rec.handle, cb);
+    }
+
+    // the first context restored in a share group is shared by the others
+    std::map<HandleType, RenderContextPtr> groups;
+    const RenderSnapshotContext *ctxRecords = file->getContexts();
+    for (uint32_t i = 0; ok && i < hdr->numContexts; i++) {
+        const RenderSnapshotContext &rec = ctxRecords[i];
+        RenderContextPtr share(NULL);
+        std::map<HandleType, RenderContextPtr>::iterator it =
+            groups.find(rec.shareGroup);
+        if (it != groups.end()) {
+            share = it->second;
+        }
+
+        RenderContextPtr ctx( RenderContext::create(rec.config, share,
+                                                    rec.isGL2 != 0) );
+        if (ctx.Ptr() == NULL) {
+            ok = false;
+            break;
+        }
+        if (share.Ptr() == NULL) {
+            groups[rec.shareGroup] = ctx;
+        }
+
+        android::Mutex::Autolock objects(m_objectsLock);
+        ok = m_contexts.insert(rec.handle, ctx);
+        m_contextGroups[rec.handle] = rec.shareGroup;
+    }
+
+    const RenderSnapshotWindow *winRecords = file->getWindows();
+    for (uint32_t i = 0; ok && i < hdr->numWindows; i++) {
+        const RenderSnapshotWindow &rec = winRecords[i];
+        WindowSurfacePtr win( WindowSurface::create(rec.config,
+                                                    rec.width, rec.height) );
+        if (win.Ptr() == NULL) {
+            ok = false;
+            break;
+        }
+
+        ColorBufferPtr cb(NULL);
+        if (rec.colorBuffer) {
+            android::Mutex::Autolock objects(m_objectsLock);
+            ColorBufferPtr *c = m_colorbuffers.get(rec.colorBuffer);
+            if (c) {
+                cb = *c;
+            }
+        }
+        if (cb.Ptr() != NULL) {
+            // the surface renders into it from now on
+            cb->ensureContent();
+            win->setColorBuffer(cb);
+        }
+
+        android::Mutex::Autolock objects(m_objectsLock);
+        ok = m_windows.insert(rec.handle, win);
+    }
+
+    if (!ok) {
+        fprintf(stderr, "Failed to restore renderer snapshot %s\n", p_path);
+        android::Mutex::Autolock objects(m_objectsLock);
+        m_windows = WindowSurfaceMap();
+        m_contexts = RenderContextMap();
+        m_colorbuffers = ColorBufferMap();
+        m_contextGroups.clear();
+    }
+    return ok;
+}
@@ -20,20 +20,61 @@
 #include "ColorBuffer.h"
 #include "RenderContext.h"
 #include "WindowSurface.h"
+#include "HandleTable.h"
+#include "GpuMemory.h"
+#include "osThread.h"
 #include <utils/threads.h>
-#include <map>
 #include <EGL/egl.h>
 #include <stdint.h>
+#include <map>
+#include <list>
 
 #if defined(__linux__) || defined(_WIN32) || defined(__VC32__) && !defined(__CYGWIN__)
 #else
 #warning "Unsupported Platform"
 #endif
 
-typedef uint32_t HandleType;
-typedef std::map<HandleType, RenderContextPtr> RenderContextMap;
-typedef std::map<HandleType, WindowSurfacePtr> WindowSurfaceMap;
-typedef std::map<HandleType, ColorBufferPtr> ColorBufferMap;
+class FrameShm;
+class FrameRecorder;
+
+// the types tag the handles, which are unique across the three maps
+typedef HandleTable<RenderContextPtr, 1> RenderContextMap;
+typedef HandleTable<WindowSurfacePtr, 2> WindowSurfaceMap;
+typedef HandleTable<ColorBufferPtr, 3> ColorBufferMap;
+
+//
+// FrameBufferLayer - a color buffer drawn into the (x, y, width, height)
+//     rectangle of the framebuffer, in the row order of the color buffers:
+//     the layer at 0, 0 with the framebuffer size covers it exactly as a
+//     post does. A blended layer has premultiplied pixels which are drawn
+//     over the layers below it, faded by 'alpha' (0 to 255). Opaque
+//     layers ignore 'alpha'.
+//
+struct FrameBufferLayer
+{
+    HandleType colorBuffer;
+    int x;
+    int y;
+    int width;
+    int height;
+    int alpha;
+    bool blend;
+};
+
+//
+// FrameBufferRect - a rectangle of the framebuffer, in the row order of
+//     the color buffers like the layers.
+//
+struct FrameBufferRect
+{
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+// largest number of layers of a composition
+#define FB_MAX_LAYERS 16
 
 struct FrameBufferCaps
 {
@@ -41,6 +82,13 @@ struct FrameBufferCaps
     bool has_eglimage_texture_2d;
     bool has_eglimage_renderbuffer;
     bool has_BindToTexture;
+    bool has_swapRectangle;  // partial presents of the window
+    // host preferred pixel layouts, GL_BGRA_EXT or GL_RGBA, of
+    // GL_UNSIGNED_BYTE pixels. The color buffers are stored and read back
+    // in them, they are only swizzled for a guest wanting the other one.
+    // ANDROID_FB_RGBA forces GL_RGBA for both.
+    GLenum uploadFormat;     // storage and uploads of the color buffers
+    GLenum readbackFormat;   // glReadPixels
     EGLint eglMajor;
     EGLint eglMinor;
 };
@@ -48,27 +96,244 @@ struct FrameBufferCaps
 class FrameBuffer
 {
 public:
+    //
+    // initialize - p_window may be 0 for a headless framebuffer which
+    //     composes into an offscreen pbuffer. Its frames are then
+    //     published in the shared memory object named by ANDROID_FB_SHM,
+    //     if set (see FrameShm.h). ANDROID_RENDER_DISPLAY names the
+    //     native display to render on, the default one if not set.
+    //
     static bool initialize(FBNativeWindowType p_window,
                            int x, int y,
                            int width, int height);
-    static FrameBuffer *getFB() { return s_theFrameBuffer; }
+
+    //
+    // create - creates a framebuffer which is not the default one, for a
+    //     tenant of a renderer serving several emulators (see
+    //     RenderTenant.h). The dispatch tables are shared with the other
+    //     framebuffers. A headless framebuffer
+    //     publishes its frames in the 'p_shmName' shared memory object if
+    //     it is not NULL. 'p_displayName' is the native display to render
+    //     on, an X display like ":0.1" on Linux, the default one if NULL;
+    //     the framebuffers on one display share its config list.
+    //     destroy - releases a framebuffer made by create() and all its
+    //     objects, no thread may be using it anymore.
+    //
+    static FrameBuffer *create(FBNativeWindowType p_window,
+                               int x, int y, int width, int height,
+                               const char *p_shmName,
+                               const char *p_displayName);
+    static void destroy(FrameBuffer *fb);
+
+    //
+    // getFB - the framebuffer of the calling thread, the default one
+    //     unless the thread works for a tenant (RenderThreadInfo).
+    //
+    static FrameBuffer *getFB();
 
     const FrameBufferCaps &getCaps() const { return m_caps; }
 
     int getWidth() const { return m_width; }
     int getHeight() const { return m_height; }
+    int getRefreshRate() const { return m_refreshRate; }
+    int getMinSwapInterval() const { return m_minSwapInterval; }
+    int getMaxSwapInterval() const { return m_maxSwapInterval; }
+
+    //
+    // setSwapInterval - number of host display refreshes to wait for
+    //     each post, 0 presents without waiting for vsync. The value is
+    //     clamped to [getMinSwapInterval(), getMaxSwapInterval()] and is
+    //     applied on the next post.
+    //
+    void setSwapInterval(int p_interval);
+
+    //
+    // The create functions return the handle of the new object, or 0 on
+    // failure. When 'p_handle' is given the object gets that handle, which
+    // must have been reserved for it with reserveHandles.
+    //
+    HandleType createRenderContext(int p_config, HandleType p_share, bool p_isGL2 = false,
+                                   HandleType p_handle = 0);
+    HandleType createWindowSurface(int p_config, int p_width, int p_height,
+                                   HandleType p_handle = 0);
+    HandleType createColorBuffer(int p_width, int p_height, GLenum p_internalFormat,
+                                 HandleType p_handle = 0);
+
+    //
+    // Handles picked by the client, so that it does not wait for the
+    // create calls to return them.
+    // reserveHandles - sets aside 'p_count' consecutive handles for the
+    //     objects of 'p_type', returns the first one or 0.
+    // releaseHandles - gives back the handles of a reserved range which
+    //     were not used, when the client is gone.
+    //
+    enum ObjectType {
+        OBJECT_COLOR_BUFFER,
+        OBJECT_RENDER_CONTEXT,
+        OBJECT_WINDOW_SURFACE
+    };
+    HandleType reserveHandles(ObjectType p_type, uint32_t p_count);
+    void releaseHandles(ObjectType p_type, HandleType p_first, uint32_t p_count);
+
+    //
+    // waitCreated - waits a little while if 'p_handle' is reserved and its
+    //     object not created yet, for a handle another connection (or
+    //     process) got from the creating one, whose create command may be
+    //     decoded later. No framebuffer lock must be held.
+    //
+    void waitCreated(ObjectType p_type, HandleType p_handle);
 
-    HandleType createRenderContext(int p_config, HandleType p_share, bool p_isGL2 = false);
-    HandleType createWindowSurface(int p_config, int p_width, int p_height);
-    HandleType createColorBuffer(int p_width, int p_height, GLenum p_internalFormat);
     void DestroyRenderContext(HandleType p_context);
     void DestroyWindowSurface(HandleType p_surface);
     void DestroyColorBuffer(HandleType p_colorbuffer);
 
     bool  bindContext(HandleType p_context, HandleType p_drawSurface, HandleType p_readSurface);
     bool  setWindowSurfaceColorBuffer(HandleType p_surface, HandleType p_colorbuffer);
+    bool  updateColorBuffer(HandleType p_colorbuffer,
+                            int x, int y, int width, int height,
+                            GLenum format, GLenum type, void *pixels);
+    bool  readColorBuffer(HandleType p_colorbuffer,
+                          int x, int y, int width, int height,
+                          GLenum format, GLenum type, void *pixels);
+
+    //
+    // colorBufferCacheFlush - rendering and posts are processed as they are
+    //     received, so there is nothing to wait for. With 'p_forRead',
+    //     returns 1 if the color buffer was rendered to since the previous
+    //     such call, so the guest knows its CPU copy is stale, 0 otherwise.
+    //     It returns 2 instead of 1 when a readback started since then
+    //     has the new content (see startReadColorBuffer), a readback
+    //     made stale by the rendering is dropped. Returns -1 on a bad
+    //     handle.
+    //
+    int   colorBufferCacheFlush(HandleType p_colorbuffer, bool p_forRead);
+
+    //
+    // startReadColorBuffer - asynchronous readColorBuffer: the rectangle
+    //     is copied aside on the GPU and read back by a helper thread, so
+    //     the caller does not wait for the pixels. A color buffer has at
+    //     most one readback, a new one replaces it. It is done inline if
+    //     the thread cannot be started.
+    //     finishReadColorBuffer - copies at most 'p_len' bytes of the
+    //     readback pixels to 'p_pixels' and forgets it. Returns 1 when the
+    //     pixels are copied, 0 if the readback is still in flight and
+    //     'p_wait' is false, -1 if the color buffer has no readback or it
+    //     failed. A zero 'p_len' only polls the status, the readback is
+    //     then kept.
+    //
+    bool  startReadColorBuffer(HandleType p_colorbuffer,
+                               int x, int y, int width, int height,
+                               GLenum format, GLenum type);
+    int   finishReadColorBuffer(HandleType p_colorbuffer, bool p_wait,
+                                void *p_pixels, size_t p_len);
+
+    //
+    // post - display the content of a color buffer.
+    //     Unless ANDROID_SYNC_FB_POST is set, the composition is done
+    //     asynchronously by a dedicated thread: only the most recently
+    //     posted color buffer is displayed when posts come in faster
+    //     than they can be presented.
+    //     'p_frameId' is the FrameTrace id of the post, 0 when not traced.
+    //     'p_damage' is the part of the frame which changed since the
+    //     previous post, NULL if unknown. When the host can present part of
+    //     the window (has_swapRectangle) only that part is composed and
+    //     presented. Such partial presents do not wait for vsync. The
+    //     damage of posts dropped for a later one is carried over.
+    //     A frame of the same layers as the displayed one, with color
+    //     buffers which did not change since (ColorBuffer::getGeneration),
+    //     is not presented again.
+    //
+    bool post(HandleType p_colorbuffer, uint32_t p_frameId = 0,
+              const FrameBufferRect *p_damage = NULL);
 
-    bool post(HandleType p_colorbuffer);
+    //
+    // composeLayers - display the 'p_count' layers of 'p_layers' composed
+    //     in a single pass, the first layer is the bottom one. The parts of
+    //     the framebuffer no layer covers are black. Presented like a post.
+    //     Fails if a layer color buffer does not exist or there are more
+    //     than FB_MAX_LAYERS layers.
+    //
+    bool composeLayers(const FrameBufferLayer *p_layers, int p_count,
+                       uint32_t p_frameId = 0,
+                       const FrameBufferRect *p_damage = NULL);
+
+    //
+    // waitPosted - waits until the posts made so far have been presented,
+    //     or dropped for a later one. Used for the frame credits of the
+    //     guest flow control (rcFrameCredit).
+    //
+    void waitPosted();
+
+    //
+    // setDisplayTransform - where and how the framebuffer is shown in its
+    //     native window, without changing its size for the guest:
+    //     (p_x, p_y, p_width, p_height) is the display viewport in window
+    //     pixels, p_rotation a counterclockwise rotation in degrees (a
+    //     multiple of 90), and p_zoom >= 1 a magnification around the
+    //     (p_centerX, p_centerY) point of the framebuffer, given as
+    //     fractions of its width and height in the row order of the color
+    //     buffers. The last frame is displayed again with the new
+    //     transform. Fails for a headless framebuffer.
+    //
+    bool setDisplayTransform(int p_x, int p_y, int p_width, int p_height,
+                             int p_rotation, float p_zoom,
+                             float p_centerX, float p_centerY);
+
+    //
+    // setVisible - whether the native window can be seen, as reported by
+    //     the emulator UI. Nothing is composed nor presented while it is
+    //     hidden, the last frame is drawn again when it is shown. Fails
+    //     for a headless framebuffer.
+    //
+    bool setVisible(bool p_visible);
+
+    //
+    // getConfigPbuffer - 1x1 pbuffer of the given config, shared by all
+    //     window surfaces which render into framebuffer objects and only
+    //     need a drawable to make their context current. It is created
+    //     on first use and lives as long as the FrameBuffer.
+    //
+    EGLSurface getConfigPbuffer(int p_config);
+
+    //
+    // saveSnapshot - writes the contexts, window surfaces and color
+    //     buffers of the framebuffer, with the color buffer pixels, to the
+    //     'p_path' renderer snapshot file (see RendererSnapshot.h).
+    //     restoreSnapshot - recreates the objects of the snapshot with the
+    //     same handles, so a guest resumed from the matching VM snapshot
+    //     keeps using them. The framebuffer must not have any object yet,
+    //     it is the one of the calling thread. The file is mapped and the
+    //     pixels of a color buffer are only uploaded when it is first
+    //     used. The GL objects of the contexts and their state are not
+    //     part of the snapshot, the contexts are restored empty.
+    //
+    bool saveSnapshot(const char *p_path);
+    bool restoreSnapshot(const char *p_path);
+
+    //
+    // startRecording - calls 'p_callback' with each frame presented from
+    //     now on, scaled to 'p_width' x 'p_height' (the framebuffer size
+    //     if 0), see FrameRecorder.h. The frames are the framebuffer area
+    //     of the window as composed, with any display transform. Only one
+    //     recording can run at a time.
+    //     stopRecording - returns once the callback is not called anymore.
+    //
+    bool startRecording(int p_width, int p_height,
+                        OnRecordedFrameFunc p_callback, void *p_opaque);
+    void stopRecording();
+
+    //
+    // GPU memory accounting (see GpuMemory.h).
+    // getMemAccount - the account of the objects created by the calling
+    //     thread: the one of its connection, or the framebuffer's own.
+    // getOwnMemAccount - the account of the memory the framebuffer holds
+    //     itself, such as the pooled color buffers.
+    // nextUseStamp - orders the uses of the color buffers, for eviction
+    //     of the least recently used ones. The lock should be held.
+    //
+    GpuMemoryAccount *getMemAccount();
+    GpuMemoryAccount *getOwnMemAccount() const { return m_memAccount; }
+    uint32_t nextUseStamp() { return ++m_useStamp; }
 
     EGLDisplay getDisplay() const { return m_eglDisplay; }
     EGLContext getContext() const { return m_eglContext; }
@@ -76,31 +341,157 @@ public:
     bool bind_locked();
     bool unbind_locked();
 
+private:
+    friend class FrameRecorder;
+
+    class PostThread : public osUtils::Thread {
+    public:
+        explicit PostThread(FrameBuffer *p_fb) : m_fb(p_fb) {}
+        virtual int Main() { return m_fb->postThreadMain(); }
+    private:
+        FrameBuffer *m_fb;
+    };
+
+    class ReadbackThread : public osUtils::Thread {
+    public:
+        explicit ReadbackThread(FrameBuffer *p_fb) : m_fb(p_fb) {}
+        virtual int Main() { return m_fb->readbackThreadMain(); }
+    private:
+        FrameBuffer *m_fb;
+    };
+
+    enum ReadbackState {
+        READBACK_QUEUED,
+        READBACK_READING,
+        READBACK_DONE,
+        READBACK_FAILED
+    };
+
+    struct Readback {
+        ColorBufferPtr staging;  // copy of the rectangle until it is read
+        int width;
+        int height;
+        GLenum format;
+        GLenum type;
+        unsigned char *pixels;
+        size_t len;
+        ReadbackState state;
+        bool dropped;  // forgotten while being read, the thread frees it
+    };
+
 private:
     FrameBuffer(int p_x, int p_y, int p_width, int p_height);
     ~FrameBuffer();
-    HandleType genHandle();
+    bool postNow(const FrameBufferLayer *p_layers, int p_count,
+                 uint32_t p_frameId, const FrameBufferRect *p_damage);
+    static int queryRefreshRate();
+    void probePixelFormats(const char *p_glExtensions);
+    void redrawLast();
+    int postThreadMain();
+    int readbackThreadMain();
+    bool readback_locked(Readback *p_rb);
+    void cancelReadback_locked(HandleType p_colorbuffer);
+    void evictColorBuffers_locked();
+    static void freeReadback(Readback *p_rb);
 
 private:
     static FrameBuffer *s_theFrameBuffer;
-    static HandleType s_nextHandle;
     int m_x;
     int m_y;
     int m_width;
     int m_height;
+    //
+    // m_lock serializes the use of the framebuffer EGL context (see
+    // bind_locked) and must be held whenever the last reference to a
+    // ColorBuffer may be dropped. m_objectsLock only protects the handle
+    // maps below and is never held while doing GL work. When both are
+    // needed m_lock is taken first.
+    //
     android::Mutex m_lock;
+    android::Mutex m_objectsLock;
+    android::Condition m_objectsCond;  // a reserved handle was used or released
     FBNativeWindowType m_nativeWindow;
     FrameBufferCaps m_caps;
     EGLDisplay m_eglDisplay;
     RenderContextMap m_contexts;
     WindowSurfaceMap m_windows;
     ColorBufferMap m_colorbuffers;
+    // share group of each context, named after its first context
+    std::map<HandleType, HandleType> m_contextGroups;
+    GpuMemoryAccount *m_memAccount;
+    uint32_t m_useStamp;
+    std::map<int, EGLSurface> m_configPbuffers;  // see getConfigPbuffer
 
     EGLSurface m_eglSurface;
     EGLContext m_eglContext;
 
+    // binding restored by the outermost unbind_locked, nested
+    // bind_locked calls keep the framebuffer context current in between
     EGLContext m_prevContext;
     EGLSurface m_prevReadSurf;
     EGLSurface m_prevDrawSurf;
+    int m_bindDepth;
+
+    // headless framebuffer frames output, NULL if not published
+    FrameShm *m_frameShm;
+    // video capture of the presented frames, protected by m_lock
+    FrameRecorder *m_recorder;
+
+    int m_refreshRate;
+    int m_minSwapInterval;
+    int m_maxSwapInterval;
+    // requested and currently applied (-1 until the first post) swap
+    // intervals, protected by m_lock
+    int m_swapInterval;
+    int m_appliedSwapInterval;
+    // the back buffer holds the last frame, after a partial present, and
+    // the swap rectangle of the window is set, protected by m_lock
+    bool m_backBufferValid;
+    bool m_swapRectSet;
+
+    // asynchronous post state, protected by m_postLock
+    PostThread *m_postThread;
+    bool m_postExit;
+    android::Mutex m_postLock;
+    android::Condition m_postCond;
+    FrameBufferLayer m_pendingLayers[FB_MAX_LAYERS];
+    int m_pendingCount;     // 0 if there is no pending post
+    uint32_t m_pendingFrameId;
+    bool m_pendingPartial;  // m_pendingDamage is set
+    FrameBufferRect m_pendingDamage;
+    // number of posts made and of those presented, see waitPosted
+    uint32_t m_postsQueued;
+    uint32_t m_postsDone;
+    android::Condition m_postDoneCond;
+
+    //
+    // asynchronous readbacks by color buffer handle, protected by
+    // m_readbackLock which is taken after m_lock. The readbacks waiting
+    // for the thread are also in m_readbackQueue. The staging color
+    // buffers are only released with m_lock held.
+    //
+    ReadbackThread *m_readbackThread;
+    bool m_readbackExit;
+    android::Mutex m_readbackLock;
+    android::Condition m_readbackCond;
+    std::map<HandleType, Readback *> m_readbacks;
+    std::list<Readback *> m_readbackQueue;
+
+    // last displayed layers and display transform, protected by m_lock.
+    // The frame is drawn even if unchanged with m_forceRedraw.
+    FrameBufferLayer m_lastLayers[FB_MAX_LAYERS];
+    uint32_t m_lastGenerations[FB_MAX_LAYERS];
+    int m_lastCount;
+    bool m_forceRedraw;
+    bool m_visible;
+    bool m_dpyTransformed;
+    int m_dpyX;
+    int m_dpyY;
+    int m_dpyWidth;
+    int m_dpyHeight;
+    int m_dpyRotation;
+    float m_dpyZoom;
+    float m_dpyCenterX;
+    float m_dpyCenterY;
 };
 #endif
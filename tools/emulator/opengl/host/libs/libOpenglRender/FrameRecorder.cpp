@@ -0,0 +1,181 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "FrameRecorder.h"
+#include "FrameBuffer.h"
+#include "GLDispatch.h"
+#include "TimeUtils.h"
+#include <cutils/atomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+FrameRecorder::FrameRecorder() :
+    m_fb(NULL),
+    m_width(0),
+    m_height(0),
+    m_callback(NULL),
+    m_opaque(NULL),
+    m_head(0),
+    m_tail(0),
+    m_frames(0),
+    m_dropped(0),
+    m_thread(NULL),
+    m_exit(false)
+{
+    for (int i = 0; i < FRAME_RECORDER_RING_SIZE; i++) {
+        m_slots[i].pixels = NULL;
+        m_slots[i].timeUS = 0;
+    }
+}
+
+FrameRecorder *FrameRecorder::create(FrameBuffer *p_fb,
+                                     int p_width, int p_height,
+                                     OnRecordedFrameFunc p_callback,
+                                     void *p_opaque)
+{
+    if (p_width <= 0 || p_height <= 0 || !p_callback) {
+        return NULL;
+    }
+
+    FrameRecorder *rec = new FrameRecorder();
+    rec->m_fb = p_fb;
+    rec->m_width = p_width;
+    rec->m_height = p_height;
+    rec->m_callback = p_callback;
+    rec->m_opaque = p_opaque;
+
+    bool ok = true;
+    if (p_width != p_fb->getWidth() || p_height != p_fb->getHeight()) {
+        rec->m_grab = ColorBufferPtr(ColorBuffer::create(p_fb->getWidth(),
+                                                         p_fb->getHeight(),
+                                                         GL_RGBA));
+        ok = (rec->m_grab.Ptr() != NULL);
+    }
+    for (int i = 0; i < FRAME_RECORDER_RING_SIZE && ok; i++) {
+        Slot &s = rec->m_slots[i];
+        s.staging = ColorBufferPtr(ColorBuffer::create(p_width, p_height,
+                                                       GL_RGBA));
+        s.pixels = (unsigned char *)malloc(p_width * p_height * 4);
+        ok = (s.staging.Ptr() != NULL && s.pixels != NULL);
+    }
+    if (!ok) {
+        delete rec;
+        return NULL;
+    }
+    return rec;
+}
+
+FrameRecorder::~FrameRecorder()
+{
+    for (int i = 0; i < FRAME_RECORDER_RING_SIZE; i++) {
+        free(m_slots[i].pixels);
+    }
+    delete m_thread;
+}
+
+bool FrameRecorder::start()
+{
+    m_thread = new RecorderThread(this);
+    m_thread->setName("FrameRecorder");
+    if (!m_thread->start()) {
+        delete m_thread;
+        m_thread = NULL;
+        return false;
+    }
+    return true;
+}
+
+void FrameRecorder::stop()
+{
+    if (!m_thread) {
+        return;
+    }
+    {
+        android::Mutex::Autolock wake(m_wakeLock);
+        m_exit = true;
+        m_wakeCond.signal();
+    }
+    m_thread->wait(NULL);
+    delete m_thread;
+    m_thread = NULL;
+
+    fprintf(stderr, "FrameRecorder: %u frames recorded, %u dropped\n",
+            m_frames, m_dropped);
+}
+
+void FrameRecorder::capture_locked()
+{
+    int32_t head = m_head;
+    if (head - android_atomic_acquire_load(&m_tail) ==
+            FRAME_RECORDER_RING_SIZE) {
+        // the consumer is behind, never wait for it
+        m_dropped++;
+        return;
+    }
+
+    Slot &s = m_slots[head % FRAME_RECORDER_RING_SIZE];
+    bool ok;
+    if (m_grab.Ptr()) {
+        ok = m_grab->copyFromSurface(m_grab->getWidth(), m_grab->getHeight()) &&
+             s.staging->drawScaled(m_grab.Ptr());
+    }
+    else {
+        ok = s.staging->copyFromSurface(m_width, m_height);
+    }
+    if (!ok) {
+        m_dropped++;
+        return;
+    }
+    s.timeUS = GetCurrentTimeUS();
+
+    // let the GPU start the copy before the thread reads it
+    s_gl.glFlush();
+
+    android_atomic_release_store(head + 1, &m_head);
+    android::Mutex::Autolock wake(m_wakeLock);
+    m_wakeCond.signal();
+}
+
+int FrameRecorder::threadMain()
+{
+    while (true) {
+        int32_t tail = m_tail;
+        {
+            android::Mutex::Autolock wake(m_wakeLock);
+            while (!m_exit && android_atomic_acquire_load(&m_head) == tail) {
+                m_wakeCond.wait(m_wakeLock);
+            }
+            if (m_exit) {
+                break;
+            }
+        }
+
+        Slot &s = m_slots[tail % FRAME_RECORDER_RING_SIZE];
+        bool ok;
+        {
+            android::Mutex::Autolock lock(m_fb->m_lock);
+            ok = s.staging->readPixels(0, 0, m_width, m_height,
+                                       GL_RGBA, GL_UNSIGNED_BYTE, s.pixels);
+        }
+
+        // the consumer runs without any lock, it may take its time
+        if (ok) {
+            m_callback(m_opaque, m_width, m_height, s.pixels, s.timeUS);
+            m_frames++;
+        }
+        android_atomic_release_store(tail + 1, &m_tail);
+    }
+    return 0;
+}
@@ -0,0 +1,107 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _LIB_OPENGL_RENDER_FRAME_RECORDER_H
+#define _LIB_OPENGL_RENDER_FRAME_RECORDER_H
+
+#include "libOpenglRender/render_api.h"
+#include "ColorBuffer.h"
+#include "osThread.h"
+#include <utils/threads.h>
+#include <stdint.h>
+
+class FrameBuffer;
+
+// number of frames which can be in flight between a post and the callback
+#define FRAME_RECORDER_RING_SIZE 4
+
+//
+// FrameRecorder - streams the frames a FrameBuffer presents to a callback,
+//    for video capture. Each presented frame is copied on the GPU into the
+//    next staging color buffer of a ring, downscaled on the way if the
+//    record size is not the framebuffer size. A recorder thread reads the
+//    staging buffers back and calls the callback outside of the
+//    framebuffer lock, so a slow consumer only drops frames and never
+//    delays the composition.
+//
+//    The ring is a single producer, single consumer queue: the post path
+//    fills the slots at 'head' and the recorder thread releases them at
+//    'tail', both only move forward. A frame is dropped when the ring is
+//    full.
+//
+class FrameRecorder
+{
+public:
+    //
+    // create - a recorder of 'p_width' x 'p_height' frames of 'p_fb',
+    //     the framebuffer lock should be held. start - starts the thread.
+    //     stop - waits for the thread to exit, it must be called without
+    //     the framebuffer lock. The recorder must be deleted with the lock
+    //     held, once stopped, it releases its color buffers.
+    //
+    static FrameRecorder *create(FrameBuffer *p_fb, int p_width, int p_height,
+                                 OnRecordedFrameFunc p_callback,
+                                 void *p_opaque);
+    ~FrameRecorder();
+    bool start();
+    void stop();
+
+    //
+    // capture_locked - queues the frame composed in the current read
+    //     surface of the framebuffer context, which must be bound. It
+    //     changes the texture and framebuffer object bindings.
+    //
+    void capture_locked();
+
+private:
+    class RecorderThread : public osUtils::Thread {
+    public:
+        explicit RecorderThread(FrameRecorder *p_rec) : m_rec(p_rec) {}
+        virtual int Main() { return m_rec->threadMain(); }
+    private:
+        FrameRecorder *m_rec;
+    };
+
+    struct Slot {
+        ColorBufferPtr staging;
+        unsigned char *pixels;
+        long long timeUS;  // when the frame was presented
+    };
+
+private:
+    FrameRecorder();
+    int threadMain();
+
+private:
+    FrameBuffer *m_fb;
+    int m_width;
+    int m_height;
+    OnRecordedFrameFunc m_callback;
+    void *m_opaque;
+    ColorBufferPtr m_grab;  // full size copy of the frame when downscaling
+    Slot m_slots[FRAME_RECORDER_RING_SIZE];
+    volatile int32_t m_head;
+    volatile int32_t m_tail;
+    unsigned int m_frames;
+    unsigned int m_dropped;
+
+    // the lock and condition only put the idle thread to sleep
+    RecorderThread *m_thread;
+    android::Mutex m_wakeLock;
+    android::Condition m_wakeCond;
+    bool m_exit;
+};
+
+#endif
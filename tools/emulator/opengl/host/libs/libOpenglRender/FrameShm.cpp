@@ -0,0 +1,123 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "FrameShm.h"
+#include <stdio.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// pixels start on a cache line
+#define FRAME_SHM_PIXELS_OFFSET 64
+
+FrameShm::FrameShm() :
+    m_header(NULL),
+    m_mapSize(0)
+{
+}
+
+#ifdef __linux__
+
+FrameShm *FrameShm::create(const char *p_name, int p_width, int p_height)
+{
+    if (p_width <= 0 || p_height <= 0) {
+        return NULL;
+    }
+
+    size_t size = FRAME_SHM_PIXELS_OFFSET + (size_t)p_width * p_height * 4;
+
+    int fd = shm_open(p_name, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        fprintf(stderr, "FrameShm: failed to open %s\n", p_name);
+        return NULL;
+    }
+    if (ftruncate(fd, size) < 0) {
+        fprintf(stderr, "FrameShm: failed to size %s\n", p_name);
+        close(fd);
+        return NULL;
+    }
+
+    void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        fprintf(stderr, "FrameShm: failed to map %s\n", p_name);
+        return NULL;
+    }
+
+    FrameShm *shm = new FrameShm();
+    shm->m_header = (FrameShmHeader *)ptr;
+    shm->m_mapSize = size;
+
+    FrameShmHeader *h = shm->m_header;
+    h->version = FRAME_SHM_VERSION;
+    h->width = p_width;
+    h->height = p_height;
+    h->offset = FRAME_SHM_PIXELS_OFFSET;
+    h->seq = 0;
+    h->frameId = 0;
+    h->pad = 0;
+    __sync_synchronize();
+    // readers check the magic last
+    h->magic = FRAME_SHM_MAGIC;
+
+    return shm;
+}
+
+FrameShm::~FrameShm()
+{
+    if (m_header) {
+        munmap(m_header, m_mapSize);
+    }
+}
+
+void *FrameShm::beginFrame()
+{
+    m_header->seq++;
+    __sync_synchronize();
+    return (unsigned char *)m_header + m_header->offset;
+}
+
+void FrameShm::endFrame(uint32_t p_frameId)
+{
+    m_header->frameId = p_frameId;
+    __sync_synchronize();
+    m_header->seq++;
+}
+
+#else
+
+FrameShm *FrameShm::create(const char *p_name, int p_width, int p_height)
+{
+    return NULL;
+}
+
+FrameShm::~FrameShm()
+{
+}
+
+void *FrameShm::beginFrame()
+{
+    return NULL;
+}
+
+void FrameShm::endFrame(uint32_t p_frameId)
+{
+}
+
+#endif
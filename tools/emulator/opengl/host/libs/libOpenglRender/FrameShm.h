@@ -0,0 +1,75 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _LIB_OPENGL_RENDER_FRAME_SHM_H
+#define _LIB_OPENGL_RENDER_FRAME_SHM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define FRAME_SHM_MAGIC    0x4d485346  // 'FSHM'
+#define FRAME_SHM_VERSION  1
+
+//
+// Layout of the shared memory object, the pixels follow the header at
+// 'offset'. They are width x height tightly packed GL_RGBA/GL_UNSIGNED_BYTE
+// pixels, bottom row first as returned by glReadPixels.
+//
+// 'seq' is odd while a frame is being written. A reader reads it, copies
+// the pixels and reads it again, the copy is good if both values are the
+// same and even. 'frameId' is the FrameTrace id of the frame, or 0.
+//
+struct FrameShmHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t offset;
+    volatile int32_t seq;
+    volatile uint32_t frameId;
+    uint32_t pad;
+};
+
+//
+// FrameShm - publishes the composited frames of a headless FrameBuffer
+//    in a POSIX shared memory object, for readers in other processes
+//    (test harnesses taking screenshots, video encoders, ...).
+//    Only supported on Linux, create() returns NULL elsewhere.
+//
+class FrameShm {
+public:
+    //
+    // create - creates (or truncates) the shared memory object 'p_name'
+    //     and maps it. returns NULL on failure.
+    //
+    static FrameShm *create(const char *p_name, int p_width, int p_height);
+    ~FrameShm();
+
+    //
+    // beginFrame - returns where the pixels of the next frame are to be
+    //     written, endFrame publishes them.
+    //
+    void *beginFrame();
+    void endFrame(uint32_t p_frameId);
+
+private:
+    FrameShm();
+
+private:
+    FrameShmHeader *m_header;
+    size_t m_mapSize;
+};
+
+#endif
@@ -0,0 +1,214 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "FrameTrace.h"
+#include "ThreadInfo.h"
+#include <cutils/atomic.h>
+#include <utils/threads.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <map>
+
+struct FrameTraceEvent {
+    uint32_t frame;
+    uint32_t conn;
+    int32_t stage;
+    long long timeUS;
+};
+
+//
+// single writer ring, the writer fills the slot then bumps 'head' with
+// a barrier so a reader never sees a slot before it is complete (unless
+// it has been overwritten since).
+//
+struct FrameTraceRing {
+    FrameTraceEvent events[FRAME_TRACE_RING_SIZE];
+    volatile int32_t head;
+    volatile int32_t inUse;
+    FrameTraceRing *next;
+};
+
+// list of all rings ever allocated, only grows, protected by s_ringsLock
+static FrameTraceRing *s_rings = NULL;
+static android::Mutex s_ringsLock;
+
+static volatile int32_t s_lastFrameId = 0;
+static volatile int32_t s_lastConnId = 0;
+
+bool FrameTrace::enabled()
+{
+    static int s_enabled = -1;
+    if (s_enabled < 0) {
+        s_enabled = getenv("ANDROID_FRAME_TRACE") != NULL;
+    }
+    return s_enabled != 0;
+}
+
+uint32_t FrameTrace::newFrameId()
+{
+    return android_atomic_inc(&s_lastFrameId) + 1;
+}
+
+uint32_t FrameTrace::newConnectionId()
+{
+    return android_atomic_inc(&s_lastConnId) + 1;
+}
+
+static FrameTraceRing *getThreadRing()
+{
+    RenderThreadInfo *tInfo = getRenderThreadInfo();
+    if (tInfo->traceRing) {
+        return tInfo->traceRing;
+    }
+
+    android::Mutex::Autolock lock(s_ringsLock);
+
+    // reuse the ring of a thread which has gone
+    FrameTraceRing *ring;
+    for (ring = s_rings; ring != NULL; ring = ring->next) {
+        if (!ring->inUse) {
+            break;
+        }
+    }
+
+    if (!ring) {
+        ring = new FrameTraceRing();
+        ring->head = 0;
+        ring->next = s_rings;
+        s_rings = ring;
+    }
+    ring->inUse = 1;
+
+    tInfo->traceRing = ring;
+    return ring;
+}
+
+void FrameTrace::record(uint32_t frame, uint32_t conn,
+                        FrameTraceStage stage, long long timeUS)
+{
+    FrameTraceRing *ring = getThreadRing();
+
+    FrameTraceEvent &e = ring->events[ring->head % FRAME_TRACE_RING_SIZE];
+    e.frame = frame;
+    e.conn = conn;
+    e.stage = stage;
+    e.timeUS = timeUS;
+
+    android_atomic_inc(&ring->head);
+}
+
+void FrameTrace::releaseThreadRing()
+{
+    RenderThreadInfo *tInfo = getRenderThreadInfo();
+    if (!tInfo->traceRing) {
+        return;
+    }
+
+    android::Mutex::Autolock lock(s_ringsLock);
+    tInfo->traceRing->inUse = 0;
+    tInfo->traceRing = NULL;
+}
+
+struct FrameTimes {
+    uint32_t conn;
+    long long timeUS[FRAME_TRACE_NUM_STAGES];
+};
+
+typedef std::map<uint32_t, FrameTimes> FrameTimesMap;
+
+static void writeSpan(FILE *fp, bool *first, const char *name, uint32_t frame,
+                      uint32_t tid, long long start, long long end)
+{
+    if (start == 0 || end == 0 || end < start) {
+        return;
+    }
+    fprintf(fp, "%s\n{\"name\":\"%s\",\"cat\":\"frame\",\"ph\":\"X\","
+                "\"pid\":0,\"tid\":%u,\"ts\":%lld,\"dur\":%lld,"
+                "\"args\":{\"frame\":%u}}",
+            *first ? "" : ",", name, tid, start, end - start, frame);
+    *first = false;
+}
+
+bool FrameTrace::dump()
+{
+    const char *fileName = getenv("ANDROID_FRAME_TRACE");
+    if (!fileName) {
+        return false;
+    }
+
+    android::Mutex::Autolock lock(s_ringsLock);
+
+    //
+    // gather the stages of each frame, they are usually recorded by
+    // different threads
+    //
+    FrameTimesMap frames;
+    for (FrameTraceRing *ring = s_rings; ring != NULL; ring = ring->next) {
+        int32_t head = android_atomic_acquire_load(&ring->head);
+        int32_t start = head > FRAME_TRACE_RING_SIZE ?
+                        head - FRAME_TRACE_RING_SIZE : 0;
+        for (int32_t i = start; i < head; i++) {
+            const FrameTraceEvent &e = ring->events[i % FRAME_TRACE_RING_SIZE];
+            if (e.stage < 0 || e.stage >= FRAME_TRACE_NUM_STAGES) {
+                continue;
+            }
+
+            FrameTimesMap::iterator it = frames.find(e.frame);
+            if (it == frames.end()) {
+                FrameTimes t;
+                t.conn = 0;
+                for (int s = 0; s < FRAME_TRACE_NUM_STAGES; s++) {
+                    t.timeUS[s] = 0;
+                }
+                it = frames.insert(std::make_pair(e.frame, t)).first;
+            }
+            if (e.conn) {
+                it->second.conn = e.conn;
+            }
+            it->second.timeUS[e.stage] = e.timeUS;
+        }
+    }
+
+    FILE *fp = fopen(fileName, "w");
+    if (!fp) {
+        fprintf(stderr, "FrameTrace: failed to open %s\n", fileName);
+        return false;
+    }
+
+    //
+    // decoding is shown on the track of the connection (tid is the
+    // connection id), queuing and composition on the compositor track
+    // (tid 0).
+    //
+    bool first = true;
+    fprintf(fp, "{\"traceEvents\":[");
+    for (FrameTimesMap::iterator it = frames.begin();
+         it != frames.end(); it++) {
+        const FrameTimes &t = it->second;
+        writeSpan(fp, &first, "decode", it->first, t.conn,
+                  t.timeUS[FRAME_TRACE_RECEIVED],
+                  t.timeUS[FRAME_TRACE_DECODED]);
+        writeSpan(fp, &first, "queue", it->first, 0,
+                  t.timeUS[FRAME_TRACE_DECODED],
+                  t.timeUS[FRAME_TRACE_COMPOSITE_START]);
+        writeSpan(fp, &first, "composite", it->first, 0,
+                  t.timeUS[FRAME_TRACE_COMPOSITE_START],
+                  t.timeUS[FRAME_TRACE_SWAPPED]);
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+
+    return true;
+}
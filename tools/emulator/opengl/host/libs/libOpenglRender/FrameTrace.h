@@ -0,0 +1,79 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _LIB_OPENGL_RENDER_FRAME_TRACE_H
+#define _LIB_OPENGL_RENDER_FRAME_TRACE_H
+
+#include <stdint.h>
+
+//
+// FrameTrace - records the timing of every posted frame.
+//    Each rcFBPost gets a frame id and is timestamped when the data
+//    holding it was received, when it has been decoded, when the
+//    composition starts and when the buffers have been swapped. This tells
+//    whether a slow frame comes from the transport, the decoding or the
+//    host composition.
+//
+//    Events go to a ring owned by the recording thread, so recording
+//    never takes a lock. Each ring keeps the last FRAME_TRACE_RING_SIZE
+//    events.
+//
+//    Tracing is enabled by setting ANDROID_FRAME_TRACE to the name of a
+//    file. The trace is written to that file, in Chrome trace event JSON
+//    format (chrome://tracing, Perfetto), when a connection closes and
+//    when a statistics dump is requested (SIGUSR1).
+//
+enum FrameTraceStage {
+    FRAME_TRACE_RECEIVED = 0,
+    FRAME_TRACE_DECODED,
+    FRAME_TRACE_COMPOSITE_START,
+    FRAME_TRACE_SWAPPED,
+    FRAME_TRACE_NUM_STAGES
+};
+
+#define FRAME_TRACE_RING_SIZE 4096
+
+class FrameTrace
+{
+public:
+    static bool enabled();
+
+    // returns a new unique id, for frames or connections
+    static uint32_t newFrameId();
+    static uint32_t newConnectionId();
+
+    //
+    // record - log 'stage' of 'frame' at 'timeUS' in the ring of the
+    //     calling thread. 'conn' is the connection the frame came from,
+    //     can be 0 when unknown to the caller.
+    //
+    static void record(uint32_t frame, uint32_t conn,
+                       FrameTraceStage stage, long long timeUS);
+
+    //
+    // releaseThreadRing - called by a thread which will not record any
+    //     more events. Its ring keeps its events and is handed over to
+    //     the next thread which starts recording.
+    //
+    static void releaseThreadRing();
+
+    //
+    // dump - write all recorded frames to the ANDROID_FRAME_TRACE file.
+    //     Events recorded concurrently with the dump may be missing.
+    //
+    static bool dump();
+};
+
+#endif
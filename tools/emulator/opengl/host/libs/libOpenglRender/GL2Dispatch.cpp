@@ -18,10 +18,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "osDynLibrary.h"
+#include "ProcTable.h"
 
 gl2_decoder_context_t s_gl2;
 
 static osUtils::dynLibrary *s_gles2_lib = NULL;
+static ProcTable s_gles2_procs;
+static bool s_gles2_loading = false;
 
 //
 // This function is called only once during initialiation before
@@ -39,21 +42,33 @@ bool init_gl2_dispatch()
     if (!s_gles2_lib) return false;
 
     //
-    // init the GLES dispatch table
+    // init the GLES dispatch table, which asks for all the entry points
+    // the decoders need, they are kept in s_gles2_procs for them
     //
-    return s_gl2.initDispatchByName( gl2_dispatch_get_proc_func, NULL );
+    s_gles2_loading = true;
+    s_gl2.initDispatchByName( gl2_dispatch_get_proc_func, NULL );
+    s_gles2_loading = false;
+    return true;
 }
 
 //
-// This function is called only during initialiation before
-// any thread has been created - hence it should NOT be thread safe.
+// Called by init_gl2_dispatch, which fills s_gles2_procs, then by each
+// render thread initializing its decoder, which only reads it.
 //
 void *gl2_dispatch_get_proc_func(const char *name, void *userData)
 {
     if (!s_gles2_lib) {
         return NULL;
     }
-    return (void *)s_gles2_lib->findSymbol(name);
+    void *proc;
+    if (s_gles2_procs.find(name, &proc)) {
+        return proc;
+    }
+    proc = (void *)s_gles2_lib->findSymbol(name);
+    if (s_gles2_loading) {
+        s_gles2_procs.add(name, proc);
+    }
+    return proc;
 }
 
 #endif
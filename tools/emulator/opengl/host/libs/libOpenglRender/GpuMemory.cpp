@@ -0,0 +1,204 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "GpuMemory.h"
+#include <utils/threads.h>
+#include <stdlib.h>
+#include <list>
+
+struct GpuMemoryGroup
+{
+    const void *key;
+    int accounts;
+    long long gpuBytes;
+    long long peakGpuBytes;
+    long long hostBytes;
+    unsigned long long evictions;
+    unsigned long long restores;
+};
+
+struct GpuMemoryAccount
+{
+    GpuMemoryGroup *group;
+    unsigned int id;
+    int refs;
+    long long gpuBytes;
+    long long peakGpuBytes;
+    long long hostBytes;
+    unsigned long long evictions;
+    unsigned long long restores;
+};
+
+typedef std::list<GpuMemoryGroup *> GpuMemoryGroupList;
+typedef std::list<GpuMemoryAccount *> GpuMemoryAccountList;
+
+// s_lock protects all the state below
+static android::Mutex s_lock;
+static GpuMemoryGroupList s_groups;
+static GpuMemoryAccountList s_accounts;
+static unsigned int s_nextAccountId = 1;
+static long long s_budget = -1;
+
+GpuMemoryAccount *GpuMemory::addAccount(const void *group)
+{
+    android::Mutex::Autolock lock(s_lock);
+
+    GpuMemoryGroup *g = NULL;
+    for (GpuMemoryGroupList::iterator it = s_groups.begin();
+         it != s_groups.end(); it++) {
+        if ((*it)->key == group) {
+            g = *it;
+            break;
+        }
+    }
+    if (!g) {
+        g = new GpuMemoryGroup();
+        g->key = group;
+        g->accounts = 0;
+        g->gpuBytes = 0;
+        g->peakGpuBytes = 0;
+        g->hostBytes = 0;
+        g->evictions = 0;
+        g->restores = 0;
+        s_groups.push_back(g);
+    }
+    g->accounts++;
+
+    GpuMemoryAccount *a = new GpuMemoryAccount();
+    a->group = g;
+    a->id = s_nextAccountId++;
+    a->refs = 1;
+    a->gpuBytes = 0;
+    a->peakGpuBytes = 0;
+    a->hostBytes = 0;
+    a->evictions = 0;
+    a->restores = 0;
+    s_accounts.push_back(a);
+    return a;
+}
+
+void GpuMemory::acquire(GpuMemoryAccount *account)
+{
+    android::Mutex::Autolock lock(s_lock);
+    account->refs++;
+}
+
+void GpuMemory::release(GpuMemoryAccount *account)
+{
+    if (!account) {
+        return;
+    }
+
+    android::Mutex::Autolock lock(s_lock);
+    if (--account->refs > 0) {
+        return;
+    }
+    s_accounts.remove(account);
+
+    // the group goes with its last account, a new framebuffer may reuse
+    // the same address
+    GpuMemoryGroup *g = account->group;
+    if (--g->accounts == 0) {
+        s_groups.remove(g);
+        delete g;
+    }
+    delete account;
+}
+
+void GpuMemory::charge(GpuMemoryAccount *account,
+                       long long gpuBytes, long long hostBytes)
+{
+    android::Mutex::Autolock lock(s_lock);
+    GpuMemoryGroup *g = account->group;
+
+    account->gpuBytes += gpuBytes;
+    account->hostBytes += hostBytes;
+    if (account->gpuBytes > account->peakGpuBytes) {
+        account->peakGpuBytes = account->gpuBytes;
+    }
+    g->gpuBytes += gpuBytes;
+    g->hostBytes += hostBytes;
+    if (g->gpuBytes > g->peakGpuBytes) {
+        g->peakGpuBytes = g->gpuBytes;
+    }
+}
+
+void GpuMemory::countEviction(GpuMemoryAccount *account, bool restore)
+{
+    android::Mutex::Autolock lock(s_lock);
+    if (restore) {
+        account->restores++;
+        account->group->restores++;
+    }
+    else {
+        account->evictions++;
+        account->group->evictions++;
+    }
+}
+
+long long GpuMemory::getGroupGpuBytes(const void *group)
+{
+    android::Mutex::Autolock lock(s_lock);
+    for (GpuMemoryGroupList::iterator it = s_groups.begin();
+         it != s_groups.end(); it++) {
+        if ((*it)->key == group) {
+            return (*it)->gpuBytes;
+        }
+    }
+    return 0;
+}
+
+long long GpuMemory::getBudget()
+{
+    if (s_budget < 0) {
+        const char *budget = getenv("ANDROID_RENDER_GPU_BUDGET_MB");
+        s_budget = (budget && atoi(budget) > 0) ?
+                   atoi(budget) * 1024LL * 1024LL : 0;
+    }
+    return s_budget;
+}
+
+void GpuMemory::dump(FILE *fp)
+{
+    android::Mutex::Autolock lock(s_lock);
+    if (s_groups.empty()) {
+        return;
+    }
+
+    fprintf(fp, "GpuMemory: budget %lld KB\n", getBudget() / 1024);
+    fprintf(fp, "    %-18s %8s %12s %12s %12s %10s %10s\n", "group",
+            "accounts", "gpu KB", "peak KB", "evicted KB", "evictions",
+            "restores");
+    for (GpuMemoryGroupList::iterator it = s_groups.begin();
+         it != s_groups.end(); it++) {
+        const GpuMemoryGroup *g = *it;
+        fprintf(fp, "    %-18p %8d %12lld %12lld %12lld %10llu %10llu\n",
+                g->key, g->accounts, g->gpuBytes / 1024,
+                g->peakGpuBytes / 1024, g->hostBytes / 1024,
+                g->evictions, g->restores);
+    }
+
+    fprintf(fp, "    %-18s %8s %12s %12s %12s %10s %10s\n", "group",
+            "account", "gpu bytes", "peak bytes", "evicted", "evictions",
+            "restores");
+    for (GpuMemoryAccountList::iterator it = s_accounts.begin();
+         it != s_accounts.end(); it++) {
+        const GpuMemoryAccount *a = *it;
+        fprintf(fp, "    %-18p %8u %12lld %12lld %12lld %10llu %10llu\n",
+                a->group->key, a->id, a->gpuBytes, a->peakGpuBytes,
+                a->hostBytes, a->evictions, a->restores);
+    }
+    fflush(fp);
+}
@@ -0,0 +1,116 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _LIB_OPENGL_RENDER_GPU_MEMORY_H
+#define _LIB_OPENGL_RENDER_GPU_MEMORY_H
+
+#include <stdio.h>
+
+struct GpuMemoryAccount;
+
+//
+// GpuMemory - accounts the host GPU memory held by the objects of the
+//    renderer, per connection and per framebuffer. An object is charged
+//    to the account of the connection which created it, for as long as
+//    it lives, even after the connection is closed. Objects created
+//    outside of a connection, such as the ones restored from a snapshot,
+//    are charged to the account of their framebuffer itself.
+//
+//    The sizes are the ones the renderer allocates from the driver: the
+//    color buffer textures, and the pbuffers and depth and stencil
+//    buffers of the window surfaces. The objects the guest creates
+//    through the GL translators are not seen.
+//
+//    With ANDROID_RENDER_GPU_BUDGET_MB set, a framebuffer going over that
+//    budget evicts its least recently used color buffers, see
+//    FrameBuffer::evictColorBuffers_locked. They are kept compressed in
+//    host memory, which is accounted as well, until they are used again.
+//
+class GpuMemory
+{
+public:
+    //
+    // addAccount - a new account of 'group', the FrameBuffer the objects
+    //     belong to. acquire and release count the references to an
+    //     account, addAccount returns the first one. The account is freed
+    //     with its last reference.
+    //
+    static GpuMemoryAccount *addAccount(const void *group);
+    static void acquire(GpuMemoryAccount *account);
+    static void release(GpuMemoryAccount *account);
+
+    //
+    // charge - adds the given byte counts, which may be negative, to the
+    //     account and its group. 'evictions' and 'restores' count the
+    //     color buffers moved out of and back to the GPU.
+    //
+    static void charge(GpuMemoryAccount *account,
+                       long long gpuBytes, long long hostBytes);
+    static void countEviction(GpuMemoryAccount *account, bool restore);
+
+    // getGroupGpuBytes - the GPU bytes charged to all the accounts of 'group'
+    static long long getGroupGpuBytes(const void *group);
+
+    // getBudget - the GPU budget of a framebuffer in bytes, 0 if none
+    static long long getBudget();
+
+    // dump - prints the accounting of all the groups and their accounts
+    static void dump(FILE *fp);
+};
+
+//
+// GpuMemoryUsage - the memory charged for one object, released when the
+//     object is destroyed.
+//
+class GpuMemoryUsage
+{
+public:
+    GpuMemoryUsage() : m_account(NULL), m_gpuBytes(0), m_hostBytes(0) {}
+    ~GpuMemoryUsage() {
+        set(0, 0);
+        if (m_account) {
+            GpuMemory::release(m_account);
+        }
+    }
+
+    // init - the object is charged to 'p_account' from now on
+    void init(GpuMemoryAccount *p_account) {
+        GpuMemory::acquire(p_account);
+        m_account = p_account;
+    }
+
+    void set(long long p_gpuBytes, long long p_hostBytes) {
+        if (m_account) {
+            GpuMemory::charge(m_account, p_gpuBytes - m_gpuBytes,
+                              p_hostBytes - m_hostBytes);
+        }
+        m_gpuBytes = p_gpuBytes;
+        m_hostBytes = p_hostBytes;
+    }
+
+    GpuMemoryAccount *getAccount() const { return m_account; }
+    long long getGpuBytes() const { return m_gpuBytes; }
+
+private:
+    GpuMemoryUsage(const GpuMemoryUsage &);
+    GpuMemoryUsage &operator=(const GpuMemoryUsage &);
+
+private:
+    GpuMemoryAccount *m_account;
+    long long m_gpuBytes;
+    long long m_hostBytes;
+};
+
+#endif
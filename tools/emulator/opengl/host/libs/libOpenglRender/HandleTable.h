@@ -0,0 +1,236 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _LIBRENDER_HANDLE_TABLE_H
+#define _LIBRENDER_HANDLE_TABLE_H
+
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+#include <stdint.h>
+
+typedef uint32_t HandleType;
+
+//
+// HandleTable - maps handles to objects through a dense array of slots.
+//    A handle holds the slot index (plus one, so that 0 is never a valid
+//    handle) in its low bits, the slot generation above it and 'TYPE' in
+//    its top bits, so tables of different types never hand out the same
+//    handle. The generation is bumped each time a slot is released, so a
+//    stale handle to a reused slot is detected. Lookups are O(1).
+//
+//    Ranges of fresh slots can be reserved for a client which picks the
+//    handles of its objects itself (see reserve).
+//
+//    The table is not thread safe, and pointers returned by get() are
+//    only valid until the next add().
+//
+template <class T, uint32_t TYPE = 0>
+class HandleTable
+{
+public:
+    enum {
+        INDEX_BITS = 20,
+        INDEX_MASK = (1 << INDEX_BITS) - 1,
+        TYPE_BITS  = 2,
+        GEN_MASK   = (1 << (32 - TYPE_BITS - INDEX_BITS)) - 1
+    };
+
+    HandleTable() : m_reserved(0) {}
+
+    //
+    // add - store 'obj' in a free slot, returns its handle or 0 if the
+    //     table is full.
+    //
+    HandleType add(const T &obj) {
+        uint32_t index;
+        if (!m_free.empty()) {
+            index = m_free.back();
+            m_free.pop_back();
+        }
+        else {
+            if (m_slots.size() >= INDEX_MASK) {
+                return 0;
+            }
+            index = m_slots.size();
+            m_slots.push_back(Slot());
+        }
+
+        Slot &slot = m_slots[index];
+        slot.obj = obj;
+        slot.used = true;
+        return makeHandle(slot.gen, index);
+    }
+
+    //
+    // reserve - sets aside 'count' fresh slots, their handles are the
+    //     returned one and the 'count' - 1 following ones. Returns 0 if
+    //     the table cannot grow that much.
+    //
+    HandleType reserve(uint32_t count) {
+        if (count == 0 || count > INDEX_MASK - m_slots.size()) {
+            return 0;
+        }
+        HandleType first = makeHandle(0, m_slots.size());
+        m_slots.resize(m_slots.size() + count, Slot(true));
+        m_reserved += count;
+        return first;
+    }
+
+    //
+    // addReserved - store 'obj' under the reserved 'handle', returns false
+    //     if it is not a reserved handle or was used already.
+    //
+    bool addReserved(HandleType handle, const T &obj) {
+        if (!isPending(handle)) {
+            return false;
+        }
+        Slot &slot = m_slots[(handle & INDEX_MASK) - 1];
+        slot.reserved = false;
+        m_reserved--;
+        slot.obj = obj;
+        slot.used = true;
+        return true;
+    }
+
+    //
+    // isPending - returns true if 'handle' is reserved and not used yet
+    //
+    bool isPending(HandleType handle) const {
+        uint32_t index = handle & INDEX_MASK;
+        return index != 0 && index <= m_slots.size() &&
+               handle == makeHandle(0, index - 1) &&
+               m_slots[index - 1].reserved;
+    }
+
+    //
+    // unreserve - gives back the slots of the 'count' handles from 'first'
+    //     which were reserved and not used, the handles stop being valid.
+    //
+    void unreserve(HandleType first, uint32_t count) {
+        for (uint32_t i = 0; i < count; i++) {
+            if (isPending(first + i)) {
+                uint32_t index = ((first + i) & INDEX_MASK) - 1;
+                m_slots[index].reserved = false;
+                m_slots[index].gen = 1;
+                m_reserved--;
+                m_free.push_back(index);
+            }
+        }
+    }
+
+    //
+    // get - returns a pointer to the object of 'handle', or NULL if the
+    //     handle is not (or no longer) valid.
+    //
+    T *get(HandleType handle) {
+        Slot *slot = lookup(handle);
+        return slot ? &slot->obj : NULL;
+    }
+
+    //
+    // remove - releases the object of 'handle', returns false if the
+    //     handle is not valid.
+    //
+    bool remove(HandleType handle) {
+        Slot *slot = lookup(handle);
+        if (!slot) {
+            return false;
+        }
+        slot->obj = T();
+        slot->used = false;
+        slot->gen = (slot->gen + 1) & GEN_MASK;
+        m_free.push_back((handle & INDEX_MASK) - 1);
+        return true;
+    }
+
+    //
+    // insert - store 'obj' under 'handle', as it was handed out by add()
+    //     before, when restoring a snapshot. Returns false if the slot of
+    //     the handle is already used.
+    //
+    bool insert(HandleType handle, const T &obj) {
+        uint32_t index = handle & INDEX_MASK;
+        if (index == 0 || typeOf(handle) != TYPE) {
+            return false;
+        }
+        while (m_slots.size() < index) {
+            m_free.push_back(m_slots.size());
+            m_slots.push_back(Slot());
+        }
+
+        Slot &slot = m_slots[index - 1];
+        if (slot.used || slot.reserved) {
+            return false;
+        }
+        m_free.erase(std::find(m_free.begin(), m_free.end(), index - 1));
+        slot.obj = obj;
+        slot.gen = genOf(handle);
+        slot.used = true;
+        return true;
+    }
+
+    //
+    // getHandles - appends the handles of all the objects to 'handles'.
+    //
+    void getHandles(std::vector<HandleType> &handles) const {
+        for (uint32_t i = 0; i < m_slots.size(); i++) {
+            if (m_slots[i].used) {
+                handles.push_back(makeHandle(m_slots[i].gen, i));
+            }
+        }
+    }
+
+    bool empty() const { return m_free.size() + m_reserved == m_slots.size(); }
+
+private:
+    struct Slot {
+        explicit Slot(bool p_reserved = false) :
+            gen(0), used(false), reserved(p_reserved) {}
+        T obj;
+        uint32_t gen;
+        bool used;
+        bool reserved;  // by reserve, not used yet
+    };
+
+    static HandleType makeHandle(uint32_t gen, uint32_t index) {
+        return (TYPE << (32 - TYPE_BITS)) | (gen << INDEX_BITS) | (index + 1);
+    }
+    static uint32_t genOf(HandleType handle) {
+        return (handle >> INDEX_BITS) & GEN_MASK;
+    }
+    static uint32_t typeOf(HandleType handle) {
+        return handle >> (32 - TYPE_BITS);
+    }
+
+    Slot *lookup(HandleType handle) {
+        uint32_t index = handle & INDEX_MASK;
+        if (index == 0 || index > m_slots.size() || typeOf(handle) != TYPE) {
+            return NULL;
+        }
+        Slot *slot = &m_slots[index - 1];
+        if (!slot->used || slot->gen != genOf(handle)) {
+            return NULL;
+        }
+        return slot;
+    }
+
+private:
+    std::vector<Slot> m_slots;
+    std::vector<uint32_t> m_free;
+    uint32_t m_reserved;
+};
+
+#endif
@@ -0,0 +1,89 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _LIBRENDER_PROC_TABLE_H
+#define _LIBRENDER_PROC_TABLE_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+//
+// ProcTable - the entry points of a GLES library, by name. The dispatch
+//    initialization fills it, then every render thread initializing its
+//    decoders finds the several hundred entry points there instead of
+//    looking each of them up in the library again.
+//
+//    add() must only be called before the render threads are started,
+//    the table is read only afterwards so find() needs no lock.
+//
+class ProcTable
+{
+public:
+    ProcTable() : m_count(0) { memset(m_slots, 0, sizeof(m_slots)); }
+
+    // add - records the entry point 'proc' of 'name', which may be NULL
+    //     for an entry point the library does not have
+    void add(const char *name, void *proc)
+    {
+        if (m_count >= SLOTS / 2) return;   // keep the probe chains short
+
+        uint32_t i = hash(name);
+        while (m_slots[i].name != NULL) {
+            if (!strcmp(m_slots[i].name, name)) return;
+            i = (i + 1) & (SLOTS - 1);
+        }
+        m_slots[i].name = strdup(name);
+        m_slots[i].proc = proc;
+        m_count++;
+    }
+
+    // find - returns true and the entry point of 'name' in 'proc' if it
+    //     was added
+    bool find(const char *name, void **proc) const
+    {
+        uint32_t i = hash(name);
+        while (m_slots[i].name != NULL) {
+            if (!strcmp(m_slots[i].name, name)) {
+                *proc = m_slots[i].proc;
+                return true;
+            }
+            i = (i + 1) & (SLOTS - 1);
+        }
+        return false;
+    }
+
+private:
+    enum { SLOTS = 1024 };
+
+    struct Slot {
+        char *name;
+        void *proc;
+    };
+
+    static uint32_t hash(const char *name)
+    {
+        uint32_t h = 2166136261U;
+        for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+            h = (h ^ *p) * 16777619U;
+        }
+        return h & (SLOTS - 1);
+    }
+
+    Slot m_slots[SLOTS];
+    int m_count;
+};
+
+#endif
@@ -14,41 +14,484 @@
 * limitations under the License.
 */
 #include "ReadBuffer.h"
+#include "TimeUtils.h"
 #include <string.h>
 #include <assert.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include "osThread.h"
+
+//
+// ReadAheadThread - the helper thread of a ReadBuffer with read-ahead
+//
+class ReadAheadThread : public osUtils::Thread
+{
+public:
+    explicit ReadAheadThread(ReadBuffer *buf) : m_buf(buf) {}
+
+    virtual int Main()
+    {
+        m_buf->readAheadMain();
+        return 0;
+    }
+
+private:
+    ReadBuffer *m_buf;
+};
+#endif
+
 ReadBuffer::ReadBuffer(IOStream *stream, size_t bufsize)
 {
     m_size = bufsize;
     m_stream = stream;
-    m_buf = new unsigned char[m_size];
+    m_buf = NULL;
+    m_mirrored = false;
+    m_minSize = bufsize;
+    m_maxSize = 0;
+    m_shrinkMS = 0;
+    m_peakUse = 0;
+    m_shrinkCheckMS = 0;
+#ifdef _WIN32
+    m_mapping = NULL;
+#else
+    m_readAhead = NULL;
+    m_filled = m_drained = m_seen = 0;
+    m_eof = m_stop = false;
+#endif
+
+    if (allocMirrored()) {
+        m_mirrored = true;
+    }
+    else {
+        m_size = bufsize;
+        m_buf = new unsigned char[m_size];
+    }
     m_validData = 0;
     m_readPtr = m_buf;
 }
 
 ReadBuffer::~ReadBuffer()
 {
-    delete m_buf;
+#ifndef _WIN32
+    if (m_readAhead) {
+        pthread_mutex_lock(&m_lock);
+        m_stop = true;
+        bool eof = m_eof;
+        pthread_cond_signal(&m_spaceCond);
+        pthread_mutex_unlock(&m_lock);
+
+        // the helper may be blocked in a read
+        if (!eof) {
+            m_stream->interrupt();
+        }
+        m_readAhead->wait(NULL);
+        delete m_readAhead;
+
+        pthread_cond_destroy(&m_spaceCond);
+        pthread_cond_destroy(&m_dataCond);
+        pthread_mutex_destroy(&m_lock);
+    }
+#endif
+
+    if (m_mirrored) {
+        freeMirrored();
+    }
+    else {
+        delete [] m_buf;
+    }
 }
 
 int ReadBuffer::getData()
 {
-    if (m_validData > 0) {
-        memcpy(m_buf, m_readPtr, m_validData);
+    unsigned char *writePtr;
+
+#ifndef _WIN32
+    if (m_readAhead) {
+        return getReadAheadData();
     }
-    m_readPtr = m_buf;
+#endif
+
+    if (m_validData == 0) {
+        // nothing pending - restart at the beginning of the buffer
+        m_readPtr = m_buf;
+
+        if (m_maxSize > 0 &&
+            GetCurrentTimeMS() - m_shrinkCheckMS >= m_shrinkMS) {
+            if (m_peakUse <= m_size / 4 && m_size / 2 >= m_minSize) {
+                resize(m_size / 2);
+            }
+            m_peakUse = 0;
+            m_shrinkCheckMS = GetCurrentTimeMS();
+        }
+    }
+    else if (m_validData == m_size && m_size < m_maxSize) {
+        // a single packet fills the whole ring
+        resize(m_size * 2 < m_maxSize ? m_size * 2 : m_maxSize);
+    }
+
+    if (m_mirrored) {
+        //
+        // The second mapping mirrors the first one, so the free space
+        // following the valid data is always contiguous, even when it
+        // wraps around the end of the ring.
+        //
+        writePtr = m_readPtr + m_validData;
+    }
+    else {
+        //
+        // Linear buffer - compact only when there is no room left
+        // at the tail of the buffer.
+        //
+        if (m_readPtr + m_validData == m_buf + m_size) {
+            memmove(m_buf, m_readPtr, m_validData);
+            m_readPtr = m_buf;
+        }
+        writePtr = m_readPtr + m_validData;
+    }
+
     // get fresh data into the buffer;
-    size_t len = m_size - m_validData;
-    if (NULL != m_stream->read(m_buf + m_validData, &len)) {
+    size_t len = m_mirrored ? m_size - m_validData :
+                              (m_buf + m_size) - writePtr;
+    if (NULL != m_stream->read(writePtr, &len)) {
         m_validData += len;
+        if (m_validData > m_peakUse) {
+            m_peakUse = m_validData;
+        }
         return len;
     }
     return -1;
 }
 
+void ReadBuffer::setAdaptive(size_t maxSize, int shrinkMS)
+{
+    m_maxSize = maxSize > m_size ? maxSize : 0;
+    m_shrinkMS = shrinkMS;
+    m_peakUse = 0;
+    m_shrinkCheckMS = GetCurrentTimeMS();
+}
+
+bool ReadBuffer::reserve(size_t len)
+{
+    if (len <= m_size) {
+        return true;
+    }
+    if (len > m_maxSize) {
+        return false;
+    }
+
+    size_t newSize = m_size;
+    while (newSize < len) {
+        newSize *= 2;
+    }
+    return resize(newSize < m_maxSize ? newSize : m_maxSize);
+}
+
+//
+// resize - moves the pending data to a new ring of 'newSize' bytes, which
+//     must be able to hold it. Not possible once read-ahead is running.
+//
+bool ReadBuffer::resize(size_t newSize)
+{
+#ifndef _WIN32
+    if (m_readAhead) {
+        return false;
+    }
+#endif
+    if (newSize < m_validData) {
+        return false;
+    }
+
+    unsigned char *oldBuf = m_buf;
+    size_t oldSize = m_size;
+#ifdef _WIN32
+    void *oldMapping = m_mapping;
+#endif
+
+    if (m_mirrored) {
+        m_size = newSize;
+        if (!allocMirrored()) {
+            m_buf = oldBuf;
+            m_size = oldSize;
+            return false;
+        }
+    }
+    else {
+        m_buf = new unsigned char[newSize];
+        m_size = newSize;
+    }
+
+    // the pending data is contiguous in both kinds of buffers
+    memcpy(m_buf, m_readPtr, m_validData);
+    m_readPtr = m_buf;
+
+    if (m_mirrored) {
+        unsigned char *newBuf = m_buf;
+        size_t size = m_size;
+        m_buf = oldBuf;
+        m_size = oldSize;
+#ifdef _WIN32
+        void *newMapping = m_mapping;
+        m_mapping = oldMapping;
+#endif
+        freeMirrored();
+        m_buf = newBuf;
+        m_size = size;
+#ifdef _WIN32
+        m_mapping = newMapping;
+#endif
+    }
+    else {
+        delete [] oldBuf;
+    }
+    return true;
+}
+
 void ReadBuffer::consume(size_t amount)
 {
     assert(amount <= m_validData);
     m_validData -= amount;
     m_readPtr += amount;
+    if (m_mirrored && m_readPtr >= m_buf + m_size) {
+        // moved into the mirror - continue reading from the first mapping
+        m_readPtr -= m_size;
+    }
+
+#ifndef _WIN32
+    if (m_readAhead) {
+        // give the space back to the helper
+        pthread_mutex_lock(&m_lock);
+        bool wasFull = (m_filled - m_drained == m_size);
+        m_drained += amount;
+        if (wasFull) {
+            pthread_cond_signal(&m_spaceCond);
+        }
+        pthread_mutex_unlock(&m_lock);
+    }
+#endif
+}
+
+#ifdef _WIN32
+
+bool ReadBuffer::startReadAhead()
+{
+    return false;
+}
+
+#else
+
+bool ReadBuffer::startReadAhead()
+{
+    if (!m_mirrored || m_readAhead) {
+        return false;
+    }
+
+    // the helper owns the free space, the ring cannot move afterwards
+    if (m_maxSize > m_size) {
+        resize(m_maxSize);
+    }
+    m_maxSize = 0;
+
+    // the helper continues from where the data pending in the ring ends
+    m_filled = m_seen = (m_readPtr - m_buf) + m_validData;
+    m_drained = m_readPtr - m_buf;
+
+    pthread_mutex_init(&m_lock, NULL);
+    pthread_cond_init(&m_dataCond, NULL);
+    pthread_cond_init(&m_spaceCond, NULL);
+
+    m_readAhead = new ReadAheadThread(this);
+    m_readAhead->setName("RenderReadAhead");
+    if (!m_readAhead->start()) {
+        delete m_readAhead;
+        m_readAhead = NULL;
+        pthread_cond_destroy(&m_spaceCond);
+        pthread_cond_destroy(&m_dataCond);
+        pthread_mutex_destroy(&m_lock);
+        return false;
+    }
+    return true;
 }
+
+int ReadBuffer::getReadAheadData()
+{
+    pthread_mutex_lock(&m_lock);
+    while (m_filled == m_seen && !m_eof) {
+        if (m_validData == m_size) {
+            // the helper waits for space that will never be consumed
+            pthread_mutex_unlock(&m_lock);
+            fprintf(stderr, "ReadBuffer: packet larger than %u bytes\n",
+                    (unsigned int)m_size);
+            return -1;
+        }
+        pthread_cond_wait(&m_dataCond, &m_lock);
+    }
+    size_t len = (size_t)(m_filled - m_seen);
+    m_seen = m_filled;
+    pthread_mutex_unlock(&m_lock);
+
+    // data read before the end of the stream is still returned
+    if (len == 0) {
+        return -1;
+    }
+    m_validData += len;
+    return len;
+}
+
+void ReadBuffer::readAheadMain()
+{
+    pthread_mutex_lock(&m_lock);
+    while (!m_stop) {
+        size_t avail = m_size - (size_t)(m_filled - m_drained);
+        if (avail == 0) {
+            pthread_cond_wait(&m_spaceCond, &m_lock);
+            continue;
+        }
+
+        //
+        // the free space starts at the write offset and is contiguous
+        // thanks to the mirror, the owner never touches it.
+        //
+        unsigned char *writePtr = m_buf + (size_t)(m_filled % m_size);
+        pthread_mutex_unlock(&m_lock);
+
+        size_t len = avail;
+        bool ok = (NULL != m_stream->read(writePtr, &len));
+
+        pthread_mutex_lock(&m_lock);
+        if (!ok) {
+            m_eof = true;
+        }
+        else {
+            m_filled += len;
+        }
+        pthread_cond_signal(&m_dataCond);
+        if (!ok) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&m_lock);
+}
+
+#endif
+
+#ifdef _WIN32
+
+bool ReadBuffer::allocMirrored()
+{
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    size_t gran = si.dwAllocationGranularity;
+    size_t size = (m_size + gran - 1) & ~(gran - 1);
+
+    HANDLE mapping = CreateFileMapping(INVALID_HANDLE_VALUE, NULL,
+                                       PAGE_READWRITE, 0, (DWORD)size, NULL);
+    if (!mapping) {
+        return false;
+    }
+
+    //
+    // There is no way to atomically reserve an address range and map a
+    // section into it, so find a free range, release it and try to map
+    // both views there. Another thread may grab the range in between,
+    // in which case we simply retry.
+    //
+    for (int tries = 0; tries < 8; tries++) {
+        void *base = VirtualAlloc(NULL, 2 * size, MEM_RESERVE, PAGE_NOACCESS);
+        if (!base) {
+            break;
+        }
+        VirtualFree(base, 0, MEM_RELEASE);
+
+        void *lo = MapViewOfFileEx(mapping, FILE_MAP_ALL_ACCESS,
+                                   0, 0, size, base);
+        if (!lo) {
+            continue;
+        }
+        void *hi = MapViewOfFileEx(mapping, FILE_MAP_ALL_ACCESS,
+                                   0, 0, size, (char *)base + size);
+        if (!hi) {
+            UnmapViewOfFile(lo);
+            continue;
+        }
+
+        m_buf = (unsigned char *)lo;
+        m_size = size;
+        m_mapping = mapping;
+        return true;
+    }
+
+    CloseHandle(mapping);
+    return false;
+}
+
+void ReadBuffer::freeMirrored()
+{
+    UnmapViewOfFile(m_buf + m_size);
+    UnmapViewOfFile(m_buf);
+    CloseHandle((HANDLE)m_mapping);
+}
+
+#else
+
+bool ReadBuffer::allocMirrored()
+{
+    size_t page = getpagesize();
+    size_t size = (m_size + page - 1) & ~(page - 1);
+
+    //
+    // create an unlinked shared memory object to back both mappings
+    //
+    char name[64];
+    static int s_count = 0;
+    snprintf(name, sizeof(name), "/oglrender-rb-%d-%d",
+             (int)getpid(), __sync_fetch_and_add(&s_count, 1));
+
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    shm_unlink(name);
+
+    if (ftruncate(fd, size) < 0) {
+        close(fd);
+        return false;
+    }
+
+    // reserve twice the size then map the object over both halves
+    unsigned char *base = (unsigned char *)mmap(NULL, 2 * size, PROT_NONE,
+                                                MAP_PRIVATE | MAP_ANONYMOUS,
+                                                -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+
+    if (mmap(base, size, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap(base + size, size, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, 2 * size);
+        close(fd);
+        return false;
+    }
+
+    // the mappings keep the object alive
+    close(fd);
+
+    m_buf = base;
+    m_size = size;
+    return true;
+}
+
+void ReadBuffer::freeMirrored()
+{
+    munmap(m_buf, 2 * m_size);
+}
+
+#endif
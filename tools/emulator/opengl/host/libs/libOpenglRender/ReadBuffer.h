@@ -17,7 +17,26 @@
 #define _READ_BUFFER_H
 
 #include "IOStream.h"
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+class ReadAheadThread;
 
+//
+// ReadBuffer - a ring buffer of stream data waiting to be decoded.
+//    When possible the ring is backed by two adjacent virtual mappings of
+//    the same memory, so that data which wraps around the end of the ring
+//    is still contiguous when accessed through buf(). In that mode incoming
+//    data is never moved. If the double mapping cannot be created the
+//    buffer falls back to a linear buffer which is compacted only when
+//    no free space is left at its tail.
+//
+//    With read-ahead, a helper thread reads the stream directly into the
+//    free part of the ring while the owner decodes what it already has,
+//    so receiving and decoding overlap. The ring bounds the amount of
+//    data read ahead: the helper waits when it is full.
+//
 class ReadBuffer {
 public:
     ReadBuffer(IOStream *stream, size_t bufSize);
@@ -26,11 +45,67 @@ public:
     unsigned char *buf() { return m_readPtr; } // return the next read location
     size_t validData() { return m_validData; } // return the amount of valid data in readptr
     void consume(size_t amount); // notify that 'amount' data has been consumed;
+
+    //
+    // setAdaptive - lets the ring grow by doubling when it fills up, from
+    //     the size given to the constructor up to 'maxSize', and shrink by
+    //     half when less than a quarter of it was used during 'shrinkMS'
+    //     milliseconds. The shrink is checked when all data is consumed,
+    //     a connection idle in a read keeps its size until data comes.
+    // reserve - grows the ring so that it can hold a packet of 'len'
+    //     bytes, returns false if it is larger than the maximum size.
+    //
+    void setAdaptive(size_t maxSize, int shrinkMS);
+    bool reserve(size_t len);
+    size_t size() const { return m_size; }
+
+    //
+    // startReadAhead - moves the reads from the stream to a helper thread,
+    //     getData() then returns what the helper has received since the
+    //     previous call, waiting for it if there is nothing new. Needs the
+    //     double mapping and is not available on Windows; returns false if
+    //     the reads stay in getData(). The stream is interrupted when the
+    //     buffer is destroyed before the helper has seen its end.
+    //
+    bool startReadAhead();
+
+private:
+    bool allocMirrored();
+    void freeMirrored();
+    bool resize(size_t newSize);
+    int getReadAheadData();
+    void readAheadMain();
+    friend class ReadAheadThread;
+
 private:
     unsigned char *m_buf;
     unsigned char *m_readPtr;
     size_t m_size;
     size_t m_validData;
     IOStream *m_stream;
+    bool m_mirrored;
+    size_t m_minSize;
+    size_t m_maxSize;  // 0 for a fixed size
+    int m_shrinkMS;
+    size_t m_peakUse;
+    long long m_shrinkCheckMS;
+#ifdef _WIN32
+    void *m_mapping;
+#else
+    //
+    // read-ahead state, m_filled and m_drained count the bytes received
+    //     and consumed since the start, m_seen what getData() has already
+    //     added to m_validData. m_lock protects the shared fields.
+    //
+    ReadAheadThread *m_readAhead;
+    pthread_mutex_t m_lock;
+    pthread_cond_t m_dataCond;
+    pthread_cond_t m_spaceCond;
+    unsigned long long m_filled;
+    unsigned long long m_drained;
+    unsigned long long m_seen;
+    bool m_eof;
+    bool m_stop;
+#endif
 };
 #endif
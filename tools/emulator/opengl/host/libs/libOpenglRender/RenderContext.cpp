@@ -18,6 +18,7 @@
 #include "FrameBuffer.h"
 #include "EGLDispatch.h"
 #include "GLDispatch.h"
+#include "GL2Dispatch.h"
 
 RenderContext *RenderContext::create(int p_config,
                                      RenderContextPtr p_shareContext,
@@ -64,7 +65,9 @@ RenderContext *RenderContext::create(int p_config,
 RenderContext::RenderContext() :
     m_ctx(EGL_NO_CONTEXT),
     m_config(0),
-    m_isGL2(false)
+    m_isGL2(false),
+    m_defaultFramebuffer(0),
+    m_hasReleased(false)
 {
 }
 
@@ -74,3 +77,47 @@ RenderContext::~RenderContext()
         s_egl.eglDestroyContext(FrameBuffer::getFB()->getDisplay(), m_ctx);
     }
 }
+
+void RenderContext::releaseObjects(GLuint p_fbo, const GLuint *p_renderbuffers,
+                                   int p_count)
+{
+    android::Mutex::Autolock mutex(m_releasedLock);
+    if (p_fbo) {
+        m_releasedFramebuffers.push_back(p_fbo);
+    }
+    for (int i = 0; i < p_count; i++) {
+        if (p_renderbuffers[i]) {
+            m_releasedRenderbuffers.push_back(p_renderbuffers[i]);
+        }
+    }
+    m_hasReleased = true;
+}
+
+void RenderContext::deleteReleasedObjects()
+{
+    if (!m_hasReleased) {
+        return;
+    }
+
+    android::Mutex::Autolock mutex(m_releasedLock);
+    GLsizei nfbo = m_releasedFramebuffers.size();
+    GLsizei nrb = m_releasedRenderbuffers.size();
+    if (m_isGL2) {
+#ifdef WITH_GLES2
+        if (nfbo) s_gl2.glDeleteFramebuffers(nfbo, &m_releasedFramebuffers[0]);
+        if (nrb) s_gl2.glDeleteRenderbuffers(nrb, &m_releasedRenderbuffers[0]);
+#endif
+    }
+    else {
+        if (nfbo) s_gl.glDeleteFramebuffersOES(nfbo, &m_releasedFramebuffers[0]);
+        if (nrb) s_gl.glDeleteRenderbuffersOES(nrb, &m_releasedRenderbuffers[0]);
+    }
+    for (GLsizei i = 0; i < nfbo; i++) {
+        if (m_releasedFramebuffers[i] == m_defaultFramebuffer) {
+            m_defaultFramebuffer = 0;
+        }
+    }
+    m_releasedFramebuffers.clear();
+    m_releasedRenderbuffers.clear();
+    m_hasReleased = false;
+}
@@ -18,6 +18,9 @@
 
 #include "SmartPtr.h"
 #include <EGL/egl.h>
+#include <GLES/gl.h>
+#include <utils/threads.h>
+#include <vector>
 
 class RenderContext;
 typedef SmartPtr<RenderContext> RenderContextPtr;
@@ -33,6 +36,26 @@ public:
     EGLContext getEGLContext() const { return m_ctx; }
     bool isGL2() const { return m_isGL2; }
 
+    //
+    // the framebuffer object the guest framebuffer 0 stands for, the one
+    // of the window surface rendering into its color buffer image with
+    // this context, see WindowSurface::attachColorBufferImage.
+    //
+    GLuint getDefaultFramebuffer() const { return m_defaultFramebuffer; }
+    void setDefaultFramebuffer(GLuint p_fbo) { m_defaultFramebuffer = p_fbo; }
+
+    //
+    // releaseObjects - gives back a framebuffer object and renderbuffers
+    //     a window surface created in this context and no longer renders
+    //     into with it. Any thread may release them, they are deleted by
+    //     deleteReleasedObjects, or go away with the context.
+    //
+    void releaseObjects(GLuint p_fbo, const GLuint *p_renderbuffers,
+                        int p_count);
+
+    // called with the context current
+    void deleteReleasedObjects();
+
 private:
     RenderContext();
 
@@ -40,6 +63,11 @@ private:
     EGLContext m_ctx;
     int        m_config;
     bool       m_isGL2;
+    GLuint     m_defaultFramebuffer;
+    android::Mutex m_releasedLock;
+    std::vector<GLuint> m_releasedFramebuffers;
+    std::vector<GLuint> m_releasedRenderbuffers;
+    volatile bool m_hasReleased;  // read without the lock when binding
 };
 
 #endif
@@ -17,8 +17,12 @@
 #include "FrameBuffer.h"
 #include "FBConfig.h"
 #include "EGLDispatch.h"
+#include "ThreadInfo.h"
+#include "FrameTrace.h"
+#include "TimeUtils.h"
+#include <stdio.h>
 
-static const GLint rendererVersion = 1;
+static const GLint rendererVersion = 8;
 
 static GLint rcGetRendererVersion()
 {
@@ -101,13 +105,13 @@ static EGLint rcGetFBParam(EGLint param)
             ret = 72; // XXX: should be implemented
             break;
         case FB_FPS:
-            ret = 60;
+            ret = fb->getRefreshRate();
             break;
         case FB_MIN_SWAP_INTERVAL:
-            ret = 1; // XXX: should be implemented
+            ret = fb->getMinSwapInterval();
             break;
         case FB_MAX_SWAP_INTERVAL:
-            ret = 1; // XXX: should be implemented
+            ret = fb->getMaxSwapInterval();
             break;
         default:
             break;
@@ -179,6 +183,15 @@ static void rcDestroyColorBuffer(uint32_t colorbuffer)
     fb->DestroyColorBuffer( colorbuffer );
 }
 
+//
+// waitColorBuffer - a color buffer handle may come from another guest
+// process, whose rcCreateColorBufferAsync is not decoded yet.
+//
+static void waitColorBuffer(FrameBuffer *fb, uint32_t colorBuffer)
+{
+    fb->waitCreated(FrameBuffer::OBJECT_COLOR_BUFFER, colorBuffer);
+}
+
 static void rcSetWindowColorBuffer(uint32_t windowSurface,
                                    uint32_t colorBuffer)
 {
@@ -186,6 +199,7 @@ static void rcSetWindowColorBuffer(uint32_t windowSurface,
     if (!fb) {
         return;
     }
+    waitColorBuffer(fb, colorBuffer);
     fb->setWindowSurfaceColorBuffer(windowSurface, colorBuffer);
 }
 
@@ -208,13 +222,201 @@ static void rcFBPost(uint32_t colorBuffer)
     if (!fb) {
         return;
     }
+    waitColorBuffer(fb, colorBuffer);
+
+    if (!FrameTrace::enabled()) {
+        fb->post(colorBuffer);
+        return;
+    }
+
+    RenderThreadInfo *tInfo = getRenderThreadInfo();
+    uint32_t frameId = FrameTrace::newFrameId();
+    FrameTrace::record(frameId, tInfo->connId, FRAME_TRACE_RECEIVED,
+                       tInfo->lastReadUS);
+    FrameTrace::record(frameId, tInfo->connId, FRAME_TRACE_DECODED,
+                       GetCurrentTimeUS());
+    fb->post(colorBuffer, frameId);
+}
+
+static void rcFBPostWithDamage(uint32_t colorBuffer,
+                               uint32_t bufSize, uint32_t* rects)
+{
+    FrameBuffer *fb = FrameBuffer::getFB();
+    if (!fb) {
+        return;
+    }
+    waitColorBuffer(fb, colorBuffer);
+
+    // the bounding box of the rectangles, a bad list damages everything
+    FrameBufferRect damage;
+    FrameBufferRect *pDamage = NULL;
+    int count = 0;
+    if (bufSize % (RC_RECT_SIZE * sizeof(uint32_t)) == 0) {
+        count = bufSize / (RC_RECT_SIZE * sizeof(uint32_t));
+    }
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+    for (int i = 0; i < count; i++) {
+        int32_t *r = (int32_t *)rects + i * RC_RECT_SIZE;
+        if (r[2] <= 0 || r[3] <= 0) {
+            continue;
+        }
+        if (!pDamage || r[0] < x0) x0 = r[0];
+        if (!pDamage || r[1] < y0) y0 = r[1];
+        if (!pDamage || r[0] + r[2] > x1) x1 = r[0] + r[2];
+        if (!pDamage || r[1] + r[3] > y1) y1 = r[1] + r[3];
+        pDamage = &damage;
+    }
+    if (pDamage) {
+        damage.x = x0;
+        damage.y = y0;
+        damage.width = x1 - x0;
+        damage.height = y1 - y0;
+    }
+
+    if (!FrameTrace::enabled()) {
+        fb->post(colorBuffer, 0, pDamage);
+        return;
+    }
+
+    RenderThreadInfo *tInfo = getRenderThreadInfo();
+    uint32_t frameId = FrameTrace::newFrameId();
+    FrameTrace::record(frameId, tInfo->connId, FRAME_TRACE_RECEIVED,
+                       tInfo->lastReadUS);
+    FrameTrace::record(frameId, tInfo->connId, FRAME_TRACE_DECODED,
+                       GetCurrentTimeUS());
+    fb->post(colorBuffer, frameId, pDamage);
+}
+
+//
+// handles picked by the guest, so that it does not wait for the create
+// commands. The ranges are reserved per connection, which has to use its
+// handles in order.
+//
+static bool handleObjectType(uint32_t type, FrameBuffer::ObjectType *p_type)
+{
+    switch (type) {
+    case RC_HANDLE_COLOR_BUFFER:
+        *p_type = FrameBuffer::OBJECT_COLOR_BUFFER;
+        return true;
+    case RC_HANDLE_CONTEXT:
+        *p_type = FrameBuffer::OBJECT_RENDER_CONTEXT;
+        return true;
+    case RC_HANDLE_WINDOW_SURFACE:
+        *p_type = FrameBuffer::OBJECT_WINDOW_SURFACE;
+        return true;
+    }
+    return false;
+}
+
+static uint32_t rcReserveHandles(uint32_t type, uint32_t count)
+{
+    FrameBuffer *fb = FrameBuffer::getFB();
+    FrameBuffer::ObjectType objType;
+    if (!fb || !handleObjectType(type, &objType) ||
+        count == 0 || count > RC_MAX_RESERVED_HANDLES) {
+        return 0;
+    }
+
+    RenderThreadInfo::HandleRange &range =
+        getRenderThreadInfo()->reservedHandles[objType];
+    if (range.next != range.end) {
+        fb->releaseHandles(objType, range.next, range.end - range.next);
+    }
+    HandleType first = fb->reserveHandles(objType, count);
+    range.next = first;
+    range.end = first ? first + count : 0;
+    return first;
+}
+
+//
+// takeReservedHandle - checks that 'handle' is the next reserved handle of
+//     the connection for objects of 'type' and takes it
+//
+static bool takeReservedHandle(FrameBuffer::ObjectType type, uint32_t handle)
+{
+    RenderThreadInfo::HandleRange &range =
+        getRenderThreadInfo()->reservedHandles[type];
+    if (handle == 0 || handle != range.next || range.next == range.end) {
+        fprintf(stderr, "renderControl: handle 0x%x was not reserved\n", handle);
+        return false;
+    }
+    range.next++;
+    return true;
+}
+
+static void rcCreateContextAsync(uint32_t context, uint32_t config,
+                                 uint32_t share, uint32_t glVersion)
+{
+    FrameBuffer *fb = FrameBuffer::getFB();
+    if (!fb || !takeReservedHandle(FrameBuffer::OBJECT_RENDER_CONTEXT, context)) {
+        return;
+    }
+
+    if (!fb->createRenderContext(config, share, glVersion == 2, context)) {
+        fprintf(stderr, "rcCreateContextAsync: context 0x%x failed\n", context);
+        fb->releaseHandles(FrameBuffer::OBJECT_RENDER_CONTEXT, context, 1);
+    }
+}
+
+static void rcCreateWindowSurfaceAsync(uint32_t windowSurface, uint32_t config,
+                                       uint32_t width, uint32_t height)
+{
+    FrameBuffer *fb = FrameBuffer::getFB();
+    if (!fb || !takeReservedHandle(FrameBuffer::OBJECT_WINDOW_SURFACE, windowSurface)) {
+        return;
+    }
 
-    fb->post(colorBuffer);
+    if (!fb->createWindowSurface(config, width, height, windowSurface)) {
+        fprintf(stderr, "rcCreateWindowSurfaceAsync: surface 0x%x failed\n", windowSurface);
+        fb->releaseHandles(FrameBuffer::OBJECT_WINDOW_SURFACE, windowSurface, 1);
+    }
+}
+
+static void rcCreateColorBufferAsync(uint32_t colorBuffer, uint32_t width,
+                                     uint32_t height, GLenum internalFormat)
+{
+    FrameBuffer *fb = FrameBuffer::getFB();
+    if (!fb || !takeReservedHandle(FrameBuffer::OBJECT_COLOR_BUFFER, colorBuffer)) {
+        return;
+    }
+
+    if (!fb->createColorBuffer(width, height, internalFormat, colorBuffer)) {
+        fprintf(stderr, "rcCreateColorBufferAsync: color buffer 0x%x failed\n", colorBuffer);
+        fb->releaseHandles(FrameBuffer::OBJECT_COLOR_BUFFER, colorBuffer, 1);
+    }
+}
+
+void releaseReservedHandles()
+{
+    FrameBuffer *fb = FrameBuffer::getFB();
+    RenderThreadInfo *tInfo = getRenderThreadInfo();
+    for (int i = 0; i < 3; i++) {
+        RenderThreadInfo::HandleRange &range = tInfo->reservedHandles[i];
+        if (fb && range.next != range.end) {
+            fb->releaseHandles((FrameBuffer::ObjectType)i, range.next,
+                               range.end - range.next);
+        }
+        range.next = range.end = 0;
+    }
+}
+
+static GLint rcFrameCredit()
+{
+    FrameBuffer *fb = FrameBuffer::getFB();
+    if (fb) {
+        fb->waitPosted();
+    }
+    return 1;
 }
 
 static void rcFBSetSwapInterval(EGLint interval)
 {
-   // XXX: TBD - should be implemented
+    FrameBuffer *fb = FrameBuffer::getFB();
+    if (!fb) {
+        return;
+    }
+
+    fb->setSwapInterval(interval);
 }
 
 static void rcBindTexture(uint32_t colorBuffer)
@@ -225,8 +427,13 @@ static void rcBindTexture(uint32_t colorBuffer)
 static EGLint rcColorBufferCacheFlush(uint32_t colorBuffer,
                                       EGLint postCount, int forRead)
 {
-   // XXX: TBD - should be implemented
-   return 0;
+    FrameBuffer *fb = FrameBuffer::getFB();
+    if (!fb) {
+        return -1;
+    }
+    waitColorBuffer(fb, colorBuffer);
+
+    return fb->colorBufferCacheFlush(colorBuffer, forRead != 0);
 }
 
 static void rcReadColorBuffer(uint32_t colorBuffer,
@@ -234,7 +441,40 @@ static void rcReadColorBuffer(uint32_t colorBuffer,
                               GLint width, GLint height,
                               GLenum format, GLenum type, void* pixels)
 {
-   // XXX: TBD - should be implemented
+    FrameBuffer *fb = FrameBuffer::getFB();
+    if (!fb) {
+        return;
+    }
+    waitColorBuffer(fb, colorBuffer);
+
+    fb->readColorBuffer(colorBuffer, x, y, width, height,
+                        format, type, pixels);
+}
+
+static void rcStartReadColorBuffer(uint32_t colorBuffer,
+                                   GLint x, GLint y,
+                                   GLint width, GLint height,
+                                   GLenum format, GLenum type)
+{
+    FrameBuffer *fb = FrameBuffer::getFB();
+    if (!fb) {
+        return;
+    }
+    waitColorBuffer(fb, colorBuffer);
+
+    fb->startReadColorBuffer(colorBuffer, x, y, width, height,
+                             format, type);
+}
+
+static GLint rcFinishReadColorBuffer(uint32_t colorBuffer, GLint wait,
+                                     GLuint datalen, void* pixels)
+{
+    FrameBuffer *fb = FrameBuffer::getFB();
+    if (!fb) {
+        return -1;
+    }
+
+    return fb->finishReadColorBuffer(colorBuffer, wait != 0, pixels, datalen);
 }
 
 static void rcUpdateColorBuffer(uint32_t colorBuffer,
@@ -242,7 +482,92 @@ static void rcUpdateColorBuffer(uint32_t colorBuffer,
                                 GLint width, GLint height,
                                 GLenum format, GLenum type, void* pixels)
 {
-   // XXX: TBD - should be implemented
+    FrameBuffer *fb = FrameBuffer::getFB();
+    if (!fb) {
+        return;
+    }
+    waitColorBuffer(fb, colorBuffer);
+
+    fb->updateColorBuffer(colorBuffer, x, y, width, height,
+                          format, type, pixels);
+}
+
+static EGLint rcCommitFrame(uint32_t bufSize, uint32_t* ops)
+{
+    if (bufSize % (RC_FRAME_OP_SIZE * sizeof(uint32_t)) != 0) {
+        return -1;
+    }
+
+    //
+    // execute the operations in order, stop at the first failure.
+    // returns the number of completed operations.
+    //
+    EGLint numOps = bufSize / (RC_FRAME_OP_SIZE * sizeof(uint32_t));
+    EGLint n;
+    for (n = 0; n < numOps; n++) {
+        uint32_t *op = ops + n * RC_FRAME_OP_SIZE;
+        switch(op[0]) {
+        case RC_FRAME_OP_MAKE_CURRENT:
+            if (rcMakeCurrent(op[1], op[2], op[3]) != EGL_TRUE) {
+                return n;
+            }
+            break;
+        case RC_FRAME_OP_SET_WINDOW_COLOR_BUFFER:
+            rcSetWindowColorBuffer(op[1], op[2]);
+            break;
+        case RC_FRAME_OP_CACHE_FLUSH:
+            if (rcColorBufferCacheFlush(op[1], (EGLint)op[2], (int)op[3]) < 0) {
+                return n;
+            }
+            break;
+        case RC_FRAME_OP_FB_POST:
+            rcFBPost(op[1]);
+            break;
+        default:
+            // unknown operation
+            return n;
+        }
+    }
+
+    return n;
+}
+
+static void rcComposeLayers(uint32_t bufSize, uint32_t* layers)
+{
+    FrameBuffer *fb = FrameBuffer::getFB();
+    if (!fb || bufSize % (RC_LAYER_SIZE * sizeof(uint32_t)) != 0) {
+        return;
+    }
+
+    int count = bufSize / (RC_LAYER_SIZE * sizeof(uint32_t));
+    if (count <= 0 || count > RC_MAX_LAYERS) {
+        return;
+    }
+
+    FrameBufferLayer fbLayers[RC_MAX_LAYERS];
+    for (int i = 0; i < count; i++) {
+        uint32_t *l = layers + i * RC_LAYER_SIZE;
+        fbLayers[i].colorBuffer = l[0];
+        fbLayers[i].x = (int32_t)l[1];
+        fbLayers[i].y = (int32_t)l[2];
+        fbLayers[i].width = (int32_t)l[3];
+        fbLayers[i].height = (int32_t)l[4];
+        fbLayers[i].alpha = (int32_t)l[5];
+        fbLayers[i].blend = (l[6] & RC_LAYER_FLAG_BLEND) != 0;
+    }
+
+    if (!FrameTrace::enabled()) {
+        fb->composeLayers(fbLayers, count);
+        return;
+    }
+
+    RenderThreadInfo *tInfo = getRenderThreadInfo();
+    uint32_t frameId = FrameTrace::newFrameId();
+    FrameTrace::record(frameId, tInfo->connId, FRAME_TRACE_RECEIVED,
+                       tInfo->lastReadUS);
+    FrameTrace::record(frameId, tInfo->connId, FRAME_TRACE_DECODED,
+                       GetCurrentTimeUS());
+    fb->composeLayers(fbLayers, count, frameId);
 }
 
 void initRenderControlContext(renderControl_decoder_context_t *dec)
@@ -267,4 +592,14 @@ void initRenderControlContext(renderControl_decoder_context_t *dec)
     dec->set_rcColorBufferCacheFlush(rcColorBufferCacheFlush);
     dec->set_rcReadColorBuffer(rcReadColorBuffer);
     dec->set_rcUpdateColorBuffer(rcUpdateColorBuffer);
+    dec->set_rcCommitFrame(rcCommitFrame);
+    dec->set_rcComposeLayers(rcComposeLayers);
+    dec->set_rcStartReadColorBuffer(rcStartReadColorBuffer);
+    dec->set_rcFinishReadColorBuffer(rcFinishReadColorBuffer);
+    dec->set_rcFBPostWithDamage(rcFBPostWithDamage);
+    dec->set_rcFrameCredit(rcFrameCredit);
+    dec->set_rcReserveHandles(rcReserveHandles);
+    dec->set_rcCreateContextAsync(rcCreateContextAsync);
+    dec->set_rcCreateWindowSurfaceAsync(rcCreateWindowSurfaceAsync);
+    dec->set_rcCreateColorBufferAsync(rcCreateColorBufferAsync);
 }
@@ -18,4 +18,8 @@
 
 void initRenderControlContext(renderControl_decoder_context_t *dec);
 
+// releaseReservedHandles - gives back the handles the connection of the
+//     thread reserved and did not use, when it ends
+void releaseReservedHandles();
+
 #endif
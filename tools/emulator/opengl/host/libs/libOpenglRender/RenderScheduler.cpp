@@ -0,0 +1,245 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "RenderScheduler.h"
+#include "TimeUtils.h"
+#include <utils/threads.h>
+#include <stdlib.h>
+#include <list>
+
+// how long a waiting batch sleeps before checking its share again
+#define SCHED_WAIT_NS   (10 * 1000000LL)
+
+//
+// a group still counts as busy that long after its last batch, the time
+// its connections take to receive the next one
+//
+#define SCHED_IDLE_US   (20 * 1000LL)
+
+struct RenderSchedGroup
+{
+    const void *key;
+    long long vtimeUS;      // accumulated cost of the batches
+    int busy;               // clients waiting for or decoding a batch
+    long long lastEndUS;    // when its last batch ended
+    int clients;
+    long long decodeUS;
+    long long waitUS;
+    unsigned long long batches;
+    unsigned long long waits;
+};
+
+struct RenderSchedClient
+{
+    RenderSchedGroup *group;
+    unsigned int id;
+    long long decodeUS;
+    long long waitUS;
+    unsigned long long batches;
+    unsigned long long waits;
+};
+
+typedef std::list<RenderSchedGroup *> RenderSchedGroupList;
+typedef std::list<RenderSchedClient *> RenderSchedClientList;
+
+//
+// s_lock protects all the state below, s_cond is signaled each time a
+// batch ends so that the waiting batches check their share again.
+//
+static android::Mutex s_lock;
+static android::Condition s_cond;
+static RenderSchedGroupList s_groups;
+static RenderSchedClientList s_clients;
+static unsigned int s_nextClientId = 1;
+static long long s_sliceUS = -1;   // 0 if fair scheduling is disabled
+
+static long long getSliceUS()
+{
+    if (s_sliceUS < 0) {
+        const char *slice = getenv("ANDROID_RENDER_FAIR_SLICE_MS");
+        s_sliceUS = (slice && atoi(slice) > 0) ? atoi(slice) * 1000LL : 0;
+    }
+    return s_sliceUS;
+}
+
+static bool isBusy(const RenderSchedGroup *g, long long now)
+{
+    return g->busy > 0 || now - g->lastEndUS < SCHED_IDLE_US;
+}
+
+//
+// minBusyVtime - the smallest virtual time of the busy groups other than
+//     'self', or -1 if there are none. Called with s_lock held.
+//
+static long long minBusyVtime(const RenderSchedGroup *self, long long now)
+{
+    long long vmin = -1;
+    for (RenderSchedGroupList::iterator it = s_groups.begin();
+         it != s_groups.end(); it++) {
+        const RenderSchedGroup *g = *it;
+        if (g != self && isBusy(g, now) && (vmin < 0 || g->vtimeUS < vmin)) {
+            vmin = g->vtimeUS;
+        }
+    }
+    return vmin;
+}
+
+RenderSchedClient *RenderScheduler::addClient(const void *group)
+{
+    android::Mutex::Autolock lock(s_lock);
+
+    RenderSchedGroup *g = NULL;
+    for (RenderSchedGroupList::iterator it = s_groups.begin();
+         it != s_groups.end(); it++) {
+        if ((*it)->key == group) {
+            g = *it;
+            break;
+        }
+    }
+    if (!g) {
+        g = new RenderSchedGroup();
+        g->key = group;
+        g->vtimeUS = 0;
+        g->busy = 0;
+        g->lastEndUS = 0;
+        g->clients = 0;
+        g->decodeUS = 0;
+        g->waitUS = 0;
+        g->batches = 0;
+        g->waits = 0;
+        s_groups.push_back(g);
+    }
+    g->clients++;
+
+    RenderSchedClient *c = new RenderSchedClient();
+    c->group = g;
+    c->id = s_nextClientId++;
+    c->decodeUS = 0;
+    c->waitUS = 0;
+    c->batches = 0;
+    c->waits = 0;
+    s_clients.push_back(c);
+    return c;
+}
+
+void RenderScheduler::removeClient(RenderSchedClient *client)
+{
+    if (!client) {
+        return;
+    }
+
+    android::Mutex::Autolock lock(s_lock);
+    s_clients.remove(client);
+
+    // the group goes with its last client, a new framebuffer may reuse
+    // the same address
+    RenderSchedGroup *g = client->group;
+    if (--g->clients == 0) {
+        s_groups.remove(g);
+        delete g;
+    }
+    delete client;
+    s_cond.broadcast();
+}
+
+void RenderScheduler::beginBatch(RenderSchedClient *client)
+{
+    android::Mutex::Autolock lock(s_lock);
+    RenderSchedGroup *g = client->group;
+    long long now = GetCurrentTimeUS();
+
+    // no credit is kept from the time the group was idle
+    if (!isBusy(g, now)) {
+        long long vmin = minBusyVtime(g, now);
+        if (vmin > g->vtimeUS) {
+            g->vtimeUS = vmin;
+        }
+    }
+    g->busy++;
+
+    long long sliceUS = getSliceUS();
+    if (sliceUS == 0) {
+        return;
+    }
+
+    long long t0 = 0;
+    while (true) {
+        long long vmin = minBusyVtime(g, now);
+        if (vmin < 0 || g->vtimeUS <= vmin + sliceUS) {
+            break;
+        }
+        if (!t0) {
+            t0 = now;
+            client->waits++;
+            g->waits++;
+        }
+        s_cond.waitRelative(s_lock, SCHED_WAIT_NS);
+        now = GetCurrentTimeUS();
+    }
+
+    if (t0) {
+        long long dt = now - t0;
+        client->waitUS += dt;
+        g->waitUS += dt;
+    }
+}
+
+void RenderScheduler::endBatch(RenderSchedClient *client, long long decodeUS)
+{
+    android::Mutex::Autolock lock(s_lock);
+    RenderSchedGroup *g = client->group;
+
+    g->busy--;
+    g->lastEndUS = GetCurrentTimeUS();
+    g->vtimeUS += decodeUS;
+    g->decodeUS += decodeUS;
+    g->batches++;
+    client->decodeUS += decodeUS;
+    client->batches++;
+
+    if (getSliceUS() > 0) {
+        s_cond.broadcast();
+    }
+}
+
+void RenderScheduler::dump(FILE *fp)
+{
+    android::Mutex::Autolock lock(s_lock);
+    if (s_groups.empty()) {
+        return;
+    }
+
+    fprintf(fp, "RenderScheduler: slice %lld ms\n", getSliceUS() / 1000);
+    fprintf(fp, "    %-18s %7s %12s %12s %10s %12s %8s\n", "group", "clients",
+            "batches", "decode ms", "waits", "wait ms", "busy");
+    for (RenderSchedGroupList::iterator it = s_groups.begin();
+         it != s_groups.end(); it++) {
+        const RenderSchedGroup *g = *it;
+        fprintf(fp, "    %-18p %7d %12llu %12lld %10llu %12lld %8d\n",
+                g->key, g->clients, g->batches, g->decodeUS / 1000,
+                g->waits, g->waitUS / 1000, g->busy);
+    }
+
+    fprintf(fp, "    %-18s %7s %12s %12s %10s %12s\n", "group", "client",
+            "batches", "decode ms", "waits", "wait ms");
+    for (RenderSchedClientList::iterator it = s_clients.begin();
+         it != s_clients.end(); it++) {
+        const RenderSchedClient *c = *it;
+        fprintf(fp, "    %-18p %7u %12llu %12lld %10llu %12lld\n",
+                c->group->key, c->id, c->batches, c->decodeUS / 1000,
+                c->waits, c->waitUS / 1000);
+    }
+    fflush(fp);
+}
@@ -0,0 +1,64 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _LIB_OPENGL_RENDER_RENDER_SCHEDULER_H
+#define _LIB_OPENGL_RENDER_RENDER_SCHEDULER_H
+
+#include <stdio.h>
+
+struct RenderSchedClient;
+
+//
+// RenderScheduler - accounts the time each render connection spends
+//    decoding, per connection and per framebuffer, and can keep a
+//    framebuffer whose connections use more than their share from
+//    starting new batches.
+//
+//    The cost of a batch is the wall time of its decoding, which includes
+//    the GL driver time and the waits for the GPU of glFinish or read
+//    backs done while decoding it. Each framebuffer (each emulator of a
+//    multi-tenant renderer, see RenderTenant.h) accumulates the cost of
+//    its batches in a virtual time; a framebuffer which is idle when it
+//    gets work again starts from the virtual time of the busy ones.
+//
+//    With ANDROID_RENDER_FAIR_SLICE_MS set, a batch of a framebuffer
+//    whose virtual time is more than that slice ahead of the busiest
+//    framebuffer furthest behind waits until the others catch up, so that
+//    busy framebuffers get equal shares of decode time. Without it, the
+//    accounting is only reported by dump().
+//
+class RenderScheduler
+{
+public:
+    //
+    // addClient - registers a connection of 'group', usually the
+    //     FrameBuffer it renders for. The client is freed by removeClient.
+    //
+    static RenderSchedClient *addClient(const void *group);
+    static void removeClient(RenderSchedClient *client);
+
+    //
+    // beginBatch - called before decoding a batch of commands, waits if
+    //     the client's group is ahead of its share. endBatch gives the
+    //     time spent decoding the batch.
+    //
+    static void beginBatch(RenderSchedClient *client);
+    static void endBatch(RenderSchedClient *client, long long decodeUS);
+
+    // dump - prints the accounting of all the groups and their clients
+    static void dump(FILE *fp);
+};
+
+#endif
@@ -15,34 +15,163 @@
 */
 #include "RenderServer.h"
 #include "TcpStream.h"
+#include "UnixStream.h"
 #include "RenderThread.h"
+#include <stdlib.h>
+#include <errno.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <signal.h>
+#include <sys/select.h>
+#endif
+
+// how often the threads of closed connections are released while no new
+// connection comes in
+#define REAP_INTERVAL_MS 1000
+
+#ifndef _WIN32
+static void onStatsSignal(int sig)
+{
+    RenderThread::requestStatsDump();
+}
+#endif
 
 RenderServer::RenderServer() :
     m_listenSock(NULL),
-    m_exit(false)
+    m_exit(false),
+    m_multiTenant(false),
+    m_renderCpus(0)
 {
 }
 
-RenderServer *RenderServer::create(int port)
+//
+// parseCpuList - converts a list of CPU numbers and ranges, like "4-7,12",
+//     to a mask of CPUs. Returns 0 if the list is not valid.
+//
+unsigned long long RenderServer::parseCpuList(const char *list)
+{
+    unsigned long long mask = 0;
+    const char *p = list;
+    while (*p) {
+        char *end;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        if (end == p) {
+            return 0;
+        }
+        p = end;
+        if (*p == '-') {
+            last = strtol(++p, &end, 10);
+            if (end == p) {
+                return 0;
+            }
+            p = end;
+        }
+        if (first < 0 || last < first || last >= 64) {
+            return 0;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            mask |= 1ULL << cpu;
+        }
+        if (*p == ',') {
+            p++;
+        }
+        else if (*p) {
+            return 0;
+        }
+    }
+    return mask;
+}
+
+RenderServer *RenderServer::create(int port, bool multiTenant)
 {
     RenderServer *server = new RenderServer();
     if (!server) {
         return NULL;
     }
+    server->m_multiTenant = multiTenant;
 
-    server->m_listenSock = new TcpStream();
-    if (server->m_listenSock->listen(port) < 0) {
-        delete server;
-        return NULL;
+#ifndef _WIN32
+    if (getenv("ANDROID_RENDER_UNIX")) {
+        UnixStream *sock = new UnixStream();
+        server->m_listenSock = sock;
+        if (sock->listen(port) < 0) {
+            delete server;
+            return NULL;
+        }
+    }
+    else
+#endif
+    {
+        TcpStream *sock = new TcpStream();
+        server->m_listenSock = sock;
+        if (sock->listen(port) < 0) {
+            delete server;
+            return NULL;
+        }
+    }
+
+    //
+    // Render threads run at a higher priority than the emulator threads,
+    // and can be kept on the CPUs listed in ANDROID_RENDER_CPUS, away
+    // from the cores the vCPU threads are pinned to.
+    //
+    const char *cpus = getenv("ANDROID_RENDER_CPUS");
+    if (cpus) {
+        server->m_renderCpus = parseCpuList(cpus);
+        if (!server->m_renderCpus) {
+            fprintf(stderr, "Ignoring bad ANDROID_RENDER_CPUS '%s'\n", cpus);
+        }
     }
+    server->setName("RenderServer");
+    server->setAffinity(server->m_renderCpus);
+
+#ifndef _WIN32
+    // do not steal the signal if the hosting process already uses it
+    struct sigaction sa;
+    if (sigaction(SIGUSR1, NULL, &sa) == 0 && sa.sa_handler == SIG_DFL) {
+        signal(SIGUSR1, onStatsSignal);
+    }
+#endif
 
     return server;
 }
 
+//
+// waitConnection - returns true when a connection can be accepted, false
+//     if none came in within 'timeoutMS'. Errors are left to accept().
+//
+bool RenderServer::waitConnection(int timeoutMS)
+{
+    int sock = m_listenSock->getSocket();
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(sock, &fds);
+    struct timeval tv;
+    tv.tv_sec = timeoutMS / 1000;
+    tv.tv_usec = (timeoutMS % 1000) * 1000;
+
+    int n = select(sock + 1, &fds, NULL, NULL, &tv);
+#ifndef _WIN32
+    if (n < 0 && errno == EINTR) {
+        return false;
+    }
+#endif
+    return n != 0;
+}
+
 int RenderServer::Main()
 {
     while(!m_exit) {
-        TcpStream *stream = m_listenSock->accept();
+        // release the threads of connections which have been closed, an
+        // idle server does not keep them until the next connection
+        reapThreads();
+        if (!waitConnection(REAP_INTERVAL_MS)) {
+            continue;
+        }
+
+        SocketStream *stream = m_listenSock->accept();
         if (!stream) {
             fprintf(stderr,"Error accepting connection, aborting\n");
             break;
@@ -53,19 +182,48 @@ int RenderServer::Main()
             break;
         }
 
-        RenderThread *rt = RenderThread::create(stream);
+        RenderThread *rt = RenderThread::create(stream, m_multiTenant);
         if (!rt) {
             fprintf(stderr,"Failed to create RenderThread\n");
             delete stream;
+            continue;
         }
 
+        rt->setName("RenderThread");
+        rt->setPriority(osUtils::Thread::PRIORITY_HIGH);
+        rt->setAffinity(m_renderCpus);
+
         if (!rt->start()) {
             fprintf(stderr,"Failed to start RenderThread\n");
-            delete stream;
+            delete rt;  // deletes the stream as well
+            continue;
         }
 
-        printf("Started new RenderThread\n");
+        m_threads.push_back(rt);
+        printf("Started new RenderThread (%d running)\n", (int)m_threads.size());
     }
 
     return 0;
 }
+
+void RenderServer::reapThreads()
+{
+    RenderThreadsList::iterator it = m_threads.begin();
+    while (it != m_threads.end()) {
+        int status;
+        RenderThread *rt = *it;
+        if (rt->trywait(&status)) {
+            rt->wait(&status);
+            delete rt;
+            it = m_threads.erase(it);
+        }
+        else {
+            it++;
+        }
+    }
+}
+
+void RenderServer::dumpStats()
+{
+    RenderThread::requestStatsDump();
+}
@@ -16,23 +16,47 @@
 #ifndef _LIB_OPENGL_RENDER_RENDER_SERVER_H
 #define _LIB_OPENGL_RENDER_RENDER_SERVER_H
 
-#include "TcpStream.h"
+#include "SocketStream.h"
 #include "osThread.h"
+#include <list>
+
+class RenderThread;
 
 class RenderServer : public osUtils::Thread
 {
 public:
-    static RenderServer *create(int port);
+    //
+    // create - 'multiTenant' serves several emulators, each connection
+    //     names its tenant (see RenderTenant.h). The server listens to
+    //     the Unix domain socket of 'port' instead of the TCP port if
+    //     ANDROID_RENDER_UNIX is set (see UnixStream.h).
+    //
+    static RenderServer *create(int port, bool multiTenant = false);
     virtual int Main();
 
     void flagNeedExit() { m_exit = true; }
 
+    //
+    // dumpStats - print the decode statistics of all connections to
+    //     stderr. On POSIX hosts this can also be triggered by sending
+    //     SIGUSR1 to the renderer process.
+    //
+    void dumpStats();
+
 private:
     RenderServer();
+    void reapThreads();
+    bool waitConnection(int timeoutMS);
+    static unsigned long long parseCpuList(const char *list);
 
 private:
-    TcpStream *m_listenSock;
+    typedef std::list<RenderThread *> RenderThreadsList;
+
+    SocketStream *m_listenSock;
     bool m_exit;
+    bool m_multiTenant;
+    RenderThreadsList m_threads;
+    unsigned long long m_renderCpus;
 };
 
 #endif
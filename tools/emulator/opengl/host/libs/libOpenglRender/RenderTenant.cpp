@@ -0,0 +1,346 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "RenderTenant.h"
+#include "FrameBuffer.h"
+#include "ThreadInfo.h"
+#include <cutils/sockets.h>
+#include <utils/threads.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+
+#define RENDER_TENANT_MAGIC     0x544e4e54  // 'TNNT'
+#define RENDER_TENANT_VERSION   1
+
+#define RENDER_TENANT_ATTACH    1
+#define RENDER_TENANT_CONNECT   2
+
+//
+// Requests are made of RENDER_TENANT_REQ_WORDS 32-bit words:
+//     magic, version, op, then for an attach request the window, x, y,
+//     width and height, for a connect request the tenant id.
+// The reply is one word: the new tenant id or 1 on success, 0 otherwise.
+//
+#define RENDER_TENANT_REQ_WORDS 8
+
+//
+// The socket is used directly, not through the SocketStream read buffer,
+// which could swallow the data following the request.
+//
+static bool sendAll(int sock, const void *buf, size_t len)
+{
+    const char *p = (const char *)buf;
+    while (len > 0) {
+        int n = ::send(sock, p, len, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool recvAll(int sock, void *buf, size_t len)
+{
+    char *p = (char *)buf;
+    while (len > 0) {
+        int n = ::recv(sock, p, len, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+struct Tenant {
+    FrameBuffer *fb;
+    int refs;       // connections using the tenant
+    bool attached;  // the attach connection is still open
+    int display;    // index in s_displays, -1 for the default display
+};
+
+typedef std::map<uint32_t, Tenant> TenantMap;
+
+static android::Mutex s_lock;
+static TenantMap s_tenants;
+static uint32_t s_nextId = 1;
+
+//
+// The displays tenants are placed on, parsed once from
+// ANDROID_RENDER_DISPLAYS, and the number of tenants on each one.
+//
+#define RENDER_TENANT_MAX_DISPLAYS 8
+
+static struct {
+    char name[64];
+    int tenants;
+} s_displays[RENDER_TENANT_MAX_DISPLAYS];
+static int s_numDisplays = -1;
+static bool s_roundRobin = false;
+static int s_nextDisplay = 0;
+
+static void initDisplays()
+{
+    s_numDisplays = 0;
+    const char *list = getenv("ANDROID_RENDER_DISPLAYS");
+    while (list && *list && s_numDisplays < RENDER_TENANT_MAX_DISPLAYS) {
+        const char *end = strchr(list, ',');
+        size_t len = end ? (size_t)(end - list) : strlen(list);
+        if (len > 0 && len < sizeof(s_displays[0].name)) {
+            memcpy(s_displays[s_numDisplays].name, list, len);
+            s_displays[s_numDisplays].name[len] = '\0';
+            s_displays[s_numDisplays].tenants = 0;
+            s_numDisplays++;
+        }
+        list = end ? end + 1 : NULL;
+    }
+
+    const char *policy = getenv("ANDROID_RENDER_PLACEMENT");
+    s_roundRobin = policy && !strcmp(policy, "roundrobin");
+}
+
+//
+// placeTenant - picks the display of a new tenant and counts it there,
+//     -1 for the default display. Called with s_lock held.
+//
+static int placeTenant()
+{
+    if (s_numDisplays < 0) {
+        initDisplays();
+    }
+    if (s_numDisplays == 0) {
+        return -1;
+    }
+
+    int d = 0;
+    if (s_roundRobin) {
+        d = s_nextDisplay;
+        s_nextDisplay = (s_nextDisplay + 1) % s_numDisplays;
+    }
+    else {
+        for (int i=1; i<s_numDisplays; i++) {
+            if (s_displays[i].tenants < s_displays[d].tenants) {
+                d = i;
+            }
+        }
+    }
+    s_displays[d].tenants++;
+    return d;
+}
+
+static void unplaceTenant(int p_display)
+{
+    if (p_display >= 0) {
+        s_displays[p_display].tenants--;
+    }
+}
+
+uint32_t RenderTenant::attach(SocketStream *p_sock, FBNativeWindowType p_window,
+                              int p_x, int p_y, int p_width, int p_height)
+{
+    uint32_t req[RENDER_TENANT_REQ_WORDS] = { 0 };
+    req[0] = RENDER_TENANT_MAGIC;
+    req[1] = RENDER_TENANT_VERSION;
+    req[2] = RENDER_TENANT_ATTACH;
+    req[3] = (uint32_t)(uintptr_t)p_window;
+    req[4] = p_x;
+    req[5] = p_y;
+    req[6] = p_width;
+    req[7] = p_height;
+
+    uint32_t reply = 0;
+    int sock = p_sock->getSocket();
+    if (!sendAll(sock, req, sizeof(req)) ||
+        !recvAll(sock, &reply, sizeof(reply))) {
+        return 0;
+    }
+    return reply;
+}
+
+bool RenderTenant::connect(SocketStream *p_sock, uint32_t p_id)
+{
+    uint32_t req[RENDER_TENANT_REQ_WORDS] = { 0 };
+    req[0] = RENDER_TENANT_MAGIC;
+    req[1] = RENDER_TENANT_VERSION;
+    req[2] = RENDER_TENANT_CONNECT;
+    req[3] = p_id;
+
+    uint32_t reply = 0;
+    int sock = p_sock->getSocket();
+    return sendAll(sock, req, sizeof(req)) &&
+           recvAll(sock, &reply, sizeof(reply)) &&
+           reply == 1;
+}
+
+//
+// release - drops a reference to the tenant of 'p_fb', or its attachment
+//     if 'p_detach', and destroys its framebuffer when it is unused.
+//
+static void release(FrameBuffer *p_fb, bool p_detach)
+{
+    FrameBuffer *dead = NULL;
+    {
+        android::Mutex::Autolock lock(s_lock);
+        for (TenantMap::iterator it = s_tenants.begin();
+             it != s_tenants.end(); it++) {
+            Tenant &t = it->second;
+            if (t.fb != p_fb) {
+                continue;
+            }
+            if (p_detach) {
+                t.attached = false;
+            }
+            else {
+                t.refs--;
+            }
+            if (!t.attached && t.refs == 0) {
+                dead = t.fb;
+                unplaceTenant(t.display);
+                s_tenants.erase(it);
+            }
+            break;
+        }
+    }
+
+    if (dead) {
+        FrameBuffer::destroy(dead);
+    }
+}
+
+FrameBuffer *RenderTenant::accept(SocketStream *p_sock)
+{
+    int sock = p_sock->getSocket();
+    uint32_t req[RENDER_TENANT_REQ_WORDS];
+    if (!recvAll(sock, req, sizeof(req)) ||
+        req[0] != RENDER_TENANT_MAGIC || req[1] != RENDER_TENANT_VERSION) {
+        fprintf(stderr, "RenderTenant: bad tenant request\n");
+        return NULL;
+    }
+
+    if (req[2] == RENDER_TENANT_ATTACH) {
+        uint32_t id;
+        int display;
+        char displayName[64];
+        {
+            android::Mutex::Autolock lock(s_lock);
+            id = s_nextId++;
+            display = placeTenant();
+            if (display >= 0) {
+                strcpy(displayName, s_displays[display].name);
+            }
+        }
+
+        // offscreen tenants publish their frames under distinct names
+        char shmName[256];
+        const char *shm = getenv("ANDROID_FB_SHM");
+        if (shm && req[3] == 0) {
+            snprintf(shmName, sizeof(shmName), "%s-%u", shm, id);
+            shm = shmName;
+        }
+        else {
+            shm = NULL;
+        }
+
+        FrameBuffer *fb = FrameBuffer::create((FBNativeWindowType)(uintptr_t)req[3],
+                                              req[4], req[5], req[6], req[7],
+                                              shm,
+                                              display >= 0 ? displayName : NULL);
+        {
+            android::Mutex::Autolock lock(s_lock);
+            if (fb) {
+                Tenant &t = s_tenants[id];
+                t.fb = fb;
+                t.refs = 0;
+                t.attached = true;
+                t.display = display;
+            }
+            else {
+                unplaceTenant(display);
+            }
+        }
+        if (fb && display >= 0) {
+            fprintf(stderr, "RenderTenant: tenant %u on display %s\n",
+                    id, displayName);
+        }
+        else if (!fb) {
+            fprintf(stderr, "RenderTenant: failed to create a framebuffer"
+                            " for tenant %u\n", id);
+        }
+
+        uint32_t reply = fb ? id : 0;
+        if (!sendAll(sock, &reply, sizeof(reply)) && fb) {
+            release(fb, true);
+            return NULL;
+        }
+        if (!fb) {
+            return NULL;
+        }
+
+        // the tenant lives until the emulator closes the connection
+        char c;
+        while (recvAll(sock, &c, 1)) {
+        }
+        release(fb, true);
+        return NULL;
+    }
+
+    FrameBuffer *fb = NULL;
+    if (req[2] == RENDER_TENANT_CONNECT) {
+        android::Mutex::Autolock lock(s_lock);
+        TenantMap::iterator it = s_tenants.find(req[3]);
+        if (it != s_tenants.end() && it->second.attached) {
+            fb = it->second.fb;
+            it->second.refs++;
+        }
+    }
+
+    uint32_t reply = fb ? 1 : 0;
+    if (!sendAll(sock, &reply, sizeof(reply))) {
+        if (fb) {
+            release(fb, false);
+        }
+        return NULL;
+    }
+    if (fb) {
+        getRenderThreadInfo()->frameBuffer = fb;
+    }
+    return fb;
+}
+
+void RenderTenant::leave(FrameBuffer *p_fb)
+{
+    if (!p_fb) {
+        return;
+    }
+
+    // drop the thread references to the tenant objects
+    RenderThreadInfo *tInfo = getRenderThreadInfo();
+    p_fb->bindContext(0, 0, 0);
+    tInfo->frameBuffer = NULL;
+
+    release(p_fb, false);
+}
@@ -0,0 +1,82 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _LIB_OPENGL_RENDER_RENDER_TENANT_H
+#define _LIB_OPENGL_RENDER_RENDER_TENANT_H
+
+#include "libOpenglRender/render_api.h"
+#include "SocketStream.h"
+#include <stdint.h>
+
+class FrameBuffer;
+
+//
+// RenderTenant - lets a single renderer process serve several emulators.
+//    Each emulator is a tenant with its own FrameBuffer, thus its own
+//    window or offscreen target and its own namespace of contexts,
+//    surfaces and color buffers. The loaded GL libraries and the config
+//    list are shared by all the tenants.
+//
+//    A renderer started with -multi expects every connection to start
+//    with a tenant request, before the shared memory negotiation:
+//
+//    - attach: the emulator asks for a new tenant displayed in a window
+//      (0 for offscreen) and gets its id. The tenant lives as long as
+//      this connection stays open.
+//    - connect: a guest connection of the emulator names the tenant it
+//      renders for, then continues as a plain render connection.
+//
+//    New tenants are placed on the native displays listed, comma
+//    separated, in ANDROID_RENDER_DISPLAYS (e.g. ":0.0,:0.1" for two X
+//    screens driven by two GPUs), on the default display if it is not
+//    set. ANDROID_RENDER_PLACEMENT picks the policy: "leastloaded", the
+//    default, takes the display with the fewest tenants, "roundrobin"
+//    cycles through them.
+//
+class RenderTenant
+{
+public:
+    //
+    // attach - client side, asks for a tenant on 'p_sock', a fresh
+    //     connection to the renderer which must then be kept open.
+    //     Returns the tenant id, 0 if the renderer refused.
+    //
+    static uint32_t attach(SocketStream *p_sock, FBNativeWindowType p_window,
+                           int p_x, int p_y, int p_width, int p_height);
+
+    //
+    // connect - client side, binds the fresh connection 'p_sock' to the
+    //     tenant 'p_id'. Returns false if the tenant does not exist.
+    //
+    static bool connect(SocketStream *p_sock, uint32_t p_id);
+
+    //
+    // accept - server side, reads the request starting the connection
+    //     'p_sock'. For a connect request, returns the framebuffer of the
+    //     tenant, which becomes the one of the calling thread until leave()
+    //     is called. An attach request is served until the connection
+    //     closes and NULL is returned, as on errors.
+    //
+    static FrameBuffer *accept(SocketStream *p_sock);
+
+    //
+    // leave - releases the objects the calling thread has bound and its
+    //     reference to the tenant framebuffer 'p_fb'. The last thread to
+    //     leave a detached tenant destroys it.
+    //
+    static void leave(FrameBuffer *p_fb);
+};
+
+#endif
@@ -15,19 +15,138 @@
 */
 #include "RenderThread.h"
 #include "RenderControl.h"
+#include "RenderTenant.h"
+#include "RenderScheduler.h"
+#include "GpuMemory.h"
+#include "FrameBuffer.h"
 #include "ReadBuffer.h"
+#include "ShmStream.h"
 #include "TimeUtils.h"
+#include "ThreadInfo.h"
+#include "FrameTrace.h"
+#include "StreamCapture.h"
+#include "Instrument.h"
 #include "GLDispatch.h"
+#include "GL2Dispatch.h"
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
 
 #define STREAM_BUFFER_SIZE 4*1024*1024
 
+//
+// the receive buffer starts small and adapts to the traffic of the
+// connection, ANDROID_RENDER_BUFFER_MIN_KB, ANDROID_RENDER_BUFFER_MAX_KB
+// and ANDROID_RENDER_BUFFER_SHRINK_MS override the defaults.
+//
+#define READ_BUFFER_MIN_SIZE 64*1024
+#define READ_BUFFER_SHRINK_MS 5000
+
+static size_t envSize(const char *name, size_t defaultSize)
+{
+    const char *val = getenv(name);
+    int kb = val ? atoi(val) : 0;
+    return kb > 0 ? (size_t)kb * 1024 : defaultSize;
+}
+
+//
+// the guest framebuffer 0 is the framebuffer object of the window surface
+// rendering into its color buffer image with the current context, see
+// WindowSurface::attachColorBufferImage
+//
+static GLuint guestFramebuffer(GLuint p_framebuffer)
+{
+    if (p_framebuffer != 0) {
+        return p_framebuffer;
+    }
+    RenderContext *ctx = getRenderThreadInfo()->currContext.Ptr();
+    return ctx ? ctx->getDefaultFramebuffer() : 0;
+}
+
+//
+// and the other way around, the guest sees the window surface framebuffer
+// object bound as 0 (the OES enum has the same value as the GLES2 one)
+//
+static void guestFramebufferBinding(GLenum pname, GLint *params)
+{
+    if (pname != GL_FRAMEBUFFER_BINDING_OES || params[0] == 0) {
+        return;
+    }
+    RenderContext *ctx = getRenderThreadInfo()->currContext.Ptr();
+    if (ctx && (GLuint)params[0] == ctx->getDefaultFramebuffer()) {
+        params[0] = 0;
+    }
+}
+
+static void s_glBindFramebufferOES(GLenum target, GLuint framebuffer)
+{
+    s_gl.glBindFramebufferOES(target, guestFramebuffer(framebuffer));
+}
+
+static void s_glGetIntegerv(GLenum pname, GLint *params)
+{
+    s_gl.glGetIntegerv(pname, params);
+    guestFramebufferBinding(pname, params);
+}
+
+#ifdef WITH_GLES2
+static void s_glBindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    s_gl2.glBindFramebuffer(target, guestFramebuffer(framebuffer));
+}
+
+static void s_gl2GetIntegerv(GLenum pname, GLint *params)
+{
+    s_gl2.glGetIntegerv(pname, params);
+    guestFramebufferBinding(pname, params);
+}
+#endif
+
+// first opcode of each api, as set by base_opcode in its .attrib file
+#define GLES1_OPCODE_BASE   1024
+#define GLES2_OPCODE_BASE   2048
+#define RC_OPCODE_BASE      10000
+
+// bumped each time a statistics dump is requested
+static volatile int s_statsDumpGen = 0;
+
 RenderThread::RenderThread() :
     osUtils::Thread(),
-    m_stream(NULL)
+    m_stream(NULL),
+    m_replay(false),
+    m_multiTenant(false),
+    m_statBytes(0),
+    m_statPackets(0),
+    m_statGLDecodeUS(0),
+    m_statRCDecodeUS(0),
+    m_statDumpGen(s_statsDumpGen)
+{
+}
+
+RenderThread::~RenderThread()
+{
+    delete m_stream;
+}
+
+void RenderThread::requestStatsDump()
 {
+    s_statsDumpGen++;
+}
+
+RenderThread *RenderThread::create(SocketStream *p_stream, bool p_multiTenant)
+{
+    RenderThread *rt = new RenderThread();
+    if (!rt) {
+        return NULL;
+    }
+
+    rt->m_stream = p_stream;
+    rt->m_multiTenant = p_multiTenant;
+
+    return rt;
 }
 
-RenderThread *RenderThread::create(IOStream *p_stream)
+RenderThread *RenderThread::createReplay(IOStream *p_stream)
 {
     RenderThread *rt = new RenderThread();
     if (!rt) {
@@ -35,19 +154,84 @@ RenderThread *RenderThread::create(IOStream *p_stream)
     }
 
     rt->m_stream = p_stream;
+    rt->m_replay = true;
 
     return rt;
 }
 
 int RenderThread::Main()
 {
+    //
+    // find the framebuffer of the tenant the connection is for, the
+    // connections attaching a tenant are done here.
+    //
+    FrameBuffer *tenantFB = NULL;
+    if (m_multiTenant) {
+        tenantFB = RenderTenant::accept((SocketStream *)m_stream);
+        if (!tenantFB) {
+            return 0;
+        }
+    }
+
+    //
+    // switch to the shared memory transport if the client asks for it,
+    // the ShmStream takes ownership of the tcp connection. A remote
+    // client may ask for a compressed stream instead.
+    //
+    if (!m_replay) {
+        ShmStream *shm = ShmStream::accept((SocketStream *)m_stream,
+                                           STREAM_BUFFER_SIZE);
+        if (shm) {
+            m_stream = shm;
+        }
+        else {
+            ((SocketStream *)m_stream)->acceptCompression();
+        }
+    }
+
     //
     // initialize decoders
     //
     m_glDec.initGL( gl_dispatch_get_proc_func, NULL );
+    m_glDec.set_glBindFramebufferOES( s_glBindFramebufferOES );
+    m_glDec.set_glGetIntegerv( s_glGetIntegerv );
+#ifdef WITH_GLES2
+    m_gl2Dec.initGL( gl2_dispatch_get_proc_func, NULL );
+    m_gl2Dec.set_glBindFramebuffer( s_glBindFramebuffer );
+    m_gl2Dec.set_glGetIntegerv( s_gl2GetIntegerv );
+#endif
     initRenderControlContext( &m_rcDec );
 
-    ReadBuffer readBuf(m_stream, STREAM_BUFFER_SIZE);
+    ReadBuffer readBuf(m_stream, envSize("ANDROID_RENDER_BUFFER_MIN_KB",
+                                         READ_BUFFER_MIN_SIZE));
+    const char *shrinkEnv = getenv("ANDROID_RENDER_BUFFER_SHRINK_MS");
+    readBuf.setAdaptive(envSize("ANDROID_RENDER_BUFFER_MAX_KB",
+                                STREAM_BUFFER_SIZE),
+                        shrinkEnv && atoi(shrinkEnv) > 0 ?
+                            atoi(shrinkEnv) : READ_BUFFER_SHRINK_MS);
+
+    //
+    // optionally receive on a helper thread, so that large payloads such
+    // as texture uploads arrive while the previous commands are decoded
+    //
+    if (getenv("ANDROID_RENDER_READAHEAD") && !readBuf.startReadAhead()) {
+        fprintf(stderr, "RenderThread: read-ahead not available\n");
+    }
+
+    bool frameTrace = FrameTrace::enabled();
+    RenderThreadInfo *tInfo = getRenderThreadInfo();
+    if (frameTrace) {
+        tInfo->connId = FrameTrace::newConnectionId();
+    }
+
+    uint32_t captureId = 0;
+    if (!m_replay && StreamCapture::enabled()) {
+        captureId = StreamCapture::newConnection();
+    }
+
+    // decode time is shared fairly between the framebuffers
+    RenderSchedClient *sched = RenderScheduler::addClient(FrameBuffer::getFB());
+    tInfo->memAccount = GpuMemory::addAccount(FrameBuffer::getFB());
 
     int stats_totalBytes = 0;
     long long stats_t0 = GetCurrentTimeMS();
@@ -59,6 +243,15 @@ int RenderThread::Main()
             fprintf(stderr, "client shutdown\n");
             break;
         }
+        if (frameTrace) {
+            tInfo->lastReadUS = GetCurrentTimeUS();
+        }
+        if (captureId) {
+            // the fresh data follows what was left from the last read
+            StreamCapture::record(captureId,
+                                  readBuf.buf() + readBuf.validData() - stat,
+                                  stat);
+        }
 
         //
         // log received bandwidth statistics
@@ -72,32 +265,188 @@ int RenderThread::Main()
             stats_t0 = GetCurrentTimeMS();
         }
 
-        bool progress;
-        do {
-            progress = false;
-
-            //
-            // try to process some of the command buffer using the GLES decoder
-            //
-            size_t last = m_glDec.decode(readBuf.buf(), readBuf.validData(), m_stream);
-            if (last > 0) {
-                progress = true;
-                readBuf.consume(last);
+        //
+        // route each run of packets to the decoder which owns its opcode
+        // range, the decoders stop at the first packet they do not own.
+        //
+        bool protocolError = false;
+        RenderScheduler::beginBatch(sched);
+        long long batchT0 = GetCurrentTimeUS();
+        int opcode;
+        unsigned int packetLen;
+        while (parseHeader(readBuf.buf(), readBuf.validData(),
+                           &opcode, &packetLen)) {
+            if (packetLen > readBuf.validData()) {
+                if (!readBuf.reserve(packetLen)) {
+                    fprintf(stderr, "RenderThread: packet too large (%u)\n",
+                            packetLen);
+                    protocolError = true;
+                }
+                break; // wait for the rest of the packet
             }
 
-            //
-            // try to process some of the command buffer using the
-            // renderControl decoder
-            //
-            last = m_rcDec.decode(readBuf.buf(), readBuf.validData(), m_stream);
-            if (last > 0) {
-                readBuf.consume(last);
-                progress = true;
+            long long t0 = GetCurrentTimeUS();
+            long long *decodeUS;
+            size_t last = 0;
+            if (packetLen == 0) {
+                // malformed header, nothing to decode
+            }
+            else if (opcode >= RC_OPCODE_BASE) {
+                last = m_rcDec.decode(readBuf.buf(), readBuf.validData(), m_stream);
+                decodeUS = &m_statRCDecodeUS;
+            }
+#ifdef WITH_GLES2
+            else if (opcode >= GLES2_OPCODE_BASE) {
+                last = m_gl2Dec.decode(readBuf.buf(), readBuf.validData(), m_stream);
+                decodeUS = &m_statGLDecodeUS;
+            }
+#endif
+            else if (opcode >= GLES1_OPCODE_BASE) {
+                last = m_glDec.decode(readBuf.buf(), readBuf.validData(), m_stream);
+                decodeUS = &m_statGLDecodeUS;
             }
 
-        } while( progress );
+            if (last == 0) {
+                // a complete packet nobody can decode
+                fprintf(stderr, "RenderThread: unknown opcode %d (len %u)\n",
+                        opcode, packetLen);
+                protocolError = true;
+                break;
+            }
 
+            *decodeUS += GetCurrentTimeUS() - t0;
+            countPackets(readBuf.buf(), last);
+            readBuf.consume(last);
+        }
+        RenderScheduler::endBatch(sched, GetCurrentTimeUS() - batchT0);
+
+        if (protocolError) {
+            break;
+        }
+
+        if (m_statDumpGen != s_statsDumpGen) {
+            m_statDumpGen = s_statsDumpGen;
+            dumpStats(stderr);
+            Instrument::dump(stderr);
+            RenderScheduler::dump(stderr);
+            GpuMemory::dump(stderr);
+            if (frameTrace) {
+                FrameTrace::dump();
+            }
+        }
+    }
+
+    StreamCapture::endConnection(captureId);
+    releaseReservedHandles();
+    RenderScheduler::removeClient(sched);
+    // what the connection created stays charged to it
+    GpuMemory::release(tInfo->memAccount);
+    tInfo->memAccount = NULL;
+    RenderTenant::leave(tenantFB);
+
+    if (getenv("ANDROID_RENDER_STATS")) {
+        dumpStats(stderr);
+    }
+
+    if (frameTrace) {
+        FrameTrace::releaseThreadRing();
+        FrameTrace::dump();
     }
 
     return 0;
 }
+
+//
+// parseHeader - the opcode and the length of the packet at 'buf', either
+//     from its header or, for a compact packet, from the decoder of its
+//     opcode. '*packetLen' is 0 for a malformed header. Returns false if
+//     the header itself is not complete.
+//
+bool RenderThread::parseHeader(const unsigned char *buf, size_t len,
+                               int *opcode, unsigned int *packetLen)
+{
+    if (len < 2) {
+        return false;
+    }
+
+    unsigned int op = *(unsigned short *)buf;
+    if (op & IOSTREAM_COMPACT_FLAG) {
+        *opcode = op & ~IOSTREAM_COMPACT_FLAG;
+        if (*opcode >= RC_OPCODE_BASE) {
+            *packetLen = renderControl_decoder_context_t::compactPacketSize(*opcode);
+        }
+#ifdef WITH_GLES2
+        else if (*opcode >= GLES2_OPCODE_BASE) {
+            *packetLen = GL2Decoder::compactPacketSize(*opcode);
+        }
+#endif
+        else {
+            *packetLen = GLDecoder::compactPacketSize(*opcode);
+        }
+        return true;
+    }
+
+    if (len < 8) {
+        return false;
+    }
+    *opcode = *(int *)buf;
+    *packetLen = *(unsigned int *)(buf + 4);
+    if (*packetLen < 8) {
+        *packetLen = 0;
+    }
+    return true;
+}
+
+//
+// countPackets - walk the headers of the packets which have just been
+//     decoded from 'buf' and account them per opcode.
+//
+void RenderThread::countPackets(const unsigned char *buf, size_t len)
+{
+    m_statBytes += len;
+
+    size_t pos = 0;
+    int opcode;
+    unsigned int packetLen;
+    while (parseHeader(buf + pos, len - pos, &opcode, &packetLen)) {
+        if (packetLen == 0 || packetLen > len - pos) {
+            break;
+        }
+
+        OpcodeStats &op = m_statOpcodes[opcode];
+        op.calls++;
+        op.bytes += packetLen;
+        m_statPackets++;
+
+        pos += packetLen;
+    }
+}
+
+static bool compareCalls(const std::pair<int, unsigned int> &a,
+                         const std::pair<int, unsigned int> &b)
+{
+    return a.second > b.second;
+}
+
+void RenderThread::dumpStats(FILE *fp)
+{
+    fprintf(fp, "RenderThread %p: %llu bytes, %llu packets, "
+                "GL decode %lld ms, renderControl decode %lld ms\n",
+            this, m_statBytes, m_statPackets,
+            m_statGLDecodeUS / 1000, m_statRCDecodeUS / 1000);
+
+    // sort opcodes by number of calls
+    std::vector< std::pair<int, unsigned int> > ops;
+    for (OpcodeStatsMap::iterator it = m_statOpcodes.begin();
+         it != m_statOpcodes.end(); it++) {
+        ops.push_back(std::make_pair(it->first, it->second.calls));
+    }
+    std::sort(ops.begin(), ops.end(), compareCalls);
+
+    fprintf(fp, "    %8s %10s %12s\n", "opcode", "calls", "bytes");
+    for (size_t i = 0; i < ops.size(); i++) {
+        fprintf(fp, "    %8d %10u %12llu\n", ops[i].first, ops[i].second,
+                m_statOpcodes[ops[i].first].bytes);
+    }
+    fflush(fp);
+}
@@ -17,23 +17,72 @@
 #define _LIB_OPENGL_RENDER_RENDER_THREAD_H
 
 #include "IOStream.h"
+#include "SocketStream.h"
 #include "GLDecoder.h"
+#ifdef WITH_GLES2
+#include "GL2Decoder.h"
+#endif
 #include "renderControl_dec.h"
 #include "osThread.h"
+#include <stdio.h>
+#include <map>
 
 class RenderThread : public osUtils::Thread
 {
 public:
-    static RenderThread *create(IOStream *p_stream);
+    //
+    // create - 'p_multiTenant' if the connection starts with a tenant
+    //     request, see RenderTenant.
+    //
+    static RenderThread *create(SocketStream *p_stream, bool p_multiTenant = false);
+
+    //
+    // createReplay - creates a thread decoding the stream of a captured
+    //     connection, see StreamCapture. The stream is not captured and
+    //     never switched to shared memory.
+    //
+    static RenderThread *createReplay(IOStream *p_stream);
+    ~RenderThread();
+
+    //
+    // requestStatsDump - asks every render thread to print its decode
+    //     statistics to stderr. The dump happens when the thread next
+    //     receives data. Safe to call from a signal handler.
+    //
+    static void requestStatsDump();
 
 private:
     RenderThread();
     virtual int Main();
 
+    static bool parseHeader(const unsigned char *buf, size_t len,
+                            int *opcode, unsigned int *packetLen);
+    void countPackets(const unsigned char *buf, size_t len);
+    void dumpStats(FILE *fp);
+
 private:
+    struct OpcodeStats {
+        unsigned int calls;
+        unsigned long long bytes;
+    };
+    typedef std::map<int, OpcodeStats> OpcodeStatsMap;
+
     IOStream *m_stream;
+    bool m_replay;
+    bool m_multiTenant;
     GLDecoder   m_glDec;
+#ifdef WITH_GLES2
+    GL2Decoder  m_gl2Dec;
+#endif
     renderControl_decoder_context_t m_rcDec;
+
+    // per-connection decode statistics
+    unsigned long long m_statBytes;
+    unsigned long long m_statPackets;
+    long long m_statGLDecodeUS;
+    long long m_statRCDecodeUS;
+    OpcodeStatsMap m_statOpcodes;
+    int m_statDumpGen;
 };
 
 #endif
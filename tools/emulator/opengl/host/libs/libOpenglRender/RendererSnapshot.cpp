@@ -0,0 +1,127 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "RendererSnapshot.h"
+#include <stdio.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+RenderSnapshotFile::RenderSnapshotFile() :
+    m_data(NULL),
+    m_size(0)
+#ifdef _WIN32
+    , m_mapping(NULL)
+#endif
+{
+}
+
+RenderSnapshotFile::~RenderSnapshotFile()
+{
+#ifdef _WIN32
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping) {
+        CloseHandle((HANDLE)m_mapping);
+    }
+#else
+    if (m_data) {
+        munmap((void *)m_data, m_size);
+    }
+#endif
+}
+
+RenderSnapshotFile *RenderSnapshotFile::map(const char *p_path)
+{
+    RenderSnapshotFile *file = new RenderSnapshotFile();
+
+#ifdef _WIN32
+    HANDLE h = CreateFileA(p_path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h == INVALID_HANDLE_VALUE) {
+        delete file;
+        return NULL;
+    }
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(h, &size) && size.QuadPart > 0) {
+        file->m_size = (size_t)size.QuadPart;
+        file->m_mapping = CreateFileMapping(h, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (file->m_mapping) {
+            file->m_data = (const unsigned char *)
+                MapViewOfFile((HANDLE)file->m_mapping, FILE_MAP_READ, 0, 0, 0);
+        }
+    }
+    CloseHandle(h);
+#else
+    int fd = open(p_path, O_RDONLY);
+    if (fd < 0) {
+        delete file;
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            file->m_data = (const unsigned char *)data;
+            file->m_size = st.st_size;
+        }
+    }
+    close(fd);
+#endif
+
+    if (!file->m_data || !file->validate()) {
+        fprintf(stderr, "%s is not a renderer snapshot\n", p_path);
+        delete file;
+        return NULL;
+    }
+    return file;
+}
+
+bool RenderSnapshotFile::validate() const
+{
+    if (m_size < sizeof(RenderSnapshotHeader)) {
+        return false;
+    }
+    const RenderSnapshotHeader *hdr = getHeader();
+    if (hdr->magic != RENDER_SNAPSHOT_MAGIC ||
+        hdr->version != RENDER_SNAPSHOT_VERSION) {
+        return false;
+    }
+
+    // 64 bits, the counts come from the file
+    uint64_t records = sizeof(RenderSnapshotHeader) +
+        (uint64_t)hdr->numColorBuffers * sizeof(RenderSnapshotColorBuffer) +
+        (uint64_t)hdr->numContexts * sizeof(RenderSnapshotContext) +
+        (uint64_t)hdr->numWindows * sizeof(RenderSnapshotWindow);
+    if (records > m_size) {
+        return false;
+    }
+
+    const RenderSnapshotColorBuffer *cbs = getColorBuffers();
+    for (uint32_t i = 0; i < hdr->numColorBuffers; i++) {
+        uint64_t len = (uint64_t)cbs[i].width * cbs[i].height * 4;
+        if (cbs[i].offset < records || cbs[i].offset > m_size ||
+            len > m_size - cbs[i].offset) {
+            return false;
+        }
+    }
+    return true;
+}
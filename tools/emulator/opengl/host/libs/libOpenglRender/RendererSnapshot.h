@@ -0,0 +1,121 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _LIB_OPENGL_RENDER_RENDERER_SNAPSHOT_H
+#define _LIB_OPENGL_RENDER_RENDERER_SNAPSHOT_H
+
+#include "SmartPtr.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#define RENDER_SNAPSHOT_MAGIC    0x50534e52  // 'RNSP'
+#define RENDER_SNAPSHOT_VERSION  1
+
+// pixel blobs start on this boundary so they can be used straight from
+// the mapped file
+#define RENDER_SNAPSHOT_ALIGN    4096
+
+//
+// Layout of a renderer snapshot file, written by FrameBuffer::saveSnapshot.
+// The header is followed by the color buffer, context and window surface
+// records, then by the color buffer pixels. Those are width x height
+// tightly packed GL_RGBA/GL_UNSIGNED_BYTE pixels, bottom row first, at
+// the 'offset' of their record from the start of the file.
+//
+// Contexts with the same 'shareGroup' share their objects, the group is
+// named after the first context created in it.
+//
+struct RenderSnapshotHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t numColorBuffers;
+    uint32_t numContexts;
+    uint32_t numWindows;
+    uint32_t pad;
+};
+
+struct RenderSnapshotColorBuffer {
+    uint32_t handle;
+    uint32_t width;
+    uint32_t height;
+    uint32_t internalFormat;
+    uint64_t offset;
+};
+
+struct RenderSnapshotContext {
+    uint32_t handle;
+    uint32_t config;
+    uint32_t shareGroup;
+    uint32_t isGL2;
+};
+
+struct RenderSnapshotWindow {
+    uint32_t handle;
+    uint32_t config;
+    uint32_t width;
+    uint32_t height;
+    uint32_t colorBuffer;  // 0 if no color buffer is attached
+    uint32_t pad;
+};
+
+//
+// RenderSnapshotFile - a snapshot file mapped read only. The color
+//    buffers restored from it keep a reference to it until their pixels
+//    are uploaded, so the file is only read for the buffers which are
+//    used, when they are first used.
+//
+class RenderSnapshotFile
+{
+public:
+    //
+    // map - maps the snapshot file 'p_path' and checks its records fit
+    //     in it. Returns NULL if it cannot be read or is not a snapshot.
+    //
+    static RenderSnapshotFile *map(const char *p_path);
+    ~RenderSnapshotFile();
+
+    const RenderSnapshotHeader *getHeader() const {
+        return (const RenderSnapshotHeader *)m_data;
+    }
+    const RenderSnapshotColorBuffer *getColorBuffers() const {
+        return (const RenderSnapshotColorBuffer *)(getHeader() + 1);
+    }
+    const RenderSnapshotContext *getContexts() const {
+        return (const RenderSnapshotContext *)
+               (getColorBuffers() + getHeader()->numColorBuffers);
+    }
+    const RenderSnapshotWindow *getWindows() const {
+        return (const RenderSnapshotWindow *)
+               (getContexts() + getHeader()->numContexts);
+    }
+    const unsigned char *getPixels(const RenderSnapshotColorBuffer &p_cb) const {
+        return m_data + p_cb.offset;
+    }
+
+private:
+    RenderSnapshotFile();
+    bool validate() const;
+
+private:
+    const unsigned char *m_data;
+    size_t m_size;
+#ifdef _WIN32
+    void *m_mapping;
+#endif
+};
+
+typedef SmartPtr<RenderSnapshotFile> RenderSnapshotFilePtr;
+
+#endif
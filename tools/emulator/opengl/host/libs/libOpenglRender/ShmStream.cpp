@@ -0,0 +1,688 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "ShmStream.h"
+#include "StreamCapture.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <linux/futex.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <time.h>
+#endif
+
+#define SHM_STREAM_MAGIC        0x4d485353  // 'SSHM'
+#define SHM_STREAM_VERSION      2
+#define SHM_STREAM_NAME_MAX     64
+
+// ring sizes, must be powers of two
+#define SHM_STREAM_TX_RING_SIZE (4*1024*1024)  // client -> server
+#define SHM_STREAM_RX_RING_SIZE (1024*1024)    // server -> client
+#define SHM_STREAM_BULK_SIZE    (8*1024*1024)  // client bulk data
+
+// bulk chunks are aligned to this, smaller payloads are sent inline
+#define SHM_STREAM_BULK_ALIGN   16
+#define SHM_STREAM_BULK_MIN     4096
+
+// number of polls on an empty/full ring before sleeping on the futex
+#define SHM_STREAM_SPIN_COUNT   200
+
+// how often a sleeping side checks if the peer is still alive
+#define SHM_STREAM_WAIT_MS      200
+
+//
+// Shared memory layout:
+//     ShmStreamHeader
+//     ShmStreamRing (client -> server) + data
+//     ShmStreamRing (server -> client) + data
+//     bulk data
+//
+// head and tail are free running byte counters, they are only written by
+// the producer and the consumer respectively. A bulk chunk never wraps
+// around the end of the bulk ring, its id is the counter value of its
+// start; the chunks are released in order by moving the tail past them.
+//
+struct ShmStreamRing {
+    volatile int32_t head;
+    volatile int32_t tail;
+    volatile int32_t readerWaiting;
+    volatile int32_t writerWaiting;
+    uint32_t size;
+    uint32_t offset;  // of the ring data from the start of the mapping
+};
+
+struct ShmStreamBulk {
+    volatile int32_t head;
+    volatile int32_t tail;
+    uint32_t size;    // 0 if the server does not take bulk data
+    uint32_t offset;
+};
+
+struct ShmStreamHeader {
+    uint32_t magic;
+    uint32_t version;
+    volatile int32_t closed;
+    uint32_t pad;
+    ShmStreamRing rings[2];
+    ShmStreamBulk bulk;
+};
+
+#ifdef __linux__
+
+static int futexWait(volatile int32_t *addr, int32_t val, int timeoutMS)
+{
+    struct timespec ts;
+    ts.tv_sec = timeoutMS / 1000;
+    ts.tv_nsec = (timeoutMS % 1000) * 1000000;
+    return syscall(__NR_futex, addr, FUTEX_WAIT, val, &ts, NULL, 0);
+}
+
+static void futexWake(volatile int32_t *addr)
+{
+    syscall(__NR_futex, addr, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+static bool sendAll(int sock, const void *buf, size_t len)
+{
+    const char *p = (const char *)buf;
+    while (len > 0) {
+        ssize_t n = ::send(sock, p, len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool recvAll(int sock, void *buf, size_t len)
+{
+    char *p = (char *)buf;
+    while (len > 0) {
+        ssize_t n = ::recv(sock, p, len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+ShmStream::ShmStream(SocketStream *p_sock, size_t bufSize) :
+    IOStream(bufSize),
+    m_sock(p_sock),
+    m_bufsize(bufSize),
+    m_buf(NULL),
+    m_header(NULL),
+    m_mapSize(0),
+    m_rxRing(NULL),
+    m_txRing(NULL),
+    m_rxData(NULL),
+    m_txData(NULL),
+    m_bulk(NULL),
+    m_bulkData(NULL)
+{
+}
+
+ShmStream::~ShmStream()
+{
+    if (m_header) {
+        // let the peer know we are gone
+        interrupt();
+        munmap(m_header, m_mapSize);
+    }
+    delete m_sock;
+    free(m_buf);
+}
+
+void ShmStream::interrupt()
+{
+    if (!m_header) {
+        return;
+    }
+
+    // both sides see the rings as closed and the sleepers wake up
+    m_header->closed = 1;
+    __sync_synchronize();
+    futexWake(&m_header->rings[0].head);
+    futexWake(&m_header->rings[0].tail);
+    futexWake(&m_header->rings[1].head);
+    futexWake(&m_header->rings[1].tail);
+}
+
+bool ShmStream::map(int fd, size_t size)
+{
+    void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+        return false;
+    }
+    m_header = (ShmStreamHeader *)ptr;
+    m_mapSize = size;
+    return true;
+}
+
+ShmStream *ShmStream::connect(SocketStream *p_sock, size_t bufSize)
+{
+    if (getenv("ANDROID_NO_SHM_STREAM")) {
+        return NULL;
+    }
+
+    int sock = p_sock->getSocket();
+    if (sock < 0) {
+        return NULL;
+    }
+
+    //
+    // create and initialize the shared memory object
+    //
+    char name[SHM_STREAM_NAME_MAX];
+    static int s_count = 0;
+    snprintf(name, sizeof(name), "/oglrender-shm-%d-%d",
+             (int)getpid(), __sync_fetch_and_add(&s_count, 1));
+
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    size_t hdrSize = (sizeof(ShmStreamHeader) + 4095) & ~4095;
+    size_t size = hdrSize + SHM_STREAM_TX_RING_SIZE + SHM_STREAM_RX_RING_SIZE +
+                  SHM_STREAM_BULK_SIZE;
+    if (ftruncate(fd, size) < 0) {
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+
+    ShmStream *stream = new ShmStream(p_sock, bufSize);
+    if (!stream->map(fd, size)) {
+        close(fd);
+        shm_unlink(name);
+        stream->m_sock = NULL;
+        delete stream;
+        return NULL;
+    }
+    close(fd);
+
+    ShmStreamHeader *hdr = stream->m_header;
+    memset(hdr, 0, sizeof(ShmStreamHeader));
+    hdr->magic = SHM_STREAM_MAGIC;
+    hdr->version = SHM_STREAM_VERSION;
+    hdr->rings[0].size = SHM_STREAM_TX_RING_SIZE;
+    hdr->rings[0].offset = hdrSize;
+    hdr->rings[1].size = SHM_STREAM_RX_RING_SIZE;
+    hdr->rings[1].offset = hdrSize + SHM_STREAM_TX_RING_SIZE;
+    hdr->bulk.size = SHM_STREAM_BULK_SIZE;
+    hdr->bulk.offset = hdrSize + SHM_STREAM_TX_RING_SIZE + SHM_STREAM_RX_RING_SIZE;
+
+    stream->m_txRing = &hdr->rings[0];
+    stream->m_rxRing = &hdr->rings[1];
+    stream->m_txData = (unsigned char *)hdr + hdr->rings[0].offset;
+    stream->m_rxData = (unsigned char *)hdr + hdr->rings[1].offset;
+    __sync_synchronize();
+
+    //
+    // send the request and wait for the server answer
+    //
+    uint32_t req[3];
+    req[0] = SHM_STREAM_MAGIC;
+    req[1] = SHM_STREAM_VERSION;
+    req[2] = strlen(name);
+    uint32_t reply = 0;
+    bool ok = sendAll(sock, req, sizeof(req)) &&
+              sendAll(sock, name, req[2]) &&
+              recvAll(sock, &reply, sizeof(reply));
+
+    // the server has the object mapped by now (or never will)
+    shm_unlink(name);
+
+    if (!ok || reply != 1) {
+        stream->m_sock = NULL;  // the caller keeps the socket
+        delete stream;
+        return NULL;
+    }
+
+    // the server clears the bulk size if it does not want bulk data
+    __sync_synchronize();
+    if (hdr->bulk.size != 0) {
+        stream->m_bulk = &hdr->bulk;
+        stream->m_bulkData = (unsigned char *)hdr + hdr->bulk.offset;
+    }
+
+    return stream;
+}
+
+ShmStream *ShmStream::accept(SocketStream *p_sock, size_t bufSize)
+{
+    int sock = p_sock->getSocket();
+    if (sock < 0) {
+        return NULL;
+    }
+
+    //
+    // check if the client starts with a shared memory request
+    //
+    uint32_t req[3];
+    ssize_t n;
+    do {
+        n = ::recv(sock, req, sizeof(uint32_t), MSG_PEEK | MSG_WAITALL);
+    } while (n < 0 && errno == EINTR);
+
+    if (n != sizeof(uint32_t) || req[0] != SHM_STREAM_MAGIC) {
+        return NULL;
+    }
+
+    if (!recvAll(sock, req, sizeof(req)) || req[2] >= SHM_STREAM_NAME_MAX) {
+        return NULL;
+    }
+
+    char name[SHM_STREAM_NAME_MAX];
+    if (!recvAll(sock, name, req[2])) {
+        return NULL;
+    }
+    name[req[2]] = '\0';
+
+    ShmStream *stream = NULL;
+    uint32_t reply = 0;
+
+    int fd = -1;
+    if (req[1] == SHM_STREAM_VERSION && !getenv("ANDROID_NO_SHM_STREAM")) {
+        fd = shm_open(name, O_RDWR, 0600);
+    }
+
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) == 0 &&
+        (size_t)st.st_size > sizeof(ShmStreamHeader)) {
+        stream = new ShmStream(p_sock, bufSize);
+        if (stream->map(fd, st.st_size)) {
+            ShmStreamHeader *hdr = stream->m_header;
+            bool valid = hdr->magic == SHM_STREAM_MAGIC;
+            for (int i = 0; i < 2 && valid; i++) {
+                valid = hdr->rings[i].offset + hdr->rings[i].size <=
+                        (size_t)st.st_size &&
+                        (hdr->rings[i].size & (hdr->rings[i].size - 1)) == 0;
+            }
+            valid = valid && hdr->bulk.offset + hdr->bulk.size <=
+                    (size_t)st.st_size &&
+                    (hdr->bulk.size & (hdr->bulk.size - 1)) == 0;
+            if (valid) {
+                //
+                // a capture records the rings only, the bulk data would be
+                // missing from it. The bulk ring is then left unused.
+                //
+                if (StreamCapture::enabled() || getenv("ANDROID_NO_SHM_BULK")) {
+                    hdr->bulk.size = 0;
+                }
+                if (hdr->bulk.size != 0) {
+                    stream->m_bulk = &hdr->bulk;
+                    stream->m_bulkData = (unsigned char *)hdr + hdr->bulk.offset;
+                }
+                __sync_synchronize();
+
+                // rings are seen from the client point of view
+                stream->m_rxRing = &hdr->rings[0];
+                stream->m_txRing = &hdr->rings[1];
+                stream->m_rxData = (unsigned char *)hdr + hdr->rings[0].offset;
+                stream->m_txData = (unsigned char *)hdr + hdr->rings[1].offset;
+                reply = 1;
+            }
+        }
+        if (!reply) {
+            stream->m_sock = NULL;
+            delete stream;
+            stream = NULL;
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    if (!sendAll(sock, &reply, sizeof(reply)) && stream) {
+        stream->m_sock = NULL;
+        delete stream;
+        stream = NULL;
+    }
+
+    return stream;
+}
+
+bool ShmStream::peerClosed()
+{
+    if (m_header->closed) {
+        return true;
+    }
+
+    //
+    // no data is expected on the socket once the rings are in use,
+    // readability means the peer has closed the connection.
+    //
+    struct pollfd pfd;
+    pfd.fd = m_sock->getSocket();
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, 0) > 0) {
+        char c;
+        ssize_t n = ::recv(pfd.fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void *ShmStream::allocBuffer(size_t minSize)
+{
+    size_t allocSize = (m_bufsize < minSize ? minSize : m_bufsize);
+    if (m_buf && m_bufsize < allocSize) {
+        //
+        // IOStream only asks for a buffer once everything staged in the
+        // previous one was committed, do not copy it over. Large replies
+        // such as glReadPixels pixels grow the buffer this way.
+        //
+        free(m_buf);
+        m_buf = NULL;
+    }
+    if (!m_buf) {
+        m_buf = (unsigned char *)malloc(allocSize);
+        if (m_buf != NULL) {
+            m_bufsize = allocSize;
+        } else {
+            ERR("malloc (%u) failed\n", (unsigned)allocSize);
+            m_bufsize = 0;
+        }
+    }
+
+    return m_buf;
+}
+
+int ShmStream::commitBuffer(size_t size)
+{
+    return writeFully(m_buf, size);
+}
+
+int ShmStream::writeFully(const void *buf, size_t len)
+{
+    const unsigned char *src = (const unsigned char *)buf;
+    ShmStreamRing *ring = m_txRing;
+    uint32_t mask = ring->size - 1;
+    int spin = 0;
+
+    while (len > 0) {
+        uint32_t head = ring->head;
+        uint32_t tail = ring->tail;
+        uint32_t avail = ring->size - (head - tail);
+
+        if (avail == 0) {
+            if (m_header->closed) {
+                return -1;
+            }
+            if (++spin < SHM_STREAM_SPIN_COUNT) {
+                continue;
+            }
+
+            // ring is full - sleep until the reader frees some space
+            ring->writerWaiting = 1;
+            __sync_synchronize();
+            if (ring->tail == (int32_t)tail) {
+                futexWait(&ring->tail, tail, SHM_STREAM_WAIT_MS);
+            }
+            ring->writerWaiting = 0;
+            if (ring->tail == (int32_t)tail && peerClosed()) {
+                ERR("ShmStream::writeFully failed: peer closed\n");
+                return -1;
+            }
+            continue;
+        }
+        spin = 0;
+
+        size_t n = len < avail ? len : avail;
+        size_t off = head & mask;
+        size_t first = ring->size - off;
+        if (first > n) first = n;
+        memcpy(m_txData + off, src, first);
+        memcpy(m_txData, src + first, n - first);
+
+        __sync_synchronize();
+        ring->head = head + n;
+        __sync_synchronize();
+        if (ring->readerWaiting) {
+            futexWake(&ring->head);
+        }
+
+        src += n;
+        len -= n;
+    }
+    return 0;
+}
+
+//
+// readSome - blocks until data is available and reads up to 'len' bytes.
+//     returns the number of bytes read or -1 if the peer has closed.
+//
+int ShmStream::readSome(void *buf, size_t len)
+{
+    ShmStreamRing *ring = m_rxRing;
+    uint32_t mask = ring->size - 1;
+    int spin = 0;
+
+    while (true) {
+        uint32_t tail = ring->tail;
+        uint32_t head = ring->head;
+        uint32_t avail = head - tail;
+
+        if (avail == 0) {
+            if (m_header->closed) {
+                return -1;
+            }
+            if (++spin < SHM_STREAM_SPIN_COUNT) {
+                continue;
+            }
+
+            // ring is empty - sleep until the writer posts some data
+            ring->readerWaiting = 1;
+            __sync_synchronize();
+            if (ring->head == (int32_t)head) {
+                futexWait(&ring->head, head, SHM_STREAM_WAIT_MS);
+            }
+            ring->readerWaiting = 0;
+            if (ring->head == (int32_t)head && peerClosed()) {
+                return -1;
+            }
+            continue;
+        }
+
+        __sync_synchronize();
+        size_t n = len < avail ? len : avail;
+        size_t off = tail & mask;
+        size_t first = ring->size - off;
+        if (first > n) first = n;
+        memcpy(buf, m_rxData + off, first);
+        memcpy((unsigned char *)buf + first, m_rxData, n - first);
+
+        __sync_synchronize();
+        ring->tail = tail + n;
+        __sync_synchronize();
+        if (ring->writerWaiting) {
+            futexWake(&ring->tail);
+        }
+        return n;
+    }
+}
+
+const unsigned char *ShmStream::readFully(void *buf, size_t len)
+{
+    if (!buf) {
+        ERR("ShmStream::readFully failed, buf=NULL");
+        return NULL;
+    }
+
+    size_t res = len;
+    while (res > 0) {
+        int n = readSome((unsigned char *)buf + (len - res), res);
+        if (n < 0) {
+            return NULL;
+        }
+        res -= n;
+    }
+    return (const unsigned char *)buf;
+}
+
+const unsigned char *ShmStream::read( void *buf, size_t *inout_len)
+{
+    if (!buf) {
+        ERR("ShmStream::read failed, buf=NULL");
+        return NULL;
+    }
+
+    int n = readSome(buf, *inout_len);
+    if (n > 0) {
+        *inout_len = n;
+        return (const unsigned char *)buf;
+    }
+    return NULL;
+}
+
+static inline uint32_t bulkChunkSize(size_t len)
+{
+    return (len + SHM_STREAM_BULK_ALIGN - 1) & ~(SHM_STREAM_BULK_ALIGN - 1);
+}
+
+void *ShmStream::allocBulk(size_t len, unsigned int *id)
+{
+    // only the client, which reads rings[1], writes bulk data
+    if (!m_bulk || m_rxRing != &m_header->rings[1] ||
+        len < SHM_STREAM_BULK_MIN || len > m_bulk->size / 2) {
+        return NULL;
+    }
+
+    uint32_t size = m_bulk->size;
+    uint32_t chunk = bulkChunkSize(len);
+    uint32_t head = m_bulk->head;
+    uint32_t tail = m_bulk->tail;
+
+    // skip the end of the ring rather than splitting the chunk
+    uint32_t off = head & (size - 1);
+    uint32_t pad = off + chunk > size ? size - off : 0;
+    if ((head - tail) + pad + chunk > size) {
+        return NULL;
+    }
+
+    *id = head + pad;
+    m_bulk->head = head + pad + chunk;
+    return m_bulkData + ((head + pad) & (size - 1));
+}
+
+const unsigned char *ShmStream::getBulk(unsigned int id, size_t len)
+{
+    // only the server, which writes rings[1], reads bulk data
+    if (!m_bulk || m_txRing != &m_header->rings[1] || len > m_bulk->size) {
+        return NULL;
+    }
+
+    // the chunk must be within the part of the ring written by the client
+    __sync_synchronize();
+    uint32_t tail = m_bulk->tail;
+    uint32_t used = (uint32_t)m_bulk->head - tail;
+    uint32_t chunk = bulkChunkSize(len);
+    uint32_t off = id & (m_bulk->size - 1);
+    if (id - tail > used || id - tail + chunk > used ||
+        off + chunk > m_bulk->size) {
+        ERR("ShmStream::getBulk: bad bulk id %u (%u bytes)\n", id, (unsigned)len);
+        return NULL;
+    }
+    return m_bulkData + off;
+}
+
+void ShmStream::releaseBulk(unsigned int id, size_t len)
+{
+    if (!m_bulk || m_txRing != &m_header->rings[1]) {
+        return;
+    }
+
+    // done reading the chunk before the client may reuse it
+    __sync_synchronize();
+    m_bulk->tail = id + bulkChunkSize(len);
+}
+
+#else // !__linux__
+
+ShmStream *ShmStream::connect(SocketStream *p_sock, size_t bufSize)
+{
+    return NULL;
+}
+
+ShmStream *ShmStream::accept(SocketStream *p_sock, size_t bufSize)
+{
+    return NULL;
+}
+
+ShmStream::~ShmStream()
+{
+}
+
+void *ShmStream::allocBuffer(size_t minSize)
+{
+    return NULL;
+}
+
+int ShmStream::commitBuffer(size_t size)
+{
+    return -1;
+}
+
+const unsigned char *ShmStream::readFully( void *buf, size_t len)
+{
+    return NULL;
+}
+
+const unsigned char *ShmStream::read( void *buf, size_t *inout_len)
+{
+    return NULL;
+}
+
+int ShmStream::writeFully(const void *buf, size_t len)
+{
+    return -1;
+}
+
+void ShmStream::interrupt()
+{
+}
+
+void *ShmStream::allocBulk(size_t len, unsigned int *id)
+{
+    return NULL;
+}
+
+const unsigned char *ShmStream::getBulk(unsigned int id, size_t len)
+{
+    return NULL;
+}
+
+void ShmStream::releaseBulk(unsigned int id, size_t len)
+{
+}
+
+#endif
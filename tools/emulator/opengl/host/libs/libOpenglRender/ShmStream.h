@@ -0,0 +1,97 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _LIB_OPENGL_RENDER_SHM_STREAM_H
+#define _LIB_OPENGL_RENDER_SHM_STREAM_H
+
+#include <stdint.h>
+#include "IOStream.h"
+#include "SocketStream.h"
+
+struct ShmStreamHeader;
+struct ShmStreamRing;
+struct ShmStreamBulk;
+
+//
+// ShmStream - an IOStream which transfers data through a pair of
+//    single-producer/single-consumer rings in shared memory. It is used
+//    between the emulator and a renderer process running on the same host,
+//    and avoids the syscalls and kernel copies of a loopback TCP connection.
+//    Blocked readers and writers are woken with futex doorbells.
+//
+//    The shared memory transport is negotiated on a freshly connected
+//    SocketStream: the client creates the rings and sends their name, the
+//    server maps them and acknowledges. The TCP connection is kept open
+//    in order to detect when the peer goes away.
+//
+//    Large payloads of the client (texture pixels, buffer data) can also
+//    go through a third region, the bulk ring, so that the rings only carry
+//    a reference to them (see IOStream::allocBulk). The server turns it off
+//    while the streams are captured, as the capture only sees the rings.
+//
+//    Only supported on Linux, on other platforms connect()/accept() always
+//    fail and the TCP connection is used as is.
+//
+class ShmStream : public IOStream {
+public:
+    //
+    // connect - client side negotiation over the connected 'p_sock'.
+    //     returns a new ShmStream which owns 'p_sock', or NULL if the
+    //     server declined, in which case 'p_sock' is still usable as a
+    //     plain TCP stream.
+    //
+    static ShmStream *connect(SocketStream *p_sock, size_t bufSize);
+
+    //
+    // accept - server side negotiation over the accepted 'p_sock'.
+    //     returns a new ShmStream which owns 'p_sock' if the client
+    //     requested the shared memory transport, NULL otherwise. No data
+    //     is consumed from 'p_sock' when NULL is returned.
+    //
+    static ShmStream *accept(SocketStream *p_sock, size_t bufSize);
+
+    ~ShmStream();
+
+    virtual void *allocBuffer(size_t minSize);
+    virtual int commitBuffer(size_t size);
+    virtual const unsigned char *readFully( void *buf, size_t len);
+    virtual const unsigned char *read( void *buf, size_t *inout_len);
+    virtual int writeFully(const void *buf, size_t len);
+    virtual void interrupt();
+    virtual void *allocBulk(size_t len, unsigned int *id);
+    virtual const unsigned char *getBulk(unsigned int id, size_t len);
+    virtual void releaseBulk(unsigned int id, size_t len);
+
+private:
+    ShmStream(SocketStream *p_sock, size_t bufSize);
+    bool map(int fd, size_t size);
+    bool peerClosed();
+    int readSome(void *buf, size_t len);
+
+private:
+    SocketStream *m_sock;
+    size_t m_bufsize;
+    unsigned char *m_buf;
+    ShmStreamHeader *m_header;
+    size_t m_mapSize;
+    ShmStreamRing *m_rxRing;
+    ShmStreamRing *m_txRing;
+    unsigned char *m_rxData;
+    unsigned char *m_txData;
+    ShmStreamBulk *m_bulk;
+    unsigned char *m_bulkData;
+};
+
+#endif
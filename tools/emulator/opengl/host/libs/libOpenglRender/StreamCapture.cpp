@@ -0,0 +1,330 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "StreamCapture.h"
+#include "RenderThread.h"
+#include "IOStream.h"
+#include "TimeUtils.h"
+#include <cutils/atomic.h>
+#include <utils/threads.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+
+// capture output, opened by the first newConnection, protected by s_lock
+static FILE *s_captureFile = NULL;
+static bool s_captureFailed = false;
+static android::Mutex s_lock;
+
+static volatile int32_t s_lastConnId = 0;
+
+bool StreamCapture::enabled()
+{
+    static int s_enabled = -1;
+    if (s_enabled < 0) {
+        s_enabled = getenv("ANDROID_GL_CAPTURE") != NULL;
+    }
+    return s_enabled != 0;
+}
+
+uint32_t StreamCapture::newConnection()
+{
+    android::Mutex::Autolock lock(s_lock);
+
+    if (!s_captureFile && !s_captureFailed) {
+        const char *fileName = getenv("ANDROID_GL_CAPTURE");
+        s_captureFile = fileName ? fopen(fileName, "wb") : NULL;
+        StreamCaptureHeader hdr = { STREAM_CAPTURE_MAGIC, STREAM_CAPTURE_VERSION };
+        if (!s_captureFile || fwrite(&hdr, sizeof(hdr), 1, s_captureFile) != 1) {
+            fprintf(stderr, "StreamCapture: cannot write %s\n", fileName);
+            if (s_captureFile) {
+                fclose(s_captureFile);
+                s_captureFile = NULL;
+            }
+            s_captureFailed = true;
+        }
+    }
+    if (!s_captureFile) {
+        return 0;
+    }
+
+    return android_atomic_inc(&s_lastConnId) + 1;
+}
+
+void StreamCapture::record(uint32_t connId, const unsigned char *buf, size_t len)
+{
+    if (connId == 0 || len == 0) {
+        return;
+    }
+
+    StreamCaptureRecord rec;
+    rec.connId = connId;
+    rec.len = len;
+    rec.timeUS = GetCurrentTimeUS();
+
+    android::Mutex::Autolock lock(s_lock);
+    if (s_captureFile) {
+        fwrite(&rec, sizeof(rec), 1, s_captureFile);
+        fwrite(buf, 1, len, s_captureFile);
+    }
+}
+
+void StreamCapture::endConnection(uint32_t connId)
+{
+    if (connId == 0) {
+        return;
+    }
+
+    StreamCaptureRecord rec;
+    rec.connId = connId;
+    rec.len = 0;
+    rec.timeUS = GetCurrentTimeUS();
+
+    android::Mutex::Autolock lock(s_lock);
+    if (s_captureFile) {
+        fwrite(&rec, sizeof(rec), 1, s_captureFile);
+        fflush(s_captureFile);
+    }
+}
+
+//
+// ReplayStream - stream of a replayed connection. Reads block until the
+//     replay hands a record to the stream, whatever the decoders write
+//     back is dropped.
+//
+class ReplayStream : public IOStream
+{
+public:
+    ReplayStream() :
+        IOStream(64 * 1024),
+        m_writeBuf(NULL),
+        m_writeBufSize(0),
+        m_data(NULL),
+        m_left(0),
+        m_fed(0),
+        m_done(0),
+        m_closed(false)
+    {
+    }
+
+    ~ReplayStream() {
+        free(m_writeBuf);
+    }
+
+    // feed - hand 'len' bytes to the render thread reading the stream
+    void feed(const unsigned char *data, size_t len) {
+        android::Mutex::Autolock lock(m_lock);
+        m_data = data;
+        m_left = len;
+        m_fed++;
+        m_cond.broadcast();
+    }
+
+    //
+    // waitConsumed - wait up to 'timeoutNS' for the render thread to ask
+    //     for more data, which it only does after decoding all the complete
+    //     packets it was fed. Returns false on timeout.
+    //
+    bool waitConsumed(long long timeoutNS) {
+        android::Mutex::Autolock lock(m_lock);
+        if (m_done != m_fed && !m_closed) {
+            m_cond.waitRelative(m_lock, timeoutNS);
+        }
+        return m_done == m_fed || m_closed;
+    }
+
+    // close - makes the render thread see the end of the connection
+    void close() {
+        android::Mutex::Autolock lock(m_lock);
+        m_closed = true;
+        m_cond.broadcast();
+    }
+
+    virtual void *allocBuffer(size_t minSize) {
+        if (minSize > m_writeBufSize) {
+            free(m_writeBuf);
+            m_writeBufSize = 0;
+            m_writeBuf = (unsigned char *)malloc(minSize);
+            if (!m_writeBuf) {
+                return NULL;
+            }
+            m_writeBufSize = minSize;
+        }
+        return m_writeBuf;
+    }
+
+    virtual int commitBuffer(size_t size) { return size; }
+    virtual int writeFully(const void *buf, size_t len) { return 0; }
+
+    virtual const unsigned char *read(void *buf, size_t *inout_len) {
+        android::Mutex::Autolock lock(m_lock);
+        if (m_left == 0) {
+            // everything handed so far has been decoded
+            m_done = m_fed;
+            m_cond.broadcast();
+            while (m_left == 0 && !m_closed) {
+                m_cond.wait(m_lock);
+            }
+            if (m_left == 0) {
+                return NULL;
+            }
+        }
+
+        size_t len = *inout_len < m_left ? *inout_len : m_left;
+        memcpy(buf, m_data, len);
+        m_data += len;
+        m_left -= len;
+        *inout_len = len;
+        return (const unsigned char *)buf;
+    }
+
+    virtual const unsigned char *readFully(void *buf, size_t len) {
+        unsigned char *dst = (unsigned char *)buf;
+        while (len > 0) {
+            size_t n = len;
+            if (!read(dst, &n)) {
+                return NULL;
+            }
+            dst += n;
+            len -= n;
+        }
+        return (const unsigned char *)buf;
+    }
+
+private:
+    unsigned char *m_writeBuf;
+    size_t m_writeBufSize;
+
+    android::Mutex m_lock;
+    android::Condition m_cond;
+    const unsigned char *m_data;
+    size_t m_left;
+    unsigned int m_fed;     // records handed to the stream
+    unsigned int m_done;    // records fully consumed by the render thread
+    bool m_closed;
+};
+
+struct ReplayConnection {
+    ReplayStream *stream;   // owned by the render thread
+    RenderThread *thread;
+    bool exited;            // the thread stopped decoding on its own
+};
+typedef std::map<uint32_t, ReplayConnection> ReplayConnectionMap;
+
+static void endReplayConnection(ReplayConnection *conn)
+{
+    conn->stream->close();
+    int exitStatus;
+    conn->thread->wait(&exitStatus);
+    delete conn->thread;
+}
+
+bool StreamCapture::replay(const char *p_fileName)
+{
+    FILE *fp = fopen(p_fileName, "rb");
+    if (!fp) {
+        fprintf(stderr, "StreamCapture: cannot open %s\n", p_fileName);
+        return false;
+    }
+
+    StreamCaptureHeader hdr;
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1 ||
+        hdr.magic != STREAM_CAPTURE_MAGIC ||
+        hdr.version != STREAM_CAPTURE_VERSION) {
+        fprintf(stderr, "StreamCapture: %s is not a capture file\n", p_fileName);
+        fclose(fp);
+        return false;
+    }
+
+    ReplayConnectionMap conns;
+    unsigned char *data = NULL;
+    size_t dataSize = 0;
+    unsigned long long totalBytes = 0;
+    unsigned int nRecords = 0;
+    long long t0 = GetCurrentTimeUS();
+
+    StreamCaptureRecord rec;
+    while (fread(&rec, sizeof(rec), 1, fp) == 1) {
+        ReplayConnectionMap::iterator c = conns.find(rec.connId);
+
+        if (rec.len == 0) {
+            if (c != conns.end()) {
+                endReplayConnection(&c->second);
+                conns.erase(c);
+            }
+            continue;
+        }
+
+        if (rec.len > dataSize) {
+            unsigned char *buf = (unsigned char *)realloc(data, rec.len);
+            if (!buf) {
+                fprintf(stderr, "StreamCapture: out of memory\n");
+                break;
+            }
+            data = buf;
+            dataSize = rec.len;
+        }
+        if (fread(data, 1, rec.len, fp) != rec.len) {
+            fprintf(stderr, "StreamCapture: truncated capture\n");
+            break;
+        }
+
+        if (c == conns.end()) {
+            ReplayConnection conn;
+            conn.stream = new ReplayStream();
+            conn.thread = RenderThread::createReplay(conn.stream);
+            conn.exited = false;
+            if (!conn.thread || !conn.thread->start()) {
+                fprintf(stderr, "StreamCapture: cannot start a render thread\n");
+                delete conn.thread;
+                break;
+            }
+            c = conns.insert(std::make_pair(rec.connId, conn)).first;
+        }
+
+        //
+        // a thread stops reading on a protocol error, the rest of its
+        // records are dropped.
+        //
+        ReplayConnection &conn = c->second;
+        if (conn.exited) {
+            continue;
+        }
+        conn.stream->feed(data, rec.len);
+        while (!conn.stream->waitConsumed(100000000LL)) {
+            int exitStatus;
+            if (conn.thread->trywait(&exitStatus)) {
+                conn.exited = true;
+                break;
+            }
+        }
+        totalBytes += rec.len;
+        nRecords++;
+    }
+
+    for (ReplayConnectionMap::iterator c = conns.begin(); c != conns.end(); c++) {
+        endReplayConnection(&c->second);
+    }
+
+    long long dt = GetCurrentTimeUS() - t0;
+    fprintf(stderr, "StreamCapture: replayed %u records, %llu bytes in %lld ms (%.3f MB/s)\n",
+            nRecords, totalBytes, dt / 1000,
+            dt > 0 ? ((double)totalBytes / (1024.0 * 1024.0)) / ((double)dt / 1000000.0) : 0.0);
+
+    free(data);
+    fclose(fp);
+    return true;
+}
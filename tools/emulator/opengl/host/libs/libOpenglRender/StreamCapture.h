@@ -0,0 +1,77 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _LIB_OPENGL_RENDER_STREAM_CAPTURE_H
+#define _LIB_OPENGL_RENDER_STREAM_CAPTURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//
+// StreamCapture - records the command streams received by all render
+//    threads into a single file, and replays such a file with the same
+//    decoders, without any guest. Replaying runs as fast as the host
+//    renderer can go, which makes a capture a throughput benchmark of the
+//    host GL implementation.
+//
+//    Capture is enabled by setting ANDROID_GL_CAPTURE to the name of the
+//    file to write.
+//
+//    The file is a StreamCaptureHeader followed by records, each one a
+//    StreamCaptureRecord and 'len' bytes of stream data, in the order the
+//    data was received. A record with a zero 'len' marks the end of a
+//    connection. Data is recorded before it is decoded, so a connection
+//    which waited for a reply of another one is always recorded after it.
+//
+#define STREAM_CAPTURE_MAGIC   0x50434c47  // 'GLCP'
+#define STREAM_CAPTURE_VERSION 1
+
+struct StreamCaptureHeader {
+    uint32_t magic;
+    uint32_t version;
+};
+
+struct StreamCaptureRecord {
+    uint32_t connId;
+    uint32_t len;
+    uint64_t timeUS;    // when the data was received
+};
+
+class StreamCapture
+{
+public:
+    static bool enabled();
+
+    // returns the id of a new captured connection, 0 if capture failed
+    static uint32_t newConnection();
+
+    // record - append 'len' bytes received by connection 'connId'
+    static void record(uint32_t connId, const unsigned char *buf, size_t len);
+
+    // endConnection - record the end of connection 'connId'
+    static void endConnection(uint32_t connId);
+
+    //
+    // replay - decode the capture 'p_fileName' with one render thread per
+    //     recorded connection. The data of each record is handed to its
+    //     thread only once the previous record has been decoded, so the
+    //     order across connections is the recorded one. The FrameBuffer
+    //     must have been initialized. Prints the replay throughput and
+    //     returns false if the file cannot be read.
+    //
+    static bool replay(const char *p_fileName);
+};
+
+#endif
@@ -18,12 +18,43 @@
 
 #include "RenderContext.h"
 #include "WindowSurface.h"
+#include "GpuMemory.h"
+#include <stdint.h>
+#include <string.h>
+
+struct FrameTraceRing;
+class FrameBuffer;
 
 struct RenderThreadInfo
 {
+    RenderThreadInfo() : frameBuffer(NULL), memAccount(NULL), connId(0),
+                         lastReadUS(0), traceRing(NULL) {
+        memset(reservedHandles, 0, sizeof(reservedHandles));
+    }
+
+    // framebuffer of the tenant the thread works for, NULL for the
+    // default one, see FrameBuffer::getFB()
+    FrameBuffer *frameBuffer;
+
+    // GPU memory account of the connection, NULL outside of connections
+    GpuMemoryAccount *memAccount;
+
     RenderContextPtr currContext;
     WindowSurfacePtr currDrawSurf;
     WindowSurfacePtr currReadSurf;
+
+    // the handles the connection reserved last for each object type (see
+    // rcReserveHandles), it takes them in order from 'next'
+    struct HandleRange {
+        uint32_t next;
+        uint32_t end;
+    };
+    HandleRange reservedHandles[3];
+
+    // frame tracing state, see FrameTrace.h
+    uint32_t connId;
+    long long lastReadUS;
+    FrameTraceRing *traceRing;
 };
 
 RenderThreadInfo *getRenderThreadInfo();
@@ -27,20 +27,33 @@ WindowSurface::WindowSurface() :
     m_fbObj(0),
     m_depthRB(0),
     m_stencilRB(0),
+    m_colorRB(0),
+    m_fbOwner(NULL),
+    m_depthSize(0),
+    m_stencilSize(0),
     m_eglSurface(NULL),
     m_attachedColorBuffer(NULL),
     m_readContext(NULL),
     m_drawContext(NULL),
     m_width(0),
     m_height(0),
+    m_config(0),
     m_useEGLImage(false),
-    m_useBindToTexture(false)
+    m_useBindToTexture(false),
+    m_useCopyTexture(true)
 {
 }
 
 WindowSurface::~WindowSurface()
 {
-    s_egl.eglDestroySurface(FrameBuffer::getFB()->getDisplay(), m_eglSurface);
+    // the pbuffer of a surface using EGLImage is shared, see create()
+    if (!m_useEGLImage) {
+        s_egl.eglDestroySurface(FrameBuffer::getFB()->getDisplay(), m_eglSurface);
+    }
+    else if (m_attachedColorBuffer.Ptr() != NULL) {
+        m_attachedColorBuffer->setDirectTarget(false);
+    }
+    releaseTargetObjects();
 }
 
 WindowSurface *WindowSurface::create(int p_config, int p_width, int p_height)
@@ -61,16 +74,27 @@ WindowSurface *WindowSurface::create(int p_config, int p_width, int p_height)
 
     //
     // We can use eglimage and prevent copies if:
-    //     GL_KHR_gl_texture_2D_image is present.
-    //     and either there is no need for depth or stencil buffer
-    //     or GL_KHR_gl_renderbuffer_image present.
+    //     EGL_KHR_gl_texture_2D_image is present, for the color buffer image
+    //     and a framebuffer object can render into it.
     //
     win->m_useEGLImage =
-         (caps.has_eglimage_texture_2d &&
-          (caps.has_eglimage_renderbuffer ||
-           (fbconf->getDepthSize() + fbconf->getStencilSize() == 0)) );
+         (caps.has_eglimage_texture_2d && caps.has_eglimage_renderbuffer);
 
     if (win->m_useEGLImage) {
+        //
+        // Rendering goes to a framebuffer object attached to the color
+        // buffer image, a drawable is only needed to make the context
+        // current. All such surfaces of a config share the same 1x1
+        // pbuffer, so binding another surface does not switch the native
+        // drawable and creating one does not allocate any.
+        //
+        win->m_eglSurface = fb->getConfigPbuffer(p_config);
+        if (win->m_eglSurface == EGL_NO_SURFACE) {
+            delete win;
+            return NULL;
+        }
+        win->m_depthSize = fbconf->getDepthSize();
+        win->m_stencilSize = fbconf->getStencilSize();
     }
     else if (0 != (fbconf->getSurfaceType() & EGL_PBUFFER_BIT)) {
 
@@ -113,6 +137,19 @@ WindowSurface *WindowSurface::create(int p_config, int p_width, int p_height)
 
     win->m_width = p_width;
     win->m_height = p_height;
+    win->m_config = p_config;
+
+    //
+    // a surface rendering into its color buffer only allocates the depth
+    // and stencil buffers, sized as the surface, otherwise its pbuffer
+    // holds 32 bits color pixels as well
+    //
+    long long pixelBits = fbconf->getDepthSize() + fbconf->getStencilSize();
+    if (!win->m_useEGLImage) {
+        pixelBits += 32;
+    }
+    win->m_memUsage.init(fb->getMemAccount());
+    win->m_memUsage.set((long long)p_width * p_height * pixelBits / 8, 0);
 
     return win;
 }
@@ -125,6 +162,14 @@ WindowSurface *WindowSurface::create(int p_config, int p_width, int p_height)
 //
 void WindowSurface::setColorBuffer(ColorBufferPtr p_colorBuffer)
 {
+    //
+    // the copy and the release of the previous color buffer are both done
+    // with the framebuffer context, keep it bound for the whole switch.
+    //
+    FrameBuffer *fb = FrameBuffer::getFB();
+    bool fbBound = !m_useEGLImage && m_attachedColorBuffer.Ptr() != NULL &&
+                   fb->bind_locked();
+
     if (m_attachedColorBuffer.Ptr() != NULL) {
 
         if (!m_useEGLImage) {
@@ -133,15 +178,55 @@ void WindowSurface::setColorBuffer(ColorBufferPtr p_colorBuffer)
                 copied = m_attachedColorBuffer->blitFromPbuffer(m_eglSurface);
             }
 
+            //
+            // copy on the GPU if possible, otherwise fall back to
+            // readback and download for good.
+            //
+            if (!copied && m_useCopyTexture &&
+                m_attachedColorBuffer->getWidth() == m_width &&
+                m_attachedColorBuffer->getHeight() == m_height) {
+                copied = m_attachedColorBuffer->copyFromPbuffer(m_eglSurface);
+                m_useCopyTexture = copied;
+            }
+
             if (!copied) {
                 copyToColorBuffer();
             }
+            m_attachedColorBuffer->markRendered();
         }
-        else {
+        else if (m_drawContext.Ptr() != NULL &&
+                 s_egl.eglGetCurrentContext() == m_drawContext->getEGLContext()) {
+            // the previous color buffer has been rendered to directly,
+            // just make sure the rendering has been submitted.
+            if (m_drawContext->isGL2()) {
+#ifdef WITH_GLES2
+                s_gl2.glFlush();
+#endif
+            }
+            else {
+                s_gl.glFlush();
+            }
+        }
+    }
+
+    if (m_useEGLImage) {
+        if (m_attachedColorBuffer.Ptr() != NULL) {
+            m_attachedColorBuffer->setDirectTarget(false);
+        }
+        if (p_colorBuffer.Ptr() != NULL) {
+            p_colorBuffer->setDirectTarget(true);
         }
     }
 
     m_attachedColorBuffer = p_colorBuffer;
+    if (fbBound) {
+        fb->unbind_locked();
+    }
+
+    if (m_useEGLImage && m_drawContext.Ptr() != NULL &&
+        s_egl.eglGetCurrentContext() == m_drawContext->getEGLContext()) {
+        attachColorBufferImage();
+    }
 }
 
 //
@@ -166,9 +251,160 @@ void WindowSurface::bind(RenderContextPtr p_ctx, SurfaceBindType p_bindType)
         return;  // bad param
     }
 
-    if (m_useEGLImage) {
-        // XXX: should be implemented
+    if (m_useEGLImage && m_drawContext.Ptr() != NULL &&
+        p_bindType != SURFACE_BIND_READ) {
+        attachColorBufferImage();
+    }
+}
+
+//
+// attachColorBufferImage - called with the draw context current, make the
+//    attached color buffer image the render target of that context.
+//    The framebuffer object is created the first time the surface is bound
+//    to a context. When the surface moves to another context the objects
+//    are given back to the previous one, which deletes them, and created
+//    again in the new one. The framebuffer object stands for the guest
+//    framebuffer 0 of the context, one the guest bound stays bound.
+//
+void WindowSurface::attachColorBufferImage()
+{
+    if (m_attachedColorBuffer.Ptr() == NULL ||
+        m_attachedColorBuffer->getEGLImage() == NULL) {
+        return;
+    }
+
+    // rendering now goes straight into the color buffer
+    m_attachedColorBuffer->setRenderedDirectly();
+
+    bool firstBind = (m_fbOwner.Ptr() != m_drawContext.Ptr());
+    if (firstBind) {
+        releaseTargetObjects();
+        m_fbOwner = m_drawContext;
+    }
+
+    GLint guestFbo = 0;
+    GLuint prevDefault = m_drawContext->getDefaultFramebuffer();
+
+    if (m_drawContext->isGL2()) {
+#ifdef WITH_GLES2
+        // the OES enums have the same values as the GLES2 core ones
+        s_gl2.glGetIntegerv(GL_FRAMEBUFFER_BINDING_OES, &guestFbo);
+        if (firstBind) {
+            s_gl2.glGenFramebuffers(1, &m_fbObj);
+            s_gl2.glGenRenderbuffers(1, &m_colorRB);
+            s_gl2.glBindFramebuffer(GL_FRAMEBUFFER_OES, m_fbObj);
+            if (m_depthSize > 0) {
+                s_gl2.glGenRenderbuffers(1, &m_depthRB);
+                s_gl2.glBindRenderbuffer(GL_RENDERBUFFER_OES, m_depthRB);
+                s_gl2.glRenderbufferStorage(GL_RENDERBUFFER_OES,
+                                            GL_DEPTH_COMPONENT16_OES,
+                                            m_width, m_height);
+                s_gl2.glFramebufferRenderbuffer(GL_FRAMEBUFFER_OES,
+                                                GL_DEPTH_ATTACHMENT_OES,
+                                                GL_RENDERBUFFER_OES, m_depthRB);
+            }
+            if (m_stencilSize > 0) {
+                s_gl2.glGenRenderbuffers(1, &m_stencilRB);
+                s_gl2.glBindRenderbuffer(GL_RENDERBUFFER_OES, m_stencilRB);
+                s_gl2.glRenderbufferStorage(GL_RENDERBUFFER_OES,
+                                            GL_STENCIL_INDEX8_OES,
+                                            m_width, m_height);
+                s_gl2.glFramebufferRenderbuffer(GL_FRAMEBUFFER_OES,
+                                                GL_STENCIL_ATTACHMENT_OES,
+                                                GL_RENDERBUFFER_OES, m_stencilRB);
+            }
+        }
+        else {
+            s_gl2.glBindFramebuffer(GL_FRAMEBUFFER_OES, m_fbObj);
+        }
+
+        s_gl2.glBindRenderbuffer(GL_RENDERBUFFER_OES, m_colorRB);
+        s_gl2.glEGLImageTargetRenderbufferStorageOES(GL_RENDERBUFFER_OES,
+                          (GLeglImageOES)m_attachedColorBuffer->getEGLImage());
+        s_gl2.glFramebufferRenderbuffer(GL_FRAMEBUFFER_OES, GL_COLOR_ATTACHMENT0_OES,
+                                        GL_RENDERBUFFER_OES, m_colorRB);
+        if (guestFbo && (GLuint)guestFbo != prevDefault) {
+            s_gl2.glBindFramebuffer(GL_FRAMEBUFFER_OES, guestFbo);
+        }
+        if (firstBind) {
+            s_gl2.glViewport(0, 0, m_width, m_height);
+            s_gl2.glScissor(0, 0, m_width, m_height);
+        }
+#else
+        return; // should never happen, context cannot be GL2 in this case.
+#endif
+    }
+    else {
+        s_gl.glGetIntegerv(GL_FRAMEBUFFER_BINDING_OES, &guestFbo);
+        if (firstBind) {
+            s_gl.glGenFramebuffersOES(1, &m_fbObj);
+            s_gl.glGenRenderbuffersOES(1, &m_colorRB);
+            s_gl.glBindFramebufferOES(GL_FRAMEBUFFER_OES, m_fbObj);
+            if (m_depthSize > 0) {
+                s_gl.glGenRenderbuffersOES(1, &m_depthRB);
+                s_gl.glBindRenderbufferOES(GL_RENDERBUFFER_OES, m_depthRB);
+                s_gl.glRenderbufferStorageOES(GL_RENDERBUFFER_OES,
+                                              GL_DEPTH_COMPONENT16_OES,
+                                              m_width, m_height);
+                s_gl.glFramebufferRenderbufferOES(GL_FRAMEBUFFER_OES,
+                                                  GL_DEPTH_ATTACHMENT_OES,
+                                                  GL_RENDERBUFFER_OES, m_depthRB);
+            }
+            if (m_stencilSize > 0) {
+                s_gl.glGenRenderbuffersOES(1, &m_stencilRB);
+                s_gl.glBindRenderbufferOES(GL_RENDERBUFFER_OES, m_stencilRB);
+                s_gl.glRenderbufferStorageOES(GL_RENDERBUFFER_OES,
+                                              GL_STENCIL_INDEX8_OES,
+                                              m_width, m_height);
+                s_gl.glFramebufferRenderbufferOES(GL_FRAMEBUFFER_OES,
+                                                  GL_STENCIL_ATTACHMENT_OES,
+                                                  GL_RENDERBUFFER_OES, m_stencilRB);
+            }
+        }
+        else {
+            s_gl.glBindFramebufferOES(GL_FRAMEBUFFER_OES, m_fbObj);
+        }
+
+        s_gl.glBindRenderbufferOES(GL_RENDERBUFFER_OES, m_colorRB);
+        s_gl.glEGLImageTargetRenderbufferStorageOES(GL_RENDERBUFFER_OES,
+                          (GLeglImageOES)m_attachedColorBuffer->getEGLImage());
+        s_gl.glFramebufferRenderbufferOES(GL_FRAMEBUFFER_OES,
+                                          GL_COLOR_ATTACHMENT0_OES,
+                                          GL_RENDERBUFFER_OES, m_colorRB);
+        if (guestFbo && (GLuint)guestFbo != prevDefault) {
+            s_gl.glBindFramebufferOES(GL_FRAMEBUFFER_OES, guestFbo);
+        }
+        if (firstBind) {
+            s_gl.glViewport(0, 0, m_width, m_height);
+            s_gl.glScissor(0, 0, m_width, m_height);
+        }
+    }
+
+    m_drawContext->setDefaultFramebuffer(m_fbObj);
+}
+
+//
+// releaseTargetObjects - the framebuffer object and renderbuffers are
+//    deleted in the context which created them, right away when it is
+//    current in this thread, otherwise the next time it is made current.
+//
+void WindowSurface::releaseTargetObjects()
+{
+    if (m_fbOwner.Ptr() == NULL) {
+        return;
+    }
+
+    GLuint renderbuffers[3] = { m_colorRB, m_depthRB, m_stencilRB };
+    m_fbOwner->releaseObjects(m_fbObj, renderbuffers, 3);
+    if (s_egl.eglGetCurrentContext() == m_fbOwner->getEGLContext()) {
+        m_fbOwner->deleteReleasedObjects();
     }
+
+    m_fbOwner = RenderContextPtr(NULL);
+    m_fbObj = 0;
+    m_colorRB = 0;
+    m_depthRB = 0;
+    m_stencilRB = 0;
 }
 
 void WindowSurface::copyToColorBuffer()
@@ -199,11 +435,14 @@ void WindowSurface::copyToColorBuffer()
         return;
     }
 
+    // read in the host layout, which is usually the one of the color buffer
+    GLenum format = fb->getCaps().readbackFormat;
+
     if (m_drawContext->isGL2()) {
 #ifdef WITH_GLES2
         s_gl2.glPixelStorei(GL_PACK_ALIGNMENT, 1);
         s_gl2.glReadPixels(0, 0, m_width, m_height,
-                          GL_RGBA, GL_UNSIGNED_BYTE, data);
+                          format, GL_UNSIGNED_BYTE, data);
 #else
         return; // should never happen, context cannot be GL2 in this case.
 #endif
@@ -211,11 +450,11 @@ void WindowSurface::copyToColorBuffer()
     else {
         s_gl.glPixelStorei(GL_PACK_ALIGNMENT, 1);
         s_gl.glReadPixels(0, 0, m_width, m_height,
-                          GL_RGBA, GL_UNSIGNED_BYTE, data);
+                          format, GL_UNSIGNED_BYTE, data);
     }
 
     // update the attached color buffer with the readback pixels
-    m_attachedColorBuffer->update(GL_RGBA, GL_UNSIGNED_BYTE, data);
+    m_attachedColorBuffer->update(format, GL_UNSIGNED_BYTE, data);
 
     // restore current context/surface
     s_egl.eglMakeCurrent(fb->getDisplay(), prevDrawSurf,
@@ -20,6 +20,7 @@
 #include "RenderContext.h"
 #include "SmartPtr.h"
 #include "FixedBuffer.h"
+#include "GpuMemory.h"
 #include <EGL/egl.h>
 #include <GLES/gl.h>
 
@@ -35,28 +36,47 @@ public:
     static WindowSurface *create(int p_config, int p_width, int p_height);
     ~WindowSurface();
     EGLSurface getEGLSurface() const { return m_eglSurface; }
+    int getConfig() const { return m_config; }
+    GLuint getWidth() const { return m_width; }
+    GLuint getHeight() const { return m_height; }
+    const ColorBufferPtr &getColorBuffer() const { return m_attachedColorBuffer; }
 
     void setColorBuffer(ColorBufferPtr p_colorBuffer);
     void bind(RenderContextPtr p_ctx, SurfaceBindType p_bindType);
+    bool isBound(const RenderContextPtr &p_ctx, SurfaceBindType p_bindType) const {
+        return (p_bindType == SURFACE_BIND_DRAW ||
+                m_readContext.Ptr() == p_ctx.Ptr()) &&
+               (p_bindType == SURFACE_BIND_READ ||
+                m_drawContext.Ptr() == p_ctx.Ptr());
+    }
 
 private:
     WindowSurface();
 
     void copyToColorBuffer();  // copy pbuffer content with readback+download
+    void attachColorBufferImage();  // render into the color buffer EGLImage
+    void releaseTargetObjects();    // give the objects below back to m_fbOwner
 
 private:
     GLuint m_fbObj;   // GLES Framebuffer object (when EGLimage is used)
     GLuint m_depthRB;
     GLuint m_stencilRB;
+    GLuint m_colorRB;
+    RenderContextPtr m_fbOwner;  // context which created the objects above
+    GLuint m_depthSize;
+    GLuint m_stencilSize;
     EGLSurface m_eglSurface;
     ColorBufferPtr m_attachedColorBuffer;
     RenderContextPtr m_readContext;
     RenderContextPtr m_drawContext;
     GLuint m_width;
     GLuint m_height;
+    int m_config;
     bool m_useEGLImage;
     bool m_useBindToTexture;
+    bool m_useCopyTexture;    // glCopyTexSubImage2D with the FB context works
     FixedBuffer m_xferBuffer;
+    GpuMemoryUsage m_memUsage;
 };
 
 typedef SmartPtr<WindowSurface> WindowSurfacePtr;
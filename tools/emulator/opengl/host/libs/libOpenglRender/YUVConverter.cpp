@@ -0,0 +1,96 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "YUVConverter.h"
+#include "glUtils.h"
+
+bool YUVConverter::isYUVFormat(GLenum p_format)
+{
+    return p_format == GLUTILS_FORMAT_YCRCB_420_SP ||
+           p_format == GLUTILS_FORMAT_YV12;
+}
+
+static inline unsigned char clamp10(int v)
+{
+    // v is in 2^10 fixed point
+    if (v < 0) return 0;
+    if (v > 262143) return 255;
+    return (unsigned char)(v >> 10);
+}
+
+//
+// converts two rows of Y sharing one row of chroma samples. The BT.601
+// coefficients are the ones of tools/yuv420sp2rgb, each chroma sample
+// is only weighted once for the four pixels it covers.
+//
+static void convertRows(int width, const unsigned char *y0,
+                        const unsigned char *y1,
+                        const unsigned char *u, const unsigned char *v,
+                        int chromaStep,
+                        unsigned char *rgba0, unsigned char *rgba1)
+{
+    for (int x = 0; x < width; x += 2) {
+        int nU = *u - 128;
+        int nV = *v - 128;
+        int r = 1634 * nV;
+        int g = -833 * nV - 400 * nU;
+        int b = 2066 * nU;
+        u += chromaStep;
+        v += chromaStep;
+
+        const unsigned char *ys[4] = { y0 + x, y0 + x + 1, y1 + x, y1 + x + 1 };
+        unsigned char *out[4] = { rgba0 + x * 4, rgba0 + x * 4 + 4,
+                                  rgba1 + x * 4, rgba1 + x * 4 + 4 };
+        for (int i = 0; i < 4; i++) {
+            int nY = *ys[i] - 16;
+            if (nY < 0) nY = 0;
+            nY *= 1192;
+            out[i][0] = clamp10(nY + r);
+            out[i][1] = clamp10(nY + g);
+            out[i][2] = clamp10(nY + b);
+            out[i][3] = 0xff;
+        }
+    }
+}
+
+void YUVConverter::yuvToRGBA(GLenum p_format, int width, int height,
+                             const unsigned char *yuv, unsigned char *rgba)
+{
+    const unsigned char *yPlane = yuv;
+    const unsigned char *uPlane;
+    const unsigned char *vPlane;
+    int chromaStep;     // distance between two samples of a chroma row
+    int chromaStride;   // distance between two chroma rows
+
+    if (p_format == GLUTILS_FORMAT_YCRCB_420_SP) {
+        vPlane = yuv + width * height;
+        uPlane = vPlane + 1;
+        chromaStep = 2;
+        chromaStride = width;
+    }
+    else {
+        vPlane = yuv + width * height;
+        uPlane = vPlane + (width / 2) * (height / 2);
+        chromaStep = 1;
+        chromaStride = width / 2;
+    }
+
+    for (int y = 0; y < height; y += 2) {
+        int c = (y / 2) * chromaStride;
+        convertRows(width, yPlane + y * width, yPlane + (y + 1) * width,
+                    uPlane + c, vPlane + c, chromaStep,
+                    rgba + y * width * 4, rgba + (y + 1) * width * 4);
+    }
+}
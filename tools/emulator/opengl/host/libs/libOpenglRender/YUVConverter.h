@@ -0,0 +1,39 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _LIBRENDER_YUV_CONVERTER_H
+#define _LIBRENDER_YUV_CONVERTER_H
+
+#include <GLES/gl.h>
+
+//
+// YUVConverter - conversion of the YUV 4:2:0 guest buffers to the RGBA
+//     pixels of their color buffer. The guest sends the planes as they
+//     are, with no row padding:
+//     GLUTILS_FORMAT_YCRCB_420_SP (NV21) - Y plane, then interleaved V/U
+//     GLUTILS_FORMAT_YV12 - Y plane, then the V plane, then the U plane.
+//     'width' and 'height' must be even.
+//
+class YUVConverter
+{
+public:
+    static bool isYUVFormat(GLenum p_format);
+
+    // yuvToRGBA - converts 'yuv' into width x height RGBA pixels
+    static void yuvToRGBA(GLenum p_format, int width, int height,
+                          const unsigned char *yuv, unsigned char *rgba);
+};
+
+#endif
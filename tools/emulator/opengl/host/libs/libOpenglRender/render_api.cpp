@@ -16,13 +16,93 @@
 #include "libOpenglRender/render_api.h"
 #include "FrameBuffer.h"
 #include "RenderServer.h"
+#include "RenderTenant.h"
+#include "ShmStream.h"
+#include "TcpStream.h"
+#include "UnixStream.h"
 #include "osProcess.h"
 #include "TimeUtils.h"
+#ifndef _WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#endif
 
 static osUtils::childProcess *s_renderProc = NULL;
 static RenderServer *s_renderThread = NULL;
 static int s_renderPort = 0;
 
+// attach connection and id of our tenant of a shared renderer, see
+// RenderTenant.h, the tenant is released when the connection closes
+static SocketStream *s_tenantSock = NULL;
+static uint32_t s_tenantId = 0;
+
+//
+// connectRenderer - a new connection to the renderer port, through its Unix
+//     domain socket if ANDROID_RENDER_UNIX is set (see RenderServer.h).
+//
+static SocketStream *connectRenderer(size_t p_bufSize)
+{
+#ifndef _WIN32
+    if (getenv("ANDROID_RENDER_UNIX")) {
+        UnixStream *stream = new UnixStream(p_bufSize);
+        if (stream->connect(s_renderPort) < 0) {
+            delete stream;
+            return NULL;
+        }
+        return stream;
+    }
+#endif
+
+    TcpStream *stream = new TcpStream(p_bufSize);
+    if (stream->connect("localhost", s_renderPort) < 0) {
+        delete stream;
+        return NULL;
+    }
+    return stream;
+}
+
+// how long to wait for emulator_renderer to listen to its port
+#define RENDERER_START_TIMEOUT_MS 3000
+
+#ifndef _WIN32
+//
+// waitRendererReady - blocks until emulator_renderer writes a byte on the
+//     'readyFd' pipe, which it does once its render server is listening.
+//     The pipe reaches end of file if the renderer exits before that.
+//
+static bool waitRendererReady(int readyFd)
+{
+    long long deadline = GetCurrentTimeMS() + RENDERER_START_TIMEOUT_MS;
+    for (;;) {
+        int timeout = (int)(deadline - GetCurrentTimeMS());
+        if (timeout < 0) {
+            timeout = 0;
+        }
+
+        struct pollfd pfd;
+        pfd.fd = readyFd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int ret = poll(&pfd, 1, timeout);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            return false;
+        }
+
+        char c;
+        ssize_t n = read(readyFd, &c, 1);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        return n == 1;
+    }
+}
+#endif
+
 bool initOpenGLRenderer(FBNativeWindowType window,
                         int x, int y, int width, int height,
                         int portNum)
@@ -31,12 +111,29 @@ bool initOpenGLRenderer(FBNativeWindowType window,
     //
     // Fail if renderer is already initialized
     //
-    if (s_renderProc || s_renderThread) {
+    if (s_renderProc || s_renderThread || s_tenantSock) {
         return false;
     }
 
     s_renderPort = portNum;
 
+    //
+    // share a renderer process with other emulators if asked to
+    //
+    const char *sharedPort = getenv("ANDROID_SHARED_RENDERER_PORT");
+    if (sharedPort) {
+        s_renderPort = atoi(sharedPort);
+        s_tenantSock = connectRenderer(10000);
+        if (!s_tenantSock ||
+            (s_tenantId = RenderTenant::attach(s_tenantSock, window,
+                                               x, y, width, height)) == 0) {
+            delete s_tenantSock;
+            s_tenantSock = NULL;
+            return false;
+        }
+        return true;
+    }
+
 #ifdef RENDER_API_USE_THREAD  // should be defined for mac
     //
     // initialize the renderer and listen to connections
@@ -47,6 +144,12 @@ bool initOpenGLRenderer(FBNativeWindowType window,
         return false;
     }
 
+    // objects of the guest resumed from a VM snapshot
+    const char *restore = getenv("ANDROID_RENDER_RESTORE");
+    if (restore && !FrameBuffer::getFB()->restoreSnapshot(restore)) {
+        return false;
+    }
+
     s_renderThread = RenderServer::create(portNum);
     if (!s_renderThread) {
         return false;
@@ -58,14 +161,59 @@ bool initOpenGLRenderer(FBNativeWindowType window,
     //
     // Launch emulator_renderer
     //
-    char cmdLine[128];
-    snprintf(cmdLine, 128, "emulator_renderer -windowid %d -port %d -x %d -y %d -width %d -height %d",
-             (int)window, portNum, x, y, width, height);
+    char cmdLine[1024];
+    int n = snprintf(cmdLine, sizeof(cmdLine), "emulator_renderer -windowid %d -port %d -x %d -y %d -width %d -height %d",
+                     (int)window, portNum, x, y, width, height);
+
+    const char *restore = getenv("ANDROID_RENDER_RESTORE");
+    if (restore) {
+        n += snprintf(cmdLine + n, sizeof(cmdLine) - n, " -restore %s",
+                      restore);
+        if (n >= (int)sizeof(cmdLine)) {
+            return false;
+        }
+    }
+
+#ifndef _WIN32
+    //
+    // the renderer tells on a pipe when it listens to the port,
+    // instead of having to poll it with connections.
+    //
+    int readyFds[2] = { -1, -1 };
+    if (pipe(readyFds) == 0) {
+        fcntl(readyFds[0], F_SETFD, FD_CLOEXEC);
+        snprintf(cmdLine + n, sizeof(cmdLine) - n, " -readyfd %d", readyFds[1]);
+    }
+
+    s_renderProc = osUtils::childProcess::create(cmdLine, NULL, readyFds[1]);
+    if (readyFds[1] >= 0) {
+        close(readyFds[1]);
+    }
+    if (!s_renderProc) {
+        if (readyFds[0] >= 0) {
+            close(readyFds[0]);
+        }
+        return false;
+    }
 
+    if (readyFds[0] >= 0) {
+        bool ready = waitRendererReady(readyFds[0]);
+        close(readyFds[0]);
+        if (!ready) {
+            osUtils::KillProcess(s_renderProc->getPID(), true);
+            delete s_renderProc;
+            s_renderProc = NULL;
+            return false;
+        }
+        return true;
+    }
+#else
+    (void)n;
     s_renderProc = osUtils::childProcess::create(cmdLine, NULL);
     if (!s_renderProc) {
         return false;
     }
+#endif
 
     //
     // try to connect to the renderer in order to check it
@@ -107,7 +255,14 @@ bool stopOpenGLRenderer()
 {
     bool ret = false;
 
-    if (s_renderProc) {
+    if (s_tenantSock) {
+        // closing the attach connection releases the tenant
+        delete s_tenantSock;
+        s_tenantSock = NULL;
+        s_tenantId = 0;
+        ret = true;
+    }
+    else if (s_renderProc) {
         //
         // kill the render process
         //
@@ -139,17 +294,86 @@ bool stopOpenGLRenderer()
     return ret;
 }
 
+bool setOpenGLDisplayTransform(int x, int y, int width, int height,
+                               int rotation, float zoom,
+                               float centerX, float centerY)
+{
+    FrameBuffer *fb = FrameBuffer::getFB();
+    if (!s_renderThread || !fb) {
+        return false;
+    }
+
+    return fb->setDisplayTransform(x, y, width, height,
+                                   rotation, zoom, centerX, centerY);
+}
+
+bool setOpenGLDisplayVisible(bool visible)
+{
+    FrameBuffer *fb = FrameBuffer::getFB();
+    if (!s_renderThread || !fb) {
+        return false;
+    }
+
+    return fb->setVisible(visible);
+}
+
+bool saveOpenGLRendererSnapshot(const char *path)
+{
+    FrameBuffer *fb = FrameBuffer::getFB();
+    if (!s_renderThread || !fb) {
+        return false;
+    }
+
+    return fb->saveSnapshot(path);
+}
+
+bool startOpenGLRecording(int width, int height,
+                          OnRecordedFrameFunc callback, void *opaque)
+{
+    FrameBuffer *fb = FrameBuffer::getFB();
+    if (!s_renderThread || !fb) {
+        return false;
+    }
+
+    return fb->startRecording(width, height, callback, opaque);
+}
+
+bool stopOpenGLRecording()
+{
+    FrameBuffer *fb = FrameBuffer::getFB();
+    if (!s_renderThread || !fb) {
+        return false;
+    }
+
+    fb->stopRecording();
+    return true;
+}
+
 IOStream *createRenderThread(int p_stream_buffer_size)
 {
-    TcpStream *stream = new TcpStream(p_stream_buffer_size);
+    SocketStream *stream = connectRenderer(p_stream_buffer_size);
     if (!stream) {
         return NULL;
     }
 
-    if (stream->connect("localhost", s_renderPort) < 0) {
+    if (s_tenantId && !RenderTenant::connect(stream, s_tenantId)) {
         delete stream;
         return NULL;
     }
 
+    //
+    // The renderer runs on the same host, try to move the connection
+    // to shared memory. Keep using the tcp stream if that fails.
+    //
+    ShmStream *shm = ShmStream::connect(stream, p_stream_buffer_size);
+    if (shm) {
+        return shm;
+    }
+
+    // a renderer reached over a slow link may take a compressed stream
+    if (getenv("ANDROID_RENDER_COMPRESS")) {
+        stream->requestCompression();
+    }
+
     return stream;
 }
@@ -25,7 +25,7 @@ LOCAL_C_INCLUDES += $(emulatorOpengl)/shared/OpenglCodecCommon \
 #we use only *_dec.h as a sentinel for the other generated headers
 GEN := $(intermediates)/renderControl_dec.cpp $(intermediates)/renderControl_dec.h
 $(GEN): PRIVATE_PATH := $(LOCAL_PATH)
-$(GEN): PRIVATE_CUSTOM_TOOL := $(EMUGEN) -D $(intermediates) -i $(emulatorOpengl)/system/renderControl_enc renderControl
+$(GEN): PRIVATE_CUSTOM_TOOL := $(EMUGEN) -J -D $(intermediates) -i $(emulatorOpengl)/system/renderControl_enc renderControl
 $(GEN): $(EMUGEN) \
 	$(emulatorOpengl)/system/renderControl_enc/renderControl.attrib \
 	$(emulatorOpengl)/system/renderControl_enc/renderControl.in \
@@ -17,17 +17,32 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 #include "FrameBuffer.h"
+#include "StreamCapture.h"
 
 static void printUsage(const char *progName)
 {
     fprintf(stderr, "Usage: %s -windowid <windowid> [options]\n", progName);
-    fprintf(stderr, "    -windowid <windowid>   - window id to render into\n");
+    fprintf(stderr, "    -windowid <windowid>   - window id to render into, 0 to render\n");
+    fprintf(stderr, "                             offscreen (frames are published in the\n");
+    fprintf(stderr, "                             ANDROID_FB_SHM shared memory object)\n");
     fprintf(stderr, "    -port <portNum>        - listening TCP port number\n");
     fprintf(stderr, "    -x <num>               - render subwindow x position\n");
     fprintf(stderr, "    -y <num>               - render subwindow y position\n");
     fprintf(stderr, "    -width <num>           - render subwindow width\n");
     fprintf(stderr, "    -height <num>          - render subwindow height\n");
+    fprintf(stderr, "    -readyfd <fd>          - write a byte to fd once listening\n");
+    fprintf(stderr, "    -replay <file>         - decode a capture written with\n");
+    fprintf(stderr, "                             ANDROID_GL_CAPTURE offscreen and exit,\n");
+    fprintf(stderr, "                             no -windowid is needed\n");
+    fprintf(stderr, "    -restore <file>        - restore the renderer snapshot file\n");
+    fprintf(stderr, "                             before listening\n");
+    fprintf(stderr, "    -multi                 - serve several emulators, each one\n");
+    fprintf(stderr, "                             attaching its own window, no\n");
+    fprintf(stderr, "                             -windowid is needed\n");
     exit(-1);
 }
 
@@ -39,7 +54,11 @@ int main(int argc, char *argv[])
     int winWidth = 320;
     int winHeight = 480;
     FBNativeWindowType windowId = NULL;
-    int iWindowId  = 0;
+    int iWindowId  = -1;
+    const char *replayFile = NULL;
+    const char *restoreFile = NULL;
+    int readyFd = -1;
+    bool multiTenant = false;
 
     //
     // Parse command line arguments
@@ -76,33 +95,77 @@ int main(int argc, char *argv[])
                 printUsage(argv[0]);
             }
         }
+        else if (!strcmp(argv[i], "-readyfd")) {
+            if (++i >= argc || sscanf(argv[i],"%d", &readyFd) != 1) {
+                printUsage(argv[0]);
+            }
+        }
+        else if (!strcmp(argv[i], "-replay")) {
+            if (++i >= argc) {
+                printUsage(argv[0]);
+            }
+            replayFile = argv[i];
+            iWindowId = 0;
+        }
+        else if (!strcmp(argv[i], "-restore")) {
+            if (++i >= argc) {
+                printUsage(argv[0]);
+            }
+            restoreFile = argv[i];
+        }
+        else if (!strcmp(argv[i], "-multi")) {
+            multiTenant = true;
+        }
     }
 
-    windowId = (FBNativeWindowType)iWindowId;
-    if (!windowId) {
+    if (iWindowId < 0 && !multiTenant) {
         // window id must be provided
         printUsage(argv[0]);
     }
+    windowId = (FBNativeWindowType)iWindowId;
 
     //
-    // initialize Framebuffer
+    // initialize Framebuffer, the tenants of a multi-tenant renderer
+    // create their own when they attach
     //
-    bool inited = FrameBuffer::initialize(windowId,
-                                          winX, winY, winWidth, winHeight);
-    if (!inited) {
-        fprintf(stderr,"Failed to initialize Framebuffer\n");
+    if (!multiTenant || replayFile) {
+        bool inited = FrameBuffer::initialize(windowId,
+                                              winX, winY, winWidth, winHeight);
+        if (!inited) {
+            fprintf(stderr,"Failed to initialize Framebuffer\n");
+            return -1;
+        }
+    }
+
+    if (replayFile) {
+        return StreamCapture::replay(replayFile) ? 0 : -1;
+    }
+
+    if (restoreFile && !multiTenant &&
+        !FrameBuffer::getFB()->restoreSnapshot(restoreFile)) {
         return -1;
     }
 
     //
     // Create and run a render server listening to the givven port number
     //
-    RenderServer *server = RenderServer::create(portNum);
+    RenderServer *server = RenderServer::create(portNum, multiTenant);
     if (!server) {
         fprintf(stderr,"Cannot initialize render server\n");
         return -1;
     }
 
+#ifndef _WIN32
+    //
+    // tell the parent process it can connect now
+    //
+    if (readyFd >= 0) {
+        char c = 1;
+        write(readyFd, &c, 1);
+        close(readyFd);
+    }
+#endif
+
     server->Main(); // never returns
 
     return 0;
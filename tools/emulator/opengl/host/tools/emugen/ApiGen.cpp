@@ -155,6 +155,40 @@ int ApiGen::genEntryPoints(const std::string & filename, SideType side)
     fprintf(fp, "#include \"%s_%s_context.h\"\n", m_basename.c_str(), sideString(side));
     fprintf(fp, "\n");
 
+    //
+    // the wrapper entry points may time every call, the wrapper library
+    // provides CallTrace.h when it is built with WRAPPER_CALL_TRACE.
+    //
+    bool trace = (side == WRAPPER_SIDE);
+    if (trace) {
+        fprintf(fp, "#ifdef WRAPPER_CALL_TRACE\n");
+        fprintf(fp, "#include \"CallTrace.h\"\n");
+        fprintf(fp, "#else\n");
+        fprintf(fp, "#define CALL_TRACE(name)\n");
+        fprintf(fp, "#endif\n\n");
+    }
+
+    //
+    // in direct mode the client entry points call the encoder functions
+    // rather than going through the dispatch table of the context, except
+    // for the unsupported ones and the client_override ones, which the
+    // encoder class replaces in its table. The encoder header is not
+    // included, it brings the GL headers whose prototypes differ from the
+    // entry points, so the encoder functions are declared here.
+    //
+    bool direct = (side == CLIENT_SIDE && m_directEncoder);
+    if (direct) {
+        fprintf(fp, "extern \"C\" {\n");
+        for (size_t i = 0; i < size(); i++) {
+            EntryPoint *e = &at(i);
+            if (e->unsupported() || e->clientOverride()) continue;
+            fprintf(fp, "\t");
+            e->print(fp, false, "_enc", "", "void *self");
+            fprintf(fp, ";\n");
+        }
+        fprintf(fp, "};\n\n");
+    }
+
     fprintf(fp, "extern \"C\" {\n");
 
     for (size_t i = 0; i < size(); i++) {
@@ -174,14 +208,20 @@ int ApiGen::genEntryPoints(const std::string & filename, SideType side)
         EntryPoint *e = &at(i);
         e->print(fp);
         fprintf(fp, "{\n");
+        if (trace) {
+            fprintf(fp, "\t CALL_TRACE(%s);\n", e->name().c_str());
+        }
         fprintf(fp, "\t %s_%s_context_t * ctx = getCurrentContext(); \n",
                 m_basename.c_str(), sideString(side));
 
         bool shouldReturn = !e->retval().isVoid();
         bool shouldCallWithContext = (side == CLIENT_SIDE);
-        fprintf(fp, "\t %sctx->%s(%s",
+        bool directCall = direct && !e->unsupported() && !e->clientOverride();
+        fprintf(fp, "\t %s%s%s%s(%s",
                 shouldReturn ? "return " : "",
+                directCall ? "" : "ctx->",
                 e->name().c_str(),
+                directCall ? "_enc" : "",
                 shouldCallWithContext ? "ctx" : "");
         size_t nvars = e->vars().size();
 
@@ -200,6 +240,23 @@ int ApiGen::genEntryPoints(const std::string & filename, SideType side)
 }
 
 
+//
+// compactPacketSize - size of the compact packet of 'e', a 2 bytes header
+//     holding the opcode with IOSTREAM_COMPACT_FLAG set, followed by the
+//     arguments. Its length is implicit, so only entry points without
+//     pointers have one, 0 is returned for the others.
+//
+static size_t compactPacketSize(EntryPoint *e)
+{
+    VarsArray & evars = e->vars();
+    size_t size = 2;
+    for (size_t j = 0; j < evars.size(); j++) {
+        if (evars[j].isPointer()) return 0;
+        if (!evars[j].isVoid()) size += evars[j].type()->bytes();
+    }
+    return size;
+}
+
 int ApiGen::genOpcodes(const std::string &filename)
 {
     FILE *fp = fopen(filename.c_str(), "wt");
@@ -211,6 +268,10 @@ int ApiGen::genOpcodes(const std::string &filename)
     printHeader(fp);
     fprintf(fp, "#ifndef __GUARD_%s_opcodes_h_\n", m_basename.c_str());
     fprintf(fp, "#define __GUARD_%s_opcodes_h_\n\n", m_basename.c_str());
+    if (size() + m_baseOpcode > 0x8000) {
+        // the compact header has 15 bits for the opcode
+        fprintf(stderr, "WARNING: opcodes above 0x7fff cannot be sent in compact packets\n");
+    }
     for (size_t i = 0; i < size(); i++) {
         fprintf(fp, "#define OP_%s \t\t\t\t\t%u\n", at(i).name().c_str(), (unsigned int)i + m_baseOpcode);
     }
@@ -295,6 +356,7 @@ int ApiGen::genEncoderImpl(const std::string &filename)
     fprintf(fp, "#include \"%s_opcodes.h\"\n\n", m_basename.c_str());
     fprintf(fp, "#include \"%s_enc.h\"\n\n\n", m_basename.c_str());
     fprintf(fp, "#include <stdio.h>\n");
+    fprintf(fp, "#include \"StreamChecksum.h\"\n\n");
     std::string classname = m_basename + "_encoder_context_t";
     size_t n = size();
 
@@ -315,12 +377,87 @@ int ApiGen::genEncoderImpl(const std::string &filename)
                 classname.c_str(),
                 classname.c_str());
 
-        // size calculation ;
-        fprintf(fp, "\t size_t packetSize = ");
-
         VarsArray & evars = e->vars();
         size_t nvars = evars.size();
         size_t npointers = 0;
+        for (size_t j = 0; j < nvars; j++) {
+            if (evars[j].isPointer()) npointers++;
+        }
+
+        if (npointers == 0) {
+            //
+            // once the stream negotiated it, packets without pointers go
+            // in the compact form. Its fields are not aligned.
+            //
+            fprintf(fp, "#ifndef CHECK_GL_STREAM\n");
+            fprintf(fp, "\tif (ctx->m_stream->compactPackets()) {\n");
+            fprintf(fp, "\t\tunsigned char *ptr = ctx->m_stream->alloc(%u);\n",
+                    (unsigned int) compactPacketSize(e));
+            fprintf(fp, "\t\tconst unsigned short op = OP_%s | IOSTREAM_COMPACT_FLAG;\n",
+                    e->name().c_str());
+            fprintf(fp, "\t\tmemcpy(ptr, &op, 2);\n");
+            size_t compactOffset = 2;
+            for (size_t j = 0; j < nvars; j++) {
+                if (evars[j].isVoid()) continue;
+                fprintf(fp, "\t\tmemcpy(ptr + %u, &%s, %u);\n",
+                        (unsigned int) compactOffset, evars[j].name().c_str(),
+                        (unsigned int) evars[j].type()->bytes());
+                compactOffset += evars[j].type()->bytes();
+            }
+            fprintf(fp, "\t} else\n");
+            fprintf(fp, "#endif\n");
+            fprintf(fp, "\t{\n");
+
+            //
+            // packets without pointers have a size known here, emit it as
+            // a constant and store every field at its fixed offset
+            //
+            size_t packetSize = 8;
+            for (size_t j = 0; j < nvars; j++) {
+                if (!evars[j].isVoid()) packetSize += evars[j].type()->bytes();
+            }
+            fprintf(fp, "\tconst size_t packetSize = %u + STREAM_CHECKSUM_SIZE;\n", (unsigned int) packetSize);
+            fprintf(fp, "\tunsigned char *ptr = ctx->m_stream->alloc(packetSize);\n\n");
+            fprintf(fp, "\t*(unsigned int *)(ptr) = OP_%s;\n", e->name().c_str());
+            fprintf(fp, "\t*(unsigned int *)(ptr + 4) = (unsigned int) packetSize;\n");
+            size_t offset = 8;
+            for (size_t j = 0; j < nvars; j++) {
+                if (evars[j].isVoid()) continue;
+                fprintf(fp, "\t*(%s *)(ptr + %u) = %s;\n",
+                        evars[j].type()->name().c_str(), (unsigned int) offset,
+                        evars[j].name().c_str());
+                offset += evars[j].type()->bytes();
+            }
+            fprintf(fp, "#ifdef CHECK_GL_STREAM\n");
+            fprintf(fp, "\tStreamChecksum checksum(ctx->m_stream);\n");
+            fprintf(fp, "\tchecksum.add(ptr, %u);\n", (unsigned int) offset);
+            fprintf(fp, "\tchecksum.write(ptr + %u);\n", (unsigned int) offset);
+            fprintf(fp, "#endif\n");
+            fprintf(fp, "\t}\n");
+        } else {
+
+        //
+        // 'isBulk' pointers data goes to the side channel of the stream if
+        // it takes it, the packet is then sized for the id instead.
+        //
+        for (size_t j = 0; j < nvars; j++) {
+            if (!evars[j].isBulk()) continue;
+            fprintf(fp, "\tunsigned int bulkId_%s = 0;\n", evars[j].name().c_str());
+            if (evars[j].nullAllowed()) {
+                fprintf(fp, "\tvoid *bulk_%s = %s != NULL ? ctx->m_stream->allocBulk(%s, &bulkId_%s) : NULL;\n",
+                        evars[j].name().c_str(), evars[j].name().c_str(),
+                        evars[j].lenExpression().c_str(), evars[j].name().c_str());
+            } else {
+                fprintf(fp, "\tvoid *bulk_%s = ctx->m_stream->allocBulk(%s, &bulkId_%s);\n",
+                        evars[j].name().c_str(), evars[j].lenExpression().c_str(),
+                        evars[j].name().c_str());
+            }
+        }
+
+        // size calculation ;
+        fprintf(fp, "\t size_t packetSize = ");
+
+        npointers = 0;
         for (size_t j = 0; j < nvars; j++) {
             fprintf(fp, "%s ", j == 0 ? "" : " +");
             if (evars[j].isPointer()) {
@@ -331,6 +468,9 @@ int ApiGen::genEncoderImpl(const std::string &filename)
                             e->name().c_str(), evars[j].name().c_str());
                 }
 
+                if (evars[j].isBulk()) {
+                    fprintf(fp, "(bulk_%s != NULL ? 4 : ", evars[j].name().c_str());
+                }
                 if (evars[j].nullAllowed()) {
                     fprintf(fp, "(%s != NULL ? %s : 0)",
                             evars[j].name().c_str(),
@@ -343,14 +483,63 @@ int ApiGen::genEncoderImpl(const std::string &filename)
                         fprintf(fp, "0");
                     }
                 }
+                if (evars[j].isBulk()) {
+                    fprintf(fp, ")");
+                }
             } else {
                 fprintf(fp, "%u", (unsigned int) evars[j].type()->bytes());
             }
         }
-        fprintf(fp, " %s 8 + %u * 4;\n", nvars != 0 ? "+" : "", (unsigned int) npointers);
+        fprintf(fp, " %s 8 + %u * 4 + STREAM_CHECKSUM_SIZE;\n", nvars != 0 ? "+" : "", (unsigned int) npointers);
+
+        //
+        // 'isLarge' pointers data is not copied into the stream buffer,
+        // it is sent directly from the caller memory. Split the packet into
+        // the segments that are staged in the stream buffer around them.
+        //
+        std::vector<std::string> segSizes;
+        std::string seg = "8";
+        for (size_t j = 0; j < nvars; j++) {
+            if (evars[j].isPointer()) {
+                seg += " + 4";
+                Var::PointerDir dir = evars[j].pointerDir();
+                if (dir == Var::POINTER_IN || dir == Var::POINTER_INOUT) {
+                    if (evars[j].isBulk()) {
+                        // the bulk id follows the size
+                        segSizes.push_back(seg + " + (bulk_" + evars[j].name() + " != NULL ? 4 : 0)");
+                        seg = "0";
+                    } else if (evars[j].isLarge()) {
+                        segSizes.push_back(seg);
+                        seg = "0";
+                    } else if (evars[j].nullAllowed()) {
+                        seg += " + (" + evars[j].name() + " != NULL ? " +
+                               evars[j].lenExpression() + " : 0)";
+                    } else {
+                        seg += " + " + evars[j].lenExpression();
+                    }
+                }
+            } else if (!evars[j].isVoid()) {
+                seg += " + " + toString(evars[j].type()->bytes());
+            }
+        }
+        // the checksum footer ends the last segment, unless it is empty
+        if (seg != "0") {
+            seg += " + STREAM_CHECKSUM_SIZE";
+        }
+        segSizes.push_back(seg);
+        size_t curSeg = 0;
 
         // allocate buffer from the stream;
-        fprintf(fp, "\t unsigned char *ptr = ctx->m_stream->alloc(packetSize);\n\n");
+        if (segSizes.size() > 1) {
+            fprintf(fp, "\t unsigned char *ptr = ctx->m_stream->alloc(%s);\n\n",
+                    segSizes[0].c_str());
+        } else {
+            fprintf(fp, "\t unsigned char *ptr = ctx->m_stream->alloc(packetSize);\n\n");
+        }
+        fprintf(fp, "#ifdef CHECK_GL_STREAM\n");
+        fprintf(fp, "\tStreamChecksum checksum(ctx->m_stream);\n");
+        fprintf(fp, "\tunsigned char *checksumPtr = ptr;\n");
+        fprintf(fp, "#endif\n");
 
         // encode into the stream;
         fprintf(fp, "\t*(unsigned int *)(ptr) = OP_%s; ptr += 4;\n",  e->name().c_str());
@@ -360,7 +549,16 @@ int ApiGen::genEncoderImpl(const std::string &filename)
         for (size_t j = 0; j < nvars; j++) {
             if (evars[j].isPointer()) {
                 // encode a pointer header
-                if (evars[j].nullAllowed()) {
+                if (evars[j].isBulk()) {
+                    fprintf(fp, "\t*(unsigned int *)(ptr) = bulk_%s != NULL ? (%s) | IOSTREAM_BULK_FLAG : ",
+                            evars[j].name().c_str(), evars[j].lenExpression().c_str());
+                    if (evars[j].nullAllowed()) {
+                        fprintf(fp, "(%s != NULL) ? %s : 0; ptr += 4; \n",
+                                evars[j].name().c_str(), evars[j].lenExpression().c_str());
+                    } else {
+                        fprintf(fp, "%s; ptr += 4; \n", evars[j].lenExpression().c_str());
+                    }
+                } else if (evars[j].nullAllowed()) {
                     fprintf(fp, "\t*(unsigned int *)(ptr) = (%s != NULL) ? %s : 0; ptr += 4; \n",
                             evars[j].name().c_str(), evars[j].lenExpression().c_str());
                 } else {
@@ -369,7 +567,51 @@ int ApiGen::genEncoderImpl(const std::string &filename)
                 }
 
                 Var::PointerDir dir = evars[j].pointerDir();
-                if (dir == Var::POINTER_INOUT || dir == Var::POINTER_IN) {
+                if ((dir == Var::POINTER_INOUT || dir == Var::POINTER_IN) &&
+                    evars[j].isLarge()) {
+                    if (evars[j].isBulk()) {
+                        // the stream took the data, only the id is staged
+                        fprintf(fp, "\tif (bulk_%s != NULL) {\n", evars[j].name().c_str());
+                        fprintf(fp, "\t\tmemcpy(bulk_%s, %s, %s);\n",
+                                evars[j].name().c_str(), evars[j].name().c_str(),
+                                evars[j].lenExpression().c_str());
+                        fprintf(fp, "\t\t*(unsigned int *)(ptr) = bulkId_%s; ptr += 4;\n",
+                                evars[j].name().c_str());
+                        fprintf(fp, "#ifdef CHECK_GL_STREAM\n");
+                        fprintf(fp, "\t\tchecksum.add(checksumPtr, ptr - checksumPtr);\n");
+                        fprintf(fp, "#endif\n");
+                        fprintf(fp, "\t} else {\n");
+                    }
+                    // flush the staged part and send the data in place
+                    fprintf(fp, "#ifdef CHECK_GL_STREAM\n");
+                    fprintf(fp, "\tchecksum.add(checksumPtr, ptr - checksumPtr);\n");
+                    fprintf(fp, "\tchecksum.add(%s, %s);\n",
+                            evars[j].name().c_str(), evars[j].lenExpression().c_str());
+                    fprintf(fp, "#endif\n");
+                    if (evars[j].nullAllowed()) {
+                        fprintf(fp, "\tctx->m_stream->writev(%s, %s != NULL ? %s : 0);\n",
+                                evars[j].name().c_str(), evars[j].name().c_str(),
+                                evars[j].lenExpression().c_str());
+                    } else {
+                        fprintf(fp, "\tctx->m_stream->writev(%s, %s);\n",
+                                evars[j].name().c_str(),
+                                evars[j].lenExpression().c_str());
+                    }
+                    if (evars[j].isBulk()) {
+                        fprintf(fp, "\t}\n");
+                    }
+                    curSeg++;
+                    if (segSizes[curSeg] != "0") {
+                        fprintf(fp, "\tptr = ctx->m_stream->alloc(%s);\n",
+                                segSizes[curSeg].c_str());
+                        fprintf(fp, "#ifdef CHECK_GL_STREAM\n");
+                    } else {
+                        fprintf(fp, "#ifdef CHECK_GL_STREAM\n");
+                        fprintf(fp, "\tptr = ctx->m_stream->alloc(STREAM_CHECKSUM_SIZE);\n");
+                    }
+                    fprintf(fp, "\tchecksumPtr = ptr;\n");
+                    fprintf(fp, "#endif\n");
+                } else if (dir == Var::POINTER_INOUT || dir == Var::POINTER_IN) {
                     if (evars[j].nullAllowed()) {
                         fprintf(fp, "\tif (%s != NULL) ", evars[j].name().c_str());
                     } else {
@@ -399,6 +641,12 @@ int ApiGen::genEncoderImpl(const std::string &filename)
                 }
             }
         }
+        fprintf(fp, "#ifdef CHECK_GL_STREAM\n");
+        fprintf(fp, "\tchecksum.add(checksumPtr, ptr - checksumPtr);\n");
+        fprintf(fp, "\tchecksum.write(ptr);\n");
+        fprintf(fp, "#endif\n");
+        } // npointers != 0
+
         // in variables;
         for (size_t j = 0; j < nvars; j++) {
             if (evars[j].isPointer()) {
@@ -422,6 +670,15 @@ int ApiGen::genEncoderImpl(const std::string &filename)
             fprintf(stderr, "WARNING: %s : return value of pointer is unsupported\n",
                     e->name().c_str());
             fprintf(fp, "\t return NULL;\n");
+        } else if (e->retval().type()->name() != "void" && e->deferredReply()) {
+            if (e->retval().type()->bytes() != 4) {
+                fprintf(stderr, "WARNING: %s : deferred reply of %u bytes, only 4 are supported\n",
+                        e->name().c_str(), (uint) e->retval().type()->bytes());
+            }
+            // the reply is read later, see IOStream::deferReply
+            fprintf(fp, "\n\tctx->m_stream->flush();\n");
+            fprintf(fp, "\tctx->m_stream->deferReply();\n");
+            fprintf(fp, "\treturn 0;\n");
         } else if (e->retval().type()->name() != "void") {
             fprintf(fp, "\n\t%s retval;\n", e->retval().type()->name().c_str());
             fprintf(fp, "\tctx->m_stream->readback(&retval, %u);\n",(uint) e->retval().type()->bytes());
@@ -483,6 +740,8 @@ int ApiGen::genDecoderHeader(const std::string &filename)
     fprintf(fp, "struct %s : public %s_%s_context_t {\n\n",
             classname.c_str(), m_basename.c_str(), sideString(SERVER_SIDE));
     fprintf(fp, "\tsize_t decode(void *buf, size_t bufsize, IOStream *stream);\n");
+    fprintf(fp, "\t// size of the compact packets of 'opcode', 0 if it has none or is not ours\n");
+    fprintf(fp, "\tstatic size_t compactPacketSize(int opcode);\n");
     fprintf(fp, "\n};\n\n");
     fprintf(fp, "#endif");
 
@@ -523,6 +782,228 @@ int ApiGen::genContextImpl(const std::string &filename, SideType side)
     return 0;
 }
 
+//
+// genDecoderCall - generate the code which decodes the packet at 'ptr'
+//     for entry point 'e' and calls it through the context named 'ctx'.
+//     The arguments follow a header of 'headerSize' bytes.
+//
+void ApiGen::genDecoderCall(FILE *fp, EntryPoint *e, const char *ctx, size_t headerSize)
+{
+    enum Pass_t { PASS_TmpBuffAlloc = 0, PASS_MemAlloc, PASS_DebugPrint, PASS_FunctionCall, PASS_Epilog, PASS_LAST };
+
+    // construct a printout string;
+    std::string printString = "";
+    for (size_t i = 0; i < e->vars().size(); i++) {
+        Var *v = &e->vars()[i];
+        if (!v->isVoid())  printString += (v->isPointer() ? "%p(%u)" : v->type()->printFormat()) + " ";
+    }
+    printString += "";
+    // TODO - add for return value;
+
+    bool totalTmpBuffExist = false;
+    std::string totalTmpBuffOffset = "0";
+    std::string *tmpBufOffset = new std::string[e->vars().size()];
+
+    // construct retval type string
+    std::string retvalType;
+    if (!e->retval().isVoid()) {
+        retvalType = e->retval().type()->name();
+    }
+
+    //
+    // unpack the arguments once into locals. Fields are not aligned in the
+    // packet so they are loaded with memcpy, which compiles to plain loads
+    // where unaligned accesses are allowed, and only the wire size of the
+    // field is copied in case the host type is wider. The offset of a
+    // field is the sum of a constant and of the sizes of the pointers
+    // before it.
+    //
+    VarsArray & evars = e->vars();
+    size_t constOffset = headerSize; // skip the header
+    std::string sizesOffset = "";
+    for (size_t j = 0; j < evars.size(); j++) {
+        Var *v = & evars[j];
+        if (v->isVoid()) continue;
+
+        std::string offset = toString(constOffset) + sizesOffset;
+        if (!v->isPointer()) {
+            fprintf(fp, "\t\t\t%s var_%s = 0;\n", v->type()->name().c_str(), v->name().c_str());
+            fprintf(fp, "\t\t\tmemcpy(&var_%s, ptr + %s, %u);\n",
+                    v->name().c_str(), offset.c_str(), (uint) v->type()->bytes());
+            constOffset += v->type()->bytes();
+        } else {
+            fprintf(fp, "\t\t\tunsigned int size_%s;\n", v->name().c_str());
+            fprintf(fp, "\t\t\tmemcpy(&size_%s, ptr + %s, 4);\n",
+                    v->name().c_str(), offset.c_str());
+            constOffset += 4;
+            if (v->isBulk()) {
+                // the packet holds the id of the data if it went aside,
+                // inlen_ is the room it takes, only the fields after it
+                // read it
+                const char *name = v->name().c_str();
+                bool fieldsAfter = false;
+                for (size_t k = j + 1; k < evars.size(); k++) {
+                    if (!evars[k].isVoid()) fieldsAfter = true;
+                }
+                fprintf(fp, "\t\t\tunsigned char *inptr_%s = ptr + %s + 4;\n",
+                        name, offset.c_str());
+                if (fieldsAfter) {
+                    fprintf(fp, "\t\t\tunsigned int inlen_%s = size_%s;\n", name, name);
+                }
+                fprintf(fp, "\t\t\tunsigned int bulkId_%s = 0;\n", name);
+                fprintf(fp, "\t\t\tbool bulk_%s = (size_%s & IOSTREAM_BULK_FLAG) != 0;\n",
+                        name, name);
+                fprintf(fp, "\t\t\tif (bulk_%s) {\n", name);
+                fprintf(fp, "\t\t\t\tsize_%s &= ~IOSTREAM_BULK_FLAG;\n", name);
+                fprintf(fp, "\t\t\t\tmemcpy(&bulkId_%s, inptr_%s, 4);\n", name, name);
+                fprintf(fp, "\t\t\t\tinptr_%s = (unsigned char *)stream->getBulk(bulkId_%s, size_%s);\n",
+                        name, name, name);
+                if (fieldsAfter) {
+                    fprintf(fp, "\t\t\t\tinlen_%s = 4;\n", name);
+                }
+                fprintf(fp, "\t\t\t}\n");
+                sizesOffset += " + inlen_" + v->name();
+            } else if (v->pointerDir() == Var::POINTER_IN || v->pointerDir() == Var::POINTER_INOUT) {
+                fprintf(fp, "\t\t\tunsigned char *inptr_%s = ptr + %s + 4;\n",
+                        v->name().c_str(), offset.c_str());
+                sizesOffset += " + size_" + v->name();
+            }
+        }
+    }
+
+    for (int pass = PASS_TmpBuffAlloc; pass < PASS_LAST; pass++) {
+        if (pass == PASS_FunctionCall && !e->retval().isVoid() && !e->retval().isPointer()) {
+            fprintf(fp, "\t\t\t%s retval = ", retvalType.c_str());
+        }
+
+
+        if (pass == PASS_FunctionCall) {
+            fprintf(fp, "%s%s->%s(",
+                    !e->retval().isVoid() && !e->retval().isPointer() ? "" : "\t\t\t",
+                    ctx, e->name().c_str());
+            if (e->customDecoder()) {
+                fprintf(fp, "%s", ctx); // add a context to the call
+            }
+        } else if (pass == PASS_DebugPrint) {
+            fprintf(fp, "#ifdef DEBUG_PRINTOUT\n");
+            fprintf(fp, "\t\t\tfprintf(stderr,\"%s(%s)\\n\"", e->name().c_str(), printString.c_str());
+            if (e->vars().size() > 0 && !e->vars()[0].isVoid()) fprintf(fp, ",");
+        }
+
+        // allocate memory for out pointers;
+        for (size_t j = 0; j < evars.size(); j++) {
+            Var *v = & evars[j];
+            if (!v->isVoid()) {
+                if ((pass == PASS_FunctionCall) && (j != 0 || e->customDecoder())) fprintf(fp, ", ");
+                if (pass == PASS_DebugPrint && j != 0) fprintf(fp, ", ");
+
+                if (!v->isPointer()) {
+                    if (pass == PASS_FunctionCall || pass == PASS_DebugPrint) {
+                        fprintf(fp, "var_%s", v->name().c_str());
+                    }
+                } else {
+                    if (v->pointerDir() == Var::POINTER_IN || v->pointerDir() == Var::POINTER_INOUT) {
+                        if (pass == PASS_MemAlloc && v->pointerDir() == Var::POINTER_INOUT) {
+                            fprintf(fp, "\t\t\tsize_t tmpPtr%uSize = size_%s;\n",
+                                    (uint) j, v->name().c_str());
+                            fprintf(fp, "\t\t\tunsigned char *tmpPtr%u = inptr_%s;\n",
+                                    (uint) j, v->name().c_str());
+                        }
+                        if (pass == PASS_FunctionCall) {
+                            if (v->nullAllowed()) {
+                                fprintf(fp, "size_%s == 0 ? NULL : (%s)(inptr_%s)",
+                                        v->name().c_str(), v->type()->name().c_str(),
+                                        v->name().c_str());
+                            } else {
+                                fprintf(fp, "(%s)(inptr_%s)",
+                                        v->type()->name().c_str(), v->name().c_str());
+                            }
+                        } else if (pass == PASS_DebugPrint) {
+                            fprintf(fp, "(%s)(inptr_%s), size_%s",
+                                    v->type()->name().c_str(), v->name().c_str(),
+                                    v->name().c_str());
+                        }
+                    } else { // out pointer;
+                        if (pass == PASS_TmpBuffAlloc) {
+                            fprintf(fp, "\t\t\tsize_t tmpPtr%uSize = size_%s;\n",
+                                    (uint) j, v->name().c_str());
+                            if (!totalTmpBuffExist) {
+                                fprintf(fp, "\t\t\tsize_t totalTmpSize = tmpPtr%uSize;\n", (uint)j);
+                            } else {
+                                fprintf(fp, "\t\t\ttotalTmpSize += tmpPtr%uSize;\n", (uint)j);
+                            }
+                            tmpBufOffset[j] = totalTmpBuffOffset;
+                            char tmpPtrName[16];
+                            sprintf(tmpPtrName," + tmpPtr%uSize", (uint)j);
+                            totalTmpBuffOffset += std::string(tmpPtrName);
+                            totalTmpBuffExist = true;
+                        } else if (pass == PASS_MemAlloc) {
+                            fprintf(fp, "\t\t\tunsigned char *tmpPtr%u = &tmpBuf[%s];\n",
+                                    (uint)j, tmpBufOffset[j].c_str());
+                        } else if (pass == PASS_FunctionCall) {
+                            if (v->nullAllowed()) {
+                                fprintf(fp, "tmpPtr%uSize == 0 ? NULL : (%s)(tmpPtr%u)",
+                                        (uint) j, v->type()->name().c_str(), (uint) j);
+                            } else {
+                                fprintf(fp, "(%s)(tmpPtr%u)", v->type()->name().c_str(), (uint) j);
+                            }
+                        } else if (pass == PASS_DebugPrint) {
+                            fprintf(fp, "(%s)(tmpPtr%u), size_%s",
+                                    v->type()->name().c_str(), (uint) j,
+                                    v->name().c_str());
+                        }
+                    }
+                }
+            }
+        }
+
+        if (pass == PASS_FunctionCall || pass == PASS_DebugPrint) fprintf(fp, ");\n");
+        if (pass == PASS_DebugPrint) fprintf(fp, "#endif\n");
+
+        if (pass == PASS_FunctionCall && !e->retval().isVoid() && !e->retval().isPointer()) {
+            fprintf(fp, "\t\t\tmemcpy(&tmpBuf[%s], &retval, %u);\n",
+                    totalTmpBuffOffset.c_str(), (uint) e->retval().type()->bytes());
+        }
+
+        if (pass == PASS_TmpBuffAlloc) {
+            if (!e->retval().isVoid() && !e->retval().isPointer()) {
+                if (!totalTmpBuffExist)
+                    fprintf(fp, "\t\t\tsize_t totalTmpSize = %u;\n", (uint) e->retval().type()->bytes());
+                else
+                    fprintf(fp, "\t\t\ttotalTmpSize += %u;\n", (uint) e->retval().type()->bytes());
+
+                totalTmpBuffExist = true;
+            }
+            //
+            // out pointers and the return value are written in place in
+            // the staging buffer of the reply stream, which only grows, so
+            // the reply is neither copied nor allocated per packet.
+            //
+            if (totalTmpBuffExist) {
+                fprintf(fp, "\t\t\tunsigned char *tmpBuf = stream->alloc(totalTmpSize);\n");
+            }
+        }
+
+        if (pass == PASS_Epilog) {
+            // the call is done with the bulk data
+            for (size_t j = 0; j < evars.size(); j++) {
+                if (evars[j].isBulk()) {
+                    fprintf(fp, "\t\t\tif (bulk_%s) stream->releaseBulk(bulkId_%s, size_%s);\n",
+                            evars[j].name().c_str(), evars[j].name().c_str(),
+                            evars[j].name().c_str());
+                }
+            }
+            // send back out pointers data as well as retval
+            if (totalTmpBuffExist) {
+                fprintf(fp, "\t\t\tstream->flush();\n");
+            }
+        }
+
+    } // pass;
+
+    delete [] tmpBufOffset;
+}
+
 int ApiGen::genDecoderImpl(const std::string &filename)
 {
     FILE *fp = fopen(filename.c_str(), "wt");
@@ -540,171 +1021,141 @@ int ApiGen::genDecoderImpl(const std::string &filename)
     fprintf(fp, "\n\n#include <string.h>\n");
     fprintf(fp, "#include \"%s_opcodes.h\"\n\n", m_basename.c_str());
     fprintf(fp, "#include \"%s_dec.h\"\n\n\n", m_basename.c_str());
-    fprintf(fp, "#include <stdio.h>\n\n");
+    fprintf(fp, "#include <stdio.h>\n");
+    fprintf(fp, "#include \"StreamChecksum.h\"\n\n");
+
+    // implicit sizes of the compact packets, indexed by (opcode - base opcode)
+    fprintf(fp, "static const unsigned short s_compactSizes[] = {\n");
+    for (size_t f = 0; f < n; f++) {
+        fprintf(fp, "\t%u,\n", (uint) compactPacketSize(&at(f)));
+    }
+    fprintf(fp, "};\n\n");
+    fprintf(fp, "size_t %s::compactPacketSize(int opcode)\n{\n", classname.c_str());
+    fprintf(fp, "\tunsigned int idx = (unsigned int)(opcode - %d);\n", m_baseOpcode);
+    fprintf(fp, "\treturn idx < %u ? s_compactSizes[idx] : 0;\n", (uint) n);
+    fprintf(fp, "}\n\n");
+
+    if (m_decoderJumpTable) {
+        //
+        // one handler function per entry point, dispatched through a
+        // table indexed by (opcode - base opcode)
+        //
+        fprintf(fp, "typedef void (*%s_handler_t)(%s *ctx, unsigned char *ptr, IOStream *stream);\n\n",
+                m_basename.c_str(), classname.c_str());
+        for (size_t f = 0; f < n; f++) {
+            EntryPoint *e = &at(f);
+            fprintf(fp, "static void dec_%s(%s *ctx, unsigned char *ptr, IOStream *stream)\n{\n",
+                    e->name().c_str(), classname.c_str());
+            genDecoderCall(fp, e, "ctx", 8);
+            fprintf(fp, "}\n\n");
+            if (compactPacketSize(e) != 0) {
+                fprintf(fp, "static void dec_compact_%s(%s *ctx, unsigned char *ptr, IOStream *stream)\n{\n",
+                        e->name().c_str(), classname.c_str());
+                genDecoderCall(fp, e, "ctx", 2);
+                fprintf(fp, "}\n\n");
+            }
+        }
+
+        fprintf(fp, "static const %s_handler_t s_handlers[] = {\n", m_basename.c_str());
+        for (size_t f = 0; f < n; f++) {
+            fprintf(fp, "\tdec_%s,\n", at(f).name().c_str());
+        }
+        fprintf(fp, "};\n\n");
+
+        fprintf(fp, "static const %s_handler_t s_compactHandlers[] = {\n", m_basename.c_str());
+        for (size_t f = 0; f < n; f++) {
+            if (compactPacketSize(&at(f)) != 0) {
+                fprintf(fp, "\tdec_compact_%s,\n", at(f).name().c_str());
+            } else {
+                fprintf(fp, "\tNULL,\n");
+            }
+        }
+        fprintf(fp, "};\n\n");
+
+        fprintf(fp, "size_t %s::decode(void *buf, size_t len, IOStream *stream)\n{\n", classname.c_str());
+        fprintf(fp,
+                "\tsize_t pos = 0;\n\
+\tunsigned char *ptr = (unsigned char *)buf;\n\
+\twhile (len - pos >= 2) {\n\
+\t\tunsigned int op = *(unsigned short *)ptr;\n\
+\t\tif (op & IOSTREAM_COMPACT_FLAG) {\n\
+\t\t\tunsigned int idx = (op & ~IOSTREAM_COMPACT_FLAG) - %d;\n\
+\t\t\tif (idx >= %u || s_compactSizes[idx] == 0) break; // not ours\n\
+\t\t\tunsigned int packetLen = s_compactSizes[idx];\n\
+\t\t\tif (len - pos < packetLen) break;\n\
+\t\t\ts_compactHandlers[idx](this, ptr, stream);\n\
+\t\t\tpos += packetLen;\n\
+\t\t\tptr += packetLen;\n\
+\t\t\tcontinue;\n\
+\t\t}\n\
+\t\tif (len - pos < 8) break;\n\
+\t\tunsigned int idx = (unsigned int)(*(int *)ptr - %d);\n\
+\t\tunsigned int packetLen = *(int *)(ptr + 4);\n\
+\t\tif (idx >= %u) break; // not ours\n\
+\t\tif (len - pos < packetLen) break;\n\
+#ifdef CHECK_GL_STREAM\n\
+\t\tif (!StreamChecksum::check(stream, ptr, packetLen)) break;\n\
+#endif\n\
+\t\ts_handlers[idx](this, ptr, stream);\n\
+\t\tpos += packetLen;\n\
+\t\tptr += packetLen;\n\
+\t}\n\
+\treturn pos;\n\
+}\n",
+                m_baseOpcode, (uint) n, m_baseOpcode, (uint) n);
+
+        fclose(fp);
+        return 0;
+    }
 
     // decoder switch;
     fprintf(fp, "size_t %s::decode(void *buf, size_t len, IOStream *stream)\n{\n", classname.c_str());
     fprintf(fp,
             "                           \n\
 \tsize_t pos = 0;\n\
-\tif (len < 8) return pos; \n\
+\tif (len < 2) return pos; \n\
 \tunsigned char *ptr = (unsigned char *)buf;\n\
 \tbool unknownOpcode = false;  \n\
-\twhile ((len - pos >= 8) && !unknownOpcode) {   \n\
+\twhile ((len - pos >= 2) && !unknownOpcode) {   \n\
 \t\tvoid *params[%u]; \n\
-\t\tint opcode = *(int *)ptr;   \n\
-\t\tunsigned int packetLen = *(int *)(ptr + 4);\n\
+\t\tint opcode;\n\
+\t\tunsigned int packetLen;\n\
+\t\tif (*(unsigned short *)ptr & IOSTREAM_COMPACT_FLAG) {\n\
+\t\t\topcode = *(unsigned short *)ptr;\n\
+\t\t\tpacketLen = compactPacketSize(opcode & ~IOSTREAM_COMPACT_FLAG);\n\
+\t\t\tif (packetLen == 0) return pos; // not ours\n\
+\t\t} else {\n\
+\t\t\tif (len - pos < 8) return pos;\n\
+\t\t\topcode = *(int *)ptr;\n\
+\t\t\tpacketLen = *(int *)(ptr + 4);\n\
+\t\t}\n\
 \t\tif (len - pos < packetLen)  return pos; \n\
+#ifdef CHECK_GL_STREAM\n\
+\t\tif ((unsigned int)(opcode - %d) < %u &&\n\
+\t\t    !StreamChecksum::check(stream, ptr, packetLen)) return pos;\n\
+#endif\n\
 \t\tswitch(opcode) {\n",
-            (uint) m_maxEntryPointsParams);
+            (uint) m_maxEntryPointsParams, m_baseOpcode, (uint) n);
 
     for (size_t f = 0; f < n; f++) {
-        enum Pass_t { PASS_TmpBuffAlloc = 0, PASS_MemAlloc, PASS_DebugPrint, PASS_FunctionCall, PASS_Epilog, PASS_LAST };
         EntryPoint *e = &at(f);
 
-        // construct a printout string;
-        std::string printString = "";
-        for (size_t i = 0; i < e->vars().size(); i++) {
-            Var *v = &e->vars()[i];
-            if (!v->isVoid())  printString += (v->isPointer() ? "%p(%u)" : v->type()->printFormat()) + " ";
-        }
-        printString += "";
-        // TODO - add for return value;
-
         fprintf(fp, "\t\t\tcase OP_%s:\n", e->name().c_str());
         fprintf(fp, "\t\t\t{\n");
-
-        bool totalTmpBuffExist = false;
-        std::string totalTmpBuffOffset = "0";
-        std::string *tmpBufOffset = new std::string[e->vars().size()];
-
-        // construct retval type string
-        std::string retvalType;
-        if (!e->retval().isVoid()) {
-            retvalType = e->retval().type()->name();
-        }
-
-        for (int pass = PASS_TmpBuffAlloc; pass < PASS_LAST; pass++) {
-            if (pass == PASS_FunctionCall && !e->retval().isVoid() && !e->retval().isPointer()) {
-                fprintf(fp, "\t\t\t*(%s *)(&tmpBuf[%s]) = ", retvalType.c_str(),
-                        totalTmpBuffOffset.c_str());
-            }
-
-
-            if (pass == PASS_FunctionCall) {
-                fprintf(fp, "\t\t\tthis->%s(", e->name().c_str());
-                if (e->customDecoder()) {
-                    fprintf(fp, "this"); // add a context to the call
-                }
-            } else if (pass == PASS_DebugPrint) {
-                fprintf(fp, "#ifdef DEBUG_PRINTOUT\n");
-                fprintf(fp, "\t\t\tfprintf(stderr,\"%s(%s)\\n\"", e->name().c_str(), printString.c_str());
-                if (e->vars().size() > 0 && !e->vars()[0].isVoid()) fprintf(fp, ",");
-            }
-
-            std::string varoffset = "8"; // skip the header
-            VarsArray & evars = e->vars();
-            // allocate memory for out pointers;
-            for (size_t j = 0; j < evars.size(); j++) {
-                Var *v = & evars[j];
-                if (!v->isVoid()) {
-                    if ((pass == PASS_FunctionCall) && (j != 0 || e->customDecoder())) fprintf(fp, ", ");
-                    if (pass == PASS_DebugPrint && j != 0) fprintf(fp, ", ");
-
-                    if (!v->isPointer()) {
-                        if (pass == PASS_FunctionCall || pass == PASS_DebugPrint) {
-                            fprintf(fp, "*(%s *)(ptr + %s)", v->type()->name().c_str(), varoffset.c_str());
-                        }
-                        varoffset += " + " + toString(v->type()->bytes());
-                    } else {
-                        if (v->pointerDir() == Var::POINTER_IN || v->pointerDir() == Var::POINTER_INOUT) {
-                            if (pass == PASS_MemAlloc && v->pointerDir() == Var::POINTER_INOUT) {
-                                fprintf(fp, "\t\t\tsize_t tmpPtr%uSize = (size_t)*(unsigned int *)(ptr + %s);\n",
-                                        (uint) j, varoffset.c_str());
-                                fprintf(fp, "unsigned char *tmpPtr%u = (ptr + %s + 4);\n",
-                                        (uint) j, varoffset.c_str());
-                            }
-                            if (pass == PASS_FunctionCall) {
-                                if (v->nullAllowed()) {
-                                    fprintf(fp, "*((unsigned int *)(ptr + %s)) == 0 ? NULL : (%s)(ptr + %s + 4)",
-                                            varoffset.c_str(), v->type()->name().c_str(), varoffset.c_str());
-                                } else {
-                                    fprintf(fp, "(%s)(ptr + %s + 4)",
-                                            v->type()->name().c_str(), varoffset.c_str());
-                                }
-                            } else if (pass == PASS_DebugPrint) {
-                                fprintf(fp, "(%s)(ptr + %s + 4), *(unsigned int *)(ptr + %s)",
-                                        v->type()->name().c_str(), varoffset.c_str(),
-                                        varoffset.c_str());
-                            }
-                            varoffset += " + 4 + *(size_t *)(ptr +" + varoffset + ")";
-                        } else { // out pointer;
-                            if (pass == PASS_TmpBuffAlloc) {
-                                fprintf(fp, "\t\t\tsize_t tmpPtr%uSize = (size_t)*(unsigned int *)(ptr + %s);\n",
-                                        (uint) j, varoffset.c_str());
-                                if (!totalTmpBuffExist) {
-                                    fprintf(fp, "\t\t\tsize_t totalTmpSize = tmpPtr%uSize;\n", (uint)j);
-                                } else {
-                                    fprintf(fp, "\t\t\ttotalTmpSize += tmpPtr%uSize;\n", (uint)j);
-                                }
-                                tmpBufOffset[j] = totalTmpBuffOffset;
-                                char tmpPtrName[16];
-                                sprintf(tmpPtrName," + tmpPtr%uSize", (uint)j);
-                                totalTmpBuffOffset += std::string(tmpPtrName);
-                                totalTmpBuffExist = true;
-                            } else if (pass == PASS_MemAlloc) {
-                                fprintf(fp, "\t\t\tunsigned char *tmpPtr%u = &tmpBuf[%s];\n",
-                                        (uint)j, tmpBufOffset[j].c_str());
-                            } else if (pass == PASS_FunctionCall) {
-                                if (v->nullAllowed()) {
-                                    fprintf(fp, "tmpPtr%uSize == 0 ? NULL : (%s)(tmpPtr%u)",
-                                            (uint) j, v->type()->name().c_str(), (uint) j);
-                                } else {
-                                    fprintf(fp, "(%s)(tmpPtr%u)", v->type()->name().c_str(), (uint) j);
-                                }
-                            } else if (pass == PASS_DebugPrint) {
-                                fprintf(fp, "(%s)(tmpPtr%u), *(unsigned int *)(ptr + %s)",
-                                        v->type()->name().c_str(), (uint) j,
-                                        varoffset.c_str());
-                            }
-                            varoffset += " + 4";
-                        }
-                    }
-                }
-            }
-
-            if (pass == PASS_FunctionCall || pass == PASS_DebugPrint) fprintf(fp, ");\n");
-            if (pass == PASS_DebugPrint) fprintf(fp, "#endif\n");
-
-            if (pass == PASS_TmpBuffAlloc) {
-                if (!e->retval().isVoid() && !e->retval().isPointer()) {
-                    if (!totalTmpBuffExist)
-                        fprintf(fp, "\t\t\tsize_t totalTmpSize = sizeof(%s);\n", retvalType.c_str());
-                    else
-                        fprintf(fp, "\t\t\ttotalTmpSize += sizeof(%s);\n", retvalType.c_str());
-
-                    totalTmpBuffExist = true;
-                }
-                if (totalTmpBuffExist) {
-                    fprintf(fp, "\t\t\tunsigned char *tmpBuf = stream->alloc(totalTmpSize);\n");
-                }
-            }
-
-            if (pass == PASS_Epilog) {
-                // send back out pointers data as well as retval
-                if (totalTmpBuffExist) {
-                    fprintf(fp, "\t\t\tstream->flush();\n");
-                }
-
-                fprintf(fp, "\t\t\tpos += *(int *)(ptr + 4);\n");
-                fprintf(fp, "\t\t\tptr += *(int *)(ptr + 4);\n");
-            }
-
-        } // pass;
+        genDecoderCall(fp, e, "this", 8);
+        fprintf(fp, "\t\t\tpos += packetLen;\n");
+        fprintf(fp, "\t\t\tptr += packetLen;\n");
         fprintf(fp, "\t\t\t}\n");
         fprintf(fp, "\t\t\tbreak;\n");
-
-        delete [] tmpBufOffset;
+        if (compactPacketSize(e) != 0) {
+            fprintf(fp, "\t\t\tcase OP_%s | IOSTREAM_COMPACT_FLAG:\n", e->name().c_str());
+            fprintf(fp, "\t\t\t{\n");
+            genDecoderCall(fp, e, "this", 2);
+            fprintf(fp, "\t\t\tpos += packetLen;\n");
+            fprintf(fp, "\t\t\tptr += packetLen;\n");
+            fprintf(fp, "\t\t\t}\n");
+            fprintf(fp, "\t\t\tbreak;\n");
+        }
     }
     fprintf(fp, "\t\t\tdefault:\n");
     fprintf(fp, "\t\t\t\tunknownOpcode = true;\n");
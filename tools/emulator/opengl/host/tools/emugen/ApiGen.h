@@ -30,7 +30,9 @@ public:
     ApiGen(const std::string & basename) :
         m_basename(basename),
         m_maxEntryPointsParams(0),
-        m_baseOpcode(0)
+        m_baseOpcode(0),
+        m_decoderJumpTable(false),
+        m_directEncoder(false)
     { }
     virtual ~ApiGen() {}
     int readSpec(const std::string & filename);
@@ -41,6 +43,8 @@ public:
     }
     int baseOpcode() { return m_baseOpcode; }
     void setBaseOpcode(int base) { m_baseOpcode = base; }
+    void setDecoderJumpTable(bool enable) { m_decoderJumpTable = enable; }
+    void setDirectEncoder(bool enable) { m_directEncoder = enable; }
 
     const char *sideString(SideType side) {
         const char *retval;
@@ -80,6 +84,7 @@ public:
     int genDecoderImpl(const std::string &filename);
 
 protected:
+    void genDecoderCall(FILE *fp, EntryPoint *e, const char *ctx, size_t headerSize);
     virtual void printHeader(FILE *fp) const;
     std::string m_basename;
     StringVec m_clientContextHeaders;
@@ -88,6 +93,8 @@ protected:
     StringVec m_decoderHeaders;
     size_t m_maxEntryPointsParams; // record the maximum number of parameters in the entry points;
     int m_baseOpcode;
+    bool m_decoderJumpTable; // dispatch decoded packets through a table rather than a switch
+    bool m_directEncoder; // client entry points call the encoder functions directly
     int setGlobalAttribute(const std::string & line, size_t lc);
 };
 
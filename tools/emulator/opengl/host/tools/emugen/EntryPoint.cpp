@@ -34,6 +34,8 @@ void EntryPoint::reset()
 {
     m_unsupported = false;
     m_customDecoder = false;
+    m_deferredReply = false;
+    m_clientOverride = false;
     m_vars.empty();
 }
 
@@ -280,6 +282,22 @@ int EntryPoint::setAttribute(const std::string &line, size_t lc)
                 fprintf(stderr, "WARNING: %u: setting nullAllowed for non-pointer variable %s\n",
                         (unsigned int) lc, v->name().c_str());
             }
+        } else if (flag == "isLarge") {
+            if (v->isPointer()) {
+                v->setIsLarge(true);
+            } else {
+                fprintf(stderr, "WARNING: %u: setting isLarge for non-pointer variable %s\n",
+                        (unsigned int) lc, v->name().c_str());
+            }
+        } else if (flag == "isBulk") {
+            if (v->isPointer()) {
+                // the data is sent as an isLarge one when it cannot be bulk
+                v->setIsLarge(true);
+                v->setIsBulk(true);
+            } else {
+                fprintf(stderr, "WARNING: %u: setting isBulk for non-pointer variable %s\n",
+                        (unsigned int) lc, v->name().c_str());
+            }
         } else {
             fprintf(stderr, "WARNING: %u: unknow flag %s\n", (unsigned int)lc, flag.c_str());
         }
@@ -312,6 +330,10 @@ int EntryPoint::setAttribute(const std::string &line, size_t lc)
             setUnsupported(true);
         } else if (flag == "custom_decoder") {
             setCustomDecoder(true);
+        } else if (flag == "deferred_reply") {
+            setDeferredReply(true);
+        } else if (flag == "client_override") {
+            setClientOverride(true);
         } else {
             fprintf(stderr, "WARNING: %u: unknown flag %s\n", (unsigned int)lc, flag.c_str());
         }
@@ -45,6 +45,10 @@ public:
     void setUnsupported(bool state) { m_unsupported = state; }
     bool customDecoder() { return m_customDecoder; }
     void setCustomDecoder(bool state) { m_customDecoder = state; }
+    bool deferredReply() const { return m_deferredReply; }
+    void setDeferredReply(bool state) { m_deferredReply = state; }
+    bool clientOverride() const { return m_clientOverride; }
+    void setClientOverride(bool state) { m_clientOverride = state; }
     int setAttribute(const std::string &line, size_t lc);
 
 private:
@@ -54,6 +58,8 @@ private:
     VarsArray m_vars;
     bool m_unsupported;
     bool m_customDecoder;
+    bool m_deferredReply;
+    bool m_clientOverride;
 
     void err(unsigned int lc, const char *msg) {
         fprintf(stderr, "line %d: %s\n", lc, msg);
@@ -30,6 +30,8 @@ public:
         m_lenExpression(""),
         m_pointerDir(POINTER_IN),
         m_nullAllowed(false),
+        m_isLarge(false),
+        m_isBulk(false),
         m_packExpression("")
 
     {
@@ -45,6 +47,8 @@ public:
         m_lenExpression(lenExpression),
         m_pointerDir(dir),
         m_nullAllowed(false),
+        m_isLarge(false),
+        m_isBulk(false),
         m_packExpression(packExpression)
     {
     }
@@ -58,7 +62,8 @@ public:
         m_packExpression = packExpression;
         m_pointerDir = dir;
         m_nullAllowed = false;
-
+        m_isLarge = false;
+        m_isBulk = false;
     }
 
     const std::string & name() const { return m_name; }
@@ -73,6 +78,10 @@ public:
     PointerDir pointerDir() { return m_pointerDir; }
     void setNullAllowed(bool state) { m_nullAllowed = state; }
     bool nullAllowed() const { return m_nullAllowed; }
+    void setIsLarge(bool state) { m_isLarge = state; }
+    bool isLarge() const { return m_isLarge; }
+    void setIsBulk(bool state) { m_isBulk = state; }
+    bool isBulk() const { return m_isBulk && m_pointerDir == POINTER_IN; }
     void printType(FILE *fp) { fprintf(fp, "%s", m_type->name().c_str()); }
     void printTypeName(FILE *fp) { printType(fp); fprintf(fp, " %s", m_name.c_str()); }
 
@@ -83,6 +92,8 @@ private:
     std::string m_lenExpression; // an expression to calcualte a pointer data size
     PointerDir m_pointerDir;
     bool m_nullAllowed;
+    bool m_isLarge; // pointer data is sent directly from the caller memory
+    bool m_isBulk;  // pointer data may go through the stream side channel
     std::string m_packExpression; // an expression to pack data into the stream
 
 };
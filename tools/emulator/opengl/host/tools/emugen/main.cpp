@@ -35,6 +35,8 @@ void usage(const char *filename)
     fprintf(stderr, "\t-i: input dir, local directory by default\n");
     fprintf(stderr, "\t-T : generate attribute template into the input directory\n\t\tno other files are generated\n");
     fprintf(stderr, "\t-W : generate wrapper into dir\n");
+    fprintf(stderr, "\t-J : make the decoder dispatch through a jump table instead of a switch\n");
+    fprintf(stderr, "\t-S : make the client entry points call the encoder functions directly,\n\t\texcept for the client_override ones\n");
 }
 
 int main(int argc, char *argv[])
@@ -44,9 +46,11 @@ int main(int argc, char *argv[])
     std::string wrapperDir = "";
     std::string inDir = ".";
     bool generateAttributesTemplate = false;
+    bool decoderJumpTable = false;
+    bool directEncoder = false;
 
     int c;
-    while((c = getopt(argc, argv, "TE:D:i:hW:")) != -1) {
+    while((c = getopt(argc, argv, "TJSE:D:i:hW:")) != -1) {
         switch(c) {
         case 'W':
             wrapperDir = std::string(optarg);
@@ -54,6 +58,12 @@ int main(int argc, char *argv[])
         case 'T':
             generateAttributesTemplate = true;
             break;
+        case 'J':
+            decoderJumpTable = true;
+            break;
+        case 'S':
+            directEncoder = true;
+            break;
         case 'h':
             usage(argv[0]);
             exit(0);
@@ -91,6 +101,8 @@ int main(int argc, char *argv[])
 
     std::string baseName = std::string(argv[optind]);
     ApiGen apiEntries(baseName);
+    apiEntries.setDecoderJumpTable(decoderJumpTable);
+    apiEntries.setDirectEncoder(directEncoder);
 
     // init types;
     std::string typesFilename = inDir + "/" + baseName + TYPES_EXTENTION;
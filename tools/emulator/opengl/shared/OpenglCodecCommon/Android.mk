@@ -8,9 +8,17 @@ include $(CLEAR_VARS)
 
 OpenglCodecCommon := \
         GLClientState.cpp \
+        GLMatrixState.cpp \
         glUtils.cpp \
+        Instrument.cpp \
+        LoopbackStream.cpp \
+        SocketStream.cpp \
+        StreamChecksum.cpp \
+        StreamCompress.cpp \
         TcpStream.cpp \
-        TimeUtils.cpp
+        TextureHash.cpp \
+        TimeUtils.cpp \
+        UnixStream.cpp
 
 LOCAL_SRC_FILES :=  $(OpenglCodecCommon)
 
@@ -25,7 +33,8 @@ include $(BUILD_STATIC_LIBRARY)
 ### OpenglCodecCommon  host ##############################################
 include $(CLEAR_VARS)
 
-LOCAL_SRC_FILES :=  $(OpenglCodecCommon)
+LOCAL_SRC_FILES :=  $(OpenglCodecCommon) \
+        TextureCache.cpp
 
 LOCAL_C_INCLUDES += $(emulatorOpengl)/host/include/libOpenglRender 
 
@@ -33,6 +42,7 @@ LOCAL_MODULE_TAGS := debug
 LOCAL_MODULE := libOpenglCodecCommon
 LOCAL_PRELINK_MODULE := false
 
+# Define WITH_INSTRUMENTATION in the modules to instrument, see Instrument.h
 # XXX - enable the next line for host debugging - JR
 # LOCAL_CFLAGS := -O0 -g
 include $(BUILD_HOST_STATIC_LIBRARY)
@@ -16,23 +16,41 @@
 #ifndef _FIXED_BUFFER_H
 #define _FIXED_BUFFER_H
 
+//
+// FixedBuffer - scratch buffer which grows to the largest size asked for.
+//    It is released after FIXED_BUFFER_SHRINK_ALLOCS consecutive allocations
+//    using at most a quarter of it, so that a single large transfer does
+//    not pin its memory for the life of the owner.
+//
+#define FIXED_BUFFER_SHRINK_ALLOCS 64
+
 class FixedBuffer {
 public:
     FixedBuffer(size_t initialSize = 0) {
         m_buffer = NULL;
         m_bufferLen = 0;
+        m_smallAllocs = 0;
         alloc(m_bufferLen);
     }
 
     ~FixedBuffer() {
-        delete m_buffer;
+        delete [] m_buffer;
         m_bufferLen = 0;
     }
 
     void * alloc(size_t size) {
-        if (m_bufferLen >= size) return (void *)(m_buffer);
+        if (m_bufferLen >= size) {
+            if (size > m_bufferLen / 4) {
+                m_smallAllocs = 0;
+                return (void *)(m_buffer);
+            }
+            if (++m_smallAllocs < FIXED_BUFFER_SHRINK_ALLOCS) {
+                return (void *)(m_buffer);
+            }
+        }
+        m_smallAllocs = 0;
 
-        if (m_buffer != NULL) delete m_buffer;
+        if (m_buffer != NULL) delete [] m_buffer;
 
         m_bufferLen = size;
         m_buffer = new unsigned char[m_bufferLen];
@@ -45,6 +63,7 @@ public:
 private:
     unsigned char *m_buffer;
     size_t m_bufferLen;
+    int m_smallAllocs;
 };
 
 #endif
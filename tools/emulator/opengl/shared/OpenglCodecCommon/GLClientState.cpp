@@ -14,6 +14,7 @@
 * limitations under the License.
 */
 #include "GLClientState.h"
+#include "GLMatrixState.h"
 #include "ErrorLog.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -26,12 +27,19 @@ GLClientState::GLClientState(int nLocations)
     if (nLocations < LAST_LOCATION) {
         nLocations = LAST_LOCATION;
     }
+    // the enable state of each location is kept in a 64 bit mask
+    if (nLocations > 64) {
+        nLocations = 64;
+    }
     m_nLocations = nLocations;
     m_states = new VertexAttribState[m_nLocations];
+    m_sentArrays = new SentArrayData[m_nLocations];
     for (int i = 0; i < m_nLocations; i++) {
         m_states[i].enabled = 0;
-        m_states[i].enableDirty = false;
+        m_sentArrays[i].valid = false;
     }
+    m_enabledMask = 0;
+    m_enableDirtyMask = 0;
     m_currentArrayVbo = 0;
     m_currentIndexVbo = 0;
     // init gl constans;
@@ -53,11 +61,33 @@ GLClientState::GLClientState(int nLocations)
 
     m_pixelStore.unpack_alignment = 4;
     m_pixelStore.pack_alignment = 4;
+
+    m_indexBuffers = NULL;
+    m_nIndexBuffers = 0;
+    m_indexBuffersCapacity = 0;
+    m_indexGeneration = 0;
+    memset(m_indexRanges, 0, sizeof(m_indexRanges));
+    m_nextIndexRange = 0;
+    m_matrixState = NULL;
 }
 
 GLClientState::~GLClientState()
 {
     delete m_states;
+    delete [] m_sentArrays;
+    for (int i = 0; i < m_nIndexBuffers; i++) {
+        free(m_indexBuffers[i].data);
+    }
+    free(m_indexBuffers);
+    delete m_matrixState;
+}
+
+GLMatrixState *GLClientState::matrixState()
+{
+    if (m_matrixState == NULL) {
+        m_matrixState = new GLMatrixState();
+    }
+    return m_matrixState;
 }
 
 void GLClientState::enable(int location, int state)
@@ -66,8 +96,16 @@ void GLClientState::enable(int location, int state)
         return;
     }
 
-    m_states[location].enableDirty |= (state != m_states[location].enabled);
+    uint64_t bit = (uint64_t)1 << location;
+    if (state != m_states[location].enabled) {
+        m_enableDirtyMask |= bit;
+    }
     m_states[location].enabled = state;
+    if (state) {
+        m_enabledMask |= bit;
+    } else {
+        m_enabledMask &= ~bit;
+    }
 }
 
 void GLClientState::setState(int location, int size, GLenum type, GLboolean normalized, GLsizei stride, void *data)
@@ -93,6 +131,53 @@ void GLClientState::setBufferObject(int location, GLuint id)
     m_states[location].bufferObject = id;
 }
 
+bool GLClientState::clientArrayDataSent(int location, unsigned int first, unsigned int count)
+{
+    if (!validLocation(location)) {
+        return false;
+    }
+
+    const VertexAttribState *state = &m_states[location];
+    SentArrayData *sent = &m_sentArrays[location];
+    unsigned int datalen = state->elementSize * count;
+    unsigned int stride = state->stride == 0 ? state->elementSize : state->stride;
+    const unsigned char *ptr = (const unsigned char *)state->data + stride * first;
+
+    // hash the elements the way glUtilsPackPointerData packs them
+    uint64_t hash;
+    if (stride == state->elementSize) {
+        hash = glUtilsHashData(0, ptr, datalen);
+    } else {
+        hash = 0;
+        for (unsigned int i = 0; i < count; i++, ptr += stride) {
+            hash = glUtilsHashData(hash, ptr, state->elementSize);
+        }
+    }
+
+    if (sent->valid && sent->hash == hash && sent->datalen == datalen &&
+        sent->size == state->size && sent->type == state->type &&
+        sent->stride == state->stride && sent->normalized == state->normalized) {
+        return true;
+    }
+
+    sent->valid = true;
+    sent->hash = hash;
+    sent->datalen = datalen;
+    sent->size = state->size;
+    sent->type = state->type;
+    sent->stride = state->stride;
+    sent->normalized = state->normalized;
+    return false;
+}
+
+void GLClientState::invalidateArrayData(int location)
+{
+    if (!validLocation(location)) {
+        return;
+    }
+    m_sentArrays[location].valid = false;
+}
+
 const GLClientState::VertexAttribState * GLClientState::getState(int location)
 {
     if (!validLocation(location)) {
@@ -107,11 +192,12 @@ const GLClientState::VertexAttribState * GLClientState::getStateAndEnableDirty(i
         return NULL;
     }
 
+    uint64_t bit = (uint64_t)1 << location;
     if (enableChanged) {
-        *enableChanged = m_states[location].enableDirty;
+        *enableChanged = (m_enableDirtyMask & bit) != 0;
     }
 
-    m_states[location].enableDirty = false;
+    m_enableDirtyMask &= ~bit;
     return & m_states[location];
 }
 
@@ -229,3 +315,138 @@ size_t GLClientState::pixelDataSize(GLsizei width, GLsizei height, GLenum format
     return aligned_linesize * height;
 }
 
+GLClientState::IndexBufferShadow *GLClientState::findIndexBuffer(GLuint id)
+{
+    for (int i = 0; i < m_nIndexBuffers; i++) {
+        if (m_indexBuffers[i].id == id) {
+            return &m_indexBuffers[i];
+        }
+    }
+    return NULL;
+}
+
+void GLClientState::bufferData(GLenum target, GLsizeiptr size, const void *data)
+{
+    if (target != GL_ELEMENT_ARRAY_BUFFER || m_currentIndexVbo == 0 || size < 0) {
+        return;
+    }
+
+    IndexBufferShadow *buf = findIndexBuffer(m_currentIndexVbo);
+    if (!buf) {
+        if (m_nIndexBuffers == m_indexBuffersCapacity) {
+            int capacity = m_indexBuffersCapacity ? m_indexBuffersCapacity * 2 : 8;
+            IndexBufferShadow *p = (IndexBufferShadow *)
+                realloc(m_indexBuffers, capacity * sizeof(IndexBufferShadow));
+            if (!p) {
+                return;
+            }
+            m_indexBuffers = p;
+            m_indexBuffersCapacity = capacity;
+        }
+        buf = &m_indexBuffers[m_nIndexBuffers++];
+        buf->id = m_currentIndexVbo;
+        buf->size = 0;
+        buf->data = NULL;
+    }
+
+    // the content of a buffer created without data is undefined
+    unsigned char *p = (unsigned char *)realloc(buf->data, size ? size : 1);
+    if (!p) {
+        free(buf->data);
+        buf->data = NULL;
+        buf->size = 0;
+    } else {
+        buf->data = p;
+        buf->size = size;
+        if (data) {
+            memcpy(buf->data, data, size);
+        }
+    }
+    buf->generation = ++m_indexGeneration;
+}
+
+void GLClientState::bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data)
+{
+    if (target != GL_ELEMENT_ARRAY_BUFFER || m_currentIndexVbo == 0) {
+        return;
+    }
+
+    IndexBufferShadow *buf = findIndexBuffer(m_currentIndexVbo);
+    if (!buf || !data || offset < 0 || size < 0 ||
+        (size_t)offset + size > buf->size) {
+        // out of range updates fail with GL_INVALID_VALUE
+        return;
+    }
+    memcpy(buf->data + offset, data, size);
+    buf->generation = ++m_indexGeneration;
+}
+
+void GLClientState::deleteBuffers(GLsizei n, const GLuint *buffers)
+{
+    for (int i = 0; i < n; i++) {
+        if (buffers[i] == 0) {
+            continue;
+        }
+
+        // deleted buffers are unbound
+        if (buffers[i] == m_currentArrayVbo) {
+            m_currentArrayVbo = 0;
+        }
+        if (buffers[i] == m_currentIndexVbo) {
+            m_currentIndexVbo = 0;
+        }
+
+        IndexBufferShadow *buf = findIndexBuffer(buffers[i]);
+        if (buf) {
+            free(buf->data);
+            *buf = m_indexBuffers[--m_nIndexBuffers];
+        }
+    }
+}
+
+const void *GLClientState::getIndexBufferRange(GLenum type, const void *offset, GLsizei count,
+                                               int *minIndex, int *maxIndex)
+{
+    IndexBufferShadow *buf = findIndexBuffer(m_currentIndexVbo);
+    size_t start = (size_t)offset;
+    size_t indexSize = glSizeof(type);
+    if (!buf || !buf->data || count < 0 || indexSize == 0 ||
+        start > buf->size || (buf->size - start) / indexSize < (size_t)count) {
+        return NULL;
+    }
+    const void *indices = buf->data + start;
+
+    for (int i = 0; i < INDEX_RANGE_CACHE_SIZE; i++) {
+        const IndexRange &r = m_indexRanges[i];
+        if (r.vbo == buf->id && r.generation == buf->generation &&
+            r.offset == (uintptr_t)offset && r.count == count && r.type == type) {
+            *minIndex = r.minIndex;
+            *maxIndex = r.maxIndex;
+            return indices;
+        }
+    }
+
+    switch (type) {
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE:
+        GLUtils::minmax<unsigned char>((unsigned char *)indices, count, minIndex, maxIndex);
+        break;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+        GLUtils::minmax<unsigned short>((unsigned short *)indices, count, minIndex, maxIndex);
+        break;
+    default:
+        return NULL;
+    }
+
+    IndexRange &r = m_indexRanges[m_nextIndexRange];
+    m_nextIndexRange = (m_nextIndexRange + 1) % INDEX_RANGE_CACHE_SIZE;
+    r.vbo = buf->id;
+    r.generation = buf->generation;
+    r.offset = (uintptr_t)offset;
+    r.count = count;
+    r.type = type;
+    r.minIndex = *minIndex;
+    r.maxIndex = *maxIndex;
+    return indices;
+}
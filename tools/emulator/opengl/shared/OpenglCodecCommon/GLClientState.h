@@ -29,9 +29,15 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include "ErrorLog.h"
 #include "codec_defs.h"
 
+class GLMatrixState;
+
+// number of indexed draw ranges remembered by GLClientState
+#define INDEX_RANGE_CACHE_SIZE 8
+
 class GLClientState {
 public:
     typedef enum {
@@ -52,17 +58,20 @@ public:
         LAST_LOCATION = 14
     } StateLocation;
 
+    //
+    // the fields read on every draw come first, the enable state is
+    // mirrored in the enabled mask of GLClientState (see enabledMask)
+    //
     typedef struct {
-        GLint enabled;
-        GLint size;
-        GLenum type;
-        GLsizei stride;
         void *data;
         GLuint bufferObject;
-        GLenum glConst;
+        GLsizei stride;
         unsigned int elementSize;
-        bool enableDirty;  // true if any enable state has changed since last draw
+        GLint size;
+        GLenum type;
+        GLint enabled;
         bool normalized;
+        GLenum glConst;
     } VertexAttribState;
 
     typedef struct {
@@ -70,6 +79,39 @@ public:
         int pack_alignment;
     } PixelStoreState;
 
+    //
+    // guest side copy of an element array buffer, 'generation' changes
+    // whenever its content does
+    //
+    typedef struct {
+        GLuint id;
+        unsigned int generation;
+        size_t size;
+        unsigned char *data;
+    } IndexBufferShadow;
+
+    // vertex range of an indexed draw from an element array buffer
+    typedef struct {
+        GLuint vbo;
+        unsigned int generation;
+        uintptr_t offset;
+        GLsizei count;
+        GLenum type;
+        int minIndex;
+        int maxIndex;
+    } IndexRange;
+
+    // client array data last sent to the host for a location
+    typedef struct {
+        bool valid;
+        uint64_t hash;
+        unsigned int datalen;
+        GLint size;
+        GLenum type;
+        GLsizei stride;
+        bool normalized;
+    } SentArrayData;
+
 public:
     GLClientState(int nLocations = CODEC_MAX_VERTEX_ATTRIBUTES);
     ~GLClientState();
@@ -83,6 +125,36 @@ public:
     void setBufferObject(int location, GLuint id);
     const VertexAttribState  *getState(int location);
     const VertexAttribState  *getStateAndEnableDirty(int location, bool *enableChanged);
+
+    //
+    // enabledMask - bit i is set when location i is enabled.
+    // takeEnableDirtyMask - bit i is set when the enable state of location
+    //     i changed since the last call, the dirty bits are cleared.
+    // A draw only needs to walk the locations of
+    // enabledMask() | takeEnableDirtyMask(), see nextLocation.
+    //
+    uint64_t enabledMask() const { return m_enabledMask; }
+    uint64_t takeEnableDirtyMask() {
+        uint64_t mask = m_enableDirtyMask;
+        m_enableDirtyMask = 0;
+        return mask;
+    }
+
+    // nextLocation - removes the lowest location from a non empty mask and returns it
+    static int nextLocation(uint64_t *mask) {
+        uint64_t m = *mask;
+        *mask = m & (m - 1);
+#ifdef __GNUC__
+        return __builtin_ctzll(m);
+#else
+        int i = 0;
+        while (!(m & 1)) {
+            m >>= 1;
+            i++;
+        }
+        return i;
+#endif
+    }
     int getLocation(GLenum loc);
     void setActiveTexture(int texUnit) {m_activeTexture = texUnit; };
     int getActiveTexture() const { return m_activeTexture; }
@@ -120,14 +192,64 @@ public:
     }
     size_t pixelDataSize(GLsizei width, GLsizei height, GLenum format, GLenum type, int pack) const;
 
+    //
+    // bufferData/bufferSubData/deleteBuffers - keep track of the content of
+    //     the element array buffers, so the range of vertices an indexed
+    //     draw needs can be found when the vertex arrays are client side.
+    //     Only data uploaded while bound to GL_ELEMENT_ARRAY_BUFFER is kept.
+    //
+    void bufferData(GLenum target, GLsizeiptr size, const void *data);
+    void bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data);
+    void deleteBuffers(GLsizei n, const GLuint *buffers);
+
+    //
+    // getIndexBufferRange - returns the guest copy of the 'count' indices
+    //     of 'type' at 'offset' in the current element array buffer, and the
+    //     smallest and largest of them. The range of recent draws is cached
+    //     until the buffer content changes. Returns NULL if the buffer
+    //     content is not known.
+    //
+    const void *getIndexBufferRange(GLenum type, const void *offset, GLsizei count,
+                                    int *minIndex, int *maxIndex);
+
+    //
+    // clientArrayDataSent - returns true if the 'count' elements of the
+    //     client array of 'location' starting at 'first' are identical to
+    //     the data last sent to the host for it, which the host still uses
+    //     as long as no other pointer was set for the location. Otherwise
+    //     they are remembered as the last sent data and false is returned.
+    //     invalidateArrayData must be called whenever the host pointer of
+    //     the location is changed by other means.
+    //
+    bool clientArrayDataSent(int location, unsigned int first, unsigned int count);
+    void invalidateArrayData(int location);
+
+    // matrixState - the shadow of the GLES1 matrix stacks, made when first
+    //     needed so that GLES2 contexts do not pay for it
+    GLMatrixState *matrixState();
+
 private:
     PixelStoreState m_pixelStore;
     VertexAttribState *m_states;
     int m_nLocations;
+    uint64_t m_enabledMask;
+    uint64_t m_enableDirtyMask;
     GLuint m_currentArrayVbo;
     GLuint m_currentIndexVbo;
     int m_activeTexture;
 
+    IndexBufferShadow *m_indexBuffers;
+    int m_nIndexBuffers;
+    int m_indexBuffersCapacity;
+    unsigned int m_indexGeneration;
+    IndexRange m_indexRanges[INDEX_RANGE_CACHE_SIZE];
+    int m_nextIndexRange;
+
+    SentArrayData *m_sentArrays;
+    GLMatrixState *m_matrixState;
+
+    IndexBufferShadow *findIndexBuffer(GLuint id);
+
 
     bool validLocation(int location) { return (location >= 0 && location < m_nLocations); }
 public:
@@ -0,0 +1,85 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _GL_CONSTANT_CACHE_H
+#define _GL_CONSTANT_CACHE_H
+
+#include <string.h>
+
+// largest number of values of a cached glGet parameter
+#define GL_CONSTANT_MAX_VALUES 2
+
+//
+// GLConstantCache - values of the glGet parameters which are constants of
+// the host GL implementation (GL_MAX_TEXTURE_SIZE and the like). An encoder
+// keeps one per connection and only queries each of them once from the
+// host, in glGetIntegerv form, the other glGet variants convert them.
+//
+class GLConstantCache {
+public:
+    typedef struct {
+        GLenum param;
+        int count;      // number of values, at most GL_CONSTANT_MAX_VALUES
+    } Constant;
+
+    // 'constants' must stay valid for the life of the cache
+    GLConstantCache(const Constant *constants, int nConstants) :
+        m_constants(constants),
+        m_nConstants(nConstants)
+    {
+        memset(m_valid, 0, sizeof(m_valid));
+    }
+
+    //
+    // get - copies the values of 'param' into 'values' and returns their
+    //     number. Returns 0 if 'param' is not a constant or its values are
+    //     not known yet, they are then given to set once queried.
+    //
+    int get(GLenum param, GLint *values) const
+    {
+        int i = find(param);
+        if (i < 0 || !m_valid[i]) return 0;
+        memcpy(values, m_values[i], m_constants[i].count * sizeof(GLint));
+        return m_constants[i].count;
+    }
+
+    void set(GLenum param, const GLint *values)
+    {
+        int i = find(param);
+        if (i < 0) return;
+        memcpy(m_values[i], values, m_constants[i].count * sizeof(GLint));
+        m_valid[i] = true;
+    }
+
+    bool isConstant(GLenum param) const { return find(param) >= 0; }
+
+private:
+    enum { MAX_CONSTANTS = 32 };
+
+    int find(GLenum param) const
+    {
+        for (int i = 0; i < m_nConstants && i < MAX_CONSTANTS; i++) {
+            if (m_constants[i].param == param) return i;
+        }
+        return -1;
+    }
+
+    const Constant *m_constants;
+    int m_nConstants;
+    bool m_valid[MAX_CONSTANTS];
+    GLint m_values[MAX_CONSTANTS][GL_CONSTANT_MAX_VALUES];
+};
+
+#endif
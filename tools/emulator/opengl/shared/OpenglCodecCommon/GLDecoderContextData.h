@@ -45,10 +45,11 @@ public:
         m_nLocations(nLocations)
     {
         m_pointerData = new FixedBuffer[m_nLocations];
+        m_interleavedLen = 0;
     }
 
     ~GLDecoderContextData() {
-        delete m_pointerData;
+        delete [] m_pointerData;
     }
 
     void storePointerData(unsigned int loc, void *data, size_t len) {
@@ -61,9 +62,22 @@ public:
         assert(loc < m_nLocations);
         return m_pointerData[loc].ptr();
     }
+
+    // block of interleaved client arrays shared by several locations
+    void storeInterleavedData(void *data, size_t len) {
+        m_interleavedData.alloc(len);
+        memcpy(m_interleavedData.ptr(), data, len);
+        m_interleavedLen = len;
+    }
+    void *interleavedData(size_t offset) {
+        if (offset >= m_interleavedLen) return NULL;
+        return (unsigned char *)m_interleavedData.ptr() + offset;
+    }
 private:
     FixedBuffer *m_pointerData;
     int m_nLocations;
+    FixedBuffer m_interleavedData;
+    size_t m_interleavedLen;
 };
 
 #endif
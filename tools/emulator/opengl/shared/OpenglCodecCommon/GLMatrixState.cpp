@@ -0,0 +1,303 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "GLClientState.h"
+#include "GLMatrixState.h"
+#include <math.h>
+#include <string.h>
+
+static const GLfloat sIdentity[16] = {
+    1, 0, 0, 0,
+    0, 1, 0, 0,
+    0, 0, 1, 0,
+    0, 0, 0, 1
+};
+
+GLMatrixState::GLMatrixState()
+{
+    initStack(&m_modelview, MODELVIEW_LEVELS);
+    initStack(&m_projection, PROJECTION_LEVELS);
+    for (int i = 0; i < TEXTURE_UNITS; i++) {
+        initStack(&m_texture[i], TEXTURE_LEVELS);
+    }
+    m_mode = GL_MODELVIEW;
+    m_activeTexture = 0;
+}
+
+GLMatrixState::~GLMatrixState()
+{
+    delete [] m_modelview.levels;
+    delete [] m_projection.levels;
+    for (int i = 0; i < TEXTURE_UNITS; i++) {
+        delete [] m_texture[i].levels;
+    }
+}
+
+void GLMatrixState::initStack(Stack *s, int nLevels)
+{
+    // a new context has the identity on each stack
+    s->levels = new Level[nLevels];
+    s->nLevels = nLevels;
+    s->depth = 1;
+    memcpy(s->levels[0].m, sIdentity, sizeof(sIdentity));
+    s->levels[0].precision = EXACT;
+}
+
+void GLMatrixState::matrixMode(GLenum mode)
+{
+    switch (mode) {
+    case GL_MODELVIEW:
+    case GL_PROJECTION:
+    case GL_TEXTURE:
+    case GL_MATRIX_PALETTE_OES:
+        m_mode = mode;
+        break;
+    default:
+        // GL_INVALID_ENUM, the mode does not change
+        break;
+    }
+}
+
+void GLMatrixState::activeTexture(GLenum texture, GLint maxUnits)
+{
+    GLint unit = (GLint)texture - GL_TEXTURE0;
+    if (unit >= 0 && unit < maxUnits) {
+        m_activeTexture = unit;
+    }
+}
+
+GLMatrixState::Stack *GLMatrixState::currentStack()
+{
+    switch (m_mode) {
+    case GL_MODELVIEW:
+        return &m_modelview;
+    case GL_PROJECTION:
+        return &m_projection;
+    case GL_TEXTURE:
+        return m_activeTexture < TEXTURE_UNITS ? &m_texture[m_activeTexture] : NULL;
+    }
+    return NULL;
+}
+
+const GLMatrixState::Stack *GLMatrixState::stack(GLenum param) const
+{
+    switch (param) {
+    case GL_MODELVIEW_MATRIX:
+    case GL_MODELVIEW_STACK_DEPTH:
+        return &m_modelview;
+    case GL_PROJECTION_MATRIX:
+    case GL_PROJECTION_STACK_DEPTH:
+        return &m_projection;
+    case GL_TEXTURE_MATRIX:
+    case GL_TEXTURE_STACK_DEPTH:
+        return m_activeTexture < TEXTURE_UNITS ? &m_texture[m_activeTexture] : NULL;
+    }
+    return NULL;
+}
+
+GLMatrixState::Level *GLMatrixState::top()
+{
+    Stack *s = currentStack();
+    if (s == NULL || s->depth > s->nLevels) return NULL;
+    return &s->levels[s->depth - 1];
+}
+
+GLenum GLMatrixState::maxDepthParam() const
+{
+    switch (m_mode) {
+    case GL_MODELVIEW:
+        return GL_MAX_MODELVIEW_STACK_DEPTH;
+    case GL_PROJECTION:
+        return GL_MAX_PROJECTION_STACK_DEPTH;
+    case GL_TEXTURE:
+        return GL_MAX_TEXTURE_STACK_DEPTH;
+    }
+    return 0;
+}
+
+void GLMatrixState::push(GLint maxDepth)
+{
+    Stack *s = currentStack();
+    if (s == NULL || s->depth >= maxDepth) {
+        // GL_STACK_OVERFLOW, nothing is pushed
+        return;
+    }
+    s->depth++;
+    if (s->depth <= s->nLevels) {
+        s->levels[s->depth - 1] = s->levels[s->depth - 2];
+    }
+}
+
+void GLMatrixState::pop()
+{
+    Stack *s = currentStack();
+    if (s != NULL && s->depth > 1) {
+        s->depth--;
+    }
+}
+
+bool GLMatrixState::loadIdentity()
+{
+    return load(sIdentity);
+}
+
+bool GLMatrixState::load(const GLfloat *m)
+{
+    Level *l = top();
+    if (l == NULL) return true;
+
+    if (l->precision == EXACT && !memcmp(l->m, m, sizeof(l->m))) {
+        return false;
+    }
+    memcpy(l->m, m, sizeof(l->m));
+    l->precision = EXACT;
+    return true;
+}
+
+//
+// multTop - multiplies the current matrix by 'm' on the right, as the
+// GL does. The matrices are in column major order.
+//
+void GLMatrixState::multTop(const GLfloat *m)
+{
+    Level *l = top();
+    if (l == NULL || l->precision == UNKNOWN) return;
+
+    const GLfloat *a = l->m;
+    GLfloat r[16];
+    for (int col = 0; col < 4; col++) {
+        const GLfloat *b = m + col * 4;
+        for (int row = 0; row < 4; row++) {
+            r[col * 4 + row] = a[row] * b[0] + a[4 + row] * b[1] +
+                               a[8 + row] * b[2] + a[12 + row] * b[3];
+        }
+    }
+    memcpy(l->m, r, sizeof(r));
+    l->precision = COMPUTED;
+}
+
+void GLMatrixState::mult(const GLfloat *m)
+{
+    multTop(m);
+}
+
+void GLMatrixState::translate(GLfloat x, GLfloat y, GLfloat z)
+{
+    GLfloat m[16];
+    memcpy(m, sIdentity, sizeof(m));
+    m[12] = x;
+    m[13] = y;
+    m[14] = z;
+    multTop(m);
+}
+
+void GLMatrixState::scale(GLfloat x, GLfloat y, GLfloat z)
+{
+    GLfloat m[16];
+    memcpy(m, sIdentity, sizeof(m));
+    m[0] = x;
+    m[5] = y;
+    m[10] = z;
+    multTop(m);
+}
+
+void GLMatrixState::rotate(GLfloat angle, GLfloat x, GLfloat y, GLfloat z)
+{
+    GLfloat len = sqrtf(x * x + y * y + z * z);
+    if (len == 0.0f) {
+        // the GL leaves this undefined, the host decides
+        Level *l = top();
+        if (l != NULL) l->precision = UNKNOWN;
+        return;
+    }
+    x /= len;
+    y /= len;
+    z /= len;
+
+    GLfloat a = angle * (GLfloat)(M_PI / 180.0);
+    GLfloat c = cosf(a);
+    GLfloat s = sinf(a);
+    GLfloat t = 1.0f - c;
+
+    GLfloat m[16] = {
+        x * x * t + c,     y * x * t + z * s, x * z * t - y * s, 0,
+        x * y * t - z * s, y * y * t + c,     y * z * t + x * s, 0,
+        x * z * t + y * s, y * z * t - x * s, z * z * t + c,     0,
+        0,                 0,                 0,                 1
+    };
+    multTop(m);
+}
+
+void GLMatrixState::frustum(GLfloat l, GLfloat r, GLfloat b, GLfloat t, GLfloat n, GLfloat f)
+{
+    if (n <= 0 || f <= 0 || l == r || b == t || n == f) {
+        // GL_INVALID_VALUE, the matrix does not change
+        return;
+    }
+    GLfloat m[16] = {
+        2 * n / (r - l),   0,                 0,                      0,
+        0,                 2 * n / (t - b),   0,                      0,
+        (r + l) / (r - l), (t + b) / (t - b), -(f + n) / (f - n),     -1,
+        0,                 0,                 -2 * f * n / (f - n),   0
+    };
+    multTop(m);
+}
+
+void GLMatrixState::ortho(GLfloat l, GLfloat r, GLfloat b, GLfloat t, GLfloat n, GLfloat f)
+{
+    if (l == r || b == t || n == f) {
+        // GL_INVALID_VALUE, the matrix does not change
+        return;
+    }
+    GLfloat m[16] = {
+        2 / (r - l),        0,                  0,                  0,
+        0,                  2 / (t - b),        0,                  0,
+        0,                  0,                  -2 / (f - n),       0,
+        -(r + l) / (r - l), -(t + b) / (t - b), -(f + n) / (f - n), 1
+    };
+    multTop(m);
+}
+
+bool GLMatrixState::getMatrix(GLenum param, GLfloat *m) const
+{
+    const Stack *s = stack(param);
+    if (s == NULL || s->depth > s->nLevels) return false;
+
+    const Level *l = &s->levels[s->depth - 1];
+    if (l->precision == UNKNOWN) return false;
+    memcpy(m, l->m, sizeof(l->m));
+    return true;
+}
+
+bool GLMatrixState::getInteger(GLenum param, GLint *value) const
+{
+    switch (param) {
+    case GL_MATRIX_MODE:
+        *value = m_mode;
+        return true;
+    case GL_ACTIVE_TEXTURE:
+        *value = GL_TEXTURE0 + m_activeTexture;
+        return true;
+    case GL_MODELVIEW_STACK_DEPTH:
+    case GL_PROJECTION_STACK_DEPTH:
+    case GL_TEXTURE_STACK_DEPTH: {
+        const Stack *s = stack(param);
+        if (s == NULL) return false;
+        *value = s->depth;
+        return true;
+        }
+    }
+    return false;
+}
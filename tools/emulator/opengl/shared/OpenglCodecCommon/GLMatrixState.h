@@ -0,0 +1,105 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _GL_MATRIX_STATE_H_
+#define _GL_MATRIX_STATE_H_
+
+//
+// GLMatrixState - a shadow of the GLES1 fixed function matrix stacks of a
+// context, so that the matrix queries can be answered without asking the
+// host. The matrix calls are still all sent, apart from the loads of the
+// matrix the stack already has.
+//
+// The encoder gives every matrix call to the shadow before sending it,
+// and the host limits (stack depths, texture units) when they matter, so
+// that the calls the host rejects are rejected here as well. A matrix
+// the shadow is not sure of is unknown, its queries then go to the host.
+//
+class GLMatrixState {
+public:
+    // levels kept of each stack, deeper levels are counted but unknown
+    enum {
+        MODELVIEW_LEVELS = 32,
+        PROJECTION_LEVELS = 4,
+        TEXTURE_LEVELS = 4,
+        TEXTURE_UNITS = 8
+    };
+
+    GLMatrixState();
+    ~GLMatrixState();
+
+    void matrixMode(GLenum mode);
+    // 'maxUnits' is the host GL_MAX_TEXTURE_UNITS
+    void activeTexture(GLenum texture, GLint maxUnits);
+
+    // maxDepthParam - the glGet parameter holding the host depth limit of
+    //     the current stack, which push needs. 0 if the stack is not
+    //     shadowed (the matrix palette).
+    GLenum maxDepthParam() const;
+
+    void push(GLint maxDepth);
+    void pop();
+
+    //
+    // loadIdentity, load - return false if the current matrix is known to
+    //     be exactly the one loaded already, then the load needs not be sent
+    //
+    bool loadIdentity();
+    bool load(const GLfloat *m);
+
+    void mult(const GLfloat *m);
+    void translate(GLfloat x, GLfloat y, GLfloat z);
+    void scale(GLfloat x, GLfloat y, GLfloat z);
+    void rotate(GLfloat angle, GLfloat x, GLfloat y, GLfloat z);
+    void frustum(GLfloat l, GLfloat r, GLfloat b, GLfloat t, GLfloat n, GLfloat f);
+    void ortho(GLfloat l, GLfloat r, GLfloat b, GLfloat t, GLfloat n, GLfloat f);
+
+    // getMatrix - the GL_XXX_MATRIX queries, false if the matrix is unknown
+    bool getMatrix(GLenum param, GLfloat *m) const;
+    // getInteger - GL_MATRIX_MODE, GL_ACTIVE_TEXTURE and the stack depths
+    bool getInteger(GLenum param, GLint *value) const;
+
+private:
+    typedef enum {
+        UNKNOWN = 0,
+        COMPUTED,   // result of the shadow math, may differ from the host's
+        EXACT       // loaded, so equal to the host's
+    } Precision;
+
+    struct Level {
+        GLfloat m[16];
+        Precision precision;
+    };
+
+    struct Stack {
+        Level *levels;
+        int nLevels;
+        GLint depth;    // may be larger than nLevels
+    };
+
+    Stack m_modelview;
+    Stack m_projection;
+    Stack m_texture[TEXTURE_UNITS];
+    GLenum m_mode;
+    GLint m_activeTexture;
+
+    static void initStack(Stack *s, int nLevels);
+    Stack *currentStack();
+    const Stack *stack(GLenum param) const;
+    Level *top();
+    void multTop(const GLfloat *m);
+};
+
+#endif
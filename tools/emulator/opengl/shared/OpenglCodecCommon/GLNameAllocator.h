@@ -0,0 +1,169 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _GL_NAME_ALLOCATOR_H
+#define _GL_NAME_ALLOCATOR_H
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+//
+// GLNameAllocator - object names picked by the guest, so that glGen* and
+// glCreate* do not wait for the host to name the objects (see the
+// glGen*Guest entry points). The names are handed out in increasing order
+// and the search wraps around to the freed ones only at the end of the
+// table, which keeps them in the dense part of the host name tables while
+// a freed name is not reused before its glDelete*, which may still be in
+// the stream of another thread, had the time to reach the host.
+//
+// The guest does not know which contexts share their objects, so the
+// names are unique per process, the encoders have one allocator per
+// object type. Names an application binds without generating them are
+// marked used when they are seen.
+//
+class GLNameAllocator {
+public:
+    GLNameAllocator() : m_bits(NULL), m_words(0), m_next(1)
+    {
+        pthread_mutex_init(&m_lock, NULL);
+    }
+
+    ~GLNameAllocator()
+    {
+        free(m_bits);
+        pthread_mutex_destroy(&m_lock);
+    }
+
+    //
+    // alloc - stores 'n' new names in 'names'. Returns false if the
+    //     table could not grow, then no name was allocated.
+    //
+    bool alloc(int n, uint32_t *names)
+    {
+        pthread_mutex_lock(&m_lock);
+        uint32_t next = m_next;
+        int i;
+        for (i = 0; i < n; i++) {
+            uint32_t name = findFree(m_next);
+            if (name == 0) {
+                name = findFree(1);
+            }
+            if (name == 0) {
+                // full, the next name is past the end of the table
+                name = m_words ? m_words * 32 : 1;
+            }
+            if (!setUsed(name)) {
+                break;
+            }
+            names[i] = name;
+            m_next = name + 1;
+        }
+        if (i < n) {
+            // undo the partial allocation
+            for (int j = 0; j < i; j++) {
+                clearUsed(names[j]);
+            }
+            m_next = next;
+        }
+        pthread_mutex_unlock(&m_lock);
+        return i == n;
+    }
+
+    // release - frees the 'n' names of 'names', 0 and unknown ones are
+    //     skipped
+    void release(int n, const uint32_t *names)
+    {
+        pthread_mutex_lock(&m_lock);
+        for (int i = 0; i < n; i++) {
+            if (names[i] != 0 && isUsed(names[i])) {
+                clearUsed(names[i]);
+            }
+        }
+        pthread_mutex_unlock(&m_lock);
+    }
+
+    // markUsed - 'name' is in use without having been allocated here,
+    //     names past MAX_NAME are left to the application
+    void markUsed(uint32_t name)
+    {
+        if (name == 0 || name > MAX_NAME) return;
+
+        pthread_mutex_lock(&m_lock);
+        setUsed(name);
+        pthread_mutex_unlock(&m_lock);
+    }
+
+private:
+    enum { MAX_NAME = 1 << 24 };
+
+    // findFree - the first free name from 'start' to the end of the
+    //     table, 0 if there is none
+    uint32_t findFree(uint32_t start) const
+    {
+        uint32_t end = m_words * 32;
+        uint32_t name = start;
+        while (name < end) {
+            if (m_bits[name / 32] == 0xffffffff) {
+                name = (name / 32 + 1) * 32;
+            }
+            else if (!isUsed(name)) {
+                return name;
+            }
+            else {
+                name++;
+            }
+        }
+        return 0;
+    }
+
+    bool isUsed(uint32_t name) const
+    {
+        uint32_t word = name / 32;
+        return word < m_words && (m_bits[word] & (1u << (name % 32))) != 0;
+    }
+
+    bool setUsed(uint32_t name)
+    {
+        uint32_t word = name / 32;
+        if (word >= m_words) {
+            if (name > MAX_NAME) return false;
+            uint32_t words = m_words ? m_words * 2 : 64;
+            while (words <= word) {
+                words *= 2;
+            }
+            uint32_t *bits = (uint32_t *)realloc(m_bits, words * sizeof(uint32_t));
+            if (bits == NULL) return false;
+            memset(bits + m_words, 0, (words - m_words) * sizeof(uint32_t));
+            m_bits = bits;
+            m_words = words;
+        }
+        m_bits[word] |= 1u << (name % 32);
+        return true;
+    }
+
+    void clearUsed(uint32_t name)
+    {
+        m_bits[name / 32] &= ~(1u << (name % 32));
+    }
+
+    pthread_mutex_t m_lock;
+    uint32_t *m_bits;
+    uint32_t m_words;
+    uint32_t m_next;  // where the search for a free name starts
+};
+
+#endif
@@ -0,0 +1,215 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _GL_PROGRAM_LOCATIONS_H
+#define _GL_PROGRAM_LOCATIONS_H
+
+#include <stdlib.h>
+#include <string.h>
+
+//
+// Reply of glGetProgramLocations, which returns all the active attributes
+// and uniforms of a linked program in one request. It is an array of GLint:
+//
+//   [0] size in bytes of the whole table, which is truncated to the
+//       buffer size given to the request if it is larger
+//   [1] GL_LINK_STATUS of the program, 0 if it is not a program
+//   [2] number of entries, 0 if the program is not linked
+//
+// followed by the entries, each made of:
+//
+//   kind       GL_PROGRAM_LOCATION_ATTRIB or GL_PROGRAM_LOCATION_UNIFORM
+//   flags      GL_PROGRAM_LOCATION_ARRAY for uniform arrays
+//   size       number of array elements, 1 otherwise
+//   length     length of the name, without any "[0]" suffix
+//   name       'length' chars, padded with zeros to a multiple of 4 bytes
+//   locations  'size' values, the location of each array element
+//
+#define GL_PROGRAM_LOCATION_HEADER 3
+#define GL_PROGRAM_LOCATION_ATTRIB 0
+#define GL_PROGRAM_LOCATION_UNIFORM 1
+#define GL_PROGRAM_LOCATION_ARRAY 1
+
+// number of GLints taken by a name of 'length' chars
+#define GL_PROGRAM_LOCATION_NAME_INTS(length) (((length) + sizeof(GLint)) / sizeof(GLint))
+
+//
+// GLProgramLocations - the location tables of the linked programs of a
+// context, so that glGetAttribLocation and glGetUniformLocation can be
+// answered without asking the host. The names the tables cannot answer
+// (a bad index, a non-active name) are asked to the host and remembered.
+// A program's table is dropped when it is relinked or deleted.
+//
+class GLProgramLocations {
+public:
+    GLProgramLocations() : m_programs(NULL) {}
+
+    ~GLProgramLocations() { clear(); }
+
+    // clear - forgets about all the programs, when another context is made
+    //     current on the encoder
+    void clear()
+    {
+        while (m_programs != NULL) {
+            remove(m_programs->program);
+        }
+    }
+
+    // hasTable - true if the table of 'program' was fetched since it was
+    //     last linked
+    bool hasTable(GLuint program) const { return find(program) != NULL; }
+
+    // isLinked - true if the table of 'program' was fetched and says it is
+    //     successfully linked
+    bool isLinked(GLuint program) const
+    {
+        const Program *p = find(program);
+        return p != NULL && p->linked;
+    }
+
+    // setTable - takes ownership of 'table', a malloc'ed reply of
+    //     glGetProgramLocations. A program which is not linked gets an
+    //     empty table, then all its lookups go to the host.
+    void setTable(GLuint program, GLint *table)
+    {
+        remove(program);
+        Program *p = new Program;
+        p->program = program;
+        p->table = table;
+        p->linked = table[1] != 0;
+        p->lookups = NULL;
+        p->nLookups = 0;
+        p->next = m_programs;
+        m_programs = p;
+    }
+
+    // remove - forgets about 'program', when it is relinked or deleted
+    void remove(GLuint program)
+    {
+        for (Program **pp = &m_programs; *pp != NULL; pp = &(*pp)->next) {
+            Program *p = *pp;
+            if (p->program == program) {
+                *pp = p->next;
+                while (p->lookups != NULL) {
+                    Lookup *l = p->lookups;
+                    p->lookups = l->next;
+                    free(l->name);
+                    delete l;
+                }
+                free(p->table);
+                delete p;
+                return;
+            }
+        }
+    }
+
+    //
+    // get - looks 'name' of 'kind' up in the table of 'program'. Returns
+    //     false if the host has to be asked, then its answer should be given
+    //     to addLookup.
+    //
+    bool get(GLuint program, int kind, const char *name, GLint *location) const
+    {
+        const Program *p = find(program);
+        if (p == NULL || !p->linked) return false;
+
+        for (const Lookup *l = p->lookups; l != NULL; l = l->next) {
+            if (l->kind == kind && !strcmp(l->name, name)) {
+                *location = l->location;
+                return true;
+            }
+        }
+
+        // split a trailing array index, "[0]" and no index are the same
+        size_t len = strlen(name);
+        int index = -1;
+        if (len > 3 && name[len - 1] == ']') {
+            size_t i = len - 2;
+            while (i > 0 && name[i] >= '0' && name[i] <= '9') i--;
+            if (name[i] == '[' && i < len - 2 && (name[i + 1] != '0' || i == len - 3)) {
+                index = atoi(name + i + 1);
+                len = i;
+            }
+        }
+
+        const GLint *entry = p->table + GL_PROGRAM_LOCATION_HEADER;
+        for (GLint n = 0; n < p->table[2]; n++) {
+            GLint size = entry[2];
+            GLint length = entry[3];
+            const char *entryName = (const char *)(entry + 4);
+            const GLint *locations = entry + 4 + GL_PROGRAM_LOCATION_NAME_INTS(length);
+            if (entry[0] == kind && (size_t)length == len && !memcmp(entryName, name, len)) {
+                if (index < 0) {
+                    *location = locations[0];
+                    return true;
+                }
+                if ((entry[1] & GL_PROGRAM_LOCATION_ARRAY) && index < size) {
+                    *location = locations[index];
+                    return true;
+                }
+                return false;
+            }
+            entry = locations + size;
+        }
+        return false;
+    }
+
+    // addLookup - remembers the host answer for a name 'get' did not find
+    void addLookup(GLuint program, int kind, const char *name, GLint location)
+    {
+        Program *p = find(program);
+        if (p == NULL || !p->linked || p->nLookups >= MAX_LOOKUPS) return;
+
+        Lookup *l = new Lookup;
+        l->kind = kind;
+        l->name = strdup(name);
+        l->location = location;
+        l->next = p->lookups;
+        p->lookups = l;
+        p->nLookups++;
+    }
+
+private:
+    // bounds the names remembered per program, in case they are made up
+    enum { MAX_LOOKUPS = 64 };
+
+    struct Lookup {
+        int kind;
+        char *name;
+        GLint location;
+        Lookup *next;
+    };
+
+    struct Program {
+        GLuint program;
+        GLint *table;
+        bool linked;
+        Lookup *lookups;
+        int nLookups;
+        Program *next;
+    };
+
+    Program *find(GLuint program) const
+    {
+        for (Program *p = m_programs; p != NULL; p = p->next) {
+            if (p->program == program) return p;
+        }
+        return NULL;
+    }
+
+    Program *m_programs;
+};
+
+#endif
@@ -0,0 +1,127 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _GL_UNIFORM_SHADOW_H
+#define _GL_UNIFORM_SHADOW_H
+
+#include <stdlib.h>
+#include <string.h>
+
+// largest uniform value shadowed, a 4x4 float matrix
+#define GL_UNIFORM_SHADOW_MAX_BYTES (16 * sizeof(GLfloat))
+
+//
+// GLUniformShadow - the last uniform values an encoder sent for each
+// program, so that glUniform* calls setting the value a program already
+// has can be dropped. Each program gets a small direct-mapped table keyed
+// by location, a location which misses just gets its value sent again.
+// The values are dropped when the program is relinked or deleted.
+//
+class GLUniformShadow {
+public:
+    GLUniformShadow() : m_programs(NULL) {}
+
+    ~GLUniformShadow() { clear(); }
+
+    // clear - forgets about all the programs, when another context is made
+    //     current on the encoder
+    void clear()
+    {
+        while (m_programs != NULL) {
+            remove(m_programs->program);
+        }
+    }
+
+    //
+    // update - records that 'size' bytes of 'data' are the value of type
+    //     'type' at 'location' of 'program'. Returns false if that is
+    //     already its value, then the call setting it needs not be sent.
+    //
+    bool update(GLuint program, GLint location, GLenum type, const void *data, size_t size)
+    {
+        if (location < 0 || size > GL_UNIFORM_SHADOW_MAX_BYTES) return true;
+
+        Program *p = find(program);
+        if (p == NULL) {
+            p = (Program *)calloc(1, sizeof(Program));
+            if (p == NULL) return true;
+            p->program = program;
+            p->next = m_programs;
+            m_programs = p;
+        }
+
+        Value *v = &p->values[location % MAX_VALUES];
+        if (v->valid && v->location == location && v->type == type &&
+            !memcmp(v->data, data, size)) {
+            return false;
+        }
+        v->valid = true;
+        v->location = location;
+        v->type = type;
+        memcpy(v->data, data, size);
+        return true;
+    }
+
+    // invalidate - forgets the values of 'program', when they were set in
+    //     a way update does not follow (uniform arrays)
+    void invalidate(GLuint program)
+    {
+        Program *p = find(program);
+        if (p != NULL) {
+            memset(p->values, 0, sizeof(p->values));
+        }
+    }
+
+    // remove - forgets about 'program', when it is relinked or deleted
+    void remove(GLuint program)
+    {
+        for (Program **pp = &m_programs; *pp != NULL; pp = &(*pp)->next) {
+            Program *p = *pp;
+            if (p->program == program) {
+                *pp = p->next;
+                free(p);
+                return;
+            }
+        }
+    }
+
+private:
+    enum { MAX_VALUES = 64 };
+
+    struct Value {
+        bool valid;
+        GLint location;
+        GLenum type;
+        unsigned char data[GL_UNIFORM_SHADOW_MAX_BYTES];
+    };
+
+    struct Program {
+        GLuint program;
+        Value values[MAX_VALUES];
+        Program *next;
+    };
+
+    Program *find(GLuint program) const
+    {
+        for (Program *p = m_programs; p != NULL; p = p->next) {
+            if (p->program == program) return p;
+        }
+        return NULL;
+    }
+
+    Program *m_programs;
+};
+
+#endif
@@ -0,0 +1,265 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "Instrument.h"
+#include <cutils/threads.h>
+#include <stdlib.h>
+#include <string.h>
+
+//
+// values of all the counters and histograms as seen by one thread. Only
+// the owning thread writes to it, a snapshot reads it under s_lock.
+//
+struct InstrumentBlock {
+    unsigned long long counters[INSTRUMENT_MAX_COUNTERS];
+    struct {
+        unsigned long long count;
+        unsigned long long sum;
+        unsigned long long buckets[INSTRUMENT_BUCKETS];
+    } histograms[INSTRUMENT_MAX_HISTOGRAMS];
+    bool inUse;
+    InstrumentBlock *next;
+};
+
+//
+// s_lock protects the registered names and the list of blocks. The blocks
+// of exited threads are added into s_retired and then reused.
+//
+static mutex_t s_lock = MUTEX_INITIALIZER;
+static const char *s_counterNames[INSTRUMENT_MAX_COUNTERS];
+static int s_nCounters = 0;
+static const char *s_histogramNames[INSTRUMENT_MAX_HISTOGRAMS];
+static int s_nHistograms = 0;
+static InstrumentBlock *s_blocks = NULL;
+static InstrumentBlock s_retired;
+
+static thread_store_t s_tls = THREAD_STORE_INITIALIZER;
+
+static void retireBlock(void *ptr)
+{
+    InstrumentBlock *b = (InstrumentBlock *)ptr;
+    if (!b) {
+        return;
+    }
+
+    mutex_lock(&s_lock);
+    for (int i = 0; i < INSTRUMENT_MAX_COUNTERS; i++) {
+        s_retired.counters[i] += b->counters[i];
+    }
+    for (int h = 0; h < INSTRUMENT_MAX_HISTOGRAMS; h++) {
+        s_retired.histograms[h].count += b->histograms[h].count;
+        s_retired.histograms[h].sum += b->histograms[h].sum;
+        for (int i = 0; i < INSTRUMENT_BUCKETS; i++) {
+            s_retired.histograms[h].buckets[i] += b->histograms[h].buckets[i];
+        }
+    }
+    InstrumentBlock *next = b->next;
+    memset(b, 0, sizeof(*b));
+    b->next = next;
+    mutex_unlock(&s_lock);
+}
+
+static InstrumentBlock *getThreadBlock()
+{
+    InstrumentBlock *b = (InstrumentBlock *)thread_store_get(&s_tls);
+    if (b) {
+        return b;
+    }
+
+    mutex_lock(&s_lock);
+    for (b = s_blocks; b != NULL; b = b->next) {
+        if (!b->inUse) {
+            break;
+        }
+    }
+    if (!b) {
+        b = (InstrumentBlock *)calloc(1, sizeof(InstrumentBlock));
+        if (b) {
+            b->next = s_blocks;
+            s_blocks = b;
+        }
+    }
+    if (b) {
+        b->inUse = true;
+    }
+    mutex_unlock(&s_lock);
+
+    if (b) {
+        thread_store_set(&s_tls, b, retireBlock);
+    }
+    return b;
+}
+
+static int registerName(const char **names, int *nNames, int maxNames,
+                        const char *name)
+{
+    int index = -1;
+    mutex_lock(&s_lock);
+    if (*nNames < maxNames) {
+        index = (*nNames)++;
+        names[index] = name;
+    }
+    mutex_unlock(&s_lock);
+    return index;
+}
+
+InstrumentCounter::InstrumentCounter(const char *name) :
+    m_name(name)
+{
+    m_index = registerName(s_counterNames, &s_nCounters,
+                           INSTRUMENT_MAX_COUNTERS, name);
+}
+
+void InstrumentCounter::add(unsigned long long n)
+{
+    InstrumentBlock *b;
+    if (m_index >= 0 && (b = getThreadBlock()) != NULL) {
+        b->counters[m_index] += n;
+    }
+}
+
+InstrumentHistogram::InstrumentHistogram(const char *name) :
+    m_name(name)
+{
+    m_index = registerName(s_histogramNames, &s_nHistograms,
+                           INSTRUMENT_MAX_HISTOGRAMS, name);
+}
+
+void InstrumentHistogram::record(unsigned long long value)
+{
+    InstrumentBlock *b;
+    if (m_index >= 0 && (b = getThreadBlock()) != NULL) {
+        b->histograms[m_index].count++;
+        b->histograms[m_index].sum += value;
+        b->histograms[m_index].buckets[Instrument::bucketIndex(value)]++;
+    }
+}
+
+int Instrument::bucketIndex(unsigned long long value)
+{
+    const int sub = 1 << INSTRUMENT_BUCKET_BITS;
+    if (value < (unsigned long long)sub) {
+        return (int)value;
+    }
+    if (value >> INSTRUMENT_MAX_VALUE_BITS) {
+        return INSTRUMENT_BUCKETS - 1;
+    }
+
+    int msb = INSTRUMENT_BUCKET_BITS;
+    while (value >> (msb + 1)) {
+        msb++;
+    }
+    int shift = msb - INSTRUMENT_BUCKET_BITS;
+    return ((shift + 1) << INSTRUMENT_BUCKET_BITS) + (int)((value >> shift) & (sub - 1));
+}
+
+unsigned long long Instrument::bucketLowerBound(int bucket)
+{
+    const int sub = 1 << INSTRUMENT_BUCKET_BITS;
+    if (bucket < sub) {
+        return bucket;
+    }
+    int shift = (bucket >> INSTRUMENT_BUCKET_BITS) - 1;
+    return (unsigned long long)(sub + (bucket & (sub - 1))) << shift;
+}
+
+void Instrument::snapshot(InstrumentSnapshot *snap)
+{
+    memset(snap, 0, sizeof(*snap));
+
+    mutex_lock(&s_lock);
+    snap->nCounters = s_nCounters;
+    for (int i = 0; i < s_nCounters; i++) {
+        snap->counters[i].name = s_counterNames[i];
+        snap->counters[i].value = s_retired.counters[i];
+        for (InstrumentBlock *b = s_blocks; b != NULL; b = b->next) {
+            snap->counters[i].value += b->counters[i];
+        }
+    }
+
+    snap->nHistograms = s_nHistograms;
+    for (int h = 0; h < s_nHistograms; h++) {
+        snap->histograms[h].name = s_histogramNames[h];
+        for (InstrumentBlock *b = s_blocks; ; b = b->next) {
+            const InstrumentBlock *src = b ? b : &s_retired;
+            snap->histograms[h].count += src->histograms[h].count;
+            snap->histograms[h].sum += src->histograms[h].sum;
+            for (int i = 0; i < INSTRUMENT_BUCKETS; i++) {
+                snap->histograms[h].buckets[i] += src->histograms[h].buckets[i];
+            }
+            if (!b) {
+                break;
+            }
+        }
+    }
+    mutex_unlock(&s_lock);
+}
+
+unsigned long long Instrument::percentile(const InstrumentSnapshot *snap,
+                                          int h, double p)
+{
+    unsigned long long count = snap->histograms[h].count;
+    if (count == 0) {
+        return 0;
+    }
+
+    // rank of the percentile, counted from 1
+    unsigned long long rank = (unsigned long long)(p * count / 100.0);
+    if (rank < 1) {
+        rank = 1;
+    }
+
+    unsigned long long seen = 0;
+    for (int i = 0; i < INSTRUMENT_BUCKETS; i++) {
+        seen += snap->histograms[h].buckets[i];
+        if (seen >= rank) {
+            return bucketLowerBound(i);
+        }
+    }
+    return bucketLowerBound(INSTRUMENT_BUCKETS - 1);
+}
+
+void Instrument::dump(FILE *fp)
+{
+    InstrumentSnapshot *snap = (InstrumentSnapshot *)malloc(sizeof(InstrumentSnapshot));
+    if (!snap) {
+        return;
+    }
+    snapshot(snap);
+
+    if (snap->nCounters > 0) {
+        fprintf(fp, "%-40s %16s\n", "counter", "value");
+        for (int i = 0; i < snap->nCounters; i++) {
+            fprintf(fp, "%-40s %16llu\n",
+                    snap->counters[i].name, snap->counters[i].value);
+        }
+    }
+
+    if (snap->nHistograms > 0) {
+        fprintf(fp, "%-40s %10s %12s %12s %12s %12s\n",
+                "histogram", "count", "mean", "p50", "p90", "p99");
+        for (int h = 0; h < snap->nHistograms; h++) {
+            unsigned long long count = snap->histograms[h].count;
+            fprintf(fp, "%-40s %10llu %12llu %12llu %12llu %12llu\n",
+                    snap->histograms[h].name, count,
+                    count ? snap->histograms[h].sum / count : 0,
+                    percentile(snap, h, 50.0),
+                    percentile(snap, h, 90.0),
+                    percentile(snap, h, 99.0));
+        }
+    }
+
+    free(snap);
+}
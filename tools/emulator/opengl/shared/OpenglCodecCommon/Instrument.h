@@ -0,0 +1,161 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _INSTRUMENT_H
+#define _INSTRUMENT_H
+
+#include <stdio.h>
+#include "TimeUtils.h"
+
+//
+// Instrument - named counters and histograms for the hot paths of the
+//    encoders, the decoders and the renderer.
+//
+//    Counters and histograms are static objects. Each thread updates its
+//    own copy of their values, so updating never takes a lock nor an
+//    atomic operation; a snapshot sums the copies of all the threads.
+//    Histograms have log-linear buckets: four buckets per power of two,
+//    which keeps the error on percentiles under 25%.
+//
+//    Everything compiles to nothing unless WITH_INSTRUMENTATION is
+//    defined, so the macros below can stay in the code:
+//
+//        INSTRUMENT_HISTOGRAM(s_drawTime, "GLEncoder.glDrawArrays.ns");
+//        INSTRUMENT_COUNTER(s_drawBytes, "GLEncoder.glDrawArrays.bytes");
+//
+//        void GLEncoder::s_glDrawArrays(...)
+//        {
+//            INSTRUMENT_SCOPED_TIMER(s_drawTime);
+//            ...
+//            INSTRUMENT_ADD(s_drawBytes, size);
+//        }
+//
+#define INSTRUMENT_MAX_COUNTERS 64
+#define INSTRUMENT_MAX_HISTOGRAMS 16
+
+// buckets of values up to 2^40, larger values go to the last bucket
+#define INSTRUMENT_BUCKET_BITS 2
+#define INSTRUMENT_MAX_VALUE_BITS 40
+#define INSTRUMENT_BUCKETS ((INSTRUMENT_MAX_VALUE_BITS - 1) << INSTRUMENT_BUCKET_BITS)
+
+class InstrumentCounter
+{
+public:
+    explicit InstrumentCounter(const char *name);
+
+    void add(unsigned long long n);
+    const char *name() const { return m_name; }
+
+private:
+    const char *m_name;
+    int m_index;
+};
+
+class InstrumentHistogram
+{
+public:
+    explicit InstrumentHistogram(const char *name);
+
+    void record(unsigned long long value);
+    const char *name() const { return m_name; }
+
+private:
+    const char *m_name;
+    int m_index;
+};
+
+class InstrumentScopedTimer
+{
+public:
+    explicit InstrumentScopedTimer(InstrumentHistogram &histogram) :
+        m_histogram(histogram),
+        m_start(GetCurrentTimeNS()) {}
+
+    ~InstrumentScopedTimer()
+    {
+        m_histogram.record(GetCurrentTimeNS() - m_start);
+    }
+
+private:
+    InstrumentHistogram &m_histogram;
+    long long m_start;
+};
+
+struct InstrumentSnapshot
+{
+    int nCounters;
+    struct {
+        const char *name;
+        unsigned long long value;
+    } counters[INSTRUMENT_MAX_COUNTERS];
+
+    int nHistograms;
+    struct {
+        const char *name;
+        unsigned long long count;
+        unsigned long long sum;
+        unsigned long long buckets[INSTRUMENT_BUCKETS];
+    } histograms[INSTRUMENT_MAX_HISTOGRAMS];
+};
+
+class Instrument
+{
+public:
+    //
+    // snapshot - sums the values of all the threads, including those
+    //     which have exited. Updates done concurrently may be missing.
+    //
+    static void snapshot(InstrumentSnapshot *snap);
+
+    // bucketIndex - the bucket 'value' is recorded in
+    static int bucketIndex(unsigned long long value);
+
+    // bucketLowerBound - the smallest value recorded in 'bucket'
+    static unsigned long long bucketLowerBound(int bucket);
+
+    //
+    // percentile - the lower bound of the bucket holding the 'p'th
+    //     percentile (0 to 100) of histogram 'h' of 'snap'
+    //
+    static unsigned long long percentile(const InstrumentSnapshot *snap,
+                                         int h, double p);
+
+    // dump - prints a snapshot in text form, nothing if nothing was used
+    static void dump(FILE *fp);
+};
+
+#ifdef WITH_INSTRUMENTATION
+
+#define INSTRUMENT_COUNTER(var, name) static InstrumentCounter var(name)
+#define INSTRUMENT_HISTOGRAM(var, name) static InstrumentHistogram var(name)
+#define INSTRUMENT_ADD(var, n) (var).add(n)
+#define INSTRUMENT_RECORD(var, value) (var).record(value)
+
+#define INSTRUMENT_CONCAT_(a, b) a##b
+#define INSTRUMENT_CONCAT(a, b) INSTRUMENT_CONCAT_(a, b)
+#define INSTRUMENT_SCOPED_TIMER(var) \
+        InstrumentScopedTimer INSTRUMENT_CONCAT(instrumentTimer, __LINE__)(var)
+
+#else
+
+#define INSTRUMENT_COUNTER(var, name) extern int var##NotInstrumented
+#define INSTRUMENT_HISTOGRAM(var, name) extern int var##NotInstrumented
+#define INSTRUMENT_ADD(var, n) do {} while (0)
+#define INSTRUMENT_RECORD(var, value) do {} while (0)
+#define INSTRUMENT_SCOPED_TIMER(var) do {} while (0)
+
+#endif
+
+#endif
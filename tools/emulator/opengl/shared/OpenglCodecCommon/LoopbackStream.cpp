@@ -0,0 +1,177 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "LoopbackStream.h"
+#include <string.h>
+
+LoopbackStream::LoopbackStream(size_t bufsize) :
+    IOStream(bufsize),
+    m_bufsize(bufsize),
+    m_buf(NULL),
+    m_peer(NULL),
+    m_pump(NULL),
+    m_pumpCookie(NULL),
+    m_queue(NULL),
+    m_queueSize(0),
+    m_queueLen(0),
+    m_queuePos(0),
+    m_bytesWritten(0),
+    m_writes(0)
+{
+}
+
+LoopbackStream::~LoopbackStream()
+{
+    if (m_peer) {
+        m_peer->m_peer = NULL;
+    }
+    free(m_buf);
+    free(m_queue);
+}
+
+void LoopbackStream::connect(LoopbackStream *a, LoopbackStream *b)
+{
+    a->m_peer = b;
+    b->m_peer = a;
+}
+
+void LoopbackStream::consume(size_t len)
+{
+    m_queuePos += len;
+    if (m_queuePos >= m_queueLen) {
+        m_queuePos = m_queueLen = 0;
+    }
+}
+
+//
+// queue - appends 'len' bytes to the queue of the peer, the read part of
+//     the queue is dropped first when it is worth it
+//
+bool LoopbackStream::queue(const void *data, size_t len)
+{
+    LoopbackStream *p = m_peer;
+    if (!p) {
+        return false;
+    }
+
+    if (p->m_queuePos > 0 && p->m_queuePos >= p->m_queueLen - p->m_queuePos) {
+        memmove(p->m_queue, p->m_queue + p->m_queuePos, p->m_queueLen - p->m_queuePos);
+        p->m_queueLen -= p->m_queuePos;
+        p->m_queuePos = 0;
+    }
+
+    if (p->m_queueLen + len > p->m_queueSize) {
+        size_t size = p->m_queueSize ? p->m_queueSize * 2 : m_bufsize;
+        while (size < p->m_queueLen + len) {
+            size *= 2;
+        }
+        unsigned char *q = (unsigned char *)realloc(p->m_queue, size);
+        if (!q) {
+            ERR("LoopbackStream: realloc (%d) failed\n", size);
+            return false;
+        }
+        p->m_queue = q;
+        p->m_queueSize = size;
+    }
+
+    memcpy(p->m_queue + p->m_queueLen, data, len);
+    p->m_queueLen += len;
+    m_bytesWritten += len;
+    return true;
+}
+
+bool LoopbackStream::waitData(size_t len)
+{
+    while (m_queueLen - m_queuePos < len) {
+        size_t before = m_queueLen - m_queuePos;
+        if (!m_pump) {
+            return false;
+        }
+        m_pump(m_pumpCookie);
+        if (m_queueLen - m_queuePos == before) {
+            return false;   // the pump had nothing for us
+        }
+    }
+    return true;
+}
+
+void *LoopbackStream::allocBuffer(size_t minSize)
+{
+    size_t allocSize = (m_bufsize < minSize ? minSize : m_bufsize);
+    if (m_buf && m_bufsize < allocSize) {
+        free(m_buf);
+        m_buf = NULL;
+    }
+    if (!m_buf) {
+        m_buf = (unsigned char *)malloc(allocSize);
+        if (m_buf != NULL) {
+            m_bufsize = allocSize;
+        } else {
+            ERR("malloc (%d) failed\n", allocSize);
+            m_bufsize = 0;
+        }
+    }
+
+    return m_buf;
+}
+
+int LoopbackStream::commitBuffer(size_t size)
+{
+    return writeFully(m_buf, size);
+}
+
+int LoopbackStream::commitBufferv(size_t size, const void *data, size_t len)
+{
+    m_writes++;
+    if (size > 0 && !queue(m_buf, size)) {
+        return -1;
+    }
+    if (len > 0 && !queue(data, len)) {
+        return -1;
+    }
+    return 0;
+}
+
+int LoopbackStream::writeFully(const void *buf, size_t len)
+{
+    m_writes++;
+    return queue(buf, len) ? 0 : -1;
+}
+
+const unsigned char *LoopbackStream::readFully(void *buf, size_t len)
+{
+    if (!buf || !waitData(len)) {
+        return NULL;
+    }
+    memcpy(buf, m_queue + m_queuePos, len);
+    consume(len);
+    return (const unsigned char *)buf;
+}
+
+const unsigned char *LoopbackStream::read(void *buf, size_t *inout_len)
+{
+    if (!buf || !inout_len || !waitData(1)) {
+        return NULL;
+    }
+
+    size_t len = m_queueLen - m_queuePos;
+    if (len > *inout_len) {
+        len = *inout_len;
+    }
+    memcpy(buf, m_queue + m_queuePos, len);
+    consume(len);
+    *inout_len = len;
+    return (const unsigned char *)buf;
+}
@@ -0,0 +1,83 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef __LOOPBACK_STREAM_H
+#define __LOOPBACK_STREAM_H
+
+#include <stdlib.h>
+#include "IOStream.h"
+
+//
+// LoopbackStream - one end of an in memory connection, to run an encoder
+//    and a decoder in the same thread without a pipe or a socket (e.g. to
+//    benchmark them). The data written to one end is queued until it is
+//    read from the other end.
+//
+//    A read which finds no data calls the pump function of the stream, if
+//    one was set, which is expected to make the other end write some. A
+//    pump on the encoder end typically decodes the commands pending on
+//    the decoder end, which then writes the replies.
+//
+class LoopbackStream : public IOStream {
+public:
+    typedef void (*PumpFunc)(void *cookie);
+
+    explicit LoopbackStream(size_t bufsize = 10000);
+    ~LoopbackStream();
+
+    // connect - connects 'a' and 'b' to each other
+    static void connect(LoopbackStream *a, LoopbackStream *b);
+
+    void setPump(PumpFunc pump, void *cookie) { m_pump = pump; m_pumpCookie = cookie; }
+
+    //
+    // pending - the data written by the other end, not read yet. The
+    //     decoding end can decode it in place and consume() what it used.
+    //
+    unsigned char *pending(size_t *len) { *len = m_queueLen - m_queuePos; return m_queue + m_queuePos; }
+    void consume(size_t len);
+
+    // bytes and transfers written to this end since it was created
+    unsigned long long bytesWritten() const { return m_bytesWritten; }
+    unsigned long long writes() const { return m_writes; }
+
+    virtual void *allocBuffer(size_t minSize);
+    virtual int commitBuffer(size_t size);
+    virtual const unsigned char *readFully( void *buf, size_t len);
+    virtual const unsigned char *read( void *buf, size_t *inout_len);
+    virtual int writeFully(const void *buf, size_t len);
+    virtual int commitBufferv(size_t size, const void *data, size_t len);
+
+private:
+    bool queue(const void *data, size_t len);
+    bool waitData(size_t len);
+
+    size_t m_bufsize;
+    unsigned char *m_buf;
+    LoopbackStream *m_peer;
+    PumpFunc m_pump;
+    void *m_pumpCookie;
+
+    // data written by the peer, m_queuePos bytes of it have been read
+    unsigned char *m_queue;
+    size_t m_queueSize;
+    size_t m_queueLen;
+    size_t m_queuePos;
+
+    unsigned long long m_bytesWritten;
+    unsigned long long m_writes;
+};
+
+#endif
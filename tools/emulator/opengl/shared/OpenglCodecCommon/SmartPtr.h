@@ -16,20 +16,24 @@
 #ifndef __SMART_PTR_H
 #define __SMART_PTR_H
 
-#include <cutils/threads.h>
 #include <cutils/atomic.h>
-
+#include <stdlib.h>
+
+//
+// SmartPtr - reference counted pointer, the object is deleted with its
+//    last reference. The count is updated with atomic operations so
+//    references to the same object can be copied and released from
+//    different threads, a single SmartPtr instance must not be assigned
+//    while another thread copies it.
+//
+//    The threadSafe parameter is only kept for source compatibility,
+//    all the pointers are thread safe the same way.
+//
 template <class T, bool threadSafe = false>
 class SmartPtr
 {
 public:
     explicit SmartPtr(T* ptr = (T*)NULL) {
-        if (threadSafe) {
-            m_lock = new mutex_t;
-            mutex_init(m_lock);
-        }
-        else m_lock = NULL;
-
         m_ptr = ptr;
         if (ptr)
            m_pRefCount = new int32_t(1);
@@ -37,41 +41,14 @@ public:
            m_pRefCount = NULL;
     }
 
-    SmartPtr<T,threadSafe>(const SmartPtr<T,false>& rhs) {
-        if (threadSafe) {
-            m_lock = new mutex_t;
-            mutex_init(m_lock);
-        }
-        else m_lock = NULL;
-
+    SmartPtr(const SmartPtr<T,threadSafe>& rhs) {
         m_pRefCount = rhs.m_pRefCount;
         m_ptr       = rhs.m_ptr;
         use();
     }
 
-    SmartPtr<T,threadSafe>(SmartPtr<T,true>& rhs) {
-        if (threadSafe) {
-            m_lock = new mutex_t;
-            mutex_init(m_lock);
-        }
-        else m_lock = NULL;
-
-        if (rhs.m_lock) mutex_lock(rhs.m_lock);
-        m_pRefCount = rhs.m_pRefCount;
-        m_ptr       = rhs.m_ptr;
-        use();
-        if (rhs.m_lock) mutex_unlock(rhs.m_lock);
-    }
-
     ~SmartPtr() {
-        if (m_lock) mutex_lock(m_lock);
         release();
-        if (m_lock)
-        {
-            mutex_unlock(m_lock);
-            mutex_destroy(m_lock);
-            delete m_lock;
-        }
     }
 
     T* Ptr() const {
@@ -96,45 +73,42 @@ public:
     }
 
     // This gives STL lists something to compare.
-    bool operator <(const SmartPtr<T>& t1) const {
+    bool operator <(const SmartPtr<T,threadSafe>& t1) const {
         return m_ptr < t1.m_ptr;
     }
 
-    SmartPtr<T,threadSafe>& operator=(const SmartPtr<T,false>& rhs)
+    SmartPtr<T,threadSafe>& operator=(const SmartPtr<T,threadSafe>& rhs)
     {
         if (m_ptr == rhs.m_ptr)
             return *this;
 
-        if (m_lock) mutex_lock(m_lock);
+        int32_t *refCount = rhs.m_pRefCount;
+        T *ptr = rhs.m_ptr;
+        if (refCount) android_atomic_inc(refCount);
         release();
-        m_pRefCount = rhs.m_pRefCount;
-        m_ptr       = rhs.m_ptr;
-        use();
-        if (m_lock) mutex_unlock(m_lock);
+        m_pRefCount = refCount;
+        m_ptr       = ptr;
 
         return *this;
     }
 
-    SmartPtr<T,threadSafe>& operator=(SmartPtr<T,true>& rhs)
+    //
+    // swap - exchanges the objects of two pointers without touching the
+    //        reference counts, to hand a reference over (what a move would
+    //        do) without the two atomic operations of a copy.
+    //
+    void swap(SmartPtr<T,threadSafe>& other)
     {
-        if (m_ptr == rhs.m_ptr)
-            return *this;
-
-        if (m_lock) mutex_lock(m_lock);
-        release();
-        if (rhs.m_lock) mutex_lock(rhs.m_lock);
-        m_pRefCount = rhs.m_pRefCount;
-        m_ptr       = rhs.m_ptr;
-        use();
-        if (rhs.m_lock) mutex_unlock(rhs.m_lock);
-        if (m_lock) mutex_unlock(m_lock);
-
-        return *this;
+        int32_t *refCount = m_pRefCount;
+        T *ptr = m_ptr;
+        m_pRefCount = other.m_pRefCount;
+        m_ptr       = other.m_ptr;
+        other.m_pRefCount = refCount;
+        other.m_ptr       = ptr;
     }
 
 private:
     int32_t  *m_pRefCount;
-    mutex_t  *m_lock;
     T* m_ptr;
 
     // Increment the reference count on this pointer by 1.
@@ -0,0 +1,570 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "SocketStream.h"
+#include "StreamCompress.h"
+#include "Instrument.h"
+#include <cutils/sockets.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+// only Linux can hold a partial frame back until the rest is sent
+#ifndef MSG_MORE
+#define MSG_MORE 0
+#endif
+
+// small reads are served from a buffer filled with reads of that size
+#define READ_AHEAD_SIZE 16384
+
+// kernel buffer sizes, large enough for a texture upload or so in flight
+#define SOCKET_BUFFER_SIZE (256 * 1024)
+
+#define SOCKET_COMPRESS_MAGIC      0x345a4c54  // 'TLZ4'
+#define SOCKET_COMPRESS_VERSION    1
+
+// smaller frames are not worth compressing
+#define SOCKET_COMPRESS_MIN_SIZE   256
+
+//
+// A compressed stream is a sequence of frames, each made of a header of
+// two 32-bit words, the size of the data and the size of the payload,
+// followed by the payload. The payload is the data itself if both sizes
+// match, its LZ4 block otherwise.
+//
+#define SOCKET_FRAME_HEADER_SIZE   8
+
+INSTRUMENT_COUNTER(s_compressIn, "SocketStream.compress.inBytes");
+INSTRUMENT_COUNTER(s_compressOut, "SocketStream.compress.outBytes");
+
+SocketStream::SocketStream(size_t bufSize) :
+    IOStream(bufSize),
+    m_sock(-1),
+    m_bufsize(bufSize),
+    m_buf(NULL),
+    m_readBuf(NULL),
+    m_readPos(0),
+    m_readValid(0),
+    m_compress(false),
+    m_sendFrame(NULL),
+    m_recvFrame(NULL)
+{
+}
+
+SocketStream::SocketStream(int sock, size_t bufSize) :
+    IOStream(bufSize),
+    m_sock(sock),
+    m_bufsize(bufSize),
+    m_buf(NULL),
+    m_readBuf(NULL),
+    m_readPos(0),
+    m_readValid(0),
+    m_compress(false),
+    m_sendFrame(NULL),
+    m_recvFrame(NULL)
+{
+    setOptions();
+}
+
+SocketStream::~SocketStream()
+{
+    if (m_sock >= 0) {
+        ::close(m_sock);
+    }
+    if (m_buf != NULL) {
+        free(m_buf);
+    }
+    free(m_readBuf);
+    free(m_sendFrame);
+    free(m_recvFrame);
+}
+
+void SocketStream::setOptions()
+{
+    if (m_sock < 0) {
+        return;
+    }
+
+    // not every transport has all the options, failures are harmless
+    int on = 1;
+    ::setsockopt(m_sock, IPPROTO_TCP, TCP_NODELAY, (const char *)&on, sizeof(on));
+
+    int size = SOCKET_BUFFER_SIZE;
+    ::setsockopt(m_sock, SOL_SOCKET, SO_SNDBUF, (const char *)&size, sizeof(size));
+    ::setsockopt(m_sock, SOL_SOCKET, SO_RCVBUF, (const char *)&size, sizeof(size));
+}
+
+void *SocketStream::allocBuffer(size_t minSize)
+{
+    size_t allocSize = minSize;
+    if (m_buf && (m_bufsize < allocSize || m_bufsize / 2 >= allocSize)) {
+        //
+        // IOStream only asks for a buffer once everything staged in the
+        // previous one was committed, do not copy it over. Large replies
+        // such as glReadPixels pixels grow the buffer this way, and an
+        // adaptive buffer (IOStream::setAdaptiveBuffer) shrinks back.
+        //
+        free(m_buf);
+        m_buf = NULL;
+    }
+    if (!m_buf) {
+        m_buf = (unsigned char *)malloc(allocSize);
+        if (m_buf != NULL) {
+            m_bufsize = allocSize;
+        } else {
+            ERR("malloc (%d) failed\n", allocSize);
+            m_bufsize = 0;
+        }
+    }
+
+    return m_buf;
+};
+
+void SocketStream::trimBuffers()
+{
+    free(m_buf);
+    m_buf = NULL;
+    free(m_sendFrame);
+    m_sendFrame = NULL;
+    free(m_recvFrame);
+    m_recvFrame = NULL;
+    // keep data read ahead, if any, it belongs to the next reply
+    if (m_readValid == 0) {
+        free(m_readBuf);
+        m_readBuf = NULL;
+        m_readPos = m_readValid = 0;
+    }
+}
+
+void SocketStream::interrupt()
+{
+    // the socket stays open, a blocked recv() returns 0
+    if (m_sock >= 0) {
+        ::shutdown(m_sock, 2 /* SHUT_RDWR / SD_BOTH */);
+    }
+}
+
+int SocketStream::commitBuffer(size_t size)
+{
+    return writeFully(m_buf, size);
+}
+
+int SocketStream::commitBufferv(size_t size, const void *data, size_t len)
+{
+#ifdef _WIN32
+    return IOStream::commitBufferv(size, data, len);
+#else
+    if (!valid()) return -1;
+    if (m_compress) {
+        // the frames of both parts leave together
+        int stat = writeFrames(m_buf, size, len > 0);
+        return stat < 0 ? stat : writeFrames(data, len, false);
+    }
+
+    struct iovec iov[2];
+    int niov = 0;
+    if (size > 0) {
+        iov[niov].iov_base = m_buf;
+        iov[niov].iov_len = size;
+        niov++;
+    }
+    if (len > 0) {
+        iov[niov].iov_base = (void *)data;
+        iov[niov].iov_len = len;
+        niov++;
+    }
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = niov;
+
+    while (msg.msg_iovlen > 0) {
+        ssize_t stat = ::sendmsg(m_sock, &msg, 0);
+        if (stat < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ERR("SocketStream::commitBufferv failed: %s\n", strerror(errno));
+            return stat;
+        }
+
+        // skip over what has been sent, a partial send may end mid-vector
+        while (msg.msg_iovlen > 0 && (size_t)stat >= msg.msg_iov->iov_len) {
+            stat -= msg.msg_iov->iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+        }
+        if (msg.msg_iovlen > 0) {
+            msg.msg_iov->iov_base = (char *)msg.msg_iov->iov_base + stat;
+            msg.msg_iov->iov_len -= stat;
+        }
+    }
+    return 0;
+#endif
+}
+
+int SocketStream::writeFully(const void *buf, size_t len)
+{
+    if (!valid()) return -1;
+    if (!m_compress) {
+        return writeRaw(buf, len);
+    }
+    return writeFrames(buf, len, false);
+}
+
+//
+// writeRaw - sends 'len' bytes as they are, retried on EINTR. 'more'
+//     tells that more data follows at once, so that the kernel does not
+//     push a partial segment out with Nagle's algorithm disabled.
+//
+int SocketStream::writeRaw(const void *buf, size_t len, bool more)
+{
+    size_t res = len;
+    int retval = 0;
+    int flags = more ? MSG_MORE : 0;
+
+    while (res > 0) {
+        ssize_t stat = ::send(m_sock, (const char *)(buf) + (len - res), res, flags);
+        if (stat < 0) {
+            if (errno != EINTR) {
+                retval =  stat;
+                ERR("SocketStream::writeFully failed: %s\n", strerror(errno));
+                break;
+            }
+        } else {
+            res -= stat;
+        }
+    }
+    return retval;
+}
+
+const unsigned char *SocketStream::readFully(void *buf, size_t len)
+{
+    if (!valid()) return NULL;
+    if (!buf) {
+      ERR("SocketStream::readFully failed, buf=NULL");
+      return NULL;  // do not allow NULL buf in that implementation
+    }
+
+    // serve what we can from data read ahead previously
+    size_t res = len - readBuffered(buf, len);
+
+    if (m_compress) {
+        while (res > 0) {
+            if (readFrame() <= 0) {
+                return NULL;
+            }
+            res -= readBuffered((char *)(buf) + len - res, res);
+        }
+        return (const unsigned char *)buf;
+    }
+
+    while (res > 0) {
+        char *dst = (char *)(buf) + len - res;
+        ssize_t stat;
+        if (res >= READ_AHEAD_SIZE) {
+            // large read - no point in going through the read-ahead buffer
+            stat = readRaw(dst, res);
+        }
+        else {
+            if (!m_readBuf) {
+                m_readBuf = (unsigned char *)malloc(READ_AHEAD_SIZE);
+                if (!m_readBuf) {
+                    ERR("SocketStream::readFully failed to allocate read-ahead buffer\n");
+                    return NULL;
+                }
+            }
+            stat = readRaw(m_readBuf, READ_AHEAD_SIZE);
+            if (stat > 0) {
+                m_readPos = 0;
+                m_readValid = stat;
+                stat = readBuffered(dst, res);
+            }
+        }
+
+        if (stat == 0) {
+            // client shutdown;
+            return NULL;
+        } else if (stat < 0) {
+            ERR("SocketStream::readFully failed (buf %p): %s\n", buf, strerror(errno));
+            return NULL;
+        }
+        res -= stat;
+    }
+    return (const unsigned char *)buf;
+}
+
+const unsigned char *SocketStream::read( void *buf, size_t *inout_len)
+{
+    if (!valid()) return NULL;
+    if (!buf) {
+      ERR("SocketStream::read failed, buf=NULL");
+      return NULL;  // do not allow NULL buf in that implementation
+    }
+
+    int n;
+    do {
+        n = recv(buf, *inout_len);
+    } while( n < 0 && errno == EINTR );
+
+    if (n > 0) {
+        *inout_len = n;
+        return (const unsigned char *)buf;
+    }
+
+    return NULL;
+}
+
+int SocketStream::recv(void *buf, size_t len)
+{
+    if (!valid()) return int(ERR_INVALID_SOCKET);
+    size_t n = readBuffered(buf, len);
+    if (n > 0) {
+        return n;
+    }
+    if (m_compress) {
+        int stat = readFrame();
+        return stat > 0 ? (int)readBuffered(buf, len) : stat;
+    }
+    int res = 0;
+    while(true) {
+        res = ::recv(m_sock, (char *)buf, len, 0);
+        if (res < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+        }
+        break;
+    }
+    return res;
+}
+
+//
+// readRaw - one read from the socket, retried on EINTR.
+//
+int SocketStream::readRaw(void *buf, size_t len)
+{
+    int res;
+    do {
+        res = ::recv(m_sock, (char *)buf, len, 0);
+    } while (res < 0 && errno == EINTR);
+    return res;
+}
+
+//
+// readBuffered - copy up to 'len' bytes of read-ahead data to 'buf',
+//     returns the number of bytes copied.
+//
+size_t SocketStream::readBuffered(void *buf, size_t len)
+{
+    size_t n = m_readValid < len ? m_readValid : len;
+    if (n > 0) {
+        memcpy(buf, m_readBuf + m_readPos, n);
+        m_readPos += n;
+        m_readValid -= n;
+    }
+    return n;
+}
+
+//
+// readRawFully - reads exactly 'len' bytes from the socket, bypassing the
+//     read-ahead buffer.
+//
+bool SocketStream::readRawFully(void *buf, size_t len)
+{
+    char *p = (char *)buf;
+    while (len > 0) {
+        int n = readRaw(p, len);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+//
+// writeFrames - sends 'len' bytes as frames of a compressed stream, all
+//     but the last one corked.
+//
+int SocketStream::writeFrames(const void *buf, size_t len, bool more)
+{
+    const char *p = (const char *)buf;
+    while (len > 0) {
+        size_t n = len < LZ4_MAX_BLOCK_SIZE ? len : LZ4_MAX_BLOCK_SIZE;
+        int stat = writeFrame(p, n, more || n < len);
+        if (stat < 0) {
+            return stat;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+//
+// writeFrame - sends 'len' bytes, at most LZ4_MAX_BLOCK_SIZE, as one frame
+//     of a compressed stream.
+//
+int SocketStream::writeFrame(const void *buf, size_t len, bool more)
+{
+    if (!m_sendFrame) {
+        m_sendFrame = (unsigned char *)malloc(SOCKET_FRAME_HEADER_SIZE +
+                                              LZ4_MAX_BLOCK_SIZE);
+        if (!m_sendFrame) {
+            ERR("SocketStream::writeFrame failed to allocate frame buffer\n");
+            return -1;
+        }
+    }
+
+    unsigned char *payload = m_sendFrame + SOCKET_FRAME_HEADER_SIZE;
+    size_t payloadLen = 0;
+    if (len >= SOCKET_COMPRESS_MIN_SIZE) {
+        // only keep the compressed block if it is smaller
+        payloadLen = lz4Compress(buf, len, payload, len - 1);
+    }
+    if (payloadLen == 0) {
+        memcpy(payload, buf, len);
+        payloadLen = len;
+    }
+
+    uint32_t header[2] = { (uint32_t)len, (uint32_t)payloadLen };
+    memcpy(m_sendFrame, header, sizeof(header));
+
+    INSTRUMENT_ADD(s_compressIn, len);
+    INSTRUMENT_ADD(s_compressOut, SOCKET_FRAME_HEADER_SIZE + payloadLen);
+    return writeRaw(m_sendFrame, SOCKET_FRAME_HEADER_SIZE + payloadLen, more);
+}
+
+//
+// readFrame - receives the next frame of a compressed stream into the
+//     read-ahead buffer, which must be empty. Returns 1 on success, 0 if
+//     the peer closed the connection and -1 on errors.
+//
+int SocketStream::readFrame()
+{
+    uint32_t header[2];
+    if (!readRawFully(header, sizeof(header))) {
+        return 0;
+    }
+    if (header[0] == 0 || header[0] > LZ4_MAX_BLOCK_SIZE ||
+        header[1] == 0 || header[1] > header[0]) {
+        ERR("SocketStream::readFrame: bad frame (%u bytes, %u compressed)\n",
+            header[0], header[1]);
+        return -1;
+    }
+
+    if (!m_readBuf) {
+        m_readBuf = (unsigned char *)malloc(LZ4_MAX_BLOCK_SIZE);
+        if (!m_readBuf) {
+            ERR("SocketStream::readFrame failed to allocate read-ahead buffer\n");
+            return -1;
+        }
+    }
+
+    if (header[1] == header[0]) {
+        if (!readRawFully(m_readBuf, header[0])) {
+            return 0;
+        }
+    }
+    else {
+        if (!m_recvFrame) {
+            m_recvFrame = (unsigned char *)malloc(LZ4_MAX_BLOCK_SIZE);
+            if (!m_recvFrame) {
+                ERR("SocketStream::readFrame failed to allocate frame buffer\n");
+                return -1;
+            }
+        }
+        if (!readRawFully(m_recvFrame, header[1])) {
+            return 0;
+        }
+        if (lz4Decompress(m_recvFrame, header[1], m_readBuf, header[0]) !=
+            (int)header[0]) {
+            ERR("SocketStream::readFrame: corrupted frame\n");
+            return -1;
+        }
+    }
+
+    m_readPos = 0;
+    m_readValid = header[0];
+    return 1;
+}
+
+bool SocketStream::requestCompression()
+{
+    if (!valid()) return false;
+
+    uint32_t req[2] = { SOCKET_COMPRESS_MAGIC, SOCKET_COMPRESS_VERSION };
+    uint32_t reply = 0;
+    if (writeRaw(req, sizeof(req)) < 0 ||
+        !readRawFully(&reply, sizeof(reply)) || reply != 1) {
+        return false;
+    }
+
+    // the read-ahead buffer is sized for frames from now on
+    free(m_readBuf);
+    m_readBuf = NULL;
+    m_readPos = m_readValid = 0;
+    m_compress = true;
+    return true;
+}
+
+bool SocketStream::acceptCompression()
+{
+    if (!valid() || m_readValid > 0) return false;
+
+    //
+    // check if the client starts with a compression request
+    //
+    uint32_t req[2];
+    int n;
+    do {
+#ifdef _WIN32
+        n = ::recv(m_sock, (char *)req, sizeof(uint32_t), MSG_PEEK);
+#else
+        n = ::recv(m_sock, (char *)req, sizeof(uint32_t), MSG_PEEK | MSG_WAITALL);
+#endif
+    } while (n < 0 && errno == EINTR);
+
+    if (n != sizeof(uint32_t) || req[0] != SOCKET_COMPRESS_MAGIC) {
+        return false;
+    }
+    if (!readRawFully(req, sizeof(req))) {
+        return false;
+    }
+
+    uint32_t reply = (req[1] == SOCKET_COMPRESS_VERSION &&
+                      !getenv("ANDROID_NO_STREAM_COMPRESSION")) ? 1 : 0;
+    if (writeRaw(&reply, sizeof(reply)) < 0 || !reply) {
+        return false;
+    }
+
+    free(m_readBuf);
+    m_readBuf = NULL;
+    m_readPos = 0;
+    m_compress = true;
+    return true;
+}
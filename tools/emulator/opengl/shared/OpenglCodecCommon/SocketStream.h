@@ -0,0 +1,96 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef __SOCKET_STREAM_H
+#define __SOCKET_STREAM_H
+
+#include <stdlib.h>
+#include "IOStream.h"
+
+//
+// SocketStream - an IOStream over a connected stream socket. The
+//    transports, TcpStream and UnixStream, only differ in the way they
+//    listen, accept and connect.
+//
+//    Sockets are tuned for the renderer protocol: Nagle's algorithm is
+//    disabled, as most calls wait for a reply right after they are
+//    flushed, and the kernel buffers are enlarged for the bulk transfers
+//    of textures and vertex data.
+//
+class SocketStream : public IOStream {
+public:
+    typedef enum { ERR_INVALID_SOCKET = -1000 } SocketStreamError;
+
+    explicit SocketStream(size_t bufsize = 10000);
+    virtual ~SocketStream();
+
+    virtual SocketStream *accept() = 0;
+
+    virtual void *allocBuffer(size_t minSize);
+    virtual int commitBuffer(size_t size);
+    virtual const unsigned char *readFully( void *buf, size_t len);
+    virtual const unsigned char *read( void *buf, size_t *inout_len);
+    virtual int writeFully(const void *buf, size_t len);
+    virtual int commitBufferv(size_t size, const void *data, size_t len);
+    virtual void trimBuffers();
+    virtual void interrupt();
+
+    bool valid() { return m_sock >= 0; }
+    int getSocket() const { return m_sock; }
+    int recv(void *buf, size_t len);
+
+    //
+    // LZ4 compression of the stream, for connections to a renderer over a
+    // real network. It is negotiated on a fresh connection, before any
+    // other data: the data is then sent in frames of up to
+    // LZ4_MAX_BLOCK_SIZE bytes, compressed when that makes them smaller
+    // and they are at least SOCKET_COMPRESS_MIN_SIZE bytes.
+    //
+    // requestCompression - client side, returns true if the server agreed,
+    //     otherwise the stream goes on uncompressed.
+    // acceptCompression - server side, returns true if the client asked
+    //     for compression. No data is consumed otherwise.
+    //
+    bool requestCompression();
+    bool acceptCompression();
+    bool compressed() const { return m_compress; }
+
+protected:
+    SocketStream(int sock, size_t bufSize);
+
+    // setOptions - applies the socket tuning to a connected socket
+    void setOptions();
+
+    int m_sock;
+    size_t m_bufsize;
+
+private:
+    unsigned char *m_buf;
+    unsigned char *m_readBuf;   // read-ahead buffer, decompressed data
+    size_t m_readPos;
+    size_t m_readValid;
+    bool m_compress;
+    unsigned char *m_sendFrame; // frame being sent when compressing
+    unsigned char *m_recvFrame; // compressed frame being received
+    int readRaw(void *buf, size_t len);
+    bool readRawFully(void *buf, size_t len);
+    int writeRaw(const void *buf, size_t len, bool more = false);
+    int writeFrames(const void *buf, size_t len, bool more);
+    int writeFrame(const void *buf, size_t len, bool more);
+    int readFrame();
+    size_t readBuffered(void *buf, size_t len);
+};
+
+#endif
@@ -0,0 +1,78 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _STREAM_CHECKSUM_H
+#define _STREAM_CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "IOStream.h"
+
+//
+// Stream validation - when CHECK_GL_STREAM is defined, the emugen generated
+// encoders end each packet with a StreamChecksum footer holding a sequence
+// number and the CRC32C of the packet, and the decoders check it before
+// decoding the packet. A lost, duplicated or corrupted packet is then
+// reported at once instead of making the decoder run on garbage.
+//
+// The footer changes the wire format, the guest and the host must be built
+// with the same setting. It is off by default, define CHECK_GL_STREAM here
+// or in the build flags of both sides.
+//
+// #define CHECK_GL_STREAM 1
+
+#ifdef CHECK_GL_STREAM
+#define STREAM_CHECKSUM_SIZE 8
+#else
+#define STREAM_CHECKSUM_SIZE 0
+#endif
+
+// crc32c - update 'crc' with 'len' bytes of 'data' (Castagnoli polynomial)
+uint32_t crc32c(uint32_t crc, const void *data, size_t len);
+
+class StreamChecksum {
+public:
+    // takes the sequence number of the next packet sent on 'stream'
+    StreamChecksum(IOStream *stream) {
+        m_seq = stream->nextChecksumSeq();
+        m_crc = crc32c(0xffffffff, &m_seq, sizeof(m_seq));
+    }
+
+    void add(const void *data, size_t len) {
+        if (data != NULL) {
+            m_crc = crc32c(m_crc, data, len);
+        }
+    }
+
+    // write - store the footer at 'ptr', once the whole packet was added
+    void write(unsigned char *ptr) const {
+        *(uint32_t *)(ptr) = m_seq;
+        *(uint32_t *)(ptr + 4) = ~m_crc;
+    }
+
+    //
+    // check - verify the footer of a complete packet received on 'stream',
+    //     prints the reason to stderr and returns false if the packet is
+    //     out of sequence or corrupted.
+    //
+    static bool check(IOStream *stream, const unsigned char *packet,
+                      size_t packetLen);
+
+private:
+    uint32_t m_seq;
+    uint32_t m_crc;
+};
+
+#endif
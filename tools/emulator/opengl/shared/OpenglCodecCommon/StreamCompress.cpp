@@ -0,0 +1,209 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "StreamCompress.h"
+#include <stdint.h>
+#include <string.h>
+
+#define MIN_MATCH       4
+#define LAST_LITERALS   5   // the block always ends with that many literals
+#define MF_LIMIT        12  // no match starts closer than that to the end
+#define HASH_BITS       12
+
+static inline uint32_t read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t hash32(uint32_t v)
+{
+    return (v * 2654435761U) >> (32 - HASH_BITS);
+}
+
+// writeLength - the bytes extending a length of 15 or more in a token
+static inline uint8_t *writeLength(uint8_t *op, size_t len)
+{
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+size_t lz4Compress(const void *src, size_t len, void *dst, size_t dstLen)
+{
+    if (len > LZ4_MAX_BLOCK_SIZE) {
+        return 0;
+    }
+
+    const uint8_t *base = (const uint8_t *)src;
+    const uint8_t *ip = base;
+    const uint8_t *anchor = base;
+    const uint8_t *end = base + len;
+    uint8_t *op = (uint8_t *)dst;
+    uint8_t *oend = op + dstLen;
+
+    // positions of the last 4-byte sequences seen, by hash
+    uint16_t table[1 << HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    if (len > MF_LIMIT) {
+        const uint8_t *mfLimit = end - MF_LIMIT;
+        const uint8_t *matchLimit = end - LAST_LITERALS;
+
+        ip++;
+        while (ip < mfLimit) {
+            uint32_t seq = read32(ip);
+            uint32_t h = hash32(seq);
+            const uint8_t *ref = base + table[h];
+            table[h] = (uint16_t)(ip - base);
+            if (ref >= ip || read32(ref) != seq) {
+                ip++;
+                continue;
+            }
+
+            // extend the match both ways
+            while (ip > anchor && ref > base && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+            const uint8_t *mp = ip + MIN_MATCH;
+            const uint8_t *mr = ref + MIN_MATCH;
+            while (mp < matchLimit && *mp == *mr) {
+                mp++;
+                mr++;
+            }
+
+            size_t litLen = ip - anchor;
+            size_t matchLen = mp - ip - MIN_MATCH;
+            if ((size_t)(oend - op) < 1 + litLen + litLen / 255 + 1 +
+                                      2 + matchLen / 255 + 1) {
+                return 0;
+            }
+
+            uint8_t *token = op++;
+            *token = (uint8_t)((litLen >= 15 ? 15 : litLen) << 4);
+            if (litLen >= 15) {
+                op = writeLength(op, litLen - 15);
+            }
+            memcpy(op, anchor, litLen);
+            op += litLen;
+
+            size_t offset = ip - ref;
+            *op++ = (uint8_t)offset;
+            *op++ = (uint8_t)(offset >> 8);
+
+            *token |= (uint8_t)(matchLen >= 15 ? 15 : matchLen);
+            if (matchLen >= 15) {
+                op = writeLength(op, matchLen - 15);
+            }
+
+            ip = mp;
+            anchor = ip;
+        }
+    }
+
+    // the remaining bytes are literals
+    size_t litLen = end - anchor;
+    if ((size_t)(oend - op) < 1 + litLen + litLen / 255 + 1) {
+        return 0;
+    }
+    *op++ = (uint8_t)((litLen >= 15 ? 15 : litLen) << 4);
+    if (litLen >= 15) {
+        op = writeLength(op, litLen - 15);
+    }
+    memcpy(op, anchor, litLen);
+    op += litLen;
+
+    return op - (uint8_t *)dst;
+}
+
+// readLength - adds the bytes extending a length of 15 to '*len'
+static inline bool readLength(const uint8_t **ip, const uint8_t *iend,
+                              size_t *len)
+{
+    uint8_t b;
+    do {
+        if (*ip >= iend) {
+            return false;
+        }
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return true;
+}
+
+int lz4Decompress(const void *src, size_t len, void *dst, size_t dstLen)
+{
+    const uint8_t *ip = (const uint8_t *)src;
+    const uint8_t *iend = ip + len;
+    uint8_t *op = (uint8_t *)dst;
+    uint8_t *oend = op + dstLen;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+
+        size_t litLen = token >> 4;
+        if (litLen == 15 && !readLength(&ip, iend, &litLen)) {
+            return -1;
+        }
+        if (litLen > (size_t)(iend - ip) || litLen > (size_t)(oend - op)) {
+            return -1;
+        }
+        memcpy(op, ip, litLen);
+        op += litLen;
+        ip += litLen;
+
+        // the last sequence has no match
+        if (ip == iend) {
+            break;
+        }
+
+        if (iend - ip < 2) {
+            return -1;
+        }
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - (uint8_t *)dst)) {
+            return -1;
+        }
+
+        size_t matchLen = token & 15;
+        if (matchLen == 15 && !readLength(&ip, iend, &matchLen)) {
+            return -1;
+        }
+        matchLen += MIN_MATCH;
+        if (matchLen > (size_t)(oend - op)) {
+            return -1;
+        }
+
+        // a match may overlap the bytes it produces
+        const uint8_t *mp = op - offset;
+        if (offset >= matchLen) {
+            memcpy(op, mp, matchLen);
+            op += matchLen;
+        }
+        else {
+            while (matchLen-- > 0) {
+                *op++ = *mp++;
+            }
+        }
+    }
+
+    return op - (uint8_t *)dst;
+}
@@ -0,0 +1,47 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _STREAM_COMPRESS_H
+#define _STREAM_COMPRESS_H
+
+#include <stddef.h>
+
+//
+// LZ4 block compression of the GL stream, for the renderer connections
+// which go over a real network (see SocketStream::requestCompression). The
+// blocks follow the LZ4 block format, without the frame format around
+// them, and are limited to LZ4_MAX_BLOCK_SIZE bytes of input so that
+// offsets always fit.
+//
+#define LZ4_MAX_BLOCK_SIZE 65535
+
+// worst case size of the compressed form of 'n' bytes
+#define LZ4_COMPRESS_BOUND(n) ((n) + (n) / 255 + 16)
+
+//
+// lz4Compress - compresses the 'len' bytes of 'src' into 'dst', which
+//     holds 'dstLen' bytes. Returns the compressed size, 0 if it does not
+//     fit in 'dstLen' or 'len' is larger than LZ4_MAX_BLOCK_SIZE.
+//
+size_t lz4Compress(const void *src, size_t len, void *dst, size_t dstLen);
+
+//
+// lz4Decompress - decompresses the 'len' bytes block 'src' into 'dst',
+//     which holds 'dstLen' bytes. Returns the decompressed size, -1 if the
+//     block is malformed or does not fit.
+//
+int lz4Decompress(const void *src, size_t len, void *dst, size_t dstLen);
+
+#endif
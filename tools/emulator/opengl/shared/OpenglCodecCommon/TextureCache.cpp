@@ -0,0 +1,467 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "TextureCache.h"
+#include "ErrorLog.h"
+#include <cutils/threads.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define TEXTURE_CACHE_MAGIC     0x48435854  // 'TXCH'
+#define TEXTURE_CACHE_VERSION   1
+
+// images are stored in chains of fixed size blocks
+#define TEXTURE_CACHE_BLOCK_SIZE (16*1024)
+
+// largest cache which can be asked for, in MB
+#define TEXTURE_CACHE_MAX_MB    4096
+
+// how long a renderer waits for another one to initialize the cache
+#define TEXTURE_CACHE_INIT_WAIT_MS 1000
+
+#define TEXTURE_CACHE_NONE      (-1)
+
+#ifdef __linux__
+
+static mutex_t s_lock = MUTEX_INITIALIZER;
+static bool s_initialized = false;
+static TextureCache *s_cache = NULL;
+
+//
+// Shared memory layout:
+//     TextureCacheHeader
+//     TextureCacheEntry[numBlocks]
+//     int32_t links[numBlocks]  - next block of the chain
+//     int32_t buckets[numBuckets]
+//     block data
+//
+// There are as many entries as blocks since an image takes at least one
+// block. Free entries and free blocks are kept in lists threaded through
+// hashNext and links. Everything is protected by the robust process
+// shared mutex of the header: a renderer which dies with it held makes
+// the next one reset the cache.
+//
+struct TextureCacheEntry {
+    TextureCacheKey key;
+    int32_t firstBlock;
+    int32_t hashNext;   // next entry of the bucket or of the free list
+    int32_t lruPrev;
+    int32_t lruNext;
+};
+
+struct TextureCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    volatile int32_t ready;
+    uint32_t pad;
+    uint64_t mapSize;
+    pthread_mutex_t lock;
+    uint32_t numBlocks;
+    uint32_t numBuckets;
+    uint32_t entriesOffset;
+    uint32_t linksOffset;
+    uint32_t bucketsOffset;
+    uint32_t dataOffset;
+    int32_t freeEntries;
+    int32_t freeBlocks;
+    uint32_t numFreeBlocks;
+    int32_t lruHead;    // most recently used
+    int32_t lruTail;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+};
+
+#define CACHE_ENTRIES(hdr) ((TextureCacheEntry *)((char *)(hdr) + (hdr)->entriesOffset))
+#define CACHE_LINKS(hdr)   ((int32_t *)((char *)(hdr) + (hdr)->linksOffset))
+#define CACHE_BUCKETS(hdr) ((int32_t *)((char *)(hdr) + (hdr)->bucketsOffset))
+#define CACHE_BLOCK(hdr, b) ((unsigned char *)(hdr) + (hdr)->dataOffset + \
+                             (size_t)(b) * TEXTURE_CACHE_BLOCK_SIZE)
+
+TextureCache::TextureCache() :
+    m_header(NULL),
+    m_mapSize(0),
+    m_maxSize(0)
+{
+}
+
+TextureCache *TextureCache::get()
+{
+    mutex_lock(&s_lock);
+    if (!s_initialized) {
+        s_initialized = true;
+        const char *env = getenv("ANDROID_RENDER_TEXTURE_CACHE");
+        int sizeMB = env ? atoi(env) : 0;
+        if (sizeMB > 0) {
+            TextureCache *cache = new TextureCache();
+            if (cache->init(sizeMB < TEXTURE_CACHE_MAX_MB ? sizeMB : TEXTURE_CACHE_MAX_MB)) {
+                s_cache = cache;
+            } else {
+                ERR("TextureCache: could not map the shared texture cache\n");
+                delete cache;
+            }
+        }
+    }
+    mutex_unlock(&s_lock);
+    return s_cache;
+}
+
+bool TextureCache::init(size_t sizeMB)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "/oglrender-texcache-%d", (int)getuid());
+
+    uint32_t numBlocks = (uint32_t)(sizeMB * 1024 * 1024 / TEXTURE_CACHE_BLOCK_SIZE);
+    uint32_t numBuckets = 1;
+    while (numBuckets < numBlocks) {
+        numBuckets <<= 1;
+    }
+
+    size_t entriesOffset = (sizeof(TextureCacheHeader) + 63) & ~63;
+    size_t linksOffset = entriesOffset + numBlocks * sizeof(TextureCacheEntry);
+    size_t bucketsOffset = linksOffset + numBlocks * sizeof(int32_t);
+    size_t dataOffset = (bucketsOffset + numBuckets * sizeof(int32_t) + 4095) & ~4095;
+    size_t size = dataOffset + (size_t)numBlocks * TEXTURE_CACHE_BLOCK_SIZE;
+
+    bool creator = true;
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 && errno == EEXIST) {
+        creator = false;
+        fd = shm_open(name, O_RDWR, 0600);
+    }
+    if (fd < 0) {
+        return false;
+    }
+
+    if (creator) {
+        if (ftruncate(fd, size) < 0) {
+            close(fd);
+            shm_unlink(name);
+            return false;
+        }
+    } else {
+        //
+        // created by another renderer, maybe with another size. Wait for
+        // it to have set the size of the object.
+        //
+        struct stat st;
+        int waitMS = 0;
+        while (fstat(fd, &st) == 0 && (size_t)st.st_size < sizeof(TextureCacheHeader) &&
+               waitMS < TEXTURE_CACHE_INIT_WAIT_MS) {
+            usleep(10000);
+            waitMS += 10;
+        }
+        if ((size_t)st.st_size < sizeof(TextureCacheHeader)) {
+            close(fd);
+            return false;
+        }
+        size = st.st_size;
+    }
+
+    void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        if (creator) {
+            shm_unlink(name);
+        }
+        return false;
+    }
+    m_header = (TextureCacheHeader *)ptr;
+    m_mapSize = size;
+
+    TextureCacheHeader *hdr = m_header;
+    if (creator) {
+        hdr->magic = TEXTURE_CACHE_MAGIC;
+        hdr->version = TEXTURE_CACHE_VERSION;
+        hdr->mapSize = size;
+        hdr->numBlocks = numBlocks;
+        hdr->numBuckets = numBuckets;
+        hdr->entriesOffset = entriesOffset;
+        hdr->linksOffset = linksOffset;
+        hdr->bucketsOffset = bucketsOffset;
+        hdr->dataOffset = dataOffset;
+
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&hdr->lock, &attr);
+        pthread_mutexattr_destroy(&attr);
+
+        reset();
+        __sync_synchronize();
+        hdr->ready = 1;
+    } else {
+        int waitMS = 0;
+        while (!hdr->ready && waitMS < TEXTURE_CACHE_INIT_WAIT_MS) {
+            usleep(10000);
+            waitMS += 10;
+        }
+        __sync_synchronize();
+        if (!hdr->ready || hdr->magic != TEXTURE_CACHE_MAGIC ||
+            hdr->version != TEXTURE_CACHE_VERSION || hdr->mapSize != size ||
+            hdr->dataOffset + (uint64_t)hdr->numBlocks * TEXTURE_CACHE_BLOCK_SIZE > size) {
+            munmap(ptr, size);
+            m_header = NULL;
+            return false;
+        }
+    }
+
+    // an image may take up to half of the cache
+    m_maxSize = (size_t)hdr->numBlocks / 2 * TEXTURE_CACHE_BLOCK_SIZE;
+    return true;
+}
+
+bool TextureCache::lock()
+{
+    int err = pthread_mutex_lock(&m_header->lock);
+    if (err == EOWNERDEAD) {
+        // a renderer died in the middle of an update, start over
+        reset();
+        pthread_mutex_consistent(&m_header->lock);
+        return true;
+    }
+    return err == 0;
+}
+
+void TextureCache::unlock()
+{
+    pthread_mutex_unlock(&m_header->lock);
+}
+
+void TextureCache::reset()
+{
+    TextureCacheHeader *hdr = m_header;
+    TextureCacheEntry *entries = CACHE_ENTRIES(hdr);
+    int32_t *links = CACHE_LINKS(hdr);
+    int32_t *buckets = CACHE_BUCKETS(hdr);
+
+    for (uint32_t i = 0; i < hdr->numBlocks; i++) {
+        entries[i].firstBlock = TEXTURE_CACHE_NONE;
+        entries[i].hashNext = i + 1 < hdr->numBlocks ? (int32_t)(i + 1) : TEXTURE_CACHE_NONE;
+        links[i] = i + 1 < hdr->numBlocks ? (int32_t)(i + 1) : TEXTURE_CACHE_NONE;
+    }
+    for (uint32_t i = 0; i < hdr->numBuckets; i++) {
+        buckets[i] = TEXTURE_CACHE_NONE;
+    }
+    hdr->freeEntries = hdr->numBlocks ? 0 : TEXTURE_CACHE_NONE;
+    hdr->freeBlocks = hdr->numBlocks ? 0 : TEXTURE_CACHE_NONE;
+    hdr->numFreeBlocks = hdr->numBlocks;
+    hdr->lruHead = TEXTURE_CACHE_NONE;
+    hdr->lruTail = TEXTURE_CACHE_NONE;
+}
+
+int32_t TextureCache::find(const TextureCacheKey &key)
+{
+    TextureCacheEntry *entries = CACHE_ENTRIES(m_header);
+    int32_t e = CACHE_BUCKETS(m_header)[key.hash[0] & (m_header->numBuckets - 1)];
+    while (e != TEXTURE_CACHE_NONE) {
+        if (!memcmp(&entries[e].key, &key, sizeof(key))) {
+            return e;
+        }
+        e = entries[e].hashNext;
+    }
+    return TEXTURE_CACHE_NONE;
+}
+
+// touch - moves 'e' to the head of the LRU list, it may be unlinked
+void TextureCache::touch(int32_t e)
+{
+    TextureCacheHeader *hdr = m_header;
+    TextureCacheEntry *entries = CACHE_ENTRIES(hdr);
+    TextureCacheEntry *entry = &entries[e];
+
+    if (hdr->lruHead == e) {
+        return;
+    }
+    if (entry->lruPrev != TEXTURE_CACHE_NONE) {
+        entries[entry->lruPrev].lruNext = entry->lruNext;
+        if (entry->lruNext != TEXTURE_CACHE_NONE) {
+            entries[entry->lruNext].lruPrev = entry->lruPrev;
+        } else {
+            hdr->lruTail = entry->lruPrev;
+        }
+    }
+
+    entry->lruPrev = TEXTURE_CACHE_NONE;
+    entry->lruNext = hdr->lruHead;
+    if (hdr->lruHead != TEXTURE_CACHE_NONE) {
+        entries[hdr->lruHead].lruPrev = e;
+    } else {
+        hdr->lruTail = e;
+    }
+    hdr->lruHead = e;
+}
+
+void TextureCache::evict(int32_t e)
+{
+    TextureCacheHeader *hdr = m_header;
+    TextureCacheEntry *entries = CACHE_ENTRIES(hdr);
+    int32_t *links = CACHE_LINKS(hdr);
+    TextureCacheEntry *entry = &entries[e];
+
+    // out of its bucket
+    int32_t *pe = &CACHE_BUCKETS(hdr)[entry->key.hash[0] & (hdr->numBuckets - 1)];
+    while (*pe != e) {
+        pe = &entries[*pe].hashNext;
+    }
+    *pe = entry->hashNext;
+
+    // out of the LRU list
+    if (entry->lruPrev != TEXTURE_CACHE_NONE) {
+        entries[entry->lruPrev].lruNext = entry->lruNext;
+    } else {
+        hdr->lruHead = entry->lruNext;
+    }
+    if (entry->lruNext != TEXTURE_CACHE_NONE) {
+        entries[entry->lruNext].lruPrev = entry->lruPrev;
+    } else {
+        hdr->lruTail = entry->lruPrev;
+    }
+
+    // its blocks and itself back to the free lists
+    int32_t last = entry->firstBlock;
+    uint32_t n = 1;
+    while (links[last] != TEXTURE_CACHE_NONE) {
+        last = links[last];
+        n++;
+    }
+    links[last] = hdr->freeBlocks;
+    hdr->freeBlocks = entry->firstBlock;
+    hdr->numFreeBlocks += n;
+
+    entry->firstBlock = TEXTURE_CACHE_NONE;
+    entry->hashNext = hdr->freeEntries;
+    hdr->freeEntries = e;
+    hdr->evictions++;
+}
+
+bool TextureCache::lookup(const TextureCacheKey &key, void *data)
+{
+    if (key.len == 0 || key.len > m_maxSize || !lock()) {
+        return false;
+    }
+
+    int32_t e = find(key);
+    if (e == TEXTURE_CACHE_NONE) {
+        m_header->misses++;
+        unlock();
+        return false;
+    }
+    touch(e);
+
+    const int32_t *links = CACHE_LINKS(m_header);
+    unsigned char *dst = (unsigned char *)data;
+    size_t left = key.len;
+    for (int32_t b = CACHE_ENTRIES(m_header)[e].firstBlock; left > 0; b = links[b]) {
+        size_t n = left < TEXTURE_CACHE_BLOCK_SIZE ? left : TEXTURE_CACHE_BLOCK_SIZE;
+        memcpy(dst, CACHE_BLOCK(m_header, b), n);
+        dst += n;
+        left -= n;
+    }
+    m_header->hits++;
+    unlock();
+    return true;
+}
+
+void TextureCache::insert(const TextureCacheKey &key, const void *data)
+{
+    if (key.len < TEXTURE_CACHE_MIN_SIZE || key.len > m_maxSize || !lock()) {
+        return;
+    }
+
+    TextureCacheHeader *hdr = m_header;
+    if (find(key) != TEXTURE_CACHE_NONE) {
+        // another instance got there first
+        unlock();
+        return;
+    }
+
+    uint32_t numBlocks = (key.len + TEXTURE_CACHE_BLOCK_SIZE - 1) / TEXTURE_CACHE_BLOCK_SIZE;
+    while ((hdr->numFreeBlocks < numBlocks || hdr->freeEntries == TEXTURE_CACHE_NONE) &&
+           hdr->lruTail != TEXTURE_CACHE_NONE) {
+        evict(hdr->lruTail);
+    }
+
+    TextureCacheEntry *entries = CACHE_ENTRIES(hdr);
+    int32_t *links = CACHE_LINKS(hdr);
+
+    int32_t e = hdr->freeEntries;
+    TextureCacheEntry *entry = &entries[e];
+    hdr->freeEntries = entry->hashNext;
+    entry->key = key;
+
+    // take the blocks off the head of the free list, in order
+    const unsigned char *src = (const unsigned char *)data;
+    size_t left = key.len;
+    int32_t b = hdr->freeBlocks;
+    entry->firstBlock = b;
+    for (uint32_t i = 0; i < numBlocks; i++) {
+        size_t n = left < TEXTURE_CACHE_BLOCK_SIZE ? left : TEXTURE_CACHE_BLOCK_SIZE;
+        memcpy(CACHE_BLOCK(hdr, b), src, n);
+        src += n;
+        left -= n;
+        if (i + 1 < numBlocks) {
+            b = links[b];
+        }
+    }
+    hdr->freeBlocks = links[b];
+    links[b] = TEXTURE_CACHE_NONE;
+    hdr->numFreeBlocks -= numBlocks;
+
+    int32_t *bucket = &CACHE_BUCKETS(hdr)[key.hash[0] & (hdr->numBuckets - 1)];
+    entry->hashNext = *bucket;
+    *bucket = e;
+
+    entry->lruPrev = TEXTURE_CACHE_NONE;
+    entry->lruNext = TEXTURE_CACHE_NONE;
+    touch(e);
+    unlock();
+}
+
+#else // !__linux__
+
+TextureCache::TextureCache() :
+    m_header(NULL),
+    m_mapSize(0),
+    m_maxSize(0)
+{
+}
+
+TextureCache *TextureCache::get()
+{
+    return NULL;
+}
+
+bool TextureCache::lookup(const TextureCacheKey &key, void *data)
+{
+    return false;
+}
+
+void TextureCache::insert(const TextureCacheKey &key, const void *data)
+{
+}
+
+#endif
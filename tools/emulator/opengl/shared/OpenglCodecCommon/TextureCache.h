@@ -0,0 +1,106 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _TEXTURE_CACHE_H
+#define _TEXTURE_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "TextureHash.h"
+
+struct TextureCacheHeader;
+
+//
+// key of a cached image, its content hash and what the guest said it is
+//
+struct TextureCacheKey {
+    uint32_t hash[TEXTURE_HASH_WORDS];
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;
+    uint32_t type;
+    uint32_t len;
+
+    void set(const uint32_t *p_hash, uint32_t p_width, uint32_t p_height,
+             uint32_t p_format, uint32_t p_type, uint32_t p_len)
+    {
+        memcpy(hash, p_hash, sizeof(hash));
+        width = p_width;
+        height = p_height;
+        format = p_format;
+        type = p_type;
+        len = p_len;
+    }
+};
+
+//
+// TextureCache - a size-bounded LRU of texture images, kept in shared
+//    memory so that all the renderer processes of the user on the host
+//    share it. Many emulator instances upload the same images at boot
+//    (launcher, system UI and framework assets), the encoders first send
+//    the hash of the large glTexImage2D images (glTexImage2DCached) and
+//    only send the pixels if the host does not have them.
+//
+//    Entries are only added from pixels received by the host, which
+//    computes their hash itself, so an instance cannot insert an image
+//    under the hash of another one. The images of an instance can be
+//    served to any other instance of the same user.
+//
+//    The cache is enabled by setting ANDROID_RENDER_TEXTURE_CACHE to its
+//    size in MB: the first renderer process creates it with that size, the
+//    others map it as is. It outlives the renderers, until the host
+//    reboots or /dev/shm/oglrender-texcache-<uid> is removed.
+//    Only supported on Linux, get() returns NULL elsewhere.
+//
+class TextureCache {
+public:
+    // get - the cache of the process, NULL if it is not enabled
+    static TextureCache *get();
+
+    // maxSize - the largest image the cache stores
+    size_t maxSize() const { return m_maxSize; }
+
+    //
+    // lookup - copies the image of 'key' to 'data', which has room for
+    //     key.len bytes, and makes it the most recently used.
+    //     returns false if the cache does not have it.
+    //
+    bool lookup(const TextureCacheKey &key, void *data);
+
+    //
+    // insert - adds the key.len bytes of 'data', evicting the least
+    //     recently used images as needed. The hash of 'key' must have
+    //     been computed from 'data' by the caller.
+    //
+    void insert(const TextureCacheKey &key, const void *data);
+
+private:
+    TextureCache();
+    bool init(size_t sizeMB);
+    bool lock();
+    void unlock();
+    void reset();
+    int32_t find(const TextureCacheKey &key);
+    void touch(int32_t e);
+    void evict(int32_t e);
+
+private:
+    TextureCacheHeader *m_header;
+    size_t m_mapSize;
+    size_t m_maxSize;
+};
+
+#endif
@@ -0,0 +1,38 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _TEXTURE_HASH_H
+#define _TEXTURE_HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//
+// textureHash - content hash of texture images, computed by the encoders
+//     and checked by the host texture cache (see TextureCache.h), so both
+//     sides must use this function. It is the SHA-256 of the image: the
+//     hash is the only key of a cache shared by the instances of the host
+//     and a cached image is uploaded without being compared to anything,
+//     so an instance must not be able to make up pixels with the hash of
+//     an image another instance will upload.
+//
+#define TEXTURE_HASH_WORDS 8
+
+// images smaller than this are not worth a lookup round trip
+#define TEXTURE_CACHE_MIN_SIZE (16*1024)
+
+void textureHash(const void *data, size_t len, uint32_t hash[TEXTURE_HASH_WORDS]);
+
+#endif
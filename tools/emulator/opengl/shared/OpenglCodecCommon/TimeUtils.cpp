@@ -24,6 +24,10 @@
 #include <sys/time.h>
 #include <time.h>
 #include <unistd.h>
+#elif defined(__APPLE__)
+#include <sys/time.h>
+#include <unistd.h>
+#include <mach/mach_time.h>
 #else
 #include <sys/time.h>
 #include <unistd.h>
@@ -59,6 +63,72 @@ long long GetCurrentTimeMS()
 #endif
 }
 
+long long GetCurrentTimeUS()
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    static bool bNotInit = true;
+    if ( bNotInit ) {
+        bNotInit = (QueryPerformanceFrequency( &freq ) == FALSE);
+    }
+    LARGE_INTEGER currVal;
+    QueryPerformanceCounter( &currVal );
+
+    return (currVal.QuadPart / freq.QuadPart) * 1000000LL +
+           ((currVal.QuadPart % freq.QuadPart) * 1000000LL) / freq.QuadPart;
+
+#elif defined(__linux__)
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec * 1000000LL) + now.tv_nsec/1000LL;
+
+#else /* Others, e.g. OS X */
+
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (now.tv_sec * 1000000LL) + now.tv_usec;
+
+#endif
+}
+
+long long GetCurrentTimeNS()
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    static bool bNotInit = true;
+    if ( bNotInit ) {
+        bNotInit = (QueryPerformanceFrequency( &freq ) == FALSE);
+    }
+    LARGE_INTEGER currVal;
+    QueryPerformanceCounter( &currVal );
+
+    return (currVal.QuadPart / freq.QuadPart) * 1000000000LL +
+           ((currVal.QuadPart % freq.QuadPart) * 1000000000LL) / freq.QuadPart;
+
+#elif defined(__linux__)
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec * 1000000000LL) + now.tv_nsec;
+
+#elif defined(__APPLE__)
+
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+
+#else /* Others */
+
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (now.tv_sec * 1000000000LL) + now.tv_usec * 1000LL;
+
+#endif
+}
+
 void TimeSleepMS(int p_mili)
 {
 #ifdef _WIN32
@@ -0,0 +1,104 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "UnixStream.h"
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+UnixStream::UnixStream(size_t bufSize) :
+    SocketStream(bufSize)
+{
+}
+
+UnixStream::UnixStream(int sock, size_t bufSize) :
+    SocketStream(sock, bufSize)
+{
+}
+
+void UnixStream::makePath(unsigned short port, char *path, size_t pathLen)
+{
+    snprintf(path, pathLen, "/tmp/oglrender-%d-%d.sock", (int)getuid(), port);
+}
+
+static void makeAddr(unsigned short port, struct sockaddr_un *addr)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    UnixStream::makePath(port, addr->sun_path, sizeof(addr->sun_path));
+}
+
+int UnixStream::listen(unsigned short port)
+{
+    struct sockaddr_un addr;
+    makeAddr(port, &addr);
+
+    m_sock = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (!valid()) return int(ERR_INVALID_SOCKET);
+
+    // a renderer which did not exit cleanly leaves its socket behind
+    ::unlink(addr.sun_path);
+    if (::bind(m_sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        ::listen(m_sock, 4) < 0) {
+        ::close(m_sock);
+        m_sock = -1;
+        return int(ERR_INVALID_SOCKET);
+    }
+
+    return 0;
+}
+
+UnixStream *UnixStream::accept()
+{
+    int clientSock;
+    do {
+        clientSock = ::accept(m_sock, NULL, NULL);
+    } while (clientSock < 0 && errno == EINTR);
+
+    if (clientSock < 0) {
+        return NULL;
+    }
+    return new UnixStream(clientSock, m_bufsize);
+}
+
+int UnixStream::connect(unsigned short port)
+{
+    struct sockaddr_un addr;
+    makeAddr(port, &addr);
+
+    m_sock = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (!valid()) return -1;
+
+    int ret;
+    do {
+        ret = ::connect(m_sock, (struct sockaddr *)&addr, sizeof(addr));
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret < 0) {
+        ::close(m_sock);
+        m_sock = -1;
+        return -1;
+    }
+    setOptions();
+    return 0;
+}
+
+#endif
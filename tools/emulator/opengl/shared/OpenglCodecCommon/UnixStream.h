@@ -0,0 +1,45 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef __UNIX_STREAM_H
+#define __UNIX_STREAM_H
+
+#include "SocketStream.h"
+
+#ifndef _WIN32
+
+//
+// UnixStream - a SocketStream over a Unix domain socket, for a renderer
+//    running on the same host. It spares the TCP/IP stack the loopback
+//    traffic. A port number names the socket like it names a TcpStream
+//    server, see makePath().
+//
+class UnixStream : public SocketStream {
+public:
+    explicit UnixStream(size_t bufsize = 10000);
+    int listen(unsigned short port);
+    virtual UnixStream *accept();
+    int connect(unsigned short port);
+
+    // makePath - the socket file used for 'port'
+    static void makePath(unsigned short port, char *path, size_t pathLen);
+
+private:
+    UnixStream(int sock, size_t bufSize);
+};
+
+#endif
+
+#endif
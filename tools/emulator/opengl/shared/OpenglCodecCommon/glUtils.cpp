@@ -17,6 +17,14 @@
 #include <string.h>
 #include "ErrorLog.h"
 
+#if defined(__SSE2__)
+#define GLUTILS_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__)
+#define GLUTILS_NEON
+#include <arm_neon.h>
+#endif
+
 size_t glSizeof(GLenum type)
 {
     size_t retval = 0;
@@ -290,6 +298,60 @@ size_t glUtilsParamSize(GLenum param)
     return s;
 }
 
+//
+// copyElement - copies one vertex element of N bytes. N is a constant so
+// that each copy is a few loads and stores instead of a memcpy call, the
+// elements of strided arrays are neither aligned nor a multiple of a
+// vector apart, hence the unaligned accesses.
+//
+template <int N>
+static inline void copyElement(unsigned char *dst, const unsigned char *src)
+{
+    memcpy(dst, src, N);
+}
+
+template <>
+inline void copyElement<8>(unsigned char *dst, const unsigned char *src)
+{
+#if defined(GLUTILS_SSE2)
+    _mm_storel_epi64((__m128i *)dst, _mm_loadl_epi64((const __m128i *)src));
+#elif defined(GLUTILS_NEON)
+    vst1_u8(dst, vld1_u8(src));
+#else
+    memcpy(dst, src, 8);
+#endif
+}
+
+template <>
+inline void copyElement<12>(unsigned char *dst, const unsigned char *src)
+{
+    copyElement<8>(dst, src);
+    copyElement<4>(dst + 8, src + 8);
+}
+
+template <>
+inline void copyElement<16>(unsigned char *dst, const unsigned char *src)
+{
+#if defined(GLUTILS_SSE2)
+    _mm_storeu_si128((__m128i *)dst, _mm_loadu_si128((const __m128i *)src));
+#elif defined(GLUTILS_NEON)
+    vst1q_u8(dst, vld1q_u8(src));
+#else
+    memcpy(dst, src, 16);
+#endif
+}
+
+template <int N>
+static void packElements(unsigned char *dst, const unsigned char *src,
+                         unsigned int stride, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i++) {
+        copyElement<N>(dst, src);
+        dst += N;
+        src += stride;
+    }
+}
+
 void glUtilsPackPointerData(unsigned char *dst, unsigned char *src,
                      int size, GLenum type, unsigned int stride,
                      unsigned int datalen)
@@ -299,12 +361,32 @@ void glUtilsPackPointerData(unsigned char *dst, unsigned char *src,
 
     if (stride == vsize) {
         memcpy(dst, src, datalen);
-    } else {
+        return;
+    }
+
+    // the common sizes: float or fixed 1 to 4 components, ubyte and short
+    // colors and texture coordinates
+    unsigned int count = (datalen + vsize - 1) / vsize;
+    switch (vsize) {
+    case 4:
+        packElements<4>(dst, src, stride, count);
+        break;
+    case 8:
+        packElements<8>(dst, src, stride, count);
+        break;
+    case 12:
+        packElements<12>(dst, src, stride, count);
+        break;
+    case 16:
+        packElements<16>(dst, src, stride, count);
+        break;
+    default:
         for (unsigned int i = 0; i < datalen; i += vsize) {
             memcpy(dst, src, vsize);
             dst += vsize;
             src += stride;
         }
+        break;
     }
 }
 
@@ -313,6 +395,12 @@ int glUtilsPixelBitSize(GLenum format, GLenum type)
     int components = 0;
     int componentsize = 0;
     int pixelsize = 0;
+
+    if (format == GLUTILS_FORMAT_YCRCB_420_SP || format == GLUTILS_FORMAT_YV12) {
+        // full resolution luma and 2x2 subsampled chroma
+        return 12;
+    }
+
     switch(type) {
     case GL_UNSIGNED_BYTE:
         componentsize = 8;
@@ -398,3 +486,261 @@ int glUtilsCalcShaderSourceLen( char **strings,  GLint *length, GLsizei count)
     return len;
 
 }
+
+//
+// murmur3 like mixing of 8 bytes at a time. This is only used to spot
+// unchanged vertex data, not for anything which needs a strong hash.
+//
+static inline uint64_t hashRotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t hashMix(uint64_t h, uint64_t k)
+{
+    k *= 0x87c37b91114253d5ULL;
+    k = hashRotl(k, 31);
+    k *= 0x4cf5ad432745937fULL;
+    h ^= k;
+    return hashRotl(h, 27) * 5 + 0x52dce729;
+}
+
+uint64_t glUtilsHashData(uint64_t seed, const void *data, size_t len)
+{
+    const unsigned char *ptr = (const unsigned char *)data;
+    uint64_t h = seed ^ len;
+    for (; len >= 8; len -= 8, ptr += 8) {
+        uint64_t k;
+        memcpy(&k, ptr, 8);
+        h = hashMix(h, k);
+    }
+    if (len > 0) {
+        uint64_t k = 0;
+        memcpy(&k, ptr, len);
+        h = hashMix(h, k);
+    }
+    return h;
+}
+
+namespace GLUtils {
+
+//
+// minmax/shiftIndices for the index types. The vector loops process 16
+// bytes at a time, the remaining indices are done one by one. Unsigned
+// 16 and 32 bits min/max are not in SSE2, the values are biased by the
+// sign bit and compared as signed instead.
+//
+template <class T> static void reduceLanes(const T *mins, const T *maxs, int n,
+                                           T *lo, T *hi)
+{
+    for (int i = 0; i < n; i++) {
+        if (mins[i] < *lo) *lo = mins[i];
+        if (maxs[i] > *hi) *hi = maxs[i];
+    }
+}
+
+template <class T> static void minmaxTail(const T *indices, int i, int count,
+                                          T lo, T hi, int *min, int *max)
+{
+    for (; i < count; i++) {
+        if (indices[i] < lo) lo = indices[i];
+        if (indices[i] > hi) hi = indices[i];
+    }
+    *min = lo;
+    *max = hi;
+}
+
+template <> void minmax<unsigned char>(unsigned char *indices, int count, int *min, int *max)
+{
+    if (count <= 0) {
+        *min = -1;
+        *max = -1;
+        return;
+    }
+
+    unsigned char lo = indices[0], hi = indices[0];
+    int i = 0;
+#if defined(GLUTILS_SSE2)
+    if (count >= 16) {
+        __m128i vmin = _mm_loadu_si128((const __m128i *)indices);
+        __m128i vmax = vmin;
+        for (i = 16; i + 16 <= count; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(indices + i));
+            vmin = _mm_min_epu8(vmin, v);
+            vmax = _mm_max_epu8(vmax, v);
+        }
+        unsigned char mins[16], maxs[16];
+        _mm_storeu_si128((__m128i *)mins, vmin);
+        _mm_storeu_si128((__m128i *)maxs, vmax);
+        reduceLanes(mins, maxs, 16, &lo, &hi);
+    }
+#elif defined(GLUTILS_NEON)
+    if (count >= 16) {
+        uint8x16_t vmin = vld1q_u8(indices);
+        uint8x16_t vmax = vmin;
+        for (i = 16; i + 16 <= count; i += 16) {
+            uint8x16_t v = vld1q_u8(indices + i);
+            vmin = vminq_u8(vmin, v);
+            vmax = vmaxq_u8(vmax, v);
+        }
+        unsigned char mins[16], maxs[16];
+        vst1q_u8(mins, vmin);
+        vst1q_u8(maxs, vmax);
+        reduceLanes(mins, maxs, 16, &lo, &hi);
+    }
+#endif
+    minmaxTail(indices, i, count, lo, hi, min, max);
+}
+
+template <> void minmax<unsigned short>(unsigned short *indices, int count, int *min, int *max)
+{
+    if (count <= 0) {
+        *min = -1;
+        *max = -1;
+        return;
+    }
+
+    unsigned short lo = indices[0], hi = indices[0];
+    int i = 0;
+#if defined(GLUTILS_SSE2)
+    if (count >= 8) {
+        const __m128i bias = _mm_set1_epi16((short)0x8000);
+        __m128i vmin = _mm_xor_si128(_mm_loadu_si128((const __m128i *)indices), bias);
+        __m128i vmax = vmin;
+        for (i = 8; i + 8 <= count; i += 8) {
+            __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(indices + i)), bias);
+            vmin = _mm_min_epi16(vmin, v);
+            vmax = _mm_max_epi16(vmax, v);
+        }
+        unsigned short mins[8], maxs[8];
+        _mm_storeu_si128((__m128i *)mins, _mm_xor_si128(vmin, bias));
+        _mm_storeu_si128((__m128i *)maxs, _mm_xor_si128(vmax, bias));
+        reduceLanes(mins, maxs, 8, &lo, &hi);
+    }
+#elif defined(GLUTILS_NEON)
+    if (count >= 8) {
+        uint16x8_t vmin = vld1q_u16(indices);
+        uint16x8_t vmax = vmin;
+        for (i = 8; i + 8 <= count; i += 8) {
+            uint16x8_t v = vld1q_u16(indices + i);
+            vmin = vminq_u16(vmin, v);
+            vmax = vmaxq_u16(vmax, v);
+        }
+        unsigned short mins[8], maxs[8];
+        vst1q_u16(mins, vmin);
+        vst1q_u16(maxs, vmax);
+        reduceLanes(mins, maxs, 8, &lo, &hi);
+    }
+#endif
+    minmaxTail(indices, i, count, lo, hi, min, max);
+}
+
+template <> void minmax<unsigned int>(unsigned int *indices, int count, int *min, int *max)
+{
+    if (count <= 0) {
+        *min = -1;
+        *max = -1;
+        return;
+    }
+
+    unsigned int lo = indices[0], hi = indices[0];
+    int i = 0;
+#if defined(GLUTILS_SSE2)
+    if (count >= 4) {
+        const __m128i bias = _mm_set1_epi32((int)0x80000000);
+        __m128i vmin = _mm_xor_si128(_mm_loadu_si128((const __m128i *)indices), bias);
+        __m128i vmax = vmin;
+        for (i = 4; i + 4 <= count; i += 4) {
+            __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(indices + i)), bias);
+            __m128i lt = _mm_cmpgt_epi32(vmin, v);
+            __m128i gt = _mm_cmpgt_epi32(v, vmax);
+            vmin = _mm_or_si128(_mm_and_si128(lt, v), _mm_andnot_si128(lt, vmin));
+            vmax = _mm_or_si128(_mm_and_si128(gt, v), _mm_andnot_si128(gt, vmax));
+        }
+        unsigned int mins[4], maxs[4];
+        _mm_storeu_si128((__m128i *)mins, _mm_xor_si128(vmin, bias));
+        _mm_storeu_si128((__m128i *)maxs, _mm_xor_si128(vmax, bias));
+        reduceLanes(mins, maxs, 4, &lo, &hi);
+    }
+#elif defined(GLUTILS_NEON)
+    if (count >= 4) {
+        uint32x4_t vmin = vld1q_u32(indices);
+        uint32x4_t vmax = vmin;
+        for (i = 4; i + 4 <= count; i += 4) {
+            uint32x4_t v = vld1q_u32(indices + i);
+            vmin = vminq_u32(vmin, v);
+            vmax = vmaxq_u32(vmax, v);
+        }
+        unsigned int mins[4], maxs[4];
+        vst1q_u32(mins, vmin);
+        vst1q_u32(maxs, vmax);
+        reduceLanes(mins, maxs, 4, &lo, &hi);
+    }
+#endif
+    minmaxTail(indices, i, count, lo, hi, min, max);
+}
+
+//
+// the additions wrap around in the index type, like the generic version
+//
+template <> void shiftIndices<unsigned char>(unsigned char *src, unsigned char *dst, int count, int offset)
+{
+    int i = 0;
+#if defined(GLUTILS_SSE2)
+    const __m128i voff = _mm_set1_epi8((char)offset);
+    for (; i + 16 <= count; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_add_epi8(v, voff));
+    }
+#elif defined(GLUTILS_NEON)
+    const uint8x16_t voff = vdupq_n_u8((uint8_t)offset);
+    for (; i + 16 <= count; i += 16) {
+        vst1q_u8(dst + i, vaddq_u8(vld1q_u8(src + i), voff));
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] = src[i] + offset;
+    }
+}
+
+template <> void shiftIndices<unsigned short>(unsigned short *src, unsigned short *dst, int count, int offset)
+{
+    int i = 0;
+#if defined(GLUTILS_SSE2)
+    const __m128i voff = _mm_set1_epi16((short)offset);
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_add_epi16(v, voff));
+    }
+#elif defined(GLUTILS_NEON)
+    const uint16x8_t voff = vdupq_n_u16((uint16_t)offset);
+    for (; i + 8 <= count; i += 8) {
+        vst1q_u16(dst + i, vaddq_u16(vld1q_u16(src + i), voff));
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] = src[i] + offset;
+    }
+}
+
+template <> void shiftIndices<unsigned int>(unsigned int *src, unsigned int *dst, int count, int offset)
+{
+    int i = 0;
+#if defined(GLUTILS_SSE2)
+    const __m128i voff = _mm_set1_epi32(offset);
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_add_epi32(v, voff));
+    }
+#elif defined(GLUTILS_NEON)
+    const uint32x4_t voff = vdupq_n_u32((uint32_t)offset);
+    for (; i + 4 <= count; i += 4) {
+        vst1q_u32(dst + i, vaddq_u32(vld1q_u32(src + i), voff));
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] = src[i] + offset;
+    }
+}
+
+} // namespace GLUtils
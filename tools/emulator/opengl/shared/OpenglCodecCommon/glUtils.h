@@ -18,6 +18,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 #ifdef GL_API
     #undef GL_API
@@ -42,6 +43,15 @@
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
 
+//
+// formats of the YUV 4:2:0 color buffers of guest camera and video
+// buffers. They are not GL enums, only rcCreateColorBuffer and
+// rcUpdateColorBuffer understand them, the host converts the planes to
+// RGBA. glUtilsPixelBitSize gives 12 bits per pixel for both.
+//
+#define GLUTILS_FORMAT_YCRCB_420_SP 0x7fa00001  // NV21, Y then V/U interleaved
+#define GLUTILS_FORMAT_YV12         0x7fa00002  // Y, then V, then U planes
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -54,6 +64,8 @@ extern "C" {
     int glUtilsPixelBitSize(GLenum format, GLenum type);
     void   glUtilsPackStrings(char *ptr, char **strings, GLint *length, GLsizei count);
     int glUtilsCalcShaderSourceLen(char **strings, GLint *length, GLsizei count);
+    // glUtilsHashData - folds 'len' bytes of 'data' into the 64 bit hash 'seed'
+    uint64_t glUtilsHashData(uint64_t seed, const void *data, size_t len);
 #ifdef __cplusplus
 };
 #endif
@@ -88,5 +100,16 @@ namespace GLUtils {
             src++;
         }
     }
+
+    //
+    // vectorized versions for the index types (SSE2 or NEON when the
+    // compiler targets them), see glUtils.cpp
+    //
+    template <> void minmax<unsigned char>(unsigned char *indices, int count, int *min, int *max);
+    template <> void minmax<unsigned short>(unsigned short *indices, int count, int *min, int *max);
+    template <> void minmax<unsigned int>(unsigned int *indices, int count, int *min, int *max);
+    template <> void shiftIndices<unsigned char>(unsigned char *src, unsigned char *dst, int count, int offset);
+    template <> void shiftIndices<unsigned short>(unsigned short *src, unsigned short *dst, int count, int offset);
+    template <> void shiftIndices<unsigned int>(unsigned int *src, unsigned int *dst, int count, int offset);
 }; // namespace GLUtils
 #endif
@@ -25,7 +25,13 @@ namespace osUtils {
 class childProcess
 {
 public:
-    static childProcess *create(const char *p_cmdLine, const char *p_startdir);
+    //
+    // create - starts p_cmdLine in p_startdir. The child does not inherit
+    //     the open file descriptors except p_inheritFd, if it is not -1,
+    //     which is ignored on Windows.
+    //
+    static childProcess *create(const char *p_cmdLine, const char *p_startdir,
+                                int p_inheritFd = -1);
     ~childProcess();
 
     int getPID()
@@ -91,7 +91,8 @@ static char **buildArgList(const char *command)
     return argv;
 }
 
-static pid_t start_process(const char *command,const char *startDir)
+static pid_t start_process(const char *command,const char *startDir,
+                           int inheritFd)
 {
     pid_t pid;
 
@@ -102,10 +103,12 @@ static pid_t start_process(const char *command,const char *startDir)
     }
     else if (pid == 0) {
         //
-        // Close all opened file descriptors
+        // Close all opened file descriptors, but the inherited one
         //
         for (int i=3; i<256; i++) {
-            close(i);
+            if (i != inheritFd) {
+                close(i);
+            }
         }
 
         if (startDir) {
@@ -126,14 +129,15 @@ static pid_t start_process(const char *command,const char *startDir)
 }
 
 childProcess *
-childProcess::create(const char *p_cmdLine, const char *p_startdir)
+childProcess::create(const char *p_cmdLine, const char *p_startdir,
+                     int p_inheritFd)
 {
     childProcess *child = new childProcess();
     if (!child) {
         return NULL;
     }
 
-    child->m_pid = start_process(p_cmdLine, p_startdir);
+    child->m_pid = start_process(p_cmdLine, p_startdir, p_inheritFd);
     if (child->m_pid < 0) {
         delete child;
         return NULL;
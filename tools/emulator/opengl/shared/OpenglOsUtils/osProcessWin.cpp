@@ -22,7 +22,8 @@
 namespace osUtils {
 
 childProcess *
-childProcess::create(const char *p_cmdLine, const char *p_startdir)
+childProcess::create(const char *p_cmdLine, const char *p_startdir,
+                     int p_inheritFd)
 {
     childProcess *child = new childProcess();
     if (!child) {
@@ -36,7 +36,31 @@ public:
     bool  wait(int *exitStatus);
     bool trywait(int *exitStatus);
 
+    enum Priority {
+        PRIORITY_LOW,
+        PRIORITY_NORMAL,
+        PRIORITY_HIGH
+    };
+
+    //
+    // Scheduling settings of the thread. They must be set before start()
+    // and are applied by the thread itself before Main() is called, as
+    // far as the platform and the process privileges allow.
+    //
+    // setName - names the thread for debuggers and tools like top,
+    //     names are truncated to 15 characters (ignored on Windows)
+    // setPriority - raises or lowers the thread priority
+    // setAffinity - restricts the thread to the CPUs whose bit is set in
+    //     'cpuMask', 0 lets it run anywhere (ignored on Mac)
+    //
+    void setName(const char *name);
+    void setPriority(Priority priority) { m_priority = priority; }
+    void setAffinity(unsigned long long cpuMask) { m_cpuMask = cpuMask; }
+
 private:
+    // applySettings - applies the scheduling settings to the calling thread
+    void applySettings();
+
 #ifdef _WIN32
     static DWORD WINAPI thread_main(void *p_arg);
 #else // !WIN32
@@ -53,6 +77,9 @@ private:
     pthread_mutex_t m_lock;
 #endif
     bool m_isRunning;
+    char m_name[16];
+    Priority m_priority;
+    unsigned long long m_cpuMask;
 };
 
 } // of namespace osUtils
@@ -14,14 +14,25 @@
 * limitations under the License.
 */
 #include "osThread.h"
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#endif
 
 namespace osUtils {
 
 Thread::Thread() :
     m_thread((pthread_t)NULL),
     m_exitStatus(0),
-    m_isRunning(false)
+    m_isRunning(false),
+    m_priority(PRIORITY_NORMAL),
+    m_cpuMask(0)
 {
+    m_name[0] = '\0';
     pthread_mutex_init(&m_lock, NULL);
 }
 
@@ -37,15 +48,19 @@ Thread::start()
     int ret = pthread_create(&m_thread, NULL, Thread::thread_main, this);
     if(ret) {
         m_isRunning = false;
+        m_thread = (pthread_t)NULL;
     }
+    // the thread may already be done once the lock is released
+    bool started = (ret == 0);
     pthread_mutex_unlock(&m_lock);
-    return m_isRunning;
+    return started;
 }
 
 bool
 Thread::wait(int *exitStatus)
 {
-    if (!m_isRunning) {
+    // a thread which has already exited still needs to be joined
+    if (!m_thread) {
         return false;
     }
 
@@ -53,6 +68,7 @@ Thread::wait(int *exitStatus)
     if (pthread_join(m_thread,&retval)) {
         return false;
     }
+    m_thread = (pthread_t)NULL;
 
     long long int ret=(long long int)retval;
     if (exitStatus) {
@@ -75,15 +91,64 @@ Thread::trywait(int *exitStatus)
     return ret;
 }
 
+void
+Thread::setName(const char *name)
+{
+    strncpy(m_name, name, sizeof(m_name) - 1);
+    m_name[sizeof(m_name) - 1] = '\0';
+}
+
+void
+Thread::applySettings()
+{
+#ifdef __linux__
+    if (m_name[0]) {
+        prctl(PR_SET_NAME, (unsigned long)m_name, 0, 0, 0);
+    }
+
+    if (m_cpuMask) {
+        // the raw syscall is used since the C libraries do not all wrap it
+        unsigned long mask[sizeof(m_cpuMask) / sizeof(unsigned long)];
+        for (unsigned int i = 0; i < sizeof(mask) / sizeof(mask[0]); i++) {
+            mask[i] = (unsigned long)(m_cpuMask >> (i * 8 * sizeof(unsigned long)));
+        }
+        syscall(__NR_sched_setaffinity, 0, sizeof(mask), mask);
+    }
+
+    // the nice value of a linux thread is its own, raising it may need
+    // privileges the process does not have
+    if (m_priority != PRIORITY_NORMAL) {
+        int nice = (m_priority == PRIORITY_HIGH) ? -10 : 10;
+        setpriority(PRIO_PROCESS, syscall(__NR_gettid), nice);
+    }
+#elif defined(__APPLE__)
+    if (m_name[0]) {
+        pthread_setname_np(m_name);
+    }
+
+    if (m_priority != PRIORITY_NORMAL) {
+        int policy;
+        struct sched_param param;
+        if (pthread_getschedparam(pthread_self(), &policy, &param) == 0) {
+            param.sched_priority = (m_priority == PRIORITY_HIGH) ?
+                                   sched_get_priority_max(policy) :
+                                   sched_get_priority_min(policy);
+            pthread_setschedparam(pthread_self(), policy, &param);
+        }
+    }
+#endif
+}
+
 void *
 Thread::thread_main(void *p_arg)
 {
     Thread *self = (Thread *)p_arg;
-    void *ret = (void *)self->Main();
+    self->applySettings();
+    void *ret = (void *)(intptr_t)self->Main();
 
     pthread_mutex_lock(&self->m_lock);
     self->m_isRunning = false;
-    self->m_exitStatus = (int)ret;
+    self->m_exitStatus = (int)(intptr_t)ret;
     pthread_mutex_unlock(&self->m_lock);
 
     return ret;
@@ -14,14 +14,18 @@
 * limitations under the License.
 */
 #include "osThread.h"
+#include <string.h>
 
 namespace osUtils {
 
 Thread::Thread() :
     m_thread(NULL),
     m_threadId(0),
-    m_isRunning(false)
+    m_isRunning(false),
+    m_priority(PRIORITY_NORMAL),
+    m_cpuMask(0)
 {
+    m_name[0] = '\0';
 }
 
 Thread::~Thread()
@@ -39,13 +43,15 @@ Thread::start()
     if(!m_thread) {
         m_isRunning = false;
     }
-    return m_isRunning;
+    // the thread may already be done and have cleared m_isRunning
+    return m_thread != NULL;
 }
 
 bool
 Thread::wait(int *exitStatus)
 {
-    if (!m_isRunning) {
+    // m_isRunning is cleared by the thread itself when it exits
+    if (!m_thread) {
         return false;
     }
 
@@ -69,7 +75,8 @@ Thread::wait(int *exitStatus)
 bool
 Thread::trywait(int *exitStatus)
 {
-    if (!m_isRunning) {
+    // m_isRunning is cleared by the thread itself when it exits
+    if (!m_thread) {
         return false;
     }
 
@@ -89,10 +96,34 @@ Thread::trywait(int *exitStatus)
     return false;
 }
 
+void
+Thread::setName(const char *name)
+{
+    // only debuggers see thread names on windows, it is kept for them
+    strncpy(m_name, name, sizeof(m_name) - 1);
+    m_name[sizeof(m_name) - 1] = '\0';
+}
+
+void
+Thread::applySettings()
+{
+    if (m_cpuMask) {
+        SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)m_cpuMask);
+    }
+
+    if (m_priority != PRIORITY_NORMAL) {
+        SetThreadPriority(GetCurrentThread(),
+                          m_priority == PRIORITY_HIGH ?
+                                THREAD_PRIORITY_ABOVE_NORMAL :
+                                THREAD_PRIORITY_BELOW_NORMAL);
+    }
+}
+
 DWORD WINAPI
 Thread::thread_main(void *p_arg)
 {
     Thread *self = (Thread *)p_arg;
+    self->applySettings();
     int ret = self->Main();
     self->m_isRunning = false;
     return ret;
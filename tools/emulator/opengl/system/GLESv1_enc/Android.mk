@@ -35,7 +35,7 @@ GEN_GL := \
 
 $(GEN_GL) : PRIVATE_PATH := $(LOCAL_PATH)
 $(GEN_GL) : PRIVATE_CUSTOM_TOOL := \
-        $(EMUGEN) -E $(glesv1_intermediates) -i $(PRIVATE_PATH) gl
+        $(EMUGEN) -S -E $(glesv1_intermediates) -i $(PRIVATE_PATH) gl
 $(GEN_GL) : $(EMUGEN) \
         $(LOCAL_PATH)/gl.attrib \
         $(LOCAL_PATH)/gl.in \
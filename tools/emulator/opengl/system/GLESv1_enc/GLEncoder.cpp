@@ -16,15 +16,24 @@
 #include "GLEncoder.h"
 #include "glUtils.h"
 #include "FixedBuffer.h"
+#include "TextureHash.h"
 
 #include <cutils/log.h>
+#include <cutils/properties.h>
 #include <assert.h>
+#include <stdlib.h>
 
 static GLubyte *gVendorString= (GLubyte *) "Android";
 static GLubyte *gRendererString= (GLubyte *) "Android HW-GLES 1.0";
 static GLubyte *gVersionString= (GLubyte *) "OpenGL ES-CM 1.0";
 static GLubyte *gExtensionsString= (GLubyte *) ""; // no extensions at this point;
 
+// the names of the objects named by the guest
+static GLNameAllocator sBufferNames;
+static GLNameAllocator sTextureNames;
+static GLNameAllocator sFramebufferNames;
+static GLNameAllocator sRenderbufferNames;
+
 
 GLint * GLEncoder::getCompressedTextureFormats()
 {
@@ -40,6 +49,62 @@ GLint * GLEncoder::getCompressedTextureFormats()
     return m_compressedTextureFormats;
 }
 
+//
+// host implementation limits, they cannot change during a connection
+//
+// fixed point conversions, done as the host does them
+#define X2F(x) (((GLfloat)(x)) / 65536.0f)
+
+static GLfixed F2X(GLfloat f)
+{
+    if (f > 32767.65535f) return 32767 * 65536 + 65535;
+    if (f < -32768.65535f) return -32768 * 65536 + 65535;
+    return (GLfixed)(f * 65536);
+}
+
+static void fixedToFloat(GLfloat *f, const GLfixed *x, int n)
+{
+    for (int i = 0; i < n; i++) {
+        f[i] = X2F(x[i]);
+    }
+}
+
+static const GLConstantCache::Constant sConstants[] = {
+    { GL_MAX_TEXTURE_SIZE, 1 },
+    { GL_MAX_TEXTURE_UNITS, 1 },
+    { GL_MAX_LIGHTS, 1 },
+    { GL_MAX_CLIP_PLANES, 1 },
+    { GL_MAX_MODELVIEW_STACK_DEPTH, 1 },
+    { GL_MAX_PROJECTION_STACK_DEPTH, 1 },
+    { GL_MAX_TEXTURE_STACK_DEPTH, 1 },
+    { GL_MAX_VIEWPORT_DIMS, 2 },
+    { GL_SUBPIXEL_BITS, 1 },
+    { GL_NUM_COMPRESSED_TEXTURE_FORMATS, 1 },
+    { GL_MAX_PALETTE_MATRICES_OES, 1 },
+    { GL_MAX_VERTEX_UNITS_OES, 1 },
+    { GL_MAX_RENDERBUFFER_SIZE_OES, 1 },
+    { GL_MAX_CUBE_MAP_TEXTURE_SIZE_OES, 1 },
+};
+
+//
+// getConstant - gets the values of an implementation constant, from the
+//     host the first time only. Returns their number, 0 if 'param' is
+//     not such a constant.
+//
+int GLEncoder::getConstant(GLenum param, GLint *values)
+{
+    if (!m_constants.isConstant(param)) return 0;
+
+    int n = m_constants.get(param, values);
+    if (n == 0) {
+        GLint hostValues[GL_CONSTANT_MAX_VALUES];
+        m_glGetIntegerv_enc(this, param, hostValues);
+        m_constants.set(param, hostValues);
+        n = m_constants.get(param, values);
+    }
+    return n;
+}
+
 void GLEncoder::s_glGetIntegerv(void *self, GLenum param, GLint *ptr)
 {
     GLEncoder *ctx = (GLEncoder *)self;
@@ -50,7 +115,9 @@ void GLEncoder::s_glGetIntegerv(void *self, GLenum param, GLint *ptr)
             memcpy(ptr, compressedTextureFormats, ctx->m_num_compressedTextureFormats * sizeof(GLint));
         }
     }
-    else if (!ctx->m_state->getClientStateParameter<GLint>(param,ptr)) {
+    else if (!ctx->m_state->getClientStateParameter<GLint>(param,ptr) &&
+             !ctx->matrixState()->getInteger(param, ptr) &&
+             !ctx->getConstant(param, ptr)) {
         ctx->m_glGetIntegerv_enc(self, param, ptr);
     }
 }
@@ -67,8 +134,16 @@ void GLEncoder::s_glGetFloatv(void *self, GLenum param, GLfloat *ptr)
             }
         }
     }
-    else if (!ctx->m_state->getClientStateParameter<GLfloat>(param,ptr)) {
-        ctx->m_glGetFloatv_enc(self, param, ptr);
+    else if (!ctx->m_state->getClientStateParameter<GLfloat>(param,ptr) &&
+             !ctx->getMatrixParameter(param, ptr)) {
+        GLint values[GL_CONSTANT_MAX_VALUES];
+        int n = ctx->getConstant(param, values);
+        if (n == 0) {
+            ctx->m_glGetFloatv_enc(self, param, ptr);
+        }
+        for (int i = 0; i < n; i++) {
+            ptr[i] = (GLfloat) values[i];
+        }
     }
 }
 
@@ -85,10 +160,42 @@ void GLEncoder::s_glGetFixedv(void *self, GLenum param, GLfixed *ptr)
         }
     }
     else if (!ctx->m_state->getClientStateParameter<GLfixed>(param,ptr)) {
-        ctx->m_glGetFixedv_enc(self, param, ptr);
+        GLfloat m[16];
+        if (ctx->matrixState()->getMatrix(param, m)) {
+            for (int i = 0; i < 16; i++) {
+                ptr[i] = F2X(m[i]);
+            }
+            return;
+        }
+        GLint values[GL_CONSTANT_MAX_VALUES];
+        int n = ctx->getConstant(param, values);
+        if (n == 0) {
+            ctx->m_glGetFixedv_enc(self, param, ptr);
+        }
+        for (int i = 0; i < n; i++) {
+            ptr[i] = values[i] << 16;
+        }
     }
 }
 
+//
+// getMatrixParameter - answers the matrix queries from the shadow of the
+//     matrix stacks, returns false if it does not know the answer.
+//
+bool GLEncoder::getMatrixParameter(GLenum param, GLfloat *values)
+{
+    GLMatrixState *ms = matrixState();
+    if (ms->getMatrix(param, values)) {
+        return true;
+    }
+    GLint value;
+    if (ms->getInteger(param, &value)) {
+        values[0] = (GLfloat)value;
+        return true;
+    }
+    return false;
+}
+
 void GLEncoder::s_glGetBooleanv(void *self, GLenum param, GLboolean *ptr)
 {
     GLEncoder *ctx = (GLEncoder *)self;
@@ -97,7 +204,14 @@ void GLEncoder::s_glGetBooleanv(void *self, GLenum param, GLboolean *ptr)
         // ignore the command, although we should have generated a GLerror;
     }
     else if (!ctx->m_state->getClientStateParameter<GLboolean>(param,ptr)) {
-        ctx->m_glGetBooleanv_enc(self, param, ptr);
+        GLint values[GL_CONSTANT_MAX_VALUES];
+        int n = ctx->getConstant(param, values);
+        if (n == 0) {
+            ctx->m_glGetBooleanv_enc(self, param, ptr);
+        }
+        for (int i = 0; i < n; i++) {
+            ptr[i] = values[i] != 0 ? GL_TRUE : GL_FALSE;
+        }
     }
 }
 
@@ -111,8 +225,15 @@ void GLEncoder::s_glGetPointerv(void * self, GLenum param, GLvoid **params)
 void GLEncoder::s_glFlush(void *self)
 {
     GLEncoder *ctx = (GLEncoder *)self;
+    // glFlush is a sync point, it is always sent unless nothing was sent
+    // since the previous one
+    if (ctx->m_flushed && ctx->m_stream->idleSince(ctx->m_flushedSeq)) {
+        return;
+    }
     ctx->m_glFlush_enc(self);
     ctx->m_stream->flush();
+    ctx->m_flushed = true;
+    ctx->m_flushedSeq = ctx->m_stream->sentSeq();
 }
 
 GLubyte *GLEncoder::s_glGetString(void *self, GLenum name)
@@ -135,6 +256,89 @@ GLubyte *GLEncoder::s_glGetString(void *self, GLenum name)
     return retval;
 }
 
+void GLEncoder::setError(GLenum error)
+{
+    // like GL, keep the first error until it is queried
+    if (m_error == GL_NO_ERROR) {
+        m_error = error;
+    }
+}
+
+//
+// in the deferred error mode the errors of the host are only fetched at
+// the points where the guest waits for the host anyway, and reported by
+// the following glGetError
+//
+void GLEncoder::collectHostError()
+{
+    if (!m_deferErrors) return;
+
+    GLenum error = m_glGetError_enc(this);
+    if (error != GL_NO_ERROR) {
+        setError(error);
+    }
+}
+
+GLenum GLEncoder::s_glGetError(void *self)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    GLenum error = ctx->m_error;
+    if (error != GL_NO_ERROR) {
+        ctx->m_error = GL_NO_ERROR;
+        return error;
+    }
+    if (ctx->m_deferErrors) {
+        return GL_NO_ERROR;
+    }
+    return ctx->m_glGetError_enc(self);
+}
+
+GLint GLEncoder::s_glFinish(void *self)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    GLint retval = ctx->m_glFinish_enc(self);
+    ctx->collectHostError();
+    return retval;
+}
+
+void GLEncoder::s_glReadPixels(void *self, GLint x, GLint y, GLsizei width, GLsizei height,
+                              GLenum format, GLenum type, GLvoid *pixels)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    ctx->m_glReadPixels_enc(self, x, y, width, height, format, type, pixels);
+    ctx->collectHostError();
+}
+
+void GLEncoder::s_glTexImage2D(void *self, GLenum target, GLint level, GLint internalformat,
+                               GLsizei width, GLsizei height, GLint border,
+                               GLenum format, GLenum type, GLvoid *pixels)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+
+    if (ctx->m_textureCache && pixels != NULL) {
+        size_t len = ctx->pixelDataSize(width, height, format, type, 1);
+        if (len >= TEXTURE_CACHE_MIN_SIZE) {
+            GLuint hash[TEXTURE_HASH_WORDS];
+            textureHash(pixels, len, hash);
+            GLint res = ctx->glTexImage2DCached(self, target, level, internalformat,
+                                                width, height, border, format, type, len, hash);
+            if (res > 0) {
+                return;
+            }
+            if (res == 0) {
+                // the host adds the image to its cache
+                ctx->glTexImage2DCachedData(self, target, level, internalformat,
+                                            width, height, border, format, type, pixels, len);
+                return;
+            }
+            // the host has no texture cache, stop asking
+            ctx->m_textureCache = false;
+        }
+    }
+    ctx->m_glTexImage2D_enc(self, target, level, internalformat, width, height, border,
+                            format, type, pixels);
+}
+
 void GLEncoder::s_glPixelStorei(void *self, GLenum param, GLint value)
 {
     GLEncoder *ctx = (GLEncoder *)self;
@@ -237,21 +441,217 @@ void GLEncoder::s_glBindBuffer(void *self, GLenum target, GLuint id)
     assert(ctx->m_state != NULL);
     ctx->m_state->bindBuffer(target, id);
     // TODO set error state if needed;
+    if (ctx->m_guestNames) {
+        sBufferNames.markUsed(id);
+    }
     ctx->m_glBindBuffer_enc(self, target, id);
 }
 
+void GLEncoder::s_glBufferData(void *self, GLenum target, GLsizeiptr size, GLvoid *data, GLenum usage)
+{
+    GLEncoder *ctx = (GLEncoder *) self;
+    assert(ctx->m_state != NULL);
+    ctx->m_state->bufferData(target, size, data);
+    ctx->m_glBufferData_enc(self, target, size, data, usage);
+}
+
+void GLEncoder::s_glBufferSubData(void *self, GLenum target, GLintptr offset, GLsizeiptr size, GLvoid *data)
+{
+    GLEncoder *ctx = (GLEncoder *) self;
+    assert(ctx->m_state != NULL);
+    ctx->m_state->bufferSubData(target, offset, size, data);
+    ctx->m_glBufferSubData_enc(self, target, offset, size, data);
+}
+
+void GLEncoder::s_glDeleteBuffers(void *self, GLsizei n, GLuint *buffers)
+{
+    GLEncoder *ctx = (GLEncoder *) self;
+    assert(ctx->m_state != NULL);
+    if (n > 0) {
+        ctx->m_state->deleteBuffers(n, buffers);
+        if (ctx->m_guestNames) {
+            sBufferNames.release(n, buffers);
+        }
+    }
+    ctx->m_glDeleteBuffers_enc(self, n, buffers);
+}
+
+//
+// guest named objects, the glGen*Guest calls only tell the host about the
+// names, which it creates the objects of as glGen* would have. When the
+// names cannot be allocated (n < 0 reports the error) the host generates
+// them, they are taken from then on as the names bound without being
+// generated are.
+//
+void GLEncoder::s_glGenBuffers(void *self, GLsizei n, GLuint *buffers)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    if (n >= 0 && sBufferNames.alloc(n, buffers)) {
+        if (n > 0) ctx->glGenBuffersGuest(self, n, buffers);
+        return;
+    }
+    ctx->m_glGenBuffers_enc(self, n, buffers);
+    for (GLsizei i = 0; i < n; i++) {
+        sBufferNames.markUsed(buffers[i]);
+    }
+}
+
+void GLEncoder::s_glGenTextures(void *self, GLsizei n, GLuint *textures)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    if (n >= 0 && sTextureNames.alloc(n, textures)) {
+        if (n > 0) ctx->glGenTexturesGuest(self, n, textures);
+        return;
+    }
+    ctx->m_glGenTextures_enc(self, n, textures);
+    for (GLsizei i = 0; i < n; i++) {
+        sTextureNames.markUsed(textures[i]);
+    }
+}
+
+void GLEncoder::s_glDeleteTextures(void *self, GLsizei n, GLuint *textures)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    ctx->m_glDeleteTextures_enc(self, n, textures);
+    if (n > 0) sTextureNames.release(n, textures);
+}
+
+void GLEncoder::s_glBindTexture(void *self, GLenum target, GLuint texture)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    sTextureNames.markUsed(texture);
+    ctx->m_glBindTexture_enc(self, target, texture);
+}
+
+void GLEncoder::s_glGenFramebuffersOES(void *self, GLsizei n, GLuint *framebuffers)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    if (n >= 0 && sFramebufferNames.alloc(n, framebuffers)) {
+        if (n > 0) ctx->glGenFramebuffersOESGuest(self, n, framebuffers);
+        return;
+    }
+    ctx->m_glGenFramebuffersOES_enc(self, n, framebuffers);
+    for (GLsizei i = 0; i < n; i++) {
+        sFramebufferNames.markUsed(framebuffers[i]);
+    }
+}
+
+void GLEncoder::s_glGenRenderbuffersOES(void *self, GLsizei n, GLuint *renderbuffers)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    if (n >= 0 && sRenderbufferNames.alloc(n, renderbuffers)) {
+        if (n > 0) ctx->glGenRenderbuffersOESGuest(self, n, renderbuffers);
+        return;
+    }
+    ctx->m_glGenRenderbuffersOES_enc(self, n, renderbuffers);
+    for (GLsizei i = 0; i < n; i++) {
+        sRenderbufferNames.markUsed(renderbuffers[i]);
+    }
+}
+
+void GLEncoder::s_glDeleteFramebuffersOES(void *self, GLsizei n, GLuint *framebuffers)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    ctx->m_glDeleteFramebuffersOES_enc(self, n, framebuffers);
+    if (n > 0) sFramebufferNames.release(n, framebuffers);
+}
+
+void GLEncoder::s_glDeleteRenderbuffersOES(void *self, GLsizei n, GLuint *renderbuffers)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    ctx->m_glDeleteRenderbuffersOES_enc(self, n, renderbuffers);
+    if (n > 0) sRenderbufferNames.release(n, renderbuffers);
+}
+
+void GLEncoder::s_glBindFramebufferOES(void *self, GLenum target, GLuint framebuffer)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    sFramebufferNames.markUsed(framebuffer);
+    ctx->m_glBindFramebufferOES_enc(self, target, framebuffer);
+}
+
+void GLEncoder::s_glBindRenderbufferOES(void *self, GLenum target, GLuint renderbuffer)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    sRenderbufferNames.markUsed(renderbuffer);
+    ctx->m_glBindRenderbufferOES_enc(self, target, renderbuffer);
+}
+
+//
+// findInterleavedArrays - looks for enabled client arrays which share a
+//     stride and whose elements all lie within the same 'stride' bytes,
+//     such as a { position, normal, texcoord } vertex structure. Returns
+//     the mask of the locations of the largest such group, 0 if none has
+//     two arrays or more, and sets 'base' to the lowest pointer of the
+//     group, 'stride' to its stride and 'span' to the number of bytes of
+//     a vertex it covers. Groups whose arrays use less than half of the
+//     stride are left alone, sending them separately is cheaper.
+//
+uint32_t GLEncoder::findInterleavedArrays(const unsigned char **base, unsigned int *stride,
+                                          unsigned int *span)
+{
+    uint32_t bestMask = 0;
+    int bestCount = 0;
+    const uint64_t enabled = m_state->enabledMask();
+
+    for (uint64_t candidates = enabled; candidates; ) {
+        int i = GLClientState::nextLocation(&candidates);
+        const GLClientState::VertexAttribState *a = m_state->getState(i);
+        if (a->bufferObject != 0 ||
+            a->stride == 0 || (unsigned int)a->stride < a->elementSize) continue;
+
+        // the group of arrays starting at this one
+        const unsigned char *lo = (const unsigned char *)a->data;
+        const unsigned char *end = lo;
+        uint32_t mask = 0;
+        int n = 0;
+        unsigned int used = 0;
+        for (uint64_t others = enabled; others; ) {
+            int j = GLClientState::nextLocation(&others);
+            const GLClientState::VertexAttribState *b = m_state->getState(j);
+            if (b->bufferObject != 0 || b->stride != a->stride) continue;
+            const unsigned char *p = (const unsigned char *)b->data;
+            if (p < lo || p + b->elementSize > lo + a->stride) continue;
+            if (p + b->elementSize > end) end = p + b->elementSize;
+            mask |= 1 << j;
+            n++;
+            used += b->elementSize;
+        }
+        if (n > bestCount && 2 * used >= (unsigned int)a->stride) {
+            bestMask = mask;
+            bestCount = n;
+            *base = lo;
+            *stride = a->stride;
+            *span = end - lo;
+        }
+    }
+
+    return bestCount >= 2 ? bestMask : 0;
+}
+
 void GLEncoder::sendVertexData(unsigned int first, unsigned int count)
 {
     assert(m_state != NULL);
-    for (int i = 0; i < GLClientState::LAST_LOCATION; i++) {
-        bool enableDirty;
-        const GLClientState::VertexAttribState *state = m_state->getStateAndEnableDirty(i, &enableDirty);
 
-        // do not process if state not valid
-        if (!state) continue;
+    // send the vertices of interleaved client arrays once, the arrays
+    // then only need their offset in it
+    const unsigned char *interleavedBase = NULL;
+    unsigned int interleavedStride = 0, interleavedSpan = 0;
+    uint32_t interleaved = 0;
+    if (count > 0) {
+        interleaved = findInterleavedArrays(&interleavedBase, &interleavedStride, &interleavedSpan);
+    }
+    if (interleaved) {
+        this->glInterleavedArrayData(this, (void *)(interleavedBase + interleavedStride * first),
+                                     interleavedStride * (count - 1) + interleavedSpan);
+    }
 
-        // do not send disable state if state was already disabled
-        if (!enableDirty && !state->enabled) continue;
+    // only the enabled locations and those which were just disabled matter
+    const uint64_t dirty = m_state->takeEnableDirtyMask();
+    for (uint64_t locations = m_state->enabledMask() | dirty; locations; ) {
+        int i = GLClientState::nextLocation(&locations);
+        bool enableDirty = (dirty >> i) & 1;
+        const GLClientState::VertexAttribState *state = m_state->getState(i);
 
         if ( i >= GLClientState::TEXCOORD0_LOCATION &&
             i <= GLClientState::TEXCOORD7_LOCATION ) {
@@ -268,7 +668,14 @@ void GLEncoder::sendVertexData(unsigned int first, unsigned int count)
             if (stride == 0) stride = state->elementSize;
             int firstIndex = stride * first;
 
-            if (state->bufferObject == 0) {
+            if (state->bufferObject == 0 && (interleaved & (1 << i))) {
+                m_state->invalidateArrayData(i);
+                this->glInterleavedArrayPointer(this, i, state->size, state->type, state->stride,
+                                                (const unsigned char *)state->data - interleavedBase);
+            } else if (state->bufferObject == 0) {
+
+                // the host still points at identical data
+                if (m_dedupVertexData && m_state->clientArrayDataSent(i, first, count)) continue;
 
                 switch(i) {
                 case GLClientState::VERTEX_LOCATION:
@@ -308,6 +715,7 @@ void GLEncoder::sendVertexData(unsigned int first, unsigned int count)
                     break;
                 }
             } else {
+                m_state->invalidateArrayData(i);
                 this->glBindBuffer(this, GL_ARRAY_BUFFER, state->bufferObject);
 
                 switch(i) {
@@ -358,6 +766,15 @@ void GLEncoder::s_glDrawArrays(void *self, GLenum mode, GLint first, GLsizei cou
 {
     GLEncoder *ctx = (GLEncoder *)self;
 
+    if (first < 0 || count < 0) {
+        ctx->setError(GL_INVALID_VALUE);
+        return;
+    }
+    if (mode > GL_TRIANGLE_FAN) {
+        ctx->setError(GL_INVALID_ENUM);
+        return;
+    }
+
     ctx->sendVertexData(first, count);
     ctx->m_glDrawArrays_enc(ctx, mode, /*first*/ 0, count);
 }
@@ -368,17 +785,25 @@ void GLEncoder::s_glDrawElements(void *self, GLenum mode, GLsizei count, GLenum
     GLEncoder *ctx = (GLEncoder *)self;
     assert(ctx->m_state != NULL);
 
+    if (count < 0) {
+        ctx->setError(GL_INVALID_VALUE);
+        return;
+    }
+    if (mode > GL_TRIANGLE_FAN) {
+        ctx->setError(GL_INVALID_ENUM);
+        return;
+    }
+
     bool has_immediate_arrays = false;
     bool has_indirect_arrays = false;
 
-    for (int i = 0; i < GLClientState::LAST_LOCATION; i++) {
-        const GLClientState::VertexAttribState *state = ctx->m_state->getState(i);
-        if (state->enabled) {
-            if (state->bufferObject != 0) {
-                has_indirect_arrays = true;
-            } else {
-                has_immediate_arrays = true;
-            }
+    for (uint64_t enabled = ctx->m_state->enabledMask(); enabled; ) {
+        const GLClientState::VertexAttribState *state =
+            ctx->m_state->getState(GLClientState::nextLocation(&enabled));
+        if (state->bufferObject != 0) {
+            has_indirect_arrays = true;
+        } else {
+            has_immediate_arrays = true;
         }
     }
 
@@ -387,21 +812,54 @@ void GLEncoder::s_glDrawElements(void *self, GLenum mode, GLsizei count, GLenum
         return;
     }
 
+    int minIndex = 0, maxIndex = 0;
+    bool haveRange = false;
     if (ctx->m_state->currentIndexVbo() != 0) {
         if (!has_immediate_arrays) {
             ctx->sendVertexData(0, count);
             ctx->glDrawElementsOffset(ctx, mode, count, type, (GLuint)indices);
-        } else {
-            LOGE("glDrawElements: indirect index arrays, with immidate-mode data array is not supported\n");
+            return;
+        }
+
+        //
+        // the immediate arrays are sent for the range of the indices, the
+        // indices are then read from the guest copy of the index buffer
+        // and sent with the command as if they were client side
+        //
+        GLuint offset = (GLuint)indices;
+        indices = (void *)ctx->m_state->getIndexBufferRange(type, indices, count,
+                                                            &minIndex, &maxIndex);
+        if (!indices) {
+            LOGE("glDrawElements: content of the index buffer is unknown - ignoring\n");
+            return;
+        }
+        if (minIndex == 0) {
+            // no rebasing needed, the host draws from its copy of the indices
+            ctx->sendVertexData(0, maxIndex + 1);
+            ctx->glDrawElementsOffset(ctx, mode, count, type, offset);
+            return;
         }
-    } else {
+        haveRange = true;
+    } else if (!has_immediate_arrays) {
+        //
+        // all the vertex arrays are buffer objects, there is no range to
+        // send and the indices go as they are
+        //
+        ctx->sendVertexData(0, count);
+        ctx->glDrawElementsData(ctx, mode, count, type, indices,
+                                count * glSizeof(type));
+        return;
+    }
+
+    {
         void *adjustedIndices = indices;
-        int minIndex = 0, maxIndex = 0;
 
         switch(type) {
         case GL_BYTE:
         case GL_UNSIGNED_BYTE:
-            GLUtils::minmax<unsigned char>((unsigned char *)indices, count, &minIndex, &maxIndex);
+            if (!haveRange) {
+                GLUtils::minmax<unsigned char>((unsigned char *)indices, count, &minIndex, &maxIndex);
+            }
             if (minIndex != 0) {
                 adjustedIndices =  ctx->m_fixedBuffer.alloc(glSizeof(type) * count);
                 GLUtils::shiftIndices<unsigned char>((unsigned char *)indices,
@@ -411,7 +869,9 @@ void GLEncoder::s_glDrawElements(void *self, GLenum mode, GLsizei count, GLenum
             break;
         case GL_SHORT:
         case GL_UNSIGNED_SHORT:
-            GLUtils::minmax<unsigned short>((unsigned short *)indices, count, &minIndex, &maxIndex);
+            if (!haveRange) {
+                GLUtils::minmax<unsigned short>((unsigned short *)indices, count, &minIndex, &maxIndex);
+            }
             if (minIndex != 0) {
                 adjustedIndices = ctx->m_fixedBuffer.alloc(glSizeof(type) * count);
                 GLUtils::shiftIndices<unsigned short>((unsigned short *)indices,
@@ -422,26 +882,51 @@ void GLEncoder::s_glDrawElements(void *self, GLenum mode, GLsizei count, GLenum
         default:
             LOGE("unsupported index buffer type %d\n", type);
         }
-        if (has_indirect_arrays || 1) {
-            ctx->sendVertexData(minIndex, maxIndex - minIndex + 1);
-            ctx->glDrawElementsData(ctx, mode, count, type, adjustedIndices,
-                                      count * glSizeof(type));
-            // XXX - OPTIMIZATION (see the other else branch) should be implemented
-            if(!has_indirect_arrays) {
-                //LOGD("unoptimized drawelements !!!\n");
-            }
-        } else {
-            // we are all direct arrays and immidate mode index array -
-            // rebuild the arrays and the index array;
-            LOGE("glDrawElements: direct index & direct buffer data - will be implemented in later versions;\n");
+        ctx->sendVertexData(minIndex, maxIndex - minIndex + 1);
+        if (haveRange) {
+            // the host would read the indices from the bound buffer
+            ctx->m_glBindBuffer_enc(self, GL_ELEMENT_ARRAY_BUFFER, 0);
+        }
+        ctx->glDrawElementsData(ctx, mode, count, type, adjustedIndices,
+                                  count * glSizeof(type));
+        if (haveRange) {
+            ctx->m_glBindBuffer_enc(self, GL_ELEMENT_ARRAY_BUFFER,
+                                    ctx->m_state->currentIndexVbo());
         }
     }
 }
 
-GLEncoder::GLEncoder(IOStream *stream) : gl_encoder_context_t(stream)
+GLEncoder::GLEncoder(IOStream *stream) : gl_encoder_context_t(stream),
+    m_constants(sConstants, sizeof(sConstants) / sizeof(sConstants[0]))
 {
     m_state = NULL;
     m_compressedTextureFormats = NULL;
+    m_flushed = false;
+    m_flushedSeq = 0;
+
+    // opt-in: skip resending client arrays whose content did not change
+    // since they were last sent (see GLClientState::clientArrayDataSent)
+    char prop[PROPERTY_VALUE_MAX];
+    property_get("qemu.gles.vertex_dedup", prop, "0");
+    m_dedupVertexData = atoi(prop) != 0;
+
+    // opt-in: glGetError only reports the errors found by the encoder and
+    // those the host had at the last synchronous command, so it does not
+    // need a round trip
+    property_get("qemu.gles.defer_errors", prop, "0");
+    m_deferErrors = atoi(prop) != 0;
+    m_error = GL_NO_ERROR;
+
+    // opt-in: send the hash of large glTexImage2D images first, the host
+    // texture cache may already have them (see TextureCache.h)
+    property_get("qemu.gles.texture_cache", prop, "0");
+    m_textureCache = atoi(prop) != 0;
+
+    // opt-in: the guest names the objects, glGen* do not wait for the
+    // host (see GLNameAllocator.h)
+    property_get("qemu.gles.guest_names", prop, "0");
+    m_guestNames = atoi(prop) != 0;
+
     // overrides;
     m_glFlush_enc = set_glFlush(s_glFlush);
     m_glPixelStorei_enc = set_glPixelStorei(s_glPixelStorei);
@@ -461,13 +946,60 @@ GLEncoder::GLEncoder(IOStream *stream) : gl_encoder_context_t(stream)
     m_glGetPointerv_enc = set_glGetPointerv(s_glGetPointerv);
 
     m_glBindBuffer_enc = set_glBindBuffer(s_glBindBuffer);
+    m_glBufferData_enc = set_glBufferData(s_glBufferData);
+    m_glBufferSubData_enc = set_glBufferSubData(s_glBufferSubData);
+    m_glDeleteBuffers_enc = set_glDeleteBuffers(s_glDeleteBuffers);
     m_glEnableClientState_enc = set_glEnableClientState(s_glEnableClientState);
     m_glDisableClientState_enc = set_glDisableClientState(s_glDisableClientState);
     m_glIsEnabled_enc = set_glIsEnabled(s_glIsEnabled);
     m_glDrawArrays_enc = set_glDrawArrays(s_glDrawArrays);
     m_glDrawElements_enc = set_glDrawElements(s_glDrawElements);
     set_glGetString(s_glGetString);
+    m_glGetError_enc = set_glGetError(s_glGetError);
+    m_glFinish_enc = set_glFinish(s_glFinish);
+    m_glReadPixels_enc = set_glReadPixels(s_glReadPixels);
+    m_glTexImage2D_enc = set_glTexImage2D(s_glTexImage2D);
+    m_glMatrixMode_enc = set_glMatrixMode(s_glMatrixMode);
+    m_glActiveTexture_enc = set_glActiveTexture(s_glActiveTexture);
+    m_glPushMatrix_enc = set_glPushMatrix(s_glPushMatrix);
+    m_glPopMatrix_enc = set_glPopMatrix(s_glPopMatrix);
+    m_glLoadIdentity_enc = set_glLoadIdentity(s_glLoadIdentity);
+    m_glLoadMatrixf_enc = set_glLoadMatrixf(s_glLoadMatrixf);
+    m_glLoadMatrixx_enc = set_glLoadMatrixx(s_glLoadMatrixx);
+    m_glLoadMatrixxOES_enc = set_glLoadMatrixxOES(s_glLoadMatrixxOES);
+    m_glMultMatrixf_enc = set_glMultMatrixf(s_glMultMatrixf);
+    m_glMultMatrixx_enc = set_glMultMatrixx(s_glMultMatrixx);
+    m_glMultMatrixxOES_enc = set_glMultMatrixxOES(s_glMultMatrixxOES);
+    m_glTranslatef_enc = set_glTranslatef(s_glTranslatef);
+    m_glTranslatex_enc = set_glTranslatex(s_glTranslatex);
+    m_glTranslatexOES_enc = set_glTranslatexOES(s_glTranslatexOES);
+    m_glScalef_enc = set_glScalef(s_glScalef);
+    m_glScalex_enc = set_glScalex(s_glScalex);
+    m_glScalexOES_enc = set_glScalexOES(s_glScalexOES);
+    m_glRotatef_enc = set_glRotatef(s_glRotatef);
+    m_glRotatex_enc = set_glRotatex(s_glRotatex);
+    m_glRotatexOES_enc = set_glRotatexOES(s_glRotatexOES);
+    m_glFrustumf_enc = set_glFrustumf(s_glFrustumf);
+    m_glFrustumfOES_enc = set_glFrustumfOES(s_glFrustumfOES);
+    m_glFrustumx_enc = set_glFrustumx(s_glFrustumx);
+    m_glFrustumxOES_enc = set_glFrustumxOES(s_glFrustumxOES);
+    m_glOrthof_enc = set_glOrthof(s_glOrthof);
+    m_glOrthofOES_enc = set_glOrthofOES(s_glOrthofOES);
+    m_glOrthox_enc = set_glOrthox(s_glOrthox);
+    m_glOrthoxOES_enc = set_glOrthoxOES(s_glOrthoxOES);
 
+    if (m_guestNames) {
+        m_glGenBuffers_enc = set_glGenBuffers(s_glGenBuffers);
+        m_glGenTextures_enc = set_glGenTextures(s_glGenTextures);
+        m_glDeleteTextures_enc = set_glDeleteTextures(s_glDeleteTextures);
+        m_glBindTexture_enc = set_glBindTexture(s_glBindTexture);
+        m_glGenFramebuffersOES_enc = set_glGenFramebuffersOES(s_glGenFramebuffersOES);
+        m_glGenRenderbuffersOES_enc = set_glGenRenderbuffersOES(s_glGenRenderbuffersOES);
+        m_glDeleteFramebuffersOES_enc = set_glDeleteFramebuffersOES(s_glDeleteFramebuffersOES);
+        m_glDeleteRenderbuffersOES_enc = set_glDeleteRenderbuffersOES(s_glDeleteRenderbuffersOES);
+        m_glBindFramebufferOES_enc = set_glBindFramebufferOES(s_glBindFramebufferOES);
+        m_glBindRenderbufferOES_enc = set_glBindRenderbufferOES(s_glBindRenderbufferOES);
+    }
 }
 
 GLEncoder::~GLEncoder()
@@ -480,3 +1012,247 @@ size_t GLEncoder::pixelDataSize(GLsizei width, GLsizei height, GLenum format, GL
     assert(m_state != NULL);
     return m_state->pixelDataSize(width, height, format, type, pack);
 }
+
+void GLEncoder::s_glMatrixMode(void *self, GLenum mode)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    ctx->matrixState()->matrixMode(mode);
+    ctx->m_glMatrixMode_enc(self, mode);
+}
+
+void GLEncoder::s_glActiveTexture(void *self, GLenum texture)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    GLint maxUnits = 0;
+    ctx->getConstant(GL_MAX_TEXTURE_UNITS, &maxUnits);
+    ctx->matrixState()->activeTexture(texture, maxUnits);
+    ctx->m_glActiveTexture_enc(self, texture);
+}
+
+void GLEncoder::s_glPushMatrix(void *self)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    GLMatrixState *ms = ctx->matrixState();
+    GLenum param = ms->maxDepthParam();
+    if (param != 0) {
+        GLint maxDepth = 0;
+        ctx->getConstant(param, &maxDepth);
+        ms->push(maxDepth);
+    }
+    ctx->m_glPushMatrix_enc(self);
+}
+
+void GLEncoder::s_glPopMatrix(void *self)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    ctx->matrixState()->pop();
+    ctx->m_glPopMatrix_enc(self);
+}
+
+void GLEncoder::s_glLoadIdentity(void *self)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    if (ctx->matrixState()->loadIdentity()) {
+        ctx->m_glLoadIdentity_enc(self);
+    }
+}
+
+void GLEncoder::s_glLoadMatrixf(void *self, GLfloat *m)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    if (ctx->matrixState()->load(m)) {
+        ctx->m_glLoadMatrixf_enc(self, m);
+    }
+}
+
+void GLEncoder::s_glLoadMatrixx(void *self, GLfixed *m)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    GLfloat f[16];
+    fixedToFloat(f, m, 16);
+    if (ctx->matrixState()->load(f)) {
+        ctx->m_glLoadMatrixx_enc(self, m);
+    }
+}
+
+void GLEncoder::s_glLoadMatrixxOES(void *self, GLfixed *m)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    GLfloat f[16];
+    fixedToFloat(f, m, 16);
+    if (ctx->matrixState()->load(f)) {
+        ctx->m_glLoadMatrixxOES_enc(self, m);
+    }
+}
+
+void GLEncoder::s_glMultMatrixf(void *self, GLfloat *m)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    ctx->matrixState()->mult(m);
+    ctx->m_glMultMatrixf_enc(self, m);
+}
+
+void GLEncoder::s_glMultMatrixx(void *self, GLfixed *m)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    GLfloat f[16];
+    fixedToFloat(f, m, 16);
+    ctx->matrixState()->mult(f);
+    ctx->m_glMultMatrixx_enc(self, m);
+}
+
+void GLEncoder::s_glMultMatrixxOES(void *self, GLfixed *m)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    GLfloat f[16];
+    fixedToFloat(f, m, 16);
+    ctx->matrixState()->mult(f);
+    ctx->m_glMultMatrixxOES_enc(self, m);
+}
+
+void GLEncoder::s_glTranslatef(void *self, GLfloat x, GLfloat y, GLfloat z)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    ctx->matrixState()->translate(x, y, z);
+    ctx->m_glTranslatef_enc(self, x, y, z);
+}
+
+void GLEncoder::s_glTranslatex(void *self, GLfixed x, GLfixed y, GLfixed z)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    ctx->matrixState()->translate(X2F(x), X2F(y), X2F(z));
+    ctx->m_glTranslatex_enc(self, x, y, z);
+}
+
+void GLEncoder::s_glTranslatexOES(void *self, GLfixed x, GLfixed y, GLfixed z)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    ctx->matrixState()->translate(X2F(x), X2F(y), X2F(z));
+    ctx->m_glTranslatexOES_enc(self, x, y, z);
+}
+
+void GLEncoder::s_glScalef(void *self, GLfloat x, GLfloat y, GLfloat z)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    ctx->matrixState()->scale(x, y, z);
+    ctx->m_glScalef_enc(self, x, y, z);
+}
+
+void GLEncoder::s_glScalex(void *self, GLfixed x, GLfixed y, GLfixed z)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    ctx->matrixState()->scale(X2F(x), X2F(y), X2F(z));
+    ctx->m_glScalex_enc(self, x, y, z);
+}
+
+void GLEncoder::s_glScalexOES(void *self, GLfixed x, GLfixed y, GLfixed z)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    ctx->matrixState()->scale(X2F(x), X2F(y), X2F(z));
+    ctx->m_glScalexOES_enc(self, x, y, z);
+}
+
+void GLEncoder::s_glRotatef(void *self, GLfloat angle, GLfloat x, GLfloat y, GLfloat z)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    ctx->matrixState()->rotate(angle, x, y, z);
+    ctx->m_glRotatef_enc(self, angle, x, y, z);
+}
+
+void GLEncoder::s_glRotatex(void *self, GLfixed angle, GLfixed x, GLfixed y, GLfixed z)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    ctx->matrixState()->rotate(X2F(angle), X2F(x), X2F(y), X2F(z));
+    ctx->m_glRotatex_enc(self, angle, x, y, z);
+}
+
+void GLEncoder::s_glRotatexOES(void *self, GLfixed angle, GLfixed x, GLfixed y, GLfixed z)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    ctx->matrixState()->rotate(X2F(angle), X2F(x), X2F(y), X2F(z));
+    ctx->m_glRotatexOES_enc(self, angle, x, y, z);
+}
+
+void GLEncoder::s_glFrustumf(void *self, GLfloat left, GLfloat right, GLfloat bottom, GLfloat top, GLfloat zNear, GLfloat zFar)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    ctx->matrixState()->frustum(left, right, bottom, top, zNear, zFar);
+    ctx->m_glFrustumf_enc(self, left, right, bottom, top, zNear, zFar);
+}
+
+void GLEncoder::s_glFrustumfOES(void *self, GLfloat left, GLfloat right, GLfloat bottom, GLfloat top, GLfloat zNear, GLfloat zFar)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    ctx->matrixState()->frustum(left, right, bottom, top, zNear, zFar);
+    ctx->m_glFrustumfOES_enc(self, left, right, bottom, top, zNear, zFar);
+}
+
+void GLEncoder::s_glFrustumx(void *self, GLfixed left, GLfixed right, GLfixed bottom, GLfixed top, GLfixed zNear, GLfixed zFar)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    ctx->matrixState()->frustum(X2F(left), X2F(right), X2F(bottom), X2F(top), X2F(zNear), X2F(zFar));
+    ctx->m_glFrustumx_enc(self, left, right, bottom, top, zNear, zFar);
+}
+
+void GLEncoder::s_glFrustumxOES(void *self, GLfixed left, GLfixed right, GLfixed bottom, GLfixed top, GLfixed zNear, GLfixed zFar)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    ctx->matrixState()->frustum(X2F(left), X2F(right), X2F(bottom), X2F(top), X2F(zNear), X2F(zFar));
+    ctx->m_glFrustumxOES_enc(self, left, right, bottom, top, zNear, zFar);
+}
+
+void GLEncoder::s_glOrthof(void *self, GLfloat left, GLfloat right, GLfloat bottom, GLfloat top, GLfloat zNear, GLfloat zFar)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    ctx->matrixState()->ortho(left, right, bottom, top, zNear, zFar);
+    ctx->m_glOrthof_enc(self, left, right, bottom, top, zNear, zFar);
+}
+
+void GLEncoder::s_glOrthofOES(void *self, GLfloat left, GLfloat right, GLfloat bottom, GLfloat top, GLfloat zNear, GLfloat zFar)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    ctx->matrixState()->ortho(left, right, bottom, top, zNear, zFar);
+    ctx->m_glOrthofOES_enc(self, left, right, bottom, top, zNear, zFar);
+}
+
+void GLEncoder::s_glOrthox(void *self, GLfixed left, GLfixed right, GLfixed bottom, GLfixed top, GLfixed zNear, GLfixed zFar)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    ctx->matrixState()->ortho(X2F(left), X2F(right), X2F(bottom), X2F(top), X2F(zNear), X2F(zFar));
+    ctx->m_glOrthox_enc(self, left, right, bottom, top, zNear, zFar);
+}
+
+void GLEncoder::s_glOrthoxOES(void *self, GLfixed left, GLfixed right, GLfixed bottom, GLfixed top, GLfixed zNear, GLfixed zFar)
+{
+    GLEncoder *ctx = (GLEncoder *)self;
+    assert(ctx->m_state != NULL);
+    ctx->matrixState()->ortho(X2F(left), X2F(right), X2F(bottom), X2F(top), X2F(zNear), X2F(zFar));
+    ctx->m_glOrthoxOES_enc(self, left, right, bottom, top, zNear, zFar);
+}
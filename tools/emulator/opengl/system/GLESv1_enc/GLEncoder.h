@@ -19,6 +19,9 @@
 #include "gl_enc.h"
 #include "GLClientState.h"
 #include "FixedBuffer.h"
+#include "GLConstantCache.h"
+#include "GLMatrixState.h"
+#include "GLNameAllocator.h"
 
 class GLEncoder : public gl_encoder_context_t {
 
@@ -36,8 +39,12 @@ private:
     FixedBuffer m_fixedBuffer;
     GLint *m_compressedTextureFormats;
     GLint m_num_compressedTextureFormats;
+    bool m_dedupVertexData;
 
     GLint *getCompressedTextureFormats();
+
+    GLConstantCache m_constants;
+    int getConstant(GLenum param, GLint *values);
     // original functions;
     glGetIntegerv_client_proc_t m_glGetIntegerv_enc;
     glGetFloatv_client_proc_t m_glGetFloatv_enc;
@@ -56,6 +63,9 @@ private:
     glWeightPointerOES_client_proc_t m_glWeightPointerOES_enc;
 
     glBindBuffer_client_proc_t m_glBindBuffer_enc;
+    glBufferData_client_proc_t m_glBufferData_enc;
+    glBufferSubData_client_proc_t m_glBufferSubData_enc;
+    glDeleteBuffers_client_proc_t m_glDeleteBuffers_enc;
     glEnableClientState_client_proc_t m_glEnableClientState_enc;
     glDisableClientState_client_proc_t m_glDisableClientState_enc;
     glIsEnabled_client_proc_t m_glIsEnabled_enc;
@@ -63,6 +73,147 @@ private:
     glDrawElements_client_proc_t m_glDrawElements_enc;
     glFlush_client_proc_t m_glFlush_enc;
 
+    GLenum m_error;
+    bool m_deferErrors;
+    void setError(GLenum error);
+    void collectHostError();
+
+    glGetError_client_proc_t m_glGetError_enc;
+    static GLenum s_glGetError(void *self);
+
+    glFinish_client_proc_t m_glFinish_enc;
+    static GLint s_glFinish(void *self);
+
+    glReadPixels_client_proc_t m_glReadPixels_enc;
+    static void s_glReadPixels(void *self, GLint x, GLint y, GLsizei width, GLsizei height,
+                               GLenum format, GLenum type, GLvoid *pixels);
+
+    bool m_textureCache;
+    glTexImage2D_client_proc_t m_glTexImage2D_enc;
+    static void s_glTexImage2D(void *self, GLenum target, GLint level, GLint internalformat,
+                               GLsizei width, GLsizei height, GLint border,
+                               GLenum format, GLenum type, GLvoid *pixels);
+
+    // object names picked by the guest, see GLNameAllocator.h
+    bool m_guestNames;
+
+    glGenBuffers_client_proc_t m_glGenBuffers_enc;
+    static void s_glGenBuffers(void *self, GLsizei n, GLuint *buffers);
+
+    glGenTextures_client_proc_t m_glGenTextures_enc;
+    static void s_glGenTextures(void *self, GLsizei n, GLuint *textures);
+
+    glDeleteTextures_client_proc_t m_glDeleteTextures_enc;
+    static void s_glDeleteTextures(void *self, GLsizei n, GLuint *textures);
+
+    glBindTexture_client_proc_t m_glBindTexture_enc;
+    static void s_glBindTexture(void *self, GLenum target, GLuint texture);
+
+    glGenFramebuffersOES_client_proc_t m_glGenFramebuffersOES_enc;
+    static void s_glGenFramebuffersOES(void *self, GLsizei n, GLuint *framebuffers);
+
+    glGenRenderbuffersOES_client_proc_t m_glGenRenderbuffersOES_enc;
+    static void s_glGenRenderbuffersOES(void *self, GLsizei n, GLuint *renderbuffers);
+
+    glDeleteFramebuffersOES_client_proc_t m_glDeleteFramebuffersOES_enc;
+    static void s_glDeleteFramebuffersOES(void *self, GLsizei n, GLuint *framebuffers);
+
+    glDeleteRenderbuffersOES_client_proc_t m_glDeleteRenderbuffersOES_enc;
+    static void s_glDeleteRenderbuffersOES(void *self, GLsizei n, GLuint *renderbuffers);
+
+    glBindFramebufferOES_client_proc_t m_glBindFramebufferOES_enc;
+    static void s_glBindFramebufferOES(void *self, GLenum target, GLuint framebuffer);
+
+    glBindRenderbufferOES_client_proc_t m_glBindRenderbufferOES_enc;
+    static void s_glBindRenderbufferOES(void *self, GLenum target, GLuint renderbuffer);
+
+    GLMatrixState *matrixState() { return m_state->matrixState(); }
+    bool getMatrixParameter(GLenum param, GLfloat *values);
+
+    glMatrixMode_client_proc_t m_glMatrixMode_enc;
+    static void s_glMatrixMode(void *self, GLenum mode);
+
+    glActiveTexture_client_proc_t m_glActiveTexture_enc;
+    static void s_glActiveTexture(void *self, GLenum texture);
+
+    glPushMatrix_client_proc_t m_glPushMatrix_enc;
+    static void s_glPushMatrix(void *self);
+
+    glPopMatrix_client_proc_t m_glPopMatrix_enc;
+    static void s_glPopMatrix(void *self);
+
+    glLoadIdentity_client_proc_t m_glLoadIdentity_enc;
+    static void s_glLoadIdentity(void *self);
+
+    glLoadMatrixf_client_proc_t m_glLoadMatrixf_enc;
+    static void s_glLoadMatrixf(void *self, GLfloat *m);
+
+    glLoadMatrixx_client_proc_t m_glLoadMatrixx_enc;
+    static void s_glLoadMatrixx(void *self, GLfixed *m);
+
+    glLoadMatrixxOES_client_proc_t m_glLoadMatrixxOES_enc;
+    static void s_glLoadMatrixxOES(void *self, GLfixed *m);
+
+    glMultMatrixf_client_proc_t m_glMultMatrixf_enc;
+    static void s_glMultMatrixf(void *self, GLfloat *m);
+
+    glMultMatrixx_client_proc_t m_glMultMatrixx_enc;
+    static void s_glMultMatrixx(void *self, GLfixed *m);
+
+    glMultMatrixxOES_client_proc_t m_glMultMatrixxOES_enc;
+    static void s_glMultMatrixxOES(void *self, GLfixed *m);
+
+    glTranslatef_client_proc_t m_glTranslatef_enc;
+    static void s_glTranslatef(void *self, GLfloat x, GLfloat y, GLfloat z);
+
+    glTranslatex_client_proc_t m_glTranslatex_enc;
+    static void s_glTranslatex(void *self, GLfixed x, GLfixed y, GLfixed z);
+
+    glTranslatexOES_client_proc_t m_glTranslatexOES_enc;
+    static void s_glTranslatexOES(void *self, GLfixed x, GLfixed y, GLfixed z);
+
+    glScalef_client_proc_t m_glScalef_enc;
+    static void s_glScalef(void *self, GLfloat x, GLfloat y, GLfloat z);
+
+    glScalex_client_proc_t m_glScalex_enc;
+    static void s_glScalex(void *self, GLfixed x, GLfixed y, GLfixed z);
+
+    glScalexOES_client_proc_t m_glScalexOES_enc;
+    static void s_glScalexOES(void *self, GLfixed x, GLfixed y, GLfixed z);
+
+    glRotatef_client_proc_t m_glRotatef_enc;
+    static void s_glRotatef(void *self, GLfloat angle, GLfloat x, GLfloat y, GLfloat z);
+
+    glRotatex_client_proc_t m_glRotatex_enc;
+    static void s_glRotatex(void *self, GLfixed angle, GLfixed x, GLfixed y, GLfixed z);
+
+    glRotatexOES_client_proc_t m_glRotatexOES_enc;
+    static void s_glRotatexOES(void *self, GLfixed angle, GLfixed x, GLfixed y, GLfixed z);
+
+    glFrustumf_client_proc_t m_glFrustumf_enc;
+    static void s_glFrustumf(void *self, GLfloat left, GLfloat right, GLfloat bottom, GLfloat top, GLfloat zNear, GLfloat zFar);
+
+    glFrustumfOES_client_proc_t m_glFrustumfOES_enc;
+    static void s_glFrustumfOES(void *self, GLfloat left, GLfloat right, GLfloat bottom, GLfloat top, GLfloat zNear, GLfloat zFar);
+
+    glFrustumx_client_proc_t m_glFrustumx_enc;
+    static void s_glFrustumx(void *self, GLfixed left, GLfixed right, GLfixed bottom, GLfixed top, GLfixed zNear, GLfixed zFar);
+
+    glFrustumxOES_client_proc_t m_glFrustumxOES_enc;
+    static void s_glFrustumxOES(void *self, GLfixed left, GLfixed right, GLfixed bottom, GLfixed top, GLfixed zNear, GLfixed zFar);
+
+    glOrthof_client_proc_t m_glOrthof_enc;
+    static void s_glOrthof(void *self, GLfloat left, GLfloat right, GLfloat bottom, GLfloat top, GLfloat zNear, GLfloat zFar);
+
+    glOrthofOES_client_proc_t m_glOrthofOES_enc;
+    static void s_glOrthofOES(void *self, GLfloat left, GLfloat right, GLfloat bottom, GLfloat top, GLfloat zNear, GLfloat zFar);
+
+    glOrthox_client_proc_t m_glOrthox_enc;
+    static void s_glOrthox(void *self, GLfixed left, GLfixed right, GLfixed bottom, GLfixed top, GLfixed zNear, GLfixed zFar);
+
+    glOrthoxOES_client_proc_t m_glOrthoxOES_enc;
+    static void s_glOrthoxOES(void *self, GLfixed left, GLfixed right, GLfixed bottom, GLfixed top, GLfixed zNear, GLfixed zFar);
+
     // statics
     static void s_glGetIntegerv(void *self, GLenum pname, GLint *ptr);
     static void s_glGetBooleanv(void *self, GLenum pname, GLboolean *ptr);
@@ -71,6 +222,12 @@ private:
     static void s_glGetPointerv(void *self, GLenum pname, GLvoid **params);
 
     static void s_glFlush(void * self);
+    // the stream sequence after the last glFlush, see IOStream::idleSince
+    bool m_flushed;
+    unsigned int m_flushedSeq;
+    static void s_glBufferData(void *self, GLenum target, GLsizeiptr size, GLvoid *data, GLenum usage);
+    static void s_glBufferSubData(void *self, GLenum target, GLintptr offset, GLsizeiptr size, GLvoid *data);
+    static void s_glDeleteBuffers(void *self, GLsizei n, GLuint *buffers);
     static GLubyte * s_glGetString(void *self, GLenum name);
     static void s_glVertexPointer(void *self, int size, GLenum type, GLsizei stride, void *data);
     static void s_glNormalPointer(void *self, GLenum type, GLsizei stride, void *data);
@@ -88,5 +245,7 @@ private:
     static void s_glDrawElements(void *self, GLenum mode, GLsizei count, GLenum type, void *indices);
     static void s_glPixelStorei(void *self, GLenum param, GLint value);
     void sendVertexData(unsigned first, unsigned count);
+    uint32_t findInterleavedArrays(const unsigned char **base, unsigned int *stride,
+                                   unsigned int *span);
 };
 #endif
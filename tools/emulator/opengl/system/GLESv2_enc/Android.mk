@@ -36,7 +36,7 @@ GEN_GL2 := \
 
 $(GEN_GL2) : PRIVATE_PATH := $(LOCAL_PATH)
 $(GEN_GL2) : PRIVATE_CUSTOM_TOOL := \
-        $(EMUGEN) -E $(glesv2_intermediates) -i $(PRIVATE_PATH) gl2
+        $(EMUGEN) -S -E $(glesv2_intermediates) -i $(PRIVATE_PATH) gl2
 $(GEN_GL2) : $(EMUGEN) \
         $(LOCAL_PATH)/gl2.attrib \
         $(LOCAL_PATH)/gl2.in \
@@ -1,5 +1,9 @@
 #include "GL2Encoder.h"
+#include "TextureHash.h"
+#include <cutils/log.h>
+#include <cutils/properties.h>
 #include <assert.h>
+#include <stdlib.h>
 
 
 static GLubyte *gVendorString= (GLubyte *) "Android";
@@ -7,13 +11,90 @@ static GLubyte *gRendererString= (GLubyte *) "Android HW-GLES 2.0";
 static GLubyte *gVersionString= (GLubyte *) "OpenGL ES 2.0";
 static GLubyte *gExtensionsString= (GLubyte *) ""; // no extensions at this point;
 
-GL2Encoder::GL2Encoder(IOStream *stream) : gl2_encoder_context_t(stream)
+//
+// the names of the objects named by the guest, shaders and programs share
+// theirs as in GL
+//
+static GLNameAllocator sBufferNames;
+static GLNameAllocator sTextureNames;
+static GLNameAllocator sFramebufferNames;
+static GLNameAllocator sRenderbufferNames;
+static GLNameAllocator sShaderNames;
+
+//
+// allocNames - 'n' names for glGen*, false if they have to come from the
+//     host (n < 0 reports the error)
+// markNames - the 'n' names the host generated are taken
+//
+static bool allocNames(GLNameAllocator *names, GLsizei n, GLuint *ids)
+{
+    return n >= 0 && names->alloc(n, ids);
+}
+
+static void markNames(GLNameAllocator *names, GLsizei n, const GLuint *ids)
+{
+    for (GLsizei i = 0; i < n; i++) {
+        names->markUsed(ids[i]);
+    }
+}
+
+//
+// host implementation limits, they cannot change during a connection
+//
+static const GLConstantCache::Constant sConstants[] = {
+    { GL_MAX_TEXTURE_SIZE, 1 },
+    { GL_MAX_CUBE_MAP_TEXTURE_SIZE, 1 },
+    { GL_MAX_RENDERBUFFER_SIZE, 1 },
+    { GL_MAX_VIEWPORT_DIMS, 2 },
+    { GL_MAX_VERTEX_ATTRIBS, 1 },
+    { GL_MAX_VERTEX_UNIFORM_VECTORS, 1 },
+    { GL_MAX_VARYING_VECTORS, 1 },
+    { GL_MAX_FRAGMENT_UNIFORM_VECTORS, 1 },
+    { GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, 1 },
+    { GL_MAX_VERTEX_TEXTURE_IMAGE_UNITS, 1 },
+    { GL_MAX_TEXTURE_IMAGE_UNITS, 1 },
+    { GL_SUBPIXEL_BITS, 1 },
+    { GL_NUM_COMPRESSED_TEXTURE_FORMATS, 1 },
+};
+
+GL2Encoder::GL2Encoder(IOStream *stream) : gl2_encoder_context_t(stream),
+    m_constants(sConstants, sizeof(sConstants) / sizeof(sConstants[0]))
 {
     m_state = NULL;
+    m_currentProgram = 0;
+    m_flushed = false;
+    m_flushedSeq = 0;
+
+    // opt-in: skip resending client arrays whose content did not change
+    // since they were last sent (see GLClientState::clientArrayDataSent)
+    char prop[PROPERTY_VALUE_MAX];
+    property_get("qemu.gles.vertex_dedup", prop, "0");
+    m_dedupVertexData = atoi(prop) != 0;
+
+    // opt-in: glGetError only reports the errors found by the encoder and
+    // those the host had at the last synchronous command, so it does not
+    // need a round trip
+    property_get("qemu.gles.defer_errors", prop, "0");
+    m_deferErrors = atoi(prop) != 0;
+    m_error = GL_NO_ERROR;
+
+    // opt-in: send the hash of large glTexImage2D images first, the host
+    // texture cache may already have them (see TextureCache.h)
+    property_get("qemu.gles.texture_cache", prop, "0");
+    m_textureCache = atoi(prop) != 0;
+
+    // opt-in: the guest names the objects, glGen* and glCreate* do not
+    // wait for the host (see GLNameAllocator.h)
+    property_get("qemu.gles.guest_names", prop, "0");
+    m_guestNames = atoi(prop) != 0;
+
     m_glFlush_enc = set_glFlush(s_glFlush);
     m_glPixelStorei_enc = set_glPixelStorei(s_glPixelStorei);
     m_glGetString_enc = set_glGetString(s_glGetString);
     m_glBindBuffer_enc = set_glBindBuffer(s_glBindBuffer);
+    m_glBufferData_enc = set_glBufferData(s_glBufferData);
+    m_glBufferSubData_enc = set_glBufferSubData(s_glBufferSubData);
+    m_glDeleteBuffers_enc = set_glDeleteBuffers(s_glDeleteBuffers);
     m_glDrawArrays_enc = set_glDrawArrays(s_glDrawArrays);
     m_glDrawElements_enc = set_glDrawElements(s_glDrawElements);
     m_glGetIntegerv_enc = set_glGetIntegerv(s_glGetIntegerv);
@@ -26,6 +107,50 @@ GL2Encoder::GL2Encoder(IOStream *stream) : gl2_encoder_context_t(stream)
     m_glGetVertexAttribfv_enc = set_glGetVertexAttribfv(s_glGetVertexAttribfv);
     m_glGetVertexAttribPointerv = set_glGetVertexAttribPointerv(s_glGetVertexAttribPointerv);
     set_glShaderSource(s_glShaderSource);
+    m_glGetError_enc = set_glGetError(s_glGetError);
+    m_glFinish_enc = set_glFinish(s_glFinish);
+    m_glReadPixels_enc = set_glReadPixels(s_glReadPixels);
+    m_glTexImage2D_enc = set_glTexImage2D(s_glTexImage2D);
+    m_glLinkProgram_enc = set_glLinkProgram(s_glLinkProgram);
+    m_glDeleteProgram_enc = set_glDeleteProgram(s_glDeleteProgram);
+    m_glGetAttribLocation_enc = set_glGetAttribLocation(s_glGetAttribLocation);
+    m_glGetUniformLocation_enc = set_glGetUniformLocation(s_glGetUniformLocation);
+    m_glUseProgram_enc = set_glUseProgram(s_glUseProgram);
+    m_glUniform1f_enc = set_glUniform1f(s_glUniform1f);
+    m_glUniform1fv_enc = set_glUniform1fv(s_glUniform1fv);
+    m_glUniform1i_enc = set_glUniform1i(s_glUniform1i);
+    m_glUniform1iv_enc = set_glUniform1iv(s_glUniform1iv);
+    m_glUniform2f_enc = set_glUniform2f(s_glUniform2f);
+    m_glUniform2fv_enc = set_glUniform2fv(s_glUniform2fv);
+    m_glUniform2i_enc = set_glUniform2i(s_glUniform2i);
+    m_glUniform2iv_enc = set_glUniform2iv(s_glUniform2iv);
+    m_glUniform3f_enc = set_glUniform3f(s_glUniform3f);
+    m_glUniform3fv_enc = set_glUniform3fv(s_glUniform3fv);
+    m_glUniform3i_enc = set_glUniform3i(s_glUniform3i);
+    m_glUniform3iv_enc = set_glUniform3iv(s_glUniform3iv);
+    m_glUniform4f_enc = set_glUniform4f(s_glUniform4f);
+    m_glUniform4fv_enc = set_glUniform4fv(s_glUniform4fv);
+    m_glUniform4i_enc = set_glUniform4i(s_glUniform4i);
+    m_glUniform4iv_enc = set_glUniform4iv(s_glUniform4iv);
+    m_glUniformMatrix2fv_enc = set_glUniformMatrix2fv(s_glUniformMatrix2fv);
+    m_glUniformMatrix3fv_enc = set_glUniformMatrix3fv(s_glUniformMatrix3fv);
+    m_glUniformMatrix4fv_enc = set_glUniformMatrix4fv(s_glUniformMatrix4fv);
+
+    if (m_guestNames) {
+        m_glGenBuffers_enc = set_glGenBuffers(s_glGenBuffers);
+        m_glGenTextures_enc = set_glGenTextures(s_glGenTextures);
+        m_glGenFramebuffers_enc = set_glGenFramebuffers(s_glGenFramebuffers);
+        m_glGenRenderbuffers_enc = set_glGenRenderbuffers(s_glGenRenderbuffers);
+        m_glCreateShader_enc = set_glCreateShader(s_glCreateShader);
+        m_glCreateProgram_enc = set_glCreateProgram(s_glCreateProgram);
+        m_glDeleteTextures_enc = set_glDeleteTextures(s_glDeleteTextures);
+        m_glDeleteFramebuffers_enc = set_glDeleteFramebuffers(s_glDeleteFramebuffers);
+        m_glDeleteRenderbuffers_enc = set_glDeleteRenderbuffers(s_glDeleteRenderbuffers);
+        m_glDeleteShader_enc = set_glDeleteShader(s_glDeleteShader);
+        m_glBindTexture_enc = set_glBindTexture(s_glBindTexture);
+        m_glBindFramebuffer_enc = set_glBindFramebuffer(s_glBindFramebuffer);
+        m_glBindRenderbuffer_enc = set_glBindRenderbuffer(s_glBindRenderbuffer);
+    }
 }
 
 GL2Encoder::~GL2Encoder()
@@ -33,11 +158,101 @@ GL2Encoder::~GL2Encoder()
     delete m_compressedTextureFormats;
 }
 
+void GL2Encoder::setError(GLenum error)
+{
+    // like GL, keep the first error until it is queried
+    if (m_error == GL_NO_ERROR) {
+        m_error = error;
+    }
+}
+
+//
+// in the deferred error mode the errors of the host are only fetched at
+// the points where the guest waits for the host anyway, and reported by
+// the following glGetError
+//
+void GL2Encoder::collectHostError()
+{
+    if (!m_deferErrors) return;
+
+    GLenum error = m_glGetError_enc(this);
+    if (error != GL_NO_ERROR) {
+        setError(error);
+    }
+}
+
+GLenum GL2Encoder::s_glGetError(void *self)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    GLenum error = ctx->m_error;
+    if (error != GL_NO_ERROR) {
+        ctx->m_error = GL_NO_ERROR;
+        return error;
+    }
+    if (ctx->m_deferErrors) {
+        return GL_NO_ERROR;
+    }
+    return ctx->m_glGetError_enc(self);
+}
+
+GLint GL2Encoder::s_glFinish(void *self)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    GLint retval = ctx->m_glFinish_enc(self);
+    ctx->collectHostError();
+    return retval;
+}
+
+void GL2Encoder::s_glReadPixels(void *self, GLint x, GLint y, GLsizei width, GLsizei height,
+                               GLenum format, GLenum type, GLvoid *pixels)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    ctx->m_glReadPixels_enc(self, x, y, width, height, format, type, pixels);
+    ctx->collectHostError();
+}
+
+void GL2Encoder::s_glTexImage2D(void *self, GLenum target, GLint level, GLint internalformat,
+                                GLsizei width, GLsizei height, GLint border,
+                                GLenum format, GLenum type, GLvoid *pixels)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+
+    if (ctx->m_textureCache && pixels != NULL) {
+        size_t len = ctx->m_state->pixelDataSize(width, height, format, type, 1);
+        if (len >= TEXTURE_CACHE_MIN_SIZE) {
+            GLuint hash[TEXTURE_HASH_WORDS];
+            textureHash(pixels, len, hash);
+            GLint res = ctx->glTexImage2DCached(self, target, level, internalformat,
+                                                width, height, border, format, type, len, hash);
+            if (res > 0) {
+                return;
+            }
+            if (res == 0) {
+                // the host adds the image to its cache
+                ctx->glTexImage2DCachedData(self, target, level, internalformat,
+                                            width, height, border, format, type, pixels, len);
+                return;
+            }
+            // the host has no texture cache, stop asking
+            ctx->m_textureCache = false;
+        }
+    }
+    ctx->m_glTexImage2D_enc(self, target, level, internalformat, width, height, border,
+                            format, type, pixels);
+}
+
 void GL2Encoder::s_glFlush(void *self)
 {
     GL2Encoder *ctx = (GL2Encoder *) self;
+    // glFlush is a sync point, it is always sent unless nothing was sent
+    // since the previous one
+    if (ctx->m_flushed && ctx->m_stream->idleSince(ctx->m_flushedSeq)) {
+        return;
+    }
     ctx->m_glFlush_enc(self);
     ctx->m_stream->flush();
+    ctx->m_flushed = true;
+    ctx->m_flushedSeq = ctx->m_stream->sentSeq();
 }
 
 GLubyte *GL2Encoder::s_glGetString(void *self, GLenum name)
@@ -75,9 +290,41 @@ void GL2Encoder::s_glBindBuffer(void *self, GLenum target, GLuint id)
     assert(ctx->m_state != NULL);
     ctx->m_state->bindBuffer(target, id);
     // TODO set error state if needed;
+    if (ctx->m_guestNames) {
+        sBufferNames.markUsed(id);
+    }
     ctx->m_glBindBuffer_enc(self, target, id);
 }
 
+void GL2Encoder::s_glBufferData(void *self, GLenum target, GLsizeiptr size, GLvoid *data, GLenum usage)
+{
+    GL2Encoder *ctx = (GL2Encoder *) self;
+    assert(ctx->m_state != NULL);
+    ctx->m_state->bufferData(target, size, data);
+    ctx->m_glBufferData_enc(self, target, size, data, usage);
+}
+
+void GL2Encoder::s_glBufferSubData(void *self, GLenum target, GLintptr offset, GLsizeiptr size, GLvoid *data)
+{
+    GL2Encoder *ctx = (GL2Encoder *) self;
+    assert(ctx->m_state != NULL);
+    ctx->m_state->bufferSubData(target, offset, size, data);
+    ctx->m_glBufferSubData_enc(self, target, offset, size, data);
+}
+
+void GL2Encoder::s_glDeleteBuffers(void *self, GLsizei n, GLuint *buffers)
+{
+    GL2Encoder *ctx = (GL2Encoder *) self;
+    assert(ctx->m_state != NULL);
+    if (n > 0) {
+        ctx->m_state->deleteBuffers(n, buffers);
+        if (ctx->m_guestNames) {
+            sBufferNames.release(n, buffers);
+        }
+    }
+    ctx->m_glDeleteBuffers_enc(self, n, buffers);
+}
+
 void GL2Encoder::s_glVertexAtrribPointer(void *self, GLuint indx, GLint size, GLenum type, GLboolean normalized, GLsizei stride, GLvoid * ptr)
 {
     GL2Encoder *ctx = (GL2Encoder *)self;
@@ -85,6 +332,25 @@ void GL2Encoder::s_glVertexAtrribPointer(void *self, GLuint indx, GLint size, GL
     ctx->m_state->setState(indx, size, type, normalized, stride, ptr);
 }
 
+//
+// getConstant - gets the values of an implementation constant, from the
+//     host the first time only. Returns their number, 0 if 'param' is
+//     not such a constant.
+//
+int GL2Encoder::getConstant(GLenum param, GLint *values)
+{
+    if (!m_constants.isConstant(param)) return 0;
+
+    int n = m_constants.get(param, values);
+    if (n == 0) {
+        GLint hostValues[GL_CONSTANT_MAX_VALUES];
+        m_glGetIntegerv_enc(this, param, hostValues);
+        m_constants.set(param, hostValues);
+        n = m_constants.get(param, values);
+    }
+    return n;
+}
+
 void GL2Encoder::s_glGetIntegerv(void *self, GLenum param, GLint *params)
 {
     GL2Encoder *ctx = (GL2Encoder *) self;
@@ -98,7 +364,8 @@ void GL2Encoder::s_glGetIntegerv(void *self, GLenum param, GLint *params)
         if (ctx->m_num_compressedTextureFormats > 0 && compressedTextureFormats != NULL) {
             memcpy(params, compressedTextureFormats, ctx->m_num_compressedTextureFormats * sizeof(GLint));
         }
-    } else if (!ctx->m_state->getClientStateParameter<GLint>(param, params)) {
+    } else if (!ctx->m_state->getClientStateParameter<GLint>(param, params) &&
+               !ctx->getConstant(param, params)) {
         ctx->m_glGetIntegerv_enc(self, param, params);
     }
 }
@@ -121,7 +388,14 @@ void GL2Encoder::s_glGetFloatv(void *self, GLenum param, GLfloat *ptr)
         }
     }
     else if (!ctx->m_state->getClientStateParameter<GLfloat>(param,ptr)) {
-        ctx->m_glGetFloatv_enc(self, param, ptr);
+        GLint values[GL_CONSTANT_MAX_VALUES];
+        int n = ctx->getConstant(param, values);
+        if (n == 0) {
+            ctx->m_glGetFloatv_enc(self, param, ptr);
+        }
+        for (int i = 0; i < n; i++) {
+            ptr[i] = (GLfloat) values[i];
+        }
     }
 }
 
@@ -134,7 +408,14 @@ void GL2Encoder::s_glGetBooleanv(void *self, GLenum param, GLboolean *ptr)
         // ignore the command, although we should have generated a GLerror;
     }
     else if (!ctx->m_state->getClientStateParameter<GLboolean>(param,ptr)) {
-        ctx->m_glGetBooleanv_enc(self, param, ptr);
+        GLint values[GL_CONSTANT_MAX_VALUES];
+        int n = ctx->getConstant(param, values);
+        if (n == 0) {
+            ctx->m_glGetBooleanv_enc(self, param, ptr);
+        }
+        for (int i = 0; i < n; i++) {
+            ptr[i] = values[i] != 0 ? GL_TRUE : GL_FALSE;
+        }
     }
 }
 
@@ -190,18 +471,11 @@ void GL2Encoder::sendVertexAttributes(GLint first, GLsizei count)
 {
     assert(m_state);
 
-    for (int i = 0; i < m_state->nLocations(); i++) {
-        bool enableDirty;
-        const GLClientState::VertexAttribState *state = m_state->getStateAndEnableDirty(i, &enableDirty);
-
-        if (!state) {
-            continue;
-        }
-
-        if (!enableDirty && !state->enabled) {
-            continue;
-        }
-
+    // only the enabled locations and those which were just disabled matter
+    const uint64_t dirty = m_state->takeEnableDirtyMask();
+    for (uint64_t locations = m_state->enabledMask() | dirty; locations; ) {
+        int i = GLClientState::nextLocation(&locations);
+        const GLClientState::VertexAttribState *state = m_state->getState(i);
 
         if (state->enabled) {
             m_glEnableVertexAttribArray_enc(this, i);
@@ -211,9 +485,13 @@ void GL2Encoder::sendVertexAttributes(GLint first, GLsizei count)
             int firstIndex = stride * first;
 
             if (state->bufferObject == 0) {
-                this->glVertexAttribPointerData(this, i, state->size, state->type, state->normalized, state->stride,
-                                                (unsigned char *)state->data + firstIndex, datalen);
+                // the host still points at identical data
+                if (!m_dedupVertexData || !m_state->clientArrayDataSent(i, first, count)) {
+                    this->glVertexAttribPointerData(this, i, state->size, state->type, state->normalized, state->stride,
+                                                    (unsigned char *)state->data + firstIndex, datalen);
+                }
             } else {
+                m_state->invalidateArrayData(i);
                 this->glBindBuffer(this, GL_ARRAY_BUFFER, state->bufferObject);
                 this->glVertexAttribPointerOffset(this, i, state->size, state->type, state->normalized, state->stride,
                                                   (GLuint) state->data + firstIndex);
@@ -227,6 +505,16 @@ void GL2Encoder::sendVertexAttributes(GLint first, GLsizei count)
 void GL2Encoder::s_glDrawArrays(void *self, GLenum mode, GLint first, GLsizei count)
 {
     GL2Encoder *ctx = (GL2Encoder *)self;
+
+    if (first < 0 || count < 0) {
+        ctx->setError(GL_INVALID_VALUE);
+        return;
+    }
+    if (mode > GL_TRIANGLE_FAN) {
+        ctx->setError(GL_INVALID_ENUM);
+        return;
+    }
+
     ctx->sendVertexAttributes(first, count);
     ctx->m_glDrawArrays_enc(ctx, mode, 0, count);
 }
@@ -238,18 +526,25 @@ void GL2Encoder::s_glDrawElements(void *self, GLenum mode, GLsizei count, GLenum
     GL2Encoder *ctx = (GL2Encoder *)self;
     assert(ctx->m_state != NULL);
 
+    if (count < 0) {
+        ctx->setError(GL_INVALID_VALUE);
+        return;
+    }
+    if (mode > GL_TRIANGLE_FAN) {
+        ctx->setError(GL_INVALID_ENUM);
+        return;
+    }
+
     bool has_immediate_arrays = false;
     bool has_indirect_arrays = false;
-    int nLocations = ctx->m_state->nLocations();
 
-    for (int i = 0; i < nLocations; i++) {
-        const GLClientState::VertexAttribState *state = ctx->m_state->getState(i);
-        if (state->enabled) {
-            if (state->bufferObject != 0) {
-                has_indirect_arrays = true;
-            } else {
-                has_immediate_arrays = true;
-            }
+    for (uint64_t enabled = ctx->m_state->enabledMask(); enabled; ) {
+        const GLClientState::VertexAttribState *state =
+            ctx->m_state->getState(GLClientState::nextLocation(&enabled));
+        if (state->bufferObject != 0) {
+            has_indirect_arrays = true;
+        } else {
+            has_immediate_arrays = true;
         }
     }
 
@@ -258,21 +553,54 @@ void GL2Encoder::s_glDrawElements(void *self, GLenum mode, GLsizei count, GLenum
         return;
     }
 
+    int minIndex = 0, maxIndex = 0;
+    bool haveRange = false;
     if (ctx->m_state->currentIndexVbo() != 0) {
         if (!has_immediate_arrays) {
             ctx->sendVertexAttributes(0, count);
             ctx->glDrawElementsOffset(ctx, mode, count, type, (GLuint)indices);
-        } else {
-            LOGE("glDrawElements: indirect index arrays, with immidate-mode data array is not supported\n");
+            return;
         }
-    } else {
+
+        //
+        // the immediate arrays are sent for the range of the indices, the
+        // indices are then read from the guest copy of the index buffer
+        // and sent with the command as if they were client side
+        //
+        GLuint offset = (GLuint)indices;
+        indices = (void *)ctx->m_state->getIndexBufferRange(type, indices, count,
+                                                            &minIndex, &maxIndex);
+        if (!indices) {
+            LOGE("glDrawElements: content of the index buffer is unknown - ignoring\n");
+            return;
+        }
+        if (minIndex == 0) {
+            // no rebasing needed, the host draws from its copy of the indices
+            ctx->sendVertexAttributes(0, maxIndex + 1);
+            ctx->glDrawElementsOffset(ctx, mode, count, type, offset);
+            return;
+        }
+        haveRange = true;
+    } else if (!has_immediate_arrays) {
+        //
+        // all the vertex arrays are buffer objects, there is no range to
+        // send and the indices go as they are
+        //
+        ctx->sendVertexAttributes(0, count);
+        ctx->glDrawElementsData(ctx, mode, count, type, indices,
+                                count * glSizeof(type));
+        return;
+    }
+
+    {
         void *adjustedIndices = indices;
-        int minIndex = 0, maxIndex = 0;
 
         switch(type) {
         case GL_BYTE:
         case GL_UNSIGNED_BYTE:
-            GLUtils::minmax<unsigned char>((unsigned char *)indices, count, &minIndex, &maxIndex);
+            if (!haveRange) {
+                GLUtils::minmax<unsigned char>((unsigned char *)indices, count, &minIndex, &maxIndex);
+            }
             if (minIndex != 0) {
                 adjustedIndices =  ctx->m_fixedBuffer.alloc(glSizeof(type) * count);
                 GLUtils::shiftIndices<unsigned char>((unsigned char *)indices,
@@ -282,7 +610,9 @@ void GL2Encoder::s_glDrawElements(void *self, GLenum mode, GLsizei count, GLenum
             break;
         case GL_SHORT:
         case GL_UNSIGNED_SHORT:
-            GLUtils::minmax<unsigned short>((unsigned short *)indices, count, &minIndex, &maxIndex);
+            if (!haveRange) {
+                GLUtils::minmax<unsigned short>((unsigned short *)indices, count, &minIndex, &maxIndex);
+            }
             if (minIndex != 0) {
                 adjustedIndices = ctx->m_fixedBuffer.alloc(glSizeof(type) * count);
                 GLUtils::shiftIndices<unsigned short>((unsigned short *)indices,
@@ -293,18 +623,16 @@ void GL2Encoder::s_glDrawElements(void *self, GLenum mode, GLsizei count, GLenum
         default:
             LOGE("unsupported index buffer type %d\n", type);
         }
-        if (has_indirect_arrays || 1) {
-            ctx->sendVertexAttributes(minIndex, maxIndex - minIndex + 1);
-            ctx->glDrawElementsData(ctx, mode, count, type, adjustedIndices,
-                                    count * glSizeof(type));
-            // XXX - OPTIMIZATION (see the other else branch) should be implemented
-            if(!has_indirect_arrays) {
-                LOGD("unoptimized drawelements !!!\n");
-            }
-        } else {
-            // we are all direct arrays and immidate mode index array -
-            // rebuild the arrays and the index array;
-            LOGE("glDrawElements: direct index & direct buffer data - will be implemented in later versions;\n");
+        ctx->sendVertexAttributes(minIndex, maxIndex - minIndex + 1);
+        if (haveRange) {
+            // the host would read the indices from the bound buffer
+            ctx->m_glBindBuffer_enc(self, GL_ELEMENT_ARRAY_BUFFER, 0);
+        }
+        ctx->glDrawElementsData(ctx, mode, count, type, adjustedIndices,
+                                count * glSizeof(type));
+        if (haveRange) {
+            ctx->m_glBindBuffer_enc(self, GL_ELEMENT_ARRAY_BUFFER,
+                                    ctx->m_state->currentIndexVbo());
         }
     }
 }
@@ -335,3 +663,406 @@ void GL2Encoder::s_glShaderSource(void *self, GLuint shader, GLsizei count, GLst
     ctx->glShaderString(ctx, shader, str, len + 1);
     delete str;
 }
+
+void GL2Encoder::s_glLinkProgram(void *self, GLuint program)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    ctx->m_glLinkProgram_enc(self, program);
+    // the locations may change, they are fetched again when next asked for,
+    // and linking resets the uniform values
+    ctx->m_programLocations.remove(program);
+    ctx->m_uniformShadow.remove(program);
+}
+
+void GL2Encoder::s_glDeleteProgram(void *self, GLuint program)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    ctx->m_glDeleteProgram_enc(self, program);
+    ctx->m_programLocations.remove(program);
+    ctx->m_uniformShadow.remove(program);
+    if (ctx->m_guestNames) {
+        sShaderNames.release(1, &program);
+    }
+}
+
+//
+// guest named objects, the glGen*Guest calls only tell the host about the
+// names, which it creates the objects of as glGen* would have
+//
+void GL2Encoder::s_glGenBuffers(void *self, GLsizei n, GLuint *buffers)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    if (allocNames(&sBufferNames, n, buffers)) {
+        if (n > 0) ctx->glGenBuffersGuest(self, n, buffers);
+        return;
+    }
+    ctx->m_glGenBuffers_enc(self, n, buffers);
+    markNames(&sBufferNames, n, buffers);
+}
+
+void GL2Encoder::s_glGenTextures(void *self, GLsizei n, GLuint *textures)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    if (allocNames(&sTextureNames, n, textures)) {
+        if (n > 0) ctx->glGenTexturesGuest(self, n, textures);
+        return;
+    }
+    ctx->m_glGenTextures_enc(self, n, textures);
+    markNames(&sTextureNames, n, textures);
+}
+
+void GL2Encoder::s_glGenFramebuffers(void *self, GLsizei n, GLuint *framebuffers)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    if (allocNames(&sFramebufferNames, n, framebuffers)) {
+        if (n > 0) ctx->glGenFramebuffersGuest(self, n, framebuffers);
+        return;
+    }
+    ctx->m_glGenFramebuffers_enc(self, n, framebuffers);
+    markNames(&sFramebufferNames, n, framebuffers);
+}
+
+void GL2Encoder::s_glGenRenderbuffers(void *self, GLsizei n, GLuint *renderbuffers)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    if (allocNames(&sRenderbufferNames, n, renderbuffers)) {
+        if (n > 0) ctx->glGenRenderbuffersGuest(self, n, renderbuffers);
+        return;
+    }
+    ctx->m_glGenRenderbuffers_enc(self, n, renderbuffers);
+    markNames(&sRenderbufferNames, n, renderbuffers);
+}
+
+GLuint GL2Encoder::s_glCreateShader(void *self, GLenum type)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    GLuint shader;
+    // an invalid type is left to the host to report
+    if ((type == GL_VERTEX_SHADER || type == GL_FRAGMENT_SHADER) &&
+        sShaderNames.alloc(1, &shader)) {
+        ctx->glCreateShaderGuest(self, type, shader);
+        return shader;
+    }
+    shader = ctx->m_glCreateShader_enc(self, type);
+    sShaderNames.markUsed(shader);
+    return shader;
+}
+
+GLuint GL2Encoder::s_glCreateProgram(void *self)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    GLuint program;
+    if (sShaderNames.alloc(1, &program)) {
+        ctx->glCreateProgramGuest(self, program);
+        return program;
+    }
+    program = ctx->m_glCreateProgram_enc(self);
+    sShaderNames.markUsed(program);
+    return program;
+}
+
+void GL2Encoder::s_glDeleteTextures(void *self, GLsizei n, GLuint *textures)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    ctx->m_glDeleteTextures_enc(self, n, textures);
+    if (n > 0) sTextureNames.release(n, textures);
+}
+
+void GL2Encoder::s_glDeleteFramebuffers(void *self, GLsizei n, GLuint *framebuffers)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    ctx->m_glDeleteFramebuffers_enc(self, n, framebuffers);
+    if (n > 0) sFramebufferNames.release(n, framebuffers);
+}
+
+void GL2Encoder::s_glDeleteRenderbuffers(void *self, GLsizei n, GLuint *renderbuffers)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    ctx->m_glDeleteRenderbuffers_enc(self, n, renderbuffers);
+    if (n > 0) sRenderbufferNames.release(n, renderbuffers);
+}
+
+void GL2Encoder::s_glDeleteShader(void *self, GLuint shader)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    ctx->m_glDeleteShader_enc(self, shader);
+    sShaderNames.release(1, &shader);
+}
+
+// names bound without being generated are taken from then on
+void GL2Encoder::s_glBindTexture(void *self, GLenum target, GLuint texture)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    sTextureNames.markUsed(texture);
+    ctx->m_glBindTexture_enc(self, target, texture);
+}
+
+void GL2Encoder::s_glBindFramebuffer(void *self, GLenum target, GLuint framebuffer)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    sFramebufferNames.markUsed(framebuffer);
+    ctx->m_glBindFramebuffer_enc(self, target, framebuffer);
+}
+
+void GL2Encoder::s_glBindRenderbuffer(void *self, GLenum target, GLuint renderbuffer)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    sRenderbufferNames.markUsed(renderbuffer);
+    ctx->m_glBindRenderbuffer_enc(self, target, renderbuffer);
+}
+
+//
+// fetches the locations of all the active attributes and uniforms of
+// 'program' in one round trip, instead of one per glGet*Location
+//
+void GL2Encoder::fetchProgramLocations(GLuint program)
+{
+    GLsizei bufsize = 2048;
+    GLint *table = (GLint *)malloc(bufsize);
+    if (table == NULL) return;
+
+    this->glGetProgramLocations(this, program, bufsize, table);
+    if (table[0] > bufsize) {
+        // rare, large programs need a second request
+        bufsize = table[0];
+        GLint *larger = (GLint *)realloc(table, bufsize);
+        if (larger == NULL) {
+            free(table);
+            return;
+        }
+        table = larger;
+        this->glGetProgramLocations(this, program, bufsize, table);
+        if (table[0] > bufsize) {
+            // relinked by another context in between, try again next time
+            free(table);
+            return;
+        }
+    }
+    m_programLocations.setTable(program, table);
+}
+
+GLint GL2Encoder::getLocation(GLuint program, int kind, GLchar *name)
+{
+    if (!m_programLocations.hasTable(program)) {
+        fetchProgramLocations(program);
+    }
+
+    GLint location;
+    if (m_programLocations.get(program, kind, name, &location)) {
+        return location;
+    }
+
+    // not linked, or a name the table cannot answer
+    if (kind == GL_PROGRAM_LOCATION_ATTRIB) {
+        location = m_glGetAttribLocation_enc(this, program, name);
+    } else {
+        location = m_glGetUniformLocation_enc(this, program, name);
+    }
+    m_programLocations.addLookup(program, kind, name, location);
+    return location;
+}
+
+int GL2Encoder::s_glGetAttribLocation(void *self, GLuint program, GLchar *name)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    return ctx->getLocation(program, GL_PROGRAM_LOCATION_ATTRIB, name);
+}
+
+int GL2Encoder::s_glGetUniformLocation(void *self, GLuint program, GLchar *name)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    return ctx->getLocation(program, GL_PROGRAM_LOCATION_UNIFORM, name);
+}
+
+void GL2Encoder::s_glUseProgram(void *self, GLuint program)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    ctx->m_glUseProgram_enc(self, program);
+    // only a program known to be linked surely becomes current, the
+    // values of any other are not shadowed
+    ctx->m_currentProgram = ctx->m_programLocations.isLinked(program) ? program : 0;
+}
+
+//
+// uniformChanged - true if a glUniform* call setting 'count' values of
+// 'type' at 'location' of the current program must be sent, false if it
+// sets the value the program already has
+//
+bool GL2Encoder::uniformChanged(GLint location, GLenum type, GLsizei count, const void *data, size_t size)
+{
+    GLuint program = m_currentProgram;
+    if (program == 0 || !m_programLocations.isLinked(program)) return true;
+
+    if (count != 1) {
+        // array elements have their own locations, do not follow them
+        m_uniformShadow.invalidate(program);
+        return true;
+    }
+    return m_uniformShadow.update(program, location, type, data, size);
+}
+
+void GL2Encoder::s_glUniform1f(void *self, GLint location, GLfloat x)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    GLfloat v[1] = { x };
+    if (ctx->uniformChanged(location, GL_FLOAT, 1, v, sizeof(v))) {
+        ctx->m_glUniform1f_enc(self, location, x);
+    }
+}
+
+void GL2Encoder::s_glUniform1fv(void *self, GLint location, GLsizei count, GLfloat *v)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    if (ctx->uniformChanged(location, GL_FLOAT, count, v, 1 * sizeof(GLfloat))) {
+        ctx->m_glUniform1fv_enc(self, location, count, v);
+    }
+}
+
+void GL2Encoder::s_glUniform1i(void *self, GLint location, GLint x)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    GLint v[1] = { x };
+    if (ctx->uniformChanged(location, GL_INT, 1, v, sizeof(v))) {
+        ctx->m_glUniform1i_enc(self, location, x);
+    }
+}
+
+void GL2Encoder::s_glUniform1iv(void *self, GLint location, GLsizei count, GLint *v)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    if (ctx->uniformChanged(location, GL_INT, count, v, 1 * sizeof(GLint))) {
+        ctx->m_glUniform1iv_enc(self, location, count, v);
+    }
+}
+
+void GL2Encoder::s_glUniform2f(void *self, GLint location, GLfloat x, GLfloat y)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    GLfloat v[2] = { x, y };
+    if (ctx->uniformChanged(location, GL_FLOAT_VEC2, 1, v, sizeof(v))) {
+        ctx->m_glUniform2f_enc(self, location, x, y);
+    }
+}
+
+void GL2Encoder::s_glUniform2fv(void *self, GLint location, GLsizei count, GLfloat *v)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    if (ctx->uniformChanged(location, GL_FLOAT_VEC2, count, v, 2 * sizeof(GLfloat))) {
+        ctx->m_glUniform2fv_enc(self, location, count, v);
+    }
+}
+
+void GL2Encoder::s_glUniform2i(void *self, GLint location, GLint x, GLint y)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    GLint v[2] = { x, y };
+    if (ctx->uniformChanged(location, GL_INT_VEC2, 1, v, sizeof(v))) {
+        ctx->m_glUniform2i_enc(self, location, x, y);
+    }
+}
+
+void GL2Encoder::s_glUniform2iv(void *self, GLint location, GLsizei count, GLint *v)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    if (ctx->uniformChanged(location, GL_INT_VEC2, count, v, 2 * sizeof(GLint))) {
+        ctx->m_glUniform2iv_enc(self, location, count, v);
+    }
+}
+
+void GL2Encoder::s_glUniform3f(void *self, GLint location, GLfloat x, GLfloat y, GLfloat z)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    GLfloat v[3] = { x, y, z };
+    if (ctx->uniformChanged(location, GL_FLOAT_VEC3, 1, v, sizeof(v))) {
+        ctx->m_glUniform3f_enc(self, location, x, y, z);
+    }
+}
+
+void GL2Encoder::s_glUniform3fv(void *self, GLint location, GLsizei count, GLfloat *v)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    if (ctx->uniformChanged(location, GL_FLOAT_VEC3, count, v, 3 * sizeof(GLfloat))) {
+        ctx->m_glUniform3fv_enc(self, location, count, v);
+    }
+}
+
+void GL2Encoder::s_glUniform3i(void *self, GLint location, GLint x, GLint y, GLint z)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    GLint v[3] = { x, y, z };
+    if (ctx->uniformChanged(location, GL_INT_VEC3, 1, v, sizeof(v))) {
+        ctx->m_glUniform3i_enc(self, location, x, y, z);
+    }
+}
+
+void GL2Encoder::s_glUniform3iv(void *self, GLint location, GLsizei count, GLint *v)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    if (ctx->uniformChanged(location, GL_INT_VEC3, count, v, 3 * sizeof(GLint))) {
+        ctx->m_glUniform3iv_enc(self, location, count, v);
+    }
+}
+
+void GL2Encoder::s_glUniform4f(void *self, GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    GLfloat v[4] = { x, y, z, w };
+    if (ctx->uniformChanged(location, GL_FLOAT_VEC4, 1, v, sizeof(v))) {
+        ctx->m_glUniform4f_enc(self, location, x, y, z, w);
+    }
+}
+
+void GL2Encoder::s_glUniform4fv(void *self, GLint location, GLsizei count, GLfloat *v)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    if (ctx->uniformChanged(location, GL_FLOAT_VEC4, count, v, 4 * sizeof(GLfloat))) {
+        ctx->m_glUniform4fv_enc(self, location, count, v);
+    }
+}
+
+void GL2Encoder::s_glUniform4i(void *self, GLint location, GLint x, GLint y, GLint z, GLint w)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    GLint v[4] = { x, y, z, w };
+    if (ctx->uniformChanged(location, GL_INT_VEC4, 1, v, sizeof(v))) {
+        ctx->m_glUniform4i_enc(self, location, x, y, z, w);
+    }
+}
+
+void GL2Encoder::s_glUniform4iv(void *self, GLint location, GLsizei count, GLint *v)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    if (ctx->uniformChanged(location, GL_INT_VEC4, count, v, 4 * sizeof(GLint))) {
+        ctx->m_glUniform4iv_enc(self, location, count, v);
+    }
+}
+
+void GL2Encoder::s_glUniformMatrix2fv(void *self, GLint location, GLsizei count, GLboolean transpose, GLfloat *value)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    // transpose must be GL_FALSE, let the host report the error otherwise
+    if (transpose != GL_FALSE ||
+        ctx->uniformChanged(location, GL_FLOAT_MAT2, count, value, 4 * sizeof(GLfloat))) {
+        ctx->m_glUniformMatrix2fv_enc(self, location, count, transpose, value);
+    }
+}
+
+void GL2Encoder::s_glUniformMatrix3fv(void *self, GLint location, GLsizei count, GLboolean transpose, GLfloat *value)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    // transpose must be GL_FALSE, let the host report the error otherwise
+    if (transpose != GL_FALSE ||
+        ctx->uniformChanged(location, GL_FLOAT_MAT3, count, value, 9 * sizeof(GLfloat))) {
+        ctx->m_glUniformMatrix3fv_enc(self, location, count, transpose, value);
+    }
+}
+
+void GL2Encoder::s_glUniformMatrix4fv(void *self, GLint location, GLsizei count, GLboolean transpose, GLfloat *value)
+{
+    GL2Encoder *ctx = (GL2Encoder *)self;
+    // transpose must be GL_FALSE, let the host report the error otherwise
+    if (transpose != GL_FALSE ||
+        ctx->uniformChanged(location, GL_FLOAT_MAT4, count, value, 16 * sizeof(GLfloat))) {
+        ctx->m_glUniformMatrix4fv_enc(self, location, count, transpose, value);
+    }
+}
@@ -20,6 +20,10 @@
 #include "IOStream.h"
 #include "GLClientState.h"
 #include "FixedBuffer.h"
+#include "GLConstantCache.h"
+#include "GLProgramLocations.h"
+#include "GLUniformShadow.h"
+#include "GLNameAllocator.h"
 
 
 class GL2Encoder : public gl2_encoder_context_t {
@@ -27,6 +31,12 @@ public:
     GL2Encoder(IOStream *stream);
     virtual ~GL2Encoder();
     void setClientState(GLClientState *state) {
+        if (state != m_state) {
+            // program names belong to the context
+            m_programLocations.clear();
+            m_uniformShadow.clear();
+            m_currentProgram = 0;
+        }
         m_state = state;
     }
     const GLClientState *state() { return m_state; }
@@ -38,14 +48,88 @@ private:
 
     GLint *m_compressedTextureFormats;
     GLint m_num_compressedTextureFormats;
+    bool m_dedupVertexData;
     GLint *getCompressedTextureFormats();
 
+    GLConstantCache m_constants;
+    int getConstant(GLenum param, GLint *values);
+
     FixedBuffer m_fixedBuffer;
 
+    GLProgramLocations m_programLocations;
+    void fetchProgramLocations(GLuint program);
+    GLint getLocation(GLuint program, int kind, GLchar *name);
+
     void sendVertexAttributes(GLint first, GLsizei count);
 
+    GLenum m_error;
+    bool m_deferErrors;
+    void setError(GLenum error);
+    void collectHostError();
+
+    glGetError_client_proc_t m_glGetError_enc;
+    static GLenum s_glGetError(void *self);
+
+    glFinish_client_proc_t m_glFinish_enc;
+    static GLint s_glFinish(void *self);
+
+    glReadPixels_client_proc_t m_glReadPixels_enc;
+    static void s_glReadPixels(void *self, GLint x, GLint y, GLsizei width, GLsizei height,
+                               GLenum format, GLenum type, GLvoid *pixels);
+
+    bool m_textureCache;
+    glTexImage2D_client_proc_t m_glTexImage2D_enc;
+    static void s_glTexImage2D(void *self, GLenum target, GLint level, GLint internalformat,
+                               GLsizei width, GLsizei height, GLint border,
+                               GLenum format, GLenum type, GLvoid *pixels);
+
     glFlush_client_proc_t m_glFlush_enc;
     static void s_glFlush(void * self);
+    // the stream sequence after the last glFlush, see IOStream::idleSince
+    bool m_flushed;
+    unsigned int m_flushedSeq;
+
+    // object names picked by the guest, see GLNameAllocator.h
+    bool m_guestNames;
+
+    glGenBuffers_client_proc_t m_glGenBuffers_enc;
+    static void s_glGenBuffers(void *self, GLsizei n, GLuint *buffers);
+
+    glGenTextures_client_proc_t m_glGenTextures_enc;
+    static void s_glGenTextures(void *self, GLsizei n, GLuint *textures);
+
+    glGenFramebuffers_client_proc_t m_glGenFramebuffers_enc;
+    static void s_glGenFramebuffers(void *self, GLsizei n, GLuint *framebuffers);
+
+    glGenRenderbuffers_client_proc_t m_glGenRenderbuffers_enc;
+    static void s_glGenRenderbuffers(void *self, GLsizei n, GLuint *renderbuffers);
+
+    glCreateShader_client_proc_t m_glCreateShader_enc;
+    static GLuint s_glCreateShader(void *self, GLenum type);
+
+    glCreateProgram_client_proc_t m_glCreateProgram_enc;
+    static GLuint s_glCreateProgram(void *self);
+
+    glDeleteTextures_client_proc_t m_glDeleteTextures_enc;
+    static void s_glDeleteTextures(void *self, GLsizei n, GLuint *textures);
+
+    glDeleteFramebuffers_client_proc_t m_glDeleteFramebuffers_enc;
+    static void s_glDeleteFramebuffers(void *self, GLsizei n, GLuint *framebuffers);
+
+    glDeleteRenderbuffers_client_proc_t m_glDeleteRenderbuffers_enc;
+    static void s_glDeleteRenderbuffers(void *self, GLsizei n, GLuint *renderbuffers);
+
+    glDeleteShader_client_proc_t m_glDeleteShader_enc;
+    static void s_glDeleteShader(void *self, GLuint shader);
+
+    glBindTexture_client_proc_t m_glBindTexture_enc;
+    static void s_glBindTexture(void *self, GLenum target, GLuint texture);
+
+    glBindFramebuffer_client_proc_t m_glBindFramebuffer_enc;
+    static void s_glBindFramebuffer(void *self, GLenum target, GLuint framebuffer);
+
+    glBindRenderbuffer_client_proc_t m_glBindRenderbuffer_enc;
+    static void s_glBindRenderbuffer(void *self, GLenum target, GLuint renderbuffer);
 
     glPixelStorei_client_proc_t m_glPixelStorei_enc;
     static void s_glPixelStorei(void *self, GLenum param, GLint value);
@@ -56,6 +140,15 @@ private:
     glBindBuffer_client_proc_t m_glBindBuffer_enc;
     static void s_glBindBuffer(void *self, GLenum target, GLuint id);
 
+    glBufferData_client_proc_t m_glBufferData_enc;
+    static void s_glBufferData(void *self, GLenum target, GLsizeiptr size, GLvoid *data, GLenum usage);
+
+    glBufferSubData_client_proc_t m_glBufferSubData_enc;
+    static void s_glBufferSubData(void *self, GLenum target, GLintptr offset, GLsizeiptr size, GLvoid *data);
+
+    glDeleteBuffers_client_proc_t m_glDeleteBuffers_enc;
+    static void s_glDeleteBuffers(void *self, GLsizei n, GLuint *buffers);
+
     glDrawArrays_client_proc_t m_glDrawArrays_enc;
     static void s_glDrawArrays(void *self, GLenum mode, GLint first, GLsizei count);
 
@@ -92,5 +185,81 @@ private:
     static void s_glGetVertexAttribPointerv(void *self, GLuint index, GLenum pname, GLvoid **pointer);
 
     static void s_glShaderSource(void *self, GLuint shader, GLsizei count, GLstr *string, GLint *length);
+
+    glLinkProgram_client_proc_t m_glLinkProgram_enc;
+    static void s_glLinkProgram(void *self, GLuint program);
+
+    glDeleteProgram_client_proc_t m_glDeleteProgram_enc;
+    static void s_glDeleteProgram(void *self, GLuint program);
+
+    glGetAttribLocation_client_proc_t m_glGetAttribLocation_enc;
+    static int s_glGetAttribLocation(void *self, GLuint program, GLchar *name);
+
+    glGetUniformLocation_client_proc_t m_glGetUniformLocation_enc;
+    static int s_glGetUniformLocation(void *self, GLuint program, GLchar *name);
+
+    GLUniformShadow m_uniformShadow;
+    GLuint m_currentProgram;
+    bool uniformChanged(GLint location, GLenum type, GLsizei count, const void *data, size_t size);
+
+    glUseProgram_client_proc_t m_glUseProgram_enc;
+    static void s_glUseProgram(void *self, GLuint program);
+
+    glUniform1f_client_proc_t m_glUniform1f_enc;
+    static void s_glUniform1f(void *self, GLint location, GLfloat x);
+
+    glUniform1fv_client_proc_t m_glUniform1fv_enc;
+    static void s_glUniform1fv(void *self, GLint location, GLsizei count, GLfloat *v);
+
+    glUniform1i_client_proc_t m_glUniform1i_enc;
+    static void s_glUniform1i(void *self, GLint location, GLint x);
+
+    glUniform1iv_client_proc_t m_glUniform1iv_enc;
+    static void s_glUniform1iv(void *self, GLint location, GLsizei count, GLint *v);
+
+    glUniform2f_client_proc_t m_glUniform2f_enc;
+    static void s_glUniform2f(void *self, GLint location, GLfloat x, GLfloat y);
+
+    glUniform2fv_client_proc_t m_glUniform2fv_enc;
+    static void s_glUniform2fv(void *self, GLint location, GLsizei count, GLfloat *v);
+
+    glUniform2i_client_proc_t m_glUniform2i_enc;
+    static void s_glUniform2i(void *self, GLint location, GLint x, GLint y);
+
+    glUniform2iv_client_proc_t m_glUniform2iv_enc;
+    static void s_glUniform2iv(void *self, GLint location, GLsizei count, GLint *v);
+
+    glUniform3f_client_proc_t m_glUniform3f_enc;
+    static void s_glUniform3f(void *self, GLint location, GLfloat x, GLfloat y, GLfloat z);
+
+    glUniform3fv_client_proc_t m_glUniform3fv_enc;
+    static void s_glUniform3fv(void *self, GLint location, GLsizei count, GLfloat *v);
+
+    glUniform3i_client_proc_t m_glUniform3i_enc;
+    static void s_glUniform3i(void *self, GLint location, GLint x, GLint y, GLint z);
+
+    glUniform3iv_client_proc_t m_glUniform3iv_enc;
+    static void s_glUniform3iv(void *self, GLint location, GLsizei count, GLint *v);
+
+    glUniform4f_client_proc_t m_glUniform4f_enc;
+    static void s_glUniform4f(void *self, GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w);
+
+    glUniform4fv_client_proc_t m_glUniform4fv_enc;
+    static void s_glUniform4fv(void *self, GLint location, GLsizei count, GLfloat *v);
+
+    glUniform4i_client_proc_t m_glUniform4i_enc;
+    static void s_glUniform4i(void *self, GLint location, GLint x, GLint y, GLint z, GLint w);
+
+    glUniform4iv_client_proc_t m_glUniform4iv_enc;
+    static void s_glUniform4iv(void *self, GLint location, GLsizei count, GLint *v);
+
+    glUniformMatrix2fv_client_proc_t m_glUniformMatrix2fv_enc;
+    static void s_glUniformMatrix2fv(void *self, GLint location, GLsizei count, GLboolean transpose, GLfloat *value);
+
+    glUniformMatrix3fv_client_proc_t m_glUniformMatrix3fv_enc;
+    static void s_glUniformMatrix3fv(void *self, GLint location, GLsizei count, GLboolean transpose, GLfloat *value);
+
+    glUniformMatrix4fv_client_proc_t m_glUniformMatrix4fv_enc;
+    static void s_glUniformMatrix4fv(void *self, GLint location, GLsizei count, GLboolean transpose, GLfloat *value);
 };
 #endif
@@ -18,18 +18,67 @@
 #include "QemuPipeStream.h"
 #include "ThreadInfo.h"
 #include <cutils/log.h>
+#include <cutils/properties.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 
-#define STREAM_BUFFER_SIZE  4*1024*1024
+//
+// the command buffer of a connection starts small and grows up to the
+// maximum size as needed, it shrinks back when it is underused for the
+// shrink period. qemu.gles.stream_min_kb, qemu.gles.stream_max_kb and
+// qemu.gles.stream_shrink_ms override the defaults.
+//
+#define STREAM_BUFFER_MIN_SIZE  64*1024
+#define STREAM_BUFFER_MAX_SIZE  4*1024*1024
+#define STREAM_SHRINK_MS        5000
 #define STREAM_PORT_NUM     4141
 
 /* Set to 1 to use a QEMU pipe, or 0 for a TCP connection */
 #define  USE_QEMU_PIPE  1
 
+/* Set to 1 to ask for a compressed stream on a TCP connection, which
+ * pays off when the renderer runs on another machine. */
+#define  USE_TCP_COMPRESSION  0
+
+// number of idle connections kept for later threads
+#define CONNECTION_POOL_MAX     4
+
+// first host renderer version which decodes compact packets
+#define COMPACT_PACKETS_RENDERER_VERSION    7
+
+// first host renderer version with the rc*Async create commands, and the
+// number of handles reserved at once for them
+#define ASYNC_CREATE_RENDERER_VERSION       8
+#define HANDLE_RESERVE_COUNT                16
+
+//
+// the host caps are published by the first process allowed to set that
+// property, surfaceflinger which opens the framebuffer at boot runs as
+// the system user which may only set the "sys." properties. The value
+// is the format version followed by the HostCaps fields.
+//
+#define HOST_CAPS_PROPERTY      "sys.qemu.gles.host_caps"
+#define HOST_CAPS_FORMAT        1
+
+// host caps of the process, loaded once under s_capsLock
+static pthread_mutex_t s_capsLock = PTHREAD_MUTEX_INITIALIZER;
+static HostCaps s_hostCaps;
+static bool s_hostCapsValid = false;
+
+static pthread_mutex_t s_poolLock = PTHREAD_MUTEX_INITIALIZER;
+static HostConnection *s_pool[CONNECTION_POOL_MAX];
+static int s_poolCount = 0;
+
 HostConnection::HostConnection() :
     m_stream(NULL),
     m_glEnc(NULL),
-    m_rcEnc(NULL)
+    m_rcEnc(NULL),
+    m_asyncCreate(-1)
 {
+    memset(m_handleNext, 0, sizeof(m_handleNext));
+    memset(m_handleEnd, 0, sizeof(m_handleEnd));
 }
 
 HostConnection::~HostConnection()
@@ -50,14 +99,28 @@ HostConnection *HostConnection::get()
         return NULL;
     }
 
+    if (tinfo->hostConn == NULL) {
+        tinfo->hostConn = takeIdle();
+    }
+
     if (tinfo->hostConn == NULL) {
         HostConnection *con = new HostConnection();
         if (NULL == con) {
             return NULL;
         }
 
+        char sizeProp[PROPERTY_VALUE_MAX];
+        property_get("qemu.gles.stream_min_kb", sizeProp, "0");
+        size_t minSize = atoi(sizeProp) > 0 ? atoi(sizeProp) * 1024 :
+                                               STREAM_BUFFER_MIN_SIZE;
+        property_get("qemu.gles.stream_max_kb", sizeProp, "0");
+        size_t maxSize = atoi(sizeProp) > 0 ? atoi(sizeProp) * 1024 :
+                                               STREAM_BUFFER_MAX_SIZE;
+        property_get("qemu.gles.stream_shrink_ms", sizeProp, "0");
+        int shrinkMS = atoi(sizeProp) > 0 ? atoi(sizeProp) : STREAM_SHRINK_MS;
+
         if (useQemuPipe) {
-            QemuPipeStream *stream = new QemuPipeStream(STREAM_BUFFER_SIZE);
+            QemuPipeStream *stream = new QemuPipeStream(minSize);
             if (!stream) {
                 LOGE("Failed to create QemuPipeStream for host connection!!!\n");
                 delete con;
@@ -69,10 +132,22 @@ HostConnection *HostConnection::get()
                 return NULL;
             }
             con->m_stream = stream;
+
+            //
+            // qemu.gles.async_submit is the number of command buffers the
+            // encoder rotates through while a thread writes them to the
+            // pipe, 0 (the default) keeps the submission synchronous.
+            //
+            char prop[PROPERTY_VALUE_MAX];
+            property_get("qemu.gles.async_submit", prop, "0");
+            int buffers = atoi(prop);
+            if (buffers > 1 && !stream->enableAsyncSubmit(buffers)) {
+                LOGW("Failed to start the command submission thread\n");
+            }
         }
         else /* !useQemuPipe */
         {
-            TcpStream *stream = new TcpStream(STREAM_BUFFER_SIZE);
+            TcpStream *stream = new TcpStream(minSize);
             if (!stream) {
                 LOGE("Failed to create TcpStream for host connection!!!\n");
                 delete con;
@@ -84,8 +159,26 @@ HostConnection *HostConnection::get()
                 delete con;
                 return NULL;
             }
+            if (USE_TCP_COMPRESSION && !stream->requestCompression()) {
+                LOGD("Host declined stream compression\n");
+            }
             con->m_stream = stream;
         }
+        con->m_stream->setAdaptiveBuffer(maxSize, shrinkMS);
+
+        //
+        // the small commands go in compact packets when the host decodes
+        // them, unless qemu.gles.compact_packets is set to 0.
+        //
+        char compactProp[PROPERTY_VALUE_MAX];
+        property_get("qemu.gles.compact_packets", compactProp, "1");
+        if (atoi(compactProp) != 0) {
+            const HostCaps *caps = loadHostCaps(con);
+            if (caps &&
+                caps->rendererVersion >= COMPACT_PACKETS_RENDERER_VERSION) {
+                con->m_stream->setCompactPackets(true);
+            }
+        }
         LOGD("Host Connection established \n");
         tinfo->hostConn = con;
     }
@@ -93,6 +186,154 @@ HostConnection *HostConnection::get()
     return tinfo->hostConn;
 }
 
+uint32_t HostConnection::allocHandle(int type)
+{
+    if (type < RC_HANDLE_COLOR_BUFFER || type > RC_HANDLE_WINDOW_SURFACE) {
+        return 0;
+    }
+
+    //
+    // the objects are created without waiting for the host when it
+    // supports it, unless qemu.gles.async_create is set to 0.
+    //
+    if (m_asyncCreate < 0) {
+        char prop[PROPERTY_VALUE_MAX];
+        property_get("qemu.gles.async_create", prop, "1");
+        const HostCaps *caps = atoi(prop) != 0 ? loadHostCaps(this) : NULL;
+        m_asyncCreate = caps &&
+            caps->rendererVersion >= ASYNC_CREATE_RENDERER_VERSION;
+    }
+    renderControl_encoder_context_t *rcEnc = m_asyncCreate ? rcEncoder() : NULL;
+    if (!rcEnc) {
+        return 0;
+    }
+
+    int i = type - RC_HANDLE_COLOR_BUFFER;
+    if (m_handleNext[i] == m_handleEnd[i]) {
+        uint32_t first = rcEnc->rcReserveHandles(rcEnc, type, HANDLE_RESERVE_COUNT);
+        if (!first) {
+            return 0;
+        }
+        m_handleNext[i] = first;
+        m_handleEnd[i] = first + HANDLE_RESERVE_COUNT;
+    }
+    return m_handleNext[i]++;
+}
+
+const HostCaps *HostConnection::getHostCaps()
+{
+    pthread_mutex_lock(&s_capsLock);
+    bool valid = s_hostCapsValid;
+    pthread_mutex_unlock(&s_capsLock);
+    if (valid) {
+        return &s_hostCaps;
+    }
+    return loadHostCaps(NULL);
+}
+
+//
+// loadHostCaps - loads the host caps from the property, or queries them
+//     through 'con' (the connection of the thread if NULL) and publishes
+//     them. The property cannot be set from the app processes, they then
+//     query them once each.
+//
+const HostCaps *HostConnection::loadHostCaps(HostConnection *con)
+{
+    pthread_mutex_lock(&s_capsLock);
+    if (s_hostCapsValid) {
+        pthread_mutex_unlock(&s_capsLock);
+        return &s_hostCaps;
+    }
+
+    HostCaps caps;
+    int format = 0;
+    char prop[PROPERTY_VALUE_MAX];
+    property_get(HOST_CAPS_PROPERTY, prop, "");
+    if (sscanf(prop, "%d %d %d %d %d %d %d %d %d", &format,
+               &caps.rendererVersion, &caps.fbWidth, &caps.fbHeight,
+               &caps.fbXdpi, &caps.fbYdpi, &caps.fbFps,
+               &caps.fbMinSwapInterval, &caps.fbMaxSwapInterval) == 9 &&
+        format == HOST_CAPS_FORMAT) {
+        s_hostCaps = caps;
+        s_hostCapsValid = true;
+        pthread_mutex_unlock(&s_capsLock);
+        return &s_hostCaps;
+    }
+    pthread_mutex_unlock(&s_capsLock);
+
+    // not published yet, ask the host without holding the lock
+    if (!con) {
+        con = get();
+        if (!con) {
+            return NULL;
+        }
+    }
+    renderControl_encoder_context_t *rcEnc = con->rcEncoder();
+    if (!rcEnc) {
+        return NULL;
+    }
+    caps.rendererVersion = rcEnc->rcGetRendererVersion(rcEnc);
+    caps.fbWidth = rcEnc->rcGetFBParam(rcEnc, FB_WIDTH);
+    caps.fbHeight = rcEnc->rcGetFBParam(rcEnc, FB_HEIGHT);
+    caps.fbXdpi = rcEnc->rcGetFBParam(rcEnc, FB_XDPI);
+    caps.fbYdpi = rcEnc->rcGetFBParam(rcEnc, FB_YDPI);
+    caps.fbFps = rcEnc->rcGetFBParam(rcEnc, FB_FPS);
+    caps.fbMinSwapInterval = rcEnc->rcGetFBParam(rcEnc, FB_MIN_SWAP_INTERVAL);
+    caps.fbMaxSwapInterval = rcEnc->rcGetFBParam(rcEnc, FB_MAX_SWAP_INTERVAL);
+
+    snprintf(prop, sizeof(prop), "%d %d %d %d %d %d %d %d %d",
+             HOST_CAPS_FORMAT, caps.rendererVersion,
+             caps.fbWidth, caps.fbHeight, caps.fbXdpi, caps.fbYdpi,
+             caps.fbFps, caps.fbMinSwapInterval, caps.fbMaxSwapInterval);
+    if (property_set(HOST_CAPS_PROPERTY, prop) < 0) {
+        LOGD("Host caps not published (%s)\n", prop);
+    }
+
+    pthread_mutex_lock(&s_capsLock);
+    s_hostCaps = caps;
+    s_hostCapsValid = true;
+    pthread_mutex_unlock(&s_capsLock);
+    return &s_hostCaps;
+}
+
+HostConnection *HostConnection::takeIdle()
+{
+    HostConnection *con = NULL;
+
+    pthread_mutex_lock(&s_poolLock);
+    if (s_poolCount > 0) {
+        con = s_pool[--s_poolCount];
+    }
+    pthread_mutex_unlock(&s_poolLock);
+    return con;
+}
+
+void HostConnection::recycle(HostConnection *con)
+{
+    if (!con) {
+        return;
+    }
+
+    //
+    // the client state belonged to a context of the exiting thread,
+    // the next one sets its own when it makes a context current.
+    //
+    if (con->m_glEnc) {
+        con->m_glEnc->setClientState(NULL);
+    }
+    con->flush();
+    con->m_stream->trimBuffers();
+
+    pthread_mutex_lock(&s_poolLock);
+    if (s_poolCount < CONNECTION_POOL_MAX) {
+        s_pool[s_poolCount++] = con;
+        con = NULL;
+    }
+    pthread_mutex_unlock(&s_poolLock);
+
+    delete con;
+}
+
 GLEncoder *HostConnection::glEncoder()
 {
     if (!m_glEnc) {
@@ -20,12 +20,47 @@
 #include "GLEncoder.h"
 #include "renderControl_enc.h"
 
+//
+// HostCaps - what the host renderer reports which does not change for
+//     the whole boot: its version and the framebuffer parameters
+//     (rcGetRendererVersion and rcGetFBParam).
+//
+struct HostCaps
+{
+    int rendererVersion;
+    int fbWidth;
+    int fbHeight;
+    int fbXdpi;
+    int fbYdpi;
+    int fbFps;
+    int fbMinSwapInterval;
+    int fbMaxSwapInterval;
+};
+
 class HostConnection
 {
 public:
     static HostConnection *get();
     ~HostConnection();
 
+    //
+    // getHostCaps - the host caps, queried from the host by the first
+    //     process which needs them and published system wide in the
+    //     HOST_CAPS_PROPERTY property, so that the later processes do not
+    //     query them again. Returns NULL if they are not published yet and
+    //     the host cannot be reached.
+    //
+    static const HostCaps *getHostCaps();
+
+    //
+    // recycle - called when the thread owning 'con' exits. The connection
+    //     is kept in a process-wide pool of idle connections, with its
+    //     stream buffers released, and handed to the next thread which
+    //     needs one instead of connecting again. It is deleted if the pool
+    //     is full.
+    //
+    static void recycle(HostConnection *con);
+
     GLEncoder *glEncoder();
     renderControl_encoder_context_t *rcEncoder();
 
@@ -35,14 +70,42 @@ public:
         }
     }
 
+    //
+    // waitFrameCredits - waits until at most 'p_maxPending' of the frame
+    //     credits asked with rcFrameCredit are still to come. Returns false
+    //     if the connection failed.
+    //
+    bool waitFrameCredits(int p_maxPending) {
+        while (m_stream && m_stream->deferredReplies() > p_maxPending) {
+            if (!m_stream->takeDeferredReply()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //
+    // allocHandle - a handle for a new object of 'type' (RC_HANDLE_*) for
+    //     its rc*Async create command, taken from the range reserved for
+    //     the connection, reserving another one once it is used up.
+    //     Returns 0 if the host does not support it, the object is then
+    //     created synchronously.
+    //
+    uint32_t allocHandle(int type);
+
 private:
     HostConnection();
     static gl_client_context_t *s_getGLContext();
+    static HostConnection *takeIdle();
+    static const HostCaps *loadHostCaps(HostConnection *con);
 
 private:
     IOStream *m_stream;
     GLEncoder *m_glEnc;
     renderControl_encoder_context_t *m_rcEnc;
+    int m_asyncCreate;  // -1 until the first allocHandle
+    uint32_t m_handleNext[3];
+    uint32_t m_handleEnd[3];
 };
 
 #endif
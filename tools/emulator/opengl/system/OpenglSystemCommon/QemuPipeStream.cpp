@@ -20,12 +20,24 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <sys/uio.h>
+
+// small reads are served from a buffer filled with reads of that size
+#define READ_AHEAD_SIZE 16384
 
 QemuPipeStream::QemuPipeStream(size_t bufSize) :
     IOStream(bufSize),
     m_sock(-1),
     m_bufsize(bufSize),
-    m_buf(NULL)
+    m_buf(NULL),
+    m_readBuf(NULL),
+    m_readPos(0),
+    m_readValid(0),
+    m_submitCount(0),
+    m_submitHead(0),
+    m_submitQueued(0),
+    m_submitError(0),
+    m_submitExit(false)
 {
 }
 
@@ -33,18 +45,41 @@ QemuPipeStream::QemuPipeStream(int sock, size_t bufSize) :
     IOStream(bufSize),
     m_sock(sock),
     m_bufsize(bufSize),
-    m_buf(NULL)
+    m_buf(NULL),
+    m_readBuf(NULL),
+    m_readPos(0),
+    m_readValid(0),
+    m_submitCount(0),
+    m_submitHead(0),
+    m_submitQueued(0),
+    m_submitError(0),
+    m_submitExit(false)
 {
 }
 
 QemuPipeStream::~QemuPipeStream()
 {
+    if (m_submitCount > 0) {
+        // the buffers still queued go out before the pipe is closed
+        pthread_mutex_lock(&m_submitLock);
+        m_submitExit = true;
+        pthread_cond_broadcast(&m_submitCond);
+        pthread_mutex_unlock(&m_submitLock);
+        pthread_join(m_submitThread, NULL);
+        pthread_cond_destroy(&m_submitCond);
+        pthread_mutex_destroy(&m_submitLock);
+        for (int i = 0; i < m_submitCount; i++) {
+            free(m_submit[i].data);
+        }
+        m_buf = NULL;
+    }
     if (m_sock >= 0) {
         ::close(m_sock);
     }
     if (m_buf != NULL) {
         free(m_buf);
     }
+    free(m_readBuf);
 }
 
 
@@ -55,21 +90,128 @@ int QemuPipeStream::connect(void)
     return 0;
 }
 
+bool QemuPipeStream::enableAsyncSubmit(int p_buffers)
+{
+    if (!valid() || m_submitCount > 0 || p_buffers < 2) {
+        return false;
+    }
+    if (p_buffers > QEMU_PIPE_MAX_SUBMIT_BUFFERS) {
+        p_buffers = QEMU_PIPE_MAX_SUBMIT_BUFFERS;
+    }
+
+    // nothing may be staged, the first buffer takes the place of m_buf
+    if (flush() < 0) {
+        return false;
+    }
+
+    pthread_mutex_init(&m_submitLock, NULL);
+    pthread_cond_init(&m_submitCond, NULL);
+    if (pthread_create(&m_submitThread, NULL, s_submitThreadMain, this) != 0) {
+        pthread_cond_destroy(&m_submitCond);
+        pthread_mutex_destroy(&m_submitLock);
+        return false;
+    }
+
+    memset(m_submit, 0, sizeof(m_submit));
+    m_submit[0].data = m_buf;
+    m_submit[0].size = m_buf ? m_bufsize : 0;
+    m_submitHead = 0;
+    m_submitQueued = 0;
+    pthread_mutex_lock(&m_submitLock);
+    m_submitCount = p_buffers;
+    pthread_mutex_unlock(&m_submitLock);
+    return true;
+}
+
+void *QemuPipeStream::s_submitThreadMain(void *param)
+{
+    ((QemuPipeStream *)param)->submitThreadMain();
+    return NULL;
+}
+
+void QemuPipeStream::submitThreadMain()
+{
+    pthread_mutex_lock(&m_submitLock);
+    while (true) {
+        while (m_submitQueued == 0 && !m_submitExit) {
+            pthread_cond_wait(&m_submitCond, &m_submitLock);
+        }
+        if (m_submitQueued == 0) {
+            break;
+        }
+
+        // the queued buffer is left alone by the encoding thread
+        SubmitBuffer *b = &m_submit[m_submitHead];
+        pthread_mutex_unlock(&m_submitLock);
+        int stat = m_submitError ? 0 : writeRaw(b->data, b->len);
+        pthread_mutex_lock(&m_submitLock);
+
+        if (stat < 0 && !m_submitError) {
+            m_submitError = stat;
+        }
+        m_submitHead = (m_submitHead + 1) % m_submitCount;
+        m_submitQueued--;
+        pthread_cond_broadcast(&m_submitCond);
+    }
+    pthread_mutex_unlock(&m_submitLock);
+}
+
+//
+// drainSubmit - waits for the queued buffers to be written, returns the
+//     error of a failed write.
+//
+int QemuPipeStream::drainSubmit()
+{
+    if (m_submitCount == 0) {
+        return 0;
+    }
+    pthread_mutex_lock(&m_submitLock);
+    while (m_submitQueued > 0) {
+        pthread_cond_wait(&m_submitCond, &m_submitLock);
+    }
+    int err = m_submitError;
+    pthread_mutex_unlock(&m_submitLock);
+    return err;
+}
+
 void *QemuPipeStream::allocBuffer(size_t minSize)
 {
-    size_t allocSize = (m_bufsize < minSize ? minSize : m_bufsize);
+    if (m_submitCount > 0) {
+        // the buffer after the queued ones is not in flight
+        SubmitBuffer *b = &m_submit[(m_submitHead + m_submitQueued) % m_submitCount];
+        size_t allocSize = minSize;
+        if (b->data && (b->size < allocSize || b->size / 2 >= allocSize)) {
+            free(b->data);
+            b->data = NULL;
+        }
+        if (!b->data) {
+            b->data = (unsigned char *)malloc(allocSize);
+            b->size = b->data ? allocSize : 0;
+            if (!b->data) {
+                ERR("malloc (%d) failed\n", allocSize);
+            }
+        }
+        m_buf = b->data;
+        return m_buf;
+    }
+
+    size_t allocSize = minSize;
+    if (m_buf && (m_bufsize < allocSize || m_bufsize / 2 >= allocSize)) {
+        //
+        // IOStream only asks for a buffer once everything staged in the
+        // previous one was committed, do not copy it over. Large replies
+        // such as glReadPixels pixels grow the buffer this way, and an
+        // adaptive buffer (IOStream::setAdaptiveBuffer) shrinks back.
+        //
+        free(m_buf);
+        m_buf = NULL;
+    }
     if (!m_buf) {
         m_buf = (unsigned char *)malloc(allocSize);
-    }
-    else if (m_bufsize < allocSize) {
-        unsigned char *p = (unsigned char *)realloc(m_buf, allocSize);
-        if (p != NULL) {
-            m_buf = p;
+        if (m_buf != NULL) {
             m_bufsize = allocSize;
         } else {
-            ERR("realloc (%d) failed\n", allocSize);
-            free(m_buf);
-            m_buf = NULL;
+            ERR("malloc (%d) failed\n", allocSize);
             m_bufsize = 0;
         }
     }
@@ -77,12 +219,109 @@ void *QemuPipeStream::allocBuffer(size_t minSize)
     return m_buf;
 };
 
+void QemuPipeStream::trimBuffers()
+{
+    if (m_submitCount > 0) {
+        drainSubmit();
+        for (int i = 0; i < m_submitCount; i++) {
+            free(m_submit[i].data);
+            m_submit[i].data = NULL;
+            m_submit[i].size = 0;
+        }
+    }
+    else {
+        free(m_buf);
+    }
+    m_buf = NULL;
+    // keep data read ahead, if any, it belongs to the next reply
+    if (m_readValid == 0) {
+        free(m_readBuf);
+        m_readBuf = NULL;
+        m_readPos = m_readValid = 0;
+    }
+}
+
 int QemuPipeStream::commitBuffer(size_t size)
 {
-    return writeFully(m_buf, size);
+    if (m_submitCount == 0) {
+        return writeFully(m_buf, size);
+    }
+
+    //
+    // queue the buffer for the submission thread, then wait for a free
+    // one to encode into if they are all in flight.
+    //
+    pthread_mutex_lock(&m_submitLock);
+    m_submit[(m_submitHead + m_submitQueued) % m_submitCount].len = size;
+    m_submitQueued++;
+    pthread_cond_broadcast(&m_submitCond);
+    while (m_submitQueued == m_submitCount) {
+        pthread_cond_wait(&m_submitCond, &m_submitLock);
+    }
+    int err = m_submitError;
+    pthread_mutex_unlock(&m_submitLock);
+    m_buf = NULL;
+    return err;
+}
+
+int QemuPipeStream::commitBufferv(size_t size, const void *data, size_t len)
+{
+    if (!valid()) return -1;
+
+    // the caller memory is written in order, after the queued buffers
+    int err = drainSubmit();
+    if (err < 0) return err;
+
+    struct iovec iov[2];
+    struct iovec *vec = iov;
+    int nvec = 0;
+    if (size > 0) {
+        iov[nvec].iov_base = m_buf;
+        iov[nvec].iov_len = size;
+        nvec++;
+    }
+    if (len > 0) {
+        iov[nvec].iov_base = (void *)data;
+        iov[nvec].iov_len = len;
+        nvec++;
+    }
+
+    while (nvec > 0) {
+        ssize_t stat = ::writev(m_sock, vec, nvec);
+        if (stat == 0) { /* EOF */
+            ERR("QemuPipeStream::commitBufferv failed: premature EOF\n");
+            return -1;
+        }
+        if (stat < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ERR("QemuPipeStream::commitBufferv failed: %s\n", strerror(errno));
+            return stat;
+        }
+
+        // skip over what has been written, a short write may end mid-vector
+        while (nvec > 0 && (size_t)stat >= vec->iov_len) {
+            stat -= vec->iov_len;
+            vec++;
+            nvec--;
+        }
+        if (nvec > 0) {
+            vec->iov_base = (char *)vec->iov_base + stat;
+            vec->iov_len -= stat;
+        }
+    }
+    return 0;
 }
 
 int QemuPipeStream::writeFully(const void *buf, size_t len)
+{
+    int err = drainSubmit();
+    if (err < 0) return err;
+    return writeRaw(buf, len);
+}
+
+int QemuPipeStream::writeRaw(const void *buf, size_t len)
 {
     if (!valid()) return -1;
 
@@ -114,26 +353,44 @@ const unsigned char *QemuPipeStream::readFully(void *buf, size_t len)
 {
     if (!valid()) return NULL;
     if (!buf) {
-        ERR("QemuPipeStream::readFully failed, buf=NULL");
-        return NULL;  // do not allow NULL buf in that implementation
+      ERR("QemuPipeStream::readFully failed, buf=NULL");
+      return NULL;  // do not allow NULL buf in that implementation
     }
-    size_t res = len;
+
+    // serve what we can from data read ahead previously
+    size_t res = len - readBuffered(buf, len);
+
     while (res > 0) {
-        ssize_t stat = ::read(m_sock, (char *)(buf) + len - res, len);
+        char *dst = (char *)(buf) + len - res;
+        ssize_t stat;
+        if (res >= READ_AHEAD_SIZE) {
+            // large read - no point in going through the read-ahead buffer
+            stat = readRaw(dst, res);
+        }
+        else {
+            if (!m_readBuf) {
+                m_readBuf = (unsigned char *)malloc(READ_AHEAD_SIZE);
+                if (!m_readBuf) {
+                    ERR("QemuPipeStream::readFully failed to allocate read-ahead buffer\n");
+                    return NULL;
+                }
+            }
+            stat = readRaw(m_readBuf, READ_AHEAD_SIZE);
+            if (stat > 0) {
+                m_readPos = 0;
+                m_readValid = stat;
+                stat = readBuffered(dst, res);
+            }
+        }
+
         if (stat == 0) {
             // client shutdown;
             return NULL;
         } else if (stat < 0) {
-            if (errno == EINTR) {
-                continue;
-            } else {
-                ERR("QemuPipeStream::readFully failed (buf %p): %s\n",
-                    buf, strerror(errno));
-                return NULL;
-            }
-        } else {
-            res -= stat;
+            ERR("QemuPipeStream::readFully failed (buf %p): %s\n", buf, strerror(errno));
+            return NULL;
         }
+        res -= stat;
     }
     return (const unsigned char *)buf;
 }
@@ -160,7 +417,9 @@ int QemuPipeStream::recv(void *buf, size_t len)
 {
     if (!valid()) return int(ERR_INVALID_SOCKET);
     char* p = (char *)buf;
-    int ret = 0;
+    int ret = readBuffered(buf, len);
+    p += ret;
+    len -= ret;
     while(len > 0) {
         int res = ::read(m_sock, p, len);
         if (res > 0) {
@@ -182,3 +441,30 @@ int QemuPipeStream::recv(void *buf, size_t len)
     }
     return ret;
 }
+
+//
+// readRaw - one read from the pipe, retried on EINTR.
+//
+int QemuPipeStream::readRaw(void *buf, size_t len)
+{
+    int res;
+    do {
+        res = ::read(m_sock, (char *)buf, len);
+    } while (res < 0 && errno == EINTR);
+    return res;
+}
+
+//
+// readBuffered - copy up to 'len' bytes of read-ahead data to 'buf',
+//     returns the number of bytes copied.
+//
+size_t QemuPipeStream::readBuffered(void *buf, size_t len)
+{
+    size_t n = m_readValid < len ? m_readValid : len;
+    if (n > 0) {
+        memcpy(buf, m_readBuf + m_readPos, n);
+        m_readPos += n;
+        m_readValid -= n;
+    }
+    return n;
+}
@@ -21,8 +21,12 @@
  * <hardware/qemu_pipe.h> for more details.
  */
 #include <stdlib.h>
+#include <pthread.h>
 #include "IOStream.h"
 
+// largest number of command buffers of the asynchronous submission
+#define QEMU_PIPE_MAX_SUBMIT_BUFFERS 3
+
 class QemuPipeStream : public IOStream {
 public:
     typedef enum { ERR_INVALID_SOCKET = -1000 } QemuPipeStreamError;
@@ -35,18 +39,60 @@ public:
     virtual int commitBuffer(size_t size);
     virtual const unsigned char *readFully( void *buf, size_t len);
     virtual const unsigned char *read( void *buf, size_t *inout_len);
+    virtual int writeFully(const void *buf, size_t len);
+    virtual int commitBufferv(size_t size, const void *data, size_t len);
+    virtual void trimBuffers();
 
     bool valid() { return m_sock >= 0; }
     int recv(void *buf, size_t len);
 
-private:
-    int writeFully(const void *buf, size_t len);
+    //
+    // enableAsyncSubmit - the committed command buffers are written to the
+    //     pipe by a submission thread, while the caller goes on encoding in
+    //     another of 'p_buffers' (2 to QEMU_PIPE_MAX_SUBMIT_BUFFERS)
+    //     buffers. The caller only waits when all of them are in flight.
+    //     Writes of caller memory (commitBufferv) wait for the submitted
+    //     buffers first, to keep the stream in order. Returns false if the
+    //     thread cannot be started, the stream then stays synchronous.
+    //
+    bool enableAsyncSubmit(int p_buffers);
 
 private:
+    struct SubmitBuffer {
+        unsigned char *data;
+        size_t size;
+        size_t len;     // bytes to write, while queued
+    };
+
     int m_sock;
     size_t m_bufsize;
     unsigned char *m_buf;
+    unsigned char *m_readBuf;   // read-ahead buffer
+    size_t m_readPos;
+    size_t m_readValid;
+
+    //
+    // asynchronous submission state, protected by m_submitLock. The
+    // queued buffers are m_submitQueued buffers from m_submitHead in ring
+    // order, the one after them is the buffer being encoded.
+    //
+    int m_submitCount;          // 0 if the submission is synchronous
+    SubmitBuffer m_submit[QEMU_PIPE_MAX_SUBMIT_BUFFERS];
+    int m_submitHead;
+    int m_submitQueued;
+    int m_submitError;          // first failed write, reported by commits
+    bool m_submitExit;
+    pthread_t m_submitThread;
+    pthread_mutex_t m_submitLock;
+    pthread_cond_t m_submitCond;
+
     QemuPipeStream(int sock, size_t bufSize);
+    int readRaw(void *buf, size_t len);
+    size_t readBuffered(void *buf, size_t len);
+    int writeRaw(const void *buf, size_t len);
+    int drainSubmit();
+    void submitThreadMain();
+    static void *s_submitThreadMain(void *param);
 };
 
 #endif
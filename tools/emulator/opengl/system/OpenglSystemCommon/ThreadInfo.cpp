@@ -22,7 +22,15 @@ static void tlsDestruct(void *ptr)
 {
     if (ptr) {
         EGLThreadInfo *ti = (EGLThreadInfo *)ptr;
-        delete ti->hostConn;
+        //
+        // a connection whose thread still has a context current keeps
+        // it bound on the host, it can't be handed to another thread.
+        //
+        if (ti->currentContext) {
+            delete ti->hostConn;
+        } else {
+            HostConnection::recycle(ti->hostConn);
+        }
         delete ti;
     }
 }
@@ -25,13 +25,34 @@
 #include <cutils/ashmem.h>
 #include <unistd.h>
 #include <errno.h>
+#include <stdarg.h>
 #include <sys/mman.h>
 #include "HostConnection.h"
 #include "glUtils.h"
 #include <cutils/log.h>
+#include <cutils/properties.h>
 
 #define BUFFER_HANDLE_MAGIC ((int)0xabfabfab)
 
+//
+// private perform() operations, for emulator specific clients:
+//   GRALLOC_EMULATOR_START_READ (buffer_handle_t handle)
+//       starts reading a color buffer back from the host ahead of a read
+//       lock, which then gets the pixels without waiting for the host to
+//       read them. Returns 0, or -ENOSYS if the host does not support it.
+//   GRALLOC_EMULATOR_POLL_READ (buffer_handle_t handle)
+//       returns 1 if the started read has completed, 0 if it is still in
+//       flight and -EINVAL if there is none.
+//
+#define GRALLOC_EMULATOR_START_READ  0x454d0001
+#define GRALLOC_EMULATOR_POLL_READ   0x454d0002
+
+// first renderer versions with rcStartReadColorBuffer and
+// rcFBPostWithDamage
+#define ASYNC_READ_RENDERER_VERSION 4
+#define POST_DAMAGE_RENDERER_VERSION 5
+#define FRAME_CREDIT_RENDERER_VERSION 6
+
 //
 // our private gralloc module structure
 //
@@ -39,11 +60,15 @@ struct private_module_t {
     gralloc_module_t base;
 };
 
-typedef struct _alloc_list_node {
-    buffer_handle_t handle;
-    _alloc_list_node *next;
-    _alloc_list_node *prev;
-} AllocListNode;
+//
+// slot of the allocated buffers table, a buffer keeps the index of its
+// slot in its handle so it is found without a search when freed. Free
+// slots are chained through nextFree.
+//
+typedef struct _alloc_slot {
+    buffer_handle_t handle;     // NULL if the slot is free
+    int nextFree;               // next free slot, -1 at the end of the chain
+} AllocSlot;
 
 //
 // Our gralloc device structure (alloc interface)
@@ -51,7 +76,10 @@ typedef struct _alloc_list_node {
 struct gralloc_device_t {
     alloc_device_t  device;
 
-    AllocListNode *allocListHead;    // double linked list of allocated buffers
+    AllocSlot *allocSlots;      // table of allocated buffers
+    int allocSlotsCount;        // number of entries in allocSlots
+    int allocFreeSlot;          // first free slot, -1 if the table is full
+    int allocCount;             // number of allocated buffers
     pthread_mutex_t lock;
 };
 
@@ -60,6 +88,15 @@ struct gralloc_device_t {
 //
 struct fb_device_t {
     framebuffer_device_t  device;
+
+    // rectangle of the next post set by fb_setUpdateRect, in the row
+    // order of the buffers, if updateRectSet
+    bool updateRectSet;
+    uint32_t updateRect[RC_RECT_SIZE];
+
+    // frames posted but not yet presented by the host which may be
+    // pending before a post waits, 0 if the posts are not flow controlled
+    int maxFramesInFlight;
 };
 
 #define CB_HANDLE_NUM_INTS(nfds) ((sizeof(cb_handle_t) - (nfds)*sizeof(int)) / sizeof(int))
@@ -85,7 +122,8 @@ struct cb_handle_t : public native_handle {
         lockedTop(0),
         lockedWidth(0),
         lockedHeight(0),
-        hostHandle(0)
+        hostHandle(0),
+        allocSlot(-1)
     {
         version = sizeof(native_handle);
         numFds = 1;
@@ -126,8 +164,58 @@ struct cb_handle_t : public native_handle {
     int lockedWidth;
     int lockedHeight;
     uint32_t hostHandle;
+    int allocSlot;          // slot of the buffer in the allocating device table
 };
 
+//
+// reserves a slot of the allocated buffers table for 'cb', the table
+// doubles when it is full. Must be called with the device lock held.
+//
+static bool alloc_slot_insert(gralloc_device_t *grdev, cb_handle_t *cb)
+{
+    if (grdev->allocFreeSlot < 0) {
+        int count = grdev->allocSlotsCount ? grdev->allocSlotsCount * 2 : 64;
+        AllocSlot *slots = (AllocSlot *)realloc(grdev->allocSlots,
+                                                count * sizeof(AllocSlot));
+        if (!slots) {
+            return false;
+        }
+        for (int i = grdev->allocSlotsCount; i < count; i++) {
+            slots[i].handle = NULL;
+            slots[i].nextFree = (i + 1 < count) ? i + 1 : -1;
+        }
+        grdev->allocFreeSlot = grdev->allocSlotsCount;
+        grdev->allocSlots = slots;
+        grdev->allocSlotsCount = count;
+    }
+
+    int slot = grdev->allocFreeSlot;
+    grdev->allocFreeSlot = grdev->allocSlots[slot].nextFree;
+    grdev->allocSlots[slot].handle = cb;
+    grdev->allocSlots[slot].nextFree = -1;
+    grdev->allocCount++;
+    cb->allocSlot = slot;
+    return true;
+}
+
+//
+// releases the slot of 'cb', does nothing if 'cb' was not allocated by
+// this device. Must be called with the device lock held.
+//
+static void alloc_slot_remove(gralloc_device_t *grdev, const cb_handle_t *cb)
+{
+    int slot = cb->allocSlot;
+    if (slot < 0 || slot >= grdev->allocSlotsCount ||
+        grdev->allocSlots[slot].handle != cb) {
+        return;
+    }
+
+    grdev->allocSlots[slot].handle = NULL;
+    grdev->allocSlots[slot].nextFree = grdev->allocFreeSlot;
+    grdev->allocFreeSlot = slot;
+    grdev->allocCount--;
+}
+
 static int map_buffer(cb_handle_t *cb, void **vaddr)
 {
     if (cb->fd < 0 || cb->ashmemSize <= 0) {
@@ -163,10 +251,23 @@ static int map_buffer(cb_handle_t *cb, void **vaddr)
         return -EIO; \
     }
 
+//
+// getRendererVersion - version of the host renderer, from the host caps
+//     (see HostConnection::getHostCaps), it tells which renderControl
+//     commands the host supports.
+//
+static int getRendererVersion(renderControl_encoder_context_t *rcEnc)
+{
+    const HostCaps *caps = HostConnection::getHostCaps();
+    return caps ? caps->rendererVersion : rcEnc->rcGetRendererVersion(rcEnc);
+}
 
 //
 // gralloc device functions (alloc interface)
 //
+static int gralloc_free(alloc_device_t* dev,
+                        buffer_handle_t handle);
+
 static int gralloc_alloc(alloc_device_t* dev,
                          int w, int h, int format, int usage,
                          buffer_handle_t* pHandle, int* pStride)
@@ -191,6 +292,7 @@ static int gralloc_alloc(alloc_device_t* dev,
     GLenum glFormat = 0;
 
     int bpp = 0;
+    bool yuv_format = false;
     switch (format) {
         case HAL_PIXEL_FORMAT_RGBA_8888:
         case HAL_PIXEL_FORMAT_RGBX_8888:
@@ -214,11 +316,31 @@ static int gralloc_alloc(alloc_device_t* dev,
             bpp = 2;
             glFormat = GL_RGBA4_OES;
             break;
+        case HAL_PIXEL_FORMAT_YCrCb_420_SP:
+            // bpp is the luma plane one, the chroma planes add half of it
+            bpp = 1;
+            yuv_format = true;
+            glFormat = GLUTILS_FORMAT_YCRCB_420_SP;
+            break;
+        case HAL_PIXEL_FORMAT_YV12:
+            bpp = 1;
+            yuv_format = true;
+            glFormat = GLUTILS_FORMAT_YV12;
+            break;
 
         default:
             return -EINVAL;
     }
 
+    //
+    // YUV buffers are converted to RGBA by the host when they are updated,
+    // they can only be written by s/w and read as textures.
+    //
+    if (yuv_format && ((w & 1) || (h & 1) ||
+                       (usage & (GRALLOC_USAGE_HW_RENDER | GRALLOC_USAGE_HW_FB)))) {
+        return -EINVAL;
+    }
+
     if (usage & GRALLOC_USAGE_HW_FB) {
         // keep space for postCounter
         ashmem_size += sizeof(uint32_t);
@@ -226,10 +348,22 @@ static int gralloc_alloc(alloc_device_t* dev,
 
     if (usage & (GRALLOC_USAGE_SW_READ_MASK | GRALLOC_USAGE_SW_WRITE_MASK)) {
         // keep space for image on guest memory if SW access is needed
-        int align = 1;
-        size_t bpr = (w*bpp + (align-1)) & ~(align-1);
-        ashmem_size += (bpr * h);
-        *pStride = bpr / bpp;
+        if (format == HAL_PIXEL_FORMAT_YV12) {
+            // the rows of all planes are 16 bytes aligned
+            size_t yStride = (w + 15) & ~15;
+            size_t cStride = (yStride / 2 + 15) & ~15;
+            ashmem_size += yStride * h + cStride * h;
+            *pStride = yStride;
+        }
+        else {
+            int align = 1;
+            size_t bpr = (w*bpp + (align-1)) & ~(align-1);
+            ashmem_size += (bpr * h);
+            if (yuv_format) {
+                ashmem_size += bpr * h / 2;
+            }
+            *pStride = bpr / bpp;
+        }
     }
 
     LOGD("gralloc_alloc ashmem_size=%d\n", ashmem_size);
@@ -270,7 +404,18 @@ static int gralloc_alloc(alloc_device_t* dev,
     if (usage & GRALLOC_USAGE_HW_MASK) {
         DEFINE_HOST_CONNECTION;
         if (hostCon && rcEnc) {
-            cb->hostHandle = rcEnc->rcCreateColorBuffer(rcEnc, w, h, glFormat);
+            // a failed creation shows when the color buffer is first used
+            uint32_t handle = hostCon->allocHandle(RC_HANDLE_COLOR_BUFFER);
+            if (handle) {
+                rcEnc->rcCreateColorBufferAsync(rcEnc, handle, w, h, glFormat);
+                // the buffer usually goes to another process, which must
+                // not get to the host first
+                hostCon->flush();
+                cb->hostHandle = handle;
+            }
+            else {
+                cb->hostHandle = rcEnc->rcCreateColorBuffer(rcEnc, w, h, glFormat);
+            }
             LOGD("Created host ColorBuffer 0x%x\n", cb->hostHandle);
         }
 
@@ -283,18 +428,15 @@ static int gralloc_alloc(alloc_device_t* dev,
     }
 
     //
-    // alloc succeeded - insert the allocated handle to the allocated list
+    // alloc succeeded - insert the allocated handle to the allocated table
     //
-    AllocListNode *node = new AllocListNode();
     pthread_mutex_lock(&grdev->lock);
-    node->handle = cb;
-    node->next =  grdev->allocListHead;
-    node->prev =  NULL;
-    if (grdev->allocListHead) {
-        grdev->allocListHead->prev = node;
-    }
-    grdev->allocListHead = node;
+    bool inserted = alloc_slot_insert(grdev, cb);
     pthread_mutex_unlock(&grdev->lock);
+    if (!inserted) {
+        gralloc_free(dev, cb);
+        return -ENOMEM;
+    }
 
     *pHandle = cb;
     return 0;
@@ -324,27 +466,10 @@ static int gralloc_free(alloc_device_t* dev,
         close(cb->fd);
     }
 
-    // remove it from the allocated list
+    // remove it from the allocated table
     gralloc_device_t *grdev = (gralloc_device_t *)dev;
     pthread_mutex_lock(&grdev->lock);
-    AllocListNode *n = grdev->allocListHead;
-    while( n && n->handle != cb ) {
-        n = n->next;
-    }
-    if (n) {
-       // buffer found on list - remove it from list
-       if (n->next) {
-           n->next->prev = n->prev;
-       }
-       if (n->prev) {
-           n->prev = n->next;
-       }
-       else {
-           grdev->allocListHead = n->next;
-       }
-
-       delete n;
-    }
+    alloc_slot_remove(grdev, cb);
     pthread_mutex_unlock(&grdev->lock);
 
     delete cb;
@@ -358,11 +483,14 @@ static int gralloc_device_close(struct hw_device_t *dev)
     if (d) {
 
         // free still allocated buffers
-        while( d->allocListHead != NULL ) {
-            gralloc_free(&d->device, d->allocListHead->handle);
+        for (int i = 0; i < d->allocSlotsCount && d->allocCount > 0; i++) {
+            if (d->allocSlots[i].handle != NULL) {
+                gralloc_free(&d->device, d->allocSlots[i].handle);
+            }
         }
 
         // free device
+        free(d->allocSlots);
         free(d);
     }
     return 0;
@@ -391,8 +519,36 @@ static int fb_post(struct framebuffer_device_t* dev, buffer_handle_t buffer)
     }
     (*postCountPtr)++;
 
-    // send post request to host
-    rcEnc->rcFBPost(rcEnc, cb->hostHandle);
+    //
+    // flow control: wait for the oldest frame to be presented if too many
+    // are in flight. The guest does not run more frames ahead of the host
+    // display, which bounds the input to display latency.
+    //
+    if (fbdev->maxFramesInFlight > 0 &&
+        !hostCon->waitFrameCredits(fbdev->maxFramesInFlight - 1)) {
+        return -EIO;
+    }
+
+    //
+    // send post request to host. The post is queued on the stream after
+    // the commands which rendered the buffer, and the host decodes the
+    // stream in order, so the buffer can be rendered again right away
+    // without waiting for the host. The flush is what gets the frame on
+    // the screen, nothing else may flush the stream until the next frame.
+    //
+    if (fbdev->updateRectSet) {
+        rcEnc->rcFBPostWithDamage(rcEnc, cb->hostHandle,
+                                  sizeof(fbdev->updateRect),
+                                  fbdev->updateRect);
+        fbdev->updateRectSet = false;
+    }
+    else {
+        rcEnc->rcFBPost(rcEnc, cb->hostHandle);
+    }
+    if (fbdev->maxFramesInFlight > 0) {
+        // the reply comes when the frame is presented, this flushes
+        rcEnc->rcFrameCredit(rcEnc);
+    }
     hostCon->flush();
 
     return 0;
@@ -403,16 +559,16 @@ static int fb_setUpdateRect(struct framebuffer_device_t* dev,
 {
     fb_device_t *fbdev = (fb_device_t *)dev;
 
-    if (!fbdev) {
+    if (!fbdev || w < 0 || h < 0) {
         return -EINVAL;
     }
 
-    // Make sure we have host connection
-    DEFINE_AND_VALIDATE_HOST_CONNECTION;
-
-    // send request to host
-    // XXX - should be implemented
-    //rcEnc->rc_XXX
+    // the rectangle goes with the next post
+    fbdev->updateRect[0] = l;
+    fbdev->updateRect[1] = t;
+    fbdev->updateRect[2] = w;
+    fbdev->updateRect[3] = h;
+    fbdev->updateRectSet = true;
 
     return 0;
 }
@@ -429,9 +585,9 @@ static int fb_setSwapInterval(struct framebuffer_device_t* dev,
     // Make sure we have host connection
     DEFINE_AND_VALIDATE_HOST_CONNECTION;
 
-    // send request to host
+    // send request to host, it only applies to the next posts so it
+    // goes with the next fb_post flush.
     rcEnc->rcFBSetSwapInterval(rcEnc, interval);
-    hostCon->flush();
 
     return 0;
 }
@@ -569,6 +725,31 @@ static int gralloc_lock(gralloc_module_t const* module,
             return -EBUSY;
         }
 
+        //
+        // for a read lock, the host tells whether the color buffer was
+        // rendered to since it was last read. Only then is the CPU copy
+        // stale and read back, repeated read locks of a buffer which is
+        // only written by the CPU do not transfer anything. The buffer
+        // has to be in a format glReadPixels can return.
+        //
+        // A status of 2 means the pixels are already being read back since
+        // GRALLOC_EMULATOR_START_READ, the lock only waits for the end of
+        // that read.
+        //
+        if (sw_read && hostSyncStatus > 0 &&
+            (cb->glFormat == GL_RGBA || cb->glFormat == GL_RGB)) {
+            GLuint len = ((glUtilsPixelBitSize(cb->glFormat, GL_UNSIGNED_BYTE) *
+                           cb->width) >> 3) * cb->height;
+            if (hostSyncStatus != 2 ||
+                rcEnc->rcFinishReadColorBuffer(rcEnc, cb->hostHandle,
+                                               1, len, cpu_addr) != 1) {
+                rcEnc->rcReadColorBuffer(rcEnc, cb->hostHandle,
+                                         0, 0, cb->width, cb->height,
+                                         cb->glFormat, GL_UNSIGNED_BYTE,
+                                         cpu_addr);
+            }
+        }
+
         //
         // is virtual address required ?
         //
@@ -590,6 +771,90 @@ static int gralloc_lock(gralloc_module_t const* module,
     return 0;
 }
 
+static int gralloc_perform(struct gralloc_module_t const* module,
+                           int operation, ... )
+{
+    if (operation != GRALLOC_EMULATOR_START_READ &&
+        operation != GRALLOC_EMULATOR_POLL_READ) {
+        return -EINVAL;
+    }
+
+    va_list args;
+    va_start(args, operation);
+    cb_handle_t *cb = (cb_handle_t *)va_arg(args, buffer_handle_t);
+    va_end(args);
+
+    private_module_t *gr = (private_module_t *)module;
+    if (!gr || !cb || !cb->validate() || !cb->hostHandle ||
+        (cb->glFormat != GL_RGBA && cb->glFormat != GL_RGB)) {
+        return -EINVAL;
+    }
+
+    // Make sure we have host connection
+    DEFINE_AND_VALIDATE_HOST_CONNECTION;
+
+    if (getRendererVersion(rcEnc) < ASYNC_READ_RENDERER_VERSION) {
+        return -ENOSYS;
+    }
+
+    if (operation == GRALLOC_EMULATOR_START_READ) {
+        rcEnc->rcStartReadColorBuffer(rcEnc, cb->hostHandle,
+                                      0, 0, cb->width, cb->height,
+                                      cb->glFormat, GL_UNSIGNED_BYTE);
+        return 0;
+    }
+
+    int ret = rcEnc->rcFinishReadColorBuffer(rcEnc, cb->hostHandle,
+                                             0, 0, NULL);
+    return ret < 0 ? -EINVAL : ret;
+}
+
+//
+// YUV buffers are always sent whole, the host converts all planes at once.
+// The planes go with no row padding, so a YV12 buffer which width is not
+// a multiple of 32 is repacked first.
+//
+static void unlock_yuv_buffer(renderControl_encoder_context_t *rcEnc,
+                              cb_handle_t *cb, void *cpu_addr)
+{
+    char *pixels = (char *)cpu_addr;
+    char *packed = NULL;
+
+    if (cb->glFormat == GLUTILS_FORMAT_YV12 && (cb->width & 31) != 0) {
+        int yStride = (cb->width + 15) & ~15;
+        int cStride = (yStride / 2 + 15) & ~15;
+        int cWidth = cb->width / 2;
+        int cHeight = cb->height / 2;
+
+        packed = (char *)malloc(cb->width * cb->height * 3 / 2);
+        if (!packed) {
+            LOGE("gralloc_unlock: out of memory\n");
+            return;
+        }
+
+        char *dst = packed;
+        const char *src = pixels;
+        for (int y = 0; y < cb->height; y++) {
+            memcpy(dst, src, cb->width);
+            dst += cb->width;
+            src += yStride;
+        }
+        // V then U plane
+        for (int y = 0; y < cHeight * 2; y++) {
+            memcpy(dst, src, cWidth);
+            dst += cWidth;
+            src += cStride;
+        }
+        pixels = packed;
+    }
+
+    rcEnc->rcUpdateColorBuffer(rcEnc, cb->hostHandle,
+                               0, 0, cb->width, cb->height,
+                               cb->glFormat, GL_UNSIGNED_BYTE,
+                               pixels);
+    free(packed);
+}
+
 static int gralloc_unlock(gralloc_module_t const* module,
                           buffer_handle_t handle)
 {
@@ -616,33 +881,53 @@ static int gralloc_unlock(gralloc_module_t const* module,
             cpu_addr = (void *)(cb->ashmemBase);
         }
 
-        if (cb->lockedWidth < cb->width || cb->lockedHeight < cb->height) {
-            int bpp = glUtilsPixelBitSize(cb->glFormat, GL_UNSIGNED_BYTE) >> 3;
-            char *tmpBuf = new char[cb->lockedWidth * cb->lockedHeight * bpp];
+        if (cb->glFormat == GLUTILS_FORMAT_YCRCB_420_SP ||
+            cb->glFormat == GLUTILS_FORMAT_YV12) {
+            unlock_yuv_buffer(rcEnc, cb, cpu_addr);
+            cb->lockedWidth = cb->lockedHeight = 0;
+            return 0;
+        }
 
-            int dst_line_len = cb->lockedWidth * bpp;
-            int src_line_len = cb->width * bpp;
-            char *src = (char *)cpu_addr + cb->lockedTop*src_line_len + cb->lockedLeft*bpp;
-            char *dst = tmpBuf;
-            for (int y=0; y<cb->lockedHeight; y++) {
-                memcpy(dst, src, dst_line_len);
-                src += src_line_len;
-                dst += dst_line_len;
-            }
+        //
+        // Only send the rows covered by the locked rectangle. The rows are
+        // sent full-width, straight out of the buffer memory: they are
+        // contiguous that way and no repacking copy is needed. The host
+        // only updates that band of the color buffer.
+        //
+        // A rectangle narrower than half the buffer is cheaper to pack
+        // into a temporary buffer than to send with the rest of its rows,
+        // the copy in the guest costs less than the pipe transfer.
+        //
+        int bpp = glUtilsPixelBitSize(cb->glFormat, GL_UNSIGNED_BYTE) >> 3;
+        char *rows = (char *)cpu_addr + cb->lockedTop * cb->width * bpp;
+        size_t rowSize = cb->lockedWidth * bpp;
+        char *rect = NULL;
+
+        if (cb->lockedWidth * 2 <= cb->width && cb->lockedLeft >= 0 &&
+            cb->lockedLeft + cb->lockedWidth <= cb->width) {
+            rect = (char *)malloc(rowSize * cb->lockedHeight);
+        }
 
+        if (rect) {
+            size_t stride = cb->width * bpp;
+            const char *src = rows + cb->lockedLeft * bpp;
+            for (int y = 0; y < cb->lockedHeight; y++) {
+                memcpy(rect + y * rowSize, src, rowSize);
+                src += stride;
+            }
             rcEnc->rcUpdateColorBuffer(rcEnc, cb->hostHandle,
                                        cb->lockedLeft, cb->lockedTop,
                                        cb->lockedWidth, cb->lockedHeight,
                                        cb->glFormat, GL_UNSIGNED_BYTE,
-                                       tmpBuf);
-
-            delete [] tmpBuf;
+                                       rect);
+            free(rect);
         }
         else {
-            rcEnc->rcUpdateColorBuffer(rcEnc, cb->hostHandle, 0, 0,
-                                       cb->width, cb->height,
+            rcEnc->rcUpdateColorBuffer(rcEnc, cb->hostHandle,
+                                       0, cb->lockedTop,
+                                       cb->width, cb->lockedHeight,
                                        cb->glFormat, GL_UNSIGNED_BYTE,
-                                       cpu_addr);
+                                       rows);
         }
     }
 
@@ -686,7 +971,10 @@ static int gralloc_device_open(const hw_module_t* module,
 
         dev->device.alloc   = gralloc_alloc;
         dev->device.free    = gralloc_free;
-        dev->allocListHead  = NULL;
+        dev->allocSlots     = NULL;
+        dev->allocSlotsCount = 0;
+        dev->allocFreeSlot  = -1;
+        dev->allocCount     = 0;
         pthread_mutex_init(&dev->lock, NULL);
 
         *device = &dev->device.common;
@@ -698,18 +986,23 @@ static int gralloc_device_open(const hw_module_t* module,
         DEFINE_AND_VALIDATE_HOST_CONNECTION;
 
         //
-        // Query the host for Framebuffer attributes
+        // Framebuffer attributes, queried from the host by the first
+        // process which opens it
         //
-        LOGD("gralloc: query Frabuffer attribs\n");
-        EGLint width = rcEnc->rcGetFBParam(rcEnc, FB_WIDTH);
+        const HostCaps *caps = HostConnection::getHostCaps();
+        if (!caps) {
+            LOGE("gralloc: Failed to get the host caps\n");
+            return -EIO;
+        }
+        EGLint width = caps->fbWidth;
         LOGD("gralloc: width=%d\n", width);
-        EGLint height = rcEnc->rcGetFBParam(rcEnc, FB_HEIGHT);
+        EGLint height = caps->fbHeight;
         LOGD("gralloc: height=%d\n", height);
-        EGLint xdpi = rcEnc->rcGetFBParam(rcEnc, FB_XDPI);
-        EGLint ydpi = rcEnc->rcGetFBParam(rcEnc, FB_YDPI);
-        EGLint fps = rcEnc->rcGetFBParam(rcEnc, FB_FPS);
-        EGLint min_si = rcEnc->rcGetFBParam(rcEnc, FB_MIN_SWAP_INTERVAL);
-        EGLint max_si = rcEnc->rcGetFBParam(rcEnc, FB_MAX_SWAP_INTERVAL);
+        EGLint xdpi = caps->fbXdpi;
+        EGLint ydpi = caps->fbYdpi;
+        EGLint fps = caps->fbFps;
+        EGLint min_si = caps->fbMinSwapInterval;
+        EGLint max_si = caps->fbMaxSwapInterval;
 
         //
         // Allocate memory for the framebuffer device
@@ -728,7 +1021,28 @@ static int gralloc_device_open(const hw_module_t* module,
         dev->device.common.close = fb_close;
         dev->device.setSwapInterval = fb_setSwapInterval;
         dev->device.post            = fb_post;
-        dev->device.setUpdateRect   = 0; //XXX: fb_setUpdateRect;
+        dev->updateRectSet          = false;
+
+        // opt-in: qemu.gles.frames_in_flight limits the frames posted
+        // ahead of the host display, typically 1 or 2
+        char prop[PROPERTY_VALUE_MAX];
+        property_get("qemu.gles.frames_in_flight", prop, "0");
+        dev->maxFramesInFlight = atoi(prop);
+        if (dev->maxFramesInFlight < 0 ||
+            getRendererVersion(rcEnc) < FRAME_CREDIT_RENDERER_VERSION) {
+            dev->maxFramesInFlight = 0;
+        }
+
+        //
+        // SurfaceFlinger only sends partial updates when setUpdateRect is
+        // set, which needs a host able to post them.
+        //
+        if (getRendererVersion(rcEnc) >= POST_DAMAGE_RENDERER_VERSION) {
+            dev->device.setUpdateRect = fb_setUpdateRect;
+        }
+        else {
+            dev->device.setUpdateRect = 0;
+        }
 
         const_cast<uint32_t&>(dev->device.flags) = 0;
         const_cast<uint32_t&>(dev->device.width) = width;
@@ -770,5 +1084,6 @@ struct private_module_t HAL_MODULE_INFO_SYM = {
         unregisterBuffer: gralloc_unregister_buffer,
         lock: gralloc_lock,
         unlock: gralloc_unlock,
+        perform: gralloc_perform,
     }
 };
@@ -10,3 +10,34 @@
 #define FB_FPS      5
 #define FB_MIN_SWAP_INTERVAL 6
 #define FB_MAX_SWAP_INTERVAL 7
+
+// operation codes of the rcCommitFrame command list, each operation
+// takes RC_FRAME_OP_SIZE 32-bit words: the code followed by 3 arguments
+#define RC_FRAME_OP_SIZE                 4
+#define RC_FRAME_OP_MAKE_CURRENT         1  // context, drawSurf, readSurf
+#define RC_FRAME_OP_SET_WINDOW_COLOR_BUFFER 2  // windowSurface, colorBuffer
+#define RC_FRAME_OP_CACHE_FLUSH          3  // colorBuffer, postCount, forRead
+#define RC_FRAME_OP_FB_POST              4  // colorBuffer
+
+// layers of the rcComposeLayers list, bottom layer first. Each layer takes
+// RC_LAYER_SIZE 32-bit words: colorBuffer, x, y, width, height, alpha and
+// flags. The rectangle is in framebuffer pixels, in the row order of the
+// color buffers, alpha goes from 0 to 255 and only applies to blended
+// layers.
+#define RC_LAYER_SIZE                    7
+#define RC_LAYER_FLAG_BLEND              1  // premultiplied, drawn over the layers below
+#define RC_MAX_LAYERS                    16
+
+// damage rectangles of rcFBPostWithDamage, RC_RECT_SIZE 32-bit words
+// each: x, y, width and height in framebuffer pixels, in the row order of
+// the color buffers.
+#define RC_RECT_SIZE                     4
+
+// object types of rcReserveHandles. The handles of a reserved range are
+// consecutive, the connection uses them in order with the rc*Async create
+// commands. A failed asynchronous creation leaves its handle invalid, the
+// next synchronous command using it reports the failure.
+#define RC_HANDLE_COLOR_BUFFER           1
+#define RC_HANDLE_CONTEXT                2
+#define RC_HANDLE_WINDOW_SURFACE         3
+#define RC_MAX_RESERVED_HANDLES          64  // per rcReserveHandles
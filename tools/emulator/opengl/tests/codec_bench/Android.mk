@@ -0,0 +1,141 @@
+LOCAL_PATH := $(call my-dir)
+
+# Encode/decode microbenchmarks. The encoders are built for the host from
+# their .in/.attrib/.types specs, they run against the host decoders
+# through a LoopbackStream. GLESv1 and GLESv2 have their own executable
+# as their generated encoders use the same symbol names.
+ifeq ($(HOST_OS),linux)
+
+emulatorOpengl := $(LOCAL_PATH)/../..
+EMUGEN := $(HOST_OUT_EXECUTABLES)/emugen
+
+codecBenchIncludes := \
+    $(emulatorOpengl)/host/include/libOpenglRender \
+    $(emulatorOpengl)/shared \
+    $(emulatorOpengl)/shared/OpenglCodecCommon \
+    $(emulatorOpengl)/system/renderControl_enc \
+    $(call intermediates-dir-for, SHARED_LIBRARIES, lib_renderControl_dec, HOST)
+
+codecBenchLibs := \
+        libOpenglCodecCommon \
+        libOpenglOsUtils \
+        libcutils \
+        liblog
+
+### emulator_gles1_bench ###########################################
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := emulator_gles1_bench
+LOCAL_MODULE_TAGS := debug
+
+intermediates := $(local-intermediates-dir)
+
+LOCAL_SRC_FILES := \
+    gles1_bench.cpp \
+    rc_bench.cpp \
+    CodecBench.cpp \
+    ../../system/GLESv1_enc/GLEncoder.cpp \
+    ../../system/GLESv1_enc/GLEncoderUtils.cpp
+
+LOCAL_C_INCLUDES := $(codecBenchIncludes) \
+    $(emulatorOpengl)/system/GLESv1_enc \
+    $(emulatorOpengl)/host/libs/GLESv1_dec \
+    $(call intermediates-dir-for, SHARED_LIBRARIES, libGLESv1_dec, HOST) \
+    $(intermediates)
+
+LOCAL_STATIC_LIBRARIES := $(codecBenchLibs)
+LOCAL_SHARED_LIBRARIES := \
+        libGLESv1_dec \
+        lib_renderControl_dec
+LOCAL_LDLIBS := -ldl -lpthread -lrt
+
+GEN := \
+	$(intermediates)/gl_client_context.cpp \
+	$(intermediates)/gl_enc.cpp \
+	$(intermediates)/gl_enc.h
+
+$(GEN) : PRIVATE_CUSTOM_TOOL := \
+        $(EMUGEN) -E $(intermediates) -i $(emulatorOpengl)/system/GLESv1_enc gl
+$(GEN) : $(EMUGEN) \
+        $(emulatorOpengl)/system/GLESv1_enc/gl.attrib \
+        $(emulatorOpengl)/system/GLESv1_enc/gl.in \
+        $(emulatorOpengl)/system/GLESv1_enc/gl.types
+	$(transform-generated-source)
+
+LOCAL_GENERATED_SOURCES += $(GEN)
+
+GEN := \
+	$(intermediates)/renderControl_client_context.cpp \
+	$(intermediates)/renderControl_enc.cpp \
+	$(intermediates)/renderControl_enc.h
+
+$(GEN) : PRIVATE_CUSTOM_TOOL := \
+        $(EMUGEN) -E $(intermediates) -i $(emulatorOpengl)/system/renderControl_enc renderControl
+$(GEN) : $(EMUGEN) \
+        $(emulatorOpengl)/system/renderControl_enc/renderControl.attrib \
+        $(emulatorOpengl)/system/renderControl_enc/renderControl.in \
+        $(emulatorOpengl)/system/renderControl_enc/renderControl.types
+	$(transform-generated-source)
+
+LOCAL_GENERATED_SOURCES += $(GEN)
+include $(BUILD_HOST_EXECUTABLE)
+
+### emulator_gles2_bench ###########################################
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := emulator_gles2_bench
+LOCAL_MODULE_TAGS := debug
+
+intermediates := $(local-intermediates-dir)
+
+LOCAL_SRC_FILES := \
+    gles2_bench.cpp \
+    rc_bench.cpp \
+    CodecBench.cpp \
+    ../../system/GLESv2_enc/GL2Encoder.cpp \
+    ../../system/GLESv2_enc/GL2EncoderUtils.cpp
+
+LOCAL_C_INCLUDES := $(codecBenchIncludes) \
+    $(emulatorOpengl)/system/GLESv2_enc \
+    $(emulatorOpengl)/host/libs/GLESv2_dec \
+    $(call intermediates-dir-for, SHARED_LIBRARIES, libGLESv2_dec, HOST) \
+    $(intermediates)
+
+LOCAL_STATIC_LIBRARIES := $(codecBenchLibs)
+LOCAL_SHARED_LIBRARIES := \
+        libGLESv2_dec \
+        lib_renderControl_dec
+LOCAL_LDLIBS := -ldl -lpthread -lrt
+
+GEN := \
+	$(intermediates)/gl2_client_context.cpp \
+	$(intermediates)/gl2_enc.cpp \
+	$(intermediates)/gl2_enc.h
+
+$(GEN) : PRIVATE_CUSTOM_TOOL := \
+        $(EMUGEN) -E $(intermediates) -i $(emulatorOpengl)/system/GLESv2_enc gl2
+$(GEN) : $(EMUGEN) \
+        $(emulatorOpengl)/system/GLESv2_enc/gl2.attrib \
+        $(emulatorOpengl)/system/GLESv2_enc/gl2.in \
+        $(emulatorOpengl)/system/GLESv2_enc/gl2.types
+	$(transform-generated-source)
+
+LOCAL_GENERATED_SOURCES += $(GEN)
+
+GEN := \
+	$(intermediates)/renderControl_client_context.cpp \
+	$(intermediates)/renderControl_enc.cpp \
+	$(intermediates)/renderControl_enc.h
+
+$(GEN) : PRIVATE_CUSTOM_TOOL := \
+        $(EMUGEN) -E $(intermediates) -i $(emulatorOpengl)/system/renderControl_enc renderControl
+$(GEN) : $(EMUGEN) \
+        $(emulatorOpengl)/system/renderControl_enc/renderControl.attrib \
+        $(emulatorOpengl)/system/renderControl_enc/renderControl.in \
+        $(emulatorOpengl)/system/renderControl_enc/renderControl.types
+	$(transform-generated-source)
+
+LOCAL_GENERATED_SOURCES += $(GEN)
+include $(BUILD_HOST_EXECUTABLE)
+
+endif # HOST_OS == linux
@@ -0,0 +1,200 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "CodecBench.h"
+#include "TimeUtils.h"
+#include <stdio.h>
+
+// pending commands are decoded once there is that much of them
+#define DECODE_BATCH_SIZE (4 * 1024 * 1024)
+
+CodecBench::CodecBench() :
+    m_encStream(64 * 1024),
+    m_decStream(64 * 1024),
+    m_nDecoders(0),
+    m_decodeNS(0),
+    m_packets(0),
+    m_headerBytes(0)
+{
+    LoopbackStream::connect(&m_encStream, &m_decStream);
+
+    // replies the encoder waits for come from decoding what it sent
+    m_encStream.setPump(pump, this);
+}
+
+void CodecBench::addDecoder(int opcodeBase, DecodeFunc decode,
+                            CompactSizeFunc compactSize, void *decoder)
+{
+    if (m_nDecoders < MAX_DECODERS) {
+        m_decoders[m_nDecoders].opcodeBase = opcodeBase;
+        m_decoders[m_nDecoders].decode = decode;
+        m_decoders[m_nDecoders].compactSize = compactSize;
+        m_decoders[m_nDecoders].decoder = decoder;
+        m_nDecoders++;
+    }
+}
+
+static int noop()
+{
+    return 0;
+}
+
+void *CodecBench::getProc(const char *name, void *userData)
+{
+    return (void *)noop;
+}
+
+void CodecBench::pump(void *self)
+{
+    CodecBench *bench = (CodecBench *)self;
+    bench->m_encStream.flush();
+    bench->decodePending();
+}
+
+// findDecoder - the decoder of the api 'opcode' belongs to
+const CodecBench::Decoder *CodecBench::findDecoder(int opcode) const
+{
+    const Decoder *d = NULL;
+    for (int i = 0; i < m_nDecoders; i++) {
+        if (opcode >= m_decoders[i].opcodeBase &&
+            (!d || m_decoders[i].opcodeBase > d->opcodeBase)) {
+            d = &m_decoders[i];
+        }
+    }
+    return d;
+}
+
+//
+// parseHeader - the opcode, length and header length of the packet at
+//     'buf', regular or compact. '*packetLen' is 0 if it is malformed.
+//     Returns false if the header is not complete.
+//
+bool CodecBench::parseHeader(const unsigned char *buf, size_t len,
+                             int *opcode, unsigned int *packetLen,
+                             unsigned int *headerLen) const
+{
+    if (len < 2) {
+        return false;
+    }
+
+    unsigned int op = *(unsigned short *)buf;
+    if (op & IOSTREAM_COMPACT_FLAG) {
+        *opcode = op & ~IOSTREAM_COMPACT_FLAG;
+        const Decoder *d = findDecoder(*opcode);
+        *packetLen = d ? d->compactSize(*opcode) : 0;
+        *headerLen = 2;
+        return true;
+    }
+
+    if (len < 8) {
+        return false;
+    }
+    *opcode = *(int *)buf;
+    *packetLen = *(unsigned int *)(buf + 4);
+    if (*packetLen < 8) {
+        *packetLen = 0;
+    }
+    *headerLen = 8;
+    return true;
+}
+
+void CodecBench::decodePending()
+{
+    long long t0 = GetCurrentTimeNS();
+
+    size_t len;
+    unsigned char *buf = m_decStream.pending(&len);
+    size_t pos = 0;
+    int opcode;
+    unsigned int packetLen, headerLen;
+    while (parseHeader(buf + pos, len - pos, &opcode, &packetLen, &headerLen)) {
+        if (packetLen == 0 || packetLen > len - pos) {
+            break;
+        }
+
+        // the decoders decode runs of packets of their api
+        const Decoder *d = findDecoder(opcode);
+        size_t last = d ? d->decode(d->decoder, buf + pos, len - pos, &m_decStream) : 0;
+        if (last == 0) {
+            fprintf(stderr, "CodecBench: cannot decode opcode %d (len %u)\n",
+                    opcode, packetLen);
+            pos = len;
+            break;
+        }
+
+        // count the packets which have been decoded
+        size_t end = pos + last;
+        while (pos < end &&
+               parseHeader(buf + pos, end - pos, &opcode, &packetLen, &headerLen) &&
+               packetLen > 0) {
+            pos += packetLen;
+            m_headerBytes += headerLen;
+            m_packets++;
+        }
+        pos = end;
+    }
+    m_decStream.consume(pos);
+    m_decStream.flush();
+
+    m_decodeNS += GetCurrentTimeNS() - t0;
+}
+
+void CodecBench::printHeader()
+{
+    printf("%-30s %8s %10s %10s %10s %10s %8s %8s\n",
+           "case", "calls", "enc ns", "dec ns", "calls/s",
+           "bytes", "packets", "header%");
+}
+
+void CodecBench::run(const char *name, int iterations, CaseFunc func, void *arg)
+{
+    m_encStream.flush();
+    decodePending();
+
+    unsigned long long bytes0 = m_encStream.bytesWritten();
+    m_decodeNS = 0;
+    m_packets = 0;
+    m_headerBytes = 0;
+
+    long long encodeNS = 0;
+    for (int i = 0; i < iterations; i++) {
+        long long t0 = GetCurrentTimeNS();
+        long long decode0 = m_decodeNS;
+        func(arg, i);
+        // a round trip decodes in the middle of the call
+        encodeNS += GetCurrentTimeNS() - t0 - (m_decodeNS - decode0);
+
+        size_t pending;
+        m_decStream.pending(&pending);
+        if (pending >= DECODE_BATCH_SIZE) {
+            decodePending();
+        }
+    }
+
+    long long t0 = GetCurrentTimeNS();
+    m_encStream.flush();
+    encodeNS += GetCurrentTimeNS() - t0;
+    decodePending();
+
+    double n = iterations > 0 ? iterations : 1;
+    unsigned long long bytes = m_encStream.bytesWritten() - bytes0;
+    long long totalNS = encodeNS + m_decodeNS;
+    printf("%-30s %8d %10.1f %10.1f %10.0f %10.1f %8.2f %8.1f\n",
+           name, iterations,
+           encodeNS / n, m_decodeNS / n,
+           totalNS > 0 ? iterations * 1e9 / totalNS : 0.0,
+           bytes / n, m_packets / n,
+           bytes > 0 ? 100.0 * m_headerBytes / bytes : 0.0);
+}
@@ -0,0 +1,96 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _CODEC_BENCH_H
+#define _CODEC_BENCH_H
+
+#include "LoopbackStream.h"
+
+// first opcode of each api, as set by base_opcode in its .attrib file
+#define GLES1_OPCODE_BASE   1024
+#define GLES2_OPCODE_BASE   2048
+#define RC_OPCODE_BASE      10000
+
+//
+// CodecBench - runs encoders against their decoders through a
+//    LoopbackStream, in one thread, and reports for each case the encode
+//    and decode time per call, the calls per second, the bytes and the
+//    packets per call, and the share of the bytes taken by packet headers.
+//    The decoders dispatch to no-op functions, so only the codec and the
+//    copies of the transport are measured, not the GL implementation.
+//
+class CodecBench
+{
+public:
+    typedef size_t (*DecodeFunc)(void *decoder, void *buf, size_t len, IOStream *stream);
+    typedef size_t (*CompactSizeFunc)(int opcode);
+    typedef void (*CaseFunc)(void *arg, int iteration);
+
+    CodecBench();
+
+    // the stream to give to the encoders
+    IOStream *stream() { return &m_encStream; }
+
+    //
+    // addDecoder - decode the packets with opcodes from 'opcodeBase',
+    //     'compactSize' is the compactPacketSize of the decoder class.
+    //
+    void addDecoder(int opcodeBase, DecodeFunc decode,
+                    CompactSizeFunc compactSize, void *decoder);
+
+    // run - times 'iterations' calls of 'func' and prints the results
+    void run(const char *name, int iterations, CaseFunc func, void *arg);
+
+    static void printHeader();
+
+    // getProc - for initDispatchByName, returns a no-op for every name
+    static void *getProc(const char *name, void *userData);
+
+    template <class T>
+    static size_t decodeWith(void *decoder, void *buf, size_t len, IOStream *stream)
+    {
+        return ((T *)decoder)->decode(buf, len, stream);
+    }
+
+private:
+    static void pump(void *self);
+    void decodePending();
+
+    enum { MAX_DECODERS = 4 };
+    struct Decoder {
+        int opcodeBase;
+        DecodeFunc decode;
+        CompactSizeFunc compactSize;
+        void *decoder;
+    };
+    const Decoder *findDecoder(int opcode) const;
+    bool parseHeader(const unsigned char *buf, size_t len,
+                     int *opcode, unsigned int *packetLen,
+                     unsigned int *headerLen) const;
+
+    LoopbackStream m_encStream;
+    LoopbackStream m_decStream;
+    Decoder m_decoders[MAX_DECODERS];
+    int m_nDecoders;
+
+    long long m_decodeNS;
+    unsigned long long m_packets;
+    unsigned long long m_headerBytes;
+};
+
+// runRenderControlBench - the renderControl cases, on its own encoder
+void runRenderControlBench(CodecBench &bench);
+
+#endif
@@ -0,0 +1,127 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "CodecBench.h"
+#include "GLEncoder.h"
+#include "GLDecoder.h"
+#include "renderControl_dec.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+//
+// emulator_gles1_bench - GLESv1 and renderControl encode/decode rates.
+//
+struct GLCase {
+    GLEncoder *enc;
+    int size;
+    unsigned char *pixels;
+};
+
+static const GLfloat s_triangle[] = {
+    0.0f, 0.0f, 0.0f,
+    1.0f, 0.0f, 0.0f,
+    0.0f, 1.0f, 0.0f
+};
+
+static void benchEnable(void *arg, int i)
+{
+    GLEncoder *enc = ((GLCase *)arg)->enc;
+    enc->glEnable(enc, GL_BLEND);
+}
+
+static void benchColor4f(void *arg, int i)
+{
+    GLEncoder *enc = ((GLCase *)arg)->enc;
+    enc->glColor4f(enc, 1.0f, 0.5f, 0.25f, 1.0f);
+}
+
+static void benchBindTexture(void *arg, int i)
+{
+    GLEncoder *enc = ((GLCase *)arg)->enc;
+    enc->glBindTexture(enc, GL_TEXTURE_2D, 1 + (i & 1));
+}
+
+static void benchDrawArrays(void *arg, int i)
+{
+    GLEncoder *enc = ((GLCase *)arg)->enc;
+    enc->glDrawArrays(enc, GL_TRIANGLES, 0, 3);
+}
+
+static void benchGetError(void *arg, int i)
+{
+    GLEncoder *enc = ((GLCase *)arg)->enc;
+    enc->glGetError(enc);
+}
+
+static void benchTexImage2D(void *arg, int i)
+{
+    GLCase *c = (GLCase *)arg;
+    c->enc->glTexImage2D(c->enc, GL_TEXTURE_2D, 0, GL_RGBA, c->size, c->size, 0,
+                         GL_RGBA, GL_UNSIGNED_BYTE, c->pixels);
+}
+
+int main(int argc, char *argv[])
+{
+    CodecBench bench;
+
+    GLDecoder glDec;
+    GLDecoderContextData contextData;
+    glDec.initGL(CodecBench::getProc, NULL);
+    glDec.setContextData(&contextData);
+    bench.addDecoder(GLES1_OPCODE_BASE, CodecBench::decodeWith<GLDecoder>,
+                     GLDecoder::compactPacketSize, &glDec);
+
+    renderControl_decoder_context_t rcDec;
+    rcDec.initDispatchByName(CodecBench::getProc, NULL);
+    bench.addDecoder(RC_OPCODE_BASE,
+                     CodecBench::decodeWith<renderControl_decoder_context_t>,
+                     renderControl_decoder_context_t::compactPacketSize, &rcDec);
+
+    GLEncoder enc(bench.stream());
+    GLClientState state;
+    enc.setClientState(&state);
+    GLCase c = { &enc, 0, NULL };
+
+    CodecBench::printHeader();
+    bench.run("glEnable", 100000, benchEnable, &c);
+    bench.run("glColor4f", 100000, benchColor4f, &c);
+    bench.run("glBindTexture", 100000, benchBindTexture, &c);
+
+    bench.stream()->setCompactPackets(true);
+    bench.run("glEnable (compact)", 100000, benchEnable, &c);
+    bench.run("glColor4f (compact)", 100000, benchColor4f, &c);
+    bench.run("glBindTexture (compact)", 100000, benchBindTexture, &c);
+    bench.stream()->setCompactPackets(false);
+
+    enc.glEnableClientState(&enc, GL_VERTEX_ARRAY);
+    enc.glVertexPointer(&enc, 3, GL_FLOAT, 0, (void *)s_triangle);
+    bench.run("glDrawArrays 3 vertices", 50000, benchDrawArrays, &c);
+    enc.glDisableClientState(&enc, GL_VERTEX_ARRAY);
+
+    bench.run("glGetError (round trip)", 20000, benchGetError, &c);
+
+    static const int sizes[] = { 16, 64, 256, 1024 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        c.size = sizes[s];
+        c.pixels = (unsigned char *)calloc(c.size * c.size, 4);
+        char name[64];
+        snprintf(name, sizeof(name), "glTexImage2D %dx%d", c.size, c.size);
+        bench.run(name, sizes[s] >= 1024 ? 200 : 5000, benchTexImage2D, &c);
+        free(c.pixels);
+    }
+
+    runRenderControlBench(bench);
+    return 0;
+}
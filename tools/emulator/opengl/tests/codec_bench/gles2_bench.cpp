@@ -0,0 +1,128 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "CodecBench.h"
+#include "GL2Encoder.h"
+#include "GL2Decoder.h"
+#include "renderControl_dec.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+//
+// emulator_gles2_bench - GLESv2 and renderControl encode/decode rates.
+//
+struct GLCase {
+    GL2Encoder *enc;
+    int size;
+    unsigned char *pixels;
+};
+
+static const GLfloat s_triangle[] = {
+    0.0f, 0.0f, 0.0f,
+    1.0f, 0.0f, 0.0f,
+    0.0f, 1.0f, 0.0f
+};
+
+static void benchEnable(void *arg, int i)
+{
+    GL2Encoder *enc = ((GLCase *)arg)->enc;
+    enc->glEnable(enc, GL_BLEND);
+}
+
+static void benchUniform4f(void *arg, int i)
+{
+    // a new value each time, unchanged values are not sent
+    GL2Encoder *enc = ((GLCase *)arg)->enc;
+    enc->glUniform4f(enc, 0, (GLfloat)i, 0.5f, 0.25f, 1.0f);
+}
+
+static void benchBindTexture(void *arg, int i)
+{
+    GL2Encoder *enc = ((GLCase *)arg)->enc;
+    enc->glBindTexture(enc, GL_TEXTURE_2D, 1 + (i & 1));
+}
+
+static void benchDrawArrays(void *arg, int i)
+{
+    GL2Encoder *enc = ((GLCase *)arg)->enc;
+    enc->glDrawArrays(enc, GL_TRIANGLES, 0, 3);
+}
+
+static void benchGetError(void *arg, int i)
+{
+    GL2Encoder *enc = ((GLCase *)arg)->enc;
+    enc->glGetError(enc);
+}
+
+static void benchTexImage2D(void *arg, int i)
+{
+    GLCase *c = (GLCase *)arg;
+    c->enc->glTexImage2D(c->enc, GL_TEXTURE_2D, 0, GL_RGBA, c->size, c->size, 0,
+                         GL_RGBA, GL_UNSIGNED_BYTE, c->pixels);
+}
+
+int main(int argc, char *argv[])
+{
+    CodecBench bench;
+
+    GL2Decoder gl2Dec;
+    GLDecoderContextData contextData;
+    gl2Dec.initGL(CodecBench::getProc, NULL);
+    gl2Dec.setContextData(&contextData);
+    bench.addDecoder(GLES2_OPCODE_BASE, CodecBench::decodeWith<GL2Decoder>,
+                     GL2Decoder::compactPacketSize, &gl2Dec);
+
+    renderControl_decoder_context_t rcDec;
+    rcDec.initDispatchByName(CodecBench::getProc, NULL);
+    bench.addDecoder(RC_OPCODE_BASE,
+                     CodecBench::decodeWith<renderControl_decoder_context_t>,
+                     renderControl_decoder_context_t::compactPacketSize, &rcDec);
+
+    GL2Encoder enc(bench.stream());
+    GLClientState state;
+    enc.setClientState(&state);
+    GLCase c = { &enc, 0, NULL };
+
+    CodecBench::printHeader();
+    bench.run("glEnable", 100000, benchEnable, &c);
+    bench.run("glUniform4f", 100000, benchUniform4f, &c);
+    bench.run("glBindTexture", 100000, benchBindTexture, &c);
+
+    bench.stream()->setCompactPackets(true);
+    bench.run("glEnable (compact)", 100000, benchEnable, &c);
+    bench.run("glUniform4f (compact)", 100000, benchUniform4f, &c);
+    bench.run("glBindTexture (compact)", 100000, benchBindTexture, &c);
+    bench.stream()->setCompactPackets(false);
+
+    enc.glEnableVertexAttribArray(&enc, 0);
+    enc.glVertexAttribPointer(&enc, 0, 3, GL_FLOAT, GL_FALSE, 0, (void *)s_triangle);
+    bench.run("glDrawArrays 3 vertices", 50000, benchDrawArrays, &c);
+    enc.glDisableVertexAttribArray(&enc, 0);
+
+    bench.run("glGetError (round trip)", 20000, benchGetError, &c);
+
+    static const int sizes[] = { 16, 64, 256, 1024 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        c.size = sizes[s];
+        c.pixels = (unsigned char *)calloc(c.size * c.size, 4);
+        char name[64];
+        snprintf(name, sizeof(name), "glTexImage2D %dx%d", c.size, c.size);
+        bench.run(name, sizes[s] >= 1024 ? 200 : 5000, benchTexImage2D, &c);
+        free(c.pixels);
+    }
+
+    runRenderControlBench(bench);
+    return 0;
+}
@@ -0,0 +1,63 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "CodecBench.h"
+#include "renderControl_enc.h"
+#include <stdlib.h>
+
+struct RcCase {
+    renderControl_encoder_context_t *enc;
+    int width;
+    int height;
+    unsigned char *pixels;
+};
+
+static void benchFBPost(void *arg, int i)
+{
+    RcCase *c = (RcCase *)arg;
+    c->enc->rcFBPost(c->enc, 1);
+}
+
+static void benchGetFBParam(void *arg, int i)
+{
+    RcCase *c = (RcCase *)arg;
+    c->enc->rcGetFBParam(c->enc, EGL_WIDTH);
+}
+
+static void benchUpdateColorBuffer(void *arg, int i)
+{
+    RcCase *c = (RcCase *)arg;
+    c->enc->rcUpdateColorBuffer(c->enc, 1, 0, 0, c->width, c->height,
+                                GL_RGBA, GL_UNSIGNED_BYTE, c->pixels);
+}
+
+void runRenderControlBench(CodecBench &bench)
+{
+    renderControl_encoder_context_t enc(bench.stream());
+    RcCase c = { &enc, 0, 0, NULL };
+
+    bench.run("rcFBPost", 100000, benchFBPost, &c);
+    bench.run("rcGetFBParam (round trip)", 20000, benchGetFBParam, &c);
+
+    static const int sizes[] = { 64, 256, 1024 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        c.width = c.height = sizes[s];
+        c.pixels = (unsigned char *)calloc(c.width * c.height, 4);
+        char name[64];
+        snprintf(name, sizeof(name), "rcUpdateColorBuffer %dx%d", c.width, c.height);
+        bench.run(name, sizes[s] >= 1024 ? 200 : 2000, benchUpdateColorBuffer, &c);
+        free(c.pixels);
+    }
+}
@@ -14,14 +14,17 @@ include $(CLEAR_VARS)
 LOCAL_MODULE := libGLESv1_CM_emul
 LOCAL_MODULE_PATH := $(TARGET_OUT_SHARED_LIBRARIES)/egl
 LOCAL_MODULE_CLASS := SHARED_LIBRARIES
-LOCAL_SRC_FILES := glesv1_emul_ifc.cpp
+LOCAL_SRC_FILES := glesv1_emul_ifc.cpp \
+	CallTrace.cpp
 
 LOCAL_PRELINK_MODULE := false
 LOCAL_MODULE_TAGS := debug
 LOCAL_SHARED_LIBRARIES := libdl libcutils
 LOCAL_CFLAGS += $(debugFlags)
+LOCAL_CFLAGS += $(logTag) -DWRAPPER_CALL_TRACE -DCALL_TRACE_LIB=\"GLESv1\"
 
 LOCAL_C_INCLUDES += \
+	$(LOCAL_PATH) \
 	$(emulatorOpengl)/system/GLESv1_enc \
 	$(emulatorOpengl)/shared/OpenglCodecCommon
 
@@ -49,14 +52,17 @@ include $(CLEAR_VARS)
 LOCAL_MODULE := libGLESv2_emul
 LOCAL_MODULE_PATH := $(TARGET_OUT_SHARED_LIBRARIES)/egl
 LOCAL_MODULE_CLASS := SHARED_LIBRARIES
-LOCAL_SRC_FILES := glesv2_emul_ifc.cpp
+LOCAL_SRC_FILES := glesv2_emul_ifc.cpp \
+	CallTrace.cpp
 
 LOCAL_PRELINK_MODULE := false
 LOCAL_MODULE_TAGS := debug
 LOCAL_SHARED_LIBRARIES := libdl libcutils
 LOCAL_CFLAGS += $(debugFlags)
+LOCAL_CFLAGS += $(logTag) -DWRAPPER_CALL_TRACE -DCALL_TRACE_LIB=\"GLESv2\"
 
 LOCAL_C_INCLUDES += \
+	$(LOCAL_PATH) \
 	$(emulatorOpengl)/system/GLESv2_enc \
 	$(emulatorOpengl)/shared/OpenglCodecCommon
 
@@ -87,7 +93,8 @@ LOCAL_SRC_FILES :=  \
         egl.cpp \
         egl_dispatch.cpp \
         ServerConnection.cpp \
-        ThreadInfo.cpp
+        ThreadInfo.cpp \
+        CallTrace.cpp
 
 # add additional depencies to ensure that the generated code that we depend on
 # is generated
@@ -115,6 +122,7 @@ LOCAL_C_INCLUDES := $(emulatorOpengl)/shared/OpenglCodecCommon \
 
 LOCAL_CFLAGS := $(logTag)
 LOCAL_CFLAGS += $(debugFlags)
+LOCAL_CFLAGS += -DCALL_TRACE_LIB=\"EGL\"
 
 
 LOCAL_MODULE_PATH := $(TARGET_OUT_SHARED_LIBRARIES)/egl
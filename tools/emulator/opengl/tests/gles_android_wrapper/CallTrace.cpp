@@ -0,0 +1,226 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "CallTrace.h"
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <cutils/atomic.h>
+#include <cutils/log.h>
+#include <cutils/properties.h>
+
+#ifndef CALL_TRACE_LIB
+#define CALL_TRACE_LIB "wrapper"
+#endif
+
+#define CALL_TRACE_MAX_FUNCS 512
+
+// the calls of one thread, only written by that thread
+struct CallTraceThread
+{
+    CallTraceThread *next;
+    pid_t tid;
+    uint32_t count[CALL_TRACE_MAX_FUNCS];
+    uint64_t totalNs[CALL_TRACE_MAX_FUNCS];
+    uint64_t maxNs[CALL_TRACE_MAX_FUNCS];
+};
+
+struct CallTraceTotal
+{
+    int id;
+    uint64_t count;
+    uint64_t totalNs;
+    uint64_t maxNs;
+};
+
+bool g_callTraceEnabled = false;
+
+static CallTraceFunc *s_funcs[CALL_TRACE_MAX_FUNCS];
+static volatile int32_t s_numFuncs = 0;
+
+// the tables of all threads that made a traced call, kept until exit
+static CallTraceThread *s_threads = NULL;
+static pthread_mutex_t s_threadsLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t s_threadKey;
+
+static volatile int32_t s_dumpRequested = 0;
+static struct sigaction s_prevSigAction;
+
+uint64_t callTraceNow()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int cmpTotals(const void *a, const void *b)
+{
+    const CallTraceTotal *ta = (const CallTraceTotal *)a;
+    const CallTraceTotal *tb = (const CallTraceTotal *)b;
+    if (ta->totalNs == tb->totalNs) return 0;
+    return ta->totalNs < tb->totalNs ? 1 : -1;
+}
+
+//
+// log the per-function totals of all threads, costliest first. The
+// tables of running threads are read as they are being updated, a
+// total may be one call behind.
+//
+static void dumpTotals()
+{
+    int numFuncs = s_numFuncs;
+    if (numFuncs > CALL_TRACE_MAX_FUNCS) numFuncs = CALL_TRACE_MAX_FUNCS;
+
+    CallTraceTotal *totals = new CallTraceTotal[numFuncs];
+    memset(totals, 0, numFuncs * sizeof(CallTraceTotal));
+    for (int i = 0; i < numFuncs; i++) {
+        totals[i].id = i;
+    }
+
+    uint64_t allNs = 0;
+    pthread_mutex_lock(&s_threadsLock);
+    for (CallTraceThread *t = s_threads; t != NULL; t = t->next) {
+        uint64_t threadNs = 0;
+        uint64_t threadCalls = 0;
+        for (int i = 0; i < numFuncs; i++) {
+            totals[i].count += t->count[i];
+            totals[i].totalNs += t->totalNs[i];
+            if (t->maxNs[i] > totals[i].maxNs) totals[i].maxNs = t->maxNs[i];
+            threadNs += t->totalNs[i];
+            threadCalls += t->count[i];
+        }
+        LOGI("call trace %s: thread %d: %llu calls, %llu us\n", CALL_TRACE_LIB,
+             t->tid, (unsigned long long)threadCalls,
+             (unsigned long long)(threadNs / 1000));
+        allNs += threadNs;
+    }
+    pthread_mutex_unlock(&s_threadsLock);
+
+    qsort(totals, numFuncs, sizeof(CallTraceTotal), cmpTotals);
+
+    LOGI("call trace %s: %llu us in traced calls\n", CALL_TRACE_LIB,
+         (unsigned long long)(allNs / 1000));
+    LOGI("call trace %s: %-32s %10s %12s %10s %10s\n", CALL_TRACE_LIB,
+         "function", "calls", "total us", "avg us", "max us");
+    for (int i = 0; i < numFuncs; i++) {
+        CallTraceTotal *t = &totals[i];
+        if (t->count == 0) continue;
+        LOGI("call trace %s: %-32s %10llu %12llu %10llu %10llu\n", CALL_TRACE_LIB,
+             s_funcs[t->id]->name, (unsigned long long)t->count,
+             (unsigned long long)(t->totalNs / 1000),
+             (unsigned long long)(t->totalNs / t->count / 1000),
+             (unsigned long long)(t->maxNs / 1000));
+    }
+
+    delete [] totals;
+}
+
+static void callTraceSignal(int sig, siginfo_t *info, void *ucontext)
+{
+    // logging is not safe here, the next traced call does it
+    s_dumpRequested = 1;
+
+    // other wrapper libraries may have installed their handlers before us
+    if (s_prevSigAction.sa_flags & SA_SIGINFO) {
+        if (s_prevSigAction.sa_sigaction) {
+            s_prevSigAction.sa_sigaction(sig, info, ucontext);
+        }
+    } else if (s_prevSigAction.sa_handler != SIG_DFL &&
+               s_prevSigAction.sa_handler != SIG_IGN) {
+        s_prevSigAction.sa_handler(sig);
+    }
+}
+
+static CallTraceThread *getThreadTable()
+{
+    CallTraceThread *t = (CallTraceThread *)pthread_getspecific(s_threadKey);
+    if (t) return t;
+
+    t = (CallTraceThread *)calloc(1, sizeof(CallTraceThread));
+    if (!t) return NULL;
+    t->tid = gettid();
+    pthread_setspecific(s_threadKey, t);
+
+    pthread_mutex_lock(&s_threadsLock);
+    t->next = s_threads;
+    s_threads = t;
+    pthread_mutex_unlock(&s_threadsLock);
+    return t;
+}
+
+void callTraceRecord(CallTraceFunc *func, uint64_t start)
+{
+    uint64_t ns = callTraceNow() - start;
+
+    int32_t id = func->id;
+    if (id < 0) {
+        // first call of the function in this library, by any thread
+        int32_t newId = android_atomic_inc(&s_numFuncs);
+        if (newId >= CALL_TRACE_MAX_FUNCS) return;
+        s_funcs[newId] = func;
+        // if another thread got the function a slot first, ours stays unused
+        android_atomic_release_cas(-1, newId, &func->id);
+        id = func->id;
+    }
+
+    CallTraceThread *t = getThreadTable();
+    if (t) {
+        t->count[id]++;
+        t->totalNs[id] += ns;
+        if (ns > t->maxNs[id]) t->maxNs[id] = ns;
+    }
+
+    if (s_dumpRequested &&
+        android_atomic_release_cas(1, 0, &s_dumpRequested) == 0) {
+        dumpTotals();
+    }
+}
+
+static void callTraceExit()
+{
+    dumpTotals();
+}
+
+//
+// tracing is decided once, when the library is loaded
+//
+static struct CallTraceInit
+{
+    CallTraceInit() {
+        char prop[PROPERTY_VALUE_MAX];
+        property_get("debug.egl.trace_calls", prop, "0");
+        if (atoi(prop) == 0) return;
+
+        if (pthread_key_create(&s_threadKey, NULL) != 0) {
+            LOGE("call trace %s: no thread key, not tracing\n", CALL_TRACE_LIB);
+            return;
+        }
+
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_sigaction = callTraceSignal;
+        sa.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGUSR2, &sa, &s_prevSigAction);
+
+        atexit(callTraceExit);
+        g_callTraceEnabled = true;
+        LOGI("call trace %s: tracing calls, SIGUSR2 logs the totals\n",
+             CALL_TRACE_LIB);
+    }
+} s_callTraceInit;
@@ -0,0 +1,67 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _CALL_TRACE_H
+#define _CALL_TRACE_H
+
+#include <stdint.h>
+
+//
+// Per-call latency tracing of the wrapper entry points, enabled by setting
+// the debug.egl.trace_calls property to 1 before the process starts.
+//
+// Each traced function times every call from its entry until its exit,
+// so for a synchronous call that includes the encoder, the pipe and the
+// host. The times go into per-thread tables, only written by their own
+// thread, and the per-function totals are logged when the process exits
+// or receives SIGUSR2 (on its next traced call).
+//
+// Every library traces its own calls, CALL_TRACE_LIB names it in the log.
+// The symbols are hidden so that the libraries do not share them.
+//
+
+#define CALL_TRACE_LOCAL __attribute__((visibility("hidden")))
+
+struct CallTraceFunc
+{
+    const char *name;
+    volatile int32_t id;    // slot in the per-thread tables, -1 until used
+};
+
+extern bool g_callTraceEnabled CALL_TRACE_LOCAL;
+
+uint64_t callTraceNow() CALL_TRACE_LOCAL;
+void callTraceRecord(CallTraceFunc *func, uint64_t start) CALL_TRACE_LOCAL;
+
+class CallTraceScope
+{
+public:
+    CallTraceScope(CallTraceFunc *func) :
+        m_func(func), m_start(g_callTraceEnabled ? callTraceNow() : 0) {}
+    ~CallTraceScope() {
+        if (m_start) callTraceRecord(m_func, m_start);
+    }
+
+private:
+    CallTraceFunc *m_func;
+    uint64_t m_start;
+};
+
+// the function statics are constant initialized, without any guard
+#define CALL_TRACE(name) \
+    static CallTraceFunc s_callTraceFunc = { #name, -1 }; \
+    CallTraceScope callTraceScope(&s_callTraceFunc)
+
+#endif
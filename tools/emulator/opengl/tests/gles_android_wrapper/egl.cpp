@@ -31,6 +31,7 @@
 #include <cutils/log.h>
 #include "ServerConnection.h"
 #include "ThreadInfo.h"
+#include "CallTrace.h"
 #include <pthread.h>
 #include "gl_wrapper_context.h"
 #include "gl2_wrapper_context.h"
@@ -246,7 +247,7 @@ static struct egl_dispatch *getDispatch()
 
 __eglMustCastToProperFunctionPointerType eglGetProcAddress(const char *procname)
 {
-
+    CALL_TRACE(eglGetProcAddress);
     // search in EGL function table
     for (int i=0; i<egl_num_funcs; i++) {
         if (!strcmp(egl_funcs_by_name[i].name, procname)) {
@@ -263,31 +264,37 @@ __eglMustCastToProperFunctionPointerType eglGetProcAddress(const char *procname)
 
 EGLint eglGetError()
 {
+    CALL_TRACE(eglGetError);
     return getDispatch()->eglGetError();
 }
 
 EGLDisplay eglGetDisplay(EGLNativeDisplayType display_id)
 {
+    CALL_TRACE(eglGetDisplay);
     return getDispatch()->eglGetDisplay(display_id);
 }
 
 EGLBoolean eglInitialize(EGLDisplay dpy, EGLint *major, EGLint *minor)
 {
+    CALL_TRACE(eglInitialize);
     return getDispatch()->eglInitialize(dpy, major, minor);
 }
 
 EGLBoolean eglTerminate(EGLDisplay dpy)
 {
+    CALL_TRACE(eglTerminate);
     return getDispatch()->eglTerminate(dpy);
 }
 
 const char* eglQueryString(EGLDisplay dpy, EGLint name)
 {
+    CALL_TRACE(eglQueryString);
     return getDispatch()->eglQueryString(dpy, name);
 }
 
 EGLBoolean eglGetConfigs(EGLDisplay dpy, EGLConfig *configs, EGLint config_size, EGLint *num_config)
 {
+    CALL_TRACE(eglGetConfigs);
     return getDispatch()->eglGetConfigs(dpy, configs, config_size, num_config);
 }
 
@@ -323,6 +330,7 @@ static EGLint * filter_es2_bit(const EGLint *attrib_list, bool *isES2)
 
 EGLBoolean eglChooseConfig(EGLDisplay dpy, const EGLint *attrib_list, EGLConfig *configs, EGLint config_size, EGLint *num_config)
 {
+    CALL_TRACE(eglChooseConfig);
     EGLBoolean res;
     if (s_needEncode) {
         EGLint *attribs = filter_es2_bit(attrib_list, NULL);
@@ -348,6 +356,7 @@ EGLBoolean eglChooseConfig(EGLDisplay dpy, const EGLint *attrib_list, EGLConfig
 
 EGLBoolean eglGetConfigAttrib(EGLDisplay dpy, EGLConfig config, EGLint attribute, EGLint *value)
 {
+    CALL_TRACE(eglGetConfigAttrib);
     if (s_needEncode && attribute == EGL_RENDERABLE_TYPE) {
         *value = EGL_OPENGL_ES_BIT | EGL_OPENGL_ES2_BIT;
         return EGL_TRUE;
@@ -358,6 +367,7 @@ EGLBoolean eglGetConfigAttrib(EGLDisplay dpy, EGLConfig config, EGLint attribute
 
 EGLSurface eglCreateWindowSurface(EGLDisplay dpy, EGLConfig config, EGLNativeWindowType win, const EGLint *attrib_list)
 {
+    CALL_TRACE(eglCreateWindowSurface);
     EGLSurface surface =  getDispatch()->eglCreateWindowSurface(dpy, config, win, attrib_list);
     if (surface != EGL_NO_SURFACE) {
         ServerConnection *server;
@@ -370,6 +380,7 @@ EGLSurface eglCreateWindowSurface(EGLDisplay dpy, EGLConfig config, EGLNativeWin
 
 EGLSurface eglCreatePbufferSurface(EGLDisplay dpy, EGLConfig config, const EGLint *attrib_list)
 {
+    CALL_TRACE(eglCreatePbufferSurface);
     EGLSurface surface =  getDispatch()->eglCreatePbufferSurface(dpy, config, attrib_list);
     if (surface != EGL_NO_SURFACE) {
         ServerConnection *server;
@@ -382,6 +393,7 @@ EGLSurface eglCreatePbufferSurface(EGLDisplay dpy, EGLConfig config, const EGLin
 
 EGLSurface eglCreatePixmapSurface(EGLDisplay dpy, EGLConfig config, EGLNativePixmapType pixmap, const EGLint *attrib_list)
 {
+    CALL_TRACE(eglCreatePixmapSurface);
     EGLSurface surface =  getDispatch()->eglCreatePixmapSurface(dpy, config, pixmap, attrib_list);
     if (surface != EGL_NO_SURFACE) {
         ServerConnection *server;
@@ -394,6 +406,7 @@ EGLSurface eglCreatePixmapSurface(EGLDisplay dpy, EGLConfig config, EGLNativePix
 
 EGLBoolean eglDestroySurface(EGLDisplay dpy, EGLSurface surface)
 {
+    CALL_TRACE(eglDestroySurface);
     EGLBoolean res =  getDispatch()->eglDestroySurface(dpy, surface);
     if (res && surface != EGL_NO_SURFACE) {
         ServerConnection *server;
@@ -406,6 +419,7 @@ EGLBoolean eglDestroySurface(EGLDisplay dpy, EGLSurface surface)
 
 EGLBoolean eglQuerySurface(EGLDisplay dpy, EGLSurface surface, EGLint attribute, EGLint *value)
 {
+    CALL_TRACE(eglQuerySurface);
     EGLBoolean res = getDispatch()->eglQuerySurface(dpy, surface, attribute, value);
     if (res && attribute == EGL_RENDERABLE_TYPE) {
         *value |= EGL_OPENGL_ES2_BIT;
@@ -415,52 +429,61 @@ EGLBoolean eglQuerySurface(EGLDisplay dpy, EGLSurface surface, EGLint attribute,
 
 EGLBoolean eglBindAPI(EGLenum api)
 {
+    CALL_TRACE(eglBindAPI);
     return getDispatch()->eglBindAPI(api);
 }
 
 EGLenum eglQueryAPI()
 {
+    CALL_TRACE(eglQueryAPI);
     return getDispatch()->eglQueryAPI();
 }
 
 EGLBoolean eglWaitClient()
 {
+    CALL_TRACE(eglWaitClient);
     return getDispatch()->eglWaitClient();
 }
 
 EGLBoolean eglReleaseThread()
 {
+    CALL_TRACE(eglReleaseThread);
     return getDispatch()->eglReleaseThread();
 }
 
 EGLSurface eglCreatePbufferFromClientBuffer(EGLDisplay dpy, EGLenum buftype, EGLClientBuffer buffer, EGLConfig config, const EGLint *attrib_list)
 {
+    CALL_TRACE(eglCreatePbufferFromClientBuffer);
     return getDispatch()->eglCreatePbufferFromClientBuffer(dpy, buftype, buffer, config, attrib_list);
 }
 
 EGLBoolean eglSurfaceAttrib(EGLDisplay dpy, EGLSurface surface, EGLint attribute, EGLint value)
 {
+    CALL_TRACE(eglSurfaceAttrib);
     return getDispatch()->eglSurfaceAttrib(dpy, surface, attribute, value);
 }
 
 EGLBoolean eglBindTexImage(EGLDisplay dpy, EGLSurface surface, EGLint buffer)
 {
+    CALL_TRACE(eglBindTexImage);
     return getDispatch()->eglBindTexImage(dpy, surface, buffer);
 }
 
 EGLBoolean eglReleaseTexImage(EGLDisplay dpy, EGLSurface surface, EGLint buffer)
 {
+    CALL_TRACE(eglReleaseTexImage);
     return getDispatch()->eglReleaseTexImage(dpy, surface, buffer);
 }
 
 EGLBoolean eglSwapInterval(EGLDisplay dpy, EGLint interval)
 {
+    CALL_TRACE(eglSwapInterval);
     return getDispatch()->eglSwapInterval(dpy, interval);
 }
 
 EGLContext eglCreateContext(EGLDisplay dpy, EGLConfig config, EGLContext share_context, const EGLint *attrib_list)
 {
-
+    CALL_TRACE(eglCreateContext);
     EGLContext share = share_context;
     if (share) share = ((EGLWrapperContext *)share_context)->aglContext;
 
@@ -505,6 +528,7 @@ EGLContext eglCreateContext(EGLDisplay dpy, EGLConfig config, EGLContext share_c
 
 EGLBoolean eglDestroyContext(EGLDisplay dpy, EGLContext ctx)
 {
+    CALL_TRACE(eglDestroyContext);
     EGLWrapperContext *wctx = (EGLWrapperContext *)ctx;
     EGLBoolean res = EGL_FALSE;
 
@@ -526,6 +550,7 @@ EGLBoolean eglDestroyContext(EGLDisplay dpy, EGLContext ctx)
 
 EGLBoolean eglMakeCurrent(EGLDisplay dpy, EGLSurface draw, EGLSurface read, EGLContext ctx)
 {
+    CALL_TRACE(eglMakeCurrent);
     EGLWrapperContext *wctx = (EGLWrapperContext *)ctx;
     EGLContext aglContext = (ctx == EGL_NO_CONTEXT ? EGL_NO_CONTEXT : wctx->aglContext);
     EGLThreadInfo *ti = getEGLThreadInfo();
@@ -553,22 +578,26 @@ EGLBoolean eglMakeCurrent(EGLDisplay dpy, EGLSurface draw, EGLSurface read, EGLC
 
 EGLContext eglGetCurrentContext()
 {
+    CALL_TRACE(eglGetCurrentContext);
     EGLThreadInfo *ti = getEGLThreadInfo();
     return (ti->currentContext ? ti->currentContext : EGL_NO_CONTEXT);
 }
 
 EGLSurface eglGetCurrentSurface(EGLint readdraw)
 {
+    CALL_TRACE(eglGetCurrentSurface);
     return getDispatch()->eglGetCurrentSurface(readdraw);
 }
 
 EGLDisplay eglGetCurrentDisplay()
 {
+    CALL_TRACE(eglGetCurrentDisplay);
     return getDispatch()->eglGetCurrentDisplay();
 }
 
 EGLBoolean eglQueryContext(EGLDisplay dpy, EGLContext ctx, EGLint attribute, EGLint *value)
 {
+    CALL_TRACE(eglQueryContext);
     EGLWrapperContext *wctx = (EGLWrapperContext *)ctx;
     if (wctx) {
         if (attribute == EGL_CONTEXT_CLIENT_VERSION) {
@@ -585,16 +614,19 @@ EGLBoolean eglQueryContext(EGLDisplay dpy, EGLContext ctx, EGLint attribute, EGL
 
 EGLBoolean eglWaitGL()
 {
+    CALL_TRACE(eglWaitGL);
     return getDispatch()->eglWaitGL();
 }
 
 EGLBoolean eglWaitNative(EGLint engine)
 {
+    CALL_TRACE(eglWaitNative);
     return getDispatch()->eglWaitNative(engine);
 }
 
 EGLBoolean eglSwapBuffers(EGLDisplay dpy, EGLSurface surface)
 {
+    CALL_TRACE(eglSwapBuffers);
     ServerConnection *server;
     if (s_needEncode && (server = ServerConnection::s_getServerConnection()) != NULL) {
         server->utEnc()->swapBuffers(server->utEnc(), getpid(), (uint32_t)surface);
@@ -607,21 +639,25 @@ EGLBoolean eglSwapBuffers(EGLDisplay dpy, EGLSurface surface)
 
 EGLBoolean eglCopyBuffers(EGLDisplay dpy, EGLSurface surface, EGLNativePixmapType target)
 {
+    CALL_TRACE(eglCopyBuffers);
     return getDispatch()->eglCopyBuffers(dpy, surface, target);
 }
 
 EGLBoolean eglLockSurfaceKHR(EGLDisplay display, EGLSurface surface, const EGLint *attrib_list)
 {
+    CALL_TRACE(eglLockSurfaceKHR);
     return getDispatch()->eglLockSurfaceKHR(display, surface, attrib_list);
 }
 
 EGLBoolean eglUnlockSurfaceKHR(EGLDisplay display, EGLSurface surface)
 {
+    CALL_TRACE(eglUnlockSurfaceKHR);
     return getDispatch()->eglUnlockSurfaceKHR(display, surface);
 }
 
 EGLImageKHR eglCreateImageKHR(EGLDisplay dpy, EGLContext ctx, EGLenum target, EGLClientBuffer buffer, const EGLint *attrib_list)
 {
+    CALL_TRACE(eglCreateImageKHR);
     EGLWrapperContext *wctx = (EGLWrapperContext *)ctx;
     EGLContext aglContext = (wctx ? wctx->aglContext : EGL_NO_CONTEXT);
     return getDispatch()->eglCreateImageKHR(dpy, aglContext, target, buffer, attrib_list);
@@ -629,35 +665,42 @@ EGLImageKHR eglCreateImageKHR(EGLDisplay dpy, EGLContext ctx, EGLenum target, EG
 
 EGLBoolean eglDestroyImageKHR(EGLDisplay dpy, EGLImageKHR image)
 {
+    CALL_TRACE(eglDestroyImageKHR);
     return getDispatch()->eglDestroyImageKHR(dpy, image);
 }
 
 EGLSyncKHR eglCreateSyncKHR(EGLDisplay dpy, EGLenum type, const EGLint *attrib_list)
 {
+    CALL_TRACE(eglCreateSyncKHR);
     return getDispatch()->eglCreateSyncKHR(dpy, type, attrib_list);
 }
 
 EGLBoolean eglDestroySyncKHR(EGLDisplay dpy, EGLSyncKHR sync)
 {
+    CALL_TRACE(eglDestroySyncKHR);
     return getDispatch()->eglDestroySyncKHR(dpy, sync);
 }
 
 EGLint eglClientWaitSyncKHR(EGLDisplay dpy, EGLSyncKHR sync, EGLint flags, EGLTimeKHR timeout)
 {
+    CALL_TRACE(eglClientWaitSyncKHR);
     return getDispatch()->eglClientWaitSyncKHR(dpy, sync, flags, timeout);
 }
 
 EGLBoolean eglSignalSyncKHR(EGLDisplay dpy, EGLSyncKHR sync, EGLenum mode)
 {
+    CALL_TRACE(eglSignalSyncKHR);
     return getDispatch()->eglSignalSyncKHR(dpy, sync, mode);
 }
 
 EGLBoolean eglGetSyncAttribKHR(EGLDisplay dpy, EGLSyncKHR sync, EGLint attribute, EGLint *value)
 {
+    CALL_TRACE(eglGetSyncAttribKHR);
     return getDispatch()->eglGetSyncAttribKHR(dpy, sync, attribute, value);
 }
 
 EGLBoolean eglSetSwapRectangleANDROID(EGLDisplay dpy, EGLSurface draw, EGLint left, EGLint top, EGLint width, EGLint height)
 {
+    CALL_TRACE(eglSetSwapRectangleANDROID);
     return getDispatch()->eglSetSwapRectangleANDROID(dpy, draw, left, top, width, height);
 }
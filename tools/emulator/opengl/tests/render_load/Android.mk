@@ -0,0 +1,69 @@
+LOCAL_PATH := $(call my-dir)
+
+# Load generator for emulator_renderer, see main.cpp. The GLESv1 and
+# renderControl encoders are built for the host from their specs.
+ifeq ($(HOST_OS),linux)
+include $(CLEAR_VARS)
+
+emulatorOpengl := $(LOCAL_PATH)/../..
+EMUGEN := $(HOST_OUT_EXECUTABLES)/emugen
+
+LOCAL_MODULE := emulator_render_load
+LOCAL_MODULE_TAGS := debug
+
+intermediates := $(local-intermediates-dir)
+
+LOCAL_SRC_FILES := \
+    main.cpp \
+    ../../host/libs/libOpenglRender/ShmStream.cpp \
+    ../../system/GLESv1_enc/GLEncoder.cpp \
+    ../../system/GLESv1_enc/GLEncoderUtils.cpp
+
+LOCAL_C_INCLUDES := \
+    $(emulatorOpengl)/host/include/libOpenglRender \
+    $(emulatorOpengl)/host/libs/libOpenglRender \
+    $(emulatorOpengl)/shared/OpenglCodecCommon \
+    $(emulatorOpengl)/shared/OpenglOsUtils \
+    $(emulatorOpengl)/system/GLESv1_enc \
+    $(emulatorOpengl)/system/renderControl_enc \
+    $(intermediates)
+
+LOCAL_STATIC_LIBRARIES := \
+        libOpenglCodecCommon \
+        libOpenglOsUtils \
+        libcutils \
+        liblog
+LOCAL_LDLIBS := -lpthread -lrt
+
+GEN := \
+	$(intermediates)/gl_client_context.cpp \
+	$(intermediates)/gl_enc.cpp \
+	$(intermediates)/gl_enc.h
+
+$(GEN) : PRIVATE_CUSTOM_TOOL := \
+        $(EMUGEN) -E $(intermediates) -i $(emulatorOpengl)/system/GLESv1_enc gl
+$(GEN) : $(EMUGEN) \
+        $(emulatorOpengl)/system/GLESv1_enc/gl.attrib \
+        $(emulatorOpengl)/system/GLESv1_enc/gl.in \
+        $(emulatorOpengl)/system/GLESv1_enc/gl.types
+	$(transform-generated-source)
+
+LOCAL_GENERATED_SOURCES += $(GEN)
+
+GEN := \
+	$(intermediates)/renderControl_client_context.cpp \
+	$(intermediates)/renderControl_enc.cpp \
+	$(intermediates)/renderControl_enc.h
+
+$(GEN) : PRIVATE_CUSTOM_TOOL := \
+        $(EMUGEN) -E $(intermediates) -i $(emulatorOpengl)/system/renderControl_enc renderControl
+$(GEN) : $(EMUGEN) \
+        $(emulatorOpengl)/system/renderControl_enc/renderControl.attrib \
+        $(emulatorOpengl)/system/renderControl_enc/renderControl.in \
+        $(emulatorOpengl)/system/renderControl_enc/renderControl.types
+	$(transform-generated-source)
+
+LOCAL_GENERATED_SOURCES += $(GEN)
+include $(BUILD_HOST_EXECUTABLE)
+
+endif # HOST_OS == linux
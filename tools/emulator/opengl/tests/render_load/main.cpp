@@ -0,0 +1,429 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "TcpStream.h"
+#include "ShmStream.h"
+#include "GLEncoder.h"
+#include "renderControl_enc.h"
+#include "osThread.h"
+#include "TimeUtils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include <algorithm>
+
+//
+// emulator_render_load - opens concurrent connections to a running
+//    emulator_renderer and drives each of them the way an emulated
+//    application would: it creates a context, a window surface and two
+//    color buffers, then renders and posts frames at a given rate.
+//    At the end it reports for each connection the frames sent, the
+//    throughput and the post latency, and the CPU used by the renderer.
+//
+//    The post latency is the time from rcFBPost until the answer of an
+//    rcGetFBParam sent right after it, which the render thread decodes
+//    once the post is done.
+//
+
+static struct {
+    const char *host;
+    int port;
+    int clients;
+    int seconds;
+    int fps;
+    int draws;
+    int width;
+    int height;
+    int texSize;
+    int churn;
+    int config;
+    int rendererPid;
+    bool shm;
+} s_opts = { "127.0.0.1", 4141, 4, 10, 60, 16, 320, 480, 0, 0, 0, 0, false };
+
+static const GLfloat s_triangle[] = {
+    -0.5f, -0.5f, 0.0f,
+     0.5f, -0.5f, 0.0f,
+     0.0f,  0.5f, 0.0f
+};
+
+//
+// MeteredStream - counts the bytes an IOStream sends
+//
+class MeteredStream : public IOStream {
+public:
+    MeteredStream(IOStream *stream, size_t bufSize) :
+        IOStream(bufSize), m_stream(stream), m_bytes(0) {}
+    ~MeteredStream() { delete m_stream; }
+
+    virtual void *allocBuffer(size_t minSize) { return m_stream->allocBuffer(minSize); }
+    virtual int commitBuffer(size_t size) {
+        m_bytes += size;
+        return m_stream->commitBuffer(size);
+    }
+    virtual int commitBufferv(size_t size, const void *data, size_t len) {
+        m_bytes += size + len;
+        return m_stream->commitBufferv(size, data, len);
+    }
+    virtual int writeFully(const void *buf, size_t len) {
+        m_bytes += len;
+        return m_stream->writeFully(buf, len);
+    }
+    virtual const unsigned char *readFully(void *buf, size_t len) {
+        return m_stream->readFully(buf, len);
+    }
+    virtual const unsigned char *read(void *buf, size_t *inout_len) {
+        return m_stream->read(buf, inout_len);
+    }
+
+    unsigned long long bytes() const { return m_bytes; }
+
+private:
+    IOStream *m_stream;
+    unsigned long long m_bytes;
+};
+
+class LoadClient : public osUtils::Thread
+{
+public:
+    LoadClient(int id) : m_id(id), m_frames(0), m_bytes(0), m_failed(false) {}
+
+    virtual int Main();
+    void report(double seconds);
+
+    static void reportHeader();
+
+    int m_id;
+    unsigned int m_frames;
+    unsigned long long m_bytes;
+    std::vector<long long> m_postUS;
+    bool m_failed;
+};
+
+static IOStream *connectRenderer()
+{
+    const size_t bufSize = 1024 * 1024;
+    TcpStream *sock = new TcpStream(bufSize);
+    if (sock->connect(s_opts.host, s_opts.port) < 0) {
+        delete sock;
+        return NULL;
+    }
+
+    IOStream *stream = sock;
+    if (s_opts.shm) {
+        ShmStream *shm = ShmStream::connect(sock, bufSize);
+        if (shm) {
+            stream = shm;
+        }
+    }
+    return new MeteredStream(stream, bufSize);
+}
+
+int LoadClient::Main()
+{
+    MeteredStream *stream = (MeteredStream *)connectRenderer();
+    if (!stream) {
+        fprintf(stderr, "client %d: cannot connect to %s:%d\n",
+                m_id, s_opts.host, s_opts.port);
+        m_failed = true;
+        return -1;
+    }
+
+    renderControl_encoder_context_t *rc = new renderControl_encoder_context_t(stream);
+    GLEncoder *gl = new GLEncoder(stream);
+    GLClientState state;
+    gl->setClientState(&state);
+
+    uint32_t context = rc->rcCreateContext(rc, s_opts.config, 0, 1);
+    uint32_t surface = rc->rcCreateWindowSurface(rc, s_opts.config,
+                                                 s_opts.width, s_opts.height);
+    uint32_t colorBuffers[2];
+    for (int i = 0; i < 2; i++) {
+        colorBuffers[i] = rc->rcCreateColorBuffer(rc, s_opts.width,
+                                                  s_opts.height, GL_RGBA);
+    }
+    rc->rcSetWindowColorBuffer(rc, surface, colorBuffers[0]);
+    if (!context || !surface || !colorBuffers[0] || !colorBuffers[1] ||
+        rc->rcMakeCurrent(rc, context, surface, surface) != EGL_TRUE) {
+        fprintf(stderr, "client %d: cannot set up a context\n", m_id);
+        m_failed = true;
+        delete gl;
+        delete rc;
+        delete stream;
+        return -1;
+    }
+
+    unsigned char *pixels = NULL;
+    if (s_opts.texSize > 0) {
+        pixels = (unsigned char *)calloc(s_opts.texSize * s_opts.texSize, 4);
+        GLuint tex = 1;
+        gl->glGenTextures(gl, 1, &tex);
+        gl->glBindTexture(gl, GL_TEXTURE_2D, tex);
+    }
+
+    gl->glViewport(gl, 0, 0, s_opts.width, s_opts.height);
+    gl->glEnableClientState(gl, GL_VERTEX_ARRAY);
+    gl->glVertexPointer(gl, 3, GL_FLOAT, 0, (void *)s_triangle);
+
+    long long start = GetCurrentTimeUS();
+    long long end = start + s_opts.seconds * 1000000LL;
+    long long frameUS = s_opts.fps > 0 ? 1000000LL / s_opts.fps : 0;
+    long long next = start;
+    int back = 0;
+
+    while (GetCurrentTimeUS() < end) {
+        gl->glClearColor(gl, (m_frames & 0xff) / 255.0f, 0.0f, 0.0f, 1.0f);
+        gl->glClear(gl, GL_COLOR_BUFFER_BIT);
+        if (pixels) {
+            gl->glTexImage2D(gl, GL_TEXTURE_2D, 0, GL_RGBA,
+                             s_opts.texSize, s_opts.texSize, 0,
+                             GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        }
+        for (int d = 0; d < s_opts.draws; d++) {
+            gl->glDrawArrays(gl, GL_TRIANGLES, 0, 3);
+        }
+
+        // swap: post the buffer just drawn, then draw to the other one
+        uint32_t posted = colorBuffers[back];
+        back ^= 1;
+        rc->rcSetWindowColorBuffer(rc, surface, colorBuffers[back]);
+
+        long long t0 = GetCurrentTimeUS();
+        rc->rcFBPost(rc, posted);
+        rc->rcGetFBParam(rc, FB_WIDTH);
+        m_postUS.push_back(GetCurrentTimeUS() - t0);
+        m_frames++;
+
+        // color buffer churn, as when an application resizes its windows
+        if (s_opts.churn > 0 && m_frames % s_opts.churn == 0) {
+            uint32_t old = colorBuffers[back ^ 1];
+            colorBuffers[back ^ 1] = rc->rcCreateColorBuffer(rc, s_opts.width,
+                                                             s_opts.height, GL_RGBA);
+            rc->rcDestroyColorBuffer(rc, old);
+        }
+
+        if (frameUS > 0) {
+            next += frameUS;
+            long long now = GetCurrentTimeUS();
+            if (next > now) {
+                usleep(next - now);
+            } else {
+                next = now;     // late, do not try to catch up
+            }
+        }
+    }
+
+    rc->rcMakeCurrent(rc, 0, 0, 0);
+    rc->rcDestroyWindowSurface(rc, surface);
+    rc->rcDestroyColorBuffer(rc, colorBuffers[0]);
+    rc->rcDestroyColorBuffer(rc, colorBuffers[1]);
+    rc->rcDestroyContext(rc, context);
+    rc->rcGetFBParam(rc, FB_WIDTH);     // wait until the host got it all
+
+    m_bytes = stream->bytes();
+    free(pixels);
+    delete gl;
+    delete rc;
+    delete stream;
+    return 0;
+}
+
+void LoadClient::reportHeader()
+{
+    printf("%6s %8s %8s %10s %10s %10s %10s %10s\n",
+           "client", "frames", "fps", "MB/s",
+           "post avg", "post p50", "post p99", "post max");
+}
+
+void LoadClient::report(double seconds)
+{
+    if (m_failed) {
+        printf("%6d failed\n", m_id);
+        return;
+    }
+
+    std::sort(m_postUS.begin(), m_postUS.end());
+    size_t n = m_postUS.size();
+    long long sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += m_postUS[i];
+    }
+
+    printf("%6d %8u %8.1f %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+           m_id, m_frames, m_frames / seconds,
+           m_bytes / seconds / (1024.0 * 1024.0),
+           n ? sum / 1000.0 / n : 0.0,
+           n ? m_postUS[n / 2] / 1000.0 : 0.0,
+           n ? m_postUS[n * 99 / 100] / 1000.0 : 0.0,
+           n ? m_postUS[n - 1] / 1000.0 : 0.0);
+}
+
+//
+// processCPUTicks - user and system time of process 'pid' in clock ticks,
+//     -1 if it cannot be read
+//
+static long long processCPUTicks(int pid)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return -1;
+    }
+
+    // the command name is in parentheses and may contain spaces
+    char buf[1024];
+    size_t len = fread(buf, 1, sizeof(buf) - 1, fp);
+    fclose(fp);
+    buf[len] = '\0';
+    char *p = strrchr(buf, ')');
+    if (!p) {
+        return -1;
+    }
+
+    unsigned long utime, stime;
+    if (sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+               &utime, &stime) != 2) {
+        return -1;
+    }
+    return (long long)utime + stime;
+}
+
+static void printUsage(const char *progName)
+{
+    fprintf(stderr, "Usage: %s [options]\n", progName);
+    fprintf(stderr, "    -host <name>           - renderer host, default %s\n", s_opts.host);
+    fprintf(stderr, "    -port <portNum>        - renderer TCP port, default %d\n", s_opts.port);
+    fprintf(stderr, "    -clients <num>         - concurrent connections, default %d\n", s_opts.clients);
+    fprintf(stderr, "    -seconds <num>         - duration of the run, default %d\n", s_opts.seconds);
+    fprintf(stderr, "    -fps <num>             - frames per second of each client,\n");
+    fprintf(stderr, "                             0 for as fast as possible, default %d\n", s_opts.fps);
+    fprintf(stderr, "    -draws <num>           - draw calls per frame, default %d\n", s_opts.draws);
+    fprintf(stderr, "    -width <num>           - surface width, default %d\n", s_opts.width);
+    fprintf(stderr, "    -height <num>          - surface height, default %d\n", s_opts.height);
+    fprintf(stderr, "    -texsize <num>         - upload a <num>x<num> texture every frame\n");
+    fprintf(stderr, "    -churn <num>           - replace a color buffer every <num> frames\n");
+    fprintf(stderr, "    -config <num>          - EGL config index, default %d\n", s_opts.config);
+    fprintf(stderr, "    -pid <pid>             - renderer process, to report its CPU usage\n");
+    fprintf(stderr, "    -shm                   - use the shared memory transport\n");
+    exit(-1);
+}
+
+static int intArg(int argc, char *argv[], int *i)
+{
+    int value;
+    if (++*i >= argc || sscanf(argv[*i], "%d", &value) != 1 || value < 0) {
+        printUsage(argv[0]);
+    }
+    return value;
+}
+
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-host")) {
+            if (++i >= argc) {
+                printUsage(argv[0]);
+            }
+            s_opts.host = argv[i];
+        }
+        else if (!strcmp(argv[i], "-port")) {
+            s_opts.port = intArg(argc, argv, &i);
+        }
+        else if (!strcmp(argv[i], "-clients")) {
+            s_opts.clients = intArg(argc, argv, &i);
+        }
+        else if (!strcmp(argv[i], "-seconds")) {
+            s_opts.seconds = intArg(argc, argv, &i);
+        }
+        else if (!strcmp(argv[i], "-fps")) {
+            s_opts.fps = intArg(argc, argv, &i);
+        }
+        else if (!strcmp(argv[i], "-draws")) {
+            s_opts.draws = intArg(argc, argv, &i);
+        }
+        else if (!strcmp(argv[i], "-width")) {
+            s_opts.width = intArg(argc, argv, &i);
+        }
+        else if (!strcmp(argv[i], "-height")) {
+            s_opts.height = intArg(argc, argv, &i);
+        }
+        else if (!strcmp(argv[i], "-texsize")) {
+            s_opts.texSize = intArg(argc, argv, &i);
+        }
+        else if (!strcmp(argv[i], "-churn")) {
+            s_opts.churn = intArg(argc, argv, &i);
+        }
+        else if (!strcmp(argv[i], "-config")) {
+            s_opts.config = intArg(argc, argv, &i);
+        }
+        else if (!strcmp(argv[i], "-pid")) {
+            s_opts.rendererPid = intArg(argc, argv, &i);
+        }
+        else if (!strcmp(argv[i], "-shm")) {
+            s_opts.shm = true;
+        }
+        else {
+            printUsage(argv[0]);
+        }
+    }
+
+    if (s_opts.clients < 1 || s_opts.width < 1 || s_opts.height < 1) {
+        printUsage(argv[0]);
+    }
+
+    long long cpu0 = s_opts.rendererPid ? processCPUTicks(s_opts.rendererPid) : -1;
+    long long t0 = GetCurrentTimeUS();
+
+    std::vector<LoadClient *> clients;
+    for (int i = 0; i < s_opts.clients; i++) {
+        LoadClient *c = new LoadClient(i);
+        if (!c->start()) {
+            fprintf(stderr, "cannot start client %d\n", i);
+            delete c;
+            continue;
+        }
+        clients.push_back(c);
+    }
+
+    unsigned int frames = 0;
+    unsigned long long bytes = 0;
+    for (size_t i = 0; i < clients.size(); i++) {
+        int status;
+        clients[i]->wait(&status);
+        frames += clients[i]->m_frames;
+        bytes += clients[i]->m_bytes;
+    }
+
+    double seconds = (GetCurrentTimeUS() - t0) / 1e6;
+    long long cpu1 = s_opts.rendererPid ? processCPUTicks(s_opts.rendererPid) : -1;
+
+    LoadClient::reportHeader();
+    for (size_t i = 0; i < clients.size(); i++) {
+        clients[i]->report(seconds);
+        delete clients[i];
+    }
+    printf("total: %u frames, %.1f fps, %.2f MB/s in %.1f seconds\n",
+           frames, frames / seconds, bytes / seconds / (1024.0 * 1024.0), seconds);
+
+    if (cpu0 >= 0 && cpu1 >= 0) {
+        printf("renderer CPU: %.1f%%\n",
+               100.0 * (cpu1 - cpu0) / sysconf(_SC_CLK_TCK) / seconds);
+    }
+
+    return 0;
+}
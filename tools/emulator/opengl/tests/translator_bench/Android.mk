@@ -0,0 +1,36 @@
+LOCAL_PATH := $(call my-dir)
+
+# Benchmark of the GLES_CM translator, see main.cpp. It loads the EGL and
+# GLES_CM translators through the libOpenglRender dispatch tables.
+ifeq ($(HOST_OS),linux)
+include $(CLEAR_VARS)
+
+emulatorOpengl := $(LOCAL_PATH)/../..
+
+LOCAL_MODULE := emulator_translator_bench
+LOCAL_MODULE_TAGS := debug
+
+LOCAL_ADDITIONAL_DEPENDENCIES := \
+	$(HOST_OUT_SHARED_LIBRARIES)/libEGL_translator$(HOST_SHLIB_SUFFIX) \
+	$(HOST_OUT_SHARED_LIBRARIES)/libGLES_CM_translator$(HOST_SHLIB_SUFFIX)
+
+LOCAL_SRC_FILES := \
+    main.cpp \
+    ../../host/libs/libOpenglRender/EGLDispatch.cpp \
+    ../../host/libs/libOpenglRender/GLDispatch.cpp
+
+LOCAL_C_INCLUDES := \
+    $(emulatorOpengl)/host/libs/libOpenglRender \
+    $(emulatorOpengl)/shared/OpenglCodecCommon \
+    $(emulatorOpengl)/shared/OpenglOsUtils
+
+LOCAL_STATIC_LIBRARIES := \
+        libOpenglCodecCommon \
+        libOpenglOsUtils \
+        libcutils \
+        liblog
+LOCAL_LDLIBS := -ldl -lpthread -lrt
+
+include $(BUILD_HOST_EXECUTABLE)
+
+endif # HOST_OS == linux
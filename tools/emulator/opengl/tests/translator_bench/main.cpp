@@ -0,0 +1,462 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "EGLDispatch.h"
+#include "GLDispatch.h"
+#include "TimeUtils.h"
+#include <GLES/glext.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+//
+// emulator_translator_bench - times the GLES_CM translator, called
+// directly as the renderer does, on a small pbuffer so the host GL does
+// little more than take the converted data. The cases go through the
+// translator paths which convert or copy what the application gives:
+// fixed point arrays (GLEScontext::convertArrs), in client memory or in
+// buffers (RangeList), indexed draws, point size arrays (drawPointsData),
+// paletted textures (uncompressTexture), the object names
+// (objectNameManager) and eglMakeCurrent.
+//
+// Every case runs once untimed, then 'repeat' times. It prints one line
+// per case: its name, the calls of a run, the median and the minimum
+// ns per call of the runs, and the calls per second of the median run.
+// Lines starting with '#' are comments.
+//
+
+static struct {
+    int repeat;
+    const char *only;   // prefix of the cases to run
+} s_opts = { 5, NULL };
+
+#define MAX_REPEAT 32
+
+#define BENCH_SURFACE_SIZE 64
+
+static EGLDisplay s_dpy;
+static EGLSurface s_surfaces[2];
+static EGLContext s_contexts[2];
+
+struct BenchArg {
+    int count;              // vertices, indices, texels on a side or names
+    GLfixed *verts;
+    GLfixed *texCoords;
+    GLfloat *pointSizes;
+    GLushort *indices;
+    bool indexBuffer;       // the indices are in GL_ELEMENT_ARRAY_BUFFER
+    GLenum format;
+    GLsizei dataSize;
+    unsigned char *data;
+    GLuint *names;
+};
+
+typedef void (*CaseFunc)(BenchArg *arg, int i);
+
+static void runCase(const char *name, int iterations, CaseFunc func, BenchArg *arg)
+{
+    if (s_opts.only && strncmp(name, s_opts.only, strlen(s_opts.only))) {
+        return;
+    }
+
+    // warms the caches, the scratch buffers and the driver up
+    for (int i = 0; i < iterations; i++) {
+        func(arg, i);
+    }
+    s_gl.glFinish();
+
+    long long runs[MAX_REPEAT];
+    for (int r = 0; r < s_opts.repeat; r++) {
+        long long t0 = GetCurrentTimeNS();
+        for (int i = 0; i < iterations; i++) {
+            func(arg, i);
+        }
+        s_gl.glFinish();
+        runs[r] = GetCurrentTimeNS() - t0;
+    }
+    std::sort(runs, runs + s_opts.repeat);
+
+    GLenum err = s_gl.glGetError();
+    if (err != GL_NO_ERROR) {
+        fprintf(stderr, "%s: GL error 0x%x\n", name, err);
+    }
+
+    double median = runs[s_opts.repeat / 2];
+    printf("%-32s %8d %10.1f %10.1f %12.0f\n", name, iterations,
+           median / iterations, (double)runs[0] / iterations,
+           median > 0 ? iterations * 1e9 / median : 0.0);
+}
+
+static void benchDrawArrays(BenchArg *a, int i)
+{
+    s_gl.glDrawArrays(GL_TRIANGLES, 0, a->count);
+}
+
+static void benchDrawElements(BenchArg *a, int i)
+{
+    s_gl.glDrawElements(GL_TRIANGLES, a->count, GL_UNSIGNED_SHORT,
+                        a->indexBuffer ? NULL : a->indices);
+}
+
+// the first vertices of the buffer change before every draw
+static void benchBufferSubDataDraw(BenchArg *a, int i)
+{
+    s_gl.glBufferSubData(GL_ARRAY_BUFFER, 0, 3 * 3 * sizeof(GLfixed), a->verts);
+    s_gl.glDrawArrays(GL_TRIANGLES, 0, a->count);
+}
+
+static void benchDrawPoints(BenchArg *a, int i)
+{
+    s_gl.glDrawArrays(GL_POINTS, 0, a->count);
+}
+
+static void benchDrawPointsElements(BenchArg *a, int i)
+{
+    s_gl.glDrawElements(GL_POINTS, a->count, GL_UNSIGNED_SHORT, a->indices);
+}
+
+static void benchPalettedTexture(BenchArg *a, int i)
+{
+    s_gl.glCompressedTexImage2D(GL_TEXTURE_2D, 0, a->format, a->count, a->count,
+                                0, a->dataSize, a->data);
+}
+
+static void benchGenDeleteTextures(BenchArg *a, int i)
+{
+    s_gl.glGenTextures(a->count, a->names);
+    s_gl.glDeleteTextures(a->count, a->names);
+}
+
+static void benchBindTexture(BenchArg *a, int i)
+{
+    s_gl.glBindTexture(GL_TEXTURE_2D, a->names[i % a->count]);
+}
+
+static void benchBindBuffer(BenchArg *a, int i)
+{
+    s_gl.glBindBuffer(GL_ARRAY_BUFFER, a->names[i % a->count]);
+}
+
+static void benchIsTexture(BenchArg *a, int i)
+{
+    s_gl.glIsTexture(a->names[i % a->count]);
+}
+
+static void benchMakeCurrentSame(BenchArg *a, int i)
+{
+    s_egl.eglMakeCurrent(s_dpy, s_surfaces[0], s_surfaces[0], s_contexts[0]);
+}
+
+static void benchMakeCurrentSwitch(BenchArg *a, int i)
+{
+    s_egl.eglMakeCurrent(s_dpy, s_surfaces[i & 1], s_surfaces[i & 1],
+                         s_contexts[i & 1]);
+}
+
+//
+// fillVertices - 'count' vertices of tiny triangles spread over the
+//     surface, and their texture coordinates
+//
+static void fillVertices(BenchArg *a, int count)
+{
+    a->count = count;
+    a->verts = new GLfixed[count * 3];
+    a->texCoords = new GLfixed[count * 2];
+    a->pointSizes = new GLfloat[count];
+    a->indices = new GLushort[count];
+    srand(1);
+    for (int v = 0; v < count; v++) {
+        GLfixed x = (rand() % 0x20000) - 0x10000;
+        GLfixed y = (rand() % 0x20000) - 0x10000;
+        a->verts[v * 3] = x + (v % 3 == 1 ? 0x400 : 0);
+        a->verts[v * 3 + 1] = y + (v % 3 == 2 ? 0x400 : 0);
+        a->verts[v * 3 + 2] = 0;
+        a->texCoords[v * 2] = rand() % 0x10000;
+        a->texCoords[v * 2 + 1] = rand() % 0x10000;
+        a->pointSizes[v] = 1.0f + (v % 4);
+        // the vertices in reverse, so that they are not in order
+        a->indices[v] = count - 1 - v;
+    }
+}
+
+static void freeVertices(BenchArg *a)
+{
+    delete [] a->verts;
+    delete [] a->texCoords;
+    delete [] a->pointSizes;
+    delete [] a->indices;
+}
+
+static void benchArrays()
+{
+    static const int counts[] = { 48, 768, 12288 };
+    char name[64];
+
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        BenchArg a;
+        memset(&a, 0, sizeof(a));
+        fillVertices(&a, counts[c]);
+        int iterations = 3000000 / counts[c];
+
+        // client memory, converted at every draw
+        s_gl.glEnableClientState(GL_VERTEX_ARRAY);
+        s_gl.glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        s_gl.glVertexPointer(3, GL_FIXED, 0, a.verts);
+        s_gl.glTexCoordPointer(2, GL_FIXED, 0, a.texCoords);
+        snprintf(name, sizeof(name), "fixed_client_draw/%d", a.count);
+        runCase(name, iterations, benchDrawArrays, &a);
+        snprintf(name, sizeof(name), "fixed_client_elements/%d", a.count);
+        runCase(name, iterations, benchDrawElements, &a);
+
+        // buffers, converted once unless they change
+        GLuint buffers[3];
+        s_gl.glGenBuffers(3, buffers);
+        s_gl.glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+        s_gl.glBufferData(GL_ARRAY_BUFFER, a.count * 3 * sizeof(GLfixed),
+                          a.verts, GL_STATIC_DRAW);
+        s_gl.glVertexPointer(3, GL_FIXED, 0, NULL);
+        s_gl.glBindBuffer(GL_ARRAY_BUFFER, buffers[1]);
+        s_gl.glBufferData(GL_ARRAY_BUFFER, a.count * 2 * sizeof(GLfixed),
+                          a.texCoords, GL_STATIC_DRAW);
+        s_gl.glTexCoordPointer(2, GL_FIXED, 0, NULL);
+        snprintf(name, sizeof(name), "fixed_vbo_draw/%d", a.count);
+        runCase(name, iterations, benchDrawArrays, &a);
+        snprintf(name, sizeof(name), "fixed_vbo_elements/%d", a.count);
+        runCase(name, iterations, benchDrawElements, &a);
+
+        s_gl.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[2]);
+        s_gl.glBufferData(GL_ELEMENT_ARRAY_BUFFER, a.count * sizeof(GLushort),
+                          a.indices, GL_STATIC_DRAW);
+        a.indexBuffer = true;
+        snprintf(name, sizeof(name), "fixed_vbo_elements_vbo/%d", a.count);
+        runCase(name, iterations, benchDrawElements, &a);
+        s_gl.glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        a.indexBuffer = false;
+
+        s_gl.glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+        s_gl.glVertexPointer(3, GL_FIXED, 0, NULL);
+        snprintf(name, sizeof(name), "fixed_vbo_update_draw/%d", a.count);
+        runCase(name, iterations, benchBufferSubDataDraw, &a);
+
+        s_gl.glBindBuffer(GL_ARRAY_BUFFER, 0);
+        s_gl.glDeleteBuffers(3, buffers);
+        s_gl.glDisableClientState(GL_VERTEX_ARRAY);
+        s_gl.glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        freeVertices(&a);
+    }
+}
+
+static void benchPoints()
+{
+    static const int counts[] = { 64, 1024, 16384 };
+    char name[64];
+
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        BenchArg a;
+        memset(&a, 0, sizeof(a));
+        fillVertices(&a, counts[c]);
+        int iterations = 1000000 / counts[c];
+
+        s_gl.glEnableClientState(GL_VERTEX_ARRAY);
+        s_gl.glEnableClientState(GL_POINT_SIZE_ARRAY_OES);
+        s_gl.glVertexPointer(3, GL_FIXED, 0, a.verts);
+        s_gl.glPointSizePointerOES(GL_FLOAT, 0, a.pointSizes);
+        snprintf(name, sizeof(name), "point_size_draw/%d", a.count);
+        runCase(name, iterations, benchDrawPoints, &a);
+        snprintf(name, sizeof(name), "point_size_elements/%d", a.count);
+        runCase(name, iterations, benchDrawPointsElements, &a);
+
+        s_gl.glDisableClientState(GL_POINT_SIZE_ARRAY_OES);
+        s_gl.glDisableClientState(GL_VERTEX_ARRAY);
+        freeVertices(&a);
+    }
+}
+
+static void benchPalettedTextures()
+{
+    static const int sizes[] = { 64, 256, 1024 };
+    static const struct {
+        GLenum format;
+        const char *name;
+        int paletteBytes;   // entries times bytes per entry
+        int bitsPerTexel;
+    } formats[] = {
+        { GL_PALETTE8_RGBA8_OES, "palette8_rgba8", 256 * 4, 8 },
+        { GL_PALETTE4_RGB8_OES, "palette4_rgb8", 16 * 3, 4 }
+    };
+    char name[64];
+
+    GLuint tex;
+    s_gl.glGenTextures(1, &tex);
+    s_gl.glBindTexture(GL_TEXTURE_2D, tex);
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            BenchArg a;
+            memset(&a, 0, sizeof(a));
+            a.count = sizes[s];
+            a.format = formats[f].format;
+            a.dataSize = formats[f].paletteBytes +
+                         a.count * a.count * formats[f].bitsPerTexel / 8;
+            a.data = new unsigned char[a.dataSize];
+            srand(1);
+            for (GLsizei i = 0; i < a.dataSize; i++) {
+                a.data[i] = rand();
+            }
+
+            snprintf(name, sizeof(name), "%s_upload/%d", formats[f].name, a.count);
+            runCase(name, a.count >= 1024 ? 20 : 4000000 / (a.count * a.count),
+                    benchPalettedTexture, &a);
+            delete [] a.data;
+        }
+    }
+    s_gl.glBindTexture(GL_TEXTURE_2D, 0);
+    s_gl.glDeleteTextures(1, &tex);
+}
+
+static void benchNames()
+{
+    static const int counts[] = { 100, 10000 };
+    char name[64];
+
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        BenchArg a;
+        memset(&a, 0, sizeof(a));
+        a.count = counts[c];
+        a.names = new GLuint[a.count];
+
+        snprintf(name, sizeof(name), "gen_delete_textures/%d", a.count);
+        runCase(name, 1000000 / a.count, benchGenDeleteTextures, &a);
+
+        s_gl.glGenTextures(a.count, a.names);
+        snprintf(name, sizeof(name), "bind_texture/%d", a.count);
+        runCase(name, 200000, benchBindTexture, &a);
+        snprintf(name, sizeof(name), "is_texture/%d", a.count);
+        runCase(name, 200000, benchIsTexture, &a);
+        s_gl.glBindTexture(GL_TEXTURE_2D, 0);
+        s_gl.glDeleteTextures(a.count, a.names);
+
+        s_gl.glGenBuffers(a.count, a.names);
+        snprintf(name, sizeof(name), "bind_buffer/%d", a.count);
+        runCase(name, 200000, benchBindBuffer, &a);
+        s_gl.glBindBuffer(GL_ARRAY_BUFFER, 0);
+        s_gl.glDeleteBuffers(a.count, a.names);
+
+        delete [] a.names;
+    }
+}
+
+static void benchMakeCurrent()
+{
+    BenchArg a;
+    memset(&a, 0, sizeof(a));
+    runCase("make_current_same", 200000, benchMakeCurrentSame, &a);
+    runCase("make_current_switch", 20000, benchMakeCurrentSwitch, &a);
+    s_egl.eglMakeCurrent(s_dpy, s_surfaces[0], s_surfaces[0], s_contexts[0]);
+}
+
+static bool initEGL()
+{
+    // the translators, unless the environment picks other libraries
+    setenv("ANDROID_EGL_LIB", "libEGL_translator.so", 0);
+    setenv("ANDROID_GLESv1_LIB", "libGLES_CM_translator.so", 0);
+    if (!init_egl_dispatch() || !init_gl_dispatch()) {
+        fprintf(stderr, "cannot load the EGL or GLES_CM library\n");
+        return false;
+    }
+
+    s_dpy = s_egl.eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    EGLint major, minor;
+    if (s_dpy == EGL_NO_DISPLAY || !s_egl.eglInitialize(s_dpy, &major, &minor)) {
+        fprintf(stderr, "cannot initialize EGL\n");
+        return false;
+    }
+
+    static const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_NONE
+    };
+    static const EGLint pbufAttribs[] = {
+        EGL_WIDTH, BENCH_SURFACE_SIZE,
+        EGL_HEIGHT, BENCH_SURFACE_SIZE,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint n;
+    if (!s_egl.eglChooseConfig(s_dpy, configAttribs, &config, 1, &n) || n < 1) {
+        fprintf(stderr, "no pbuffer config\n");
+        return false;
+    }
+    for (int i = 0; i < 2; i++) {
+        s_surfaces[i] = s_egl.eglCreatePbufferSurface(s_dpy, config, pbufAttribs);
+        s_contexts[i] = s_egl.eglCreateContext(s_dpy, config, EGL_NO_CONTEXT, NULL);
+        if (s_surfaces[i] == EGL_NO_SURFACE || s_contexts[i] == EGL_NO_CONTEXT) {
+            fprintf(stderr, "cannot create the surfaces and contexts\n");
+            return false;
+        }
+    }
+    if (!s_egl.eglMakeCurrent(s_dpy, s_surfaces[0], s_surfaces[0], s_contexts[0])) {
+        fprintf(stderr, "eglMakeCurrent failed\n");
+        return false;
+    }
+    s_gl.glViewport(0, 0, BENCH_SURFACE_SIZE, BENCH_SURFACE_SIZE);
+    return true;
+}
+
+static void printUsage(const char *progName)
+{
+    fprintf(stderr, "Usage: %s [options]\n", progName);
+    fprintf(stderr, "    -repeat <num>          - timed runs of each case, default %d\n", s_opts.repeat);
+    fprintf(stderr, "    -only <prefix>         - only the cases whose name starts with <prefix>\n");
+    exit(-1);
+}
+
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-repeat")) {
+            if (++i >= argc || sscanf(argv[i], "%d", &s_opts.repeat) != 1 ||
+                s_opts.repeat < 1 || s_opts.repeat > MAX_REPEAT) {
+                printUsage(argv[0]);
+            }
+        }
+        else if (!strcmp(argv[i], "-only")) {
+            if (++i >= argc) {
+                printUsage(argv[0]);
+            }
+            s_opts.only = argv[i];
+        }
+        else {
+            printUsage(argv[0]);
+        }
+    }
+
+    if (!initEGL()) {
+        return 1;
+    }
+    printf("# %s\n", (const char *)s_gl.glGetString(GL_RENDERER));
+    printf("# %-30s %8s %10s %10s %12s\n",
+           "case", "calls", "median ns", "min ns", "calls/s");
+
+    benchArrays();
+    benchPoints();
+    benchPalettedTextures();
+    benchNames();
+    benchMakeCurrent();
+    return 0;
+}
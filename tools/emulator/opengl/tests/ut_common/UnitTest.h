@@ -0,0 +1,53 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _UT_COMMON_UNIT_TEST_H
+#define _UT_COMMON_UNIT_TEST_H
+
+#include <stdio.h>
+
+//
+// The checks of the ut_* host unit tests, for a single source file test.
+// A failing CHECK prints its condition and the test goes on, main() ends
+// with "return testResult(name);" which prints the outcome and returns
+// the exit status, 1 if any check failed.
+//
+
+static int s_failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        s_failures++; \
+    } \
+} while (0)
+
+// testFailed - counts a failure the test reported itself
+static inline void testFailed()
+{
+    s_failures++;
+}
+
+static inline int testResult(const char *name)
+{
+    if (s_failures) {
+        fprintf(stderr, "%s: %d checks failed\n", name, s_failures);
+        return 1;
+    }
+    printf("%s: passed\n", name);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,17 @@
+LOCAL_PATH := $(call my-dir)
+
+# Unit test of the libOpenglRender HandleTable, see main.cpp.
+include $(CLEAR_VARS)
+
+emulatorOpengl := $(LOCAL_PATH)/../..
+
+LOCAL_MODULE := ut_handle_table
+LOCAL_MODULE_TAGS := debug
+
+LOCAL_SRC_FILES := main.cpp
+
+LOCAL_C_INCLUDES := \
+    $(emulatorOpengl)/host/libs/libOpenglRender \
+    $(emulatorOpengl)/tests/ut_common
+
+include $(BUILD_HOST_EXECUTABLE)
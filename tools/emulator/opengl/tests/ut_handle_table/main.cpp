@@ -0,0 +1,181 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "HandleTable.h"
+#include "UnitTest.h"
+#include <stdio.h>
+
+//
+// ut_handle_table - checks that HandleTable hands out and reuses slots,
+//    and that a stale handle is rejected, including once the generation
+//    of its slot has wrapped around, or when it comes from a table of
+//    another type.
+//
+
+typedef HandleTable<int> IntTable;
+typedef HandleTable<int, 1> OtherTable;
+
+static uint32_t handleIndex(HandleType h) { return h & IntTable::INDEX_MASK; }
+static uint32_t handleGen(HandleType h) { return (h >> IntTable::INDEX_BITS) & IntTable::GEN_MASK; }
+
+static void testAddRemove()
+{
+    IntTable table;
+    CHECK(table.empty());
+    CHECK(table.get(0) == NULL);
+
+    HandleType a = table.add(1);
+    HandleType b = table.add(2);
+    CHECK(a != 0 && b != 0 && a != b);
+    CHECK(table.get(a) && *table.get(a) == 1);
+    CHECK(table.get(b) && *table.get(b) == 2);
+    CHECK(!table.empty());
+
+    CHECK(table.remove(a));
+    CHECK(table.get(a) == NULL);
+    CHECK(!table.remove(a));
+
+    // the slot of 'a' is reused under a new generation
+    HandleType c = table.add(3);
+    CHECK(handleIndex(c) == handleIndex(a));
+    CHECK(c != a);
+    CHECK(table.get(a) == NULL);
+    CHECK(table.get(c) && *table.get(c) == 3);
+
+    // handles out of the table
+    CHECK(table.get(handleIndex(b) + 1) == NULL);
+    CHECK(table.get(IntTable::INDEX_MASK) == NULL);
+
+    CHECK(table.remove(b));
+    CHECK(table.remove(c));
+    CHECK(table.empty());
+}
+
+static void testGenerationWrap()
+{
+    IntTable table;
+    HandleType first = table.add(0);
+    HandleType prev = first;
+    HandleType last = 0;
+
+    // reuse the slot until its generation wraps back to 0
+    for (uint32_t i = 1; i <= IntTable::GEN_MASK + 1; i++) {
+        CHECK(table.remove(prev));
+        HandleType h = table.add(i);
+        CHECK(handleIndex(h) == handleIndex(first));
+        CHECK(handleGen(h) == (i & IntTable::GEN_MASK));
+        CHECK(table.get(prev) == NULL);
+        if (i == IntTable::GEN_MASK) {
+            last = h;
+        }
+        prev = h;
+    }
+
+    // the handle of the last generation before the wrap is stale
+    CHECK(handleGen(last) == IntTable::GEN_MASK);
+    CHECK(table.get(last) == NULL);
+    CHECK(!table.remove(last));
+
+    // and the wrapped one is valid again
+    CHECK(prev == first);
+    CHECK(table.get(prev) && *table.get(prev) == IntTable::GEN_MASK + 1);
+}
+
+static void testTypes()
+{
+    OtherTable contexts;
+    HandleTable<int, 2> windows;
+
+    // the same slot of both tables, under two handles
+    HandleType c = contexts.add(1);
+    HandleType w = windows.add(2);
+    CHECK(handleIndex(c) == handleIndex(w) && handleGen(c) == handleGen(w));
+    CHECK(c != w);
+    CHECK(contexts.get(w) == NULL && windows.get(c) == NULL);
+    CHECK(!contexts.remove(w));
+    CHECK(contexts.get(c) && *contexts.get(c) == 1);
+}
+
+static void testReserve()
+{
+    IntTable table;
+    HandleType a = table.add(1);
+    HandleType first = table.reserve(3);
+    CHECK(first == handleIndex(a) + 1);
+    CHECK(table.reserve(0) == 0);
+    CHECK(table.isPending(first) && table.isPending(first + 2));
+    CHECK(table.get(first) == NULL);
+
+    // add() does not hand out reserved slots
+    HandleType b = table.add(2);
+    CHECK(handleIndex(b) > handleIndex(first + 2));
+
+    CHECK(table.addReserved(first + 1, 5));
+    CHECK(!table.addReserved(first + 1, 6));
+    CHECK(!table.addReserved(b, 6));
+    CHECK(!OtherTable().isPending(first));
+    CHECK(!table.isPending(first + 1));
+    CHECK(table.get(first + 1) && *table.get(first + 1) == 5);
+
+    table.unreserve(first, 3);
+    CHECK(!table.isPending(first) && !table.isPending(first + 2));
+    CHECK(table.get(first + 1) != NULL);
+    CHECK(!table.addReserved(first, 7));
+
+    // the given back slots are reused, the old handles stay invalid
+    HandleType c = table.add(3);
+    CHECK(c != first && c != first + 2);
+    CHECK(table.get(first) == NULL && table.get(first + 2) == NULL);
+}
+
+static void testInsert()
+{
+    IntTable table;
+    HandleType a = table.add(1);
+    CHECK(table.remove(a));
+    HandleType b = table.add(2);
+
+    // restore handles as another table handed them out
+    IntTable restored;
+    CHECK(restored.insert(b, 2));
+    CHECK(!restored.insert(b, 3));
+    CHECK(!restored.insert(0, 3));
+    CHECK(restored.get(b) && *restored.get(b) == 2);
+    CHECK(restored.get(a) == NULL);
+
+    HandleType far = (1 << IntTable::INDEX_BITS) | 10;
+    CHECK(restored.insert(far, 4));
+    CHECK(!OtherTable().insert(b, 2));
+    std::vector<HandleType> handles;
+    restored.getHandles(handles);
+    CHECK(handles.size() == 2);
+    CHECK(std::find(handles.begin(), handles.end(), b) != handles.end());
+    CHECK(std::find(handles.begin(), handles.end(), far) != handles.end());
+
+    // the slots skipped by insert are free
+    HandleType c = restored.add(5);
+    CHECK(handleIndex(c) > handleIndex(b) && handleIndex(c) < handleIndex(far));
+}
+
+int main(int argc, char **argv)
+{
+    testAddRemove();
+    testGenerationWrap();
+    testTypes();
+    testReserve();
+    testInsert();
+
+    return testResult("ut_handle_table");
+}
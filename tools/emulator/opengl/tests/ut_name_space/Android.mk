@@ -0,0 +1,30 @@
+LOCAL_PATH := $(call my-dir)
+
+# Unit test of the translators ShareGroup names, see main.cpp.
+ifeq ($(HOST_OS),linux)
+include $(CLEAR_VARS)
+
+emulatorOpengl := $(LOCAL_PATH)/../..
+
+LOCAL_MODULE := ut_name_space
+LOCAL_MODULE_TAGS := debug
+
+LOCAL_SRC_FILES := main.cpp
+
+LOCAL_C_INCLUDES := \
+    $(emulatorOpengl)/host/libs/Translator/include \
+    $(emulatorOpengl)/shared \
+    $(emulatorOpengl)/shared/OpenglOsUtils \
+    $(emulatorOpengl)/tests/ut_common
+
+LOCAL_STATIC_LIBRARIES := \
+        libOpenglOsUtils \
+        libcutils \
+        liblog
+LOCAL_SHARED_LIBRARIES := \
+        libGLcommon
+LOCAL_LDLIBS := -lpthread
+
+include $(BUILD_HOST_EXECUTABLE)
+
+endif # HOST_OS == linux
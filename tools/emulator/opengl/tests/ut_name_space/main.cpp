@@ -0,0 +1,162 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <GLcommon/objectNameManager.h>
+#include <cutils/atomic.h>
+#include "osThread.h"
+#include "UnitTest.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+//
+// ut_name_space - checks the names of a ShareGroup, first from a single
+//    thread, then while reader threads look up names with getGlobalName,
+//    which does not take the lock, as a writer creates names that force
+//    the array of the NameSpace to grow. A reader must always find the
+//    global name of a name which was created before its lookup.
+//
+
+static ObjectNameManager s_manager;
+
+static void testNames()
+{
+    ShareGroupPtr group = s_manager.createShareGroup((void *)1);
+
+    unsigned int a = group->genName(TEXTURE);
+    unsigned int b = group->genName(TEXTURE);
+    CHECK(a != 0 && b != 0 && a != b);
+    unsigned int globalA = group->getGlobalName(TEXTURE, a);
+    CHECK(globalA != 0);
+    CHECK(group->getGlobalName(TEXTURE, b) != globalA);
+    CHECK(group->getLocalName(TEXTURE, globalA) == a);
+    CHECK(group->isObject(TEXTURE, a));
+    CHECK(!group->isObject(VERTEXBUFFER, a));
+
+    // names picked by the guest, in the array and out of it
+    const unsigned int picked[] = { 1000, NAMESPACE_DENSE_NAMES + 5, 0 };
+    group->createNames(TEXTURE, 3, picked);
+    CHECK(group->isObject(TEXTURE, picked[0]));
+    CHECK(group->isObject(TEXTURE, picked[1]));
+    CHECK(!group->isObject(TEXTURE, 0));
+
+    // the names created before the array grew are still there
+    CHECK(group->getGlobalName(TEXTURE, a) == globalA);
+
+    unsigned int globals[3];
+    const unsigned int deleted[] = { a, picked[1], 12345 };
+    group->deleteNames(TEXTURE, 3, deleted, globals);
+    CHECK(globals[0] == globalA && globals[1] != 0 && globals[2] == 0);
+    CHECK(!group->isObject(TEXTURE, a));
+    CHECK(!group->isObject(TEXTURE, picked[1]));
+    CHECK(group->getGlobalName(TEXTURE, a) == 0);
+    CHECK(group->getLocalName(TEXTURE, globalA) == 0);
+    CHECK(group->isObject(TEXTURE, b));
+
+    // the global names go away with the last share group
+    group = ShareGroupPtr(NULL);
+    s_manager.deleteShareGroup((void *)1);
+}
+
+#define GROWTH_ROUNDS 20
+#define GROWTH_NAMES 20000
+#define GROWTH_READERS 4
+
+// each round creates its names in a group of its own, from an empty array
+static ShareGroupPtr s_groups[GROWTH_ROUNDS];
+static unsigned int s_globals[GROWTH_ROUNDS][GROWTH_NAMES + 1];
+static volatile int32_t s_round;
+static volatile int32_t s_created;     // names 1 to s_created of the round exist
+static volatile int32_t s_done;
+
+class Reader : public osUtils::Thread
+{
+public:
+    Reader(unsigned int seed) : m_seed(seed), m_errors(0), m_lookups(0) {}
+
+    virtual int Main() {
+        while (!android_atomic_acquire_load(&s_done)) {
+            // names 1 to 'created' exist in the group of 'round', even if
+            // the writer went on to the next rounds in between
+            int32_t round = android_atomic_acquire_load(&s_round);
+            int32_t created = android_atomic_acquire_load(&s_created);
+            if (created == 0) {
+                continue;
+            }
+            unsigned int name = 1 + rand_r(&m_seed) % created;
+            if (s_groups[round]->getGlobalName(TEXTURE, name) !=
+                s_globals[round][name]) {
+                m_errors++;
+            }
+            m_lookups++;
+        }
+        return 0;
+    }
+
+    unsigned int m_seed;
+    int m_errors;
+    int m_lookups;
+};
+
+static void testConcurrentGrowth()
+{
+    for (int round = 0; round < GROWTH_ROUNDS; round++) {
+        s_groups[round] = s_manager.createShareGroup((void *)(long)(round + 2));
+    }
+
+    Reader *readers[GROWTH_READERS];
+    for (int i = 0; i < GROWTH_READERS; i++) {
+        readers[i] = new Reader(i + 1);
+        CHECK(readers[i]->start());
+    }
+
+    for (int round = 0; round < GROWTH_ROUNDS; round++) {
+        android_atomic_release_store(0, &s_created);
+        android_atomic_release_store(round, &s_round);
+        for (unsigned int name = 1; name <= GROWTH_NAMES; name++) {
+            s_groups[round]->genName(TEXTURE, name);
+            s_globals[round][name] = s_groups[round]->getGlobalName(TEXTURE, name);
+            android_atomic_release_store(name, &s_created);
+        }
+    }
+    android_atomic_release_store(1, &s_done);
+
+    int errors = 0;
+    int lookups = 0;
+    for (int i = 0; i < GROWTH_READERS; i++) {
+        int status;
+        CHECK(readers[i]->wait(&status));
+        errors += readers[i]->m_errors;
+        lookups += readers[i]->m_lookups;
+        delete readers[i];
+    }
+    if (errors) {
+        fprintf(stderr, "%d of %d concurrent lookups failed\n", errors, lookups);
+        testFailed();
+    }
+
+    for (int round = 0; round < GROWTH_ROUNDS; round++) {
+        CHECK(s_globals[round][GROWTH_NAMES] != 0);
+        s_groups[round] = ShareGroupPtr(NULL);
+        s_manager.deleteShareGroup((void *)(long)(round + 2));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    testNames();
+    testConcurrentGrowth();
+
+    return testResult("ut_name_space");
+}
@@ -0,0 +1,19 @@
+LOCAL_PATH := $(call my-dir)
+
+# Unit test of the GLES_CM translator RangeList, see main.cpp.
+include $(CLEAR_VARS)
+
+emulatorOpengl := $(LOCAL_PATH)/../..
+
+LOCAL_MODULE := ut_range_list
+LOCAL_MODULE_TAGS := debug
+
+LOCAL_SRC_FILES := \
+    main.cpp \
+    ../../host/libs/Translator/GLES_CM/RangeManip.cpp
+
+LOCAL_C_INCLUDES := \
+    $(emulatorOpengl)/host/libs/Translator/GLES_CM \
+    $(emulatorOpengl)/tests/ut_common
+
+include $(BUILD_HOST_EXECUTABLE)
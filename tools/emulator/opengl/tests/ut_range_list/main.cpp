@@ -0,0 +1,194 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "RangeManip.h"
+#include "UnitTest.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//
+// ut_range_list - checks that RangeList merges the ranges it is given
+//    and splits them when a range is deleted from their middle, then runs
+//    random add and delete sequences against a bitmap of the covered
+//    offsets.
+//
+
+//
+// hasRanges - returns true if 'rl' holds exactly the 'count' ranges of
+//     'expected', given as start, end pairs in order.
+//
+static bool hasRanges(const RangeList &rl, const int *expected, int count)
+{
+    if (rl.size() != count) {
+        return false;
+    }
+    RangeList::const_iterator it = rl.begin();
+    for (int i = 0; i < count; i++, it++) {
+        if (it->first != expected[2 * i] || it->second != expected[2 * i + 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void testMerge()
+{
+    RangeList rl;
+    CHECK(rl.empty());
+
+    rl.addRange(Range(10, 10));
+    rl.addRange(Range(40, 10));
+    rl.addRange(Range(0, 0));           // empty ranges are dropped
+    const int disjoint[] = { 10, 20, 40, 50 };
+    CHECK(hasRanges(rl, disjoint, 2));
+
+    rl.addRange(Range(20, 5));          // adjacent
+    rl.addRange(Range(12, 4));          // inside
+    const int adjacent[] = { 10, 25, 40, 50 };
+    CHECK(hasRanges(rl, adjacent, 2));
+
+    rl.addRange(Range(5, 40));          // overlaps both
+    const int merged[] = { 5, 50 };
+    CHECK(hasRanges(rl, merged, 1));
+
+    RangeList other;
+    other.addRange(Range(60, 10));
+    other.addRange(Range(50, 5));
+    rl.addRanges(other);
+    const int added[] = { 5, 55, 60, 70 };
+    CHECK(hasRanges(rl, added, 2));
+
+    rl.clear();
+    CHECK(rl.empty());
+}
+
+static void testSplit()
+{
+    RangeList rl, deleted;
+    rl.addRange(Range(0, 100));
+
+    rl.delRange(Range(40, 20), deleted);
+    const int split[] = { 0, 40, 60, 100 };
+    const int splitDeleted[] = { 40, 60 };
+    CHECK(hasRanges(rl, split, 2));
+    CHECK(hasRanges(deleted, splitDeleted, 1));
+
+    // across the gap, from both ranges
+    deleted.clear();
+    rl.delRange(Range(30, 40), deleted);
+    const int trimmed[] = { 0, 30, 70, 100 };
+    const int trimmedDeleted[] = { 30, 40, 60, 70 };
+    CHECK(hasRanges(rl, trimmed, 2));
+    CHECK(hasRanges(deleted, trimmedDeleted, 2));
+
+    // a range fully covered by the deleted one is reported whole
+    deleted.clear();
+    rl.delRange(Range(60, 50), deleted);
+    const int covered[] = { 0, 30 };
+    const int coveredDeleted[] = { 70, 100 };
+    CHECK(hasRanges(rl, covered, 1));
+    CHECK(hasRanges(deleted, coveredDeleted, 1));
+
+    // nothing to delete
+    deleted.clear();
+    rl.delRange(Range(30, 10), deleted);
+    CHECK(hasRanges(rl, covered, 1));
+    CHECK(deleted.empty());
+
+    RangeList pending;
+    pending.addRange(Range(5, 5));
+    pending.addRange(Range(20, 20));
+    deleted.clear();
+    rl.delRanges(pending, deleted);
+    const int left[] = { 0, 5, 10, 20 };
+    const int leftDeleted[] = { 5, 10, 20, 30 };
+    CHECK(hasRanges(rl, left, 2));
+    CHECK(hasRanges(deleted, leftDeleted, 2));
+}
+
+#define MODEL_SIZE 256
+
+//
+// matchesModel - returns true if 'rl' is the sorted list of disjoint, non
+//     adjacent ranges which covers the offsets set in 'model'.
+//
+static bool matchesModel(const RangeList &rl, const bool *model)
+{
+    bool covered[MODEL_SIZE];
+    memset(covered, 0, sizeof(covered));
+    int prevEnd = -1;
+    for (RangeList::const_iterator it = rl.begin(); it != rl.end(); it++) {
+        if (it->first <= prevEnd || it->second <= it->first ||
+            it->first < 0 || it->second > MODEL_SIZE) {
+            return false;
+        }
+        for (int i = it->first; i < it->second; i++) {
+            covered[i] = true;
+        }
+        prevEnd = it->second;
+    }
+    return memcmp(covered, model, sizeof(covered)) == 0;
+}
+
+static void testRandom()
+{
+    srand(1);
+    for (int run = 0; run < 200; run++) {
+        RangeList rl;
+        bool model[MODEL_SIZE];
+        memset(model, 0, sizeof(model));
+
+        for (int op = 0; op < 50; op++) {
+            int start = rand() % MODEL_SIZE;
+            int size = rand() % (MODEL_SIZE - start + 1);
+            if (rand() % 3) {
+                rl.addRange(Range(start, size));
+                for (int i = start; i < start + size; i++) {
+                    model[i] = true;
+                }
+            }
+            else {
+                RangeList deleted;
+                bool expected[MODEL_SIZE];
+                memset(expected, 0, sizeof(expected));
+                for (int i = start; i < start + size; i++) {
+                    expected[i] = model[i];
+                    model[i] = false;
+                }
+                rl.delRange(Range(start, size), deleted);
+                if (!matchesModel(deleted, expected)) {
+                    fprintf(stderr, "run %d op %d: wrong deleted ranges\n", run, op);
+                    testFailed();
+                    return;
+                }
+            }
+            if (!matchesModel(rl, model)) {
+                fprintf(stderr, "run %d op %d: wrong ranges\n", run, op);
+                testFailed();
+                return;
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    testMerge();
+    testSplit();
+    testRandom();
+
+    return testResult("ut_range_list");
+}
@@ -0,0 +1,24 @@
+LOCAL_PATH := $(call my-dir)
+
+# Unit test of the CRC32C and the packet footers of StreamChecksum, see
+# main.cpp. StreamChecksum.cpp is built here with CHECK_GL_STREAM, which
+# libOpenglCodecCommon does not define by default.
+include $(CLEAR_VARS)
+
+emulatorOpengl := $(LOCAL_PATH)/../..
+
+LOCAL_MODULE := ut_stream_checksum
+LOCAL_MODULE_TAGS := debug
+
+LOCAL_SRC_FILES := \
+    main.cpp \
+    ../../shared/OpenglCodecCommon/StreamChecksum.cpp
+
+LOCAL_C_INCLUDES := \
+    $(emulatorOpengl)/host/include/libOpenglRender \
+    $(emulatorOpengl)/shared/OpenglCodecCommon \
+    $(emulatorOpengl)/tests/ut_common
+
+LOCAL_CFLAGS := -DCHECK_GL_STREAM
+
+include $(BUILD_HOST_EXECUTABLE)
@@ -0,0 +1,162 @@
+/*
+* Copyright (C) 2011 The Android Open Source Project
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "StreamChecksum.h"
+#include "UnitTest.h"
+#include <stdio.h>
+#include <string.h>
+
+//
+// ut_stream_checksum - checks crc32c against known answers (RFC 3720
+//    appendix B.4 and the usual "123456789" check value), at every
+//    alignment and split in pieces. Built with CHECK_GL_STREAM, as
+//    Android.mk does, it also checks that StreamChecksum::check accepts
+//    the packets of a stream in order and rejects a corrupted, lost or
+//    replayed one.
+//
+
+static uint32_t crc32cOf(const void *data, size_t len)
+{
+    return ~crc32c(0xffffffff, data, len);
+}
+
+static void testKnownAnswers()
+{
+    unsigned char buf[32];
+
+    CHECK(crc32cOf("123456789", 9) == 0xe3069283);
+    CHECK(crc32cOf("", 0) == 0);
+
+    memset(buf, 0, sizeof(buf));
+    CHECK(crc32cOf(buf, sizeof(buf)) == 0x8a9136aa);
+
+    memset(buf, 0xff, sizeof(buf));
+    CHECK(crc32cOf(buf, sizeof(buf)) == 0x62a8ab43);
+
+    for (int i = 0; i < 32; i++) {
+        buf[i] = i;
+    }
+    CHECK(crc32cOf(buf, sizeof(buf)) == 0x46dd794e);
+
+    for (int i = 0; i < 32; i++) {
+        buf[i] = 31 - i;
+    }
+    CHECK(crc32cOf(buf, sizeof(buf)) == 0x113fdb5c);
+}
+
+static void testAlignmentAndSplits()
+{
+    const char *check = "123456789";
+    unsigned char buf[16];
+
+    // unaligned heads and tails of the word at a time loops
+    for (int offset = 0; offset < 7; offset++) {
+        memcpy(buf + offset, check, 9);
+        if (crc32cOf(buf + offset, 9) != 0xe3069283) {
+            fprintf(stderr, "wrong crc32c at offset %d\n", offset);
+            testFailed();
+        }
+    }
+
+    // the crc built up over pieces is the crc of the whole
+    for (size_t split = 0; split <= 9; split++) {
+        uint32_t crc = crc32c(0xffffffff, check, split);
+        crc = crc32c(crc, check + split, 9 - split);
+        if (~crc != 0xe3069283) {
+            fprintf(stderr, "wrong crc32c split at %u\n", (unsigned int)split);
+            testFailed();
+        }
+    }
+}
+
+#ifdef CHECK_GL_STREAM
+
+// the footers only need the checksum sequence of the streams
+class NullStream : public IOStream {
+public:
+    NullStream() : IOStream(0) {}
+    virtual void *allocBuffer(size_t minSize) { return NULL; }
+    virtual int commitBuffer(size_t size) { return -1; }
+    virtual const unsigned char *readFully(void *buf, size_t len) { return NULL; }
+    virtual const unsigned char *read(void *buf, size_t *inout_len) { return NULL; }
+    virtual int writeFully(const void *buf, size_t len) { return -1; }
+};
+
+#define PACKET_LEN (8 + 12 + STREAM_CHECKSUM_SIZE)
+
+//
+// makePacket - builds a packet of 'opcode' with a 12 bytes payload and
+//     its footer, as the generated encoders do on 'stream'.
+//
+static void makePacket(IOStream *stream, int opcode, unsigned char *packet)
+{
+    int len = PACKET_LEN;
+    memcpy(packet, &opcode, 4);
+    memcpy(packet + 4, &len, 4);
+    for (int i = 8; i < PACKET_LEN - STREAM_CHECKSUM_SIZE; i++) {
+        packet[i] = opcode + i;
+    }
+
+    StreamChecksum sum(stream);
+    sum.add(packet, 8);
+    sum.add(packet + 8, PACKET_LEN - STREAM_CHECKSUM_SIZE - 8);
+    sum.write(packet + PACKET_LEN - STREAM_CHECKSUM_SIZE);
+}
+
+static void testPackets()
+{
+    NullStream encoder, decoder;
+    unsigned char packet[PACKET_LEN];
+
+    for (int op = 0; op < 3; op++) {
+        makePacket(&encoder, 1000 + op, packet);
+        CHECK(StreamChecksum::check(&decoder, packet, PACKET_LEN));
+    }
+
+    fprintf(stderr, "# the next checks print the rejected packets\n");
+
+    // a flipped bit
+    makePacket(&encoder, 1003, packet);
+    packet[10] ^= 0x10;
+    CHECK(!StreamChecksum::check(&decoder, packet, PACKET_LEN));
+
+    // a lost packet, the decoder gets 1005 while it expects 1004
+    unsigned char lost[PACKET_LEN];
+    makePacket(&encoder, 1004, lost);
+    makePacket(&encoder, 1005, packet);
+    CHECK(!StreamChecksum::check(&decoder, packet, PACKET_LEN));
+
+    // a replayed packet
+    NullStream encoder2, decoder2;
+    makePacket(&encoder2, 2000, packet);
+    CHECK(StreamChecksum::check(&decoder2, packet, PACKET_LEN));
+    CHECK(!StreamChecksum::check(&decoder2, packet, PACKET_LEN));
+
+    // too short to hold a footer
+    CHECK(!StreamChecksum::check(&decoder2, packet, 8));
+}
+
+#endif
+
+int main(int argc, char **argv)
+{
+    testKnownAnswers();
+    testAlignmentAndSplits();
+#ifdef CHECK_GL_STREAM
+    testPackets();
+#endif
+
+    return testResult("ut_stream_checksum");
+}
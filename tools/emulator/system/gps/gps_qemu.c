@@ -153,19 +153,44 @@ Fail:
     return -1;
 }
 
+/* parse a NMEA decimal number ([-]ddd[.ddd]) in place. the digits
+ * are accumulated in an integer and divided once by a power of ten,
+ * which is exact for the 15 digits or less NMEA fields have. parsing
+ * stops at the first unexpected character, like strtod() */
 static double
 str2float( const char*  p, const char*  end )
 {
-    int   result = 0;
-    int   len    = end - p;
-    char  temp[16];
-
-    if (len >= (int)sizeof(temp))
-        return 0.;
-
-    memcpy( temp, p, len );
-    temp[len] = 0;
-    return strtod( temp, NULL );
+    static const double  pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8,
+        1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15
+    };
+    long long  mant   = 0;
+    int        digits = 0;
+    int        frac   = -1;
+    int        neg    = 0;
+
+    if (p < end && (*p == '-' || *p == '+')) {
+        neg = (*p == '-');
+        p++;
+    }
+    for ( ; p < end; p++ ) {
+        int  c = *p - '0';
+
+        if ((unsigned)c < 10) {
+            if (digits == 15)
+                break;
+            mant = mant*10 + c;
+            digits++;
+            if (frac >= 0)
+                frac++;
+        } else if (*p == '.' && frac < 0) {
+            frac = 0;
+        } else
+            break;
+    }
+    if (frac > 0)
+        return (neg ? -mant : mant) / pow10[frac];
+    return neg ? -mant : mant;
 }
 
 /*****************************************************************/
@@ -178,9 +203,31 @@ str2float( const char*  p, const char*  end )
 
 #define  NMEA_MAX_SIZE  83
 
+/* a binary location frame, sent instead of NMEA sentences by emulators
+ * which support it once we ask for it (see gps_state_init). frames are
+ * read from the same stream, their first byte is a zero, which can't
+ * start a NMEA sentence. the layout, in little-endian order, is:
+ *
+ *   offset  size
+ *      0      4    GPS_FRAME_MAGIC
+ *      4      4    GPS_LOCATION_HAS_XXX flags
+ *      8      8    latitude, in degrees (double)
+ *     16      8    longitude, in degrees (double)
+ *     24      8    altitude, in meters (double)
+ *     32      4    speed, in meters per second (float)
+ *     36      4    bearing, in degrees (float)
+ *     40      4    accuracy, in meters (float)
+ *     44      4    padding
+ *     48      8    UTC time of the fix, in milliseconds
+ */
+#define  GPS_FRAME_MAGIC  "\0loc"
+#define  GPS_FRAME_SIZE   56
+#define  GPS_FORMAT_COMMAND  "set-format:binary\n"
+
 typedef struct {
     int     pos;
     int     overflow;
+    int     frame_pos;    /* bytes of the current binary frame, 0 if none */
     int     utc_year;
     int     utc_mon;
     int     utc_day;
@@ -188,6 +235,7 @@ typedef struct {
     GpsLocation  fix;
     gps_location_callback  callback;
     char    in[ NMEA_MAX_SIZE+1 ];
+    char    frame[ GPS_FRAME_SIZE ];
 } NmeaReader;
 
 
@@ -225,6 +273,7 @@ nmea_reader_init( NmeaReader*  r )
 
     r->pos      = 0;
     r->overflow = 0;
+    r->frame_pos = 0;
     r->utc_year = -1;
     r->utc_mon  = -1;
     r->utc_day  = -1;
@@ -407,7 +456,10 @@ nmea_reader_update_speed( NmeaReader*  r,
 
 
 static void
-nmea_reader_parse( NmeaReader*  r )
+nmea_reader_report( NmeaReader*  r );
+
+static void
+nmea_reader_parse( NmeaReader*  r, const char*  p, const char*  end )
 {
    /* we received a complete sentence, now parse it to generate
     * a new GPS fix...
@@ -415,13 +467,13 @@ nmea_reader_parse( NmeaReader*  r )
     NmeaTokenizer  tzer[1];
     Token          tok;
 
-    D("Received: '%.*s'", r->pos, r->in);
-    if (r->pos < 9) {
+    D("Received: '%.*s'", end-p, p);
+    if (end-p < 9) {
         D("Too short. discarded.");
         return;
     }
 
-    nmea_tokenizer_init(tzer, r->in, r->in + r->pos);
+    nmea_tokenizer_init(tzer, p, end);
 #if GPS_DEBUG
     {
         int  n;
@@ -488,6 +540,14 @@ nmea_reader_parse( NmeaReader*  r )
         tok.p -= 2;
         D("unknown sentence '%.*s", tok.end-tok.p, tok.p);
     }
+    nmea_reader_report(r);
+}
+
+
+/* send the current fix to the callback, if any */
+static void
+nmea_reader_report( NmeaReader*  r )
+{
     if (r->fix.flags != 0) {
 #if GPS_DEBUG
         char   temp[256];
@@ -526,26 +586,98 @@ nmea_reader_parse( NmeaReader*  r )
 }
 
 
+/* decode a complete binary location frame */
 static void
-nmea_reader_addc( NmeaReader*  r, int  c )
+nmea_reader_parse_frame( NmeaReader*  r, const char*  frame )
 {
-    if (r->overflow) {
-        r->overflow = (c != '\n');
+    uint32_t  flags;
+    double    d;
+    float     f;
+    int64_t   t;
+
+    memcpy(&flags, frame + 4, sizeof flags);
+    r->fix.flags = flags & (GPS_LOCATION_HAS_LAT_LONG | GPS_LOCATION_HAS_ALTITUDE |
+                            GPS_LOCATION_HAS_SPEED | GPS_LOCATION_HAS_BEARING |
+                            GPS_LOCATION_HAS_ACCURACY);
+
+    memcpy(&d, frame +  8, sizeof d);  r->fix.latitude  = d;
+    memcpy(&d, frame + 16, sizeof d);  r->fix.longitude = d;
+    memcpy(&d, frame + 24, sizeof d);  r->fix.altitude  = d;
+    memcpy(&f, frame + 32, sizeof f);  r->fix.speed     = f;
+    memcpy(&f, frame + 36, sizeof f);  r->fix.bearing   = f;
+    memcpy(&f, frame + 40, sizeof f);  r->fix.accuracy  = f;
+    memcpy(&t, frame + 48, sizeof t);  r->fix.timestamp = t;
+
+    if (memcmp(frame, GPS_FRAME_MAGIC, 4)) {
+        D("bad binary frame magic, discarded.");
+        r->fix.flags = 0;
         return;
     }
+    nmea_reader_report(r);
+}
 
-    if (r->pos >= (int) sizeof(r->in)-1 ) {
-        r->overflow = 1;
-        r->pos      = 0;
-        return;
-    }
 
-    r->in[r->pos] = (char)c;
-    r->pos       += 1;
+/* feed 'len' bytes read from the daemon to the reader. sentences and
+ * frames which are complete within 'buff' are parsed in place, only
+ * the ones split across reads are copied to the reader first */
+static void
+nmea_reader_addbuf( NmeaReader*  r, const char*  buff, int  len )
+{
+    const char*  p   = buff;
+    const char*  end = buff + len;
+
+    while (p < end) {
+        const char*  q;
+        int          n;
+
+        /* the rest of a binary frame */
+        if (r->frame_pos > 0) {
+            n = GPS_FRAME_SIZE - r->frame_pos;
+            if (n > end - p)
+                n = end - p;
+            memcpy(r->frame + r->frame_pos, p, n);
+            r->frame_pos += n;
+            p            += n;
+            if (r->frame_pos == GPS_FRAME_SIZE) {
+                nmea_reader_parse_frame(r, r->frame);
+                r->frame_pos = 0;
+            }
+            continue;
+        }
 
-    if (c == '\n') {
-        nmea_reader_parse( r );
-        r->pos = 0;
+        /* a binary frame can only start between sentences */
+        if (r->pos == 0 && !r->overflow && *p == 0) {
+            if (end - p >= GPS_FRAME_SIZE) {
+                nmea_reader_parse_frame(r, p);
+                p += GPS_FRAME_SIZE;
+            } else {
+                r->frame[0]  = 0;
+                r->frame_pos = 1;
+                p           += 1;
+            }
+            continue;
+        }
+
+        q = memchr(p, '\n', end - p);
+        n = (q != NULL ? q + 1 : end) - p;
+
+        if (r->overflow) {
+            r->overflow = (q == NULL);
+        } else if (r->pos + n > (int) sizeof(r->in)-1) {
+            /* sentence too long, skip it */
+            r->overflow = (q == NULL);
+            r->pos      = 0;
+        } else if (r->pos == 0 && q != NULL) {
+            nmea_reader_parse( r, p, q + 1 );
+        } else {
+            memcpy(r->in + r->pos, p, n);
+            r->pos += n;
+            if (q != NULL) {
+                nmea_reader_parse( r, r->in, r->in + r->pos );
+                r->pos = 0;
+            }
+        }
+        p += n;
     }
 }
 
@@ -728,10 +860,10 @@ gps_state_thread( void*  arg )
                 }
                 else if (fd == gps_fd)
                 {
-                    char  buff[32];
+                    char  buff[1024];
                     D("gps fd event");
                     for (;;) {
-                        int  nn, ret;
+                        int  ret;
 
                         ret = read( fd, buff, sizeof(buff) );
                         if (ret < 0) {
@@ -741,9 +873,10 @@ gps_state_thread( void*  arg )
                                 LOGE("error while reading from gps daemon socket: %s:", strerror(errno));
                             break;
                         }
+                        if (ret == 0)
+                            break;
                         D("received %d bytes: %.*s", ret, ret, buff);
-                        for (nn = 0; nn < ret; nn++)
-                            nmea_reader_addc( reader, buff[nn] );
+                        nmea_reader_addbuf( reader, buff, ret );
                     }
                     D("gps fd event end");
                 }
@@ -774,6 +907,10 @@ gps_state_init( GpsState*  state, GpsCallbacks* callbacks )
 
     D("gps emulation will read from '%s' qemud channel", QEMU_CHANNEL_NAME );
 
+    /* ask for binary location frames, emulators which don't know about
+     * them ignore this and keep sending NMEA sentences */
+    write( state->fd, GPS_FORMAT_COMMAND, sizeof(GPS_FORMAT_COMMAND)-1 );
+
     if ( socketpair( AF_LOCAL, SOCK_STREAM, 0, state->control ) < 0 ) {
         LOGE("could not create thread control socket pair: %s", strerror(errno));
         goto Fail;
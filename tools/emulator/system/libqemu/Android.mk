@@ -3,7 +3,7 @@ LOCAL_PATH := $(call my-dir)
 # The main libqemud library
 include $(CLEAR_VARS)
 LOCAL_MODULE    := libqemu
-LOCAL_SRC_FILES := libqemu.c
+LOCAL_SRC_FILES := libqemu.c qemu_pipe_mux.c
 LOCAL_MODULE_TAGS := debug
 include $(BUILD_STATIC_LIBRARY)
 
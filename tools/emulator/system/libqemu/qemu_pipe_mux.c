@@ -0,0 +1,506 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Set to 1 to enable debugging */
+#define DEBUG  0
+
+#if DEBUG >= 1
+#  define D(...)  fprintf(stderr,"libqemu-mux:" __VA_ARGS__), fprintf(stderr, "\n")
+#endif
+
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include <hardware/qemu_pipe.h>
+#include "qemu_pipe_mux.h"
+
+#ifndef D
+#  define  D(...)   do{}while(0)
+#endif
+
+/* Data received for a channel and not read yet by its user */
+typedef struct MuxBuffer {
+    struct MuxBuffer*  next;
+    size_t             size;
+    size_t             pos;
+    uint8_t*           data;   /* points right after the MuxBuffer */
+} MuxBuffer;
+
+struct QemuMuxChannel {
+    QemuMux*         mux;
+    QemuMuxChannel*  next;
+    uint32_t         id;
+    MuxBuffer*       first;
+    MuxBuffer*       last;
+    size_t           sendCredit;  /* bytes we can send before an ack */
+    size_t           consumed;    /* bytes read but not acknowledged yet */
+    int              closed;      /* closed by the service */
+};
+
+/* The pipe is read by whichever thread needs something from it first,
+ * the frames it gets are dispatched to their channels and the threads
+ * waiting on them are woken up. 'lock' protects everything except the
+ * pipe itself, writes to it are serialized by 'writeLock' so that frames
+ * from different channels are never interleaved.
+ */
+struct QemuMux {
+    int               fd;
+    pthread_mutex_t   lock;
+    pthread_cond_t    cond;
+    pthread_mutex_t   writeLock;
+    int               reading;   /* a thread is reading the pipe */
+    int               broken;    /* the pipe was closed or failed */
+    uint32_t          lastId;
+    QemuMuxChannel*   channels;
+};
+
+static void
+mux_put32(uint8_t*  p, uint32_t  val)
+{
+    p[0] = (uint8_t)(val);
+    p[1] = (uint8_t)(val >> 8);
+    p[2] = (uint8_t)(val >> 16);
+    p[3] = (uint8_t)(val >> 24);
+}
+
+static uint32_t
+mux_get32(const uint8_t*  p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int
+mux_read_fully(int  fd, void*  buff, size_t  len)
+{
+    uint8_t*  p = buff;
+
+    while (len > 0) {
+        int  ret = TEMP_FAILURE_RETRY(read(fd, p, len));
+        if (ret <= 0) {
+            if (ret == 0)
+                errno = ECONNRESET;
+            return -1;
+        }
+        p   += ret;
+        len -= ret;
+    }
+    return 0;
+}
+
+/* Send a frame, the header and payload go out in a single writev() */
+static int
+mux_write_frame(QemuMux*  mux, uint32_t  id, int  type,
+                const void*  data, size_t  size)
+{
+    uint8_t       header[QEMU_MUX_HEADER_SIZE];
+    struct iovec  iov[2];
+    int           count = 2;
+    int           ret   = 0;
+
+    mux_put32(header, id);
+    header[4] = (uint8_t)type;
+    header[5] = (uint8_t)(type >> 8);
+    header[6] = header[7] = 0;
+    mux_put32(header + 8, size);
+
+    iov[0].iov_base = header;
+    iov[0].iov_len  = sizeof header;
+    iov[1].iov_base = (void*)data;
+    iov[1].iov_len  = size;
+
+    pthread_mutex_lock(&mux->writeLock);
+    while (count > 0) {
+        ssize_t  len = TEMP_FAILURE_RETRY(writev(mux->fd, iov + 2 - count, count));
+        if (len <= 0) {
+            if (len == 0)
+                errno = ECONNRESET;
+            ret = -1;
+            break;
+        }
+        while (count > 0 && (size_t)len >= iov[2-count].iov_len) {
+            len -= iov[2-count].iov_len;
+            count--;
+        }
+        if (count > 0) {
+            iov[2-count].iov_base = (uint8_t*)iov[2-count].iov_base + len;
+            iov[2-count].iov_len -= len;
+        }
+    }
+    pthread_mutex_unlock(&mux->writeLock);
+    return ret;
+}
+
+static QemuMuxChannel*
+mux_find(QemuMux*  mux, uint32_t  id)
+{
+    QemuMuxChannel*  ch;
+
+    for (ch = mux->channels; ch != NULL; ch = ch->next)
+        if (ch->id == id)
+            break;
+    return ch;
+}
+
+/* Read one frame from the pipe and dispatch it. This must be called
+ * with mux->lock held and nobody else reading, the lock is released
+ * while waiting for the pipe. */
+static void
+mux_pump(QemuMux*  mux)
+{
+    uint8_t          header[QEMU_MUX_HEADER_SIZE];
+    uint32_t         id, size;
+    int              type;
+    MuxBuffer*       buf = NULL;
+    uint8_t          small[4];
+    QemuMuxChannel*  ch;
+
+    mux->reading = 1;
+    pthread_mutex_unlock(&mux->lock);
+
+    if (mux_read_fully(mux->fd, header, sizeof header) < 0)
+        goto Broken;
+
+    id   = mux_get32(header);
+    type = header[4] | (header[5] << 8);
+    size = mux_get32(header + 8);
+
+    if (type == QEMU_MUX_DATA) {
+        if (size == 0 || size > QEMU_MUX_MAX_FRAME) {
+            D("%s: bad frame size %u", __FUNCTION__, size);
+            goto Broken;
+        }
+        buf = malloc(sizeof(*buf) + size);
+        if (buf == NULL)
+            goto Broken;
+        buf->next = NULL;
+        buf->size = size;
+        buf->pos  = 0;
+        buf->data = (uint8_t*)(buf + 1);
+        if (mux_read_fully(mux->fd, buf->data, size) < 0) {
+            free(buf);
+            goto Broken;
+        }
+    } else {
+        if (size > sizeof small) {
+            D("%s: bad control frame size %u", __FUNCTION__, size);
+            goto Broken;
+        }
+        memset(small, 0, sizeof small);
+        if (size > 0 && mux_read_fully(mux->fd, small, size) < 0)
+            goto Broken;
+    }
+
+    pthread_mutex_lock(&mux->lock);
+    ch = mux_find(mux, id);
+    if (ch == NULL) {
+        D("%s: frame type %d for unknown channel %u", __FUNCTION__, type, id);
+        free(buf);
+    } else if (type == QEMU_MUX_DATA) {
+        if (ch->last)
+            ch->last->next = buf;
+        else
+            ch->first = buf;
+        ch->last = buf;
+    } else if (type == QEMU_MUX_CREDIT) {
+        ch->sendCredit += mux_get32(small);
+    } else if (type == QEMU_MUX_CLOSE) {
+        ch->closed = 1;
+    }
+    mux->reading = 0;
+    pthread_cond_broadcast(&mux->cond);
+    return;
+
+Broken:
+    pthread_mutex_lock(&mux->lock);
+    mux->broken  = 1;
+    mux->reading = 0;
+    pthread_cond_broadcast(&mux->cond);
+}
+
+/* Wait for something to happen on the session, reading the pipe
+ * ourselves if nobody else does. Called with mux->lock held. */
+static void
+mux_wait(QemuMux*  mux)
+{
+    if (!mux->reading)
+        mux_pump(mux);
+    else
+        pthread_cond_wait(&mux->cond, &mux->lock);
+}
+
+QemuMux*
+qemu_mux_open(const char*  pipeName)
+{
+    QemuMux*  mux;
+    uint8_t   version[4];
+    uint8_t   header[QEMU_MUX_HEADER_SIZE];
+    int       fd = qemu_pipe_open(pipeName);
+
+    if (fd < 0)
+        return NULL;
+
+    mux = calloc(1, sizeof(*mux));
+    if (mux == NULL) {
+        close(fd);
+        errno = ENOMEM;
+        return NULL;
+    }
+    mux->fd = fd;
+    pthread_mutex_init(&mux->lock, NULL);
+    pthread_cond_init(&mux->cond, NULL);
+    pthread_mutex_init(&mux->writeLock, NULL);
+
+    /* no other thread knows about the session yet, so the answer to
+     * the hello can be read directly */
+    mux_put32(version, QEMU_MUX_VERSION);
+    if (mux_write_frame(mux, 0, QEMU_MUX_HELLO, version, sizeof version) < 0 ||
+        mux_read_fully(fd, header, sizeof header) < 0 ||
+        mux_get32(header + 8) != sizeof version ||
+        mux_read_fully(fd, version, sizeof version) < 0) {
+        D("%s: no multiplexer on %s pipe: %s", __FUNCTION__, pipeName, strerror(errno));
+        qemu_mux_close(mux);
+        errno = ECONNREFUSED;
+        return NULL;
+    }
+    if (header[4] != QEMU_MUX_HELLO || mux_get32(version) != QEMU_MUX_VERSION) {
+        D("%s: unsupported multiplexer version %u", __FUNCTION__, mux_get32(version));
+        qemu_mux_close(mux);
+        errno = EPROTONOSUPPORT;
+        return NULL;
+    }
+    return mux;
+}
+
+void
+qemu_mux_close(QemuMux*  mux)
+{
+    if (mux == NULL)
+        return;
+
+    if (mux->channels != NULL)
+        D("%s: closing session with open channels", __FUNCTION__);
+
+    close(mux->fd);
+    pthread_mutex_destroy(&mux->writeLock);
+    pthread_cond_destroy(&mux->cond);
+    pthread_mutex_destroy(&mux->lock);
+    free(mux);
+}
+
+QemuMuxChannel*
+qemu_mux_channel_open(QemuMux*  mux)
+{
+    QemuMuxChannel*  ch = calloc(1, sizeof(*ch));
+
+    if (ch == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    ch->mux        = mux;
+    ch->sendCredit = QEMU_MUX_WINDOW;
+
+    pthread_mutex_lock(&mux->lock);
+    do {
+        ch->id = ++mux->lastId;
+    } while (ch->id == 0 || mux_find(mux, ch->id) != NULL);
+    ch->next      = mux->channels;
+    mux->channels = ch;
+    pthread_mutex_unlock(&mux->lock);
+
+    if (mux_write_frame(mux, ch->id, QEMU_MUX_OPEN, NULL, 0) < 0) {
+        qemu_mux_channel_close(ch);
+        return NULL;
+    }
+    return ch;
+}
+
+int
+qemu_mux_channel_send(QemuMuxChannel*  ch, const void*  buff, size_t  len)
+{
+    QemuMux*        mux = ch->mux;
+    const uint8_t*  p   = buff;
+
+    while (len > 0) {
+        size_t  n;
+
+        pthread_mutex_lock(&mux->lock);
+        while (ch->sendCredit == 0 && !ch->closed && !mux->broken)
+            mux_wait(mux);
+
+        if (ch->closed || mux->broken) {
+            pthread_mutex_unlock(&mux->lock);
+            errno = EPIPE;
+            return -1;
+        }
+        n = len;
+        if (n > ch->sendCredit)
+            n = ch->sendCredit;
+        if (n > QEMU_MUX_MAX_FRAME)
+            n = QEMU_MUX_MAX_FRAME;
+        ch->sendCredit -= n;
+        pthread_mutex_unlock(&mux->lock);
+
+        if (mux_write_frame(mux, ch->id, QEMU_MUX_DATA, p, n) < 0)
+            return -1;
+        p   += n;
+        len -= n;
+    }
+    return 0;
+}
+
+int
+qemu_mux_channel_recv(QemuMuxChannel*  ch, void*  buff, size_t  len)
+{
+    QemuMux*  mux   = ch->mux;
+    uint8_t*  p     = buff;
+    size_t    count = 0;
+    size_t    grant = 0;
+
+    pthread_mutex_lock(&mux->lock);
+    while (ch->first == NULL && !ch->closed && !mux->broken)
+        mux_wait(mux);
+
+    if (ch->first == NULL) {
+        int  broken = mux->broken && !ch->closed;
+        pthread_mutex_unlock(&mux->lock);
+        if (broken) {
+            errno = EIO;
+            return -1;
+        }
+        return 0;
+    }
+
+    while (count < len && ch->first != NULL) {
+        MuxBuffer*  buf = ch->first;
+        size_t      n   = buf->size - buf->pos;
+
+        if (n > len - count)
+            n = len - count;
+        memcpy(p + count, buf->data + buf->pos, n);
+        buf->pos += n;
+        count    += n;
+
+        if (buf->pos == buf->size) {
+            ch->first = buf->next;
+            if (ch->first == NULL)
+                ch->last = NULL;
+            free(buf);
+        }
+    }
+
+    /* acknowledge the data in large enough chunks to keep the number
+     * of credit frames low */
+    ch->consumed += count;
+    if (ch->consumed >= QEMU_MUX_WINDOW/2) {
+        grant        = ch->consumed;
+        ch->consumed = 0;
+    }
+    pthread_mutex_unlock(&mux->lock);
+
+    if (grant > 0) {
+        uint8_t  val[4];
+        mux_put32(val, grant);
+        mux_write_frame(mux, ch->id, QEMU_MUX_CREDIT, val, sizeof val);
+    }
+    return (int)count;
+}
+
+void
+qemu_mux_channel_close(QemuMuxChannel*  ch)
+{
+    QemuMux*          mux;
+    QemuMuxChannel**  pnode;
+
+    if (ch == NULL)
+        return;
+
+    mux = ch->mux;
+
+    pthread_mutex_lock(&mux->lock);
+    for (pnode = &mux->channels; *pnode != NULL; pnode = &(*pnode)->next) {
+        if (*pnode == ch) {
+            *pnode = ch->next;
+            break;
+        }
+    }
+    while (ch->first != NULL) {
+        MuxBuffer*  buf = ch->first;
+        ch->first = buf->next;
+        free(buf);
+    }
+    if (!ch->closed && !mux->broken) {
+        pthread_mutex_unlock(&mux->lock);
+        mux_write_frame(mux, ch->id, QEMU_MUX_CLOSE, NULL, 0);
+    } else {
+        pthread_mutex_unlock(&mux->lock);
+    }
+    free(ch);
+}
+
+/** PIPE POOL
+ **/
+
+static struct {
+    char  name[64];
+    int   fd;
+} _pipe_pool[QEMU_PIPE_POOL_MAX];
+
+static int              _pipe_pool_count;
+static pthread_mutex_t  _pipe_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int
+qemu_pipe_pool_get(const char*  pipeName)
+{
+    int  nn, fd = -1;
+
+    pthread_mutex_lock(&_pipe_pool_lock);
+    for (nn = 0; nn < _pipe_pool_count; nn++) {
+        if (!strcmp(_pipe_pool[nn].name, pipeName)) {
+            fd = _pipe_pool[nn].fd;
+            _pipe_pool[nn] = _pipe_pool[--_pipe_pool_count];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&_pipe_pool_lock);
+
+    if (fd < 0)
+        fd = qemu_pipe_open(pipeName);
+    return fd;
+}
+
+void
+qemu_pipe_pool_put(const char*  pipeName, int  fd)
+{
+    if (fd < 0)
+        return;
+
+    pthread_mutex_lock(&_pipe_pool_lock);
+    if (_pipe_pool_count < QEMU_PIPE_POOL_MAX &&
+        strlen(pipeName) < sizeof(_pipe_pool[0].name)) {
+        strcpy(_pipe_pool[_pipe_pool_count].name, pipeName);
+        _pipe_pool[_pipe_pool_count].fd = fd;
+        _pipe_pool_count++;
+        fd = -1;
+    }
+    pthread_mutex_unlock(&_pipe_pool_lock);
+
+    if (fd >= 0)
+        close(fd);
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef QEMU_PIPE_MUX_H
+#define QEMU_PIPE_MUX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A QemuMux runs many logical channels over a single qemu pipe, instead
+ * of opening one /dev/qemu_pipe fd (and one host connection) for each
+ * of them. The pipe service must speak the following protocol.
+ *
+ * Everything is sent as frames made of a 12-byte header followed by
+ * 'size' bytes of payload, all values in little-endian order:
+ *
+ *   offset  size
+ *      0      4    channel id, 0 for the session itself
+ *      4      2    frame type, see QEMU_MUX_XXX below
+ *      6      2    reserved, must be 0
+ *      8      4    payload size
+ *
+ * The guest starts with a QEMU_MUX_HELLO frame on channel 0 carrying
+ * the protocol version as a 32-bit value, the service must answer with
+ * a QEMU_MUX_HELLO frame holding the same version.
+ *
+ * The guest then opens channels with QEMU_MUX_OPEN frames (no payload)
+ * for ids it picks, and closes them with QEMU_MUX_CLOSE. The service
+ * can also send QEMU_MUX_CLOSE to end a channel from its side.
+ *
+ * QEMU_MUX_DATA frames carry at most QEMU_MUX_MAX_FRAME bytes. Each side
+ * of a channel may have at most QEMU_MUX_WINDOW bytes of data not yet
+ * acknowledged by the other one, which acknowledges them with
+ * QEMU_MUX_CREDIT frames holding the number of bytes consumed as a
+ * 32-bit value. This keeps a slow channel from stalling the others on
+ * the shared pipe.
+ */
+#define  QEMU_MUX_VERSION    1
+
+#define  QEMU_MUX_HELLO      0
+#define  QEMU_MUX_OPEN       1
+#define  QEMU_MUX_DATA       2
+#define  QEMU_MUX_CREDIT     3
+#define  QEMU_MUX_CLOSE      4
+
+#define  QEMU_MUX_HEADER_SIZE  12
+#define  QEMU_MUX_MAX_FRAME    16384
+#define  QEMU_MUX_WINDOW       65536
+
+typedef struct QemuMux         QemuMux;
+typedef struct QemuMuxChannel  QemuMuxChannel;
+
+/* Open a multiplexed session to the pipe service 'pipeName', returns
+ * NULL and sets errno on failure. */
+QemuMux*  qemu_mux_open(const char*  pipeName);
+
+/* Close a session, all its channels must have been closed before. */
+void      qemu_mux_close(QemuMux*  mux);
+
+/* Open a new channel in 'mux', returns NULL and sets errno on failure.
+ * Different threads can use different channels of the same session
+ * concurrently. */
+QemuMuxChannel*  qemu_mux_channel_open(QemuMux*  mux);
+
+/* Send 'len' bytes on a channel, blocking while the other side has not
+ * acknowledged enough data. Returns 0, or -1 and sets errno. */
+int   qemu_mux_channel_send(QemuMuxChannel*  ch, const void*  buff, size_t  len);
+
+/* Receive up to 'len' bytes from a channel, blocking until some data is
+ * available. Returns the number of bytes read, 0 if the channel was
+ * closed by the service, or -1 and sets errno. */
+int   qemu_mux_channel_recv(QemuMuxChannel*  ch, void*  buff, size_t  len);
+
+/* Close a channel and release it */
+void  qemu_mux_channel_close(QemuMuxChannel*  ch);
+
+/* A small per-process pool of idle qemu pipe fds, for services whose
+ * connections can be reused once their previous user is done with them.
+ * qemu_pipe_pool_get returns an idle fd connected to 'pipeName' or opens
+ * a new one with qemu_pipe_open, qemu_pipe_pool_put gives it back to the
+ * pool, or closes it if the pool is full. */
+#define  QEMU_PIPE_POOL_MAX  4
+
+int   qemu_pipe_pool_get(const char*  pipeName);
+void  qemu_pipe_pool_put(const char*  pipeName, int  fd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QEMU_PIPE_MUX_H */
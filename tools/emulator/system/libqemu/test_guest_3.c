@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* This program opens a single multiplexed pipe session and runs several
+ * threads on it, each one with its own channel:
+ *
+ *    for count in range(0,1000):
+ *       msg = random data of varying size
+ *       qemu_mux_channel_send(msg)
+ *       qemu_mux_channel_recv(msg2)
+ *       if (msg != msg2):
+ *          error()
+ *
+ * See test_host_3.c for the corresponding server code, which sends back
+ * anything it receives on a channel.
+ */
+#include <errno.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "qemu_pipe_mux.h"
+#include "test_util.h"
+
+#define  PIPE_NAME     "tcp:8012"
+#define  NUM_THREADS   8
+#define  MAX_COUNT     1000
+#define  MAX_SIZE      100000
+
+static QemuMux*  mux;
+
+static void*
+channel_thread(void*  arg)
+{
+    int              index = (int)(intptr_t)arg;
+    QemuMuxChannel*  ch    = qemu_mux_channel_open(mux);
+    uint8_t*         buff  = malloc(MAX_SIZE);
+    uint8_t*         buff2 = malloc(MAX_SIZE);
+    unsigned int     seed  = index;
+    int              count, nn;
+
+    if (ch == NULL || buff == NULL || buff2 == NULL) {
+        fprintf(stderr, "%d: Could not open channel: %s\n", index, strerror(errno));
+        exit(1);
+    }
+
+    for (count = 0; count < MAX_COUNT; count++) {
+        int  len = 1 + rand_r(&seed) % (count % 10 ? 256 : MAX_SIZE);
+        int  pos;
+
+        for (nn = 0; nn < len; nn++)
+            buff[nn] = (uint8_t)(index + count + nn);
+
+        if (qemu_mux_channel_send(ch, buff, len) < 0) {
+            fprintf(stderr, "%d: Sending %d bytes failed: %s\n", index, len, strerror(errno));
+            exit(2);
+        }
+        for (pos = 0; pos < len; ) {
+            int  ret = qemu_mux_channel_recv(ch, buff2 + pos, len - pos);
+            if (ret <= 0) {
+                fprintf(stderr, "%d: Receiving failed (ret=%d): %s\n", index, ret, strerror(errno));
+                exit(3);
+            }
+            pos += ret;
+        }
+        if (memcmp(buff, buff2, len) != 0) {
+            fprintf(stderr, "%d: Message content mismatch!\n", index);
+            exit(4);
+        }
+    }
+
+    qemu_mux_channel_close(ch);
+    free(buff);
+    free(buff2);
+    return NULL;
+}
+
+int main(void)
+{
+    pthread_t  threads[NUM_THREADS];
+    double     time0, time1;
+    int        nn;
+
+    mux = qemu_mux_open(PIPE_NAME);
+    if (mux == NULL) {
+        fprintf(stderr, "Could not open '%s' session: %s\n", PIPE_NAME, strerror(errno));
+        return 1;
+    }
+    printf("Connected to '%s' pipe\n", PIPE_NAME);
+
+    time0 = now_secs();
+    for (nn = 0; nn < NUM_THREADS; nn++)
+        pthread_create(&threads[nn], NULL, channel_thread, (void*)(intptr_t)nn);
+    for (nn = 0; nn < NUM_THREADS; nn++)
+        pthread_join(threads[nn], NULL);
+    time1 = now_secs();
+
+    printf("Closing session\n");
+    qemu_mux_close(mux);
+
+    printf("%d channels x %d messages in %g seconds.\n",
+           NUM_THREADS, MAX_COUNT, time1-time0);
+    return 0;
+}
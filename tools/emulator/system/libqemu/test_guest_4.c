@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* This program benchmarks a QEMUD pipe. It measures:
+ *
+ *  - the round-trip latency of small messages, as percentiles over
+ *    many exchanges with an echo server.
+ *
+ *  - the sustained throughput of bulk transfers for several buffer
+ *    sizes, either as round-trips with an echo server, or one-way
+ *    with the -discard option and a server that drops everything.
+ *
+ * See test_host_1.c for the echo server and test_host_2.c for the
+ * discarding one. Results are printed as CSV lines on stdout, one per
+ * measurement, so they can be compared between runs:
+ *
+ *   test,size,count,p50_us,p90_us,p99_us,max_us,mb_per_s
+ */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include "test_util.h"
+
+#define  PIPE_NAME  "pingpong"
+
+/* total number of bytes sent for each throughput measurement */
+#define  BULK_TOTAL  (32*1024*1024)
+
+static const int  latencySizes[] = { 1, 64, 256, 1024 };
+static const int  bulkSizes[]    = { 256, 1024, 4096, 16384, 65536 };
+
+char* progname;
+
+static void usage(int code)
+{
+    printf("Usage: %s [options]\n\n", progname);
+    printf(
+      "Valid options are:\n\n"
+      "  -? -h --help     Print this message\n"
+      "  -pipe <name>     Use pipe name (default: " PIPE_NAME ")\n"
+      "  -tcp <port>      Use local tcp port\n"
+      "  -count <count>   Number of round-trips per latency test (default: 1000)\n"
+      "  -discard         One-way throughput, for a discarding server\n"
+      "\n"
+    );
+    exit(code);
+}
+
+static int
+pipe_recvFully( Pipe*  pipe, uint8_t*  buff, int  len )
+{
+    while (len > 0) {
+        int  ret = pipe_recv(pipe, buff, len);
+        if (ret <= 0)
+            return -1;
+        buff += ret;
+        len  -= ret;
+    }
+    return 0;
+}
+
+static int
+compare_doubles( const void*  a, const void*  b )
+{
+    double  da = *(const double*)a, db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+/* measure 'count' round-trips of 'size' bytes */
+static int
+bench_latency( Pipe*  pipe, uint8_t*  buff, int  size, int  count )
+{
+    double*  times = malloc(count * sizeof(double));
+    int      nn;
+
+    if (times == NULL)
+        return -1;
+
+    for (nn = 0; nn < count; nn++) {
+        double  t0 = now_secs();
+        if (pipe_send(pipe, buff, size) < 0 ||
+            pipe_recvFully(pipe, buff, size) < 0) {
+            fprintf(stderr, "latency: round-trip %d of %d bytes failed\n", nn, size);
+            free(times);
+            return -1;
+        }
+        times[nn] = (now_secs() - t0) * 1e6;
+    }
+
+    qsort(times, count, sizeof(double), compare_doubles);
+    printf("latency,%d,%d,%.1f,%.1f,%.1f,%.1f,\n", size, count,
+           times[count*50/100], times[count*90/100], times[count*99/100],
+           times[count-1]);
+    free(times);
+    return 0;
+}
+
+/* send BULK_TOTAL bytes in 'size' chunks, reading them back unless
+ * 'discard' is set */
+static int
+bench_throughput( Pipe*  pipe, uint8_t*  buff, int  size, int  discard )
+{
+    int     count = BULK_TOTAL / size;
+    int     nn;
+    double  t0 = now_secs(), t1;
+
+    for (nn = 0; nn < count; nn++) {
+        if (pipe_send(pipe, buff, size) < 0 ||
+            (!discard && pipe_recvFully(pipe, buff, size) < 0)) {
+            fprintf(stderr, "throughput: transfer %d of %d bytes failed\n", nn, size);
+            return -1;
+        }
+    }
+    t1 = now_secs();
+
+    printf("%s,%d,%d,,,,,%.2f\n", discard ? "send" : "echo", size, count,
+           (1.0*count*size/(1024.*1024.)) / (t1 - t0));
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    Pipe        pipe[1];
+    const char* tcpPort = NULL;
+    const char* pipeName = NULL;
+    int         count = 1000;
+    int         discard = 0;
+    uint8_t*    buffer;
+    int         nn;
+
+    /* Extract program name */
+    {
+        char* p = strrchr(argv[0], '/');
+        if (p == NULL)
+            progname = argv[0];
+        else
+            progname = p+1;
+    }
+
+    /* Parse options */
+    while (argc > 1 && argv[1][0] == '-') {
+        char* arg = argv[1];
+        if (!strcmp(arg, "-?") || !strcmp(arg, "-h") || !strcmp(arg, "--help")) {
+            usage(0);
+        } else if (!strcmp(arg, "-pipe") || !strcmp(arg, "-tcp") || !strcmp(arg, "-count")) {
+            if (argc < 3) {
+                fprintf(stderr, "%s option needs an argument! See --help for details.\n", arg);
+                exit(1);
+            }
+            argc--;
+            argv++;
+            if (!strcmp(arg, "-pipe"))
+                pipeName = argv[1];
+            else if (!strcmp(arg, "-tcp"))
+                tcpPort = argv[1];
+            else
+                count = atoi(argv[1]);
+        } else if (!strcmp(arg, "-discard")) {
+            discard = 1;
+        } else {
+            fprintf(stderr, "UNKNOWN OPTION: %s\n\n", arg);
+            usage(1);
+        }
+        argc--;
+        argv++;
+    }
+
+    /* Check arguments */
+    if (tcpPort && pipeName) {
+        fprintf(stderr, "You can't use both -pipe and -tcp at the same time\n");
+        exit(2);
+    }
+    if (count <= 0) {
+        fprintf(stderr, "Invalid count\n");
+        exit(2);
+    }
+
+    /* Open the pipe */
+    if (tcpPort != NULL) {
+        int  port = atoi(tcpPort);
+        if (port <= 0 || port > 65535) {
+            fprintf(stderr, "Invalid port number: %s\n", tcpPort);
+            exit(2);
+        }
+        if (pipe_openSocket(pipe, port) < 0) {
+            fprintf(stderr, "Could not open tcp socket!\n");
+            return 1;
+        }
+    } else {
+        if (pipeName == NULL)
+            pipeName = PIPE_NAME;
+        if (pipe_openQemuPipe(pipe, pipeName) < 0) {
+            fprintf(stderr, "Could not open '%s' pipe: %s\n", pipeName, strerror(errno));
+            return 1;
+        }
+    }
+
+    buffer = malloc(bulkSizes[sizeof(bulkSizes)/sizeof(bulkSizes[0]) - 1]);
+    if (buffer == NULL) {
+        fprintf(stderr, "Not enough memory\n");
+        return 1;
+    }
+    memset(buffer, 0x55, bulkSizes[sizeof(bulkSizes)/sizeof(bulkSizes[0]) - 1]);
+
+    printf("test,size,count,p50_us,p90_us,p99_us,max_us,mb_per_s\n");
+
+    /* a discarding server never answers, so only measure latency
+     * against an echo one */
+    if (!discard) {
+        for (nn = 0; nn < (int)(sizeof(latencySizes)/sizeof(latencySizes[0])); nn++)
+            if (bench_latency(pipe, buffer, latencySizes[nn], count) < 0)
+                return 3;
+    }
+
+    for (nn = 0; nn < (int)(sizeof(bulkSizes)/sizeof(bulkSizes[0])); nn++)
+        if (bench_throughput(pipe, buffer, bulkSizes[nn], discard) < 0)
+            return 4;
+
+    pipe_close(pipe);
+    free(buffer);
+    return 0;
+}
@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* This program is used to test the multiplexed qemu pipe sessions of
+ * qemu_pipe_mux.c, see test_guest_3.c for the corresponding client.
+ *
+ * The program acts as a simple TCP server that speaks the multiplexer
+ * protocol described in qemu_pipe_mux.h, and sends back anything it
+ * receives on a channel to the same channel.
+ */
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include "qemu_pipe_mux.h"
+
+/* Default port number */
+#define  DEFAULT_PORT  8012
+
+/* Try to execute x, looping around EINTR errors. */
+#undef TEMP_FAILURE_RETRY
+#define TEMP_FAILURE_RETRY(exp) ({         \
+    typeof (exp) _rc;                      \
+    do {                                   \
+        _rc = (exp);                       \
+    } while (_rc == -1 && errno == EINTR); \
+    _rc; })
+
+#define TFR TEMP_FAILURE_RETRY
+
+/* Close a socket, preserving the value of errno */
+static void
+socket_close(int  sock)
+{
+    int  old_errno = errno;
+    close(sock);
+    errno = old_errno;
+}
+
+/* Create a server socket bound to a loopback port */
+static int
+socket_loopback_server( int port, int type )
+{
+    struct sockaddr_in  addr;
+
+    int  sock = socket(AF_INET, type, 0);
+    if (sock < 0) {
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int n = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &n, sizeof(n));
+
+    if (TFR(bind(sock, (struct sockaddr*)&addr, sizeof(addr))) < 0) {
+        socket_close(sock);
+        return -1;
+    }
+
+    if (type == SOCK_STREAM) {
+        if (TFR(listen(sock, 4)) < 0) {
+            socket_close(sock);
+            return -1;
+        }
+    }
+
+    return sock;
+}
+
+static int
+read_fully(int  fd, void*  buff, size_t  len)
+{
+    uint8_t*  p = buff;
+    while (len > 0) {
+        int  ret = TFR(read(fd, p, len));
+        if (ret <= 0)
+            return -1;
+        p   += ret;
+        len -= ret;
+    }
+    return 0;
+}
+
+static int
+write_fully(int  fd, const void*  buff, size_t  len)
+{
+    const uint8_t*  p = buff;
+    while (len > 0) {
+        int  ret = TFR(write(fd, p, len));
+        if (ret <= 0)
+            return -1;
+        p   += ret;
+        len -= ret;
+    }
+    return 0;
+}
+
+static void
+put32(uint8_t*  p, uint32_t  val)
+{
+    p[0] = (uint8_t)val;
+    p[1] = (uint8_t)(val >> 8);
+    p[2] = (uint8_t)(val >> 16);
+    p[3] = (uint8_t)(val >> 24);
+}
+
+static uint32_t
+get32(const uint8_t*  p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int
+send_frame(int  fd, uint32_t  id, int  type, const void*  data, uint32_t  size)
+{
+    uint8_t  header[QEMU_MUX_HEADER_SIZE];
+
+    put32(header, id);
+    header[4] = (uint8_t)type;
+    header[5] = (uint8_t)(type >> 8);
+    header[6] = header[7] = 0;
+    put32(header + 8, size);
+
+    if (write_fully(fd, header, sizeof header) < 0)
+        return -1;
+    return write_fully(fd, data, size);
+}
+
+/* Main program */
+int main(void)
+{
+    int sock, client;
+    int port = DEFAULT_PORT;
+
+    printf("Starting multiplexer test server on local port %d\n", port);
+    sock = socket_loopback_server( port, SOCK_STREAM );
+    if (sock < 0) {
+        fprintf(stderr, "Could not start server: %s\n", strerror(errno));
+        return 1;
+    }
+
+RESTART:
+    client = TFR(accept(sock, NULL, NULL));
+    if (client < 0) {
+        fprintf(stderr, "Server error: %s\n", strerror(errno));
+        return 2;
+    }
+    printf("Client connected!\n");
+
+    /* Now, read frames and echo data frames to their channel. The data
+     * is consumed as soon as it is sent back, so each data frame is
+     * acknowledged right away. */
+    for (;;) {
+        uint8_t   header[QEMU_MUX_HEADER_SIZE];
+        uint8_t   buff[QEMU_MUX_MAX_FRAME];
+        uint8_t   val[4];
+        uint32_t  id, size;
+        int       type;
+
+        if (read_fully(client, header, sizeof header) < 0)
+            break;
+
+        id   = get32(header);
+        type = header[4] | (header[5] << 8);
+        size = get32(header + 8);
+
+        if (size > sizeof buff) {
+            fprintf(stderr, "Frame too large: %u bytes\n", size);
+            break;
+        }
+        if (read_fully(client, buff, size) < 0)
+            break;
+
+        switch (type) {
+        case QEMU_MUX_HELLO:
+            printf("Client protocol version %u\n", get32(buff));
+            put32(val, QEMU_MUX_VERSION);
+            send_frame(client, 0, QEMU_MUX_HELLO, val, sizeof val);
+            break;
+        case QEMU_MUX_OPEN:
+            printf("Channel %u opened\n", id);
+            break;
+        case QEMU_MUX_CLOSE:
+            printf("Channel %u closed\n", id);
+            break;
+        case QEMU_MUX_DATA:
+            send_frame(client, id, QEMU_MUX_DATA, buff, size);
+            put32(val, size);
+            send_frame(client, id, QEMU_MUX_CREDIT, val, sizeof val);
+            break;
+        case QEMU_MUX_CREDIT:
+            break;
+        default:
+            fprintf(stderr, "Unknown frame type %d\n", type);
+        }
+    }
+    printf("Client closed connection\n");
+    socket_close(client);
+    goto RESTART;
+
+    return 0;
+}
@@ -28,3 +28,26 @@ LOCAL_SRC_FILES := test_guest_2.c test_util.c
 LOCAL_MODULE_TAGS := debug
 LOCAL_STATIC_LIBRARIES := libqemu libcutils
 include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := test-libqemu-3
+LOCAL_SRC_FILES := test_host_3.c
+LOCAL_MODULE_TAGS := debug
+include $(BUILD_HOST_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := test-libqemu-3
+LOCAL_SRC_FILES := test_guest_3.c test_util.c
+LOCAL_MODULE_TAGS := debug
+LOCAL_STATIC_LIBRARIES := libqemu libcutils
+include $(BUILD_EXECUTABLE)
+
+# The benchmark program runs against test-libqemu-1 (round-trips), or
+# test-libqemu-2 with its -discard option (one-way throughput).
+#
+include $(CLEAR_VARS)
+LOCAL_MODULE := test-libqemu-bench
+LOCAL_SRC_FILES := test_guest_4.c test_util.c
+LOCAL_MODULE_TAGS := debug
+LOCAL_STATIC_LIBRARIES := libqemu libcutils
+include $(BUILD_EXECUTABLE)
@@ -60,18 +60,140 @@ rgb_to_brightness( struct light_state_t const* state )
             + (150 * ((color >> 8) & 0x00ff)) + (29 * (color & 0x00ff))) >> 8;
 }
 
-/* set backlight brightness by LIGHTS_SERVICE_NAME service. */
-static int
-set_light_backlight( struct light_device_t* dev, struct light_state_t const* state )
+/* Light updates are not sent by the caller, they are recorded in the
+ * table below and sent by a single writer thread over a qemud channel
+ * that stays open. Only the latest brightness of each light is kept, so
+ * a fast animation sends at most one command per light for each write
+ * the channel can take, and values equal to the last one sent are
+ * dropped.
+ */
+enum {
+    LIGHT_LCD_BACKLIGHT = 0,
+    LIGHT_COUNT
+};
+
+/* name of each light in the "power:light:brightness:<name>:<value>"
+ * commands of the LIGHTS_SERVICE_NAME service */
+static const char* const  _light_names[LIGHT_COUNT] = {
+    "lcd_backlight",
+};
+
+typedef struct {
+    int  pending;     /* brightness to send, or -1 */
+    int  sent;        /* last brightness sent, or -1 */
+} LightState;
+
+static pthread_once_t   _lights_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t  _lights_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   _lights_cond = PTHREAD_COND_INITIALIZER;
+static LightState       _lights[LIGHT_COUNT];
+static int              _lights_writer_ok;
+
+static void*
+lights_writer( void* arg )
+{
+    int  fd = -1;
+
+    pthread_mutex_lock( &_lights_lock );
+    for (;;) {
+        int  values[LIGHT_COUNT];
+        int  nn, count = 0;
+
+        for (nn = 0; nn < LIGHT_COUNT; nn++) {
+            values[nn] = _lights[nn].pending;
+            _lights[nn].pending = -1;
+            if (values[nn] >= 0)
+                count++;
+        }
+        if (count == 0) {
+            pthread_cond_wait( &_lights_cond, &_lights_lock );
+            continue;
+        }
+        pthread_mutex_unlock( &_lights_lock );
+
+        for (nn = 0; nn < LIGHT_COUNT; nn++) {
+            char  buffer[64];
+
+            if (values[nn] < 0)
+                continue;
+
+            if (fd < 0) {
+                fd = qemud_channel_open( LIGHTS_SERVICE_NAME );
+                if (fd < 0) {
+                    E( "%s: no qemud connection", __FUNCTION__ );
+                    values[nn] = -1;
+                    continue;
+                }
+            }
+
+            snprintf( buffer, sizeof(buffer), "power:light:brightness:%s:%d",
+                      _light_names[nn], values[nn] );
+            D( "%s: command: %s", __FUNCTION__, buffer );
+
+            if (qemud_channel_send( fd, buffer, -1 ) < 0) {
+                E( "%s: could not set %s: %s", __FUNCTION__,
+                   _light_names[nn], strerror(errno) );
+                close( fd );
+                fd = -1;
+                values[nn] = -1;
+            }
+        }
+
+        pthread_mutex_lock( &_lights_lock );
+        for (nn = 0; nn < LIGHT_COUNT; nn++) {
+            if (values[nn] >= 0)
+                _lights[nn].sent = values[nn];
+        }
+    }
+    return NULL;
+}
+
+static void
+lights_writer_init( void )
 {
-    /* Get Lights service. */
-    int  fd = qemud_channel_open( LIGHTS_SERVICE_NAME );
+    pthread_t       thread;
+    pthread_attr_t  attr;
+    int             nn;
 
-    if (fd < 0) {
-        E( "%s: no qemud connection", __FUNCTION__ );
+    for (nn = 0; nn < LIGHT_COUNT; nn++) {
+        _lights[nn].pending = -1;
+        _lights[nn].sent    = -1;
+    }
+
+    pthread_attr_init( &attr );
+    pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_DETACHED );
+    if (pthread_create( &thread, &attr, lights_writer, NULL ) != 0) {
+        E( "%s: could not create writer thread: %s", __FUNCTION__, strerror(errno) );
+    } else {
+        _lights_writer_ok = 1;
+    }
+    pthread_attr_destroy( &attr );
+}
+
+/* record a new brightness for 'light', returns immediately */
+static int
+lights_update( int light, int brightness )
+{
+    pthread_once( &_lights_once, lights_writer_init );
+    if (!_lights_writer_ok)
         return -1;
+
+    pthread_mutex_lock( &_lights_lock );
+    if (brightness == _lights[light].sent) {
+        /* cancel an update that would only be undone */
+        _lights[light].pending = -1;
+    } else if (brightness != _lights[light].pending) {
+        _lights[light].pending = brightness;
+        pthread_cond_signal( &_lights_cond );
     }
+    pthread_mutex_unlock( &_lights_lock );
+    return 0;
+}
 
+/* set backlight brightness by LIGHTS_SERVICE_NAME service. */
+static int
+set_light_backlight( struct light_device_t* dev, struct light_state_t const* state )
+{
     D( "%s: On/Off %d/%d flashMode %d brightnessMode %d"
        " RGB = 0x%08x", __func__,
        state->flashOnMS,
@@ -80,21 +202,7 @@ set_light_backlight( struct light_device_t* dev, struct light_state_t const* sta
        state->brightnessMode,
        state->color );
 
-    int brightness = rgb_to_brightness( state );
-
-    char buffer[64];
-    snprintf( buffer, sizeof(buffer), "power:light:brightness:lcd_backlight:%d", brightness );
-    D( "%s: lcd_backlight command: %s", __FUNCTION__, buffer );
-
-    /* send backlight command to perform the backlight setting. */
-    if (qemud_channel_send( fd, buffer, -1 ) < 0) {
-        E( "%s: could not query lcd_backlight: %s", __FUNCTION__, strerror(errno) );
-        close( fd );
-        return -1;
-    }
-
-    close( fd );
-    return 0;
+    return lights_update( LIGHT_LCD_BACKLIGHT, rgb_to_brightness( state ) );
 }
 
 static int
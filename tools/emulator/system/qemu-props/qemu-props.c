@@ -35,13 +35,77 @@
 
 #include <cutils/properties.h>
 #include <unistd.h>
+#include <string.h>
 #include <hardware/qemud.h>
 
 /* Name of the qemud service we want to connect to.
  */
 #define  QEMUD_SERVICE  "boot-properties"
 
-#define  MAX_TRIES      5
+/* qemud is usually up when we start, so retry quickly at first, then
+ * back off up to one second between tries, for about 5 seconds overall.
+ */
+#define  FIRST_DELAY_US   10000
+#define  MAX_DELAY_US     1000000
+#define  TOTAL_DELAY_US   5000000
+
+/* the largest message a qemud channel can carry */
+#define  BULK_SIZE_MAX    65535
+
+/* set property 'prop' from a "name=value" string, returns 1 on success */
+static int
+set_property(char*  prop)
+{
+    char*  q = strchr(prop, '=');
+
+    /* separate propery name from value */
+    if (q == NULL) {
+        DD("invalid format, ignored.");
+        return 0;
+    }
+    *q++ = '\0';
+
+    if (property_set(prop, q) < 0) {
+        DD("could not set property '%s' to '%s'", prop, q);
+        return 0;
+    }
+    return 1;
+}
+
+/* ask for all properties at once with the 'list-all' command, the
+ * answer is a single message with all the "name=value" strings, each
+ * one terminated by a NUL byte (a lone NUL byte if there are none).
+ * returns the number of properties set,
+ * or -1 if the service doesn't support the command.
+ */
+static int
+bulk_fetch(int  qemud_fd)
+{
+    static char  buff[BULK_SIZE_MAX+1];
+    char*        p;
+    char*        end;
+    int          len, count = 0;
+
+    if (qemud_channel_send(qemud_fd, "list-all", -1) < 0)
+        return -1;
+
+    len = qemud_channel_recv(qemud_fd, buff, BULK_SIZE_MAX);
+
+    /* older emulators answer "KO:<reason>" to unknown commands */
+    if (len < 0 || (len >= 3 && !memcmp(buff, "KO:", 3))) {
+        DD("no bulk property support in '%s' service", QEMUD_SERVICE);
+        return -1;
+    }
+    buff[len] = '\0';
+
+    for (p = buff, end = buff + len; p < end; p += strlen(p) + 1) {
+        if (*p == '\0')
+            continue;
+        DD("received: %s", p);
+        count += set_property(p);
+    }
+    return count;
+}
 
 int  main(void)
 {
@@ -49,25 +113,38 @@ int  main(void)
 
     /* try to connect to the qemud service */
     {
-        int  tries = MAX_TRIES;
+        int  delay = FIRST_DELAY_US;
+        int  total = 0;
 
         while (1) {
             qemud_fd = qemud_channel_open( "boot-properties" );
             if (qemud_fd >= 0)
                 break;
 
-            if (--tries <= 0) {
+            if (total >= TOTAL_DELAY_US) {
                 DD("Could not connect after too many tries. Aborting");
                 return 1;
             }
 
-            DD("waiting 1s to wait for qemud.");
-            sleep(1);
+            DD("waiting %d ms for qemud.", delay / 1000);
+            usleep(delay);
+            total += delay;
+            delay *= 2;
+            if (delay > MAX_DELAY_US)
+                delay = MAX_DELAY_US;
         }
     }
 
     DD("connected to '%s' qemud service.", QEMUD_SERVICE);
 
+    count = bulk_fetch(qemud_fd);
+    if (count >= 0) {
+        close(qemud_fd);
+        DD("exiting (%d properties set).", count);
+        return 0;
+    }
+    count = 0;
+
     /* send the 'list' command to the service */
     if (qemud_channel_send(qemud_fd, "list", -1) < 0) {
         DD("could not send command to '%s' service", QEMUD_SERVICE);
@@ -81,7 +158,6 @@ int  main(void)
     {
 #define  BUFF_SIZE   (PROPERTY_KEY_MAX + PROPERTY_VALUE_MAX + 2)
         DD("receiving..");
-        char* q;
         char  temp[BUFF_SIZE];
         int   len = qemud_channel_recv(qemud_fd, temp, sizeof temp - 1);
 
@@ -93,19 +169,7 @@ int  main(void)
 
         DD("received: %.*s", len, temp);
 
-        /* separate propery name from value */
-        q = strchr(temp, '=');
-        if (q == NULL) {
-            DD("invalid format, ignored.");
-            continue;
-        }
-        *q++ = '\0';
-
-        if (property_set(temp, q) < 0) {
-            DD("could not set property '%s' to '%s'", temp, q);
-        } else {
-            count += 1;
-        }
+        count += set_property(temp);
     }
 
 
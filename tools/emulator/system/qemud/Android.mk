@@ -17,6 +17,9 @@ LOCAL_SRC_FILES:= \
 LOCAL_SHARED_LIBRARIES := \
 	libcutils \
 
+LOCAL_STATIC_LIBRARIES := \
+	libqemu
+
 LOCAL_MODULE:= qemud
 LOCAL_MODULE_TAGS := debug
 
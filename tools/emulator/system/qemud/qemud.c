@@ -6,8 +6,11 @@
 #include <errno.h>
 #include <string.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <termios.h>
+#include <unistd.h>
 #include <cutils/sockets.h>
+#include <hardware/qemu_pipe.h>
 
 /*
  *  the qemud daemon program is only used within Android as a bridge
@@ -76,6 +79,14 @@
  *
  *  Internally, the daemon maintains a "Client" object for each client
  *  connection (i.e. accepting socket connection).
+ *
+ *  When the emulator provides /dev/qemu_pipe, each client is instead
+ *  connected to its service through its own "qemud:<service-name>" pipe
+ *  and its messages are passed through as they are, without the channel
+ *  framing. The serial port is only used for the services the emulator
+ *  does not provide as pipes, and is optional in that case.
+ *
+ *      emulator <==pipe==> qemud <---> client
  */
 
 /* name of the single control socket used by the daemon */
@@ -217,12 +228,12 @@ fd_read(int  fd, void*  to, int  len)
 }
 
 static int
-fd_write(int  fd, const void*  from, int  len)
+fd_writev(int  fd, const struct iovec*  iov, int  count)
 {
     int  ret;
 
     do {
-        ret = write(fd, from, len);
+        ret = writev(fd, iov, count);
     } while (ret < 0 && errno == EINTR);
 
     return ret;
@@ -234,7 +245,7 @@ fd_setnonblock(int  fd)
     int  ret, flags;
 
     do {
-        flags = fcntl(fd, F_GETFD);
+        flags = fcntl(fd, F_GETFL);
     } while (flags < 0 && errno == EINTR);
 
     if (flags < 0) {
@@ -243,7 +254,7 @@ fd_setnonblock(int  fd)
     }
 
     do {
-        ret = fcntl(fd, F_SETFD, flags | O_NONBLOCK);
+        ret = fcntl(fd, F_SETFL, flags | O_NONBLOCK);
     } while (ret < 0 && errno == EINTR);
 
     if (ret < 0) {
@@ -304,59 +315,85 @@ fd_accept(int  fd)
 typedef void (*EventFunc)( void*  user, int  events );
 
 /* bit flags for the LoopHook structure.
- *
- * HOOK_PENDING means that an event happened on the
- * corresponding file descriptor.
  *
  * HOOK_CLOSING is used to delay-close monitored
  * file descriptors.
  */
 enum {
-    HOOK_PENDING = (1 << 0),
     HOOK_CLOSING = (1 << 1),
 };
 
 /* A LoopHook structure is used to monitor a given
  * file descriptor and record its event handler.
+ * hooks are allocated individually so their address,
+ * which epoll hands back with each event, never changes.
  */
-typedef struct {
+typedef struct LoopHook  LoopHook;
+
+struct LoopHook {
     int        fd;
     int        wanted;  /* events we are monitoring */
-    int        events;  /* events that occured */
     int        state;   /* see HOOK_XXX constants */
     void*      ev_user; /* user-provided handler parameter */
     EventFunc  ev_func; /* event handler callback */
-} LoopHook;
+    LoopHook*  next_closing;
+};
 
 /* Looper is the main object modeling a looper object
  */
 typedef struct {
     int                  epoll_fd;
     int                  num_fds;
-    int                  max_fds;
+    int                  max_events;
     struct epoll_event*  events;
-    LoopHook*            hooks;
+    /* hooks indexed by file descriptor */
+    int                  max_fd_slots;
+    LoopHook**           hooks;
+    /* hooks removed during the current dispatch,
+     * freed once all events have been handled */
+    LoopHook*            closing;
 } Looper;
 
 /* initialize a looper object */
 static void
 looper_init( Looper*  l )
 {
-    l->epoll_fd = epoll_create(4);
-    l->num_fds  = 0;
-    l->max_fds  = 0;
-    l->events   = NULL;
-    l->hooks    = NULL;
+    l->epoll_fd     = epoll_create(4);
+    l->num_fds      = 0;
+    l->max_events   = 0;
+    l->events       = NULL;
+    l->max_fd_slots = 0;
+    l->hooks        = NULL;
+    l->closing      = NULL;
+}
+
+/* free the hooks removed since the last call */
+static void
+looper_reap( Looper*  l )
+{
+    LoopHook*  hook;
+
+    while ((hook = l->closing) != NULL) {
+        l->closing = hook->next_closing;
+        xfree(hook);
+    }
 }
 
 /* finalize a looper object */
 static void
 looper_done( Looper*  l )
 {
+    int  n;
+
+    looper_reap(l);
+    for (n = 0; n < l->max_fd_slots; n++) {
+        xfree(l->hooks[n]);
+    }
     xfree(l->events);
     xfree(l->hooks);
-    l->max_fds = 0;
-    l->num_fds = 0;
+    l->max_events   = 0;
+    l->max_fd_slots = 0;
+    l->num_fds      = 0;
 
     close(l->epoll_fd);
     l->epoll_fd  = -1;
@@ -368,37 +405,10 @@ looper_done( Looper*  l )
 static LoopHook*
 looper_find( Looper*  l, int  fd )
 {
-    LoopHook*  hook = l->hooks;
-    LoopHook*  end  = hook + l->num_fds;
-
-    for ( ; hook < end; hook++ ) {
-        if (hook->fd == fd)
-            return hook;
-    }
-    return NULL;
-}
-
-/* grow the arrays in the looper object */
-static void
-looper_grow( Looper*  l )
-{
-    int  old_max = l->max_fds;
-    int  new_max = old_max + (old_max >> 1) + 4;
-    int  n;
-
-    xrenew( l->events, new_max );
-    xrenew( l->hooks,  new_max );
-    l->max_fds = new_max;
-
-    /* now change the handles to all events */
-    for (n = 0; n < l->num_fds; n++) {
-        struct epoll_event ev;
-        LoopHook*          hook = l->hooks + n;
+    if (fd < 0 || fd >= l->max_fd_slots)
+        return NULL;
 
-        ev.events   = hook->wanted;
-        ev.data.ptr = hook;
-        epoll_ctl( l->epoll_fd, EPOLL_CTL_MOD, hook->fd, &ev );
-    }
+    return l->hooks[fd];
 }
 
 /* register a file descriptor and its event handler.
@@ -410,17 +420,29 @@ looper_add( Looper*  l, int  fd, EventFunc  func, void*  user )
     struct epoll_event  ev;
     LoopHook*           hook;
 
-    if (l->num_fds >= l->max_fds)
-        looper_grow(l);
+    if (fd >= l->max_fd_slots) {
+        int  old_max = l->max_fd_slots;
+        int  new_max = fd + (fd >> 1) + 4;
+
+        xrenew( l->hooks, new_max );
+        memset( l->hooks + old_max, 0, (new_max - old_max) * sizeof(l->hooks[0]) );
+        l->max_fd_slots = new_max;
+    }
 
-    hook = l->hooks + l->num_fds;
+    /* one event slot per registered fd */
+    if (l->num_fds >= l->max_events) {
+        int  new_max = l->max_events + (l->max_events >> 1) + 4;
 
+        xrenew( l->events, new_max );
+        l->max_events = new_max;
+    }
+
+    xnew0(hook);
     hook->fd      = fd;
     hook->ev_user = user;
     hook->ev_func = func;
     hook->state   = 0;
     hook->wanted  = 0;
-    hook->events  = 0;
 
     fd_setnonblock(fd);
 
@@ -428,7 +450,8 @@ looper_add( Looper*  l, int  fd, EventFunc  func, void*  user )
     ev.data.ptr = hook;
     epoll_ctl( l->epoll_fd, EPOLL_CTL_ADD, fd, &ev );
 
-    l->num_fds += 1;
+    l->hooks[fd] = hook;
+    l->num_fds  += 1;
 }
 
 /* unregister a file descriptor and its event handler
@@ -442,8 +465,13 @@ looper_del( Looper*  l, int  fd )
         D( "%s: invalid fd: %d", __FUNCTION__, fd );
         return;
     }
-    /* don't remove the hook yet */
-    hook->state |= HOOK_CLOSING;
+    /* don't free the hook yet, events for it may
+     * still be waiting to be dispatched */
+    hook->state       |= HOOK_CLOSING;
+    hook->next_closing = l->closing;
+    l->closing         = hook;
+    l->hooks[fd]       = NULL;
+    l->num_fds        -= 1;
 
     epoll_ctl( l->epoll_fd, EPOLL_CTL_DEL, fd, NULL );
 }
@@ -508,7 +536,7 @@ looper_loop( Looper*  l )
         int  n, count;
 
         do {
-            count = epoll_wait( l->epoll_fd, l->events, l->num_fds, -1 );
+            count = epoll_wait( l->epoll_fd, l->events, l->max_events, -1 );
         } while (count < 0 && errno == EINTR);
 
         if (count < 0) {
@@ -521,40 +549,18 @@ looper_loop( Looper*  l )
             continue;
         }
 
-        /* mark all pending hooks */
+        /* execute hook callbacks. this may add or remove hooks,
+         * and grow the 'events' array, so always index it through
+         * the looper. removed hooks are skipped, they are only
+         * freed below. */
         for (n = 0; n < count; n++) {
             LoopHook*  hook = l->events[n].data.ptr;
-            hook->state  = HOOK_PENDING;
-            hook->events = l->events[n].events;
-        }
-
-        /* execute hook callbacks. this may change the 'hooks'
-         * and 'events' array, as well as l->num_fds, so be careful */
-        for (n = 0; n < l->num_fds; n++) {
-            LoopHook*  hook = l->hooks + n;
-            if (hook->state & HOOK_PENDING) {
-                hook->state &= ~HOOK_PENDING;
-                hook->ev_func( hook->ev_user, hook->events );
-            }
-        }
-
-        /* now remove all the hooks that were closed by
-         * the callbacks */
-        for (n = 0; n < l->num_fds;) {
-            struct epoll_event ev;
-            LoopHook*  hook = l->hooks + n;
-
             if (!(hook->state & HOOK_CLOSING)) {
-                n++;
-                continue;
+                hook->ev_func( hook->ev_user, l->events[n].events );
             }
-
-            hook[0]     = l->hooks[l->num_fds-1];
-            l->num_fds -= 1;
-            ev.events   = hook->wanted;
-            ev.data.ptr = hook;
-            epoll_ctl( l->epoll_fd, EPOLL_CTL_MOD, hook->fd, &ev );
         }
+
+        looper_reap(l);
     }
 }
 
@@ -644,28 +650,62 @@ struct Packet {
     Packet*   next;
     int       len;
     int       channel;
-    uint8_t   data[ MAX_PAYLOAD ];
+    int       size;      /* capacity of 'data' */
+    int       klass;     /* size class index, -1 if not cached */
+    uint8_t*  data;      /* points right after the Packet */
 };
 
-/* we expect to alloc/free a lot of packets during
- * operations so use a single linked list of free packets
- * to keep things speedy and simple.
+/* we expect to alloc/free a lot of packets during operations,
+ * most of them small control messages or short client writes.
+ * Packets are allocated from a few size classes, each one with
+ * its own free list to keep things speedy and simple. Packets
+ * larger than the biggest class (e.g. a large frame from the
+ * serial port) are malloc'ed to their exact size and never
+ * cached.
+ *
+ * The free lists are bounded by PACKET_CACHE_MAX bytes overall,
+ * packets released beyond that go back to the system, so a
+ * burst of traffic doesn't pin memory for the life of the
+ * daemon.
  */
-static Packet*   _free_packets;
+#define  PACKET_CLASSES    3
+#define  PACKET_CACHE_MAX  (64*1024)
+
+static const int  _packet_class_size[PACKET_CLASSES] = { 64, 512, 4096 };
+
+static Packet*   _free_packets[PACKET_CLASSES];
+static int       _free_packets_bytes;
 
-/* Allocate a packet */
+/* Allocate a packet that can hold at least 'size' bytes */
 static Packet*
-packet_alloc(void)
+packet_alloc( int  size )
 {
-    Packet*  p = _free_packets;
-    if (p != NULL) {
-        _free_packets = p->next;
+    Packet*  p;
+    int      klass;
+
+    for (klass = 0; klass < PACKET_CLASSES; klass++)
+        if (size <= _packet_class_size[klass])
+            break;
+
+    if (klass < PACKET_CLASSES) {
+        p = _free_packets[klass];
+        if (p != NULL) {
+            _free_packets[klass] = p->next;
+            _free_packets_bytes -= p->size;
+        } else {
+            p = xalloc(sizeof(*p) + _packet_class_size[klass]);
+            p->size = _packet_class_size[klass];
+        }
     } else {
-        xnew(p);
+        klass   = -1;
+        p       = xalloc(sizeof(*p) + size);
+        p->size = size;
     }
     p->next    = NULL;
     p->len     = 0;
     p->channel = -1;
+    p->klass   = klass;
+    p->data    = (uint8_t*)(p + 1);
     return p;
 }
 
@@ -678,12 +718,38 @@ packet_free( Packet*  *ppacket )
 {
     Packet*  p = *ppacket;
     if (p) {
-        p->next       = _free_packets;
-        _free_packets = p;
+        if (p->klass < 0 || _free_packets_bytes + p->size > PACKET_CACHE_MAX) {
+            free(p);
+        } else {
+            p->next = _free_packets[p->klass];
+            _free_packets[p->klass] = p;
+            _free_packets_bytes    += p->size;
+        }
         *ppacket = NULL;
     }
 }
 
+/* Return a packet holding the payload of 'p' in the smallest
+ * class that fits it, releasing 'p' if a copy was made. This
+ * is used for data read into a full-size buffer, so queued
+ * short messages don't each keep MAX_PAYLOAD bytes around.
+ */
+static Packet*
+packet_shrink( Packet*  p )
+{
+    Packet*  q;
+
+    if (p->klass <= 0 || p->len > _packet_class_size[p->klass-1])
+        return p;
+
+    q = packet_alloc(p->len);
+    memcpy(q->data, p->data, p->len);
+    q->len     = p->len;
+    q->channel = p->channel;
+    packet_free(&p);
+    return q;
+}
+
 /** PACKET RECEIVER
  **
  ** Simple abstraction for something that can receive a packet
@@ -749,6 +815,8 @@ struct FDHandler {
     int             fd;
     FDHandlerList*  list;
     char            closing;
+    char            in_event;  /* fdhandler_event is running */
+    char            closed;    /* closed by a receiver during the event */
     Receiver        receiver[1];
 
     /* queue of outgoing packets */
@@ -756,6 +824,10 @@ struct FDHandler {
     Packet*         out_first;
     Packet**        out_ptail;
 
+    /* called when the outgoing queue was entirely sent */
+    CloseFunc       on_drained;
+    void*           drained_user;
+
     FDHandler*      next;
     FDHandler**     pref;
 
@@ -843,6 +915,13 @@ fdhandler_close( FDHandler*  f )
     }
 
     f->list = NULL;
+
+    /* a receiver closed us from fdhandler_event, which
+     * frees the handler once it is done with it */
+    if (f->in_event) {
+        f->closed = 1;
+        return;
+    }
     xfree(f);
 }
 
@@ -889,60 +968,120 @@ fdhandler_enqueue( FDHandler*  f, Packet*  p )
 }
 
 
+/* maximum number of packets read, or written in a single
+ * writev() call, per FDHandler event. this lets a busy stream
+ * (e.g. sensors or GPS at high rates) be drained in one wakeup
+ * without starving the other file descriptors.
+ */
+#define  MAX_EVENT_PACKETS  16
+
+/* send as much of the outgoing queue as the kernel accepts */
+static void
+fdhandler_flush( FDHandler*  f )
+{
+    while (f->out_first != NULL) {
+        struct iovec  iov[ MAX_EVENT_PACKETS ];
+        Packet*       p = f->out_first;
+        int           count, total, len, sent;
+
+        iov[0].iov_base = p->data + f->out_pos;
+        iov[0].iov_len  = p->len - f->out_pos;
+        total = iov[0].iov_len;
+        count = 1;
+        for (p = p->next; p != NULL && count < MAX_EVENT_PACKETS; p = p->next) {
+            iov[count].iov_base = p->data;
+            iov[count].iov_len  = p->len;
+            total += p->len;
+            count += 1;
+        }
+
+        if ((len = fd_writev(f->fd, iov, count)) < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                D("%s: can't send: %s", __FUNCTION__, strerror(errno));
+            return;
+        }
+        sent = len;
+
+        /* release the packets that were completely sent */
+        while ((p = f->out_first) != NULL && len >= p->len - f->out_pos) {
+            len         -= p->len - f->out_pos;
+            f->out_pos   = 0;
+            f->out_first = p->next;
+            packet_free(&p);
+        }
+        if (p != NULL)
+            f->out_pos += len;
+
+        if (sent < total)
+            return;  /* the kernel buffer is full */
+    }
+
+    f->out_ptail = &f->out_first;
+    looper_disable( f->list->looper, f->fd, EPOLLOUT );
+
+    /* a closing handler is done once its queue is empty */
+    if (f->closing) {
+        fdhandler_close(f);
+        return;
+    }
+
+    /* let the owner refill the queue */
+    if (f->on_drained)
+        f->on_drained( f->drained_user );
+}
+
 /* FDHandler file descriptor event callback for read/write ops */
 static void
 fdhandler_event( FDHandler*  f, int  events )
 {
-   int  len;
-
     /* in certain cases, it's possible to have both EPOLLIN and
      * EPOLLHUP at the same time. This indicates that there is incoming
      * data to read, but that the connection was nonetheless closed
      * by the sender. Be sure to read the data before closing
      * the receiver to avoid packet loss.
      */
+    f->in_event = 1;
 
     if (events & EPOLLIN) {
-        Packet*  p = packet_alloc();
-        int      len;
+        int  n;
 
-        if ((len = fd_read(f->fd, p->data, MAX_PAYLOAD)) < 0) {
-            D("%s: can't recv: %s", __FUNCTION__, strerror(errno));
-            packet_free(&p);
-        } else if (len > 0) {
+        /* read until the fd is drained, a short read means
+         * there is nothing left */
+        for (n = 0; n < MAX_EVENT_PACKETS && !f->closed; n++) {
+            Packet*  p = packet_alloc(MAX_PAYLOAD);
+            int      len;
+
+            if ((len = fd_read(f->fd, p->data, MAX_PAYLOAD)) < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    D("%s: can't recv: %s", __FUNCTION__, strerror(errno));
+                packet_free(&p);
+                break;
+            }
+            if (len == 0) {
+                packet_free(&p);
+                break;
+            }
             p->len     = len;
             p->channel = -101;  /* special debug value, not used */
+            p = packet_shrink(p);
             receiver_post( f->receiver, p );
+            if (len < MAX_PAYLOAD)
+                break;
         }
     }
 
-    if (events & (EPOLLHUP|EPOLLERR)) {
+    if (!f->closed && (events & (EPOLLHUP|EPOLLERR))) {
         /* disconnection */
         D("%s: disconnect on fd %d", __FUNCTION__, f->fd);
         fdhandler_close(f);
-        return;
     }
 
-    if (events & EPOLLOUT && f->out_first) {
-        Packet*  p = f->out_first;
-        int      avail, len;
+    if (!f->closed && (events & EPOLLOUT) && f->out_first)
+        fdhandler_flush(f);
 
-        avail = p->len - f->out_pos;
-        if ((len = fd_write(f->fd, p->data + f->out_pos, avail)) < 0) {
-            D("%s: can't send: %s", __FUNCTION__, strerror(errno));
-        } else {
-            f->out_pos += len;
-            if (f->out_pos >= p->len) {
-                f->out_pos   = 0;
-                f->out_first = p->next;
-                packet_free(&p);
-                if (f->out_first == NULL) {
-                    f->out_ptail = &f->out_first;
-                    looper_disable( f->list->looper, f->fd, EPOLLOUT );
-                }
-            }
-        }
-    }
+    f->in_event = 0;
+    if (f->closed)
+        xfree(f);
 }
 
 
@@ -970,6 +1109,17 @@ fdhandler_new( int             fd,
 }
 
 
+/* set the function called each time the outgoing queue of 'f'
+ * becomes empty, it may enqueue more packets.
+ */
+static void
+fdhandler_set_drained( FDHandler*  f, CloseFunc  func, void*  user )
+{
+    f->on_drained   = func;
+    f->drained_user = user;
+}
+
+
 /* event callback function to monitor accepts() on server sockets.
  * the convention used here is that the receiver will receive a
  * dummy packet with the new client socket in p->channel
@@ -979,7 +1129,7 @@ fdhandler_accept_event( FDHandler*  f, int  events )
 {
     if (events & EPOLLIN) {
         /* this is an accept - send a dummy packet to the receiver */
-        Packet*  p = packet_alloc();
+        Packet*  p = packet_alloc(1);
 
         D("%s: accepting on fd %d", __FUNCTION__, f->fd);
         p->data[0] = 1;
@@ -1048,6 +1198,28 @@ fdhandler_new_accept( int             fd,
 
 #define  CHANNEL_CONTROL  0
 
+/* outgoing packets are queued per channel and only handed to the serial
+ * port's FDHandler once it has sent everything it had, so a bulk sender
+ * cannot bury the other channels under a long backlog:
+ *
+ *   - the control channel has priority, its whole queue goes first
+ *
+ *   - the data channels then share the link with deficit round robin,
+ *     each one may send up to SERIAL_QUANTUM bytes per round, the
+ *     unused part carried over to send packets larger than that.
+ *
+ * this bounds the delay of a control message to one round of the
+ * busy channels.
+ */
+#define  SERIAL_QUEUES   256
+#define  SERIAL_QUANTUM  1024
+
+typedef struct SerialQueue {
+    Packet*   first;
+    Packet**  ptail;
+    int       deficit;   /* bytes the channel may still send */
+} SerialQueue;
+
 /* The Serial object receives data from the serial port,
  * extracts the payload size and channel index, then sends
  * the resulting messages as a packet to a generic receiver.
@@ -1058,10 +1230,14 @@ fdhandler_new_accept( int             fd,
 typedef struct Serial {
     FDHandler*  fdhandler;   /* used to monitor serial port fd */
     Receiver    receiver[1]; /* send payload there */
-    int         in_len;      /* current bytes in input packet */
+    int         in_len;      /* current bytes in header or input packet */
     int         in_datalen;  /* payload size, or 0 when reading header */
     int         in_channel;  /* extracted channel number */
-    Packet*     in_packet;   /* used to read incoming packets */
+    Packet*     in_packet;   /* payload being read, sized from the header */
+    uint8_t     in_header[HEADER_SIZE];
+    SerialQueue out_queues[SERIAL_QUEUES];  /* indexed by channel */
+    int         out_queued;  /* packets waiting in the queues */
+    int         out_round;   /* first data channel of the next round */
 } Serial;
 
 
@@ -1105,18 +1281,22 @@ serial_fd_receive( Serial*  s, Packet*  p )
             if (avail > wanted)
                 avail = wanted;
 
-            memcpy( inp->data + inpos, p->data + rpos, avail );
+            memcpy( s->in_header + inpos, p->data + rpos, avail );
             inpos += avail;
             rpos  += avail;
 
             if (inpos == HEADER_SIZE) {
-                s->in_datalen = hex2int( inp->data + LENGTH_OFFSET,  LENGTH_SIZE );
-                s->in_channel = hex2int( inp->data + CHANNEL_OFFSET, CHANNEL_SIZE );
+                s->in_datalen = hex2int( s->in_header + LENGTH_OFFSET,  LENGTH_SIZE );
+                s->in_channel = hex2int( s->in_header + CHANNEL_OFFSET, CHANNEL_SIZE );
 
                 if (s->in_datalen <= 0) {
                     D("ignoring %s packet from serial port",
                       s->in_datalen ? "empty" : "malformed");
                     s->in_datalen = 0;
+                } else {
+                    /* the whole frame goes into a single packet, up
+                     * to the 0xffff bytes the header can describe */
+                    s->in_packet = inp = packet_alloc( s->in_datalen );
                 }
 
                 //D("received %d bytes packet for channel %d", s->in_datalen, s->in_channel);
@@ -1138,12 +1318,14 @@ serial_fd_receive( Serial*  s, Packet*  p )
                 if (s->in_channel < 0) {
                     D("ignoring %d bytes addressed to channel %d",
                        inpos, s->in_channel);
+                    packet_free(&inp);
                 } else {
                     inp->len     = inpos;
                     inp->channel = s->in_channel;
                     receiver_post( s->receiver, inp );
-                    s->in_packet  = inp = packet_alloc();
+                    inp = NULL;
                 }
+                s->in_packet  = NULL;
                 s->in_datalen = 0;
                 inpos         = 0;
             }
@@ -1154,14 +1336,14 @@ serial_fd_receive( Serial*  s, Packet*  p )
 }
 
 
-/* send a packet to the serial port.
+/* give a packet to the serial port's FDHandler.
  * this assumes that p->len and p->channel contain the payload's
  * size and channel and will add the appropriate header.
  */
 static void
-serial_send( Serial*  s, Packet*  p )
+serial_emit( Serial*  s, Packet*  p )
 {
-    Packet*  h = packet_alloc();
+    Packet*  h = packet_alloc(HEADER_SIZE);
 
     //D("sending to serial %d bytes from channel %d: '%.*s'", p->len, p->channel, p->len, p->data);
 
@@ -1177,6 +1359,89 @@ serial_send( Serial*  s, Packet*  p )
     fdhandler_enqueue( s->fdhandler, p );
 }
 
+static Packet*
+serial_queue_pop( Serial*  s, SerialQueue*  q )
+{
+    Packet*  p = q->first;
+
+    q->first = p->next;
+    if (q->first == NULL)
+        q->ptail = &q->first;
+    s->out_queued -= 1;
+    return p;
+}
+
+/* move the next packets of the queues to the FDHandler, see
+ * SERIAL_QUANTUM. called each time the FDHandler is done sending.
+ */
+static void
+serial_schedule( Serial*  s )
+{
+    SerialQueue*  control = &s->out_queues[CHANNEL_CONTROL];
+    int           sent    = 0;
+
+    while (control->first != NULL)
+        serial_emit( s, serial_queue_pop(s, control) );
+
+    /* a channel may need several rounds to send a large packet,
+     * go on until something was sent */
+    while (s->out_queued > 0 && !sent) {
+        int  n;
+
+        for (n = 0; n < SERIAL_QUEUES; n++) {
+            int           channel = (s->out_round + n) % SERIAL_QUEUES;
+            SerialQueue*  q       = &s->out_queues[channel];
+
+            if (channel == CHANNEL_CONTROL || q->first == NULL)
+                continue;
+
+            q->deficit += SERIAL_QUANTUM;
+            while (q->first != NULL && q->first->len + HEADER_SIZE <= q->deficit) {
+                q->deficit -= q->first->len + HEADER_SIZE;
+                serial_emit( s, serial_queue_pop(s, q) );
+                sent += 1;
+            }
+            /* an idle channel does not keep its credit */
+            if (q->first == NULL)
+                q->deficit = 0;
+        }
+        s->out_round = (s->out_round + 1) % SERIAL_QUEUES;
+    }
+}
+
+/* queue a packet for the serial port on the queue of 'channel',
+ * which can differ from p->channel to keep a control message
+ * behind the data of the channel it is about.
+ */
+static void
+serial_queue( Serial*  s, int  channel, Packet*  p )
+{
+    SerialQueue*  q = &s->out_queues[channel & (SERIAL_QUEUES-1)];
+
+    p->next     = NULL;
+    q->ptail[0] = p;
+    q->ptail    = &p->next;
+    s->out_queued += 1;
+
+    /* an idle link is fed at once */
+    if (s->fdhandler->out_first == NULL)
+        serial_schedule(s);
+}
+
+/* send a packet to the serial port on its channel */
+static void
+serial_send( Serial*  s, Packet*  p )
+{
+    serial_queue( s, p->channel, p );
+}
+
+/* whether packets of 'channel' still wait to be sent */
+static int
+serial_channel_busy( Serial*  s, int  channel )
+{
+    return s->out_queues[channel & (SERIAL_QUEUES-1)].first != NULL;
+}
+
 
 /* initialize serial reader */
 static void
@@ -1186,6 +1451,7 @@ serial_init( Serial*         s,
              Receiver*       receiver )
 {
     Receiver  recv;
+    int       n;
 
     recv.user  = s;
     recv.post  = (PostFunc)  serial_fd_receive;
@@ -1197,7 +1463,17 @@ serial_init( Serial*         s,
     s->in_len     = 0;
     s->in_datalen = 0;
     s->in_channel = 0;
-    s->in_packet  = packet_alloc();
+    s->in_packet  = NULL;
+
+    for (n = 0; n < SERIAL_QUEUES; n++) {
+        s->out_queues[n].first   = NULL;
+        s->out_queues[n].ptail   = &s->out_queues[n].first;
+        s->out_queues[n].deficit = 0;
+    }
+    s->out_queued = 0;
+    s->out_round  = 1;
+
+    fdhandler_set_drained( s->fdhandler, (CloseFunc) serial_schedule, s );
 }
 
 
@@ -1229,12 +1505,15 @@ struct Client {
     int           channel;
     char          registered;
     FDHandler*    fdhandler;
+    FDHandler*    pipe;         /* service pipe, NULL on the serial port */
     Multiplexer*  multiplexer;
 };
 
 struct Multiplexer {
     Client*        clients;
     int            last_channel;
+    int            use_pipes;   /* /dev/qemu_pipe is available */
+    int            has_serial;
     Serial         serial[1];
     Looper         looper[1];
     FDHandlerList  fdhandlers[1];
@@ -1244,6 +1523,8 @@ struct Multiplexer {
 static int   multiplexer_open_channel( Multiplexer*  mult, Packet*  p );
 static void  multiplexer_close_channel( Multiplexer*  mult, int  channel );
 static void  multiplexer_serial_send( Multiplexer* mult, int  channel, Packet*  p );
+static int   multiplexer_open_pipe( Multiplexer*  mult, Client*  c, Packet*  service );
+static void  client_registration( Client*  c, int  registered );
 
 static void
 client_dump( Client*  c, Packet*  p, const char*  funcname )
@@ -1271,6 +1552,10 @@ client_free( Client*  c )
         fdhandler_shutdown(c->fdhandler);
         c->fdhandler = NULL;
     }
+    if (c->pipe != NULL) {
+        fdhandler_shutdown(c->pipe);
+        c->pipe = NULL;
+    }
 
     xfree(c);
 }
@@ -1284,9 +1569,12 @@ client_fd_receive( Client*  c, Packet*  p )
 
     if (c->registered) {
         /* the client is registered, just send the
-         * data through the serial port
+         * data through its pipe or the serial port
          */
-        multiplexer_serial_send(c->multiplexer, c->channel, p);
+        if (c->pipe != NULL)
+            fdhandler_enqueue(c->pipe, p);
+        else
+            multiplexer_serial_send(c->multiplexer, c->channel, p);
         return;
     }
 
@@ -1311,6 +1599,15 @@ client_fd_receive( Client*  c, Packet*  p )
      */
     D("%s: attempting registration for service '%.*s'",
       __FUNCTION__, p->len, p->data);
+    if (multiplexer_open_pipe(c->multiplexer, c, p) == 0) {
+        packet_free(&p);
+        return;
+    }
+    if (!c->multiplexer->has_serial) {
+        client_registration(c, 0);
+        packet_free(&p);
+        return;
+    }
     c->channel = multiplexer_open_channel(c->multiplexer, p);
     if (c->channel < 0) {
         D("%s: service name too long", __FUNCTION__);
@@ -1344,7 +1641,7 @@ client_fd_close( Client*  c )
 static void
 client_registration( Client*  c, int  registered )
 {
-    Packet*  p = packet_alloc();
+    Packet*  p = packet_alloc(2);
 
     /* sends registration status to client */
     if (!registered) {
@@ -1376,6 +1673,24 @@ client_send( Client*  c, Packet*  p )
     fdhandler_enqueue(c->fdhandler, p);
 }
 
+/* a function called when the service pipe of a client receives data */
+static void
+client_pipe_receive( Client*  c, Packet*  p )
+{
+    client_send(c, p);
+}
+
+/* a function called when the emulator closes the service pipe */
+static void
+client_pipe_close( Client*  c )
+{
+    D("%s: client %p service pipe closed", __FUNCTION__, c);
+
+    /* no need to shutdown the FDHandler */
+    c->pipe = NULL;
+    client_free(c);
+}
+
 
 /* Create new client socket handler */
 static Client*
@@ -1394,6 +1709,7 @@ client_new( Multiplexer*    mult,
     c->pref        = &c->next;
     c->channel     = -1;
     c->registered  = 0;
+    c->pipe        = NULL;
 
     recv.user  = c;
     recv.post  = (PostFunc)  client_fd_receive;
@@ -1540,7 +1856,7 @@ multiplexer_serial_send( Multiplexer*  mult, int  channel, Packet*  p )
 static int
 multiplexer_open_channel( Multiplexer*  mult, Packet*  service )
 {
-    Packet*   p = packet_alloc();
+    Packet*   p = packet_alloc(MAX_PAYLOAD);
     int       len, channel;
 
     /* find a free channel number, assume we don't have many
@@ -1553,11 +1869,15 @@ multiplexer_open_channel( Multiplexer*  mult, Packet*  service )
         for (c = mult->clients; c != NULL; c = c->next)
             if (c->channel == channel)
                 goto TRY_AGAIN;
+
+        /* the disconnect of a previous user may still be queued */
+        if (channel == CHANNEL_CONTROL || serial_channel_busy(mult->serial, channel))
+            goto TRY_AGAIN;
     }
 
-    len = snprintf((char*)p->data, sizeof p->data, "connect:%.*s:%02x", service->len, service->data, channel);
-    if (len >= (int)sizeof(p->data)) {
-        D("%s: weird, service name too long (%d > %d)", __FUNCTION__, len, sizeof(p->data));
+    len = snprintf((char*)p->data, p->size, "connect:%.*s:%02x", service->len, service->data, channel);
+    if (len >= p->size) {
+        D("%s: weird, service name too long (%d > %d)", __FUNCTION__, len, p->size);
         packet_free(&p);
         return -1;
     }
@@ -1568,14 +1888,50 @@ multiplexer_open_channel( Multiplexer*  mult, Packet*  service )
     return channel;
 }
 
+/* a function used by a client to connect directly to its service through
+ * a qemu pipe, and bypass the serial port. 'service' must be a packet
+ * containing the name of the service in its payload.
+ *
+ * returns 0 and registers the client on success, or -1 if the emulator
+ * does not provide the service as a pipe.
+ */
+static int
+multiplexer_open_pipe( Multiplexer*  mult, Client*  c, Packet*  service )
+{
+    char      name[64];
+    int       len, fd;
+    Receiver  recv;
+
+    if (!mult->use_pipes)
+        return -1;
+
+    len = snprintf(name, sizeof name, "qemud:%.*s", service->len, service->data);
+    if (len >= (int)sizeof name)
+        return -1;
+
+    fd = qemu_pipe_open(name);
+    if (fd < 0) {
+        D("%s: no '%s' pipe: %s", __FUNCTION__, name, strerror(errno));
+        return -1;
+    }
+
+    recv.user  = c;
+    recv.post  = (PostFunc)  client_pipe_receive;
+    recv.close = (CloseFunc) client_pipe_close;
+
+    c->pipe = fdhandler_new( fd, mult->fdhandlers, &recv );
+    client_registration(c, 1);
+    return 0;
+}
+
 /* used to tell the emulator a channel was closed by a client */
 static void
 multiplexer_close_channel( Multiplexer*  mult, int  channel )
 {
-    Packet*  p   = packet_alloc();
-    int      len = snprintf((char*)p->data, sizeof(p->data), "disconnect:%02x", channel);
+    Packet*  p   = packet_alloc(16);
+    int      len = snprintf((char*)p->data, p->size, "disconnect:%02x", channel);
 
-    if (len > (int)sizeof(p->data)) {
+    if (len >= p->size) {
         /* should not happen */
         return;
     }
@@ -1583,7 +1939,8 @@ multiplexer_close_channel( Multiplexer*  mult, int  channel )
     p->channel = CHANNEL_CONTROL;
     p->len     = len;
 
-    serial_send(mult->serial, p);
+    /* after the data the client sent before closing */
+    serial_queue(mult->serial, channel, p);
 }
 
 /* this function is used when a new connection happens on the control
@@ -1609,6 +1966,9 @@ multiplexer_control_close( Multiplexer*  m )
     fatal("unexpected multiplexer control close");
 }
 
+/* 'serial_dev' can be NULL when the services are reached through
+ * qemu pipes only.
+ */
 static void
 multiplexer_init( Multiplexer*  m, const char*  serial_dev )
 {
@@ -1619,29 +1979,36 @@ multiplexer_init( Multiplexer*  m, const char*  serial_dev )
     looper_init( m->looper );
     fdhandler_list_init( m->fdhandlers, m->looper );
 
-    /* open the serial port */
-    do {
-        fd = open(serial_dev, O_RDWR);
-    } while (fd < 0 && errno == EINTR);
+    m->use_pipes  = (access("/dev/qemu_pipe", R_OK|W_OK) == 0);
+    m->has_serial = 0;
+    D("%s: %s qemu pipes", __FUNCTION__, m->use_pipes ? "using" : "no");
 
-    if (fd < 0) {
-        fatal( "%s: could not open '%s': %s", __FUNCTION__, serial_dev,
-               strerror(errno) );
-    }
-    // disable echo on serial lines
-    if ( !memcmp( serial_dev, "/dev/ttyS", 9 ) ) {
-        struct termios  ios;
-        tcgetattr( fd, &ios );
-        ios.c_lflag = 0;  /* disable ECHO, ICANON, etc... */
-        tcsetattr( fd, TCSANOW, &ios );
-    }
+    if (serial_dev != NULL) {
+        /* open the serial port */
+        do {
+            fd = open(serial_dev, O_RDWR);
+        } while (fd < 0 && errno == EINTR);
 
-    /* initialize the serial reader/writer */
-    recv.user  = m;
-    recv.post  = (PostFunc)  multiplexer_serial_receive;
-    recv.close = (CloseFunc) multiplexer_serial_close;
+        if (fd < 0) {
+            fatal( "%s: could not open '%s': %s", __FUNCTION__, serial_dev,
+                   strerror(errno) );
+        }
+        // disable echo on serial lines
+        if ( !memcmp( serial_dev, "/dev/ttyS", 9 ) ) {
+            struct termios  ios;
+            tcgetattr( fd, &ios );
+            ios.c_lflag = 0;  /* disable ECHO, ICANON, etc... */
+            tcsetattr( fd, TCSANOW, &ios );
+        }
 
-    serial_init( m->serial, fd, m->fdhandlers, &recv );
+        /* initialize the serial reader/writer */
+        recv.user  = m;
+        recv.post  = (PostFunc)  multiplexer_serial_receive;
+        recv.close = (CloseFunc) multiplexer_serial_close;
+
+        serial_init( m->serial, fd, m->fdhandlers, &recv );
+        m->has_serial = 1;
+    }
 
     /* open the qemud control socket */
     recv.user  = m;
@@ -1699,17 +2066,20 @@ int  main( void )
         if (p == NULL) {
             D("%s: can't find '%s' in /proc/cmdline",
             __FUNCTION__, KERNEL_OPTION );
-            exit(1);
-        }
-
-        p += sizeof(KERNEL_OPTION)-1;  /* skip option */
-        q  = p;
-        while ( *q && *q != ' ' && *q != '\t' )
-            q += 1;
+            /* the services may still be reachable through qemu pipes */
+            if (access("/dev/qemu_pipe", R_OK|W_OK) != 0)
+                exit(1);
+            multiplexer_init( m, NULL );
+        } else {
+            p += sizeof(KERNEL_OPTION)-1;  /* skip option */
+            q  = p;
+            while ( *q && *q != ' ' && *q != '\t' )
+                q += 1;
 
-        snprintf( buff, sizeof(buff), "/dev/%.*s", q-p, p );
+            snprintf( buff, sizeof(buff), "/dev/%.*s", q-p, p );
 
-        multiplexer_init( m, buff );
+            multiplexer_init( m, buff );
+        }
     }
 
     D( "entering main loop");
@@ -111,6 +111,35 @@ _sensorIdFromName( const char*  name )
     return -1;
 }
 
+/** BINARY EVENTS
+ **
+ ** By default the emulator sends one text message per sensor
+ ** value, followed by a "sync:<time>" message. After we send
+ ** "set-format:binary" on the channel, an emulator which knows
+ ** about it sends batches of samples instead, each one as a
+ ** single message with the following little-endian layout:
+ **
+ **   offset  size
+ **      0      4    SENSORS_BATCH_MAGIC
+ **      4      4    number of samples that follow
+ **      8     24    first sample:
+ **                    0  1  sensor index (ID_ACCELERATION, ...)
+ **                    1  3  padding
+ **                    4  8  VM time of the sample in micro-seconds
+ **                   12 12  three float values, same meaning as
+ **                          in the text messages
+ **     32     24    second sample, etc...
+ **
+ ** Older emulators ignore the command and keep sending text,
+ ** which is still understood. The magic starts with a zero
+ ** byte, so it can't be confused with a text message.
+ **/
+
+#define  SENSORS_BATCH_MAGIC    "\0sev"
+#define  SENSORS_BATCH_HEADER   8
+#define  SENSORS_BATCH_RECORD   24
+#define  SENSORS_BATCH_MAX      64
+
 /** SENSORS POLL DEVICE
  **
  ** This one is used to read sensor data from the hardware.
@@ -123,6 +152,9 @@ typedef struct SensorPoll {
     sensors_event_t               sensors[MAX_NUM_SENSORS];
     int                           events_fd;
     uint32_t                      pendingSensors;
+    sensors_event_t               batch[SENSORS_BATCH_MAX];
+    int                           batchPos;   /* next event to return */
+    int                           batchCount;
     int64_t                       timeStart;
     int64_t                       timeOffset;
     int                           fd;
@@ -140,6 +172,8 @@ control__open_data_source(struct sensors_poll_device_t *dev)
 
     if (ctl->fd < 0) {
         ctl->fd = qemud_channel_open(SENSORS_SERVICE_NAME);
+        if (ctl->fd >= 0)
+            qemud_channel_send(ctl->fd, "set-format:binary", -1);
     }
     D("%s: fd=%d", __FUNCTION__, ctl->fd);
     handle = native_handle_create(1, 0);
@@ -237,6 +271,8 @@ data__data_open(struct sensors_poll_device_t *dev, native_handle_t* handle)
         data->sensors[i].acceleration.status = SENSOR_STATUS_ACCURACY_HIGH;
     }
     data->pendingSensors = 0;
+    data->batchPos       = 0;
+    data->batchCount     = 0;
     data->timeStart      = 0;
     data->timeOffset     = 0;
 
@@ -259,6 +295,74 @@ data__data_close(struct sensors_poll_device_t *dev)
     return 0;
 }
 
+/* convert a VM time in micro-seconds into a local time in nano-seconds */
+static int64_t
+data__event_time(SensorPoll*  data, int64_t  event_time)
+{
+    int64_t t = event_time * 1000LL;  /* convert to nano-seconds */
+
+    /* use the time of the first event as the base for later
+     * time values */
+    if (data->timeStart == 0) {
+        data->timeStart  = data__now_ns();
+        data->timeOffset = data->timeStart - t;
+    }
+    return t + data->timeOffset;
+}
+
+/* parse a binary batch into data->batch, returns the number of events */
+static int
+data__parse_batch(SensorPoll*  data, const char*  buff, int  len)
+{
+    uint32_t  count, nn;
+    int       n = 0;
+
+    memcpy(&count, buff + 4, sizeof count);
+    if (count > SENSORS_BATCH_MAX ||
+        len != SENSORS_BATCH_HEADER + (int)count * SENSORS_BATCH_RECORD) {
+        E("%s: malformed batch (%u samples, %d bytes)", __FUNCTION__, count, len);
+        return 0;
+    }
+
+    for (nn = 0; nn < count; nn++) {
+        const char*       rec = buff + SENSORS_BATCH_HEADER + nn * SENSORS_BATCH_RECORD;
+        int               id  = (unsigned char)rec[0];
+        int64_t           event_time;
+        sensors_event_t*  ev;
+
+        if (!ID_CHECK(id)) {
+            D("%s: ignoring sample for sensor %d", __FUNCTION__, id);
+            continue;
+        }
+        memcpy(&event_time, rec + 4, sizeof event_time);
+        memcpy(data->sensors[id].data, rec + 12, 3 * sizeof(float));
+
+        ev = &data->batch[n++];
+        *ev = data->sensors[id];
+        ev->sensor    = id;
+        ev->version   = sizeof(*ev);
+        ev->timestamp = data__event_time(data, event_time);
+    }
+    data->batchPos   = 0;
+    data->batchCount = n;
+    return n;
+}
+
+/* copy up to 'count' queued batch events to 'values' */
+static int
+pick_batch(SensorPoll*       data,
+           sensors_event_t*  values,
+           int               count)
+{
+    int  n = data->batchCount - data->batchPos;
+
+    if (n > count)
+        n = count;
+    memcpy(values, data->batch + data->batchPos, n * sizeof(*values));
+    data->batchPos += n;
+    return n;
+}
+
 static int
 pick_sensor(SensorPoll*       data,
             sensors_event_t*  values)
@@ -299,13 +403,17 @@ data__poll(struct sensors_poll_device_t *dev, sensors_event_t* values)
     if (data->pendingSensors) {
         return pick_sensor(data, values);
     }
+    if (data->batchPos < data->batchCount) {
+        pick_batch(data, values, 1);
+        return values->sensor;
+    }
 
     // wait until we get a complete event for an enabled sensor
     uint32_t new_sensors = 0;
 
     while (1) {
         /* read the next event */
-        char     buff[256];
+        char     buff[SENSORS_BATCH_HEADER + SENSORS_BATCH_MAX*SENSORS_BATCH_RECORD];
         int      len = qemud_channel_recv(data->events_fd, buff, sizeof buff-1);
         float    params[3];
         int64_t  event_time;
@@ -315,10 +423,19 @@ data__poll(struct sensors_poll_device_t *dev, sensors_event_t* values)
             return -errno;
         }
 
+        /* a batch of binary samples, see BINARY EVENTS above */
+        if (len >= SENSORS_BATCH_HEADER && !memcmp(buff, SENSORS_BATCH_MAGIC, 4)) {
+            if (data__parse_batch(data, buff, len) > 0) {
+                pick_batch(data, values, 1);
+                return values->sensor;
+            }
+            continue;
+        }
+
         buff[len] = 0;
 
         /* "wake" is sent from the emulator to exit this loop. */
-        if (!strcmp((const char*)data, "wake")) {
+        if (!strcmp(buff, "wake")) {
             return 0x7FFFFFFF;
         }
 
@@ -370,15 +487,7 @@ data__poll(struct sensors_poll_device_t *dev, sensors_event_t* values)
         if (sscanf(buff, "sync:%lld", &event_time) == 1) {
             if (new_sensors) {
                 data->pendingSensors = new_sensors;
-                int64_t t = event_time * 1000LL;  /* convert to nano-seconds */
-
-                /* use the time at the first sync: as the base for later
-                 * time values */
-                if (data->timeStart == 0) {
-                    data->timeStart  = data__now_ns();
-                    data->timeOffset = data->timeStart - t;
-                }
-                t += data->timeOffset;
+                int64_t t = data__event_time(data, event_time);
 
                 while (new_sensors) {
                     uint32_t i = 31 - __builtin_clz(new_sensors);
@@ -440,6 +549,10 @@ static int poll__poll(struct sensors_poll_device_t *dev,
         if (ret > MAX_NUM_SENSORS || ret < 0) {
            return i;
         }
+        /* hand the rest of a binary batch in one go */
+        if (datadev->batchPos < datadev->batchCount) {
+           return i + 1 + pick_batch(datadev, data, count - i - 1);
+        }
         if (!datadev->pendingSensors) {
            return i + 1;
         }
@@ -24,7 +24,7 @@ LOCAL_STATIC_LIBRARIES := \
 	libETC1
 
 ifeq ($(HOST_OS),linux)
-LOCAL_LDLIBS += -lrt
+LOCAL_LDLIBS += -lrt -lpthread
 endif
 
 # Statically link libz for MinGW (Win SDK under Linux),
@@ -12,14 +12,20 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <ctype.h>
+#include <dirent.h>
 #include <errno.h>
+#include <math.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
 
 #include <png.h>
 #include <ETC1/etc1.h>
+#include <utils/threads.h>
 
 
 int writePNGFile(const char* pOutput, png_uint_32 width, png_uint_32 height,
@@ -39,7 +45,11 @@ void usage(char* message, ...) {
     }
     fprintf(
             stderr,
-            "%s infile [--help | --encode | --encodeNoHeader | --decode] [--showDifference difffile] [-o outfile]\n",
+            "%s infile [--help | --encode | --encodeNoHeader | --decode] [--showDifference difffile] [--showPSNR] [--jobs n] [-o outfile]\n",
+            gpExeName);
+    fprintf(
+            stderr,
+            "%s --batch dir|listfile [--encode | --encodeNoHeader] [--mipmaps] [--cache cachefile] [--jobs n] [-o outdir]\n",
             gpExeName);
     fprintf(stderr, "\tDefault is --encode\n");
     fprintf(stderr, "\t\t--help           print this usage information.\n");
@@ -54,6 +64,27 @@ void usage(char* message, ...) {
             "\t\t--showDifference difffile    Write difference between original and encoded\n");
     fprintf(stderr,
             "\t\t                             image to difffile. (Only valid when encoding).\n");
+    fprintf(stderr,
+            "\t\t--showPSNR       print the mean squared error and PSNR of the encoded\n");
+    fprintf(stderr,
+            "\t\t                 image. (Only valid when encoding).\n");
+    fprintf(stderr,
+            "\t\t--jobs n         encode using n threads. Default is 1.\n");
+    fprintf(stderr,
+            "\t\t--batch path     encode every PNG file of a directory, or every file listed\n");
+    fprintf(stderr,
+            "\t\t                 in a list file, one path per line.\n");
+    fprintf(stderr,
+            "\t\t--mipmaps        also write mipmaps down to 1x1, to <name>_mip<level>.pkm.\n");
+    fprintf(stderr,
+            "\t\t                 (Only valid with --batch).\n");
+    fprintf(stderr,
+            "\t\t--cache file     skip images unchanged since the last batch using this cache.\n");
+    fprintf(stderr,
+            "\t\t                 (Only valid with --batch).\n");
+    fprintf(stderr,
+            "\tWith --batch, outdir is the directory in which the outputs are written,\n");
+    fprintf(stderr, "\tnext to their input if it is not specified.\n");
     fprintf(stderr,
             "\tIf outfile is not specified, an outfile path is constructed from infile,\n");
     fprintf(stderr, "\twith the apropriate suffix (.pkm or .png).\n");
@@ -307,32 +338,145 @@ int readPKMFile(const char* pInput, etc1_byte** ppImageData,
 }
 
 
-// Encode the file.
-// Returns non-zero if an error occurred.
+// Runs func(pArg, index) for every index below count, on up to jobs
+// threads, the calling one included. Indices are handed out in order to
+// whichever thread is free.
 
-int encode(const char* pInput, const char* pOutput, bool bEmitHeader, const char* pDiffFile) {
-    FILE* pOut = NULL;
-    etc1_uint32 width = 0;
-    etc1_uint32 height = 0;
-    etc1_uint32 encodedSize = 0;
-    int result = -1;
-    etc1_byte* pSourceImage = 0;
-    etc1_byte* pEncodedData = 0;
-    etc1_byte* pDiffImage = 0; // Used for differencing
+typedef void (*ParallelFunc)(void* pArg, etc1_uint32 index);
 
-    if (read_PNG_File(pInput, &pSourceImage, &width, &height)) {
-        goto exit;
+struct ParallelJob {
+    ParallelFunc func;
+    void* pArg;
+    etc1_uint32 count;
+    etc1_uint32 next;
+    int threadsRunning;
+    android::Mutex lock;
+    android::Condition done;
+};
+
+static
+void runParallelJob(ParallelJob* pJob) {
+    for (;;) {
+        etc1_uint32 index;
+        {
+            android::Mutex::Autolock autoLock(pJob->lock);
+            if (pJob->next >= pJob->count) {
+                break;
+            }
+            index = pJob->next++;
+        }
+        pJob->func(pJob->pArg, index);
+    }
+}
+
+static
+int parallelThread(void* pArg) {
+    ParallelJob* pJob = (ParallelJob*) pArg;
+    runParallelJob(pJob);
+    android::Mutex::Autolock autoLock(pJob->lock);
+    pJob->threadsRunning--;
+    pJob->done.signal();
+    return 0;
+}
+
+static
+void parallelFor(etc1_uint32 count, int jobs, ParallelFunc func, void* pArg) {
+    ParallelJob job;
+    job.func = func;
+    job.pArg = pArg;
+    job.count = count;
+    job.next = 0;
+    job.threadsRunning = 0;
+
+    for (int i = 1; i < jobs && (etc1_uint32) i < count; i++) {
+        android::Mutex::Autolock autoLock(job.lock);
+        if (!android::createThread(parallelThread, &job)) {
+            fprintf(stderr, "Could not create a thread, using %d.\n", i);
+            break;
+        }
+        job.threadsRunning++;
     }
 
-    encodedSize = etc1_get_encoded_data_size(width, height);
-    pEncodedData = new etc1_byte[encodedSize];
+    runParallelJob(&job);
+
+    android::Mutex::Autolock autoLock(job.lock);
+    while (job.threadsRunning > 0) {
+        job.done.wait(job.lock);
+    }
+}
+
+// Blocks are encoded independently of each other, so an image can be split
+// in bands of block rows encoded by different threads. Each band is written
+// to its own part of the output, so the result does not depend on the number
+// of threads.
+
+static const etc1_uint32 kBandBlockRows = 8;
+
+struct EncodeBands {
+    const etc1_byte* pIn;
+    etc1_uint32 width;
+    etc1_uint32 height;
+    etc1_uint32 stride;
+    etc1_byte* pOut;
+};
+
+static
+void encodeBand(void* pArg, etc1_uint32 band) {
+    EncodeBands* pBands = (EncodeBands*) pArg;
+    etc1_uint32 encodedRowSize = ((pBands->width + 3) / 4) * 8;
+    etc1_uint32 y = band * kBandBlockRows * 4;
+    etc1_uint32 bandHeight = pBands->height - y;
+    if (bandHeight > kBandBlockRows * 4) {
+        bandHeight = kBandBlockRows * 4;
+    }
+    etc1_encode_image(pBands->pIn + y * pBands->stride,
+            pBands->width, bandHeight, 3, pBands->stride,
+            pBands->pOut + band * kBandBlockRows * encodedRowSize);
+}
+
+// Encode an image with up to jobs threads, the calling one included.
+
+static
+void encodeImage(const etc1_byte* pIn, etc1_uint32 width, etc1_uint32 height,
+        etc1_uint32 stride, etc1_byte* pOut, int jobs) {
+    etc1_uint32 blockRows = (height + 3) / 4;
+    if (jobs <= 1 || blockRows <= kBandBlockRows) {
+        etc1_encode_image(pIn, width, height, 3, stride, pOut);
+        return;
+    }
+
+    EncodeBands bands;
+    bands.pIn = pIn;
+    bands.width = width;
+    bands.height = height;
+    bands.stride = stride;
+    bands.pOut = pOut;
+    parallelFor((blockRows + kBandBlockRows - 1) / kBandBlockRows, jobs,
+            encodeBand, &bands);
+}
+
+// Encode an image and write it to a PKM file, or to a raw ETC1 data file if
+// bEmitHeader is false. If pDecodedImage is not NULL, the encoded image is
+// also decoded into it.
+// Returns non-zero if an error occurred.
+
+static
+int writePKMFile(const char* pOutput, const etc1_byte* pImage,
+        etc1_uint32 width, etc1_uint32 height, bool bEmitHeader, int jobs,
+        etc1_byte* pDecodedImage) {
+    FILE* pOut = NULL;
+    int result = -1;
+    etc1_uint32 encodedSize = etc1_get_encoded_data_size(width, height);
+    etc1_byte* pEncodedData = new etc1_byte[encodedSize];
     if (!pEncodedData) {
         fprintf(stderr, "Out of memory.\n");
         goto exit;
     }
 
-    etc1_encode_image(pSourceImage,
-            width, height, 3, width * 3, pEncodedData);
+    encodeImage(pImage, width, height, width * 3, pEncodedData, jobs);
+    if (pDecodedImage) {
+        etc1_decode_image(pEncodedData, pDecodedImage, width, height, 3, width * 3);
+    }
 
     if ((pOut = fopen(pOutput, "wb")) == NULL) {
         fprintf(stderr, "Could not open output file %s: %d\n", pOutput, errno);
@@ -357,35 +501,120 @@ int encode(const char* pInput, const char* pOutput, bool bEmitHeader, const char
         goto exit;
     }
 
-    fclose(pOut);
+    if (fclose(pOut)) {
+        pOut = NULL;
+        fprintf(stderr, "Could not write output file %s: %d\n", pOutput, errno);
+        goto exit;
+    }
     pOut = NULL;
 
-    if (pDiffFile) {
-        etc1_uint32 outWidth;
-        etc1_uint32 outHeight;
-        if (readPKMFile(pOutput, &pDiffImage, &outWidth, &outHeight)) {
-            goto exit;
+    // Success
+    result = 0;
+
+    exit:
+    delete[] pEncodedData;
+    if (pOut) {
+        fclose(pOut);
+    }
+    return result;
+}
+
+// Print the mean squared error of each channel of an encoded image, and the
+// PSNR of the whole image.
+
+static
+void printPSNR(const etc1_byte* pSource, const etc1_byte* pEncoded,
+        etc1_uint32 width, etc1_uint32 height) {
+    unsigned long long sum[3] = { 0, 0, 0 };
+    for (etc1_uint32 y = 0; y < height; y++) {
+        // A row of squared differences fits in 32 bits for any width that
+        // fits in a PKM header.
+        etc1_uint32 rowSum[3] = { 0, 0, 0 };
+        const etc1_byte* pSrc = pSource + y * width * 3;
+        const etc1_byte* pEnc = pEncoded + y * width * 3;
+        for (etc1_uint32 x = 0; x < width; x++) {
+            for (int c = 0; c < 3; c++) {
+                int diff = pSrc[c] - pEnc[c];
+                rowSum[c] += diff * diff;
+            }
+            pSrc += 3;
+            pEnc += 3;
         }
-        if (outWidth != width || outHeight != height) {
-            fprintf(stderr, "Output file has incorrect bounds: %u, %u != %u, %u\n",
-                    outWidth, outHeight, width, height);
-            goto exit;
+        for (int c = 0; c < 3; c++) {
+            sum[c] += rowSum[c];
         }
-        const etc1_byte* pSrc = pSourceImage;
-        etc1_byte* pDest = pDiffImage;
-        etc1_uint32 size = width * height * 3;
-        for (etc1_uint32 i = 0; i < size; i++) {
-            int diff = *pSrc++ - *pDest;
-            diff *= diff;
-            diff <<= 3;
-            if (diff < 0) {
-                diff = 0;
-            } else if (diff > 255) {
-                diff = 255;
-            }
-            *pDest++ = (png_byte) diff;
+    }
+
+    double pixels = (double) width * height;
+    double mse[3];
+    for (int c = 0; c < 3; c++) {
+        mse[c] = sum[c] / pixels;
+    }
+    double total = (mse[0] + mse[1] + mse[2]) / 3;
+    printf("MSE: r %.3f g %.3f b %.3f all %.3f\n", mse[0], mse[1], mse[2], total);
+    if (total > 0) {
+        printf("PSNR: %.3f dB\n", 10 * log10(255.0 * 255.0 / total));
+    } else {
+        printf("PSNR: infinite\n");
+    }
+}
+
+// Write the squared difference between an image and its encoded version, times
+// 8 and clamped to 255, to a PNG file.
+// Returns non-zero if an error occurred.
+
+static
+int writeDifferenceFile(const char* pDiffFile, const etc1_byte* pSource,
+        etc1_byte* pEncoded, etc1_uint32 width, etc1_uint32 height) {
+    etc1_byte diffTable[256];
+    for (int i = 0; i < 256; i++) {
+        int diff = (i * i) << 3;
+        diffTable[i] = (etc1_byte) (diff > 255 ? 255 : diff);
+    }
+
+    etc1_uint32 size = width * height * 3;
+    for (etc1_uint32 i = 0; i < size; i++) {
+        int diff = pSource[i] - pEncoded[i];
+        pEncoded[i] = diffTable[diff < 0 ? -diff : diff];
+    }
+    return writePNGFile(pDiffFile, width, height, pEncoded, 3 * width);
+}
+
+// Encode the file.
+// Returns non-zero if an error occurred.
+
+int encode(const char* pInput, const char* pOutput, bool bEmitHeader, const char* pDiffFile,
+        bool bShowPSNR, int jobs) {
+    etc1_uint32 width = 0;
+    etc1_uint32 height = 0;
+    int result = -1;
+    etc1_byte* pSourceImage = 0;
+    etc1_byte* pDecodedImage = 0; // Used for differencing
+
+    if (read_PNG_File(pInput, &pSourceImage, &width, &height)) {
+        goto exit;
+    }
+
+    if (pDiffFile || bShowPSNR) {
+        pDecodedImage = new etc1_byte[width * height * 3];
+        if (!pDecodedImage) {
+            fprintf(stderr, "Out of memory.\n");
+            goto exit;
         }
-        writePNGFile(pDiffFile, outWidth, outHeight, pDiffImage, 3 * outWidth);
+    }
+
+    if (writePKMFile(pOutput, pSourceImage, width, height, bEmitHeader, jobs,
+            pDecodedImage)) {
+        goto exit;
+    }
+
+    if (bShowPSNR) {
+        printPSNR(pSourceImage, pDecodedImage, width, height);
+    }
+
+    if (pDiffFile
+            && writeDifferenceFile(pDiffFile, pSourceImage, pDecodedImage, width, height)) {
+        goto exit;
     }
 
     // Success
@@ -393,12 +622,7 @@ int encode(const char* pInput, const char* pOutput, bool bEmitHeader, const char
 
     exit:
     delete[] pSourceImage;
-    delete[] pEncodedData;
-    delete[] pDiffImage;
-
-    if (pOut) {
-        fclose(pOut);
-    }
+    delete[] pDecodedImage;
     return result;
 }
 
@@ -472,6 +696,416 @@ int decode(const char* pInput, const char* pOutput) {
     return result;
 }
 
+// Batch mode: encodes every PNG file of a directory, or every file named in
+// a list file (one path per line), on several threads. Optionally each image
+// also gets a chain of mipmaps, each level written to its own file named
+// <name>_mip<level>.pkm, down to 1x1.
+//
+// With a cache file, an image is skipped when the content of its input file
+// and the encoding options have the same hash as the last time it was
+// encoded, and its output still exists.
+
+struct BatchItem {
+    char* pInput;
+    char* pOutputBase; // Output path without its extension
+    etc1_uint32 hashLow;
+    etc1_uint32 hashHigh;
+    bool bCached;
+    bool bSkipped;
+    int result;
+};
+
+struct Batch {
+    BatchItem* pItems;
+    etc1_uint32 count;
+    etc1_uint32 capacity;
+    bool bEmitHeader;
+    bool bMipmaps;
+};
+
+static
+char* duplicateString(const char* pString) {
+    size_t length = strlen(pString);
+    char* pCopy = new char[length + 1];
+    if (pCopy) {
+        memcpy(pCopy, pString, length + 1);
+    }
+    return pCopy;
+}
+
+// Returns non-zero if an error occurred.
+
+static
+int addBatchItem(Batch* pBatch, const char* pInput, const char* pOutputDir) {
+    if (pBatch->count == pBatch->capacity) {
+        etc1_uint32 capacity = pBatch->capacity ? 2 * pBatch->capacity : 64;
+        BatchItem* pItems = new BatchItem[capacity];
+        if (!pItems) {
+            fprintf(stderr, "Out of memory.\n");
+            return -1;
+        }
+        memcpy(pItems, pBatch->pItems, pBatch->count * sizeof(BatchItem));
+        delete[] pBatch->pItems;
+        pBatch->pItems = pItems;
+        pBatch->capacity = capacity;
+    }
+
+    const char* pName = pInput;
+    if (pOutputDir) {
+        const char* pSlash = strrchr(pInput, '/');
+        if (pSlash) {
+            pName = pSlash + 1;
+        }
+    }
+    size_t baseSize = strlen(pName) + 2;
+    if (pOutputDir) {
+        baseSize += strlen(pOutputDir) + 1;
+    }
+    char* pOutputBase = new char[baseSize];
+    if (!pOutputBase) {
+        fprintf(stderr, "Out of memory.\n");
+        return -1;
+    }
+    if (pOutputDir) {
+        snprintf(pOutputBase, baseSize, "%s/%s", pOutputDir, pName);
+    } else {
+        strcpy(pOutputBase, pName);
+    }
+    if (changeExtension(pOutputBase, baseSize, "")) {
+        fprintf(stderr, "Could not change extension of input file name: %s\n", pInput);
+        delete[] pOutputBase;
+        return -1;
+    }
+
+    BatchItem* pItem = &pBatch->pItems[pBatch->count++];
+    memset(pItem, 0, sizeof(*pItem));
+    pItem->pInput = duplicateString(pInput);
+    pItem->pOutputBase = pOutputBase;
+    return 0;
+}
+
+static
+bool isPNGFileName(const char* pName) {
+    size_t length = strlen(pName);
+    if (length < 4) {
+        return false;
+    }
+    const char* pExtension = pName + length - 4;
+    return pExtension[0] == '.' && tolower(pExtension[1]) == 'p'
+            && tolower(pExtension[2]) == 'n' && tolower(pExtension[3]) == 'g';
+}
+
+// Returns non-zero if an error occurred.
+
+static
+int readBatchDirectory(Batch* pBatch, const char* pDir, const char* pOutputDir) {
+    DIR* pDirectory = opendir(pDir);
+    if (!pDirectory) {
+        fprintf(stderr, "Could not open directory %s: %d\n", pDir, errno);
+        return -1;
+    }
+
+    int result = 0;
+    struct dirent* pEntry;
+    while (!result && (pEntry = readdir(pDirectory)) != NULL) {
+        if (!isPNGFileName(pEntry->d_name)) {
+            continue;
+        }
+        size_t pathSize = strlen(pDir) + strlen(pEntry->d_name) + 2;
+        char* pPath = new char[pathSize];
+        if (!pPath) {
+            fprintf(stderr, "Out of memory.\n");
+            result = -1;
+            break;
+        }
+        snprintf(pPath, pathSize, "%s/%s", pDir, pEntry->d_name);
+        result = addBatchItem(pBatch, pPath, pOutputDir);
+        delete[] pPath;
+    }
+    closedir(pDirectory);
+    return result;
+}
+
+// Returns non-zero if an error occurred.
+
+static
+int readBatchList(Batch* pBatch, const char* pList, const char* pOutputDir) {
+    FILE* pIn = fopen(pList, "r");
+    if (!pIn) {
+        fprintf(stderr, "Could not open list file %s for reading: %d\n", pList, errno);
+        return -1;
+    }
+
+    int result = 0;
+    char line[4096];
+    while (!result && fgets(line, sizeof(line), pIn)) {
+        size_t length = strlen(line);
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+            line[--length] = '\0';
+        }
+        if (length == 0 || line[0] == '#') {
+            continue;
+        }
+        result = addBatchItem(pBatch, line, pOutputDir);
+    }
+    fclose(pIn);
+    return result;
+}
+
+static
+int compareBatchItems(const void* pA, const void* pB) {
+    return strcmp(((const BatchItem*) pA)->pInput, ((const BatchItem*) pB)->pInput);
+}
+
+// FNV-1a hash of the content of a file, folded with the encoding options.
+// Returns non-zero if an error occurred.
+
+static
+int hashFile(const char* pInput, const Batch* pBatch,
+        etc1_uint32* pHashLow, etc1_uint32* pHashHigh) {
+    FILE* pIn = fopen(pInput, "rb");
+    if (!pIn) {
+        fprintf(stderr, "Could not open input file %s for reading: %d\n",
+                pInput, errno);
+        return -1;
+    }
+
+    unsigned long long hash = 14695981039346656037ULL;
+    hash = (hash ^ (pBatch->bEmitHeader ? 1 : 0)) * 1099511628211ULL;
+    hash = (hash ^ (pBatch->bMipmaps ? 1 : 0)) * 1099511628211ULL;
+
+    etc1_byte buffer[16384];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), pIn)) > 0) {
+        for (size_t i = 0; i < length; i++) {
+            hash = (hash ^ buffer[i]) * 1099511628211ULL;
+        }
+    }
+    int result = ferror(pIn) ? -1 : 0;
+    if (result) {
+        fprintf(stderr, "Could not read input file %s: %d\n", pInput, errno);
+    }
+    fclose(pIn);
+
+    *pHashLow = (etc1_uint32) hash;
+    *pHashHigh = (etc1_uint32) (hash >> 32);
+    return result;
+}
+
+// The cache file holds one "<hash> <input path>" line per encoded image.
+
+static
+void readBatchCache(Batch* pBatch, const char* pCacheFile) {
+    FILE* pIn = fopen(pCacheFile, "r");
+    if (!pIn) {
+        return;
+    }
+
+    char line[4096 + 32];
+    while (fgets(line, sizeof(line), pIn)) {
+        size_t length = strlen(line);
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+            line[--length] = '\0';
+        }
+        etc1_uint32 hashHigh, hashLow;
+        int pathOffset = 0;
+        if (sscanf(line, "%8x%8x %n", &hashHigh, &hashLow, &pathOffset) != 2
+                || pathOffset == 0) {
+            continue;
+        }
+        BatchItem key;
+        key.pInput = line + pathOffset;
+        BatchItem* pItem = (BatchItem*) bsearch(&key, pBatch->pItems,
+                pBatch->count, sizeof(BatchItem), compareBatchItems);
+        if (pItem) {
+            pItem->bCached = true;
+            pItem->hashHigh = hashHigh;
+            pItem->hashLow = hashLow;
+        }
+    }
+    fclose(pIn);
+}
+
+static
+void writeBatchCache(const Batch* pBatch, const char* pCacheFile) {
+    FILE* pOut = fopen(pCacheFile, "w");
+    if (!pOut) {
+        fprintf(stderr, "Could not open cache file %s: %d\n", pCacheFile, errno);
+        return;
+    }
+    for (etc1_uint32 i = 0; i < pBatch->count; i++) {
+        const BatchItem* pItem = &pBatch->pItems[i];
+        if (pItem->result == 0) {
+            fprintf(pOut, "%08x%08x %s\n", pItem->hashHigh, pItem->hashLow,
+                    pItem->pInput);
+        }
+    }
+    if (fclose(pOut)) {
+        fprintf(stderr, "Could not write cache file %s: %d\n", pCacheFile, errno);
+    }
+}
+
+// Shrink an image to half its size, rounded up, averaging 2x2 pixels.
+
+static
+void downsampleImage(const etc1_byte* pIn, etc1_uint32 width, etc1_uint32 height,
+        etc1_byte* pOut) {
+    etc1_uint32 outWidth = (width + 1) / 2;
+    etc1_uint32 outHeight = (height + 1) / 2;
+    for (etc1_uint32 y = 0; y < outHeight; y++) {
+        const etc1_byte* pRow0 = pIn + 2 * y * width * 3;
+        const etc1_byte* pRow1 = 2 * y + 1 < height ? pRow0 + width * 3 : pRow0;
+        for (etc1_uint32 x = 0; x < outWidth; x++) {
+            etc1_uint32 x0 = 2 * x * 3;
+            etc1_uint32 x1 = 2 * x + 1 < width ? x0 + 3 : x0;
+            for (int c = 0; c < 3; c++) {
+                *pOut++ = (etc1_byte) ((pRow0[x0 + c] + pRow0[x1 + c]
+                        + pRow1[x0 + c] + pRow1[x1 + c] + 2) / 4);
+            }
+        }
+    }
+}
+
+// Returns non-zero if an error occurred.
+
+static
+int encodeBatchItem(const Batch* pBatch, BatchItem* pItem) {
+    size_t outputSize = strlen(pItem->pOutputBase) + 32;
+    char* pOutput = new char[outputSize];
+    etc1_byte* pImage = NULL;
+    etc1_uint32 width = 0;
+    etc1_uint32 height = 0;
+    int result = -1;
+
+    if (!pOutput) {
+        fprintf(stderr, "Out of memory.\n");
+        goto exit;
+    }
+
+    if (read_PNG_File(pItem->pInput, &pImage, &width, &height)) {
+        goto exit;
+    }
+
+    for (int level = 0; ; level++) {
+        if (level == 0) {
+            snprintf(pOutput, outputSize, "%s.pkm", pItem->pOutputBase);
+        } else {
+            snprintf(pOutput, outputSize, "%s_mip%d.pkm", pItem->pOutputBase, level);
+        }
+        if (writePKMFile(pOutput, pImage, width, height, pBatch->bEmitHeader, 1, NULL)) {
+            goto exit;
+        }
+        if (!pBatch->bMipmaps || (width == 1 && height == 1)) {
+            break;
+        }
+
+        etc1_uint32 mipWidth = (width + 1) / 2;
+        etc1_uint32 mipHeight = (height + 1) / 2;
+        etc1_byte* pMipImage = new etc1_byte[mipWidth * mipHeight * 3];
+        if (!pMipImage) {
+            fprintf(stderr, "Out of memory.\n");
+            goto exit;
+        }
+        downsampleImage(pImage, width, height, pMipImage);
+        delete[] pImage;
+        pImage = pMipImage;
+        width = mipWidth;
+        height = mipHeight;
+    }
+
+    // Success
+    result = 0;
+
+    exit:
+    delete[] pOutput;
+    delete[] pImage;
+    return result;
+}
+
+static
+void encodeBatchItemThread(void* pArg, etc1_uint32 index) {
+    Batch* pBatch = (Batch*) pArg;
+    BatchItem* pItem = &pBatch->pItems[index];
+
+    etc1_uint32 hashLow, hashHigh;
+    if (hashFile(pItem->pInput, pBatch, &hashLow, &hashHigh)) {
+        pItem->result = -1;
+        return;
+    }
+
+    if (pItem->bCached && pItem->hashLow == hashLow && pItem->hashHigh == hashHigh) {
+        size_t outputSize = strlen(pItem->pOutputBase) + 5;
+        char* pOutput = new char[outputSize];
+        if (pOutput) {
+            snprintf(pOutput, outputSize, "%s.pkm", pItem->pOutputBase);
+            struct stat st;
+            pItem->bSkipped = stat(pOutput, &st) == 0;
+            delete[] pOutput;
+        }
+    }
+
+    pItem->hashLow = hashLow;
+    pItem->hashHigh = hashHigh;
+    if (!pItem->bSkipped) {
+        pItem->result = encodeBatchItem(pBatch, pItem);
+    }
+}
+
+// Encode every image of a directory or list file.
+// Returns non-zero if an error occurred.
+
+int encodeBatch(const char* pBatchPath, const char* pOutputDir, bool bEmitHeader,
+        bool bMipmaps, const char* pCacheFile, int jobs) {
+    Batch batch;
+    memset(&batch, 0, sizeof(batch));
+    batch.bEmitHeader = bEmitHeader;
+    batch.bMipmaps = bMipmaps;
+
+    int result;
+    struct stat st;
+    if (stat(pBatchPath, &st) == 0 && S_ISDIR(st.st_mode)) {
+        result = readBatchDirectory(&batch, pBatchPath, pOutputDir);
+    } else {
+        result = readBatchList(&batch, pBatchPath, pOutputDir);
+    }
+
+    if (!result) {
+        qsort(batch.pItems, batch.count, sizeof(BatchItem), compareBatchItems);
+        if (pCacheFile) {
+            readBatchCache(&batch, pCacheFile);
+        }
+
+        parallelFor(batch.count, jobs, encodeBatchItemThread, &batch);
+
+        int encoded = 0;
+        int skipped = 0;
+        int failed = 0;
+        for (etc1_uint32 i = 0; i < batch.count; i++) {
+            if (batch.pItems[i].result) {
+                failed++;
+            } else if (batch.pItems[i].bSkipped) {
+                skipped++;
+            } else {
+                encoded++;
+            }
+        }
+        printf("Encoded %d images, skipped %d unchanged, %d failed.\n",
+                encoded, skipped, failed);
+
+        if (pCacheFile) {
+            writeBatchCache(&batch, pCacheFile);
+        }
+        result = failed ? -1 : 0;
+    }
+
+    for (etc1_uint32 i = 0; i < batch.count; i++) {
+        delete[] batch.pItems[i].pInput;
+        delete[] batch.pItems[i].pOutputBase;
+    }
+    delete[] batch.pItems;
+    return result;
+}
+
 void multipleEncodeDecodeCheck(bool* pbEncodeDecodeSeen) {
     if (*pbEncodeDecodeSeen) {
         usage("At most one occurrence of --encode --encodeNoHeader or --decode is allowed.\n");
@@ -491,6 +1125,11 @@ int main(int argc, char** argv) {
     bool bEncodeHeader = false;
     bool bDecode = false;
     bool bShowDifference = false;
+    bool bShowPSNR = false;
+    int jobs = 1;
+    const char* pBatch = NULL;
+    const char* pCacheFile = NULL;
+    bool bMipmaps = false;
 
     for (int i = 1; i < argc; i++) {
         const char* pArg = argv[i];
@@ -527,6 +1166,31 @@ int main(int argc, char** argv) {
                         usage("Expected difffile after --showDifference");
                     }
                     pDiffFile = argv[++i];
+                } else if (strcmp(pArg, "--showPSNR") == 0) {
+                    bShowPSNR = true;
+                } else if (strcmp(pArg, "--jobs") == 0) {
+                    if (i + 1 >= argc) {
+                        usage("Expected a number of threads after --jobs");
+                    }
+                    jobs = atoi(argv[++i]);
+                    if (jobs < 1) {
+                        usage("--jobs needs at least 1 thread, not %s", argv[i]);
+                    }
+                } else if (strcmp(pArg, "--batch") == 0) {
+                    if (pBatch != NULL) {
+                        usage("Only one --batch option allowed.\n");
+                    }
+                    if (i + 1 >= argc) {
+                        usage("Expected a directory or list file after --batch");
+                    }
+                    pBatch = argv[++i];
+                } else if (strcmp(pArg, "--mipmaps") == 0) {
+                    bMipmaps = true;
+                } else if (strcmp(pArg, "--cache") == 0) {
+                    if (i + 1 >= argc) {
+                        usage("Expected cachefile after --cache");
+                    }
+                    pCacheFile = argv[++i];
                 } else if (strcmp(pArg, "--help") == 0) {
                     usage( NULL);
                 } else {
@@ -555,6 +1219,25 @@ int main(int argc, char** argv) {
     if ((! bEncode) && bShowDifference) {
         usage("--showDifference is only valid when encoding.");
     }
+    if ((! bEncode) && bShowPSNR) {
+        usage("--showPSNR is only valid when encoding.");
+    }
+
+    if (pBatch) {
+        if (pInput) {
+            usage("No input file allowed with --batch.");
+        }
+        if (! bEncode) {
+            usage("--batch is only valid when encoding.");
+        }
+        if (bShowDifference || bShowPSNR) {
+            usage("--showDifference and --showPSNR are not valid with --batch.");
+        }
+        return encodeBatch(pBatch, pOutput, bEncodeHeader, bMipmaps, pCacheFile, jobs) ? 1 : 0;
+    }
+    if (bMipmaps || pCacheFile) {
+        usage("--mipmaps and --cache are only valid with --batch.");
+    }
 
     if (!pInput) {
         usage("Expected an input file.");
@@ -572,7 +1255,7 @@ int main(int argc, char** argv) {
     }
 
     if (bEncode) {
-        encode(pInput, pOutput, bEncodeHeader, pDiffFile);
+        encode(pInput, pOutput, bEncodeHeader, pDiffFile, bShowPSNR, jobs);
     } else {
         decode(pInput, pOutput);
     }
@@ -11,6 +11,8 @@ LOCAL_SRC_FILES:= \
 LOCAL_C_INCLUDES += \
 	dalvik/vm
 
+LOCAL_LDLIBS += -lpthread
+
 LOCAL_MODULE := jdwpspy
 
 include $(BUILD_HOST_EXECUTABLE)
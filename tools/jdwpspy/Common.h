@@ -83,10 +83,21 @@ INLINE u8 get8BE(unsigned char const* pSrc)
 }
 
 
+/*
+ * What to dump of the traffic.  By default every packet is dumped.
+ */
+typedef struct DumpOptions {
+    int     sampleRate;         /* dump one request in this many */
+    bool    filterSets;         /* only dump requests in "cmdSets" */
+    u1      cmdSets[256 / 8];   /* bitmap of command sets to dump */
+    bool    headersOnly;        /* don't hex dump packet data */
+} DumpOptions;
+
 /*
  * Start here.
  */
-int run(const char* connectHost, int connectPort, int listenPort);
+int run(const char* connectHost, int connectPort, int listenPort,
+    const DumpOptions* pOptions);
 
 /*
  * Print a hex dump to the specified file pointer.
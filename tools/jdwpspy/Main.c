@@ -10,6 +10,7 @@
 #include <string.h>
 #include <assert.h>
 #include <ctype.h>
+#include <unistd.h>
 
 static const char gHexDigit[] = "0123456789abcdef";
 
@@ -107,10 +108,41 @@ void printHexDumpEx(FILE* fp, const void* vaddr, size_t length,
  */
 static void usage(const char* progName)
 {
-    fprintf(stderr, "Usage: %s VM-port [debugger-listen-port]\n\n", progName);
+    fprintf(stderr, "Usage: %s [-s rate] [-c cmdset[,cmdset...]] [-q] "
+        "VM-port [debugger-listen-port]\n\n", progName);
     fprintf(stderr,
 "When a debugger connects to the debugger-listen-port, jdwpspy will connect\n");
-    fprintf(stderr, "to the VM on the VM-port.\n");
+    fprintf(stderr, "to the VM on the VM-port.\n\n");
+    fprintf(stderr,
+"  -s rate    only dump one request in 'rate', and its reply\n");
+    fprintf(stderr,
+"  -c cmdset  only dump requests of these command sets, and their replies\n");
+    fprintf(stderr,
+"  -q         don't hex dump the packet data\n");
+}
+
+/*
+ * Parse a comma-separated list of command sets into "pOptions".
+ */
+static bool parseCmdSets(const char* list, DumpOptions* pOptions)
+{
+    while (*list != '\0') {
+        char* end;
+        long cmdSet = strtol(list, &end, 10);
+
+        if (end == list || cmdSet < 0 || cmdSet > 255)
+            return false;
+        pOptions->cmdSets[cmdSet / 8] |= 1 << (cmdSet % 8);
+
+        if (*end == ',')
+            end++;
+        else if (*end != '\0')
+            return false;
+        list = end;
+    }
+
+    pOptions->filterSets = true;
+    return true;
 }
 
 /*
@@ -118,15 +150,43 @@ static void usage(const char* progName)
  */
 int main(int argc, char* argv[])
 {
+    DumpOptions options;
     int connectPort, listenPort;
-    int cc;
+    int cc, ic;
+
+    memset(&options, 0, sizeof(options));
+    while ((ic = getopt(argc, argv, "s:c:q")) != -1) {
+        switch (ic) {
+        case 's':
+            options.sampleRate = atoi(optarg);
+            break;
+        case 'c':
+            if (!parseCmdSets(optarg, &options)) {
+                usage("jdwpspy");
+                return 2;
+            }
+            break;
+        case 'q':
+            options.headersOnly = true;
+            break;
+        default:
+            usage("jdwpspy");
+            return 2;
+        }
+    }
+    argc -= optind - 1;
+    argv += optind - 1;
 
     if (argc < 2 || argc > 3) {
         usage("jdwpspy");
         return 2;
     }
 
-    setvbuf(stdout, NULL, _IONBF, 0);
+    /*
+     * Dumps are written by a thread of their own, which flushes stdout
+     * whenever it runs out of packets.
+     */
+    setvbuf(stdout, NULL, _IOFBF, 64*1024);
 
     /* may want this to be host:port */
     connectPort = atoi(argv[1]);
@@ -136,7 +196,7 @@ int main(int argc, char* argv[])
     else
         listenPort = connectPort + 1;
 
-    cc = run("localhost", connectPort, listenPort);
+    cc = run("localhost", connectPort, listenPort, &options);
 
     return (cc != 0);
 }
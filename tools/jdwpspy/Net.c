@@ -10,6 +10,8 @@
 #include <unistd.h>     
 #include <stdio.h>
 #include <string.h>     
+#include <pthread.h>
+#include <poll.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -26,6 +28,9 @@
 #define kJDWPHeaderLen      11
 #define kJDWPFlagReply      0x80
 
+#define kDumpQueueMax       (8*1024*1024)   /* bytes of packets not dumped yet */
+#define kSelectedIdMax      64              /* requests whose reply we dump */
+
 
 /*
  * Information about the remote end.
@@ -35,7 +40,8 @@ typedef struct Peer {
 
     int     sock;
     unsigned char   inputBuffer[kInputBufferSize];
-    int     inputCount;
+    int     inputStart;         /* offset of the first unconsumed byte */
+    int     inputCount;         /* offset past the last byte read */
 
     bool    awaitingHandshake;  /* waiting for "JDWP-Handshake" */
 } Peer;
@@ -219,6 +225,51 @@ static const char* getCommandName(int cmdSet, int cmd)
 }
 
 
+/*
+ * A packet waiting to be dumped by the writer thread.
+ */
+typedef struct DumpEntry {
+    struct DumpEntry* next;
+    char    srcName[2];
+    char    dstName[2];
+    int     min, sec;           /* when we forwarded it */
+    u4      length;
+    unsigned char data[1];
+} DumpEntry;
+
+/*
+ * Packets are copied here and dumped by a separate thread, so a slow
+ * stdout doesn't hold up the traffic between the debugger and the VM.
+ * If the writer falls too far behind, dumps get dropped instead.
+ */
+typedef struct DumpQueue {
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    DumpEntry*  head;
+    DumpEntry*  tail;
+    size_t      queuedBytes;
+    int         dropped;
+} DumpQueue;
+
+static DumpQueue gDumpQueue = {
+    PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, NULL, NULL, 0, 0
+};
+
+static DumpOptions gDumpOptions;
+
+/*
+ * Requests we dumped, so we can dump their replies as well when only some
+ * requests are selected.  "requester" is the label of the side that sent
+ * the request.
+ */
+static struct {
+    u4      id;
+    char    requester;
+} gSelectedIds[kSelectedIdMax];
+static int gNextSelectedId = 0;
+static int gSampleCount = 0;
+
+
 void jdwpNetFree(NetState* netState);       /* fwd */
 
 /*
@@ -386,7 +437,7 @@ bool jdwpAcceptConnection(NetState* netState)
 
     netState->dbg.sock = sock;
     netState->dbg.awaitingHandshake = true;
-    netState->dbg.inputCount = 0;
+    netState->dbg.inputStart = netState->dbg.inputCount = 0;
 
     setNoDelay(sock);
 
@@ -417,37 +468,33 @@ void jdwpCloseConnection(NetState* netState)
  */
 static bool haveFullPacket(Peer* pPeer)
 {
+    int avail = pPeer->inputCount - pPeer->inputStart;
     long length;
 
     if (pPeer->awaitingHandshake)
-        return (pPeer->inputCount >= kMagicHandshakeLen);
+        return (avail >= kMagicHandshakeLen);
 
-    if (pPeer->inputCount < 4)
+    if (avail < 4)
         return false;
 
-    length = get4BE(pPeer->inputBuffer);
-    return (pPeer->inputCount >= length);
+    length = get4BE(pPeer->inputBuffer + pPeer->inputStart);
+    return (avail >= length);
 }
 
 /*
  * Consume bytes from the buffer.
  *
- * This would be more efficient with a circular buffer.  However, we're
- * usually only going to find one packet, which is trivial to handle.
+ * We just move the start of the data; the leftovers are moved down only
+ * when we run out of room at the end of the buffer (see readPeer).
  */
 static void consumeBytes(Peer* pPeer, int count)
 {
     assert(count > 0);
-    assert(count <= pPeer->inputCount);
+    assert(count <= pPeer->inputCount - pPeer->inputStart);
 
-    if (count == pPeer->inputCount) {
-        pPeer->inputCount = 0;
-        return;
-    }
-
-    memmove(pPeer->inputBuffer, pPeer->inputBuffer + count,
-        pPeer->inputCount - count);
-    pPeer->inputCount -= count;
+    pPeer->inputStart += count;
+    if (pPeer->inputStart == pPeer->inputCount)
+        pPeer->inputStart = pPeer->inputCount = 0;
 }
 
 /*
@@ -468,7 +515,7 @@ static void getCurrentTime(int* pMin, int* pSec)
  * Dump the contents of a packet to stdout.
  */
 static void dumpPacket(const unsigned char* packetBuf, const char* srcName,
-    const char* dstName)
+    const char* dstName, int min, int sec)
 {
     const unsigned char* buf = packetBuf;
     char prefix[3];
@@ -502,9 +549,6 @@ static void dumpPacket(const unsigned char* packetBuf, const char* srcName,
     }
     prefix[2] = '\0';
 
-    int min, sec;
-    getCurrentTime(&min, &sec);
-
     if (!reply) {
         printf("%s REQUEST dataLen=%-5u id=0x%08x flags=0x%02x cmd=%d/%d [%02d:%02d]\n",
             prefix, dataLen, id, flags, cmdSet, cmd, min, sec);
@@ -513,28 +557,142 @@ static void dumpPacket(const unsigned char* packetBuf, const char* srcName,
         printf("%s REPLY   dataLen=%-5u id=0x%08x flags=0x%02x err=%d (%s) [%02d:%02d]\n",
             prefix, dataLen, id, flags, error, dvmJdwpErrorStr(error), min,sec);
     }
-    if (dataLen > 0)
+    if (dataLen > 0 && !gDumpOptions.headersOnly)
         printHexDump2(buf, dataLen, prefix);
     printf("%s ----------\n", prefix);
 }
 
+/*
+ * Decide if a packet sent by "srcName" should be dumped.
+ */
+static bool selectPacket(const unsigned char* buf, const char* srcName,
+    const char* dstName)
+{
+    u4 id = get4BE(buf+4);
+    int i;
+
+    if (gDumpOptions.sampleRate <= 1 && !gDumpOptions.filterSets)
+        return true;
+
+    if ((get1(buf+8) & kJDWPFlagReply) != 0) {
+        /* dump the replies to the requests we dumped */
+        for (i = 0; i < kSelectedIdMax; i++) {
+            if (gSelectedIds[i].requester == dstName[0] &&
+                gSelectedIds[i].id == id)
+            {
+                gSelectedIds[i].requester = '\0';
+                return true;
+            }
+        }
+        return false;
+    }
+
+    u1 cmdSet = get1(buf+9);
+    if (gDumpOptions.filterSets &&
+        (gDumpOptions.cmdSets[cmdSet / 8] & (1 << (cmdSet % 8))) == 0)
+    {
+        return false;
+    }
+    if (gDumpOptions.sampleRate > 1 &&
+        (gSampleCount++ % gDumpOptions.sampleRate) != 0)
+    {
+        return false;
+    }
+
+    gSelectedIds[gNextSelectedId].id = id;
+    gSelectedIds[gNextSelectedId].requester = srcName[0];
+    gNextSelectedId = (gNextSelectedId + 1) % kSelectedIdMax;
+    return true;
+}
+
+/*
+ * Hand a copy of a packet to the writer thread.
+ */
+static void queueDump(const unsigned char* packetBuf, const char* srcName,
+    const char* dstName)
+{
+    DumpEntry* pEntry;
+    u4 length = get4BE(packetBuf);
+
+    if (!selectPacket(packetBuf, srcName, dstName))
+        return;
+
+    pEntry = (DumpEntry*) malloc(sizeof(DumpEntry) + length);
+    if (pEntry == NULL)
+        return;
+    pEntry->next = NULL;
+    strcpy(pEntry->srcName, srcName);
+    strcpy(pEntry->dstName, dstName);
+    getCurrentTime(&pEntry->min, &pEntry->sec);
+    pEntry->length = length;
+    memcpy(pEntry->data, packetBuf, length);
+
+    pthread_mutex_lock(&gDumpQueue.lock);
+    if (gDumpQueue.queuedBytes + length > kDumpQueueMax) {
+        gDumpQueue.dropped++;
+        free(pEntry);
+    } else {
+        if (gDumpQueue.tail != NULL)
+            gDumpQueue.tail->next = pEntry;
+        else
+            gDumpQueue.head = pEntry;
+        gDumpQueue.tail = pEntry;
+        gDumpQueue.queuedBytes += length;
+        pthread_cond_signal(&gDumpQueue.cond);
+    }
+    pthread_mutex_unlock(&gDumpQueue.lock);
+}
+
+/*
+ * Writer thread.  Takes everything queued so far and dumps it, flushing
+ * stdout once the queue is empty.
+ */
+static void* dumpThreadStart(void* arg)
+{
+    while (true) {
+        DumpEntry* pEntry;
+        int dropped;
+
+        pthread_mutex_lock(&gDumpQueue.lock);
+        while (gDumpQueue.head == NULL)
+            pthread_cond_wait(&gDumpQueue.cond, &gDumpQueue.lock);
+        pEntry = gDumpQueue.head;
+        gDumpQueue.head = gDumpQueue.tail = NULL;
+        gDumpQueue.queuedBytes = 0;
+        dropped = gDumpQueue.dropped;
+        gDumpQueue.dropped = 0;
+        pthread_mutex_unlock(&gDumpQueue.lock);
+
+        if (dropped != 0)
+            printf("*** dropped %d packets, output is too slow\n", dropped);
+
+        while (pEntry != NULL) {
+            DumpEntry* pNext = pEntry->next;
+            dumpPacket(pEntry->data, pEntry->srcName, pEntry->dstName,
+                pEntry->min, pEntry->sec);
+            free(pEntry);
+            pEntry = pNext;
+        }
+        fflush(stdout);
+    }
+
+    return NULL;
+}
+
 /*
  * Handle a packet.  Returns "false" if we encounter a connection-fatal error.
  */
 static bool handlePacket(Peer* pDst, Peer* pSrc)
 {
-    const unsigned char* buf = pSrc->inputBuffer;
+    const unsigned char* buf = pSrc->inputBuffer + pSrc->inputStart;
     u4 length;
-    u1 flags;
     int cc;
 
     length = get4BE(buf+0);
-    flags = get1(buf+9);
-
-    assert((int) length <= pSrc->inputCount);
 
-    dumpPacket(buf, pSrc->label, pDst->label);
+    assert((int) length <= pSrc->inputCount - pSrc->inputStart);
 
+    /* forward it first, the dump can wait */
     cc = write(pDst->sock, buf, length);
     if (cc != (int) length) {
         fprintf(stderr, "Failed sending packet: %s\n", strerror(errno));
@@ -543,20 +701,23 @@ static bool handlePacket(Peer* pDst, Peer* pSrc)
     /*printf("*** wrote %d bytes from %c to %c\n",
         cc, pSrc->label[0], pDst->label[0]);*/
 
+    queueDump(buf, pSrc->label, pDst->label);
+
     consumeBytes(pSrc, length);
     return true;
 }
 
 /*
- * Handle incoming data.  If we have a full packet in the buffer, process it.
+ * Handle incoming data.  Process all the full packets in the buffer.
  */
 static bool handleIncoming(Peer* pWritePeer, Peer* pReadPeer)
 {
-    if (haveFullPacket(pReadPeer)) {
+    while (haveFullPacket(pReadPeer)) {
         if (pReadPeer->awaitingHandshake) {
-            printf("Handshake [%c]: %.14s\n",
-                pReadPeer->label[0], pReadPeer->inputBuffer);
-            if (write(pWritePeer->sock, pReadPeer->inputBuffer,
+            const unsigned char* buf =
+                pReadPeer->inputBuffer + pReadPeer->inputStart;
+            printf("Handshake [%c]: %.14s\n", pReadPeer->label[0], buf);
+            if (write(pWritePeer->sock, buf,
                     kMagicHandshakeLen) != kMagicHandshakeLen)
             {
                 fprintf(stderr,
@@ -569,8 +730,6 @@ static bool handleIncoming(Peer* pWritePeer, Peer* pReadPeer)
             if (!handlePacket(pWritePeer, pReadPeer))
                 goto fail;
         }
-    } else {
-        /*printf("*** %c not full yet\n", pReadPeer->label[0]);*/
     }
 
     return true;
@@ -579,6 +738,49 @@ fail:
     return false;
 }
 
+/*
+ * Read what's available from a peer into its input buffer.
+ *
+ * Returns 1 on success, 0 if we were interrupted, -1 on error (including
+ * the peer disconnecting).
+ */
+static int readPeer(Peer* pPeer, const char* name)
+{
+    int cc;
+
+    /* make room at the end if a partial packet is left near it */
+    if (pPeer->inputCount == (int) sizeof(pPeer->inputBuffer) &&
+        pPeer->inputStart > 0)
+    {
+        memmove(pPeer->inputBuffer, pPeer->inputBuffer + pPeer->inputStart,
+            pPeer->inputCount - pPeer->inputStart);
+        pPeer->inputCount -= pPeer->inputStart;
+        pPeer->inputStart = 0;
+    }
+
+    cc = read(pPeer->sock, pPeer->inputBuffer + pPeer->inputCount,
+        sizeof(pPeer->inputBuffer) - pPeer->inputCount);
+    if (cc < 0) {
+        if (errno == EINTR) {
+            fprintf(stderr, "+++ EINTR on read\n");
+            return 0;
+        }
+        fprintf(stderr, "+++ %s read failed: %s\n", name, strerror(errno));
+        return -1;
+    }
+    if (cc == 0) {
+        if ((int) sizeof(pPeer->inputBuffer) == pPeer->inputCount)
+            fprintf(stderr, "+++ %s sent huge message\n", name);
+        else
+            fprintf(stderr, "+++ %s disconnected\n", name);
+        return -1;
+    }
+
+    /*printf("*** %d bytes from %s\n", cc, name);*/
+    pPeer->inputCount += cc;
+    return 1;
+}
+
 /*
  * Process incoming data.  If no data is available, this will block until
  * some arrives.
@@ -594,74 +796,38 @@ bool jdwpProcessIncoming(NetState* netState)
 
     while (!haveFullPacket(&netState->dbg) && !haveFullPacket(&netState->vm)) {
         /* read some more */
-        int highFd;
-        fd_set readfds;
+        struct pollfd fds[2];
 
-        highFd = (netState->dbg.sock > netState->vm.sock) ?
-            netState->dbg.sock+1 : netState->vm.sock+1;
-        FD_ZERO(&readfds);
-        FD_SET(netState->dbg.sock, &readfds);
-        FD_SET(netState->vm.sock, &readfds);
+        fds[0].fd = netState->dbg.sock;
+        fds[0].events = POLLIN;
+        fds[1].fd = netState->vm.sock;
+        fds[1].events = POLLIN;
 
         errno = 0;
-        cc = select(highFd, &readfds, NULL, NULL, NULL);
+        cc = poll(fds, 2, -1);
         if (cc < 0) {
             if (errno == EINTR) {
-                fprintf(stderr, "+++ EINTR on select\n");
+                fprintf(stderr, "+++ EINTR on poll\n");
                 continue;
             }
-            fprintf(stderr, "+++ select failed: %s\n", strerror(errno));
+            fprintf(stderr, "+++ poll failed: %s\n", strerror(errno));
             goto fail;
         }
 
-        if (FD_ISSET(netState->dbg.sock, &readfds)) {
-            cc = read(netState->dbg.sock,
-                netState->dbg.inputBuffer + netState->dbg.inputCount,
-                sizeof(netState->dbg.inputBuffer) - netState->dbg.inputCount);
-            if (cc < 0) {
-                if (errno == EINTR) {
-                    fprintf(stderr, "+++ EINTR on read\n");
-                    continue;
-                }
-                fprintf(stderr, "+++ dbg read failed: %s\n", strerror(errno));
-                goto fail;
-            }
-            if (cc == 0) {
-                if (sizeof(netState->dbg.inputBuffer) ==
-                        netState->dbg.inputCount)
-                    fprintf(stderr, "+++ debugger sent huge message\n");
-                else
-                    fprintf(stderr, "+++ debugger disconnected\n");
+        if ((fds[0].revents & (POLLIN | POLLHUP | POLLERR)) != 0) {
+            cc = readPeer(&netState->dbg, "debugger");
+            if (cc < 0)
                 goto fail;
-            }
-
-            /*printf("*** %d bytes from dbg\n", cc);*/
-            netState->dbg.inputCount += cc;
+            if (cc == 0)
+                continue;
         }
 
-        if (FD_ISSET(netState->vm.sock, &readfds)) {
-            cc = read(netState->vm.sock,
-                netState->vm.inputBuffer + netState->vm.inputCount,
-                sizeof(netState->vm.inputBuffer) - netState->vm.inputCount);
-            if (cc < 0) {
-                if (errno == EINTR) {
-                    fprintf(stderr, "+++ EINTR on read\n");
-                    continue;
-                }
-                fprintf(stderr, "+++ vm read failed: %s\n", strerror(errno));
+        if ((fds[1].revents & (POLLIN | POLLHUP | POLLERR)) != 0) {
+            cc = readPeer(&netState->vm, "vm");
+            if (cc < 0)
                 goto fail;
-            }
-            if (cc == 0) {
-                if (sizeof(netState->vm.inputBuffer) ==
-                        netState->vm.inputCount)
-                    fprintf(stderr, "+++ vm sent huge message\n");
-                else
-                    fprintf(stderr, "+++ vm disconnected\n");
-                goto fail;
-            }
-
-            /*printf("*** %d bytes from vm\n", cc);*/
-            netState->vm.inputCount += cc;
+            if (cc == 0)
+                continue;
         }
     }
 
@@ -704,7 +870,7 @@ bool jdwpConnectToVm(NetState* netState)
 
     netState->vm.sock = sock;
     netState->vm.awaitingHandshake = true;
-    netState->vm.inputCount = 0;
+    netState->vm.inputStart = netState->vm.inputCount = 0;
 
     setNoDelay(netState->vm.sock);
     return true;
@@ -722,14 +888,25 @@ fail:
  * open a connection to the VM.  If one side or the other goes away, we
  * drop both ends and go back to listening.
  */
-int run(const char* connectHost, int connectPort, int listenPort)
+int run(const char* connectHost, int connectPort, int listenPort,
+    const DumpOptions* pOptions)
 {
     NetState* state;
+    pthread_t dumpThread;
+
+    gDumpOptions = *pOptions;
 
     state = jdwpNetStartup(listenPort, connectHost, connectPort);
     if (state == NULL)
         return -1;
 
+    if (pthread_create(&dumpThread, NULL, dumpThreadStart, NULL) != 0) {
+        fprintf(stderr, "Unable to start dump thread\n");
+        jdwpNetFree(state);
+        return -1;
+    }
+    pthread_detach(dumpThread);
+
     while (true) {
         if (!jdwpAcceptConnection(state))
             break;
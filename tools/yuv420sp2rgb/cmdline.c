@@ -16,6 +16,8 @@ static struct option long_options[] = {
     {"gray",    no_argument,       0, 'g'},
     {"type",    required_argument, 0, 't'},
     {"rotate",  required_argument, 0, 'r'},
+    {"stream",  no_argument,       0, 's'},
+    {"threads", required_argument, 0, 'j'},
     {"verbose", no_argument,       0, 'V'},
     {"help",    no_argument,       0, 1},
     {0, 0, 0, 0},
@@ -29,6 +31,9 @@ static const char *descriptions[] = {
     "process the luma plane only",
     "encode as one of { 'ppm', 'rgb', or 'argb' }",
     "rotate (90, -90, 180 degrees)",
+    "convert a stream of concatenated frames; '-' reads stdin or writes stdout,\n"
+    "\t\tand an output name with a %d in it writes one file per frame",
+    "number of threads converting a stream (default: one per cpu)",
     "print verbose output",
     "print this help screen",
 };
@@ -37,7 +42,7 @@ void print_help(const char *name) {
     fprintf(stdout,
             "Converts yuv 4:2:0 to rgb24 and generates a PPM file.\n"
             "invokation:\n"
-            "\t%s infile --height <height> --width <width> --output <outfile> -t <ppm|grb|argb> [ --gray ] [ --rotate <degrees> ] [ --verbose ]\n"
+            "\t%s infile --height <height> --width <width> --output <outfile> -t <ppm|grb|argb> [ --gray ] [ --rotate <degrees> ] [ --stream [ --threads <n> ] ] [ --verbose ]\n"
             "\t%s infile --help\n",
             name, name);
     fprintf(stdout, "options:\n");
@@ -61,6 +66,8 @@ int get_options(int argc, char **argv,
                 int *gray,
                 char **type,
                 int *rotate,
+                int *stream,
+                int *threads,
                 int *verbose) {
     int c;
 
@@ -69,6 +76,8 @@ int get_options(int argc, char **argv,
     ASSERT(width); *width = -1;
     ASSERT(gray); *gray = 0;
     ASSERT(rotate); *rotate = 0;
+    ASSERT(stream); *stream = 0;
+    ASSERT(threads); *threads = 0;
     ASSERT(verbose); *verbose = 0;
     ASSERT(type); *type = NULL;
 
@@ -77,7 +86,7 @@ int get_options(int argc, char **argv,
         int option_index = 0;
 
         c = getopt_long (argc, argv,
-                         "Vgo:h:w:r:t:",
+                         "Vgso:h:w:r:t:j:",
                          long_options,
                          &option_index);
         /* Detect the end of the options. */
@@ -129,7 +138,11 @@ int get_options(int argc, char **argv,
         case 'r':
             SET_INT_OPTION(rotate);
             break;
+        case 'j':
+            SET_INT_OPTION(threads);
+            break;
         case 'g': *gray = 1; break;
+        case 's': *stream = 1; break;
         case 'V': *verbose = 1; break;
         case '?':
             /* getopt_long already printed an error message. */
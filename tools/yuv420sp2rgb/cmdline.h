@@ -10,6 +10,8 @@ extern int get_options(int argc, char **argv,
                        int *gray,
                        char **type,
                        int *rotate,
+                       int *stream,
+                       int *threads,
                        int *verbose);
 
 #endif/*CMDLINE_H*/
@@ -8,6 +8,8 @@
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
+#include <limits.h>
+#include <pthread.h>
 
 #ifndef max
 #define max(a,b) ({typeof(a) _a = (a); typeof(b) _b = (b); _a > _b ? _a : _b; })
@@ -18,6 +20,8 @@
 #define CONVERT_TYPE_RGB 1
 #define CONVERT_TYPE_ARGB 2
 
+#define MAX_THREADS 16
+
 /*
    YUV 4:2:0 image with a plane of 8 bit Y samples followed by an interleaved
    U/V plane containing 8 bit 2x2 subsampled chroma samples.
@@ -29,23 +33,198 @@
    V (Cr) Sample Period 2 2
  */
 
-typedef struct rgb_context {
-    unsigned char *buffer;
-    int width;
-    int height;
-    int rotate;
-    int i;
+/*
+   The image is converted a pair of luma rows at a time, so that each row of
+   chroma samples is read and turned into its red, green and blue terms only
+   once. The output format is picked once per image: each kernel below writes
+   one pair of rows in its own format, and the compiler specializes the
+   inline helpers for it since the bytes per pixel and the alpha are
+   constants there.
+
+   When the image is rotated, it is converted STRIP_ROWS rows at a time into
+   a scratch strip, which is then copied to the output in BLOCK_SIZE x
+   BLOCK_SIZE tiles, rather than computing a rotated offset for every pixel
+   as it is converted.
+ */
+
+#define STRIP_ROWS 16
+#define BLOCK_SIZE 16
+
+typedef void (*rows_fn)(
+    const unsigned char *pY0,
+    const unsigned char *pY1, /* NULL for the last row of an odd height */
+    const unsigned char *pUV,
+    unsigned char *out0,
+    unsigned char *out1,
+    int width);
+
+static inline unsigned char clamp_rgb(int c)
+{
+    c = min(262143, max(0, c));
+    return (unsigned char)(c >> 10);
+}
+
+static inline void put_pixel(unsigned char *out,
+                             int r, int g, int b,
+                             const int alpha)
+{
+    int i = 0;
+    if (alpha) out[i++] = 0xff;
+    out[i++] = r;
+    out[i++] = g;
+    out[i] = b;
+}
+
+static inline void yuv_pixel(unsigned char *out, int nY,
+                             int rV, int gUV, int bU,
+                             const int alpha)
+{
+    nY -= 16;
+    if (nY < 0)
+        nY = 0;
+    nY *= 1192;
+
+    put_pixel(out,
+              clamp_rgb(nY + rV),
+              clamp_rgb(nY + gUV),
+              clamp_rgb(nY + bU),
+              alpha);
+}
+
+static inline void yuv_rows(const unsigned char *pY0,
+                            const unsigned char *pY1,
+                            const unsigned char *pUV,
+                            unsigned char *out0,
+                            unsigned char *out1,
+                            int width,
+                            const int alpha)
+{
+    const int bpp = 3 + !!alpha;
     int j;
-    int size; /* for debugging */
-} rgb_context;
 
-typedef void (*rgb_cb)(
-    unsigned char r,
-    unsigned char g,
-    unsigned char b,
-    rgb_context *ctx);
+    for (j = 0; j < width; j += 2) {
+        int nV = pUV[j] - 128;
+        int nU = pUV[j + 1] - 128;
+
+        // nR = (int)(1.164 * nY + 2.018 * nU);
+        // nG = (int)(1.164 * nY - 0.813 * nV - 0.391 * nU);
+        // nB = (int)(1.164 * nY + 1.596 * nV);
+
+        int bU = 2066 * nU;
+        int gUV = -833 * nV - 400 * nU;
+        int rV = 1634 * nV;
+
+        yuv_pixel(out0 + j * bpp, pY0[j], rV, gUV, bU, alpha);
+        if (pY1)
+            yuv_pixel(out1 + j * bpp, pY1[j], rV, gUV, bU, alpha);
+        if (j + 1 < width) {
+            yuv_pixel(out0 + (j + 1) * bpp, pY0[j + 1], rV, gUV, bU, alpha);
+            if (pY1)
+                yuv_pixel(out1 + (j + 1) * bpp, pY1[j + 1], rV, gUV, bU, alpha);
+        }
+    }
+}
+
+static inline void gray_rows(const unsigned char *pY0,
+                             const unsigned char *pY1,
+                             unsigned char *out0,
+                             unsigned char *out1,
+                             int width,
+                             const int alpha)
+{
+    const int bpp = 3 + !!alpha;
+    int j;
+
+    for (j = 0; j < width; j++) {
+        put_pixel(out0 + j * bpp, pY0[j], pY0[j], pY0[j], alpha);
+        if (pY1)
+            put_pixel(out1 + j * bpp, pY1[j], pY1[j], pY1[j], alpha);
+    }
+}
+
+static void rgb24_rows(const unsigned char *pY0, const unsigned char *pY1,
+                       const unsigned char *pUV,
+                       unsigned char *out0, unsigned char *out1,
+                       int width)
+{
+    yuv_rows(pY0, pY1, pUV, out0, out1, width, 0);
+}
+
+static void argb_rows(const unsigned char *pY0, const unsigned char *pY1,
+                      const unsigned char *pUV,
+                      unsigned char *out0, unsigned char *out1,
+                      int width)
+{
+    yuv_rows(pY0, pY1, pUV, out0, out1, width, 1);
+}
+
+static void gray_rgb24_rows(const unsigned char *pY0, const unsigned char *pY1,
+                            const unsigned char *pUV,
+                            unsigned char *out0, unsigned char *out1,
+                            int width)
+{
+    gray_rows(pY0, pY1, out0, out1, width, 0);
+}
+
+static void gray_argb_rows(const unsigned char *pY0, const unsigned char *pY1,
+                           const unsigned char *pUV,
+                           unsigned char *out0, unsigned char *out1,
+                           int width)
+{
+    gray_rows(pY0, pY1, out0, out1, width, 1);
+}
+
+/* Converts rows [first, first + count) of the image, first must be even. */
+static void convert_rows(rows_fn fn,
+                         const unsigned char *pY, const unsigned char *pUV,
+                         int width, int height,
+                         int first, int count,
+                         unsigned char *out, int stride)
+{
+    int i;
+    for (i = 0; i < count; i += 2) {
+        int row = first + i;
+        fn(pY + row * width,
+           row + 1 < height ? pY + (row + 1) * width : NULL,
+           pUV + (row / 2) * width,
+           out + i * stride,
+           out + (i + 1) * stride,
+           width);
+    }
+}
 
-const int bytes_per_pixel = 2;
+/*
+   Copies rows [first, first + count) of the unrotated image, held in strip,
+   to their rotated place in out. Pixel (row, j) of the image goes to pixel
+   base + row * di + j * dj of the output.
+ */
+static inline void rotate_strip(const unsigned char *strip,
+                                int first, int count,
+                                int width,
+                                int base, int di, int dj,
+                                unsigned char *out,
+                                const int bpp)
+{
+    int i, j, k, bj, bi;
+    int stride = width * bpp;
+
+    for (bj = 0; bj < width; bj += BLOCK_SIZE) {
+        int ej = min(width, bj + BLOCK_SIZE);
+        for (bi = 0; bi < count; bi += BLOCK_SIZE) {
+            int ei = min(count, bi + BLOCK_SIZE);
+            for (j = bj; j < ej; j++) {
+                const unsigned char *src = strip + bi * stride + j * bpp;
+                unsigned char *dst = out + (base + (first + bi) * di + j * dj) * bpp;
+                for (i = bi; i < ei; i++) {
+                    for (k = 0; k < bpp; k++)
+                        dst[k] = src[k];
+                    src += stride;
+                    dst += di * bpp;
+                }
+            }
+        }
+    }
+}
 
 static void color_convert_common(
     unsigned char *pY, unsigned char *pUV,
@@ -54,138 +233,87 @@ static void color_convert_common(
     int size, /* buffer size in bytes */
     int gray,
     int rotate,
-    rgb_cb cb) 
+    int alpha,
+    unsigned char *strip) /* STRIP_ROWS rows of scratch, used for rotation */
 {
-	int i, j;
-	int nR, nG, nB;
-	int nY, nU, nV;
-    rgb_context ctx;
+    int bpp = 3 + !!alpha;
+    int stride = width * bpp;
+    rows_fn fn;
+    int base = 0, di = 0, dj = 0;
+    int i;
 
-    ctx.buffer = buffer;
-    ctx.size = size; /* debug */
-    ctx.width = width;
-    ctx.height = height;
-    ctx.rotate = rotate;
+    FAILIF(rotate < 0 || rotate > 3, "Unexpected roation value %d!\n", rotate);
+    FAILIF(height * stride > size,
+           "a %dx%d image does not fit in the %d bytes of the buffer.\n",
+           width, height, size);
 
-    if (gray) {
-        for (i = 0; i < height; i++) {
-            for (j = 0; j < width; j++) {
-                nB = *(pY + i * width + j);
-                ctx.i = i;
-                ctx.j = j;
-                cb(nB, nB, nB, &ctx);
-            }
-        }	
-    } else {
-        // YUV 4:2:0
-        for (i = 0; i < height; i++) {
-            for (j = 0; j < width; j++) {
-                nY = *(pY + i * width + j);
-                nV = *(pUV + (i/2) * width + bytes_per_pixel * (j/2));
-                nU = *(pUV + (i/2) * width + bytes_per_pixel * (j/2) + 1);
-            
-                // Yuv Convert
-                nY -= 16;
-                nU -= 128;
-                nV -= 128;
-            
-                if (nY < 0)
-                    nY = 0;
-            
-                // nR = (int)(1.164 * nY + 2.018 * nU);
-                // nG = (int)(1.164 * nY - 0.813 * nV - 0.391 * nU);
-                // nB = (int)(1.164 * nY + 1.596 * nV);
-            
-                nB = (int)(1192 * nY + 2066 * nU);
-                nG = (int)(1192 * nY - 833 * nV - 400 * nU);
-                nR = (int)(1192 * nY + 1634 * nV);
-            
-                nR = min(262143, max(0, nR));
-                nG = min(262143, max(0, nG));
-                nB = min(262143, max(0, nB));
-            
-                nR >>= 10; nR &= 0xff;
-                nG >>= 10; nG &= 0xff;
-                nB >>= 10; nB &= 0xff;
-
-                ctx.i = i;
-                ctx.j = j;
-                cb(nR, nG, nB, &ctx);
-            }
-        }
-    }
-}   
+    if (gray)
+        fn = alpha ? gray_argb_rows : gray_rgb24_rows;
+    else
+        fn = alpha ? argb_rows : rgb24_rows;
 
-static void rgb16_cb(
-    unsigned char r,
-    unsigned char g,
-    unsigned char b,
-    rgb_context *ctx)
-{
-    unsigned short *rgb16 = (unsigned short *)ctx->buffer;
-    *(rgb16 + ctx->i * ctx->width + ctx->j) = b | (g << 5) | (r << 11);
-}
+    if (!rotate) {
+        convert_rows(fn, pY, pUV, width, height, 0, height, buffer, stride);
+        return;
+    }
 
-static void common_rgb_cb(
-    unsigned char r,
-    unsigned char g,
-    unsigned char b,
-    rgb_context *ctx,
-    int alpha)
-{
-    unsigned char *out = ctx->buffer;
-    int offset = 0;
-    int bpp;
-    int i = 0;
-    switch(ctx->rotate) {
-    case 0: /* no rotation */
-        offset = ctx->i * ctx->width + ctx->j;
-        break;
+    switch (rotate) {
     case 1: /* 90 degrees */
-        offset = ctx->height * (ctx->j + 1) - ctx->i;
+        base = height - 1;
+        di = -1;
+        dj = height;
         break;
     case 2: /* 180 degrees */
-        offset = (ctx->height - 1 - ctx->i) * ctx->width + ctx->j;
+        base = height * width - 1;
+        di = -width;
+        dj = -1;
         break;
     case 3: /* 270 degrees */
-        offset = (ctx->width - 1 - ctx->j) * ctx->height + ctx->i;
+        base = (width - 1) * height;
+        di = 1;
+        dj = -height;
         break;
-    default:
-        FAILIF(1, "Unexpected roation value %d!\n", ctx->rotate);
     }
 
-    bpp = 3 + !!alpha;
-    offset *= bpp;
-    FAILIF(offset < 0, "point (%d, %d) generates a negative offset.\n", ctx->i, ctx->j);
-    FAILIF(offset + bpp > ctx->size, "point (%d, %d) at offset %d exceeds the size %d of the buffer.\n",
-           ctx->i, ctx->j,
-           offset,
-           ctx->size);
-
-    out += offset;
-
-    if (alpha) out[i++] = 0xff;
-    out[i++] = r;
-    out[i++] = g;
-    out[i] = b;
+    for (i = 0; i < height; i += STRIP_ROWS) {
+        int count = min(STRIP_ROWS, height - i);
+        convert_rows(fn, pY, pUV, width, height, i, count, strip, stride);
+        if (alpha)
+            rotate_strip(strip, i, count, width, base, di, dj, buffer, 4);
+        else
+            rotate_strip(strip, i, count, width, base, di, dj, buffer, 3);
+    }
 }
 
-static void rgb24_cb(
-    unsigned char r,
-    unsigned char g,
-    unsigned char b,
-    rgb_context *ctx)
+/*
+   Writes the header of frames encoded as type into header, and returns its
+   size. The number of bytes per output pixel is stored in bpp.
+ */
+static int encode_header(int type, int width, int height, int rotate,
+                         char *header, size_t size, int *bpp)
 {
-    return common_rgb_cb(r,g,b,ctx,0);
-}
+    int header_size = 0;
 
-static void argb_cb(
-    unsigned char r,
-    unsigned char g,
-    unsigned char b,
-    rgb_context *ctx)
-{
-    return common_rgb_cb(r,g,b,ctx,1);
+    *bpp = 3;
+    switch (type) {
+    case CONVERT_TYPE_PPM:
+        PRINT("encoding PPM\n");
+        if (rotate & 1)
+            header_size = snprintf(header, size, "P6\n%d %d\n255\n", height, width);
+        else
+            header_size = snprintf(header, size, "P6\n%d %d\n255\n", width, height);
+	break;
+    case CONVERT_TYPE_RGB:
+        PRINT("encoding raw RGB24\n");
+        header_size = 0;
+        break;
+    case CONVERT_TYPE_ARGB:
+        PRINT("encoding raw ARGB\n");
+        header_size = 0;
+        *bpp = 4;
+        break;
+    }
+    return header_size;
 }
 
 static void convert(const char *infile,
@@ -202,27 +330,12 @@ static void convert(const char *infile,
     static char header[1024];
     int header_size;
     size_t outsize;
+    unsigned char *strip;
+    int bpp;
+
+    header_size = encode_header(type, width, height, rotate,
+                                header, sizeof(header), &bpp);
 
-    int bpp = 3;
-    switch (type) {
-    case CONVERT_TYPE_PPM:
-        PRINT("encoding PPM\n");
-        if (rotate & 1)
-            header_size = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", height, width);
-        else
-            header_size = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
-	break;
-    case CONVERT_TYPE_RGB:
-        PRINT("encoding raw RGB24\n");
-        header_size = 0;
-        break;
-    case CONVERT_TYPE_ARGB:
-        PRINT("encoding raw ARGB\n");
-        header_size = 0;
-        bpp = 4;
-        break;
-    }
-        
     outsize = header_size + width * height * bpp;
     outsize = (outsize + psz - 1) & ~(psz - 1);
 
@@ -257,11 +370,251 @@ static void convert(const char *infile,
            strerror(errno), errno);
 
     INFO("Converting %dx%d YUV 4:2:0 to RGB24...\n", width, height);
+    strip = MALLOC(STRIP_ROWS * width * bpp);
     color_convert_common(in, in + width * height,
                          width, height, 
                          out + header_size, outsize - header_size,
                          gray, rotate,
-                         type == CONVERT_TYPE_ARGB ? argb_cb : rgb24_cb);
+                         type == CONVERT_TYPE_ARGB,
+                         strip);
+    FREE(strip);
+}
+
+/*
+   Streaming mode: the input is a sequence of concatenated frames, read from
+   a file or from stdin, which are converted by a pool of worker threads.
+
+   Frames go through a ring of 2 * threads slots. The main thread reads frame
+   n into slot n % nslots, after first writing out the frame that slot held,
+   so frames come out in order; the workers convert the frames read and not
+   yet taken by another worker. Each worker has its own rotation strip.
+ */
+
+typedef struct frame_slot {
+    unsigned char *in;
+    unsigned char *out;      /* header followed by the converted frame */
+    int converted;
+} frame_slot;
+
+typedef struct stream_context {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    frame_slot *slots;
+    int nslots;
+    int nread;               /* frames read so far */
+    int next;                /* next frame to be converted */
+    int done;                /* set once the input is exhausted */
+
+    int width;
+    int height;
+    int gray;
+    int rotate;
+    int alpha;
+    int header_size;
+    size_t insize;
+    size_t outsize;
+} stream_context;
+
+static void *stream_worker(void *arg)
+{
+    stream_context *ctx = arg;
+    int bpp = 3 + !!ctx->alpha;
+    unsigned char *strip = MALLOC(STRIP_ROWS * ctx->width * bpp);
+
+    pthread_mutex_lock(&ctx->lock);
+    while (1) {
+        frame_slot *slot;
+
+        while (ctx->next == ctx->nread && !ctx->done)
+            pthread_cond_wait(&ctx->cond, &ctx->lock);
+        if (ctx->next == ctx->nread)
+            break;
+
+        slot = &ctx->slots[ctx->next++ % ctx->nslots];
+        pthread_mutex_unlock(&ctx->lock);
+
+        color_convert_common(slot->in, slot->in + ctx->width * ctx->height,
+                             ctx->width, ctx->height,
+                             slot->out + ctx->header_size,
+                             ctx->outsize - ctx->header_size,
+                             ctx->gray, ctx->rotate, ctx->alpha,
+                             strip);
+
+        pthread_mutex_lock(&ctx->lock);
+        slot->converted = 1;
+        pthread_cond_broadcast(&ctx->cond);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+
+    FREE(strip);
+    return NULL;
+}
+
+/* Reads up to len bytes, returns how many were read before end of file. */
+static size_t read_fully(int fd, void *buf, size_t len)
+{
+    size_t done = 0;
+    while (done < len) {
+        ssize_t rc = read(fd, (char *)buf + done, len - done);
+        if (rc < 0 && errno == EINTR)
+            continue;
+        FAILIF(rc < 0, "read() failed: %s (%d)\n", strerror(errno), errno);
+        if (rc == 0)
+            break;
+        done += rc;
+    }
+    return done;
+}
+
+static void write_fully(int fd, const void *buf, size_t len)
+{
+    size_t done = 0;
+    while (done < len) {
+        ssize_t rc = write(fd, (const char *)buf + done, len - done);
+        if (rc < 0 && errno == EINTR)
+            continue;
+        FAILIF(rc < 0, "write() failed: %s (%d)\n", strerror(errno), errno);
+        done += rc;
+    }
+}
+
+/*
+   Waits for frame n to be converted and writes it out, either to ofd or, when
+   ofd is negative, to its own file named after the outfile pattern.
+ */
+static void write_frame(stream_context *ctx, int n,
+                        const char *outfile, int ofd)
+{
+    frame_slot *slot = &ctx->slots[n % ctx->nslots];
+
+    pthread_mutex_lock(&ctx->lock);
+    while (!slot->converted)
+        pthread_cond_wait(&ctx->cond, &ctx->lock);
+    pthread_mutex_unlock(&ctx->lock);
+
+    if (ofd < 0) {
+        char name[PATH_MAX];
+        int fd;
+
+        snprintf(name, sizeof(name), outfile, n);
+        INFO("Writing frame %d to %s\n", n, name);
+        fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0664);
+        FAILIF(fd < 0, "open(%s) failed: %s (%d)\n",
+               name, strerror(errno), errno);
+        write_fully(fd, slot->out, ctx->outsize);
+        close(fd);
+    } else {
+        write_fully(ofd, slot->out, ctx->outsize);
+    }
+}
+
+static void convert_stream(const char *infile,
+                           const char *outfile,
+                           int height,
+                           int width,
+                           int gray,
+                           int type,
+                           int rotate,
+                           int threads)
+{
+    static char header[1024];
+    pthread_t workers[MAX_THREADS];
+    stream_context ctx;
+    int ifd, ofd = -1;
+    int bpp, i, n, first;
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.width = width;
+    ctx.height = height;
+    ctx.gray = gray;
+    ctx.rotate = rotate;
+    ctx.alpha = type == CONVERT_TYPE_ARGB;
+    ctx.header_size = encode_header(type, width, height, rotate,
+                                    header, sizeof(header), &bpp);
+    ctx.insize = width * height * 3 / 2;
+    ctx.outsize = ctx.header_size + width * height * bpp;
+
+    if (!strcmp(infile, "-")) {
+        ifd = STDIN_FILENO;
+    } else {
+        INFO("Opening input file %s\n", infile);
+        ifd = open(infile, O_RDONLY);
+        FAILIF(ifd < 0, "open(%s) failed: %s (%d)\n",
+               infile, strerror(errno), errno);
+    }
+
+    /* An output name with a % in it is a pattern for one file per frame. */
+    if (!strcmp(outfile, "-")) {
+        ofd = STDOUT_FILENO;
+    } else if (!strchr(outfile, '%')) {
+        INFO("Opening output file %s\n", outfile);
+        ofd = open(outfile, O_WRONLY | O_CREAT | O_TRUNC, 0664);
+        FAILIF(ofd < 0, "open(%s) failed: %s (%d)\n",
+               outfile, strerror(errno), errno);
+    }
+
+    ctx.nslots = 2 * threads;
+    ctx.slots = CALLOC(ctx.nslots, sizeof(frame_slot));
+    for (i = 0; i < ctx.nslots; i++) {
+        ctx.slots[i].in = MALLOC(ctx.insize);
+        ctx.slots[i].out = MALLOC(ctx.outsize);
+        memcpy(ctx.slots[i].out, header, ctx.header_size);
+    }
+    pthread_mutex_init(&ctx.lock, NULL);
+    pthread_cond_init(&ctx.cond, NULL);
+
+    INFO("Converting %dx%d YUV 4:2:0 frames with %d threads...\n",
+         width, height, threads);
+    for (i = 0; i < threads; i++)
+        FAILIF(pthread_create(&workers[i], NULL, stream_worker, &ctx),
+               "Could not create worker thread %d!\n", i);
+
+    for (n = 0; ; n++) {
+        frame_slot *slot = &ctx.slots[n % ctx.nslots];
+        size_t len;
+
+        if (n >= ctx.nslots)
+            write_frame(&ctx, n - ctx.nslots, outfile, ofd);
+
+        len = read_fully(ifd, slot->in, ctx.insize);
+        if (len < ctx.insize) {
+            if (len)
+                ERROR("Ignoring %d trailing bytes of a partial frame.\n", (int)len);
+            break;
+        }
+
+        pthread_mutex_lock(&ctx.lock);
+        slot->converted = 0;
+        ctx.nread++;
+        pthread_cond_broadcast(&ctx.cond);
+        pthread_mutex_unlock(&ctx.lock);
+    }
+
+    pthread_mutex_lock(&ctx.lock);
+    ctx.done = 1;
+    pthread_cond_broadcast(&ctx.cond);
+    pthread_mutex_unlock(&ctx.lock);
+
+    first = max(0, n - ctx.nslots + 1);
+    for (i = first; i < n; i++)
+        write_frame(&ctx, i, outfile, ofd);
+
+    for (i = 0; i < threads; i++)
+        pthread_join(workers[i], NULL);
+
+    PRINT("converted %d frames\n", n);
+
+    for (i = 0; i < ctx.nslots; i++) {
+        FREE(ctx.slots[i].in);
+        FREE(ctx.slots[i].out);
+    }
+    FREE(ctx.slots);
+    pthread_cond_destroy(&ctx.cond);
+    pthread_mutex_destroy(&ctx.lock);
+    if (ofd > STDOUT_FILENO)
+        close(ofd);
+    if (ifd != STDIN_FILENO)
+        close(ifd);
 }
 
 int verbose_flag;
@@ -270,7 +623,7 @@ int quiet_flag;
 int main(int argc, char **argv) {
 
     char *infile, *outfile, *type;
-    int height, width, gray, rotate;
+    int height, width, gray, rotate, stream, threads;
     int cmdline_error = 0;
 
     /* Parse command-line arguments. */
@@ -282,6 +635,8 @@ int main(int argc, char **argv) {
                             &gray,
                             &type,
                             &rotate,
+                            &stream,
+                            &threads,
                             &verbose_flag);
 
     if (first == argc) {
@@ -303,6 +658,15 @@ int main(int argc, char **argv) {
     rotate %= 4;
     if (rotate < 0) rotate += 4;
 
+    if (threads < 0 || threads > MAX_THREADS) {
+        ERROR("The number of threads must be between 1 and %d!\n", MAX_THREADS);
+        cmdline_error++;
+    }
+    if (!threads) {
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = min(MAX_THREADS, max(1, threads));
+    }
+
     if (cmdline_error) {
         print_help(argv[0]);
         exit(1);
@@ -310,6 +674,12 @@ int main(int argc, char **argv) {
 
     infile = argv[first];
 
+    /* Keep our messages out of a stream written to stdout. */
+    if (stream && !strcmp(outfile, "-")) {
+        quiet_flag = 1;
+        verbose_flag = 0;
+    }
+
     INFO("input file: [%s]\n", infile);
     INFO("output file: [%s]\n", outfile);
     INFO("height: %d\n", height);
@@ -317,6 +687,7 @@ int main(int argc, char **argv) {
     INFO("gray only: %d\n", gray);
     INFO("encode as: %s\n", type);
     INFO("rotation: %d\n", rotate);
+    INFO("stream: %d\n", stream);
     
     /* Convert the image */
 
@@ -329,10 +700,16 @@ int main(int argc, char **argv) {
         conv_type = CONVERT_TYPE_ARGB;
     else FAILIF(1, "Unknown encoding type %s.\n", type);
     
-    convert(infile, outfile,
-            height, width, gray,
-            conv_type,
-            rotate);
+    if (stream)
+        convert_stream(infile, outfile,
+                       height, width, gray,
+                       conv_type,
+                       rotate, threads);
+    else
+        convert(infile, outfile,
+                height, width, gray,
+                conv_type,
+                rotate);
         
     free(outfile);
     return 0;